@@ -0,0 +1,440 @@
+/** @file
+  Asynchronous TEEC_InvokeCommand calls and per command latency statistics
+  of the OP-TEE client library.
+  **/
+
+/*
+ * Copyright (c) 2018, Microsoft Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <ntddk.h>
+#include <ntstatus.h>
+#include <wdf.h>
+
+#include "OpteeClientLib.h"
+#include "OpteeClientAsync.h"
+#include "trace.h"
+
+#ifdef WPP_TRACING
+#include "OpteeClientAsync.tmh"
+#endif
+
+#define OPTEE_CLIENT_ASYNC_TAG 'ACPO'
+
+typedef struct _OPTEE_CLIENT_ASYNC_REQUEST
+{
+    LIST_ENTRY ListEntry;
+    TEEC_Session *Session;
+    uint32_t CommandId;
+    TEEC_Operation *Operation;
+    POPTEE_CLIENT_INVOKE_COMPLETION Completion;
+    PVOID Context;
+    LARGE_INTEGER SubmitTime;
+} OPTEE_CLIENT_ASYNC_REQUEST, *POPTEE_CLIENT_ASYNC_REQUEST;
+
+typedef struct _OPTEE_CLIENT_ASYNC_WORKER
+{
+    BOOLEAN Active;
+} OPTEE_CLIENT_ASYNC_WORKER, *POPTEE_CLIENT_ASYNC_WORKER;
+
+WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(OPTEE_CLIENT_ASYNC_WORKER, OpteeClientAsyncGetWorker);
+
+EVT_WDF_WORKITEM OpteeClientAsyncWorker;
+
+//
+// The lock protects the pending list, the worker states and all the
+// statistics. A worker is active from the time it is queued until it finds
+// the pending list empty.
+//
+
+static WDFWORKITEM AsyncWorkers[OPTEE_CLIENT_ASYNC_WORKER_COUNT];
+static LIST_ENTRY AsyncPendingList;
+static KSPIN_LOCK AsyncLock;
+static ULONG AsyncPending;
+static ULONG AsyncInFlight;
+static BOOLEAN AsyncRunning = FALSE;
+static OPTEE_CLIENT_ASYNC_STATISTICS AsyncStatistics;
+static OPTEE_CLIENT_INVOKE_STATISTICS InvokeStatistics[OPTEE_CLIENT_INVOKE_STATISTICS_ENTRIES];
+static LARGE_INTEGER AsyncPerformanceFrequency;
+
+
+static UINT64 OpteeClientAsyncElapsedMicroseconds(LARGE_INTEGER Start)
+{
+    LARGE_INTEGER Now;
+
+    Now = KeQueryPerformanceCounter(NULL);
+    if (AsyncPerformanceFrequency.QuadPart == 0) {
+        return 0;
+    }
+
+    return (UINT64)(Now.QuadPart - Start.QuadPart) * 1000000ULL /
+           (UINT64)AsyncPerformanceFrequency.QuadPart;
+}
+
+/*
+ * Create the worker pool.
+ */
+_Use_decl_annotations_
+NTSTATUS
+OpteeClientAsyncInit(
+    WDFDEVICE ServiceDevice
+    )
+{
+    WDF_OBJECT_ATTRIBUTES Attributes;
+    ULONG Index;
+    NTSTATUS Status;
+    WDF_WORKITEM_CONFIG WdfWorkitemConfig;
+
+    NT_ASSERT(!AsyncRunning);
+
+    InitializeListHead(&AsyncPendingList);
+    KeInitializeSpinLock(&AsyncLock);
+    AsyncPending = 0;
+    AsyncInFlight = 0;
+    RtlZeroMemory(&AsyncStatistics, sizeof(AsyncStatistics));
+    RtlZeroMemory(InvokeStatistics, sizeof(InvokeStatistics));
+    KeQueryPerformanceCounter(&AsyncPerformanceFrequency);
+
+    for (Index = 0; Index < OPTEE_CLIENT_ASYNC_WORKER_COUNT; Index++) {
+        WDF_OBJECT_ATTRIBUTES_INIT(&Attributes);
+        WDF_OBJECT_ATTRIBUTES_SET_CONTEXT_TYPE(&Attributes,
+                                               OPTEE_CLIENT_ASYNC_WORKER);
+        Attributes.ParentObject = ServiceDevice;
+
+        WDF_WORKITEM_CONFIG_INIT(&WdfWorkitemConfig, OpteeClientAsyncWorker);
+        WdfWorkitemConfig.AutomaticSerialization = FALSE;
+
+        Status = WdfWorkItemCreate(&WdfWorkitemConfig,
+                                   &Attributes,
+                                   &AsyncWorkers[Index]);
+
+        if (!NT_SUCCESS(Status)) {
+            TraceError("WdfWorkItemCreate failed, status %!STATUS!", Status);
+            AsyncWorkers[Index] = NULL;
+            OpteeClientAsyncDeinit();
+            return Status;
+        }
+
+        OpteeClientAsyncGetWorker(AsyncWorkers[Index])->Active = FALSE;
+    }
+
+    AsyncRunning = TRUE;
+    return STATUS_SUCCESS;
+}
+
+/*
+ * Stop accepting requests, wait for the queued ones to complete and
+ * delete the worker pool.
+ */
+_Use_decl_annotations_
+VOID
+OpteeClientAsyncDeinit(
+    VOID
+    )
+{
+    ULONG Index;
+    KIRQL OldIrql;
+
+    KeAcquireSpinLock(&AsyncLock, &OldIrql);
+    AsyncRunning = FALSE;
+    KeReleaseSpinLock(&AsyncLock, OldIrql);
+
+    // Active workers drain the pending list before they return.
+    //
+
+    for (Index = 0; Index < OPTEE_CLIENT_ASYNC_WORKER_COUNT; Index++) {
+        if (AsyncWorkers[Index] != NULL) {
+            WdfWorkItemFlush(AsyncWorkers[Index]);
+            WdfObjectDelete(AsyncWorkers[Index]);
+            AsyncWorkers[Index] = NULL;
+        }
+    }
+
+    NT_ASSERT(IsListEmpty(&AsyncPendingList));
+}
+
+/*
+ * Run queued invocations until the pending list is empty.
+ */
+_Use_decl_annotations_
+VOID
+OpteeClientAsyncWorker(
+    WDFWORKITEM WdfWorkItem
+    )
+{
+    uint32_t ErrorOrigin;
+    KIRQL OldIrql;
+    UINT64 QueueMicroseconds;
+    POPTEE_CLIENT_ASYNC_REQUEST Request;
+    TEEC_Result TeecResult;
+    POPTEE_CLIENT_ASYNC_WORKER Worker;
+
+    Worker = OpteeClientAsyncGetWorker(WdfWorkItem);
+
+    for (;;) {
+        KeAcquireSpinLock(&AsyncLock, &OldIrql);
+
+        if (IsListEmpty(&AsyncPendingList)) {
+            Worker->Active = FALSE;
+            KeReleaseSpinLock(&AsyncLock, OldIrql);
+            break;
+        }
+
+        Request = CONTAINING_RECORD(RemoveHeadList(&AsyncPendingList),
+                                    OPTEE_CLIENT_ASYNC_REQUEST,
+                                    ListEntry);
+
+        AsyncPending--;
+        AsyncInFlight++;
+        if (AsyncInFlight > AsyncStatistics.MaxInFlight) {
+            AsyncStatistics.MaxInFlight = AsyncInFlight;
+        }
+
+        KeReleaseSpinLock(&AsyncLock, OldIrql);
+
+        QueueMicroseconds = OpteeClientAsyncElapsedMicroseconds(Request->SubmitTime);
+
+        ErrorOrigin = TEEC_ORIGIN_API;
+        TeecResult = TEEC_InvokeCommand(Request->Session,
+                                        Request->CommandId,
+                                        Request->Operation,
+                                        &ErrorOrigin);
+
+        //
+        // Account for the request before completing it, the caller may
+        // tear down the session as soon as its completion has run.
+        //
+        KeAcquireSpinLock(&AsyncLock, &OldIrql);
+        AsyncInFlight--;
+        AsyncStatistics.Completed++;
+        AsyncStatistics.QueueMicroseconds += QueueMicroseconds;
+        KeReleaseSpinLock(&AsyncLock, OldIrql);
+
+        Request->Completion(Request->Context, TeecResult, ErrorOrigin);
+        ExFreePoolWithTag(Request, OPTEE_CLIENT_ASYNC_TAG);
+    }
+}
+
+/*
+ * Queue a TEEC_InvokeCommand call and start an idle worker for it, if
+ * there is one.
+ */
+_Use_decl_annotations_
+TEEC_Result
+OpteeClientInvokeCommandAsync(
+    TEEC_Session *Session,
+    uint32_t CommandId,
+    TEEC_Operation *Operation,
+    POPTEE_CLIENT_INVOKE_COMPLETION Completion,
+    PVOID Context
+    )
+{
+    ULONG Index;
+    KIRQL OldIrql;
+    POPTEE_CLIENT_ASYNC_REQUEST Request;
+    TEEC_Result TeecResult;
+    POPTEE_CLIENT_ASYNC_WORKER Worker;
+    WDFWORKITEM WorkItem;
+
+    if ((Session == NULL) || (Completion == NULL)) {
+        return TEEC_ERROR_BAD_PARAMETERS;
+    }
+
+    Request = ExAllocatePoolWithTag(NonPagedPoolNx,
+                                    sizeof(*Request),
+                                    OPTEE_CLIENT_ASYNC_TAG);
+
+    if (Request == NULL) {
+        return TEEC_ERROR_OUT_OF_MEMORY;
+    }
+
+    Request->Session = Session;
+    Request->CommandId = CommandId;
+    Request->Operation = Operation;
+    Request->Completion = Completion;
+    Request->Context = Context;
+    Request->SubmitTime = KeQueryPerformanceCounter(NULL);
+
+    WorkItem = NULL;
+
+    KeAcquireSpinLock(&AsyncLock, &OldIrql);
+
+    if (!AsyncRunning) {
+        TeecResult = TEEC_ERROR_BAD_STATE;
+
+    } else if (AsyncPending >= OPTEE_CLIENT_ASYNC_MAX_PENDING) {
+        AsyncStatistics.Rejected++;
+        TeecResult = TEEC_ERROR_BUSY;
+
+    } else {
+        InsertTailList(&AsyncPendingList, &Request->ListEntry);
+        AsyncPending++;
+        AsyncStatistics.Submitted++;
+        if (AsyncPending > AsyncStatistics.MaxPending) {
+            AsyncStatistics.MaxPending = AsyncPending;
+        }
+
+        for (Index = 0; Index < OPTEE_CLIENT_ASYNC_WORKER_COUNT; Index++) {
+            Worker = OpteeClientAsyncGetWorker(AsyncWorkers[Index]);
+            if (!Worker->Active) {
+                Worker->Active = TRUE;
+                WorkItem = AsyncWorkers[Index];
+                break;
+            }
+        }
+
+        Request = NULL;
+        TeecResult = TEEC_SUCCESS;
+    }
+
+    KeReleaseSpinLock(&AsyncLock, OldIrql);
+
+    if (Request != NULL) {
+        ExFreePoolWithTag(Request, OPTEE_CLIENT_ASYNC_TAG);
+    }
+
+    // With all the workers active the request is picked up by the first
+    // one to finish its current call.
+    //
+
+    if (WorkItem != NULL) {
+        WdfWorkItemEnqueue(WorkItem);
+    }
+
+    return TeecResult;
+}
+
+/*
+ * Account a completed TEEC_InvokeCommand call.
+ */
+_Use_decl_annotations_
+VOID
+OpteeClientInvokeRecord(
+    UINT32 SessionId,
+    UINT32 CommandId,
+    LARGE_INTEGER Start,
+    TEEC_Result TeecResult
+    )
+{
+    POPTEE_CLIENT_INVOKE_STATISTICS Entry;
+    ULONG Index;
+    UINT64 Microseconds;
+    KIRQL OldIrql;
+    UINT64 Value;
+    ULONG Bucket;
+
+    Microseconds = OpteeClientAsyncElapsedMicroseconds(Start);
+    Entry = NULL;
+
+    KeAcquireSpinLock(&AsyncLock, &OldIrql);
+
+    for (Index = 0; Index < AsyncStatistics.CommandCount; Index++) {
+        if ((InvokeStatistics[Index].SessionId == SessionId) &&
+            (InvokeStatistics[Index].CommandId == CommandId)) {
+
+            Entry = &InvokeStatistics[Index];
+            break;
+        }
+    }
+
+    if ((Entry == NULL) &&
+        (AsyncStatistics.CommandCount < OPTEE_CLIENT_INVOKE_STATISTICS_ENTRIES)) {
+
+        Entry = &InvokeStatistics[AsyncStatistics.CommandCount++];
+        Entry->SessionId = SessionId;
+        Entry->CommandId = CommandId;
+    }
+
+    if (Entry == NULL) {
+        AsyncStatistics.UntrackedInvocations++;
+        KeReleaseSpinLock(&AsyncLock, OldIrql);
+        return;
+    }
+
+    Entry->Invocations++;
+    if (TeecResult != TEEC_SUCCESS) {
+        Entry->Failures++;
+    }
+
+    Entry->TotalMicroseconds += Microseconds;
+    if (Microseconds > Entry->MaxMicroseconds) {
+        Entry->MaxMicroseconds = Microseconds;
+    }
+
+    Bucket = 0;
+    Value = Microseconds >> OPTEE_CLIENT_INVOKE_LATENCY_BUCKET_SHIFT;
+    while ((Value != 0) && (Bucket < (OPTEE_CLIENT_INVOKE_LATENCY_BUCKETS - 1))) {
+        Value >>= 1;
+        Bucket++;
+    }
+
+    Entry->Latency[Bucket]++;
+
+    KeReleaseSpinLock(&AsyncLock, OldIrql);
+}
+
+/*
+ * Get a snapshot of the asynchronous invocation statistics.
+ */
+_Use_decl_annotations_
+VOID
+OpteeClientAsyncGetStatistics(
+    POPTEE_CLIENT_ASYNC_STATISTICS Statistics
+    )
+{
+    KIRQL OldIrql;
+
+    KeAcquireSpinLock(&AsyncLock, &OldIrql);
+    RtlCopyMemory(Statistics, &AsyncStatistics, sizeof(*Statistics));
+    KeReleaseSpinLock(&AsyncLock, OldIrql);
+}
+
+/*
+ * Get a snapshot of the statistics of a session/command pair, returns FALSE
+ * once Index is past the last tracked pair.
+ */
+_Use_decl_annotations_
+BOOLEAN
+OpteeClientInvokeGetStatistics(
+    ULONG Index,
+    POPTEE_CLIENT_INVOKE_STATISTICS Statistics
+    )
+{
+    BOOLEAN Found;
+    KIRQL OldIrql;
+
+    KeAcquireSpinLock(&AsyncLock, &OldIrql);
+
+    Found = (Index < AsyncStatistics.CommandCount);
+    if (Found) {
+        RtlCopyMemory(Statistics, &InvokeStatistics[Index], sizeof(*Statistics));
+    }
+
+    KeReleaseSpinLock(&AsyncLock, OldIrql);
+
+    return Found;
+}
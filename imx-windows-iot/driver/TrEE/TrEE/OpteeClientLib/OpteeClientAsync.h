@@ -0,0 +1,134 @@
+/** @file
+  Asynchronous TEEC_InvokeCommand calls and per command latency statistics
+  of the OP-TEE client library.
+**/
+
+/*
+ * Copyright (c) 2018, Microsoft Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "tee_client_api.h"
+
+//
+// Asynchronous invocations are run by a bounded pool of workers, each of
+// which drains the pending list. OP-TEE only has a few threads, a call that
+// finds all of them busy waits in OpteeSmcCallInternal for one to free up.
+//
+#define OPTEE_CLIENT_ASYNC_WORKER_COUNT 4
+#define OPTEE_CLIENT_ASYNC_MAX_PENDING 64
+
+//
+// Latency bucket 0 counts calls that completed in less than 64us, bucket N
+// those that took from 64us << (N - 1) up to 64us << N, the last bucket
+// also counts everything beyond it.
+//
+#define OPTEE_CLIENT_INVOKE_LATENCY_BUCKETS 20
+#define OPTEE_CLIENT_INVOKE_LATENCY_BUCKET_SHIFT 6
+
+//
+// Number of distinct session/command pairs tracked, invocations of further
+// pairs are only counted as untracked.
+//
+#define OPTEE_CLIENT_INVOKE_STATISTICS_ENTRIES 32
+
+typedef
+VOID
+OPTEE_CLIENT_INVOKE_COMPLETION(
+    _In_opt_ PVOID Context,
+    _In_ TEEC_Result TeecResult,
+    _In_ uint32_t ErrorOrigin
+    );
+
+typedef OPTEE_CLIENT_INVOKE_COMPLETION *POPTEE_CLIENT_INVOKE_COMPLETION;
+
+typedef struct _OPTEE_CLIENT_INVOKE_STATISTICS {
+    UINT32 SessionId;
+    UINT32 CommandId;
+    UINT64 Invocations;
+    UINT64 Failures;
+    UINT64 TotalMicroseconds;
+    UINT64 MaxMicroseconds;
+    UINT64 Latency[OPTEE_CLIENT_INVOKE_LATENCY_BUCKETS];
+} OPTEE_CLIENT_INVOKE_STATISTICS, *POPTEE_CLIENT_INVOKE_STATISTICS;
+
+typedef struct _OPTEE_CLIENT_ASYNC_STATISTICS {
+    UINT64 Submitted;
+    UINT64 Completed;
+    UINT64 Rejected;
+    UINT64 QueueMicroseconds;
+    ULONG MaxPending;
+    ULONG MaxInFlight;
+    UINT64 UntrackedInvocations;
+    ULONG CommandCount;
+} OPTEE_CLIENT_ASYNC_STATISTICS, *POPTEE_CLIENT_ASYNC_STATISTICS;
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+OpteeClientAsyncInit(
+    _In_ WDFDEVICE ServiceDevice
+    );
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+VOID
+OpteeClientAsyncDeinit(
+    VOID
+    );
+
+//
+// Queue a TEEC_InvokeCommand call. On success the completion routine is
+// called from a worker thread at PASSIVE_LEVEL once the call is done, the
+// session and the operation must stay valid until then.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+TEEC_Result
+OpteeClientInvokeCommandAsync(
+    _In_ TEEC_Session *Session,
+    _In_ uint32_t CommandId,
+    _In_opt_ TEEC_Operation *Operation,
+    _In_ POPTEE_CLIENT_INVOKE_COMPLETION Completion,
+    _In_opt_ PVOID Context
+    );
+
+VOID
+OpteeClientInvokeRecord(
+    _In_ UINT32 SessionId,
+    _In_ UINT32 CommandId,
+    _In_ LARGE_INTEGER Start,
+    _In_ TEEC_Result TeecResult
+    );
+
+VOID
+OpteeClientAsyncGetStatistics(
+    _Out_ POPTEE_CLIENT_ASYNC_STATISTICS Statistics
+    );
+
+BOOLEAN
+OpteeClientInvokeGetStatistics(
+    _In_ ULONG Index,
+    _Out_ POPTEE_CLIENT_INVOKE_STATISTICS Statistics
+    );
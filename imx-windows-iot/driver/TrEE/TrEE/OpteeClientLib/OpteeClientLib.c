@@ -38,6 +38,8 @@ secure world for handling.
 #include "OpteeClientMemory.h"
 #include "OpteeClientSMC.h"
 #include "OpteeClientRPC.h"
+#include "OpteeClientAsync.h"
+#include "OpteeClientWaitQueue.h"
 #include "trace.h"
 
 #ifdef WPP_TRACING
@@ -48,6 +50,7 @@ secure world for handling.
 WDFDEVICE LibServiceDevice = NULL;
 KSEMAPHORE OpteeSMCLock;
 KSEMAPHORE OpteeMemLock;
+KEVENT OpteeSmcThreadEvent;
 
 static BOOLEAN OpteeClientLibInitialized = FALSE;
 static LONG OpteeClientApiLibRefCount = 0;
@@ -101,8 +104,29 @@ NTSTATUS OpteeClientApiLibInitialize(
             goto Exit;
         }
 
+        Status = OpteeClientRpmbInit();
+        if (!NT_SUCCESS(Status)) {
+            TraceError("OpteeClientRpmbInit failed, status %!STATUS!",
+                Status);
+
+            goto Exit;
+        }
+
         LibServiceDevice = ServiceDevice;
 
+        Status = OpteeClientAsyncInit(ServiceDevice);
+        if (!NT_SUCCESS(Status)) {
+            TraceError("OpteeClientAsyncInit failed, status %!STATUS!",
+                Status);
+
+            goto Exit;
+        }
+
+        // Signaled whenever an SMC call completes and frees an OP-TEE thread.
+        //
+
+        KeInitializeEvent(&OpteeSmcThreadEvent, SynchronizationEvent, FALSE);
+
         // Initializing the SMC lock.
         //
 
@@ -141,6 +165,8 @@ NTSTATUS OpteeClientApiLibInitialize(
                 IO_NO_INCREMENT,
                 1,
                 FALSE);
+
+            OpteeClientAsyncDeinit();
         }
     }
 
@@ -285,6 +311,130 @@ OpteeClientApiLibDeinitialize(
         }
         OpteeClientRpmbPnpNotificationHandle = NULL;
 
+        // Complete the queued asynchronous calls before tearing down the
+        // resources they use.
+        //
+
+        OpteeClientAsyncDeinit();
+
+        OPTEE_CLIENT_MEM_STATISTICS MemStatistics;
+        ULONG ClassIndex;
+
+        OpteeClientMemGetStatistics(&MemStatistics);
+        TraceInformation("Shared memory: %u of %u pages free, largest free run %u, fragmentation %u%%, %I64u large blocks, %I64u failed",
+            MemStatistics.FreePages,
+            MemStatistics.TotalPages,
+            MemStatistics.LargestFreeRun,
+            MemStatistics.FragmentationPercent,
+            MemStatistics.LargeAllocations,
+            MemStatistics.LargeFailures);
+        TraceInformation("Shared memory slabs: %u pages, occupancy %u%%, %I64u reclaims, %I64u pages reclaimed",
+            MemStatistics.SlabPages,
+            MemStatistics.SlabOccupancyPercent,
+            MemStatistics.Reclaims,
+            MemStatistics.ReclaimedPages);
+        for (ClassIndex = 0; ClassIndex < OPTEE_CLIENT_MEM_SLAB_CLASS_COUNT; ClassIndex++) {
+            TraceInformation("Shared memory slab %u: %u pages, %u in use, %I64u allocations, %I64u fast, %I64u refills, %I64u failed",
+                MemStatistics.Slab[ClassIndex].ChunkSize,
+                MemStatistics.Slab[ClassIndex].Pages,
+                MemStatistics.Slab[ClassIndex].ChunksInUse,
+                MemStatistics.Slab[ClassIndex].Allocations,
+                MemStatistics.Slab[ClassIndex].FastAllocations,
+                MemStatistics.Slab[ClassIndex].Refills,
+                MemStatistics.Slab[ClassIndex].Failures);
+        }
+
+        OPTEE_RPMB_STATISTICS RpmbStatistics;
+        static const char *RpmbRequestNames[OpteeRpmbRequestTypeCount] = {
+            "program key", "query counter", "write", "read", "device info"
+        };
+
+        OpteeClientRpmbGetStatistics(&RpmbStatistics);
+        TraceInformation("RPMB: %I64u operations, %I64u us, %I64u buffer reuses, %I64u grows, %I64u temporary, %I64u device info cache hits",
+            RpmbStatistics.Operations,
+            RpmbStatistics.OperationMicroseconds,
+            RpmbStatistics.BufferReuses,
+            RpmbStatistics.BufferGrows,
+            RpmbStatistics.TemporaryBuffers,
+            RpmbStatistics.DevInfoCacheHits);
+        for (ClassIndex = 0; ClassIndex < OPTEE_RPMB_SIZE_BUCKETS; ClassIndex++) {
+            if (RpmbStatistics.RequestsPerOperation[ClassIndex] != 0) {
+                TraceInformation("RPMB operations with %u+ requests: %I64u",
+                    1 << ClassIndex,
+                    RpmbStatistics.RequestsPerOperation[ClassIndex]);
+            }
+        }
+        for (ClassIndex = 0; ClassIndex < OPTEE_RPMB_LATENCY_BUCKETS; ClassIndex++) {
+            if (RpmbStatistics.OperationLatency[ClassIndex] != 0) {
+                TraceInformation("RPMB operations taking %u+ us: %I64u",
+                    ClassIndex == 0 ? 0 : (1 << (OPTEE_RPMB_LATENCY_BUCKET_SHIFT + ClassIndex - 1)),
+                    RpmbStatistics.OperationLatency[ClassIndex]);
+            }
+        }
+        for (ClassIndex = 0; ClassIndex < OpteeRpmbRequestTypeCount; ClassIndex++) {
+            POPTEE_RPMB_REQUEST_STATISTICS RequestStatistics = &RpmbStatistics.Request[ClassIndex];
+
+            if (RequestStatistics->Requests == 0) {
+                continue;
+            }
+
+            TraceInformation("RPMB %s: %I64u requests, %I64u device calls, %I64u blocks, %I64u failed, avg %I64u us, max %I64u us",
+                RpmbRequestNames[ClassIndex],
+                RequestStatistics->Requests,
+                RequestStatistics->DeviceCalls,
+                RequestStatistics->Blocks,
+                RequestStatistics->Failures,
+                RequestStatistics->TotalMicroseconds / RequestStatistics->Requests,
+                RequestStatistics->MaxMicroseconds);
+        }
+
+        OPTEE_CLIENT_ASYNC_STATISTICS AsyncStatistics;
+        OPTEE_CLIENT_INVOKE_STATISTICS InvokeStatistics;
+        OPTEE_WAIT_QUEUE_STATISTICS WaitQueueStatistics;
+
+        OpteeClientAsyncGetStatistics(&AsyncStatistics);
+        TraceInformation("Async invoke: %I64u submitted, %I64u completed, %I64u rejected, %I64u us queued, max %u pending, max %u in flight",
+            AsyncStatistics.Submitted,
+            AsyncStatistics.Completed,
+            AsyncStatistics.Rejected,
+            AsyncStatistics.QueueMicroseconds,
+            AsyncStatistics.MaxPending,
+            AsyncStatistics.MaxInFlight);
+        for (ClassIndex = 0; OpteeClientInvokeGetStatistics(ClassIndex, &InvokeStatistics); ClassIndex++) {
+            ULONG Bucket;
+
+            TraceInformation("Invoke session 0x%X command 0x%X: %I64u calls, %I64u failed, avg %I64u us, max %I64u us",
+                InvokeStatistics.SessionId,
+                InvokeStatistics.CommandId,
+                InvokeStatistics.Invocations,
+                InvokeStatistics.Failures,
+                InvokeStatistics.TotalMicroseconds / InvokeStatistics.Invocations,
+                InvokeStatistics.MaxMicroseconds);
+            for (Bucket = 0; Bucket < OPTEE_CLIENT_INVOKE_LATENCY_BUCKETS; Bucket++) {
+                if (InvokeStatistics.Latency[Bucket] != 0) {
+                    TraceInformation("Invoke session 0x%X command 0x%X taking %u+ us: %I64u",
+                        InvokeStatistics.SessionId,
+                        InvokeStatistics.CommandId,
+                        Bucket == 0 ? 0 : (1 << (OPTEE_CLIENT_INVOKE_LATENCY_BUCKET_SHIFT + Bucket - 1)),
+                        InvokeStatistics.Latency[Bucket]);
+                }
+            }
+        }
+        if (AsyncStatistics.UntrackedInvocations != 0) {
+            TraceInformation("Invoke: %I64u calls of untracked commands",
+                AsyncStatistics.UntrackedInvocations);
+        }
+
+        OpteeClientWaitQueueGetStatistics(&WaitQueueStatistics);
+        TraceInformation("Wait queue: %I64u sleeps, %I64u wake-ups, %I64u early, %u blocks, max %u blocks, max chain %u",
+            WaitQueueStatistics.Sleeps,
+            WaitQueueStatistics.WakeUps,
+            WaitQueueStatistics.EarlyWakeUps,
+            WaitQueueStatistics.Blocks,
+            WaitQueueStatistics.MaxBlocks,
+            WaitQueueStatistics.MaxChainLength);
+
+        OpteeClientRpmbDeinit();
         OpteeClientMemDeinit();
 	OpteeClientLibInitialized = FALSE;
     }
@@ -620,11 +770,14 @@ TEEC_Result TEEC_InvokeCommand(TEEC_Session *session,
 {
     TEEC_Result TeecResult = TEEC_SUCCESS;
     uint32_t TeecErrorOrigin = TEEC_ORIGIN_API;
+    LARGE_INTEGER Start;
 
     TraceDebug("TEEC_InvokeCommand Enter: session=0x%p, cmd_id=0x%X\n",
         session,
         cmd_id);
 
+    Start = KeQueryPerformanceCounter(NULL);
+
     if (session == NULL) {
         ASSERT(session != NULL);
         TeecResult = TEEC_ERROR_BAD_PARAMETERS;
@@ -651,6 +804,8 @@ TEEC_Result TEEC_InvokeCommand(TEEC_Session *session,
         //
         TeecResult = TEEC_SMC_InvokeCommand(session, cmd_id,
             TeecOperation, &TeecErrorOrigin);
+
+        OpteeClientInvokeRecord(session->session_id, cmd_id, Start, TeecResult);
     }
 
 Exit:
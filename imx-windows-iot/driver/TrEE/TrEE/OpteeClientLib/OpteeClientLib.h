@@ -41,6 +41,7 @@ secure world for handling.
 extern WDFDEVICE LibServiceDevice;
 extern KSEMAPHORE OpteeSMCLock;
 extern KSEMAPHORE OpteeMemLock;
+extern KEVENT OpteeSmcThreadEvent;
 
 NTSTATUS
 OpteeClientApiLibInitialize(
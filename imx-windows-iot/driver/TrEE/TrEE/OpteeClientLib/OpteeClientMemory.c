@@ -57,6 +57,15 @@ client in normal world and the OP-TEE OS in secure world.
 #define OPTEE_SHM_RESERVED_SIZE 0x1000
 #define MEMORY_GANULARITY PAGE_SIZE
 
+//
+// Small blocks are carved from slab pages, a slab page starts with the
+// OPTEE_CLIENT_SLAB_PAGE header followed by the chunks of one size class.
+// The chunk of a free block holds the SLIST_ENTRY, an allocated chunk
+// starts with the OPTEE_CLIENT_MEM_HEADER like any other block.
+//
+#define OPTEE_SLAB_PAGE_HEADER_SIZE 64
+#define OPTEE_SLAB_PAGE_SIGNATURE 'bSTO'
+
 /*
 * Driver image handle to use for memory allocation.
 */
@@ -79,6 +88,66 @@ typedef struct _OPTEE_CLIENT_MEM_HEADER {
     UINT64 Reserved64;
 } OPTEE_CLIENT_MEM_HEADER;
 
+/*
+* Header at the start of each slab page.
+* ReclaimCount and Link are only used with OpteeMemLock held.
+*/
+typedef struct _OPTEE_CLIENT_SLAB_PAGE {
+
+    UINT32 Signature;
+    UINT32 BitMapIndex;
+    UINT32 ClassIndex;
+    UINT32 ChunkCount;
+    UINT32 ReclaimCount;
+    LIST_ENTRY Link;
+} OPTEE_CLIENT_SLAB_PAGE;
+
+C_ASSERT(sizeof(OPTEE_CLIENT_SLAB_PAGE) <= OPTEE_SLAB_PAGE_HEADER_SIZE);
+C_ASSERT(sizeof(SLIST_ENTRY) <= sizeof(OPTEE_CLIENT_MEM_HEADER));
+C_ASSERT((OPTEE_SLAB_PAGE_HEADER_SIZE % MEMORY_ALLOCATION_ALIGNMENT) == 0);
+
+/*
+* Free lists of one processor. A processor allocates from and frees to its own
+* lists, so the interlocked operations of the fast path do not bounce between
+* processors. The counters are only written by their processor too.
+*/
+typedef struct DECLSPEC_CACHEALIGN _OPTEE_CLIENT_SLAB_CPU {
+
+    SLIST_HEADER FreeList[OPTEE_CLIENT_MEM_SLAB_CLASS_COUNT];
+    LONG64 Allocations[OPTEE_CLIENT_MEM_SLAB_CLASS_COUNT];
+    LONG64 FastAllocations[OPTEE_CLIENT_MEM_SLAB_CLASS_COUNT];
+    LONG64 Frees[OPTEE_CLIENT_MEM_SLAB_CLASS_COUNT];
+} OPTEE_CLIENT_SLAB_CPU;
+
+typedef struct _OPTEE_CLIENT_SLAB_CLASS {
+
+    LIST_ENTRY PageList;
+    UINT32 ChunkSize;
+    UINT32 ChunksPerPage;
+    UINT32 Pages;
+    LONG64 Refills;
+    LONG64 Failures;
+} OPTEE_CLIENT_SLAB_CLASS;
+
+typedef struct _OPTEE_CLIENT_SLAB {
+
+    OPTEE_CLIENT_SLAB_CPU *Cpu;
+    ULONG ProcessorCount;
+    OPTEE_CLIENT_SLAB_CLASS Class[OPTEE_CLIENT_MEM_SLAB_CLASS_COUNT];
+    LONG64 LargeAllocations;
+    LONG64 LargeFailures;
+    LONG64 Reclaims;
+    LONG64 ReclaimedPages;
+} OPTEE_CLIENT_SLAB;
+
+static const UINT32 OpteeSlabChunkSize[OPTEE_CLIENT_MEM_SLAB_CLASS_COUNT] = {
+    64, 128, 256, 512, 1024
+};
+
+C_ASSERT(OPTEE_CLIENT_MEM_SLAB_MAX_SIZE + sizeof(OPTEE_CLIENT_MEM_HEADER) == 1024);
+
+static OPTEE_CLIENT_SLAB g_OpteeSlab;
+
 
 NTSTATUS OpteeClientMemInit(
     _In_ HANDLE ImageHandle,
@@ -93,6 +162,8 @@ NTSTATUS OpteeClientMemInit(
 
 {
     ULONG BitMapSizeBits;
+    ULONG Cpu;
+    ULONG ClassIndex;
     NTSTATUS Status = STATUS_SUCCESS;
 
     UNREFERENCED_PARAMETER(ImageHandle);
@@ -141,6 +212,40 @@ NTSTATUS OpteeClientMemInit(
     //
     RtlClearAllBits(&g_OpteeMemoryHeader.BitMapHeader);
 
+    //
+    // Set up the slab classes and the per processor free lists.
+    //
+    RtlZeroMemory(&g_OpteeSlab, sizeof(g_OpteeSlab));
+
+    g_OpteeSlab.ProcessorCount = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+    g_OpteeSlab.Cpu = ExAllocatePoolWithTag(NonPagedPoolNx,
+        g_OpteeSlab.ProcessorCount * sizeof(OPTEE_CLIENT_SLAB_CPU),
+        OPTEE_TREE_POOL_TAG);
+
+    if (g_OpteeSlab.Cpu == NULL) {
+        //
+        // Report Error.
+        //
+        Status = STATUS_UNSUCCESSFUL;
+        goto Exit;
+    }
+
+    RtlZeroMemory(g_OpteeSlab.Cpu,
+        g_OpteeSlab.ProcessorCount * sizeof(OPTEE_CLIENT_SLAB_CPU));
+
+    for (Cpu = 0; Cpu < g_OpteeSlab.ProcessorCount; Cpu++) {
+        for (ClassIndex = 0; ClassIndex < OPTEE_CLIENT_MEM_SLAB_CLASS_COUNT; ClassIndex++) {
+            InitializeSListHead(&g_OpteeSlab.Cpu[Cpu].FreeList[ClassIndex]);
+        }
+    }
+
+    for (ClassIndex = 0; ClassIndex < OPTEE_CLIENT_MEM_SLAB_CLASS_COUNT; ClassIndex++) {
+        InitializeListHead(&g_OpteeSlab.Class[ClassIndex].PageList);
+        g_OpteeSlab.Class[ClassIndex].ChunkSize = OpteeSlabChunkSize[ClassIndex];
+        g_OpteeSlab.Class[ClassIndex].ChunksPerPage =
+            (PAGE_SIZE - OPTEE_SLAB_PAGE_HEADER_SIZE) / OpteeSlabChunkSize[ClassIndex];
+    }
+
 Exit:
     return Status;
 }
@@ -169,39 +274,129 @@ OpteeClientMemDeinit()
     }
 
     g_OpteeMemoryHeader.BitMapAddress = NULL;
+
+    if (g_OpteeSlab.Cpu != NULL) {
+        ExFreePoolWithTag(g_OpteeSlab.Cpu,
+                          OPTEE_TREE_POOL_TAG);
+    }
+
+    RtlZeroMemory(&g_OpteeSlab, sizeof(g_OpteeSlab));
 }
 
 
-NTSTATUS
-OpteeClientMemAlloc(
-    _In_ UINT32 Length,
-    _Out_ PVOID *AllocatedMemory,
-    _Out_opt_ PHYSICAL_ADDRESS *PhysicalMemory
-    )
+static
+ULONG
+OpteeClientSlabReclaim()
 
 /*
- * Allocate a page aligned block of memory from the TrustZone
- * shared memory block.
+ * Give the slab pages with no allocated chunk back to the page bitmap.
+ * All the free chunks are taken from the free lists, a page whose chunks
+ * were all found free is released, the other chunks are put back.
+ * A chunk freed meanwhile just keeps its page. Must be called with
+ * OpteeMemLock held.
  */
 
 {
-    NTSTATUS Status;
-    UINT32 ActualLength;
-    ULONG NumPages;
-    ULONG ClearIndex;
+    ULONG ClassIndex;
+    ULONG Cpu;
+    ULONG ReleasedPages = 0;
+    PSLIST_ENTRY Chunks;
+    PSLIST_ENTRY Entry;
+    PSLIST_ENTRY Next;
+    OPTEE_CLIENT_SLAB_PAGE* Page;
+    PLIST_ENTRY Link;
+
+    for (ClassIndex = 0; ClassIndex < OPTEE_CLIENT_MEM_SLAB_CLASS_COUNT; ClassIndex++) {
+        OPTEE_CLIENT_SLAB_CLASS* Class = &g_OpteeSlab.Class[ClassIndex];
+
+        if (Class->Pages == 0) {
+            continue;
+        }
 
-    *AllocatedMemory = NULL;
-    if (PhysicalMemory != NULL) {
-        PhysicalMemory->QuadPart = 0;
-    }
+        //
+        // Take all the free chunks of the class and count them per page.
+        //
+        Chunks = NULL;
+        for (Cpu = 0; Cpu < g_OpteeSlab.ProcessorCount; Cpu++) {
+            Entry = InterlockedFlushSList(&g_OpteeSlab.Cpu[Cpu].FreeList[ClassIndex]);
+            while (Entry != NULL) {
+                Next = Entry->Next;
+                Page = (OPTEE_CLIENT_SLAB_PAGE*)PAGE_ALIGN(Entry);
+                Page->ReclaimCount++;
+                Entry->Next = Chunks;
+                Chunks = Entry;
+                Entry = Next;
+            }
+        }
 
-    if (g_OpteeMemoryHeader.BaseVA == NULL) {
         //
-        // Memory was not mapped during initialization
+        // Put back the chunks of the pages that are still in use,
+        // spread over the processors.
         //
-        return STATUS_MEMORY_NOT_ALLOCATED;
+        Cpu = 0;
+        Entry = Chunks;
+        while (Entry != NULL) {
+            Next = Entry->Next;
+            Page = (OPTEE_CLIENT_SLAB_PAGE*)PAGE_ALIGN(Entry);
+            if (Page->ReclaimCount != Page->ChunkCount) {
+                InterlockedPushEntrySList(&g_OpteeSlab.Cpu[Cpu].FreeList[ClassIndex], Entry);
+                if (++Cpu == g_OpteeSlab.ProcessorCount) {
+                    Cpu = 0;
+                }
+            }
+            Entry = Next;
+        }
+
+        //
+        // Release the pages with all the chunks free.
+        //
+        Link = Class->PageList.Flink;
+        while (Link != &Class->PageList) {
+            Page = CONTAINING_RECORD(Link, OPTEE_CLIENT_SLAB_PAGE, Link);
+            Link = Link->Flink;
+            if (Page->ReclaimCount == Page->ChunkCount) {
+                RemoveEntryList(&Page->Link);
+                Page->Signature = 0;
+                RtlClearBits(&g_OpteeMemoryHeader.BitMapHeader, Page->BitMapIndex, 1);
+                Class->Pages--;
+                ReleasedPages++;
+            } else {
+                Page->ReclaimCount = 0;
+            }
+        }
     }
 
+    g_OpteeSlab.Reclaims++;
+    g_OpteeSlab.ReclaimedPages += ReleasedPages;
+
+    return ReleasedPages;
+}
+
+
+static
+PSLIST_ENTRY
+OpteeClientSlabRefill(
+    _In_ ULONG ClassIndex,
+    _In_ ULONG Cpu
+    )
+
+/*
+ * Carve a new shared page for the slab class. One chunk is returned,
+ * the others go to the free list of the processor. Slab pages are taken
+ * from the top of the shared memory so they do not split the runs used
+ * by the large blocks, which are allocated from the bottom.
+ */
+
+{
+    NTSTATUS Status;
+    OPTEE_CLIENT_SLAB_CLASS* Class = &g_OpteeSlab.Class[ClassIndex];
+    OPTEE_CLIENT_SLAB_PAGE* Page;
+    PSLIST_ENTRY Entry;
+    ULONG RunIndex;
+    ULONG RunLength;
+    ULONG BitMapIndex;
+    UINT32 Chunk;
+
     Status = KeWaitForSingleObject(&OpteeMemLock,
                                    Executive,
                                    KernelMode,
@@ -209,13 +404,149 @@ OpteeClientMemAlloc(
                                    NULL);
     ASSERT(Status == STATUS_SUCCESS);
 
-    ActualLength = Length + sizeof(OPTEE_CLIENT_MEM_HEADER);
-    NumPages = (ActualLength / PAGE_SIZE) + 1;
+    //
+    // Another thread could have refilled the class while we were waiting.
+    //
+    Entry = InterlockedPopEntrySList(&g_OpteeSlab.Cpu[Cpu].FreeList[ClassIndex]);
+    if (Entry != NULL) {
+        goto Exit;
+    }
+
+    RunLength = RtlFindLastBackwardRunClear(&g_OpteeMemoryHeader.BitMapHeader,
+                                            g_OpteeMemoryHeader.BitMapHeader.SizeOfBitMap - 1,
+                                            &RunIndex);
+    if (RunLength == 0) {
+        if (OpteeClientSlabReclaim() != 0) {
+            RunLength = RtlFindLastBackwardRunClear(&g_OpteeMemoryHeader.BitMapHeader,
+                                                    g_OpteeMemoryHeader.BitMapHeader.SizeOfBitMap - 1,
+                                                    &RunIndex);
+        }
+
+        //
+        // The reclaim may have put back free chunks of this class too.
+        //
+        Entry = InterlockedPopEntrySList(&g_OpteeSlab.Cpu[Cpu].FreeList[ClassIndex]);
+        if (Entry != NULL || RunLength == 0) {
+            goto Exit;
+        }
+    }
+
+    BitMapIndex = RunIndex + RunLength - 1;
+    RtlSetBits(&g_OpteeMemoryHeader.BitMapHeader, BitMapIndex, 1);
+
+    Page = (OPTEE_CLIENT_SLAB_PAGE*)((UINTN)g_OpteeMemoryHeader.BaseVA + BitMapIndex * MEMORY_GANULARITY);
+    Page->Signature = OPTEE_SLAB_PAGE_SIGNATURE;
+    Page->BitMapIndex = BitMapIndex;
+    Page->ClassIndex = ClassIndex;
+    Page->ChunkCount = Class->ChunksPerPage;
+    Page->ReclaimCount = 0;
+    InsertTailList(&Class->PageList, &Page->Link);
+    Class->Pages++;
+    Class->Refills++;
+
+    //
+    // Keep the first chunk, push the others so the lowest addresses are
+    // handed out first.
+    //
+    for (Chunk = Class->ChunksPerPage - 1; Chunk > 0; Chunk--) {
+        InterlockedPushEntrySList(&g_OpteeSlab.Cpu[Cpu].FreeList[ClassIndex],
+            (PSLIST_ENTRY)((UINTN)Page + OPTEE_SLAB_PAGE_HEADER_SIZE + Chunk * Class->ChunkSize));
+    }
+
+    Entry = (PSLIST_ENTRY)((UINTN)Page + OPTEE_SLAB_PAGE_HEADER_SIZE);
+
+Exit:
 
-    if ((ActualLength % PAGE_SIZE) != 0) {
-        ActualLength = NumPages * PAGE_SIZE;
+    KeReleaseSemaphore(&OpteeMemLock,
+                       LOW_PRIORITY,
+                       1,
+                       FALSE);
+
+    return Entry;
+}
+
+
+static
+OPTEE_CLIENT_MEM_HEADER*
+OpteeClientSlabAlloc(
+    _In_ ULONG ClassIndex
+    )
+
+/*
+ * Allocate a chunk of the slab class. The free list of the current
+ * processor is tried first, then the lists of the other processors and
+ * only then a new page is carved under OpteeMemLock.
+ */
+
+{
+    ULONG Cpu = KeGetCurrentProcessorNumberEx(NULL);
+    ULONG Other;
+    PSLIST_ENTRY Entry;
+    OPTEE_CLIENT_SLAB_PAGE* Page;
+    OPTEE_CLIENT_MEM_HEADER* Header;
+
+    Entry = InterlockedPopEntrySList(&g_OpteeSlab.Cpu[Cpu].FreeList[ClassIndex]);
+    if (Entry != NULL) {
+        InterlockedIncrement64(&g_OpteeSlab.Cpu[Cpu].FastAllocations[ClassIndex]);
+    } else {
+        for (Other = 1; (Other < g_OpteeSlab.ProcessorCount) && (Entry == NULL); Other++) {
+            Entry = InterlockedPopEntrySList(
+                &g_OpteeSlab.Cpu[(Cpu + Other) % g_OpteeSlab.ProcessorCount].FreeList[ClassIndex]);
+        }
+
+        if (Entry == NULL) {
+            Entry = OpteeClientSlabRefill(ClassIndex, Cpu);
+        }
+
+        if (Entry == NULL) {
+            InterlockedIncrement64(&g_OpteeSlab.Class[ClassIndex].Failures);
+            return NULL;
+        }
     }
 
+    InterlockedIncrement64(&g_OpteeSlab.Cpu[Cpu].Allocations[ClassIndex]);
+
+    Page = (OPTEE_CLIENT_SLAB_PAGE*)PAGE_ALIGN(Entry);
+    ASSERT(Page->Signature == OPTEE_SLAB_PAGE_SIGNATURE);
+    ASSERT(Page->ClassIndex == ClassIndex);
+
+    Header = (OPTEE_CLIENT_MEM_HEADER*)Entry;
+    Header->BitMapIndex = Page->BitMapIndex;
+    Header->Length = g_OpteeSlab.Class[ClassIndex].ChunkSize;
+    Header->Reserved64 = 0;
+
+    return Header;
+}
+
+
+static
+NTSTATUS
+OpteeClientLargeAlloc(
+    _In_ UINT32 Length,
+    _Out_ OPTEE_CLIENT_MEM_HEADER** Header
+    )
+
+/*
+ * Allocate a page aligned block of memory from the page bitmap.
+ * The empty slab pages are reclaimed if no run is large enough.
+ */
+
+{
+    NTSTATUS Status;
+    ULONG NumPages;
+    ULONG ClearIndex;
+
+    *Header = NULL;
+
+    NumPages = BYTES_TO_PAGES(Length + sizeof(OPTEE_CLIENT_MEM_HEADER));
+
+    Status = KeWaitForSingleObject(&OpteeMemLock,
+                                   Executive,
+                                   KernelMode,
+                                   FALSE,
+                                   NULL);
+    ASSERT(Status == STATUS_SUCCESS);
+
     //
     // Find the run that contain the set of clear bits and set the bit(s).
     //
@@ -223,28 +554,28 @@ OpteeClientMemAlloc(
                                         NumPages,
                                         0);
 
+    if ((ClearIndex == 0xFFFFFFFF) && (OpteeClientSlabReclaim() != 0)) {
+        ClearIndex = RtlFindClearBitsAndSet(&g_OpteeMemoryHeader.BitMapHeader,
+                                            NumPages,
+                                            0);
+    }
+
     if (ClearIndex == 0xFFFFFFFF) {
+        g_OpteeSlab.LargeFailures++;
         Status = STATUS_INSUFFICIENT_RESOURCES;
         goto Exit;
     }
 
-    *AllocatedMemory = (PVOID)((UINTN)g_OpteeMemoryHeader.BaseVA + ClearIndex * MEMORY_GANULARITY);
+    g_OpteeSlab.LargeAllocations++;
 
     //
-    // Fill in the length into the header and account for the header at the start
-    // of the memory block.
+    // Fill in the length into the header.
     //
-    OPTEE_CLIENT_MEM_HEADER* Header = (OPTEE_CLIENT_MEM_HEADER*)(UINTN)(*AllocatedMemory);
-
-    Header->BitMapIndex = ClearIndex;
-    Header->Length = ActualLength;
-    Header->Reserved64 = 0;
+    *Header = (OPTEE_CLIENT_MEM_HEADER*)((UINTN)g_OpteeMemoryHeader.BaseVA + ClearIndex * MEMORY_GANULARITY);
 
-    *AllocatedMemory = (PVOID)((UINTN)(*AllocatedMemory) + sizeof(OPTEE_CLIENT_MEM_HEADER));
-
-    if (PhysicalMemory != NULL) {
-        PhysicalMemory->QuadPart = OpteeClientVirtualToPhysical(*AllocatedMemory);
-    }
+    (*Header)->BitMapIndex = ClearIndex;
+    (*Header)->Length = NumPages * PAGE_SIZE;
+    (*Header)->Reserved64 = 0;
 
     Status = STATUS_SUCCESS;
 
@@ -259,6 +590,72 @@ Exit:
 }
 
 
+NTSTATUS
+OpteeClientMemAlloc(
+    _In_ UINT32 Length,
+    _Out_ PVOID *AllocatedMemory,
+    _Out_opt_ PHYSICAL_ADDRESS *PhysicalMemory
+    )
+
+/*
+ * Allocate a block of memory from the TrustZone shared memory block.
+ * Blocks up to OPTEE_CLIENT_MEM_SLAB_MAX_SIZE come from the slab of the
+ * smallest size class that fits, larger blocks are page aligned.
+ */
+
+{
+    NTSTATUS Status = STATUS_SUCCESS;
+    OPTEE_CLIENT_MEM_HEADER* Header = NULL;
+    ULONG ClassIndex;
+
+    *AllocatedMemory = NULL;
+    if (PhysicalMemory != NULL) {
+        PhysicalMemory->QuadPart = 0;
+    }
+
+    if (g_OpteeMemoryHeader.BaseVA == NULL) {
+        //
+        // Memory was not mapped during initialization
+        //
+        return STATUS_MEMORY_NOT_ALLOCATED;
+    }
+
+    if (Length > g_OpteeMemoryHeader.Length) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    if (Length <= OPTEE_CLIENT_MEM_SLAB_MAX_SIZE) {
+        for (ClassIndex = 0; ClassIndex < OPTEE_CLIENT_MEM_SLAB_CLASS_COUNT; ClassIndex++) {
+            if (Length + sizeof(OPTEE_CLIENT_MEM_HEADER) <= OpteeSlabChunkSize[ClassIndex]) {
+                break;
+            }
+        }
+
+        Header = OpteeClientSlabAlloc(ClassIndex);
+        if (Header == NULL) {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+        }
+    } else {
+        Status = OpteeClientLargeAlloc(Length, &Header);
+    }
+
+    if (!NT_SUCCESS(Status)) {
+        return Status;
+    }
+
+    //
+    // Account for the header at the start of the memory block.
+    //
+    *AllocatedMemory = (PVOID)((UINTN)Header + sizeof(OPTEE_CLIENT_MEM_HEADER));
+
+    if (PhysicalMemory != NULL) {
+        PhysicalMemory->QuadPart = OpteeClientVirtualToPhysical(*AllocatedMemory);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
 VOID
 OpteeClientMemFree(
     _In_ PVOID Mem
@@ -270,24 +667,134 @@ OpteeClientMemFree(
  */
 
 {
+    NTSTATUS Status;
     OPTEE_CLIENT_MEM_HEADER* Header;
+    OPTEE_CLIENT_SLAB_PAGE* Page;
     ULONG NumPages;
+    ULONG Cpu;
 
     Header = (OPTEE_CLIENT_MEM_HEADER*)(
         ((UINTN)(Mem)) - sizeof(OPTEE_CLIENT_MEM_HEADER));
 
-    ASSERT(((UINTN)Header) % PAGE_SIZE == 0);
+    ASSERT(((UINTN)Header >= (UINTN)g_OpteeMemoryHeader.BaseVA) &&
+           ((UINTN)Header < (UINTN)g_OpteeMemoryHeader.BaseVA + g_OpteeMemoryHeader.Length));
+
+    if (((UINTN)Header) % PAGE_SIZE != 0) {
+        //
+        // Slab chunk, only large blocks start on a page boundary.
+        //
+        Page = (OPTEE_CLIENT_SLAB_PAGE*)PAGE_ALIGN(Header);
+        ASSERT(Page->Signature == OPTEE_SLAB_PAGE_SIGNATURE);
+        ASSERT(Header->Length == g_OpteeSlab.Class[Page->ClassIndex].ChunkSize);
+
+        Cpu = KeGetCurrentProcessorNumberEx(NULL);
+        InterlockedIncrement64(&g_OpteeSlab.Cpu[Cpu].Frees[Page->ClassIndex]);
+        InterlockedPushEntrySList(&g_OpteeSlab.Cpu[Cpu].FreeList[Page->ClassIndex],
+                                  (PSLIST_ENTRY)Header);
+        return;
+    }
 
     NumPages = Header->Length  / PAGE_SIZE;
 
+    Status = KeWaitForSingleObject(&OpteeMemLock,
+                                   Executive,
+                                   KernelMode,
+                                   FALSE,
+                                   NULL);
+    ASSERT(Status == STATUS_SUCCESS);
+
     ASSERT(RtlAreBitsSet(&g_OpteeMemoryHeader.BitMapHeader, Header->BitMapIndex, NumPages) == TRUE);
 
     RtlClearBits(&g_OpteeMemoryHeader.BitMapHeader, Header->BitMapIndex, NumPages);
 
+    KeReleaseSemaphore(&OpteeMemLock,
+                       LOW_PRIORITY,
+                       1,
+                       FALSE);
+
     return;
 }
 
 
+VOID
+OpteeClientMemGetStatistics(
+    _Out_ OPTEE_CLIENT_MEM_STATISTICS *Statistics
+    )
+
+/*
+ * Take a snapshot of the occupancy and fragmentation of the shared
+ * memory. The slab counters are gathered without stopping the fast path,
+ * so they are only consistent with each other approximately.
+ */
+
+{
+    NTSTATUS Status;
+    ULONG ClassIndex;
+    ULONG Cpu;
+    ULONG RunIndex;
+    UINT64 Chunks = 0;
+    UINT64 ChunksInUse = 0;
+
+    RtlZeroMemory(Statistics, sizeof(*Statistics));
+
+    if (g_OpteeMemoryHeader.BitMapAddress == NULL || g_OpteeSlab.Cpu == NULL) {
+        return;
+    }
+
+    Status = KeWaitForSingleObject(&OpteeMemLock,
+                                   Executive,
+                                   KernelMode,
+                                   FALSE,
+                                   NULL);
+    ASSERT(Status == STATUS_SUCCESS);
+
+    Statistics->TotalPages = g_OpteeMemoryHeader.BitMapHeader.SizeOfBitMap;
+    Statistics->FreePages = RtlNumberOfClearBits(&g_OpteeMemoryHeader.BitMapHeader);
+    Statistics->LargestFreeRun = RtlFindLongestRunClear(&g_OpteeMemoryHeader.BitMapHeader, &RunIndex);
+    if (Statistics->FreePages != 0) {
+        Statistics->FragmentationPercent = 100 -
+            (UINT32)(((UINT64)Statistics->LargestFreeRun * 100) / Statistics->FreePages);
+    }
+
+    Statistics->LargeAllocations = (UINT64)g_OpteeSlab.LargeAllocations;
+    Statistics->LargeFailures = (UINT64)g_OpteeSlab.LargeFailures;
+    Statistics->Reclaims = (UINT64)g_OpteeSlab.Reclaims;
+    Statistics->ReclaimedPages = (UINT64)g_OpteeSlab.ReclaimedPages;
+
+    for (ClassIndex = 0; ClassIndex < OPTEE_CLIENT_MEM_SLAB_CLASS_COUNT; ClassIndex++) {
+        OPTEE_CLIENT_MEM_SLAB_STATISTICS* Slab = &Statistics->Slab[ClassIndex];
+        LONG64 Frees = 0;
+
+        Slab->ChunkSize = g_OpteeSlab.Class[ClassIndex].ChunkSize;
+        Slab->ChunksPerPage = g_OpteeSlab.Class[ClassIndex].ChunksPerPage;
+        Slab->Pages = g_OpteeSlab.Class[ClassIndex].Pages;
+        Slab->Refills = (UINT64)g_OpteeSlab.Class[ClassIndex].Refills;
+        Slab->Failures = (UINT64)g_OpteeSlab.Class[ClassIndex].Failures;
+        for (Cpu = 0; Cpu < g_OpteeSlab.ProcessorCount; Cpu++) {
+            Slab->Allocations += (UINT64)g_OpteeSlab.Cpu[Cpu].Allocations[ClassIndex];
+            Slab->FastAllocations += (UINT64)g_OpteeSlab.Cpu[Cpu].FastAllocations[ClassIndex];
+            Frees += g_OpteeSlab.Cpu[Cpu].Frees[ClassIndex];
+        }
+        if (Slab->Allocations > (UINT64)Frees) {
+            Slab->ChunksInUse = (UINT32)(Slab->Allocations - (UINT64)Frees);
+        }
+
+        Statistics->SlabPages += Slab->Pages;
+        Chunks += (UINT64)Slab->Pages * Slab->ChunksPerPage;
+        ChunksInUse += Slab->ChunksInUse;
+    }
+
+    if (Chunks != 0) {
+        Statistics->SlabOccupancyPercent = (UINT32)((ChunksInUse * 100) / Chunks);
+    }
+
+    KeReleaseSemaphore(&OpteeMemLock,
+                       LOW_PRIORITY,
+                       1,
+                       FALSE);
+}
+
+
 ULONGLONG
 OpteeClientVirtualToPhysical(
     _In_ PVOID Va
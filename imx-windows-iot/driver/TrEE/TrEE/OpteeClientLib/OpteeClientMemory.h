@@ -65,6 +65,46 @@ OpteeClientPhysicalToVirtual(
     _In_ ULONGLONG Pa
     );
 
+//
+// Small blocks are served from size-class slabs carved out of shared pages,
+// OPTEE_CLIENT_MEM_SLAB_MAX_SIZE is the largest request (without the block
+// header) that is still served from a slab.
+//
+#define OPTEE_CLIENT_MEM_SLAB_CLASS_COUNT 5
+#define OPTEE_CLIENT_MEM_SLAB_MAX_SIZE (1024 - 16)
+
+typedef struct _OPTEE_CLIENT_MEM_SLAB_STATISTICS {
+
+    UINT32 ChunkSize;           // Size of a chunk including the block header
+    UINT32 ChunksPerPage;       // Number of chunks carved from one shared page
+    UINT32 Pages;               // Shared pages owned by the slab
+    UINT32 ChunksInUse;         // Chunks currently allocated
+    UINT64 Allocations;         // All allocations served by the slab
+    UINT64 FastAllocations;     // Allocations served from the current processor free list
+    UINT64 Refills;             // New pages carved for the slab
+    UINT64 Failures;            // Allocations failed, no shared page left
+} OPTEE_CLIENT_MEM_SLAB_STATISTICS;
+
+typedef struct _OPTEE_CLIENT_MEM_STATISTICS {
+
+    UINT32 TotalPages;          // Pages of the shared memory carve-out
+    UINT32 FreePages;           // Pages neither used by a slab nor by a large block
+    UINT32 SlabPages;           // Pages owned by the slabs
+    UINT32 LargestFreeRun;      // Largest run of free pages
+    UINT32 FragmentationPercent;// 100 * (1 - LargestFreeRun / FreePages)
+    UINT32 SlabOccupancyPercent;// Allocated share of the chunks carved from the slab pages
+    UINT64 LargeAllocations;    // Allocations served by the page bitmap
+    UINT64 LargeFailures;       // Page bitmap allocations failed
+    UINT64 Reclaims;            // Times the empty slab pages were given back to the bitmap
+    UINT64 ReclaimedPages;      // Slab pages given back to the bitmap
+    OPTEE_CLIENT_MEM_SLAB_STATISTICS Slab[OPTEE_CLIENT_MEM_SLAB_CLASS_COUNT];
+} OPTEE_CLIENT_MEM_STATISTICS;
+
+VOID
+OpteeClientMemGetStatistics(
+    _Out_ OPTEE_CLIENT_MEM_STATISTICS *Statistics
+    );
+
 #define SWAP_B16(u16)				 \
 			((((UINT16)(u16)<<8) & 0xFF00)   | \
 			 (((UINT16)(u16)>>8) & 0x00FF))
@@ -44,6 +44,7 @@
 #include "OpteeClientLib.h"
 #include "OpteeClientRPC.h"
 #include "OpteeClientMemory.h"
+#include "OpteeClientWaitQueue.h"
 #include <TrEEGenService.h>
 #include "trace.h"
 
@@ -80,18 +81,13 @@ GenServiceReceiveRpcCommand(
     );
 
 
-#define OPTEE_CLIENT_RPC_WAIT_BLOCK_TAG 'wTPO'
-
 #define NANOS_PER_SEC (1000LL * 1000LL * 1000LL)
 #define HUNDRED_NANOS_TO_SEC (NANOS_PER_SEC / 100LL)
 
 #define OS_TA_FILE_PATH_W_MAX_LENGTH 100
 
-#define OPTEE_RPC_MEMORY_TAG 'ETPO'
 #define OPTEE_RPC_CID_QUERY_TAG 'diCO'
 
-#define RPMB_PACKET_DATA_TO_UINT16(d) ((d[0] << 8) + (d[1]))
-
 
 //
 // RPMB CID information
@@ -100,31 +96,12 @@ GenServiceReceiveRpcCommand(
 static UINT8 RpmbCid[RPMB_EMMC_CID_SIZE];
 static BOOLEAN RpmbCidAquired = FALSE;
 
-//
-// Wait object resources
-//
-
-static WDFLOOKASIDE WaitBlockPool = NULL;
-static WDFCOLLECTION WaitBlockList = NULL;
-static FAST_MUTEX WaitBlockListLock;
-
-//
-// OPTEE sync object
-//
-
-typedef struct _OPTEE_WAIT_BLOCK
-{
-    WDFMEMORY Handle;
-    uint64_t Key;
-    KEVENT Event;
-} OPTEE_WAIT_BLOCK, *POPTEE_WAIT_BLOCK;
-
 
 static TEEC_Result OpteeRpcAlloc(UINTN Size, UINT64 *Address);
 static TEEC_Result OpteeRpcFree(UINT64 Address);
 
 static TEEC_Result OpteeRpcCmdLoadTa(t_teesmc_arg *TeeSmcArg);
-static TEEC_Result OpteeRpcCmdRpmb(t_teesmc_arg *TeeSmcArg);
+static TEEC_Result OpteeRpcCmdRpmb(t_teesmc_arg *TeeSmcArg, POPTEE_RPMB_OPERATION RpmbOperation);
 static TEEC_Result OpteeRpcCmdFs(t_teesmc_arg *TeeSmcArg);
 static TEEC_Result OpteeRpcCmdGetTime(t_teesmc_arg *TeeSmcArg);
 static TEEC_Result OpteeRpcCmdWaitQueue(t_teesmc_arg *TeeSmcArg);
@@ -138,55 +115,13 @@ static TEEC_Result OpteeRpcCmdSharedMemFree(t_teesmc_arg *TeeSmcArg);
  */
 NTSTATUS OpteeClientRpcInit()
 {
-    WDF_OBJECT_ATTRIBUTES Attributes;
-    NTSTATUS Status;
-    WDFDRIVER WdfDriver;
-
-    WdfDriver = WdfGetDriver();
-
-    if (WaitBlockPool != NULL) {
-        NT_ASSERT(WaitBlockList != NULL);
-        return STATUS_SUCCESS;
-    }
-
-    WDF_OBJECT_ATTRIBUTES_INIT(&Attributes);
-    Attributes.ParentObject = WdfDriver;
-
-    Status = WdfCollectionCreate(&Attributes, &WaitBlockList);
-
-    if (!NT_SUCCESS(Status)) {
-        TraceError("WdfCollectionCreate failed, status %!STATUS!", Status);
-        return Status;
-    }
-
-    WDF_OBJECT_ATTRIBUTES_INIT(&Attributes);
-    Attributes.ParentObject = WdfDriver;
-
-    Status = WdfLookasideListCreate(
-        &Attributes,
-        sizeof(OPTEE_WAIT_BLOCK),
-        NonPagedPool,
-        WDF_NO_OBJECT_ATTRIBUTES,
-        OPTEE_CLIENT_RPC_WAIT_BLOCK_TAG,
-        &WaitBlockPool);
-
-    if (!NT_SUCCESS(Status)) {
-        TraceError(
-            "Failed to create wait objects lookaside list, %!STATUS!",
-            Status);
-
-        return Status;
-    }
-
-    ExInitializeFastMutex(&WaitBlockListLock);
-
-    return STATUS_SUCCESS;
+    return OpteeClientWaitQueueInit();
 }
 
 /*
  * Handle the callback from secure world.
  */
-TEEC_Result OpteeRpcCallback(ARM_SMC_ARGS *ArmSmcArgs)
+TEEC_Result OpteeRpcCallback(ARM_SMC_ARGS *ArmSmcArgs, POPTEE_RPMB_OPERATION RpmbOperation)
 {
     TEEC_Result TeecResult = TEEC_SUCCESS;
 
@@ -284,7 +219,7 @@ TEEC_Result OpteeRpcCallback(ARM_SMC_ARGS *ArmSmcArgs)
 
         case TEE_RPC_CMD_RPMB: {
 
-            TeecResult = OpteeRpcCmdRpmb(TeeSmcArg);
+            TeecResult = OpteeRpcCmdRpmb(TeeSmcArg, RpmbOperation);
             break;
         }
 
@@ -640,24 +575,13 @@ Exit:
 /*
  * Execute an RPMB storage operation.
  */
-TEEC_Result OpteeRpcCmdRpmb(t_teesmc_arg *TeeSmcArg)
+TEEC_Result OpteeRpcCmdRpmb(t_teesmc_arg *TeeSmcArg, POPTEE_RPMB_OPERATION RpmbOperation)
 {
-    ULONG AllocSize;
-    ULONG BlockCount;
-    ULONG_PTR BytesWritten;
-    SFFDISK_DEVICE_RPMB_DATA_FRAME *Frame;
-    ULONG InputSize;
-    ULONG OutputSize;
     ULONGLONG Physical;
-    UINT16 RequestMsgType;
-    SFFDISK_DEVICE_RPMB_DATA_FRAME *RequestPackets;
     SFFDISK_DEVICE_RPMB_DATA_FRAME *ResponsePackets;
     tee_rpc_rpmb_cmd_t *RpmbRequest;
-    NTSTATUS Status;
     TEEC_Result TeecResult;
     t_teesmc_param *TeeSmcParam;
-    SFFDISK_DEVICE_PARTITION_ACCESS_DATA *TreeData;
-    TR_SERVICE_REQUEST TreeRequest;
 
     if (TeeSmcArg->num_params != 2) {
 
@@ -665,7 +589,6 @@ TEEC_Result OpteeRpcCmdRpmb(t_teesmc_arg *TeeSmcArg)
         goto Exit;
     }
 
-    TeecResult = TEEC_SUCCESS;
     TeeSmcParam = TEESMC_GET_PARAMS(TeeSmcArg);
 
     if ((TeeSmcParam[0].attr != TEESMC_ATTR_TYPE_TMEM_INPUT) ||
@@ -677,275 +600,21 @@ TEEC_Result OpteeRpcCmdRpmb(t_teesmc_arg *TeeSmcArg)
 
     Physical = TeeSmcParam[0].u.tmem.buf_ptr;
     RpmbRequest = (tee_rpc_rpmb_cmd_t *)OpteeClientPhysicalToVirtual(Physical);
-    TreeData = NULL;
-    BytesWritten = 0;
 
     switch (RpmbRequest->cmd) {
         case TEE_RPC_RPMB_CMD_DATA_REQ: {
-            RequestPackets = (SFFDISK_DEVICE_RPMB_DATA_FRAME *)
-                                (RpmbRequest + 1);
-
             Physical = TeeSmcParam[1].u.tmem.buf_ptr;
             ResponsePackets = (SFFDISK_DEVICE_RPMB_DATA_FRAME *)
                                 OpteeClientPhysicalToVirtual(Physical);
 
             ASSERT(ResponsePackets != NULL);
 
-            RequestMsgType = RPMB_PACKET_DATA_TO_UINT16(
-                                RequestPackets->RequestOrResponseType);
-
-            TraceInformation("RPMB Data request %d\n", RequestMsgType);
-
-            switch (RequestMsgType) {
-                case SFFDISK_RPMB_PROGRAM_AUTH_KEY: {
-                    InputSize = sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA);
-                    OutputSize = sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA);
-                    AllocSize = InputSize;
-                    TreeData = ExAllocatePoolWithTag(PagedPool,
-                                                     AllocSize,
-                                                     OPTEE_RPC_MEMORY_TAG);
-
-                    if (TreeData == NULL) {
-                        TraceError("ERR: Could not allocate requested size %d\n",
-                                   AllocSize);
-
-                        TeecResult = TEEC_ERROR_OUT_OF_MEMORY;
-                        break;
-                    }
-
-                    TreeRequest.FunctionCode = TREE_RPMB_SFFDISK_PARTITION_ACCESS;
-                    TreeRequest.InputBuffer = TreeData;
-                    TreeRequest.InputBufferSize = InputSize;
-                    TreeRequest.OutputBuffer = TreeData;
-                    TreeRequest.OutputBufferSize = OutputSize;
-                    TreeData->Command = SFFDISK_RPMB_PROGRAM_AUTH_KEY;
-                    TreeData->Size = sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA);
-                    Frame = &TreeData->Parameters.RpmbProgramAuthKey.ProgramAuthKeyFrame;
-                    RtlCopyMemory(Frame,
-                                  RequestPackets,
-                                  sizeof(SFFDISK_DEVICE_RPMB_DATA_FRAME));
-
-                    Status = TrSecureDeviceCallOSService(LibServiceDevice,
-                                                         &GUID_DEVINTERFACE_EMMC_PARTITION_ACCESS_RPMB,
-                                                         &TreeRequest,
-                                                         &BytesWritten);
-
-                    if (!NT_SUCCESS(Status)) {
-                        TraceError("ERR: RpmbQueryWriteCounter failed 0x%x\n",
-                                   Status);
-
-                        TeecResult = TEEC_ERROR_GENERIC;
-                        break;
-                    }
-
-                    Frame = &TreeData->Parameters.RpmbProgramAuthKey.ResultFrame;
-                    RtlCopyMemory(ResponsePackets,
-                                  Frame,
-                                  sizeof(SFFDISK_DEVICE_RPMB_DATA_FRAME));
-
-                    break;
-                }
-
-                case SFFDISK_RPMB_QUERY_WRITE_COUNTER: {
-                    InputSize = sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA);
-                    OutputSize = sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA);
-                    AllocSize = InputSize;
-                    TreeData = ExAllocatePoolWithTag(PagedPool,
-                                                     AllocSize,
-                                                     OPTEE_RPC_MEMORY_TAG);
-
-                    if (TreeData == NULL) {
-                        TraceError("ERR: Could not allocate requested size %d\n",
-                                   AllocSize);
-
-                        TeecResult = TEEC_ERROR_OUT_OF_MEMORY;
-                        break;
-                    }
-
-                    TreeRequest.FunctionCode = TREE_RPMB_SFFDISK_PARTITION_ACCESS;
-                    TreeRequest.InputBuffer = TreeData;
-                    TreeRequest.InputBufferSize = InputSize;
-                    TreeRequest.OutputBuffer = TreeData;
-                    TreeRequest.OutputBufferSize = OutputSize;
-                    TreeData->Command = SFFDISK_RPMB_QUERY_WRITE_COUNTER;
-                    TreeData->Size = sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA);
-                    Frame = &TreeData->Parameters.RpmbQueryWriteCounter.QueryWriteCounterFrame;
-                    RtlCopyMemory(Frame,
-                                  RequestPackets,
-                                  sizeof(SFFDISK_DEVICE_RPMB_DATA_FRAME));
-
-                    Status = TrSecureDeviceCallOSService(LibServiceDevice,
-                                                         &GUID_DEVINTERFACE_EMMC_PARTITION_ACCESS_RPMB,
-                                                         &TreeRequest,
-                                                         &BytesWritten);                    
-
-                    if (!NT_SUCCESS(Status)) {
-                        TraceError("ERR: RpmbQueryWriteCounter failed 0x%x\n",
-                                   Status);
-
-                        TeecResult = TEEC_ERROR_GENERIC;
-                        break;
-                    }
-
-                    Frame = &TreeData->Parameters.RpmbQueryWriteCounter.ResultFrame;
-                    RtlCopyMemory(ResponsePackets,
-                                  Frame,
-                                  sizeof(SFFDISK_DEVICE_RPMB_DATA_FRAME));
-
-                    break;
-                }
-
-                case SFFDISK_RPMB_AUTHENTICATED_WRITE: {
-                    OutputSize = sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA);
-
-                    // The input size is block_count * the size of a
-                    // frame/block, however the ACCESS_DATA already contains
-                    // one frame.
-                    //
-
-                    BlockCount = RPMB_PACKET_DATA_TO_UINT16(
-                                    RequestPackets->BlockCount);
-
-                    InputSize = sizeof(SFFDISK_DEVICE_RPMB_DATA_FRAME);
-                    InputSize *= (BlockCount - 1);
-                    InputSize += sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA);
-
-                    // Since the ACCESS_DATA contains the request and response
-                    // frames then the allocation size is always the larger
-                    // of the two sizes.
-                    //
-
-                    AllocSize = InputSize;
-                    TreeData = ExAllocatePoolWithTag(PagedPool,
-                                                     AllocSize,
-                                                     OPTEE_RPC_MEMORY_TAG);
-
-                    if (TreeData == NULL) {
-                        TraceError("ERR: Could not allocate requested size %d\n",
-                                   AllocSize);
-
-                        TeecResult = TEEC_ERROR_OUT_OF_MEMORY;
-                        break;
-                    }
-
-                    TreeRequest.FunctionCode = TREE_RPMB_SFFDISK_PARTITION_ACCESS;
-                    TreeRequest.InputBuffer = TreeData;
-                    TreeRequest.InputBufferSize = InputSize;
-                    TreeRequest.OutputBuffer = TreeData;
-                    TreeRequest.OutputBufferSize = OutputSize;
-                    TreeData->Command = SFFDISK_RPMB_AUTHENTICATED_WRITE;
-                    TreeData->Size = sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA);
-                    TreeData->Parameters.RpmbAuthenticatedWrite.CountToWrite =
-                        BlockCount;
-
-                    InputSize = BlockCount * sizeof(SFFDISK_DEVICE_RPMB_DATA_FRAME);
-                    Frame = TreeData->Parameters.RpmbAuthenticatedWrite.FrameDataToWrite;
-                    RtlCopyMemory(Frame,
-                                  RequestPackets,
-                                  InputSize);
-
-                    Status = TrSecureDeviceCallOSService(LibServiceDevice,
-                                                         &GUID_DEVINTERFACE_EMMC_PARTITION_ACCESS_RPMB,
-                                                         &TreeRequest,
-                                                         &BytesWritten);                    
-
-                    if (!NT_SUCCESS(Status)) {
-                        TraceError("ERR: RpmbAuthenticatedWrite failed 0x%x\n",
-                                   Status);
-
-                        TeecResult = TEEC_ERROR_GENERIC;
-                        break;
-                    }
-
-                    Frame = &TreeData->Parameters.RpmbAuthenticatedWrite.ResultFrame;
-                    RtlCopyMemory(ResponsePackets,
-                                  Frame,
-                                  sizeof(SFFDISK_DEVICE_RPMB_DATA_FRAME));
-
-                    break;
-                }
-
-                case SFFDISK_RPMB_AUTHENTICATED_READ: {
-
-                    // The output size is block_count * the size of a
-                    // frame/block, however the ACCESS_DATA already contains
-                    // one frame.
-                    //
-
-                    BlockCount = RpmbRequest->block_count;
-                    OutputSize = sizeof(SFFDISK_DEVICE_RPMB_DATA_FRAME);
-                    OutputSize *= (BlockCount - 1);
-                    OutputSize += sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA);
-
-                    // There seems to be a bug with the sdstor driver that
-                    // requires InputSize = Output size for read.
-                    //
-                    
-                    //InputSize = sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA);
-                    InputSize = OutputSize;
-
-                    // Since the ACCESS_DATA contains the request and response
-                    // frames then the allocation size is always the larger
-                    // of the two sizes.
-                    //
-
-                    AllocSize = OutputSize;
-                    TreeData = ExAllocatePoolWithTag(PagedPool,
-                                                     AllocSize,
-                                                     OPTEE_RPC_MEMORY_TAG);
-
-                    if (TreeData == NULL) {
-                        TraceError("ERR: Could not allocate requested size %d\n",
-                                   AllocSize);
-
-                        TeecResult = TEEC_ERROR_OUT_OF_MEMORY;
-                        break;
-                    }
-
-                    TreeRequest.FunctionCode = TREE_RPMB_SFFDISK_PARTITION_ACCESS;
-                    TreeRequest.InputBuffer = TreeData;
-                    TreeRequest.InputBufferSize = InputSize;
-                    TreeRequest.OutputBuffer = TreeData;
-                    TreeRequest.OutputBufferSize = OutputSize;
-                    TreeData->Command = SFFDISK_RPMB_AUTHENTICATED_READ;
-                    TreeData->Size = sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA);
-                    TreeData->Parameters.RpmbAuthenticatedRead.CountToRead = BlockCount;
-                    
-                    Frame = &TreeData->Parameters.RpmbAuthenticatedRead.AuthenticatedReadFrame;
-                    RtlCopyMemory(Frame,
-                                  RequestPackets,
-                                  sizeof(SFFDISK_DEVICE_RPMB_DATA_FRAME));
-
-                    Status = TrSecureDeviceCallOSService(LibServiceDevice,
-                                                         &GUID_DEVINTERFACE_EMMC_PARTITION_ACCESS_RPMB,
-                                                         &TreeRequest,
-                                                         &BytesWritten);                    
-
-                    if (!NT_SUCCESS(Status)) {
-                        TraceError("ERR: RpmbAuthenticatedRead failed 0x%x\n",
-                                     Status);
-
-                        TeecResult = TEEC_ERROR_GENERIC;
-                        break;
-                    }
-
-                    OutputSize = BlockCount * sizeof(SFFDISK_DEVICE_RPMB_DATA_FRAME);
-                    Frame = TreeData->Parameters.RpmbAuthenticatedRead.ReturnedFrameData;
-                    RtlCopyMemory(ResponsePackets, Frame, OutputSize);
-                    break;
-                }
-
-                default:
-                    TeecResult = TEEC_ERROR_BAD_PARAMETERS;
-                    break;
-            }
-
-            if (TreeData != NULL) {
-                ExFreePool(TreeData);
-            }
-
-            TraceInformation("Exit TeecResult %d\n", TeecResult);
-
+            TeecResult = OpteeClientRpmbDataRequest(LibServiceDevice,
+                                                    RpmbOperation,
+                                                    RpmbRequest,
+                                                    (SIZE_T)TeeSmcParam[0].u.tmem.size,
+                                                    ResponsePackets,
+                                                    (SIZE_T)TeeSmcParam[1].u.tmem.size);
             break;
         }
 
@@ -953,8 +622,6 @@ TEEC_Result OpteeRpcCmdRpmb(t_teesmc_arg *TeeSmcArg)
             
             tee_rpc_rpmb_dev_info* DeviceInfo;
 
-            TraceInformation("RPMB Get Device Information request\n");
-
             if (!RpmbCidAquired) {
                 NT_ASSERT(RpmbCidAquired);
                 TeecResult = TEEC_ERROR_BAD_STATE;
@@ -965,52 +632,9 @@ TEEC_Result OpteeRpcCmdRpmb(t_teesmc_arg *TeeSmcArg)
             DeviceInfo = (tee_rpc_rpmb_dev_info *)
                 OpteeClientPhysicalToVirtual(Physical);
 
-            InputSize = sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA);
-            OutputSize = sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA);
-            AllocSize = InputSize;
-            TreeData = ExAllocatePoolWithTag(PagedPool,
-                                             AllocSize,
-                                             OPTEE_RPC_MEMORY_TAG);
-
-            if (TreeData == NULL) {
-                TraceError("ERR: Could not allocate requested size %d\n",
-                           AllocSize);
-
-                TeecResult = TEEC_ERROR_OUT_OF_MEMORY;
-                break;
-            }
-
-            TreeRequest.FunctionCode = TREE_RPMB_SFFDISK_PARTITION_ACCESS;
-            TreeRequest.InputBuffer = TreeData;
-            TreeRequest.InputBufferSize = InputSize;
-            TreeRequest.OutputBuffer = TreeData;
-            TreeRequest.OutputBufferSize = OutputSize;
-            TreeData->Command = SFFDISK_RPMB_IS_SUPPORTED;
-            TreeData->Size = sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA);
-
-            Status = TrSecureDeviceCallOSService(LibServiceDevice,
-                                                 &GUID_DEVINTERFACE_EMMC_PARTITION_ACCESS_RPMB,
-                                                 &TreeRequest,
-                                                 &BytesWritten);
-
-            if (!NT_SUCCESS(Status)) {
-                TraceError("ERR: RpmbSupported failed 0x%x\n",
-                           Status);
-                
-                TeecResult = TEEC_ERROR_GENERIC;
-                DeviceInfo->ret_code = TEE_RPC_RPMB_CMD_GET_DEV_INFO_RET_ERROR;
-
-            } else {
-                DeviceInfo->rel_wr_sec_c = (uint8_t)(TreeData->Parameters.RpmbIsSupported.MaxReliableWriteSizeInBytes / 512);
-                DeviceInfo->rpmb_size_mult = (uint8_t)(TreeData->Parameters.RpmbIsSupported.SizeInBytes / (128 * 1024));
-                RtlCopyMemory(DeviceInfo->cid, RpmbCid, RPMB_EMMC_CID_SIZE);
-                DeviceInfo->ret_code = TEE_RPC_RPMB_CMD_GET_DEV_INFO_RET_OK;
-
-                TeecResult = TEEC_SUCCESS;
-            }
-
-            DeviceInfo->ret_code = (uint8_t)TeecResult;
-            ExFreePoolWithTag(TreeData, OPTEE_RPC_MEMORY_TAG);
+            TeecResult = OpteeClientRpmbGetDevInfo(LibServiceDevice,
+                                                   RpmbCid,
+                                                   DeviceInfo);
             break;
         }
 
@@ -1082,184 +706,6 @@ TEEC_Result OpteeRpcCmdGetTime(t_teesmc_arg *TeeSmcArg)
     return TEEC_SUCCESS;
 }
 
-/*
- * Allocate and initialize a wait block object.
- *
- * On Entry:
- *  Key: Value identifying the queue to wait for.
- *
- */
-static POPTEE_WAIT_BLOCK OpteeRpcWaitBlockAlloc(UINT64 Key)
-{
-    NTSTATUS Status;
-    POPTEE_WAIT_BLOCK WaitBlock;
-    WDFMEMORY WaitBlockObject;
-
-    Status = WdfMemoryCreateFromLookaside(WaitBlockPool, &WaitBlockObject);
-    if (!NT_SUCCESS(Status)) {
-        TraceError("WdfMemoryCreateFromLookaside failed, status %!STATUS!\n",
-                   Status);
-
-        return NULL;
-    }
-
-    WaitBlock = (POPTEE_WAIT_BLOCK)WdfMemoryGetBuffer(WaitBlockObject, NULL);
-    WaitBlock->Handle = WaitBlockObject;
-    WaitBlock->Key = Key;
-    KeInitializeEvent(&WaitBlock->Event, SynchronizationEvent, FALSE);
-
-    Status = WdfCollectionAdd(WaitBlockList, WaitBlockObject);
-    if (!NT_SUCCESS(Status)) {
-        TraceError("WdfCollectionAdd failed, status %!STATUS!\n",
-                   Status);
-
-        WdfObjectDelete(WaitBlockObject);
-        WaitBlock = NULL;
-    }
-
-    return WaitBlock;
-}
-
-/*
- * Find the block for a key, create the block if
- * it does not exist.
- *
- * On Entry:
- *  Key: Value identifying the queue to wait for.
- *
- */
-static POPTEE_WAIT_BLOCK OpteeRpcGetWaitBlock(UINT64 Key)
-{
-    ULONG Index, ListCount;
-    POPTEE_WAIT_BLOCK KeyWaitBlock = NULL;
-
-    ExAcquireFastMutex(&WaitBlockListLock);
-
-    ListCount = WdfCollectionGetCount(WaitBlockList);
-    for (Index = 0; Index < ListCount; ++Index) {
-        POPTEE_WAIT_BLOCK WaitBlock;
-
-        WaitBlock = (POPTEE_WAIT_BLOCK)WdfMemoryGetBuffer(
-            (WDFMEMORY)WdfCollectionGetItem(WaitBlockList, Index),
-            NULL);
-
-        if (WaitBlock->Key == Key) {
-            KeyWaitBlock = WaitBlock;
-            break;
-        }
-    }
-
-    //
-    // If the block has not been created yet, create it now.
-    //
-    if (KeyWaitBlock == NULL) {
-        KeyWaitBlock = OpteeRpcWaitBlockAlloc(Key);
-    }
-
-    ExReleaseFastMutex(&WaitBlockListLock);
-
-    return KeyWaitBlock;
-}
-
-/*
- * Free a wait block object.
- *
- * On Entry:
- *  WaitBlock: The wait block to be freed.
- *
- */
-static VOID OpteeRpcWaitBlockFree(POPTEE_WAIT_BLOCK WaitBlock)
-{
-    ExAcquireFastMutex(&WaitBlockListLock);
-
-    WdfCollectionRemove(WaitBlockList, WaitBlock->Handle);
-
-    ExReleaseFastMutex(&WaitBlockListLock);
-
-    WdfObjectDelete(WaitBlock->Handle);
-}
-
-/*
- * Wait until queue/synchronization object is signaled.
- *
- * On Entry:
- *  Key: Value identifying the queue to wait for.
- */
-static TEEC_Result OpteeRpcCmdWaitQueueSleep(uint64_t Key)
-{
-    NTSTATUS Status;
-    POPTEE_WAIT_BLOCK WaitBlock;
-
-    TraceDebug("WaitQueueSleep: thread 0x%p, key = %llX\n", 
-               KeGetCurrentThread(), 
-               Key);
-
-    //
-    // Get or create a new block. The block may already exist
-    // if the scheduler has inverted the order we receive the
-    // wake/sleep RPC calls.
-    //
-    WaitBlock = OpteeRpcGetWaitBlock(Key);
-
-    if (WaitBlock == NULL) {
-        NT_ASSERT(FALSE);
-        return TEEC_ERROR_OUT_OF_MEMORY;
-    }
-
-    Status = KeWaitForSingleObject(&WaitBlock->Event,
-                                   Executive,
-                                   KernelMode,
-                                   FALSE,
-                                   NULL);
-
-    NT_ASSERT(Status == STATUS_SUCCESS);
-
-    TraceDebug("WaitQueueSleep: thread 0x%p, key = %llX, status %!STATUS!\n", 
-               KeGetCurrentThread(), 
-               Key, 
-               Status);
-
-    OpteeRpcWaitBlockFree(WaitBlock);
-
-    return TEEC_SUCCESS;
-}
-
-/*
-* Signal queue/synchronization object.
-*
-* On Entry:
-*  Key: Unique value identifying the queue to signal for.
-*
-*/
-static TEEC_Result OpteeRpcCmdWaitQueueWakeUp(uint64_t Key)
-{
-    POPTEE_WAIT_BLOCK WaitBlock;
-
-    TraceDebug("WaitQueueWakeUp: thread 0x%p, key = %llX\n", 
-               KeGetCurrentThread(),
-               Key);
-
-    //
-    // Get or create a new block. The block may not exist
-    // if the scheduler has inverted the order we receive the
-    // wake/sleep RPC calls.
-    //
-    WaitBlock = OpteeRpcGetWaitBlock(Key);
-    if (WaitBlock == NULL) {
-        NT_ASSERT(FALSE);
-        return TEEC_ERROR_OUT_OF_MEMORY;
-    }
-
-    TraceDebug("WaitQueueWakeUp: thread 0x%p, key = %llX, "
-        "setting event 0x%p\n",
-        KeGetCurrentThread(),
-        Key,
-        &WaitBlock->Event);
-    KeSetEvent(&WaitBlock->Event, IO_NO_INCREMENT, FALSE);
-
-    return TEEC_SUCCESS;
-}
-
 /*
  * Wait for or signal queue/synchronization object.
  *
@@ -1286,11 +732,11 @@ static TEEC_Result OpteeRpcCmdWaitQueue(t_teesmc_arg *TeeSmcArg)
 
     switch (TeeSmcParam[0].u.value.a) {
     case TEE_WAIT_QUEUE_SLEEP:
-        Result = OpteeRpcCmdWaitQueueSleep(TeeSmcParam[0].u.value.b);
+        Result = OpteeClientWaitQueueSleep(TeeSmcParam[0].u.value.b);
         break;
 
     case TEE_WAIT_QUEUE_WAKEUP:
-        Result = OpteeRpcCmdWaitQueueWakeUp(TeeSmcParam[0].u.value.b);
+        Result = OpteeClientWaitQueueWakeUp(TeeSmcParam[0].u.value.b);
         break;
 
     default:
@@ -35,7 +35,8 @@
 #include "types.h"
 #include "OpteeClientLib.h"
 #include "arm/ArmSmcLib.h"
+#include "OpteeClientRpmb.h"
 
 NTSTATUS OpteeClientRpcInit();
-TEEC_Result OpteeRpcCallback(ARM_SMC_ARGS *ArmSmcArgs);
+TEEC_Result OpteeRpcCallback(ARM_SMC_ARGS *ArmSmcArgs, POPTEE_RPMB_OPERATION RpmbOperation);
 
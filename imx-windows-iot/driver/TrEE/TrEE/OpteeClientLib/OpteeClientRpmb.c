@@ -0,0 +1,741 @@
+/** @file
+  RPMB frame I/O for the OP-TEE RPC interface. Translates the RPMB data
+  requests of the OP-TEE OS secure storage into SFFDISK partition access
+  calls to the eMMC RPMB service.
+  **/
+
+/*
+ * Copyright (c) 2018, Microsoft Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <ntddk.h>
+#include <ntstatus.h>
+#include <sffdisk.h>
+#include <wdf.h>
+#include <TrustedRuntimeClx.h>
+#include <TreeRpmbService.h>
+
+#include "OpteeClientLib.h"
+#include "tee_rpc_types.h"
+#include "OpteeClientRpmb.h"
+#include "trace.h"
+
+// Taken from the optee_os implementation.
+//
+#include "tee_rpc.h"
+
+#ifdef WPP_TRACING
+#include "OpteeClientRpmb.tmh"
+#endif
+
+#define OPTEE_RPMB_MEMORY_TAG 'BRPO'
+
+#define RPMB_PACKET_DATA_TO_UINT16(d) ((d[0] << 8) + (d[1]))
+
+//
+// Size of the partition access data needed for a given number of frames,
+// the access data already contains one frame.
+//
+#define OPTEE_RPMB_ACCESS_DATA_SIZE(Frames) \
+    (sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA) + \
+     ((Frames) - 1) * sizeof(SFFDISK_DEVICE_RPMB_DATA_FRAME))
+
+typedef struct _OPTEE_RPMB_FRAME_BUFFER
+{
+    volatile LONG Busy;
+    ULONG Size;
+    SFFDISK_DEVICE_PARTITION_ACCESS_DATA *Data;
+} OPTEE_RPMB_FRAME_BUFFER, *POPTEE_RPMB_FRAME_BUFFER;
+
+typedef struct _OPTEE_RPMB_DEV_INFO_CACHE
+{
+    BOOLEAN Valid;
+    UINT8 RpmbSizeMult;
+    UINT8 RelWrSecC;
+} OPTEE_RPMB_DEV_INFO_CACHE;
+
+//
+// The frame buffers are claimed with an interlocked exchange on Busy and
+// owned by the claiming request until released. The lock protects the
+// statistics and the device information cache and is never held across a
+// call to the RPMB service.
+//
+
+static OPTEE_RPMB_FRAME_BUFFER RpmbFrameBuffers[OPTEE_RPMB_FRAME_BUFFER_COUNT];
+static OPTEE_RPMB_DEV_INFO_CACHE RpmbDevInfo;
+static OPTEE_RPMB_STATISTICS RpmbStatistics;
+static FAST_MUTEX RpmbLock;
+static LARGE_INTEGER RpmbPerformanceFrequency;
+
+
+static ULONG OpteeClientRpmbBucket(UINT64 Value, ULONG Shift, ULONG Buckets)
+{
+    ULONG Bucket = 0;
+
+    Value >>= Shift;
+    while ((Value != 0) && (Bucket < (Buckets - 1))) {
+        Value >>= 1;
+        Bucket++;
+    }
+
+    return Bucket;
+}
+
+static UINT64 OpteeClientRpmbElapsedMicroseconds(LARGE_INTEGER Start)
+{
+    LARGE_INTEGER Now;
+
+    Now = KeQueryPerformanceCounter(NULL);
+    if (RpmbPerformanceFrequency.QuadPart == 0) {
+        return 0;
+    }
+
+    return (UINT64)(Now.QuadPart - Start.QuadPart) * 1000000ULL /
+           (UINT64)RpmbPerformanceFrequency.QuadPart;
+}
+
+/*
+ * Claim a frame buffer of at least Size bytes. A reusable buffer is grown up
+ * to OPTEE_RPMB_FRAME_BUFFER_MAX_FRAMES, beyond that or when all of them are
+ * busy a temporary buffer is allocated.
+ */
+static SFFDISK_DEVICE_PARTITION_ACCESS_DATA *
+OpteeClientRpmbAcquireFrameBuffer(ULONG Size)
+{
+    POPTEE_RPMB_FRAME_BUFFER FrameBuffer;
+    SFFDISK_DEVICE_PARTITION_ACCESS_DATA *Data;
+    ULONG Index;
+    ULONG NewSize;
+    BOOLEAN Grown;
+
+    if (Size <= OPTEE_RPMB_ACCESS_DATA_SIZE(OPTEE_RPMB_FRAME_BUFFER_MAX_FRAMES)) {
+        for (Index = 0; Index < OPTEE_RPMB_FRAME_BUFFER_COUNT; Index++) {
+            FrameBuffer = &RpmbFrameBuffers[Index];
+            if (InterlockedCompareExchange(&FrameBuffer->Busy, 1, 0) != 0) {
+                continue;
+            }
+
+            Grown = FALSE;
+            if (FrameBuffer->Size < Size) {
+                NewSize = ROUND_TO_PAGES(Size);
+                Data = ExAllocatePoolWithTag(PagedPool,
+                                             NewSize,
+                                             OPTEE_RPMB_MEMORY_TAG);
+
+                if (Data == NULL) {
+                    InterlockedExchange(&FrameBuffer->Busy, 0);
+                    break;
+                }
+
+                if (FrameBuffer->Data != NULL) {
+                    ExFreePoolWithTag(FrameBuffer->Data, OPTEE_RPMB_MEMORY_TAG);
+                }
+
+                FrameBuffer->Data = Data;
+                FrameBuffer->Size = NewSize;
+                Grown = TRUE;
+            }
+
+            ExAcquireFastMutex(&RpmbLock);
+            if (Grown) {
+                RpmbStatistics.BufferGrows++;
+            } else {
+                RpmbStatistics.BufferReuses++;
+            }
+            ExReleaseFastMutex(&RpmbLock);
+
+            return FrameBuffer->Data;
+        }
+    }
+
+    Data = ExAllocatePoolWithTag(PagedPool, Size, OPTEE_RPMB_MEMORY_TAG);
+    if (Data != NULL) {
+        ExAcquireFastMutex(&RpmbLock);
+        RpmbStatistics.TemporaryBuffers++;
+        ExReleaseFastMutex(&RpmbLock);
+    }
+
+    return Data;
+}
+
+static VOID
+OpteeClientRpmbReleaseFrameBuffer(SFFDISK_DEVICE_PARTITION_ACCESS_DATA *Data)
+{
+    ULONG Index;
+
+    for (Index = 0; Index < OPTEE_RPMB_FRAME_BUFFER_COUNT; Index++) {
+        if (RpmbFrameBuffers[Index].Data == Data) {
+            NT_ASSERT(RpmbFrameBuffers[Index].Busy != 0);
+            InterlockedExchange(&RpmbFrameBuffers[Index].Busy, 0);
+            return;
+        }
+    }
+
+    ExFreePoolWithTag(Data, OPTEE_RPMB_MEMORY_TAG);
+}
+
+static VOID
+OpteeClientRpmbRecordRequest(
+    OPTEE_RPMB_REQUEST_TYPE Type,
+    ULONG Blocks,
+    ULONG DeviceCalls,
+    UINT64 Microseconds,
+    TEEC_Result TeecResult
+    )
+{
+    POPTEE_RPMB_REQUEST_STATISTICS RequestStatistics;
+
+    ExAcquireFastMutex(&RpmbLock);
+
+    RequestStatistics = &RpmbStatistics.Request[Type];
+    RequestStatistics->Requests++;
+    RequestStatistics->DeviceCalls += DeviceCalls;
+    RequestStatistics->Blocks += Blocks;
+    if (TeecResult != TEEC_SUCCESS) {
+        RequestStatistics->Failures++;
+    }
+
+    RequestStatistics->TotalMicroseconds += Microseconds;
+    if (Microseconds > RequestStatistics->MaxMicroseconds) {
+        RequestStatistics->MaxMicroseconds = Microseconds;
+    }
+
+    RequestStatistics->Latency[OpteeClientRpmbBucket(
+        Microseconds,
+        OPTEE_RPMB_LATENCY_BUCKET_SHIFT,
+        OPTEE_RPMB_LATENCY_BUCKETS)]++;
+
+    if (Blocks != 0) {
+        RequestStatistics->BlocksPerRequest[OpteeClientRpmbBucket(
+            Blocks,
+            1,
+            OPTEE_RPMB_SIZE_BUCKETS)]++;
+    }
+
+    ExReleaseFastMutex(&RpmbLock);
+}
+
+/*
+ * Send one partition access request to the RPMB service.
+ */
+static NTSTATUS
+OpteeClientRpmbCallDevice(
+    WDFDEVICE ServiceDevice,
+    SFFDISK_DEVICE_PARTITION_ACCESS_DATA *TreeData,
+    ULONG InputSize,
+    ULONG OutputSize
+    )
+{
+    ULONG_PTR BytesWritten;
+    TR_SERVICE_REQUEST TreeRequest;
+
+    BytesWritten = 0;
+    TreeRequest.FunctionCode = TREE_RPMB_SFFDISK_PARTITION_ACCESS;
+    TreeRequest.InputBuffer = TreeData;
+    TreeRequest.InputBufferSize = InputSize;
+    TreeRequest.OutputBuffer = TreeData;
+    TreeRequest.OutputBufferSize = OutputSize;
+
+    return TrSecureDeviceCallOSService(ServiceDevice,
+                                       &GUID_DEVINTERFACE_EMMC_PARTITION_ACCESS_RPMB,
+                                       &TreeRequest,
+                                       &BytesWritten);
+}
+
+/*
+ * Initialize the RPMB frame buffers and statistics.
+ */
+NTSTATUS OpteeClientRpmbInit()
+{
+    ULONG Size;
+
+    if (RpmbFrameBuffers[0].Data != NULL) {
+        return STATUS_SUCCESS;
+    }
+
+    RtlZeroMemory(RpmbFrameBuffers, sizeof(RpmbFrameBuffers));
+    RtlZeroMemory(&RpmbDevInfo, sizeof(RpmbDevInfo));
+    RtlZeroMemory(&RpmbStatistics, sizeof(RpmbStatistics));
+    ExInitializeFastMutex(&RpmbLock);
+    KeQueryPerformanceCounter(&RpmbPerformanceFrequency);
+
+    // The first buffer is created up front, the others on first use.
+    //
+
+    Size = ROUND_TO_PAGES(
+        OPTEE_RPMB_ACCESS_DATA_SIZE(OPTEE_RPMB_FRAME_BUFFER_INITIAL_FRAMES));
+
+    RpmbFrameBuffers[0].Data = ExAllocatePoolWithTag(PagedPool,
+                                                     Size,
+                                                     OPTEE_RPMB_MEMORY_TAG);
+
+    if (RpmbFrameBuffers[0].Data == NULL) {
+        TraceError("ERR: Could not allocate RPMB frame buffer of size %d\n",
+                   Size);
+
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    RpmbFrameBuffers[0].Size = Size;
+    return STATUS_SUCCESS;
+}
+
+/*
+ * Release the RPMB frame buffers.
+ */
+VOID OpteeClientRpmbDeinit()
+{
+    ULONG Index;
+
+    for (Index = 0; Index < OPTEE_RPMB_FRAME_BUFFER_COUNT; Index++) {
+        NT_ASSERT(RpmbFrameBuffers[Index].Busy == 0);
+
+        if (RpmbFrameBuffers[Index].Data != NULL) {
+            ExFreePoolWithTag(RpmbFrameBuffers[Index].Data,
+                              OPTEE_RPMB_MEMORY_TAG);
+
+            RpmbFrameBuffers[Index].Data = NULL;
+        }
+
+        RpmbFrameBuffers[Index].Size = 0;
+    }
+
+    RpmbDevInfo.Valid = FALSE;
+}
+
+/*
+ * Execute an RPMB data request. RequestSize and ResponseSize are the sizes
+ * of the shared memory buffers holding the request and the response frames.
+ */
+TEEC_Result
+OpteeClientRpmbDataRequest(
+    WDFDEVICE ServiceDevice,
+    POPTEE_RPMB_OPERATION Operation,
+    const tee_rpc_rpmb_cmd_t *RpmbRequest,
+    SIZE_T RequestSize,
+    SFFDISK_DEVICE_RPMB_DATA_FRAME *ResponsePackets,
+    SIZE_T ResponseSize
+    )
+{
+    ULONG BlockCount;
+    ULONG DeviceCalls;
+    SFFDISK_DEVICE_RPMB_DATA_FRAME *Frame;
+    ULONG InputSize;
+    ULONG OutputSize;
+    SIZE_T RequestFrames;
+    UINT16 RequestMsgType;
+    const SFFDISK_DEVICE_RPMB_DATA_FRAME *RequestPackets;
+    ULONG ResponseFrames;
+    LARGE_INTEGER Start;
+    NTSTATUS Status;
+    TEEC_Result TeecResult;
+    SFFDISK_DEVICE_PARTITION_ACCESS_DATA *TreeData;
+    OPTEE_RPMB_REQUEST_TYPE Type;
+
+    Start = KeQueryPerformanceCounter(NULL);
+    DeviceCalls = 0;
+    TreeData = NULL;
+
+    if (RequestSize < sizeof(*RpmbRequest) + sizeof(*RequestPackets)) {
+        return TEEC_ERROR_BAD_PARAMETERS;
+    }
+
+    RequestPackets = (const SFFDISK_DEVICE_RPMB_DATA_FRAME *)(RpmbRequest + 1);
+    RequestFrames = (RequestSize - sizeof(*RpmbRequest)) /
+                    sizeof(SFFDISK_DEVICE_RPMB_DATA_FRAME);
+
+    RequestMsgType = RPMB_PACKET_DATA_TO_UINT16(
+                        RequestPackets->RequestOrResponseType);
+
+    TraceInformation("RPMB Data request %d\n", RequestMsgType);
+
+    // Every request is sent in a single call: the MAC of the request and of
+    // the response covers all frames, so they cannot be split or merged
+    // here. OP-TEE packs the blocks of a write up to the reliable write
+    // count reported by OpteeClientRpmbGetDevInfo.
+    //
+
+    switch (RequestMsgType) {
+        case SFFDISK_RPMB_PROGRAM_AUTH_KEY:
+            Type = OpteeRpmbProgramKey;
+            BlockCount = 1;
+            ResponseFrames = 1;
+            InputSize = sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA);
+            OutputSize = sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA);
+            break;
+
+        case SFFDISK_RPMB_QUERY_WRITE_COUNTER:
+            Type = OpteeRpmbQueryWriteCounter;
+            BlockCount = 1;
+            ResponseFrames = 1;
+            InputSize = sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA);
+            OutputSize = sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA);
+            break;
+
+        case SFFDISK_RPMB_AUTHENTICATED_WRITE:
+            Type = OpteeRpmbAuthenticatedWrite;
+            BlockCount = RPMB_PACKET_DATA_TO_UINT16(RequestPackets->BlockCount);
+            ResponseFrames = 1;
+
+            if ((BlockCount == 0) || (BlockCount > RequestFrames)) {
+                TraceError("ERR: RPMB write of %d blocks, %Id frames given\n",
+                           BlockCount,
+                           RequestFrames);
+
+                TeecResult = TEEC_ERROR_BAD_PARAMETERS;
+                goto Exit;
+            }
+
+            if ((RpmbStatistics.ReliableWriteBlocks != 0) &&
+                (BlockCount > RpmbStatistics.ReliableWriteBlocks)) {
+
+                TraceError("ERR: RPMB write of %d blocks exceeds reliable write count %d\n",
+                           BlockCount,
+                           RpmbStatistics.ReliableWriteBlocks);
+            }
+
+            InputSize = (ULONG)OPTEE_RPMB_ACCESS_DATA_SIZE(BlockCount);
+            OutputSize = sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA);
+            break;
+
+        case SFFDISK_RPMB_AUTHENTICATED_READ:
+            Type = OpteeRpmbAuthenticatedRead;
+            BlockCount = RpmbRequest->block_count;
+            ResponseFrames = BlockCount;
+
+            if (BlockCount == 0) {
+                TeecResult = TEEC_ERROR_BAD_PARAMETERS;
+                goto Exit;
+            }
+
+            OutputSize = (ULONG)OPTEE_RPMB_ACCESS_DATA_SIZE(BlockCount);
+
+            // There seems to be a bug with the sdstor driver that
+            // requires InputSize = Output size for read.
+            //
+
+            InputSize = OutputSize;
+            break;
+
+        default:
+            return TEEC_ERROR_BAD_PARAMETERS;
+    }
+
+    if (ResponseSize < ResponseFrames * sizeof(SFFDISK_DEVICE_RPMB_DATA_FRAME)) {
+        TraceError("ERR: RPMB response buffer of %Id bytes too small for %d frames\n",
+                   ResponseSize,
+                   ResponseFrames);
+
+        TeecResult = TEEC_ERROR_SHORT_BUFFER;
+        goto Exit;
+    }
+
+    // Since the ACCESS_DATA contains the request and response frames then
+    // the buffer size is always the larger of the two sizes.
+    //
+
+    TreeData = OpteeClientRpmbAcquireFrameBuffer(max(InputSize, OutputSize));
+    if (TreeData == NULL) {
+        TraceError("ERR: Could not allocate requested size %d\n",
+                   max(InputSize, OutputSize));
+
+        TeecResult = TEEC_ERROR_OUT_OF_MEMORY;
+        goto Exit;
+    }
+
+    // A reused buffer still holds the frames of the previous request.
+    //
+
+    RtlZeroMemory(TreeData, sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA));
+    TreeData->Size = sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA);
+
+    switch (Type) {
+        case OpteeRpmbProgramKey:
+            TreeData->Command = SFFDISK_RPMB_PROGRAM_AUTH_KEY;
+            Frame = &TreeData->Parameters.RpmbProgramAuthKey.ProgramAuthKeyFrame;
+            RtlCopyMemory(Frame,
+                          RequestPackets,
+                          sizeof(SFFDISK_DEVICE_RPMB_DATA_FRAME));
+            break;
+
+        case OpteeRpmbQueryWriteCounter:
+            TreeData->Command = SFFDISK_RPMB_QUERY_WRITE_COUNTER;
+            Frame = &TreeData->Parameters.RpmbQueryWriteCounter.QueryWriteCounterFrame;
+            RtlCopyMemory(Frame,
+                          RequestPackets,
+                          sizeof(SFFDISK_DEVICE_RPMB_DATA_FRAME));
+            break;
+
+        case OpteeRpmbAuthenticatedWrite:
+            TreeData->Command = SFFDISK_RPMB_AUTHENTICATED_WRITE;
+            TreeData->Parameters.RpmbAuthenticatedWrite.CountToWrite = BlockCount;
+            Frame = TreeData->Parameters.RpmbAuthenticatedWrite.FrameDataToWrite;
+            RtlCopyMemory(Frame,
+                          RequestPackets,
+                          BlockCount * sizeof(SFFDISK_DEVICE_RPMB_DATA_FRAME));
+            break;
+
+        case OpteeRpmbAuthenticatedRead:
+            TreeData->Command = SFFDISK_RPMB_AUTHENTICATED_READ;
+            TreeData->Parameters.RpmbAuthenticatedRead.CountToRead = BlockCount;
+            Frame = &TreeData->Parameters.RpmbAuthenticatedRead.AuthenticatedReadFrame;
+            RtlCopyMemory(Frame,
+                          RequestPackets,
+                          sizeof(SFFDISK_DEVICE_RPMB_DATA_FRAME));
+            break;
+
+        default:
+            NT_ASSERT(FALSE);
+            break;
+    }
+
+    Status = OpteeClientRpmbCallDevice(ServiceDevice,
+                                       TreeData,
+                                       InputSize,
+                                       OutputSize);
+    DeviceCalls++;
+
+    if (!NT_SUCCESS(Status)) {
+        TraceError("ERR: RPMB request %d failed 0x%x\n",
+                   RequestMsgType,
+                   Status);
+
+        TeecResult = TEEC_ERROR_GENERIC;
+        goto Exit;
+    }
+
+    switch (Type) {
+        case OpteeRpmbProgramKey:
+            Frame = &TreeData->Parameters.RpmbProgramAuthKey.ResultFrame;
+            break;
+
+        case OpteeRpmbQueryWriteCounter:
+            Frame = &TreeData->Parameters.RpmbQueryWriteCounter.ResultFrame;
+            break;
+
+        case OpteeRpmbAuthenticatedWrite:
+            Frame = &TreeData->Parameters.RpmbAuthenticatedWrite.ResultFrame;
+            break;
+
+        default:
+            Frame = TreeData->Parameters.RpmbAuthenticatedRead.ReturnedFrameData;
+            break;
+    }
+
+    RtlCopyMemory(ResponsePackets,
+                  Frame,
+                  ResponseFrames * sizeof(SFFDISK_DEVICE_RPMB_DATA_FRAME));
+
+    TeecResult = TEEC_SUCCESS;
+
+Exit:
+    if (TreeData != NULL) {
+        OpteeClientRpmbReleaseFrameBuffer(TreeData);
+    }
+
+    if (Operation != NULL) {
+        Operation->Requests++;
+    }
+
+    OpteeClientRpmbRecordRequest(Type,
+                                 BlockCount,
+                                 DeviceCalls,
+                                 OpteeClientRpmbElapsedMicroseconds(Start),
+                                 TeecResult);
+
+    TraceInformation("Exit TeecResult %d\n", TeecResult);
+
+    return TeecResult;
+}
+
+/*
+ * Report the RPMB device information. The device is only queried once, the
+ * CID is acquired separately when the RPMB interface arrives.
+ */
+TEEC_Result
+OpteeClientRpmbGetDevInfo(
+    WDFDEVICE ServiceDevice,
+    const UINT8 *Cid,
+    tee_rpc_rpmb_dev_info *DeviceInfo
+    )
+{
+    ULONG DeviceCalls;
+    ULONG MaxReliableWriteSize;
+    ULONG RelWrSecC;
+    ULONG RpmbSizeMult;
+    LARGE_INTEGER Start;
+    NTSTATUS Status;
+    TEEC_Result TeecResult;
+    SFFDISK_DEVICE_PARTITION_ACCESS_DATA *TreeData;
+
+    TraceInformation("RPMB Get Device Information request\n");
+
+    Start = KeQueryPerformanceCounter(NULL);
+    DeviceCalls = 0;
+
+    ExAcquireFastMutex(&RpmbLock);
+    if (RpmbDevInfo.Valid) {
+        RpmbStatistics.DevInfoCacheHits++;
+        DeviceInfo->rpmb_size_mult = RpmbDevInfo.RpmbSizeMult;
+        DeviceInfo->rel_wr_sec_c = RpmbDevInfo.RelWrSecC;
+        ExReleaseFastMutex(&RpmbLock);
+
+        TeecResult = TEEC_SUCCESS;
+        goto Exit;
+    }
+    ExReleaseFastMutex(&RpmbLock);
+
+    TreeData = OpteeClientRpmbAcquireFrameBuffer(
+                    sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA));
+
+    if (TreeData == NULL) {
+        TraceError("ERR: Could not allocate requested size %d\n",
+                   sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA));
+
+        TeecResult = TEEC_ERROR_OUT_OF_MEMORY;
+        goto Exit;
+    }
+
+    RtlZeroMemory(TreeData, sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA));
+    TreeData->Command = SFFDISK_RPMB_IS_SUPPORTED;
+    TreeData->Size = sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA);
+
+    Status = OpteeClientRpmbCallDevice(ServiceDevice,
+                                       TreeData,
+                                       sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA),
+                                       sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA));
+    DeviceCalls++;
+
+    if (!NT_SUCCESS(Status)) {
+        TraceError("ERR: RpmbSupported failed 0x%x\n",
+                   Status);
+
+        OpteeClientRpmbReleaseFrameBuffer(TreeData);
+        TeecResult = TEEC_ERROR_GENERIC;
+        goto Exit;
+    }
+
+    MaxReliableWriteSize = TreeData->Parameters.RpmbIsSupported.MaxReliableWriteSizeInBytes;
+    RpmbSizeMult = TreeData->Parameters.RpmbIsSupported.SizeInBytes / (128 * 1024);
+    OpteeClientRpmbReleaseFrameBuffer(TreeData);
+
+    // Both values are single bytes of the EXT_CSD. OP-TEE packs up to twice
+    // rel_wr_sec_c blocks into one authenticated write, a count that wrapped
+    // to zero would stop it from writing at all.
+    //
+
+    RelWrSecC = MaxReliableWriteSize / 512;
+    if (RelWrSecC == 0) {
+        RelWrSecC = 1;
+    } else if (RelWrSecC > MAXUINT8) {
+        RelWrSecC = MAXUINT8;
+    }
+
+    if (RpmbSizeMult > MAXUINT8) {
+        RpmbSizeMult = MAXUINT8;
+    }
+
+    TraceInformation("RPMB reliable write size %d bytes, rel_wr_sec_c %d, size mult %d\n",
+                     MaxReliableWriteSize,
+                     RelWrSecC,
+                     RpmbSizeMult);
+
+    ExAcquireFastMutex(&RpmbLock);
+    RpmbDevInfo.RpmbSizeMult = (UINT8)RpmbSizeMult;
+    RpmbDevInfo.RelWrSecC = (UINT8)RelWrSecC;
+    RpmbDevInfo.Valid = TRUE;
+    RpmbStatistics.ReliableWriteBlocks = RelWrSecC * 512 / OPTEE_RPMB_FRAME_DATA_SIZE;
+    ExReleaseFastMutex(&RpmbLock);
+
+    DeviceInfo->rpmb_size_mult = (UINT8)RpmbSizeMult;
+    DeviceInfo->rel_wr_sec_c = (UINT8)RelWrSecC;
+    TeecResult = TEEC_SUCCESS;
+
+Exit:
+    if (TeecResult == TEEC_SUCCESS) {
+        RtlCopyMemory(DeviceInfo->cid, Cid, RPMB_EMMC_CID_SIZE);
+        DeviceInfo->ret_code = TEE_RPC_RPMB_CMD_GET_DEV_INFO_RET_OK;
+    } else {
+        DeviceInfo->ret_code = TEE_RPC_RPMB_CMD_GET_DEV_INFO_RET_ERROR;
+    }
+
+    OpteeClientRpmbRecordRequest(OpteeRpmbGetDevInfo,
+                                 0,
+                                 DeviceCalls,
+                                 OpteeClientRpmbElapsedMicroseconds(Start),
+                                 TeecResult);
+
+    return TeecResult;
+}
+
+/*
+ * Start tracking the RPMB requests of an SMC call.
+ */
+VOID OpteeClientRpmbBeginOperation(POPTEE_RPMB_OPERATION Operation)
+{
+    Operation->Requests = 0;
+    Operation->Start = KeQueryPerformanceCounter(NULL);
+}
+
+/*
+ * Account an SMC call that needed RPMB requests.
+ */
+VOID OpteeClientRpmbEndOperation(POPTEE_RPMB_OPERATION Operation)
+{
+    UINT64 Microseconds;
+
+    if (Operation->Requests == 0) {
+        return;
+    }
+
+    Microseconds = OpteeClientRpmbElapsedMicroseconds(Operation->Start);
+
+    ExAcquireFastMutex(&RpmbLock);
+    RpmbStatistics.Operations++;
+    RpmbStatistics.OperationMicroseconds += Microseconds;
+    RpmbStatistics.OperationLatency[OpteeClientRpmbBucket(
+        Microseconds,
+        OPTEE_RPMB_LATENCY_BUCKET_SHIFT,
+        OPTEE_RPMB_LATENCY_BUCKETS)]++;
+
+    RpmbStatistics.RequestsPerOperation[OpteeClientRpmbBucket(
+        Operation->Requests,
+        1,
+        OPTEE_RPMB_SIZE_BUCKETS)]++;
+
+    ExReleaseFastMutex(&RpmbLock);
+}
+
+/*
+ * Get a snapshot of the RPMB statistics.
+ */
+VOID OpteeClientRpmbGetStatistics(POPTEE_RPMB_STATISTICS Statistics)
+{
+    ExAcquireFastMutex(&RpmbLock);
+    RtlCopyMemory(Statistics, &RpmbStatistics, sizeof(*Statistics));
+    ExReleaseFastMutex(&RpmbLock);
+}
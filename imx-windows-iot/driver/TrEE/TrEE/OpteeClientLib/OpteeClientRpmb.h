@@ -0,0 +1,156 @@
+/** @file
+  RPMB frame I/O for the OP-TEE RPC interface. Translates the RPMB data
+  requests of the OP-TEE OS secure storage into SFFDISK partition access
+  calls to the eMMC RPMB service.
+**/
+
+/*
+ * Copyright (c) 2018, Microsoft Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <sffdisk.h>
+#include "OpteeClientLib.h"
+#include "tee_rpc_types.h"
+
+//
+// The MAC of an authenticated request or response covers all of its frames,
+// so a request always goes to the device as a single call. The number of
+// frames OP-TEE packs into one authenticated write is bounded by the reliable
+// write sector count reported through TEE_RPC_RPMB_CMD_GET_DEV_INFO.
+//
+
+#define OPTEE_RPMB_FRAME_DATA_SIZE 256
+
+//
+// Number of reusable frame buffers, the frames each one is created with and
+// the largest request served from them. Larger requests, or requests that
+// find every buffer busy, use a temporary allocation.
+//
+#define OPTEE_RPMB_FRAME_BUFFER_COUNT 2
+#define OPTEE_RPMB_FRAME_BUFFER_INITIAL_FRAMES 16
+#define OPTEE_RPMB_FRAME_BUFFER_MAX_FRAMES 512
+
+//
+// Histogram buckets are powers of two. Latency bucket 0 counts requests
+// that completed in less than 64us, bucket N those that took from
+// 64us << (N - 1) up to 64us << N. Size bucket N counts requests of
+// 2^N up to 2^(N + 1) - 1 blocks or requests. The last bucket of each
+// histogram also counts everything beyond it.
+//
+#define OPTEE_RPMB_LATENCY_BUCKETS 16
+#define OPTEE_RPMB_LATENCY_BUCKET_SHIFT 6
+#define OPTEE_RPMB_SIZE_BUCKETS 10
+
+typedef enum _OPTEE_RPMB_REQUEST_TYPE {
+    OpteeRpmbProgramKey,
+    OpteeRpmbQueryWriteCounter,
+    OpteeRpmbAuthenticatedWrite,
+    OpteeRpmbAuthenticatedRead,
+    OpteeRpmbGetDevInfo,
+    OpteeRpmbRequestTypeCount
+} OPTEE_RPMB_REQUEST_TYPE;
+
+typedef struct _OPTEE_RPMB_REQUEST_STATISTICS {
+    UINT64 Requests;
+    UINT64 DeviceCalls;
+    UINT64 Blocks;
+    UINT64 Failures;
+    UINT64 TotalMicroseconds;
+    UINT64 MaxMicroseconds;
+    UINT64 Latency[OPTEE_RPMB_LATENCY_BUCKETS];
+    UINT64 BlocksPerRequest[OPTEE_RPMB_SIZE_BUCKETS];
+} OPTEE_RPMB_REQUEST_STATISTICS, *POPTEE_RPMB_REQUEST_STATISTICS;
+
+typedef struct _OPTEE_RPMB_STATISTICS {
+    OPTEE_RPMB_REQUEST_STATISTICS Request[OpteeRpmbRequestTypeCount];
+
+    //
+    // Operations are the SMC calls from normal world that needed at least
+    // one RPMB request, e.g. a TPM command that updated NV storage.
+    //
+    UINT64 Operations;
+    UINT64 OperationMicroseconds;
+    UINT64 OperationLatency[OPTEE_RPMB_LATENCY_BUCKETS];
+    UINT64 RequestsPerOperation[OPTEE_RPMB_SIZE_BUCKETS];
+
+    UINT64 BufferReuses;
+    UINT64 BufferGrows;
+    UINT64 TemporaryBuffers;
+    UINT64 DevInfoCacheHits;
+    ULONG ReliableWriteBlocks;
+} OPTEE_RPMB_STATISTICS, *POPTEE_RPMB_STATISTICS;
+
+//
+// Tracks the RPMB requests of one SMC call, lives on the stack of the caller.
+//
+typedef struct _OPTEE_RPMB_OPERATION {
+    ULONG Requests;
+    LARGE_INTEGER Start;
+} OPTEE_RPMB_OPERATION, *POPTEE_RPMB_OPERATION;
+
+NTSTATUS
+OpteeClientRpmbInit(
+    VOID
+    );
+
+VOID
+OpteeClientRpmbDeinit(
+    VOID
+    );
+
+TEEC_Result
+OpteeClientRpmbDataRequest(
+    _In_ WDFDEVICE ServiceDevice,
+    _Inout_opt_ POPTEE_RPMB_OPERATION Operation,
+    _In_reads_bytes_(RequestSize) const tee_rpc_rpmb_cmd_t *RpmbRequest,
+    _In_ SIZE_T RequestSize,
+    _Out_writes_bytes_(ResponseSize) SFFDISK_DEVICE_RPMB_DATA_FRAME *ResponsePackets,
+    _In_ SIZE_T ResponseSize
+    );
+
+TEEC_Result
+OpteeClientRpmbGetDevInfo(
+    _In_ WDFDEVICE ServiceDevice,
+    _In_reads_bytes_(RPMB_EMMC_CID_SIZE) const UINT8 *Cid,
+    _Out_ tee_rpc_rpmb_dev_info *DeviceInfo
+    );
+
+VOID
+OpteeClientRpmbBeginOperation(
+    _Out_ POPTEE_RPMB_OPERATION Operation
+    );
+
+VOID
+OpteeClientRpmbEndOperation(
+    _In_ POPTEE_RPMB_OPERATION Operation
+    );
+
+VOID
+OpteeClientRpmbGetStatistics(
+    _Out_ POPTEE_RPMB_STATISTICS Statistics
+    );
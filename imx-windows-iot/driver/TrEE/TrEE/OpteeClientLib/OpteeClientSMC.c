@@ -44,6 +44,11 @@
 #include "teesmc.h"
 
 #define TEEC_SMC_SERIALIZE_CALLS 0
+
+// How long a call that found all OP-TEE threads busy waits for one of the
+// calls in progress to complete before trying again.
+//
+#define TEEC_SMC_THREAD_LIMIT_WAIT_MS 10
 #define TEEC_SMC_DEFAULT_CACHE_ATTRIBUTES (TEESMC_ATTR_CACHE_DEFAULT << TEESMC_ATTR_CACHE_SHIFT);
 
 volatile float FloatingPointInit;
@@ -407,6 +412,8 @@ TEEC_Result OpteeSmcCallInternal(PHYSICAL_ADDRESS *TeeSmc32ArgPA)
 {
     TEEC_Result TeecResult = TEEC_SUCCESS;
     ARM_SMC_ARGS ArmSmcArgs = {0};
+    OPTEE_RPMB_OPERATION RpmbOperation;
+    LARGE_INTEGER ThreadLimitTimeout;
     
     // For now just use the normal call style.
     //
@@ -414,11 +421,15 @@ TEEC_Result OpteeSmcCallInternal(PHYSICAL_ADDRESS *TeeSmc32ArgPA)
     ArmSmcArgs.Arg1 = TeeSmc32ArgPA->u.HighPart;
     ArmSmcArgs.Arg2 = TeeSmc32ArgPA->u.LowPart;
 
+    ThreadLimitTimeout.QuadPart = -10LL * 1000LL * TEEC_SMC_THREAD_LIMIT_WAIT_MS;
+
     // This is a loop because the call may result in RPC's that will need
     // to be processed and may result in further calls until the originating
     // call is completed.
     //
 
+    OpteeClientRpmbBeginOperation(&RpmbOperation);
+
     for (;;) {
 
         ArmCallSmc(&ArmSmcArgs);
@@ -429,7 +440,24 @@ TEEC_Result OpteeSmcCallInternal(PHYSICAL_ADDRESS *TeeSmc32ArgPA)
             // and let the OP-TEE OS unwind and return back to us with
             // it's error information.
             //
-            (void) OpteeRpcCallback(&ArmSmcArgs);
+            (void) OpteeRpcCallback(&ArmSmcArgs, &RpmbOperation);
+        }
+        else if (ArmSmcArgs.Arg0 == TEESMC_RETURN_ETHREAD_LIMIT) {
+
+            // All OP-TEE threads are busy with other calls. Wait for
+            // one of them to complete and issue the call again, the
+            // timeout covers a completion signaled before we waited.
+            //
+            (void) KeWaitForSingleObject(&OpteeSmcThreadEvent,
+                                         Executive,
+                                         KernelMode,
+                                         FALSE,
+                                         &ThreadLimitTimeout);
+
+            RtlZeroMemory(&ArmSmcArgs, sizeof(ArmSmcArgs));
+            ArmSmcArgs.Arg0 = TEESMC32_CALL_WITH_ARG;
+            ArmSmcArgs.Arg1 = TeeSmc32ArgPA->u.HighPart;
+            ArmSmcArgs.Arg2 = TeeSmc32ArgPA->u.LowPart;
         }
         else if (ArmSmcArgs.Arg0 == TEESMC_RETURN_UNKNOWN_FUNCTION) {
             TeecResult = TEEC_ERROR_NOT_IMPLEMENTED;
@@ -445,5 +473,11 @@ TEEC_Result OpteeSmcCallInternal(PHYSICAL_ADDRESS *TeeSmc32ArgPA)
         }
     }
 
+    OpteeClientRpmbEndOperation(&RpmbOperation);
+
+    // An OP-TEE thread is free again.
+    //
+    KeSetEvent(&OpteeSmcThreadEvent, IO_NO_INCREMENT, FALSE);
+
     return TeecResult;
 }
@@ -0,0 +1,300 @@
+/** @file
+  OP-TEE wait queues. Secure world threads that block on a mutex or a
+  condition variable sleep in normal world until another thread wakes them
+  up, both through TEE_RPC_CMD_WAIT_QUEUE requests.
+  **/
+
+/*
+ * Copyright (c) 2018, Microsoft Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <ntddk.h>
+#include <ntstatus.h>
+#include <wdf.h>
+
+#include "OpteeClientLib.h"
+#include "OpteeClientWaitQueue.h"
+#include "trace.h"
+
+#ifdef WPP_TRACING
+#include "OpteeClientWaitQueue.tmh"
+#endif
+
+#define OPTEE_CLIENT_RPC_WAIT_BLOCK_TAG 'wTPO'
+
+//
+// OPTEE sync object
+//
+
+typedef struct _OPTEE_WAIT_BLOCK
+{
+    WDFMEMORY Handle;
+    LIST_ENTRY ListEntry;
+    UINT64 Key;
+    KEVENT Event;
+} OPTEE_WAIT_BLOCK, *POPTEE_WAIT_BLOCK;
+
+//
+// Wait object resources. The lock protects the buckets and the statistics,
+// a block is only freed by its sleeper, with the lock held.
+//
+
+static WDFLOOKASIDE WaitBlockPool = NULL;
+static LIST_ENTRY WaitBlockBuckets[OPTEE_WAIT_QUEUE_BUCKETS];
+static FAST_MUTEX WaitBlockLock;
+static OPTEE_WAIT_QUEUE_STATISTICS WaitQueueStatistics;
+
+/*
+ * Map a wait queue key to its bucket. The top bits of the multiplicative
+ * hash are used, the low bits do not depend on the high bits of the key.
+ */
+static ULONG OpteeClientWaitQueueHash(UINT64 Key)
+{
+    ULONG Hash;
+
+    Hash = (ULONG)(Key ^ (Key >> 32)) * 0x9E3779B1;
+    return Hash >> (32 - OPTEE_WAIT_QUEUE_BUCKET_SHIFT);
+}
+
+/*
+ * Initialize wait queue resources.
+ */
+NTSTATUS OpteeClientWaitQueueInit()
+{
+    WDF_OBJECT_ATTRIBUTES Attributes;
+    ULONG Index;
+    NTSTATUS Status;
+
+    if (WaitBlockPool != NULL) {
+        return STATUS_SUCCESS;
+    }
+
+    WDF_OBJECT_ATTRIBUTES_INIT(&Attributes);
+    Attributes.ParentObject = WdfGetDriver();
+
+    Status = WdfLookasideListCreate(
+        &Attributes,
+        sizeof(OPTEE_WAIT_BLOCK),
+        NonPagedPool,
+        WDF_NO_OBJECT_ATTRIBUTES,
+        OPTEE_CLIENT_RPC_WAIT_BLOCK_TAG,
+        &WaitBlockPool);
+
+    if (!NT_SUCCESS(Status)) {
+        TraceError(
+            "Failed to create wait objects lookaside list, %!STATUS!",
+            Status);
+
+        return Status;
+    }
+
+    for (Index = 0; Index < OPTEE_WAIT_QUEUE_BUCKETS; Index++) {
+        InitializeListHead(&WaitBlockBuckets[Index]);
+    }
+
+    RtlZeroMemory(&WaitQueueStatistics, sizeof(WaitQueueStatistics));
+    ExInitializeFastMutex(&WaitBlockLock);
+
+    return STATUS_SUCCESS;
+}
+
+/*
+ * Find the block for a key, create the block if
+ * it does not exist. Called with the lock held.
+ *
+ * On Entry:
+ *  Key: Value identifying the queue to wait for.
+ *
+ * On Exit:
+ *  Created: TRUE if the block did not exist yet.
+ *
+ */
+static POPTEE_WAIT_BLOCK OpteeClientWaitQueueGetBlock(UINT64 Key, BOOLEAN *Created)
+{
+    PLIST_ENTRY Bucket;
+    ULONG ChainLength;
+    PLIST_ENTRY Entry;
+    NTSTATUS Status;
+    POPTEE_WAIT_BLOCK WaitBlock;
+    WDFMEMORY WaitBlockObject;
+
+    *Created = FALSE;
+    ChainLength = 0;
+    Bucket = &WaitBlockBuckets[OpteeClientWaitQueueHash(Key)];
+
+    for (Entry = Bucket->Flink; Entry != Bucket; Entry = Entry->Flink) {
+        WaitBlock = CONTAINING_RECORD(Entry, OPTEE_WAIT_BLOCK, ListEntry);
+        if (WaitBlock->Key == Key) {
+            return WaitBlock;
+        }
+
+        ChainLength++;
+    }
+
+    //
+    // If the block has not been created yet, create it now.
+    //
+    Status = WdfMemoryCreateFromLookaside(WaitBlockPool, &WaitBlockObject);
+    if (!NT_SUCCESS(Status)) {
+        TraceError("WdfMemoryCreateFromLookaside failed, status %!STATUS!\n",
+                   Status);
+
+        return NULL;
+    }
+
+    WaitBlock = (POPTEE_WAIT_BLOCK)WdfMemoryGetBuffer(WaitBlockObject, NULL);
+    WaitBlock->Handle = WaitBlockObject;
+    WaitBlock->Key = Key;
+    KeInitializeEvent(&WaitBlock->Event, SynchronizationEvent, FALSE);
+    InsertTailList(Bucket, &WaitBlock->ListEntry);
+
+    WaitQueueStatistics.Blocks++;
+    if (WaitQueueStatistics.Blocks > WaitQueueStatistics.MaxBlocks) {
+        WaitQueueStatistics.MaxBlocks = WaitQueueStatistics.Blocks;
+    }
+
+    if (ChainLength + 1 > WaitQueueStatistics.MaxChainLength) {
+        WaitQueueStatistics.MaxChainLength = ChainLength + 1;
+    }
+
+    *Created = TRUE;
+    return WaitBlock;
+}
+
+/*
+ * Wait until queue/synchronization object is signaled.
+ *
+ * On Entry:
+ *  Key: Value identifying the queue to wait for.
+ */
+TEEC_Result OpteeClientWaitQueueSleep(UINT64 Key)
+{
+    BOOLEAN Created;
+    NTSTATUS Status;
+    POPTEE_WAIT_BLOCK WaitBlock;
+    WDFMEMORY WaitBlockObject;
+
+    TraceDebug("WaitQueueSleep: thread 0x%p, key = %llX\n",
+               KeGetCurrentThread(),
+               Key);
+
+    //
+    // Get or create a new block. The block may already exist
+    // if the scheduler has inverted the order we receive the
+    // wake/sleep RPC calls.
+    //
+    ExAcquireFastMutex(&WaitBlockLock);
+    WaitBlock = OpteeClientWaitQueueGetBlock(Key, &Created);
+    WaitQueueStatistics.Sleeps++;
+    ExReleaseFastMutex(&WaitBlockLock);
+
+    if (WaitBlock == NULL) {
+        NT_ASSERT(FALSE);
+        return TEEC_ERROR_OUT_OF_MEMORY;
+    }
+
+    Status = KeWaitForSingleObject(&WaitBlock->Event,
+                                   Executive,
+                                   KernelMode,
+                                   FALSE,
+                                   NULL);
+
+    NT_ASSERT(Status == STATUS_SUCCESS);
+
+    TraceDebug("WaitQueueSleep: thread 0x%p, key = %llX, status %!STATUS!\n",
+               KeGetCurrentThread(),
+               Key,
+               Status);
+
+    ExAcquireFastMutex(&WaitBlockLock);
+    RemoveEntryList(&WaitBlock->ListEntry);
+    WaitQueueStatistics.Blocks--;
+    WaitBlockObject = WaitBlock->Handle;
+    ExReleaseFastMutex(&WaitBlockLock);
+
+    WdfObjectDelete(WaitBlockObject);
+
+    return TEEC_SUCCESS;
+}
+
+/*
+* Signal queue/synchronization object.
+*
+* On Entry:
+*  Key: Unique value identifying the queue to signal for.
+*
+*/
+TEEC_Result OpteeClientWaitQueueWakeUp(UINT64 Key)
+{
+    BOOLEAN Created;
+    POPTEE_WAIT_BLOCK WaitBlock;
+
+    TraceDebug("WaitQueueWakeUp: thread 0x%p, key = %llX\n",
+               KeGetCurrentThread(),
+               Key);
+
+    //
+    // Get or create a new block. The block may not exist
+    // if the scheduler has inverted the order we receive the
+    // wake/sleep RPC calls. The event is set with the lock
+    // held so the sleeper cannot free the block under us.
+    //
+    ExAcquireFastMutex(&WaitBlockLock);
+
+    WaitBlock = OpteeClientWaitQueueGetBlock(Key, &Created);
+    if (WaitBlock == NULL) {
+        ExReleaseFastMutex(&WaitBlockLock);
+        NT_ASSERT(FALSE);
+        return TEEC_ERROR_OUT_OF_MEMORY;
+    }
+
+    WaitQueueStatistics.WakeUps++;
+    if (Created) {
+        WaitQueueStatistics.EarlyWakeUps++;
+    }
+
+    TraceDebug("WaitQueueWakeUp: thread 0x%p, key = %llX, "
+        "setting event 0x%p\n",
+        KeGetCurrentThread(),
+        Key,
+        &WaitBlock->Event);
+    KeSetEvent(&WaitBlock->Event, IO_NO_INCREMENT, FALSE);
+
+    ExReleaseFastMutex(&WaitBlockLock);
+
+    return TEEC_SUCCESS;
+}
+
+/*
+ * Get a snapshot of the wait queue statistics.
+ */
+VOID OpteeClientWaitQueueGetStatistics(POPTEE_WAIT_QUEUE_STATISTICS Statistics)
+{
+    ExAcquireFastMutex(&WaitBlockLock);
+    RtlCopyMemory(Statistics, &WaitQueueStatistics, sizeof(*Statistics));
+    ExReleaseFastMutex(&WaitBlockLock);
+}
@@ -0,0 +1,74 @@
+/** @file
+  OP-TEE wait queues. Secure world threads that block on a mutex or a
+  condition variable sleep in normal world until another thread wakes them
+  up, both through TEE_RPC_CMD_WAIT_QUEUE requests.
+**/
+
+/*
+ * Copyright (c) 2018, Microsoft Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+//
+// Wait blocks are hashed by key. OP-TEE uses the id of the sleeping thread
+// as the key, so each bucket holds at most a few blocks.
+//
+#define OPTEE_WAIT_QUEUE_BUCKET_SHIFT 6
+#define OPTEE_WAIT_QUEUE_BUCKETS (1 << OPTEE_WAIT_QUEUE_BUCKET_SHIFT)
+
+typedef struct _OPTEE_WAIT_QUEUE_STATISTICS {
+    UINT64 Sleeps;
+    UINT64 WakeUps;
+
+    //
+    // Wake-ups received before the matching sleep.
+    //
+    UINT64 EarlyWakeUps;
+    ULONG Blocks;
+    ULONG MaxBlocks;
+    ULONG MaxChainLength;
+} OPTEE_WAIT_QUEUE_STATISTICS, *POPTEE_WAIT_QUEUE_STATISTICS;
+
+NTSTATUS
+OpteeClientWaitQueueInit(
+    VOID
+    );
+
+TEEC_Result
+OpteeClientWaitQueueSleep(
+    _In_ UINT64 Key
+    );
+
+TEEC_Result
+OpteeClientWaitQueueWakeUp(
+    _In_ UINT64 Key
+    );
+
+VOID
+OpteeClientWaitQueueGetStatistics(
+    _Out_ POPTEE_WAIT_QUEUE_STATISTICS Statistics
+    );
@@ -0,0 +1,900 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host unit test of the asynchronous invocations and of the RPC wait queues
+// against a simulated secure world
+//
+// The secure world has fewer threads than the worker pool, so calls see
+// TEESMC_RETURN_ETHREAD_LIMIT and take the wait and retry path of
+// OpteeSmcCallInternal. Its trusted application serializes some commands
+// on a mutex held across an IRQ return to normal world. A call that finds
+// the mutex held sleeps in the wait queue, keyed by its secure thread, and
+// the holder wakes it up on release, as OP-TEE does. The thread keys all
+// map to the same wait queue bucket. The shared memory is a 1:1 mapping of
+// host memory and the RPC dispatch only serves the wait queue commands.
+//
+// Covered: sleep, wake-up and early wake-up, keys that collide in the hash
+// or differ only in the high bits, the worker pool failing to initialize,
+// the parameter checks, the bound of calls in flight, the completion of
+// every request exactly once with its result and error origin, the
+// rejection past the pending limit, the drain of the queued requests on
+// deinit and the statistics.
+//
+
+#define HOST_TEST_THREADS
+
+#include "OpteeClientSMC.c"
+#include "OpteeClientAsync.c"
+#include "OpteeClientWaitQueue.c"
+
+#include <unistd.h>
+
+#include "HostTest.h"
+#include "tee_rpc.h"
+
+#define SECURE_THREAD_COUNT     2
+#define SECURE_KEY_COUNT        8
+
+#define TA_CMD_ADD              1
+#define TA_CMD_LOCKED_ADD       2
+#define TA_CMD_FAIL             3
+#define TA_CMD_GATED_ADD        4
+
+#define TEST_REQUESTS           2000
+#define TEST_WAIT_MS            30000
+
+KSEMAPHORE OpteeSMCLock;
+KEVENT OpteeSmcThreadEvent;
+
+//
+// Shared memory, mapped 1:1
+//
+
+NTSTATUS
+OpteeClientMemAlloc(
+    UINT32 Length,
+    PVOID *AllocatedMemory,
+    PHYSICAL_ADDRESS *PhysicalMemory
+    )
+{
+    *AllocatedMemory = calloc(1, Length);
+    if (*AllocatedMemory == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+    if (PhysicalMemory != NULL) {
+        PhysicalMemory->QuadPart = (LONGLONG)(ULONG_PTR)*AllocatedMemory;
+    }
+    return STATUS_SUCCESS;
+}
+
+VOID
+OpteeClientMemFree(
+    PVOID Mem
+    )
+{
+    free(Mem);
+}
+
+VOID
+OpteeClientRpmbBeginOperation(
+    POPTEE_RPMB_OPERATION Operation
+    )
+{
+    UNREFERENCED_PARAMETER(Operation);
+}
+
+VOID
+OpteeClientRpmbEndOperation(
+    POPTEE_RPMB_OPERATION Operation
+    )
+{
+    UNREFERENCED_PARAMETER(Operation);
+}
+
+static
+t_teesmc_arg*
+ArgFromRegisters(
+    UINTN High,
+    UINTN Low
+    )
+{
+    return (t_teesmc_arg*)(ULONG_PTR)(((UINT64)(UINT32)High << 32) | (UINT32)Low);
+}
+
+//
+// Simulated secure world
+//
+
+typedef struct _SECURE_THREAD {
+    BOOLEAN Busy;
+    ULONG Step;
+    t_teesmc_arg *Arg;
+    struct {
+        t_teesmc_arg Arg;
+        t_teesmc_param Param;
+    } Rpc;
+} SECURE_THREAD;
+
+static struct {
+    pthread_mutex_t Lock;
+    pthread_cond_t GateChanged;
+    BOOLEAN GateOpen;
+    ULONG Gated;
+    SECURE_THREAD Threads[SECURE_THREAD_COUNT];
+    UINT64 Keys[SECURE_KEY_COUNT];
+    BOOLEAN MutexHeld;
+    ULONG Waiters[SECURE_THREAD_COUNT];
+    ULONG WaiterCount;
+    UINT64 LockedCount;
+    UINT64 ThreadLimitReturns;
+    UINT64 BadRpcReturns;
+} g_Secure;
+
+static
+UINT32
+TaResult(
+    UINT32 Value
+    )
+{
+    return Value * 3 + 1;
+}
+
+static
+VOID
+SecureReturnRpc(
+    ARM_SMC_ARGS *Args,
+    SECURE_THREAD *Thread,
+    UINTN Function
+    )
+{
+    Args->Arg0 = TEESMC_RPC_VAL(Function);
+    Args->Arg1 = (UINTN)((ULONG_PTR)&Thread->Rpc.Arg >> 32);
+    Args->Arg2 = (UINTN)((ULONG_PTR)&Thread->Rpc.Arg & 0xFFFFFFFF);
+    Args->Arg3 = (UINTN)(Thread - g_Secure.Threads);
+}
+
+static
+VOID
+SecureReturnWaitQueue(
+    ARM_SMC_ARGS *Args,
+    SECURE_THREAD *Thread,
+    UINT32 Command,
+    UINT64 Key
+    )
+{
+    RtlZeroMemory(&Thread->Rpc, sizeof(Thread->Rpc));
+    Thread->Rpc.Arg.cmd = TEE_RPC_CMD_WAIT_QUEUE;
+    Thread->Rpc.Arg.num_params = 1;
+    Thread->Rpc.Param.attr = TEESMC_ATTR_TYPE_VALUE_INPUT;
+    Thread->Rpc.Param.u.value.a = Command;
+    Thread->Rpc.Param.u.value.b = Key;
+    SecureReturnRpc(Args, Thread, TEESMC_RPC_FUNC_CMD);
+}
+
+//
+// Run a secure thread until it returns to normal world, with the secure
+// world lock held.
+//
+static
+VOID
+SecureThreadRun(
+    ARM_SMC_ARGS *Args,
+    SECURE_THREAD *Thread
+    )
+{
+    t_teesmc_param *Param = TEESMC_GET_PARAMS(Thread->Arg);
+    ULONG Index = (ULONG)(Thread - g_Secure.Threads);
+    ULONG Waiter;
+
+    for (;;) {
+        switch (Thread->Step) {
+        case 0:
+            if (Thread->Arg->func == TA_CMD_FAIL) {
+                Thread->Arg->ret = TEEC_ERROR_ITEM_NOT_FOUND;
+                Thread->Arg->ret_origin = TEEC_ORIGIN_TRUSTED_APP;
+                Thread->Step = 4;
+                continue;
+            }
+            if (Thread->Arg->func == TA_CMD_GATED_ADD) {
+                g_Secure.Gated++;
+                pthread_cond_broadcast(&g_Secure.GateChanged);
+                while (!g_Secure.GateOpen) {
+                    pthread_cond_wait(&g_Secure.GateChanged, &g_Secure.Lock);
+                }
+            }
+            Thread->Step = (Thread->Arg->func == TA_CMD_LOCKED_ADD) ? 1 : 3;
+            continue;
+
+        //
+        // Take the mutex or sleep until the holder wakes this thread up.
+        //
+        case 1:
+            if (g_Secure.MutexHeld) {
+                g_Secure.Waiters[g_Secure.WaiterCount++] = Index;
+                SecureReturnWaitQueue(Args, Thread, TEE_WAIT_QUEUE_SLEEP, g_Secure.Keys[Index]);
+                return;
+            }
+            g_Secure.MutexHeld = TRUE;
+            Thread->Step = 2;
+
+            //
+            // Let the other calls run into the mutex.
+            //
+            pthread_mutex_unlock(&g_Secure.Lock);
+            usleep(20);
+            pthread_mutex_lock(&g_Secure.Lock);
+            SecureReturnRpc(Args, Thread, TEESMC_RPC_FUNC_IRQ);
+            return;
+
+        case 2:
+            g_Secure.LockedCount++;
+            g_Secure.MutexHeld = FALSE;
+            Thread->Step = 3;
+            if (g_Secure.WaiterCount != 0) {
+                Waiter = g_Secure.Waiters[0];
+                g_Secure.WaiterCount--;
+                memmove(&g_Secure.Waiters[0], &g_Secure.Waiters[1],
+                        g_Secure.WaiterCount * sizeof(g_Secure.Waiters[0]));
+                SecureReturnWaitQueue(Args, Thread, TEE_WAIT_QUEUE_WAKEUP, g_Secure.Keys[Waiter]);
+                return;
+            }
+            continue;
+
+        case 3:
+            Param[0].u.value.b = TaResult((UINT32)Param[0].u.value.a);
+            Thread->Arg->ret = TEEC_SUCCESS;
+            Thread->Arg->ret_origin = TEEC_ORIGIN_TRUSTED_APP;
+            Thread->Step = 4;
+            continue;
+
+        default:
+            Thread->Busy = FALSE;
+            Args->Arg0 = TEESMC_RETURN_OK;
+            return;
+        }
+    }
+}
+
+VOID
+ArmCallSmc(
+    ARM_SMC_ARGS *Args
+    )
+{
+    SECURE_THREAD *Thread = NULL;
+    ULONG Index;
+
+    pthread_mutex_lock(&g_Secure.Lock);
+
+    if (Args->Arg0 == TEESMC32_CALL_WITH_ARG) {
+        for (Index = 0; Index < SECURE_THREAD_COUNT; Index++) {
+            if (!g_Secure.Threads[Index].Busy) {
+                Thread = &g_Secure.Threads[Index];
+                break;
+            }
+        }
+        if (Thread == NULL) {
+            g_Secure.ThreadLimitReturns++;
+            Args->Arg0 = TEESMC_RETURN_ETHREAD_LIMIT;
+            pthread_mutex_unlock(&g_Secure.Lock);
+            return;
+        }
+        Thread->Busy = TRUE;
+        Thread->Step = 0;
+        Thread->Arg = ArgFromRegisters(Args->Arg1, Args->Arg2);
+
+    } else if ((Args->Arg0 == TEESMC32_CALL_RETURN_FROM_RPC) &&
+               (Args->Arg3 < SECURE_THREAD_COUNT) &&
+               g_Secure.Threads[Args->Arg3].Busy) {
+
+        Thread = &g_Secure.Threads[Args->Arg3];
+        if (Thread->Rpc.Arg.ret != TEEC_SUCCESS) {
+            g_Secure.BadRpcReturns++;
+        }
+
+    } else {
+        g_Secure.BadRpcReturns++;
+        Args->Arg0 = TEESMC_RETURN_UNKNOWN_FUNCTION;
+        pthread_mutex_unlock(&g_Secure.Lock);
+        return;
+    }
+
+    SecureThreadRun(Args, Thread);
+
+    pthread_mutex_unlock(&g_Secure.Lock);
+}
+
+static
+VOID
+SecureSetGate(
+    BOOLEAN Open
+    )
+{
+    pthread_mutex_lock(&g_Secure.Lock);
+    g_Secure.GateOpen = Open;
+    g_Secure.Gated = 0;
+    pthread_cond_broadcast(&g_Secure.GateChanged);
+    pthread_mutex_unlock(&g_Secure.Lock);
+}
+
+//
+// Normal world side of the RPCs, the wait queue commands are dispatched as
+// in OpteeRpcCmdWaitQueue. Every other sleep is delayed so that its wake-up
+// often comes first.
+//
+static LONG g_SleepRpcs;
+
+TEEC_Result
+OpteeRpcCallback(
+    ARM_SMC_ARGS *ArmSmcArgs,
+    POPTEE_RPMB_OPERATION RpmbOperation
+    )
+{
+    t_teesmc_arg *TeeSmcArg;
+    t_teesmc_param *TeeSmcParam;
+    TEEC_Result TeecResult = TEEC_SUCCESS;
+
+    UNREFERENCED_PARAMETER(RpmbOperation);
+
+    switch (TEESMC_RETURN_GET_RPC_FUNC(ArmSmcArgs->Arg0)) {
+    case TEESMC_RPC_FUNC_IRQ:
+        break;
+
+    case TEESMC_RPC_FUNC_CMD:
+        TeeSmcArg = ArgFromRegisters(ArmSmcArgs->Arg1, ArmSmcArgs->Arg2);
+        TeeSmcParam = TEESMC_GET_PARAMS(TeeSmcArg);
+        CHECK(TeeSmcArg->cmd == TEE_RPC_CMD_WAIT_QUEUE);
+
+        if (TeeSmcParam[0].u.value.a == TEE_WAIT_QUEUE_SLEEP) {
+            if ((__atomic_add_fetch(&g_SleepRpcs, 1, __ATOMIC_SEQ_CST) % 2) == 0) {
+                usleep(100);
+            }
+            TeecResult = OpteeClientWaitQueueSleep(TeeSmcParam[0].u.value.b);
+        } else {
+            TeecResult = OpteeClientWaitQueueWakeUp(TeeSmcParam[0].u.value.b);
+        }
+        TeeSmcArg->ret = TeecResult;
+        break;
+
+    default:
+        CHECK(FALSE);
+        break;
+    }
+
+    ArmSmcArgs->Arg0 = TEESMC32_CALL_RETURN_FROM_RPC;
+
+    return TeecResult;
+}
+
+//
+// TEEC_InvokeCommand as in OpteeClientLib.c, which also counts the calls in
+// flight.
+//
+static LONG g_InFlight;
+static LONG g_MaxInFlight;
+
+TEEC_Result
+TEEC_InvokeCommand(
+    TEEC_Session *session,
+    uint32_t cmd_id,
+    TEEC_Operation *operation,
+    uint32_t *error_origin
+    )
+{
+    LARGE_INTEGER Start;
+    TEEC_Result TeecResult;
+    LONG InFlight;
+    LONG Max;
+
+    InFlight = __atomic_add_fetch(&g_InFlight, 1, __ATOMIC_SEQ_CST);
+    Max = __atomic_load_n(&g_MaxInFlight, __ATOMIC_SEQ_CST);
+    while ((InFlight > Max) &&
+           !__atomic_compare_exchange_n(&g_MaxInFlight, &Max, InFlight, FALSE,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+    }
+
+    Start = KeQueryPerformanceCounter(NULL);
+    TeecResult = TEEC_SMC_InvokeCommand(session, cmd_id, operation, error_origin);
+    OpteeClientInvokeRecord(session->session_id, cmd_id, Start, TeecResult);
+
+    __atomic_sub_fetch(&g_InFlight, 1, __ATOMIC_SEQ_CST);
+
+    return TeecResult;
+}
+
+//
+// Requests and their completions
+//
+
+typedef struct _TEST_REQUEST {
+    uint32_t CommandId;
+    TEEC_Operation Operation;
+    LONG Completions;
+    TEEC_Result Result;
+    uint32_t ErrorOrigin;
+} TEST_REQUEST;
+
+static TEEC_Session g_Session = { NULL, 0x5E55 };
+static TEST_REQUEST g_Requests[TEST_REQUESTS];
+static LONG g_Completed;
+
+static
+VOID
+TestCompletion(
+    PVOID Context,
+    TEEC_Result TeecResult,
+    uint32_t ErrorOrigin
+    )
+{
+    TEST_REQUEST *Request = (TEST_REQUEST *)Context;
+
+    Request->Result = TeecResult;
+    Request->ErrorOrigin = ErrorOrigin;
+    __atomic_add_fetch(&Request->Completions, 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&g_Completed, 1, __ATOMIC_SEQ_CST);
+}
+
+static
+VOID
+ResetRequests()
+{
+    RtlZeroMemory(g_Requests, sizeof(g_Requests));
+    g_Completed = 0;
+}
+
+static
+TEEC_Result
+Submit(
+    ULONG Index,
+    uint32_t CommandId
+    )
+{
+    TEST_REQUEST *Request = &g_Requests[Index];
+
+    Request->CommandId = CommandId;
+    Request->Operation.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INOUT, TEEC_NONE,
+                                                     TEEC_NONE, TEEC_NONE);
+    Request->Operation.params[0].value.a = Index;
+    Request->Operation.params[0].value.b = 0;
+
+    return OpteeClientInvokeCommandAsync(&g_Session, CommandId, &Request->Operation,
+                                         TestCompletion, Request);
+}
+
+static
+BOOLEAN
+WaitFor(
+    LONG volatile *Value,
+    LONG Expected
+    )
+{
+    ULONG Ms;
+
+    for (Ms = 0; Ms < TEST_WAIT_MS; Ms++) {
+        if (__atomic_load_n(Value, __ATOMIC_SEQ_CST) == Expected) {
+            return TRUE;
+        }
+        usleep(1000);
+    }
+    return FALSE;
+}
+
+static
+BOOLEAN
+WaitForGated(
+    ULONG Expected
+    )
+{
+    ULONG Gated;
+    ULONG Ms;
+
+    for (Ms = 0; Ms < TEST_WAIT_MS; Ms++) {
+        pthread_mutex_lock(&g_Secure.Lock);
+        Gated = g_Secure.Gated;
+        pthread_mutex_unlock(&g_Secure.Lock);
+        if (Gated == Expected) {
+            return TRUE;
+        }
+        usleep(1000);
+    }
+    return FALSE;
+}
+
+static
+BOOLEAN
+WaitForInFlight(
+    ULONG Expected
+    )
+{
+    KIRQL OldIrql;
+    ULONG InFlight;
+    ULONG Ms;
+
+    for (Ms = 0; Ms < TEST_WAIT_MS; Ms++) {
+        KeAcquireSpinLock(&AsyncLock, &OldIrql);
+        InFlight = AsyncInFlight;
+        KeReleaseSpinLock(&AsyncLock, OldIrql);
+        if (InFlight == Expected) {
+            return TRUE;
+        }
+        usleep(1000);
+    }
+    return FALSE;
+}
+
+static
+VOID
+CheckRequest(
+    ULONG Index
+    )
+{
+    TEST_REQUEST *Request = &g_Requests[Index];
+
+    CHECK(Request->Completions == 1);
+    if (Request->CommandId == TA_CMD_FAIL) {
+        CHECK(Request->Result == TEEC_ERROR_ITEM_NOT_FOUND);
+    } else {
+        CHECK(Request->Result == TEEC_SUCCESS);
+        CHECK(Request->Operation.params[0].value.b == TaResult(Index));
+    }
+    CHECK(Request->ErrorOrigin == TEEC_ORIGIN_TRUSTED_APP);
+}
+
+//
+// Wait queue
+//
+
+typedef struct _SLEEPER {
+    pthread_t Thread;
+    UINT64 Key;
+    TEEC_Result Result;
+    LONG Done;
+} SLEEPER;
+
+static
+void*
+SleeperThread(
+    void *Parameter
+    )
+{
+    SLEEPER *Sleeper = (SLEEPER *)Parameter;
+
+    Sleeper->Result = OpteeClientWaitQueueSleep(Sleeper->Key);
+    __atomic_store_n(&Sleeper->Done, 1, __ATOMIC_SEQ_CST);
+    return NULL;
+}
+
+static
+BOOLEAN
+WaitForBlocks(
+    ULONG Blocks
+    )
+{
+    OPTEE_WAIT_QUEUE_STATISTICS Statistics;
+    ULONG Ms;
+
+    for (Ms = 0; Ms < TEST_WAIT_MS; Ms++) {
+        OpteeClientWaitQueueGetStatistics(&Statistics);
+        if (Statistics.Blocks == Blocks) {
+            return TRUE;
+        }
+        usleep(1000);
+    }
+    return FALSE;
+}
+
+static
+VOID
+TestWaitQueue()
+{
+    OPTEE_WAIT_QUEUE_STATISTICS Before;
+    OPTEE_WAIT_QUEUE_STATISTICS Statistics;
+    SLEEPER Sleepers[SECURE_KEY_COUNT];
+    UINT64 High;
+    LONG Objects;
+    ULONG Index;
+
+    CHECK(NT_SUCCESS(OpteeClientWaitQueueInit()));
+    Objects = g_HostWdfObjects;
+    OpteeClientWaitQueueGetStatistics(&Before);
+
+    //
+    // A wake-up before the sleep leaves the event set for the sleeper.
+    //
+    CHECK(OpteeClientWaitQueueWakeUp(0x1234) == TEEC_SUCCESS);
+    OpteeClientWaitQueueGetStatistics(&Statistics);
+    CHECK(Statistics.Blocks == 1);
+    CHECK(Statistics.EarlyWakeUps == Before.EarlyWakeUps + 1);
+    CHECK(OpteeClientWaitQueueSleep(0x1234) == TEEC_SUCCESS);
+    OpteeClientWaitQueueGetStatistics(&Statistics);
+    CHECK(Statistics.Blocks == 0);
+    CHECK(g_HostWdfObjects == Objects);
+
+    //
+    // Keys that collide in the hash each get their own block, woken in any
+    // order.
+    //
+    for (Index = 0; Index < SECURE_KEY_COUNT; Index++) {
+        Sleepers[Index].Key = g_Secure.Keys[Index];
+        Sleepers[Index].Done = 0;
+        pthread_create(&Sleepers[Index].Thread, NULL, SleeperThread, &Sleepers[Index]);
+    }
+    CHECK(WaitForBlocks(SECURE_KEY_COUNT));
+    OpteeClientWaitQueueGetStatistics(&Statistics);
+    CHECK(Statistics.MaxChainLength >= SECURE_KEY_COUNT);
+
+    for (Index = SECURE_KEY_COUNT; Index-- > 0;) {
+        CHECK(OpteeClientWaitQueueWakeUp(Sleepers[Index].Key) == TEEC_SUCCESS);
+        pthread_join(Sleepers[Index].Thread, NULL);
+        CHECK(Sleepers[Index].Result == TEEC_SUCCESS);
+        if (Index != 0) {
+            CHECK(__atomic_load_n(&Sleepers[Index - 1].Done, __ATOMIC_SEQ_CST) == 0);
+        }
+    }
+
+    //
+    // Keys that differ only in their high bits and share a bucket do not
+    // wake each other up.
+    //
+    for (High = 1ULL << 32; OpteeClientWaitQueueHash(High | 1) != OpteeClientWaitQueueHash(1);
+         High += 1ULL << 32) {
+    }
+    Sleepers[0].Key = 1;
+    Sleepers[0].Done = 0;
+    pthread_create(&Sleepers[0].Thread, NULL, SleeperThread, &Sleepers[0]);
+    CHECK(WaitForBlocks(1));
+    CHECK(OpteeClientWaitQueueWakeUp(High | 1) == TEEC_SUCCESS);
+    OpteeClientWaitQueueGetStatistics(&Statistics);
+    CHECK(Statistics.Blocks == 2);
+    usleep(10000);
+    CHECK(__atomic_load_n(&Sleepers[0].Done, __ATOMIC_SEQ_CST) == 0);
+    CHECK(OpteeClientWaitQueueWakeUp(1) == TEEC_SUCCESS);
+    pthread_join(Sleepers[0].Thread, NULL);
+    CHECK(OpteeClientWaitQueueSleep(High | 1) == TEEC_SUCCESS);
+
+    OpteeClientWaitQueueGetStatistics(&Statistics);
+    CHECK(Statistics.Blocks == 0);
+    CHECK(Statistics.Sleeps == Before.Sleeps + SECURE_KEY_COUNT + 3);
+    CHECK(Statistics.WakeUps == Before.WakeUps + SECURE_KEY_COUNT + 3);
+    CHECK(Statistics.EarlyWakeUps == Before.EarlyWakeUps + 2);
+    CHECK(g_HostWdfObjects == Objects);
+}
+
+//
+// Asynchronous invocations
+//
+
+static
+VOID
+TestInitFailure()
+{
+    LONG Objects = g_HostWdfObjects;
+
+    g_HostWorkItemsToCreate = 2;
+    CHECK(!NT_SUCCESS(OpteeClientAsyncInit(NULL)));
+    g_HostWorkItemsToCreate = 0xFFFFFFFF;
+    CHECK(g_HostWdfObjects == Objects);
+
+    ResetRequests();
+    CHECK(Submit(0, TA_CMD_ADD) == TEEC_ERROR_BAD_STATE);
+    CHECK(OpteeClientInvokeCommandAsync(NULL, TA_CMD_ADD, NULL, TestCompletion, NULL) ==
+          TEEC_ERROR_BAD_PARAMETERS);
+    CHECK(OpteeClientInvokeCommandAsync(&g_Session, TA_CMD_ADD, NULL, NULL, NULL) ==
+          TEEC_ERROR_BAD_PARAMETERS);
+    CHECK(g_Completed == 0);
+}
+
+static
+VOID
+TestConcurrent()
+{
+    static const uint32_t Commands[] = { TA_CMD_ADD, TA_CMD_LOCKED_ADD, TA_CMD_LOCKED_ADD, TA_CMD_FAIL };
+    OPTEE_CLIENT_ASYNC_STATISTICS AsyncStatistics;
+    OPTEE_CLIENT_INVOKE_STATISTICS Invoke;
+    OPTEE_WAIT_QUEUE_STATISTICS Before;
+    OPTEE_WAIT_QUEUE_STATISTICS Statistics;
+    UINT64 Invocations = 0;
+    UINT64 Failures = 0;
+    UINT64 Locked = 0;
+    UINT64 LockedBefore;
+    ULONG Busy = 0;
+    ULONG Index;
+    TEEC_Result TeecResult;
+
+    CHECK(NT_SUCCESS(OpteeClientAsyncInit(NULL)));
+    OpteeClientWaitQueueGetStatistics(&Before);
+    LockedBefore = g_Secure.LockedCount;
+    ResetRequests();
+    g_MaxInFlight = 0;
+
+    for (Index = 0; Index < TEST_REQUESTS; Index++) {
+        while ((TeecResult = Submit(Index, Commands[Index % 4])) == TEEC_ERROR_BUSY) {
+            Busy++;
+            usleep(1000);
+        }
+        CHECK(TeecResult == TEEC_SUCCESS);
+        Locked += (Commands[Index % 4] == TA_CMD_LOCKED_ADD);
+    }
+
+    CHECK(WaitFor(&g_Completed, TEST_REQUESTS));
+    for (Index = 0; Index < TEST_REQUESTS; Index++) {
+        CheckRequest(Index);
+    }
+
+    //
+    // The calls in flight are bounded by the pool, not by the secure
+    // threads, the others retried after an ETHREAD_LIMIT return.
+    //
+    CHECK(g_MaxInFlight <= OPTEE_CLIENT_ASYNC_WORKER_COUNT);
+    CHECK(g_MaxInFlight > SECURE_THREAD_COUNT);
+    CHECK(g_Secure.ThreadLimitReturns != 0);
+    CHECK(g_Secure.BadRpcReturns == 0);
+    CHECK(g_Secure.LockedCount == LockedBefore + Locked);
+
+    OpteeClientAsyncGetStatistics(&AsyncStatistics);
+    CHECK(AsyncStatistics.Submitted == TEST_REQUESTS);
+    CHECK(AsyncStatistics.Completed == TEST_REQUESTS);
+    CHECK(AsyncStatistics.Rejected == Busy);
+    CHECK(AsyncStatistics.MaxInFlight <= OPTEE_CLIENT_ASYNC_WORKER_COUNT);
+    CHECK(AsyncStatistics.MaxPending <= OPTEE_CLIENT_ASYNC_MAX_PENDING);
+    CHECK(AsyncStatistics.CommandCount == 3);
+
+    for (Index = 0; OpteeClientInvokeGetStatistics(Index, &Invoke); Index++) {
+        CHECK(Invoke.SessionId == g_Session.session_id);
+        Invocations += Invoke.Invocations;
+        Failures += Invoke.Failures;
+    }
+    CHECK(Index == 3);
+    CHECK(Invocations == TEST_REQUESTS);
+    CHECK(Failures == TEST_REQUESTS / 4);
+
+    //
+    // Each sleep in the secure world got its wake-up and left no block
+    // behind.
+    //
+    OpteeClientWaitQueueGetStatistics(&Statistics);
+    CHECK(Statistics.Sleeps > Before.Sleeps);
+    CHECK(Statistics.Sleeps - Before.Sleeps == Statistics.WakeUps - Before.WakeUps);
+    CHECK(Statistics.EarlyWakeUps > Before.EarlyWakeUps);
+    CHECK(Statistics.Blocks == 0);
+
+    OpteeClientAsyncDeinit();
+}
+
+static
+VOID
+TestBusy()
+{
+    OPTEE_CLIENT_ASYNC_STATISTICS Statistics;
+    ULONG Index;
+
+    SecureSetGate(FALSE);
+    CHECK(NT_SUCCESS(OpteeClientAsyncInit(NULL)));
+    ResetRequests();
+
+    //
+    // Two workers wait at the gate in the secure world, the two others
+    // retry on ETHREAD_LIMIT, so further requests stay pending.
+    //
+    for (Index = 0; Index < OPTEE_CLIENT_ASYNC_WORKER_COUNT; Index++) {
+        CHECK(Submit(Index, TA_CMD_GATED_ADD) == TEEC_SUCCESS);
+    }
+    CHECK(WaitForGated(SECURE_THREAD_COUNT));
+    CHECK(WaitForInFlight(OPTEE_CLIENT_ASYNC_WORKER_COUNT));
+
+    for (; Index < OPTEE_CLIENT_ASYNC_WORKER_COUNT + OPTEE_CLIENT_ASYNC_MAX_PENDING; Index++) {
+        CHECK(Submit(Index, TA_CMD_ADD) == TEEC_SUCCESS);
+    }
+    CHECK(Submit(Index, TA_CMD_ADD) == TEEC_ERROR_BUSY);
+    CHECK(g_Completed == 0);
+
+    SecureSetGate(TRUE);
+    CHECK(WaitFor(&g_Completed, Index));
+    for (Index = 0; Index < OPTEE_CLIENT_ASYNC_WORKER_COUNT + OPTEE_CLIENT_ASYNC_MAX_PENDING; Index++) {
+        CheckRequest(Index);
+    }
+    CHECK(g_Requests[Index].Completions == 0);
+
+    OpteeClientAsyncGetStatistics(&Statistics);
+    CHECK(Statistics.Rejected == 1);
+    CHECK(Statistics.MaxPending == OPTEE_CLIENT_ASYNC_MAX_PENDING);
+    CHECK(Statistics.MaxInFlight == OPTEE_CLIENT_ASYNC_WORKER_COUNT);
+
+    OpteeClientAsyncDeinit();
+}
+
+static
+void*
+DeinitThread(
+    void *Parameter
+    )
+{
+    UNREFERENCED_PARAMETER(Parameter);
+    OpteeClientAsyncDeinit();
+    return NULL;
+}
+
+static
+VOID
+TestDeinitDrains()
+{
+    pthread_t Thread;
+    KIRQL OldIrql;
+    BOOLEAN Running;
+    LONG Objects = g_HostWdfObjects;
+    ULONG Count = 24;
+    ULONG Index;
+    ULONG Ms;
+
+    SecureSetGate(FALSE);
+    CHECK(NT_SUCCESS(OpteeClientAsyncInit(NULL)));
+    ResetRequests();
+
+    for (Index = 0; Index < Count; Index++) {
+        CHECK(Submit(Index, (Index < OPTEE_CLIENT_ASYNC_WORKER_COUNT) ? TA_CMD_GATED_ADD : TA_CMD_LOCKED_ADD) ==
+              TEEC_SUCCESS);
+    }
+    CHECK(WaitForGated(SECURE_THREAD_COUNT));
+
+    //
+    // Deinit stops the submissions at once and returns once the queued
+    // requests are done.
+    //
+    pthread_create(&Thread, NULL, DeinitThread, NULL);
+    for (Ms = 0; Ms < TEST_WAIT_MS; Ms++) {
+        usleep(1000);
+        KeAcquireSpinLock(&AsyncLock, &OldIrql);
+        Running = AsyncRunning;
+        KeReleaseSpinLock(&AsyncLock, OldIrql);
+        if (!Running) {
+            break;
+        }
+    }
+    CHECK(!Running);
+
+    CHECK(Submit(Count, TA_CMD_ADD) == TEEC_ERROR_BAD_STATE);
+    CHECK(g_Completed == 0);
+
+    SecureSetGate(TRUE);
+    pthread_join(Thread, NULL);
+
+    CHECK(g_Completed == (LONG)Count);
+    for (Index = 0; Index < Count; Index++) {
+        CheckRequest(Index);
+    }
+    CHECK(g_Requests[Count].Completions == 0);
+    CHECK(IsListEmpty(&AsyncPendingList));
+    CHECK(g_HostWdfObjects == Objects);
+}
+
+int
+main()
+{
+    ULONG Index;
+    UINT64 Key;
+
+    pthread_mutex_init(&g_Secure.Lock, NULL);
+    pthread_cond_init(&g_Secure.GateChanged, NULL);
+    KeInitializeSemaphore(&OpteeSMCLock, 1, 1);
+    KeInitializeEvent(&OpteeSmcThreadEvent, SynchronizationEvent, FALSE);
+
+    //
+    // The secure thread keys and those of the wait queue test all collide
+    // in the first bucket.
+    //
+    Index = 0;
+    for (Key = 1; Index < SECURE_KEY_COUNT; Key++) {
+        if (OpteeClientWaitQueueHash(Key) == 0) {
+            g_Secure.Keys[Index++] = Key;
+        }
+    }
+    SecureSetGate(TRUE);
+
+    TestWaitQueue();
+    TestInitFailure();
+    TestConcurrent();
+    TestBusy();
+    TestDeinitDrains();
+
+    return HostTestResult("OpteeClientAsyncTest");
+}
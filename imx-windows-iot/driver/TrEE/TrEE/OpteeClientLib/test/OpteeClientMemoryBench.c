@@ -0,0 +1,247 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host benchmark of the OP-TEE shared memory allocator
+//
+// Runs the same random workload, 96 live blocks with 70% of the requests
+// under 512 bytes, 25% up to 4 KB and 5% of 8 to 32 KB, on carve-outs of
+// 512 KB and 256 KB. For the slab allocator and for a model of the page per
+// block allocator it replaced, prints the average number of pages in use,
+// the failed allocations and the time per operation. Then prints the time
+// of an allocation and free of a small block on the fast path.
+//
+
+#include "OpteeClientMemory.c"
+
+#include <stdio.h>
+#include <time.h>
+
+#define BENCH_LIVE_BLOCKS   96
+#define BENCH_OPERATIONS    1000000
+#define BENCH_SAMPLE        64
+#define BENCH_FAST_PAIRS    10000000
+
+KSEMAPHORE OpteeMemLock;
+
+typedef struct _BENCH_RESULT {
+    double AveragePages;
+    ULONG Failures;
+    double NsPerOperation;
+} BENCH_RESULT;
+
+//
+// The allocator before the slabs: every block is a run of whole pages, one
+// page more than the block and header need, and a block whose length with
+// the header is a multiple of the page size frees one page less than it
+// took.
+//
+static RTL_BITMAP g_PageBitMap;
+
+static
+ULONG
+PageAlloc(
+    UINT32 Length,
+    ULONG* Pages
+    )
+{
+    UINT32 ActualLength = Length + sizeof(OPTEE_CLIENT_MEM_HEADER);
+    ULONG NumPages = (ActualLength / PAGE_SIZE) + 1;
+    ULONG Index;
+
+    Index = RtlFindClearBitsAndSet(&g_PageBitMap, NumPages, 0);
+    if (Index == 0xFFFFFFFF) {
+        return Index;
+    }
+    *Pages = ((ActualLength % PAGE_SIZE) != 0) ? NumPages : ActualLength / PAGE_SIZE;
+    return Index;
+}
+
+static unsigned g_Seed;
+
+static
+unsigned
+Random(
+    unsigned Range
+    )
+{
+    g_Seed = g_Seed * 1103515245 + 12345;
+    return (g_Seed >> 8) % Range;
+}
+
+static
+UINT32
+RandomLength()
+{
+    unsigned Kind = Random(100);
+
+    if (Kind < 70) {
+        return 16 + Random(496);
+    }
+    if (Kind < 95) {
+        return 512 + Random(3584);
+    }
+    return 8192 + Random(24 * 1024);
+}
+
+static
+double
+Now()
+{
+    struct timespec Time;
+
+    clock_gettime(CLOCK_MONOTONIC, &Time);
+    return Time.tv_sec * 1e9 + Time.tv_nsec;
+}
+
+static
+BENCH_RESULT
+RunSlab(
+    ULONG ShmPages
+    )
+{
+    PVOID Blocks[BENCH_LIVE_BLOCKS] = { 0 };
+    PHYSICAL_ADDRESS Base;
+    OPTEE_CLIENT_MEM_STATISTICS Statistics;
+    BENCH_RESULT Result = { 0 };
+    double UsedPages = 0;
+    double Start;
+    ULONG Samples = 0;
+    ULONG Operation;
+    ULONG Index;
+
+    Base.QuadPart = 0x80000000;
+    KeInitializeSemaphore(&OpteeMemLock, 1, 1);
+    OpteeClientMemInit(NULL, Base, ShmPages * PAGE_SIZE + OPTEE_SHM_RESERVED_SIZE);
+
+    g_Seed = 1;
+    Start = Now();
+    for (Operation = 0; Operation < BENCH_OPERATIONS; Operation++) {
+        Index = Random(BENCH_LIVE_BLOCKS);
+        g_HostProcessor = Random(g_HostProcessorCount);
+        if (Blocks[Index] != NULL) {
+            OpteeClientMemFree(Blocks[Index]);
+            Blocks[Index] = NULL;
+        } else if (!NT_SUCCESS(OpteeClientMemAlloc(RandomLength(), &Blocks[Index], NULL))) {
+            Result.Failures++;
+        }
+
+        if ((Operation % BENCH_SAMPLE) == 0) {
+            OpteeClientMemGetStatistics(&Statistics);
+            UsedPages += Statistics.TotalPages - Statistics.FreePages;
+            Samples++;
+        }
+    }
+    Result.NsPerOperation = (Now() - Start) / BENCH_OPERATIONS;
+    Result.AveragePages = UsedPages / Samples;
+
+    for (Index = 0; Index < BENCH_LIVE_BLOCKS; Index++) {
+        if (Blocks[Index] != NULL) {
+            OpteeClientMemFree(Blocks[Index]);
+        }
+    }
+    OpteeClientMemDeinit();
+
+    return Result;
+}
+
+static
+BENCH_RESULT
+RunPage(
+    ULONG ShmPages
+    )
+{
+    ULONG Blocks[BENCH_LIVE_BLOCKS];
+    ULONG Pages[BENCH_LIVE_BLOCKS];
+    BENCH_RESULT Result = { 0 };
+    double UsedPages = 0;
+    double Start;
+    ULONG Samples = 0;
+    ULONG Operation;
+    ULONG Index;
+
+    RtlInitializeBitMap(&g_PageBitMap, malloc((ShmPages + 7) / 8), ShmPages);
+    RtlClearAllBits(&g_PageBitMap);
+    for (Index = 0; Index < BENCH_LIVE_BLOCKS; Index++) {
+        Blocks[Index] = 0xFFFFFFFF;
+    }
+
+    g_Seed = 1;
+    Start = Now();
+    for (Operation = 0; Operation < BENCH_OPERATIONS; Operation++) {
+        Index = Random(BENCH_LIVE_BLOCKS);
+        Random(g_HostProcessorCount);
+        if (Blocks[Index] != 0xFFFFFFFF) {
+            RtlClearBits(&g_PageBitMap, Blocks[Index], Pages[Index]);
+            Blocks[Index] = 0xFFFFFFFF;
+        } else {
+            Blocks[Index] = PageAlloc(RandomLength(), &Pages[Index]);
+            if (Blocks[Index] == 0xFFFFFFFF) {
+                Result.Failures++;
+            }
+        }
+
+        if ((Operation % BENCH_SAMPLE) == 0) {
+            UsedPages += ShmPages - RtlNumberOfClearBits(&g_PageBitMap);
+            Samples++;
+        }
+    }
+    Result.NsPerOperation = (Now() - Start) / BENCH_OPERATIONS;
+    Result.AveragePages = UsedPages / Samples;
+
+    free(g_PageBitMap.Buffer);
+
+    return Result;
+}
+
+static
+double
+RunFastPath()
+{
+    PHYSICAL_ADDRESS Base;
+    PVOID Va;
+    double Start;
+    ULONG Pair;
+
+    Base.QuadPart = 0x80000000;
+    KeInitializeSemaphore(&OpteeMemLock, 1, 1);
+    OpteeClientMemInit(NULL, Base, 128 * PAGE_SIZE + OPTEE_SHM_RESERVED_SIZE);
+    g_HostProcessor = 0;
+
+    OpteeClientMemAlloc(64, &Va, NULL);
+    OpteeClientMemFree(Va);
+
+    Start = Now();
+    for (Pair = 0; Pair < BENCH_FAST_PAIRS; Pair++) {
+        OpteeClientMemAlloc(64, &Va, NULL);
+        OpteeClientMemFree(Va);
+    }
+    Start = (Now() - Start) / BENCH_FAST_PAIRS;
+
+    OpteeClientMemDeinit();
+
+    return Start;
+}
+
+int
+main()
+{
+    static const ULONG ShmPages[] = { 128, 64 };
+    ULONG Index;
+
+    printf("%-12s %-8s %12s %10s %10s\n", "carve-out", "alloc", "avg pages", "failures", "ns per op");
+
+    for (Index = 0; Index < sizeof(ShmPages) / sizeof(ShmPages[0]); Index++) {
+        BENCH_RESULT Page = RunPage(ShmPages[Index]);
+        BENCH_RESULT Slab = RunSlab(ShmPages[Index]);
+
+        printf("%4u KB      %-8s %12.1f %10u %10.1f\n", ShmPages[Index] * 4, "page",
+               Page.AveragePages, Page.Failures, Page.NsPerOperation);
+        printf("%4u KB      %-8s %12.1f %10u %10.1f\n", ShmPages[Index] * 4, "slab",
+               Slab.AveragePages, Slab.Failures, Slab.NsPerOperation);
+    }
+
+    printf("small block alloc and free on the fast path: %.1f ns\n", RunFastPath());
+
+    return EXIT_SUCCESS;
+}
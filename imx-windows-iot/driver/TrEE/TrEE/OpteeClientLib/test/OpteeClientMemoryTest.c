@@ -0,0 +1,465 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host unit test of the OP-TEE shared memory allocator
+//
+// Checks the size class of the small blocks, the exact page rounding of the
+// large blocks and their placement at both ends of the carve-out, that the
+// fast path never takes OpteeMemLock, the per processor free lists, the
+// reclaim of the empty slab pages and the statistics. A random workload
+// over several processors then checks against a shadow of the live blocks
+// that no two blocks overlap and that freeing everything gives back the
+// whole carve-out as one block.
+//
+
+#include "OpteeClientMemory.c"
+
+#include "HostTest.h"
+
+#define TEST_SHM_BASE       0x80000000ULL
+#define TEST_SHM_PAGES      128
+#define TEST_LIVE_BLOCKS    96
+#define TEST_ITERATIONS     200000
+
+KSEMAPHORE OpteeMemLock;
+
+typedef struct _TEST_BLOCK {
+    UCHAR* Va;
+    UINT32 Length;
+    UCHAR Fill;
+} TEST_BLOCK;
+
+static unsigned g_Seed = 1;
+
+static
+unsigned
+Random(
+    unsigned Range
+    )
+{
+    g_Seed = g_Seed * 1103515245 + 12345;
+    return (g_Seed >> 8) % Range;
+}
+
+static
+void
+InitShm(
+    ULONG Pages
+    )
+{
+    PHYSICAL_ADDRESS Base;
+
+    Base.QuadPart = TEST_SHM_BASE;
+    KeInitializeSemaphore(&OpteeMemLock, 1, 1);
+    g_HostProcessor = 0;
+    CHECK(OpteeClientMemInit(NULL, Base, (Pages * PAGE_SIZE) + OPTEE_SHM_RESERVED_SIZE) == STATUS_SUCCESS);
+}
+
+static
+OPTEE_CLIENT_MEM_HEADER*
+HeaderOf(
+    PVOID Va
+    )
+{
+    return (OPTEE_CLIENT_MEM_HEADER*)((UCHAR*)Va - sizeof(OPTEE_CLIENT_MEM_HEADER));
+}
+
+static
+ULONG
+PageOf(
+    PVOID Va
+    )
+{
+    return (ULONG)(((UINTN)Va - (UINTN)g_OpteeMemoryHeader.BaseVA) / PAGE_SIZE);
+}
+
+static
+PVOID
+Alloc(
+    UINT32 Length
+    )
+{
+    PVOID Va;
+
+    if (!NT_SUCCESS(OpteeClientMemAlloc(Length, &Va, NULL))) {
+        return NULL;
+    }
+    return Va;
+}
+
+static
+void
+Free(
+    PVOID Va
+    )
+{
+    //
+    // A failed allocation was already reported by its CHECK.
+    //
+    if (Va != NULL) {
+        OpteeClientMemFree(Va);
+    }
+}
+
+static
+void
+TestSizeClasses()
+{
+    static const struct {
+        UINT32 Length;
+        UINT32 BlockLength;
+    } Cases[] = {
+        { 1, 64 }, { 48, 64 }, { 49, 128 }, { 112, 128 }, { 113, 256 },
+        { 240, 256 }, { 241, 512 }, { 496, 512 }, { 497, 1024 },
+        { OPTEE_CLIENT_MEM_SLAB_MAX_SIZE, 1024 },
+        { OPTEE_CLIENT_MEM_SLAB_MAX_SIZE + 1, PAGE_SIZE },
+        { PAGE_SIZE - 16, PAGE_SIZE }, { PAGE_SIZE - 15, 2 * PAGE_SIZE },
+        { 3 * PAGE_SIZE - 16, 3 * PAGE_SIZE },
+    };
+    PVOID Va[sizeof(Cases) / sizeof(Cases[0])];
+    PHYSICAL_ADDRESS Pa;
+    OPTEE_CLIENT_MEM_STATISTICS Statistics;
+    ULONG Index;
+
+    InitShm(TEST_SHM_PAGES);
+
+    for (Index = 0; Index < sizeof(Cases) / sizeof(Cases[0]); Index++) {
+        CHECK(OpteeClientMemAlloc(Cases[Index].Length, &Va[Index], &Pa) == STATUS_SUCCESS);
+        CHECK(HeaderOf(Va[Index])->Length == Cases[Index].BlockLength);
+        CHECK(((UINTN)Va[Index] % MEMORY_ALLOCATION_ALIGNMENT) == 0);
+        CHECK((ULONGLONG)Pa.QuadPart == OpteeClientVirtualToPhysical(Va[Index]));
+        CHECK((ULONGLONG)Pa.QuadPart ==
+              TEST_SHM_BASE + OPTEE_SHM_RESERVED_SIZE + ((UCHAR*)Va[Index] - (UCHAR*)g_OpteeMemoryHeader.BaseVA));
+        CHECK(OpteeClientPhysicalToVirtual(Pa.QuadPart) == Va[Index]);
+
+        //
+        // Slab chunks never start a page, large blocks always do and come
+        // from the bottom of the carve-out, slab pages from the top.
+        //
+        if (Cases[Index].BlockLength <= 1024) {
+            CHECK(((UINTN)HeaderOf(Va[Index]) % PAGE_SIZE) != 0);
+            CHECK(PageOf(Va[Index]) >= TEST_SHM_PAGES - OPTEE_CLIENT_MEM_SLAB_CLASS_COUNT);
+        } else {
+            CHECK(((UINTN)HeaderOf(Va[Index]) % PAGE_SIZE) == 0);
+            CHECK(PageOf(Va[Index]) < 6);
+        }
+        memset(Va[Index], 0xA5, Cases[Index].Length);
+    }
+
+    OpteeClientMemGetStatistics(&Statistics);
+    CHECK(Statistics.TotalPages == TEST_SHM_PAGES);
+    CHECK(Statistics.SlabPages == OPTEE_CLIENT_MEM_SLAB_CLASS_COUNT);
+    CHECK(Statistics.LargeAllocations == 4);
+    CHECK(Statistics.FreePages == TEST_SHM_PAGES - OPTEE_CLIENT_MEM_SLAB_CLASS_COUNT - 7);
+    CHECK(Statistics.FragmentationPercent == 0);
+    CHECK(Statistics.Slab[0].ChunksInUse == 2);
+    CHECK(Statistics.Slab[0].ChunksPerPage == (PAGE_SIZE - OPTEE_SLAB_PAGE_HEADER_SIZE) / 64);
+    CHECK(Statistics.Slab[4].ChunksInUse == 2);
+    CHECK(Statistics.Slab[4].ChunksPerPage == 3);
+
+    for (Index = 0; Index < sizeof(Cases) / sizeof(Cases[0]); Index++) {
+        Free(Va[Index]);
+    }
+
+    OpteeClientMemGetStatistics(&Statistics);
+    CHECK(Statistics.FreePages == TEST_SHM_PAGES - OPTEE_CLIENT_MEM_SLAB_CLASS_COUNT);
+    CHECK(Statistics.SlabOccupancyPercent == 0);
+
+    //
+    // Too large and unmapped requests.
+    //
+    CHECK(OpteeClientMemAlloc(TEST_SHM_PAGES * PAGE_SIZE + 1, &Va[0], NULL) == STATUS_INSUFFICIENT_RESOURCES);
+    CHECK(Va[0] == NULL);
+    CHECK(OpteeClientMemAlloc(TEST_SHM_PAGES * PAGE_SIZE, &Va[0], NULL) == STATUS_INSUFFICIENT_RESOURCES);
+
+    OpteeClientMemDeinit();
+
+    CHECK(OpteeClientMemAlloc(64, &Va[0], NULL) == STATUS_MEMORY_NOT_ALLOCATED);
+}
+
+static
+void
+TestFastPath()
+{
+    ULONG ChunksPerPage = (PAGE_SIZE - OPTEE_SLAB_PAGE_HEADER_SIZE) / 128;
+    PVOID Va[64];
+    PVOID Stolen;
+    ULONG Waits;
+    ULONG Index;
+    OPTEE_CLIENT_MEM_STATISTICS Statistics;
+
+    InitShm(TEST_SHM_PAGES);
+
+    //
+    // The first allocation of a class carves a page under the lock, the
+    // other chunks of that page need no lock, on allocation or on free.
+    //
+    Waits = g_HostSemaphoreWaits;
+    Va[0] = Alloc(100);
+    CHECK(g_HostSemaphoreWaits == Waits + 1);
+
+    for (Index = 1; Index < ChunksPerPage; Index++) {
+        Va[Index] = Alloc(100);
+        CHECK(Va[Index] == (UCHAR*)Va[Index - 1] + 128);
+        CHECK(PageOf(Va[Index]) == PageOf(Va[0]));
+    }
+    CHECK(g_HostSemaphoreWaits == Waits + 1);
+
+    for (Index = 0; Index < ChunksPerPage; Index++) {
+        Free(Va[Index]);
+    }
+    CHECK(g_HostSemaphoreWaits == Waits + 1);
+    CHECK(OpteeMemLock.Count == 1);
+
+    //
+    // A chunk freed on another processor goes to its list and is handed out
+    // again there first.
+    //
+    g_HostProcessor = 0;
+    Va[0] = Alloc(100);
+    g_HostProcessor = 2;
+    Free(Va[0]);
+    CHECK(Alloc(100) == Va[0]);
+    CHECK(g_OpteeSlab.Cpu[2].FastAllocations[1] == 1);
+
+    //
+    // A processor with an empty list takes a chunk of another processor
+    // before it carves a new page.
+    //
+    g_HostProcessor = 3;
+    Stolen = Alloc(100);
+    CHECK(Stolen != NULL);
+    CHECK(PageOf(Stolen) == PageOf(Va[0]));
+    CHECK(g_OpteeSlab.Class[1].Refills == 1);
+    CHECK(g_OpteeSlab.Cpu[3].FastAllocations[1] == 0);
+    CHECK(g_HostSemaphoreWaits == Waits + 1);
+
+    //
+    // Large blocks always take the lock.
+    //
+    Va[1] = Alloc(2000);
+    Free(Va[1]);
+    CHECK(g_HostSemaphoreWaits == Waits + 3);
+
+    Free(Va[0]);
+    Free(Stolen);
+
+    OpteeClientMemGetStatistics(&Statistics);
+    CHECK(Statistics.Slab[1].Allocations == ChunksPerPage + 3);
+    CHECK(Statistics.Slab[1].FastAllocations == ChunksPerPage + 1);
+    CHECK(Statistics.Slab[1].ChunksInUse == 0);
+    CHECK(Statistics.Slab[1].Pages == 1);
+    CHECK(Statistics.Slab[1].Refills == 1);
+
+    OpteeClientMemDeinit();
+}
+
+static
+void
+TestReclaim()
+{
+    ULONG ChunksPerPage = (PAGE_SIZE - OPTEE_SLAB_PAGE_HEADER_SIZE) / 64;
+    ULONG Count = TEST_SHM_PAGES * ChunksPerPage;
+    PVOID* Va = malloc(Count * sizeof(PVOID));
+    PVOID Kept;
+    PVOID Large;
+    ULONG Index;
+    UINT64 Reclaims;
+    OPTEE_CLIENT_MEM_STATISTICS Statistics;
+
+    InitShm(TEST_SHM_PAGES);
+
+    //
+    // Fill the whole carve-out with 64 byte chunks, spread over the
+    // processors, the next allocation of any size fails.
+    //
+    for (Index = 0; Index < Count; Index++) {
+        g_HostProcessor = Index % g_HostProcessorCount;
+        Va[Index] = Alloc(32);
+        CHECK(Va[Index] != NULL);
+    }
+    CHECK(Alloc(32) == NULL);
+    CHECK(Alloc(200) == NULL);
+    CHECK(Alloc(5000) == NULL);
+
+    OpteeClientMemGetStatistics(&Statistics);
+    CHECK(Statistics.FreePages == 0);
+    CHECK(Statistics.SlabPages == TEST_SHM_PAGES);
+    CHECK(Statistics.SlabOccupancyPercent == 100);
+    CHECK(Statistics.Slab[0].Failures == 1);
+    CHECK(Statistics.Slab[2].Failures == 1);
+    CHECK(Statistics.LargeFailures == 1);
+
+    //
+    // Free everything but one chunk, freed on other processors than the
+    // ones they were allocated on. The page of the kept chunk, the last one
+    // carved at the bottom of the carve-out, stays with the slab. The other
+    // pages go back to the bitmap for a large block.
+    //
+    Reclaims = Statistics.Reclaims;
+    Kept = Va[Count - 1];
+    CHECK(PageOf(Kept) == 0);
+    for (Index = 0; Index < Count; Index++) {
+        if (Va[Index] != Kept) {
+            g_HostProcessor = (Index + 1) % g_HostProcessorCount;
+            Free(Va[Index]);
+        }
+    }
+
+    Large = Alloc((TEST_SHM_PAGES - 1) * PAGE_SIZE - sizeof(OPTEE_CLIENT_MEM_HEADER));
+    CHECK(Large != NULL);
+    CHECK(PageOf(Large) == 1);
+
+    OpteeClientMemGetStatistics(&Statistics);
+    CHECK(Statistics.Reclaims == Reclaims + 1);
+    CHECK(Statistics.ReclaimedPages == TEST_SHM_PAGES - 1);
+    CHECK(Statistics.Slab[0].Pages == 1);
+    CHECK(Statistics.Slab[0].ChunksInUse == 1);
+    CHECK(Statistics.FreePages == 0);
+
+    //
+    // The free chunks of the kept page were put back and are still usable.
+    //
+    for (Index = 0; Index < ChunksPerPage - 1; Index++) {
+        Va[Index] = Alloc(16);
+        CHECK(Va[Index] != NULL);
+        CHECK(PageOf(Va[Index]) == PageOf(Kept));
+    }
+    CHECK(Alloc(16) == NULL);
+    for (Index = 0; Index < ChunksPerPage - 1; Index++) {
+        Free(Va[Index]);
+    }
+    Free(Kept);
+    Free(Large);
+
+    //
+    // Everything free, the whole carve-out is one block again.
+    //
+    Large = Alloc(TEST_SHM_PAGES * PAGE_SIZE - sizeof(OPTEE_CLIENT_MEM_HEADER));
+    CHECK(Large != NULL);
+    Free(Large);
+
+    OpteeClientMemGetStatistics(&Statistics);
+    CHECK(Statistics.FreePages == TEST_SHM_PAGES);
+    CHECK(Statistics.LargestFreeRun == TEST_SHM_PAGES);
+    CHECK(Statistics.SlabPages == 0);
+    CHECK(OpteeMemLock.Count == 1);
+
+    OpteeClientMemDeinit();
+    free(Va);
+}
+
+static
+UINT32
+RandomLength()
+{
+    unsigned Kind = Random(100);
+
+    if (Kind < 70) {
+        return 1 + Random(512);
+    }
+    if (Kind < 95) {
+        return 512 + Random(4096);
+    }
+    return 8192 + Random(24 * 1024);
+}
+
+static
+void
+TestRandom()
+{
+    TEST_BLOCK Blocks[TEST_LIVE_BLOCKS] = { { 0 } };
+    ULONG Iteration;
+    ULONG Index;
+    ULONG Other;
+    ULONG Failures = 0;
+    UINT32 Offset;
+    PVOID Large;
+    OPTEE_CLIENT_MEM_STATISTICS Statistics;
+
+    InitShm(TEST_SHM_PAGES);
+
+    for (Iteration = 0; Iteration < TEST_ITERATIONS; Iteration++) {
+        TEST_BLOCK* Block = &Blocks[Random(TEST_LIVE_BLOCKS)];
+
+        g_HostProcessor = Random(g_HostProcessorCount);
+
+        if (Block->Va != NULL) {
+            //
+            // The block must still hold its pattern, nothing else wrote it.
+            //
+            for (Offset = 0; Offset < Block->Length; Offset++) {
+                if (Block->Va[Offset] != Block->Fill) {
+                    CHECK(Block->Va[Offset] == Block->Fill);
+                    break;
+                }
+            }
+            OpteeClientMemFree(Block->Va);
+            Block->Va = NULL;
+            continue;
+        }
+
+        Block->Length = RandomLength();
+        Block->Va = Alloc(Block->Length);
+        if (Block->Va == NULL) {
+            Failures++;
+            continue;
+        }
+
+        CHECK((UCHAR*)Block->Va >= (UCHAR*)g_OpteeMemoryHeader.BaseVA);
+        CHECK((UCHAR*)Block->Va + Block->Length <=
+              (UCHAR*)g_OpteeMemoryHeader.BaseVA + g_OpteeMemoryHeader.Length);
+        CHECK(HeaderOf(Block->Va)->Length >= Block->Length + sizeof(OPTEE_CLIENT_MEM_HEADER));
+
+        //
+        // Sampled overlap check against the other live blocks.
+        //
+        if ((Iteration % 16) == 0) {
+            for (Other = 0; Other < TEST_LIVE_BLOCKS; Other++) {
+                if ((&Blocks[Other] != Block) && (Blocks[Other].Va != NULL)) {
+                    CHECK((Blocks[Other].Va + Blocks[Other].Length <= Block->Va) ||
+                          (Block->Va + Block->Length <= Blocks[Other].Va));
+                }
+            }
+        }
+
+        Block->Fill = (UCHAR)(1 + Random(255));
+        memset(Block->Va, Block->Fill, Block->Length);
+    }
+
+    //
+    // 96 live blocks averaging well under 128 pages fit, the few failures
+    // are large blocks that found no free run.
+    //
+    OpteeClientMemGetStatistics(&Statistics);
+    CHECK(Failures < TEST_ITERATIONS / 100);
+    for (Index = 0; Index < OPTEE_CLIENT_MEM_SLAB_CLASS_COUNT; Index++) {
+        CHECK(Statistics.Slab[Index].Failures == 0);
+    }
+
+    for (Index = 0; Index < TEST_LIVE_BLOCKS; Index++) {
+        if (Blocks[Index].Va != NULL) {
+            g_HostProcessor = Index % g_HostProcessorCount;
+            OpteeClientMemFree(Blocks[Index].Va);
+        }
+    }
+
+    Large = Alloc(TEST_SHM_PAGES * PAGE_SIZE - sizeof(OPTEE_CLIENT_MEM_HEADER));
+    CHECK(Large != NULL);
+    Free(Large);
+    CHECK(OpteeMemLock.Count == 1);
+
+    OpteeClientMemDeinit();
+}
+
+int
+main()
+{
+    TestSizeClasses();
+    TestFastPath();
+    TestReclaim();
+    TestRandom();
+
+    return HostTestResult("OpteeClientMemoryTest");
+}
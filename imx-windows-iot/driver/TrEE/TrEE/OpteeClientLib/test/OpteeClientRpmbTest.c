@@ -0,0 +1,911 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host unit test of the RPMB data path against an emulated device
+//
+// The device implements the JEDEC eMMC RPMB partition: the authentication
+// key, the HMAC-SHA256 MAC over all the frames of a request or response,
+// the write counter, the reliable write limit and the address range. The
+// test plays the part of OP-TEE. It builds the RPC requests with their
+// MACs, sends them through OpteeClientRpmbDataRequest and checks the MACs,
+// nonces and results of the responses.
+//
+// Covered: device information and its cache, the clamp of the reliable
+// write count, key programming, packed writes read back, rejection of a
+// tampered MAC, of a replayed or stale write counter, of an over-limit
+// write and of a write beyond the partition, the parameter checks, the
+// reuse of the frame buffers without allocation during I/O and the
+// statistics.
+//
+
+#include "OpteeClientRpmb.c"
+
+#include "HostTest.h"
+
+#define TEST_RPMB_SIZE_MULT         2
+#define TEST_RPMB_BLOCKS            (TEST_RPMB_SIZE_MULT * 128 * 1024 / 256)
+#define TEST_RPMB_REL_WR_BYTES      (16 * 512)
+#define TEST_RPMB_REL_WR_BLOCKS     (TEST_RPMB_REL_WR_BYTES / 256)
+#define TEST_MAX_FRAMES             600
+
+#define RPMB_REQ_PROGRAM_KEY        0x0001
+#define RPMB_REQ_WRITE_COUNTER      0x0002
+#define RPMB_REQ_DATA_WRITE         0x0003
+#define RPMB_REQ_DATA_READ          0x0004
+#define RPMB_RESP_PROGRAM_KEY       0x0100
+#define RPMB_RESP_WRITE_COUNTER     0x0200
+#define RPMB_RESP_DATA_WRITE        0x0300
+#define RPMB_RESP_DATA_READ         0x0400
+
+#define RPMB_RESULT_OK              0x0000
+#define RPMB_RESULT_GENERAL_FAILURE 0x0001
+#define RPMB_RESULT_AUTH_FAILURE    0x0002
+#define RPMB_RESULT_COUNTER_FAILURE 0x0003
+#define RPMB_RESULT_ADDRESS_FAILURE 0x0004
+#define RPMB_RESULT_WRITE_FAILURE   0x0005
+#define RPMB_RESULT_NO_AUTH_KEY     0x0007
+
+#define FIELD_OFFSET(type, field)   ((ULONG)offsetof(type, field))
+
+//
+// The MAC covers bytes 228 to 511 of each frame, from Data to the end.
+//
+#define RPMB_MAC_OFFSET             FIELD_OFFSET(SFFDISK_DEVICE_RPMB_DATA_FRAME, Data)
+#define RPMB_MAC_LENGTH             (sizeof(SFFDISK_DEVICE_RPMB_DATA_FRAME) - RPMB_MAC_OFFSET)
+
+const GUID GUID_DEVINTERFACE_EMMC_PARTITION_ACCESS_RPMB =
+    { 0x27bc9e5a, 0x4fea, 0x4d3a, { 0x8a, 0x1b, 0x68, 0x74, 0x48, 0x4b, 0x8a, 0xa5 } };
+
+//
+// SHA-256 (FIPS 180-4)
+//
+
+typedef struct _SHA256 {
+    UINT32 State[8];
+    UINT8 Block[64];
+    UINT64 Length;
+} SHA256;
+
+static const UINT32 Sha256K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static
+void
+Sha256Compress(
+    SHA256* Sha,
+    const UINT8* Block
+    )
+{
+    UINT32 W[64];
+    UINT32 V[8];
+    UINT32 T1;
+    UINT32 T2;
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        W[i] = ((UINT32)Block[4 * i] << 24) | ((UINT32)Block[4 * i + 1] << 16) |
+               ((UINT32)Block[4 * i + 2] << 8) | Block[4 * i + 3];
+    }
+    for (i = 16; i < 64; i++) {
+        W[i] = W[i - 16] + (ROR32(W[i - 15], 7) ^ ROR32(W[i - 15], 18) ^ (W[i - 15] >> 3)) +
+               W[i - 7] + (ROR32(W[i - 2], 17) ^ ROR32(W[i - 2], 19) ^ (W[i - 2] >> 10));
+    }
+
+    memcpy(V, Sha->State, sizeof(V));
+    for (i = 0; i < 64; i++) {
+        T1 = V[7] + (ROR32(V[4], 6) ^ ROR32(V[4], 11) ^ ROR32(V[4], 25)) +
+             ((V[4] & V[5]) ^ (~V[4] & V[6])) + Sha256K[i] + W[i];
+        T2 = (ROR32(V[0], 2) ^ ROR32(V[0], 13) ^ ROR32(V[0], 22)) +
+             ((V[0] & V[1]) ^ (V[0] & V[2]) ^ (V[1] & V[2]));
+        memmove(&V[1], &V[0], 7 * sizeof(UINT32));
+        V[4] += T1;
+        V[0] = T1 + T2;
+    }
+    for (i = 0; i < 8; i++) {
+        Sha->State[i] += V[i];
+    }
+}
+
+static
+void
+Sha256Init(
+    SHA256* Sha
+    )
+{
+    static const UINT32 Initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+
+    memcpy(Sha->State, Initial, sizeof(Initial));
+    Sha->Length = 0;
+}
+
+static
+void
+Sha256Update(
+    SHA256* Sha,
+    const void* Data,
+    SIZE_T Length
+    )
+{
+    const UINT8* Bytes = Data;
+
+    while (Length-- != 0) {
+        Sha->Block[Sha->Length++ % 64] = *Bytes++;
+        if ((Sha->Length % 64) == 0) {
+            Sha256Compress(Sha, Sha->Block);
+        }
+    }
+}
+
+static
+void
+Sha256Final(
+    SHA256* Sha,
+    UINT8 Digest[32]
+    )
+{
+    UINT64 Bits = Sha->Length * 8;
+    UINT8 Pad = 0x80;
+    int i;
+
+    Sha256Update(Sha, &Pad, 1);
+    Pad = 0;
+    while ((Sha->Length % 64) != 56) {
+        Sha256Update(Sha, &Pad, 1);
+    }
+    for (i = 7; i >= 0; i--) {
+        Pad = (UINT8)(Bits >> (8 * i));
+        Sha256Update(Sha, &Pad, 1);
+    }
+    for (i = 0; i < 32; i++) {
+        Digest[i] = (UINT8)(Sha->State[i / 4] >> (24 - 8 * (i % 4)));
+    }
+}
+
+//
+// Frame helpers
+//
+
+static
+UINT16
+Get16(
+    const UCHAR* Field
+    )
+{
+    return (UINT16)((Field[0] << 8) | Field[1]);
+}
+
+static
+void
+Put16(
+    UCHAR* Field,
+    UINT16 Value
+    )
+{
+    Field[0] = (UCHAR)(Value >> 8);
+    Field[1] = (UCHAR)Value;
+}
+
+static
+UINT32
+Get32(
+    const UCHAR* Field
+    )
+{
+    return ((UINT32)Field[0] << 24) | ((UINT32)Field[1] << 16) | ((UINT32)Field[2] << 8) | Field[3];
+}
+
+static
+void
+Put32(
+    UCHAR* Field,
+    UINT32 Value
+    )
+{
+    Field[0] = (UCHAR)(Value >> 24);
+    Field[1] = (UCHAR)(Value >> 16);
+    Field[2] = (UCHAR)(Value >> 8);
+    Field[3] = (UCHAR)Value;
+}
+
+static
+void
+FramesMac(
+    const UINT8 Key[32],
+    const SFFDISK_DEVICE_RPMB_DATA_FRAME* Frames,
+    ULONG Count,
+    UINT8 Mac[32]
+    )
+{
+    SHA256 Sha;
+    UINT8 Pad[64];
+    UINT8 Inner[32];
+    ULONG Frame;
+    int i;
+
+    //
+    // HMAC-SHA256 (RFC 2104) over the MAC ranges of the frames.
+    //
+    for (i = 0; i < 64; i++) {
+        Pad[i] = (UINT8)(((i < 32) ? Key[i] : 0) ^ 0x36);
+    }
+    Sha256Init(&Sha);
+    Sha256Update(&Sha, Pad, sizeof(Pad));
+    for (Frame = 0; Frame < Count; Frame++) {
+        Sha256Update(&Sha, (const UCHAR*)&Frames[Frame] + RPMB_MAC_OFFSET, RPMB_MAC_LENGTH);
+    }
+    Sha256Final(&Sha, Inner);
+
+    for (i = 0; i < 64; i++) {
+        Pad[i] = (UINT8)(((i < 32) ? Key[i] : 0) ^ 0x5C);
+    }
+    Sha256Init(&Sha);
+    Sha256Update(&Sha, Pad, sizeof(Pad));
+    Sha256Update(&Sha, Inner, sizeof(Inner));
+    Sha256Final(&Sha, Mac);
+}
+
+//
+// Emulated RPMB device
+//
+
+typedef struct _TEST_RPMB_DEVICE {
+    UINT8 Key[32];
+    BOOLEAN KeyProgrammed;
+    UINT32 WriteCounter;
+    UINT8 Blocks[TEST_RPMB_BLOCKS][256];
+    ULONG MaxReliableWriteSizeInBytes;
+    ULONG Calls;
+} TEST_RPMB_DEVICE;
+
+static TEST_RPMB_DEVICE g_Device;
+
+static
+UINT16
+DeviceWrite(
+    const SFFDISK_DEVICE_RPMB_DATA_FRAME* Frames,
+    ULONG Count
+    )
+{
+    UINT8 Mac[32];
+    UINT16 Address = Get16(Frames[0].Address);
+    ULONG Frame;
+
+    if (!g_Device.KeyProgrammed) {
+        return RPMB_RESULT_NO_AUTH_KEY;
+    }
+
+    for (Frame = 0; Frame < Count; Frame++) {
+        if ((Get16(Frames[Frame].RequestOrResponseType) != RPMB_REQ_DATA_WRITE) ||
+            (Get16(Frames[Frame].BlockCount) != Count)) {
+            return RPMB_RESULT_GENERAL_FAILURE;
+        }
+    }
+
+    if (Count > g_Device.MaxReliableWriteSizeInBytes / 256) {
+        return RPMB_RESULT_GENERAL_FAILURE;
+    }
+
+    FramesMac(g_Device.Key, Frames, Count, Mac);
+    if (memcmp(Mac, Frames[Count - 1].KeyOrMAC, sizeof(Mac)) != 0) {
+        return RPMB_RESULT_AUTH_FAILURE;
+    }
+
+    if (Get32(Frames[0].WriteCounter) != g_Device.WriteCounter) {
+        return RPMB_RESULT_COUNTER_FAILURE;
+    }
+
+    if ((ULONG)Address + Count > TEST_RPMB_BLOCKS) {
+        return RPMB_RESULT_ADDRESS_FAILURE;
+    }
+
+    for (Frame = 0; Frame < Count; Frame++) {
+        memcpy(g_Device.Blocks[Address + Frame], Frames[Frame].Data, 256);
+    }
+    g_Device.WriteCounter++;
+
+    return RPMB_RESULT_OK;
+}
+
+NTSTATUS
+TrSecureDeviceCallOSService(
+    WDFDEVICE Device,
+    const GUID* ServiceGuid,
+    PTR_SERVICE_REQUEST Request,
+    ULONG_PTR* BytesWritten
+    )
+{
+    SFFDISK_DEVICE_PARTITION_ACCESS_DATA* Data = Request->InputBuffer;
+    SFFDISK_DEVICE_RPMB_DATA_FRAME* Frame;
+    SFFDISK_DEVICE_RPMB_DATA_FRAME* Result;
+    UINT16 ResultCode = RPMB_RESULT_OK;
+    ULONG Count;
+    ULONG Index;
+    UINT16 Address;
+
+    UNREFERENCED_PARAMETER(Device);
+
+    g_Device.Calls++;
+    CHECK(memcmp(ServiceGuid, &GUID_DEVINTERFACE_EMMC_PARTITION_ACCESS_RPMB, sizeof(GUID)) == 0);
+    CHECK(Request->FunctionCode == TREE_RPMB_SFFDISK_PARTITION_ACCESS);
+    CHECK(Request->OutputBuffer == Request->InputBuffer);
+    CHECK(Data->Size == sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA));
+    CHECK(Request->InputBufferSize >= sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA));
+    CHECK(Request->OutputBufferSize >= sizeof(SFFDISK_DEVICE_PARTITION_ACCESS_DATA));
+    *BytesWritten = Request->OutputBufferSize;
+
+    switch (Data->Command) {
+    case SFFDISK_RPMB_IS_SUPPORTED:
+        Data->Parameters.RpmbIsSupported.SizeInBytes = TEST_RPMB_SIZE_MULT * 128 * 1024;
+        Data->Parameters.RpmbIsSupported.MaxReliableWriteSizeInBytes = g_Device.MaxReliableWriteSizeInBytes;
+        return STATUS_SUCCESS;
+
+    case SFFDISK_RPMB_PROGRAM_AUTH_KEY:
+        Frame = &Data->Parameters.RpmbProgramAuthKey.ProgramAuthKeyFrame;
+        Result = &Data->Parameters.RpmbProgramAuthKey.ResultFrame;
+        CHECK(Get16(Frame->RequestOrResponseType) == RPMB_REQ_PROGRAM_KEY);
+        if (g_Device.KeyProgrammed) {
+            ResultCode = RPMB_RESULT_WRITE_FAILURE;
+        } else {
+            memcpy(g_Device.Key, Frame->KeyOrMAC, sizeof(g_Device.Key));
+            g_Device.KeyProgrammed = TRUE;
+        }
+        memset(Result, 0, sizeof(*Result));
+        Put16(Result->OperationResult, ResultCode);
+        Put16(Result->RequestOrResponseType, RPMB_RESP_PROGRAM_KEY);
+        return STATUS_SUCCESS;
+
+    case SFFDISK_RPMB_QUERY_WRITE_COUNTER:
+        Frame = &Data->Parameters.RpmbQueryWriteCounter.QueryWriteCounterFrame;
+        Result = &Data->Parameters.RpmbQueryWriteCounter.ResultFrame;
+        CHECK(Get16(Frame->RequestOrResponseType) == RPMB_REQ_WRITE_COUNTER);
+        memcpy(Result->Nonce, Frame->Nonce, sizeof(Result->Nonce));
+        memset(Result, 0, RPMB_MAC_OFFSET);
+        memset(Result->Data, 0, sizeof(Result->Data));
+        Put32(Result->WriteCounter, g_Device.WriteCounter);
+        Put16(Result->Address, 0);
+        Put16(Result->BlockCount, 0);
+        Put16(Result->OperationResult, g_Device.KeyProgrammed ? RPMB_RESULT_OK : RPMB_RESULT_NO_AUTH_KEY);
+        Put16(Result->RequestOrResponseType, RPMB_RESP_WRITE_COUNTER);
+        FramesMac(g_Device.Key, Result, 1, Result->KeyOrMAC);
+        return STATUS_SUCCESS;
+
+    case SFFDISK_RPMB_AUTHENTICATED_WRITE:
+        Count = Data->Parameters.RpmbAuthenticatedWrite.CountToWrite;
+        CHECK(Request->InputBufferSize >= OPTEE_RPMB_ACCESS_DATA_SIZE(Count));
+        Frame = Data->Parameters.RpmbAuthenticatedWrite.FrameDataToWrite;
+        Result = &Data->Parameters.RpmbAuthenticatedWrite.ResultFrame;
+        ResultCode = DeviceWrite(Frame, Count);
+        Address = Get16(Frame[0].Address);
+        memset(Result, 0, sizeof(*Result));
+        Put32(Result->WriteCounter, g_Device.WriteCounter);
+        Put16(Result->Address, Address);
+        Put16(Result->OperationResult, ResultCode);
+        Put16(Result->RequestOrResponseType, RPMB_RESP_DATA_WRITE);
+        FramesMac(g_Device.Key, Result, 1, Result->KeyOrMAC);
+        return STATUS_SUCCESS;
+
+    case SFFDISK_RPMB_AUTHENTICATED_READ:
+        Count = Data->Parameters.RpmbAuthenticatedRead.CountToRead;
+        CHECK(Request->OutputBufferSize >= OPTEE_RPMB_ACCESS_DATA_SIZE(Count));
+        CHECK(Request->InputBufferSize == Request->OutputBufferSize);
+        Frame = &Data->Parameters.RpmbAuthenticatedRead.AuthenticatedReadFrame;
+        Result = Data->Parameters.RpmbAuthenticatedRead.ReturnedFrameData;
+        CHECK(Get16(Frame->RequestOrResponseType) == RPMB_REQ_DATA_READ);
+        Address = Get16(Frame->Address);
+        if ((ULONG)Address + Count > TEST_RPMB_BLOCKS) {
+            ResultCode = RPMB_RESULT_ADDRESS_FAILURE;
+        }
+        for (Index = 0; Index < Count; Index++) {
+            memset(&Result[Index], 0, sizeof(Result[Index]));
+            if (ResultCode == RPMB_RESULT_OK) {
+                memcpy(Result[Index].Data, g_Device.Blocks[Address + Index], 256);
+            }
+            memcpy(Result[Index].Nonce, Frame->Nonce, sizeof(Frame->Nonce));
+            Put16(Result[Index].Address, Address);
+            Put16(Result[Index].BlockCount, (UINT16)Count);
+            Put16(Result[Index].OperationResult, ResultCode);
+            Put16(Result[Index].RequestOrResponseType, RPMB_RESP_DATA_READ);
+        }
+        FramesMac(g_Device.Key, Result, Count, Result[Count - 1].KeyOrMAC);
+        return STATUS_SUCCESS;
+
+    default:
+        CHECK(FALSE);
+        return STATUS_INVALID_PARAMETER;
+    }
+}
+
+//
+// Secure world side
+//
+
+static UINT8 g_Key[32];
+static UINT32 g_Nonce;
+
+static
+union {
+    tee_rpc_rpmb_cmd_t Command;
+    UCHAR Bytes[sizeof(tee_rpc_rpmb_cmd_t) + TEST_MAX_FRAMES * sizeof(SFFDISK_DEVICE_RPMB_DATA_FRAME)];
+} g_Request;
+
+static SFFDISK_DEVICE_RPMB_DATA_FRAME g_Response[TEST_MAX_FRAMES];
+
+static
+SFFDISK_DEVICE_RPMB_DATA_FRAME*
+RequestFrames()
+{
+    return (SFFDISK_DEVICE_RPMB_DATA_FRAME*)(&g_Request.Command + 1);
+}
+
+static
+SIZE_T
+RequestSize(
+    ULONG Frames
+    )
+{
+    return sizeof(tee_rpc_rpmb_cmd_t) + Frames * sizeof(SFFDISK_DEVICE_RPMB_DATA_FRAME);
+}
+
+static
+TEEC_Result
+Send(
+    ULONG Frames,
+    ULONG ResponseFrames
+    )
+{
+    g_Request.Command.cmd = TEE_RPC_RPMB_CMD_DATA_REQ;
+    g_Request.Command.dev_id = 0;
+    memset(g_Response, 0xEE, ResponseFrames * sizeof(g_Response[0]));
+    return OpteeClientRpmbDataRequest(NULL,
+                                      NULL,
+                                      &g_Request.Command,
+                                      RequestSize(Frames),
+                                      g_Response,
+                                      ResponseFrames * sizeof(g_Response[0]));
+}
+
+static
+BOOLEAN
+ResponseMacValid(
+    ULONG Frames
+    )
+{
+    UINT8 Mac[32];
+
+    FramesMac(g_Key, g_Response, Frames, Mac);
+    return memcmp(Mac, g_Response[Frames - 1].KeyOrMAC, sizeof(Mac)) == 0;
+}
+
+static
+UINT32
+ReadCounter()
+{
+    SFFDISK_DEVICE_RPMB_DATA_FRAME* Frame = RequestFrames();
+
+    memset(Frame, 0, sizeof(*Frame));
+    Put32(Frame->Nonce, ++g_Nonce);
+    Put16(Frame->RequestOrResponseType, RPMB_REQ_WRITE_COUNTER);
+    g_Request.Command.block_count = 0;
+
+    CHECK(Send(1, 1) == TEEC_SUCCESS);
+    CHECK(Get16(g_Response[0].RequestOrResponseType) == RPMB_RESP_WRITE_COUNTER);
+    CHECK(Get16(g_Response[0].OperationResult) == RPMB_RESULT_OK);
+    CHECK(Get32(g_Response[0].Nonce) == g_Nonce);
+    CHECK(ResponseMacValid(1));
+
+    return Get32(g_Response[0].WriteCounter);
+}
+
+static
+UCHAR
+BlockFill(
+    UINT16 Address,
+    UINT32 Counter,
+    ULONG Byte
+    )
+{
+    return (UCHAR)(Address * 7 + Counter * 13 + Byte);
+}
+
+//
+// Build an authenticated write of Count blocks at Address, MAC in the
+// last frame.
+//
+static
+void
+BuildWrite(
+    UINT16 Address,
+    ULONG Count,
+    UINT32 Counter
+    )
+{
+    SFFDISK_DEVICE_RPMB_DATA_FRAME* Frames = RequestFrames();
+    ULONG Frame;
+    ULONG Byte;
+
+    for (Frame = 0; Frame < Count; Frame++) {
+        memset(&Frames[Frame], 0, sizeof(Frames[Frame]));
+        for (Byte = 0; Byte < 256; Byte++) {
+            Frames[Frame].Data[Byte] = BlockFill((UINT16)(Address + Frame), Counter, Byte);
+        }
+        Put32(Frames[Frame].WriteCounter, Counter);
+        Put16(Frames[Frame].Address, Address);
+        Put16(Frames[Frame].BlockCount, (UINT16)Count);
+        Put16(Frames[Frame].RequestOrResponseType, RPMB_REQ_DATA_WRITE);
+    }
+    FramesMac(g_Key, Frames, Count, Frames[Count - 1].KeyOrMAC);
+    g_Request.Command.block_count = (uint16_t)Count;
+}
+
+static
+UINT16
+SendWrite(
+    ULONG Count
+    )
+{
+    UINT16 Address = Get16(RequestFrames()->Address);
+
+    CHECK(Send(Count, 1) == TEEC_SUCCESS);
+    CHECK(Get16(g_Response[0].RequestOrResponseType) == RPMB_RESP_DATA_WRITE);
+    CHECK(Get16(g_Response[0].Address) == Address);
+    CHECK(ResponseMacValid(1));
+
+    return Get16(g_Response[0].OperationResult);
+}
+
+//
+// Read Count blocks at Address and check the MAC, the nonce and that the
+// blocks hold the data of the write made with Counter.
+//
+static
+BOOLEAN
+ReadAndCheck(
+    UINT16 Address,
+    ULONG Count,
+    UINT32 Counter
+    )
+{
+    SFFDISK_DEVICE_RPMB_DATA_FRAME* Frame = RequestFrames();
+    BOOLEAN Match = TRUE;
+    ULONG Index;
+    ULONG Byte;
+
+    memset(Frame, 0, sizeof(*Frame));
+    Put32(Frame->Nonce, ++g_Nonce);
+    Put16(Frame->Address, Address);
+    Put16(Frame->RequestOrResponseType, RPMB_REQ_DATA_READ);
+    g_Request.Command.block_count = (uint16_t)Count;
+
+    CHECK(Send(1, Count) == TEEC_SUCCESS);
+    CHECK(ResponseMacValid(Count));
+
+    for (Index = 0; Index < Count; Index++) {
+        CHECK(Get16(g_Response[Index].OperationResult) == RPMB_RESULT_OK);
+        CHECK(Get32(g_Response[Index].Nonce) == g_Nonce);
+        for (Byte = 0; Byte < 256; Byte++) {
+            if (g_Response[Index].Data[Byte] != BlockFill((UINT16)(Address + Index), Counter, Byte)) {
+                Match = FALSE;
+            }
+        }
+    }
+
+    return Match;
+}
+
+static
+void
+TestSha256()
+{
+    static const UINT8 Expected[32] = {
+        0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+        0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad,
+    };
+    SHA256 Sha;
+    UINT8 Digest[32];
+
+    //
+    // The MACs of the device and of the test share this code, check it
+    // against the FIPS 180-4 "abc" vector.
+    //
+    Sha256Init(&Sha);
+    Sha256Update(&Sha, "abc", 3);
+    Sha256Final(&Sha, Digest);
+    CHECK(memcmp(Digest, Expected, sizeof(Expected)) == 0);
+}
+
+static
+void
+TestDevInfo()
+{
+    static const UINT8 Cid[RPMB_EMMC_CID_SIZE] = {
+        0x15, 0x01, 0x00, 0x38, 0x47, 0x54, 0x46, 0x34, 0x52, 0x03, 0x12, 0x34, 0x56, 0x78, 0x9a, 0x00
+    };
+    tee_rpc_rpmb_dev_info Info;
+    OPTEE_RPMB_STATISTICS Statistics;
+    ULONG Calls;
+
+    //
+    // A 128 KB reliable write size used to wrap rel_wr_sec_c to 0.
+    //
+    g_Device.MaxReliableWriteSizeInBytes = 128 * 1024;
+    CHECK(OpteeClientRpmbInit() == STATUS_SUCCESS);
+    memset(&Info, 0xCC, sizeof(Info));
+    CHECK(OpteeClientRpmbGetDevInfo(NULL, Cid, &Info) == TEEC_SUCCESS);
+    CHECK(Info.ret_code == TEE_RPC_RPMB_CMD_GET_DEV_INFO_RET_OK);
+    CHECK(Info.rel_wr_sec_c == 255);
+    CHECK(Info.rpmb_size_mult == TEST_RPMB_SIZE_MULT);
+    CHECK(memcmp(Info.cid, Cid, sizeof(Cid)) == 0);
+    OpteeClientRpmbDeinit();
+
+    g_Device.MaxReliableWriteSizeInBytes = TEST_RPMB_REL_WR_BYTES;
+    CHECK(OpteeClientRpmbInit() == STATUS_SUCCESS);
+    CHECK(OpteeClientRpmbGetDevInfo(NULL, Cid, &Info) == TEEC_SUCCESS);
+    CHECK(Info.rel_wr_sec_c == TEST_RPMB_REL_WR_BYTES / 512);
+
+    //
+    // The device is queried once.
+    //
+    Calls = g_Device.Calls;
+    memset(&Info, 0xCC, sizeof(Info));
+    CHECK(OpteeClientRpmbGetDevInfo(NULL, Cid, &Info) == TEEC_SUCCESS);
+    CHECK(g_Device.Calls == Calls);
+    CHECK(Info.rel_wr_sec_c == TEST_RPMB_REL_WR_BYTES / 512);
+    CHECK(Info.rpmb_size_mult == TEST_RPMB_SIZE_MULT);
+    CHECK(Info.ret_code == TEE_RPC_RPMB_CMD_GET_DEV_INFO_RET_OK);
+    CHECK(memcmp(Info.cid, Cid, sizeof(Cid)) == 0);
+
+    OpteeClientRpmbGetStatistics(&Statistics);
+    CHECK(Statistics.DevInfoCacheHits == 1);
+    CHECK(Statistics.ReliableWriteBlocks == TEST_RPMB_REL_WR_BLOCKS);
+    CHECK(Statistics.Request[OpteeRpmbGetDevInfo].Requests == 2);
+    CHECK(Statistics.Request[OpteeRpmbGetDevInfo].DeviceCalls == 1);
+}
+
+static
+void
+TestProgramKey()
+{
+    SFFDISK_DEVICE_RPMB_DATA_FRAME* Frame = RequestFrames();
+    ULONG Index;
+
+    for (Index = 0; Index < sizeof(g_Key); Index++) {
+        g_Key[Index] = (UINT8)(0x40 + Index * 3);
+    }
+
+    memset(Frame, 0, sizeof(*Frame));
+    memcpy(Frame->KeyOrMAC, g_Key, sizeof(g_Key));
+    Put16(Frame->RequestOrResponseType, RPMB_REQ_PROGRAM_KEY);
+    g_Request.Command.block_count = 0;
+
+    CHECK(Send(1, 1) == TEEC_SUCCESS);
+    CHECK(Get16(g_Response[0].RequestOrResponseType) == RPMB_RESP_PROGRAM_KEY);
+    CHECK(Get16(g_Response[0].OperationResult) == RPMB_RESULT_OK);
+    CHECK(g_Device.KeyProgrammed);
+
+    //
+    // The key can only be programmed once.
+    //
+    CHECK(Send(1, 1) == TEEC_SUCCESS);
+    CHECK(Get16(g_Response[0].OperationResult) == RPMB_RESULT_WRITE_FAILURE);
+
+    CHECK(ReadCounter() == 0);
+}
+
+static
+void
+TestPackedWrites()
+{
+    OPTEE_RPMB_STATISTICS Before;
+    OPTEE_RPMB_STATISTICS After;
+    OPTEE_RPMB_OPERATION Operation;
+    ULONG Allocations;
+    UINT32 Counter;
+    ULONG Write;
+    UINT16 Address;
+
+    //
+    // Warm up both frame buffers to the size of a full reliable write.
+    //
+    Counter = ReadCounter();
+    BuildWrite(0, TEST_RPMB_REL_WR_BLOCKS, Counter);
+    CHECK(SendWrite(TEST_RPMB_REL_WR_BLOCKS) == RPMB_RESULT_OK);
+    CHECK(ReadAndCheck(0, TEST_RPMB_REL_WR_BLOCKS, Counter));
+
+    OpteeClientRpmbGetStatistics(&Before);
+    Allocations = g_HostPoolAllocations;
+
+    OpteeClientRpmbBeginOperation(&Operation);
+    for (Write = 0; Write < 50; Write++) {
+        Address = (UINT16)((Write * 37) % (TEST_RPMB_BLOCKS - 16));
+        Counter = ReadCounter();
+        CHECK(Counter == Write + 1);
+        BuildWrite(Address, 16, Counter);
+        g_Request.Command.block_count = 16;
+        CHECK(OpteeClientRpmbDataRequest(NULL, &Operation, &g_Request.Command, RequestSize(16),
+                                         g_Response, sizeof(g_Response[0])) == TEEC_SUCCESS);
+        CHECK(Get16(g_Response[0].OperationResult) == RPMB_RESULT_OK);
+        CHECK(Get32(g_Response[0].WriteCounter) == Counter + 1);
+        CHECK(ResponseMacValid(1));
+        CHECK(ReadAndCheck(Address, 16, Counter));
+    }
+    OpteeClientRpmbEndOperation(&Operation);
+
+    //
+    // No buffer was allocated during the I/O, every request was one device
+    // call.
+    //
+    CHECK(g_HostPoolAllocations == Allocations);
+    OpteeClientRpmbGetStatistics(&After);
+    CHECK(After.TemporaryBuffers == Before.TemporaryBuffers);
+    CHECK(After.BufferGrows == Before.BufferGrows);
+    CHECK(After.BufferReuses == Before.BufferReuses + 150);
+    CHECK(After.Request[OpteeRpmbAuthenticatedWrite].Requests ==
+          Before.Request[OpteeRpmbAuthenticatedWrite].Requests + 50);
+    CHECK(After.Request[OpteeRpmbAuthenticatedWrite].DeviceCalls ==
+          Before.Request[OpteeRpmbAuthenticatedWrite].DeviceCalls + 50);
+    CHECK(After.Request[OpteeRpmbAuthenticatedWrite].Blocks ==
+          Before.Request[OpteeRpmbAuthenticatedWrite].Blocks + 50 * 16);
+    CHECK(After.Request[OpteeRpmbAuthenticatedWrite].BlocksPerRequest[4] ==
+          Before.Request[OpteeRpmbAuthenticatedWrite].BlocksPerRequest[4] + 50);
+    CHECK(After.Request[OpteeRpmbAuthenticatedRead].Blocks ==
+          Before.Request[OpteeRpmbAuthenticatedRead].Blocks + 50 * 16);
+    CHECK(After.Operations == Before.Operations + 1);
+    CHECK(After.RequestsPerOperation[5] == Before.RequestsPerOperation[5] + 1);
+}
+
+static
+void
+TestRejectedWrites()
+{
+    SFFDISK_DEVICE_RPMB_DATA_FRAME Saved[4];
+    OPTEE_RPMB_STATISTICS Statistics;
+    UINT32 Counter;
+    ULONG Calls;
+
+    //
+    // A tampered data byte no longer matches the MAC: rejected, nothing
+    // written, the counter does not move.
+    //
+    Counter = ReadCounter();
+    BuildWrite(100, 4, Counter);
+    CHECK(SendWrite(4) == RPMB_RESULT_OK);
+    CHECK(ReadAndCheck(100, 4, Counter));
+
+    BuildWrite(100, 4, Counter + 1);
+    RequestFrames()[2].Data[17] ^= 0x01;
+    CHECK(SendWrite(4) == RPMB_RESULT_AUTH_FAILURE);
+    CHECK(ReadCounter() == Counter + 1);
+    CHECK(ReadAndCheck(100, 4, Counter));
+
+    //
+    // A MAC made with another key.
+    //
+    BuildWrite(100, 4, Counter + 1);
+    g_Key[0] ^= 0xFF;
+    FramesMac(g_Key, RequestFrames(), 4, RequestFrames()[3].KeyOrMAC);
+    g_Key[0] ^= 0xFF;
+    CHECK(Send(4, 1) == TEEC_SUCCESS);
+    CHECK(Get16(g_Response[0].OperationResult) == RPMB_RESULT_AUTH_FAILURE);
+    CHECK(ReadCounter() == Counter + 1);
+
+    //
+    // A valid write replayed: its counter is stale.
+    //
+    BuildWrite(100, 4, Counter + 1);
+    memcpy(Saved, RequestFrames(), sizeof(Saved));
+    CHECK(SendWrite(4) == RPMB_RESULT_OK);
+    CHECK(ReadCounter() == Counter + 2);
+    memcpy(RequestFrames(), Saved, sizeof(Saved));
+    CHECK(SendWrite(4) == RPMB_RESULT_COUNTER_FAILURE);
+    CHECK(ReadCounter() == Counter + 2);
+    CHECK(ReadAndCheck(100, 4, Counter + 1));
+
+    //
+    // A counter ahead of the device is rejected as well.
+    //
+    BuildWrite(100, 4, Counter + 5);
+    CHECK(SendWrite(4) == RPMB_RESULT_COUNTER_FAILURE);
+    CHECK(ReadCounter() == Counter + 2);
+
+    //
+    // More blocks than the reliable write count, and a write that runs
+    // past the end of the partition.
+    //
+    BuildWrite(200, TEST_RPMB_REL_WR_BLOCKS + 1, Counter + 2);
+    CHECK(SendWrite(TEST_RPMB_REL_WR_BLOCKS + 1) == RPMB_RESULT_GENERAL_FAILURE);
+    BuildWrite(TEST_RPMB_BLOCKS - 2, 4, Counter + 2);
+    CHECK(SendWrite(4) == RPMB_RESULT_ADDRESS_FAILURE);
+    CHECK(ReadCounter() == Counter + 2);
+
+    //
+    // Requests the library rejects before the device is called.
+    //
+    Calls = g_Device.Calls;
+    BuildWrite(100, 4, Counter + 2);
+    CHECK(Send(3, 1) == TEEC_ERROR_BAD_PARAMETERS);
+    Put16(RequestFrames()[0].BlockCount, 0);
+    CHECK(Send(4, 1) == TEEC_ERROR_BAD_PARAMETERS);
+    CHECK(OpteeClientRpmbDataRequest(NULL, NULL, &g_Request.Command, sizeof(tee_rpc_rpmb_cmd_t),
+                                     g_Response, sizeof(g_Response[0])) == TEEC_ERROR_BAD_PARAMETERS);
+    Put16(RequestFrames()[0].RequestOrResponseType, 0x0009);
+    CHECK(Send(1, 1) == TEEC_ERROR_BAD_PARAMETERS);
+
+    memset(RequestFrames(), 0, sizeof(SFFDISK_DEVICE_RPMB_DATA_FRAME));
+    Put16(RequestFrames()[0].RequestOrResponseType, RPMB_REQ_DATA_READ);
+    g_Request.Command.block_count = 8;
+    CHECK(Send(1, 7) == TEEC_ERROR_SHORT_BUFFER);
+    g_Request.Command.block_count = 0;
+    CHECK(Send(1, 1) == TEEC_ERROR_BAD_PARAMETERS);
+    CHECK(g_Device.Calls == Calls);
+
+    OpteeClientRpmbGetStatistics(&Statistics);
+    CHECK(Statistics.Request[OpteeRpmbAuthenticatedWrite].Failures == 2);
+    CHECK(Statistics.Request[OpteeRpmbAuthenticatedRead].Failures == 2);
+}
+
+static
+void
+TestLargeRead()
+{
+    OPTEE_RPMB_STATISTICS Before;
+    OPTEE_RPMB_STATISTICS After;
+    UINT32 Counter = ReadCounter();
+
+    //
+    // A read larger than the reusable buffers can grow to uses a temporary
+    // buffer, the next smaller read is served from a reusable one again.
+    //
+    OpteeClientRpmbGetStatistics(&Before);
+    BuildWrite(0, TEST_RPMB_REL_WR_BLOCKS, Counter);
+    CHECK(SendWrite(TEST_RPMB_REL_WR_BLOCKS) == RPMB_RESULT_OK);
+    CHECK(ReadAndCheck(0, TEST_RPMB_REL_WR_BLOCKS, Counter));
+
+    memset(RequestFrames(), 0, sizeof(SFFDISK_DEVICE_RPMB_DATA_FRAME));
+    Put32(RequestFrames()->Nonce, ++g_Nonce);
+    Put16(RequestFrames()->RequestOrResponseType, RPMB_REQ_DATA_READ);
+    g_Request.Command.block_count = TEST_MAX_FRAMES;
+    CHECK(Send(1, TEST_MAX_FRAMES) == TEEC_SUCCESS);
+    CHECK(ResponseMacValid(TEST_MAX_FRAMES));
+    CHECK(memcmp(g_Response[0].Data, g_Device.Blocks[0], 256) == 0);
+    CHECK(memcmp(g_Response[TEST_MAX_FRAMES - 1].Data, g_Device.Blocks[TEST_MAX_FRAMES - 1], 256) == 0);
+
+    CHECK(ReadAndCheck(0, TEST_RPMB_REL_WR_BLOCKS, Counter));
+
+    OpteeClientRpmbGetStatistics(&After);
+    CHECK(After.TemporaryBuffers == Before.TemporaryBuffers + 1);
+    CHECK(After.BufferReuses == Before.BufferReuses + 3);
+    CHECK(After.Request[OpteeRpmbAuthenticatedRead].BlocksPerRequest[OPTEE_RPMB_SIZE_BUCKETS - 1] ==
+          Before.Request[OpteeRpmbAuthenticatedRead].BlocksPerRequest[OPTEE_RPMB_SIZE_BUCKETS - 1] + 1);
+    CHECK(After.Request[OpteeRpmbAuthenticatedRead].Failures ==
+          Before.Request[OpteeRpmbAuthenticatedRead].Failures);
+    CHECK(After.Request[OpteeRpmbAuthenticatedWrite].Failures ==
+          Before.Request[OpteeRpmbAuthenticatedWrite].Failures);
+}
+
+int
+main()
+{
+    TestSha256();
+    TestDevInfo();
+    TestProgramKey();
+    TestPackedWrites();
+    TestRejectedWrites();
+    TestLargeRead();
+
+    OpteeClientRpmbDeinit();
+
+    return HostTestResult("OpteeClientRpmbTest");
+}
@@ -0,0 +1,11 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host build stand-in for the TrEE driver header, the OP-TEE client library
+// sources only use the pool tag
+//
+
+#pragma once
+
+#define OPTEE_TREE_POOL_TAG 'SerT'
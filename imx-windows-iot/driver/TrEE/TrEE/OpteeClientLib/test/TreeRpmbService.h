@@ -0,0 +1,10 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host build stand-in for the RPMB OS service definitions
+//
+
+#pragma once
+
+#define TREE_RPMB_SFFDISK_PARTITION_ACCESS 1
@@ -0,0 +1,28 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host build stand-in for the parts of TrustedRuntimeClx.h used by the
+// OP-TEE client library sources. TrSecureDeviceCallOSService is provided
+// by the test.
+//
+
+#pragma once
+
+#include <wdf.h>
+
+typedef struct _TR_SERVICE_REQUEST {
+    ULONG FunctionCode;
+    PVOID InputBuffer;
+    ULONG InputBufferSize;
+    PVOID OutputBuffer;
+    ULONG OutputBufferSize;
+} TR_SERVICE_REQUEST, *PTR_SERVICE_REQUEST;
+
+NTSTATUS
+TrSecureDeviceCallOSService(
+    _In_ WDFDEVICE Device,
+    _In_ const GUID *ServiceGuid,
+    _In_ PTR_SERVICE_REQUEST Request,
+    _Out_ ULONG_PTR *BytesWritten
+    );
@@ -0,0 +1,696 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host build stand-in for the kernel headers used by the OP-TEE client
+// library sources. The other kernel headers they include are empty.
+//
+// The processor the code runs on and the processor count are set by the
+// tests through g_HostProcessor and g_HostProcessorCount, waits on a
+// semaphore are counted in g_HostSemaphoreWaits. The host tests are single
+// threaded, a wait on a semaphore that is not signaled or a recursive
+// acquire of a fast mutex is a bug.
+//
+// A test that defines HOST_TEST_THREADS gets dispatcher objects, fast
+// mutexes and spin locks on host threads instead. The singly linked lists
+// stay single threaded.
+//
+
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define _WIN64
+
+typedef int32_t             NTSTATUS;
+typedef uint8_t             UINT8, UCHAR, BOOLEAN;
+typedef uint16_t            UINT16, USHORT;
+typedef uint32_t            UINT32, ULONG, *PULONG;
+typedef uint64_t            UINT64, ULONGLONG, ULONG64;
+typedef int32_t             LONG;
+typedef int64_t             LONG64, LONGLONG;
+typedef uintptr_t           ULONG_PTR;
+typedef size_t              SIZE_T;
+typedef void                VOID, *PVOID, *HANDLE;
+typedef char                CHAR;
+
+typedef union _LARGE_INTEGER {
+    struct {
+        ULONG LowPart;
+        LONG HighPart;
+    } u;
+    LONGLONG QuadPart;
+} LARGE_INTEGER, PHYSICAL_ADDRESS, *PLARGE_INTEGER;
+
+typedef struct _GUID {
+    UINT32 Data1;
+    UINT16 Data2;
+    UINT16 Data3;
+    UINT8 Data4[8];
+} GUID;
+
+#define TRUE                1
+#define FALSE               0
+#define MAXUINT8            0xFF
+#define ANYSIZE_ARRAY       1
+
+#ifndef max
+#define max(a, b)           (((a) > (b)) ? (a) : (b))
+#endif
+
+#define STATUS_SUCCESS                  ((NTSTATUS)0x00000000L)
+#define STATUS_TIMEOUT                  ((NTSTATUS)0x00000102L)
+#define STATUS_UNSUCCESSFUL             ((NTSTATUS)0xC0000001L)
+#define STATUS_NOT_IMPLEMENTED          ((NTSTATUS)0xC0000002L)
+#define STATUS_INVALID_PARAMETER        ((NTSTATUS)0xC000000DL)
+#define STATUS_ACCESS_DENIED            ((NTSTATUS)0xC0000022L)
+#define STATUS_BUFFER_TOO_SMALL         ((NTSTATUS)0xC0000023L)
+#define STATUS_PARAMETER_QUOTA_EXCEEDED ((NTSTATUS)0xC0000410L)
+#define STATUS_BAD_DATA                 ((NTSTATUS)0xC000090BL)
+#define STATUS_UNEXPECTED_IO_ERROR      ((NTSTATUS)0xC00000E9L)
+#define STATUS_NOT_FOUND                ((NTSTATUS)0xC0000225L)
+#define STATUS_NOT_SUPPORTED            ((NTSTATUS)0xC00000BBL)
+#define STATUS_NO_DATA_DETECTED         ((NTSTATUS)0x80000022L)
+#define STATUS_INSUFFICIENT_RESOURCES   ((NTSTATUS)0xC000009AL)
+#define STATUS_DEVICE_BUSY              ((NTSTATUS)0x80000011L)
+#define STATUS_PROTOCOL_UNREACHABLE     ((NTSTATUS)0xC000023EL)
+#define STATUS_FAIL_CHECK               ((NTSTATUS)0xC0000229L)
+#define STATUS_CANCELLED                ((NTSTATUS)0xC0000120L)
+#define STATUS_DEVICE_UNREACHABLE       ((NTSTATUS)0xC0000464L)
+#define STATUS_MEMORY_NOT_ALLOCATED     ((NTSTATUS)0xC00000A0L)
+
+#define NT_SUCCESS(Status)  (((NTSTATUS)(Status)) >= 0)
+#define ASSERT(e)           assert(e)
+#define NT_ASSERT(e)        assert(e)
+#define UNREFERENCED_PARAMETER(P) ((void)(P))
+#define C_ASSERT(e)         _Static_assert(e, #e)
+#define DECLSPEC_CACHEALIGN __attribute__((aligned(64)))
+
+#define MEMORY_ALLOCATION_ALIGNMENT 16
+
+#ifndef PAGE_SIZE
+#define PAGE_SIZE           0x1000
+#endif
+#define PAGE_ALIGN(Va)      ((PVOID)((ULONG_PTR)(Va) & ~((ULONG_PTR)PAGE_SIZE - 1)))
+#define BYTES_TO_PAGES(Size) ((ULONG)(((Size) + PAGE_SIZE - 1) / PAGE_SIZE))
+#define ROUND_TO_PAGES(Size) (((ULONG_PTR)(Size) + PAGE_SIZE - 1) & ~((ULONG_PTR)PAGE_SIZE - 1))
+
+#define CONTAINING_RECORD(address, type, field) \
+    ((type *)((char *)(address) - offsetof(type, field)))
+
+#define RtlZeroMemory(Destination, Length)  memset((Destination), 0, (Length))
+#define RtlCopyMemory(Destination, Source, Length) memcpy((Destination), (Source), (Length))
+
+#define _In_
+#define _In_opt_
+#define _Out_
+#define _Out_opt_
+#define _Inout_
+#define _Inout_opt_
+#define _In_reads_bytes_(Size)
+#define _Out_writes_bytes_(Size)
+#define _Use_decl_annotations_
+#define _IRQL_requires_max_(Irql)
+#define IN
+#define OUT
+
+#define PASSIVE_LEVEL       0
+#define DISPATCH_LEVEL      2
+
+//
+// Doubly linked lists
+//
+
+typedef struct _LIST_ENTRY {
+    struct _LIST_ENTRY *Flink;
+    struct _LIST_ENTRY *Blink;
+} LIST_ENTRY, *PLIST_ENTRY;
+
+static inline void InitializeListHead(PLIST_ENTRY Head)
+{
+    Head->Flink = Head->Blink = Head;
+}
+
+static inline BOOLEAN IsListEmpty(const LIST_ENTRY *Head)
+{
+    return Head->Flink == Head;
+}
+
+static inline void RemoveEntryList(PLIST_ENTRY Entry)
+{
+    Entry->Blink->Flink = Entry->Flink;
+    Entry->Flink->Blink = Entry->Blink;
+}
+
+static inline PLIST_ENTRY RemoveHeadList(PLIST_ENTRY Head)
+{
+    PLIST_ENTRY Entry = Head->Flink;
+
+    RemoveEntryList(Entry);
+    return Entry;
+}
+
+static inline void InsertTailList(PLIST_ENTRY Head, PLIST_ENTRY Entry)
+{
+    Entry->Flink = Head;
+    Entry->Blink = Head->Blink;
+    Head->Blink->Flink = Entry;
+    Head->Blink = Entry;
+}
+
+static inline void InsertHeadList(PLIST_ENTRY Head, PLIST_ENTRY Entry)
+{
+    Entry->Flink = Head->Flink;
+    Entry->Blink = Head;
+    Head->Flink->Blink = Entry;
+    Head->Flink = Entry;
+}
+
+//
+// Singly linked interlocked lists
+//
+
+typedef struct _SLIST_ENTRY {
+    struct _SLIST_ENTRY *Next;
+} SLIST_ENTRY, *PSLIST_ENTRY;
+
+typedef struct _SLIST_HEADER {
+    PSLIST_ENTRY First;
+    ULONG Depth;
+} SLIST_HEADER, *PSLIST_HEADER;
+
+static inline void InitializeSListHead(PSLIST_HEADER Head)
+{
+    Head->First = NULL;
+    Head->Depth = 0;
+}
+
+static inline PSLIST_ENTRY InterlockedPushEntrySList(PSLIST_HEADER Head, PSLIST_ENTRY Entry)
+{
+    PSLIST_ENTRY First = Head->First;
+
+    Entry->Next = First;
+    Head->First = Entry;
+    Head->Depth++;
+    return First;
+}
+
+static inline PSLIST_ENTRY InterlockedPopEntrySList(PSLIST_HEADER Head)
+{
+    PSLIST_ENTRY First = Head->First;
+
+    if (First != NULL) {
+        Head->First = First->Next;
+        Head->Depth--;
+    }
+    return First;
+}
+
+static inline PSLIST_ENTRY InterlockedFlushSList(PSLIST_HEADER Head)
+{
+    PSLIST_ENTRY First = Head->First;
+
+    Head->First = NULL;
+    Head->Depth = 0;
+    return First;
+}
+
+static inline LONG64 InterlockedIncrement64(LONG64 volatile *Addend)
+{
+    return __atomic_add_fetch(Addend, 1, __ATOMIC_SEQ_CST);
+}
+
+static inline LONG InterlockedCompareExchange(LONG volatile *Destination, LONG Exchange,
+    LONG Comperand)
+{
+    __atomic_compare_exchange_n(Destination, &Comperand, Exchange, FALSE,
+                                __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return Comperand;
+}
+
+static inline LONG InterlockedExchange(LONG volatile *Target, LONG Value)
+{
+    return __atomic_exchange_n(Target, Value, __ATOMIC_SEQ_CST);
+}
+
+//
+// Processors
+//
+
+#define ALL_PROCESSOR_GROUPS 0xFFFF
+
+static ULONG g_HostProcessor;
+static ULONG g_HostProcessorCount = 4;
+
+static inline ULONG KeQueryMaximumProcessorCountEx(USHORT GroupNumber)
+{
+    UNREFERENCED_PARAMETER(GroupNumber);
+    return g_HostProcessorCount;
+}
+
+static inline ULONG KeGetCurrentProcessorNumberEx(PVOID ProcNumber)
+{
+    UNREFERENCED_PARAMETER(ProcNumber);
+    assert(g_HostProcessor < g_HostProcessorCount);
+    return g_HostProcessor;
+}
+
+//
+// Semaphores, events and locks
+//
+
+typedef enum { Executive } KWAIT_REASON;
+typedef enum { KernelMode } KPROCESSOR_MODE;
+typedef enum { NotificationEvent, SynchronizationEvent } EVENT_TYPE;
+typedef UCHAR KIRQL, *PKIRQL;
+
+#define LOW_PRIORITY 0
+#define IO_NO_INCREMENT 0
+
+static ULONG g_HostSemaphoreWaits;
+
+#ifndef HOST_TEST_THREADS
+
+typedef struct _KSEMAPHORE {
+    LONG Count;
+    LONG Limit;
+} KSEMAPHORE, *PKSEMAPHORE;
+
+static inline void KeInitializeSemaphore(PKSEMAPHORE Semaphore, LONG Count, LONG Limit)
+{
+    Semaphore->Count = Count;
+    Semaphore->Limit = Limit;
+}
+
+static inline NTSTATUS KeWaitForSingleObject(PVOID Object,
+    KWAIT_REASON WaitReason, KPROCESSOR_MODE WaitMode, BOOLEAN Alertable,
+    PLARGE_INTEGER Timeout)
+{
+    PKSEMAPHORE Semaphore = (PKSEMAPHORE)Object;
+
+    UNREFERENCED_PARAMETER(WaitReason);
+    UNREFERENCED_PARAMETER(WaitMode);
+    UNREFERENCED_PARAMETER(Alertable);
+    UNREFERENCED_PARAMETER(Timeout);
+
+    assert(Semaphore->Count > 0);
+    Semaphore->Count--;
+    g_HostSemaphoreWaits++;
+    return STATUS_SUCCESS;
+}
+
+static inline LONG KeReleaseSemaphore(PKSEMAPHORE Semaphore, LONG Increment,
+    LONG Adjustment, BOOLEAN Wait)
+{
+    LONG Previous = Semaphore->Count;
+
+    UNREFERENCED_PARAMETER(Increment);
+    UNREFERENCED_PARAMETER(Wait);
+
+    assert(Semaphore->Count + Adjustment <= Semaphore->Limit);
+    Semaphore->Count += Adjustment;
+    return Previous;
+}
+
+typedef struct _KEVENT {
+    BOOLEAN Signaled;
+} KEVENT, *PKEVENT;
+
+typedef struct _FAST_MUTEX {
+    LONG Count;
+} FAST_MUTEX, *PFAST_MUTEX;
+
+static inline void ExInitializeFastMutex(PFAST_MUTEX FastMutex)
+{
+    FastMutex->Count = 1;
+}
+
+static inline void ExAcquireFastMutex(PFAST_MUTEX FastMutex)
+{
+    assert(FastMutex->Count == 1);
+    FastMutex->Count = 0;
+}
+
+static inline void ExReleaseFastMutex(PFAST_MUTEX FastMutex)
+{
+    assert(FastMutex->Count == 0);
+    FastMutex->Count = 1;
+}
+
+#else
+
+#include <pthread.h>
+
+//
+// A semaphore holds its count in SignalState, a synchronization event is
+// a semaphore with a limit of one whose count KeSetEvent sets.
+//
+typedef struct _DISPATCHER_HEADER {
+    pthread_mutex_t Lock;
+    pthread_cond_t Signal;
+    LONG SignalState;
+    LONG Limit;
+    BOOLEAN AutoReset;
+} DISPATCHER_HEADER;
+
+typedef struct _KSEMAPHORE {
+    DISPATCHER_HEADER Header;
+} KSEMAPHORE, *PKSEMAPHORE;
+
+typedef struct _KEVENT {
+    DISPATCHER_HEADER Header;
+} KEVENT, *PKEVENT;
+
+static inline void KeHostInitializeObject(DISPATCHER_HEADER *Header, LONG SignalState,
+    LONG Limit, BOOLEAN AutoReset)
+{
+    pthread_condattr_t Attributes;
+
+    pthread_condattr_init(&Attributes);
+    pthread_condattr_setclock(&Attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&Header->Signal, &Attributes);
+    pthread_condattr_destroy(&Attributes);
+    pthread_mutex_init(&Header->Lock, NULL);
+    Header->SignalState = SignalState;
+    Header->Limit = Limit;
+    Header->AutoReset = AutoReset;
+}
+
+static inline void KeInitializeSemaphore(PKSEMAPHORE Semaphore, LONG Count, LONG Limit)
+{
+    KeHostInitializeObject(&Semaphore->Header, Count, Limit, TRUE);
+}
+
+static inline void KeInitializeEvent(PKEVENT Event, EVENT_TYPE Type, BOOLEAN State)
+{
+    KeHostInitializeObject(&Event->Header, State, 1, Type == SynchronizationEvent);
+}
+
+//
+// The timeout is relative, in negative 100ns units.
+//
+static inline NTSTATUS KeWaitForSingleObject(PVOID Object,
+    KWAIT_REASON WaitReason, KPROCESSOR_MODE WaitMode, BOOLEAN Alertable,
+    PLARGE_INTEGER Timeout)
+{
+    DISPATCHER_HEADER *Header = (DISPATCHER_HEADER *)Object;
+    struct timespec Deadline;
+    NTSTATUS Status = STATUS_SUCCESS;
+
+    UNREFERENCED_PARAMETER(WaitReason);
+    UNREFERENCED_PARAMETER(WaitMode);
+    UNREFERENCED_PARAMETER(Alertable);
+
+    if (Timeout != NULL) {
+        assert(Timeout->QuadPart <= 0);
+        clock_gettime(CLOCK_MONOTONIC, &Deadline);
+        Deadline.tv_sec += -Timeout->QuadPart / 10000000;
+        Deadline.tv_nsec += (-Timeout->QuadPart % 10000000) * 100;
+        if (Deadline.tv_nsec >= 1000000000) {
+            Deadline.tv_sec++;
+            Deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    __atomic_add_fetch(&g_HostSemaphoreWaits, 1, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&Header->Lock);
+    while (Header->SignalState == 0) {
+        if (Timeout == NULL) {
+            pthread_cond_wait(&Header->Signal, &Header->Lock);
+        } else if (pthread_cond_timedwait(&Header->Signal, &Header->Lock, &Deadline) != 0) {
+            Status = STATUS_TIMEOUT;
+            break;
+        }
+    }
+    if ((Status == STATUS_SUCCESS) && Header->AutoReset) {
+        Header->SignalState--;
+    }
+    pthread_mutex_unlock(&Header->Lock);
+
+    return Status;
+}
+
+static inline LONG KeReleaseSemaphore(PKSEMAPHORE Semaphore, LONG Increment,
+    LONG Adjustment, BOOLEAN Wait)
+{
+    LONG Previous;
+
+    UNREFERENCED_PARAMETER(Increment);
+    UNREFERENCED_PARAMETER(Wait);
+
+    pthread_mutex_lock(&Semaphore->Header.Lock);
+    Previous = Semaphore->Header.SignalState;
+    assert(Previous + Adjustment <= Semaphore->Header.Limit);
+    Semaphore->Header.SignalState += Adjustment;
+    pthread_cond_broadcast(&Semaphore->Header.Signal);
+    pthread_mutex_unlock(&Semaphore->Header.Lock);
+    return Previous;
+}
+
+static inline LONG KeSetEvent(PKEVENT Event, LONG Increment, BOOLEAN Wait)
+{
+    LONG Previous;
+
+    UNREFERENCED_PARAMETER(Increment);
+    UNREFERENCED_PARAMETER(Wait);
+
+    pthread_mutex_lock(&Event->Header.Lock);
+    Previous = Event->Header.SignalState;
+    Event->Header.SignalState = 1;
+    pthread_cond_broadcast(&Event->Header.Signal);
+    pthread_mutex_unlock(&Event->Header.Lock);
+    return Previous;
+}
+
+typedef struct _FAST_MUTEX {
+    pthread_mutex_t Lock;
+} FAST_MUTEX, *PFAST_MUTEX;
+
+static inline void ExInitializeFastMutex(PFAST_MUTEX FastMutex)
+{
+    pthread_mutex_init(&FastMutex->Lock, NULL);
+}
+
+static inline void ExAcquireFastMutex(PFAST_MUTEX FastMutex)
+{
+    pthread_mutex_lock(&FastMutex->Lock);
+}
+
+static inline void ExReleaseFastMutex(PFAST_MUTEX FastMutex)
+{
+    pthread_mutex_unlock(&FastMutex->Lock);
+}
+
+typedef pthread_mutex_t KSPIN_LOCK, *PKSPIN_LOCK;
+
+static inline void KeInitializeSpinLock(PKSPIN_LOCK SpinLock)
+{
+    pthread_mutex_init(SpinLock, NULL);
+}
+
+static inline void KeAcquireSpinLock(PKSPIN_LOCK SpinLock, PKIRQL OldIrql)
+{
+    pthread_mutex_lock(SpinLock);
+    *OldIrql = PASSIVE_LEVEL;
+}
+
+static inline void KeReleaseSpinLock(PKSPIN_LOCK SpinLock, KIRQL NewIrql)
+{
+    UNREFERENCED_PARAMETER(NewIrql);
+    pthread_mutex_unlock(SpinLock);
+}
+
+#endif
+
+//
+// Extended processor state, nothing to save on the host
+//
+
+#define XSTATE_MASK_LEGACY_SSE 0x2
+
+typedef struct _XSTATE_SAVE {
+    ULONG Reserved;
+} XSTATE_SAVE, *PXSTATE_SAVE;
+
+static inline NTSTATUS KeSaveExtendedProcessorState(ULONG64 Mask, PXSTATE_SAVE XStateSave)
+{
+    UNREFERENCED_PARAMETER(Mask);
+    UNREFERENCED_PARAMETER(XStateSave);
+    return STATUS_SUCCESS;
+}
+
+static inline void KeRestoreExtendedProcessorState(PXSTATE_SAVE XStateSave)
+{
+    UNREFERENCED_PARAMETER(XStateSave);
+}
+
+//
+// Performance counter, ticks at 1 MHz of the host monotonic clock
+//
+
+static inline LARGE_INTEGER KeQueryPerformanceCounter(PLARGE_INTEGER PerformanceFrequency)
+{
+    struct timespec Time;
+    LARGE_INTEGER Counter;
+
+    if (PerformanceFrequency != NULL) {
+        PerformanceFrequency->QuadPart = 1000000;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &Time);
+    Counter.QuadPart = (LONGLONG)Time.tv_sec * 1000000 + Time.tv_nsec / 1000;
+    return Counter;
+}
+
+//
+// Pool and I/O space, the shared memory is mapped to a page aligned
+// host allocation. Pool allocations are counted in g_HostPoolAllocations.
+//
+
+typedef enum { NonPagedPoolNx, NonPagedPool, PagedPool } POOL_TYPE;
+typedef enum { MmNonCached, MmCached } MEMORY_CACHING_TYPE;
+
+static ULONG g_HostPoolAllocations;
+
+static inline PVOID ExAllocatePoolWithTag(POOL_TYPE PoolType, SIZE_T NumberOfBytes, ULONG Tag)
+{
+    UNREFERENCED_PARAMETER(PoolType);
+    UNREFERENCED_PARAMETER(Tag);
+    __atomic_add_fetch(&g_HostPoolAllocations, 1, __ATOMIC_RELAXED);
+    return malloc(NumberOfBytes);
+}
+
+static inline void ExFreePoolWithTag(PVOID P, ULONG Tag)
+{
+    UNREFERENCED_PARAMETER(Tag);
+    free(P);
+}
+
+static inline PVOID MmMapIoSpace(PHYSICAL_ADDRESS PhysicalAddress, SIZE_T NumberOfBytes,
+    MEMORY_CACHING_TYPE CacheType)
+{
+    UNREFERENCED_PARAMETER(PhysicalAddress);
+    UNREFERENCED_PARAMETER(CacheType);
+    return aligned_alloc(PAGE_SIZE, (NumberOfBytes + PAGE_SIZE - 1) & ~((SIZE_T)PAGE_SIZE - 1));
+}
+
+static inline void MmUnmapIoSpace(PVOID BaseAddress, SIZE_T NumberOfBytes)
+{
+    UNREFERENCED_PARAMETER(NumberOfBytes);
+    free(BaseAddress);
+}
+
+//
+// Bitmaps
+//
+
+typedef struct _RTL_BITMAP {
+    ULONG SizeOfBitMap;
+    PULONG Buffer;
+} RTL_BITMAP, *PRTL_BITMAP;
+
+static inline BOOLEAN RtlHostTestBit(PRTL_BITMAP BitMap, ULONG Index)
+{
+    return (((UCHAR*)BitMap->Buffer)[Index / 8] >> (Index % 8)) & 1;
+}
+
+static inline void RtlInitializeBitMap(PRTL_BITMAP BitMap, PULONG Buffer, ULONG Size)
+{
+    BitMap->SizeOfBitMap = Size;
+    BitMap->Buffer = Buffer;
+}
+
+static inline void RtlSetBits(PRTL_BITMAP BitMap, ULONG Start, ULONG Count)
+{
+    assert(Start + Count <= BitMap->SizeOfBitMap);
+    for (ULONG Index = Start; Index < Start + Count; Index++) {
+        ((UCHAR*)BitMap->Buffer)[Index / 8] |= (UCHAR)(1 << (Index % 8));
+    }
+}
+
+static inline void RtlClearBits(PRTL_BITMAP BitMap, ULONG Start, ULONG Count)
+{
+    assert(Start + Count <= BitMap->SizeOfBitMap);
+    for (ULONG Index = Start; Index < Start + Count; Index++) {
+        ((UCHAR*)BitMap->Buffer)[Index / 8] &= (UCHAR)~(1 << (Index % 8));
+    }
+}
+
+static inline void RtlClearAllBits(PRTL_BITMAP BitMap)
+{
+    memset(BitMap->Buffer, 0, (BitMap->SizeOfBitMap + 7) / 8);
+}
+
+static inline BOOLEAN RtlAreBitsSet(PRTL_BITMAP BitMap, ULONG Start, ULONG Count)
+{
+    for (ULONG Index = Start; Index < Start + Count; Index++) {
+        if ((Index >= BitMap->SizeOfBitMap) || !RtlHostTestBit(BitMap, Index)) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+static inline ULONG RtlNumberOfClearBits(PRTL_BITMAP BitMap)
+{
+    ULONG Clear = 0;
+
+    for (ULONG Index = 0; Index < BitMap->SizeOfBitMap; Index++) {
+        Clear += !RtlHostTestBit(BitMap, Index);
+    }
+    return Clear;
+}
+
+static inline ULONG RtlFindClearBitsAndSet(PRTL_BITMAP BitMap, ULONG Count, ULONG HintIndex)
+{
+    ULONG Run = 0;
+
+    UNREFERENCED_PARAMETER(HintIndex);
+
+    for (ULONG Index = 0; Index < BitMap->SizeOfBitMap; Index++) {
+        Run = RtlHostTestBit(BitMap, Index) ? 0 : Run + 1;
+        if (Run == Count) {
+            RtlSetBits(BitMap, Index + 1 - Count, Count);
+            return Index + 1 - Count;
+        }
+    }
+    return 0xFFFFFFFF;
+}
+
+static inline ULONG RtlFindLongestRunClear(PRTL_BITMAP BitMap, PULONG StartingIndex)
+{
+    ULONG Run = 0;
+    ULONG Longest = 0;
+
+    *StartingIndex = 0;
+    for (ULONG Index = 0; Index < BitMap->SizeOfBitMap; Index++) {
+        Run = RtlHostTestBit(BitMap, Index) ? 0 : Run + 1;
+        if (Run > Longest) {
+            Longest = Run;
+            *StartingIndex = Index + 1 - Run;
+        }
+    }
+    return Longest;
+}
+
+static inline ULONG RtlFindLastBackwardRunClear(PRTL_BITMAP BitMap, ULONG FromIndex,
+    PULONG StartingRunIndex)
+{
+    ULONG End = FromIndex + 1;
+    ULONG Start;
+
+    while ((End > 0) && RtlHostTestBit(BitMap, End - 1)) {
+        End--;
+    }
+    Start = End;
+    while ((Start > 0) && !RtlHostTestBit(BitMap, Start - 1)) {
+        Start--;
+    }
+    *StartingRunIndex = Start;
+    return End - Start;
+}
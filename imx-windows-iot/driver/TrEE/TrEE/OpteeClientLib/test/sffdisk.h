@@ -0,0 +1,63 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host build stand-in for the RPMB partition access definitions of
+// sffdisk.h. A data frame has the JEDEC eMMC layout, the frames of a
+// request or response beyond the first follow the access data.
+//
+
+#pragma once
+
+#include <ntddk.h>
+
+typedef enum _SFFDISK_RPMB_COMMAND {
+    SFFDISK_RPMB_PROGRAM_AUTH_KEY = 1,
+    SFFDISK_RPMB_QUERY_WRITE_COUNTER = 2,
+    SFFDISK_RPMB_AUTHENTICATED_WRITE = 3,
+    SFFDISK_RPMB_AUTHENTICATED_READ = 4,
+    SFFDISK_RPMB_IS_SUPPORTED = 6,
+} SFFDISK_RPMB_COMMAND;
+
+typedef struct _SFFDISK_DEVICE_RPMB_DATA_FRAME {
+    UCHAR Stuff[196];
+    UCHAR KeyOrMAC[32];
+    UCHAR Data[256];
+    UCHAR Nonce[16];
+    UCHAR WriteCounter[4];
+    UCHAR Address[2];
+    UCHAR BlockCount[2];
+    UCHAR OperationResult[2];
+    UCHAR RequestOrResponseType[2];
+} SFFDISK_DEVICE_RPMB_DATA_FRAME;
+
+typedef struct _SFFDISK_DEVICE_PARTITION_ACCESS_DATA {
+    ULONG Size;
+    SFFDISK_RPMB_COMMAND Command;
+    union {
+        struct {
+            ULONG SizeInBytes;
+            ULONG MaxReliableWriteSizeInBytes;
+        } RpmbIsSupported;
+        struct {
+            SFFDISK_DEVICE_RPMB_DATA_FRAME ProgramAuthKeyFrame;
+            SFFDISK_DEVICE_RPMB_DATA_FRAME ResultFrame;
+        } RpmbProgramAuthKey;
+        struct {
+            SFFDISK_DEVICE_RPMB_DATA_FRAME QueryWriteCounterFrame;
+            SFFDISK_DEVICE_RPMB_DATA_FRAME ResultFrame;
+        } RpmbQueryWriteCounter;
+        struct {
+            ULONG CountToWrite;
+            SFFDISK_DEVICE_RPMB_DATA_FRAME ResultFrame;
+            SFFDISK_DEVICE_RPMB_DATA_FRAME FrameDataToWrite[1];
+        } RpmbAuthenticatedWrite;
+        struct {
+            ULONG CountToRead;
+            SFFDISK_DEVICE_RPMB_DATA_FRAME AuthenticatedReadFrame;
+            SFFDISK_DEVICE_RPMB_DATA_FRAME ReturnedFrameData[1];
+        } RpmbAuthenticatedRead;
+    } Parameters;
+} SFFDISK_DEVICE_PARTITION_ACCESS_DATA;
+
+extern const GUID GUID_DEVINTERFACE_EMMC_PARTITION_ACCESS_RPMB;
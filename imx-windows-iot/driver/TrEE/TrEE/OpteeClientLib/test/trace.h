@@ -0,0 +1,14 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host build stand-in for the TrEE driver trace header, the traces are
+// dropped
+//
+
+#pragma once
+
+#define TraceError(...)         ((void)0)
+#define TraceWarning(...)       ((void)0)
+#define TraceInformation(...)   ((void)0)
+#define TraceDebug(...)         ((void)0)
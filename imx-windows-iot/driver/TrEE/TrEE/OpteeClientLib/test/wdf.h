@@ -0,0 +1,223 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host build stand-in for the parts of wdf.h used by the OP-TEE client
+// library sources
+//
+// With HOST_TEST_THREADS work items, lookaside lists and memory objects
+// are host objects as well. Each work item has its own host thread, live
+// objects are counted in g_HostWdfObjects and g_HostWorkItemsToCreate
+// makes the work item creations past the given number fail.
+//
+
+#pragma once
+
+#include <ntddk.h>
+
+typedef PVOID               WDFDEVICE;
+
+#ifdef HOST_TEST_THREADS
+
+typedef enum {
+    WdfHostWorkItem,
+    WdfHostLookaside,
+    WdfHostMemory
+} WDF_HOST_OBJECT_TYPE;
+
+typedef struct _WDF_HOST_OBJECT *WDFOBJECT;
+typedef WDFOBJECT           WDFWORKITEM, WDFLOOKASIDE, WDFMEMORY, WDFDRIVER;
+
+typedef VOID EVT_WDF_WORKITEM(WDFWORKITEM WorkItem);
+typedef EVT_WDF_WORKITEM *PFN_WDF_WORKITEM;
+
+typedef struct _WDF_HOST_OBJECT {
+    WDF_HOST_OBJECT_TYPE Type;
+    PFN_WDF_WORKITEM Callback;
+    pthread_t Thread;
+    pthread_mutex_t Lock;
+    pthread_cond_t Signal;
+    BOOLEAN Queued;
+    BOOLEAN Running;
+    BOOLEAN Exit;
+    size_t BufferSize;
+    __attribute__((aligned(16))) UCHAR Context[];
+} WDF_HOST_OBJECT;
+
+typedef struct _WDF_OBJECT_ATTRIBUTES {
+    WDFOBJECT ParentObject;
+    size_t ContextSize;
+} WDF_OBJECT_ATTRIBUTES, *PWDF_OBJECT_ATTRIBUTES;
+
+typedef struct _WDF_WORKITEM_CONFIG {
+    PFN_WDF_WORKITEM EvtWorkItemFunc;
+    BOOLEAN AutomaticSerialization;
+} WDF_WORKITEM_CONFIG, *PWDF_WORKITEM_CONFIG;
+
+#define WDF_NO_OBJECT_ATTRIBUTES NULL
+
+#define WDF_OBJECT_ATTRIBUTES_SET_CONTEXT_TYPE(Attributes, Type) \
+    ((Attributes)->ContextSize = sizeof(Type))
+
+#define WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(Type, Name) \
+    static inline Type *Name(WDFOBJECT Object) { return (Type *)Object->Context; }
+
+static LONG g_HostWdfObjects;
+static ULONG g_HostWorkItemsToCreate = 0xFFFFFFFF;
+
+static inline void WDF_OBJECT_ATTRIBUTES_INIT(PWDF_OBJECT_ATTRIBUTES Attributes)
+{
+    memset(Attributes, 0, sizeof(*Attributes));
+}
+
+static inline void WDF_WORKITEM_CONFIG_INIT(PWDF_WORKITEM_CONFIG Config,
+    PFN_WDF_WORKITEM EvtWorkItemFunc)
+{
+    Config->EvtWorkItemFunc = EvtWorkItemFunc;
+    Config->AutomaticSerialization = TRUE;
+}
+
+static inline WDFDRIVER WdfGetDriver(void)
+{
+    return NULL;
+}
+
+static inline WDFOBJECT WdfHostObjectCreate(WDF_HOST_OBJECT_TYPE Type, size_t ContextSize)
+{
+    WDFOBJECT Object = calloc(1, sizeof(WDF_HOST_OBJECT) + ContextSize);
+
+    if (Object != NULL) {
+        Object->Type = Type;
+        Object->BufferSize = ContextSize;
+        __atomic_add_fetch(&g_HostWdfObjects, 1, __ATOMIC_SEQ_CST);
+    }
+    return Object;
+}
+
+//
+// Work items. An enqueue of a work item that is queued and not running
+// yet is dropped, the callbacks of a work item never overlap.
+//
+
+static inline void *WdfHostWorkItemThread(void *Parameter)
+{
+    WDFWORKITEM WorkItem = (WDFWORKITEM)Parameter;
+
+    pthread_mutex_lock(&WorkItem->Lock);
+    for (;;) {
+        while (!WorkItem->Queued && !WorkItem->Exit) {
+            pthread_cond_wait(&WorkItem->Signal, &WorkItem->Lock);
+        }
+        if (!WorkItem->Queued) {
+            break;
+        }
+        WorkItem->Queued = FALSE;
+        WorkItem->Running = TRUE;
+        pthread_mutex_unlock(&WorkItem->Lock);
+
+        WorkItem->Callback(WorkItem);
+
+        pthread_mutex_lock(&WorkItem->Lock);
+        WorkItem->Running = FALSE;
+        pthread_cond_broadcast(&WorkItem->Signal);
+    }
+    pthread_mutex_unlock(&WorkItem->Lock);
+
+    return NULL;
+}
+
+static inline NTSTATUS WdfWorkItemCreate(PWDF_WORKITEM_CONFIG Config,
+    PWDF_OBJECT_ATTRIBUTES Attributes, WDFWORKITEM *WorkItem)
+{
+    WDFWORKITEM Object;
+
+    if (g_HostWorkItemsToCreate == 0) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+    g_HostWorkItemsToCreate--;
+
+    Object = WdfHostObjectCreate(WdfHostWorkItem, Attributes->ContextSize);
+    if (Object == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+    Object->Callback = Config->EvtWorkItemFunc;
+    pthread_mutex_init(&Object->Lock, NULL);
+    pthread_cond_init(&Object->Signal, NULL);
+    pthread_create(&Object->Thread, NULL, WdfHostWorkItemThread, Object);
+
+    *WorkItem = Object;
+    return STATUS_SUCCESS;
+}
+
+static inline void WdfWorkItemEnqueue(WDFWORKITEM WorkItem)
+{
+    pthread_mutex_lock(&WorkItem->Lock);
+    WorkItem->Queued = TRUE;
+    pthread_cond_broadcast(&WorkItem->Signal);
+    pthread_mutex_unlock(&WorkItem->Lock);
+}
+
+static inline void WdfWorkItemFlush(WDFWORKITEM WorkItem)
+{
+    pthread_mutex_lock(&WorkItem->Lock);
+    while (WorkItem->Queued || WorkItem->Running) {
+        pthread_cond_wait(&WorkItem->Signal, &WorkItem->Lock);
+    }
+    pthread_mutex_unlock(&WorkItem->Lock);
+}
+
+//
+// Lookaside lists and the memory objects taken from them
+//
+
+static inline NTSTATUS WdfLookasideListCreate(PWDF_OBJECT_ATTRIBUTES LookasideAttributes,
+    size_t BufferSize, POOL_TYPE PoolType, PWDF_OBJECT_ATTRIBUTES MemoryAttributes,
+    ULONG PoolTag, WDFLOOKASIDE *Lookaside)
+{
+    UNREFERENCED_PARAMETER(LookasideAttributes);
+    UNREFERENCED_PARAMETER(PoolType);
+    UNREFERENCED_PARAMETER(MemoryAttributes);
+    UNREFERENCED_PARAMETER(PoolTag);
+
+    *Lookaside = WdfHostObjectCreate(WdfHostLookaside, 0);
+    if (*Lookaside == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+    (*Lookaside)->BufferSize = BufferSize;
+    return STATUS_SUCCESS;
+}
+
+static inline NTSTATUS WdfMemoryCreateFromLookaside(WDFLOOKASIDE Lookaside, WDFMEMORY *Memory)
+{
+    *Memory = WdfHostObjectCreate(WdfHostMemory, Lookaside->BufferSize);
+    return (*Memory != NULL) ? STATUS_SUCCESS : STATUS_INSUFFICIENT_RESOURCES;
+}
+
+static inline PVOID WdfMemoryGetBuffer(WDFMEMORY Memory, size_t *BufferSize)
+{
+    if (BufferSize != NULL) {
+        *BufferSize = Memory->BufferSize;
+    }
+    return Memory->Context;
+}
+
+//
+// Deleting a work item waits for its callback to return.
+//
+static inline void WdfObjectDelete(WDFOBJECT Object)
+{
+    if (Object->Type == WdfHostWorkItem) {
+        pthread_mutex_lock(&Object->Lock);
+        Object->Exit = TRUE;
+        pthread_cond_broadcast(&Object->Signal);
+        pthread_mutex_unlock(&Object->Lock);
+        pthread_join(Object->Thread, NULL);
+        pthread_cond_destroy(&Object->Signal);
+        pthread_mutex_destroy(&Object->Lock);
+    }
+
+    __atomic_sub_fetch(&g_HostWdfObjects, 1, __ATOMIC_SEQ_CST);
+    free(Object);
+}
+
+#endif
@@ -0,0 +1,8 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host build stand-in, the types used by the tests are in ntddk.h
+//
+
+#pragma once
@@ -0,0 +1,510 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Copyright 2023 NXP
+   Licensed under the MIT License.
+
+Abstract:
+    CAudioConverter class implementation.
+
+*/
+
+#include <wdm.h>
+#include "audioconv.h"
+
+#if defined(_M_ARM64)
+#include <arm64_neon.h>
+#define AUDIOCONV_NEON
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define AUDIOCONV_NEON
+#endif
+
+//
+// Fixed point constants of the coefficient generation, angles are in
+// turns (1 << 32 is a full circle), results in Q30
+//
+#define AUDIOCONV_Q30_ONE               (1LL << 30)
+#define AUDIOCONV_PI_OVER_2_Q30         1686629713LL
+#define AUDIOCONV_PI_Q24                52707179LL
+#define AUDIOCONV_BLACKMAN_A0_Q30       450971566LL     // 0.42
+
+//
+// Windowed sinc cutoff, fraction of the lower of the two Nyquist rates
+//
+#define AUDIOCONV_CUTOFF_NUMERATOR      9
+#define AUDIOCONV_CUTOFF_DENOMINATOR    10
+
+static ULONG
+GreatestCommonDivisor(ULONG A, ULONG B)
+{
+    while (B != 0) {
+        ULONG r = A % B;
+        A = B;
+        B = r;
+    }
+
+    return A;
+}
+
+static LONGLONG
+SinQ30(ULONG Turn)
+{
+    ULONG quadrant = Turn >> 30;
+    LONGLONG offset = Turn & 0x3fffffff;
+    LONGLONG x;
+    LONGLONG x2;
+    LONGLONG t;
+
+    if (quadrant & 1) {
+        offset = AUDIOCONV_Q30_ONE - offset;
+    }
+
+    // Quarter wave, x in [0, pi/2]: Taylor series up to x^11, Horner form
+    x = (offset * AUDIOCONV_PI_OVER_2_Q30) >> 30;
+    x2 = (x * x) >> 30;
+
+    t = AUDIOCONV_Q30_ONE - x2 / 110;
+    t = AUDIOCONV_Q30_ONE - ((x2 * t) >> 30) / 72;
+    t = AUDIOCONV_Q30_ONE - ((x2 * t) >> 30) / 42;
+    t = AUDIOCONV_Q30_ONE - ((x2 * t) >> 30) / 20;
+    t = AUDIOCONV_Q30_ONE - ((x2 * t) >> 30) / 6;
+    t = (x * t) >> 30;
+
+    return (quadrant & 2) ? -t : t;
+}
+
+static LONGLONG
+CosQ30(ULONG Turn)
+{
+    return SinQ30(Turn + 0x40000000);
+}
+
+static LONG
+ReadSample(const UCHAR* Source, ULONG ContainerBytes)
+{
+    switch (ContainerBytes) {
+    case 2:
+        return (LONG)(*(const SHORT*)Source) << 16;
+    case 3:
+        return (LONG)(((ULONG)Source[0] << 8) | ((ULONG)Source[1] << 16) | ((ULONG)Source[2] << 24));
+    default:
+        return *(const LONG*)Source;
+    }
+}
+
+static VOID
+WriteSample(UCHAR* Destination, ULONG ContainerBytes, ULONG ValidBits, LONG Sample)
+{
+    LONGLONG rounded;
+
+    if ((ContainerBytes == 4) && (ValidBits == 32)) {
+        *(LONG*)Destination = Sample;
+        return;
+    }
+
+    // Round to the valid bits, saturating
+    if (ContainerBytes == 2) {
+        rounded = ((LONGLONG)Sample + 0x8000) >> 16;
+        *(SHORT*)Destination = (SHORT)min(rounded, 0x7fffLL);
+        return;
+    }
+
+    rounded = min(((LONGLONG)Sample + 0x80) >> 8, 0x7fffffLL);
+
+    if (ContainerBytes == 3) {
+        Destination[0] = (UCHAR)rounded;
+        Destination[1] = (UCHAR)(rounded >> 8);
+        Destination[2] = (UCHAR)(rounded >> 16);
+    }
+    else {
+        *(LONG*)Destination = (LONG)(rounded << 8);
+    }
+}
+
+static LONG
+FilterTaps(const LONG* Coefficients, const LONG* History, ULONG Taps)
+{
+    LONGLONG sum;
+
+#ifdef AUDIOCONV_NEON
+    int64x2_t acc0 = vdupq_n_s64(0);
+    int64x2_t acc1 = vdupq_n_s64(0);
+
+    // Taps are a multiple of 4
+    for (ULONG k = 0; k < Taps; k += 4) {
+        int32x4_t c = vld1q_s32((const INT32*)(Coefficients + k));
+        int32x4_t h = vld1q_s32((const INT32*)(History + k));
+
+        acc0 = vmlal_s32(acc0, vget_low_s32(c), vget_low_s32(h));
+        acc1 = vmlal_s32(acc1, vget_high_s32(c), vget_high_s32(h));
+    }
+
+    acc0 = vaddq_s64(acc0, acc1);
+    sum = vgetq_lane_s64(acc0, 0) + vgetq_lane_s64(acc0, 1);
+#else
+    sum = 0;
+    for (ULONG k = 0; k < Taps; k++) {
+        sum += (LONGLONG)Coefficients[k] * History[k];
+    }
+#endif
+
+    sum = (sum + (1LL << (AUDIOCONV_COEFFICIENT_SHIFT - 1))) >> AUDIOCONV_COEFFICIENT_SHIFT;
+
+    if (sum > MAXLONG) {
+        return MAXLONG;
+    }
+    if (sum < -(LONGLONG)MAXLONG - 1) {
+        return -MAXLONG - 1;
+    }
+
+    return (LONG)sum;
+}
+
+#pragma code_seg("PAGE")
+BOOLEAN
+CAudioConverter::IsFormatSupported
+(
+    _In_        const AUDIOCONV_FORMAT* Format
+)
+{
+    PAGED_CODE();
+
+    if ((Format->Channels == 0) || (Format->Channels > AUDIOCONV_MAX_CHANNELS)) {
+        return FALSE;
+    }
+
+    if ((Format->SampleRate < AUDIOCONV_MIN_SAMPLE_RATE) || (Format->SampleRate > AUDIOCONV_MAX_SAMPLE_RATE)) {
+        return FALSE;
+    }
+
+    switch (Format->ContainerBytes) {
+    case 2:
+        return (Format->ValidBits == 16);
+    case 3:
+        return (Format->ValidBits == 24);
+    case 4:
+        return ((Format->ValidBits == 24) || (Format->ValidBits == 32));
+    default:
+        return FALSE;
+    }
+}
+
+#pragma code_seg("PAGE")
+BOOLEAN
+CAudioConverter::IsConversionSupported
+(
+    _In_        const AUDIOCONV_FORMAT* Source,
+    _In_        const AUDIOCONV_FORMAT* Destination
+)
+{
+    ULONG divisor;
+
+    PAGED_CODE();
+
+    if (!IsFormatSupported(Source) || !IsFormatSupported(Destination)) {
+        return FALSE;
+    }
+
+    // No channel mixing
+    if (Source->Channels != Destination->Channels) {
+        return FALSE;
+    }
+
+    divisor = GreatestCommonDivisor(Source->SampleRate, Destination->SampleRate);
+
+    if (Destination->SampleRate / divisor > AUDIOCONV_MAX_PHASES) {
+        return FALSE;
+    }
+
+    if (Source->SampleRate > AUDIOCONV_MAX_DECIMATION * Destination->SampleRate) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+#pragma code_seg("PAGE")
+ULONG
+CAudioConverter::GetTapsPerPhase
+(
+                ULONG Interpolation,
+                ULONG Decimation
+)
+{
+    ULONG taps = AUDIOCONV_TAPS;
+
+    PAGED_CODE();
+
+    // The cutoff follows the destination Nyquist rate, the impulse response gets longer
+    if (Decimation > Interpolation) {
+        taps = (AUDIOCONV_TAPS * Decimation + Interpolation - 1) / Interpolation;
+        taps = (taps + 3) & ~3UL;
+    }
+
+    return min(taps, (ULONG)AUDIOCONV_MAX_TAPS);
+}
+
+#pragma code_seg("PAGE")
+ULONG
+CAudioConverter::GetCoefficientCount
+(
+                ULONG SourceRate,
+                ULONG DestinationRate
+)
+{
+    ULONG divisor;
+
+    PAGED_CODE();
+
+    if ((SourceRate == DestinationRate) || (SourceRate == 0) || (DestinationRate == 0)) {
+        return 0;
+    }
+
+    divisor = GreatestCommonDivisor(SourceRate, DestinationRate);
+
+    return (DestinationRate / divisor) * GetTapsPerPhase(DestinationRate / divisor, SourceRate / divisor);
+}
+
+#pragma code_seg("PAGE")
+BOOLEAN
+CAudioConverter::Init
+(
+    _In_        const AUDIOCONV_FORMAT* Source,
+    _In_        const AUDIOCONV_FORMAT* Destination,
+    _In_opt_    LONG* Coefficients,
+                ULONG CoefficientCount
+)
+{
+    ULONG divisor;
+
+    PAGED_CODE();
+
+    if (!IsConversionSupported(Source, Destination)) {
+        return FALSE;
+    }
+
+    m_Source = *Source;
+    m_Destination = *Destination;
+    m_ulSourceBlockAlign = Source->Channels * Source->ContainerBytes;
+    m_ulDestinationBlockAlign = Destination->Channels * Destination->ContainerBytes;
+
+    divisor = GreatestCommonDivisor(Source->SampleRate, Destination->SampleRate);
+    m_ulInterpolation = Destination->SampleRate / divisor;
+    m_ulDecimation = Source->SampleRate / divisor;
+    m_ulTaps = 0;
+    m_plCoefficients = NULL;
+
+    if (IsResampling()) {
+        m_ulTaps = GetTapsPerPhase(m_ulInterpolation, m_ulDecimation);
+
+        if ((Coefficients == NULL) || (CoefficientCount < m_ulInterpolation * m_ulTaps)) {
+            return FALSE;
+        }
+
+        m_plCoefficients = Coefficients;
+        GenerateCoefficients();
+    }
+
+    Reset();
+
+    return TRUE;
+}
+
+#pragma code_seg("PAGE")
+VOID
+CAudioConverter::GenerateCoefficients()
+{
+    ULONG length = m_ulInterpolation * m_ulTaps;
+    LONGLONG cutoffNumerator = AUDIOCONV_CUTOFF_NUMERATOR;
+    LONGLONG cutoffDenominator = AUDIOCONV_CUTOFF_DENOMINATOR;
+
+    PAGED_CODE();
+
+    if (m_ulDecimation > m_ulInterpolation) {
+        cutoffNumerator *= m_ulInterpolation;
+        cutoffDenominator *= m_ulDecimation;
+    }
+
+    for (ULONG phase = 0; phase < m_ulInterpolation; phase++) {
+        LONG* coefficients = m_plCoefficients + phase * m_ulTaps;
+        LONGLONG sum = 0;
+
+        for (ULONG k = 0; k < m_ulTaps; k++) {
+            // Prototype tap n, the newest source frame meets tap 'phase'
+            ULONG n = phase + (m_ulTaps - 1 - k) * m_ulInterpolation;
+            LONGLONG m = 2 * (LONGLONG)n - (length - 1);
+            LONGLONG sinc;
+            LONGLONG window;
+            ULONG turn;
+
+            // sin(pi t) / (pi t), t = cutoff * m / (2 * interpolation)
+            if (m == 0) {
+                sinc = AUDIOCONV_Q30_ONE;
+            }
+            else {
+                LONGLONG x = AUDIOCONV_PI_Q24 * m * cutoffNumerator / (2 * m_ulInterpolation * cutoffDenominator);
+
+                turn = (ULONG)(m * cutoffNumerator * AUDIOCONV_Q30_ONE / (m_ulInterpolation * cutoffDenominator));
+                sinc = (SinQ30(turn) << 24) / x;
+            }
+
+            // Blackman window over the prototype
+            turn = (ULONG)(((ULONGLONG)n << 32) / (length - 1));
+            window = AUDIOCONV_BLACKMAN_A0_Q30 - CosQ30(turn) / 2 + CosQ30(turn * 2) * 2 / 25;
+
+            coefficients[k] = (LONG)((sinc * window) >> 30);
+            sum += coefficients[k];
+        }
+
+        // Unity gain for every phase
+        for (ULONG k = 0; k < m_ulTaps; k++) {
+            coefficients[k] = (LONG)(((LONGLONG)coefficients[k] << AUDIOCONV_COEFFICIENT_SHIFT) / sum);
+        }
+    }
+}
+
+#pragma code_seg()
+VOID
+CAudioConverter::Reset()
+{
+    RtlZeroMemory(m_History, sizeof(m_History));
+
+    m_ulHistoryIndex = 0;
+    m_ulPhase = m_ulInterpolation;
+}
+
+#pragma code_seg()
+ULONG
+CAudioConverter::ConvertFormat
+(
+    _In_        const UCHAR* Source,
+    _Out_       UCHAR* Destination,
+                ULONG Frames
+)
+{
+    ULONG samples = Frames * m_Source.Channels;
+    ULONG sample = 0;
+
+#ifdef AUDIOCONV_NEON
+    if ((m_Source.ContainerBytes == 2) && (m_Destination.ContainerBytes == 4)) {
+        for (; sample + 8 <= samples; sample += 8) {
+            int16x8_t x = vld1q_s16((const INT16*)Source + sample);
+
+            vst1q_s32((INT32*)Destination + sample, vshll_n_s16(vget_low_s16(x), 16));
+            vst1q_s32((INT32*)Destination + sample + 4, vshll_n_s16(vget_high_s16(x), 16));
+        }
+    }
+    else if ((m_Source.ContainerBytes == 4) && (m_Destination.ContainerBytes == 2)) {
+        for (; sample + 8 <= samples; sample += 8) {
+            int32x4_t x0 = vld1q_s32((const INT32*)Source + sample);
+            int32x4_t x1 = vld1q_s32((const INT32*)Source + sample + 4);
+
+            vst1q_s16((INT16*)Destination + sample, vcombine_s16(vqrshrn_n_s32(x0, 16), vqrshrn_n_s32(x1, 16)));
+        }
+    }
+    else if ((m_Source.ContainerBytes == 4) && (m_Destination.ContainerBytes == 4)) {
+        int32x4_t round = vdupq_n_s32((m_Destination.ValidBits == 24) ? 0x80 : 0);
+        int32x4_t mask = vdupq_n_s32((m_Destination.ValidBits == 24) ? (INT32)0xffffff00 : -1);
+
+        for (; sample + 4 <= samples; sample += 4) {
+            int32x4_t x = vld1q_s32((const INT32*)Source + sample);
+
+            vst1q_s32((INT32*)Destination + sample, vandq_s32(vqaddq_s32(x, round), mask));
+        }
+    }
+#endif
+
+    for (; sample < samples; sample++) {
+        WriteSample(Destination + sample * m_Destination.ContainerBytes,
+                    m_Destination.ContainerBytes,
+                    m_Destination.ValidBits,
+                    ReadSample(Source + sample * m_Source.ContainerBytes, m_Source.ContainerBytes));
+    }
+
+    return Frames;
+}
+
+#pragma code_seg()
+VOID
+CAudioConverter::PushFrame
+(
+    _In_        const UCHAR* Source
+)
+{
+    for (ULONG channel = 0; channel < m_Source.Channels; channel++) {
+        LONG sample = ReadSample(Source + channel * m_Source.ContainerBytes, m_Source.ContainerBytes);
+
+        m_History[channel][m_ulHistoryIndex] = sample;
+        m_History[channel][m_ulHistoryIndex + m_ulTaps] = sample;
+    }
+
+    m_ulHistoryIndex += 1;
+    if (m_ulHistoryIndex >= m_ulTaps) {
+        m_ulHistoryIndex = 0;
+    }
+}
+
+#pragma code_seg()
+VOID
+CAudioConverter::FilterFrame
+(
+    _Out_       UCHAR* Destination
+)
+{
+    const LONG* coefficients = m_plCoefficients + m_ulPhase * m_ulTaps;
+
+    for (ULONG channel = 0; channel < m_Destination.Channels; channel++) {
+        LONG sample = FilterTaps(coefficients, &m_History[channel][m_ulHistoryIndex], m_ulTaps);
+
+        WriteSample(Destination + channel * m_Destination.ContainerBytes,
+                    m_Destination.ContainerBytes,
+                    m_Destination.ValidBits,
+                    sample);
+    }
+}
+
+#pragma code_seg()
+ULONG
+CAudioConverter::Convert
+(
+    _In_        const VOID* Source,
+                ULONG SourceFrames,
+    _Out_       ULONG* SourceFramesUsed,
+    _Out_       VOID* Destination,
+                ULONG DestinationFrames
+)
+{
+    const UCHAR* source = (const UCHAR*)Source;
+    UCHAR* destination = (UCHAR*)Destination;
+    ULONG used = 0;
+    ULONG written = 0;
+
+    if (!IsResampling()) {
+        written = ConvertFormat(source, destination, min(SourceFrames, DestinationFrames));
+        *SourceFramesUsed = written;
+        return written;
+    }
+
+    while (written < DestinationFrames) {
+        // Bring the newest source frame up to the output time
+        while (m_ulPhase >= m_ulInterpolation) {
+            if (used == SourceFrames) {
+                goto Done;
+            }
+
+            PushFrame(source);
+            source += m_ulSourceBlockAlign;
+            used += 1;
+            m_ulPhase -= m_ulInterpolation;
+        }
+
+        FilterFrame(destination);
+        destination += m_ulDestinationBlockAlign;
+        written += 1;
+        m_ulPhase += m_ulDecimation;
+    }
+
+Done:
+    *SourceFramesUsed = used;
+
+    return written;
+}
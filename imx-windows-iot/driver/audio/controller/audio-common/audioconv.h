@@ -0,0 +1,139 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Copyright 2023 NXP
+   Licensed under the MIT License.
+
+Abstract:
+    CAudioConverter class declaration, sample rate and sample format
+    conversion between a WaveRT buffer and the device (codec) format.
+
+    Samples are unpacked to 32 bit left justified integers, resampled by a
+    polyphase FIR and packed to the destination format. The rate ratio is
+    reduced to Interpolation/Decimation, the filter has one phase per
+    interpolation step and AUDIOCONV_TAPS taps per phase (more when
+    decimating), its coefficients are generated in fixed point at Init so
+    no floating point state has to be saved. Streams at the device rate
+    only go through the format conversion.
+
+    Only needs the types of wdm.h, so it can be built and benchmarked on
+    the host.
+
+*/
+
+#pragma once
+
+#define AUDIOCONV_MAX_CHANNELS          8
+#define AUDIOCONV_TAPS                  24      // taps per phase, interpolation
+#define AUDIOCONV_MAX_TAPS              48      // taps per phase, decimation
+#define AUDIOCONV_MAX_PHASES            1024
+#define AUDIOCONV_MAX_DECIMATION        4       // Decimation / Interpolation
+#define AUDIOCONV_COEFFICIENT_SHIFT     22      // each phase sums to 1 << AUDIOCONV_COEFFICIENT_SHIFT
+
+#define AUDIOCONV_MIN_SAMPLE_RATE       8000
+#define AUDIOCONV_MAX_SAMPLE_RATE       192000
+
+typedef struct _AUDIOCONV_FORMAT
+{
+    ULONG       SampleRate;
+    ULONG       Channels;
+    ULONG       ContainerBytes;                 // 2, 3 or 4, frames are packed
+    ULONG       ValidBits;                      // 16, 24 or 32
+} AUDIOCONV_FORMAT, *PAUDIOCONV_FORMAT;
+
+class CAudioConverter
+{
+public:
+    CAudioConverter() { }
+    ~CAudioConverter() { }
+
+    static BOOLEAN IsFormatSupported
+    (
+        _In_        const AUDIOCONV_FORMAT* Format
+    );
+
+    static BOOLEAN IsConversionSupported
+    (
+        _In_        const AUDIOCONV_FORMAT* Source,
+        _In_        const AUDIOCONV_FORMAT* Destination
+    );
+
+    // Size of the coefficient table Init needs, 0 for no rate change
+    static ULONG GetCoefficientCount
+    (
+                    ULONG SourceRate,
+                    ULONG DestinationRate
+    );
+
+    // The coefficient table stays owned by the caller and must outlive the converter
+    BOOLEAN Init
+    (
+        _In_        const AUDIOCONV_FORMAT* Source,
+        _In_        const AUDIOCONV_FORMAT* Destination,
+        _In_opt_    LONG* Coefficients,
+                    ULONG CoefficientCount
+    );
+
+    // Clears the filter history, the next output starts at the next input frame
+    VOID Reset();
+
+    // Converts until the source is used up or the destination is full.
+    // Returns the number of destination frames written.
+    ULONG Convert
+    (
+        _In_        const VOID* Source,
+                    ULONG SourceFrames,
+        _Out_       ULONG* SourceFramesUsed,
+        _Out_       VOID* Destination,
+                    ULONG DestinationFrames
+    );
+
+    BOOLEAN IsResampling() { return (m_ulDecimation != m_ulInterpolation); }
+    ULONG GetInterpolation() { return m_ulInterpolation; }
+    ULONG GetDecimation() { return m_ulDecimation; }
+    ULONG GetTapsPerPhase() { return m_ulTaps; }
+
+    // Filter group delay, source frames
+    ULONG GetDelayFrames() { return IsResampling() ? (m_ulTaps / 2) : 0; }
+
+private:
+
+    static ULONG GetTapsPerPhase
+    (
+                    ULONG Interpolation,
+                    ULONG Decimation
+    );
+
+    VOID GenerateCoefficients();
+
+    ULONG ConvertFormat
+    (
+        _In_        const UCHAR* Source,
+        _Out_       UCHAR* Destination,
+                    ULONG Frames
+    );
+
+    VOID PushFrame
+    (
+        _In_        const UCHAR* Source
+    );
+
+    VOID FilterFrame
+    (
+        _Out_       UCHAR* Destination
+    );
+
+    AUDIOCONV_FORMAT    m_Source;
+    AUDIOCONV_FORMAT    m_Destination;
+    ULONG               m_ulSourceBlockAlign;
+    ULONG               m_ulDestinationBlockAlign;
+
+    ULONG               m_ulInterpolation;
+    ULONG               m_ulDecimation;
+    ULONG               m_ulTaps;
+    LONG*               m_plCoefficients;       // m_ulInterpolation phases of m_ulTaps, oldest sample first
+
+    ULONG               m_ulPhase;              // next output, in 1/m_ulInterpolation source frames past the newest
+    ULONG               m_ulHistoryIndex;
+
+    // Each sample is written twice, m_ulTaps apart, so the newest m_ulTaps are always contiguous
+    LONG                m_History[AUDIOCONV_MAX_CHANNELS][2 * AUDIOCONV_MAX_TAPS];
+};
@@ -169,6 +169,7 @@ typedef HRESULT (*PFNCREATEMINIPORT)(
 );
 
 #define ENDPOINT_NO_FLAGS                   0x00000000
+#define ENDPOINT_SOFTWARE_CONVERSION        0x00000001      // Streams may differ from the device format in rate and sample size, the controller converts
 
 //
 // Endpoint miniport pair (wave/topology) descriptor.
@@ -16,6 +16,21 @@ Abstract:
 #define MICIN_MIN_SAMPLE_RATE                  44100   // Min Sample Rate
 #define MICIN_MAX_SAMPLE_RATE                  44100   // Max Sample Rate
 
+//
+// Controllers built with IMX_AUDIO_SOFTWARE_CONVERSION convert the device
+// format above to other rates and sample sizes (CAudioConverter).
+//
+#define MICIN_CONVERTED_MIN_BITS_PER_SAMPLE    16
+#define MICIN_CONVERTED_MAX_BITS_PER_SAMPLE    32
+#define MICIN_CONVERTED_MIN_SAMPLE_RATE        8000
+#define MICIN_CONVERTED_MAX_SAMPLE_RATE        192000
+
+#ifdef IMX_AUDIO_SOFTWARE_CONVERSION
+#define MICIN_DEVICE_FLAGS                     ENDPOINT_SOFTWARE_CONVERSION
+#else
+#define MICIN_DEVICE_FLAGS                     ENDPOINT_NO_FLAGS
+#endif
+
 
 
 NTSTATUS 
@@ -132,13 +147,35 @@ KSDATARANGE_AUDIO MicInPinDataRangesStream[] =
         MICIN_MIN_SAMPLE_RATE,            
         MICIN_MAX_SAMPLE_RATE             
     },
+#ifdef IMX_AUDIO_SOFTWARE_CONVERSION
+    { // 1
+        {
+            sizeof(KSDATARANGE_AUDIO),
+            KSDATARANGE_ATTRIBUTES,         // An attributes list follows this data range
+            0,
+            0,
+            STATICGUIDOF(KSDATAFORMAT_TYPE_AUDIO),
+            STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM),
+            STATICGUIDOF(KSDATAFORMAT_SPECIFIER_WAVEFORMATEX)
+        },
+        MICIN_DEVICE_MAX_CHANNELS,
+        MICIN_CONVERTED_MIN_BITS_PER_SAMPLE,
+        MICIN_CONVERTED_MAX_BITS_PER_SAMPLE,
+        MICIN_CONVERTED_MIN_SAMPLE_RATE,
+        MICIN_CONVERTED_MAX_SAMPLE_RATE
+    },
+#endif
 };
 
 static
 PKSDATARANGE MicInPinDataRangePointersStream[] =
 {
     PKSDATARANGE(&MicInPinDataRangesStream[0]),
+    PKSDATARANGE(&PinDataRangeAttributeList),
+#ifdef IMX_AUDIO_SOFTWARE_CONVERSION
+    PKSDATARANGE(&MicInPinDataRangesStream[1]),
     PKSDATARANGE(&PinDataRangeAttributeList)
+#endif
 };
 
 //=============================================================================
@@ -81,7 +81,7 @@ ENDPOINT_MINIPAIR SpeakerHpMiniports =
     SIZEOF_ARRAY(SpeakerHpPinDeviceFormatsAndModes),
     SpeakerHpTopologyPhysicalConnections,
     SIZEOF_ARRAY(SpeakerHpTopologyPhysicalConnections),
-    ENDPOINT_NO_FLAGS
+    SPEAKERHP_DEVICE_FLAGS
 };
 
 //=============================================================================
@@ -122,7 +122,7 @@ ENDPOINT_MINIPAIR MicInMiniports =
     SIZEOF_ARRAY(MicInPinDeviceFormatsAndModes),
     MicInTopologyPhysicalConnections,
     SIZEOF_ARRAY(MicInTopologyPhysicalConnections),
-    ENDPOINT_NO_FLAGS
+    MICIN_DEVICE_FLAGS
 };
 
 //=============================================================================
@@ -979,9 +979,130 @@ Return Value:
         break;
     }
 
+    if ((ntStatus == STATUS_NO_MATCH) && IsConversionEnabled())
+    {
+        ntStatus = IsConvertibleFormat(Pin, DataFormat);
+    }
+
     return ntStatus;
 }    
 
+//=============================================================================
+#pragma code_seg("PAGE")
+_Use_decl_annotations_
+BOOLEAN
+CMiniportWaveRT::GetConverterFormat
+(
+    _In_  PWAVEFORMATEX     WaveFormat,
+    _Out_ PAUDIOCONV_FORMAT Format
+)
+/*++
+
+Routine Description:
+
+    Describes a PCM format for CAudioConverter.
+
+Arguments:
+
+    WaveFormat - the format to describe
+
+    Format - the converter format
+
+Return Value:
+
+    TRUE if the converter handles the format
+
+--*/
+{
+    PAGED_CODE();
+
+    RtlZeroMemory(Format, sizeof(*Format));
+
+    if (WaveFormat->wFormatTag == WAVE_FORMAT_EXTENSIBLE)
+    {
+        PWAVEFORMATEXTENSIBLE pWaveFormatExt = reinterpret_cast<PWAVEFORMATEXTENSIBLE>(WaveFormat);
+
+        if (WaveFormat->cbSize < sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX)) { return FALSE; }
+        if (!IsEqualGUIDAligned(pWaveFormatExt->SubFormat, KSDATAFORMAT_SUBTYPE_PCM)) { return FALSE; }
+
+        Format->ValidBits = pWaveFormatExt->Samples.wValidBitsPerSample;
+    }
+    else if (WaveFormat->wFormatTag == WAVE_FORMAT_PCM)
+    {
+        Format->ValidBits = WaveFormat->wBitsPerSample;
+    }
+    else
+    {
+        return FALSE;
+    }
+
+    Format->SampleRate = WaveFormat->nSamplesPerSec;
+    Format->Channels = WaveFormat->nChannels;
+    Format->ContainerBytes = WaveFormat->wBitsPerSample / 8;
+
+    // Frames are packed
+    if (WaveFormat->nBlockAlign != Format->Channels * Format->ContainerBytes) { return FALSE; }
+
+    return CAudioConverter::IsFormatSupported(Format);
+}
+
+//=============================================================================
+#pragma code_seg("PAGE")
+_Use_decl_annotations_
+NTSTATUS
+CMiniportWaveRT::IsConvertibleFormat
+(
+    _In_ ULONG          Pin,
+    _In_ PKSDATAFORMAT  DataFormat
+)
+/*++
+
+Routine Description:
+
+    Checks if a format the pin does not support can be converted to (render)
+    or from (capture) the device format of the pin.
+
+Arguments:
+
+    Pin - pin id
+
+    DataFormat - the format to check for
+
+Return Value:
+
+    NT status code
+
+--*/
+{
+    PAGED_CODE();
+
+    PWAVEFORMATEXTENSIBLE   pDeviceFormat = GetDeviceFormat(Pin);
+    PWAVEFORMATEX           pWaveFormat = NULL;
+    AUDIOCONV_FORMAT        streamFormat;
+    AUDIOCONV_FORMAT        deviceFormat;
+
+    if (!IsEqualGUIDAligned(DataFormat->MajorFormat, KSDATAFORMAT_TYPE_AUDIO)) { return STATUS_NO_MATCH; }
+    if (!IsEqualGUIDAligned(DataFormat->Specifier, KSDATAFORMAT_SPECIFIER_WAVEFORMATEX)) { return STATUS_NO_MATCH; }
+    if (DataFormat->FormatSize < sizeof(KSDATAFORMAT_WAVEFORMATEX)) { return STATUS_NO_MATCH; }
+
+    pWaveFormat = reinterpret_cast<PWAVEFORMATEX>(DataFormat + 1);
+
+    if (!GetConverterFormat(pWaveFormat, &streamFormat)) { return STATUS_NO_MATCH; }
+    if (!GetConverterFormat(&pDeviceFormat->Format, &deviceFormat)) { return STATUS_NO_MATCH; }
+
+    if ((pWaveFormat->wFormatTag == WAVE_FORMAT_EXTENSIBLE) &&
+        (reinterpret_cast<PWAVEFORMATEXTENSIBLE>(pWaveFormat)->dwChannelMask != pDeviceFormat->dwChannelMask))
+    {
+        return STATUS_NO_MATCH;
+    }
+
+    // Channels are not mixed, the converter checks they match
+    if (!CAudioConverter::IsConversionSupported(&streamFormat, &deviceFormat)) { return STATUS_NO_MATCH; }
+    if (!CAudioConverter::IsConversionSupported(&deviceFormat, &streamFormat)) { return STATUS_NO_MATCH; }
+
+    return STATUS_SUCCESS;
+}
+
 //=============================================================================
 #pragma code_seg("PAGE")
 _Use_decl_annotations_
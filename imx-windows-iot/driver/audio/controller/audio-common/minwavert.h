@@ -8,6 +8,8 @@ Abstract:
 
 #pragma once
 
+#include "audioconv.h"
+
 //=============================================================================
 // Referenced Forward
 //=============================================================================
@@ -39,6 +41,10 @@ private:
     ULONG                               m_DeviceFormatsAndModesCount; 
     USHORT                              m_DeviceMaxChannels;
 
+    // Largest position step measured on the streams of this miniport, 100ns units
+    // since the streams can run at different rates
+    ULONG                               m_ulPositionStep100ns;
+
     union {
         PVOID                           m_DeviceContext;
     };
@@ -91,6 +97,12 @@ public:
         _In_ PKSDATAFORMAT  _pDataFormat
     );
 
+    NTSTATUS IsConvertibleFormat
+    (
+        _In_ ULONG          _ulPin,
+        _In_ PKSDATAFORMAT  _pDataFormat
+    );
+
     static NTSTATUS GetAttributesFromAttributeList
     (
         _In_ const KSMULTIPLE_ITEM *_pAttributes,
@@ -99,6 +111,36 @@ public:
     );
 
     eDeviceType GetDeviceType() { return m_DeviceType; }
+
+    ULONG GetPositionStep100ns() { return m_ulPositionStep100ns; }
+
+    VOID UpdatePositionStep100ns(ULONG Step100ns)
+    {
+        if (Step100ns > m_ulPositionStep100ns)
+        {
+            m_ulPositionStep100ns = Step100ns;
+        }
+    }
+
+    BOOLEAN IsConversionEnabled() { return ((m_DeviceFlags & ENDPOINT_SOFTWARE_CONVERSION) != 0); }
+
+    // Format of the samples on the bus, the first format of the pin
+    PWAVEFORMATEXTENSIBLE GetDeviceFormat(_In_ ULONG Pin)
+    {
+        PKSDATAFORMAT_WAVEFORMATEXTENSIBLE pPinFormats = NULL;
+
+        PAGED_CODE();
+
+        GetPinSupportedDeviceFormats(Pin, &pPinFormats);
+
+        return &pPinFormats->WaveFormatExt;
+    }
+
+    static BOOLEAN GetConverterFormat
+    (
+        _In_  PWAVEFORMATEX     _pWaveFormat,
+        _Out_ PAUDIOCONV_FORMAT _pFormat
+    );
 public:
     DECLARE_STD_UNKNOWN();
 
@@ -116,7 +158,8 @@ public:
         m_DeviceFormatsAndModesCount(MiniportPair->PinDeviceFormatsAndModesCount),
         m_DeviceFlags(MiniportPair->DeviceFlags),
         m_pMiniportPair(MiniportPair),
-        m_pStream(NULL)
+        m_pStream(NULL),
+        m_ulPositionStep100ns(0)
     {
         PAGED_CODE();
 
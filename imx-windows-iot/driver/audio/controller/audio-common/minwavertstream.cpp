@@ -46,6 +46,8 @@ Return Value:
 
     if (NULL != m_pMiniport)
     {
+        UpdateMiniportPositionStep();
+
         if (m_bUnregisterStream)
         {
             m_pMiniport->StreamClosed(m_ulPin, this);
@@ -56,6 +58,20 @@ Return Value:
         m_pMiniport = NULL;
     }
 
+    if (m_pConverter)
+    {
+        ReportConverterCost();
+
+        delete m_pConverter;
+        m_pConverter = NULL;
+    }
+
+    if (m_plConverterCoefficients)
+    {
+        ExFreePoolWithTag( m_plConverterCoefficients, MINWAVERTSTREAM_POOLTAG );
+        m_plConverterCoefficients = NULL;
+    }
+
     if (m_pWfExt)
     {
         ExFreePoolWithTag( m_pWfExt, MINWAVERTSTREAM_POOLTAG );
@@ -123,9 +139,20 @@ Return Value:
     m_DataBuffer = NULL;
     m_KsState = KSSTATE_STOP;
     m_ulNotificationsPerBuffer = 0;
+    m_ulPeriodsPerBuffer = 0;
 
     m_ulSamplesTransferred = 0;
+    m_ulVirtualPosition = 0;
+    m_ulVirtualClock = 0;
     m_pWfExt = NULL;
+    m_pDeviceFormat = NULL;
+    m_pConverter = NULL;
+    m_plConverterCoefficients = NULL;
+    m_ulConverterFrame = 0;
+    m_ulConvertedFrames = 0;
+    m_ullConverterTicks = 0;
+    m_ullConverterTicksMax = 0;
+    m_ullConverterFramesTimed = 0;
     m_SignalProcessingMode = SignalProcessingMode;
 
     m_pPortStream = PortStream;
@@ -164,6 +191,12 @@ Return Value:
     }
     RtlCopyMemory(m_pWfExt, pWfEx, sizeof(WAVEFORMATEX) + pWfEx->cbSize);
 
+    ntStatus = InitConverter();
+    if (!NT_SUCCESS(ntStatus))
+    {
+        return ntStatus;
+    }
+
     //
     // Register this stream.
     //
@@ -176,6 +209,92 @@ Return Value:
     return ntStatus;
 }
 
+//=============================================================================
+#pragma code_seg("PAGE")
+NTSTATUS
+CMiniportWaveRTStream::InitConverter
+(
+    VOID
+)
+/*++
+
+Routine Description:
+
+    Sets up the converter of a stream whose rate or sample size differs from
+    the device format, on endpoints with ENDPOINT_SOFTWARE_CONVERSION.
+
+Arguments:
+
+    None
+
+Return Value:
+
+    NT status code
+
+--*/
+{
+    PAGED_CODE();
+
+    AUDIOCONV_FORMAT    streamFormat;
+    AUDIOCONV_FORMAT    deviceFormat;
+    PAUDIOCONV_FORMAT   source;
+    PAUDIOCONV_FORMAT   destination;
+    ULONG               coefficientCount;
+
+    m_pDeviceFormat = m_pWfExt;
+
+    if (!m_pMiniport->IsConversionEnabled())
+    {
+        return STATUS_SUCCESS;
+    }
+
+    // Formats the converter does not handle were matched exactly by IsFormatSupported
+    if (!CMiniportWaveRT::GetConverterFormat(&m_pWfExt->Format, &streamFormat) ||
+        !CMiniportWaveRT::GetConverterFormat(&m_pMiniport->GetDeviceFormat(m_ulPin)->Format, &deviceFormat))
+    {
+        return STATUS_SUCCESS;
+    }
+
+    if ((streamFormat.SampleRate == deviceFormat.SampleRate) &&
+        (streamFormat.ContainerBytes == deviceFormat.ContainerBytes) &&
+        (streamFormat.ValidBits == deviceFormat.ValidBits))
+    {
+        return STATUS_SUCCESS;
+    }
+
+    m_pDeviceFormat = m_pMiniport->GetDeviceFormat(m_ulPin);
+
+    source = m_bCapture ? &deviceFormat : &streamFormat;
+    destination = m_bCapture ? &streamFormat : &deviceFormat;
+
+    coefficientCount = CAudioConverter::GetCoefficientCount(source->SampleRate, destination->SampleRate);
+    if (coefficientCount != 0)
+    {
+        m_plConverterCoefficients = (LONG*)ExAllocatePoolWithTag(NonPagedPoolNx, coefficientCount * sizeof(LONG), MINWAVERTSTREAM_POOLTAG);
+        if (m_plConverterCoefficients == NULL)
+        {
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+    }
+
+    m_pConverter = new (NonPagedPoolNx, MINWAVERTSTREAM_POOLTAG) CAudioConverter();
+    if (m_pConverter == NULL)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    if (!m_pConverter->Init(source, destination, m_plConverterCoefficients, coefficientCount))
+    {
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    DPF(D_TERSE, ("[CMiniportWaveRTStream::InitConverter] %u Hz %u bits -> %u Hz %u bits, %u phases of %u taps",
+        source->SampleRate, source->ValidBits, destination->SampleRate, destination->ValidBits,
+        m_pConverter->GetInterpolation(), m_pConverter->GetTapsPerPhase()));
+
+    return STATUS_SUCCESS;
+}
+
 //=============================================================================
 #pragma code_seg("PAGE")
 _Use_decl_annotations_
@@ -291,6 +410,9 @@ CMiniportWaveRTStream::AllocateBufferCommon
     m_ulNotificationsPerBuffer = NotificationCount;
     m_ulDmaBufferSize = RequestedSize;
     m_DataBufferMdl = pBufferMdl;
+    m_ulPeriodsPerBuffer = GetPeriodsPerBuffer(NotificationCount);
+
+    m_Position.Init(RequestedSize, m_pWfExt->Format.nBlockAlign, NotificationCount);
 
     ntStatus = m_pAdapterCommon->RegisterStream(this, m_pMiniport->GetDeviceType());
 
@@ -318,6 +440,105 @@ CMiniportWaveRTStream::AllocateBufferCommon
     return ntStatus;
 }
 
+//=============================================================================
+#pragma code_seg("PAGE")
+ULONG
+CMiniportWaveRTStream::GetPeriodsPerBuffer
+(
+    ULONG NotificationCount
+)
+/*++
+
+Routine Description:
+
+    Splits the buffer in periods the controllers update the position at. The
+    notification intervals are halved as long as they are longer than
+    MINWAVERT_PERIOD_100NS and still divide the buffer in whole frames.
+
+Arguments:
+
+    NotificationCount - number of notifications per buffer, 0 if none
+
+Return Value:
+
+    Number of periods per buffer
+
+--*/
+{
+    ULONG periods;
+    ULONG periodBytes;
+
+    PAGED_CODE();
+
+    periods = (NotificationCount != 0) ? NotificationCount : 1;
+    periodBytes = (ULONG)(((ULONGLONG)m_pWfExt->Format.nAvgBytesPerSec * MINWAVERT_PERIOD_100NS) / _100NS_PER_SECOND);
+
+    while ((periods * 2 <= MINWAVERT_MAX_PERIODS_PER_BUFFER) &&
+           (m_ulDmaBufferSize / periods > periodBytes) &&
+           (m_ulDmaBufferSize % (periods * 2 * m_pWfExt->Format.nBlockAlign) == 0))
+    {
+        periods *= 2;
+    }
+
+    return periods;
+}
+
+//=============================================================================
+#pragma code_seg()
+ULONG
+CMiniportWaveRTStream::GetPositionStepFrames
+(
+    VOID
+)
+/*++
+
+Routine Description:
+
+    Largest position step measured on this stream or the earlier streams of
+    the miniport, that is how far the position can lag behind the hardware.
+    In frames of the stream format.
+
+--*/
+{
+    ULONG sampleRate = m_pWfExt->Format.nSamplesPerSec;
+    ULONG stepFrames;
+
+    // The earlier streams may have run at another rate, their step is kept as a time
+    stepFrames = (ULONG)(((ULONGLONG)m_pMiniport->GetPositionStep100ns() * sampleRate + _100NS_PER_SECOND - 1) / _100NS_PER_SECOND);
+
+    stepFrames = max(m_Position.GetMaxStepFrames(), stepFrames);
+    if (stepFrames == 0)
+    {
+        stepFrames = MINWAVERT_DEFAULT_STEP_FRAMES;
+    }
+
+    return stepFrames;
+}
+
+//=============================================================================
+#pragma code_seg("PAGE")
+VOID
+CMiniportWaveRTStream::UpdateMiniportPositionStep
+(
+    VOID
+)
+/*++
+
+Routine Description:
+
+    Hands the largest position step of this stream to the miniport, for
+    the streams opened later.
+
+--*/
+{
+    ULONG stepFrames = m_Position.GetMaxStepFrames();
+
+    if ((stepFrames != 0) && (m_pWfExt != NULL) && (m_pWfExt->Format.nSamplesPerSec != 0))
+    {
+        m_pMiniport->UpdatePositionStep100ns((ULONG)(((ULONGLONG)stepFrames * _100NS_PER_SECOND + m_pWfExt->Format.nSamplesPerSec - 1) / m_pWfExt->Format.nSamplesPerSec));
+    }
+}
+
 //=============================================================================
 #pragma code_seg("PAGE")
 _Use_decl_annotations_
@@ -423,8 +644,12 @@ Return Value:
     }
 
     m_ulNotificationsPerBuffer = 0;
+    m_ulPeriodsPerBuffer = 0;
     m_ulDmaBufferSize = 0;
 
+    UpdateMiniportPositionStep();
+    m_Position.Init(0, m_pWfExt->Format.nBlockAlign, 0);
+
     return;
 }
 
@@ -572,6 +797,9 @@ Routine Description:
 
     Provides hardware clock regster information.
 
+    The clock counts the frames moved by the controller since the stream start,
+    updated together with the position register.
+
 Arguments:
 
     Register - HW clock register info
@@ -584,11 +812,15 @@ Return Value:
 {
     PAGED_CODE();
 
-    UNREFERENCED_PARAMETER(Register);
+    DPF_ENTER(("[CMiniportWaveRTStream::GetClockRegister]"));
 
-    DPF(D_TERSE, ("[CMiniportWaveRTStream::GetClockRegister] Not supported"));
+    Register->Register = &m_ulVirtualClock;
+    Register->Width = 32; // bits.
+    Register->Numerator = m_pWfExt->Format.nSamplesPerSec;
+    Register->Denominator = 1;
+    Register->Accuracy = GetPositionStepFrames();
 
-    return STATUS_NOT_IMPLEMENTED;
+    return STATUS_SUCCESS;
 }
 
 //=============================================================================
@@ -623,7 +855,7 @@ Return Value:
 
     Register->Register = &m_ulVirtualPosition;
     Register->Width = 32; // bits.
-    Register->Accuracy = 15 * m_pWfExt->Format.nBlockAlign;
+    Register->Accuracy = GetPositionStepFrames() * m_pWfExt->Format.nBlockAlign;
 
     return STATUS_SUCCESS;
 }
@@ -657,8 +889,15 @@ Return Value:
     ASSERT(Latency);
 
     Latency->ChipsetDelay = 0;
+    if (m_pConverter != NULL)
+    {
+        // Filter group delay, in source frames
+        ULONG sourceRate = m_bCapture ? m_pDeviceFormat->Format.nSamplesPerSec : m_pWfExt->Format.nSamplesPerSec;
+
+        Latency->ChipsetDelay = (ULONG)((ULONGLONG)m_pConverter->GetDelayFrames() * _100NS_PER_SECOND / sourceRate);
+    }
     Latency->CodecDelay = 1 * _100NS_PER_MILLISECOND; // MSDN says to 'guess'.
-    Latency->FifoSize = m_pWfExt->Format.nBlockAlign * 15; // Number of bytes in the fifo. This is block align * 15.
+    Latency->FifoSize = GetPositionStepFrames() * m_pWfExt->Format.nBlockAlign; // Bytes of the stream format in the fifo, as measured from the position steps.
 }
 
 //=============================================================================
@@ -851,7 +1090,7 @@ Return Value:
     //Parameter 4: 0
     PADAPTERCOMMON  pAdapterComm = m_pMiniport->GetAdapterCommObj();
     pAdapterComm->WriteEtwEvent(eMINIPORT_PIN_STATE,
-                                (m_ulSamplesTransferred * m_pWfExt->Format.nBlockAlign / 2) %  m_ulDmaBufferSize, 
+                                m_Position.GetLinearPosition(), 
                                 0,
                                 State,
                                 0); 
@@ -871,6 +1110,14 @@ Return Value:
 
             m_ulSamplesTransferred = 0;
             m_ulVirtualPosition = 0;
+            m_ulVirtualClock = 0;
+            m_Position.Reset();
+
+            if (m_pConverter != NULL)
+            {
+                ReportConverterCost();
+                m_pConverter->Reset();
+            }
 
             break;
 
@@ -969,42 +1216,231 @@ Return Value:
 
 --*/
 {
-    ULONG oldPosition, newPosition;
-    BOOLEAN updateClients = FALSE;
+    BOOLEAN updateClients;
 
     //
-    // Compute if we need to notify clients.
-    //
-    // m_ulNotificationsPerBuffer can be set to either 1 or 2.  If set to 1, we notify when the DMA pointer wraps around 
-    // the end of the buffer.  If set to two, we notify when the new position wraps around the end of the buffer or passes
-    // the 50% marker.
+    // Clients are notified each time the position passes one of the m_ulNotificationsPerBuffer
+    // boundaries of the buffer, or wraps around the end of the buffer if no notifications were requested.
     //
 
     m_ulSamplesTransferred = TotalSamplesTransferred;
 
-    oldPosition = m_ulVirtualPosition;
-    newPosition = (m_ulSamplesTransferred * m_pWfExt->Format.nBlockAlign) % m_ulDmaBufferSize;
+    updateClients = m_Position.Update(TotalSamplesTransferred);
+
+    m_ulVirtualPosition = m_Position.GetPosition();
+    m_ulVirtualClock = (ULONG)m_Position.GetLinearFrames();
 
-    if ((m_ulNotificationsPerBuffer == 2) && 
-        (newPosition >= m_ulDmaBufferSize / 2) && 
-        (oldPosition < (m_ulDmaBufferSize / 2)))
+    if (updateClients == TRUE && m_KsState == KSSTATE_RUN)
     {
-        updateClients = TRUE;
+        KeInsertQueueDpc(&m_Dpc, NULL, NULL);
     }
+}
 
-    if (newPosition < oldPosition)
+//=============================================================================
+#pragma code_seg()
+VOID
+CMiniportWaveRTStream::AdvanceConverterFrame
+(
+    ULONG Frames
+)
+{
+    ULONG bufferFrames = m_ulDmaBufferSize / m_pWfExt->Format.nBlockAlign;
+
+    m_ulConverterFrame += Frames;
+    if (m_ulConverterFrame >= bufferFrames)
     {
-        // We have wrapped - always notify.
-        updateClients = TRUE;
+        m_ulConverterFrame -= bufferFrames;
     }
 
-    m_ulVirtualPosition = newPosition;
+    m_ulConvertedFrames += Frames;
+}
 
-    if (updateClients == TRUE && m_KsState == KSSTATE_RUN)
+//=============================================================================
+#pragma code_seg()
+VOID
+CMiniportWaveRTStream::UpdateConverterCost
+(
+    LARGE_INTEGER StartTime,
+    ULONG Frames
+)
+{
+    ULONGLONG ticks = (ULONGLONG)(KeQueryPerformanceCounter(NULL).QuadPart - StartTime.QuadPart);
+
+    m_ullConverterTicks += ticks;
+    m_ullConverterFramesTimed += Frames;
+    if (ticks > m_ullConverterTicksMax)
     {
-        KeInsertQueueDpc(&m_Dpc, NULL, NULL);
+        m_ullConverterTicksMax = ticks;
     }
 }
+
+//=============================================================================
+#pragma code_seg()
+VOID
+CMiniportWaveRTStream::ReportConverterCost
+(
+    VOID
+)
+/*++
+
+Routine Description:
+
+    Prints the CPU share the conversion took since the last report, in
+    thousandths of the stream time, and the longest call.
+
+Arguments:
+
+    None
+
+Return Value:
+
+    None
+
+--*/
+{
+    ULONGLONG streamTicks;
+
+    if (m_ullConverterFramesTimed == 0)
+    {
+        return;
+    }
+
+    streamTicks = m_ullConverterFramesTimed * m_PerformanceCounterFrequency.QuadPart / m_pWfExt->Format.nSamplesPerSec;
+
+    DPF(D_TERSE, ("[CMiniportWaveRTStream::ReportConverterCost] %I64u frames, load %I64u/1000, max %I64u us",
+        m_ullConverterFramesTimed,
+        (streamTicks != 0) ? (m_ullConverterTicks * 1000 / streamTicks) : 0,
+        m_ullConverterTicksMax * 1000000 / m_PerformanceCounterFrequency.QuadPart));
+
+    m_ullConverterTicks = 0;
+    m_ullConverterTicksMax = 0;
+    m_ullConverterFramesTimed = 0;
+}
+
+//=============================================================================
+#pragma code_seg()
+_Use_decl_annotations_
+ULONG
+CMiniportWaveRTStream::ConvertFromBuffer
+(
+    PVOID Destination,
+    ULONG DestinationFrames
+)
+/*++
+
+Routine Description:
+
+    Converts frames from the WaveRT buffer to the device format, render.
+
+Arguments:
+
+    Destination - device frames
+
+    DestinationFrames - number of device frames to write
+
+Return Value:
+
+    Number of device frames written
+
+--*/
+{
+    LARGE_INTEGER   startTime = KeQueryPerformanceCounter(NULL);
+    ULONG           bufferFrames = m_ulDmaBufferSize / m_pWfExt->Format.nBlockAlign;
+    PUCHAR          destination = (PUCHAR)Destination;
+    ULONG           written = 0;
+    ULONG           used = 0;
+    ULONG           convertedFrames = m_ulConvertedFrames;
+
+    if ((m_pConverter == NULL) || (m_DataBuffer == NULL) || (bufferFrames == 0))
+    {
+        return 0;
+    }
+
+    while (written < DestinationFrames)
+    {
+        ULONG frames = m_pConverter->Convert((PUCHAR)m_DataBuffer + m_ulConverterFrame * m_pWfExt->Format.nBlockAlign,
+                                             bufferFrames - m_ulConverterFrame,
+                                             &used,
+                                             destination,
+                                             DestinationFrames - written);
+
+        AdvanceConverterFrame(used);
+        destination += frames * m_pDeviceFormat->Format.nBlockAlign;
+        written += frames;
+
+        if ((frames == 0) && (used == 0))
+        {
+            break;
+        }
+    }
+
+    UpdateConverterCost(startTime, m_ulConvertedFrames - convertedFrames);
+
+    return written;
+}
+
+//=============================================================================
+#pragma code_seg()
+_Use_decl_annotations_
+ULONG
+CMiniportWaveRTStream::ConvertToBuffer
+(
+    PVOID Source,
+    ULONG SourceFrames
+)
+/*++
+
+Routine Description:
+
+    Converts device frames to the stream format into the WaveRT buffer, capture.
+
+Arguments:
+
+    Source - device frames
+
+    SourceFrames - number of device frames to read
+
+Return Value:
+
+    Number of device frames read
+
+--*/
+{
+    LARGE_INTEGER   startTime = KeQueryPerformanceCounter(NULL);
+    ULONG           bufferFrames = m_ulDmaBufferSize / m_pWfExt->Format.nBlockAlign;
+    PUCHAR          source = (PUCHAR)Source;
+    ULONG           read = 0;
+    ULONG           used = 0;
+    ULONG           convertedFrames = m_ulConvertedFrames;
+
+    if ((m_pConverter == NULL) || (m_DataBuffer == NULL) || (bufferFrames == 0))
+    {
+        return 0;
+    }
+
+    while (read < SourceFrames)
+    {
+        ULONG frames = m_pConverter->Convert(source,
+                                             SourceFrames - read,
+                                             &used,
+                                             (PUCHAR)m_DataBuffer + m_ulConverterFrame * m_pWfExt->Format.nBlockAlign,
+                                             bufferFrames - m_ulConverterFrame);
+
+        AdvanceConverterFrame(frames);
+        source += used * m_pDeviceFormat->Format.nBlockAlign;
+        read += used;
+
+        if ((frames == 0) && (used == 0))
+        {
+            break;
+        }
+    }
+
+    UpdateConverterCost(startTime, m_ulConvertedFrames - convertedFrames);
+
+    return read;
+}
+
 #pragma code_seg()
 VOID
 CMiniportWaveRTStream::DpcCallback
@@ -10,8 +10,21 @@ Abstract:
 #pragma once
 
 #include "common.h"
+#include "wavertposition.h"
+#include "audioconv.h"
 
 #define _100NS_PER_MILLISECOND           (10000)        // number of 100ns units per millisecond
+#define _100NS_PER_SECOND                (10000000)
+
+//
+// Low latency: the buffer is split in periods of at most MINWAVERT_PERIOD_100NS, the controllers
+// update the position at least once per period. Notifications stay at the requested count.
+//
+#define MINWAVERT_PERIOD_100NS           (1 * _100NS_PER_MILLISECOND)
+#define MINWAVERT_MAX_PERIODS_PER_BUFFER (32)
+
+// Position step reported until one has been measured, frames
+#define MINWAVERT_DEFAULT_STEP_FRAMES    (15)
 
 //=============================================================================
 // Referenced Forward
@@ -64,6 +77,31 @@ public:
     PWAVEFORMATEXTENSIBLE       GetDataFormat() { return m_pWfExt; }
     PMDL GetDmaBufferMdl() { return m_DataBufferMdl; }
     ULONG GetNotificationsPerBuffer() { return m_ulNotificationsPerBuffer; }
+    ULONG GetPeriodsPerBuffer() { return m_ulPeriodsPerBuffer; }
+    ULONG GetPacketCount() { return m_Position.GetPacketCount(); }
+
+    //
+    // Streams in another rate or sample size than the device format go through
+    // a converter (ENDPOINT_SOFTWARE_CONVERSION). The controller moves device
+    // frames and reports the WaveRT buffer frames the converter has moved.
+    //
+    BOOLEAN IsConverting() { return (m_pConverter != NULL); }
+    PWAVEFORMATEXTENSIBLE GetDeviceFormat() { return m_pDeviceFormat; }
+    ULONG GetConvertedFrames() { return m_ulConvertedFrames; }
+
+    // Render, returns the number of device frames written
+    ULONG ConvertFromBuffer
+    (
+        _Out_ PVOID Destination,
+        ULONG DestinationFrames
+    );
+
+    // Capture, returns the number of device frames read
+    ULONG ConvertToBuffer
+    (
+        _In_ PVOID Source,
+        ULONG SourceFrames
+    );
 
 protected:
     CMiniportWaveRT*            m_pMiniport;
@@ -74,10 +112,21 @@ protected:
     PMDL                        m_DataBufferMdl;
     LIST_ENTRY                  m_NotificationList;
     ULONG                       m_ulNotificationsPerBuffer;
+    ULONG                       m_ulPeriodsPerBuffer;
     LARGE_INTEGER               m_PerformanceCounterFrequency;
     BOOLEAN                     m_bCapture;
 
     ULONG                       m_ulSamplesTransferred;
+    CWaveRtPosition             m_Position;
+
+    PWAVEFORMATEXTENSIBLE       m_pDeviceFormat;
+    CAudioConverter*            m_pConverter;
+    LONG*                       m_plConverterCoefficients;
+    ULONG                       m_ulConverterFrame;             // next frame of the WaveRT buffer
+    ULONG                       m_ulConvertedFrames;            // WaveRT buffer frames since the stream creation
+    ULONGLONG                   m_ullConverterTicks;            // CPU cost of the conversion, performance counter ticks
+    ULONGLONG                   m_ullConverterTicksMax;         // longest call
+    ULONGLONG                   m_ullConverterFramesTimed;
 
     KSSTATE                     m_KsState;
     KDPC                        m_Dpc;
@@ -92,7 +141,8 @@ protected:
     //
 
     ULONG                       m_ulVirtualPosition;           // byte offset into the buffer
-    ULONG                       m_ulReserved[7];    
+    ULONG                       m_ulVirtualClock;              // frames since the stream start
+    ULONG                       m_ulReserved[6];    
 
 
 
@@ -128,6 +178,42 @@ private:
 
     static KDEFERRED_ROUTINE DpcCallback;
 
+    ULONG GetPeriodsPerBuffer
+    (
+        ULONG NotificationCount
+    );
+
+    ULONG GetPositionStepFrames
+    (
+        VOID
+    );
+
+    VOID UpdateMiniportPositionStep
+    (
+        VOID
+    );
+
+    NTSTATUS InitConverter
+    (
+        VOID
+    );
+
+    VOID AdvanceConverterFrame
+    (
+        ULONG Frames
+    );
+
+    VOID UpdateConverterCost
+    (
+        LARGE_INTEGER StartTime,
+        ULONG Frames
+    );
+
+    VOID ReportConverterCost
+    (
+        VOID
+    );
+
     VOID NotifyRegisteredEvents
     (
         VOID
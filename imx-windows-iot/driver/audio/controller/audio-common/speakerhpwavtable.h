@@ -16,6 +16,21 @@ Abstract:
 #define SPEAKERHP_HOST_MIN_SAMPLE_RATE                  44100   // Min Sample Rate
 #define SPEAKERHP_HOST_MAX_SAMPLE_RATE                  44100   // Max Sample Rate
 
+//
+// Controllers built with IMX_AUDIO_SOFTWARE_CONVERSION convert other rates and
+// sample sizes to the device format above (CAudioConverter).
+//
+#define SPEAKERHP_CONVERTED_MIN_BITS_PER_SAMPLE         16
+#define SPEAKERHP_CONVERTED_MAX_BITS_PER_SAMPLE         32
+#define SPEAKERHP_CONVERTED_MIN_SAMPLE_RATE             8000
+#define SPEAKERHP_CONVERTED_MAX_SAMPLE_RATE             192000
+
+#ifdef IMX_AUDIO_SOFTWARE_CONVERSION
+#define SPEAKERHP_DEVICE_FLAGS                          ENDPOINT_SOFTWARE_CONVERSION
+#else
+#define SPEAKERHP_DEVICE_FLAGS                          ENDPOINT_NO_FLAGS
+#endif
+
 //
 // Max # of pin instances.
 //
@@ -106,6 +121,24 @@ KSDATARANGE_AUDIO SpeakerHpPinDataRangesStream[] =
         SPEAKERHP_HOST_MIN_SAMPLE_RATE,            
         SPEAKERHP_HOST_MAX_SAMPLE_RATE             
     },
+#ifdef IMX_AUDIO_SOFTWARE_CONVERSION
+    { // 1
+        {
+            sizeof(KSDATARANGE_AUDIO),
+            KSDATARANGE_ATTRIBUTES,         // An attributes list follows this data range
+            0,
+            0,
+            STATICGUIDOF(KSDATAFORMAT_TYPE_AUDIO),
+            STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM),
+            STATICGUIDOF(KSDATAFORMAT_SPECIFIER_WAVEFORMATEX)
+        },
+        SPEAKERHP_HOST_MAX_CHANNELS,
+        SPEAKERHP_CONVERTED_MIN_BITS_PER_SAMPLE,
+        SPEAKERHP_CONVERTED_MAX_BITS_PER_SAMPLE,
+        SPEAKERHP_CONVERTED_MIN_SAMPLE_RATE,
+        SPEAKERHP_CONVERTED_MAX_SAMPLE_RATE
+    },
+#endif
 };
 
 
@@ -113,7 +146,11 @@ static
 PKSDATARANGE SpeakerHpPinDataRangePointersStream[] =
 {
     PKSDATARANGE(&SpeakerHpPinDataRangesStream[0]),
+    PKSDATARANGE(&PinDataRangeAttributeList),
+#ifdef IMX_AUDIO_SOFTWARE_CONVERSION
+    PKSDATARANGE(&SpeakerHpPinDataRangesStream[1]),
     PKSDATARANGE(&PinDataRangeAttributeList)
+#endif
 };
 
 //=============================================================================
@@ -0,0 +1,92 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host benchmark of CAudioConverter
+//
+// Converts 10 seconds of stereo audio in WaveRT sized periods for the
+// conversions a stream can need against the codec clock, and prints the
+// time per second of audio and the speed relative to real time. On an
+// arm64 host the NEON paths are measured, elsewhere the C paths.
+//
+
+#include "audioconv.cpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#define BENCH_SECONDS       10
+#define BENCH_PERIOD_MS     10
+
+struct BenchCase
+{
+    const char     *m_pName;
+    ULONG           m_SourceRate;
+    ULONG           m_SourceBytes;
+    ULONG           m_SourceBits;
+    ULONG           m_DestinationRate;
+    ULONG           m_DestinationBytes;
+    ULONG           m_DestinationBits;
+};
+
+static const BenchCase  g_Cases[] =
+{
+    { "48k s16 -> 48k s32",         48000, 2, 16, 48000, 4, 32 },
+    { "48k s32 -> 48k s16",         48000, 4, 32, 48000, 2, 16 },
+    { "48k s16 -> 48k s24 packed",  48000, 2, 16, 48000, 3, 24 },
+    { "44.1k s16 -> 48k s32",       44100, 2, 16, 48000, 4, 32 },
+    { "48k s32 -> 44.1k s16",       48000, 4, 32, 44100, 2, 16 },
+    { "16k s16 -> 48k s32",         16000, 2, 16, 48000, 4, 32 },
+    { "96k s32 -> 48k s32",         96000, 4, 32, 48000, 4, 32 },
+};
+
+int
+main()
+{
+    printf("%-28s %14s %10s\n", "conversion", "us per second", "realtime");
+
+    for (const BenchCase& Case : g_Cases)
+    {
+        AUDIOCONV_FORMAT    source = { Case.m_SourceRate, 2, Case.m_SourceBytes, Case.m_SourceBits };
+        AUDIOCONV_FORMAT    destination = { Case.m_DestinationRate, 2, Case.m_DestinationBytes, Case.m_DestinationBits };
+        ULONG               count = CAudioConverter::GetCoefficientCount(Case.m_SourceRate, Case.m_DestinationRate);
+        std::vector<LONG>   coefficients(count + 1);
+        ULONG               sourceFrames = Case.m_SourceRate * BENCH_SECONDS;
+        ULONG               periodFrames = Case.m_SourceRate * BENCH_PERIOD_MS / 1000;
+        std::vector<UCHAR>  input((size_t)sourceFrames * 2 * Case.m_SourceBytes);
+        std::vector<UCHAR>  output((size_t)(Case.m_DestinationRate * BENCH_PERIOD_MS / 1000 + 2) * 2 * Case.m_DestinationBytes);
+        CAudioConverter     converter;
+        ULONG               offset = 0;
+
+        for (size_t i = 0; i < input.size(); i++)
+        {
+            input[i] = (UCHAR)(i * 131 + (i >> 7));
+        }
+
+        if (!converter.Init(&source, &destination, coefficients.data(), count))
+        {
+            printf("%-28s not supported\n", Case.m_pName);
+            return EXIT_FAILURE;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        while (offset < sourceFrames)
+        {
+            ULONG   used;
+
+            converter.Convert(&input[(size_t)offset * 2 * Case.m_SourceBytes], std::min(periodFrames, sourceFrames - offset), &used,
+                              output.data(), (ULONG)(output.size() / (2 * Case.m_DestinationBytes)));
+            offset += used;
+        }
+
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / BENCH_SECONDS;
+
+        printf("%-28s %14.1f %9.0fx\n", Case.m_pName, us, 1e6 / us);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,366 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host unit test of CAudioConverter
+//
+// Format conversions are checked sample by sample. Rate conversions are
+// fed a sine, the output is fitted against a sine of the same frequency at
+// the destination rate: pass band tones must come out at unity gain with
+// little residue, tones above the destination Nyquist rate must be
+// attenuated. Converting in random chunks must give the same output as
+// converting at once.
+//
+
+#include "audioconv.cpp"
+#include "HostTest.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+static AUDIOCONV_FORMAT
+Format(
+    ULONG   SampleRate,
+    ULONG   Channels,
+    ULONG   ContainerBytes,
+    ULONG   ValidBits)
+{
+    AUDIOCONV_FORMAT    format = { SampleRate, Channels, ContainerBytes, ValidBits };
+
+    return format;
+}
+
+static void
+TestSupport()
+{
+    AUDIOCONV_FORMAT    s16 = Format(48000, 2, 2, 16);
+    AUDIOCONV_FORMAT    bad;
+
+    CHECK(CAudioConverter::IsFormatSupported(&s16));
+
+    bad = Format(48000, 2, 3, 16);
+    CHECK(!CAudioConverter::IsFormatSupported(&bad));
+    bad = Format(48000, 0, 2, 16);
+    CHECK(!CAudioConverter::IsFormatSupported(&bad));
+    bad = Format(48000, AUDIOCONV_MAX_CHANNELS + 1, 2, 16);
+    CHECK(!CAudioConverter::IsFormatSupported(&bad));
+    bad = Format(AUDIOCONV_MAX_SAMPLE_RATE + 1, 2, 2, 16);
+    CHECK(!CAudioConverter::IsFormatSupported(&bad));
+
+    // No channel mixing
+    bad = Format(48000, 1, 2, 16);
+    CHECK(!CAudioConverter::IsConversionSupported(&s16, &bad));
+
+    // 44.1 kHz to 48 kHz is 160/147, 8 kHz to 48 kHz 6/1
+    AUDIOCONV_FORMAT    s44 = Format(44100, 2, 4, 32);
+    AUDIOCONV_FORMAT    s8 = Format(8000, 2, 2, 16);
+    AUDIOCONV_FORMAT    s192 = Format(192000, 2, 2, 16);
+
+    CHECK(CAudioConverter::IsConversionSupported(&s44, &s16));
+    CHECK(CAudioConverter::IsConversionSupported(&s8, &s16));
+    CHECK(CAudioConverter::IsConversionSupported(&s192, &s16));
+
+    // More than AUDIOCONV_MAX_DECIMATION
+    CHECK(!CAudioConverter::IsConversionSupported(&s192, &s44));
+    CHECK(!CAudioConverter::IsConversionSupported(&s16, &s8));
+
+    CHECK(0 == CAudioConverter::GetCoefficientCount(48000, 48000));
+    CHECK(160 * AUDIOCONV_TAPS == CAudioConverter::GetCoefficientCount(44100, 48000));
+    CHECK(147 * 28 == CAudioConverter::GetCoefficientCount(48000, 44100));
+    CHECK(1 * AUDIOCONV_MAX_TAPS == CAudioConverter::GetCoefficientCount(96000, 48000));
+}
+
+static void
+TestFormats()
+{
+    static const int16_t    Samples16[] = { 0, 1, -1, 0x7fff, -0x8000, 0x1234, -0x1234, 100 };
+    CAudioConverter         converter;
+    AUDIOCONV_FORMAT        s16 = Format(48000, 2, 2, 16);
+    AUDIOCONV_FORMAT        s24 = Format(48000, 2, 3, 24);
+    AUDIOCONV_FORMAT        s32 = Format(48000, 2, 4, 32);
+    AUDIOCONV_FORMAT        s24in32 = Format(48000, 2, 4, 24);
+    int32_t                 out32[8];
+    int16_t                 out16[8];
+    uint8_t                 out24[8 * 3];
+    ULONG                   used;
+
+    // 16 to 32 bit is exact
+    CHECK(converter.Init(&s16, &s32, NULL, 0));
+    CHECK(4 == converter.Convert(Samples16, 4, &used, out32, 8));
+    CHECK(4 == used);
+    for (int i = 0; i < 8; i++)
+    {
+        CHECK(out32[i] == (int32_t)((uint32_t)(int32_t)Samples16[i] << 16));
+    }
+
+    // 16 to 24 to 16 bit is lossless
+    CHECK(converter.Init(&s16, &s24, NULL, 0));
+    CHECK(4 == converter.Convert(Samples16, 4, &used, out24, 4));
+    CHECK(converter.Init(&s24, &s16, NULL, 0));
+    CHECK(4 == converter.Convert(out24, 4, &used, out16, 4));
+    CHECK(!memcmp(out16, Samples16, sizeof(out16)));
+
+    // 32 to 16 bit rounds to nearest and saturates
+    static const int32_t    Samples32[] = { 0x00008000, 0x00007fff, -0x00008000, -0x00008001,
+                                            0x7fffffff, (int32_t)0x80000000, 0x12348000, -0x12347fff };
+    static const int16_t    Rounded16[] = { 1, 0, 0, -1, 0x7fff, -0x8000, 0x1235, -0x1234 };
+
+    CHECK(converter.Init(&s32, &s16, NULL, 0));
+    CHECK(4 == converter.Convert(Samples32, 4, &used, out16, 4));
+    CHECK(!memcmp(out16, Rounded16, sizeof(out16)));
+
+    // 32 bit to 24 valid bits in a 32 bit container
+    CHECK(converter.Init(&s32, &s24in32, NULL, 0));
+    CHECK(4 == converter.Convert(Samples32, 4, &used, out32, 4));
+    CHECK(out32[0] == 0x00008000);
+    CHECK(out32[1] == 0x00008000);
+    CHECK(out32[4] == 0x7fffff00);
+    CHECK(out32[5] == (int32_t)0x80000000);
+    for (int i = 0; i < 8; i++)
+    {
+        CHECK(0 == (out32[i] & 0xff));
+    }
+
+    // Without a rate change the shorter side limits
+    CHECK(converter.Init(&s32, &s16, NULL, 0));
+    CHECK(3 == converter.Convert(Samples32, 4, &used, out16, 3));
+    CHECK(3 == used);
+}
+
+//
+// Least squares fit of a*sin + b*cos at the tone frequency, the residue is
+// what is left of the output after removing the fitted tone
+//
+
+struct ToneFit
+{
+    double  GainDb;
+    double  ResidueDb;
+};
+
+static ToneFit
+FitTone(
+    const std::vector<int16_t>& Samples,
+    ULONG                       Channels,
+    ULONG                       Channel,
+    size_t                      First,
+    double                      Frequency,
+    double                      SampleRate,
+    double                      Amplitude)
+{
+    double  ss = 0, sc = 0, cc = 0, ys = 0, yc = 0;
+    double  a, b, det, residue = 0, power;
+    size_t  frames = Samples.size() / Channels;
+
+    for (size_t i = First; i < frames; i++)
+    {
+        double  s = sin(2 * M_PI * Frequency * i / SampleRate);
+        double  c = cos(2 * M_PI * Frequency * i / SampleRate);
+        double  y = Samples[i * Channels + Channel];
+
+        ss += s * s;
+        sc += s * c;
+        cc += c * c;
+        ys += y * s;
+        yc += y * c;
+    }
+
+    det = ss * cc - sc * sc;
+    a = (ys * cc - yc * sc) / det;
+    b = (yc * ss - ys * sc) / det;
+
+    for (size_t i = First; i < frames; i++)
+    {
+        double  fit = a * sin(2 * M_PI * Frequency * i / SampleRate) + b * cos(2 * M_PI * Frequency * i / SampleRate);
+        double  e = Samples[i * Channels + Channel] - fit;
+
+        residue += e * e;
+    }
+
+    power = (a * a + b * b) / 2;
+    residue /= (double)(frames - First);
+
+    ToneFit fit = { 10 * log10(power / (Amplitude * Amplitude / 2)), 10 * log10(residue / power) };
+
+    return fit;
+}
+
+static std::vector<int16_t>
+MakeTone(
+    ULONG   SampleRate,
+    ULONG   Channels,
+    double  Frequency,
+    double  Amplitude,
+    size_t  Frames)
+{
+    std::vector<int16_t>    tone(Frames * Channels);
+
+    for (size_t i = 0; i < Frames; i++)
+    {
+        for (ULONG ch = 0; ch < Channels; ch++)
+        {
+            // Each channel gets its own phase, so crossed channels show up
+            tone[i * Channels + ch] = (int16_t)lrint(Amplitude * sin(2 * M_PI * Frequency * i / SampleRate + ch));
+        }
+    }
+
+    return tone;
+}
+
+static std::vector<int16_t>
+Resample(
+    ULONG                       SourceRate,
+    ULONG                       DestinationRate,
+    ULONG                       Channels,
+    const std::vector<int16_t>& Source)
+{
+    AUDIOCONV_FORMAT        source = Format(SourceRate, Channels, 2, 16);
+    AUDIOCONV_FORMAT        destination = Format(DestinationRate, Channels, 2, 16);
+    ULONG                   count = CAudioConverter::GetCoefficientCount(SourceRate, DestinationRate);
+    std::vector<LONG>       coefficients(count);
+    CAudioConverter         converter;
+    size_t                  sourceFrames = Source.size() / Channels;
+    std::vector<int16_t>    out((sourceFrames * DestinationRate / SourceRate + 1) * Channels);
+    ULONG                   used;
+    ULONG                   written;
+
+    CHECK(converter.Init(&source, &destination, coefficients.data(), count));
+    written = converter.Convert(Source.data(), (ULONG)sourceFrames, &used, out.data(), (ULONG)(out.size() / Channels));
+    CHECK(used == sourceFrames);
+    out.resize(written * Channels);
+
+    return out;
+}
+
+static void
+TestPassBand()
+{
+    static const struct
+    {
+        ULONG   SourceRate;
+        ULONG   DestinationRate;
+        double  Frequency;
+    } Cases[] =
+    {
+        { 44100, 48000, 1000 },
+        { 48000, 44100, 1000 },
+        {  8000, 48000,  440 },
+        { 16000, 48000, 3000 },
+        { 96000, 48000, 1000 },
+        { 48000, 32000, 9000 },
+        { 22050, 48000, 6000 },
+    };
+
+    for (const auto& c : Cases)
+    {
+        std::vector<int16_t>    source = MakeTone(c.SourceRate, 2, c.Frequency, 16000, c.SourceRate / 5);
+        std::vector<int16_t>    out = Resample(c.SourceRate, c.DestinationRate, 2, source);
+
+        CHECK(out.size() / 2 + 1 >= (size_t)c.DestinationRate / 5);
+
+        for (ULONG ch = 0; ch < 2; ch++)
+        {
+            ToneFit fit = FitTone(out, 2, ch, 200, c.Frequency, c.DestinationRate, 16000);
+
+            if ((fabs(fit.GainDb) > 0.2) || (fit.ResidueDb > -60))
+            {
+                printf("%u -> %u Hz, %.0f Hz tone: gain %.2f dB, residue %.1f dB\n",
+                       c.SourceRate, c.DestinationRate, c.Frequency, fit.GainDb, fit.ResidueDb);
+            }
+
+            CHECK(fabs(fit.GainDb) <= 0.2);
+            CHECK(fit.ResidueDb <= -60);
+        }
+    }
+}
+
+static void
+TestStopBand()
+{
+    static const struct
+    {
+        ULONG   SourceRate;
+        ULONG   DestinationRate;
+        double  Frequency;
+    } Cases[] =
+    {
+        { 96000, 48000, 30000 },
+        { 48000, 32000, 21000 },
+        { 48000, 16000, 12000 },
+    };
+
+    for (const auto& c : Cases)
+    {
+        std::vector<int16_t>    source = MakeTone(c.SourceRate, 1, c.Frequency, 16000, c.SourceRate / 5);
+        std::vector<int16_t>    out = Resample(c.SourceRate, c.DestinationRate, 1, source);
+        double                  power = 0;
+
+        for (size_t i = 200; i < out.size(); i++)
+        {
+            power += (double)out[i] * out[i];
+        }
+
+        power /= (double)(out.size() - 200);
+
+        // Whatever aliases back must stay 40 dB down
+        CHECK(10 * log10(power / (16000.0 * 16000 / 2)) < -40);
+    }
+}
+
+static void
+TestChunked()
+{
+    AUDIOCONV_FORMAT        source = Format(44100, 2, 2, 16);
+    AUDIOCONV_FORMAT        destination = Format(48000, 2, 4, 24);
+    ULONG                   count = CAudioConverter::GetCoefficientCount(44100, 48000);
+    std::vector<LONG>       coefficients(count);
+    std::vector<int16_t>    input = MakeTone(44100, 2, 997, 12000, 20000);
+    std::vector<int32_t>    once(2 * 22000);
+    std::vector<int32_t>    chunked(2 * 22000);
+    CAudioConverter         converter;
+    ULONG                   used;
+    ULONG                   written;
+    ULONG                   sourceOffset = 0;
+    ULONG                   destinationOffset = 0;
+    uint32_t                seed = 7;
+
+    CHECK(converter.Init(&source, &destination, coefficients.data(), count));
+    written = converter.Convert(input.data(), 20000, &used, once.data(), 22000);
+    CHECK(20000 == used);
+
+    converter.Reset();
+
+    while (sourceOffset < 20000)
+    {
+        ULONG   sourceFrames;
+        ULONG   destinationFrames;
+
+        seed = seed * 1103515245 + 12345;
+        sourceFrames = std::min((seed >> 8) % 300, 20000 - sourceOffset);
+        destinationFrames = (seed >> 20) % 300;
+
+        destinationOffset += converter.Convert(&input[sourceOffset * 2], sourceFrames, &used,
+                                               &chunked[destinationOffset * 2], destinationFrames);
+        CHECK(used <= sourceFrames);
+        sourceOffset += used;
+    }
+
+    // The output the one-shot call gave for the source frames used
+    CHECK(destinationOffset <= written);
+    CHECK(written - destinationOffset <= 2);
+    CHECK(!memcmp(once.data(), chunked.data(), destinationOffset * 2 * sizeof(int32_t)));
+}
+
+int
+main()
+{
+    TestSupport();
+    TestFormats();
+    TestPassBand();
+    TestStopBand();
+    TestChunked();
+
+    return HostTestResult("audioconvtest");
+}
@@ -0,0 +1,252 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host unit test of CWaveRtPosition
+//
+// The controller frame counter is advanced in steps and the position,
+// linear position and packet count are compared with a model computed by
+// division from the total number of bytes moved. Covers notification
+// sizes that do not divide the buffer, counter wrap, stalls of several
+// buffers and the stream stop reset.
+//
+
+#include "wavertposition.cpp"
+#include "HostTest.h"
+
+#include <stdint.h>
+
+//
+// Reference computed from the bytes moved since Init, and since the last
+// Reset for the linear position
+//
+
+struct PositionModel
+{
+    ULONG       BufferSize;
+    ULONG       BlockAlign;
+    ULONG       NotificationSize;
+    ULONGLONG   TotalBytes;
+    ULONGLONG   ResetBytes;
+    ULONGLONG   ResetPackets;
+
+    void
+    Init(
+        ULONG   Size,
+        ULONG   Align,
+        ULONG   NotificationsPerBuffer)
+    {
+        BufferSize = Size;
+        BlockAlign = Align;
+        NotificationSize = NotificationsPerBuffer ? Size / NotificationsPerBuffer : Size;
+        TotalBytes = 0;
+        ResetBytes = 0;
+        ResetPackets = 0;
+    }
+
+    ULONG Position() { return (ULONG)(TotalBytes % BufferSize); }
+    ULONGLONG LinearPosition() { return TotalBytes - ResetBytes; }
+    ULONGLONG Packets() { return TotalBytes / NotificationSize - ResetPackets; }
+};
+
+static bool
+Matches(
+    CWaveRtPosition    *pPosition,
+    PositionModel      *pModel)
+{
+    return (pPosition->GetPosition() == pModel->Position()) &&
+           (pPosition->GetLinearPosition() == pModel->LinearPosition()) &&
+           (pPosition->GetLinearFrames() == pModel->LinearPosition() / pModel->BlockAlign) &&
+           (pPosition->GetPacketCount() == (ULONG)pModel->Packets());
+}
+
+static void
+TestPeriods()
+{
+    CWaveRtPosition Position;
+    ULONG           Total = 0;
+
+    // 48 kHz stereo 16 bit, 10 ms buffer in four 2.5 ms periods
+    Position.Init(1920, 4, 4);
+
+    // 1 ms steps, the boundaries are at 120, 240, 360 and 480 frames
+    for (ULONG Step = 1; Step <= 48; Step++)
+    {
+        BOOLEAN Notify;
+
+        Total += 48;
+        Notify = Position.Update(Total);
+
+        CHECK(Notify == (((Step*48) % 120) < 48));
+        CHECK(Position.GetPacketCount() == (Step*48) / 120);
+        CHECK(Position.GetPosition() == (Step*48*4) % 1920);
+        CHECK(Position.GetLastStepFrames() == 48);
+    }
+
+    CHECK(Position.GetLinearFrames() == 48*48);
+    CHECK(Position.GetMaxStepFrames() == 48);
+
+    // No progress, no notification
+    CHECK(!Position.Update(Total));
+    CHECK(Position.GetLinearFrames() == 48*48);
+}
+
+static void
+TestWrapOnly()
+{
+    CWaveRtPosition Position;
+
+    Position.Init(4000, 8, 0);
+
+    CHECK(!Position.Update(499));
+    CHECK(Position.Update(500));
+    CHECK(1 == Position.GetPacketCount());
+    CHECK(0 == Position.GetPosition());
+    CHECK(!Position.Update(999));
+    CHECK(Position.Update(1001));
+    CHECK(2 == Position.GetPacketCount());
+    CHECK(8 == Position.GetPosition());
+
+    // More notifications than bytes falls back to the wrap only
+    Position.Init(16, 4, 32);
+    CHECK(!Position.Update(3));
+    CHECK(Position.Update(4));
+    CHECK(1 == Position.GetPacketCount());
+}
+
+static void
+TestStallAndReset()
+{
+    CWaveRtPosition Position;
+    PositionModel   Model;
+    ULONG           Total = 0;
+
+    Position.Init(3840, 4, 8);
+    Model.Init(3840, 4, 8);
+
+    Total += 100;
+    Model.TotalBytes += 100*4;
+    Position.Update(Total);
+    CHECK(Matches(&Position, &Model));
+
+    // Two and a half buffers at once
+    Total += 2400;
+    Model.TotalBytes += 2400*4;
+    CHECK(Position.Update(Total));
+    CHECK(Matches(&Position, &Model));
+
+    // The stall is not a step
+    CHECK(100 == Position.GetMaxStepFrames());
+    CHECK(2400 == Position.GetLastStepFrames());
+
+    // Stop rewinds the linear position and packets, not the buffer offset
+    Position.Reset();
+    Model.ResetBytes = Model.TotalBytes;
+    Model.ResetPackets = Model.TotalBytes / Model.NotificationSize;
+    CHECK(Matches(&Position, &Model));
+
+    Total += 700;
+    Model.TotalBytes += 700*4;
+    Position.Update(Total);
+    CHECK(Matches(&Position, &Model));
+}
+
+static void
+TestCounterWrap()
+{
+    CWaveRtPosition Position;
+    PositionModel   Model;
+    ULONG           Total = 0xFFFFF000;
+
+    Position.Init(2048, 4, 2);
+    Model.Init(2048, 4, 2);
+
+    // The first update starts from a counter of 0
+    Position.Update(Total);
+    Model.TotalBytes = (ULONGLONG)Total * 4;
+    CHECK(Matches(&Position, &Model));
+
+    for (ULONG i = 0; i < 64; i++)
+    {
+        Total += 97;
+        Model.TotalBytes += 97*4;
+        Position.Update(Total);
+        CHECK(Matches(&Position, &Model));
+    }
+
+    CHECK(Total < 0xFFFFF000);
+}
+
+static void
+TestRandomSteps()
+{
+    static const ULONG  Layouts[][3] =
+    {
+        // buffer bytes, block align, notifications per buffer
+        { 1920,  4, 4 },
+        { 1000,  4, 3 },        // 333 byte periods across the wrap
+        { 2880,  6, 5 },
+        { 9600,  8, 2 },
+        { 1152, 24, 16 },
+        {  768, 12, 1 },
+    };
+    uint32_t            Seed = 1;
+
+    for (const ULONG* Layout : Layouts)
+    {
+        CWaveRtPosition Position;
+        PositionModel   Model;
+        ULONG           Total = 0;
+        ULONGLONG       Packets = 0;
+        ULONG           BufferFrames = Layout[0] / Layout[1];
+
+        Position.Init(Layout[0], Layout[1], Layout[2]);
+        Model.Init(Layout[0], Layout[1], Layout[2]);
+
+        for (ULONG i = 0; i < 20000; i++)
+        {
+            ULONG   Frames;
+            BOOLEAN Notify;
+
+            Seed = Seed*1103515245 + 12345;
+
+            // Mostly short steps, now and then a stall
+            if (0 == (Seed >> 24) % 64)
+            {
+                Frames = BufferFrames + (Seed >> 4) % (3*BufferFrames);
+            }
+            else
+            {
+                Frames = (Seed >> 8) % BufferFrames;
+            }
+
+            Total += Frames;
+            Model.TotalBytes += (ULONGLONG)Frames * Layout[1];
+            Notify = Position.Update(Total);
+
+            CHECK(Matches(&Position, &Model));
+            CHECK(Notify == (Model.Packets() != Packets));
+            Packets = Model.Packets();
+
+            if (0 == (Seed >> 16) % 4096)
+            {
+                Position.Reset();
+                Model.ResetBytes = Model.TotalBytes;
+                Model.ResetPackets = Model.TotalBytes / Model.NotificationSize;
+                Packets = 0;
+            }
+        }
+    }
+}
+
+int
+main()
+{
+    TestPeriods();
+    TestWrapOnly();
+    TestStallAndReset();
+    TestCounterWrap();
+    TestRandomSteps();
+
+    return HostTestResult("wavertpositiontest");
+}
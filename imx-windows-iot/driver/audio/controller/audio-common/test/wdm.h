@@ -0,0 +1,42 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host build stand-in for the wdm.h parts used by wavertposition.cpp and
+// audioconv.cpp
+//
+
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef void                VOID;
+typedef uint8_t             UCHAR;
+typedef int16_t             SHORT;
+typedef int16_t             INT16;
+typedef int32_t             INT32;
+typedef int32_t             LONG;
+typedef uint32_t            ULONG;
+typedef int64_t             LONGLONG;
+typedef uint64_t            ULONGLONG;
+typedef uint8_t             BOOLEAN;
+
+#define TRUE                1
+#define FALSE               0
+#define MAXLONG             0x7fffffff
+
+#define _In_
+#define _In_opt_
+#define _Out_
+
+#define PAGED_CODE()
+#define RtlZeroMemory(Destination, Length)  memset((Destination), 0, (Length))
+
+#ifndef min
+#define min(a, b)           (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef max
+#define max(a, b)           (((a) > (b)) ? (a) : (b))
+#endif
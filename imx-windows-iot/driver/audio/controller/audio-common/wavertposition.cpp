@@ -0,0 +1,132 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Copyright 2023 NXP
+   Licensed under the MIT License.
+
+Abstract:
+    CWaveRtPosition class implementation.
+
+*/
+
+#include <wdm.h>
+#include "wavertposition.h"
+
+#pragma code_seg()
+VOID
+CWaveRtPosition::Init
+(
+    ULONG BufferSize,
+    ULONG BlockAlign,
+    ULONG NotificationsPerBuffer
+)
+{
+    m_ulBufferSize = BufferSize;
+    m_ulBlockAlign = BlockAlign;
+
+    if ((NotificationsPerBuffer != 0) && (BufferSize >= NotificationsPerBuffer))
+    {
+        m_ulNotificationSize = BufferSize / NotificationsPerBuffer;
+        m_ulNotificationsPerBuffer = NotificationsPerBuffer;
+    }
+    else
+    {
+        m_ulNotificationSize = BufferSize;
+        m_ulNotificationsPerBuffer = 1;
+    }
+
+    m_ulLastTotalFrames = 0;
+    m_ulPosition = 0;
+    m_ulBytesToNotification = m_ulNotificationSize;
+    m_ulLastStepFrames = 0;
+    m_ulMaxStepFrames = 0;
+
+    Reset();
+}
+
+#pragma code_seg()
+VOID
+CWaveRtPosition::Reset()
+{
+    m_ullLinearPosition = 0;
+    m_ullLinearFrames = 0;
+    m_ulPacketCount = 0;
+}
+
+#pragma code_seg()
+BOOLEAN
+CWaveRtPosition::Update
+(
+    ULONG TotalFramesTransferred
+)
+{
+    ULONG frames;
+    ULONGLONG bytes;
+    BOOLEAN notify = FALSE;
+
+    if (m_ulBufferSize == 0)
+    {
+        return FALSE;
+    }
+
+    frames = TotalFramesTransferred - m_ulLastTotalFrames;
+    m_ulLastTotalFrames = TotalFramesTransferred;
+
+    if (frames == 0)
+    {
+        return FALSE;
+    }
+
+    m_ulLastStepFrames = frames;
+
+    bytes = (ULONGLONG)frames * m_ulBlockAlign;
+    m_ullLinearFrames += frames;
+    m_ullLinearPosition += bytes;
+
+    if (bytes >= m_ulBufferSize)
+    {
+        // Whole buffers at once (stalled updates), the only path that divides
+        m_ulPosition += (ULONG)(bytes % m_ulBufferSize);
+    }
+    else
+    {
+        m_ulPosition += (ULONG)bytes;
+
+        if (frames > m_ulMaxStepFrames)
+        {
+            m_ulMaxStepFrames = frames;
+        }
+    }
+
+    if (m_ulPosition >= m_ulBufferSize)
+    {
+        m_ulPosition -= m_ulBufferSize;
+    }
+
+    // Notification boundaries are counted over the linear position, they
+    // drift against the buffer wrap when the notifications do not divide it
+    if (bytes >= m_ulBytesToNotification)
+    {
+        bytes -= m_ulBytesToNotification;
+        m_ulPacketCount += 1;
+        notify = TRUE;
+
+        if (bytes >= m_ulBufferSize)
+        {
+            m_ulPacketCount += (ULONG)(bytes / m_ulNotificationSize);
+            bytes %= m_ulNotificationSize;
+        }
+
+        while (bytes >= m_ulNotificationSize)
+        {
+            bytes -= m_ulNotificationSize;
+            m_ulPacketCount += 1;
+        }
+
+        m_ulBytesToNotification = m_ulNotificationSize - (ULONG)bytes;
+    }
+    else
+    {
+        m_ulBytesToNotification -= (ULONG)bytes;
+    }
+
+    return notify;
+}
@@ -0,0 +1,66 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Copyright 2023 NXP
+   Licensed under the MIT License.
+
+Abstract:
+    CWaveRtPosition class declaration, position and notification state
+    of a WaveRT stream.
+
+    The controllers report the total number of frames moved, the position
+    is advanced by the difference so the common update needs no divide.
+    Notifications are raised each time a notification boundary of the
+    buffer is passed and are counted as packets.
+
+    Only needs the types of wdm.h, so it can be run on the host.
+
+*/
+
+#pragma once
+
+class CWaveRtPosition
+{
+public:
+    CWaveRtPosition() { }
+    ~CWaveRtPosition() { }
+
+    // NotificationsPerBuffer 0 notifies at the buffer wrap only
+    VOID Init
+    (
+        ULONG BufferSize,
+        ULONG BlockAlign,
+        ULONG NotificationsPerBuffer
+    );
+
+    // Stream stop, the linear position restarts. The buffer offset keeps
+    // following the controller, which does not rewind its buffer.
+    VOID Reset();
+
+    // Returns TRUE if one or more notification boundaries were passed
+    BOOLEAN Update
+    (
+        ULONG TotalFramesTransferred
+    );
+
+    ULONG GetPosition() { return m_ulPosition; }
+    ULONGLONG GetLinearPosition() { return m_ullLinearPosition; }
+    ULONGLONG GetLinearFrames() { return m_ullLinearFrames; }
+    ULONG GetPacketCount() { return m_ulPacketCount; }
+    ULONG GetLastStepFrames() { return m_ulLastStepFrames; }
+    ULONG GetMaxStepFrames() { return m_ulMaxStepFrames; }     // Stalls of a buffer or more excluded
+
+private:
+    ULONG       m_ulBufferSize;
+    ULONG       m_ulBlockAlign;
+    ULONG       m_ulNotificationSize;
+    ULONG       m_ulNotificationsPerBuffer;
+
+    ULONG       m_ulLastTotalFrames;
+    ULONG       m_ulPosition;                   // byte offset into the buffer
+    ULONG       m_ulBytesToNotification;
+    ULONGLONG   m_ullLinearPosition;            // bytes since the stream start
+    ULONGLONG   m_ullLinearFrames;
+    ULONG       m_ulPacketCount;
+
+    ULONG       m_ulLastStepFrames;
+    ULONG       m_ulMaxStepFrames;
+};
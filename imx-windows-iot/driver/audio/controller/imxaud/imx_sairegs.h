@@ -267,6 +267,7 @@ typedef union {
 
 #define FIFO_PTR_MSB(fifoptr) (fifoptr&0x40)
 #define FIFO_PTR_NOMSB(fifoptr) (fifoptr&0x3F)
+#define SAI_FIFO_DEPTH 0x40
 
 #else
 
@@ -286,9 +287,16 @@ typedef union {
 
 #define FIFO_PTR_MSB(fifoptr) (fifoptr&0x20)
 #define FIFO_PTR_NOMSB(fifoptr) (fifoptr&0x1F)
+#define SAI_FIFO_DEPTH 0x20
 
 #endif
 
+//
+// Words in a FIFO from its read and write pointers, the pointer bit above
+// the FIFO depth flags a wrap
+//
+#define FIFO_PTR_COUNT(writeptr, readptr) (((writeptr) - (readptr)) & (2 * SAI_FIFO_DEPTH - 1))
+
 //
 // IMX7D/8M: SAI Transmit Mask Register (I2Sx_TMR)
 //
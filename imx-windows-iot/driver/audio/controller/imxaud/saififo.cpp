@@ -0,0 +1,299 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Copyright 2022-2023 NXP
+   Licensed under the MIT License.
+
+Abstract:
+    CSaiFifo class implementation.
+
+*/
+
+#include <wdm.h>
+#include "saififo.h"
+
+#pragma code_seg()
+VOID
+CSaiFifo::Start
+(
+    _In_        ULONG* Buffer,
+                ULONG BufferSize,
+                ULONG BlockAlign,
+                ULONG Channels,
+                ULONG Slots
+)
+{
+    ASSERT(Slots != 0);
+
+    m_ulFrameWords = BlockAlign / sizeof(ULONG);
+    m_ulBufferFrames = (m_ulFrameWords != 0) ? (BufferSize / BlockAlign) : 0;
+    m_ulChannels = min(Channels, m_ulFrameWords);
+    m_ulSlots = Slots;
+    m_pBuffer = (m_ulBufferFrames != 0) ? Buffer : NULL;
+
+    m_ulFrame = 0;
+    m_ulSlot = 0;
+    m_ulFramesTransferred = 0;
+}
+
+#pragma code_seg()
+VOID
+CSaiFifo::Stop()
+{
+    m_pBuffer = NULL;
+    m_ulBufferFrames = 0;
+    m_ulFrame = 0;
+    m_ulSlot = 0;
+    m_ulFramesTransferred = 0;
+}
+
+#pragma code_seg()
+ULONG
+CSaiFifo::GetFrameWords
+(
+                ULONG Channels
+)
+{
+    if ((Channels == 0) || (Channels > SAI_MAX_WORDS_PER_FRAME)) {
+        return 0;
+    }
+
+    return max(Channels, (ULONG)SAI_MIN_WORDS_PER_FRAME);
+}
+
+#pragma code_seg()
+VOID
+CSaiFifo::SetFrameWords
+(
+    _In_        volatile SAI_REGISTERS* SaiRegisters,
+                ULONG Words
+)
+{
+    SAI_TRANSMIT_CONFIGURATION_REGISTER_4 TransmitConfigReg4;
+    SAI_RECEIVE_CONFIGURATION_REGISTER_4 ReceiveConfigReg4;
+    ULONG WordMask;
+
+    ASSERT((Words >= SAI_MIN_WORDS_PER_FRAME) && (Words <= SAI_MAX_WORDS_PER_FRAME));
+
+    TransmitConfigReg4.AsUlong = READ_REGISTER_ULONG(&SaiRegisters->TransmitConfigRegister4.AsUlong);
+    TransmitConfigReg4.FrameSize = Words - 1;       // words per frame (n-1)
+    WRITE_REGISTER_ULONG(&SaiRegisters->TransmitConfigRegister4.AsUlong, TransmitConfigReg4.AsUlong);
+
+    ReceiveConfigReg4.AsUlong = READ_REGISTER_ULONG(&SaiRegisters->ReceiveConfigRegister4.AsUlong);
+    ReceiveConfigReg4.FrameSize = Words - 1;
+    WRITE_REGISTER_ULONG(&SaiRegisters->ReceiveConfigRegister4.AsUlong, ReceiveConfigReg4.AsUlong);
+
+    // Mask off all but the words of the frame
+    WordMask = (Words < 32) ? ~((1u << Words) - 1) : 0;
+
+    WRITE_REGISTER_ULONG(&SaiRegisters->TransmitMaskRegister.AsUlong, WordMask);
+    WRITE_REGISTER_ULONG(&SaiRegisters->ReceiveMaskRegister.AsUlong, WordMask);
+}
+
+#pragma code_seg()
+ULONG
+CSaiFifo::GetFifoCount()
+{
+    SAI_RECEIVE_FIFO_REGISTER FifoControl;
+    ULONG count;
+
+    // The transmit FIFO register has the pointers at the same bits, FIFO_PTR_COUNT drops the rest
+    FifoControl.AsUlong = READ_REGISTER_ULONG(m_pFifoRegister);
+
+    count = FIFO_PTR_COUNT(FifoControl.WriteFifoPointer, FifoControl.ReadFifoPointer);
+
+    return min(count, (ULONG)SAI_FIFO_DEPTH);
+}
+
+#pragma code_seg()
+VOID
+CSaiFifo::NextFrame(ULONG Frames)
+{
+    m_ulFrame += Frames;
+    if (m_ulFrame >= m_ulBufferFrames) {
+        m_ulFrame -= m_ulBufferFrames;
+    }
+
+    m_ulFramesTransferred += Frames;
+}
+
+#pragma code_seg()
+VOID
+CSaiFifo::WriteSlot()
+{
+    ULONG sample = 0;
+
+    if (m_ulSlot < m_ulChannels) {
+        sample = m_pBuffer[m_ulFrame * m_ulFrameWords + m_ulSlot];
+    }
+
+    WRITE_REGISTER_ULONG(m_pDataRegister, sample);
+
+    m_ulSlot += 1;
+    if (m_ulSlot >= m_ulSlots) {
+        m_ulSlot = 0;
+        NextFrame(1);
+    }
+}
+
+#pragma code_seg()
+VOID
+CSaiFifo::ReadSlot(ULONG SampleMask)
+{
+    ULONG sample;
+
+    sample = READ_REGISTER_ULONG(m_pDataRegister) & SampleMask;
+
+    if (m_ulSlot < m_ulChannels) {
+        m_pBuffer[m_ulFrame * m_ulFrameWords + m_ulSlot] = sample;
+    }
+
+    m_ulSlot += 1;
+    if (m_ulSlot >= m_ulSlots) {
+        m_ulSlot = 0;
+        NextFrame(1);
+    }
+}
+
+#pragma code_seg()
+ULONG
+CSaiFifo::Fill()
+{
+    ULONG words;
+    ULONG frames;
+    ULONG written;
+
+    if (m_pBuffer == NULL) {
+        return 0;
+    }
+
+    words = SAI_FIFO_DEPTH - GetFifoCount();
+    written = words;
+
+    // Complete the frame left partially written by the last call
+    while ((words != 0) && (m_ulSlot != 0)) {
+        WriteSlot();
+        words -= 1;
+    }
+
+    frames = words / m_ulSlots;
+    words -= frames * m_ulSlots;
+
+    while (frames != 0) {
+        ULONG run = min(frames, m_ulBufferFrames - m_ulFrame);
+        const ULONG* source = m_pBuffer + m_ulFrame * m_ulFrameWords;
+
+        if ((m_ulChannels == m_ulSlots) && (m_ulFrameWords == m_ulSlots)) {
+            // The run is contiguous in the buffer
+            ULONG count = run * m_ulSlots;
+
+            while (count >= 4) {
+                WRITE_REGISTER_ULONG(m_pDataRegister, source[0]);
+                WRITE_REGISTER_ULONG(m_pDataRegister, source[1]);
+                WRITE_REGISTER_ULONG(m_pDataRegister, source[2]);
+                WRITE_REGISTER_ULONG(m_pDataRegister, source[3]);
+                source += 4;
+                count -= 4;
+            }
+
+            while (count != 0) {
+                WRITE_REGISTER_ULONG(m_pDataRegister, *source);
+                source += 1;
+                count -= 1;
+            }
+        }
+        else {
+            for (ULONG frame = 0; frame < run; frame++) {
+                for (ULONG slot = 0; slot < m_ulSlots; slot++) {
+                    WRITE_REGISTER_ULONG(m_pDataRegister, (slot < m_ulChannels) ? source[slot] : 0);
+                }
+                source += m_ulFrameWords;
+            }
+        }
+
+        NextFrame(run);
+        frames -= run;
+    }
+
+    // Top the FIFO up with the start of the next frame
+    while (words != 0) {
+        WriteSlot();
+        words -= 1;
+    }
+
+    return written;
+}
+
+#pragma code_seg()
+ULONG
+CSaiFifo::Drain
+(
+                ULONG SampleMask
+)
+{
+    ULONG words;
+    ULONG frames;
+    ULONG read;
+
+    if (m_pBuffer == NULL) {
+        return 0;
+    }
+
+    words = GetFifoCount();
+    read = words;
+
+    // Complete the frame left partially read by the last call
+    while ((words != 0) && (m_ulSlot != 0)) {
+        ReadSlot(SampleMask);
+        words -= 1;
+    }
+
+    frames = words / m_ulSlots;
+    words -= frames * m_ulSlots;
+
+    while (frames != 0) {
+        ULONG run = min(frames, m_ulBufferFrames - m_ulFrame);
+        ULONG* destination = m_pBuffer + m_ulFrame * m_ulFrameWords;
+
+        if ((m_ulChannels == m_ulSlots) && (m_ulFrameWords == m_ulSlots)) {
+            // The run is contiguous in the buffer
+            ULONG count = run * m_ulSlots;
+
+            while (count >= 4) {
+                destination[0] = READ_REGISTER_ULONG(m_pDataRegister) & SampleMask;
+                destination[1] = READ_REGISTER_ULONG(m_pDataRegister) & SampleMask;
+                destination[2] = READ_REGISTER_ULONG(m_pDataRegister) & SampleMask;
+                destination[3] = READ_REGISTER_ULONG(m_pDataRegister) & SampleMask;
+                destination += 4;
+                count -= 4;
+            }
+
+            while (count != 0) {
+                *destination = READ_REGISTER_ULONG(m_pDataRegister) & SampleMask;
+                destination += 1;
+                count -= 1;
+            }
+        }
+        else {
+            for (ULONG frame = 0; frame < run; frame++) {
+                for (ULONG slot = 0; slot < m_ulSlots; slot++) {
+                    ULONG sample = READ_REGISTER_ULONG(m_pDataRegister) & SampleMask;
+
+                    if (slot < m_ulChannels) {
+                        destination[slot] = sample;
+                    }
+                }
+                destination += m_ulFrameWords;
+            }
+        }
+
+        NextFrame(run);
+        frames -= run;
+    }
+
+    // Words of the next frame already in the FIFO
+    while (words != 0) {
+        ReadSlot(SampleMask);
+        words -= 1;
+    }
+
+    return read;
+}
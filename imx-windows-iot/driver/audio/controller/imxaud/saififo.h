@@ -0,0 +1,114 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Copyright 2022-2023 NXP
+   Licensed under the MIT License.
+
+Abstract:
+    CSaiFifo class declaration, burst fill/drain of the SAI FIFOs.
+
+    The FIFO depth is computed once per call from the FIFO register and
+    whole frames are then moved without touching the FIFO register again,
+    the FIFO can only get emptier (transmit) or fuller (receive) meanwhile.
+    Frames are made of the words enabled in the SAI frame (slots), stream
+    channels go to the first slots, extra slots are sent as silence and
+    dropped on receive. The SAI frame has one slot per channel of the
+    stream format, but at least the two of an I2S frame.
+
+    Only needs the types of wdm.h, READ_REGISTER_ULONG/WRITE_REGISTER_ULONG
+    and imx_sairegs.h, so it can be run against a simulated register block.
+
+*/
+#pragma once
+
+#include "imx_sairegs.h"
+
+// Words of an I2S frame, mono and stereo streams use this frame
+#define SAI_MIN_WORDS_PER_FRAME 2
+
+// TCR4/RCR4 FrameSize is 5 bits and TMR/RMR have one mask bit per word
+#define SAI_MAX_WORDS_PER_FRAME 32
+
+class CSaiFifo
+{
+public:
+    CSaiFifo() { }
+    ~CSaiFifo() { }
+
+    VOID Init
+    (
+        _In_        volatile ULONG* FifoRegister,
+        _In_        volatile ULONG* DataRegister
+    )
+    {
+        m_pFifoRegister = FifoRegister;
+        m_pDataRegister = DataRegister;
+    }
+
+    VOID Start
+    (
+        _In_        ULONG* Buffer,
+                    ULONG BufferSize,
+                    ULONG BlockAlign,
+                    ULONG Channels,
+                    ULONG Slots
+    );
+
+    VOID Stop();
+
+    // SAI frame words for a stream of Channels channels, 0 if the SAI can't carry it
+    static ULONG GetFrameWords
+    (
+                    ULONG Channels
+    );
+
+    // Programs the frame size and the word masks of both directions, the
+    // receiver runs on the transmitter frame so they always match. The
+    // transmitter and the receiver must be disabled.
+    static VOID SetFrameWords
+    (
+        _In_        volatile SAI_REGISTERS* SaiRegisters,
+                    ULONG Words
+    );
+
+    // FIFO reset, the next word goes to slot 0
+    VOID ResetSlot()
+    {
+        m_ulSlot = 0;
+    }
+
+    // Returns the number of words written
+    ULONG Fill();
+
+    // Returns the number of words read, samples are ANDed with SampleMask
+    ULONG Drain
+    (
+                    ULONG SampleMask
+    );
+
+    ULONG GetFramesTransferred()
+    {
+        return m_ulFramesTransferred;
+    }
+
+private:
+
+    ULONG GetFifoCount();
+
+    VOID NextFrame(ULONG Frames);
+
+    VOID WriteSlot();
+
+    VOID ReadSlot(ULONG SampleMask);
+
+    volatile ULONG*        m_pFifoRegister;
+    volatile ULONG*        m_pDataRegister;
+
+    ULONG*                 m_pBuffer;
+    ULONG                  m_ulBufferFrames;
+    ULONG                  m_ulFrameWords;      // Buffer stride
+    ULONG                  m_ulChannels;        // Channels in the buffer, <= m_ulFrameWords
+    ULONG                  m_ulSlots;           // Words per SAI frame
+
+    ULONG                  m_ulFrame;           // Current frame in the buffer
+    ULONG                  m_ulSlot;            // Next slot in the SAI frame
+    ULONG                  m_ulFramesTransferred;
+};
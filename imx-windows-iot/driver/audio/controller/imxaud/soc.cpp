@@ -20,6 +20,13 @@ volatile ULONG cntTxFifoError = 0;
 volatile ULONG cntTxFifoWarning = 0;
 volatile ULONG cntTxFifoRequest = 0;
 volatile ULONG cntIsr = 0;
+volatile ULONG cntTxWordsLast = 0;      // FIFO words written by the last ISR
+volatile ULONG cntTxWordsMax = 0;
+volatile ULONG cntRxWordsLast = 0;      // FIFO words read by the last ISR
+volatile ULONG cntRxWordsMax = 0;
+volatile ULONG64 cntIsrTicksLast = 0;   // DoIsrWork duration, performance counter ticks
+volatile ULONG64 cntIsrTicksMax = 0;
+volatile ULONG64 cntIsrTicksTotal = 0;
 
 #pragma code_seg()
 VOID
@@ -39,7 +46,7 @@ CDmaBuffer::ResetTxFifo()
     TransmitConfigReg3.ChannelFifoReset |= 1;
     WRITE_REGISTER_ULONG(&m_pSaiRegisters->TransmitConfigRegister3.AsUlong, TransmitConfigReg3.AsUlong);
 #endif
-    m_ulChannel = 0;
+    m_Fifo.ResetSlot();
 }
 
 #pragma code_seg()
@@ -53,74 +60,100 @@ CDmaBuffer::ResetRxFifo()
     ReceiveControlRegister.FifoReset = 1;
     WRITE_REGISTER_ULONG(&m_pSaiRegisters->ReceiveControlRegister.AsUlong, ReceiveControlRegister.AsUlong);
 
-    m_ulChannel = 0;
+    m_Fifo.ResetSlot();
 }
 
 #pragma code_seg()
-VOID
+ULONG
 CDmaBuffer::FillFifos()
 {
-    SAI_TRANSMIT_FIFO_REGISTER FifoControl;
-    ULONG sampleIndex;
+    ULONG words;
 
-    FifoControl.AsUlong = READ_REGISTER_ULONG(&m_pSaiRegisters->TransmitFifoRegister.AsUlong);
+    if (m_bConverting) {
+        FillStaging();
 
-    // If Read Fifo Pointer and Write Fifo Pointer are identical except for MSB, the FIFO is full
-    while(!((FIFO_PTR_NOMSB(FifoControl.ReadFifoPointer) == FIFO_PTR_NOMSB(FifoControl.WriteFifoPointer)) &&
-            (FIFO_PTR_MSB(FifoControl.ReadFifoPointer) != FIFO_PTR_MSB(FifoControl.WriteFifoPointer))))
-    {
-        // Samples consist of n values where n is number of channels, Left first.
-        ULONG sample;
+        words = m_Fifo.Fill();
+
+        m_pRtStream->UpdateVirtualPositionRegisters(m_pRtStream->GetConvertedFrames());
+    }
+    else {
+        words = m_Fifo.Fill();
 
-        sampleIndex = GetSampleIndex();
-        sample = m_DataBuffer[sampleIndex + m_ulChannel];
+        m_pRtStream->UpdateVirtualPositionRegisters(m_Fifo.GetFramesTransferred());
+    }
 
-        WRITE_REGISTER_ULONG(&m_pSaiRegisters->TransmitDataRegister.AsUlong, sample);
+    return words;
+}
 
-        m_ulChannel += 1;
-        if (m_ulChannel >= m_pWfExt->Format.nChannels) {
-            m_ulChannel = 0;
-            m_ulSamplesTransferred += 1;
-        }
+#pragma code_seg()
+ULONG
+CDmaBuffer::DrainFifos()
+{
+    ULONG words;
+
+    // Mask to 24-bit depth, MSB at bit 31
+    words = m_Fifo.Drain(0xffffff00);
+
+    if (m_bConverting) {
+        DrainStaging();
 
-        FifoControl.AsUlong = READ_REGISTER_ULONG(&m_pSaiRegisters->TransmitFifoRegister.AsUlong);
+        m_pRtStream->UpdateVirtualPositionRegisters(m_pRtStream->GetConvertedFrames());
+    }
+    else {
+        m_pRtStream->UpdateVirtualPositionRegisters(m_Fifo.GetFramesTransferred());
     }
 
-    m_pRtStream->UpdateVirtualPositionRegisters(m_ulSamplesTransferred);
+    return words;
 }
 
 #pragma code_seg()
 VOID
-CDmaBuffer::DrainFifos()
+CDmaBuffer::FillStaging()
 {
-    SAI_RECEIVE_FIFO_REGISTER FifoControl;
+    ULONG blockAlign = m_pWfExt->Format.nBlockAlign;
+    ULONG pending = m_ulStagingFramesConverted - m_Fifo.GetFramesTransferred();
 
-    FifoControl.AsUlong = READ_REGISTER_ULONG(&m_pSaiRegisters->ReceiveFifoRegister.AsUlong);
+    // Keep the staging ring full, the frame the FIFO is sending stays pending until its last slot went out
+    while (pending < SOC_STAGING_FRAMES) {
+        ULONG run = min(SOC_STAGING_FRAMES - pending, SOC_STAGING_FRAMES - m_ulStagingFrame);
+        ULONG frames;
 
-    ULONG sampleIndex;
-    ULONG sample;
+        frames = m_pRtStream->ConvertFromBuffer((PUCHAR)m_Staging + m_ulStagingFrame * blockAlign, run);
+        if (frames == 0) {
+            break;
+        }
 
-    while(FifoControl.ReadFifoPointer != FifoControl.WriteFifoPointer) 
-    {
-        // pull sample out of the fifo
-        sample = READ_REGISTER_ULONG(&m_pSaiRegisters->ReceiveDataRegister.AsUlong);
-        sampleIndex = GetSampleIndex();
+        m_ulStagingFrame += frames;
+        if (m_ulStagingFrame >= SOC_STAGING_FRAMES) {
+            m_ulStagingFrame = 0;
+        }
 
-        // Mask to 24-bit depth, MSB at bit 31
-        sample = sample & 0xffffff00;
+        m_ulStagingFramesConverted += frames;
+        pending += frames;
+    }
+}
 
-        if (m_ulChannel == 0) {
-            m_DataBuffer[sampleIndex] = sample;
-         
-            m_ulSamplesTransferred += 1;
-        }
+#pragma code_seg()
+VOID
+CDmaBuffer::DrainStaging()
+{
+    ULONG blockAlign = m_pWfExt->Format.nBlockAlign;
+    ULONG pending = m_Fifo.GetFramesTransferred() - m_ulStagingFramesConverted;
 
-        m_ulChannel = 0x01 & (m_ulChannel + 1);
+    // Frames the FIFO completed in the staging ring
+    while (pending != 0) {
+        ULONG run = min(pending, SOC_STAGING_FRAMES - m_ulStagingFrame);
 
-        FifoControl.AsUlong = READ_REGISTER_ULONG(&m_pSaiRegisters->ReceiveFifoRegister.AsUlong);
-    } 
-    
-    m_pRtStream->UpdateVirtualPositionRegisters(m_ulSamplesTransferred);
+        m_pRtStream->ConvertToBuffer((PUCHAR)m_Staging + m_ulStagingFrame * blockAlign, run);
+
+        m_ulStagingFrame += run;
+        if (m_ulStagingFrame >= SOC_STAGING_FRAMES) {
+            m_ulStagingFrame = 0;
+        }
+
+        m_ulStagingFramesConverted += run;
+        pending -= run;
+    }
 }
 
 
@@ -129,16 +162,47 @@ VOID
 CDmaBuffer::RegisterStream
 (
     _In_        CMiniportWaveRTStream* Stream,
-                eDeviceType DeviceType
+                eDeviceType DeviceType,
+                ULONG FrameWords
 )
 {
     m_pRtStream = Stream;
     m_DeviceType = DeviceType;
-    m_ulSamplesTransferred = 0;
-    m_ulChannel = 0;
     m_DataBuffer = Stream->GetDmaBuffer();
     m_ulDmaBufferSize = Stream->GetDmaBufferSize();
-    m_pWfExt = Stream->GetDataFormat();
+    // Format on the SAI, the stream format unless the stream converts
+    m_pWfExt = Stream->GetDeviceFormat();
+    m_bConverting = Stream->IsConverting();
+    m_ulStagingFrame = 0;
+    m_ulStagingFramesConverted = 0;
+
+    if (DeviceType == eSpeakerHpDevice)
+    {
+        m_Fifo.Init(&m_pSaiRegisters->TransmitFifoRegister.AsUlong,
+                    &m_pSaiRegisters->TransmitDataRegister.AsUlong);
+    }
+    else
+    {
+        m_Fifo.Init(&m_pSaiRegisters->ReceiveFifoRegister.AsUlong,
+                    &m_pSaiRegisters->ReceiveDataRegister.AsUlong);
+    }
+
+    if (m_bConverting) {
+        ASSERT(m_pWfExt->Format.nBlockAlign <= SAI_MAX_WORDS_PER_FRAME * sizeof(ULONG));
+
+        m_Fifo.Start(m_Staging,
+                     SOC_STAGING_FRAMES * m_pWfExt->Format.nBlockAlign,
+                     m_pWfExt->Format.nBlockAlign,
+                     m_pWfExt->Format.nChannels,
+                     FrameWords);
+    }
+    else {
+        m_Fifo.Start(m_DataBuffer,
+                     m_ulDmaBufferSize,
+                     m_pWfExt->Format.nBlockAlign,
+                     m_pWfExt->Format.nChannels,
+                     FrameWords);
+    }
 }
 
 #pragma code_seg()
@@ -151,12 +215,13 @@ CDmaBuffer::UnregisterStream
     UNREFERENCED_PARAMETER(Stream);
     ASSERT(m_pRtStream == Stream);
 
+    m_Fifo.Stop();
+
     m_pRtStream = NULL;
-    m_ulSamplesTransferred = 0;
-    m_ulChannel = 0;
     m_DataBuffer = NULL;
     m_ulDmaBufferSize = 0;
     m_pWfExt = NULL;
+    m_bConverting = FALSE;
 }
 
 
@@ -200,7 +265,33 @@ CSoc::RegisterStream
                 eDeviceType DeviceType
 )
 {
-    m_Buffer[DeviceType].RegisterStream(Stream, DeviceType);
+    eDeviceType otherType = (DeviceType == eSpeakerHpDevice) ? eMicInDevice : eSpeakerHpDevice;
+    ULONG frameWords;
+
+    frameWords = CSaiFifo::GetFrameWords(Stream->GetDeviceFormat()->Format.nChannels);
+    if (frameWords == 0)
+    {
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    if (m_Buffer[otherType].IsRegistered())
+    {
+        // The receiver runs on the transmitter frame, it can only be resized while one direction is in use
+        if (frameWords > m_ulFrameWords)
+        {
+            return STATUS_DEVICE_BUSY;
+        }
+
+        frameWords = m_ulFrameWords;
+    }
+    else if (frameWords != m_ulFrameWords)
+    {
+        // Nothing registered, so the transmitter and the receiver are disabled
+        CSaiFifo::SetFrameWords(m_pSaiRegisters, frameWords);
+        m_ulFrameWords = frameWords;
+    }
+
+    m_Buffer[DeviceType].RegisterStream(Stream, DeviceType, frameWords);
 
     if (DeviceType == eSpeakerHpDevice)
     {
@@ -252,9 +343,6 @@ CSoc::SetupClocks()
     SAI_TRANSMIT_CONFIGURATION_REGISTER_5 TransmitConfigReg5;
     SAI_RECEIVE_CONFIGURATION_REGISTER_5 ReceiveConfigReg5;
 
-    SAI_TRANSMIT_MASK_REGISTER TransmitMaskRegister;
-    SAI_RECEIVE_MASK_REGISTER ReceiveMaskRegister;
-
     NTSTATUS status;
     UINT32 CpuRev;
     IMX_CPU CpuType;
@@ -364,7 +452,6 @@ CSoc::SetupClocks()
     TransmitConfigReg4.AsUlong = 0;
     ReceiveConfigReg4.AsUlong = 0;
 
-    TransmitConfigReg4.FrameSize = 1;       // two words per frame (n-1)
 #ifdef IMX_SELECT_SAI_TYPE_MULTI_CHANNEL
     TransmitConfigReg4.ChannelMode = 1;     // don't tristate outputs when masked
 #endif
@@ -374,7 +461,6 @@ CSoc::SetupClocks()
     TransmitConfigReg4.FrameSyncDirection = 1; // internally generated
     TransmitConfigReg4.FrameSyncPolarity = 1; // active low
 
-    ReceiveConfigReg4.FrameSize = 1;        // two words per frame (n-1)
     ReceiveConfigReg4.SyncWidth = 0x1f;     // 32 bit word lengths
     ReceiveConfigReg4.MSBFirst = 1;         // I2S MSB-First left-1 Justified
     ReceiveConfigReg4.FrameSyncEarly = 1;
@@ -403,14 +489,12 @@ CSoc::SetupClocks()
     WRITE_REGISTER_ULONG(&m_pSaiRegisters->ReceiveConfigRegister5.AsUlong, ReceiveConfigReg5.AsUlong);
 
     //
-    // Configure the RX/TX Mask register
+    // Configure the RX/TX frame size in Config Reg 4 and the RX/TX Mask register,
+    // streams with more channels resize the frame when they register
     //
-    
-    TransmitMaskRegister.AsUlong = ~0x3u;   // mask off all but first two words
-    ReceiveMaskRegister.AsUlong = ~0x3u;
 
-    WRITE_REGISTER_ULONG(&m_pSaiRegisters->TransmitMaskRegister.AsUlong, TransmitMaskRegister.AsUlong);
-    WRITE_REGISTER_ULONG(&m_pSaiRegisters->ReceiveMaskRegister.AsUlong, ReceiveMaskRegister.AsUlong);
+    CSaiFifo::SetFrameWords(m_pSaiRegisters, SAI_MIN_WORDS_PER_FRAME);
+    m_ulFrameWords = SAI_MIN_WORDS_PER_FRAME;
 
     EnableInterrupts();
 
@@ -538,6 +622,13 @@ CSoc::StartDma
     cntRxFifoWarning = 0;
     cntRxFifoRequest = 0;
     cntRxSyncError = 0;
+    cntTxWordsLast = 0;
+    cntTxWordsMax = 0;
+    cntRxWordsLast = 0;
+    cntRxWordsMax = 0;
+    cntIsrTicksLast = 0;
+    cntIsrTicksMax = 0;
+    cntIsrTicksTotal = 0;
 
     if (m_Buffer[eMicInDevice].IsMyStream(Stream))
     {
@@ -683,6 +774,11 @@ CSoc::DoIsrWork ()
     BOOLEAN isMe;
     SAI_TRANSMIT_CONTROL_REGISTER TransmitControlRegister;
     SAI_RECEIVE_CONTROL_REGISTER ReceiveControlRegister;
+    LARGE_INTEGER startTime;
+    LARGE_INTEGER endTime;
+    ULONG64 ticks;
+
+    startTime = KeQueryPerformanceCounter(NULL);
 
     TransmitControlRegister.AsUlong = READ_REGISTER_ULONG(&m_pSaiRegisters->TransmitControlRegister.AsUlong);
     ReceiveControlRegister.AsUlong = READ_REGISTER_ULONG(&m_pSaiRegisters->ReceiveControlRegister.AsUlong);
@@ -728,17 +824,29 @@ CSoc::DoIsrWork ()
 
     if ((ReceiveControlRegister.FifoWarningFlag == 1 || ReceiveControlRegister.FifoRequestFlag == 1) && m_bIsCaptureActive == TRUE)
     {
-            m_Buffer[eMicInDevice].DrainFifos();
-        }
+        cntRxWordsLast = m_Buffer[eMicInDevice].DrainFifos();
+        if (cntRxWordsLast > cntRxWordsMax)
+            cntRxWordsMax = cntRxWordsLast;
+    }
 
     if ((TransmitControlRegister.FifoWarningFlag == 1 || TransmitControlRegister.FifoRequestFlag == 1) && m_bIsRenderActive == TRUE)
     {
-            m_Buffer[eSpeakerHpDevice].FillFifos();
-        }
+        cntTxWordsLast = m_Buffer[eSpeakerHpDevice].FillFifos();
+        if (cntTxWordsLast > cntTxWordsMax)
+            cntTxWordsMax = cntTxWordsLast;
+    }
 
     // Enable interrupts.  Also clears any error flags
     EnableInterruptsNoLock();
 
+    endTime = KeQueryPerformanceCounter(NULL);
+    ticks = (ULONG64)(endTime.QuadPart - startTime.QuadPart);
+
+    cntIsrTicksLast = ticks;
+    cntIsrTicksTotal += ticks;
+    if (ticks > cntIsrTicksMax)
+        cntIsrTicksMax = ticks;
+
     return isMe;
 }
 
@@ -11,9 +11,13 @@ Abstract:
 #include "imx_audio.h"
 #include "common.h"
 #include "imx_sairegs.h"
+#include "saififo.h"
 #include "minwavertstream.h"
 
 #define SOC_MAX_BUFFER_NUMBER 2
+
+// Device frames between a converting stream and the FIFO, one FIFO of I2S frames ahead on render
+#define SOC_STAGING_FRAMES (2 * SAI_FIFO_DEPTH / SAI_MIN_WORDS_PER_FRAME)
 class CSoc;
 
 class CDmaBuffer
@@ -39,18 +43,24 @@ public:
         }
     }
 
+    BOOLEAN IsRegistered()
+    {
+        return (m_pRtStream != NULL);
+    }
+
     VOID ResetTxFifo();
 
     VOID ResetRxFifo();
 
-    VOID FillFifos();
+    ULONG FillFifos();
 
-    VOID DrainFifos();
+    ULONG DrainFifos();
 
     VOID RegisterStream
     (
         _In_        CMiniportWaveRTStream* Stream,
-                    eDeviceType DeviceType
+                    eDeviceType DeviceType,
+                    ULONG FrameWords
     );
 
     VOID UnregisterStream
@@ -58,29 +68,25 @@ public:
         _In_        CMiniportWaveRTStream* Stream
     );
 
-    ULONG GetSampleIndex()
-    {
-        ULONG byteOffset;
-
-        byteOffset = m_ulSamplesTransferred * m_pWfExt->Format.nBlockAlign;
-        if (byteOffset >= m_ulDmaBufferSize)
-        {
-            byteOffset = byteOffset % m_ulDmaBufferSize;
-        }
+private:
 
-        return (byteOffset >> 2); // byteOffset / sizeof(ULONG)
-    }
+    VOID FillStaging();
 
-private:
+    VOID DrainStaging();
 
-    ULONG                  m_ulSamplesTransferred;
-    ULONG                  m_ulChannel;
+    CSaiFifo               m_Fifo;
     CMiniportWaveRTStream* m_pRtStream;
     ULONG*                 m_DataBuffer;
     PWAVEFORMATEXTENSIBLE  m_pWfExt;
     ULONG                  m_ulDmaBufferSize;
     eDeviceType            m_DeviceType;
 
+    // Converting streams, the FIFO moves device frames through the staging ring
+    BOOLEAN                m_bConverting;
+    ULONG                  m_ulStagingFrame;                // next frame the converter writes (render) or reads (capture)
+    ULONG                  m_ulStagingFramesConverted;
+    ULONG                  m_Staging[SOC_STAGING_FRAMES * SAI_MAX_WORDS_PER_FRAME];
+
     volatile PSAI_REGISTERS          m_pSaiRegisters;
 };
 
@@ -192,6 +198,9 @@ private:
     BOOLEAN m_bIsRenderActive;
     BOOLEAN m_bIsCaptureActive;
 
+    // Words per SAI frame, shared by both directions
+    ULONG m_ulFrameWords;
+
     volatile PSAI_REGISTERS          m_pSaiRegisters;
     PDEVICE_OBJECT                   m_pPDO;
 
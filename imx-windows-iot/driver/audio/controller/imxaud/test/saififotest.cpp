@@ -0,0 +1,306 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host unit test of CSaiFifo
+//
+// The register accessors run against a simulated SAI register block: the
+// data registers feed FIFO models whose pointers show up in the FIFO
+// registers. The test plays the serial side, shifting words out of the
+// transmit FIFO and into the receive FIFO in amounts that split frames,
+// and checks every slot of the serial stream against the stream buffer.
+//
+
+#include "saififo.cpp"
+#include "HostTest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <deque>
+#include <vector>
+
+#define SAMPLE_MASK     0xffffff00
+
+class SimSai
+{
+public:
+
+    SimSai()
+    {
+        memset(&m_Regs, 0, sizeof(m_Regs));
+        m_TxWritePtr = 0;
+        m_TxReadPtr = 0;
+        m_RxWritePtr = 0;
+        m_RxReadPtr = 0;
+    }
+
+    ULONG
+    Read(
+        volatile ULONG *Register)
+    {
+        if (Register == &m_Regs.TransmitFifoRegister.AsUlong) {
+            return (m_TxWritePtr << 16) | m_TxReadPtr;
+        }
+
+        if (Register == &m_Regs.ReceiveFifoRegister.AsUlong) {
+            return (m_RxWritePtr << 16) | m_RxReadPtr;
+        }
+
+        if (Register == &m_Regs.ReceiveDataRegister.AsUlong) {
+            ULONG value = 0;
+
+            // Reading an empty FIFO is an underrun
+            CHECK(!m_RxFifo.empty());
+            if (!m_RxFifo.empty()) {
+                value = m_RxFifo.front();
+                m_RxFifo.pop_front();
+                m_RxReadPtr = (m_RxReadPtr + 1) & (2 * SAI_FIFO_DEPTH - 1);
+            }
+
+            return value;
+        }
+
+        return *Register;
+    }
+
+    VOID
+    Write(
+        volatile ULONG *Register,
+        ULONG           Value)
+    {
+        if (Register == &m_Regs.TransmitDataRegister.AsUlong) {
+            // Writing a full FIFO is an overrun
+            CHECK(m_TxFifo.size() < SAI_FIFO_DEPTH);
+            m_TxFifo.push_back(Value);
+            m_TxWritePtr = (m_TxWritePtr + 1) & (2 * SAI_FIFO_DEPTH - 1);
+            return;
+        }
+
+        *Register = Value;
+    }
+
+    // Moves up to Words from the transmit FIFO to the serial line
+    VOID
+    ShiftOut(
+        ULONG               Words,
+        std::vector<ULONG> *pLine)
+    {
+        while ((Words != 0) && !m_TxFifo.empty()) {
+            pLine->push_back(m_TxFifo.front());
+            m_TxFifo.pop_front();
+            m_TxReadPtr = (m_TxReadPtr + 1) & (2 * SAI_FIFO_DEPTH - 1);
+            Words -= 1;
+        }
+    }
+
+    // Moves up to Words from the serial line to the receive FIFO
+    VOID
+    ShiftIn(
+        ULONG               Words,
+        const std::vector<ULONG> &Line,
+        size_t             *pLinePos)
+    {
+        while ((Words != 0) && (m_RxFifo.size() < SAI_FIFO_DEPTH) && (*pLinePos < Line.size())) {
+            m_RxFifo.push_back(Line[*pLinePos]);
+            *pLinePos += 1;
+            m_RxWritePtr = (m_RxWritePtr + 1) & (2 * SAI_FIFO_DEPTH - 1);
+            Words -= 1;
+        }
+    }
+
+    SAI_REGISTERS       m_Regs;
+
+private:
+
+    std::deque<ULONG>   m_TxFifo;
+    std::deque<ULONG>   m_RxFifo;
+    ULONG               m_TxWritePtr;
+    ULONG               m_TxReadPtr;
+    ULONG               m_RxWritePtr;
+    ULONG               m_RxReadPtr;
+};
+
+static SimSai*  g_pSai;
+
+ULONG
+READ_REGISTER_ULONG(
+    volatile ULONG *Register)
+{
+    return g_pSai->Read(Register);
+}
+
+VOID
+WRITE_REGISTER_ULONG(
+    volatile ULONG *Register,
+    ULONG           Value)
+{
+    g_pSai->Write(Register, Value);
+}
+
+static ULONG
+BufferSample(
+    ULONG   Frame,
+    ULONG   Channel)
+{
+    return ((Frame * 64 + Channel + 1) << 8) | 0x5A;
+}
+
+static void
+TestFrameWords()
+{
+    SimSai  Sai;
+
+    g_pSai = &Sai;
+
+    CHECK(0 == CSaiFifo::GetFrameWords(0));
+    CHECK(2 == CSaiFifo::GetFrameWords(1));
+    CHECK(2 == CSaiFifo::GetFrameWords(2));
+    CHECK(6 == CSaiFifo::GetFrameWords(6));
+    CHECK(SAI_MAX_WORDS_PER_FRAME == CSaiFifo::GetFrameWords(SAI_MAX_WORDS_PER_FRAME));
+    CHECK(0 == CSaiFifo::GetFrameWords(SAI_MAX_WORDS_PER_FRAME + 1));
+
+    // The other TCR4/RCR4 fields are kept
+    Sai.m_Regs.TransmitConfigRegister4.AsUlong = 0x00001f1b;
+    Sai.m_Regs.ReceiveConfigRegister4.AsUlong = 0x00001f1b;
+
+    CSaiFifo::SetFrameWords(&Sai.m_Regs, 8);
+
+    CHECK(0x00071f1b == Sai.m_Regs.TransmitConfigRegister4.AsUlong);
+    CHECK(0x00071f1b == Sai.m_Regs.ReceiveConfigRegister4.AsUlong);
+    CHECK(0xffffff00 == Sai.m_Regs.TransmitMaskRegister.AsUlong);
+    CHECK(0xffffff00 == Sai.m_Regs.ReceiveMaskRegister.AsUlong);
+
+    CSaiFifo::SetFrameWords(&Sai.m_Regs, 2);
+
+    CHECK(0x00011f1b == Sai.m_Regs.TransmitConfigRegister4.AsUlong);
+    CHECK(0xfffffffc == Sai.m_Regs.TransmitMaskRegister.AsUlong);
+
+    CSaiFifo::SetFrameWords(&Sai.m_Regs, SAI_MAX_WORDS_PER_FRAME);
+
+    CHECK(0x001f1f1b == Sai.m_Regs.ReceiveConfigRegister4.AsUlong);
+    CHECK(0 == Sai.m_Regs.TransmitMaskRegister.AsUlong);
+    CHECK(0 == Sai.m_Regs.ReceiveMaskRegister.AsUlong);
+}
+
+//
+// Renders Channels channels in frames of Slots words, the serial line must
+// carry the buffer samples in the first slots and silence in the others
+//
+
+static void
+TestFill(
+    ULONG   Channels,
+    ULONG   Slots)
+{
+    const ULONG         BufferFrames = 37;
+    SimSai              Sai;
+    CSaiFifo            Fifo;
+    std::vector<ULONG>  Buffer(BufferFrames * Channels);
+    std::vector<ULONG>  Line;
+    ULONG               Written = 0;
+
+    g_pSai = &Sai;
+
+    for (ULONG frame = 0; frame < BufferFrames; frame++) {
+        for (ULONG channel = 0; channel < Channels; channel++) {
+            Buffer[frame * Channels + channel] = BufferSample(frame, channel);
+        }
+    }
+
+    Fifo.Init(&Sai.m_Regs.TransmitFifoRegister.AsUlong, &Sai.m_Regs.TransmitDataRegister.AsUlong);
+    Fifo.Start(Buffer.data(), BufferFrames * Channels * sizeof(ULONG), Channels * sizeof(ULONG), Channels, Slots);
+
+    for (ULONG i = 0; i < 200; i++) {
+        Written += Fifo.Fill();
+
+        // Odd amounts, most of them splitting a frame
+        Sai.ShiftOut((i * 7) % SAI_FIFO_DEPTH + 1, &Line);
+    }
+
+    CHECK(Written / Slots == Fifo.GetFramesTransferred());
+    CHECK(Line.size() > 2 * BufferFrames * Slots);
+
+    ULONG mismatches = 0;
+
+    for (size_t word = 0; word < Line.size(); word++) {
+        ULONG frame = (ULONG)(word / Slots);
+        ULONG slot = (ULONG)(word % Slots);
+        ULONG expected = (slot < Channels) ? BufferSample(frame % BufferFrames, slot) : 0;
+
+        if (Line[word] != expected) {
+            mismatches++;
+        }
+    }
+
+    CHECK(0 == mismatches);
+
+    Fifo.Stop();
+    CHECK(0 == Fifo.Fill());
+}
+
+//
+// Captures Channels channels from frames of Slots words, the extra slots
+// are dropped and the samples masked
+//
+
+static void
+TestDrain(
+    ULONG   Channels,
+    ULONG   Slots)
+{
+    const ULONG         BufferFrames = 37;
+    SimSai              Sai;
+    CSaiFifo            Fifo;
+    std::vector<ULONG>  Buffer(BufferFrames * Channels, 0);
+    std::vector<ULONG>  Line(300 * Slots);
+    size_t              LinePos = 0;
+    ULONG               Read = 0;
+    ULONG               Checked = 0;
+    ULONG               mismatches = 0;
+
+    g_pSai = &Sai;
+
+    for (size_t word = 0; word < Line.size(); word++) {
+        Line[word] = BufferSample((ULONG)(word / Slots), (ULONG)(word % Slots)) | 0xff;
+    }
+
+    Fifo.Init(&Sai.m_Regs.ReceiveFifoRegister.AsUlong, &Sai.m_Regs.ReceiveDataRegister.AsUlong);
+    Fifo.Start(Buffer.data(), BufferFrames * Channels * sizeof(ULONG), Channels * sizeof(ULONG), Channels, Slots);
+
+    for (ULONG i = 0; LinePos < Line.size(); i++) {
+        Sai.ShiftIn((i * 5) % SAI_FIFO_DEPTH + 1, Line, &LinePos);
+
+        Read += Fifo.Drain(SAMPLE_MASK);
+
+        // Frames completed since the last drain, before the buffer wraps over them
+        for (; Checked < Fifo.GetFramesTransferred(); Checked++) {
+            for (ULONG channel = 0; channel < Channels; channel++) {
+                if (Buffer[(Checked % BufferFrames) * Channels + channel] != (BufferSample(Checked, channel) & SAMPLE_MASK)) {
+                    mismatches++;
+                }
+            }
+        }
+    }
+
+    CHECK(0 == mismatches);
+    CHECK(Line.size() == Read);
+    CHECK(300 == Fifo.GetFramesTransferred());
+}
+
+int
+main()
+{
+    TestFrameWords();
+
+    TestFill(2, 2);
+    TestFill(1, 2);
+    TestFill(4, 4);
+    TestFill(2, 8);
+
+    TestDrain(1, 2);
+    TestDrain(2, 2);
+    TestDrain(6, 6);
+    TestDrain(6, 8);
+
+    return HostTestResult("saififotest");
+}
@@ -0,0 +1,37 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host build stand-in for the wdm.h parts used by saififo.cpp, the register
+// accessors are implemented by the test on a simulated SAI register block
+//
+
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef void                VOID;
+typedef uint32_t            ULONG;
+typedef uint32_t            ULONG32;
+typedef uint8_t             BOOLEAN;
+
+#define _In_
+#define ASSERT(e)           assert(e)
+
+#ifndef min
+#define min(a, b)           (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef max
+#define max(a, b)           (((a) > (b)) ? (a) : (b))
+#endif
+
+ULONG
+READ_REGISTER_ULONG(
+    volatile ULONG *Register);
+
+VOID
+WRITE_REGISTER_ULONG(
+    volatile ULONG *Register,
+    ULONG           Value);
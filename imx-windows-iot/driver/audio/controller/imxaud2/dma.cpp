@@ -235,9 +235,9 @@ CDmaBuffer::RegisterStream
         return status;
     }
 
-    ULONG notif = Stream->GetNotificationsPerBuffer();
+    ULONG notif = Stream->GetPeriodsPerBuffer();
     DBG_DRV_PRINT_VERBOSE("Buffer size %u", m_BufSize);
-    DBG_DRV_PRINT_VERBOSE("Notifications %u", notif);
+    DBG_DRV_PRINT_VERBOSE("Periods %u", notif);
 
     m_NotificationBytes = m_BufSize / notif;
     status = m_pDmaAdapter->DmaOperations->ConfigureAdapterChannel(
@@ -244,9 +244,9 @@ CSoc_htx::RegisterStream
     KeLowerIrql(oldIRQL);
     NT_ASSERT(NT_SUCCESS(status));
     
-    ULONG notif = m_pRtStream->GetNotificationsPerBuffer();
+    ULONG notif = m_pRtStream->GetPeriodsPerBuffer();
     DBG_DRV_PRINT_VERBOSE("Buffer size %u", m_BufSize);
-    DBG_DRV_PRINT_VERBOSE("Notifications %u", notif);
+    DBG_DRV_PRINT_VERBOSE("Periods %u", notif);
     
     m_NotificationBytes = m_BufSize / notif;
     status = m_pDmaAdapter->DmaOperations->ConfigureAdapterChannel(m_pDmaAdapter, SDMA_CFG_FUN_SET_CHANNEL_NOTIFICATION_THRESHOLD,
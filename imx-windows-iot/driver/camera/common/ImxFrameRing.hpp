@@ -0,0 +1,297 @@
+/*
+ * Copyright 2023 NXP
+ * All rights reserved.
+ *
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "ImxVideoCommon.hpp"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*! @brief Max number of application frame buffers owned by the driver at a time. */
+#define IMX_FRAME_RING_MAX_BUFFERS 8U
+
+/*! @brief Number of ping-pong output address slots of the capture DMA. */
+#define IMX_FRAME_RING_SLOT_NUM 2U
+
+/*! @brief Frame buffer as seen by the buffer rotation. */
+struct ImxFrameBuffer_t
+{
+    UINT64 m_PhysY;     /*!< Packed or Y plane physical address. */
+    UINT64 m_PhysU;     /*!< Optional U/UV plane physical address. */
+    PVOID m_CookiePtr;  /*!< Owner handle (WDFREQUEST), NULL for a driver discard buffer. */
+    UINT32 m_Sequence;  /*!< Frame sequence number, valid for completed buffers. */
+    bool m_IsCanceled;  /*!< Cancel was requested while the buffer couldn't be taken back from the hardware. */
+    bool m_IsAborted;   /*!< Buffer is returned unfilled. */
+};
+
+/*!
+ * @brief Capture buffer rotation over the two hardware address slots.
+ *
+ * Application buffers are queued in FIFO order and programmed into the slot which has just finished a frame.
+ * If no application buffer is queued the slot gets its driver discard buffer so the DMA never stalls,
+ * the frame captured there is counted as dropped. Filled application buffers wait for PopDone().
+ * The class doesn't depend on the OS and doesn't lock, callers serialize all calls (drivers use the interrupt lock).
+ */
+class ImxFrameRing_t
+{
+public:
+    ImxFrameRing_t() : m_IsRunning(false), m_Sequence(0), m_Stats()
+    {
+        for (UINT32 i = 0; i < IMX_FRAME_RING_SLOT_NUM; ++i) {
+            m_Discard[i] = ImxFrameBuffer_t();
+            m_Slot[i] = ImxFrameBuffer_t();
+        }
+    }
+
+    void SetDiscardBuffer(UINT32 SlotId, UINT64 PhysY, UINT64 PhysU)
+    /*!
+     * Sets the buffer a slot captures to when no application buffer is queued.
+     *
+     * @param SlotId hardware slot.
+     * @param PhysY packed or Y plane physical address.
+     * @param PhysU optional U/UV plane physical address.
+     */
+    {
+        m_Discard[SlotId] = ImxFrameBuffer_t();
+        m_Discard[SlotId].m_PhysY = PhysY;
+        m_Discard[SlotId].m_PhysU = PhysU;
+    }
+
+    void Start()
+    /*!
+     * Starts a stream with both slots holding discard buffers, the hardware is expected to be programmed the same way.
+     * Resets counters, completed buffers still waiting for PopDone() are kept.
+     */
+    {
+        ASSERT(!m_IsRunning);
+        ASSERT(m_Pending.Count() == 0);
+        for (UINT32 i = 0; i < IMX_FRAME_RING_SLOT_NUM; ++i) {
+            m_Slot[i] = m_Discard[i];
+        }
+        m_Sequence = 0;
+        m_Stats = CaptureStats_t();
+        m_Stats.m_InFlight = m_Done.Count();
+        m_IsRunning = true;
+    }
+
+    bool Queue(const ImxFrameBuffer_t &Buff)
+    /*!
+     * Queues an application buffer.
+     *
+     * @param Buff buffer, m_CookiePtr must be unique and not NULL.
+     *
+     * @returns false if the stream is not running or IMX_FRAME_RING_MAX_BUFFERS buffers are in flight.
+     */
+    {
+        if ((!m_IsRunning) || (m_Stats.m_InFlight >= IMX_FRAME_RING_MAX_BUFFERS)) {
+            return false;
+        }
+        if ((m_Stats.m_QueuedCnt > 0) && (m_Pending.Count() == 0) && (!IsSlotQueued())) {
+            ++m_Stats.m_LateCnt; // Both slots are already capturing to discard buffers.
+        }
+        ImxFrameBuffer_t buff = Buff;
+
+        buff.m_IsCanceled = false;
+        buff.m_IsAborted = false;
+        m_Pending.Push(buff);
+        ++m_Stats.m_QueuedCnt;
+        if (++m_Stats.m_InFlight > m_Stats.m_MaxInFlight) {
+            m_Stats.m_MaxInFlight = m_Stats.m_InFlight;
+        }
+        return true;
+    }
+
+    const ImxFrameBuffer_t &FrameDone(UINT32 SlotId)
+    /*!
+     * Retires the frame finished in a slot and refills the slot.
+     *
+     * @param SlotId hardware slot which has finished a frame.
+     *
+     * @returns buffer to be programmed into the slot.
+     */
+    {
+        ImxFrameBuffer_t &slot = m_Slot[SlotId];
+
+        if (m_IsRunning) {
+            if (slot.m_CookiePtr != NULL) {
+                slot.m_Sequence = m_Sequence;
+                if (slot.m_IsCanceled) {
+                    slot.m_IsAborted = true;
+                    ++m_Stats.m_AbortedCnt;
+                }
+                else {
+                    ++m_Stats.m_CompletedCnt;
+                }
+                m_Done.Push(slot);
+            }
+            else if (m_Stats.m_QueuedCnt > 0) {
+                ++m_Stats.m_DroppedCnt;
+            }
+            ++m_Sequence;
+            if (!m_Pending.Pop(slot)) {
+                slot = m_Discard[SlotId];
+            }
+        }
+        return slot;
+    }
+
+    void Abort()
+    /*!
+     * Stops the stream, the hardware must be stopped already. All application buffers are moved to the done FIFO as aborted.
+     */
+    {
+        ImxFrameBuffer_t buff;
+
+        m_IsRunning = false;
+        for (UINT32 i = 0; i < IMX_FRAME_RING_SLOT_NUM; ++i) {
+            if (m_Slot[i].m_CookiePtr != NULL) {
+                m_Slot[i].m_IsAborted = true;
+                m_Done.Push(m_Slot[i]);
+                ++m_Stats.m_AbortedCnt;
+            }
+            m_Slot[i] = m_Discard[i];
+        }
+        while (m_Pending.Pop(buff)) {
+            buff.m_IsAborted = true;
+            m_Done.Push(buff);
+            ++m_Stats.m_AbortedCnt;
+        }
+    }
+
+    bool Cancel(PVOID CookiePtr)
+    /*!
+     * Cancels an application buffer.
+     *
+     * @param CookiePtr buffer owner handle.
+     *
+     * @returns true if the buffer is still owned by the ring and is returned later by PopDone() with m_IsCanceled set.
+     *          false if the buffer was removed from the queue or is not owned by the ring, the caller completes it.
+     */
+    {
+        ImxFrameBuffer_t *buffPtr;
+
+        if (m_Pending.Remove(CookiePtr)) {
+            --m_Stats.m_InFlight;
+            ++m_Stats.m_AbortedCnt;
+            return false;
+        }
+        buffPtr = m_Done.Find(CookiePtr);
+        for (UINT32 i = 0; (i < IMX_FRAME_RING_SLOT_NUM) && (buffPtr == NULL); ++i) {
+            if (m_Slot[i].m_CookiePtr == CookiePtr) {
+                buffPtr = &m_Slot[i];
+            }
+        }
+        if (buffPtr != NULL) {
+            buffPtr->m_IsCanceled = true;
+            return true;
+        }
+        return false;
+    }
+
+    bool PopDone(ImxFrameBuffer_t &Buff)
+    /*!
+     * Takes the oldest completed, aborted or canceled application buffer.
+     *
+     * @param Buff receives the buffer.
+     *
+     * @returns false if there is no buffer to complete.
+     */
+    {
+        if (!m_Done.Pop(Buff)) {
+            return false;
+        }
+        --m_Stats.m_InFlight;
+        return true;
+    }
+
+    bool HasDone() const { return m_Done.Count() > 0; }
+    bool IsRunning() const { return m_IsRunning; }
+    const CaptureStats_t &GetStats() const { return m_Stats; }
+
+private:
+    /*! @brief Bounded FIFO of frame buffers. */
+    class Fifo_t
+    {
+    public:
+        Fifo_t() : m_Head(0), m_Count(0) { ; }
+
+        UINT32 Count() const { return m_Count; }
+
+        void Push(const ImxFrameBuffer_t &Buff)
+        {
+            ASSERT(m_Count < IMX_FRAME_RING_MAX_BUFFERS); // Bounded by m_InFlight.
+            m_Buff[(m_Head + m_Count) % IMX_FRAME_RING_MAX_BUFFERS] = Buff;
+            ++m_Count;
+        }
+
+        bool Pop(ImxFrameBuffer_t &Buff)
+        {
+            if (m_Count == 0) {
+                return false;
+            }
+            Buff = m_Buff[m_Head];
+            m_Head = (m_Head + 1) % IMX_FRAME_RING_MAX_BUFFERS;
+            --m_Count;
+            return true;
+        }
+
+        ImxFrameBuffer_t *Find(PVOID CookiePtr)
+        {
+            for (UINT32 i = 0; i < m_Count; ++i) {
+                ImxFrameBuffer_t &buff = m_Buff[(m_Head + i) % IMX_FRAME_RING_MAX_BUFFERS];
+
+                if (buff.m_CookiePtr == CookiePtr) {
+                    return &buff;
+                }
+            }
+            return NULL;
+        }
+
+        bool Remove(PVOID CookiePtr)
+        {
+            UINT32 i = 0;
+
+            while ((i < m_Count) && (m_Buff[(m_Head + i) % IMX_FRAME_RING_MAX_BUFFERS].m_CookiePtr != CookiePtr)) {
+                ++i;
+            }
+            if (i == m_Count) {
+                return false;
+            }
+            for (; (i + 1) < m_Count; ++i) { // Keep FIFO order of the remaining buffers.
+                m_Buff[(m_Head + i) % IMX_FRAME_RING_MAX_BUFFERS] = m_Buff[(m_Head + i + 1) % IMX_FRAME_RING_MAX_BUFFERS];
+            }
+            --m_Count;
+            return true;
+        }
+
+    private:
+        ImxFrameBuffer_t m_Buff[IMX_FRAME_RING_MAX_BUFFERS];
+        UINT32 m_Head;
+        UINT32 m_Count;
+    };
+
+    bool IsSlotQueued() const
+    {
+        for (UINT32 i = 0; i < IMX_FRAME_RING_SLOT_NUM; ++i) {
+            if (m_Slot[i].m_CookiePtr != NULL) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool m_IsRunning;
+    UINT32 m_Sequence;
+    CaptureStats_t m_Stats;
+    ImxFrameBuffer_t m_Discard[IMX_FRAME_RING_SLOT_NUM];
+    ImxFrameBuffer_t m_Slot[IMX_FRAME_RING_SLOT_NUM];
+    Fifo_t m_Pending;
+    Fifo_t m_Done;
+};
@@ -71,6 +71,18 @@ struct FrameInfo_t
     FrameInfo_t() : m_Virtual(0), m_ByteCount(0), m_Stride(0), m_StrideValid(0) { ; }
 };
 
+/*! @brief Zero-copy capture queue counters, reset when the stream is (re)initialized. */
+struct CaptureStats_t
+{
+    UINT32 m_QueuedCnt;      /*!< Application frame buffers accepted. */
+    UINT32 m_CompletedCnt;   /*!< Frames completed into application buffers. */
+    UINT32 m_DroppedCnt;     /*!< Frames captured into a driver buffer because no application buffer was queued. */
+    UINT32 m_LateCnt;        /*!< Buffers queued after the queue ran dry, i.e. at least one frame has already been dropped. */
+    UINT32 m_AbortedCnt;     /*!< Buffers returned unfilled because of stop, reinit or cancel. */
+    UINT32 m_InFlight;       /*!< Application buffers currently owned by the driver. */
+    UINT32 m_MaxInFlight;    /*!< High watermark of m_InFlight. */
+};
+
 struct camera_config_t // : csi2rx_config_t
 {
     UINT32 resolution;                  /*!< Resolution, see @ref video_resolution_t and @ref FSL_VIDEO_RESOLUTION. */
@@ -84,27 +96,41 @@ struct camera_config_t // : csi2rx_config_t
 
     bool ContClkMode;
 
+    UINT32 outputResolution;            /*!< Resolution written by the capture DMA, 0 if the same as resolution. */
+
     camera_config_t(
         UINT32 Resolution,
         video_pixel_format_t CameraPixelFormat,
         video_pixel_format_t ResultPixelFormat,
         UINT8 FramePerSec,
         UINT8 MipiChannel,
-        UINT8 CsiLanes
+        UINT8 CsiLanes,
+        UINT32 OutputResolution = 0
     ) :
         resolution(Resolution),
         cameraPixelFormat(CameraPixelFormat),
         resultPixelFormat(ResultPixelFormat),
         framePerSec(FramePerSec),
         mipiChannel(MipiChannel),
-        csiLanes(CsiLanes)
+        csiLanes(CsiLanes),
+        outputResolution(OutputResolution)
     {};
 
+    UINT32 GetOutputResolution() const
+    {
+        return (outputResolution != 0) ? outputResolution : resolution;
+    }
+
     UINT8 GetPixelSizeBits(const video_pixel_format_t &pixelFormat) const
     {
         UINT8 ret;
 
         switch (pixelFormat) {
+        case kVIDEO_PixelFormatXRGB8888:
+        case kVIDEO_PixelFormatARGB8888:
+            ret = 32;
+            break;
+
         case kVIDEO_PixelFormatRGB888:
             ret = 24;
             break;
@@ -0,0 +1,478 @@
+/*
+ * Copyright 2023 NXP
+ * All rights reserved.
+ *
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "ImxVideoCommon.hpp"
+
+#if defined(_M_ARM64)
+#include <arm64_neon.h>
+#define IMX_VIDEO_FORMAT_NEON 1
+#endif
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*! @brief Max number of formats the capture DMA can write. */
+#define IMX_CAPTURE_CAPS_MAX_FORMATS 8U
+
+/*! @brief Max downscale ratio in one direction the ISI supports (pre-decimation 8 x scaler < 4). */
+#define IMX_ISI_MAX_DOWNSCALE 16U
+
+/*! @brief 1.0 in the ISI scaler 2.12 fixed point format. */
+#define IMX_ISI_SCALE_ONE 0x1000U
+
+/*! @brief Max value of the 14-bit ISI scale factor. */
+#define IMX_ISI_SCALE_MAX 0x3FFFU
+
+/*! @brief Conversion the CPU does after the capture DMA. */
+typedef enum _imx_convert
+{
+    kIMX_ConvertNone = 0,       /*!< Hardware writes the requested format. */
+    kIMX_ConvertSwapYuv422,     /*!< YUYV <-> UYVY. */
+    kIMX_ConvertYuv422ToNv12,   /*!< YUYV or UYVY -> NV12, chroma of two lines is averaged. */
+    kIMX_ConvertYuv422ToXrgb,   /*!< YUYV or UYVY -> XRGB8888, BT.601 limited range. */
+} imx_convert_t;
+
+/*! @brief What a capture interface can do in hardware. */
+struct ImxCaptureCaps_t
+{
+    video_pixel_format_t m_Formats[IMX_CAPTURE_CAPS_MAX_FORMATS]; /*!< Formats the DMA can write, in order of preference. */
+    UINT32 m_FormatCnt;
+    UINT32 m_MaxDownscale;      /*!< Max downscale ratio in one direction, 1 if there's no scaler. */
+};
+
+/*! @brief Result of the format negotiation. */
+struct ImxCapturePlan_t
+{
+    video_pixel_format_t m_HwFormat;    /*!< Format the capture DMA writes. */
+    UINT32 m_HwResolution;              /*!< Resolution the capture DMA writes, see @ref FSL_VIDEO_RESOLUTION. */
+    UINT32 m_HwFrameBytes;
+    video_pixel_format_t m_OutFormat;   /*!< Format delivered to the consumer. */
+    UINT32 m_OutResolution;
+    UINT32 m_OutFrameBytes;
+    imx_convert_t m_Convert;
+};
+
+/*! @brief ISI pre-decimation and scaler setting for one stream. */
+struct ImxIsiScale_t
+{
+    UINT32 m_DecX;      /*!< IMG_CTRL DEC_X field, decimation is 1 << m_DecX. */
+    UINT32 m_DecY;      /*!< IMG_CTRL DEC_Y field, decimation is 1 << m_DecY. */
+    UINT32 m_ScaleX;    /*!< SCALE_FACTOR X_SCALE, 2.12 fixed point. */
+    UINT32 m_ScaleY;    /*!< SCALE_FACTOR Y_SCALE, 2.12 fixed point. */
+};
+
+/*******************************************************************************
+ * Format helpers
+ ******************************************************************************/
+
+inline bool ImxIsYuv422(video_pixel_format_t Format)
+{
+    return (Format == kVIDEO_PixelFormatYUYV) || (Format == kVIDEO_PixelFormatUYVY);
+}
+
+inline UINT32 ImxFrameBytes(video_pixel_format_t Format, UINT32 Resolution)
+/*!
+ * Returns size of a tightly packed frame.
+ *
+ * @param Format pixel format.
+ * @param Resolution frame resolution.
+ *
+ * @returns Frame size in bytes or 0 for an unknown format.
+ */
+{
+    const UINT32 pixels = (UINT32)FSL_VIDEO_EXTRACT_WIDTH(Resolution) * FSL_VIDEO_EXTRACT_HEIGHT(Resolution);
+    UINT32 ret;
+
+    switch (Format) {
+    case kVIDEO_PixelFormatXRGB8888:
+    case kVIDEO_PixelFormatARGB8888:
+        ret = pixels * 4;
+        break;
+    case kVIDEO_PixelFormatRGB888:
+        ret = pixels * 3;
+        break;
+    case kVIDEO_PixelFormatRGB565:
+    case kVIDEO_PixelFormatYUYV:
+    case kVIDEO_PixelFormatUYVY:
+        ret = pixels * 2;
+        break;
+    case kVIDEO_PixelFormatNV12:
+        ret = pixels + (pixels / 2);
+        break;
+    default:
+        ret = 0;
+        break;
+    }
+    return ret;
+}
+
+inline imx_convert_t ImxGetConversion(video_pixel_format_t From, video_pixel_format_t To)
+/*!
+ * Returns the CPU conversion between two formats.
+ *
+ * @param From format written by the hardware.
+ * @param To format requested by the consumer.
+ *
+ * @returns kIMX_ConvertNone if the formats are the same or there's no such conversion, see ImxNegotiateCapture().
+ */
+{
+    imx_convert_t ret = kIMX_ConvertNone;
+
+    if (ImxIsYuv422(From) && (From != To)) {
+        switch (To) {
+        case kVIDEO_PixelFormatYUYV:
+        case kVIDEO_PixelFormatUYVY:
+            ret = kIMX_ConvertSwapYuv422;
+            break;
+        case kVIDEO_PixelFormatNV12:
+            ret = kIMX_ConvertYuv422ToNv12;
+            break;
+        case kVIDEO_PixelFormatXRGB8888:
+            ret = kIMX_ConvertYuv422ToXrgb;
+            break;
+        default:
+            break;
+        }
+    }
+    return ret;
+}
+
+inline bool ImxNegotiateCapture(const ImxCaptureCaps_t &Caps, UINT32 SensorResolution, video_pixel_format_t OutFormat, UINT32 OutResolution, ImxCapturePlan_t &Plan)
+/*!
+ * Chooses how to deliver a format and resolution from the sensor stream.
+ * Hardware formats are preferred, a format the hardware can't write is converted by the CPU from a YUV 4:2:2 hardware format.
+ * Only the hardware scales, the CPU conversion keeps the resolution.
+ *
+ * @param Caps hardware capabilities.
+ * @param SensorResolution resolution of the sensor stream.
+ * @param OutFormat format requested by the consumer.
+ * @param OutResolution resolution requested by the consumer.
+ * @param Plan receives the result.
+ *
+ * @returns true if the request can be satisfied.
+ */
+{
+    const UINT32 inW = FSL_VIDEO_EXTRACT_WIDTH(SensorResolution);
+    const UINT32 inH = FSL_VIDEO_EXTRACT_HEIGHT(SensorResolution);
+    const UINT32 outW = FSL_VIDEO_EXTRACT_WIDTH(OutResolution);
+    const UINT32 outH = FSL_VIDEO_EXTRACT_HEIGHT(OutResolution);
+    bool ret = true;
+
+    Plan = ImxCapturePlan_t();
+    // Even dimensions keep 4:2:x chroma aligned, the 8-byte line pitch is checked by the capture driver.
+    if ((outW == 0) || (outH == 0) || ((outW % 2) != 0) || ((outH % 2) != 0) || (outW > inW) || (outH > inH)) {
+        ret = false;
+    }
+    else if ((OutResolution != SensorResolution)
+        && ((Caps.m_MaxDownscale <= 1) || ((outW * Caps.m_MaxDownscale) < inW) || ((outH * Caps.m_MaxDownscale) < inH))) {
+        ret = false;
+    }
+    if (ret) {
+        UINT32 i;
+
+        for (i = 0; i < Caps.m_FormatCnt; ++i) {
+            if (Caps.m_Formats[i] == OutFormat) {
+                break;
+            }
+        }
+        if (i < Caps.m_FormatCnt) {
+            Plan.m_HwFormat = OutFormat;
+            Plan.m_Convert = kIMX_ConvertNone;
+        }
+        else {
+            for (i = 0; i < Caps.m_FormatCnt; ++i) {
+                imx_convert_t convert = ImxGetConversion(Caps.m_Formats[i], OutFormat);
+
+                if (convert != kIMX_ConvertNone) {
+                    Plan.m_HwFormat = Caps.m_Formats[i];
+                    Plan.m_Convert = convert;
+                    break;
+                }
+            }
+            ret = (i < Caps.m_FormatCnt);
+        }
+    }
+    if (ret) {
+        Plan.m_HwResolution = OutResolution;
+        Plan.m_HwFrameBytes = ImxFrameBytes(Plan.m_HwFormat, OutResolution);
+        Plan.m_OutFormat = OutFormat;
+        Plan.m_OutResolution = OutResolution;
+        Plan.m_OutFrameBytes = ImxFrameBytes(OutFormat, OutResolution);
+        ret = (Plan.m_HwFrameBytes != 0) && (Plan.m_OutFrameBytes != 0);
+    }
+    return ret;
+}
+
+/*******************************************************************************
+ * ISI scaler
+ ******************************************************************************/
+
+inline UINT32 ImxIsiScaleAxis(UINT32 In, UINT32 Out, UINT32 &Dec)
+/*!
+ * Splits a downscale ratio into the power of two pre-decimation and the remaining 2.12 fixed point scale factor.
+ * Decimation is used as soon as the ratio reaches 2, the bilinear scaler then works on a ratio below 2.
+ *
+ * @param In input size.
+ * @param Out output size, not 0.
+ * @param Dec receives the DEC_X/DEC_Y field value.
+ *
+ * @returns The scale factor.
+ */
+{
+    const UINT32 ratio = (UINT32)(((UINT64)In * IMX_ISI_SCALE_ONE) / Out);
+    UINT32 factor;
+
+    if (ratio < (2 * IMX_ISI_SCALE_ONE)) {
+        Dec = 0;
+    }
+    else if (ratio < (4 * IMX_ISI_SCALE_ONE)) {
+        Dec = 1;
+    }
+    else if (ratio < (8 * IMX_ISI_SCALE_ONE)) {
+        Dec = 2;
+    }
+    else {
+        Dec = 3;
+    }
+    factor = (UINT32)(((UINT64)In * IMX_ISI_SCALE_ONE) / ((UINT64)Out << Dec));
+    if (factor > IMX_ISI_SCALE_MAX) {
+        factor = IMX_ISI_SCALE_MAX;
+    }
+    return factor;
+}
+
+inline bool ImxIsiComputeScale(UINT32 InResolution, UINT32 OutResolution, ImxIsiScale_t &Scale)
+/*!
+ * Computes the ISI decimation and scaler setting for a downscale.
+ *
+ * @param InResolution resolution of the ISI input.
+ * @param OutResolution resolution of the ISI output.
+ * @param Scale receives the register fields.
+ *
+ * @returns false if the ISI can't produce the output resolution.
+ */
+{
+    const UINT32 inW = FSL_VIDEO_EXTRACT_WIDTH(InResolution);
+    const UINT32 inH = FSL_VIDEO_EXTRACT_HEIGHT(InResolution);
+    const UINT32 outW = FSL_VIDEO_EXTRACT_WIDTH(OutResolution);
+    const UINT32 outH = FSL_VIDEO_EXTRACT_HEIGHT(OutResolution);
+    bool ret = true;
+
+    Scale = ImxIsiScale_t();
+    // The ISI scaler doesn't upscale.
+    if ((outW == 0) || (outH == 0) || (outW > inW) || (outH > inH)
+        || ((outW * IMX_ISI_MAX_DOWNSCALE) < inW) || ((outH * IMX_ISI_MAX_DOWNSCALE) < inH)) {
+        ret = false;
+    }
+    else {
+        Scale.m_ScaleX = ImxIsiScaleAxis(inW, outW, Scale.m_DecX);
+        Scale.m_ScaleY = ImxIsiScaleAxis(inH, outH, Scale.m_DecY);
+    }
+    return ret;
+}
+
+/*******************************************************************************
+ * CPU fallback converters
+ *
+ * Frames are tightly packed, width and height are even. ARM64 builds use NEON for 16 pixel blocks and the scalar code
+ * for the rest of a line, both paths give the same result. The ARM64 kernel preserves NEON state, no save/restore is needed.
+ ******************************************************************************/
+
+inline UINT8 ImxClampU8(INT32 Val)
+{
+    return (UINT8)((Val < 0) ? 0 : ((Val > 255) ? 255 : Val));
+}
+
+inline void ImxSwapYuv422(const UINT8 *SrcPtr, UINT8 *DstPtr, UINT32 Width, UINT32 Height)
+/*!
+ * Converts YUYV to UYVY or UYVY to YUYV, the operation is the same.
+ *
+ * @param SrcPtr source frame.
+ * @param DstPtr destination frame, can be the same as SrcPtr.
+ * @param Width frame width in pixels.
+ * @param Height frame height in lines.
+ */
+{
+    const UINT32 bytes = Width * Height * 2;
+    UINT32 i = 0;
+
+#if defined(IMX_VIDEO_FORMAT_NEON)
+    for (; (i + 16) <= bytes; i += 16) {
+        vst1q_u8(DstPtr + i, vrev16q_u8(vld1q_u8(SrcPtr + i)));
+    }
+#endif
+    for (; i < bytes; i += 2) {
+        UINT8 tmp = SrcPtr[i];
+
+        DstPtr[i] = SrcPtr[i + 1];
+        DstPtr[i + 1] = tmp;
+    }
+}
+
+inline void ImxYuv422ToNv12(const UINT8 *SrcPtr, bool SrcIsUyvy, UINT8 *DstPtr, UINT32 Width, UINT32 Height)
+/*!
+ * Converts YUYV or UYVY to NV12. The chroma of a line pair is averaged.
+ *
+ * @param SrcPtr source frame.
+ * @param SrcIsUyvy source is UYVY, otherwise YUYV.
+ * @param DstPtr destination frame, the UV plane follows the Y plane.
+ * @param Width frame width in pixels.
+ * @param Height frame height in lines.
+ */
+{
+    const UINT32 srcPitch = Width * 2;
+    const UINT32 yOffs = SrcIsUyvy ? 1 : 0;
+    const UINT32 cOffs = SrcIsUyvy ? 0 : 1;
+    UINT8 *uvPtr = DstPtr + (Width * Height);
+
+    for (UINT32 line = 0; line < Height; line += 2) {
+        const UINT8 *s0Ptr = SrcPtr + (line * srcPitch);
+        const UINT8 *s1Ptr = s0Ptr + srcPitch;
+        UINT8 *y0Ptr = DstPtr + (line * Width);
+        UINT8 *y1Ptr = y0Ptr + Width;
+        UINT8 *cPtr = uvPtr + ((line / 2) * Width);
+        UINT32 x = 0;
+
+#if defined(IMX_VIDEO_FORMAT_NEON)
+        for (; (x + 16) <= Width; x += 16) {
+            // val[yOffs] is 16 luma samples, val[cOffs] 8 U/V pairs already in NV12 order.
+            uint8x16x2_t p0 = vld2q_u8(s0Ptr + (x * 2));
+            uint8x16x2_t p1 = vld2q_u8(s1Ptr + (x * 2));
+
+            vst1q_u8(y0Ptr + x, p0.val[yOffs]);
+            vst1q_u8(y1Ptr + x, p1.val[yOffs]);
+            vst1q_u8(cPtr + x, vrhaddq_u8(p0.val[cOffs], p1.val[cOffs]));
+        }
+#endif
+        for (; x < Width; ++x) {
+            y0Ptr[x] = s0Ptr[(x * 2) + yOffs];
+            y1Ptr[x] = s1Ptr[(x * 2) + yOffs];
+            cPtr[x] = (UINT8)((s0Ptr[(x * 2) + cOffs] + s1Ptr[(x * 2) + cOffs] + 1) >> 1);
+        }
+    }
+}
+
+/*
+ * BT.601 limited range with 6-bit coefficients, the terms fit INT16 for NEON:
+ * R = (74 * (Y - 16) + 102 * (V - 128) + 32) >> 6
+ * G = (74 * (Y - 16) - 25 * (U - 128) - 52 * (V - 128) + 32) >> 6
+ * B = (74 * (Y - 16) + 129 * (U - 128) + 32) >> 6
+ */
+inline UINT32 ImxYuvToXrgbPixel(UINT32 Y, INT32 D, INT32 E)
+{
+    const INT32 c = (74 * (INT32)Y) - ((74 * 16) - 32);
+
+    return ((UINT32)ImxClampU8((c + (102 * E)) >> 6) << 16)
+        | ((UINT32)ImxClampU8((c - (25 * D) - (52 * E)) >> 6) << 8)
+        | (UINT32)ImxClampU8((c + (129 * D)) >> 6)
+        | 0xFF000000U;
+}
+
+inline void ImxYuv422ToXrgb(const UINT8 *SrcPtr, bool SrcIsUyvy, UINT8 *DstPtr, UINT32 Width, UINT32 Height)
+/*!
+ * Converts YUYV or UYVY to XRGB8888 (B, G, R, X byte order).
+ *
+ * @param SrcPtr source frame.
+ * @param SrcIsUyvy source is UYVY, otherwise YUYV.
+ * @param DstPtr destination frame.
+ * @param Width frame width in pixels.
+ * @param Height frame height in lines.
+ */
+{
+    // Byte offsets of Y0, U, Y1, V in a macro pixel.
+    const UINT32 y0Offs = SrcIsUyvy ? 1 : 0;
+    const UINT32 uOffs = SrcIsUyvy ? 0 : 1;
+    const UINT32 y1Offs = SrcIsUyvy ? 3 : 2;
+    const UINT32 vOffs = SrcIsUyvy ? 2 : 3;
+
+    for (UINT32 line = 0; line < Height; ++line) {
+        const UINT8 *sPtr = SrcPtr + (line * Width * 2);
+        UINT8 *dPtr = DstPtr + (line * Width * 4);
+        UINT32 x = 0;
+
+#if defined(IMX_VIDEO_FORMAT_NEON)
+        const int16x8_t yBias = vdupq_n_s16((74 * 16) - 32);
+        const uint8x8_t yCoeff = vdup_n_u8(74);
+        const uint8x8_t cBias = vdup_n_u8(128);
+
+        for (; (x + 16) <= Width; x += 16) {
+            const uint8x8x4_t p = vld4_u8(sPtr + (x * 2));
+            const int16x8_t d = vreinterpretq_s16_u16(vsubl_u8(p.val[uOffs], cBias));
+            const int16x8_t e = vreinterpretq_s16_u16(vsubl_u8(p.val[vOffs], cBias));
+            const int16x8_t rC = vmulq_n_s16(e, 102);
+            const int16x8_t gC = vmlaq_n_s16(vmulq_n_s16(d, -25), e, -52);
+            const int16x8_t bC = vmulq_n_s16(d, 129);
+            const int16x8_t c0 = vsubq_s16(vreinterpretq_s16_u16(vmull_u8(p.val[y0Offs], yCoeff)), yBias);
+            const int16x8_t c1 = vsubq_s16(vreinterpretq_s16_u16(vmull_u8(p.val[y1Offs], yCoeff)), yBias);
+            // Saturation only hits sums far above 255 << 6, the narrowing clamps them anyway.
+            const uint8x8x2_t r = vzip_u8(vqshrun_n_s16(vqaddq_s16(c0, rC), 6), vqshrun_n_s16(vqaddq_s16(c1, rC), 6));
+            const uint8x8x2_t g = vzip_u8(vqshrun_n_s16(vqaddq_s16(c0, gC), 6), vqshrun_n_s16(vqaddq_s16(c1, gC), 6));
+            const uint8x8x2_t b = vzip_u8(vqshrun_n_s16(vqaddq_s16(c0, bC), 6), vqshrun_n_s16(vqaddq_s16(c1, bC), 6));
+            uint8x16x4_t out;
+
+            out.val[0] = vcombine_u8(b.val[0], b.val[1]);
+            out.val[1] = vcombine_u8(g.val[0], g.val[1]);
+            out.val[2] = vcombine_u8(r.val[0], r.val[1]);
+            out.val[3] = vdupq_n_u8(0xFF);
+            vst4q_u8(dPtr + (x * 4), out);
+        }
+#endif
+        for (; x < Width; x += 2) {
+            const UINT8 *mPtr = sPtr + (x * 2);
+            const INT32 d = (INT32)mPtr[uOffs] - 128;
+            const INT32 e = (INT32)mPtr[vOffs] - 128;
+            const UINT32 px0 = ImxYuvToXrgbPixel(mPtr[y0Offs], d, e);
+            const UINT32 px1 = ImxYuvToXrgbPixel(mPtr[y1Offs], d, e);
+
+            dPtr[(x * 4) + 0] = (UINT8)px0;
+            dPtr[(x * 4) + 1] = (UINT8)(px0 >> 8);
+            dPtr[(x * 4) + 2] = (UINT8)(px0 >> 16);
+            dPtr[(x * 4) + 3] = (UINT8)(px0 >> 24);
+            dPtr[(x * 4) + 4] = (UINT8)px1;
+            dPtr[(x * 4) + 5] = (UINT8)(px1 >> 8);
+            dPtr[(x * 4) + 6] = (UINT8)(px1 >> 16);
+            dPtr[(x * 4) + 7] = (UINT8)(px1 >> 24);
+        }
+    }
+}
+
+inline bool ImxConvertFrame(const ImxCapturePlan_t &Plan, const UINT8 *SrcPtr, UINT8 *DstPtr)
+/*!
+ * Converts a frame written by the hardware to the consumer format.
+ *
+ * @param Plan negotiated capture plan.
+ * @param SrcPtr frame written by the hardware, Plan.m_HwFrameBytes long.
+ * @param DstPtr consumer buffer, Plan.m_OutFrameBytes long.
+ *
+ * @returns false if the plan doesn't need a conversion.
+ */
+{
+    const UINT32 width = FSL_VIDEO_EXTRACT_WIDTH(Plan.m_OutResolution);
+    const UINT32 height = FSL_VIDEO_EXTRACT_HEIGHT(Plan.m_OutResolution);
+    const bool srcIsUyvy = (Plan.m_HwFormat == kVIDEO_PixelFormatUYVY);
+    bool ret = true;
+
+    switch (Plan.m_Convert) {
+    case kIMX_ConvertSwapYuv422:
+        ImxSwapYuv422(SrcPtr, DstPtr, width, height);
+        break;
+    case kIMX_ConvertYuv422ToNv12:
+        ImxYuv422ToNv12(SrcPtr, srcIsUyvy, DstPtr, width, height);
+        break;
+    case kIMX_ConvertYuv422ToXrgb:
+        ImxYuv422ToXrgb(SrcPtr, srcIsUyvy, DstPtr, width, height);
+        break;
+    default:
+        ret = false;
+        break;
+    }
+    return ret;
+}
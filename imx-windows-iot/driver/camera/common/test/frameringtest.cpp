@@ -0,0 +1,594 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host unit test of the zero-copy capture buffer rotation (ImxFrameRing.hpp)
+//
+// The ring is driven the way the ISI and CSI drivers drive it: the queue
+// handler queues buffers, the ISR reports the slot which finished a frame
+// and programs the buffer the ring returns, the DPC pops and completes the
+// finished buffers, the cancel routine cancels them, and stop and reinit
+// abort and restart the stream. A model tracks who owns each buffer (the
+// pending queue, a hardware slot, the done queue or the caller) and the
+// counters, and every buffer must come back to the caller exactly once,
+// with the right outcome.
+//
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint8_t UINT8;
+typedef uint16_t UINT16;
+typedef uint32_t UINT32;
+typedef uint64_t UINT64;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef unsigned char BOOLEAN;
+typedef unsigned char* PUCHAR;
+typedef void* PVOID;
+
+#include "HostTest.h"
+
+#define ASSERT(Cond) CHECK(Cond)
+
+#include "ImxFrameRing.hpp"
+
+#include <deque>
+#include <map>
+#include <set>
+
+#define RANDOM_STEPS 500000
+#define DISCARD_PHYS(SlotId) (0xD0000000ULL + (SlotId) * 0x100000ULL)
+#define BUFFER_PHYS(Id) (0x40000000ULL + (UINT64)(Id) * 0x100000ULL)
+
+/*! @brief Where a buffer is, according to the model. */
+enum BufferState_t
+{
+    BUFFER_PENDING,
+    BUFFER_IN_SLOT,
+    BUFFER_DONE,
+    BUFFER_RETURNED,
+};
+
+/*! @brief How a buffer came back to the caller. */
+enum BufferOutcome_t
+{
+    OUTCOME_NONE,
+    OUTCOME_FILLED,     /*!< Completed with a frame. */
+    OUTCOME_ABORTED,    /*!< Completed unfilled, stream stopped. */
+    OUTCOME_CANCELED,   /*!< Completed by the cancel routine or as canceled. */
+};
+
+struct ModelBuffer_t
+{
+    BufferState_t m_State;
+    BufferOutcome_t m_Outcome;
+    BufferOutcome_t m_Expected;
+    bool m_IsCanceled;
+    UINT32 m_Sequence;
+    UINT32 m_Stream;
+};
+
+/*! @brief Reference model of the rotation. */
+struct RingModel_t
+{
+    bool m_IsRunning;
+    UINT32 m_Sequence;
+    UINT32 m_Slot[IMX_FRAME_RING_SLOT_NUM];  /*!< Buffer id in each slot, 0 for the discard buffer. */
+    std::deque<UINT32> m_Pending;
+    std::deque<UINT32> m_Done;
+    std::map<UINT32, ModelBuffer_t> m_Buffers;
+    std::set<UINT32> m_Owned;  /*!< Buffers not returned yet. */
+    CaptureStats_t m_Stats;
+    UINT32 m_Stream;        /*!< Incremented by each Start(). */
+    UINT32 m_LastStream;
+    UINT32 m_LastSequence;
+};
+
+static ImxFrameRing_t *g_RingPtr;
+static RingModel_t g_Model;
+static UINT32 g_NextId;
+static UINT32 g_Returned;
+
+static unsigned g_Seed = 1;
+
+static unsigned Random(unsigned Range)
+{
+    g_Seed = g_Seed * 1103515245 + 12345;
+    return (g_Seed >> 8) % Range;
+}
+
+static PVOID Cookie(UINT32 Id)
+{
+    return (PVOID)(uintptr_t)(Id * 16);
+}
+
+static UINT32 CookieId(PVOID CookiePtr)
+{
+    return (UINT32)((uintptr_t)CookiePtr / 16);
+}
+
+static bool StatsMatch()
+{
+    const CaptureStats_t &stats = g_RingPtr->GetStats();
+    const CaptureStats_t &model = g_Model.m_Stats;
+
+    return (stats.m_QueuedCnt == model.m_QueuedCnt) &&
+           (stats.m_CompletedCnt == model.m_CompletedCnt) &&
+           (stats.m_DroppedCnt == model.m_DroppedCnt) &&
+           (stats.m_LateCnt == model.m_LateCnt) &&
+           (stats.m_AbortedCnt == model.m_AbortedCnt) &&
+           (stats.m_InFlight == model.m_InFlight) &&
+           (stats.m_MaxInFlight == model.m_MaxInFlight);
+}
+
+static void Reset()
+{
+    static ImxFrameRing_t ring;
+
+    ring = ImxFrameRing_t();
+    g_RingPtr = &ring;
+    g_Model = RingModel_t();
+    for (UINT32 i = 0; i < IMX_FRAME_RING_SLOT_NUM; ++i) {
+        g_RingPtr->SetDiscardBuffer(i, DISCARD_PHYS(i), DISCARD_PHYS(i) + 0x80000);
+    }
+    g_NextId = 1;
+    g_Returned = 0;
+}
+
+static void Start()
+/*!
+ * DRIVER_INIT: the stream restarts with both slots on the discard buffers.
+ */
+{
+    g_RingPtr->Start();
+    g_Model.m_IsRunning = true;
+    g_Model.m_Sequence = 0;
+    ++g_Model.m_Stream;
+    for (UINT32 i = 0; i < IMX_FRAME_RING_SLOT_NUM; ++i) {
+        g_Model.m_Slot[i] = 0;
+    }
+    g_Model.m_Stats = CaptureStats_t();
+    g_Model.m_Stats.m_InFlight = (UINT32)g_Model.m_Done.size();
+    CHECK(g_RingPtr->IsRunning());
+    CHECK(StatsMatch());
+}
+
+static bool Queue()
+/*!
+ * Queue handler: a new buffer is accepted only while the stream runs and fewer than the maximum are in flight.
+ */
+{
+    UINT32 id = g_NextId++;
+    ImxFrameBuffer_t buff = {};
+    bool isExpected = g_Model.m_IsRunning && (g_Model.m_Stats.m_InFlight < IMX_FRAME_RING_MAX_BUFFERS);
+
+    buff.m_PhysY = BUFFER_PHYS(id);
+    buff.m_PhysU = BUFFER_PHYS(id) + 0x80000;
+    buff.m_CookiePtr = Cookie(id);
+    buff.m_IsCanceled = true; // Stale flags must not leak into the ring.
+    buff.m_IsAborted = true;
+
+    bool isQueued = g_RingPtr->Queue(buff);
+    CHECK(isQueued == isExpected);
+    if (isQueued) {
+        if ((g_Model.m_Stats.m_QueuedCnt > 0) && g_Model.m_Pending.empty() &&
+            (g_Model.m_Slot[0] == 0) && (g_Model.m_Slot[1] == 0)) {
+            ++g_Model.m_Stats.m_LateCnt;
+        }
+        g_Model.m_Pending.push_back(id);
+        g_Model.m_Buffers[id] = ModelBuffer_t();
+        g_Model.m_Buffers[id].m_State = BUFFER_PENDING;
+        g_Model.m_Owned.insert(id);
+        ++g_Model.m_Stats.m_QueuedCnt;
+        if (++g_Model.m_Stats.m_InFlight > g_Model.m_Stats.m_MaxInFlight) {
+            g_Model.m_Stats.m_MaxInFlight = g_Model.m_Stats.m_InFlight;
+        }
+    }
+    return isQueued;
+}
+
+static void FrameDone(UINT32 SlotId)
+/*!
+ * ISR: the slot finished a frame, the returned buffer is programmed into it.
+ */
+{
+    const ImxFrameBuffer_t &next = g_RingPtr->FrameDone(SlotId);
+    UINT32 &slot = g_Model.m_Slot[SlotId];
+
+    if (g_Model.m_IsRunning) {
+        if (slot != 0) {
+            ModelBuffer_t &buff = g_Model.m_Buffers[slot];
+
+            buff.m_State = BUFFER_DONE;
+            buff.m_Sequence = g_Model.m_Sequence;
+            buff.m_Stream = g_Model.m_Stream;
+            if (buff.m_IsCanceled) {
+                buff.m_Expected = OUTCOME_CANCELED;
+                ++g_Model.m_Stats.m_AbortedCnt;
+            }
+            else {
+                buff.m_Expected = OUTCOME_FILLED;
+                ++g_Model.m_Stats.m_CompletedCnt;
+            }
+            g_Model.m_Done.push_back(slot);
+        }
+        else if (g_Model.m_Stats.m_QueuedCnt > 0) {
+            ++g_Model.m_Stats.m_DroppedCnt;
+        }
+        ++g_Model.m_Sequence;
+        slot = 0;
+        if (!g_Model.m_Pending.empty()) {
+            slot = g_Model.m_Pending.front();
+            g_Model.m_Pending.pop_front();
+            g_Model.m_Buffers[slot].m_State = BUFFER_IN_SLOT;
+        }
+    }
+
+    if (slot == 0) {
+        CHECK((next.m_CookiePtr == NULL) && (next.m_PhysY == DISCARD_PHYS(SlotId)));
+    }
+    else {
+        CHECK((next.m_CookiePtr == Cookie(slot)) && (next.m_PhysY == BUFFER_PHYS(slot)));
+        CHECK(next.m_PhysU == BUFFER_PHYS(slot) + 0x80000);
+    }
+    CHECK(g_RingPtr->HasDone() == !g_Model.m_Done.empty());
+}
+
+static void Return(UINT32 Id, BufferOutcome_t Outcome)
+{
+    ModelBuffer_t &buff = g_Model.m_Buffers[Id];
+
+    CHECK(buff.m_State != BUFFER_RETURNED); // Completed once only.
+    CHECK(buff.m_Outcome == OUTCOME_NONE);
+    buff.m_State = BUFFER_RETURNED;
+    buff.m_Outcome = Outcome;
+    g_Model.m_Owned.erase(Id);
+    ++g_Returned;
+}
+
+static void PopDone()
+/*!
+ * DPC: completes the finished buffers, in the order they finished, the way CompleteQueuedFrames() does.
+ */
+{
+    ImxFrameBuffer_t buff;
+
+    while (g_RingPtr->PopDone(buff)) {
+        UINT32 id = CookieId(buff.m_CookiePtr);
+
+        CHECK(!g_Model.m_Done.empty() && (g_Model.m_Done.front() == id));
+        if (g_Model.m_Done.empty() || (g_Model.m_Done.front() != id)) {
+            return;
+        }
+        g_Model.m_Done.pop_front();
+        --g_Model.m_Stats.m_InFlight;
+
+        ModelBuffer_t &model = g_Model.m_Buffers[id];
+        BufferOutcome_t outcome = buff.m_IsCanceled ? OUTCOME_CANCELED : (buff.m_IsAborted ? OUTCOME_ABORTED : OUTCOME_FILLED);
+
+        // Canceled while it waited in the done queue: filled, but completed as canceled.
+        CHECK((outcome == model.m_Expected) || (model.m_IsCanceled && (outcome == OUTCOME_CANCELED)));
+        CHECK(buff.m_IsCanceled == model.m_IsCanceled);
+        CHECK(buff.m_IsAborted == (model.m_Expected != OUTCOME_FILLED)); // Not filled, or not to be used.
+        if (outcome == OUTCOME_FILLED) {
+            CHECK(buff.m_Sequence == model.m_Sequence);
+            // Sequence numbers restart with each stream, a stream may still complete after the next one started.
+            CHECK((model.m_Stream != g_Model.m_LastStream) || (buff.m_Sequence > g_Model.m_LastSequence));
+            g_Model.m_LastStream = model.m_Stream;
+            g_Model.m_LastSequence = buff.m_Sequence;
+        }
+        Return(id, outcome);
+    }
+    CHECK(g_Model.m_Done.empty());
+}
+
+static void Cancel(UINT32 Id)
+/*!
+ * Cancel routine: a pending buffer is taken back and completed at once, a buffer in a slot or in the done queue is
+ * completed as canceled by the DPC, an unknown or returned buffer is not touched.
+ */
+{
+    bool isOwned = g_RingPtr->Cancel(Cookie(Id));
+    auto it = g_Model.m_Buffers.find(Id);
+
+    if ((it == g_Model.m_Buffers.end()) || (it->second.m_State == BUFFER_RETURNED)) {
+        CHECK(!isOwned);
+        return;
+    }
+
+    ModelBuffer_t &buff = it->second;
+    switch (buff.m_State) {
+    case BUFFER_PENDING:
+        CHECK(!isOwned);
+        for (auto pendingIt = g_Model.m_Pending.begin(); pendingIt != g_Model.m_Pending.end(); ++pendingIt) {
+            if (*pendingIt == Id) {
+                g_Model.m_Pending.erase(pendingIt);
+                break;
+            }
+        }
+        --g_Model.m_Stats.m_InFlight;
+        ++g_Model.m_Stats.m_AbortedCnt;
+        Return(Id, OUTCOME_CANCELED);
+        break;
+    case BUFFER_IN_SLOT:
+    case BUFFER_DONE:
+        CHECK(isOwned);
+        buff.m_IsCanceled = true;
+        break;
+    default:
+        break;
+    }
+}
+
+static void Abort()
+/*!
+ * STOP, reinit, cleanup or power-down: the hardware is stopped, every buffer goes to the done queue as aborted,
+ * the ones in the slots first.
+ */
+{
+    g_RingPtr->Abort();
+    g_Model.m_IsRunning = false;
+    for (UINT32 i = 0; i < IMX_FRAME_RING_SLOT_NUM; ++i) {
+        UINT32 id = g_Model.m_Slot[i];
+
+        if (id != 0) {
+            ModelBuffer_t &buff = g_Model.m_Buffers[id];
+
+            buff.m_State = BUFFER_DONE;
+            buff.m_Expected = buff.m_IsCanceled ? OUTCOME_CANCELED : OUTCOME_ABORTED;
+            g_Model.m_Done.push_back(id);
+            ++g_Model.m_Stats.m_AbortedCnt;
+        }
+        g_Model.m_Slot[i] = 0;
+    }
+    while (!g_Model.m_Pending.empty()) {
+        UINT32 id = g_Model.m_Pending.front();
+        ModelBuffer_t &buff = g_Model.m_Buffers[id];
+
+        g_Model.m_Pending.pop_front();
+        buff.m_State = BUFFER_DONE;
+        buff.m_Expected = OUTCOME_ABORTED;
+        g_Model.m_Done.push_back(id);
+        ++g_Model.m_Stats.m_AbortedCnt;
+    }
+    CHECK(!g_RingPtr->IsRunning());
+}
+
+static bool OwnershipMatches()
+/*!
+ * Every buffer not returned to the caller is in exactly one place, and the ring agrees on the number in flight.
+ */
+{
+    UINT32 inFlight = (UINT32)g_Model.m_Owned.size();
+
+    for (UINT32 owned : g_Model.m_Owned) {
+        UINT32 places = 0;
+
+        for (UINT32 id : g_Model.m_Pending) {
+            places += (id == owned);
+        }
+        for (UINT32 id : g_Model.m_Done) {
+            places += (id == owned);
+        }
+        for (UINT32 i = 0; i < IMX_FRAME_RING_SLOT_NUM; ++i) {
+            places += (g_Model.m_Slot[i] == owned);
+        }
+        if (places != 1) {
+            return false;
+        }
+    }
+    return (inFlight == g_Model.m_Stats.m_InFlight) && (inFlight <= IMX_FRAME_RING_MAX_BUFFERS);
+}
+
+static void TestRotation()
+{
+    Reset();
+
+    // Not started: nothing is accepted.
+    CHECK(!Queue());
+    Start();
+
+    // No buffer queued yet: frames go to the discard buffers, not counted as dropped.
+    FrameDone(0);
+    FrameDone(1);
+    CHECK(g_RingPtr->GetStats().m_DroppedCnt == 0);
+
+    // Two buffers fill the two slots as they finish, the frames already in the discard buffers are dropped.
+    CHECK(Queue() && Queue());
+    FrameDone(0);
+    FrameDone(1);
+    CHECK(!g_RingPtr->HasDone());
+    CHECK(g_RingPtr->GetStats().m_DroppedCnt == 2);
+
+    // Then they come back in order.
+    CHECK(Queue());
+    FrameDone(0);
+    FrameDone(1);
+    PopDone();
+    CHECK(g_RingPtr->GetStats().m_CompletedCnt == 2);
+
+    // Queue ran dry: slot 1 holds nothing, its frame is dropped, the next buffer is late.
+    FrameDone(0);
+    FrameDone(1);
+    PopDone();
+    CHECK(g_RingPtr->GetStats().m_DroppedCnt == 3);
+    CHECK(Queue());
+    CHECK(g_RingPtr->GetStats().m_LateCnt == 1);
+    FrameDone(0);
+    FrameDone(0);
+    PopDone();
+    CHECK(g_RingPtr->GetStats().m_DroppedCnt == 4);
+
+    CHECK(g_Returned == 4);
+    CHECK(StatsMatch());
+    CHECK(OwnershipMatches());
+}
+
+static void TestBounded()
+{
+    Reset();
+    Start();
+
+    // At most IMX_FRAME_RING_MAX_BUFFERS buffers, wherever they are.
+    for (UINT32 i = 0; i < IMX_FRAME_RING_MAX_BUFFERS; ++i) {
+        CHECK(Queue());
+    }
+    CHECK(!Queue());
+    FrameDone(0);
+    FrameDone(1);
+    FrameDone(0);
+    CHECK(!Queue()); // The filled buffer is still owned until it is popped.
+    PopDone();
+    CHECK(Queue());
+    CHECK(!Queue());
+    CHECK(g_RingPtr->GetStats().m_MaxInFlight == IMX_FRAME_RING_MAX_BUFFERS);
+
+    Abort();
+    CHECK(!Queue());
+    PopDone();
+    CHECK(g_RingPtr->GetStats().m_InFlight == 0);
+    CHECK(g_Returned == IMX_FRAME_RING_MAX_BUFFERS + 1);
+    CHECK(StatsMatch());
+}
+
+static void TestCancel()
+{
+    Reset();
+    Start();
+
+    // 1 and 2 go into the slots, 3 and 4 wait.
+    CHECK(Queue() && Queue() && Queue() && Queue());
+    FrameDone(0);
+    FrameDone(1);
+
+    // Pending: taken back at once, the others keep their order.
+    Cancel(3);
+    CHECK(g_Model.m_Buffers[3].m_Outcome == OUTCOME_CANCELED);
+
+    // In a slot: the DMA may still write it, it comes back once its frame is done.
+    Cancel(1);
+    CHECK(!g_RingPtr->HasDone());
+    FrameDone(0);
+    CHECK(g_Model.m_Slot[0] == 4);
+
+    // In the done queue
+    FrameDone(1);
+    Cancel(2);
+    PopDone();
+    CHECK(g_Model.m_Buffers[1].m_Outcome == OUTCOME_CANCELED);
+    CHECK(g_Model.m_Buffers[2].m_Outcome == OUTCOME_CANCELED);
+
+    // Returned or unknown buffers are not touched.
+    Cancel(2);
+    Cancel(100);
+
+    // Canceled in a slot, then the stream stops.
+    Cancel(4);
+    Abort();
+    PopDone();
+    CHECK(g_Model.m_Buffers[4].m_Outcome == OUTCOME_CANCELED);
+    CHECK(g_RingPtr->GetStats().m_CompletedCnt == 1);
+    CHECK(g_RingPtr->GetStats().m_AbortedCnt == 3);
+    CHECK(g_Returned == 4);
+    CHECK(StatsMatch());
+}
+
+static void TestRestart()
+{
+    Reset();
+    Start();
+
+    CHECK(Queue() && Queue() && Queue());
+    FrameDone(0);
+    FrameDone(1);
+    FrameDone(0);
+
+    // Stopped with a filled buffer not popped yet: reinit keeps it in flight.
+    Abort();
+    Start();
+    CHECK(g_RingPtr->GetStats().m_InFlight == 3);
+    CHECK(g_RingPtr->GetStats().m_QueuedCnt == 0);
+    FrameDone(1);
+    PopDone();
+    CHECK(g_Model.m_Buffers[1].m_Outcome == OUTCOME_FILLED);
+    CHECK(g_Model.m_Buffers[2].m_Outcome == OUTCOME_ABORTED);
+    CHECK(g_Model.m_Buffers[3].m_Outcome == OUTCOME_ABORTED);
+    CHECK(StatsMatch());
+}
+
+static void TestRandom()
+/*!
+ * Random mix of the driver entry points against the model.
+ */
+{
+    UINT32 filled = 0;
+    int failures = g_NumFailures;
+
+    Reset();
+    Start();
+    for (UINT32 step = 0; step < RANDOM_STEPS; ++step) {
+        switch (Random(16)) {
+        case 0:
+        case 1:
+        case 2:
+        case 3:
+            Queue();
+            break;
+        case 4:
+        case 5:
+        case 6:
+        case 7:
+            // The hardware mostly alternates the slots.
+            FrameDone((Random(8) == 0) ? Random(2) : (step & 1));
+            break;
+        case 8:
+        case 9:
+        case 10:
+            PopDone();
+            break;
+        case 11:
+            if (g_NextId > 1) {
+                Cancel(1 + Random(g_NextId - 1 + 2)); // Some are not queued yet.
+            }
+            break;
+        case 12:
+            if (Random(32) == 0) {
+                Abort();
+                if (Random(2) == 0) {
+                    PopDone();
+                }
+                Start();
+            }
+            break;
+        default:
+            break;
+        }
+        if (!StatsMatch() || !OwnershipMatches() || (g_NumFailures != failures)) {
+            printf("random: step %u\n", step);
+            CHECK(StatsMatch());
+            CHECK(OwnershipMatches());
+            return;
+        }
+    }
+
+    Abort();
+    PopDone();
+    for (const auto &entry : g_Model.m_Buffers) {
+        CHECK(entry.second.m_State == BUFFER_RETURNED);
+        filled += (entry.second.m_Outcome == OUTCOME_FILLED);
+    }
+    CHECK(g_Returned == g_Model.m_Buffers.size());
+    printf("random: %u buffers queued, %u filled\n", g_Returned, filled);
+}
+
+int main()
+{
+    TestRotation();
+    TestBounded();
+    TestCancel();
+    TestRestart();
+    TestRandom();
+
+    return HostTestResult("frameringtest");
+}
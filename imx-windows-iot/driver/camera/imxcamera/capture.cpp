@@ -17,6 +17,7 @@
 
 #include "imxcamera.h"
 #include "imxcsi\Public.h"
+#include "datarange.h"
 
 /**************************************************************************
 
@@ -29,8 +30,6 @@
 #pragma code_seg("PAGE")
 #endif // ALLOC_PRAGMA
 
-#define DMAX_X 1280
-#define DMAX_Y 720
 #define D_X DMAX_X
 #define D_Y DMAX_Y
 
@@ -436,8 +435,23 @@ Return Value:
 
                 auto *csi = m_Device->m_Csi.getTarget();
 
+                //
+                // If the CPU converts the format, the hardware captures to
+                // the device capture frames, queued to the ISI/CSI, and the
+                // CPU converts them to the stream buffer.  Otherwise the
+                // ISI/CSI copies the frame to the stream buffer, which is
+                // not physically contiguous.
+                //
+                const ImxCapturePlan_t &Plan = m_Device->GetCapturePlan();
+
                 if (csi == NULL) {
                     Status = STATUS_INVALID_DEVICE_STATE;
+                } else if (m_Device->IsConverting()) {
+                    if (frameInfo.m_ByteCount < Plan.m_OutFrameBytes) {
+                        Status = STATUS_BUFFER_TOO_SMALL;
+                    } else {
+                        Status = m_Device->ConvertNextFrame(frameInfo.m_Virtual);
+                    }
                 } else {
                     PIRP LowIrp = IoBuildDeviceIoControlRequest(IOCTL_CSI_DRIVER_GET_FRAME, csi->m_TargetDevicePtr, &frameInfo, sizeof(frameInfo), frameInfo.m_Virtual, frameInfo.m_ByteCount, FALSE, &csi->m_Event, &csi->m_IoStatus);
 
@@ -1168,14 +1182,17 @@ Return Value:
         }
 
         //
-        // Check that the format is a match for the selected range. 
+        // Check that the format is a match for the selected range.  The
+        // size must be one of the output sizes the range steps through.
         //
         else if (
-            (ConnectionFormat -> VideoInfoHeader.bmiHeader.biWidth !=
-                VIRange -> VideoInfoHeader.bmiHeader.biWidth) ||
+            !IsRangeOutputSize (
+                &VIRange -> ConfigCaps,
+                ConnectionFormat -> VideoInfoHeader.bmiHeader.biWidth,
+                ConnectionFormat -> VideoInfoHeader.bmiHeader.biHeight) ||
 
-            (ConnectionFormat -> VideoInfoHeader.bmiHeader.biHeight !=
-                VIRange -> VideoInfoHeader.bmiHeader.biHeight) ||
+            ((ConnectionFormat -> VideoInfoHeader.bmiHeader.biHeight < 0) !=
+                (VIRange -> VideoInfoHeader.bmiHeader.biHeight < 0)) ||
 
             (ConnectionFormat -> VideoInfoHeader.bmiHeader.biCompression !=
                 VIRange -> VideoInfoHeader.bmiHeader.biCompression) 
@@ -1438,84 +1455,6 @@ Return Value:
     DISPATCH AND DESCRIPTOR LAYOUT
 
 **************************************************************************/
-#define ONESECOND   10000000
-
-#define DEFINE_DATARANGE_VIDEO(_RANGE_NAME_, _Subtype_, _X_, _Y_, _Rate_, _Planes_, _BitCount_, _Compression_) \
-const                                                                                           \
-KS_DATARANGE_VIDEO                                                                              \
-_RANGE_NAME_ =                                                                                  \
-{                                                                                               \
-                                                                                                \
-    /*                                                                                          \
-    // KSDATARANGE                                                                              \
-    */                                                                                          \
-    {                                                                                           \
-        sizeof( KS_DATARANGE_VIDEO ),               /* FormatSize                      */       \
-        0,                                          /* Flags                           */       \
-        ULONG((ULONGLONG(_X_) *_Y_ * _BitCount_)/8),/* SampleSize                      */       \
-        0,                                          /* Reserved                        */       \
-                                                                                                \
-        STATICGUIDOF( KSDATAFORMAT_TYPE_VIDEO ),    /* aka. MEDIATYPE_Video            */       \
-        _Subtype_,                                  /* aka. MEDIASUBTYPE_RGB24,        */       \
-        STATICGUIDOF( KSDATAFORMAT_SPECIFIER_VIDEOINFO ) /* aka. FORMAT_VideoInfo      */       \
-    },                                                                                          \
-                                                                                                \
-    TRUE,               /* BOOL,  bFixedSizeSamples (all samples same size?)           */       \
-    FALSE,              /* BOOL,  bTemporalCompression (all I frames?)                 */       \
-    0,                  /* Reserved (was StreamDescriptionFlags)                       */       \
-    0,                  /* Reserved (was MemoryAllocationFlags                         */       \
-                        /*           (KS_VIDEO_ALLOC_*))                               */       \
-                        /*                                                             */       \
-                        /* _KS_VIDEO_STREAM_CONFIG_CAPS                                */       \
-                        /*                                                             */       \
-    {                                                                                           \
-        STATICGUIDOF( KSDATAFORMAT_SPECIFIER_VIDEOINFO ), /* GUID                      */       \
-        KS_AnalogVideo_None,                            /* AnalogVideoStandard         */       \
-        _X_,_Y_,        /* InputSize, (the inherent size of the incoming signal        */       \
-                        /*             with every digitized pixel unique)              */       \
-        _X_,_Y_,        /* MinCroppingSize, smallest rcSrc cropping rect allowed       */       \
-        _X_,_Y_,        /* MaxCroppingSize, largest  rcSrc cropping rect allowed       */       \
-        8,              /* CropGranularityX, granularity of cropping size              */       \
-        1,              /* CropGranularityY                                            */       \
-        8,              /* CropAlignX, alignment of cropping rect                      */       \
-        1,              /* CropAlignY;                                                 */       \
-        _X_, _Y_,       /* MinOutputSize, smallest bitmap stream can produce           */       \
-        _X_, _Y_,       /* MaxOutputSize, largest  bitmap stream can produce           */       \
-        8,              /* OutputGranularityX, granularity of output bitmap size       */       \
-        1,              /* OutputGranularityY;                                         */       \
-        0,              /* StretchTapsX  (0 no stretch, 1 pix dup, 2 interp...)        */       \
-        0,              /* StretchTapsY                                                */       \
-        0,              /* ShrinkTapsX                                                 */       \
-        0,              /* ShrinkTapsY                                                 */       \
-        (ONESECOND / _Rate_),         /* MinFrameInterval, 100 nS units                */       \
-        640000000,      /* MaxFrameInterval, 100 nS units                              */       \
-        ULONG(min(ULONG_MAX,(ULONGLONG(_X_) *_Y_ * _BitCount_)*_Rate_)),/* MinBitsPerSecond;*/  \
-        ULONG(min(ULONG_MAX,(ULONGLONG(_X_) *_Y_ * _BitCount_)*_Rate_)) /* MaxBitsPerSecond;*/  \
-    },                                                                                          \
-                                                                                                \
-    /*                                                                                          \
-    // KS_VIDEOINFOHEADER (default format)                                                      \
-    */                                                                                          \
-    {                                                                                           \
-        0,0,0,0,                            /* RECT  rcSource;                        */        \
-        0,0,0,0,                            /* RECT  rcTarget;                        */        \
-        ULONG(min(ULONG_MAX,(ULONGLONG(_X_) *_Y_ * _BitCount_)*_Rate_)),/* DWORD dwBitRate;*/   \
-        0L,                                 /* DWORD dwBitErrorRate;                  */        \
-        (ONESECOND / _Rate_),               /* REFERENCE_TIME  AvgTimePerFrame;       */        \
-        sizeof( KS_BITMAPINFOHEADER ),      /* DWORD biSize;                          */        \
-        _X_,                                /* LONG  biWidth;                         */        \
-        _Y_,                                /* LONG  biHeight;                        */        \
-        _Planes_,                           /* WORD  biPlanes;                        */        \
-        _BitCount_,                         /* WORD  biBitCount;                      */        \
-        _Compression_,                      /* DWORD biCompression;                   */        \
-        ULONG((ULONGLONG(_X_) *_Y_ * _BitCount_)/8),/* DWORD biSizeImage;             */        \
-        0,                                  /* LONG  biXPelsPerMeter;                 */        \
-        0,                                  /* LONG  biYPelsPerMeter;                 */        \
-        0,                                  /* DWORD biClrUsed;                       */        \
-        0                                   /* DWORD biClrImportant;                  */        \
-    }                                                                                           \
-};
-
 //
 // FormatYUY2_Capture:
 //
@@ -1757,16 +1696,6 @@ FormatNV12_Capture720p = {
     }
 };
 
-// DEFINE_DATARANGE_VIDEO(
-//     FormatNV12_CaptureVGA,
-//     (kVIDEO_PixelFormatNV12, 0x0000, 0x0010, 0x80, 0x00, // MEDIASUBTYPE_UYVY
-//     0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71),
-//     DMAX_X, DMAX_Y,
-//     30,
-//     1,
-//     12,
-//     FOURCC_NV12);
-
 NTSTATUS CCapturePin::Close(_In_ PKSPIN Pin,_In_ PIRP Irp)
 {
     return STATUS_SUCCESS;
@@ -1825,14 +1754,20 @@ DECLARE_SIMPLE_FRAMING_EX (
 const
 PKSDATARANGE
 CapturePinCsiDataRanges[] = {
-    (PKSDATARANGE)&FormatYUY2_Capture720p
+    (PKSDATARANGE)&FormatYUY2_Capture720p,
+    (PKSDATARANGE)&FormatNV12_Capture720p,
+    (PKSDATARANGE)&FormatRGB32_Capture720p
 };
 
 const
 PKSDATARANGE
 CapturePinIsiDataRanges[] = {
     (PKSDATARANGE)&FormatYUY2_Capture720p,
-    (PKSDATARANGE)&FormatNV12_Capture720p
+    (PKSDATARANGE)&FormatNV12_Capture720p,
+    (PKSDATARANGE)&FormatRGB32_Capture720p,
+    (PKSDATARANGE)&FormatYUY2_CaptureScaled,
+    (PKSDATARANGE)&FormatNV12_CaptureScaled,
+    (PKSDATARANGE)&FormatRGB32_CaptureScaled
 };
 
 SIZE_T GetCsiCapturePinRangesCount() {
@@ -0,0 +1,222 @@
+/*
+ * Copyright 2023 NXP
+ * All rights reserved.
+ *
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+//
+// Capture pin data ranges built from the sensor and ISI limits, and the
+// check of a requested size against a stepped range.  Kept out of
+// capture.cpp so the ranges can be checked on the host
+// (camera/imxcamera/test), the includer provides the KS types,
+// FOURCC_* and ImxVideoFormat.hpp.
+//
+
+#pragma once
+
+#define DMAX_X 1280
+#define DMAX_Y 720
+
+#define ONESECOND   10000000
+
+#define DEFINE_DATARANGE_VIDEO_SCALED(_RANGE_NAME_, _Subtype_, _MinX_, _MinY_, _MaxX_, _MaxY_, _X_, _Y_, _Rate_, _Planes_, _BitCount_, _Compression_) \
+const                                                                                           \
+KS_DATARANGE_VIDEO                                                                              \
+_RANGE_NAME_ =                                                                                  \
+{                                                                                               \
+                                                                                                \
+    /*                                                                                          \
+    // KSDATARANGE                                                                              \
+    */                                                                                          \
+    {                                                                                           \
+        sizeof( KS_DATARANGE_VIDEO ),               /* FormatSize                      */       \
+        0,                                          /* Flags                           */       \
+        ULONG((ULONGLONG(_X_) *_Y_ * _BitCount_)/8),/* SampleSize                      */       \
+        0,                                          /* Reserved                        */       \
+                                                                                                \
+        STATICGUIDOF( KSDATAFORMAT_TYPE_VIDEO ),    /* aka. MEDIATYPE_Video            */       \
+        _Subtype_,                                  /* aka. MEDIASUBTYPE_RGB24,        */       \
+        STATICGUIDOF( KSDATAFORMAT_SPECIFIER_VIDEOINFO ) /* aka. FORMAT_VideoInfo      */       \
+    },                                                                                          \
+                                                                                                \
+    TRUE,               /* BOOL,  bFixedSizeSamples (all samples same size?)           */       \
+    FALSE,              /* BOOL,  bTemporalCompression (all I frames?)                 */       \
+    0,                  /* Reserved (was StreamDescriptionFlags)                       */       \
+    0,                  /* Reserved (was MemoryAllocationFlags                         */       \
+                        /*           (KS_VIDEO_ALLOC_*))                               */       \
+                        /*                                                             */       \
+                        /* _KS_VIDEO_STREAM_CONFIG_CAPS                                */       \
+                        /*                                                             */       \
+    {                                                                                           \
+        STATICGUIDOF( KSDATAFORMAT_SPECIFIER_VIDEOINFO ), /* GUID                      */       \
+        KS_AnalogVideo_None,                            /* AnalogVideoStandard         */       \
+        _MaxX_,_MaxY_,  /* InputSize, (the inherent size of the incoming signal        */       \
+                        /*             with every digitized pixel unique)              */       \
+        _MaxX_,_MaxY_,  /* MinCroppingSize, smallest rcSrc cropping rect allowed       */       \
+        _MaxX_,_MaxY_,  /* MaxCroppingSize, largest  rcSrc cropping rect allowed       */       \
+        8,              /* CropGranularityX, granularity of cropping size              */       \
+        1,              /* CropGranularityY                                            */       \
+        8,              /* CropAlignX, alignment of cropping rect                      */       \
+        1,              /* CropAlignY;                                                 */       \
+        _MinX_, _MinY_, /* MinOutputSize, smallest bitmap stream can produce           */       \
+        _MaxX_, _MaxY_, /* MaxOutputSize, largest  bitmap stream can produce           */       \
+        8,              /* OutputGranularityX, granularity of output bitmap size       */       \
+        2,              /* OutputGranularityY;                                         */       \
+        0,              /* StretchTapsX  (0 no stretch, 1 pix dup, 2 interp...)        */       \
+        0,              /* StretchTapsY                                                */       \
+        (((_MinX_) < (_MaxX_)) ? 2 : 0), /* ShrinkTapsX                                */       \
+        (((_MinY_) < (_MaxY_)) ? 2 : 0), /* ShrinkTapsY                                */       \
+        (ONESECOND / _Rate_),         /* MinFrameInterval, 100 nS units                */       \
+        640000000,      /* MaxFrameInterval, 100 nS units                              */       \
+        ULONG(min(ULONG_MAX,(ULONGLONG(_MinX_) *_MinY_ * _BitCount_)*_Rate_)),/* MinBitsPerSecond;*/ \
+        ULONG(min(ULONG_MAX,(ULONGLONG(_MaxX_) *_MaxY_ * _BitCount_)*_Rate_)) /* MaxBitsPerSecond;*/ \
+    },                                                                                          \
+                                                                                                \
+    /*                                                                                          \
+    // KS_VIDEOINFOHEADER (default format)                                                      \
+    */                                                                                          \
+    {                                                                                           \
+        0,0,0,0,                            /* RECT  rcSource;                        */        \
+        0,0,0,0,                            /* RECT  rcTarget;                        */        \
+        ULONG(min(ULONG_MAX,(ULONGLONG(_X_) *_Y_ * _BitCount_)*_Rate_)),/* DWORD dwBitRate;*/   \
+        0L,                                 /* DWORD dwBitErrorRate;                  */        \
+        (ONESECOND / _Rate_),               /* REFERENCE_TIME  AvgTimePerFrame;       */        \
+        sizeof( KS_BITMAPINFOHEADER ),      /* DWORD biSize;                          */        \
+        _X_,                                /* LONG  biWidth;                         */        \
+        _Y_,                                /* LONG  biHeight;                        */        \
+        _Planes_,                           /* WORD  biPlanes;                        */        \
+        _BitCount_,                         /* WORD  biBitCount;                      */        \
+        _Compression_,                      /* DWORD biCompression;                   */        \
+        ULONG((ULONGLONG(_X_) *_Y_ * _BitCount_)/8),/* DWORD biSizeImage;             */        \
+        0,                                  /* LONG  biXPelsPerMeter;                 */        \
+        0,                                  /* LONG  biYPelsPerMeter;                 */        \
+        0,                                  /* DWORD biClrUsed;                       */        \
+        0                                   /* DWORD biClrImportant;                  */        \
+    }                                                                                           \
+};
+
+//
+// IMX_SUBTYPE_FOURCC, IMX_SUBTYPE_RGB32:
+//
+// Subtype GUIDs passed as a single DEFINE_DATARANGE_VIDEO_SCALED argument.  A
+// conforming preprocessor splits them again if they are forwarded to
+// another macro, so ranges use DEFINE_DATARANGE_VIDEO_SCALED directly.
+//
+#define IMX_SUBTYPE_FOURCC(_FourCC_) \
+    (_FourCC_), 0x0000, 0x0010, 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71
+#define IMX_SUBTYPE_RGB32 /* MEDIASUBTYPE_RGB32 */ \
+    kVIDEO_PixelFormatXRGB8888, 0x524f, 0x11ce, 0x9f, 0x53, 0x00, 0x20, 0xaf, 0x0b, 0xa7, 0x70
+
+//
+// Format*_Capture720p/Scaled:
+//
+// The ISI produces RGB32 with its color space converter and any size
+// down to IMX_ISI_MAX_DOWNSCALE with its scaler, the scaled ranges step
+// by 8 pixels horizontally, which keeps the line pitch 8-byte aligned for
+// every format, and by 2 lines vertically.  640x360 is their default
+// format.  The CSI gets NV12 and RGB32 converted by the CPU from YUY2.
+//
+#define ISI_MIN_X   (DMAX_X / IMX_ISI_MAX_DOWNSCALE)
+#define ISI_MIN_Y   (((DMAX_Y / IMX_ISI_MAX_DOWNSCALE) + 1) & ~1)
+
+DEFINE_DATARANGE_VIDEO_SCALED(
+    FormatRGB32_Capture720p,
+    IMX_SUBTYPE_RGB32,
+    DMAX_X, DMAX_Y,
+    DMAX_X, DMAX_Y,
+    DMAX_X, DMAX_Y,
+    30,
+    1,
+    32,
+    KS_BI_RGB);
+
+DEFINE_DATARANGE_VIDEO_SCALED(
+    FormatYUY2_CaptureScaled,
+    IMX_SUBTYPE_FOURCC(FOURCC_YUY2),
+    ISI_MIN_X, ISI_MIN_Y,
+    DMAX_X, DMAX_Y,
+    640, 360,
+    30,
+    1,
+    16,
+    FOURCC_YUY2);
+
+DEFINE_DATARANGE_VIDEO_SCALED(
+    FormatNV12_CaptureScaled,
+    IMX_SUBTYPE_FOURCC(FOURCC_NV12),
+    ISI_MIN_X, ISI_MIN_Y,
+    DMAX_X, DMAX_Y,
+    640, 360,
+    30,
+    1,
+    12,
+    FOURCC_NV12);
+
+DEFINE_DATARANGE_VIDEO_SCALED(
+    FormatRGB32_CaptureScaled,
+    IMX_SUBTYPE_RGB32,
+    ISI_MIN_X, ISI_MIN_Y,
+    DMAX_X, DMAX_Y,
+    640, 360,
+    30,
+    1,
+    32,
+    KS_BI_RGB);
+
+/*************************************************/
+
+inline BOOL
+IsRangeOutputSize (
+    const KS_VIDEO_STREAM_CONFIG_CAPS *ConfigCaps,
+    LONG Width,
+    LONG Height
+    )
+
+/*++
+
+Routine Description:
+
+    Check that a bitmap size is one a data range produces: within the
+    range output sizes and a whole number of granularity steps above the
+    smallest one.
+
+Arguments:
+
+    ConfigCaps -
+        The capabilities of the data range
+
+    Width -
+        The bitmap width
+
+    Height -
+        The bitmap height, negative for top-down bitmaps
+
+Return Value:
+
+    TRUE -
+        the range produces the size
+
+    FALSE -
+        it doesn't
+
+--*/
+
+{
+    PAGED_CODE();
+
+    const LONG MinX = ConfigCaps->MinOutputSize.cx;
+    const LONG MinY = ConfigCaps->MinOutputSize.cy;
+    const LONG StepX = max(ConfigCaps->OutputGranularityX, 1);
+    const LONG StepY = max(ConfigCaps->OutputGranularityY, 1);
+
+    if (Height < 0) {
+        Height = -Height;
+    }
+    return
+        (Width >= MinX) && (Width <= ConfigCaps->MaxOutputSize.cx) &&
+        (Height >= MinY) && (Height <= ConfigCaps->MaxOutputSize.cy) &&
+        (((Width - MinX) % StepX) == 0) &&
+        (((Height - MinY) % StepY) == 0);
+}
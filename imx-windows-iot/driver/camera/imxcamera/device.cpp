@@ -278,6 +278,77 @@ Return Value:
 
 /*************************************************/
 
+NTSTATUS
+CCaptureDevice::
+NegotiateCapture (
+    IN PKS_VIDEOINFOHEADER VideoInfoHeader,
+    IN video_pixel_format_t PixelFmt
+    )
+
+/*++
+
+Routine Description:
+
+    Choose how the capture hardware produces the connection format.  The
+    ISI converts YUV to RGB and downscales in hardware.  A format the
+    capture interface can't write is captured as YUY2 to an intermediate
+    buffer and converted by the CPU into the stream buffer.
+
+Arguments:
+
+    VideoInfoHeader -
+        The connection format video info header.
+
+    PixelFmt -
+        The connection pixel format.
+
+Return Value:
+
+    Success / Failure
+
+--*/
+
+{
+
+    PAGED_CODE();
+    NTSTATUS Status = STATUS_SUCCESS;
+    ImxCaptureCaps_t caps = {};
+    const UINT32 outResolution = FSL_VIDEO_RESOLUTION(
+        VideoInfoHeader->bmiHeader.biWidth,
+        ABS(VideoInfoHeader->bmiHeader.biHeight));
+
+    switch (m_CpuId) {
+        case IMX_CPU_MX8MP:
+        case IMX_CPU_MX8MN:
+            caps.m_Formats[caps.m_FormatCnt++] = kVIDEO_PixelFormatYUYV;
+            caps.m_Formats[caps.m_FormatCnt++] = kVIDEO_PixelFormatNV12;
+            caps.m_Formats[caps.m_FormatCnt++] = kVIDEO_PixelFormatXRGB8888;
+            caps.m_Formats[caps.m_FormatCnt++] = kVIDEO_PixelFormatRGB565;
+            caps.m_MaxDownscale = IMX_ISI_MAX_DOWNSCALE;
+            break;
+        default:
+        case IMX_CPU_MX8MQ:
+        case IMX_CPU_MX8MM:
+            caps.m_Formats[caps.m_FormatCnt++] = kVIDEO_PixelFormatYUYV;
+            caps.m_MaxDownscale = 1;
+            break;
+    }
+
+    if (!ImxNegotiateCapture(caps, kVIDEO_Resolution720P, PixelFmt, outResolution, m_CapturePlan)) {
+        _DbgPrint(("\timxcamera: Unsupported format 0x%x %dx%d\r\n", PixelFmt,
+            FSL_VIDEO_EXTRACT_WIDTH(outResolution), FSL_VIDEO_EXTRACT_HEIGHT(outResolution)));
+        Status = STATUS_NOT_SUPPORTED;
+    }
+    else if (m_CapturePlan.m_Convert != kIMX_ConvertNone) {
+        Status = AllocCaptureFrames(m_CapturePlan.m_HwFrameBytes);
+    }
+
+    return Status;
+
+}
+
+/*************************************************/
+
 
 NTSTATUS
 CCaptureDevice::
@@ -330,6 +401,7 @@ Return Value:
         m_VideoInfoHeader = VideoInfoHeader;
         m_PixelFmt = PixelFmt;
 
+        Status = NegotiateCapture(VideoInfoHeader, PixelFmt);
         if (NT_SUCCESS(Status)) {
             Status = m_Sensor.Open();
             if (!NT_SUCCESS(Status)) {
@@ -394,10 +466,14 @@ Return Value:
 
     PAGED_CODE();
 
+    DrainCaptureFrames();
+
     m_Sensor.Close();
     m_Mipi.Close();
     m_Csi.Close();
 
+    FreeCaptureFrames();
+
     //
     // Release our "lock" on hardware resources.  This will allow another
     // pin (perhaps in another graph) to acquire them.
@@ -444,7 +520,7 @@ Return Value:
     if (NT_SUCCESS(Status)) {
 
         UINT8 csiLanes = 2;
-        camera_config_t cfg{ kVIDEO_Resolution720P, m_PixelFmt, m_PixelFmt, 25, 0, csiLanes};
+        camera_config_t cfg{ kVIDEO_Resolution720P, m_CapturePlan.m_HwFormat, m_CapturePlan.m_HwFormat, 25, 0, csiLanes, m_CapturePlan.m_HwResolution};
 
         auto* mipi = m_Mipi.getTarget();
         auto* csi = m_Csi.getTarget();
@@ -458,7 +534,7 @@ Return Value:
             NTSTATUS TmpStatus = STATUS_SUCCESS;
             video_pixel_format_t requiredCameraFmt = kVIDEO_PixelFormatNone;
 
-            PIRP LowIrp = IoBuildDeviceIoControlRequest(IOCTL_CSI_REQUIRED_FMT, csi->m_TargetDevicePtr, (PUCHAR)&m_PixelFmt, sizeof(m_PixelFmt), &requiredCameraFmt, sizeof(requiredCameraFmt), FALSE, &csi->m_Event, &csi->m_IoStatus);
+            PIRP LowIrp = IoBuildDeviceIoControlRequest(IOCTL_CSI_REQUIRED_FMT, csi->m_TargetDevicePtr, (PUCHAR)&cfg.resultPixelFormat, sizeof(cfg.resultPixelFormat), &requiredCameraFmt, sizeof(requiredCameraFmt), FALSE, &csi->m_Event, &csi->m_IoStatus);
 
             if (LowIrp) {
                 TmpStatus = csi->SendIrp(LowIrp, &csi->m_Event);
@@ -550,6 +626,12 @@ Return Value:
             }
         }
 
+        /* Queue the capture frames, the ISI/CSI captures to them until stopped */
+        m_NextCaptureFrame = 0;
+        for (ULONG i = 0; (i < m_CaptureFrameCnt) && NT_SUCCESS(Status); ++i) {
+            Status = QueueCaptureFrame(&m_CaptureFrames[i]);
+        }
+
         /* Enable MIPI CSI 2 output from camera */
         if (NT_SUCCESS(Status)) {
             PIRP LowIrp = IoBuildDeviceIoControlRequest(IOCTL_SNS_START, sensor->m_TargetDevicePtr, NULL, 0, NULL, 0, FALSE, &sensor->m_Event, &sensor->m_IoStatus);
@@ -632,6 +714,12 @@ Return Value:
             Status = csi->m_IoStatus.Status;
         }
     }
+
+    //
+    // The stop completed the queued capture frames.
+    //
+    DrainCaptureFrames();
+
     return Status;
 }
 
@@ -734,7 +822,164 @@ Return Value:
             Status = csi->m_IoStatus.Status;
         }
     }
+
+    //
+    // The stop completed the queued capture frames.
+    //
+    DrainCaptureFrames();
+
+    return Status;
+}
+
+/*************************************************/
+
+NTSTATUS
+CCaptureDevice::
+AllocCaptureFrames (
+    IN SIZE_T FrameBytes
+    )
+
+/*++
+
+Routine Description:
+
+    Allocate the frame buffers the hardware captures to when the CPU
+    converts frames.  The ISI/CSI writes them directly, so they must be
+    physically contiguous and below 4 GB, as its own discard buffers.
+
+Arguments:
+
+    FrameBytes -
+        The size of a frame written by the hardware.
+
+Return Value:
+
+    Success / Failure
+
+--*/
+
+{
+
+    PAGED_CODE();
+    NTSTATUS Status = STATUS_SUCCESS;
+    static const PHYSICAL_ADDRESS zero = { 0,0 };
+    static const PHYSICAL_ADDRESS high = { 0xffffffff, 0 };
+
+    ASSERT(m_CaptureFrameCnt == 0);
+
+    for (ULONG i = 0; (i < IMXCAMERA_CAPTURE_FRAME_NUM) && NT_SUCCESS(Status); ++i) {
+        PCAPTURE_FRAME Frame = &m_CaptureFrames[i];
+
+        RtlZeroMemory(Frame, sizeof(*Frame));
+        KeInitializeEvent(&Frame->Done, NotificationEvent, FALSE);
+        Frame->Mdl = MmAllocatePagesForMdlEx(zero, high, zero, ROUND_TO_PAGES(FrameBytes), MmCached, MM_ALLOCATE_FULLY_REQUIRED | MM_ALLOCATE_REQUIRE_CONTIGUOUS_CHUNKS);
+        if (Frame->Mdl == NULL) {
+            _DbgPrint(("\timxcamera: Out of contiguous memory.\r\n"));
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+        } else {
+            m_CaptureFrameCnt++;
+            Frame->Virtual = reinterpret_cast <PUCHAR> (
+                MmMapLockedPagesSpecifyCache(Frame->Mdl, KernelMode, MmCached, NULL, FALSE, HighPagePriority)
+                );
+            if (Frame->Virtual == NULL) {
+                Status = STATUS_INSUFFICIENT_RESOURCES;
+            }
+        }
+    }
+    if (!NT_SUCCESS(Status)) {
+        FreeCaptureFrames();
+    }
     return Status;
+
+}
+
+/*************************************************/
+
+void
+CCaptureDevice::
+FreeCaptureFrames (
+    )
+
+/*++
+
+Routine Description:
+
+    Free the capture frames.  None of them may be queued.
+
+Arguments:
+
+    None
+
+Return Value:
+
+    None
+
+--*/
+
+{
+
+    PAGED_CODE();
+
+    for (ULONG i = 0; i < m_CaptureFrameCnt; ++i) {
+        PCAPTURE_FRAME Frame = &m_CaptureFrames[i];
+
+        ASSERT(Frame->Irp == NULL);
+        if (Frame->Virtual != NULL) {
+            MmUnmapLockedPages(Frame->Virtual, Frame->Mdl);
+            Frame->Virtual = NULL;
+        }
+        MmFreePagesFromMdl(Frame->Mdl);
+        ExFreePool(Frame->Mdl);
+        Frame->Mdl = NULL;
+    }
+    m_CaptureFrameCnt = 0;
+    m_NextCaptureFrame = 0;
+
+}
+
+/*************************************************/
+
+void
+CCaptureDevice::
+DrainCaptureFrames (
+    )
+
+/*++
+
+Routine Description:
+
+    Take all queued capture frames back.  The ISI/CSI completes them once
+    it is stopped, a frame the hardware doesn't give back in time is
+    canceled.
+
+Arguments:
+
+    None
+
+Return Value:
+
+    None
+
+--*/
+
+{
+
+    PAGED_CODE();
+    LARGE_INTEGER Timeout;
+
+    Timeout.QuadPart = (LONGLONG)-30000000;
+    for (ULONG i = 0; i < m_CaptureFrameCnt; ++i) {
+        PCAPTURE_FRAME Frame = &m_CaptureFrames[i];
+
+        if (Frame->Irp != NULL) {
+            if (WaitCaptureFrame(Frame, &Timeout) == STATUS_TIMEOUT) {
+                IoCancelIrp(Frame->Irp);
+                (void)WaitCaptureFrame(Frame, NULL);
+            }
+        }
+    }
+    m_NextCaptureFrame = 0;
+
 }
 
 /*************************************************/
@@ -781,6 +1026,203 @@ Return Value:
 
 /*************************************************/
 
+NTSTATUS
+CCaptureDevice::
+QueueCaptureFrame (
+    IN PCAPTURE_FRAME Frame
+    )
+
+/*++
+
+Routine Description:
+
+    Queue a capture frame to the ISI/CSI.  The request carries the frame
+    MDL as its output buffer, the capture driver checks it and programs
+    the frame into the capture DMA.
+
+Arguments:
+
+    Frame -
+        The capture frame, it must not be queued.
+
+Return Value:
+
+    Success / Failure
+
+--*/
+
+{
+
+    NTSTATUS Status = STATUS_SUCCESS;
+    auto *csi = m_Csi.getTarget();
+    PIRP Irp = NULL;
+
+    ASSERT(Frame->Irp == NULL);
+
+    if (csi == NULL) {
+        Status = STATUS_INVALID_DEVICE_STATE;
+    } else {
+        Irp = IoAllocateIrp(csi->m_TargetDevicePtr->StackSize, FALSE);
+        if (Irp == NULL) {
+            Status = STATUS_MEMORY_NOT_ALLOCATED;
+        }
+    }
+    if (NT_SUCCESS(Status)) {
+        PIO_STACK_LOCATION irpSp = IoGetNextIrpStackLocation(Irp);
+
+        Irp->MdlAddress = Frame->Mdl;
+        Irp->IoStatus.Status = STATUS_NOT_SUPPORTED;
+        irpSp->MajorFunction = IRP_MJ_INTERNAL_DEVICE_CONTROL;
+        irpSp->Parameters.DeviceIoControl.IoControlCode = IOCTL_CSI_INTERNAL_QUEUE_FRAME;
+        irpSp->Parameters.DeviceIoControl.OutputBufferLength = (ULONG)m_CapturePlan.m_HwFrameBytes;
+        irpSp->Parameters.DeviceIoControl.InputBufferLength = 0;
+        irpSp->FileObject = csi->m_TargetFileObjectPtr;
+        IoSetCompletionRoutine(Irp, CaptureFrameCompletion, &Frame->Done, TRUE, TRUE, TRUE);
+
+        KeClearEvent(&Frame->Done);
+        Frame->Irp = Irp;
+
+        //
+        // The frame is back when Done is signaled, whatever the request
+        // status is.
+        //
+        (void)IoCallDriver(csi->m_TargetDevicePtr, Irp);
+    }
+    return Status;
+
+}
+
+/*************************************************/
+
+NTSTATUS
+CCaptureDevice::
+CaptureFrameCompletion (
+    IN PDEVICE_OBJECT DeviceObject,
+    IN PIRP Irp,
+    IN PVOID Context
+    )
+
+/*++
+
+Routine Description:
+
+    Completion routine of IOCTL_CSI_INTERNAL_QUEUE_FRAME.  The IRP and the
+    frame MDL belong to the capture frame, WaitCaptureFrame() frees the IRP.
+
+--*/
+
+{
+    UNREFERENCED_PARAMETER(DeviceObject);
+    UNREFERENCED_PARAMETER(Irp);
+
+    KeSetEvent(reinterpret_cast <PKEVENT> (Context), IO_NO_INCREMENT, FALSE);
+
+    return STATUS_MORE_PROCESSING_REQUIRED;
+
+}
+
+/*************************************************/
+
+NTSTATUS
+CCaptureDevice::
+WaitCaptureFrame (
+    IN PCAPTURE_FRAME Frame,
+    IN PLARGE_INTEGER Timeout
+    )
+
+/*++
+
+Routine Description:
+
+    Wait for a queued capture frame and take it back from the ISI/CSI.
+
+Arguments:
+
+    Frame -
+        The queued capture frame.
+
+    Timeout -
+        The wait timeout, NULL waits forever.
+
+Return Value:
+
+    The status the ISI/CSI completed the frame with, STATUS_TIMEOUT if the
+    frame is still queued.
+
+--*/
+
+{
+
+    NTSTATUS Status;
+
+    ASSERT(Frame->Irp != NULL);
+
+    Status = KeWaitForSingleObject(&Frame->Done, Executive, KernelMode, FALSE, Timeout);
+    if (Status == STATUS_SUCCESS) {
+        Status = Frame->Irp->IoStatus.Status;
+        Frame->Irp->MdlAddress = NULL; // Owned by the frame, not by the IRP.
+        IoFreeIrp(Frame->Irp);
+        Frame->Irp = NULL;
+    }
+    return Status;
+
+}
+
+/*************************************************/
+
+NTSTATUS
+CCaptureDevice::
+ConvertNextFrame (
+    IN PUCHAR Destination
+    )
+
+/*++
+
+Routine Description:
+
+    Wait for the oldest queued capture frame, convert it to the connection
+    format and queue it again.  A frame that is not queued, because the
+    capture driver failed it before, is queued first.
+
+Arguments:
+
+    Destination -
+        The stream buffer, at least m_CapturePlan.m_OutFrameBytes long.
+
+Return Value:
+
+    Success / Failure, STATUS_TIMEOUT if no frame was captured in time.
+
+--*/
+
+{
+
+    NTSTATUS Status = STATUS_SUCCESS;
+    PCAPTURE_FRAME Frame = &m_CaptureFrames[m_NextCaptureFrame];
+    LARGE_INTEGER Timeout;
+
+    ASSERT(m_CaptureFrameCnt != 0);
+
+    if (Frame->Irp == NULL) {
+        Status = QueueCaptureFrame(Frame);
+    }
+    if (NT_SUCCESS(Status)) {
+        Timeout.QuadPart = (LONGLONG)-30000000;
+        Status = WaitCaptureFrame(Frame, &Timeout);
+    }
+    if (Status != STATUS_TIMEOUT) {
+        if (NT_SUCCESS(Status)) {
+            (void)ImxConvertFrame(m_CapturePlan, Frame->Virtual, Destination);
+            (void)QueueCaptureFrame(Frame);
+        }
+        m_NextCaptureFrame = (m_NextCaptureFrame + 1) % m_CaptureFrameCnt;
+    }
+    return Status;
+
+}
+
+/*************************************************/
+
 /**************************************************************************
 
     DESCRIPTOR AND DISPATCH LAYOUT
@@ -28,12 +28,33 @@
 
 #include "common.h"
 #include "ImxVideoCommon.hpp"
+#include "ImxVideoFormat.hpp"
 #include "dsdtutil.hpp"
 #include "WdmIoTargets.hpp"
 
 #define RESHUB_USE_HELPER_ROUTINES
 #include <reshub.h>
 
+//
+// Number of frame buffers queued to the capture driver when the CPU
+// converts frames.  Two keep both hardware address slots filled while the
+// CPU converts the third.
+//
+#define IMXCAMERA_CAPTURE_FRAME_NUM 3
+
+//
+// A physically contiguous frame buffer below 4 GB, owned by the driver.
+// Irp is the pending IOCTL_CSI_INTERNAL_QUEUE_FRAME describing it, NULL if
+// the frame is not queued.
+//
+typedef struct _CAPTURE_FRAME
+{
+    PMDL Mdl;
+    PUCHAR Virtual;
+    PIRP Irp;
+    KEVENT Done;
+} CAPTURE_FRAME, *PCAPTURE_FRAME;
+
 //
 // The device context performs the same job as
 // a WDM device extension in the driver frameworks
@@ -102,6 +123,24 @@ private:
     //
     video_pixel_format_t m_PixelFmt;
 
+    //
+    // How the connection format is produced from the sensor stream: the
+    // format and resolution the hardware writes and the CPU conversion, if
+    // any.  Valid while hardware resources are acquired.
+    //
+    ImxCapturePlan_t m_CapturePlan;
+
+    //
+    // Frame buffers the hardware captures to when the CPU converts frames to
+    // the connection format.  They are queued to the capture driver, which
+    // programs them straight into the capture DMA.  m_CaptureFrameCnt is 0
+    // if the plan doesn't convert.  m_NextCaptureFrame is the oldest queued
+    // frame, frames complete in queueing order.
+    //
+    CAPTURE_FRAME m_CaptureFrames[IMXCAMERA_CAPTURE_FRAME_NUM];
+    ULONG m_CaptureFrameCnt;
+    ULONG m_NextCaptureFrame;
+
     //
     // Cleanup():
     //
@@ -151,6 +190,68 @@ private:
     NTSTATUS Get_DsdAcpiResources();
     NTSTATUS GetAssigned_CrsAcpiResources(PCM_RESOURCE_LIST reslist);
 
+    //
+    // NegotiateCapture():
+    //
+    // Fills m_CapturePlan for the connection format and allocates
+    // m_CaptureFrames if the CPU has to convert frames.
+    //
+    NTSTATUS
+    NegotiateCapture (
+        IN PKS_VIDEOINFOHEADER VideoInfoHeader,
+        IN video_pixel_format_t PixelFmt
+        );
+
+    //
+    // AllocCaptureFrames() / FreeCaptureFrames():
+    //
+    // Allocates and maps or frees m_CaptureFrames.
+    //
+    NTSTATUS
+    AllocCaptureFrames (
+        IN SIZE_T FrameBytes
+        );
+
+    void
+    FreeCaptureFrames (
+        );
+
+    //
+    // QueueCaptureFrame():
+    //
+    // Hands a capture frame to the capture driver with
+    // IOCTL_CSI_INTERNAL_QUEUE_FRAME.  The request completes when a frame is
+    // captured into it or the capture driver is stopped.
+    //
+    NTSTATUS
+    QueueCaptureFrame (
+        IN PCAPTURE_FRAME Frame
+        );
+
+    //
+    // WaitCaptureFrame():
+    //
+    // Waits for a queued capture frame and takes it back from the capture
+    // driver.  Returns STATUS_TIMEOUT if the frame is still queued.
+    //
+    NTSTATUS
+    WaitCaptureFrame (
+        IN PCAPTURE_FRAME Frame,
+        IN PLARGE_INTEGER Timeout
+        );
+
+    //
+    // DrainCaptureFrames():
+    //
+    // Takes all queued capture frames back once the capture driver has
+    // been stopped.
+    //
+    void
+    DrainCaptureFrames (
+        );
+
+    static IO_COMPLETION_ROUTINE CaptureFrameCompletion;
+
 public:
     iotarget_t m_Sensor;
     iotarget_t m_Csi;
@@ -289,6 +390,43 @@ public:
     Stop (
         );
 
+    //
+    // GetCapturePlan():
+    //
+    // Returns how the connection format is produced.
+    //
+    const ImxCapturePlan_t &
+    GetCapturePlan (
+        ) const
+    {
+        return m_CapturePlan;
+    }
+
+    //
+    // IsConverting():
+    //
+    // Returns TRUE if the hardware captures to m_CaptureFrames and the CPU
+    // converts frames with ConvertNextFrame(), FALSE if frames are captured
+    // with IOCTL_CSI_DRIVER_GET_FRAME directly to the stream buffers.
+    //
+    BOOLEAN
+    IsConverting (
+        ) const
+    {
+        return (m_CaptureFrameCnt != 0);
+    }
+
+    //
+    // ConvertNextFrame():
+    //
+    // Waits for the oldest queued capture frame, converts it to the
+    // connection format into Destination and queues the frame again.
+    //
+    NTSTATUS
+    ConvertNextFrame (
+        IN PUCHAR Destination
+        );
+
     //
     // ProgramScatterGatherMappings():
     //
@@ -0,0 +1,414 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host unit test of the capture pin data ranges (datarange.h)
+//
+// The ISI ranges are built with DEFINE_DATARANGE_VIDEO_SCALED from
+// ISI_MIN_X/ISI_MIN_Y up to the sensor size, and DispatchSetFormat()
+// accepts a size with IsRangeOutputSize(). The test walks every size the
+// ranges step through and checks that the driver accepts it and the ISI
+// can produce it, checks every other size is rejected, and checks a table
+// of sizes at the edges of the ranges.
+//
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint8_t UINT8;
+typedef uint16_t UINT16;
+typedef uint32_t UINT32;
+typedef uint64_t UINT64;
+typedef int32_t INT32;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef int64_t LONGLONG;
+typedef uint64_t ULONGLONG;
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef int BOOL;
+typedef unsigned char BOOLEAN;
+typedef unsigned char* PUCHAR;
+typedef void* PVOID;
+typedef LONGLONG REFERENCE_TIME;
+
+#define TRUE 1
+#define FALSE 0
+
+#include "HostTest.h"
+
+#define PAGED_CODE()
+
+#ifndef min
+#define min(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef max
+#define max(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+
+/* The KS structures the ranges are built from, same layout as ks.h/ksmedia.h. */
+
+typedef struct
+{
+    ULONG Data1;
+    UINT16 Data2;
+    UINT16 Data3;
+    UINT8 Data4[8];
+} GUID;
+
+typedef struct
+{
+    LONG cx;
+    LONG cy;
+} SIZE;
+
+typedef struct
+{
+    LONG left;
+    LONG top;
+    LONG right;
+    LONG bottom;
+} RECT;
+
+typedef struct
+{
+    ULONG FormatSize;
+    ULONG Flags;
+    ULONG SampleSize;
+    ULONG Reserved;
+    GUID MajorFormat;
+    GUID SubFormat;
+    GUID Specifier;
+} KSDATARANGE;
+
+typedef struct
+{
+    GUID guid;
+    ULONG VideoStandard;
+    SIZE InputSize;
+    SIZE MinCroppingSize;
+    SIZE MaxCroppingSize;
+    int CropGranularityX;
+    int CropGranularityY;
+    int CropAlignX;
+    int CropAlignY;
+    SIZE MinOutputSize;
+    SIZE MaxOutputSize;
+    int OutputGranularityX;
+    int OutputGranularityY;
+    int StretchTapsX;
+    int StretchTapsY;
+    int ShrinkTapsX;
+    int ShrinkTapsY;
+    LONGLONG MinFrameInterval;
+    LONGLONG MaxFrameInterval;
+    LONG MinBitsPerSecond;
+    LONG MaxBitsPerSecond;
+} KS_VIDEO_STREAM_CONFIG_CAPS;
+
+typedef struct
+{
+    DWORD biSize;
+    LONG biWidth;
+    LONG biHeight;
+    WORD biPlanes;
+    WORD biBitCount;
+    DWORD biCompression;
+    DWORD biSizeImage;
+    LONG biXPelsPerMeter;
+    LONG biYPelsPerMeter;
+    DWORD biClrUsed;
+    DWORD biClrImportant;
+} KS_BITMAPINFOHEADER;
+
+typedef struct
+{
+    RECT rcSource;
+    RECT rcTarget;
+    DWORD dwBitRate;
+    DWORD dwBitErrorRate;
+    REFERENCE_TIME AvgTimePerFrame;
+    KS_BITMAPINFOHEADER bmiHeader;
+} KS_VIDEOINFOHEADER;
+
+typedef struct
+{
+    KSDATARANGE DataRange;
+    BOOL bFixedSizeSamples;
+    BOOL bTemporalCompression;
+    DWORD StreamDescriptionFlags;
+    DWORD MemoryAllocationFlags;
+    KS_VIDEO_STREAM_CONFIG_CAPS ConfigCaps;
+    KS_VIDEOINFOHEADER VideoInfoHeader;
+} KS_DATARANGE_VIDEO;
+
+#define STATICGUIDOF(guid) STATIC_##guid
+#define STATIC_KSDATAFORMAT_TYPE_VIDEO \
+    0x73646976L, 0x0000, 0x0010, 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71
+#define STATIC_KSDATAFORMAT_SPECIFIER_VIDEOINFO \
+    0x05589f80L, 0xc356, 0x11ce, 0xbf, 0x01, 0x00, 0xaa, 0x00, 0x55, 0x59, 0x5a
+#define KS_AnalogVideo_None 0
+#define KS_BI_RGB 0L
+
+/* From imxcamera.h */
+#define mmioFOURCC(ch0, ch1, ch2, ch3) \
+    ((DWORD)(BYTE)(ch0) | ((DWORD)(BYTE)(ch1) << 8) | ((DWORD)(BYTE)(ch2) << 16) | ((DWORD)(BYTE)(ch3) << 24))
+#define FOURCC_YUY2 mmioFOURCC('Y', 'U', 'Y', '2')
+#define FOURCC_NV12 mmioFOURCC('N', 'V', '1', '2')
+
+#include "ImxVideoFormat.hpp"
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmissing-braces"
+#include "datarange.h"
+#pragma GCC diagnostic pop
+
+/*! @brief A data range and what it must describe. */
+struct RangeCase_t
+{
+    const char *m_NamePtr;
+    const KS_DATARANGE_VIDEO *m_RangePtr;
+    video_pixel_format_t m_Format;  /*!< Format the driver negotiates for the range subtype. */
+    ULONG m_SubtypeData1;
+    WORD m_BitCount;
+    DWORD m_Compression;
+    LONG m_MinX;
+    LONG m_MinY;
+    LONG m_DefaultX;
+    LONG m_DefaultY;
+};
+
+static const RangeCase_t g_Ranges[] = {
+    {"RGB32 720p", &FormatRGB32_Capture720p, kVIDEO_PixelFormatXRGB8888, kVIDEO_PixelFormatXRGB8888, 32, KS_BI_RGB,
+        1280, 720, 1280, 720},
+    {"YUY2 scaled", &FormatYUY2_CaptureScaled, kVIDEO_PixelFormatYUYV, FOURCC_YUY2, 16, FOURCC_YUY2,
+        80, 46, 640, 360},
+    {"NV12 scaled", &FormatNV12_CaptureScaled, kVIDEO_PixelFormatNV12, FOURCC_NV12, 12, FOURCC_NV12,
+        80, 46, 640, 360},
+    {"RGB32 scaled", &FormatRGB32_CaptureScaled, kVIDEO_PixelFormatXRGB8888, kVIDEO_PixelFormatXRGB8888, 32, KS_BI_RGB,
+        80, 46, 640, 360},
+};
+
+#define RANGE_NUM (sizeof(g_Ranges) / sizeof(g_Ranges[0]))
+
+/*! @brief A requested size and whether IsRangeOutputSize() accepts it. */
+struct SizeCase_t
+{
+    UINT32 m_Range;     /*!< Index in g_Ranges. */
+    LONG m_Width;
+    LONG m_Height;
+    BOOL m_IsAccepted;
+};
+
+static const SizeCase_t g_Sizes[] = {
+    // Fixed range: its size only, both orientations.
+    {0, 1280, 720, TRUE},
+    {0, 1280, -720, TRUE},
+    {0, 640, 360, FALSE},
+    {0, 1272, 720, FALSE},
+    {0, 1280, 718, FALSE},
+    // Scaled: the default, the corners and one step out.
+    {1, 640, 360, TRUE},
+    {1, 640, -360, TRUE},
+    {1, 80, 46, TRUE},
+    {1, 1280, 720, TRUE},
+    {1, 80, 720, TRUE},
+    {1, 1280, 46, TRUE},
+    {1, 72, 46, FALSE},
+    {1, 80, 44, FALSE},
+    {1, 1288, 720, FALSE},
+    {1, 1280, 722, FALSE},
+    {1, 1280, -722, FALSE},
+    // Scaled: off the 8 x 2 grid.
+    {2, 84, 46, FALSE},
+    {2, 640, 361, FALSE},
+    {2, 644, 360, FALSE},
+    {2, 88, 48, TRUE},
+    {3, 320, 180, TRUE},
+    {3, 320, 240, TRUE},
+    {3, 176, 144, TRUE},
+    {3, 160, 120, TRUE},
+    {3, 0, 0, FALSE},
+    {3, -640, 360, FALSE},
+};
+
+static bool IsOnGrid(const RangeCase_t &Range, LONG Width, LONG Height)
+/*!
+ * Reference of IsRangeOutputSize(), from the expected range rather than the range itself.
+ */
+{
+    if (Height < 0) {
+        Height = -Height;
+    }
+    if ((Width < Range.m_MinX) || (Width > DMAX_X) || (Height < Range.m_MinY) || (Height > DMAX_Y)) {
+        return false;
+    }
+    return (Range.m_MinX == DMAX_X) ? true : ((((Width - Range.m_MinX) % 8) == 0) && (((Height - Range.m_MinY) % 2) == 0));
+}
+
+static ImxCaptureCaps_t IsiCaps()
+/*!
+ * ISI capabilities, as CCaptureDevice::SetupCapturePlan() sets them for i.MX8MP/i.MX8MN.
+ */
+{
+    ImxCaptureCaps_t caps = {};
+
+    caps.m_Formats[caps.m_FormatCnt++] = kVIDEO_PixelFormatYUYV;
+    caps.m_Formats[caps.m_FormatCnt++] = kVIDEO_PixelFormatNV12;
+    caps.m_Formats[caps.m_FormatCnt++] = kVIDEO_PixelFormatXRGB8888;
+    caps.m_Formats[caps.m_FormatCnt++] = kVIDEO_PixelFormatRGB565;
+    caps.m_MaxDownscale = IMX_ISI_MAX_DOWNSCALE;
+    return caps;
+}
+
+static bool IsiProduces(video_pixel_format_t Format, LONG Width, LONG Height)
+/*!
+ * The capture device negotiates the size in hardware and the ISI scaler can be set for it.
+ */
+{
+    const UINT32 resolution = FSL_VIDEO_RESOLUTION(Width, Height);
+    ImxCapturePlan_t plan;
+    ImxIsiScale_t scale;
+
+    return ImxNegotiateCapture(IsiCaps(), kVIDEO_Resolution720P, Format, resolution, plan) &&
+           (plan.m_Convert == kIMX_ConvertNone) &&
+           ImxIsiComputeScale(kVIDEO_Resolution720P, resolution, scale);
+}
+
+static void TestMinimum()
+{
+    // The smallest sizes on the grid the ISI can produce from 1280x720.
+    CHECK(ISI_MIN_X == 80);
+    CHECK(ISI_MIN_Y == 46);
+    CHECK((ISI_MIN_X % 8) == 0);
+    CHECK((ISI_MIN_Y % 2) == 0);
+    CHECK(IsiProduces(kVIDEO_PixelFormatYUYV, ISI_MIN_X, ISI_MIN_Y));
+    CHECK(!IsiProduces(kVIDEO_PixelFormatYUYV, ISI_MIN_X - 8, ISI_MIN_Y));
+    CHECK(!IsiProduces(kVIDEO_PixelFormatYUYV, ISI_MIN_X, ISI_MIN_Y - 2));
+}
+
+static void TestDescriptors()
+{
+    for (UINT32 i = 0; i < RANGE_NUM; ++i) {
+        const RangeCase_t &range = g_Ranges[i];
+        const KS_DATARANGE_VIDEO &video = *range.m_RangePtr;
+        const KS_VIDEO_STREAM_CONFIG_CAPS &caps = video.ConfigCaps;
+        const KS_BITMAPINFOHEADER &bmi = video.VideoInfoHeader.bmiHeader;
+        const bool isScaled = (range.m_MinX < DMAX_X);
+        const ULONG defaultBytes = (ULONG)(range.m_DefaultX * range.m_DefaultY * range.m_BitCount / 8);
+        int failures = g_NumFailures;
+
+        CHECK(video.DataRange.FormatSize == sizeof(KS_DATARANGE_VIDEO));
+        CHECK(video.DataRange.SubFormat.Data1 == range.m_SubtypeData1);
+        CHECK(video.DataRange.Specifier.Data1 == 0x05589f80L);
+        CHECK(video.DataRange.SampleSize == defaultBytes);
+        CHECK((caps.MinOutputSize.cx == range.m_MinX) && (caps.MinOutputSize.cy == range.m_MinY));
+        CHECK((caps.MaxOutputSize.cx == DMAX_X) && (caps.MaxOutputSize.cy == DMAX_Y));
+        CHECK((caps.InputSize.cx == DMAX_X) && (caps.InputSize.cy == DMAX_Y));
+        CHECK((caps.OutputGranularityX == 8) && (caps.OutputGranularityY == 2));
+        CHECK((caps.StretchTapsX == 0) && (caps.StretchTapsY == 0));
+        CHECK((caps.ShrinkTapsX == (isScaled ? 2 : 0)) && (caps.ShrinkTapsY == (isScaled ? 2 : 0)));
+        CHECK(caps.MinFrameInterval == ONESECOND / 30);
+        CHECK(caps.MinBitsPerSecond == range.m_MinX * range.m_MinY * range.m_BitCount * 30);
+        CHECK(caps.MaxBitsPerSecond == DMAX_X * DMAX_Y * range.m_BitCount * 30);
+        CHECK((bmi.biWidth == range.m_DefaultX) && (bmi.biHeight == range.m_DefaultY));
+        CHECK((bmi.biBitCount == range.m_BitCount) && (bmi.biCompression == range.m_Compression));
+        CHECK(bmi.biSizeImage == defaultBytes);
+        CHECK(video.VideoInfoHeader.dwBitRate == defaultBytes * 8 * 30);
+
+        // The default format is one the range produces.
+        CHECK(IsRangeOutputSize(&caps, bmi.biWidth, bmi.biHeight));
+        if (g_NumFailures != failures) {
+            printf("descriptor: %s\n", range.m_NamePtr);
+        }
+    }
+}
+
+static void TestSizeTable()
+{
+    for (UINT32 i = 0; i < sizeof(g_Sizes) / sizeof(g_Sizes[0]); ++i) {
+        const SizeCase_t &size = g_Sizes[i];
+        const RangeCase_t &range = g_Ranges[size.m_Range];
+        BOOL isAccepted = IsRangeOutputSize(&range.m_RangePtr->ConfigCaps, size.m_Width, size.m_Height);
+
+        CHECK(isAccepted == size.m_IsAccepted);
+        if (isAccepted != size.m_IsAccepted) {
+            printf("size: %s %dx%d\n", range.m_NamePtr, (int)size.m_Width, (int)size.m_Height);
+        }
+    }
+}
+
+static void TestEnumeration()
+/*!
+ * Steps through each range the way a client enumerates it: every size is accepted, is produced by the ISI without
+ * a CPU conversion, has an 8-byte aligned line pitch and a frame size the SampleSize formula gives, and the last
+ * step lands on the sensor size.
+ */
+{
+    for (UINT32 i = 0; i < RANGE_NUM; ++i) {
+        const RangeCase_t &range = g_Ranges[i];
+        const KS_VIDEO_STREAM_CONFIG_CAPS &caps = range.m_RangePtr->ConfigCaps;
+        UINT32 sizes = 0;
+        UINT32 bad = 0;
+        LONG width = caps.MinOutputSize.cx;
+        LONG height = caps.MinOutputSize.cy;
+
+        for (width = caps.MinOutputSize.cx; width <= caps.MaxOutputSize.cx; width += caps.OutputGranularityX) {
+            for (height = caps.MinOutputSize.cy; height <= caps.MaxOutputSize.cy; height += caps.OutputGranularityY) {
+                const UINT32 pitch = (UINT32)(width * ((range.m_Format == kVIDEO_PixelFormatNV12) ? 8 : range.m_BitCount) / 8);
+                const UINT32 bytes = (UINT32)((UINT64)width * height * range.m_BitCount / 8);
+
+                ++sizes;
+                if (!IsRangeOutputSize(&caps, width, height) || !IsRangeOutputSize(&caps, width, -height) ||
+                    !IsiProduces(range.m_Format, width, height) || ((pitch % 8) != 0) ||
+                    (ImxFrameBytes(range.m_Format, FSL_VIDEO_RESOLUTION(width, height)) != bytes)) {
+                    if (bad++ == 0) {
+                        printf("enumeration: %s %dx%d\n", range.m_NamePtr, (int)width, (int)height);
+                    }
+                }
+            }
+            CHECK(height - caps.OutputGranularityY == caps.MaxOutputSize.cy);
+        }
+        CHECK(width - caps.OutputGranularityX == caps.MaxOutputSize.cx);
+        CHECK(bad == 0);
+        CHECK(sizes == (UINT32)(((DMAX_X - range.m_MinX) / 8 + 1) * ((DMAX_Y - range.m_MinY) / 2 + 1)));
+        printf("enumeration: %s, %u sizes\n", range.m_NamePtr, sizes);
+    }
+}
+
+static void TestRejected()
+/*!
+ * Every size around the ranges, both orientations, against the reference.
+ */
+{
+    for (UINT32 i = 0; i < RANGE_NUM; ++i) {
+        const RangeCase_t &range = g_Ranges[i];
+        UINT32 bad = 0;
+
+        for (LONG width = -8; width <= DMAX_X + 16; ++width) {
+            for (LONG height = -(DMAX_Y + 8); height <= DMAX_Y + 8; ++height) {
+                bool isAccepted = IsRangeOutputSize(&range.m_RangePtr->ConfigCaps, width, height);
+
+                if (isAccepted != IsOnGrid(range, width, height)) {
+                    if (bad++ == 0) {
+                        printf("rejected: %s %dx%d\n", range.m_NamePtr, (int)width, (int)height);
+                    }
+                }
+            }
+        }
+        CHECK(bad == 0);
+    }
+}
+
+int main()
+{
+    TestMinimum();
+    TestDescriptors();
+    TestSizeTable();
+    TestEnumeration();
+    TestRejected();
+
+    return HostTestResult("datarangetest");
+}
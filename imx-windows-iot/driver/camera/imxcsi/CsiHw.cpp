@@ -242,6 +242,10 @@ NTSTATUS WdfCsi_ctx::CsiInit(const camera_config_t &Config)
         _DbgKdPrint(("The image width and frame buffer pitch should be multiple of 8-bytes.\r\n"));
         status = STATUS_INVALID_PARAMETER;
     }
+    if (Config.GetOutputResolution() != (UINT32)Config.resolution) {
+        _DbgKdPrint(("The CSI doesn't scale.\r\n"));
+        status = STATUS_INVALID_PARAMETER;
+    }
     if (NT_SUCCESS(status)) {
         switch (Config.cameraPixelFormat) {
         case kVIDEO_PixelFormatRGB888:
@@ -286,6 +290,9 @@ NTSTATUS WdfCsi_ctx::CsiInit(const camera_config_t &Config)
         m_CsiRegistersPtr->DMASA_FB2 = (UINT32)m_DiscardBuff[1].phys.QuadPart;
         // Buffer 2
         m_DiscardBuff[2].state = m_DiscardBuff[2].FREE;
+        // Zero-copy capture starts from the same buffers.
+        m_FrameRing.SetDiscardBuffer(0, (UINT64)m_DiscardBuff[0].phys.QuadPart, 0);
+        m_FrameRing.SetDiscardBuffer(1, (UINT64)m_DiscardBuff[1].phys.QuadPart, 0);
 
         { // Image resolution
             UINT32 busCyclePerPixel = 1; /* 2 cycles only for yuv over parallel 8-bit sensor input. */
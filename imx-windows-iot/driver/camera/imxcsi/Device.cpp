@@ -446,6 +446,24 @@ NTSTATUS WdfCsi_ctx::RegisterQueue()
     if (!NT_SUCCESS(status)) {
         TraceEvents(TRACE_LEVEL_ERROR, TRACE_QUEUE, "WdfIoQueueCreate failed %!STATUS!", status);
     }
+    else {
+        // Zero-copy frame buffers come from kernel clients only, as internal device control requests. They get a parallel queue of their
+        // own, so any number of them can be pending.
+        WDF_IO_QUEUE_CONFIG_INIT(&wdfQueueConfig, WdfIoQueueDispatchParallel);
+        wdfQueueConfig.PowerManaged = WdfFalse;
+        wdfQueueConfig.EvtIoInternalDeviceControl = WdfCsi_ctx::EvtZeroCopyInternalDeviceControl;
+
+        status = WdfIoQueueCreate(m_WdfDevice, &wdfQueueConfig, &wdfQueueAttributes, &m_ZeroCopyQueue);
+        if (!NT_SUCCESS(status)) {
+            TraceEvents(TRACE_LEVEL_ERROR, TRACE_QUEUE, "WdfIoQueueCreate failed %!STATUS!", status);
+        }
+        else {
+            status = WdfDeviceConfigureRequestDispatching(m_WdfDevice, m_ZeroCopyQueue, WdfRequestTypeDeviceControlInternal);
+            if (!NT_SUCCESS(status)) {
+                TraceEvents(TRACE_LEVEL_ERROR, TRACE_QUEUE, "WdfDeviceConfigureRequestDispatching failed %!STATUS!", status);
+            }
+        }
+    }
 
     return status;
 }
@@ -500,8 +518,20 @@ void WdfCsi_ctx::EvtDeviceControl(_In_ WDFQUEUE Queue, _In_ WDFREQUEST WdfReques
             break;
         case IOCTL_CSI_DRIVER_GET_FRAME:
             {
-                ctxPtr->EvtFrameRequest(requestCtxPtr);
-                // EvtFrameRequest completes request on it's own. Don't call WdfRequestComplete().
+                if (ctxPtr->m_IsZeroCopy) {
+                    // Frames go to queued buffers until the stream is reinitialized.
+                    WdfRequestComplete(WdfRequest, STATUS_INVALID_DEVICE_STATE);
+                }
+                else {
+                    ctxPtr->EvtFrameRequest(requestCtxPtr);
+                    // EvtFrameRequest completes request on it's own. Don't call WdfRequestComplete().
+                }
+            }
+            break;
+        case IOCTL_CSI_CAPTURE_STATS:
+            {
+                ctxPtr->EvtCaptureStatsRequest(requestCtxPtr);
+                // EvtCaptureStatsRequest completes request on it's own. Don't call WdfRequestComplete().
             }
             break;
         default:
@@ -563,6 +593,7 @@ NTSTATUS WdfCsi_ctx::Close()
 {
     NTSTATUS status = STATUS_SUCCESS;
 
+    TerminateIo(); // Returns zero-copy buffers still owned by the driver.
     CsiResetAndStop();
     ReleaseBuffers();
     return status;
@@ -632,12 +663,18 @@ void WdfCsi_ctx::TerminateIo()
     }
     m_State = S_STOPPED;
     CsiStart(false);
+    m_FrameRing.Abort();
     if (m_FinishedBuffPtr != NULL) {
         m_FinishedBuffPtr->state = m_FinishedBuffPtr->FREE;
         m_FinishedBuffPtr = NULL;
     }
     if (irql <= DISPATCH_LEVEL) {
         WdfInterruptReleaseLock(m_IsrCtx->m_WdfInterrupt);
+        CompleteQueuedFrames();
+    }
+    else if (m_FrameRing.HasDone()) {
+        // Called from EvtWdfInterruptDisable, aborted zero-copy buffers are completed by DPC.
+        WdfInterruptQueueDpcForIsr(m_IsrCtx->m_WdfInterrupt);
     }
 }
 
@@ -764,12 +801,15 @@ void WdfCsi_ctx::ReinitializeRequest(PREQUEST_CONTEXT RequestCtxPtr)
 
         status = WdfRequestRetrieveInputBuffer(RequestCtxPtr->m_WdfRequest, sizeof(camera_config_t), &(PVOID)configPtr, NULL);
         if (NT_SUCCESS(status)) {
+            TerminateIo(); // Returns zero-copy buffers of the previous stream.
             WdfInterruptAcquireLock(m_IsrCtx->m_WdfInterrupt);
 
             status = CsiInit(*configPtr);
             if (NT_SUCCESS(status)) {
                 CsiStart(true); // Enables IRQ
                 m_State = S_DISCARDING;
+                m_IsZeroCopy = false; // Until the first IOCTL_CSI_INTERNAL_QUEUE_FRAME.
+                m_FrameRing.Start();
                 WdfInterruptReleaseLock(m_IsrCtx->m_WdfInterrupt);
             }
             else {
@@ -781,6 +821,199 @@ void WdfCsi_ctx::ReinitializeRequest(PREQUEST_CONTEXT RequestCtxPtr)
     WdfRequestComplete(RequestCtxPtr->m_WdfRequest, status);
 }
 
+void WdfCsi_ctx::EvtCaptureStatsRequest(PREQUEST_CONTEXT RequestCtxPtr)
+/*!
+ * Returns zero-copy capture counters.
+ * EvtCaptureStatsRequest completes request on it's own. Don't use RequestCtxPtr after call.
+ *
+ * @param RequestCtxPtr pointer to request context.
+ */
+{
+    NTSTATUS status;
+    CaptureStats_t *statsPtr = NULL;
+
+    ASSERT(RequestCtxPtr != NULL);
+    ASSERT(RequestCtxPtr->m_WdfRequest != NULL);
+
+    status = WdfRequestRetrieveOutputBuffer(RequestCtxPtr->m_WdfRequest, sizeof(*statsPtr), &((PVOID)statsPtr), NULL);
+    if (NT_SUCCESS(status)) {
+        WdfInterruptAcquireLock(m_IsrCtx->m_WdfInterrupt);
+        *statsPtr = m_FrameRing.GetStats();
+        WdfInterruptReleaseLock(m_IsrCtx->m_WdfInterrupt);
+        WdfRequestSetInformation(RequestCtxPtr->m_WdfRequest, sizeof(*statsPtr));
+    }
+    WdfRequestComplete(RequestCtxPtr->m_WdfRequest, status);
+}
+
+void WdfCsi_ctx::EvtZeroCopyInternalDeviceControl(_In_ WDFQUEUE Queue, _In_ WDFREQUEST WdfRequest, _In_ size_t OutputBufferLength, _In_ size_t InputBufferLength, _In_ ULONG IoControlCode)
+/*!
+ * Handles IOCTL_CSI_INTERNAL_QUEUE_FRAME requests of kernel clients, applications cannot send internal device control requests.
+ *
+ * @param Queue handle to the zero-copy queue.
+ * @param WdfRequest handle to a WDF request object.
+ * @param OutputBufferLength size of request output buffer.
+ * @param InputBufferLength size of request input buffer.
+ * @param IoControlCode control code of the IRP.
+ */
+{
+    UNREFERENCED_PARAMETER(OutputBufferLength);
+    UNREFERENCED_PARAMETER(InputBufferLength);
+    auto ctxPtr = DeviceGetContext(WdfIoQueueGetDevice(Queue));
+
+    ASSERT(ctxPtr != NULL);
+    if (IoControlCode != IOCTL_CSI_INTERNAL_QUEUE_FRAME) {
+        WdfRequestComplete(WdfRequest, STATUS_INVALID_DEVICE_REQUEST);
+    }
+    else {
+        ctxPtr->EvtQueueFrameRequest(WdfRequest);
+    }
+}
+
+void WdfCsi_ctx::EvtQueueFrameRequest(WDFREQUEST WdfRequest)
+/*!
+ * Queues the request output buffer for zero-copy capture.
+ * The request stays pending until a frame is captured into the buffer, or the stream is stopped.
+ * First queued buffer switches the ISR from copy mode (IOCTL_CSI_DRIVER_GET_FRAME) until the next IOCTL_CSI_DRIVER_INIT.
+ *
+ * @param WdfRequest handle to a WDF request object.
+ */
+{
+    NTSTATUS status;
+    PMDL mdlPtr = NULL;
+    ImxFrameBuffer_t buff = {};
+    WDFREQUEST completeRequest = WdfRequest;
+
+    status = WdfRequestRetrieveOutputWdmMdl(WdfRequest, &mdlPtr);
+    if (NT_SUCCESS(status)) {
+        status = GetFrameBufferAddress(mdlPtr, buff);
+    }
+    if (NT_SUCCESS(status)) {
+        KeFlushIoBuffers(mdlPtr, TRUE, TRUE); // Dirty cache lines must not be written back over the frame.
+        buff.m_CookiePtr = WdfRequest;
+        status = WdfRequestMarkCancelableEx(WdfRequest, EvtZeroCopyRequestCancel);
+    }
+    if (NT_SUCCESS(status)) {
+        WdfInterruptAcquireLock(m_IsrCtx->m_WdfInterrupt);
+        if (!m_FrameRing.Queue(buff)) {
+            status = m_FrameRing.IsRunning() ? STATUS_DEVICE_BUSY : STATUS_DEVICE_NOT_READY;
+        }
+        else {
+            if (!m_IsZeroCopy) {
+                m_IsZeroCopy = true;
+                if (m_FinishedBuffPtr != NULL) { // Copy mode frame is not needed any more.
+                    m_FinishedBuffPtr->state = m_FinishedBuffPtr->FREE;
+                    m_FinishedBuffPtr = NULL;
+                }
+            }
+            completeRequest = NULL;
+        }
+        WdfInterruptReleaseLock(m_IsrCtx->m_WdfInterrupt);
+        if ((completeRequest != NULL) && (WdfRequestUnmarkCancelable(WdfRequest) == STATUS_CANCELLED)) {
+            completeRequest = NULL; // Cancel routine completes the request.
+        }
+    }
+    if (completeRequest != NULL) {
+        _DbgFrameKdPrint(("EvtQueueFrameRequest failed (s=0x%x)\r\n", status));
+        WdfRequestComplete(completeRequest, status);
+    }
+}
+
+void WdfCsi_ctx::EvtZeroCopyRequestCancel(WDFREQUEST WdfRequest)
+/*!
+ * Cancels a queued zero-copy frame buffer.
+ * Buffer already programmed into the CSI DMA can't be taken back, it's completed as canceled when the DMA is done with it.
+ *
+ * @param WdfRequest WDF request object to be canceled.
+ */
+{
+    PDEVICE_CONTEXT devCtxPtr = DeviceGetContext(WdfIoQueueGetDevice(WdfRequestGetIoQueue(WdfRequest)));
+    bool isOwnedByCsi;
+
+    WdfInterruptAcquireLock(devCtxPtr->m_IsrCtx->m_WdfInterrupt);
+    isOwnedByCsi = devCtxPtr->m_FrameRing.Cancel(WdfRequest);
+    WdfInterruptReleaseLock(devCtxPtr->m_IsrCtx->m_WdfInterrupt);
+    if (!isOwnedByCsi) {
+        WdfRequestComplete(WdfRequest, STATUS_CANCELLED);
+    }
+}
+
+void WdfCsi_ctx::CompleteQueuedFrames()
+/*!
+ * Completes zero-copy frame buffers retired by ISR or aborted by TerminateIo().
+ */
+{
+    ImxFrameBuffer_t buff;
+    bool isDone = true;
+
+    while (isDone) {
+        WdfInterruptAcquireLock(m_IsrCtx->m_WdfInterrupt);
+        isDone = m_FrameRing.PopDone(buff);
+        WdfInterruptReleaseLock(m_IsrCtx->m_WdfInterrupt);
+        if (isDone) {
+            WDFREQUEST wdfRequest = (WDFREQUEST)buff.m_CookiePtr;
+
+            if (buff.m_IsCanceled) {
+                WdfRequestComplete(wdfRequest, STATUS_CANCELLED); // Cancel routine left the request to us.
+            }
+            else if (WdfRequestUnmarkCancelable(wdfRequest) != STATUS_CANCELLED) { // Otherwise cancel routine completes the request.
+                if (buff.m_IsAborted) {
+                    WdfRequestComplete(wdfRequest, STATUS_CANCELLED);
+                }
+                else {
+                    PMDL mdlPtr;
+
+                    if (NT_SUCCESS(WdfRequestRetrieveOutputWdmMdl(wdfRequest, &mdlPtr))) {
+                        KeFlushIoBuffers(mdlPtr, TRUE, TRUE);
+                    }
+                    _DbgFrameKdPrint(("Zero-copy frame %u done.\r\n", buff.m_Sequence));
+                    ++m_CompleteFrameCnt;
+                    WdfRequestCompleteWithInformation(wdfRequest, STATUS_SUCCESS, m_FrameLenBytes);
+                }
+            }
+        }
+    }
+}
+
+NTSTATUS WdfCsi_ctx::GetFrameBufferAddress(PMDL MdlPtr, ImxFrameBuffer_t &Buff)
+/*!
+ * Gets physical address of an application frame buffer.
+ * CSI DMA writes frames directly to the buffer, so it must be physically contiguous, 8-byte aligned and below 4 GB.
+ *
+ * @param MdlPtr MDL describing the locked output buffer.
+ * @param Buff receives the buffer address.
+ *
+ * @returns STATUS_SUCCESS, STATUS_BUFFER_TOO_SMALL or STATUS_INVALID_PARAMETER if the CSI can't write to the buffer.
+ */
+{
+    NTSTATUS status = STATUS_SUCCESS;
+
+    if (MmGetMdlByteCount(MdlPtr) < m_FrameLenBytes) {
+        status = STATUS_BUFFER_TOO_SMALL;
+    }
+    else {
+        PPFN_NUMBER pfnPtr = MmGetMdlPfnArray(MdlPtr);
+        ULONG pageCnt = ADDRESS_AND_SIZE_TO_SPAN_PAGES(MmGetMdlVirtualAddress(MdlPtr), m_FrameLenBytes);
+        UINT64 phys = ((UINT64)pfnPtr[0] << PAGE_SHIFT) + MmGetMdlByteOffset(MdlPtr);
+
+        for (ULONG i = 1; ((i < pageCnt) && NT_SUCCESS(status)); ++i) {
+            if (pfnPtr[i] != (pfnPtr[0] + i)) {
+                status = STATUS_INVALID_PARAMETER;
+            }
+        }
+        if (((phys % 8) != 0) || ((phys + m_FrameLenBytes) > ((UINT64)MAXULONG + 1))) {
+            status = STATUS_INVALID_PARAMETER;
+        }
+        if (NT_SUCCESS(status)) {
+            Buff.m_PhysY = phys;
+            Buff.m_PhysU = 0;
+        }
+        else {
+            _DbgKdPrint(("Frame buffer 0x%llx is not usable by CSI DMA.\r\n", phys));
+        }
+    }
+    return status;
+}
+
 NTSTATUS WdfCsi_ctx::AllocFb(DiscardBuffInfo_t &buffInfo)
 /*!
  * Allocated buffer for common buffer DMA.
@@ -1043,7 +1276,23 @@ BOOLEAN CsiIsrCtx_t::EvtInterruptIsr(_In_ WDFINTERRUPT WdfInterrupt, _In_ ULONG
             }
             else {
                 // Enabled and no errors
-                if (csiFrameIrqFired
+                if (csiFrameIrqFired && devCtxPtr->m_IsZeroCopy) {
+                    UINT8 frameId = devCtxPtr->CsiPopSrFrameId(devCtxPtr->m_CsiRegistersPtr, csiSr);
+
+                    if (frameId > 0) {
+                        // Refill finished slot from the application buffer queue, DPC completes the filled buffer.
+                        const ImxFrameBuffer_t &nextBuff = devCtxPtr->m_FrameRing.FrameDone((frameId == 1) ? 0 : 1);
+
+                        if (frameId == 1) {
+                            devCtxPtr->m_CsiRegistersPtr->DMASA_FB1 = (UINT32)nextBuff.m_PhysY;
+                        }
+                        else {
+                            devCtxPtr->m_CsiRegistersPtr->DMASA_FB2 = (UINT32)nextBuff.m_PhysY;
+                        }
+                        scheduleDpc = devCtxPtr->m_FrameRing.HasDone();
+                    }
+                }
+                else if (csiFrameIrqFired
                     && (((devCtxPtr->m_State == WdfCsi_ctx::S_FRAME_REQUESTED) && (devCtxPtr->m_FinishedBuffPtr == NULL))
                        || (devCtxPtr->m_State == WdfCsi_ctx::S_DISCARDING))
                    )
@@ -1129,6 +1378,11 @@ void CsiIsrCtx_t::EvtInterruptDpc(_In_ WDFINTERRUPT WdfInterrupt, _In_ WDFOBJECT
 
     WdfCsi_ctx *devCtxPtr = DeviceGetContext(WdfInterruptGetDevice(WdfInterrupt));
     ASSERT(devCtxPtr);
+
+    devCtxPtr->CompleteQueuedFrames();
+    if (devCtxPtr->m_IsZeroCopy) {
+        return;
+    }
     ASSERT(devCtxPtr->m_ActiveRequestCtxPtr != NULL);
     ASSERT(devCtxPtr->m_State == WdfCsi_ctx::S_FRAME_REQUESTED);
 
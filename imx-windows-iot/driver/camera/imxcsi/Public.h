@@ -63,6 +63,11 @@ DEFINE_GUID (GUID_DEVINTERFACE_IMXCSI,
 #define IOCTL_CSI_DRIVER_STOP CTL_CODE(THIS_DEVICE_TYPE, 0x802, METHOD_BUFFERED, FILE_ANY_ACCESS)
 #define IOCTL_CSI_REQUIRED_FMT CTL_CODE(THIS_DEVICE_TYPE, 0x803, METHOD_BUFFERED, FILE_ANY_ACCESS)
 #define IOCTL_CSI_DRIVER_GET_FRAME CTL_CODE(THIS_DEVICE_TYPE, 0x804, METHOD_OUT_DIRECT, FILE_ANY_ACCESS)
+// Zero-copy capture, internal device control (IRP_MJ_INTERNAL_DEVICE_CONTROL) for kernel clients only. Output buffer must be physically
+// contiguous below 4 GB, request is pending until a frame is captured into it. Clients allocate frames with
+// MmAllocatePagesForMdlEx(MM_ALLOCATE_REQUIRE_CONTIGUOUS_CHUNKS) and pass the MDL as Irp->MdlAddress, see imxcamera.
+#define IOCTL_CSI_INTERNAL_QUEUE_FRAME CTL_CODE(THIS_DEVICE_TYPE, 0x805, METHOD_OUT_DIRECT, FILE_ANY_ACCESS)
+#define IOCTL_CSI_CAPTURE_STATS CTL_CODE(THIS_DEVICE_TYPE, 0x806, METHOD_BUFFERED, FILE_ANY_ACCESS)
 
 #endif
 
@@ -35,6 +35,7 @@ extern "C" {
 #include "dsdtutil.hpp"
 #include "Trace.h"
 #include "Public.h"
+#include "ImxFrameRing.hpp"
 #include "ImxCpuRev.h"
 
 
@@ -103,6 +104,7 @@ struct WdfCsi_ctx: io::ctx_acpi_csr_stub
 
     const WDFDEVICE m_WdfDevice;
     WDFQUEUE m_Queue;
+    WDFQUEUE m_ZeroCopyQueue;
 
     WDFWAITLOCK m_CreateDevLock;
     
@@ -144,11 +146,17 @@ struct WdfCsi_ctx: io::ctx_acpi_csr_stub
     static EVT_WDF_IO_QUEUE_IO_DEVICE_CONTROL EvtDeviceControl;
     static EVT_WDF_IO_QUEUE_IO_STOP EvtIoStop;
     static EVT_WDF_REQUEST_CANCEL EvtWdfRequestCancel;
+    static EVT_WDF_IO_QUEUE_IO_INTERNAL_DEVICE_CONTROL EvtZeroCopyInternalDeviceControl;
+    static EVT_WDF_REQUEST_CANCEL EvtZeroCopyRequestCancel;
     /* IRP MJ */
     NTSTATUS Close();
     void EvtFrameRequest(PREQUEST_CONTEXT RequestCtxPtr);
     void TerminateIo();
     void ReinitializeRequest(PREQUEST_CONTEXT RequestCtxPtr);
+    void EvtQueueFrameRequest(WDFREQUEST WdfRequest);
+    void EvtCaptureStatsRequest(PREQUEST_CONTEXT RequestCtxPtr);
+    void CompleteQueuedFrames();
+    NTSTATUS GetFrameBufferAddress(PMDL MdlPtr, ImxFrameBuffer_t &Buff);
 
     enum {
         S_FRAME_REQUESTED,
@@ -195,6 +203,10 @@ struct WdfCsi_ctx: io::ctx_acpi_csr_stub
     UINT32 m_ErrorAddrChangeCnt;
     UINT32 m_ErrorOverflowCnt;
     UINT32 m_CompleteFrameCnt;
+
+    // Zero-copy capture. m_FrameRing is shared with ISR, access it under the interrupt lock.
+    ImxFrameRing_t m_FrameRing;
+    bool m_IsZeroCopy;
 public:
     WdfCsi_ctx(WDFDEVICE &device);
     NTSTATUS RegisterQueue();
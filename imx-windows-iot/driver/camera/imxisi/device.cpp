@@ -476,6 +476,24 @@ NTSTATUS WdfIsi_ctx::RegisterQueue()
     if (!NT_SUCCESS(status)) {
         TraceEvents(TRACE_LEVEL_ERROR, TRACE_QUEUE, "WdfIoQueueCreate failed %!STATUS!", status);
     }
+    else {
+        // Zero-copy frame buffers come from kernel clients only, as internal device control requests. They get a parallel queue of their
+        // own, so any number of them can be pending.
+        WDF_IO_QUEUE_CONFIG_INIT(&wdfQueueConfig, WdfIoQueueDispatchParallel);
+        wdfQueueConfig.PowerManaged = WdfFalse;
+        wdfQueueConfig.EvtIoInternalDeviceControl = WdfIsi_ctx::EvtZeroCopyInternalDeviceControl;
+
+        status = WdfIoQueueCreate(m_WdfDevice, &wdfQueueConfig, &wdfQueueAttributes, &m_ZeroCopyQueue);
+        if (!NT_SUCCESS(status)) {
+            TraceEvents(TRACE_LEVEL_ERROR, TRACE_QUEUE, "WdfIoQueueCreate failed %!STATUS!", status);
+        }
+        else {
+            status = WdfDeviceConfigureRequestDispatching(m_WdfDevice, m_ZeroCopyQueue, WdfRequestTypeDeviceControlInternal);
+            if (!NT_SUCCESS(status)) {
+                TraceEvents(TRACE_LEVEL_ERROR, TRACE_QUEUE, "WdfDeviceConfigureRequestDispatching failed %!STATUS!", status);
+            }
+        }
+    }
 
     return status;
 }
@@ -533,8 +551,21 @@ void WdfIsi_ctx::EvtDeviceControl(_In_ WDFQUEUE Queue, _In_ WDFREQUEST WdfReques
         case IOCTL_ISI_DRIVER_GET_FRAME:
             {
                 _DbgFrameKdPrint(("IOCTL_ISI_DRIVER_GET_FRAME\r\n"));
-                ctxPtr->EvtFrameRequest(requestCtxPtr);
-                // EvtFrameRequest completes request on it's own. Don't call WdfRequestComplete().
+                if (ctxPtr->m_IsZeroCopy) {
+                    // Frames go to queued buffers until the stream is reinitialized.
+                    WdfRequestComplete(WdfRequest, STATUS_INVALID_DEVICE_STATE);
+                }
+                else {
+                    ctxPtr->EvtFrameRequest(requestCtxPtr);
+                    // EvtFrameRequest completes request on it's own. Don't call WdfRequestComplete().
+                }
+            }
+            break;
+        case IOCTL_ISI_CAPTURE_STATS:
+            {
+                _DbgKdPrint(("IOCTL_ISI_CAPTURE_STATS\r\n"));
+                ctxPtr->EvtCaptureStatsRequest(requestCtxPtr);
+                // EvtCaptureStatsRequest completes request on it's own. Don't call WdfRequestComplete().
             }
             break;
         case IOCTL_ISI_REQUIRED_FMT:
@@ -602,6 +633,7 @@ NTSTATUS WdfIsi_ctx::Close()
 {
     NTSTATUS status = STATUS_SUCCESS;
 
+    TerminateIo(); // Returns zero-copy buffers still owned by the driver.
     IsiResetAndStop();
     ReleaseBuffers();
     return status;
@@ -677,12 +709,18 @@ void WdfIsi_ctx::TerminateIo()
     }
     m_State = S_STOPPED;
     IsiStart(false);
+    m_FrameRing.Abort();
     if (m_FinishedBuffPtr != NULL) {
         m_FinishedBuffPtr->state = m_FinishedBuffPtr->FREE;
         m_FinishedBuffPtr = NULL;
     }
     if (locked) {
         WdfInterruptReleaseLock(m_IsrCtx->m_WdfInterrupt);
+        CompleteQueuedFrames();
+    }
+    else if (m_FrameRing.HasDone()) {
+        // Called from EvtWdfInterruptDisable, aborted zero-copy buffers are completed by DPC.
+        WdfInterruptQueueDpcForIsr(m_IsrCtx->m_WdfInterrupt);
     }
 }
 
@@ -799,12 +837,15 @@ void WdfIsi_ctx::ReinitializeRequest(PREQUEST_CONTEXT RequestCtxPtr)
 
         status = WdfRequestRetrieveInputBuffer(RequestCtxPtr->m_WdfRequest, sizeof(camera_config_t), &(PVOID)configPtr, NULL);
         if (NT_SUCCESS(status)) {
+            TerminateIo(); // Returns zero-copy buffers of the previous stream.
             WdfInterruptAcquireLock(m_IsrCtx->m_WdfInterrupt);
 
             status = IsiInit(*configPtr);
             if (NT_SUCCESS(status)) {
                 IsiStart(true); // Enables IRQ
                 m_State = S_DISCARDING;
+                m_IsZeroCopy = false; // Until the first IOCTL_ISI_INTERNAL_QUEUE_FRAME.
+                m_FrameRing.Start();
                 WdfInterruptReleaseLock(m_IsrCtx->m_WdfInterrupt);
             }
             else {
@@ -853,6 +894,8 @@ void WdfIsi_ctx::EvtInputFormatRequest(PREQUEST_CONTEXT RequestCtxPtr)
                     break;
                 case kVIDEO_PixelFormatYUYV:
                 case kVIDEO_PixelFormatNV12:
+                case kVIDEO_PixelFormatXRGB8888:
+                case kVIDEO_PixelFormatRGB565:
                     *inputPixelFmtPtr = kVIDEO_PixelFormatUYVY;
                     WdfRequestSetInformation(RequestCtxPtr->m_WdfRequest, sizeof(*inputPixelFmtPtr));
                     break;
@@ -866,6 +909,196 @@ void WdfIsi_ctx::EvtInputFormatRequest(PREQUEST_CONTEXT RequestCtxPtr)
     WdfRequestComplete(RequestCtxPtr->m_WdfRequest, status);
 }
 
+void WdfIsi_ctx::EvtCaptureStatsRequest(PREQUEST_CONTEXT RequestCtxPtr)
+/*!
+ * Returns zero-copy capture counters.
+ * EvtCaptureStatsRequest completes request on it's own. Don't use RequestCtxPtr after call.
+ *
+ * @param RequestCtxPtr pointer to request context.
+ */
+{
+    NTSTATUS status;
+    CaptureStats_t *statsPtr = NULL;
+
+    ASSERT(RequestCtxPtr != NULL);
+    ASSERT(RequestCtxPtr->m_WdfRequest != NULL);
+
+    status = WdfRequestRetrieveOutputBuffer(RequestCtxPtr->m_WdfRequest, sizeof(*statsPtr), &((PVOID)statsPtr), NULL);
+    if (NT_SUCCESS(status)) {
+        WdfInterruptAcquireLock(m_IsrCtx->m_WdfInterrupt);
+        *statsPtr = m_FrameRing.GetStats();
+        WdfInterruptReleaseLock(m_IsrCtx->m_WdfInterrupt);
+        WdfRequestSetInformation(RequestCtxPtr->m_WdfRequest, sizeof(*statsPtr));
+    }
+    WdfRequestComplete(RequestCtxPtr->m_WdfRequest, status);
+}
+
+void WdfIsi_ctx::EvtZeroCopyInternalDeviceControl(_In_ WDFQUEUE Queue, _In_ WDFREQUEST WdfRequest, _In_ size_t OutputBufferLength, _In_ size_t InputBufferLength, _In_ ULONG IoControlCode)
+/*!
+ * Handles IOCTL_ISI_INTERNAL_QUEUE_FRAME requests of kernel clients, applications cannot send internal device control requests.
+ *
+ * @param Queue handle to the zero-copy queue.
+ * @param WdfRequest handle to a WDF request object.
+ * @param OutputBufferLength size of request output buffer.
+ * @param InputBufferLength size of request input buffer.
+ * @param IoControlCode control code of the IRP.
+ */
+{
+    UNREFERENCED_PARAMETER(OutputBufferLength);
+    UNREFERENCED_PARAMETER(InputBufferLength);
+    auto ctxPtr = DeviceGetContext(WdfIoQueueGetDevice(Queue));
+
+    ASSERT(ctxPtr != NULL);
+    if (IoControlCode != IOCTL_ISI_INTERNAL_QUEUE_FRAME) {
+        WdfRequestComplete(WdfRequest, STATUS_INVALID_DEVICE_REQUEST);
+    }
+    else {
+        ctxPtr->EvtQueueFrameRequest(WdfRequest);
+    }
+}
+
+void WdfIsi_ctx::EvtQueueFrameRequest(WDFREQUEST WdfRequest)
+/*!
+ * Queues the request output buffer for zero-copy capture.
+ * The request stays pending until a frame is captured into the buffer, or the stream is stopped.
+ * First queued buffer switches the ISR from copy mode (IOCTL_ISI_DRIVER_GET_FRAME) until the next IOCTL_ISI_DRIVER_INIT.
+ *
+ * @param WdfRequest handle to a WDF request object.
+ */
+{
+    NTSTATUS status;
+    PMDL mdlPtr = NULL;
+    ImxFrameBuffer_t buff = {};
+    WDFREQUEST completeRequest = WdfRequest;
+
+    status = WdfRequestRetrieveOutputWdmMdl(WdfRequest, &mdlPtr);
+    if (NT_SUCCESS(status)) {
+        status = GetFrameBufferAddress(mdlPtr, buff);
+    }
+    if (NT_SUCCESS(status)) {
+        KeFlushIoBuffers(mdlPtr, TRUE, TRUE); // Dirty cache lines must not be written back over the frame.
+        buff.m_CookiePtr = WdfRequest;
+        status = WdfRequestMarkCancelableEx(WdfRequest, EvtZeroCopyRequestCancel);
+    }
+    if (NT_SUCCESS(status)) {
+        WdfInterruptAcquireLock(m_IsrCtx->m_WdfInterrupt);
+        if (!m_FrameRing.Queue(buff)) {
+            status = m_FrameRing.IsRunning() ? STATUS_DEVICE_BUSY : STATUS_DEVICE_NOT_READY;
+        }
+        else {
+            if (!m_IsZeroCopy) {
+                m_IsZeroCopy = true;
+                m_FinishedBuffPtr = NULL; // Copy mode frame is not needed any more.
+            }
+            completeRequest = NULL;
+        }
+        WdfInterruptReleaseLock(m_IsrCtx->m_WdfInterrupt);
+        if ((completeRequest != NULL) && (WdfRequestUnmarkCancelable(WdfRequest) == STATUS_CANCELLED)) {
+            completeRequest = NULL; // Cancel routine completes the request.
+        }
+    }
+    if (completeRequest != NULL) {
+        _DbgFrameKdPrint(("EvtQueueFrameRequest failed (s=0x%x)\r\n", status));
+        WdfRequestComplete(completeRequest, status);
+    }
+}
+
+void WdfIsi_ctx::EvtZeroCopyRequestCancel(WDFREQUEST WdfRequest)
+/*!
+ * Cancels a queued zero-copy frame buffer.
+ * Buffer already programmed into the ISI can't be taken back, it's completed as canceled when the ISI is done with it.
+ *
+ * @param WdfRequest WDF request object to be canceled.
+ */
+{
+    PDEVICE_CONTEXT devCtxPtr = DeviceGetContext(WdfIoQueueGetDevice(WdfRequestGetIoQueue(WdfRequest)));
+    bool isOwnedByIsi;
+
+    WdfInterruptAcquireLock(devCtxPtr->m_IsrCtx->m_WdfInterrupt);
+    isOwnedByIsi = devCtxPtr->m_FrameRing.Cancel(WdfRequest);
+    WdfInterruptReleaseLock(devCtxPtr->m_IsrCtx->m_WdfInterrupt);
+    if (!isOwnedByIsi) {
+        WdfRequestComplete(WdfRequest, STATUS_CANCELLED);
+    }
+}
+
+void WdfIsi_ctx::CompleteQueuedFrames()
+/*!
+ * Completes zero-copy frame buffers retired by ISR or aborted by TerminateIo().
+ */
+{
+    ImxFrameBuffer_t buff;
+    bool isDone = true;
+
+    while (isDone) {
+        WdfInterruptAcquireLock(m_IsrCtx->m_WdfInterrupt);
+        isDone = m_FrameRing.PopDone(buff);
+        WdfInterruptReleaseLock(m_IsrCtx->m_WdfInterrupt);
+        if (isDone) {
+            WDFREQUEST wdfRequest = (WDFREQUEST)buff.m_CookiePtr;
+
+            if (buff.m_IsCanceled) {
+                WdfRequestComplete(wdfRequest, STATUS_CANCELLED); // Cancel routine left the request to us.
+            }
+            else if (WdfRequestUnmarkCancelable(wdfRequest) != STATUS_CANCELLED) { // Otherwise cancel routine completes the request.
+                if (buff.m_IsAborted) {
+                    WdfRequestComplete(wdfRequest, STATUS_CANCELLED);
+                }
+                else {
+                    PMDL mdlPtr;
+
+                    if (NT_SUCCESS(WdfRequestRetrieveOutputWdmMdl(wdfRequest, &mdlPtr))) {
+                        KeFlushIoBuffers(mdlPtr, TRUE, TRUE);
+                    }
+                    _DbgFrameKdPrint(("Zero-copy frame %u done.\r\n", buff.m_Sequence));
+                    ++m_CompleteFrameCnt;
+                    WdfRequestCompleteWithInformation(wdfRequest, STATUS_SUCCESS, m_FrameLenBytes);
+                }
+            }
+        }
+    }
+}
+
+NTSTATUS WdfIsi_ctx::GetFrameBufferAddress(PMDL MdlPtr, ImxFrameBuffer_t &Buff)
+/*!
+ * Gets physical addresses of an application frame buffer.
+ * ISI writes frames directly to the buffer, so it must be physically contiguous, 8-byte aligned and below 4 GB.
+ *
+ * @param MdlPtr MDL describing the locked output buffer.
+ * @param Buff receives plane addresses.
+ *
+ * @returns STATUS_SUCCESS, STATUS_BUFFER_TOO_SMALL or STATUS_INVALID_PARAMETER if the ISI can't write to the buffer.
+ */
+{
+    NTSTATUS status = STATUS_SUCCESS;
+
+    if ((m_FrameLenBytes == 0) || (MmGetMdlByteCount(MdlPtr) < m_FrameLenBytes)) {
+        status = STATUS_BUFFER_TOO_SMALL;
+    }
+    else {
+        PPFN_NUMBER pfnPtr = MmGetMdlPfnArray(MdlPtr);
+        ULONG pageCnt = ADDRESS_AND_SIZE_TO_SPAN_PAGES(MmGetMdlVirtualAddress(MdlPtr), m_FrameLenBytes);
+        UINT64 phys = ((UINT64)pfnPtr[0] << PAGE_SHIFT) + MmGetMdlByteOffset(MdlPtr);
+
+        for (ULONG i = 1; ((i < pageCnt) && NT_SUCCESS(status)); ++i) {
+            if (pfnPtr[i] != (pfnPtr[0] + i)) {
+                status = STATUS_INVALID_PARAMETER;
+            }
+        }
+        if (((phys % 8) != 0) || ((phys + m_FrameLenBytes) > ((UINT64)MAXULONG + 1))) {
+            status = STATUS_INVALID_PARAMETER;
+        }
+        if (NT_SUCCESS(status)) {
+            Buff.m_PhysY = phys;
+            Buff.m_PhysU = (m_NumPlanes > 1) ? (phys + m_UPlaneOffsetBytes) : 0;
+        }
+        else {
+            _DbgKdPrint(("Frame buffer 0x%llx is not usable by ISI DMA.\r\n", phys));
+        }
+    }
+    return status;
+}
+
 NTSTATUS WdfIsi_ctx::AllocFb(DiscardBuffInfo_t &buffInfo)
 /*!
  * Allocated buffer for common buffer DMA.
@@ -983,8 +1216,8 @@ void WdfIsi_ctx::FreeFb(DiscardBuffInfo_t &buffInfo)
 NTSTATUS WdfIsi_ctx::ReSplitFrameBuffers(const camera_config_t &Config)
 {
     NTSTATUS status = STATUS_SUCCESS;
-    const UINT32 width = FSL_VIDEO_EXTRACT_WIDTH((UINT32)Config.resolution);
-    const UINT32 height = FSL_VIDEO_EXTRACT_HEIGHT((UINT32)Config.resolution);
+    const UINT32 width = FSL_VIDEO_EXTRACT_WIDTH(Config.GetOutputResolution());
+    const UINT32 height = FSL_VIDEO_EXTRACT_HEIGHT(Config.GetOutputResolution());
     const UINT32 planeSize = width * height;
 
     for (unsigned i = 0; ((i < COMMON_FRAME_BUFFER_NUM) && NT_SUCCESS(status)); ++i) {
@@ -1012,6 +1245,11 @@ NTSTATUS WdfIsi_ctx::ReSplitFrameBuffers(const camera_config_t &Config)
         }
         m_FrameLenBytes = frameSize;
     }
+    m_UPlaneOffsetBytes = planeSize * m_PlaneBytesPerPixel;
+    if (m_FrameLenBytes > m_BufferRequiredSize) {
+        _DbgKdPrint(("Frame size 0x%x exceeds the frame buffer size 0x%x.\r\n", (UINT32)m_FrameLenBytes, (UINT32)m_BufferRequiredSize));
+        status = STATUS_INVALID_PARAMETER;
+    }
     return status;
 }
 
@@ -1169,7 +1407,17 @@ BOOLEAN IsiIsrCtx_t::EvtInterruptIsr(_In_ WDFINTERRUPT WdfInterrupt, _In_ ULONG
         if (csiFrameIrqFired) {
             servicedIrq = true;
             frameId = ((isiSts & STS_BUF1_ACTIVE_BIT) > 0) + (((isiSts & STS_BUF2_ACTIVE_BIT) > 0) << 1); // STS_BUF1_ACTIVE_BIT == 1, STS_BUF2_ACTIVE_BIT == 2
-            if (frameId > 0) {
+            if ((frameId > 0) && devCtxPtr->m_IsZeroCopy) {
+                // Refill finished slot from the application buffer queue, DPC completes the filled buffer.
+                frameId -= devCtxPtr->m_QuirkInvertFrameId;
+
+                UINT8 slotId = (frameId == 1) ? 0 : 1;
+                const ImxFrameBuffer_t &nextBuff = devCtxPtr->m_FrameRing.FrameDone(slotId);
+
+                devCtxPtr->setFrameBuffer(slotId, nextBuff.m_PhysY, nextBuff.m_PhysU);
+                scheduleDpc = devCtxPtr->m_FrameRing.HasDone();
+            }
+            else if (frameId > 0) {
                 frameId -= devCtxPtr->m_QuirkInvertFrameId;
 
                 UINT64 donePhys = ((frameId == 1) ? devCtxPtr->m_IsiRegistersPtr->OUT_BUF1_ADDR_Y : devCtxPtr->m_IsiRegistersPtr->OUT_BUF2_ADDR_Y);
@@ -1245,6 +1493,11 @@ void IsiIsrCtx_t::EvtInterruptDpc(_In_ WDFINTERRUPT WdfInterrupt, _In_ WDFOBJECT
     UNREFERENCED_PARAMETER(AssociatedObject);
     ASSERT(devCtxPtr);
 
+    devCtxPtr->CompleteQueuedFrames();
+    if (devCtxPtr->m_IsZeroCopy) {
+        return;
+    }
+
     auto *requestCtxPtr = (PREQUEST_CONTEXT) InterlockedExchangePointer(&(void*)devCtxPtr->m_ActiveRequestCtxPtr, NULL);
     auto *finishedBuffPtr = (WdfIsi_ctx::DiscardBuffInfo_t*) InterlockedExchangePointer(&(void*)devCtxPtr->m_FinishedBuffPtr, NULL);
 
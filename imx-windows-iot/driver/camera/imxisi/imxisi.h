@@ -35,6 +35,7 @@ extern "C" {
 #include "dsdtutil.hpp"
 #include "trace.h"
 #include "public.h"
+#include "ImxFrameRing.hpp"
 #include "ImxCpuRev.h"
 
 #define DISPATCH_CODE() PAGED_ASSERT(KeGetCurrentIrql() == DISPATCH_LEVEL);
@@ -107,6 +108,7 @@ struct WdfIsi_ctx: io::ctx_acpi_csr_stub
 
     const WDFDEVICE m_WdfDevice;
     WDFQUEUE m_Queue;
+    WDFQUEUE m_ZeroCopyQueue;
 
     WDFWAITLOCK m_CreateDevLock;
 
@@ -146,12 +148,18 @@ struct WdfIsi_ctx: io::ctx_acpi_csr_stub
     static EVT_WDF_IO_QUEUE_IO_DEVICE_CONTROL EvtDeviceControl;
     static EVT_WDF_IO_QUEUE_IO_STOP EvtIoStop;
     static EVT_WDF_REQUEST_CANCEL EvtWdfRequestCancel;
+    static EVT_WDF_IO_QUEUE_IO_INTERNAL_DEVICE_CONTROL EvtZeroCopyInternalDeviceControl;
+    static EVT_WDF_REQUEST_CANCEL EvtZeroCopyRequestCancel;
     /* IRP MJ */
     NTSTATUS Close();
     void EvtFrameRequest(PREQUEST_CONTEXT RequestCtxPtr);
     void TerminateIo();
     void ReinitializeRequest(PREQUEST_CONTEXT RequestCtxPtr);
     void EvtInputFormatRequest(PREQUEST_CONTEXT RequestCtxPtr);
+    void EvtQueueFrameRequest(WDFREQUEST WdfRequest);
+    void EvtCaptureStatsRequest(PREQUEST_CONTEXT RequestCtxPtr);
+    void CompleteQueuedFrames();
+    NTSTATUS GetFrameBufferAddress(PMDL MdlPtr, ImxFrameBuffer_t &Buff);
 
     enum {
         S_FRAME_REQUESTED,
@@ -167,6 +175,7 @@ struct WdfIsi_ctx: io::ctx_acpi_csr_stub
     void IsiStart(bool Enable);
     void IsiResetAndStop();
     void WdfIsi_ctx::setFrameBuffer(UINT8 FrameBudId, DiscardBuffInfo_t &discardBuff);
+    void setFrameBuffer(UINT8 FrameBudId, UINT64 PhysY, UINT64 PhysU);
     NTSTATUS IsiInit(const camera_config_t &Config);
     void FinishGetFrameRequest(WdfIsi_ctx::DiscardBuffInfo_t*, PREQUEST_CONTEXT RequestCtxPtr);
 
@@ -182,6 +191,7 @@ struct WdfIsi_ctx: io::ctx_acpi_csr_stub
     NTSTATUS ReleaseBuffers();
     static constexpr SIZE_T m_BufferRequiredSize = 1366 * 768 * 4;
     SIZE_T m_FrameLenBytes = 0;
+    SIZE_T m_UPlaneOffsetBytes;
     UINT8 m_NumPlanes;
     UINT8 m_PlaneBytesPerPixel;
     UINT8 m_CpuId;
@@ -193,6 +203,10 @@ struct WdfIsi_ctx: io::ctx_acpi_csr_stub
     UINT32 m_ErrorAddrChangeCnt;
     UINT32 m_ErrorOverflowCnt;
     UINT32 m_CompleteFrameCnt;
+
+    // Zero-copy capture. m_FrameRing is shared with ISR, access it under the interrupt lock.
+    ImxFrameRing_t m_FrameRing;
+    bool m_IsZeroCopy;
 public:
     WdfIsi_ctx(WDFDEVICE &Device);
     NTSTATUS RegisterQueue();
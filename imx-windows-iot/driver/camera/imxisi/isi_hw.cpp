@@ -29,6 +29,10 @@
 
 #include "imxisi.h"
 #include "isi_iomap.h"
+#include "ImxVideoFormat.hpp"
+
+/* YCbCr (BT.601 limited range) to RGB, CSC_COEFF0..5 in the A1..A3, B1..B3, C1..C3, D1..D3 register order. */
+static const UINT32 IsiCscYuvToRgbCoeffs[] = { 0x0000012AU, 0x012A0198U, 0x0730079CU, 0x0204012AU, 0x01F00000U, 0x01800180U };
 
 void WdfIsi_ctx::DisableAllInterruptsNofence()
 /*!
@@ -83,15 +87,27 @@ void WdfIsi_ctx::EnableFrameInterruptsNofence(bool enable, bool clear)
 }
 
 void WdfIsi_ctx::setFrameBuffer(UINT8 FrameBudId, DiscardBuffInfo_t &discardBuff)
+{
+    setFrameBuffer(FrameBudId, (UINT64)discardBuff.physY.QuadPart, (UINT64)discardBuff.physU.QuadPart);
+}
+
+void WdfIsi_ctx::setFrameBuffer(UINT8 FrameBudId, UINT64 PhysY, UINT64 PhysU)
+/*!
+ * Program output buffer address, takes effect on the next frame captured into the slot.
+ *
+ * @param FrameBudId output buffer slot, 0 for BUF1, 1 for BUF2.
+ * @param PhysY packed or Y plane physical address.
+ * @param PhysU U/UV plane physical address or 0.
+ */
 {
     if (FrameBudId == 0) {
-        m_IsiRegistersPtr->OUT_BUF1_ADDR_Y = (UINT32)discardBuff.physY.QuadPart;
-        m_IsiRegistersPtr->OUT_BUF1_ADDR_U = (UINT32)discardBuff.physU.QuadPart;
+        m_IsiRegistersPtr->OUT_BUF1_ADDR_Y = (UINT32)PhysY;
+        m_IsiRegistersPtr->OUT_BUF1_ADDR_U = (UINT32)PhysU;
         m_IsiRegistersPtr->OUT_BUF_CTRL ^= OUT_BUF_CTRL_LOAD_BUF1_ADDR_BIT;
     }
     else {
-        m_IsiRegistersPtr->OUT_BUF2_ADDR_Y = (UINT32)discardBuff.physY.QuadPart;
-        m_IsiRegistersPtr->OUT_BUF2_ADDR_U = (UINT32)discardBuff.physU.QuadPart;
+        m_IsiRegistersPtr->OUT_BUF2_ADDR_Y = (UINT32)PhysY;
+        m_IsiRegistersPtr->OUT_BUF2_ADDR_U = (UINT32)PhysU;
         m_IsiRegistersPtr->OUT_BUF_CTRL ^= OUT_BUF_CTRL_LOAD_BUF2_ADDR_BIT;
     }
 }
@@ -136,6 +152,7 @@ void WdfIsi_ctx::IsiResetAndStop()
 NTSTATUS WdfIsi_ctx::IsiInit(const camera_config_t &Config)
 /*!
  * Enable or disable the CSI FIFO DMA request.
+ * The ISI converts the YUV input to RGB output formats and downscales to Config.outputResolution.
  *
  * @param config Video properties (resolution, framerate, color format ..).
  *
@@ -145,12 +162,18 @@ NTSTATUS WdfIsi_ctx::IsiInit(const camera_config_t &Config)
     NTSTATUS status = STATUS_SUCCESS;
     UINT32 resultPixFmt = 0;
     bool outpIsYuv = false;
-    UINT32 imgWidth_Bytes = FSL_VIDEO_EXTRACT_WIDTH((UINT32)Config.resolution) * Config.GetPixelSizeBits(Config.resultPixelFormat);
+    const UINT32 outResolution = Config.GetOutputResolution();
+    UINT32 imgWidth_Bytes = FSL_VIDEO_EXTRACT_WIDTH(outResolution) * Config.GetPixelSizeBits(Config.resultPixelFormat);
+    ImxIsiScale_t scale = {};
 
     if ((0U != (imgWidth_Bytes % 8)) || (imgWidth_Bytes == 0)) {
         _DbgKdPrint(("The image width and frame buffer pitch should be multiple of 8-bytes.\r\n"));
         status = STATUS_INVALID_PARAMETER;
     }
+    if (NT_SUCCESS(status) && !ImxIsiComputeScale((UINT32)Config.resolution, outResolution, scale)) {
+        _DbgKdPrint(("Unsupported ISI scaling 0x%x -> 0x%x.\r\n", (UINT32)Config.resolution, outResolution));
+        status = STATUS_INVALID_PARAMETER;
+    }
     // Correct input format could be asserted here.
     if (NT_SUCCESS(status)) {
         m_NumPlanes = 1;
@@ -173,11 +196,22 @@ NTSTATUS WdfIsi_ctx::IsiInit(const camera_config_t &Config)
             m_NumPlanes = 2;
             m_PlaneBytesPerPixel = 1;
             break;
+        case kVIDEO_PixelFormatXRGB8888:
+            _DbgKdPrint(("kVIDEO_PixelFormatXRGB8888\r\n"));
+            resultPixFmt = IMG_CTRL_FORMAT_XRGB8888;
+            m_PlaneBytesPerPixel = 4;
+            break;
+        case kVIDEO_PixelFormatRGB565:
+            _DbgKdPrint(("kVIDEO_PixelFormatRGB565\r\n"));
+            resultPixFmt = IMG_CTRL_FORMAT_RGB565;
+            break;
         default:
             _DbgKdPrint(("kVIDEO_Invalid: 0x%x\r\n", Config.resultPixelFormat));
             status = STATUS_INVALID_PARAMETER;
         }
-        ReSplitFrameBuffers(Config);
+        if (NT_SUCCESS(status)) {
+            status = ReSplitFrameBuffers(Config);
+        }
     }
     if (NT_SUCCESS(status)) {
         IsiResetAndStop();
@@ -198,6 +232,9 @@ NTSTATUS WdfIsi_ctx::IsiInit(const camera_config_t &Config)
         setFrameBuffer(1, m_DiscardBuff[1]);
         // Buffer 2
         m_DiscardBuff[2].state = m_DiscardBuff[2].FREE;
+        // Zero-copy capture starts from the same buffers.
+        m_FrameRing.SetDiscardBuffer(0, (UINT64)m_DiscardBuff[0].physY.QuadPart, (UINT64)m_DiscardBuff[0].physU.QuadPart);
+        m_FrameRing.SetDiscardBuffer(1, (UINT64)m_DiscardBuff[1].physY.QuadPart, (UINT64)m_DiscardBuff[1].physU.QuadPart);
 
 #if ( COMMON_FRAME_BUFFER_NUM > 3 )
         m_DiscardBuff[3].state = m_DiscardBuff[3].FREE;
@@ -206,19 +243,33 @@ NTSTATUS WdfIsi_ctx::IsiInit(const camera_config_t &Config)
         { // Image resolution
             const UINT32 width = FSL_VIDEO_EXTRACT_WIDTH((UINT32)Config.resolution);
             const UINT32 height = FSL_VIDEO_EXTRACT_HEIGHT((UINT32)Config.resolution);
-            _DbgKdPrint(("ISI W:%d H:%d\r\n", width, height));
+            const UINT32 outWidth = FSL_VIDEO_EXTRACT_WIDTH(outResolution);
+            const UINT32 outHeight = FSL_VIDEO_EXTRACT_HEIGHT(outResolution);
+            _DbgKdPrint(("ISI W:%d H:%d -> W:%d H:%d\r\n", width, height, outWidth, outHeight));
             m_IsiRegistersPtr->IMG_CFG = IMG_CFG_HEIGHT(height) | IMG_CFG_WIDTH(width);
-            m_IsiRegistersPtr->SCL_IMG_CFG = SCL_IMG_CFG_HEIGHT(height) | SCL_IMG_CFG_WIDTH(width);
-            m_IsiRegistersPtr->OUT_BUF_PITCH = width * m_PlaneBytesPerPixel; // FIXME bytes per pixel
+            m_IsiRegistersPtr->SCL_IMG_CFG = SCL_IMG_CFG_HEIGHT(outHeight) | SCL_IMG_CFG_WIDTH(outWidth);
+            m_IsiRegistersPtr->OUT_BUF_PITCH = outWidth * m_PlaneBytesPerPixel;
         }
 
         {
-            UINT32 imgCtrl = IMG_CTRL_CSC_BYP_BIT; // Bypass color conversion and scaler.
+            UINT32 imgCtrl = IMG_CTRL_DEC_X(scale.m_DecX) | IMG_CTRL_DEC_Y(scale.m_DecY);
 
+            if (outpIsYuv) {
+                imgCtrl |= IMG_CTRL_CSC_BYP_BIT; // Bypass color conversion.
+            }
+            else {
+                imgCtrl |= IMG_CTRL_CSC_MODE_YCbCr_TO_RGB;
+                m_IsiRegistersPtr->CSC_COEFF0 = IsiCscYuvToRgbCoeffs[0];
+                m_IsiRegistersPtr->CSC_COEFF1 = IsiCscYuvToRgbCoeffs[1];
+                m_IsiRegistersPtr->CSC_COEFF2 = IsiCscYuvToRgbCoeffs[2];
+                m_IsiRegistersPtr->CSC_COEFF3 = IsiCscYuvToRgbCoeffs[3];
+                m_IsiRegistersPtr->CSC_COEFF4 = IsiCscYuvToRgbCoeffs[4];
+                m_IsiRegistersPtr->CSC_COEFF5 = IsiCscYuvToRgbCoeffs[5];
+            }
             m_IsiRegistersPtr->IMG_CTRL = imgCtrl | resultPixFmt; //Output image format
 
-            /* set scale ratio 1:1. 0x1000 means 01.0000 0000 0000 (2-bit integer and 12 bit fraction) */
-            m_IsiRegistersPtr->SCALE_FACTOR = SCALE_FACTOR_X_SCALE(0x1000) | SCALE_FACTOR_Y_SCALE(0x1000);
+            /* 0x1000 means 01.0000 0000 0000 (2-bit integer and 12 bit fraction), the ratio left after decimation. */
+            m_IsiRegistersPtr->SCALE_FACTOR = SCALE_FACTOR_X_SCALE(scale.m_ScaleX) | SCALE_FACTOR_Y_SCALE(scale.m_ScaleY);
             /* set initial vertical offsetto 0 */
             m_IsiRegistersPtr->SCALE_OFFSET = 0;
         }
@@ -227,8 +278,11 @@ NTSTATUS WdfIsi_ctx::IsiInit(const camera_config_t &Config)
         }
 
         {
+            // The pipeline bypass also skips the CSC and the scaler.
+            const bool bypass = outpIsYuv && (outResolution == (UINT32)Config.resolution);
+
             m_IsiRegistersPtr->CTRL = CTRL_CLK_EN_BIT
-                | CTRL_BYPASS_BIT
+                | (bypass ? CTRL_BYPASS_BIT : 0U)
                 | CTRL_VC_ID(Config.mipiChannel)
                 | CTRL_SRC(m_MipiCsiSrc);
         }
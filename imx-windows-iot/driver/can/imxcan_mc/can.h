@@ -37,6 +37,7 @@
 
 #pragma once
 
+#include "canfilter.h"
 
 /** CAN Device Interface GUID */
 DEFINE_GUID(GUID_DEVINTERFACE_CAN_CONTROLLER, 0x9d3484af, 0xd47f, 0x4e60, 0x8d, 0xce, 0x3a, 0x4e, 0xbf, 0xb8, 0xf6, 0x70);
@@ -124,6 +125,11 @@ enum {
     /* Helper IOCTLs */
     CAN_IOCTL_ID_HELPER_FLEXCAN_ID_STD,
     CAN_IOCTL_ID_HELPER_FLEXCAN_RX_MB_STD_MASK,
+    /* Shared frame ring IOCTLs */
+    CAN_IOCTL_ID_CONTROLLER_MAP_RING,
+    CAN_IOCTL_ID_CONTROLLER_RING_DOORBELL,
+    /* Receive filter IOCTLs */
+    CAN_IOCTL_ID_CONTROLLER_SET_RX_FIFO_FILTER,
 };
 
 
@@ -2618,4 +2624,206 @@ typedef struct _flexcan_rx_mb_std_ioctl_t
 
 typedef flexcan_rx_mb_std_ioctl_t CAN_HELPER_FLEXCAN_RX_MB_STD_MASK_INPUT;
 
+/** Frame ring entry flags. */
+enum _can_ring_entry_flags
+{
+    kCAN_RING_EntryFD = 0x1U,               /*!< The entry holds a CAN FD frame (FDframe), otherwise a classic frame (frame). */
+};
+
+/** Frame ring entry, see canring.h for the ring protocol. */
+typedef struct _can_ring_entry
+{
+    UINT64  timestamp;                      /* RX: KeQueryPerformanceCounter() value when the interrupt pass that read the frame started,
+                                               shared by all the entries of the pass. See canring.h for the per-frame timestamp. */
+    status_t status;                        /* RX: kStatus_FLEXCAN_RxIdle, kStatus_FLEXCAN_RxOverflow if frames were lost in the Message Buffer,
+                                               kStatus_FLEXCAN_RxFifoIdle, kStatus_FLEXCAN_RxFifoOverflow for the frames of the Legacy Rx FIFO. */
+    UINT8   mbIdx;                          /* RX: Message Buffer the frame was received in, 0 for the Legacy Rx FIFO. */
+    UINT8   flags;                          /* Combination of _can_ring_entry_flags. */
+    UINT16  reserved;
+    union
+    {
+        flexcan_frame_t     frame;          /* Classic CAN frame, the frame timestamp is the FlexCAN free-running timer value. */
+        flexcan_fd_frame_t  FDframe;        /* CAN FD frame, used when the controller was initialized with IOCTL_CAN_CONTROLLER_FD_INIT. */
+    } u;
+} can_ring_entry_t;
+
+typedef can_ring_entry_t CAN_RING_ENTRY;
+
+/** Frame ring map flags. */
+enum _can_ring_map_flags
+{
+    kCAN_RING_MapRxFifo = 0x1U,             /*!< The ring drains the Legacy Rx FIFO, see IOCTL_CAN_CONTROLLER_SET_RX_FIFO_FILTER. */
+};
+
+/** IOCTL_CAN_CONTROLLER_MAP_RING input parameter structure. */
+typedef struct _can_ring_map
+{
+    UINT8   rxMbFirst;                      /* First RX Message Buffer owned by the ring, configured by SET_RXMB_CONFIG/SET_FD_RXMB_CONFIG. */
+    UINT8   rxMbCount;                      /* Number of RX Message Buffers owned by the ring. */
+    UINT8   txMbFirst;                      /* First TX Message Buffer owned by the ring, configured by SET_TXMB_CONFIG/SET_FD_TXMB_CONFIG. */
+    UINT8   txMbCount;                      /* Number of TX Message Buffers owned by the ring. */
+    UINT32  flags;                          /* Combination of _can_ring_map_flags. */
+} can_ring_map_t;
+
+typedef can_ring_map_t CAN_CONTROLLER_MAP_RING_INPUT;
+
+/**
+ * IOCTL_CAN_CONTROLLER_MAP_RING
+ *
+ * This function hands a shared frame ring to the driver. The ring buffer is passed as the output buffer and must be
+ * initialized by CanRingInitialize() with an entry size of sizeof(CAN_RING_ENTRY). The request stays pending while the
+ * ring is in use, cancel it (CancelIoEx) or close the handle to release the ring. Received frames of the RX Message
+ * Buffers owned by the ring are written to the RX ring in batches by the interrupt handler, frames written to the TX
+ * ring are sent by the TX Message Buffers owned by the ring. With kCAN_RING_MapRxFifo the ring also owns the enabled
+ * Legacy Rx FIFO, all the frames in the FIFO are moved to the RX ring at each FIFO interrupt. The Message Buffers and
+ * the FIFO must not be used by other IOCTLs while the ring is mapped. Only one ring can be mapped at a time.
+ *
+ * DeviceIoControl(
+ *                  hDevice,
+ *                  IOCTL_CAN_CONTROLLER_MAP_RING,
+ *                  &CAN_CONTROLLER_MAP_RING_INPUT,
+ *                  sizeof(CAN_CONTROLLER_MAP_RING_INPUT),
+ *                  CAN_RING_SHARED_BUFFER,
+ *                  CAN_RING_SHARED_SIZE(rxCount, txCount, sizeof(CAN_RING_ENTRY)),
+ *                  &returned,
+ *                  &OVERLAPPED
+ *                  );
+ *
+ * @param hDevice Handle of opened CAN device.
+ * @param IOCTL The control code for the operation
+ * @param CAN_CONTROLLER_MAP_RING_INPUT A pointer to the Message Buffers owned by the ring.
+ * @param CAN_RING_SHARED_BUFFER A pointer to the shared ring buffer.
+ * @param OVERLAPPED Pointer to Overlapped structure
+ * @param returned A pointer to a variable that receives the size of the data stored in the output buffer, in bytes.
+ *
+ * @return The request completes with STATUS_CANCELLED when the ring is released, or with an error when the ring
+ *         cannot be mapped (STATUS_DEVICE_BUSY if a ring is already mapped).
+ */
+#define IOCTL_CAN_CONTROLLER_MAP_RING \
+            CTL_CODE( \
+                FILE_DEVICE_CONTROLLER, \
+                CAN_IOCTL_ID_CONTROLLER_MAP_RING, \
+                METHOD_OUT_DIRECT, \
+                FILE_READ_DATA | FILE_WRITE_DATA)
+
+/** Doorbell flags. */
+enum _can_ring_doorbell_flags
+{
+    kCAN_RING_DoorbellTx = 0x1U,            /*!< Start sending the frames written to the TX ring. */
+    kCAN_RING_DoorbellWaitRx = 0x2U,        /*!< Complete the request when the RX ring is not empty. */
+};
+
+/** Frame ring statistics, returned by IOCTL_CAN_CONTROLLER_RING_DOORBELL. */
+typedef struct _can_ring_statistics
+{
+    UINT64  rxFrames;                       /* Frames written to the RX ring. */
+    UINT64  rxDropped;                      /* Frames dropped because the RX ring was full. */
+    UINT64  rxMbOverruns;                   /* Frames lost because a Message Buffer overran before it was read. */
+    UINT64  rxBatches;                      /* RX ring updates, rxFrames / rxBatches is the average batch size. */
+    UINT64  txFrames;                       /* Frames sent from the TX ring. */
+    UINT64  txErrors;                       /* TX ring frames that could not be written to a Message Buffer. */
+    UINT64  doorbells;                      /* Doorbell requests. */
+    UINT64  rxFifoFrames;                   /* Frames read from the Legacy Rx FIFO, including the filtered ones. */
+    UINT64  rxFifoFiltered;                 /* Legacy Rx FIFO frames rejected by the software check of the receive filter. */
+    UINT64  rxFifoOverflows;                /* Legacy Rx FIFO overflow events. */
+} can_ring_statistics_t;
+
+typedef UINT32 CAN_CONTROLLER_RING_DOORBELL_INPUT;
+typedef can_ring_statistics_t CAN_CONTROLLER_RING_DOORBELL_OUTPUT;
+
+/**
+ * IOCTL_CAN_CONTROLLER_RING_DOORBELL
+ *
+ * This function signals the driver about a shared frame ring. With kCAN_RING_DoorbellTx the driver fills the idle TX
+ * Message Buffers owned by the ring from the TX ring, the remaining frames are sent as Message Buffers complete. With
+ * kCAN_RING_DoorbellWaitRx the request is completed once the RX ring is not empty, use it to sleep instead of polling.
+ *
+ * DeviceIoControl(
+ *                  hDevice,
+ *                  IOCTL_CAN_CONTROLLER_RING_DOORBELL,
+ *                  &CAN_CONTROLLER_RING_DOORBELL_INPUT,
+ *                  sizeof(CAN_CONTROLLER_RING_DOORBELL_INPUT),
+ *                  &CAN_CONTROLLER_RING_DOORBELL_OUTPUT,
+ *                  sizeof(CAN_CONTROLLER_RING_DOORBELL_OUTPUT),
+ *                  &returned,
+ *                  &OVERLAPPED
+ *                  );
+ *
+ * @param hDevice Handle of opened CAN device.
+ * @param IOCTL The control code for the operation
+ * @param CAN_CONTROLLER_RING_DOORBELL_INPUT Combination of _can_ring_doorbell_flags.
+ * @param CAN_CONTROLLER_RING_DOORBELL_OUTPUT A pointer to the ring statistics.
+ * @param OVERLAPPED Pointer to Overlapped structure
+ * @param returned A pointer to a variable that receives the size of the data stored in the output buffer, in bytes.
+ *
+ * @return If the operation completes successfully, the return value is nonzero (TRUE).
+ */
+#define IOCTL_CAN_CONTROLLER_RING_DOORBELL \
+            CTL_CODE( \
+                FILE_DEVICE_CONTROLLER, \
+                CAN_IOCTL_ID_CONTROLLER_RING_DOORBELL, \
+                METHOD_BUFFERED, \
+                FILE_READ_DATA | FILE_WRITE_DATA)
+
+/** IOCTL_CAN_CONTROLLER_SET_RX_FIFO_FILTER input parameter structure, ruleCount rules follow the header. */
+typedef struct _can_rx_fifo_filter
+{
+    UINT32  ruleCount;                      /* Number of rules, up to CAN_FILTER_MAX_RULES, 0 rejects all frames. */
+    UINT32  maxFilterElements;              /* Filter elements the FIFO may use, multiple of 8 up to CAN_FILTER_MAX_ELEMENTS. */
+    flexcan_rx_fifo_priority_t priority;    /* The FlexCAN Legacy Rx FIFO receive priority. */
+    can_filter_rule_t rules[1];             /* Wanted IDs and ID ranges. */
+} can_rx_fifo_filter_t;
+
+/** IOCTL_CAN_CONTROLLER_SET_RX_FIFO_FILTER output parameter structure. */
+typedef struct _can_rx_fifo_filter_result
+{
+    UINT32  filterElements;                 /* Filter elements of the FIFO, 8 * (RFFN + 1). */
+    UINT32  usedElements;                   /* Filter elements built from the rules. */
+    UINT32  individualMasks;                /* Filter elements with an individual mask, the others use the FIFO global mask. */
+    BOOLEAN exact;                          /* TRUE if the hardware accepts exactly the rules, no frame needs the software check. */
+} can_rx_fifo_filter_result_t;
+
+typedef can_rx_fifo_filter_t CAN_CONTROLLER_SET_RX_FIFO_FILTER_INPUT;
+typedef can_rx_fifo_filter_result_t CAN_CONTROLLER_SET_RX_FIFO_FILTER_OUTPUT;
+
+/** Size of the IOCTL_CAN_CONTROLLER_SET_RX_FIFO_FILTER input buffer with the given number of rules. */
+#define CAN_RX_FIFO_FILTER_SIZE(ruleCount) \
+    (FIELD_OFFSET(can_rx_fifo_filter_t, rules) + ((ruleCount) * sizeof(can_filter_rule_t)))
+
+/**
+ * IOCTL_CAN_CONTROLLER_SET_RX_FIFO_FILTER
+ *
+ * This function compiles a list of wanted IDs and ID ranges into the Legacy Rx FIFO filter table and enables the FIFO.
+ * The rules are turned into the smallest set of Type A filter elements with individual masks (CanFilterCompile()),
+ * the controller must be initialized with enableIndividMask. When the rules do not fit in maxFilterElements, some
+ * elements accept more IDs than asked for, the frame ring (kCAN_RING_MapRxFifo) drops the unwanted frames hitting
+ * these elements with a software lookup. The filter table is built by the driver, no pointer is passed.
+ * Note: Legacy Rx FIFO only can receive classic CAN message.
+ *
+ * DeviceIoControl(
+ *                  hDevice,
+ *                  IOCTL_CAN_CONTROLLER_SET_RX_FIFO_FILTER,
+ *                  &CAN_CONTROLLER_SET_RX_FIFO_FILTER_INPUT,
+ *                  CAN_RX_FIFO_FILTER_SIZE(ruleCount),
+ *                  &CAN_CONTROLLER_SET_RX_FIFO_FILTER_OUTPUT,
+ *                  sizeof(CAN_CONTROLLER_SET_RX_FIFO_FILTER_OUTPUT),
+ *                  &returned,
+ *                  NULL
+ *                  );
+ *
+ * @param hDevice Handle of opened CAN device.
+ * @param IOCTL The control code for the operation
+ * @param CAN_CONTROLLER_SET_RX_FIFO_FILTER_INPUT A pointer to the filter rules.
+ * @param CAN_CONTROLLER_SET_RX_FIFO_FILTER_OUTPUT A pointer to the description of the compiled filter.
+ * @param returned A pointer to a variable that receives the size of the data stored in the output buffer, in bytes.
+ *
+ * @return If the operation completes successfully, the return value is nonzero (TRUE).
+ */
+#define IOCTL_CAN_CONTROLLER_SET_RX_FIFO_FILTER \
+            CTL_CODE( \
+                FILE_DEVICE_CONTROLLER, \
+                CAN_IOCTL_ID_CONTROLLER_SET_RX_FIFO_FILTER, \
+                METHOD_BUFFERED, \
+                FILE_READ_DATA | FILE_WRITE_DATA)
+
 /** @} */ /* end of imxcan */
\ No newline at end of file
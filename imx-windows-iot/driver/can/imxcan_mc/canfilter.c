@@ -0,0 +1,398 @@
+/*
+ * Copyright 2022 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of the copyright holder nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#if defined(_KERNEL_MODE)
+#include <ntddk.h>
+#endif
+#include <string.h>
+
+#include "canfilter.h"
+
+/* This module contains the receive ID filter compiler, it has no dependency on the driver. */
+
+#define CAN_FILTER_STD_WIDTH    (11U)
+#define CAN_FILTER_EXT_WIDTH    (29U)
+
+/* Returns the number of bits of an ID of the given format. */
+static UINT32 CanFilterWidth(UINT8 format)
+{
+    return (format == (UINT8)kCAN_FILTER_FormatExtend) ? CAN_FILTER_EXT_WIDTH : CAN_FILTER_STD_WIDTH;
+}
+
+/* Returns the mask of the leading prefix bits of an ID of the given width. */
+static UINT32 CanFilterPrefixMask(UINT32 width, UINT32 prefix)
+{
+    return (prefix == 0U) ? 0U : ((((UINT32)1U << width) - 1U) & ~(((UINT32)1U << (width - prefix)) - 1U));
+}
+
+/* Returns the number of IDs of a block. */
+static UINT64 CanFilterBlockSize(const can_filter_block_t *blockPtr)
+{
+    return (UINT64)1U << (CanFilterWidth(blockPtr->format) - blockPtr->prefix);
+}
+
+/* Hash table key of an ID, extended IDs and standard IDs do not collide. */
+static UINT32 CanFilterKey(UINT32 id, UINT8 format)
+{
+    return id | ((UINT32)format << CAN_FILTER_EXT_WIDTH);
+}
+
+static UINT32 CanFilterHash(UINT32 key)
+{
+    return (key * 0x9E3779B1U) >> (32U - 9U);   /* log2(CAN_FILTER_HASH_SIZE) */
+}
+
+/* Orders rules by format, then by first ID. */
+static BOOLEAN CanFilterRuleLess(const can_filter_rule_t *aPtr, const can_filter_rule_t *bPtr)
+{
+    return (BOOLEAN)((aPtr->format < bPtr->format) || ((aPtr->format == bPtr->format) && (aPtr->idFirst < bPtr->idFirst)));
+}
+
+/*
+ * Sorts the rules and merges the overlapping and adjacent ones into programPtr->ranges.
+ *
+ * return Number of merged ranges.
+ */
+static UINT32 CanFilterMergeRules(const can_filter_rule_t *rulesPtr, UINT32 ruleCount, can_filter_program_t *programPtr)
+{
+    can_filter_rule_t *rangesPtr = programPtr->ranges;
+    can_filter_rule_t rule;
+    UINT32 count = 0U;
+    UINT32 i;
+    UINT32 j;
+
+    /* Insertion sort, there are at most CAN_FILTER_MAX_RULES rules. */
+    for (i = 0U; i < ruleCount; i++) {
+        rule = rulesPtr[i];
+        for (j = i; (j > 0U) && CanFilterRuleLess(&rule, &rangesPtr[j - 1U]); j--) {
+            rangesPtr[j] = rangesPtr[j - 1U];
+        }
+        rangesPtr[j] = rule;
+    }
+    for (i = 0U; i < ruleCount; i++) {
+        if ((count != 0U) && (rangesPtr[count - 1U].format == rangesPtr[i].format) &&
+            ((UINT64)rangesPtr[count - 1U].idLast + 1U >= rangesPtr[i].idFirst)) {
+            if (rangesPtr[i].idLast > rangesPtr[count - 1U].idLast) {
+                rangesPtr[count - 1U].idLast = rangesPtr[i].idLast;
+            }
+        }
+        else {
+            rangesPtr[count++] = rangesPtr[i];
+        }
+    }
+    return count;
+}
+
+/*
+ * Returns the smallest block covering blocks first to last, and the number of blocks it covers starting at
+ * *coverFirstPtr. The blocks are sorted and disjoint, so the covered blocks are contiguous.
+ */
+static can_filter_block_t CanFilterCover(const can_filter_program_t *programPtr, UINT32 first, UINT32 last, UINT32 *coverFirstPtr, UINT32 *coverCountPtr)
+{
+    const can_filter_block_t *blocksPtr = programPtr->blocks;
+    UINT32 width = CanFilterWidth(blocksPtr[first].format);
+    UINT32 lastId = blocksPtr[last].value + (UINT32)(CanFilterBlockSize(&blocksPtr[last]) - 1U);
+    UINT32 diff = blocksPtr[first].value ^ lastId;
+    can_filter_block_t cover;
+    UINT32 prefix = width;
+    UINT32 mask;
+    UINT32 i;
+
+    while ((prefix != 0U) && (0U != (diff & CanFilterPrefixMask(width, prefix)))) {
+        prefix--;
+    }
+    mask = CanFilterPrefixMask(width, prefix);
+    cover.value = blocksPtr[first].value & mask;
+    cover.prefix = (UINT8)prefix;
+    cover.format = blocksPtr[first].format;
+    cover.inexact = 1U;
+    cover.reserved = 0U;
+
+    i = first;
+    while ((i > 0U) && (blocksPtr[i - 1U].format == cover.format) && ((blocksPtr[i - 1U].value & mask) == cover.value)) {
+        i--;
+    }
+    *coverFirstPtr = i;
+    i = last + 1U;
+    while ((i < programPtr->blockCount) && (blocksPtr[i].format == cover.format) && ((blocksPtr[i].value & mask) == cover.value)) {
+        i++;
+    }
+    *coverCountPtr = i - *coverFirstPtr;
+    return cover;
+}
+
+/*
+ * Replaces the pair of blocks whose cover accepts the fewest extra IDs by their cover. With wideOnly the pairs are
+ * made of consecutive blocks holding more than one ID, which reduces the number of such blocks.
+ *
+ * return FALSE if there is no pair to merge.
+ */
+static BOOLEAN CanFilterMergeCheapest(can_filter_program_t *programPtr, BOOLEAN wideOnly)
+{
+    can_filter_block_t *blocksPtr = programPtr->blocks;
+    can_filter_block_t cover;
+    can_filter_block_t bestCover;
+    UINT64 bestCost = ~(UINT64)0U;
+    UINT64 covered;
+    UINT64 cost;
+    UINT32 bestFirst = 0U;
+    UINT32 bestCount = 0U;
+    UINT32 coverFirst;
+    UINT32 coverCount;
+    UINT32 next;
+    UINT32 i;
+    UINT32 j;
+
+    for (i = 0U; i < programPtr->blockCount; i++) {
+        if (wideOnly && (blocksPtr[i].prefix == CanFilterWidth(blocksPtr[i].format))) {
+            continue;
+        }
+        next = i + 1U;
+        while (wideOnly && (next < programPtr->blockCount) && (blocksPtr[next].prefix == CanFilterWidth(blocksPtr[next].format))) {
+            next++;
+        }
+        if ((next >= programPtr->blockCount) || (blocksPtr[next].format != blocksPtr[i].format)) {
+            continue;
+        }
+        cover = CanFilterCover(programPtr, i, next, &coverFirst, &coverCount);
+        covered = 0U;
+        for (j = coverFirst; j < coverFirst + coverCount; j++) {
+            covered += CanFilterBlockSize(&blocksPtr[j]);
+        }
+        cost = CanFilterBlockSize(&cover) - covered;
+        if (cost < bestCost) {
+            bestCost = cost;
+            bestCover = cover;
+            bestFirst = coverFirst;
+            bestCount = coverCount;
+        }
+    }
+    if (bestCount == 0U) {
+        return 0;
+    }
+    /* A cover that adds no ID is exact only if every block it replaces is. */
+    bestCover.inexact = 0U;
+    if (bestCost != 0U) {
+        bestCover.inexact = 1U;
+    }
+    for (j = bestFirst; j < bestFirst + bestCount; j++) {
+        bestCover.inexact |= blocksPtr[j].inexact;
+    }
+    blocksPtr[bestFirst] = bestCover;
+    memmove(&blocksPtr[bestFirst + 1U], &blocksPtr[bestFirst + bestCount], (programPtr->blockCount - bestFirst - bestCount) * sizeof(*blocksPtr));
+    programPtr->blockCount -= bestCount - 1U;
+    return 1;
+}
+
+/* Splits a range into the aligned blocks it is made of, merging blocks when the work area is full. */
+static BOOLEAN CanFilterSplitRange(can_filter_program_t *programPtr, const can_filter_rule_t *rangePtr)
+{
+    UINT32 width = CanFilterWidth(rangePtr->format);
+    UINT64 first = rangePtr->idFirst;
+    UINT64 last = rangePtr->idLast;
+    can_filter_block_t *blockPtr;
+    UINT32 sizeLog2;
+
+    while (first <= last) {
+        /* Largest block aligned on first that ends before last. */
+        sizeLog2 = 0U;
+        while ((sizeLog2 < width) && (0U == (first & (((UINT64)1U << (sizeLog2 + 1U)) - 1U))) &&
+               (first + ((UINT64)1U << (sizeLog2 + 1U)) - 1U <= last)) {
+            sizeLog2++;
+        }
+        if ((programPtr->blockCount == CAN_FILTER_MAX_BLOCKS) && !CanFilterMergeCheapest(programPtr, 0)) {
+            return 0;
+        }
+        blockPtr = &programPtr->blocks[programPtr->blockCount++];
+        blockPtr->value = (UINT32)first;
+        blockPtr->prefix = (UINT8)(width - sizeLog2);
+        blockPtr->format = rangePtr->format;
+        blockPtr->inexact = 0U;
+        blockPtr->reserved = 0U;
+        first += (UINT64)1U << sizeLog2;
+    }
+    return 1;
+}
+
+/* Returns the Type A filter element, or the element mask, of a block. */
+static UINT32 CanFilterElement(const can_filter_block_t *blockPtr, BOOLEAN isMask)
+{
+    UINT32 width = CanFilterWidth(blockPtr->format);
+    UINT32 shift = (blockPtr->format == (UINT8)kCAN_FILTER_FormatExtend) ? 1U : 19U;
+    UINT32 ide = (UINT32)1U << 30;
+
+    if (isMask) {
+        /* The RTR bit is not checked, remote and data frames are both accepted. */
+        return ide | (CanFilterPrefixMask(width, blockPtr->prefix) << shift);
+    }
+    return ((blockPtr->format == (UINT8)kCAN_FILTER_FormatExtend) ? ide : 0U) | (blockPtr->value << shift);
+}
+
+BOOLEAN CanFilterCompile(const can_filter_rule_t *rulesPtr, UINT32 ruleCount, UINT32 maxElements, can_filter_program_t *programPtr)
+{
+    can_filter_block_t block;
+    UINT32 maxRffn;
+    UINT32 rangeCount;
+    UINT32 wideCount;
+    UINT32 elementCount;
+    UINT32 individualCount;
+    UINT32 slot;
+    UINT32 key;
+    UINT32 i;
+    UINT32 j;
+
+    if ((ruleCount > CAN_FILTER_MAX_RULES) || (maxElements == 0U) || (maxElements > CAN_FILTER_MAX_ELEMENTS) ||
+        ((maxElements % 8U) != 0U)) {
+        return 0;
+    }
+    for (i = 0U; i < ruleCount; i++) {
+        if ((rulesPtr[i].format > (UINT8)kCAN_FILTER_FormatExtend) || (rulesPtr[i].idFirst > rulesPtr[i].idLast) ||
+            (rulesPtr[i].idLast >= ((UINT32)1U << CanFilterWidth(rulesPtr[i].format)))) {
+            return 0;
+        }
+    }
+    memset(programPtr, 0, sizeof(*programPtr));
+    programPtr->globalMask = CAN_FILTER_EXACT_MASK;
+    programPtr->exact = 1;
+
+    /* Software part: single IDs in the hash table, the other ranges sorted for a binary search. */
+    rangeCount = CanFilterMergeRules(rulesPtr, ruleCount, programPtr);
+    for (i = 0U; i < rangeCount; i++) {
+        if (!CanFilterSplitRange(programPtr, &programPtr->ranges[i])) {
+            return 0;
+        }
+    }
+    for (i = 0U; i < rangeCount; i++) {
+        if (programPtr->ranges[i].idFirst == programPtr->ranges[i].idLast) {
+            key = CanFilterKey(programPtr->ranges[i].idFirst, programPtr->ranges[i].format);
+            for (slot = CanFilterHash(key); programPtr->hashTable[slot] != 0U; slot = (slot + 1U) % CAN_FILTER_HASH_SIZE) {
+            }
+            programPtr->hashTable[slot] = key + 1U;
+        }
+        else {
+            programPtr->ranges[programPtr->rangeCount++] = programPtr->ranges[i];
+        }
+    }
+
+    /*
+     * Hardware part: 8 * (maxRffn + 1) elements, the first min(8 + 2 * maxRffn, 32) ones have an individual mask.
+     * The other elements use the exact global mask, so a block of more than one ID needs an individual mask.
+     */
+    maxRffn = (maxElements / 8U) - 1U;
+    individualCount = 8U + (2U * maxRffn);
+    if (individualCount > CAN_FILTER_MAX_INDIVIDUAL_MASKS) {
+        individualCount = CAN_FILTER_MAX_INDIVIDUAL_MASKS;
+    }
+    while (programPtr->blockCount > maxElements) {
+        if (!CanFilterMergeCheapest(programPtr, 0)) {
+            return 0;
+        }
+    }
+    for (;;) {
+        wideCount = 0U;
+        for (i = 0U; i < programPtr->blockCount; i++) {
+            if (programPtr->blocks[i].prefix != CanFilterWidth(programPtr->blocks[i].format)) {
+                wideCount++;
+            }
+        }
+        if (wideCount <= individualCount) {
+            break;
+        }
+        if (!CanFilterMergeCheapest(programPtr, 1)) {
+            return 0;
+        }
+    }
+
+    /* Smallest table the blocks fit in. */
+    elementCount = (programPtr->blockCount == 0U) ? 8U : ((programPtr->blockCount + 7U) & ~7U);
+    while (8U + (2U * ((elementCount / 8U) - 1U)) < wideCount) {
+        elementCount += 8U;
+    }
+    programPtr->rffn = (elementCount / 8U) - 1U;
+    programPtr->individualMaskCount = 8U + (2U * programPtr->rffn);
+    if (programPtr->individualMaskCount > CAN_FILTER_MAX_INDIVIDUAL_MASKS) {
+        programPtr->individualMaskCount = CAN_FILTER_MAX_INDIVIDUAL_MASKS;
+    }
+
+    /* The blocks of more than one ID take the elements with an individual mask first. */
+    programPtr->filterCount = 0U;
+    for (j = 0U; j < 2U; j++) {
+        for (i = 0U; i < programPtr->blockCount; i++) {
+            block = programPtr->blocks[i];
+            if ((block.prefix != CanFilterWidth(block.format)) == (j == 0U)) {
+                if (block.inexact) {
+                    programPtr->inexactElements[programPtr->filterCount / 32U] |= 1U << (programPtr->filterCount % 32U);
+                    programPtr->exact = 0;
+                }
+                programPtr->filterTable[programPtr->filterCount] = CanFilterElement(&block, 0);
+                if (programPtr->filterCount < programPtr->individualMaskCount) {
+                    programPtr->maskTable[programPtr->filterCount] = CanFilterElement(&block, 1);
+                }
+                programPtr->filterCount++;
+            }
+        }
+    }
+    /* Unused elements repeat element 0, so they accept nothing more. */
+    for (i = programPtr->filterCount; i < elementCount; i++) {
+        programPtr->filterTable[i] = (programPtr->filterCount != 0U) ? programPtr->filterTable[0] : 0U;
+        if (i < programPtr->individualMaskCount) {
+            programPtr->maskTable[i] = (programPtr->filterCount != 0U) ? programPtr->maskTable[0] : CAN_FILTER_EXACT_MASK;
+        }
+    }
+    return 1;
+}
+
+BOOLEAN CanFilterMatch(const can_filter_program_t *programPtr, UINT32 id, UINT8 format)
+{
+    UINT32 key = CanFilterKey(id, format);
+    UINT32 slot;
+    UINT32 low = 0U;
+    UINT32 high = programPtr->rangeCount;
+    UINT32 middle;
+    can_filter_rule_t probe;
+
+    for (slot = CanFilterHash(key); programPtr->hashTable[slot] != 0U; slot = (slot + 1U) % CAN_FILTER_HASH_SIZE) {
+        if (programPtr->hashTable[slot] == key + 1U) {
+            return 1;
+        }
+    }
+    /* Last range starting at or before the ID. */
+    probe.idFirst = id;
+    probe.format = format;
+    while (low < high) {
+        middle = (low + high) / 2U;
+        if (CanFilterRuleLess(&probe, &programPtr->ranges[middle])) {
+            high = middle;
+        }
+        else {
+            low = middle + 1U;
+        }
+    }
+    return (BOOLEAN)((low != 0U) && (programPtr->ranges[low - 1U].format == format) && (programPtr->ranges[low - 1U].idLast >= id));
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2022 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of the copyright holder nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Receive ID filter compiler for the FlexCAN Legacy Rx FIFO */
+
+/**
+ * @file       driver/can/imxcan/canfilter.h
+ * @addtogroup imxcan
+ * @{
+ *
+ * CanFilterCompile() turns a list of wanted IDs and ID ranges into Type A elements of the Legacy Rx FIFO filter
+ * table. Each range is split into the aligned ID blocks it is made of, each block is one filter element with an
+ * individual mask. When the blocks do not fit in the filter table, neighbouring blocks are merged into the
+ * smallest block covering them until they fit. A merged block accepts IDs no rule asked for, the frames it lets
+ * through are checked against the rules in software (CanFilterAccept()), the frames hitting an exact element are
+ * accepted without any lookup.
+ *
+ * The compiler does not depend on the driver or on the Windows headers, so it can be built and tested on any
+ * host with a C compiler.
+ */
+
+#pragma once
+
+#if defined(_WIN32)
+#if !defined(_KERNEL_MODE)
+#include <windows.h>
+#endif
+#elif !defined(CAN_HOST_TYPES_DEFINED)
+#define CAN_HOST_TYPES_DEFINED
+#include <stdint.h>
+#include <stddef.h>
+typedef uint8_t UINT8;
+typedef uint32_t UINT32;
+typedef uint64_t UINT64;
+typedef size_t SIZE_T;
+typedef UINT8 BOOLEAN;
+#endif
+
+/* Maximum number of rules of one filter. */
+#define CAN_FILTER_MAX_RULES            (256U)
+/* Legacy Rx FIFO filter table size, the table has 8 * (RFFN + 1) elements. */
+#define CAN_FILTER_MAX_ELEMENTS         (128U)
+/* Only the first 32 filter elements can have an individual mask (RXIMR), the other ones use RXFGMASK. */
+#define CAN_FILTER_MAX_INDIVIDUAL_MASKS (32U)
+/* Work area of the compiler, ranges are split into at most this many blocks before they are merged. */
+#define CAN_FILTER_MAX_BLOCKS           (512U)
+/* Slots of the software hash table of single IDs, twice the maximum number of rules. */
+#define CAN_FILTER_HASH_SIZE            (512U)
+
+/* Filter element mask matching the whole ID and the IDE bit, the RTR bit is not checked. */
+#define CAN_FILTER_EXACT_MASK           (0x7FFFFFFEU)
+
+/** Frame format of a filter rule, same values as _flexcan_frame_format. */
+enum _can_filter_format
+{
+    kCAN_FILTER_FormatStandard = 0x0U,  /*!< 11-bit identifier. */
+    kCAN_FILTER_FormatExtend = 0x1U,    /*!< 29-bit identifier. */
+};
+
+/** Receive filter rule, accepts the frames with idFirst <= ID <= idLast. */
+typedef struct _can_filter_rule
+{
+    UINT32 idFirst;                     /* First accepted ID, not shifted (FLEXCAN_ID_STD() is not applied). */
+    UINT32 idLast;                      /* Last accepted ID, idFirst for a single ID. */
+    UINT8  format;                      /* _can_filter_format */
+    UINT8  reserved[3];
+} can_filter_rule_t;
+
+/** Aligned block of IDs, internal to the compiler. */
+typedef struct _can_filter_block
+{
+    UINT32 value;                       /* First ID of the block. */
+    UINT8  prefix;                      /* Number of leading ID bits matched, the block holds 2^(width - prefix) IDs. */
+    UINT8  format;                      /* _can_filter_format */
+    UINT8  inexact;                     /* The block holds IDs no rule asked for. */
+    UINT8  reserved;
+} can_filter_block_t;
+
+/** Compiled filter. */
+typedef struct _can_filter_program
+{
+    /* Hardware part. */
+    UINT32 rffn;                                            /* CTRL2[RFFN], the table has 8 * (rffn + 1) elements. */
+    UINT32 filterCount;                                     /* Elements built from the rules, the others repeat element 0. */
+    UINT32 individualMaskCount;                             /* Elements with an individual mask, min(8 + 2 * rffn, 32). */
+    UINT32 globalMask;                                      /* RXFGMASK, mask of the elements past individualMaskCount. */
+    UINT32 filterTable[CAN_FILTER_MAX_ELEMENTS];            /* Type A elements, 8 * (rffn + 1) are valid. */
+    UINT32 maskTable[CAN_FILTER_MAX_INDIVIDUAL_MASKS];      /* RXIMR values of the first individualMaskCount elements. */
+    UINT32 inexactElements[CAN_FILTER_MAX_ELEMENTS / 32U];  /* Bit set for the elements that need the software check. */
+    BOOLEAN exact;                                          /* TRUE if the hardware accepts exactly the rules. */
+    /* Software part, used only for the frames hitting an inexact element. */
+    UINT32 rangeCount;                                      /* Merged ranges of more than one ID, sorted. */
+    can_filter_rule_t ranges[CAN_FILTER_MAX_RULES];
+    UINT32 hashTable[CAN_FILTER_HASH_SIZE];                 /* Single IDs, CanFilterKey() + 1, 0 is an empty slot. */
+    /* Work area. */
+    UINT32 blockCount;
+    can_filter_block_t blocks[CAN_FILTER_MAX_BLOCKS];
+} can_filter_program_t;
+
+/**
+ * Compiles receive filter rules.
+ *
+ * @param rulesPtr The rules, in any order, they may overlap.
+ * @param ruleCount Number of rules, up to CAN_FILTER_MAX_RULES. Without rules filterCount is 0, all frames must be
+ *                  rejected (kFLEXCAN_RxFifoFilterTypeD).
+ * @param maxElements Filter elements the filter may use, multiple of 8 up to CAN_FILTER_MAX_ELEMENTS. Each 8
+ *                    elements occupy 2 Message Buffers.
+ * @param programPtr Receives the compiled filter.
+ *
+ * @return Nonzero (TRUE) if the rules have been compiled, zero (FALSE) if a rule or a parameter is invalid.
+ */
+BOOLEAN CanFilterCompile(const can_filter_rule_t *rulesPtr, UINT32 ruleCount, UINT32 maxElements, can_filter_program_t *programPtr);
+
+/**
+ * Checks a frame against the rules in software.
+ *
+ * @param id Frame ID, not shifted.
+ * @param format _can_filter_format
+ *
+ * @return Nonzero (TRUE) if a rule accepts the ID.
+ */
+BOOLEAN CanFilterMatch(const can_filter_program_t *programPtr, UINT32 id, UINT8 format);
+
+/**
+ * Checks a frame accepted by the hardware filter.
+ *
+ * @param idHit The filter element the frame hit (RXFIR[IDHIT], flexcan_frame_t.mfs_0.idhit).
+ * @param id Frame ID, not shifted.
+ * @param format _can_filter_format
+ *
+ * @return Nonzero (TRUE) if the frame is wanted, the software check is done only for inexact elements.
+ */
+static __inline BOOLEAN CanFilterAccept(const can_filter_program_t *programPtr, UINT32 idHit, UINT32 id, UINT8 format)
+{
+    if ((idHit < programPtr->filterCount) && (0U == (programPtr->inexactElements[idHit / 32U] & (1U << (idHit % 32U))))) {
+        return 1;
+    }
+    return CanFilterMatch(programPtr, id, format);
+}
+
+/** @} */
@@ -0,0 +1,241 @@
+/*
+ * Copyright 2022 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of the copyright holder nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Shared frame ring between the FlexCAN driver and a client application */
+
+/**
+ * @file       driver/can/imxcan/canring.h
+ * @addtogroup imxcan
+ * @{
+ *
+ * The application allocates one buffer holding a CAN_RING_SHARED header followed by the RX and the TX entries,
+ * initializes it with CanRingInitialize() and hands it to the driver with IOCTL_CAN_CONTROLLER_MAP_RING.
+ * Both rings are single producer/single consumer:
+ *   RX ring - produced by the interrupt handler, consumed by the application (CanRingRead()).
+ *   TX ring - produced by the application (CanRingWrite()), consumed by the driver when the application rings
+ *             the doorbell (IOCTL_CAN_CONTROLLER_RING_DOORBELL) and whenever a TX Message Buffer completes.
+ * Head and Tail are free-running indexes, the entry of an index is (index & (EntryCount - 1)). Each side writes only
+ * its own index, so no lock is shared between the driver and the application.
+ *
+ * RX timestamps: the timestamp of a CAN_RING_ENTRY is the KeQueryPerformanceCounter() value taken once when the
+ * interrupt handler starts a pass, all the entries published by that pass carry the same value. It places a batch on
+ * the host timeline but does not order or space the frames inside it. The capture time of each frame is the
+ * Message Buffer TIMESTAMP in the frame (frame.mfs_0.timestamp or FDframe.mfs_0.timestamp): the 16-bit FlexCAN
+ * free-running timer, counted in nominal CAN bit times and sampled at the start of the Identifier field. It wraps every
+ * 65536 bit times, so it is only meaningful relative to the other frames of the same batch.
+ *
+ * The header does not depend on the driver or on the Windows headers, so the protocol can be built and tested
+ * on any host with a C compiler.
+ */
+
+#pragma once
+
+#if defined(_WIN32)
+#if !defined(_KERNEL_MODE)
+#include <windows.h>
+#endif
+#elif !defined(CAN_HOST_TYPES_DEFINED)
+#define CAN_HOST_TYPES_DEFINED
+#include <stdint.h>
+#include <stddef.h>
+typedef uint8_t UINT8;
+typedef uint32_t UINT32;
+typedef uint64_t UINT64;
+typedef size_t SIZE_T;
+typedef UINT8 BOOLEAN;
+#endif
+#include <string.h>
+
+#define CAN_RING_MAGIC                  (0x474E5243U)   /* 'CRNG' */
+#define CAN_RING_VERSION                (1U)
+/* Maximum number of entries of one ring, the number of entries must be a power of two. */
+#define CAN_RING_MAX_ENTRIES            (4096U)
+/* Producer and consumer fields are kept in separate cache lines. */
+#define CAN_RING_CACHE_LINE             (64U)
+
+#if defined(_KERNEL_MODE)
+#define CAN_RING_BARRIER()              KeMemoryBarrier()
+#elif defined(_MSC_VER)
+#define CAN_RING_BARRIER()              MemoryBarrier()
+#else
+#define CAN_RING_BARRIER()              __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
+/** One direction of the shared ring. */
+typedef struct _CAN_RING
+{
+    /* Layout, written by CanRingInitialize() and validated by the driver. */
+    UINT32 EntryCount;                  /* Number of entries, power of two. */
+    UINT32 EntrySize;                   /* Size of one entry in bytes. */
+    UINT32 EntryOffset;                 /* Offset of the first entry from the start of CAN_RING_SHARED. */
+    UINT32 Reserved;
+    UINT8  Pad0[CAN_RING_CACHE_LINE - 4 * sizeof(UINT32)];
+    /* Written by the producer only. */
+    volatile UINT32 Head;               /* Index of the next entry to be produced. */
+    UINT32 Reserved1;
+    volatile UINT64 Dropped;            /* Entries the producer dropped because the ring was full. */
+    UINT8  Pad1[CAN_RING_CACHE_LINE - sizeof(UINT64) - 2 * sizeof(UINT32)];
+    /* Written by the consumer only. */
+    volatile UINT32 Tail;               /* Index of the next entry to be consumed. */
+    UINT8  Pad2[CAN_RING_CACHE_LINE - sizeof(UINT32)];
+} CAN_RING;
+
+/** Header of the buffer shared with the driver, the entries follow it. */
+typedef struct _CAN_RING_SHARED
+{
+    UINT32 Magic;                       /* CAN_RING_MAGIC */
+    UINT32 Version;                     /* CAN_RING_VERSION */
+    UINT32 Size;                        /* Size of the whole buffer in bytes. */
+    UINT32 Reserved;
+    UINT8  Pad0[CAN_RING_CACHE_LINE - 4 * sizeof(UINT32)];
+    CAN_RING Rx;
+    CAN_RING Tx;
+} CAN_RING_SHARED;
+
+/** Size of a shared buffer with the given number of RX and TX entries. */
+#define CAN_RING_SHARED_SIZE(rxCount, txCount, entrySize) \
+    (sizeof(CAN_RING_SHARED) + ((SIZE_T)(rxCount) + (SIZE_T)(txCount)) * (SIZE_T)(entrySize))
+
+/** Reads an index written by the other side, entries it covers may be accessed after the read. */
+static __inline UINT32 CanRingLoadIndex(const volatile UINT32 *indexPtr)
+{
+    UINT32 index = *indexPtr;
+
+    CAN_RING_BARRIER();
+    return index;
+}
+
+/** Publishes an index to the other side, after all accesses to the entries it covers. */
+static __inline void CanRingStoreIndex(volatile UINT32 *indexPtr, UINT32 index)
+{
+    CAN_RING_BARRIER();
+    *indexPtr = index;
+}
+
+/** Returns the address of the entry of a free-running index. */
+static __inline void *CanRingEntry(CAN_RING_SHARED *sharedPtr, const CAN_RING *ringPtr, UINT32 index)
+{
+    return (UINT8 *)sharedPtr + ringPtr->EntryOffset + (SIZE_T)(index & (ringPtr->EntryCount - 1U)) * ringPtr->EntrySize;
+}
+
+static __inline BOOLEAN CanRingIsPowerOfTwo(UINT32 value)
+{
+    return (BOOLEAN)((value != 0U) && ((value & (value - 1U)) == 0U));
+}
+
+/**
+ * Initializes a shared ring buffer.
+ *
+ * @param sharedPtr Buffer of at least CAN_RING_SHARED_SIZE(rxCount, txCount, entrySize) bytes.
+ * @param size Size of the buffer in bytes.
+ * @param rxCount Number of RX entries, power of two up to CAN_RING_MAX_ENTRIES.
+ * @param txCount Number of TX entries, power of two up to CAN_RING_MAX_ENTRIES.
+ * @param entrySize Size of one entry, sizeof(CAN_RING_ENTRY) for the FlexCAN driver.
+ *
+ * @return Nonzero (TRUE) if the buffer has been initialized.
+ */
+static __inline BOOLEAN CanRingInitialize(CAN_RING_SHARED *sharedPtr, SIZE_T size, UINT32 rxCount, UINT32 txCount, UINT32 entrySize)
+{
+    if (!CanRingIsPowerOfTwo(rxCount) || (rxCount > CAN_RING_MAX_ENTRIES) ||
+        !CanRingIsPowerOfTwo(txCount) || (txCount > CAN_RING_MAX_ENTRIES) ||
+        (entrySize == 0U) || ((entrySize % sizeof(UINT64)) != 0U) ||
+        (size < CAN_RING_SHARED_SIZE(rxCount, txCount, entrySize)) || (size > 0xFFFFFFFFU)) {
+        return 0;
+    }
+    memset(sharedPtr, 0, sizeof(*sharedPtr));
+    sharedPtr->Magic = CAN_RING_MAGIC;
+    sharedPtr->Version = CAN_RING_VERSION;
+    sharedPtr->Size = (UINT32)size;
+    sharedPtr->Rx.EntryCount = rxCount;
+    sharedPtr->Rx.EntrySize = entrySize;
+    sharedPtr->Rx.EntryOffset = (UINT32)sizeof(CAN_RING_SHARED);
+    sharedPtr->Tx.EntryCount = txCount;
+    sharedPtr->Tx.EntrySize = entrySize;
+    sharedPtr->Tx.EntryOffset = (UINT32)(sizeof(CAN_RING_SHARED) + (SIZE_T)rxCount * entrySize);
+    return 1;
+}
+
+/** Returns the number of entries ready to be consumed. */
+static __inline UINT32 CanRingCount(const CAN_RING *ringPtr)
+{
+    return ringPtr->Head - ringPtr->Tail;
+}
+
+/**
+ * Consumes up to maxCount entries (application side of the RX ring).
+ *
+ * The entries are copied to entriesPtr and released to the producer with a single index update.
+ *
+ * @return Number of entries copied.
+ */
+static __inline UINT32 CanRingRead(CAN_RING_SHARED *sharedPtr, CAN_RING *ringPtr, void *entriesPtr, UINT32 maxCount)
+{
+    UINT32 tail = ringPtr->Tail;
+    UINT32 count = CanRingLoadIndex(&ringPtr->Head) - tail;
+    UINT32 i;
+
+    if (count > maxCount) {
+        count = maxCount;
+    }
+    for (i = 0; i < count; i++) {
+        memcpy((UINT8 *)entriesPtr + (SIZE_T)i * ringPtr->EntrySize, CanRingEntry(sharedPtr, ringPtr, tail + i), ringPtr->EntrySize);
+    }
+    if (count != 0U) {
+        CanRingStoreIndex(&ringPtr->Tail, tail + count);
+    }
+    return count;
+}
+
+/**
+ * Produces up to count entries (application side of the TX ring).
+ *
+ * The entries are published to the consumer with a single index update. Entries that do not fit are not written,
+ * the caller retries them later.
+ *
+ * @return Number of entries written.
+ */
+static __inline UINT32 CanRingWrite(CAN_RING_SHARED *sharedPtr, CAN_RING *ringPtr, const void *entriesPtr, UINT32 count)
+{
+    UINT32 head = ringPtr->Head;
+    UINT32 space = ringPtr->EntryCount - (head - CanRingLoadIndex(&ringPtr->Tail));
+    UINT32 i;
+
+    if (count > space) {
+        count = space;
+    }
+    for (i = 0; i < count; i++) {
+        memcpy(CanRingEntry(sharedPtr, ringPtr, head + i), (const UINT8 *)entriesPtr + (SIZE_T)i * ringPtr->EntrySize, ringPtr->EntrySize);
+    }
+    if (count != 0U) {
+        CanRingStoreIndex(&ringPtr->Head, head + count);
+    }
+    return count;
+}
+
+/** @} */
@@ -4203,13 +4203,13 @@ status_t FLEXCAN_SubHandlerForDataTransfered(volatile IMXCAN_REGISTERS *base, fl
     /* For this implementation, we solve the Message with lowest MB index first. */
     for (result = 0U; result < (UINT32)FSL_FEATURE_FLEXCAN_HAS_MESSAGE_BUFFER_MAX_NUMBERn(base); result++)
     {
-        /* Get the lowest unhandled Message Buffer */
+        /* Get the lowest unhandled Message Buffer, the Message Buffers of the shared frame ring are handled by ImxCanRingIsr(). */
 #if (defined(FSL_FEATURE_FLEXCAN_HAS_EXTENDED_FLAG_REGISTER)) && (FSL_FEATURE_FLEXCAN_HAS_EXTENDED_FLAG_REGISTER > 0)
         UINT64 u64flag = 1;
-        if (0U != FLEXCAN_GetMbStatusFlags(base, u64flag << result))
+        if ((0U == (handle->ringMbMask & (u64flag << result))) && (0U != FLEXCAN_GetMbStatusFlags(base, u64flag << result)))
 #else
         UINT32 u32flag = 1;
-        if (0U != FLEXCAN_GetMbStatusFlags(base, u32flag << result))
+        if ((0U == (handle->ringMbMask & (u32flag << result))) && (0U != FLEXCAN_GetMbStatusFlags(base, u32flag << result)))
 #endif
         {
             if (FLEXCAN_IsMbIntEnabled(base, (UINT8)result))
@@ -271,6 +271,45 @@ NTSTATUS imxcanEvtDeviceAdd(
              &holdQueueConfig,
              WDF_NO_OBJECT_ATTRIBUTES,
              &deviceContextPtr->NotificationQueue);
+         if (!NT_SUCCESS(status)) {
+             KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "WdfIoQueueCreate(..) failed. (status=%!STATUS!)\n", status));
+             return status;
+         }
+     }
+     /* Queues with manual dispatching to hold the shared frame ring requests */
+     {
+         WDF_IO_QUEUE_CONFIG ringQueueConfig;
+         WDF_IO_QUEUE_CONFIG_INIT(
+             &ringQueueConfig,
+             WdfIoQueueDispatchManual);
+         ringQueueConfig.PowerManaged = WdfFalse;
+         /* Releases the ring when the map request is canceled */
+         ringQueueConfig.EvtIoCanceledOnQueue = ImxCanEvtRingCanceledOnQueue;
+
+         status = WdfIoQueueCreate(
+             wdfDevice,
+             &ringQueueConfig,
+             WDF_NO_OBJECT_ATTRIBUTES,
+             &deviceContextPtr->RingQueue);
+         if (!NT_SUCCESS(status)) {
+             KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "WdfIoQueueCreate(..) failed. (status=%!STATUS!)\n", status));
+             return status;
+         }
+
+         WDF_IO_QUEUE_CONFIG_INIT(
+             &ringQueueConfig,
+             WdfIoQueueDispatchManual);
+         ringQueueConfig.PowerManaged = WdfFalse;
+
+         status = WdfIoQueueCreate(
+             wdfDevice,
+             &ringQueueConfig,
+             WDF_NO_OBJECT_ATTRIBUTES,
+             &deviceContextPtr->RingWaitQueue);
+         if (!NT_SUCCESS(status)) {
+             KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "WdfIoQueueCreate(..) failed. (status=%!STATUS!)\n", status));
+             return status;
+         }
      }
 
     /* Publish controller device interface */
@@ -33,6 +33,7 @@
 
 
 #include "imxcanhw.h"
+#include "canring.h"
 
 #define IMXCAN_NONPAGED_SEGMENT_BEGIN \
     __pragma(code_seg(push)) \
@@ -91,6 +92,7 @@ typedef struct _flexcan_handle_t
 
     flexcan_frame_t *volatile       copymbFrame;                      /* Temporary copy of received frame */
     flexcan_fd_frame_t *volatile    copymbFDFrame;                    /* Temporary copy of received FD frame */
+    UINT64                          ringMbMask;                       /* Message Buffers owned by the shared frame ring, skipped by the transfer handler. */
 } flexcan_handle_t;
 
 typedef struct _IMXCAN_PIN_STATE {
@@ -100,6 +102,26 @@ typedef struct _IMXCAN_PIN_STATE {
     WDFWAITLOCK Lock;
 } IMXCAN_PIN_STATE;
 
+/* Shared frame ring state, the fields are protected by the interrupt lock. */
+typedef struct _IMXCAN_RING_STATE {
+    CAN_RING_SHARED     *SharedPtr;         /* System address of the mapped ring, NULL if no ring is mapped. */
+    WDFREQUEST          MapRequest;         /* Pending IOCTL_CAN_CONTROLLER_MAP_RING request that holds the ring buffer. */
+    /* Private copy of the ring layout, the shared header is writable by the application. */
+    CAN_RING_ENTRY      *RxEntries;
+    CAN_RING_ENTRY      *TxEntries;
+    UINT32              RxCount;
+    UINT32              TxCount;
+    UINT32              RxHead;             /* Producer index of the RX ring. */
+    UINT32              TxTail;             /* Consumer index of the TX ring. */
+    UINT64              RxMbMask;           /* RX Message Buffers owned by the ring. */
+    UINT64              TxMbMask;           /* TX Message Buffers owned by the ring. */
+    UINT64              TxMbBusyMask;       /* TX Message Buffers with a frame in flight. */
+    UINT64              RxFifoMask;         /* Legacy Rx FIFO flags (IFLAG1 bits 5-7) if the ring drains the FIFO, 0 otherwise. */
+    BOOLEAN             RxPublished;        /* Set by the ISR when entries were added to the RX ring, cleared by the DPC. */
+    CAN_RING_ENTRY      DropEntry;          /* Receives the frames dropped because the RX ring is full. */
+    can_ring_statistics_t Statistics;
+} IMXCAN_RING_STATE;
+
 typedef struct _DEV_CONTEXT {
     IMXCAN_REGISTERS    *RegistersPtr;
     WDFDEVICE           WdfDevice;
@@ -111,6 +133,13 @@ typedef struct _DEV_CONTEXT {
     flexcan_config_t    CANconfig;
     flexcan_handle_t    CANhandle;
     WDFQUEUE            NotificationQueue;
+    /* Shared frame ring */
+    IMXCAN_RING_STATE   Ring;
+    WDFQUEUE            RingQueue;          /* Holds the IOCTL_CAN_CONTROLLER_MAP_RING request. */
+    WDFQUEUE            RingWaitQueue;      /* Holds the IOCTL_CAN_CONTROLLER_RING_DOORBELL requests waiting for RX entries. */
+    /* Legacy Rx FIFO receive filter, the pointer is protected by the interrupt lock. */
+    can_filter_program_t *RxFifoFilterPtr;  /* Filter set by IOCTL_CAN_CONTROLLER_SET_RX_FIFO_FILTER, NULL if none. */
+    WDFMEMORY           RxFifoFilterMemory; /* Memory object holding RxFifoFilterPtr. */
 
     /* Controller and Pin State */
     BOOLEAN             IsControllerOpenForWrite;
@@ -230,10 +259,16 @@ _IRQL_requires_max_(DISPATCH_LEVEL) VOID ImxCanIoctlControllerGetTimeStamp(_In_
 _IRQL_requires_max_(DISPATCH_LEVEL) VOID ImxCanIoctlControllerAbortSend(_In_ const PDEV_CONTEXT DeviceContextPtr, _In_ WDFREQUEST WdfRequest);
 _IRQL_requires_max_(DISPATCH_LEVEL) VOID ImxCanIoctlControllerAbortReceive(_In_ const PDEV_CONTEXT DeviceContextPtr, _In_ WDFREQUEST WdfRequest);
 _IRQL_requires_max_(DISPATCH_LEVEL) VOID ImxCanIoctlControllerAbortReceiveFifo(_In_ const PDEV_CONTEXT DeviceContextPtr, _In_ WDFREQUEST WdfRequest);
+_IRQL_requires_max_(DISPATCH_LEVEL) VOID ImxCanIoctlControllerMapRing(_In_ const PDEV_CONTEXT DeviceContextPtr, _In_ WDFREQUEST WdfRequest);
+_IRQL_requires_max_(DISPATCH_LEVEL) VOID ImxCanIoctlControllerRingDoorbell(_In_ const PDEV_CONTEXT DeviceContextPtr, _In_ WDFREQUEST WdfRequest);
+_IRQL_requires_max_(DISPATCH_LEVEL) VOID ImxCanIoctlControllerSetRxFifoFilter(_In_ const PDEV_CONTEXT DeviceContextPtr, _In_ WDFREQUEST WdfRequest);
+_IRQL_requires_same_ BOOLEAN ImxCanRingIsr(_In_ PDEV_CONTEXT DeviceContextPtr);
+_IRQL_requires_max_(DISPATCH_LEVEL) VOID ImxCanRingDpc(_In_ PDEV_CONTEXT DeviceContextPtr);
 
 EVT_WDF_INTERRUPT_ISR ImxCanEvtInterruptIsr;
 EVT_WDF_INTERRUPT_DPC ImxCanEvtInterruptDpc;
 EVT_WDF_IO_QUEUE_IO_DEVICE_CONTROL ImxCanEvtIoDeviceControl;
+EVT_WDF_IO_QUEUE_IO_CANCELED_ON_QUEUE ImxCanEvtRingCanceledOnQueue;
 EVT_WDF_DEVICE_FILE_CREATE ImxCanEvtDeviceFileCreate;
 EVT_WDF_FILE_CLOSE ImxCanEvtFileClose;
 
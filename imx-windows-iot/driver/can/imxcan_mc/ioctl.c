@@ -314,6 +314,17 @@ VOID ImxCanEvtIoDeviceControl(
         case IOCTL_CAN_INVERT_NOTIFICATION:
             ImxCanIoctlControllerNotification(deviceContextPtr, WdfRequest);
             break;
+        /* Shared frame ring */
+        case IOCTL_CAN_CONTROLLER_MAP_RING:
+            ImxCanIoctlControllerMapRing(deviceContextPtr, WdfRequest);
+            break;
+        case IOCTL_CAN_CONTROLLER_RING_DOORBELL:
+            ImxCanIoctlControllerRingDoorbell(deviceContextPtr, WdfRequest);
+            break;
+        /* Receive filter */
+        case IOCTL_CAN_CONTROLLER_SET_RX_FIFO_FILTER:
+            ImxCanIoctlControllerSetRxFifoFilter(deviceContextPtr, WdfRequest);
+            break;
         /* Helper functions */
         case IOCTL_CAN_HELPER_FLEXCAN_ID_STD:
             ImxCanIoctlHelperFLEXCAN_ID_STD(deviceContextPtr, WdfRequest);
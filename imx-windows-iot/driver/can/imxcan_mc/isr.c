@@ -55,8 +55,12 @@ BOOLEAN ImxCanEvtInterruptIsr(WDFINTERRUPT WdfInterrupt, ULONG MessageID)
 #else
         UINT32 result = 0U;
 #endif
+        BOOLEAN ringHandled;
         do
         {
+            /* Move the frames of the shared frame ring Message Buffers first, in batches. */
+            ringHandled = ImxCanRingIsr(deviceContextPtr);
+
             /* Get Current FlexCAN Module Error and Status. */
             result = FLEXCAN_GetStatusFlags(registersPtr);
 
@@ -79,6 +83,10 @@ BOOLEAN ImxCanEvtInterruptIsr(WDFINTERRUPT WdfInterrupt, ULONG MessageID)
                 /* To handle Message Buffer or Legacy Rx FIFO transfer. */
                 status = FLEXCAN_SubHandlerForDataTransfered(registersPtr, &deviceContextPtr->CANhandle, &mbNum);
                 result = mbNum;
+                if ((status == kStatus_FLEXCAN_UnHandled) && ringHandled) {
+                    /* Only ring Message Buffers were flagged, there is nothing to notify. */
+                    continue;
+                }
             }
 
             /* Write item to the circular buffer FrameQueue */
@@ -144,7 +152,9 @@ VOID ImxCanEvtInterruptDpc(WDFINTERRUPT WdfInterrupt, WDFOBJECT AssociatedWdfObj
         /* CurrentRequest is currently used only by SendNonBlocking... */
         KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "SendNonBlocking() is currently active\n"));
     }
-    do {
+    ImxCanRingDpc(deviceContextPtr);
+    /* The DPC can run for ring frames only, with no item in FrameQueue. */
+    while (interruptContextPtr->FrameQueue.count != 0) {
         NTSTATUS status = WdfIoQueueRetrieveNextRequest(deviceContextPtr->NotificationQueue, &notifyRequest);
         if (NT_SUCCESS(status)) {
             status = WdfRequestRetrieveOutputBuffer(notifyRequest, sizeof(status), (PVOID*)&outputBufferPtr, NULL);
@@ -180,7 +190,7 @@ VOID ImxCanEvtInterruptDpc(WDFINTERRUPT WdfInterrupt, WDFOBJECT AssociatedWdfObj
             /* KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "WdfIoQueueRetrieveNextRequest(..) failed. (status = %!STATUS!)\n", status)); */
             break;
         }
-    } while (interruptContextPtr->FrameQueue.count != 0);
+    }
     deviceContextPtr->CurrentRequest = NULL;
 }
 
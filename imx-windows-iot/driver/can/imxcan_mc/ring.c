@@ -0,0 +1,713 @@
+/*
+ * Copyright 2022 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of the copyright holder nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "precomp.h"
+#pragma hdrstop
+
+#include "imxcanhw.h"
+#include "imxcan.h"
+
+/*
+ * This module contains the shared frame ring, see canring.h for the protocol.
+ *
+ * The ring is attached to the controller while the IOCTL_CAN_CONTROLLER_MAP_RING request is pending in RingQueue.
+ * The interrupt handler moves the frames of all flagged ring Message Buffers to the RX ring and publishes them with
+ * a single head update, and refills the completed ring TX Message Buffers from the TX ring. The ring state is
+ * protected by the interrupt lock.
+ *
+ * The ring can also own the Legacy Rx FIFO. The FIFO is filtered by the table IOCTL_CAN_CONTROLLER_SET_RX_FIFO_FILTER
+ * compiles from the wanted IDs (canfilter.h), the frames hitting an inexact element are checked in software when they
+ * are moved to the RX ring.
+ */
+
+/* Number of frames the Legacy Rx FIFO holds. */
+#define IMXCAN_RING_RX_FIFO_DEPTH       (6U)
+/* Legacy Rx FIFO flags owned by the ring. */
+#define IMXCAN_RING_RX_FIFO_FLAGS       ((UINT64)kFLEXCAN_RxFifoFrameAvlFlag | (UINT64)kFLEXCAN_RxFifoWarningFlag | \
+                                         (UINT64)kFLEXCAN_RxFifoOverflowFlag)
+
+IMXCAN_NONPAGED_SEGMENT_BEGIN;
+
+/* Returns the mask of count Message Buffers starting at first. */
+static UINT64 ImxCanRingMbMask(UINT8 first, UINT8 count)
+{
+    UINT64 u64mask = (count >= 64U) ? ~(UINT64)0U : (((UINT64)1U << count) - 1U);
+
+    return (count == 0U) ? 0U : (u64mask << first);
+}
+
+/* Returns the index of the lowest Message Buffer of a non-zero mask. */
+static UINT8 ImxCanRingLowestMb(UINT64 mask)
+{
+    ULONG index;
+
+    BitScanForward64(&index, mask);
+    return (UINT8)index;
+}
+
+/* Returns the number of Message Buffers of a mask. */
+static UINT32 ImxCanRingMbCount(UINT64 mask)
+{
+    UINT32 count = 0U;
+
+    for (; mask != 0U; mask &= mask - 1U) {
+        count++;
+    }
+    return count;
+}
+
+/* Returns the mask of the Message Buffers occupied by the Legacy Rx FIFO and its filter table, 0 if it is disabled. */
+static UINT64 ImxCanRingRxFifoMbMask(_In_ volatile IMXCAN_REGISTERS *RegistersPtr)
+{
+    UINT32 rffn;
+
+    if (0U == (RegistersPtr->MCR & CAN_MCR_RFEN_MASK)) {
+        return 0U;
+    }
+    rffn = (RegistersPtr->CTRL2 & CAN_CTRL2_RFFN_MASK) >> CAN_CTRL2_RFFN_SHIFT;
+    return ImxCanRingMbMask(0U, (UINT8)(6U + ((rffn + 1U) * 2U)));
+}
+
+/*
+ * Moves the frames of the Legacy Rx FIFO to the RX ring. Called by the ISR with the interrupt lock held.
+ *
+ * The FIFO is drained in one burst, the frames received while it is read are taken in the same pass, so the FIFO
+ * interrupt is raised once per burst instead of once per frame.
+ *
+ * return The RX ring producer index after the burst.
+ */
+static UINT32 ImxCanRingDrainRxFifo(_In_ PDEV_CONTEXT DeviceContextPtr, _In_ UINT64 PendingMask, _In_ UINT32 RxHead, _In_ UINT32 RxTail, _In_ UINT64 Timestamp)
+{
+    IMXCAN_RING_STATE *ringPtr = &DeviceContextPtr->Ring;
+    volatile IMXCAN_REGISTERS *registersPtr = DeviceContextPtr->RegistersPtr;
+    const can_filter_program_t *filterPtr = DeviceContextPtr->RxFifoFilterPtr;
+    CAN_RING_ENTRY *entryPtr;
+    status_t entryStatus = kStatus_FLEXCAN_RxFifoIdle;
+    UINT32 frameIdx;
+    UINT32 id;
+
+    if (0U != (PendingMask & (UINT64)kFLEXCAN_RxFifoOverflowFlag)) {
+        /* Frames were lost, the next entry reports it. */
+        ringPtr->Statistics.rxFifoOverflows++;
+        entryStatus = kStatus_FLEXCAN_RxFifoOverflow;
+    }
+    FLEXCAN_ClearMbStatusFlags(registersPtr, PendingMask & ((UINT64)kFLEXCAN_RxFifoOverflowFlag | (UINT64)kFLEXCAN_RxFifoWarningFlag));
+
+    for (frameIdx = 0U; frameIdx < IMXCAN_RING_RX_FIFO_DEPTH; frameIdx++) {
+        if (0U == FLEXCAN_GetMbStatusFlags(registersPtr, (UINT64)kFLEXCAN_RxFifoFrameAvlFlag)) {
+            break;
+        }
+        /* A full ring still has to be drained from the FIFO, otherwise the interrupt fires again. */
+        if ((RxHead - RxTail) < ringPtr->RxCount) {
+            entryPtr = &ringPtr->RxEntries[RxHead & (ringPtr->RxCount - 1U)];
+        }
+        else {
+            entryPtr = &ringPtr->DropEntry;
+        }
+        (void)FLEXCAN_ReadRxFifo(registersPtr, &entryPtr->u.frame);
+        /* Clearing the flag moves the next frame to the FIFO output. */
+        FLEXCAN_ClearMbStatusFlags(registersPtr, (UINT64)kFLEXCAN_RxFifoFrameAvlFlag);
+        ringPtr->Statistics.rxFifoFrames++;
+        if (filterPtr != NULL) {
+            id = entryPtr->u.frame.mfs_1.id;
+            if (entryPtr->u.frame.mfs_0.format == (UINT32)kFLEXCAN_FrameFormatStandard) {
+                id >>= CAN_ID_STD_SHIFT;
+            }
+            if (!CanFilterAccept(filterPtr, entryPtr->u.frame.mfs_0.idhit, id, (UINT8)entryPtr->u.frame.mfs_0.format)) {
+                ringPtr->Statistics.rxFifoFiltered++;
+                continue;
+            }
+        }
+        if (entryPtr == &ringPtr->DropEntry) {
+            ringPtr->Statistics.rxDropped++;
+            ringPtr->SharedPtr->Rx.Dropped = ringPtr->Statistics.rxDropped;
+            continue;
+        }
+        entryPtr->timestamp = Timestamp;
+        entryPtr->status = entryStatus;
+        entryPtr->mbIdx = 0U;
+        entryPtr->flags = 0U;
+        entryPtr->reserved = 0U;
+        entryStatus = kStatus_FLEXCAN_RxFifoIdle;
+        RxHead++;
+    }
+    return RxHead;
+}
+
+/*
+ * Sends the frames of the TX ring with the idle ring TX Message Buffers. Called with the interrupt lock held.
+ *
+ * The frames are copied out of the shared buffer before they are written to the Message Buffer, the application
+ * can modify the buffer at any time.
+ */
+static VOID ImxCanRingFillTxMbs(_In_ PDEV_CONTEXT DeviceContextPtr)
+{
+    IMXCAN_RING_STATE *ringPtr = &DeviceContextPtr->Ring;
+    volatile IMXCAN_REGISTERS *registersPtr = DeviceContextPtr->RegistersPtr;
+    UINT64 idleMask = ringPtr->TxMbMask & ~ringPtr->TxMbBusyMask;
+    UINT32 tail = ringPtr->TxTail;
+    UINT32 head;
+    CAN_RING_ENTRY *entryPtr;
+    UINT64 u64mask;
+    status_t status;
+    UINT8 mbIdx;
+
+    if (idleMask == 0U) {
+        return;
+    }
+    head = CanRingLoadIndex(&ringPtr->SharedPtr->Tx.Head);
+    if ((head - tail) > ringPtr->TxCount) {
+        /* The head is not in the range the application may produce, do not send anything. */
+        ringPtr->Statistics.txErrors++;
+        return;
+    }
+    while ((idleMask != 0U) && (tail != head)) {
+        mbIdx = ImxCanRingLowestMb(idleMask);
+        u64mask = (UINT64)1U << mbIdx;
+        idleMask &= ~u64mask;
+        entryPtr = &ringPtr->TxEntries[tail & (ringPtr->TxCount - 1U)];
+#if (defined(FSL_FEATURE_FLEXCAN_HAS_FLEXIBLE_DATA_RATE) && FSL_FEATURE_FLEXCAN_HAS_FLEXIBLE_DATA_RATE)
+        if (0U != (registersPtr->MCR & CAN_MCR_FDEN_MASK)) {
+            flexcan_fd_frame_t fdFrame = entryPtr->u.FDframe;
+            status = FLEXCAN_WriteFDTxMb(registersPtr, mbIdx, &fdFrame);
+        }
+        else
+#endif
+        {
+            flexcan_frame_t frame = entryPtr->u.frame;
+            status = FLEXCAN_WriteTxMb(registersPtr, mbIdx, &frame);
+        }
+        tail++;
+        if (status == kStatus_Success) {
+            ringPtr->TxMbBusyMask |= u64mask;
+        }
+        else {
+            ringPtr->Statistics.txErrors++;
+        }
+    }
+    if (tail != ringPtr->TxTail) {
+        ringPtr->TxTail = tail;
+        CanRingStoreIndex(&ringPtr->SharedPtr->Tx.Tail, tail);
+    }
+}
+
+/* Completes the doorbell requests waiting for RX entries. */
+static VOID ImxCanRingCompleteWaiters(_In_ PDEV_CONTEXT DeviceContextPtr, _In_ NTSTATUS CompletionStatus)
+{
+    CAN_CONTROLLER_RING_DOORBELL_OUTPUT statistics;
+    CAN_CONTROLLER_RING_DOORBELL_OUTPUT *outputBufferPtr;
+    WDFREQUEST waitRequest;
+    NTSTATUS status;
+
+    WdfInterruptAcquireLock(DeviceContextPtr->WdfInterrupt);
+    statistics = DeviceContextPtr->Ring.Statistics;
+    WdfInterruptReleaseLock(DeviceContextPtr->WdfInterrupt);
+
+    while (NT_SUCCESS(WdfIoQueueRetrieveNextRequest(DeviceContextPtr->RingWaitQueue, &waitRequest))) {
+        if (!NT_SUCCESS(CompletionStatus)) {
+            WdfRequestComplete(waitRequest, CompletionStatus);
+            continue;
+        }
+        status = WdfRequestRetrieveOutputBuffer(waitRequest, sizeof(*outputBufferPtr), (PVOID*)(&outputBufferPtr), NULL);
+        if (!NT_SUCCESS(status)) {
+            WdfRequestComplete(waitRequest, status);
+            continue;
+        }
+        RtlCopyMemory(outputBufferPtr, &statistics, sizeof(*outputBufferPtr));
+        WdfRequestCompleteWithInformation(waitRequest, STATUS_SUCCESS, sizeof(*outputBufferPtr));
+    }
+}
+
+/* Detaches the ring from the controller. Called with the interrupt lock held. */
+static VOID ImxCanRingDetach(_In_ PDEV_CONTEXT DeviceContextPtr)
+{
+    IMXCAN_RING_STATE *ringPtr = &DeviceContextPtr->Ring;
+    volatile IMXCAN_REGISTERS *registersPtr = DeviceContextPtr->RegistersPtr;
+    UINT64 busyMask = ringPtr->TxMbBusyMask;
+    UINT8 mbIdx;
+
+    FLEXCAN_DisableMbInterrupts(registersPtr, ringPtr->RxMbMask | ringPtr->TxMbMask | ringPtr->RxFifoMask);
+    /* Abort the frames still in flight, the TX Message Buffers are left inactive. */
+    while (busyMask != 0U) {
+        mbIdx = ImxCanRingLowestMb(busyMask);
+        busyMask &= ~((UINT64)1U << mbIdx);
+#if (defined(FSL_FEATURE_FLEXCAN_HAS_FLEXIBLE_DATA_RATE) && FSL_FEATURE_FLEXCAN_HAS_FLEXIBLE_DATA_RATE)
+        if (0U != (registersPtr->MCR & CAN_MCR_FDEN_MASK)) {
+            FLEXCAN_TransferFDAbortSend(registersPtr, &DeviceContextPtr->CANhandle, mbIdx);
+        }
+        else
+#endif
+        {
+            FLEXCAN_TransferAbortSend(registersPtr, &DeviceContextPtr->CANhandle, mbIdx);
+        }
+    }
+    FLEXCAN_ClearMbStatusFlags(registersPtr, ringPtr->TxMbMask);
+    DeviceContextPtr->CANhandle.ringMbMask = 0U;
+    ringPtr->SharedPtr = NULL;
+    ringPtr->MapRequest = NULL;
+    ringPtr->RxMbMask = 0U;
+    ringPtr->TxMbMask = 0U;
+    ringPtr->TxMbBusyMask = 0U;
+    ringPtr->RxFifoMask = 0U;
+    ringPtr->RxPublished = FALSE;
+}
+
+/*
+ * Moves the frames of the flagged ring Message Buffers to the RX ring and refills the completed ring TX Message
+ * Buffers. Called by the ISR with the interrupt lock held.
+ *
+ * return TRUE if a ring Message Buffer has been handled.
+ */
+_Use_decl_annotations_
+BOOLEAN ImxCanRingIsr(PDEV_CONTEXT DeviceContextPtr)
+{
+    IMXCAN_RING_STATE *ringPtr = &DeviceContextPtr->Ring;
+    volatile IMXCAN_REGISTERS *registersPtr = DeviceContextPtr->RegistersPtr;
+    CAN_RING_ENTRY *entryPtr;
+    UINT64 pendingMask;
+    UINT64 rxMask;
+    UINT64 txMask;
+    UINT64 u64mask;
+    UINT64 timestamp;
+    UINT32 rxHead;
+    UINT32 rxTail;
+    status_t status;
+    UINT8 flags;
+    UINT8 mbIdx;
+
+    if (ringPtr->SharedPtr == NULL) {
+        return FALSE;
+    }
+    pendingMask = FLEXCAN_GetMbStatusFlags(registersPtr, ringPtr->RxMbMask | ringPtr->TxMbMask | ringPtr->RxFifoMask);
+    if (pendingMask == 0U) {
+        return FALSE;
+    }
+
+    /*
+     * Receive: read every flagged RX Message Buffer and the whole Legacy Rx FIFO, the entries are published with
+     * a single head update.
+     */
+    rxMask = pendingMask & ringPtr->RxMbMask;
+    if ((rxMask != 0U) || (0U != (pendingMask & ringPtr->RxFifoMask))) {
+        /* One host time for the whole batch, the frames keep their own FlexCAN TIMESTAMP (see canring.h). */
+        timestamp = (UINT64)KeQueryPerformanceCounter(NULL).QuadPart;
+        rxHead = ringPtr->RxHead;
+        rxTail = CanRingLoadIndex(&ringPtr->SharedPtr->Rx.Tail);
+        while (rxMask != 0U) {
+            mbIdx = ImxCanRingLowestMb(rxMask);
+            u64mask = (UINT64)1U << mbIdx;
+            rxMask &= ~u64mask;
+            /* A full ring still has to be drained from the Message Buffer, otherwise the interrupt fires again. */
+            if ((rxHead - rxTail) < ringPtr->RxCount) {
+                entryPtr = &ringPtr->RxEntries[rxHead & (ringPtr->RxCount - 1U)];
+            }
+            else {
+                entryPtr = &ringPtr->DropEntry;
+            }
+            flags = 0U;
+#if (defined(FSL_FEATURE_FLEXCAN_HAS_FLEXIBLE_DATA_RATE) && FSL_FEATURE_FLEXCAN_HAS_FLEXIBLE_DATA_RATE)
+            if (0U != (registersPtr->MCR & CAN_MCR_FDEN_MASK)) {
+                status = FLEXCAN_ReadFDRxMb(registersPtr, mbIdx, &entryPtr->u.FDframe);
+                flags = (UINT8)kCAN_RING_EntryFD;
+            }
+            else
+#endif
+            {
+                status = FLEXCAN_ReadRxMb(registersPtr, mbIdx, &entryPtr->u.frame);
+            }
+            FLEXCAN_ClearMbStatusFlags(registersPtr, u64mask);
+            if (status == kStatus_Fail) {
+                continue;
+            }
+            if (status == kStatus_FLEXCAN_RxOverflow) {
+                ringPtr->Statistics.rxMbOverruns++;
+            }
+            if (entryPtr == &ringPtr->DropEntry) {
+                ringPtr->Statistics.rxDropped++;
+                ringPtr->SharedPtr->Rx.Dropped = ringPtr->Statistics.rxDropped;
+                continue;
+            }
+            entryPtr->timestamp = timestamp;
+            entryPtr->status = (status == kStatus_Success) ? kStatus_FLEXCAN_RxIdle : status;
+            entryPtr->mbIdx = mbIdx;
+            entryPtr->flags = flags;
+            entryPtr->reserved = 0U;
+            rxHead++;
+        }
+        if (0U != (pendingMask & ringPtr->RxFifoMask)) {
+            rxHead = ImxCanRingDrainRxFifo(DeviceContextPtr, pendingMask, rxHead, rxTail, timestamp);
+        }
+        if (rxHead != ringPtr->RxHead) {
+            ringPtr->Statistics.rxFrames += rxHead - ringPtr->RxHead;
+            ringPtr->Statistics.rxBatches++;
+            ringPtr->RxHead = rxHead;
+            CanRingStoreIndex(&ringPtr->SharedPtr->Rx.Head, rxHead);
+            ringPtr->RxPublished = TRUE;
+        }
+    }
+
+    /* Send: release the completed TX Message Buffers and refill them from the TX ring. */
+    txMask = pendingMask & ringPtr->TxMbMask;
+    if (txMask != 0U) {
+        FLEXCAN_ClearMbStatusFlags(registersPtr, txMask);
+        ringPtr->Statistics.txFrames += ImxCanRingMbCount(txMask & ringPtr->TxMbBusyMask);
+        ringPtr->TxMbBusyMask &= ~txMask;
+        ImxCanRingFillTxMbs(DeviceContextPtr);
+    }
+    return TRUE;
+}
+
+/*
+ * Completes the doorbell requests waiting for RX entries once the ISR has published new entries.
+ * Called by the DPC.
+ */
+_Use_decl_annotations_
+VOID ImxCanRingDpc(PDEV_CONTEXT DeviceContextPtr)
+{
+    BOOLEAN published;
+
+    WdfInterruptAcquireLock(DeviceContextPtr->WdfInterrupt);
+    published = DeviceContextPtr->Ring.RxPublished;
+    DeviceContextPtr->Ring.RxPublished = FALSE;
+    WdfInterruptReleaseLock(DeviceContextPtr->WdfInterrupt);
+
+    if (published) {
+        ImxCanRingCompleteWaiters(DeviceContextPtr, STATUS_SUCCESS);
+    }
+}
+
+/* Releases the ring when the IOCTL_CAN_CONTROLLER_MAP_RING request is canceled, or the handle is closed. */
+_Use_decl_annotations_
+VOID ImxCanEvtRingCanceledOnQueue(WDFQUEUE WdfQueue, WDFREQUEST WdfRequest)
+{
+    PDEV_CONTEXT deviceContextPtr = ImxCanGetDeviceContext(WdfIoQueueGetDevice(WdfQueue));
+
+    WdfInterruptAcquireLock(deviceContextPtr->WdfInterrupt);
+    if (deviceContextPtr->Ring.MapRequest == WdfRequest) {
+        ImxCanRingDetach(deviceContextPtr);
+    }
+    WdfInterruptReleaseLock(deviceContextPtr->WdfInterrupt);
+
+    KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "Frame ring released.\n"));
+    WdfRequestComplete(WdfRequest, STATUS_CANCELLED);
+    ImxCanRingCompleteWaiters(deviceContextPtr, STATUS_CANCELLED);
+}
+
+/* IOCTL_CAN_CONTROLLER_MAP_RING */
+_Use_decl_annotations_
+VOID ImxCanIoctlControllerMapRing(const PDEV_CONTEXT DeviceContextPtr, WDFREQUEST WdfRequest)
+{
+    CAN_CONTROLLER_MAP_RING_INPUT *inputBufferPtr;
+    CAN_RING_SHARED *sharedPtr;
+    IMXCAN_RING_STATE *ringPtr = &DeviceContextPtr->Ring;
+    volatile IMXCAN_REGISTERS *registersPtr = DeviceContextPtr->RegistersPtr;
+    size_t length;
+    UINT32 rxCount;
+    UINT32 txCount;
+    UINT64 rxMbMask;
+    UINT64 txMbMask;
+    UINT64 rxFifoMask = 0U;
+    UINT8 mbIdx;
+    BOOLEAN isMapped;
+
+    NTSTATUS status = WdfRequestRetrieveInputBuffer(WdfRequest, sizeof(*inputBufferPtr), (PVOID*)(&inputBufferPtr), NULL);
+    if (!NT_SUCCESS(status)) {
+        KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "WdfRequestRetrieveInputBuffer(..) failed. (status = %!STATUS!)\n", status));
+        WdfRequestComplete(WdfRequest, status);
+        return;
+    }
+    /* The output buffer is the ring, its pages stay locked and mapped until the request is completed. */
+    status = WdfRequestRetrieveOutputBuffer(WdfRequest, sizeof(*sharedPtr), (PVOID*)(&sharedPtr), &length);
+    if (!NT_SUCCESS(status)) {
+        KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "WdfRequestRetrieveOutputBuffer(..) failed. (status = %!STATUS!)\n", status));
+        WdfRequestComplete(WdfRequest, status);
+        return;
+    }
+    if (0U != ((ULONG_PTR)sharedPtr & (sizeof(UINT64) - 1U))) {
+        WdfRequestComplete(WdfRequest, STATUS_DATATYPE_MISALIGNMENT);
+        return;
+    }
+
+    /* Validate the layout, each field is read once. */
+    rxCount = sharedPtr->Rx.EntryCount;
+    txCount = sharedPtr->Tx.EntryCount;
+    if ((sharedPtr->Magic != CAN_RING_MAGIC) || (sharedPtr->Version != CAN_RING_VERSION) ||
+        !CanRingIsPowerOfTwo(rxCount) || (rxCount > CAN_RING_MAX_ENTRIES) ||
+        !CanRingIsPowerOfTwo(txCount) || (txCount > CAN_RING_MAX_ENTRIES) ||
+        (sharedPtr->Rx.EntrySize != sizeof(CAN_RING_ENTRY)) || (sharedPtr->Tx.EntrySize != sizeof(CAN_RING_ENTRY)) ||
+        (sharedPtr->Rx.EntryOffset != sizeof(CAN_RING_SHARED)) ||
+        (sharedPtr->Tx.EntryOffset != sizeof(CAN_RING_SHARED) + (rxCount * sizeof(CAN_RING_ENTRY))) ||
+        (CAN_RING_SHARED_SIZE(rxCount, txCount, sizeof(CAN_RING_ENTRY)) > length)) {
+        KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "Invalid frame ring layout.\n"));
+        WdfRequestComplete(WdfRequest, STATUS_INVALID_PARAMETER);
+        return;
+    }
+
+    /* Validate the Message Buffers, they must not be in use by the transfer IOCTLs. */
+    if (((UINT32)inputBufferPtr->rxMbFirst + inputBufferPtr->rxMbCount > (UINT32)FSL_FEATURE_FLEXCAN_HAS_MESSAGE_BUFFER_MAX_NUMBERn(registersPtr)) ||
+        ((UINT32)inputBufferPtr->txMbFirst + inputBufferPtr->txMbCount > (UINT32)FSL_FEATURE_FLEXCAN_HAS_MESSAGE_BUFFER_MAX_NUMBERn(registersPtr))) {
+        WdfRequestComplete(WdfRequest, STATUS_INVALID_PARAMETER);
+        return;
+    }
+    rxMbMask = ImxCanRingMbMask(inputBufferPtr->rxMbFirst, inputBufferPtr->rxMbCount);
+    txMbMask = ImxCanRingMbMask(inputBufferPtr->txMbFirst, inputBufferPtr->txMbCount);
+    if (0U != (inputBufferPtr->flags & (UINT32)kCAN_RING_MapRxFifo)) {
+        /* The FIFO must be enabled and must not be in use by IOCTL_CAN_CONTROLLER_RECEIVE_FIFO_NON_BLOCKING. */
+        if ((0U == ImxCanRingRxFifoMbMask(registersPtr)) || (0U != DeviceContextPtr->CANhandle.rxFifoState)) {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "Legacy Rx FIFO is disabled or in use.\n"));
+            WdfRequestComplete(WdfRequest, STATUS_INVALID_DEVICE_STATE);
+            return;
+        }
+        rxFifoMask = IMXCAN_RING_RX_FIFO_FLAGS;
+    }
+    if (((rxMbMask | txMbMask | rxFifoMask) == 0U) || ((rxMbMask & txMbMask) != 0U) ||
+        (0U != ((rxMbMask | txMbMask) & ImxCanRingRxFifoMbMask(registersPtr)))) {
+        WdfRequestComplete(WdfRequest, STATUS_INVALID_PARAMETER);
+        return;
+    }
+    for (mbIdx = 0U; mbIdx < (UINT8)FSL_FEATURE_FLEXCAN_HAS_MESSAGE_BUFFER_MAX_NUMBERn(registersPtr); mbIdx++) {
+        /* 0U == kFLEXCAN_StateIdle */
+        if ((0U != ((rxMbMask | txMbMask) & ((UINT64)1U << mbIdx))) && (0U != DeviceContextPtr->CANhandle.mbState[mbIdx])) {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "Message Buffer %u is in use.\n", mbIdx));
+            WdfRequestComplete(WdfRequest, STATUS_DEVICE_BUSY);
+            return;
+        }
+    }
+
+    /* Attach the ring. */
+    WdfInterruptAcquireLock(DeviceContextPtr->WdfInterrupt);
+    isMapped = (ringPtr->SharedPtr != NULL);
+    if (!isMapped) {
+        RtlZeroMemory(&ringPtr->Statistics, sizeof(ringPtr->Statistics));
+        ringPtr->RxEntries = (CAN_RING_ENTRY *)((UINT8 *)sharedPtr + sizeof(CAN_RING_SHARED));
+        ringPtr->TxEntries = ringPtr->RxEntries + rxCount;
+        ringPtr->RxCount = rxCount;
+        ringPtr->TxCount = txCount;
+        /* Start with an empty RX ring, and send what the application has produced so far. */
+        ringPtr->RxHead = CanRingLoadIndex(&sharedPtr->Rx.Tail);
+        sharedPtr->Rx.Head = ringPtr->RxHead;
+        sharedPtr->Rx.Dropped = 0U;
+        ringPtr->TxTail = CanRingLoadIndex(&sharedPtr->Tx.Tail);
+        ringPtr->RxMbMask = rxMbMask;
+        ringPtr->TxMbMask = txMbMask;
+        ringPtr->TxMbBusyMask = 0U;
+        ringPtr->RxFifoMask = rxFifoMask;
+        ringPtr->RxPublished = FALSE;
+        ringPtr->MapRequest = WdfRequest;
+        ringPtr->SharedPtr = sharedPtr;
+        DeviceContextPtr->CANhandle.ringMbMask = rxMbMask | txMbMask | rxFifoMask;
+        FLEXCAN_ClearMbStatusFlags(registersPtr, txMbMask);
+        /* The FIFO warning flag is polled with the frame available flag, it does not need its own interrupt. */
+        FLEXCAN_EnableMbInterrupts(registersPtr, rxMbMask | txMbMask | (rxFifoMask & ~(UINT64)kFLEXCAN_RxFifoWarningFlag));
+    }
+    WdfInterruptReleaseLock(DeviceContextPtr->WdfInterrupt);
+    if (isMapped) {
+        KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "A frame ring is already mapped.\n"));
+        WdfRequestComplete(WdfRequest, STATUS_DEVICE_BUSY);
+        return;
+    }
+
+    /* The request holds the ring until it is canceled. */
+    status = WdfRequestForwardToIoQueue(WdfRequest, DeviceContextPtr->RingQueue);
+    if (!NT_SUCCESS(status)) {
+        KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "WdfRequestForwardToIoQueue(..) failed. (status = %!STATUS!)\n", status));
+        WdfInterruptAcquireLock(DeviceContextPtr->WdfInterrupt);
+        ImxCanRingDetach(DeviceContextPtr);
+        WdfInterruptReleaseLock(DeviceContextPtr->WdfInterrupt);
+        WdfRequestComplete(WdfRequest, status);
+        return;
+    }
+    KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "Frame ring mapped. (rxCount = %u, txCount = %u)\n", rxCount, txCount));
+}
+
+/* IOCTL_CAN_CONTROLLER_RING_DOORBELL */
+_Use_decl_annotations_
+VOID ImxCanIoctlControllerRingDoorbell(const PDEV_CONTEXT DeviceContextPtr, WDFREQUEST WdfRequest)
+{
+    CAN_CONTROLLER_RING_DOORBELL_INPUT *inputBufferPtr;
+    CAN_CONTROLLER_RING_DOORBELL_OUTPUT *outputBufferPtr;
+    IMXCAN_RING_STATE *ringPtr = &DeviceContextPtr->Ring;
+    UINT32 flags;
+    BOOLEAN isMapped;
+    BOOLEAN rxPending = FALSE;
+
+    NTSTATUS status = WdfRequestRetrieveInputBuffer(WdfRequest, sizeof(*inputBufferPtr), (PVOID*)(&inputBufferPtr), NULL);
+    if (!NT_SUCCESS(status)) {
+        KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "WdfRequestRetrieveInputBuffer(..) failed. (status = %!STATUS!)\n", status));
+        WdfRequestComplete(WdfRequest, status);
+        return;
+    }
+    status = WdfRequestRetrieveOutputBuffer(WdfRequest, sizeof(*outputBufferPtr), (PVOID*)(&outputBufferPtr), NULL);
+    if (!NT_SUCCESS(status)) {
+        KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "WdfRequestRetrieveOutputBuffer(..) failed. (status = %!STATUS!)\n", status));
+        WdfRequestComplete(WdfRequest, status);
+        return;
+    }
+    flags = *inputBufferPtr;
+
+    WdfInterruptAcquireLock(DeviceContextPtr->WdfInterrupt);
+    isMapped = (ringPtr->SharedPtr != NULL);
+    if (isMapped) {
+        ringPtr->Statistics.doorbells++;
+        if (0U != (flags & (UINT32)kCAN_RING_DoorbellTx)) {
+            ImxCanRingFillTxMbs(DeviceContextPtr);
+        }
+        rxPending = (CanRingLoadIndex(&ringPtr->SharedPtr->Rx.Tail) != ringPtr->RxHead);
+        RtlCopyMemory(outputBufferPtr, &ringPtr->Statistics, sizeof(*outputBufferPtr));
+    }
+    WdfInterruptReleaseLock(DeviceContextPtr->WdfInterrupt);
+    if (!isMapped) {
+        WdfRequestComplete(WdfRequest, STATUS_INVALID_DEVICE_STATE);
+        return;
+    }
+    if ((0U == (flags & (UINT32)kCAN_RING_DoorbellWaitRx)) || rxPending) {
+        WdfRequestCompleteWithInformation(WdfRequest, STATUS_SUCCESS, sizeof(*outputBufferPtr));
+        return;
+    }
+
+    status = WdfRequestForwardToIoQueue(WdfRequest, DeviceContextPtr->RingWaitQueue);
+    if (!NT_SUCCESS(status)) {
+        KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "WdfRequestForwardToIoQueue(..) failed. (status = %!STATUS!)\n", status));
+        WdfRequestComplete(WdfRequest, status);
+        return;
+    }
+    /* Entries published before the request was queued have not completed it, check again. */
+    WdfInterruptAcquireLock(DeviceContextPtr->WdfInterrupt);
+    rxPending = (ringPtr->SharedPtr == NULL) || (CanRingLoadIndex(&ringPtr->SharedPtr->Rx.Tail) != ringPtr->RxHead);
+    WdfInterruptReleaseLock(DeviceContextPtr->WdfInterrupt);
+    if (rxPending) {
+        ImxCanRingCompleteWaiters(DeviceContextPtr, STATUS_SUCCESS);
+    }
+}
+
+/* IOCTL_CAN_CONTROLLER_SET_RX_FIFO_FILTER */
+/* Compiles the receive filter rules and configures the Legacy Rx FIFO with them. */
+_Use_decl_annotations_
+VOID ImxCanIoctlControllerSetRxFifoFilter(const PDEV_CONTEXT DeviceContextPtr, WDFREQUEST WdfRequest)
+{
+    CAN_CONTROLLER_SET_RX_FIFO_FILTER_INPUT *inputBufferPtr;
+    CAN_CONTROLLER_SET_RX_FIFO_FILTER_OUTPUT *outputBufferPtr;
+    volatile IMXCAN_REGISTERS *registersPtr = DeviceContextPtr->RegistersPtr;
+    flexcan_rx_fifo_config_t rxFifoConfig;
+    can_filter_program_t *programPtr;
+    WDF_OBJECT_ATTRIBUTES attributes;
+    WDFMEMORY programMemory;
+    WDFMEMORY oldProgramMemory;
+    size_t length;
+    UINT32 ruleCount;
+    UINT32 maxElements;
+    UINT32 maskIdx;
+    UINT64 fifoMbMask;
+    BOOLEAN isBusy;
+
+    NTSTATUS status = WdfRequestRetrieveInputBuffer(WdfRequest, FIELD_OFFSET(CAN_CONTROLLER_SET_RX_FIFO_FILTER_INPUT, rules), (PVOID*)(&inputBufferPtr), &length);
+    if (!NT_SUCCESS(status)) {
+        KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "WdfRequestRetrieveInputBuffer(..) failed. (status = %!STATUS!)\n", status));
+        WdfRequestComplete(WdfRequest, status);
+        return;
+    }
+    status = WdfRequestRetrieveOutputBuffer(WdfRequest, sizeof(*outputBufferPtr), (PVOID*)(&outputBufferPtr), NULL);
+    if (!NT_SUCCESS(status)) {
+        KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "WdfRequestRetrieveOutputBuffer(..) failed. (status = %!STATUS!)\n", status));
+        WdfRequestComplete(WdfRequest, status);
+        return;
+    }
+    ruleCount = inputBufferPtr->ruleCount;
+    maxElements = inputBufferPtr->maxFilterElements;
+    /* The FIFO, the filter table and at least two Message Buffers must fit below MAXMB, see FLEXCAN_SetRxFifoConfig(). */
+    if ((ruleCount > CAN_FILTER_MAX_RULES) || (length < CAN_RX_FIFO_FILTER_SIZE(ruleCount)) ||
+        (maxElements == 0U) || (maxElements > CAN_FILTER_MAX_ELEMENTS) || ((maxElements % 8U) != 0U) ||
+        ((6U + (2U * (maxElements / 8U))) >= (registersPtr->MCR & CAN_MCR_MAXMB_MASK))) {
+        WdfRequestComplete(WdfRequest, STATUS_INVALID_PARAMETER);
+        return;
+    }
+    /* The filter elements are built with individual masks. */
+    if (0U == (registersPtr->MCR & CAN_MCR_IRMQ_MASK)) {
+        KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "Individual Rx masking is disabled.\n"));
+        WdfRequestComplete(WdfRequest, STATUS_INVALID_DEVICE_STATE);
+        return;
+    }
+
+    WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+    attributes.ParentObject = DeviceContextPtr->WdfDevice;
+    status = WdfMemoryCreate(&attributes, NonPagedPoolNx, IMXCAN_POOL_TAG, sizeof(*programPtr), &programMemory, (PVOID*)(&programPtr));
+    if (!NT_SUCCESS(status)) {
+        KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "WdfMemoryCreate(..) failed. (status = %!STATUS!)\n", status));
+        WdfRequestComplete(WdfRequest, status);
+        return;
+    }
+    if (!CanFilterCompile(inputBufferPtr->rules, ruleCount, maxElements, programPtr)) {
+        KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "Invalid receive filter rule.\n"));
+        WdfObjectDelete(programMemory);
+        WdfRequestComplete(WdfRequest, STATUS_INVALID_PARAMETER);
+        return;
+    }
+
+    /* The Message Buffers the filter table takes must not be owned by the frame ring. */
+    fifoMbMask = ImxCanRingMbMask(0U, (UINT8)(6U + ((programPtr->rffn + 1U) * 2U)));
+    WdfInterruptAcquireLock(DeviceContextPtr->WdfInterrupt);
+    isBusy = (0U != (fifoMbMask & (DeviceContextPtr->Ring.RxMbMask | DeviceContextPtr->Ring.TxMbMask)));
+    WdfInterruptReleaseLock(DeviceContextPtr->WdfInterrupt);
+    if (isBusy) {
+        KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "The filter table overlaps the frame ring Message Buffers.\n"));
+        WdfObjectDelete(programMemory);
+        WdfRequestComplete(WdfRequest, STATUS_DEVICE_BUSY);
+        return;
+    }
+
+    /* The elements past filterCount repeat element 0, a table without elements rejects all frames. */
+    rxFifoConfig.idFilterTable = programPtr->filterTable;
+    rxFifoConfig.idFilterNum = (UINT8)(8U * (programPtr->rffn + 1U));
+    rxFifoConfig.idFilterType = (programPtr->filterCount != 0U) ? kFLEXCAN_RxFifoFilterTypeA : kFLEXCAN_RxFifoFilterTypeD;
+    rxFifoConfig.priority = inputBufferPtr->priority;
+    FLEXCAN_SetRxFifoConfig(registersPtr, &rxFifoConfig, TRUE);
+    for (maskIdx = 0U; maskIdx < programPtr->individualMaskCount; maskIdx++) {
+        FLEXCAN_SetRxIndividualMask(registersPtr, (UINT8)maskIdx, programPtr->maskTable[maskIdx]);
+    }
+    FLEXCAN_SetRxFifoGlobalMask(registersPtr, programPtr->globalMask);
+
+    /* Frames received while the filter is replaced may be checked against either filter. */
+    WdfInterruptAcquireLock(DeviceContextPtr->WdfInterrupt);
+    oldProgramMemory = DeviceContextPtr->RxFifoFilterMemory;
+    DeviceContextPtr->RxFifoFilterMemory = programMemory;
+    DeviceContextPtr->RxFifoFilterPtr = programPtr;
+    WdfInterruptReleaseLock(DeviceContextPtr->WdfInterrupt);
+    if (oldProgramMemory != NULL) {
+        WdfObjectDelete(oldProgramMemory);
+    }
+
+    outputBufferPtr->filterElements = 8U * (programPtr->rffn + 1U);
+    outputBufferPtr->usedElements = programPtr->filterCount;
+    outputBufferPtr->individualMasks = programPtr->individualMaskCount;
+    outputBufferPtr->exact = programPtr->exact;
+    KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "Rx FIFO filter set. (rules = %u, elements = %u, exact = %u)\n", ruleCount, programPtr->filterCount, programPtr->exact));
+    WdfRequestCompleteWithInformation(WdfRequest, STATUS_SUCCESS, sizeof(*outputBufferPtr));
+}
+
+IMXCAN_NONPAGED_SEGMENT_END;
@@ -0,0 +1,513 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host test of the receive ID filter compiler (canfilter.c)
+//
+// The compiled tables are run through a model of the Legacy Rx FIFO Type A
+// filter: a frame hits the lowest element whose value matches it under the
+// element's individual mask, or under RXFGMASK past the individual masks.
+// The frames the hardware lets through are then checked with
+// CanFilterAccept(), as the interrupt handler does, and the result is
+// compared with the rules themselves.
+//
+// Covers the parameter checks, the element and mask encoding, the merging
+// of overlapping and adjacent rules, the split of ranges into aligned
+// blocks, the merges forced by the table size, by the number of individual
+// masks and by the work area, and random rule sets against every standard
+// ID and the boundaries of the extended ranges.
+//
+
+#include "../canfilter.c"
+
+#include "HostTest.h"
+
+#include <stdlib.h>
+
+#ifndef TRUE
+#define TRUE                    ((BOOLEAN)1)
+#define FALSE                   ((BOOLEAN)0)
+#endif
+
+#define STD_ID_COUNT            (1U << CAN_FILTER_STD_WIDTH)
+#define EXT_ID_COUNT            (1U << CAN_FILTER_EXT_WIDTH)
+#define IDE_BIT                 (1U << 30)
+#define RTR_BIT                 (1U << 31)
+#define RANDOM_SETS             400
+
+static can_filter_program_t g_Program;
+
+static unsigned g_Seed = 1;
+
+static
+unsigned
+Random(
+    unsigned Range
+    )
+{
+    g_Seed = g_Seed * 1103515245 + 12345;
+    return (g_Seed >> 8) % Range;
+}
+
+static
+UINT32
+Random32()
+{
+    return (Random(1U << 16) << 16) | Random(1U << 16);
+}
+
+static
+can_filter_rule_t
+Rule(
+    UINT32 IdFirst,
+    UINT32 IdLast,
+    UINT8 Format
+    )
+{
+    can_filter_rule_t Rule;
+
+    memset(&Rule, 0, sizeof(Rule));
+    Rule.idFirst = IdFirst;
+    Rule.idLast = IdLast;
+    Rule.format = Format;
+    return Rule;
+}
+
+// The ID, IDE and RTR bits of a frame as the Type A elements see them.
+static
+UINT32
+FrameWord(
+    UINT32 Id,
+    UINT8 Format,
+    BOOLEAN Remote
+    )
+{
+    UINT32 Word = (Format == kCAN_FILTER_FormatExtend) ? (IDE_BIT | (Id << 1)) : (Id << 19);
+
+    return Remote ? (Word | RTR_BIT) : Word;
+}
+
+// Legacy Rx FIFO filter model, TRUE if an element accepts the frame.
+static
+BOOLEAN
+HardwareMatch(
+    const can_filter_program_t *pProgram,
+    UINT32 Id,
+    UINT8 Format,
+    BOOLEAN Remote,
+    UINT32 *pIdHit
+    )
+{
+    UINT32 Word = FrameWord(Id, Format, Remote);
+    UINT32 Elements = 8 * (pProgram->rffn + 1);
+    UINT32 Mask;
+    UINT32 Index;
+
+    // The driver sets an empty table as Type D, which rejects every frame.
+    if (pProgram->filterCount == 0) {
+        return FALSE;
+    }
+    for (Index = 0; Index < Elements; Index++) {
+        Mask = (Index < pProgram->individualMaskCount) ? pProgram->maskTable[Index] : pProgram->globalMask;
+        if (((Word ^ pProgram->filterTable[Index]) & Mask) == 0) {
+            *pIdHit = Index;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static
+BOOLEAN
+RulesAccept(
+    const can_filter_rule_t *pRules,
+    UINT32 RuleCount,
+    UINT32 Id,
+    UINT8 Format
+    )
+{
+    UINT32 Index;
+
+    for (Index = 0; Index < RuleCount; Index++) {
+        if ((pRules[Index].format == Format) && (pRules[Index].idFirst <= Id) && (Id <= pRules[Index].idLast)) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+typedef struct _FILTER_RESULT {
+    UINT32 Mismatches;
+    UINT32 Missed;
+    UINT32 HardwareExtra;
+} FILTER_RESULT;
+
+// Checks one frame, the hardware must not miss a wanted frame and the
+// software check must leave exactly the wanted ones.
+static
+void
+CheckFrame(
+    const can_filter_rule_t *pRules,
+    UINT32 RuleCount,
+    UINT32 Id,
+    UINT8 Format,
+    FILTER_RESULT *pResult
+    )
+{
+    BOOLEAN Wanted = RulesAccept(pRules, RuleCount, Id, Format);
+    BOOLEAN Remote = (BOOLEAN)(Id & 1);
+    BOOLEAN Accepted = FALSE;
+    UINT32 IdHit;
+
+    if (HardwareMatch(&g_Program, Id, Format, Remote, &IdHit)) {
+        if (!Wanted) {
+            pResult->HardwareExtra++;
+        }
+        Accepted = CanFilterAccept(&g_Program, IdHit, Id, Format);
+        // Only an inexact element lets an unwanted frame through.
+        if (!Wanted && ((g_Program.inexactElements[IdHit / 32] & (1U << (IdHit % 32))) == 0)) {
+            pResult->Mismatches++;
+        }
+    }
+    else if (Wanted) {
+        pResult->Missed++;
+    }
+    if (Accepted != Wanted) {
+        pResult->Mismatches++;
+    }
+    if (CanFilterMatch(&g_Program, Id, Format) != Wanted) {
+        pResult->Mismatches++;
+    }
+}
+
+// Checks the layout of the compiled program and every standard ID, the
+// extended IDs around each rule and random extended IDs.
+static
+FILTER_RESULT
+CheckProgram(
+    const can_filter_rule_t *pRules,
+    UINT32 RuleCount,
+    UINT32 MaxElements
+    )
+{
+    FILTER_RESULT Result = { 0, 0, 0 };
+    UINT32 Elements = 8 * (g_Program.rffn + 1);
+    UINT32 Inexact = 0;
+    UINT32 Wide = 0;
+    UINT32 Index;
+    UINT32 Id;
+    int Offset;
+
+    CHECK(Elements <= MaxElements);
+    CHECK(g_Program.filterCount <= Elements);
+    CHECK(g_Program.filterCount <= g_Program.blockCount);
+    CHECK(g_Program.individualMaskCount == ((8 + 2 * g_Program.rffn < CAN_FILTER_MAX_INDIVIDUAL_MASKS) ?
+                                            8 + 2 * g_Program.rffn : CAN_FILTER_MAX_INDIVIDUAL_MASKS));
+    CHECK(g_Program.globalMask == CAN_FILTER_EXACT_MASK);
+    for (Index = 0; Index < Elements; Index++) {
+        if ((Index < g_Program.filterCount) && (Index < g_Program.individualMaskCount) &&
+            (g_Program.maskTable[Index] != CAN_FILTER_EXACT_MASK)) {
+            Wide++;
+        }
+        if ((g_Program.inexactElements[Index / 32] & (1U << (Index % 32))) != 0) {
+            CHECK(Index < g_Program.filterCount);
+            Inexact++;
+        }
+        if ((Index >= g_Program.filterCount) && (g_Program.filterCount != 0)) {
+            CHECK(g_Program.filterTable[Index] == g_Program.filterTable[0]);
+        }
+        // The RTR bit is never checked.
+        if (Index < g_Program.individualMaskCount) {
+            CHECK((g_Program.maskTable[Index] & RTR_BIT) == 0);
+        }
+    }
+    CHECK(g_Program.exact == (Inexact == 0));
+    // Smallest table holding the elements and their individual masks.
+    if (Elements > 8) {
+        CHECK((Elements - 8 < g_Program.filterCount) || (8 + 2 * (g_Program.rffn - 1) < Wide));
+    }
+
+    for (Id = 0; Id < STD_ID_COUNT; Id++) {
+        CheckFrame(pRules, RuleCount, Id, kCAN_FILTER_FormatStandard, &Result);
+    }
+    for (Index = 0; Index < RuleCount; Index++) {
+        for (Offset = -2; Offset <= 2; Offset++) {
+            Id = pRules[Index].idFirst + Offset;
+            if (Id < EXT_ID_COUNT) {
+                CheckFrame(pRules, RuleCount, Id, kCAN_FILTER_FormatExtend, &Result);
+            }
+            Id = pRules[Index].idLast + Offset;
+            if (Id < EXT_ID_COUNT) {
+                CheckFrame(pRules, RuleCount, Id, kCAN_FILTER_FormatExtend, &Result);
+            }
+        }
+    }
+    for (Index = 0; Index < 4096; Index++) {
+        CheckFrame(pRules, RuleCount, Random32() % EXT_ID_COUNT, kCAN_FILTER_FormatExtend, &Result);
+    }
+
+    CHECK(Result.Missed == 0);
+    CHECK(Result.Mismatches == 0);
+    if (g_Program.exact) {
+        CHECK(Result.HardwareExtra == 0);
+    }
+    return Result;
+}
+
+static
+void
+TestParameters()
+{
+    static can_filter_rule_t Rules[CAN_FILTER_MAX_RULES + 1];
+    can_filter_rule_t Bad;
+    UINT32 Index;
+
+    for (Index = 0; Index <= CAN_FILTER_MAX_RULES; Index++) {
+        Rules[Index] = Rule(Index, Index, kCAN_FILTER_FormatStandard);
+    }
+    CHECK(!CanFilterCompile(Rules, CAN_FILTER_MAX_RULES + 1, 128, &g_Program));
+    CHECK(CanFilterCompile(Rules, CAN_FILTER_MAX_RULES, 128, &g_Program));
+    CHECK(!CanFilterCompile(Rules, 1, 0, &g_Program));
+    CHECK(!CanFilterCompile(Rules, 1, 12, &g_Program));
+    CHECK(!CanFilterCompile(Rules, 1, CAN_FILTER_MAX_ELEMENTS + 8, &g_Program));
+
+    Bad = Rule(0, 0, 2);
+    CHECK(!CanFilterCompile(&Bad, 1, 8, &g_Program));
+    Bad = Rule(5, 4, kCAN_FILTER_FormatStandard);
+    CHECK(!CanFilterCompile(&Bad, 1, 8, &g_Program));
+    Bad = Rule(0, STD_ID_COUNT, kCAN_FILTER_FormatStandard);
+    CHECK(!CanFilterCompile(&Bad, 1, 8, &g_Program));
+    Bad = Rule(0, EXT_ID_COUNT, kCAN_FILTER_FormatExtend);
+    CHECK(!CanFilterCompile(&Bad, 1, 8, &g_Program));
+    Bad = Rule(0, EXT_ID_COUNT - 1, kCAN_FILTER_FormatExtend);
+    CHECK(CanFilterCompile(&Bad, 1, 8, &g_Program));
+}
+
+static
+void
+TestEncoding()
+{
+    can_filter_rule_t Rules[4];
+
+    memset(Rules, 0, sizeof(Rules));
+
+    // No rule: an empty table, all frames are rejected.
+    CHECK(CanFilterCompile(Rules, 0, 8, &g_Program));
+    CHECK((g_Program.filterCount == 0) && (g_Program.rffn == 0) && g_Program.exact);
+    CHECK(g_Program.maskTable[7] == CAN_FILTER_EXACT_MASK);
+    CheckProgram(Rules, 0, 8);
+
+    Rules[0] = Rule(0x123, 0x123, kCAN_FILTER_FormatStandard);
+    CHECK(CanFilterCompile(Rules, 1, 8, &g_Program));
+    CHECK((g_Program.filterCount == 1) && g_Program.exact);
+    CHECK(g_Program.filterTable[0] == (0x123U << 19));
+    CHECK(g_Program.maskTable[0] == (IDE_BIT | (0x7FFU << 19)));
+    CheckProgram(Rules, 1, 8);
+
+    Rules[0] = Rule(0x1ABCDEF, 0x1ABCDEF, kCAN_FILTER_FormatExtend);
+    CHECK(CanFilterCompile(Rules, 1, 8, &g_Program));
+    CHECK(g_Program.filterTable[0] == (IDE_BIT | (0x1ABCDEFU << 1)));
+    CHECK(g_Program.maskTable[0] == CAN_FILTER_EXACT_MASK);
+    CheckProgram(Rules, 1, 8);
+
+    // An aligned range is one element with a wider mask.
+    Rules[0] = Rule(0x100, 0x1FF, kCAN_FILTER_FormatStandard);
+    CHECK(CanFilterCompile(Rules, 1, 8, &g_Program));
+    CHECK((g_Program.filterCount == 1) && g_Program.exact);
+    CHECK(g_Program.filterTable[0] == (0x100U << 19));
+    CHECK(g_Program.maskTable[0] == (IDE_BIT | (0x700U << 19)));
+    CheckProgram(Rules, 1, 8);
+
+    // The same ID in both formats.
+    Rules[0] = Rule(0x10, 0x10, kCAN_FILTER_FormatStandard);
+    Rules[1] = Rule(0x10, 0x10, kCAN_FILTER_FormatExtend);
+    Rules[2] = Rule(0x7FF, 0x7FF, kCAN_FILTER_FormatStandard);
+    Rules[3] = Rule(0x1FFFFFFF, 0x1FFFFFFF, kCAN_FILTER_FormatExtend);
+    CHECK(CanFilterCompile(Rules, 4, 8, &g_Program));
+    CHECK((g_Program.filterCount == 4) && g_Program.exact);
+    CheckProgram(Rules, 4, 8);
+}
+
+static
+void
+TestMergeRules()
+{
+    can_filter_rule_t Rules[6];
+
+    // Overlapping and adjacent rules, in any order, make one range.
+    Rules[0] = Rule(0x28, 0x28, kCAN_FILTER_FormatStandard);
+    Rules[1] = Rule(0x18, 0x27, kCAN_FILTER_FormatStandard);
+    Rules[2] = Rule(0x10, 0x1F, kCAN_FILTER_FormatStandard);
+    Rules[3] = Rule(0x12, 0x14, kCAN_FILTER_FormatStandard);
+    // Formats are never merged, a gap of one ID is kept.
+    Rules[4] = Rule(0x29, 0x40, kCAN_FILTER_FormatExtend);
+    Rules[5] = Rule(0x2A, 0x2A, kCAN_FILTER_FormatStandard);
+    CHECK(CanFilterCompile(Rules, 6, 32, &g_Program));
+    CHECK(g_Program.rangeCount == 2);
+    CHECK((g_Program.ranges[0].idFirst == 0x10) && (g_Program.ranges[0].idLast == 0x28));
+    CHECK(g_Program.ranges[0].format == kCAN_FILTER_FormatStandard);
+    CHECK((g_Program.ranges[1].idFirst == 0x29) && (g_Program.ranges[1].idLast == 0x40));
+    CHECK(g_Program.ranges[1].format == kCAN_FILTER_FormatExtend);
+    CHECK(!CanFilterMatch(&g_Program, 0x29, kCAN_FILTER_FormatStandard));
+    CHECK(CanFilterMatch(&g_Program, 0x2A, kCAN_FILTER_FormatStandard));
+    CHECK(!CanFilterMatch(&g_Program, 0x2A + (1U << 11), kCAN_FILTER_FormatStandard));
+    // 0x10-0x1F, 0x20-0x27, 0x28 and 0x2A, plus 0x29, 0x2A-0x2B, 0x2C-0x2F, 0x30-0x3F and 0x40.
+    CHECK(g_Program.filterCount == 9);
+    CHECK(g_Program.exact);
+    CheckProgram(Rules, 6, 32);
+}
+
+static
+void
+TestSplitAndMerge()
+{
+    static const UINT32 Spread[] = { 0x100, 0x102, 0x104, 0x106, 0x108, 0x10A, 0x10C, 0x10E,
+                                     0x200, 0x202, 0x204, 0x206, 0x208, 0x20A, 0x20C, 0x20E };
+    can_filter_rule_t Rules[16];
+    FILTER_RESULT Result;
+    UINT32 Index;
+
+    // 0x101-0x1FE is 14 aligned blocks, 12 of them with more than one ID.
+    Rules[0] = Rule(0x101, 0x1FE, kCAN_FILTER_FormatStandard);
+    CHECK(CanFilterCompile(Rules, 1, 32, &g_Program));
+    // 16 elements only have 10 individual masks, the table grows to 24.
+    CHECK((g_Program.filterCount == 14) && g_Program.exact);
+    CHECK(g_Program.rffn == 2);
+    CHECK(g_Program.individualMaskCount == 12);
+    CheckProgram(Rules, 1, 32);
+
+    // With only 16 elements the wide blocks are merged until 10 are left.
+    CHECK(CanFilterCompile(Rules, 1, 16, &g_Program));
+    CHECK(!g_Program.exact);
+    Result = CheckProgram(Rules, 1, 16);
+    CHECK(Result.HardwareExtra > 0);
+
+    // 16 single IDs in 8 elements, the cheapest table is 0x100-0x10F,
+    // 0x200-0x203 and six single IDs: 10 extra IDs.
+    for (Index = 0; Index < 16; Index++) {
+        Rules[Index] = Rule(Spread[Index], Spread[Index], kCAN_FILTER_FormatStandard);
+    }
+    CHECK(CanFilterCompile(Rules, 16, 8, &g_Program));
+    CHECK((g_Program.filterCount == 8) && !g_Program.exact);
+    Result = CheckProgram(Rules, 16, 8);
+    CHECK(Result.HardwareExtra == 10);
+
+    // The same IDs fit exactly in 16 elements.
+    CHECK(CanFilterCompile(Rules, 16, 16, &g_Program));
+    CHECK((g_Program.filterCount == 16) && g_Program.exact);
+    CheckProgram(Rules, 16, 16);
+}
+
+static
+void
+TestIndividualMasks()
+{
+    can_filter_rule_t Rules[40];
+    UINT32 Wide = 0;
+    UINT32 Index;
+
+    // 40 aligned ranges need 40 individual masks, there are only 32.
+    for (Index = 0; Index < 40; Index++) {
+        Rules[Index] = Rule(Index * 0x20, Index * 0x20 + 0xF, kCAN_FILTER_FormatStandard);
+    }
+    CHECK(CanFilterCompile(Rules, 40, 128, &g_Program));
+    CHECK(g_Program.individualMaskCount == CAN_FILTER_MAX_INDIVIDUAL_MASKS);
+    for (Index = 0; Index < g_Program.filterCount; Index++) {
+        if ((Index < g_Program.individualMaskCount) && (g_Program.maskTable[Index] != CAN_FILTER_EXACT_MASK)) {
+            Wide++;
+        }
+    }
+    CHECK(Wide <= CAN_FILTER_MAX_INDIVIDUAL_MASKS);
+    CHECK(!g_Program.exact);
+    CheckProgram(Rules, 40, 128);
+}
+
+static
+void
+TestWorkArea()
+{
+    static can_filter_rule_t Rules[CAN_FILTER_MAX_RULES];
+    UINT32 Index;
+
+    // Each range splits into 30 blocks, far more than the work area holds.
+    for (Index = 0; Index < CAN_FILTER_MAX_RULES; Index++) {
+        Rules[Index] = Rule(Index * 0x10000 + 1, Index * 0x10000 + 0xFFFE, kCAN_FILTER_FormatExtend);
+    }
+    CHECK(CanFilterCompile(Rules, CAN_FILTER_MAX_RULES, 128, &g_Program));
+    CHECK(g_Program.filterCount <= 128);
+    CHECK(g_Program.rangeCount == CAN_FILTER_MAX_RULES);
+    CheckProgram(Rules, CAN_FILTER_MAX_RULES, 128);
+}
+
+static
+void
+TestRandom()
+{
+    static can_filter_rule_t Rules[CAN_FILTER_MAX_RULES];
+    UINT32 Exact = 0;
+    UINT32 Set;
+    UINT32 RuleCount;
+    UINT32 MaxElements;
+    UINT32 Index;
+    UINT32 Width;
+    UINT32 First;
+    UINT32 Length;
+    UINT8 Format;
+
+    for (Set = 0; Set < RANDOM_SETS; Set++) {
+        RuleCount = 1 + Random((Set % 4 == 0) ? CAN_FILTER_MAX_RULES : 24);
+        MaxElements = 8 * (1 + Random(CAN_FILTER_MAX_ELEMENTS / 8));
+        for (Index = 0; Index < RuleCount; Index++) {
+            Format = (Random(3) == 0) ? kCAN_FILTER_FormatExtend : kCAN_FILTER_FormatStandard;
+            Width = (Format == kCAN_FILTER_FormatExtend) ? CAN_FILTER_EXT_WIDTH : CAN_FILTER_STD_WIDTH;
+            First = Random32() & ((1U << Width) - 1);
+            switch (Random(4)) {
+            case 0:
+                Length = 1;
+                break;
+            case 1:
+                Length = 1 + Random(16);
+                break;
+            case 2:
+                // Aligned block.
+                Length = 1U << Random(Width - 2);
+                First &= ~(Length - 1);
+                break;
+            default:
+                Length = 1 + Random(1U << (Width - 3));
+                break;
+            }
+            if (First > ((1U << Width) - 1) - (Length - 1)) {
+                First = ((1U << Width) - 1) - (Length - 1);
+            }
+            Rules[Index] = Rule(First, First + Length - 1, Format);
+        }
+        if (!CanFilterCompile(Rules, RuleCount, MaxElements, &g_Program)) {
+            CHECK(FALSE);
+            continue;
+        }
+        if (g_Program.exact) {
+            Exact++;
+        }
+        CheckProgram(Rules, RuleCount, MaxElements);
+        if (g_NumFailures != 0) {
+            printf("random set %u: %u rules, %u elements\n", Set, RuleCount, MaxElements);
+            break;
+        }
+    }
+    printf("random: %u rule sets, %u compiled exactly\n", Set, Exact);
+}
+
+int
+main()
+{
+    TestParameters();
+    TestEncoding();
+    TestMergeRules();
+    TestSplitAndMerge();
+    TestIndividualMasks();
+    TestWorkArea();
+    TestRandom();
+
+    return HostTestResult("canfilter_test");
+}
@@ -0,0 +1,8 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Empty host build stand-in for initguid.h, included by precomp.h
+//
+
+#pragma once
@@ -0,0 +1,108 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host build stand-in for the parts of ntddk.h used by the FlexCAN driver
+// sources
+//
+// The base types are defined here, canring.h and canfilter.h skip their own
+// host definitions when CAN_HOST_TYPES_DEFINED is set.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define CAN_HOST_TYPES_DEFINED
+
+typedef void                    VOID, *PVOID;
+typedef char                    CHAR;
+typedef uint8_t                 UINT8, *PUINT8, UCHAR, BOOLEAN;
+typedef uint16_t                UINT16, *PUINT16, USHORT, WCHAR;
+typedef uint32_t                UINT32, *PUINT32, ULONG, *PULONG;
+typedef int32_t                 INT32, LONG, NTSTATUS;
+typedef uint64_t                UINT64, ULONG64, ULONGLONG;
+typedef int64_t                 LONGLONG;
+typedef uintptr_t               ULONG_PTR;
+typedef size_t                  SIZE_T;
+
+typedef union _LARGE_INTEGER {
+    LONGLONG QuadPart;
+} LARGE_INTEGER, *PLARGE_INTEGER;
+
+typedef struct _UNICODE_STRING {
+    USHORT Length;
+    USHORT MaximumLength;
+    WCHAR *Buffer;
+} UNICODE_STRING;
+
+typedef enum _POOL_TYPE {
+    NonPagedPoolNx = 512
+} POOL_TYPE;
+
+#define TRUE                    1
+#define FALSE                   0
+
+#define _In_
+#define _Out_
+#define _Inout_
+#define _In_opt_
+#define _Out_opt_
+#define _Use_decl_annotations_
+#define _IRQL_requires_same_
+#define _IRQL_requires_max_(Irql)
+#define _Field_range_(...)
+#define __pragma(Pragma)
+
+#define DEFINE_GUID(...)
+
+#define STATUS_SUCCESS                  ((NTSTATUS)0x00000000L)
+#define STATUS_DATATYPE_MISALIGNMENT    ((NTSTATUS)0x80000002L)
+#define STATUS_NO_MORE_ENTRIES          ((NTSTATUS)0x8000001AL)
+#define STATUS_INVALID_PARAMETER        ((NTSTATUS)0xC000000DL)
+#define STATUS_INSUFFICIENT_RESOURCES   ((NTSTATUS)0xC000009AL)
+#define STATUS_BUFFER_TOO_SMALL         ((NTSTATUS)0xC0000023L)
+#define STATUS_CANCELLED                ((NTSTATUS)0xC0000120L)
+#define STATUS_INVALID_DEVICE_STATE     ((NTSTATUS)0xC0000184L)
+#define STATUS_DEVICE_BUSY              ((NTSTATUS)0x80000011L)
+
+#define NT_SUCCESS(Status)      (((NTSTATUS)(Status)) >= 0)
+
+#define KdPrintEx(Args)
+
+#define RtlZeroMemory(Destination, Length)          memset((Destination), 0, (Length))
+#define RtlCopyMemory(Destination, Source, Length)  memcpy((Destination), (Source), (Length))
+#define FIELD_OFFSET(Type, Field)                   offsetof(Type, Field)
+
+static inline BOOLEAN
+BitScanForward64(
+    ULONG *Index,
+    UINT64 Mask
+    )
+{
+    if (Mask == 0) {
+        return FALSE;
+    }
+    *Index = (ULONG)__builtin_ctzll(Mask);
+    return TRUE;
+}
+
+//
+// The performance counter counts the calls, so each interrupt pass gets its
+// own value.
+//
+static LONGLONG g_HostPerformanceCounter;
+
+static inline LARGE_INTEGER
+KeQueryPerformanceCounter(
+    PLARGE_INTEGER Frequency
+    )
+{
+    LARGE_INTEGER Counter;
+
+    (void)Frequency;
+    Counter.QuadPart = __atomic_add_fetch(&g_HostPerformanceCounter, 1, __ATOMIC_RELAXED);
+    return Counter;
+}
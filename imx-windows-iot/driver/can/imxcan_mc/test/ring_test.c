@@ -0,0 +1,1198 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host test of the shared frame ring (canring.h) and of the driver side of
+// the ring (ring.c) against a model of the FlexCAN Message Buffers
+//
+// The model keeps the interrupt flags write-one-to-clear, holds one frame
+// per RX Message Buffer and flags an overrun when a full one receives
+// another, queues up to 6 frames in the Legacy Rx FIFO, and sends the TX
+// Message Buffers in the order they were written. The flag accessors of
+// imxcan.h are redirected to the model, the other FlexCAN functions ring.c
+// calls are defined here.
+//
+// Covers the ring layout, batched reads and writes across the index wrap,
+// IOCTL_CAN_CONTROLLER_MAP_RING validation, the RX batch of one interrupt
+// pass with drops when the ring is full and Message Buffer overruns, the
+// Legacy Rx FIFO drain with the software filter check, the TX refill from
+// the doorbell and from the TX interrupts, the doorbell waiting for RX
+// entries and the release of the ring. A last case runs the interrupt
+// handler and the application on two threads and checks that no frame is
+// reordered, duplicated or lost without being counted.
+//
+
+#include "precomp.h"
+#include "imxcanhw.h"
+#include "imxcan.h"
+
+#define FLEXCAN_GetMbStatusFlags    HostGetMbStatusFlags
+#define FLEXCAN_ClearMbStatusFlags  HostClearMbStatusFlags
+
+static UINT64 HostGetMbStatusFlags(volatile IMXCAN_REGISTERS *Base, UINT64 Mask);
+static void HostClearMbStatusFlags(volatile IMXCAN_REGISTERS *Base, UINT64 Mask);
+
+#include "../ring.c"
+#include "../canfilter.c"
+
+#include "HostTest.h"
+
+#include <sched.h>
+#include <stdlib.h>
+
+#define HOST_MB_COUNT           64
+#define HOST_FIFO_DEPTH         6
+#define HOST_SENT_MAX           (64 * 1024)
+
+#define RING_RX_MB_FIRST        8
+#define RING_RX_MB_COUNT        8
+#define RING_TX_MB_FIRST        16
+#define RING_TX_MB_COUNT        2
+
+#define STRESS_RX_FRAMES        100000
+#define STRESS_TX_FRAMES        20000
+#define STRESS_MAX_PASSES       1000000
+
+typedef struct _HOST_FLEXCAN {
+    UINT64 Flags;
+    flexcan_frame_t Mb[HOST_MB_COUNT];
+    BOOLEAN MbFull[HOST_MB_COUNT];
+    BOOLEAN MbOverrun[HOST_MB_COUNT];
+    BOOLEAN TxBusy[HOST_MB_COUNT];
+    UINT8 TxOrder[HOST_MB_COUNT];
+    ULONG TxOrderCount;
+    BOOLEAN TxFail;
+    flexcan_frame_t Fifo[HOST_FIFO_DEPTH];
+    ULONG FifoCount;
+    UINT32 Sent[HOST_SENT_MAX];
+    ULONG SentCount;
+    ULONG Aborted;
+} HOST_FLEXCAN;
+
+static HOST_FLEXCAN g_Host;
+static IMXCAN_REGISTERS g_Registers;
+static DEV_CONTEXT g_Device;
+static WDF_HOST_OBJECT g_WdfDevice = { &g_Device };
+static WDF_HOST_INTERRUPT g_Interrupt = { PTHREAD_MUTEX_INITIALIZER };
+static WDF_HOST_QUEUE g_RingQueue = { &g_WdfDevice, NULL };
+static WDF_HOST_QUEUE g_RingWaitQueue = { &g_WdfDevice, NULL };
+
+//
+// FlexCAN model
+//
+
+static
+UINT64
+HostGetMbStatusFlags(
+    volatile IMXCAN_REGISTERS *Base,
+    UINT64 Mask
+    )
+{
+    (void)Base;
+    return g_Host.Flags & Mask;
+}
+
+static
+void
+HostClearMbStatusFlags(
+    volatile IMXCAN_REGISTERS *Base,
+    UINT64 Mask
+    )
+{
+    (void)Base;
+    g_Host.Flags &= ~Mask;
+    if (((Mask & (UINT64)kFLEXCAN_RxFifoFrameAvlFlag) != 0) && (g_Host.FifoCount != 0)) {
+        // The next frame moves to the FIFO output.
+        g_Host.FifoCount--;
+        memmove(&g_Host.Fifo[0], &g_Host.Fifo[1], g_Host.FifoCount * sizeof(g_Host.Fifo[0]));
+        if (g_Host.FifoCount != 0) {
+            g_Host.Flags |= (UINT64)kFLEXCAN_RxFifoFrameAvlFlag;
+        }
+    }
+}
+
+status_t
+FLEXCAN_ReadRxMb(
+    volatile IMXCAN_REGISTERS *base,
+    UINT8 mbIdx,
+    flexcan_frame_t *pRxFrame
+    )
+{
+    status_t status;
+
+    (void)base;
+    if (!g_Host.MbFull[mbIdx]) {
+        return kStatus_Fail;
+    }
+    *pRxFrame = g_Host.Mb[mbIdx];
+    status = g_Host.MbOverrun[mbIdx] ? kStatus_FLEXCAN_RxOverflow : kStatus_Success;
+    g_Host.MbFull[mbIdx] = FALSE;
+    g_Host.MbOverrun[mbIdx] = FALSE;
+    return status;
+}
+
+status_t
+FLEXCAN_ReadFDRxMb(
+    volatile IMXCAN_REGISTERS *base,
+    UINT8 mbIdx,
+    flexcan_fd_frame_t *pRxFrame
+    )
+{
+    (void)base;
+    (void)mbIdx;
+    (void)pRxFrame;
+    CHECK(FALSE);
+    return kStatus_Fail;
+}
+
+status_t
+FLEXCAN_ReadRxFifo(
+    volatile IMXCAN_REGISTERS *base,
+    flexcan_frame_t *pRxFrame
+    )
+{
+    (void)base;
+    if (g_Host.FifoCount == 0) {
+        return kStatus_Fail;
+    }
+    *pRxFrame = g_Host.Fifo[0];
+    return kStatus_Success;
+}
+
+status_t
+FLEXCAN_WriteTxMb(
+    volatile IMXCAN_REGISTERS *base,
+    UINT8 mbIdx,
+    const flexcan_frame_t *pTxFrame
+    )
+{
+    (void)base;
+    if (g_Host.TxBusy[mbIdx] || g_Host.TxFail) {
+        return kStatus_Fail;
+    }
+    g_Host.Mb[mbIdx] = *pTxFrame;
+    g_Host.TxBusy[mbIdx] = TRUE;
+    g_Host.TxOrder[g_Host.TxOrderCount++] = mbIdx;
+    return kStatus_Success;
+}
+
+status_t
+FLEXCAN_WriteFDTxMb(
+    volatile IMXCAN_REGISTERS *base,
+    UINT8 mbIdx,
+    const flexcan_fd_frame_t *pTxFrame
+    )
+{
+    (void)base;
+    (void)mbIdx;
+    (void)pTxFrame;
+    CHECK(FALSE);
+    return kStatus_Fail;
+}
+
+static
+void
+HostRemoveTxOrder(
+    UINT8 MbIdx
+    )
+{
+    ULONG Index;
+
+    for (Index = 0; Index < g_Host.TxOrderCount; Index++) {
+        if (g_Host.TxOrder[Index] == MbIdx) {
+            g_Host.TxOrderCount--;
+            memmove(&g_Host.TxOrder[Index], &g_Host.TxOrder[Index + 1], g_Host.TxOrderCount - Index);
+            return;
+        }
+    }
+}
+
+void
+FLEXCAN_TransferAbortSend(
+    volatile IMXCAN_REGISTERS *base,
+    flexcan_handle_t *handle,
+    UINT8 mbIdx
+    )
+{
+    (void)base;
+    (void)handle;
+    CHECK(g_Host.TxBusy[mbIdx]);
+    g_Host.TxBusy[mbIdx] = FALSE;
+    HostRemoveTxOrder(mbIdx);
+    g_Host.Aborted++;
+}
+
+void
+FLEXCAN_TransferFDAbortSend(
+    volatile IMXCAN_REGISTERS *base,
+    flexcan_handle_t *handle,
+    UINT8 mbIdx
+    )
+{
+    FLEXCAN_TransferAbortSend(base, handle, mbIdx);
+}
+
+void
+FLEXCAN_SetRxFifoConfig(
+    volatile IMXCAN_REGISTERS *base,
+    const flexcan_rx_fifo_config_t *pRxFifoConfig,
+    BOOLEAN enable
+    )
+{
+    (void)base;
+    (void)pRxFifoConfig;
+    (void)enable;
+}
+
+void
+FLEXCAN_SetRxIndividualMask(
+    volatile IMXCAN_REGISTERS *base,
+    UINT8 maskIdx,
+    UINT32 mask
+    )
+{
+    (void)base;
+    (void)maskIdx;
+    (void)mask;
+}
+
+void
+FLEXCAN_SetRxFifoGlobalMask(
+    volatile IMXCAN_REGISTERS *base,
+    UINT32 mask
+    )
+{
+    (void)base;
+    (void)mask;
+}
+
+static
+flexcan_frame_t
+MakeFrame(
+    UINT32 Sequence
+    )
+{
+    flexcan_frame_t Frame;
+
+    memset(&Frame, 0, sizeof(Frame));
+    Frame.mfs_0.format = kFLEXCAN_FrameFormatExtend;
+    Frame.mfs_0.length = 8;
+    Frame.mfs_1.id = Sequence & 0x1FFFFFFF;
+    Frame.mfp.mfp_w.dataWord0 = Sequence;
+    return Frame;
+}
+
+// A frame arrives in an RX Message Buffer.
+static
+void
+HostReceive(
+    UINT8 MbIdx,
+    UINT32 Sequence
+    )
+{
+    if (g_Host.MbFull[MbIdx]) {
+        g_Host.MbOverrun[MbIdx] = TRUE;
+    }
+    g_Host.Mb[MbIdx] = MakeFrame(Sequence);
+    g_Host.MbFull[MbIdx] = TRUE;
+    g_Host.Flags |= (UINT64)1 << MbIdx;
+}
+
+// A frame arrives in the Legacy Rx FIFO.
+static
+void
+HostReceiveFifo(
+    flexcan_frame_t Frame
+    )
+{
+    if (g_Host.FifoCount == HOST_FIFO_DEPTH) {
+        g_Host.Flags |= (UINT64)kFLEXCAN_RxFifoOverflowFlag;
+        return;
+    }
+    g_Host.Fifo[g_Host.FifoCount++] = Frame;
+    g_Host.Flags |= (UINT64)kFLEXCAN_RxFifoFrameAvlFlag;
+    if (g_Host.FifoCount == HOST_FIFO_DEPTH - 1) {
+        g_Host.Flags |= (UINT64)kFLEXCAN_RxFifoWarningFlag;
+    }
+}
+
+// The oldest written TX Message Buffer is sent, FALSE if none is busy.
+static
+BOOLEAN
+HostTransmit()
+{
+    UINT8 MbIdx;
+
+    if (g_Host.TxOrderCount == 0) {
+        return FALSE;
+    }
+    MbIdx = g_Host.TxOrder[0];
+    HostRemoveTxOrder(MbIdx);
+    g_Host.TxBusy[MbIdx] = FALSE;
+    if (g_Host.SentCount < HOST_SENT_MAX) {
+        g_Host.Sent[g_Host.SentCount] = g_Host.Mb[MbIdx].mfp.mfp_w.dataWord0;
+    }
+    g_Host.SentCount++;
+    g_Host.Flags |= (UINT64)1 << MbIdx;
+    return TRUE;
+}
+
+//
+// Driver and application helpers
+//
+
+static
+void
+ResetDevice()
+{
+    memset(&g_Host, 0, sizeof(g_Host));
+    memset(&g_Registers, 0, sizeof(g_Registers));
+    memset(&g_Device, 0, sizeof(g_Device));
+    g_Device.RegistersPtr = &g_Registers;
+    g_Device.WdfDevice = &g_WdfDevice;
+    g_Device.WdfInterrupt = &g_Interrupt;
+    g_Device.RingQueue = &g_RingQueue;
+    g_Device.RingWaitQueue = &g_RingWaitQueue;
+    g_RingQueue.Head = NULL;
+    g_RingWaitQueue.Head = NULL;
+    g_HostForwardStatus = STATUS_SUCCESS;
+}
+
+static
+CAN_RING_SHARED*
+AllocateRing(
+    UINT32 RxCount,
+    UINT32 TxCount
+    )
+{
+    SIZE_T Size = CAN_RING_SHARED_SIZE(RxCount, TxCount, sizeof(CAN_RING_ENTRY));
+    CAN_RING_SHARED *pShared = aligned_alloc(CAN_RING_CACHE_LINE, (Size + CAN_RING_CACHE_LINE - 1) & ~(SIZE_T)(CAN_RING_CACHE_LINE - 1));
+
+    CHECK(CanRingInitialize(pShared, Size, RxCount, TxCount, sizeof(CAN_RING_ENTRY)));
+    return pShared;
+}
+
+static
+void
+MapRing(
+    WDF_HOST_REQUEST *pRequest,
+    CAN_CONTROLLER_MAP_RING_INPUT *pInput,
+    CAN_RING_SHARED *pShared,
+    UINT8 RxFirst,
+    UINT8 RxCount,
+    UINT8 TxFirst,
+    UINT8 TxCount,
+    UINT32 Flags
+    )
+{
+    memset(pRequest, 0, sizeof(*pRequest));
+    memset(pInput, 0, sizeof(*pInput));
+    pInput->rxMbFirst = RxFirst;
+    pInput->rxMbCount = RxCount;
+    pInput->txMbFirst = TxFirst;
+    pInput->txMbCount = TxCount;
+    pInput->flags = Flags;
+    pRequest->InputBuffer = pInput;
+    pRequest->InputLength = sizeof(*pInput);
+    pRequest->OutputBuffer = pShared;
+    pRequest->OutputLength = CAN_RING_SHARED_SIZE(pShared->Rx.EntryCount, pShared->Tx.EntryCount, sizeof(CAN_RING_ENTRY));
+    ImxCanIoctlControllerMapRing(&g_Device, pRequest);
+}
+
+static
+void
+MapDefaultRing(
+    WDF_HOST_REQUEST *pRequest,
+    CAN_RING_SHARED *pShared
+    )
+{
+    CAN_CONTROLLER_MAP_RING_INPUT Input;
+
+    MapRing(pRequest, &Input, pShared, RING_RX_MB_FIRST, RING_RX_MB_COUNT, RING_TX_MB_FIRST, RING_TX_MB_COUNT, 0);
+    CHECK(pRequest->Completions == 0);
+    CHECK(g_Device.Ring.SharedPtr == pShared);
+}
+
+static
+void
+Doorbell(
+    WDF_HOST_REQUEST *pRequest,
+    CAN_CONTROLLER_RING_DOORBELL_INPUT *pFlags,
+    CAN_CONTROLLER_RING_DOORBELL_OUTPUT *pStatistics
+    )
+{
+    memset(pRequest, 0, sizeof(*pRequest));
+    pRequest->InputBuffer = pFlags;
+    pRequest->InputLength = sizeof(*pFlags);
+    pRequest->OutputBuffer = pStatistics;
+    pRequest->OutputLength = sizeof(*pStatistics);
+    ImxCanIoctlControllerRingDoorbell(&g_Device, pRequest);
+}
+
+static
+NTSTATUS
+SimpleDoorbell(
+    UINT32 Flags
+    )
+{
+    WDF_HOST_REQUEST Request;
+    CAN_CONTROLLER_RING_DOORBELL_OUTPUT Statistics;
+
+    Doorbell(&Request, &Flags, &Statistics);
+    CHECK(Request.Completions == 1);
+    return Request.Status;
+}
+
+static
+BOOLEAN
+RunIsr()
+{
+    BOOLEAN Handled;
+
+    WdfInterruptAcquireLock(&g_Interrupt);
+    Handled = ImxCanRingIsr(&g_Device);
+    WdfInterruptReleaseLock(&g_Interrupt);
+    return Handled;
+}
+
+// The framework removes a canceled request from its queue before the callback.
+static
+void
+CancelMapRequest(
+    WDF_HOST_REQUEST *pRequest
+    )
+{
+    WDFREQUEST Request = NULL;
+
+    CHECK(pRequest->Queue == &g_RingQueue);
+    CHECK(NT_SUCCESS(WdfIoQueueRetrieveNextRequest(&g_RingQueue, &Request)));
+    CHECK(Request == pRequest);
+    ImxCanEvtRingCanceledOnQueue(&g_RingQueue, pRequest);
+}
+
+static
+UINT32
+EntrySequence(
+    const CAN_RING_ENTRY *pEntry
+    )
+{
+    return pEntry->u.frame.mfp.mfp_w.dataWord0;
+}
+
+static unsigned g_Seed = 1;
+
+static
+unsigned
+Random(
+    unsigned Range
+    )
+{
+    g_Seed = g_Seed * 1103515245 + 12345;
+    return (g_Seed >> 8) % Range;
+}
+
+//
+// Test cases
+//
+
+static
+void
+TestLayout()
+{
+    static __attribute__((aligned(64))) UINT8 Buffer[CAN_RING_SHARED_SIZE(8, 4, sizeof(CAN_RING_ENTRY))];
+    CAN_RING_SHARED *pShared = (CAN_RING_SHARED *)Buffer;
+    SIZE_T Size = sizeof(Buffer);
+
+    CHECK(sizeof(CAN_RING) == 3 * CAN_RING_CACHE_LINE);
+    CHECK(offsetof(CAN_RING, Tail) - offsetof(CAN_RING, Head) == CAN_RING_CACHE_LINE);
+    CHECK((sizeof(CAN_RING_ENTRY) % sizeof(UINT64)) == 0);
+
+    CHECK(!CanRingInitialize(pShared, Size, 0, 4, sizeof(CAN_RING_ENTRY)));
+    CHECK(!CanRingInitialize(pShared, Size, 6, 4, sizeof(CAN_RING_ENTRY)));
+    CHECK(!CanRingInitialize(pShared, Size, 8, 3, sizeof(CAN_RING_ENTRY)));
+    CHECK(!CanRingInitialize(pShared, 1 << 30, 8192, 4, sizeof(CAN_RING_ENTRY)));
+    CHECK(!CanRingInitialize(pShared, Size, 8, 4, 0));
+    CHECK(!CanRingInitialize(pShared, Size, 8, 4, 12));
+    CHECK(!CanRingInitialize(pShared, Size - 1, 8, 4, sizeof(CAN_RING_ENTRY)));
+    CHECK(!CanRingInitialize(pShared, (SIZE_T)1 << 32, 8, 4, sizeof(CAN_RING_ENTRY)));
+
+    memset(Buffer, 0xA5, sizeof(Buffer));
+    CHECK(CanRingInitialize(pShared, Size, 8, 4, sizeof(CAN_RING_ENTRY)));
+    CHECK(pShared->Magic == CAN_RING_MAGIC);
+    CHECK(pShared->Version == CAN_RING_VERSION);
+    CHECK(pShared->Size == Size);
+    CHECK(pShared->Rx.EntryOffset == sizeof(CAN_RING_SHARED));
+    CHECK(pShared->Tx.EntryOffset == sizeof(CAN_RING_SHARED) + 8 * sizeof(CAN_RING_ENTRY));
+    CHECK((pShared->Rx.Head == 0) && (pShared->Rx.Tail == 0) && (pShared->Rx.Dropped == 0));
+    CHECK((pShared->Tx.Head == 0) && (pShared->Tx.Tail == 0));
+    CHECK(CanRingEntry(pShared, &pShared->Rx, 9) == Buffer + sizeof(CAN_RING_SHARED) + sizeof(CAN_RING_ENTRY));
+    CHECK(CanRingEntry(pShared, &pShared->Tx, 7) == Buffer + pShared->Tx.EntryOffset + 3 * sizeof(CAN_RING_ENTRY));
+    CHECK(CanRingEntry(pShared, &pShared->Tx, 3) < (void *)(Buffer + Size));
+}
+
+static
+void
+TestReadWrite()
+{
+    CAN_RING_SHARED *pShared = AllocateRing(8, 8);
+    CAN_RING *pRing = &pShared->Tx;
+    CAN_RING_ENTRY Entries[16];
+    UINT32 Sequence = 0;
+    UINT32 Expected = 0;
+    UINT32 Count;
+    UINT32 Index;
+
+    // Start just before the indexes wrap.
+    pRing->Head = 0xFFFFFFFA;
+    pRing->Tail = 0xFFFFFFFA;
+
+    memset(Entries, 0, sizeof(Entries));
+    for (Index = 0; Index < 16; Index++) {
+        Entries[Index].u.frame = MakeFrame(Sequence + Index);
+    }
+    CHECK(CanRingWrite(pShared, pRing, Entries, 10) == 8);
+    Sequence += 8;
+    CHECK(CanRingCount(pRing) == 8);
+    CHECK(CanRingWrite(pShared, pRing, Entries, 1) == 0);
+    CHECK(CanRingRead(pShared, pRing, Entries, 0) == 0);
+
+    Count = CanRingRead(pShared, pRing, Entries, 3);
+    CHECK(Count == 3);
+    for (Index = 0; Index < Count; Index++) {
+        CHECK(EntrySequence(&Entries[Index]) == Expected++);
+    }
+    CHECK(pRing->Tail == 0xFFFFFFFD);
+
+    for (Index = 0; Index < 16; Index++) {
+        Entries[Index].u.frame = MakeFrame(Sequence + Index);
+    }
+    CHECK(CanRingWrite(pShared, pRing, Entries, 5) == 3);
+    Sequence += 3;
+    CHECK(pRing->Head == 5);
+    CHECK(CanRingCount(pRing) == 8);
+
+    Count = CanRingRead(pShared, pRing, Entries, 16);
+    CHECK(Count == 8);
+    for (Index = 0; Index < Count; Index++) {
+        CHECK(EntrySequence(&Entries[Index]) == Expected++);
+    }
+    CHECK(pRing->Tail == 5);
+    CHECK(CanRingCount(pRing) == 0);
+    CHECK(Expected == Sequence);
+
+    // The RX ring is untouched.
+    CHECK((pShared->Rx.Head == 0) && (pShared->Rx.Tail == 0));
+
+    free(pShared);
+}
+
+static
+void
+TestMapRing()
+{
+    CAN_RING_SHARED *pShared = AllocateRing(8, 4);
+    CAN_RING_SHARED *pSecond = AllocateRing(8, 4);
+    CAN_CONTROLLER_MAP_RING_INPUT Input;
+    WDF_HOST_REQUEST Request;
+    WDF_HOST_REQUEST Second;
+    UINT64 RingMask;
+
+    ResetDevice();
+
+    pShared->Magic++;
+    MapRing(&Request, &Input, pShared, 8, 2, 16, 2, 0);
+    CHECK((Request.Completions == 1) && (Request.Status == STATUS_INVALID_PARAMETER));
+    pShared->Magic--;
+
+    pShared->Tx.EntryOffset += sizeof(CAN_RING_ENTRY);
+    MapRing(&Request, &Input, pShared, 8, 2, 16, 2, 0);
+    CHECK((Request.Completions == 1) && (Request.Status == STATUS_INVALID_PARAMETER));
+    pShared->Tx.EntryOffset -= sizeof(CAN_RING_ENTRY);
+
+    pShared->Rx.EntryCount = 16;
+    MapRing(&Request, &Input, pShared, 8, 2, 16, 2, 0);
+    CHECK((Request.Completions == 1) && (Request.Status == STATUS_INVALID_PARAMETER));
+    pShared->Rx.EntryCount = 8;
+
+    MapRing(&Request, &Input, pShared, 8, 2, 16, 2, 0);
+    Request.Completions = 0;
+    Request.OutputLength--;
+    ImxCanIoctlControllerMapRing(&g_Device, &Request);
+    CHECK((Request.Completions == 1) && (Request.Status == STATUS_INVALID_PARAMETER));
+    CancelMapRequest(&Request);
+
+    MapRing(&Request, &Input, pShared, 8, 2, 16, 2, 0);
+    CancelMapRequest(&Request);
+    Request.Completions = 0;
+    Request.OutputBuffer = (UINT8 *)pShared + 4;
+    ImxCanIoctlControllerMapRing(&g_Device, &Request);
+    CHECK((Request.Completions == 1) && (Request.Status == STATUS_DATATYPE_MISALIGNMENT));
+
+    // Message Buffers: none, overlapping, past the last one, in use.
+    MapRing(&Request, &Input, pShared, 8, 0, 16, 0, 0);
+    CHECK((Request.Completions == 1) && (Request.Status == STATUS_INVALID_PARAMETER));
+    MapRing(&Request, &Input, pShared, 8, 4, 11, 2, 0);
+    CHECK((Request.Completions == 1) && (Request.Status == STATUS_INVALID_PARAMETER));
+    MapRing(&Request, &Input, pShared, 8, 2, 62, 3, 0);
+    CHECK((Request.Completions == 1) && (Request.Status == STATUS_INVALID_PARAMETER));
+    g_Device.CANhandle.mbState[17] = 1;
+    MapRing(&Request, &Input, pShared, 8, 2, 16, 2, 0);
+    CHECK((Request.Completions == 1) && (Request.Status == STATUS_DEVICE_BUSY));
+    g_Device.CANhandle.mbState[17] = 0;
+
+    // Legacy Rx FIFO: disabled, then enabled and covering the Message Buffers.
+    MapRing(&Request, &Input, pShared, 8, 2, 16, 2, kCAN_RING_MapRxFifo);
+    CHECK((Request.Completions == 1) && (Request.Status == STATUS_INVALID_DEVICE_STATE));
+    g_Registers.MCR |= CAN_MCR_RFEN_MASK;
+    MapRing(&Request, &Input, pShared, 6, 2, 16, 2, 0);
+    CHECK((Request.Completions == 1) && (Request.Status == STATUS_INVALID_PARAMETER));
+    g_Device.CANhandle.rxFifoState = 1;
+    MapRing(&Request, &Input, pShared, 8, 2, 16, 2, kCAN_RING_MapRxFifo);
+    CHECK((Request.Completions == 1) && (Request.Status == STATUS_INVALID_DEVICE_STATE));
+    g_Device.CANhandle.rxFifoState = 0;
+    g_Registers.MCR &= ~CAN_MCR_RFEN_MASK;
+    CHECK(g_Device.Ring.SharedPtr == NULL);
+    CHECK((g_Registers.IMASK1 == 0) && (g_Registers.IMASK2 == 0));
+
+    // The driver starts at the application RX tail and at its TX tail.
+    pShared->Rx.Tail = 5;
+    pShared->Rx.Head = 3;
+    pShared->Rx.Dropped = 7;
+    pShared->Tx.Tail = 9;
+    pShared->Tx.Head = 9;
+    MapRing(&Request, &Input, pShared, 8, 2, 40, 2, 0);
+    RingMask = (3ULL << 8) | (3ULL << 40);
+    CHECK(Request.Completions == 0);
+    CHECK(Request.Queue == &g_RingQueue);
+    CHECK(g_Device.Ring.SharedPtr == pShared);
+    CHECK(g_Device.Ring.MapRequest == &Request);
+    CHECK(g_Device.CANhandle.ringMbMask == RingMask);
+    CHECK((g_Registers.IMASK1 == (UINT32)RingMask) && (g_Registers.IMASK2 == (UINT32)(RingMask >> 32)));
+    CHECK((g_Device.Ring.RxHead == 5) && (pShared->Rx.Head == 5) && (pShared->Rx.Dropped == 0));
+    CHECK(g_Device.Ring.TxTail == 9);
+
+    // One ring at a time.
+    MapRing(&Second, &Input, pSecond, 12, 2, 20, 2, 0);
+    CHECK((Second.Completions == 1) && (Second.Status == STATUS_DEVICE_BUSY));
+    CHECK(g_Device.Ring.SharedPtr == pShared);
+
+    CancelMapRequest(&Request);
+    CHECK((Request.Completions == 1) && (Request.Status == STATUS_CANCELLED));
+    CHECK(g_Device.Ring.SharedPtr == NULL);
+    CHECK(g_Device.CANhandle.ringMbMask == 0);
+    CHECK((g_Registers.IMASK1 == 0) && (g_Registers.IMASK2 == 0));
+
+    // The ring is detached again when the request cannot be queued.
+    g_HostForwardStatus = STATUS_INSUFFICIENT_RESOURCES;
+    MapRing(&Request, &Input, pShared, 8, 2, 16, 2, 0);
+    CHECK((Request.Completions == 1) && (Request.Status == STATUS_INSUFFICIENT_RESOURCES));
+    CHECK(g_Device.Ring.SharedPtr == NULL);
+    CHECK(g_Device.CANhandle.ringMbMask == 0);
+    CHECK(g_Registers.IMASK1 == 0);
+    g_HostForwardStatus = STATUS_SUCCESS;
+
+    MapRing(&Second, &Input, pSecond, 8, 2, 16, 2, 0);
+    CHECK(Second.Completions == 0);
+    CancelMapRequest(&Second);
+
+    free(pSecond);
+    free(pShared);
+}
+
+static
+void
+TestRxBatch()
+{
+    CAN_RING_SHARED *pShared = AllocateRing(8, 4);
+    CAN_RING_ENTRY Entries[8];
+    WDF_HOST_REQUEST Request;
+    UINT64 RxMask = ((1ULL << RING_RX_MB_COUNT) - 1) << RING_RX_MB_FIRST;
+    UINT32 Count;
+    UINT32 Index;
+
+    ResetDevice();
+    MapDefaultRing(&Request, pShared);
+
+    CHECK(!RunIsr());
+
+    // One pass publishes the flagged Message Buffers lowest first.
+    HostReceive(12, 100);
+    HostReceive(8, 101);
+    HostReceive(10, 102);
+    CHECK(RunIsr());
+    CHECK(pShared->Rx.Head == 3);
+    CHECK((g_Host.Flags & RxMask) == 0);
+    CHECK(g_Device.Ring.Statistics.rxBatches == 1);
+    CHECK(g_Device.Ring.Statistics.rxFrames == 3);
+    CHECK(g_Device.Ring.RxPublished);
+    Count = CanRingRead(pShared, &pShared->Rx, Entries, 8);
+    CHECK(Count == 3);
+    CHECK((Entries[0].mbIdx == 8) && (EntrySequence(&Entries[0]) == 101));
+    CHECK((Entries[1].mbIdx == 10) && (EntrySequence(&Entries[1]) == 102));
+    CHECK((Entries[2].mbIdx == 12) && (EntrySequence(&Entries[2]) == 100));
+    for (Index = 0; Index < Count; Index++) {
+        CHECK(Entries[Index].status == kStatus_FLEXCAN_RxIdle);
+        CHECK(Entries[Index].flags == 0);
+        CHECK(Entries[Index].timestamp == Entries[0].timestamp);
+    }
+
+    // A Message Buffer that overran reports it.
+    HostReceive(9, 200);
+    HostReceive(9, 201);
+    CHECK(RunIsr());
+    CHECK(g_Device.Ring.Statistics.rxMbOverruns == 1);
+    CHECK(CanRingRead(pShared, &pShared->Rx, Entries, 8) == 1);
+    CHECK((EntrySequence(&Entries[0]) == 201) && (Entries[0].status == kStatus_FLEXCAN_RxOverflow));
+    CHECK(Entries[0].timestamp != Entries[1].timestamp);
+
+    // A flag that belongs to the transfer IOCTLs is left alone.
+    g_Host.Flags |= 1ULL << 30;
+    CHECK(!RunIsr());
+    CHECK(g_Host.Flags == (1ULL << 30));
+    g_Host.Flags = 0;
+
+    // A full ring still drains the Message Buffers, the frames that do not
+    // fit are counted.
+    for (Index = 0; Index < 4; Index++) {
+        HostReceive((UINT8)(RING_RX_MB_FIRST + Index), 300 + Index);
+    }
+    CHECK(RunIsr());
+    for (Index = 0; Index < 8; Index++) {
+        HostReceive((UINT8)(RING_RX_MB_FIRST + Index), 400 + Index);
+    }
+    CHECK(RunIsr());
+    CHECK((g_Host.Flags & RxMask) == 0);
+    CHECK(pShared->Rx.Head - pShared->Rx.Tail == 8);
+    CHECK(pShared->Rx.Dropped == 4);
+    CHECK(g_Device.Ring.Statistics.rxDropped == 4);
+    CHECK(!RunIsr());
+
+    Count = CanRingRead(pShared, &pShared->Rx, Entries, 8);
+    CHECK(Count == 8);
+    for (Index = 0; Index < 4; Index++) {
+        CHECK(EntrySequence(&Entries[Index]) == 300 + Index);
+        CHECK(EntrySequence(&Entries[4 + Index]) == 400 + Index);
+    }
+    HostReceive(15, 500);
+    CHECK(RunIsr());
+    CHECK(pShared->Rx.Dropped == 4);
+    CHECK(CanRingRead(pShared, &pShared->Rx, Entries, 8) == 1);
+    CHECK(EntrySequence(&Entries[0]) == 500);
+
+    CancelMapRequest(&Request);
+    free(pShared);
+}
+
+static
+void
+TestRxFifo()
+{
+    static const UINT32 FilterIds[] = { 0x100, 0x102, 0x104, 0x106, 0x108, 0x10A, 0x10C, 0x10E,
+                                        0x200, 0x202, 0x204, 0x206, 0x208, 0x20A, 0x20C, 0x20E };
+    CAN_RING_SHARED *pShared = AllocateRing(16, 4);
+    CAN_CONTROLLER_MAP_RING_INPUT Input;
+    CAN_RING_ENTRY Entries[16];
+    can_filter_rule_t Rules[sizeof(FilterIds) / sizeof(FilterIds[0])];
+    can_filter_program_t *pProgram;
+    flexcan_frame_t Frame;
+    WDF_HOST_REQUEST Request;
+    UINT32 Inexact = 0xFFFFFFFF;
+    UINT32 Count;
+    UINT32 Index;
+
+    ResetDevice();
+    g_Registers.MCR |= CAN_MCR_RFEN_MASK;
+    MapRing(&Request, &Input, pShared, RING_RX_MB_FIRST, 2, RING_TX_MB_FIRST, 2, kCAN_RING_MapRxFifo);
+    CHECK(Request.Completions == 0);
+    CHECK((g_Registers.IMASK1 & kFLEXCAN_RxFifoFrameAvlFlag) != 0);
+    CHECK((g_Registers.IMASK1 & kFLEXCAN_RxFifoOverflowFlag) != 0);
+    CHECK((g_Registers.IMASK1 & kFLEXCAN_RxFifoWarningFlag) == 0);
+
+    // Seven frames for a FIFO of six, drained in the pass of a Message Buffer.
+    for (Index = 0; Index < 7; Index++) {
+        HostReceiveFifo(MakeFrame(600 + Index));
+    }
+    HostReceive(RING_RX_MB_FIRST + 1, 700);
+    CHECK(RunIsr());
+    CHECK(g_Host.Flags == 0);
+    CHECK(g_Host.FifoCount == 0);
+    CHECK(g_Device.Ring.Statistics.rxBatches == 1);
+    CHECK(g_Device.Ring.Statistics.rxFifoFrames == 6);
+    CHECK(g_Device.Ring.Statistics.rxFifoOverflows == 1);
+    Count = CanRingRead(pShared, &pShared->Rx, Entries, 16);
+    CHECK(Count == 7);
+    CHECK((Entries[0].mbIdx == RING_RX_MB_FIRST + 1) && (EntrySequence(&Entries[0]) == 700));
+    for (Index = 0; Index < 6; Index++) {
+        CHECK(EntrySequence(&Entries[1 + Index]) == 600 + Index);
+        CHECK(Entries[1 + Index].mbIdx == 0);
+        CHECK(Entries[1 + Index].status == ((Index == 0) ? kStatus_FLEXCAN_RxFifoOverflow : kStatus_FLEXCAN_RxFifoIdle));
+    }
+
+    // The frames hitting an inexact filter element are checked in software.
+    for (Index = 0; Index < sizeof(FilterIds) / sizeof(FilterIds[0]); Index++) {
+        memset(&Rules[Index], 0, sizeof(Rules[Index]));
+        Rules[Index].idFirst = FilterIds[Index];
+        Rules[Index].idLast = FilterIds[Index];
+        Rules[Index].format = kCAN_FILTER_FormatStandard;
+    }
+    pProgram = calloc(1, sizeof(*pProgram));
+    CHECK(CanFilterCompile(Rules, sizeof(Rules) / sizeof(Rules[0]), 8, pProgram));
+    CHECK(!pProgram->exact);
+    for (Index = 0; Index < pProgram->filterCount; Index++) {
+        if ((pProgram->inexactElements[Index / 32] & (1U << (Index % 32))) != 0) {
+            Inexact = Index;
+            break;
+        }
+    }
+    CHECK(Inexact != 0xFFFFFFFF);
+    g_Device.RxFifoFilterPtr = pProgram;
+
+    for (Index = 0; Index < 4; Index++) {
+        Frame = MakeFrame(800 + Index);
+        Frame.mfs_0.format = kFLEXCAN_FrameFormatStandard;
+        Frame.mfs_0.idhit = Inexact;
+        Frame.mfs_1.id = (((Index % 2) == 0) ? 0x104 : 0x105) << CAN_ID_STD_SHIFT;
+        HostReceiveFifo(Frame);
+    }
+    CHECK(RunIsr());
+    CHECK(g_Host.Flags == 0);
+    CHECK(g_Device.Ring.Statistics.rxFifoFrames == 10);
+    CHECK(g_Device.Ring.Statistics.rxFifoFiltered == 2);
+    Count = CanRingRead(pShared, &pShared->Rx, Entries, 16);
+    CHECK(Count == 2);
+    CHECK((EntrySequence(&Entries[0]) == 800) && (EntrySequence(&Entries[1]) == 802));
+    CHECK(Entries[0].status == kStatus_FLEXCAN_RxFifoIdle);
+
+    CancelMapRequest(&Request);
+    CHECK((g_Registers.IMASK1 & kFLEXCAN_RxFifoFrameAvlFlag) == 0);
+    g_Device.RxFifoFilterPtr = NULL;
+    free(pProgram);
+    free(pShared);
+}
+
+static
+void
+TestTx()
+{
+    CAN_RING_SHARED *pShared = AllocateRing(8, 4);
+    CAN_CONTROLLER_RING_DOORBELL_INPUT Flags = kCAN_RING_DoorbellTx;
+    CAN_CONTROLLER_RING_DOORBELL_OUTPUT Statistics;
+    CAN_RING_ENTRY Entries[4];
+    WDF_HOST_REQUEST Request;
+    WDF_HOST_REQUEST DoorbellRequest;
+    UINT32 Index;
+
+    ResetDevice();
+    MapDefaultRing(&Request, pShared);
+
+    memset(Entries, 0, sizeof(Entries));
+    for (Index = 0; Index < 4; Index++) {
+        Entries[Index].u.frame = MakeFrame(Index);
+    }
+    CHECK(CanRingWrite(pShared, &pShared->Tx, Entries, 3) == 3);
+
+    // The doorbell fills both TX Message Buffers.
+    Doorbell(&DoorbellRequest, &Flags, &Statistics);
+    CHECK((DoorbellRequest.Completions == 1) && (DoorbellRequest.Status == STATUS_SUCCESS));
+    CHECK(DoorbellRequest.Information == sizeof(Statistics));
+    CHECK(Statistics.doorbells == 1);
+    CHECK(g_Host.TxBusy[RING_TX_MB_FIRST] && g_Host.TxBusy[RING_TX_MB_FIRST + 1]);
+    CHECK(pShared->Tx.Tail == 2);
+
+    // A doorbell with both Message Buffers busy sends nothing.
+    CHECK(SimpleDoorbell(kCAN_RING_DoorbellTx) == STATUS_SUCCESS);
+    CHECK(pShared->Tx.Tail == 2);
+
+    // Each TX interrupt refills its Message Buffer.
+    CHECK(HostTransmit());
+    CHECK(RunIsr());
+    CHECK(g_Device.Ring.Statistics.txFrames == 1);
+    CHECK(pShared->Tx.Tail == 3);
+    while (HostTransmit()) {
+        CHECK(RunIsr());
+    }
+    CHECK(g_Device.Ring.Statistics.txFrames == 3);
+    CHECK(g_Host.SentCount == 3);
+    for (Index = 0; Index < 3; Index++) {
+        CHECK(g_Host.Sent[Index] == Index);
+    }
+    CHECK(g_Device.Ring.TxMbBusyMask == 0);
+
+    // A head past the entries the application may produce sends nothing.
+    pShared->Tx.Head = pShared->Tx.Tail + 5;
+    CHECK(SimpleDoorbell(kCAN_RING_DoorbellTx) == STATUS_SUCCESS);
+    CHECK(g_Device.Ring.Statistics.txErrors == 1);
+    CHECK(pShared->Tx.Tail == 3);
+    CHECK(g_Host.TxOrderCount == 0);
+    pShared->Tx.Head = 3;
+
+    // A frame the Message Buffer refuses is consumed and counted.
+    CHECK(CanRingWrite(pShared, &pShared->Tx, Entries, 1) == 1);
+    g_Host.TxFail = TRUE;
+    CHECK(SimpleDoorbell(kCAN_RING_DoorbellTx) == STATUS_SUCCESS);
+    g_Host.TxFail = FALSE;
+    CHECK(g_Device.Ring.Statistics.txErrors == 2);
+    CHECK(pShared->Tx.Tail == 4);
+    CHECK(g_Device.Ring.TxMbBusyMask == 0);
+
+    // A TX flag of a Message Buffer without a frame in flight is not a sent frame.
+    g_Host.Flags |= 1ULL << RING_TX_MB_FIRST;
+    CHECK(RunIsr());
+    CHECK(g_Device.Ring.Statistics.txFrames == 3);
+
+    CancelMapRequest(&Request);
+    CHECK(SimpleDoorbell(kCAN_RING_DoorbellTx) == STATUS_INVALID_DEVICE_STATE);
+    free(pShared);
+}
+
+static
+void
+TestDoorbellWait()
+{
+    CAN_RING_SHARED *pShared = AllocateRing(8, 4);
+    CAN_CONTROLLER_RING_DOORBELL_INPUT Flags = kCAN_RING_DoorbellWaitRx;
+    CAN_CONTROLLER_RING_DOORBELL_OUTPUT Statistics;
+    CAN_CONTROLLER_RING_DOORBELL_OUTPUT OtherStatistics;
+    CAN_RING_ENTRY Entries[8];
+    WDF_HOST_REQUEST Request;
+    WDF_HOST_REQUEST Waiter;
+    WDF_HOST_REQUEST Other;
+
+    ResetDevice();
+    MapDefaultRing(&Request, pShared);
+
+    // An empty ring queues the request until the DPC after a published batch.
+    Doorbell(&Waiter, &Flags, &Statistics);
+    CHECK(Waiter.Completions == 0);
+    CHECK(Waiter.Queue == &g_RingWaitQueue);
+    ImxCanRingDpc(&g_Device);
+    CHECK(Waiter.Completions == 0);
+
+    HostReceive(RING_RX_MB_FIRST, 1);
+    HostReceive(RING_RX_MB_FIRST + 1, 2);
+    CHECK(RunIsr());
+    ImxCanRingDpc(&g_Device);
+    CHECK((Waiter.Completions == 1) && (Waiter.Status == STATUS_SUCCESS));
+    CHECK(Waiter.Information == sizeof(Statistics));
+    CHECK(Statistics.rxFrames == 2);
+    CHECK(!g_Device.Ring.RxPublished);
+    CHECK(g_RingWaitQueue.Head == NULL);
+
+    // Entries not yet read complete the request at once.
+    Doorbell(&Other, &Flags, &OtherStatistics);
+    CHECK((Other.Completions == 1) && (Other.Status == STATUS_SUCCESS));
+    CHECK(CanRingRead(pShared, &pShared->Rx, Entries, 8) == 2);
+
+    // A waiter queued while the ring is released is canceled with it.
+    Doorbell(&Other, &Flags, &OtherStatistics);
+    CHECK(Other.Completions == 0);
+    CancelMapRequest(&Request);
+    CHECK((Other.Completions == 1) && (Other.Status == STATUS_CANCELLED));
+
+    free(pShared);
+}
+
+static
+void
+TestRelease()
+{
+    CAN_RING_SHARED *pShared = AllocateRing(8, 4);
+    CAN_RING_ENTRY Entries[4];
+    WDF_HOST_REQUEST Request;
+    UINT32 Index;
+
+    ResetDevice();
+    MapDefaultRing(&Request, pShared);
+
+    memset(Entries, 0, sizeof(Entries));
+    for (Index = 0; Index < 4; Index++) {
+        Entries[Index].u.frame = MakeFrame(Index);
+    }
+    CHECK(CanRingWrite(pShared, &pShared->Tx, Entries, 4) == 4);
+    CHECK(SimpleDoorbell(kCAN_RING_DoorbellTx) == STATUS_SUCCESS);
+    CHECK(g_Host.TxOrderCount == 2);
+
+    // The frames in flight are aborted and the interrupts of the ring are
+    // disabled, a flag raised afterwards is not the ring's anymore.
+    CancelMapRequest(&Request);
+    CHECK((Request.Completions == 1) && (Request.Status == STATUS_CANCELLED));
+    CHECK(g_Host.Aborted == 2);
+    CHECK(g_Host.TxOrderCount == 0);
+    CHECK((g_Registers.IMASK1 == 0) && (g_Registers.IMASK2 == 0));
+    CHECK(g_Device.CANhandle.ringMbMask == 0);
+    HostReceive(RING_RX_MB_FIRST, 1);
+    CHECK(!RunIsr());
+    CHECK(pShared->Rx.Head == 0);
+
+    // The same buffer maps again, sending what was left in the TX ring.
+    g_Host.Flags = 0;
+    g_Host.MbFull[RING_RX_MB_FIRST] = FALSE;
+    MapDefaultRing(&Request, pShared);
+    CHECK(g_Device.Ring.TxTail == 2);
+    CHECK(SimpleDoorbell(kCAN_RING_DoorbellTx) == STATUS_SUCCESS);
+    while (HostTransmit()) {
+        CHECK(RunIsr());
+    }
+    CHECK((g_Host.SentCount == 2) && (g_Host.Sent[0] == 2) && (g_Host.Sent[1] == 3));
+    CancelMapRequest(&Request);
+
+    free(pShared);
+}
+
+//
+// The interrupt handler on one thread, the application on another
+//
+
+typedef struct _STRESS_STATE {
+    CAN_RING_SHARED *pShared;
+    volatile BOOLEAN Done;
+    UINT32 RxReceived;
+    UINT32 RxOutOfOrder;
+    UINT32 TxWritten;
+    UINT32 Doorbells;
+} STRESS_STATE;
+
+static
+void*
+StressApplication(
+    void *pContext
+    )
+{
+    STRESS_STATE *pState = pContext;
+    CAN_RING_SHARED *pShared = pState->pShared;
+    CAN_RING_ENTRY Entries[32];
+    unsigned Seed = 7;
+    UINT32 Next = 0;
+    UINT32 Read;
+    UINT32 Count;
+    UINT32 Index;
+    UINT32 Written;
+
+    memset(Entries, 0, sizeof(Entries));
+    while (!pState->Done) {
+        Seed = Seed * 1103515245 + 12345;
+        // A slow reader now and then, so the RX ring fills up.
+        Read = ((Seed >> 20) % 4 != 0) ? CanRingRead(pShared, &pShared->Rx, Entries, 1 + (Seed >> 8) % 32) : 0;
+        for (Index = 0; Index < Read; Index++) {
+            // Dropped frames leave gaps, but the order is kept.
+            if ((pState->RxReceived != 0) && (EntrySequence(&Entries[Index]) < Next)) {
+                pState->RxOutOfOrder++;
+            }
+            Next = EntrySequence(&Entries[Index]) + 1;
+            pState->RxReceived++;
+        }
+
+        Seed = Seed * 1103515245 + 12345;
+        Count = 1 + (Seed >> 8) % 8;
+        if (Count > STRESS_TX_FRAMES - pState->TxWritten) {
+            Count = STRESS_TX_FRAMES - pState->TxWritten;
+        }
+        for (Index = 0; Index < Count; Index++) {
+            Entries[Index].u.frame = MakeFrame(pState->TxWritten + Index);
+        }
+        Written = CanRingWrite(pShared, &pShared->Tx, Entries, Count);
+        pState->TxWritten += Written;
+        if ((Written != 0) || ((Seed >> 16) % 16 == 0)) {
+            CHECK(SimpleDoorbell(kCAN_RING_DoorbellTx) == STATUS_SUCCESS);
+            pState->Doorbells++;
+        }
+        if ((Read == 0) && (Written == 0)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static
+void
+TestConcurrent()
+{
+    CAN_RING_SHARED *pShared = AllocateRing(16, 8);
+    CAN_RING_ENTRY Entries[16];
+    STRESS_STATE State = { pShared, FALSE, 0, 0, 0, 0 };
+    WDF_HOST_REQUEST Request;
+    pthread_t Thread;
+    UINT32 RxSequence = 0;
+    UINT32 Pass;
+    UINT32 Count;
+    UINT32 Index;
+
+    ResetDevice();
+    MapDefaultRing(&Request, pShared);
+    CHECK(pthread_create(&Thread, NULL, StressApplication, &State) == 0);
+
+    for (Pass = 0; Pass < STRESS_MAX_PASSES; Pass++) {
+        WdfInterruptAcquireLock(&g_Interrupt);
+        // A burst lands in the lowest RX Message Buffers, the next burst
+        // only after the interrupt handler has read them.
+        Count = (RxSequence < STRESS_RX_FRAMES) ? Random(RING_RX_MB_COUNT + 1) : 0;
+        if (Count > STRESS_RX_FRAMES - RxSequence) {
+            Count = STRESS_RX_FRAMES - RxSequence;
+        }
+        for (Index = 0; Index < Count; Index++) {
+            HostReceive((UINT8)(RING_RX_MB_FIRST + Index), RxSequence++);
+        }
+        if (Random(2) == 0) {
+            HostTransmit();
+        }
+        ImxCanRingIsr(&g_Device);
+        WdfInterruptReleaseLock(&g_Interrupt);
+        ImxCanRingDpc(&g_Device);
+        // Interrupts are rare next to the application, it gets the lock.
+        sched_yield();
+
+        if ((RxSequence == STRESS_RX_FRAMES) && (g_Host.SentCount == STRESS_TX_FRAMES) &&
+            (pShared->Rx.Head == pShared->Rx.Tail)) {
+            break;
+        }
+    }
+    State.Done = TRUE;
+    pthread_join(Thread, NULL);
+    CHECK(Pass < STRESS_MAX_PASSES);
+
+    // Whatever the application did not read before it stopped.
+    Count = CanRingRead(pShared, &pShared->Rx, Entries, 16);
+    State.RxReceived += Count;
+
+    CHECK(State.RxOutOfOrder == 0);
+    CHECK(State.RxReceived + pShared->Rx.Dropped == STRESS_RX_FRAMES);
+    CHECK(g_Device.Ring.Statistics.rxFrames == State.RxReceived);
+    CHECK(g_Device.Ring.Statistics.rxDropped == pShared->Rx.Dropped);
+    CHECK(g_Device.Ring.Statistics.rxMbOverruns == 0);
+    CHECK(g_Device.Ring.Statistics.rxBatches < g_Device.Ring.Statistics.rxFrames);
+
+    CHECK(State.TxWritten == STRESS_TX_FRAMES);
+    CHECK(g_Host.SentCount == STRESS_TX_FRAMES);
+    for (Index = 0; Index < STRESS_TX_FRAMES; Index++) {
+        if (g_Host.Sent[Index] != Index) {
+            CHECK(g_Host.Sent[Index] == Index);
+            break;
+        }
+    }
+    CHECK(g_Device.Ring.Statistics.txFrames == STRESS_TX_FRAMES);
+    CHECK(g_Device.Ring.Statistics.txErrors == 0);
+    CHECK(g_Device.Ring.Statistics.doorbells == State.Doorbells);
+
+    printf("concurrent: %u frames received, %llu dropped, %.1f frames per batch, %u doorbells\n",
+           State.RxReceived, (unsigned long long)pShared->Rx.Dropped,
+           (double)g_Device.Ring.Statistics.rxFrames / g_Device.Ring.Statistics.rxBatches, State.Doorbells);
+
+    CancelMapRequest(&Request);
+    free(pShared);
+}
+
+int
+main()
+{
+    TestLayout();
+    TestReadWrite();
+    TestMapRing();
+    TestRxBatch();
+    TestRxFifo();
+    TestTx();
+    TestDoorbellWait();
+    TestRelease();
+    TestConcurrent();
+
+    return HostTestResult("ring_test");
+}
@@ -0,0 +1,170 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host build stand-in for the parts of wdf.h used by the FlexCAN driver
+// sources
+//
+// Requests carry host buffers and record their completion, queues are FIFO
+// lists of forwarded requests and the interrupt lock is a host mutex, so
+// the interrupt handler can run on a host thread. g_HostForwardStatus makes
+// WdfRequestForwardToIoQueue() fail.
+//
+
+#pragma once
+
+#include <ntddk.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+typedef struct _WDF_HOST_OBJECT {
+    PVOID Context;
+} WDF_HOST_OBJECT;
+
+typedef struct _WDF_HOST_QUEUE *WDFQUEUE;
+
+typedef struct _WDF_HOST_REQUEST {
+    PVOID InputBuffer;
+    size_t InputLength;
+    PVOID OutputBuffer;
+    size_t OutputLength;
+    ULONG Completions;
+    NTSTATUS Status;
+    size_t Information;
+    WDFQUEUE Queue;
+    struct _WDF_HOST_REQUEST *Next;
+} WDF_HOST_REQUEST, *WDFREQUEST;
+
+typedef struct _WDF_HOST_QUEUE {
+    WDF_HOST_OBJECT *Device;
+    WDFREQUEST Head;
+} WDF_HOST_QUEUE;
+
+typedef struct _WDF_HOST_INTERRUPT {
+    pthread_mutex_t Lock;
+} WDF_HOST_INTERRUPT, *WDFINTERRUPT;
+
+typedef WDF_HOST_OBJECT     *WDFOBJECT, *WDFDEVICE, *WDFMEMORY, *WDFSTRING, *WDFWAITLOCK, *WDFFILEOBJECT;
+
+typedef struct _WDF_OBJECT_ATTRIBUTES {
+    WDFOBJECT ParentObject;
+} WDF_OBJECT_ATTRIBUTES, *PWDF_OBJECT_ATTRIBUTES;
+
+typedef BOOLEAN EVT_WDF_INTERRUPT_ISR(WDFINTERRUPT Interrupt, ULONG MessageID);
+typedef VOID EVT_WDF_INTERRUPT_DPC(WDFINTERRUPT Interrupt, WDFOBJECT AssociatedObject);
+typedef VOID EVT_WDF_IO_QUEUE_IO_DEVICE_CONTROL(WDFQUEUE Queue, WDFREQUEST Request, size_t OutputBufferLength,
+                                                size_t InputBufferLength, ULONG IoControlCode);
+typedef VOID EVT_WDF_IO_QUEUE_IO_CANCELED_ON_QUEUE(WDFQUEUE Queue, WDFREQUEST Request);
+typedef VOID EVT_WDF_DEVICE_FILE_CREATE(WDFDEVICE Device, WDFREQUEST Request, WDFFILEOBJECT FileObject);
+typedef VOID EVT_WDF_FILE_CLOSE(WDFFILEOBJECT FileObject);
+
+#define WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(Type, Name) \
+    static inline Type *Name(WDFOBJECT Object) { return (Type *)Object->Context; }
+
+static NTSTATUS g_HostForwardStatus = STATUS_SUCCESS;
+
+static inline void WDF_OBJECT_ATTRIBUTES_INIT(PWDF_OBJECT_ATTRIBUTES Attributes)
+{
+    memset(Attributes, 0, sizeof(*Attributes));
+}
+
+static inline void WdfInterruptAcquireLock(WDFINTERRUPT Interrupt)
+{
+    pthread_mutex_lock(&Interrupt->Lock);
+}
+
+static inline void WdfInterruptReleaseLock(WDFINTERRUPT Interrupt)
+{
+    pthread_mutex_unlock(&Interrupt->Lock);
+}
+
+static inline NTSTATUS WdfRequestRetrieveInputBuffer(WDFREQUEST Request, size_t MinimumRequiredSize,
+    PVOID *Buffer, size_t *Length)
+{
+    if (Request->InputLength < MinimumRequiredSize) {
+        return STATUS_BUFFER_TOO_SMALL;
+    }
+    *Buffer = Request->InputBuffer;
+    if (Length != NULL) {
+        *Length = Request->InputLength;
+    }
+    return STATUS_SUCCESS;
+}
+
+static inline NTSTATUS WdfRequestRetrieveOutputBuffer(WDFREQUEST Request, size_t MinimumRequiredSize,
+    PVOID *Buffer, size_t *Length)
+{
+    if (Request->OutputLength < MinimumRequiredSize) {
+        return STATUS_BUFFER_TOO_SMALL;
+    }
+    *Buffer = Request->OutputBuffer;
+    if (Length != NULL) {
+        *Length = Request->OutputLength;
+    }
+    return STATUS_SUCCESS;
+}
+
+static inline void WdfRequestCompleteWithInformation(WDFREQUEST Request, NTSTATUS Status, ULONG_PTR Information)
+{
+    Request->Completions++;
+    Request->Status = Status;
+    Request->Information = Information;
+}
+
+static inline void WdfRequestComplete(WDFREQUEST Request, NTSTATUS Status)
+{
+    WdfRequestCompleteWithInformation(Request, Status, 0);
+}
+
+static inline NTSTATUS WdfRequestForwardToIoQueue(WDFREQUEST Request, WDFQUEUE Queue)
+{
+    WDFREQUEST *Link = &Queue->Head;
+
+    if (!NT_SUCCESS(g_HostForwardStatus)) {
+        return g_HostForwardStatus;
+    }
+    while (*Link != NULL) {
+        Link = &(*Link)->Next;
+    }
+    Request->Next = NULL;
+    Request->Queue = Queue;
+    *Link = Request;
+    return STATUS_SUCCESS;
+}
+
+static inline NTSTATUS WdfIoQueueRetrieveNextRequest(WDFQUEUE Queue, WDFREQUEST *Request)
+{
+    if (Queue->Head == NULL) {
+        return STATUS_NO_MORE_ENTRIES;
+    }
+    *Request = Queue->Head;
+    Queue->Head = (*Request)->Next;
+    (*Request)->Queue = NULL;
+    return STATUS_SUCCESS;
+}
+
+static inline WDFDEVICE WdfIoQueueGetDevice(WDFQUEUE Queue)
+{
+    return Queue->Device;
+}
+
+static inline NTSTATUS WdfMemoryCreate(PWDF_OBJECT_ATTRIBUTES Attributes, POOL_TYPE PoolType, ULONG PoolTag,
+    size_t BufferSize, WDFMEMORY *Memory, PVOID *Buffer)
+{
+    (void)Attributes;
+    (void)PoolType;
+    (void)PoolTag;
+    *Memory = (WDFMEMORY)malloc(sizeof(WDF_HOST_OBJECT));
+    if (*Memory == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+    (*Memory)->Context = calloc(1, BufferSize);
+    *Buffer = (*Memory)->Context;
+    return STATUS_SUCCESS;
+}
+
+static inline void WdfObjectDelete(WDFOBJECT Object)
+{
+    free(Object->Context);
+    free(Object);
+}
@@ -95,6 +95,7 @@ GcKmBaseDisplay::Start(
     // Display only: Clean the FB to avoid boot image corruption
     // when setting different resolution than firmware.
     RtlZeroMemory(m_FrameBuffer.m_Address, m_FrameBuffer.m_Size);
+    GcKmBltInvalidateTileCache(&m_PresentTileCache);
 
     if (DisplayOnly == GcKmdGlobal::s_DriverMode)
     {
@@ -392,6 +393,8 @@ GcKmBaseDisplay::CommitVidPn(
             {
                 m_TargetId = pPath->VidPnTargetId;
 
+                SetPresentRotation(pPath->ContentTransformation.Rotation);
+
                 PrepareScanlineEmulation(pTargetMode);
             }
         }
@@ -441,6 +444,8 @@ NTSTATUS
 GcKmBaseDisplay::UpdateActiveVidPnPresentPath(
     IN_CONST_PDXGKARG_UPDATEACTIVEVIDPNPRESENTPATH_CONST    pUpdateActiveVidPnPresentPath)
 {
+    SetPresentRotation(pUpdateActiveVidPnPresentPath->VidPnPresentPathInfo.ContentTransformation.Rotation);
+
     return STATUS_SUCCESS;
 }
 
@@ -513,42 +518,141 @@ NTSTATUS
 GcKmBaseDisplay::PresentDisplayOnly(
     IN_CONST_PDXGKARG_PRESENT_DISPLAYONLY  pPresentDisplayOnly)
 {
+    static_assert(sizeof(GcKmBltRect) == sizeof(RECT), "GcKmBltRect must match RECT");
+
     auto BytesPerPixel = pPresentDisplayOnly->BytesPerPixel;
 
     NT_ASSERT(BytesPerPixel == 4);
-    NT_ASSERT(!pPresentDisplayOnly->Flags.Rotate);
+    NT_ASSERT(0 == pPresentDisplayOnly->VidPnSourceId);
+
+    const auto& ActiveSize = m_CurTargetModes[pPresentDisplayOnly->VidPnSourceId].VideoSignalInfo.ActiveSize;
+    bool bTransposed = (GcKmBltRotation90 == m_PresentRotation) || (GcKmBltRotation270 == m_PresentRotation);
+
+    GcKmBltSurface Dst;
+    Dst.m_pBits = static_cast<uint8_t*>(m_FrameBuffer.m_Address);
+    Dst.m_Width = ActiveSize.cx;
+    Dst.m_Height = ActiveSize.cy;
+    Dst.m_Pitch = ActiveSize.cx * 4;
+
+    GcKmBltSurface Src;
+    Src.m_pBits = static_cast<uint8_t*>(pPresentDisplayOnly->pSource);
+    Src.m_Width = bTransposed ? ActiveSize.cy : ActiveSize.cx;
+    Src.m_Height = bTransposed ? ActiveSize.cx : ActiveSize.cy;
+    Src.m_Pitch = pPresentDisplayOnly->Pitch;
+
+    if (!GcKmBltPresent(
+            &Src,
+            &Dst,
+            BytesPerPixel,
+            m_PresentRotation,
+            reinterpret_cast<const GcKmBltRect*>(pPresentDisplayOnly->pDirtyRect),
+            pPresentDisplayOnly->NumDirtyRects,
+            GetPresentTileCache(Src.m_Width, Src.m_Height, BytesPerPixel),
+            nullptr))
+    {
+        NT_ASSERT(FALSE);
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+void
+GcKmBaseDisplay::SetPresentRotation(
+    D3DKMDT_VIDPN_PRESENT_PATH_ROTATION Rotation)
+{
+    switch (Rotation)
+    {
+    case D3DKMDT_VPPR_ROTATE90:
+    case D3DKMDT_VPPR_ROTATE90_OFFSET0:
+        m_PresentRotation = GcKmBltRotation90;
+        break;
+    case D3DKMDT_VPPR_ROTATE180:
+    case D3DKMDT_VPPR_ROTATE180_OFFSET0:
+        m_PresentRotation = GcKmBltRotation180;
+        break;
+    case D3DKMDT_VPPR_ROTATE270:
+    case D3DKMDT_VPPR_ROTATE270_OFFSET0:
+        m_PresentRotation = GcKmBltRotation270;
+        break;
+    default:
+        m_PresentRotation = GcKmBltRotationIdentity;
+        break;
+    }
+
+    //
+    // The frame buffer no longer matches the shadow copy of the source
+    //
 
-    for (ULONG i = 0; i < pPresentDisplayOnly->NumDirtyRects; i++)
+    GcKmBltInvalidateTileCache(&m_PresentTileCache);
+}
+
+GcKmBltTileCache*
+GcKmBaseDisplay::GetPresentTileCache(UINT Width, UINT Height, UINT BytesPerPixel)
+{
+    UINT TilesX, TilesY, ShadowPitch;
+    UINT NumTiles = GcKmBltGetTileCount(Width, Height, &TilesX, &TilesY);
+    UINT ShadowSize = GcKmBltGetShadowSize(Width, Height, BytesPerPixel, &ShadowPitch);
+
+    if (m_PresentTileCache.m_pTiles &&
+        (m_PresentTileCache.m_TilesX == TilesX) &&
+        (m_PresentTileCache.m_TilesY == TilesY) &&
+        (m_PresentTileCache.m_ShadowPitch == ShadowPitch))
     {
-        const auto& Rect = pPresentDisplayOnly->pDirtyRect[i];
-        NT_ASSERT(Rect.left <= Rect.right);
-        NT_ASSERT(Rect.top <= Rect.bottom);
+        return &m_PresentTileCache;
+    }
 
-        const auto BytesPerRow = (Rect.right - Rect.left) * BytesPerPixel;
-        auto SrcPitch = pPresentDisplayOnly->Pitch;
-        UINT DstPitch;
+    FreePresentTileCache();
 
-        NT_ASSERT(0 == pPresentDisplayOnly->VidPnSourceId);
-        DstPitch = m_CurTargetModes[pPresentDisplayOnly->VidPnSourceId].VideoSignalInfo.ActiveSize.cx * 4;
+    //
+    // Zeroed allocation, all tiles start out invalid
+    //
 
-        auto Src = static_cast<BYTE*>(pPresentDisplayOnly->pSource)
-            + static_cast<LONGLONG>(Rect.top) * SrcPitch
-            + static_cast<LONGLONG>(Rect.left) * BytesPerPixel;
-        auto Dst = static_cast<BYTE*>(m_FrameBuffer.m_Address)
-            + static_cast<LONGLONG>(Rect.top) * DstPitch
-            + static_cast<LONGLONG>(Rect.left) * BytesPerPixel;
+    m_PresentTileCache.m_pTiles = static_cast<GcKmBltTile*>(ExAllocatePool2(
+        POOL_FLAG_PAGED,
+        NumTiles * sizeof(GcKmBltTile),
+        'PSID'));
+    if (m_PresentTileCache.m_pTiles == nullptr)
+    {
+        return nullptr;
+    }
 
-        auto Rows = Rect.bottom - Rect.top;
-        while (Rows)
-        {
-            Rows--;
-            RtlCopyMemory(Dst, Src, BytesPerRow);
-            Src += SrcPitch;
-            Dst += DstPitch;
-        }
+    //
+    // Copy of the source as last written to the frame buffer,
+    // tiles are skipped only when they compare equal to it
+    //
+
+    m_PresentTileCache.m_pShadow = static_cast<uint8_t*>(ExAllocatePool2(
+        POOL_FLAG_PAGED | POOL_FLAG_UNINITIALIZED,
+        ShadowSize,
+        'PSID'));
+    if (m_PresentTileCache.m_pShadow == nullptr)
+    {
+        FreePresentTileCache();
+        return nullptr;
     }
 
-    return STATUS_SUCCESS;
+    m_PresentTileCache.m_TilesX = TilesX;
+    m_PresentTileCache.m_TilesY = TilesY;
+    m_PresentTileCache.m_ShadowPitch = ShadowPitch;
+
+    return &m_PresentTileCache;
+}
+
+void
+GcKmBaseDisplay::FreePresentTileCache()
+{
+    if (m_PresentTileCache.m_pTiles)
+    {
+        ExFreePoolWithTag(m_PresentTileCache.m_pTiles, 'PSID');
+    }
+
+    if (m_PresentTileCache.m_pShadow)
+    {
+        ExFreePoolWithTag(m_PresentTileCache.m_pShadow, 'PSID');
+    }
+
+    m_PresentTileCache = {};
 }
 
 NTSTATUS
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "GcKmdHdmiTransmitter.h"
+#include "GcKmdBlt.h"
 
 struct GcKmdFrameBuffer
 {
@@ -29,9 +30,14 @@ public:
         m_Pitch = 0;
         m_TargetId = 0;
         m_bNotifyVSync = true;
+        m_PresentRotation = GcKmBltRotationIdentity;
+        m_PresentTileCache = {};
     }
 
-    virtual ~GcKmBaseDisplay() {}
+    virtual ~GcKmBaseDisplay()
+    {
+        FreePresentTileCache();
+    }
 
     virtual NTSTATUS Start(
         DXGKRNL_INTERFACE  *pDxgkInterface,
@@ -172,6 +178,9 @@ public:
     void PrepareScanlineEmulation(
         const D3DKMDT_VIDPN_TARGET_MODE* pTargetMode);
 
+    void SetPresentRotation(
+        D3DKMDT_VIDPN_PRESENT_PATH_ROTATION Rotation);
+
 private:
 
     NTSTATUS ProcessVidPnPaths(
@@ -254,6 +263,13 @@ private:
 
     NTSTATUS GetFramebufferInfo(DXGKRNL_INTERFACE* pDxgkInterface, PHYSICAL_ADDRESS *pAddress, ULONG *pSize);
 
+    GcKmBltTileCache* GetPresentTileCache(UINT Width, UINT Height, UINT BytesPerPixel);
+
+    void FreePresentTileCache();
+
+    GcKmBltRotation m_PresentRotation;
+    GcKmBltTileCache m_PresentTileCache;
+
     GcKmdFrameBuffer m_FrameBuffer;
 
 protected:
@@ -489,6 +489,8 @@ GcKmBaseDisplayController::CommitVidPn(
                         }
                     }
 
+                    pPipeline->SetPresentRotation(pPath->ContentTransformation.Rotation);
+
                     pNewPathInfo->m_pDisplayPipeline = pPipeline;
                     pNewPathInfo->m_TargetId = pPath->VidPnTargetId;
                     pNewPathInfo->m_Importance = pPath->ImportanceOrdinal;
@@ -0,0 +1,551 @@
+/* Copyright (c) Microsoft Corporation.
+ * Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+#include <string.h>
+
+#include "GcKmdBlt.h"
+
+#if defined(_M_ARM64)
+#include <arm64_neon.h>
+#define GC_KM_BLT_NEON
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define GC_KM_BLT_NEON
+#endif
+
+//
+// Rotated rows are gathered into a line buffer first,
+// so the frame buffer is still written sequentially
+//
+
+#define GC_KM_BLT_LINE_PIXELS   256
+
+static int64_t
+RectArea(
+    const GcKmBltRect&  Rect)
+{
+    return (int64_t)(Rect.right - Rect.left)*(Rect.bottom - Rect.top);
+}
+
+static GcKmBltRect
+UnionRect(
+    const GcKmBltRect&  Rect0,
+    const GcKmBltRect&  Rect1)
+{
+    GcKmBltRect Union;
+
+    Union.left = Rect0.left < Rect1.left ? Rect0.left : Rect1.left;
+    Union.top = Rect0.top < Rect1.top ? Rect0.top : Rect1.top;
+    Union.right = Rect0.right > Rect1.right ? Rect0.right : Rect1.right;
+    Union.bottom = Rect0.bottom > Rect1.bottom ? Rect0.bottom : Rect1.bottom;
+
+    return Union;
+}
+
+static int64_t
+IntersectArea(
+    const GcKmBltRect&  Rect0,
+    const GcKmBltRect&  Rect1)
+{
+    int32_t Width = (Rect0.right < Rect1.right ? Rect0.right : Rect1.right) -
+                    (Rect0.left > Rect1.left ? Rect0.left : Rect1.left);
+    int32_t Height = (Rect0.bottom < Rect1.bottom ? Rect0.bottom : Rect1.bottom) -
+                     (Rect0.top > Rect1.top ? Rect0.top : Rect1.top);
+
+    if ((Width <= 0) || (Height <= 0))
+    {
+        return 0;
+    }
+
+    return (int64_t)Width*Height;
+}
+
+//
+// Overlapping or adjacent rectangles are merged when the union
+// wastes no more than 1/8 of its area on clean pixels
+//
+
+static bool
+ShouldMerge(
+    const GcKmBltRect&  Rect0,
+    const GcKmBltRect&  Rect1)
+{
+    if ((Rect0.left > Rect1.right) || (Rect1.left > Rect0.right) ||
+        (Rect0.top > Rect1.bottom) || (Rect1.top > Rect0.bottom))
+    {
+        return false;
+    }
+
+    int64_t UnionArea = RectArea(UnionRect(Rect0, Rect1));
+    int64_t DirtyArea = RectArea(Rect0) + RectArea(Rect1) - IntersectArea(Rect0, Rect1);
+
+    return (UnionArea - DirtyArea)*8 <= UnionArea;
+}
+
+uint32_t
+GcKmBltMergeRects(
+    const GcKmBltRect  *pRects,
+    uint32_t            NumRects,
+    uint32_t            Width,
+    uint32_t            Height,
+    GcKmBltRect        *pMerged)
+{
+    uint32_t    NumMerged = 0;
+
+    for (uint32_t i = 0; i < NumRects; i++)
+    {
+        GcKmBltRect Rect = pRects[i];
+
+        Rect.left = Rect.left < 0 ? 0 : Rect.left;
+        Rect.top = Rect.top < 0 ? 0 : Rect.top;
+        Rect.right = Rect.right > (int32_t)Width ? (int32_t)Width : Rect.right;
+        Rect.bottom = Rect.bottom > (int32_t)Height ? (int32_t)Height : Rect.bottom;
+
+        if ((Rect.left >= Rect.right) || (Rect.top >= Rect.bottom))
+        {
+            continue;
+        }
+
+        if (NumMerged < GC_KM_BLT_MAX_RECTS)
+        {
+            pMerged[NumMerged++] = Rect;
+            continue;
+        }
+
+        //
+        // Out of room, grow the rectangle which grows the least
+        //
+
+        uint32_t    Best = 0;
+        int64_t     BestGrowth = INT64_MAX;
+
+        for (uint32_t j = 0; j < NumMerged; j++)
+        {
+            int64_t Growth = RectArea(UnionRect(pMerged[j], Rect)) - RectArea(pMerged[j]);
+
+            if (Growth < BestGrowth)
+            {
+                Best = j;
+                BestGrowth = Growth;
+            }
+        }
+
+        pMerged[Best] = UnionRect(pMerged[Best], Rect);
+    }
+
+    bool    bMerged;
+
+    do
+    {
+        bMerged = false;
+
+        for (uint32_t i = 0; i < NumMerged; i++)
+        {
+            uint32_t    j = i + 1;
+
+            while (j < NumMerged)
+            {
+                if (ShouldMerge(pMerged[i], pMerged[j]))
+                {
+                    pMerged[i] = UnionRect(pMerged[i], pMerged[j]);
+                    pMerged[j] = pMerged[--NumMerged];
+                    bMerged = true;
+                }
+                else
+                {
+                    j++;
+                }
+            }
+        }
+    } while (bMerged);
+
+    return NumMerged;
+}
+
+uint32_t
+GcKmBltGetTileCount(
+    uint32_t    Width,
+    uint32_t    Height,
+    uint32_t   *pTilesX,
+    uint32_t   *pTilesY)
+{
+    *pTilesX = (Width + GC_KM_BLT_TILE_SIZE - 1)/GC_KM_BLT_TILE_SIZE;
+    *pTilesY = (Height + GC_KM_BLT_TILE_SIZE - 1)/GC_KM_BLT_TILE_SIZE;
+
+    return (*pTilesX)*(*pTilesY);
+}
+
+uint32_t
+GcKmBltGetShadowSize(
+    uint32_t    Width,
+    uint32_t    Height,
+    uint32_t    BytesPerPixel,
+    uint32_t   *pShadowPitch)
+{
+    *pShadowPitch = Width*BytesPerPixel;
+
+    return (*pShadowPitch)*Height;
+}
+
+void
+GcKmBltInvalidateTileCache(
+    GcKmBltTileCache   *pTileCache)
+{
+    if (pTileCache->m_pTiles)
+    {
+        memset(pTileCache->m_pTiles, 0, pTileCache->m_TilesX*pTileCache->m_TilesY*sizeof(GcKmBltTile));
+    }
+}
+
+//
+// The frame buffer is mapped write combined, whole 64 byte
+// bursts keep the write combining buffers full
+//
+
+static void
+CopyRow(
+    uint8_t        *pDst,
+    const uint8_t  *pSrc,
+    size_t          Size)
+{
+#if defined(GC_KM_BLT_NEON)
+    if (Size >= 64)
+    {
+        size_t  HeadSize = (0 - (uintptr_t)pDst) & 63;
+
+        memcpy(pDst, pSrc, HeadSize);
+
+        pDst += HeadSize;
+        pSrc += HeadSize;
+        Size -= HeadSize;
+
+        while (Size >= 64)
+        {
+            uint8x16_t  Data0 = vld1q_u8(pSrc);
+            uint8x16_t  Data1 = vld1q_u8(pSrc + 16);
+            uint8x16_t  Data2 = vld1q_u8(pSrc + 32);
+            uint8x16_t  Data3 = vld1q_u8(pSrc + 48);
+
+            vst1q_u8(pDst, Data0);
+            vst1q_u8(pDst + 16, Data1);
+            vst1q_u8(pDst + 32, Data2);
+            vst1q_u8(pDst + 48, Data3);
+
+            pDst += 64;
+            pSrc += 64;
+            Size -= 64;
+        }
+    }
+#endif
+
+    memcpy(pDst, pSrc, Size);
+}
+
+template <typename PIXEL>
+static void
+CopyRectRotated(
+    const GcKmBltSurface   *pSrc,
+    const GcKmBltSurface   *pDst,
+    GcKmBltRotation         Rotation,
+    const GcKmBltRect&      Rect)
+{
+    PIXEL       LineBuffer[GC_KM_BLT_LINE_PIXELS];
+    int32_t     SrcWidth = (int32_t)pSrc->m_Width;
+    int32_t     SrcHeight = (int32_t)pSrc->m_Height;
+    int64_t     SrcPitch = pSrc->m_Pitch;
+    GcKmBltRect DstRect;
+    int64_t     SrcStride;
+
+    switch (Rotation)
+    {
+    case GcKmBltRotation90:
+        DstRect.left = SrcHeight - Rect.bottom;
+        DstRect.right = SrcHeight - Rect.top;
+        DstRect.top = Rect.left;
+        DstRect.bottom = Rect.right;
+        SrcStride = -SrcPitch;
+        break;
+
+    case GcKmBltRotation180:
+        DstRect.left = SrcWidth - Rect.right;
+        DstRect.right = SrcWidth - Rect.left;
+        DstRect.top = SrcHeight - Rect.bottom;
+        DstRect.bottom = SrcHeight - Rect.top;
+        SrcStride = -(int64_t)sizeof(PIXEL);
+        break;
+
+    default:
+        DstRect.left = Rect.top;
+        DstRect.right = Rect.bottom;
+        DstRect.top = SrcWidth - Rect.right;
+        DstRect.bottom = SrcWidth - Rect.left;
+        SrcStride = SrcPitch;
+        break;
+    }
+
+    for (int32_t y = DstRect.top; y < DstRect.bottom; y++)
+    {
+        PIXEL  *pDstRow = (PIXEL *)(pDst->m_pBits + (int64_t)y*pDst->m_Pitch);
+
+        for (int32_t x = DstRect.left; x < DstRect.right; x += GC_KM_BLT_LINE_PIXELS)
+        {
+            int32_t SrcX, SrcY;
+            int32_t NumPixels = DstRect.right - x;
+
+            if (NumPixels > GC_KM_BLT_LINE_PIXELS)
+            {
+                NumPixels = GC_KM_BLT_LINE_PIXELS;
+            }
+
+            switch (Rotation)
+            {
+            case GcKmBltRotation90:
+                SrcX = y;
+                SrcY = SrcHeight - 1 - x;
+                break;
+
+            case GcKmBltRotation180:
+                SrcX = SrcWidth - 1 - x;
+                SrcY = SrcHeight - 1 - y;
+                break;
+
+            default:
+                SrcX = SrcWidth - 1 - y;
+                SrcY = x;
+                break;
+            }
+
+            const uint8_t  *pSrcPixel = pSrc->m_pBits + SrcY*SrcPitch + (int64_t)SrcX*sizeof(PIXEL);
+
+            for (int32_t i = 0; i < NumPixels; i++)
+            {
+                LineBuffer[i] = *(const PIXEL *)pSrcPixel;
+                pSrcPixel += SrcStride;
+            }
+
+            CopyRow((uint8_t *)(pDstRow + x), (const uint8_t *)LineBuffer, NumPixels*sizeof(PIXEL));
+        }
+    }
+}
+
+static void
+CopyRect(
+    const GcKmBltSurface   *pSrc,
+    const GcKmBltSurface   *pDst,
+    uint32_t                BytesPerPixel,
+    GcKmBltRotation         Rotation,
+    const GcKmBltRect&      Rect,
+    GcKmBltStats           *pStats)
+{
+    pStats->m_BytesCopied += (uint64_t)RectArea(Rect)*BytesPerPixel;
+
+    if (GcKmBltRotationIdentity != Rotation)
+    {
+        if (4 == BytesPerPixel)
+        {
+            CopyRectRotated<uint32_t>(pSrc, pDst, Rotation, Rect);
+        }
+        else
+        {
+            CopyRectRotated<uint16_t>(pSrc, pDst, Rotation, Rect);
+        }
+
+        return;
+    }
+
+    size_t          RowSize = (size_t)(Rect.right - Rect.left)*BytesPerPixel;
+    const uint8_t  *pSrcRow = pSrc->m_pBits + (int64_t)Rect.top*pSrc->m_Pitch + (int64_t)Rect.left*BytesPerPixel;
+    uint8_t        *pDstRow = pDst->m_pBits + (int64_t)Rect.top*pDst->m_Pitch + (int64_t)Rect.left*BytesPerPixel;
+
+    for (int32_t y = Rect.top; y < Rect.bottom; y++)
+    {
+        CopyRow(pDstRow, pSrcRow, RowSize);
+
+        pSrcRow += pSrc->m_Pitch;
+        pDstRow += pDst->m_Pitch;
+    }
+}
+
+//
+// Compares the source rectangle against the shadow copy and refreshes
+// the shadow from the first differing row on. Returns true if they differ.
+//
+
+static bool
+UpdateShadow(
+    const GcKmBltSurface   *pSrc,
+    const GcKmBltTileCache *pTileCache,
+    uint32_t                BytesPerPixel,
+    const GcKmBltRect&      Rect,
+    bool                    bCompare)
+{
+    size_t          RowSize = (size_t)(Rect.right - Rect.left)*BytesPerPixel;
+    const uint8_t  *pSrcRow = pSrc->m_pBits + (int64_t)Rect.top*pSrc->m_Pitch + (int64_t)Rect.left*BytesPerPixel;
+    uint8_t        *pShadowRow = pTileCache->m_pShadow + (int64_t)Rect.top*pTileCache->m_ShadowPitch + (int64_t)Rect.left*BytesPerPixel;
+    bool            bDiffers = !bCompare;
+
+    for (int32_t y = Rect.top; y < Rect.bottom; y++)
+    {
+        if (!bDiffers && (0 != memcmp(pShadowRow, pSrcRow, RowSize)))
+        {
+            bDiffers = true;
+        }
+
+        if (bDiffers)
+        {
+            memcpy(pShadowRow, pSrcRow, RowSize);
+        }
+
+        pSrcRow += pSrc->m_Pitch;
+        pShadowRow += pTileCache->m_ShadowPitch;
+    }
+
+    return bDiffers;
+}
+
+bool
+GcKmBltPresent(
+    const GcKmBltSurface   *pSrc,
+    const GcKmBltSurface   *pDst,
+    uint32_t                BytesPerPixel,
+    GcKmBltRotation         Rotation,
+    const GcKmBltRect      *pDirtyRects,
+    uint32_t                NumDirtyRects,
+    GcKmBltTileCache       *pTileCache,
+    GcKmBltStats           *pStats)
+{
+    GcKmBltRect     Merged[GC_KM_BLT_MAX_RECTS];
+    GcKmBltStats    Stats;
+    bool            bTransposed = (GcKmBltRotation90 == Rotation) || (GcKmBltRotation270 == Rotation);
+
+    if (NULL == pStats)
+    {
+        pStats = &Stats;
+    }
+
+    memset(pStats, 0, sizeof(*pStats));
+
+    if ((2 != BytesPerPixel) && (4 != BytesPerPixel))
+    {
+        return false;
+    }
+
+    if ((pDst->m_Width < (bTransposed ? pSrc->m_Height : pSrc->m_Width)) ||
+        (pDst->m_Height < (bTransposed ? pSrc->m_Width : pSrc->m_Height)))
+    {
+        return false;
+    }
+
+    uint32_t    NumMerged = GcKmBltMergeRects(pDirtyRects, NumDirtyRects, pSrc->m_Width, pSrc->m_Height, Merged);
+
+    pStats->m_NumDirtyRects = NumDirtyRects;
+    pStats->m_NumMergedRects = NumMerged;
+
+    uint32_t    TilesX, TilesY;
+
+    GcKmBltGetTileCount(pSrc->m_Width, pSrc->m_Height, &TilesX, &TilesY);
+
+    if (pTileCache &&
+        ((NULL == pTileCache->m_pTiles) || (NULL == pTileCache->m_pShadow) ||
+         (TilesX != pTileCache->m_TilesX) || (TilesY != pTileCache->m_TilesY) ||
+         (pTileCache->m_ShadowPitch < pSrc->m_Width*BytesPerPixel)))
+    {
+        pTileCache = NULL;
+    }
+
+    //
+    // Rectangles smaller than a tile are cheaper to copy than to compare,
+    // they only invalidate the tiles they touch
+    //
+
+    uint32_t    NumTiled = 0;
+
+    for (uint32_t i = 0; i < NumMerged; i++)
+    {
+        const GcKmBltRect&  Rect = Merged[i];
+
+        if (pTileCache && (RectArea(Rect) >= (GC_KM_BLT_TILE_SIZE*GC_KM_BLT_TILE_SIZE)))
+        {
+            Merged[NumTiled++] = Rect;
+            continue;
+        }
+
+        CopyRect(pSrc, pDst, BytesPerPixel, Rotation, Rect, pStats);
+
+        if (pTileCache)
+        {
+            for (int32_t ty = Rect.top/GC_KM_BLT_TILE_SIZE; ty <= (Rect.bottom - 1)/GC_KM_BLT_TILE_SIZE; ty++)
+            {
+                for (int32_t tx = Rect.left/GC_KM_BLT_TILE_SIZE; tx <= (Rect.right - 1)/GC_KM_BLT_TILE_SIZE; tx++)
+                {
+                    pTileCache->m_pTiles[ty*TilesX + tx].m_bValid = 0;
+                }
+            }
+        }
+    }
+
+    if (0 == NumTiled)
+    {
+        return true;
+    }
+
+    GcKmBltRect Bounds = Merged[0];
+
+    for (uint32_t i = 1; i < NumTiled; i++)
+    {
+        Bounds = UnionRect(Bounds, Merged[i]);
+    }
+
+    for (int32_t ty = Bounds.top/GC_KM_BLT_TILE_SIZE; ty <= (Bounds.bottom - 1)/GC_KM_BLT_TILE_SIZE; ty++)
+    {
+        for (int32_t tx = Bounds.left/GC_KM_BLT_TILE_SIZE; tx <= (Bounds.right - 1)/GC_KM_BLT_TILE_SIZE; tx++)
+        {
+            GcKmBltRect Tile;
+
+            Tile.left = tx*GC_KM_BLT_TILE_SIZE;
+            Tile.top = ty*GC_KM_BLT_TILE_SIZE;
+            Tile.right = Tile.left + GC_KM_BLT_TILE_SIZE;
+            Tile.bottom = Tile.top + GC_KM_BLT_TILE_SIZE;
+            Tile.right = Tile.right > (int32_t)pSrc->m_Width ? (int32_t)pSrc->m_Width : Tile.right;
+            Tile.bottom = Tile.bottom > (int32_t)pSrc->m_Height ? (int32_t)pSrc->m_Height : Tile.bottom;
+
+            bool    bDirty = false;
+
+            for (uint32_t i = 0; i < NumTiled; i++)
+            {
+                if (IntersectArea(Tile, Merged[i]))
+                {
+                    bDirty = true;
+                    break;
+                }
+            }
+
+            if (!bDirty)
+            {
+                continue;
+            }
+
+            //
+            // The source holds the whole frame, so the entire tile is copied
+            //
+
+            GcKmBltTile    *pTile = &pTileCache->m_pTiles[ty*TilesX + tx];
+
+            if (!UpdateShadow(pSrc, pTileCache, BytesPerPixel, Tile, (0 != pTile->m_bValid)))
+            {
+                pStats->m_NumTilesSkipped++;
+                continue;
+            }
+
+            CopyRect(pSrc, pDst, BytesPerPixel, Rotation, Tile, pStats);
+
+            pTile->m_bValid = 1;
+
+            pStats->m_NumTilesCopied++;
+        }
+    }
+
+    return true;
+}
+
@@ -0,0 +1,140 @@
+/* Copyright (c) Microsoft Corporation.
+ * Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdint.h>
+
+//
+// CPU blitter for display-only presents
+//
+// The functions here have no OS dependency, so they can be built and
+// benchmarked on the host.
+//
+// Dirty rectangles are clipped and merged with their overlapping or adjacent
+// neighbours, then copied (and rotated) into the write combined frame buffer
+// with whole 64 byte bursts. With a tile cache, the source is compared per
+// GC_KM_BLT_TILE_SIZE square tile against a shadow copy of what was last
+// written to the frame buffer and tiles whose content did not change since
+// the last present are skipped. The shadow costs one source sized system
+// memory surface, it is what makes the skip exact.
+//
+
+#define GC_KM_BLT_MAX_RECTS     64
+#define GC_KM_BLT_TILE_SIZE     64
+
+//
+// Rotation of the source relative to the frame buffer, clockwise
+//
+
+enum GcKmBltRotation
+{
+    GcKmBltRotationIdentity = 0,
+    GcKmBltRotation90,
+    GcKmBltRotation180,
+    GcKmBltRotation270
+};
+
+//
+// Same layout as RECT
+//
+
+struct GcKmBltRect
+{
+    int32_t     left;
+    int32_t     top;
+    int32_t     right;
+    int32_t     bottom;
+};
+
+struct GcKmBltSurface
+{
+    uint8_t    *m_pBits;
+    uint32_t    m_Width;
+    uint32_t    m_Height;
+    uint32_t    m_Pitch;
+};
+
+struct GcKmBltTile
+{
+    uint32_t    m_bValid;   // Shadow matches the frame buffer
+};
+
+struct GcKmBltTileCache
+{
+    GcKmBltTile    *m_pTiles;
+    uint32_t        m_TilesX;
+    uint32_t        m_TilesY;
+    uint8_t        *m_pShadow;      // Source sized, GcKmBltGetShadowSize() bytes
+    uint32_t        m_ShadowPitch;
+};
+
+struct GcKmBltStats
+{
+    uint32_t    m_NumDirtyRects;
+    uint32_t    m_NumMergedRects;
+    uint32_t    m_NumTilesCopied;
+    uint32_t    m_NumTilesSkipped;
+    uint64_t    m_BytesCopied;
+};
+
+//
+// Clips the rectangles to Width x Height and merges overlapping or adjacent
+// ones, pMerged must hold GC_KM_BLT_MAX_RECTS. Returns the merged count.
+//
+
+uint32_t
+GcKmBltMergeRects(
+    const GcKmBltRect  *pRects,
+    uint32_t            NumRects,
+    uint32_t            Width,
+    uint32_t            Height,
+    GcKmBltRect        *pMerged);
+
+//
+// Number of GcKmBltTile entries needed for a Width x Height source
+//
+
+uint32_t
+GcKmBltGetTileCount(
+    uint32_t    Width,
+    uint32_t    Height,
+    uint32_t   *pTilesX,
+    uint32_t   *pTilesY);
+
+//
+// Size of the tile cache shadow surface for a Width x Height source
+//
+
+uint32_t
+GcKmBltGetShadowSize(
+    uint32_t    Width,
+    uint32_t    Height,
+    uint32_t    BytesPerPixel,
+    uint32_t   *pShadowPitch);
+
+void
+GcKmBltInvalidateTileCache(
+    GcKmBltTileCache   *pTileCache);
+
+//
+// Copies the dirty rectangles (in source coordinates) of pSrc into pDst.
+// pDst is in frame buffer coordinates, its width and height are swapped
+// against pSrc for 90 and 270 degree rotations. pTileCache and pStats
+// are optional.
+//
+// Returns false for an unsupported pixel size or mismatching surfaces.
+//
+
+bool
+GcKmBltPresent(
+    const GcKmBltSurface   *pSrc,
+    const GcKmBltSurface   *pDst,
+    uint32_t                BytesPerPixel,
+    GcKmBltRotation         Rotation,
+    const GcKmBltRect      *pDirtyRects,
+    uint32_t                NumDirtyRects,
+    GcKmBltTileCache       *pTileCache,
+    GcKmBltStats           *pStats);
+
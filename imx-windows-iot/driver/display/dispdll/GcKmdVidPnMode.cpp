@@ -154,6 +154,18 @@ GcKmBaseDisplay::ProcessVidPnPathAttributes(
         ModifiedVidPnPath.ContentTransformation.RotationSupport = D3DKMDT_VIDPN_PRESENT_PATH_ROTATION_SUPPORT{};
         ModifiedVidPnPath.ContentTransformation.RotationSupport.Identity = TRUE;
         ModifiedVidPnPath.ContentTransformation.RotationSupport.Offset0 = TRUE;
+
+        //
+        // Display only presents are rotated by the CPU blitter (GcKmdBlt)
+        //
+
+        if (DisplayOnly == GcKmdGlobal::s_DriverMode)
+        {
+            ModifiedVidPnPath.ContentTransformation.RotationSupport.Rotate90 = TRUE;
+            ModifiedVidPnPath.ContentTransformation.RotationSupport.Rotate180 = TRUE;
+            ModifiedVidPnPath.ContentTransformation.RotationSupport.Rotate270 = TRUE;
+        }
+
         bVidPnPathNeedsUpdate = TRUE;
     }
 
@@ -41,6 +41,10 @@ void dcss_blkctl_cfg(struct dcss_blkctl *blkctl)
 
 	dcss_set(B_CLK_RESETN | APB_CLK_RESETN | P_CLK_RESETN | RTR_CLK_RESETN,
 		 blkctl->base_reg + DCSS_BLKCTL_RESET_CTRL);
+
+	/* the submodules start over from their reset values */
+	if (blkctl->dcss->ctxld)
+		dcss_ctxld_shadow_reset(blkctl->dcss->ctxld);
 }
 
 int dcss_blkctl_init(struct dcss_dev *dcss, unsigned long blkctl_base)
@@ -65,6 +65,34 @@ struct dcss_ctxld_item {
 
 #define CTX_ITEM_SIZE			sizeof(struct dcss_ctxld_item)
 
+/*
+ * Shadow register file, used to drop writes of values the hardware already
+ * has (or will have once the pending contexts are loaded) and to coalesce
+ * back to back writes to the same register within one context.
+ *
+ * It is a small open addressing cache keyed by register offset. Losing an
+ * entry only costs a redundant write, so entries not queued in the current
+ * context are recycled when a probe sequence is full.
+ */
+#define CTXLD_SHADOW_ENTRIES		4096	/* power of 2 */
+#define CTXLD_SHADOW_PROBES		8
+#define CTXLD_SHADOW_BYPASS_RANGES	4
+
+struct dcss_ctxld_shadow_reg {
+	u32 ofs;
+	u32 val;
+	u32 gen;	/* item_idx is valid if gen matches ctxld->shadow_gen */
+	u16 item_idx;
+	u8 ctx_id;
+	u8 used : 1;
+	u8 known : 1;	/* val is what the hardware will hold */
+};
+
+struct dcss_ctxld_shadow_range {
+	u32 start;
+	u32 end;
+};
+
 struct dcss_ctxld {
 	struct device *dev;
 	char __iomem *ctxld_reg;
@@ -84,6 +112,15 @@ struct dcss_ctxld {
 	bool in_use;
 	bool armed;
 
+	struct dcss_ctxld_shadow_reg *shadow;
+	u32 shadow_gen;
+
+	/* registers with side effects, always written */
+	struct dcss_ctxld_shadow_range bypass[CTXLD_SHADOW_BYPASS_RANGES];
+	int num_bypass;
+
+	struct dcss_ctxld_stats stats;
+
 	spinlock_t lock; /* protects concurent access to private data */
 };
 
@@ -172,6 +209,74 @@ static void dcss_ctxld_free_ctx(struct dcss_ctxld *ctxld)
 	}
 }
 
+static void dcss_ctxld_shadow_reset_locked(struct dcss_ctxld *ctxld)
+{
+	memset(ctxld->shadow, 0,
+	       CTXLD_SHADOW_ENTRIES * sizeof(*ctxld->shadow));
+
+	ctxld->shadow_gen = 1;
+}
+
+static inline u32 dcss_ctxld_shadow_hash(u32 reg_ofs)
+{
+	return ((reg_ofs >> 2) * 0x9e3779b1) >> 20;
+}
+
+static bool dcss_ctxld_shadow_is_bypassed(struct dcss_ctxld *ctxld,
+					  u32 reg_ofs)
+{
+	int i;
+
+	for (i = 0; i < ctxld->num_bypass; i++) {
+		if (reg_ofs >= ctxld->bypass[i].start &&
+		    reg_ofs < ctxld->bypass[i].end)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Looks up reg_ofs in the shadow register file. With insert, a free or
+ * recyclable slot is claimed for it, its value unknown. Returns NULL if the
+ * register is not (or cannot be) tracked.
+ */
+static struct dcss_ctxld_shadow_reg *
+dcss_ctxld_shadow_find(struct dcss_ctxld *ctxld, u32 reg_ofs, bool insert)
+{
+	struct dcss_ctxld_shadow_reg *reg, *free_reg = NULL, *stale_reg = NULL;
+	u32 idx = dcss_ctxld_shadow_hash(reg_ofs);
+	int i;
+
+	for (i = 0; i < CTXLD_SHADOW_PROBES; i++) {
+		reg = &ctxld->shadow[idx];
+
+		if (!reg->used) {
+			if (!free_reg)
+				free_reg = reg;
+		} else if (reg->ofs == reg_ofs) {
+			return reg;
+		} else if (!stale_reg && reg->gen != ctxld->shadow_gen) {
+			stale_reg = reg;
+		}
+
+		idx = (idx + 1) & (CTXLD_SHADOW_ENTRIES - 1);
+	}
+
+	if (!insert)
+		return NULL;
+
+	reg = free_reg ? free_reg : stale_reg;
+	if (!reg)
+		return NULL;
+
+	memset(reg, 0, sizeof(*reg));
+	reg->ofs = reg_ofs;
+	reg->used = 1;
+
+	return reg;
+}
+
 static int dcss_ctxld_alloc_ctx(struct dcss_ctxld *ctxld)
 {
 	struct dcss_ctxld_item *ctx;
@@ -219,6 +324,16 @@ int dcss_ctxld_init(struct dcss_dev *dcss, unsigned long ctxld_base)
 		goto err;
 	}
 
+	ctxld->shadow = kcalloc(CTXLD_SHADOW_ENTRIES, sizeof(*ctxld->shadow),
+				GFP_KERNEL);
+	if (!ctxld->shadow) {
+		dev_err(dcss->dev, "ctxld: cannot allocate shadow registers.\n");
+		ret = -ENOMEM;
+		goto err;
+	}
+
+	dcss_ctxld_shadow_reset_locked(ctxld);
+
 	ctxld->ctxld_reg = ioremap(ctxld_base, SZ_4K);
 	if (!ctxld->ctxld_reg) {
 		dev_err(dcss->dev, "ctxld: unable to remap ctxld base\n");
@@ -239,19 +354,38 @@ err_irq:
 
 err:
 	dcss_ctxld_free_ctx(ctxld);
+	kfree(ctxld->shadow);
 	kfree(ctxld);
 
 	return ret;
 }
 
+static void dcss_ctxld_print_stats(struct dcss_ctxld *ctxld)
+{
+	struct dcss_ctxld_stats *stats = &ctxld->stats;
+
+	dev_dbg(ctxld->dev,
+		 "ctxld: %llu kicks, %llu writes: %llu queued, %llu dropped, %llu coalesced\n",
+		 stats->kicks, stats->writes, stats->queued, stats->dropped,
+		 stats->coalesced);
+	dev_dbg(ctxld->dev,
+		 "ctxld: peak occupancy db=%d/%d, sb_hp=%d/%d, sb_lp=%d/%d\n",
+		 stats->peak_size[CTX_DB], CTXLD_DB_CTX_ENTRIES,
+		 stats->peak_size[CTX_SB_HP], CTXLD_SB_HP_CTX_ENTRIES,
+		 stats->peak_size[CTX_SB_LP], CTXLD_SB_LP_CTX_ENTRIES);
+}
+
 void dcss_ctxld_exit(struct dcss_ctxld *ctxld)
 {
 	free_irq(ctxld->irq, ctxld);
 
+	dcss_ctxld_print_stats(ctxld);
+
 	if (ctxld->ctxld_reg)
 		iounmap(ctxld->ctxld_reg, SZ_4K);
 
 	dcss_ctxld_free_ctx(ctxld);
+	kfree(ctxld->shadow);
 	kfree(ctxld);
 }
 
@@ -260,6 +394,7 @@ static int dcss_ctxld_enable_locked(struct dcss_ctxld *ctxld)
 	int curr_ctx = ctxld->current_ctx;
 	u32 db_base, sb_base, sb_count;
 	u32 sb_hp_cnt, sb_lp_cnt, db_cnt;
+	int i;
 	struct dcss_dev *dcss = dcss_drv_dev_to_dcss(ctxld->dev);
 
 	if (!dcss)
@@ -278,6 +413,16 @@ static int dcss_ctxld_enable_locked(struct dcss_ctxld *ctxld)
 	sb_lp_cnt = ctxld->ctx_size[curr_ctx][CTX_SB_LP];
 	db_cnt = ctxld->ctx_size[curr_ctx][CTX_DB];
 
+	ctxld->stats.kicks++;
+	ctxld->stats.last_size[CTX_DB] = db_cnt;
+	ctxld->stats.last_size[CTX_SB_HP] = sb_hp_cnt;
+	ctxld->stats.last_size[CTX_SB_LP] = sb_lp_cnt;
+
+	for (i = 0; i < 3; i++) {
+		if (ctxld->stats.last_size[i] > ctxld->stats.peak_size[i])
+			ctxld->stats.peak_size[i] = ctxld->stats.last_size[i];
+	}
+
 	/* make sure SB_LP context area comes after SB_HP */
 	if (sb_lp_cnt &&
 	    ctxld->sb_lp[curr_ctx] != ctxld->sb_hp[curr_ctx] + sb_hp_cnt) {
@@ -320,6 +465,10 @@ static int dcss_ctxld_enable_locked(struct dcss_ctxld *ctxld)
 	ctxld->ctx_size[ctxld->current_ctx][CTX_SB_HP] = 0;
 	ctxld->ctx_size[ctxld->current_ctx][CTX_SB_LP] = 0;
 
+	/* shadow entries no longer point into the new context */
+	if (!++ctxld->shadow_gen)
+		dcss_ctxld_shadow_reset_locked(ctxld);
+
 	return 0;
 }
 
@@ -353,6 +502,31 @@ void dcss_ctxld_write_irqsafe(struct dcss_ctxld *ctxld, u32 ctx_id, u32 val,
 	ctx[CTX_SB_HP] = ctxld->sb_hp[curr_ctx];
 	ctx[CTX_SB_LP] = ctxld->sb_lp[curr_ctx];
 
+	struct dcss_ctxld_shadow_reg *reg = NULL;
+
+	ctxld->stats.writes++;
+
+	if (!dcss_ctxld_shadow_is_bypassed(ctxld, reg_ofs))
+		reg = dcss_ctxld_shadow_find(ctxld, reg_ofs, true);
+
+	if (reg && reg->gen == ctxld->shadow_gen && reg->ctx_id == ctx_id) {
+		/*
+		 * Already queued in this context. Only the most recent item can
+		 * be overwritten in place, an older one would be moved ahead of
+		 * the writes queued after it. Otherwise append.
+		 */
+		if (reg->item_idx + 1 == ctxld->ctx_size[curr_ctx][ctx_id]) {
+			ctx[ctx_id][reg->item_idx].val = val;
+			reg->val = val;
+			reg->known = 1;
+			ctxld->stats.coalesced++;
+			return;
+		}
+	} else if (reg && reg->known && reg->val == val) {
+		ctxld->stats.dropped++;
+		return;
+	}
+
 	int item_idx = ctxld->ctx_size[curr_ctx][ctx_id];
 
 	if (item_idx + 1 > dcss_ctxld_ctx_size[ctx_id]) {
@@ -363,6 +537,15 @@ void dcss_ctxld_write_irqsafe(struct dcss_ctxld *ctxld, u32 ctx_id, u32 val,
 	ctx[ctx_id][item_idx].val = val;
 	ctx[ctx_id][item_idx].ofs = reg_ofs;
 	ctxld->ctx_size[curr_ctx][ctx_id] += 1;
+	ctxld->stats.queued++;
+
+	if (reg) {
+		reg->val = val;
+		reg->known = 1;
+		reg->gen = ctxld->shadow_gen;
+		reg->item_idx = (u16)item_idx;
+		reg->ctx_id = (u8)ctx_id;
+	}
 }
 
 void dcss_ctxld_write(struct dcss_ctxld *ctxld, u32 ctx_id,
@@ -373,6 +556,64 @@ void dcss_ctxld_write(struct dcss_ctxld *ctxld, u32 ctx_id,
 	spin_unlock_irq(&ctxld->lock);
 }
 
+/*
+ * Registers in [reg_ofs, reg_ofs + size) have side effects (self clearing
+ * or trigger bits) and must be written every time.
+ */
+void dcss_ctxld_shadow_bypass(struct dcss_ctxld *ctxld, u32 reg_ofs, u32 size)
+{
+	spin_lock_irq(&ctxld->lock);
+
+	if (ctxld->num_bypass < CTXLD_SHADOW_BYPASS_RANGES) {
+		ctxld->bypass[ctxld->num_bypass].start = reg_ofs;
+		ctxld->bypass[ctxld->num_bypass].end = reg_ofs + size;
+		ctxld->num_bypass++;
+	} else {
+		WARN_ON(1);
+	}
+
+	spin_unlock_irq(&ctxld->lock);
+}
+
+/*
+ * Must be called when a register is written directly, bypassing the context
+ * loader, so the next write through the context loader is not dropped.
+ */
+void dcss_ctxld_shadow_invalidate(struct dcss_ctxld *ctxld, u32 reg_ofs)
+{
+	struct dcss_ctxld_shadow_reg *reg;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ctxld->lock, flags);
+
+	reg = dcss_ctxld_shadow_find(ctxld, reg_ofs, false);
+	if (reg)
+		reg->known = 0;
+
+	spin_unlock_irqrestore(&ctxld->lock, flags);
+}
+
+/*
+ * Must be called whenever the DCSS loses its register contents (block reset,
+ * power gating), nothing the shadow holds is in the hardware anymore.
+ */
+void dcss_ctxld_shadow_reset(struct dcss_ctxld *ctxld)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&ctxld->lock, flags);
+	dcss_ctxld_shadow_reset_locked(ctxld);
+	spin_unlock_irqrestore(&ctxld->lock, flags);
+}
+
+void dcss_ctxld_get_stats(struct dcss_ctxld *ctxld,
+			  struct dcss_ctxld_stats *stats)
+{
+	spin_lock_irq(&ctxld->lock);
+	*stats = ctxld->stats;
+	spin_unlock_irq(&ctxld->lock);
+}
+
 bool dcss_ctxld_is_flushed(struct dcss_ctxld *ctxld)
 {
 	return ctxld->ctx_size[ctxld->current_ctx][CTX_DB] == 0 &&
@@ -384,6 +625,9 @@ int dcss_ctxld_resume(struct dcss_ctxld *ctxld)
 {
 	dcss_ctxld_hw_cfg(ctxld);
 
+	/* the block comes back from power gating and reset with defaults */
+	dcss_ctxld_shadow_reset(ctxld);
+
 	if (!ctxld->irq_en) {
 		enable_irq(ctxld->irq);
 		ctxld->irq_en = true;
@@ -420,8 +664,13 @@ int dcss_ctxld_suspend(struct dcss_ctxld *ctxld)
 	ctxld->ctx_size[0][CTX_SB_HP] = 0;
 	ctxld->ctx_size[0][CTX_SB_LP] = 0;
 
+	/* register contents are lost while the block is powered down */
+	dcss_ctxld_shadow_reset_locked(ctxld);
+
 	spin_unlock_irq(&ctxld->lock);
 
+	dcss_ctxld_print_stats(ctxld);
+
 	return ret;
 }
 
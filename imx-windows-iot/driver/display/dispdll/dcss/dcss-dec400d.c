@@ -87,6 +87,9 @@ int dcss_dec400d_init(struct dcss_dev *dcss, unsigned long dec400d_base)
 
 	dec400d->ctx_id = CTX_SB_HP;
 
+	/* the clear and flush registers are triggers, never drop them */
+	dcss_ctxld_shadow_bypass(dec400d->ctxld, dec400d_base, SZ_4K);
+
 	return 0;
 
 free_mem:
@@ -126,6 +126,16 @@ void dcss_blkctl_cfg(struct dcss_blkctl *blkctl);
 void dcss_blkctl_exit(struct dcss_blkctl *blkctl);
 
 /* CTXLD */
+struct dcss_ctxld_stats {
+	u64 kicks;
+	u64 writes;		/* requested through dcss_ctxld_write*() */
+	u64 queued;		/* added to a context */
+	u64 dropped;		/* value already in the hardware */
+	u64 coalesced;		/* overwrote the last entry of the same context */
+	u16 last_size[3];	/* DB, SB_HP and SB_LP entries of the last kick */
+	u16 peak_size[3];
+};
+
 int dcss_ctxld_init(struct dcss_dev *dcss, unsigned long ctxld_base);
 void dcss_ctxld_exit(struct dcss_ctxld *ctxld);
 void dcss_ctxld_write(struct dcss_ctxld *ctxld, u32 ctx_id,
@@ -144,6 +154,12 @@ void dcss_ctxld_register_dtrc_cb(struct dcss_ctxld *ctxld,
 	bool(*cb)(void *),
 	void *data);
 bool dcss_ctxld_is_armed(struct dcss_ctxld *ctxld);
+void dcss_ctxld_shadow_bypass(struct dcss_ctxld *ctxld, u32 reg_ofs,
+	u32 size);
+void dcss_ctxld_shadow_invalidate(struct dcss_ctxld *ctxld, u32 reg_ofs);
+void dcss_ctxld_shadow_reset(struct dcss_ctxld *ctxld);
+void dcss_ctxld_get_stats(struct dcss_ctxld *ctxld,
+	struct dcss_ctxld_stats *stats);
 
 /* DPR */
 int dcss_dpr_init(struct dcss_dev *dcss, unsigned long dpr_base);
@@ -619,8 +619,11 @@ void dcss_dpr_addr_set_no_ctxld(struct dcss_dpr *dpr, int ch_num,
 {
 	struct dcss_dpr_ch *ch = &dpr->ch[ch_num];
 
-	if (!dcss_dtrc_ch_running(dpr->dtrc, ch_num))
+	if (!dcss_dtrc_ch_running(dpr->dtrc, ch_num)) {
 		dcss_writel(base_addr, ch->base_reg + DCSS_DPR_FRAME_1P_BASE_ADDR);
+		dcss_ctxld_shadow_invalidate(dpr->ctxld, ch->base_ofs +
+					     DCSS_DPR_FRAME_1P_BASE_ADDR);
+	}
 }
 
 void dcss_dpr_tile_set_no_ctxld(struct dcss_dpr *dpr,
@@ -631,6 +634,8 @@ void dcss_dpr_tile_set_no_ctxld(struct dcss_dpr *dpr,
 	dcss_dpr_tile_set(ch, modifier);
 
 	dcss_writel(ch->mode_ctrl, ch->base_reg + DCSS_DPR_MODE_CTRL0);
+	dcss_ctxld_shadow_invalidate(dpr->ctxld,
+				     ch->base_ofs + DCSS_DPR_MODE_CTRL0);
 }
 
 void dcss_dpr_tile_set_ctxld(struct dcss_dpr *dpr,
@@ -340,6 +340,8 @@ void dcss_dtg_shutoff(struct dcss_dtg *dtg)
 
 	dcss_writel(dtg->control_status,
 		    dtg->base_reg + DCSS_DTG_TC_CONTROL_STATUS);
+	dcss_ctxld_shadow_invalidate(dtg->ctxld,
+				     dtg->base_ofs + DCSS_DTG_TC_CONTROL_STATUS);
 
 	dtg->in_use = false;
 }
@@ -209,6 +209,9 @@ int dcss_dtrc_init(struct dcss_dev *dcss, unsigned long dtrc_base)
 	dtrc->ctxld = dcss->ctxld;
 	dtrc->ctx_id = CTX_SB_HP;
 
+	/* CONFIG_READY self clears, rewrite DTRC registers every time */
+	dcss_ctxld_shadow_bypass(dtrc->ctxld, dtrc_base, 2 * SZ_4K);
+
 	if (dcss_dtrc_ch_init_all(dtrc, dtrc_base)) {
 		struct dcss_dtrc_ch *ch;
 		int i;
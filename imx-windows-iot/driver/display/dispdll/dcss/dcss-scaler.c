@@ -7,6 +7,7 @@
 
 #include <linux/device.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 
 #include "dcss-dev.h"
 
@@ -81,19 +82,6 @@ struct dcss_scaler_ch {
 	int ch_num;
 };
 
-struct dcss_scaler {
-	struct device *dev;
-
-	struct dcss_ctxld *ctxld;
-	u32 ctx_id;
-
-	struct dcss_scaler_ch ch[3];
-
-	struct dcss_wrscl *wrscl;
-	struct dcss_rdsrc *rdsrc;
-	int ch_using_wrscl;
-};
-
 /* scaler coefficients generator */
 #define PSC_FRAC_BITS 30
 #define PSC_FRAC_SCALE BIT(PSC_FRAC_BITS)
@@ -108,6 +96,46 @@ struct dcss_scaler {
 #define PSC_Q_FRACTION 19
 #define PSC_Q_ROUND_OFFSET (1 << (PSC_Q_FRACTION - 1))
 
+/*
+ * Number of designed filters kept around. The coefficients only depend on
+ * the cutoff frequency, the number of taps and the phase 0 override, so a
+ * full plane update (4 filters) of a resizing overlay mostly hits the cache.
+ */
+#define PSC_COEF_CACHE_ENTRIES 16
+
+#define PSC_COEF_5_TAPS		BIT(0)
+#define PSC_COEF_PHASE0_IDENTITY	BIT(1)
+
+struct dcss_scaler_coef_entry {
+	int fc_q;
+	u32 flags;
+	u32 last_used;	/* 0 if the entry is empty */
+	int coef[PSC_STORED_PHASES][PSC_NUM_TAPS];
+};
+
+struct dcss_scaler_coef_cache {
+	spinlock_t lock; /* protects the entries and the counters */
+	u32 tick;
+	u32 hits;
+	u32 misses;
+	struct dcss_scaler_coef_entry entry[PSC_COEF_CACHE_ENTRIES];
+};
+
+struct dcss_scaler {
+	struct device *dev;
+
+	struct dcss_ctxld *ctxld;
+	u32 ctx_id;
+
+	struct dcss_scaler_ch ch[3];
+
+	struct dcss_wrscl *wrscl;
+	struct dcss_rdsrc *rdsrc;
+	int ch_using_wrscl;
+
+	struct dcss_scaler_coef_cache coef_cache;
+};
+
 /**
  * mult_q() - Performs fixed-point multiplication.
  * @A: multiplier
@@ -249,19 +277,104 @@ static void dcss_scaler_gaussian_filter(int fc_q, bool use_5_taps,
 	}
 }
 
+/**
+ * dcss_scaler_coef_lookup() - Look up previously designed coefficients.
+ * @cache: coefficient cache
+ * @fc_q: fixed-point cutoff frequency
+ * @flags: PSC_COEF_* flags
+ * @coef: output coefficients, filled on a hit
+ *
+ * Return: true on a hit.
+ */
+static bool dcss_scaler_coef_lookup(struct dcss_scaler_coef_cache *cache,
+				    int fc_q, u32 flags,
+				    int coef[][PSC_NUM_TAPS])
+{
+	struct dcss_scaler_coef_entry *entry;
+	unsigned long irqflags;
+	bool hit = false;
+	int i;
+
+	spin_lock_irqsave(&cache->lock, irqflags);
+
+	for (i = 0; i < PSC_COEF_CACHE_ENTRIES; i++) {
+		entry = &cache->entry[i];
+
+		if (entry->last_used && entry->fc_q == fc_q &&
+		    entry->flags == flags) {
+			memcpy(coef, entry->coef, sizeof(entry->coef));
+			entry->last_used = ++cache->tick;
+			hit = true;
+			break;
+		}
+	}
+
+	if (hit)
+		cache->hits++;
+	else
+		cache->misses++;
+
+	spin_unlock_irqrestore(&cache->lock, irqflags);
+
+	return hit;
+}
+
+/**
+ * dcss_scaler_coef_insert() - Store designed coefficients, replacing the
+ *			       least recently used entry.
+ * @cache: coefficient cache
+ * @fc_q: fixed-point cutoff frequency
+ * @flags: PSC_COEF_* flags
+ * @coef: coefficients to store
+ */
+static void dcss_scaler_coef_insert(struct dcss_scaler_coef_cache *cache,
+				    int fc_q, u32 flags,
+				    int coef[][PSC_NUM_TAPS])
+{
+	struct dcss_scaler_coef_entry *lru;
+	unsigned long irqflags;
+	int i;
+
+	spin_lock_irqsave(&cache->lock, irqflags);
+
+	lru = &cache->entry[0];
+	for (i = 1; i < PSC_COEF_CACHE_ENTRIES; i++) {
+		if (cache->entry[i].last_used < lru->last_used)
+			lru = &cache->entry[i];
+	}
+
+	lru->fc_q = fc_q;
+	lru->flags = flags;
+	memcpy(lru->coef, coef, sizeof(lru->coef));
+	lru->last_used = ++cache->tick;
+
+	/* restart the LRU order rather than wrap into "empty" */
+	if (cache->tick == U32_MAX) {
+		for (i = 0; i < PSC_COEF_CACHE_ENTRIES; i++)
+			if (cache->entry[i].last_used)
+				cache->entry[i].last_used = 1;
+		cache->tick = 1;
+	}
+
+	spin_unlock_irqrestore(&cache->lock, irqflags);
+}
+
 /**
  * dcss_scaler_filter_design() - Compute filter coefficients using
  *				 Gaussian filter.
+ * @scl: scaler, its coefficient cache is used
  * @src_length: length of input
  * @dst_length: length of output
  * @use_5_taps: 0 for 7 taps per phase, 1 for 5 taps
  * @coef: output coefficients
  */
-static void dcss_scaler_filter_design(int src_length, int dst_length,
+static void dcss_scaler_filter_design(struct dcss_scaler *scl,
+				      int src_length, int dst_length,
 				      bool use_5_taps, bool phase0_identity,
 				      int coef[][PSC_NUM_TAPS])
 {
 	int fc_q;
+	u32 flags;
 
 	/* compute cutoff frequency */
 	if (dst_length >= src_length)
@@ -269,8 +382,16 @@ static void dcss_scaler_filter_design(int src_length, int dst_length,
 	else
 		fc_q = div_q(dst_length, src_length * PSC_NUM_PHASES);
 
+	flags = (use_5_taps ? PSC_COEF_5_TAPS : 0) |
+		(phase0_identity ? PSC_COEF_PHASE0_IDENTITY : 0);
+
+	if (dcss_scaler_coef_lookup(&scl->coef_cache, fc_q, flags, coef))
+		return;
+
 	/* compute gaussian filter coefficients */
 	dcss_scaler_gaussian_filter(fc_q, use_5_taps, phase0_identity, coef);
+
+	dcss_scaler_coef_insert(&scl->coef_cache, fc_q, flags, coef);
 }
 
 static void dcss_scaler_write(struct dcss_scaler_ch *ch, u32 val, u32 ofs)
@@ -320,6 +441,8 @@ int dcss_scaler_init(struct dcss_dev *dcss, unsigned long scaler_base)
 	scaler->rdsrc = dcss->rdsrc;
 	scaler->ch_using_wrscl = -1;
 
+	spin_lock_init(&scaler->coef_cache.lock);
+
 	if (dcss_scaler_ch_init_all(scaler, scaler_base)) {
 		int i;
 
@@ -695,12 +818,12 @@ static void dcss_scaler_yuv_coef_set(struct dcss_scaler_ch *ch,
 			       src_format == BUF_FMT_ARGB8888_YUV444);
 
 	/* horizontal luma */
-	dcss_scaler_filter_design(src_xres, dst_xres, false,
+	dcss_scaler_filter_design(ch->scl, src_xres, dst_xres, false,
 				  src_xres == dst_xres, coef);
 	dcss_scaler_program_7_coef_set(ch, DCSS_SCALER_COEF_HLUM, coef);
 
 	/* vertical luma */
-	dcss_scaler_filter_design(src_yres, dst_yres, program_5_taps,
+	dcss_scaler_filter_design(ch->scl, src_yres, dst_yres, program_5_taps,
 				  src_yres == dst_yres, coef);
 
 	if (program_5_taps)
@@ -719,14 +842,14 @@ static void dcss_scaler_yuv_coef_set(struct dcss_scaler_ch *ch,
 		dst_yres >>= 1;
 
 	/* horizontal chroma */
-	dcss_scaler_filter_design(src_xres, dst_xres, false,
+	dcss_scaler_filter_design(ch->scl, src_xres, dst_xres, false,
 				  (src_xres == dst_xres) && (ch->c_hstart == 0),
 				  coef);
 
 	dcss_scaler_program_7_coef_set(ch, DCSS_SCALER_COEF_HCHR, coef);
 
 	/* vertical chroma */
-	dcss_scaler_filter_design(src_yres, dst_yres, program_5_taps,
+	dcss_scaler_filter_design(ch->scl, src_yres, dst_yres, program_5_taps,
 				  (src_yres == dst_yres) && (ch->c_vstart == 0),
 				  coef);
 	if (program_5_taps)
@@ -742,12 +865,12 @@ static void dcss_scaler_rgb_coef_set(struct dcss_scaler_ch *ch,
 	int coef[PSC_STORED_PHASES][PSC_NUM_TAPS];
 
 	/* horizontal RGB */
-	dcss_scaler_filter_design(src_xres, dst_xres, false,
+	dcss_scaler_filter_design(ch->scl, src_xres, dst_xres, false,
 				  src_xres == dst_xres, coef);
 	dcss_scaler_program_7_coef_set(ch, DCSS_SCALER_COEF_HLUM, coef);
 
 	/* vertical RGB */
-	dcss_scaler_filter_design(src_yres, dst_yres, false,
+	dcss_scaler_filter_design(ch->scl, src_yres, dst_yres, false,
 				  src_yres == dst_yres, coef);
 	dcss_scaler_program_7_coef_set(ch, DCSS_SCALER_COEF_VLUM, coef);
 }
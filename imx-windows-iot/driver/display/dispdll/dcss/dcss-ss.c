@@ -194,5 +194,6 @@ void dcss_ss_enable(struct dcss_ss *ss)
 void dcss_ss_shutoff(struct dcss_ss *ss)
 {
 	dcss_writel(0, ss->base_reg + DCSS_SS_SYS_CTRL);
+	dcss_ctxld_shadow_invalidate(ss->ctxld, ss->base_ofs + DCSS_SS_SYS_CTRL);
 	ss->in_use = false;
 }
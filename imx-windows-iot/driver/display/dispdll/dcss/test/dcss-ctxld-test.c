@@ -0,0 +1,475 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright 2023 NXP.
+ */
+
+/*
+ * Host replay test of the DCSS context loader shadow register file.
+ *
+ * Random register write sequences, kicks, direct writes, suspend/resume and
+ * block resets are replayed through dcss_ctxld_write(). A register model
+ * loads the contexts the way the hardware does and records every write it
+ * sees. The same sequence is also recorded without the shadow. Both traces
+ * must give the same register file, and the same order of value changes.
+ */
+
+#include "dcss-ctxld.c"
+#include "dcss-blkctl.c"
+#include "HostTest.h"
+
+int g_num_warnings;
+unsigned long long jiffies;
+
+/* DMA handles are the region index in the upper byte */
+#define MAX_DMA_REGIONS		8
+#define DMA_HANDLE_SHIFT	24
+
+static void *dma_regions[MAX_DMA_REGIONS];
+
+void *dma_alloc_coherent(struct device *dev, size_t size, dma_addr_t *handle,
+			 int gfp)
+{
+	int i;
+
+	(void)dev;
+	(void)gfp;
+
+	for (i = 0; i < MAX_DMA_REGIONS; i++) {
+		if (!dma_regions[i]) {
+			dma_regions[i] = calloc(1, size);
+			*handle = (dma_addr_t)(i + 1) << DMA_HANDLE_SHIFT;
+			return dma_regions[i];
+		}
+	}
+
+	return NULL;
+}
+
+void dma_free_coherent(struct device *dev, size_t size, void *vaddr,
+		       dma_addr_t handle)
+{
+	(void)dev;
+	(void)size;
+
+	assert(dma_regions[(handle >> DMA_HANDLE_SHIFT) - 1] == vaddr);
+
+	dma_regions[(handle >> DMA_HANDLE_SHIFT) - 1] = NULL;
+	free(vaddr);
+}
+
+static struct dcss_ctxld_item *dma_to_items(dma_addr_t addr)
+{
+	char *region = dma_regions[(addr >> DMA_HANDLE_SHIFT) - 1];
+
+	return (struct dcss_ctxld_item *)
+		(region + (addr & ((1 << DMA_HANDLE_SHIFT) - 1)));
+}
+
+/* The other DCSS submodules are not part of the test */
+static struct device test_device;
+static struct dcss_dev test_dcss;
+
+struct dcss_dev *dcss_drv_dev_to_dcss(struct device *dev)
+{
+	(void)dev;
+
+	return &test_dcss;
+}
+
+void dcss_dpr_write_sysctrl(struct dcss_dpr *dpr)
+{
+	(void)dpr;
+}
+
+void dcss_scaler_write_sclctrl(struct dcss_scaler *scl)
+{
+	(void)scl;
+}
+
+bool dcss_dtrc_is_running(struct dcss_dtrc *dtrc)
+{
+	(void)dtrc;
+
+	return false;
+}
+
+void dcss_dtrc_switch_banks(struct dcss_dtrc *dtrc)
+{
+	(void)dtrc;
+}
+
+/*
+ * Register model. The first BYPASS_REGS registers have side effects and
+ * must see every write.
+ */
+#define NUM_REGS		48
+#define BYPASS_REGS		4
+#define REG_BASE		0x20000
+#define REG_OFS(i)		((u32)(REG_BASE + (i) * 4))
+#define REG_IDX(ofs)		(((ofs) - REG_BASE) / 4)
+#define REG_CTX(i)		((i) % 3)
+
+#define TRACE_RESET		0xffffffff
+#define MAX_TRACE		200000
+
+struct trace {
+	u32 ofs[MAX_TRACE];
+	u32 val[MAX_TRACE];
+	int len;
+};
+
+static u32 hw_regs[NUM_REGS];
+static struct trace hw_trace;
+static struct trace ref_trace;
+
+/* writes queued without the shadow, per context type */
+static u32 ref_pending_ofs[3][CTXLD_SB_HP_CTX_ENTRIES];
+static u32 ref_pending_val[3][CTXLD_SB_HP_CTX_ENTRIES];
+static int ref_pending_len[3];
+
+static void trace_add(struct trace *t, u32 ofs, u32 val)
+{
+	assert(t->len < MAX_TRACE);
+
+	t->ofs[t->len] = ofs;
+	t->val[t->len] = val;
+	t->len++;
+}
+
+static void hw_write(u32 ofs, u32 val)
+{
+	hw_regs[REG_IDX(ofs)] = val;
+	trace_add(&hw_trace, ofs, val);
+}
+
+static void hw_load_items(struct dcss_ctxld_item *items, u32 count)
+{
+	u32 i;
+
+	for (i = 0; i < count; i++)
+		hw_write(items[i].ofs, items[i].val);
+}
+
+/* Runs the contexts the driver handed to the context loader, DB first */
+static void hw_run_ctxld(struct dcss_ctxld *ctxld)
+{
+	char *regs = ctxld->ctxld_reg;
+	u32 db_cnt = readl(regs + DCSS_CTXLD_DB_COUNT);
+	u32 sb_count = readl(regs + DCSS_CTXLD_SB_COUNT);
+	u32 sb_cnt = ((sb_count & SB_HP_COUNT_MASK) >> SB_HP_COUNT_POS) +
+		     ((sb_count & SB_LP_COUNT_MASK) >> SB_LP_COUNT_POS);
+
+	if (db_cnt)
+		hw_load_items(dma_to_items(readl(regs + DCSS_CTXLD_DB_BASE_ADDR)),
+			      db_cnt);
+	if (sb_cnt)
+		hw_load_items(dma_to_items(readl(regs + DCSS_CTXLD_SB_BASE_ADDR)),
+			      sb_cnt);
+
+	writel(SB_HP_COMP, regs + DCSS_CTXLD_CONTROL_STATUS);
+	dcss_ctxld_irq_handler(ctxld->irq, ctxld);
+}
+
+static void hw_reset(void)
+{
+	memset(hw_regs, 0, sizeof(hw_regs));
+	trace_add(&hw_trace, TRACE_RESET, 0);
+	trace_add(&ref_trace, TRACE_RESET, 0);
+}
+
+static void test_write(struct dcss_ctxld *ctxld, int reg, u32 val)
+{
+	int ctx_id = REG_CTX(reg);
+
+	ref_pending_ofs[ctx_id][ref_pending_len[ctx_id]] = REG_OFS(reg);
+	ref_pending_val[ctx_id][ref_pending_len[ctx_id]] = val;
+	ref_pending_len[ctx_id]++;
+
+	dcss_ctxld_write(ctxld, ctx_id, val, REG_OFS(reg));
+}
+
+static void test_kick(struct dcss_ctxld *ctxld)
+{
+	int ctx_id, i;
+
+	dcss_ctxld_enable(ctxld);
+	dcss_ctxld_kick(ctxld);
+
+	CHECK(ctxld->in_use);
+	hw_run_ctxld(ctxld);
+	CHECK(!ctxld->in_use);
+
+	for (ctx_id = 0; ctx_id < 3; ctx_id++) {
+		for (i = 0; i < ref_pending_len[ctx_id]; i++)
+			trace_add(&ref_trace, ref_pending_ofs[ctx_id][i],
+				  ref_pending_val[ctx_id][i]);
+
+		ref_pending_len[ctx_id] = 0;
+	}
+}
+
+/*
+ * A register written behind the context loader's back, like the DPR does.
+ * The order against items still pending in a context is undefined on the
+ * hardware too, so the context is flushed first.
+ */
+static void test_direct_write(struct dcss_ctxld *ctxld, int reg, u32 val)
+{
+	test_kick(ctxld);
+
+	hw_write(REG_OFS(reg), val);
+	trace_add(&ref_trace, REG_OFS(reg), val);
+
+	dcss_ctxld_shadow_invalidate(ctxld, REG_OFS(reg));
+}
+
+static void test_suspend_resume(struct dcss_ctxld *ctxld)
+{
+	test_kick(ctxld);
+
+	CHECK(0 == dcss_ctxld_suspend(ctxld));
+	hw_reset();
+	CHECK(0 == dcss_ctxld_resume(ctxld));
+}
+
+/* The block is only reset after suspend flushed the contexts */
+static void test_block_reset(struct dcss_ctxld *ctxld)
+{
+	test_kick(ctxld);
+
+	hw_reset();
+	dcss_blkctl_cfg(test_dcss.blkctl);
+}
+
+/*
+ * Reduces a trace to the value changes it makes, starting from reset values:
+ * back to back writes of one register collapse into the last one and writes
+ * that do not change the register are removed, until neither applies.
+ */
+static void canonicalize(const struct trace *in, struct trace *out)
+{
+	static struct trace tmp;
+	u32 regs[NUM_REGS];
+	bool changed;
+	int i;
+
+	*out = *in;
+
+	do {
+		changed = false;
+		tmp.len = 0;
+
+		for (i = 0; i < out->len; i++) {
+			if (out->ofs[i] != TRACE_RESET && i + 1 < out->len &&
+			    out->ofs[i + 1] == out->ofs[i]) {
+				changed = true;
+				continue;
+			}
+
+			trace_add(&tmp, out->ofs[i], out->val[i]);
+		}
+
+		out->len = 0;
+		memset(regs, 0, sizeof(regs));
+
+		for (i = 0; i < tmp.len; i++) {
+			if (tmp.ofs[i] == TRACE_RESET) {
+				memset(regs, 0, sizeof(regs));
+			} else if (regs[REG_IDX(tmp.ofs[i])] == tmp.val[i]) {
+				changed = true;
+				continue;
+			} else {
+				regs[REG_IDX(tmp.ofs[i])] = tmp.val[i];
+			}
+
+			trace_add(out, tmp.ofs[i], tmp.val[i]);
+		}
+	} while (changed);
+}
+
+static int count_writes(const struct trace *t, int reg)
+{
+	int count = 0;
+	int i;
+
+	for (i = 0; i < t->len; i++) {
+		if (t->ofs[i] == REG_OFS(reg))
+			count++;
+	}
+
+	return count;
+}
+
+static void check_traces(void)
+{
+	static struct trace hw_canon, ref_canon;
+	u32 ref_regs[NUM_REGS];
+	int i;
+
+	memset(ref_regs, 0, sizeof(ref_regs));
+
+	for (i = 0; i < ref_trace.len; i++) {
+		if (ref_trace.ofs[i] == TRACE_RESET)
+			memset(ref_regs, 0, sizeof(ref_regs));
+		else
+			ref_regs[REG_IDX(ref_trace.ofs[i])] = ref_trace.val[i];
+	}
+
+	CHECK(0 == memcmp(hw_regs, ref_regs, sizeof(hw_regs)));
+
+	canonicalize(&hw_trace, &hw_canon);
+	canonicalize(&ref_trace, &ref_canon);
+
+	CHECK(hw_canon.len == ref_canon.len);
+	for (i = 0; i < hw_canon.len && i < ref_canon.len; i++) {
+		if (hw_canon.ofs[i] != ref_canon.ofs[i] ||
+		    hw_canon.val[i] != ref_canon.val[i]) {
+			printf("traces differ at change %d\n", i);
+			CHECK(false);
+			break;
+		}
+	}
+
+	for (i = 0; i < BYPASS_REGS; i++)
+		CHECK(count_writes(&hw_trace, i) == count_writes(&ref_trace, i));
+}
+
+static struct dcss_ctxld *test_init(void)
+{
+	memset(hw_regs, 0, sizeof(hw_regs));
+	memset(ref_pending_len, 0, sizeof(ref_pending_len));
+	hw_trace.len = 0;
+	ref_trace.len = 0;
+
+	memset(&test_dcss, 0, sizeof(test_dcss));
+	test_dcss.dev = &test_device;
+
+	CHECK(0 == dcss_blkctl_init(&test_dcss, 0));
+	CHECK(0 == dcss_ctxld_init(&test_dcss, 0));
+
+	dcss_ctxld_shadow_bypass(test_dcss.ctxld, REG_OFS(0), BYPASS_REGS * 4);
+
+	return test_dcss.ctxld;
+}
+
+static void test_exit(void)
+{
+	dcss_ctxld_exit(test_dcss.ctxld);
+	dcss_blkctl_exit(test_dcss.blkctl);
+}
+
+static void test_basic(void)
+{
+	struct dcss_ctxld *ctxld = test_init();
+	struct dcss_ctxld_stats stats;
+	int a = BYPASS_REGS, b = BYPASS_REGS + 3;	/* same context type */
+
+	/* back to back writes coalesce */
+	test_write(ctxld, a, 1);
+	test_write(ctxld, a, 2);
+
+	/* an older item must not be overwritten past a later write */
+	test_write(ctxld, b, 3);
+	test_write(ctxld, a, 4);
+	test_kick(ctxld);
+
+	dcss_ctxld_get_stats(ctxld, &stats);
+	CHECK(1 == stats.coalesced);
+	CHECK(3 == stats.queued);
+	CHECK(3 == hw_trace.len);
+	CHECK(hw_trace.ofs[0] == REG_OFS(a) && hw_trace.val[0] == 2);
+	CHECK(hw_trace.ofs[1] == REG_OFS(b) && hw_trace.val[1] == 3);
+	CHECK(hw_trace.ofs[2] == REG_OFS(a) && hw_trace.val[2] == 4);
+
+	/* values the hardware holds are dropped */
+	test_write(ctxld, a, 4);
+	test_kick(ctxld);
+
+	dcss_ctxld_get_stats(ctxld, &stats);
+	CHECK(1 == stats.dropped);
+	CHECK(3 == hw_trace.len);
+
+	/* but not after the hardware lost them */
+	test_suspend_resume(ctxld);
+	test_write(ctxld, a, 4);
+	test_kick(ctxld);
+	CHECK(4 == hw_regs[a]);
+
+	test_block_reset(ctxld);
+	test_write(ctxld, b, 3);
+	test_kick(ctxld);
+	CHECK(3 == hw_regs[b]);
+
+	/* nor after a direct write */
+	test_direct_write(ctxld, a, 7);
+	test_write(ctxld, a, 4);
+	test_kick(ctxld);
+	CHECK(4 == hw_regs[a]);
+
+	/* trigger registers see every write */
+	test_write(ctxld, 0, 1);
+	test_kick(ctxld);
+	test_write(ctxld, 0, 1);
+	test_kick(ctxld);
+
+	check_traces();
+	test_exit();
+}
+
+static u32 rand_seed = 1;
+
+static u32 rand_next(u32 range)
+{
+	rand_seed = rand_seed * 1103515245 + 12345;
+
+	return ((rand_seed >> 8) & 0xffffff) % range;
+}
+
+static void test_replay(u32 seed)
+{
+	struct dcss_ctxld *ctxld = test_init();
+	struct dcss_ctxld_stats stats;
+	int i;
+
+	rand_seed = seed;
+
+	for (i = 0; i < 20000; i++) {
+		u32 op = rand_next(1000);
+
+		if (op < 850)
+			test_write(ctxld, rand_next(NUM_REGS), rand_next(4));
+		else if (op < 970)
+			test_kick(ctxld);
+		else if (op < 990)
+			test_direct_write(ctxld, rand_next(NUM_REGS),
+					  rand_next(4));
+		else if (op < 995)
+			test_suspend_resume(ctxld);
+		else
+			test_block_reset(ctxld);
+	}
+
+	test_kick(ctxld);
+
+	check_traces();
+
+	/* the shadow has to do something for the test to mean anything */
+	dcss_ctxld_get_stats(ctxld, &stats);
+	CHECK(stats.dropped && stats.coalesced);
+
+	test_exit();
+}
+
+int main(void)
+{
+	u32 seed;
+
+	test_basic();
+
+	for (seed = 1; seed <= 20; seed++)
+		test_replay(seed);
+
+	CHECK(0 == g_num_warnings);
+
+	return HostTestResult("dcss-ctxld-test");
+}
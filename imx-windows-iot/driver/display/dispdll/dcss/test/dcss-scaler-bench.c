@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright 2023 NXP.
+ */
+
+/*
+ * Host benchmark of the DCSS scaler coefficient cache.
+ *
+ * Designs the four filters of a YUV plane update for a few typical update
+ * patterns, once with the Gaussian filter generator alone and once through
+ * the cache, and prints the time per plane update and the hit rate.
+ */
+
+#include "dcss-scaler-shim.h"
+
+#include <time.h>
+
+#define BENCH_UPDATES		20000
+
+struct bench_case {
+	const char *name;
+	int src_w, src_h;
+	int dst_w, dst_h;
+	int step;		/* destination size change per update */
+	int steps;		/* updates before the size starts over */
+};
+
+static const struct bench_case bench_cases[] = {
+	{ "static 1080p to 720p",	1920, 1080, 1280,  720, 0,  1 },
+	{ "resize animation",		1920, 1080,  640,  360, 8, 80 },
+	{ "two sizes alternating",	1920, 1080, 1280,  720, 640, 2 },
+	{ "window drag resize",		1280,  720,  400,  240, 2, 400 },
+};
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void design(struct dcss_scaler *scl, int src, int dst, bool use_5_taps,
+		   bool phase0_identity, int coef[][PSC_NUM_TAPS])
+{
+	int fc_q;
+
+	if (scl) {
+		dcss_scaler_filter_design(scl, src, dst, use_5_taps,
+					  phase0_identity, coef);
+		return;
+	}
+
+	if (dst >= src)
+		fc_q = div_q(1, PSC_NUM_PHASES);
+	else
+		fc_q = div_q(dst, src * PSC_NUM_PHASES);
+
+	dcss_scaler_gaussian_filter(fc_q, use_5_taps, phase0_identity, coef);
+}
+
+/* luma and chroma, horizontal and vertical, as dcss_scaler_yuv_coef_set() */
+static double run(const struct bench_case *bc, struct dcss_scaler *scl)
+{
+	int coef[PSC_STORED_PHASES][PSC_NUM_TAPS];
+	volatile int sink = 0;
+	double start;
+	int i;
+
+	start = now_ns();
+
+	for (i = 0; i < BENCH_UPDATES; i++) {
+		int dst_w = bc->dst_w + (i % bc->steps) * bc->step;
+		int dst_h = bc->dst_h + (i % bc->steps) * bc->step * 9 / 16;
+
+		design(scl, bc->src_w, dst_w, false, bc->src_w == dst_w, coef);
+		sink += coef[0][3];
+		design(scl, bc->src_h, dst_h, true, bc->src_h == dst_h, coef);
+		sink += coef[0][3];
+		design(scl, bc->src_w / 2, dst_w / 2, false, false, coef);
+		sink += coef[0][3];
+		design(scl, bc->src_h / 2, dst_h / 2, true, false, coef);
+		sink += coef[0][3];
+	}
+
+	(void)sink;
+
+	return (now_ns() - start) / BENCH_UPDATES;
+}
+
+int main(void)
+{
+	unsigned int i;
+
+	printf("%-24s %12s %12s %8s\n", "case", "design ns", "cached ns",
+	       "hits");
+
+	for (i = 0; i < sizeof(bench_cases) / sizeof(bench_cases[0]); i++) {
+		const struct bench_case *bc = &bench_cases[i];
+		struct dcss_scaler *scl = test_scaler_alloc();
+		double design_ns = run(bc, NULL);
+		double cached_ns = run(bc, scl);
+		struct dcss_scaler_coef_cache *cache = &scl->coef_cache;
+
+		printf("%-24s %12.0f %12.0f %7.1f%%\n", bc->name, design_ns,
+		       cached_ns,
+		       100.0 * cache->hits / (cache->hits + cache->misses));
+
+		kfree(scl);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,92 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright 2023 NXP.
+ */
+
+/*
+ * Builds dcss-scaler.c on the host. The context loader and the write-back
+ * path are not part of the scaler tests, their entry points do nothing.
+ */
+
+#ifndef __DCSS_TEST_SCALER_SHIM_H__
+#define __DCSS_TEST_SCALER_SHIM_H__
+
+#include "dcss-scaler.c"
+
+int g_num_warnings;
+unsigned long long jiffies;
+
+void dcss_ctxld_write(struct dcss_ctxld *ctxld, u32 ctx_id, u32 val,
+		      u32 reg_idx)
+{
+	(void)ctxld;
+	(void)ctx_id;
+	(void)val;
+	(void)reg_idx;
+}
+
+void dcss_ctxld_write_irqsafe(struct dcss_ctxld *ctxld, u32 ctx_id, u32 val,
+			      u32 reg_ofs)
+{
+	dcss_ctxld_write(ctxld, ctx_id, val, reg_ofs);
+}
+
+void dcss_ctxld_assert_locked(struct dcss_ctxld *ctxld)
+{
+	(void)ctxld;
+}
+
+u32 dcss_wrscl_setup(struct dcss_wrscl *wrscl, u32 pix_format, u32 pix_clk_hz,
+		     u32 dst_xres, u32 dst_yres)
+{
+	(void)wrscl;
+	(void)pix_format;
+	(void)pix_clk_hz;
+	(void)dst_xres;
+	(void)dst_yres;
+
+	return 0;
+}
+
+void dcss_wrscl_enable(struct dcss_wrscl *wrscl)
+{
+	(void)wrscl;
+}
+
+void dcss_wrscl_disable(struct dcss_wrscl *wrscl)
+{
+	(void)wrscl;
+}
+
+void dcss_rdsrc_setup(struct dcss_rdsrc *rdsrc, u32 pix_format, u32 dst_xres,
+		      u32 dst_yres, u32 base_addr)
+{
+	(void)rdsrc;
+	(void)pix_format;
+	(void)dst_xres;
+	(void)dst_yres;
+	(void)base_addr;
+}
+
+void dcss_rdsrc_enable(struct dcss_rdsrc *rdsrc)
+{
+	(void)rdsrc;
+}
+
+void dcss_rdsrc_disable(struct dcss_rdsrc *rdsrc)
+{
+	(void)rdsrc;
+}
+
+/* Only the coefficient cache of the scaler is set up */
+static struct dcss_scaler *test_scaler_alloc(void)
+{
+	struct dcss_scaler *scl = kzalloc(sizeof(*scl), GFP_KERNEL);
+
+	assert(scl);
+	spin_lock_init(&scl->coef_cache.lock);
+
+	return scl;
+}
+
+#endif /* __DCSS_TEST_SCALER_SHIM_H__ */
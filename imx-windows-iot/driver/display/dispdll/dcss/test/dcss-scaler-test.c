@@ -0,0 +1,196 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright 2023 NXP.
+ */
+
+/*
+ * Host test of the DCSS scaler coefficient cache.
+ *
+ * Entries are keyed on the cutoff frequency and the PSC_COEF_* flags, and
+ * the least recently used one is replaced. Whatever the cache returns must
+ * be the coefficients dcss_scaler_gaussian_filter() designs for that key.
+ */
+
+#include "dcss-scaler-shim.h"
+#include "HostTest.h"
+
+typedef int coef_set[PSC_STORED_PHASES][PSC_NUM_TAPS];
+
+static void fill_coef(coef_set coef, int seed)
+{
+	int i, j;
+
+	for (i = 0; i < PSC_STORED_PHASES; i++)
+		for (j = 0; j < PSC_NUM_TAPS; j++)
+			coef[i][j] = seed * 1000 + i * PSC_NUM_TAPS + j;
+}
+
+static bool design_matches(struct dcss_scaler *scl, int src, int dst,
+			   bool use_5_taps, bool phase0_identity)
+{
+	coef_set cached, designed;
+
+	dcss_scaler_filter_design(scl, src, dst, use_5_taps, phase0_identity,
+				  cached);
+
+	if (dst >= src)
+		dcss_scaler_gaussian_filter(div_q(1, PSC_NUM_PHASES),
+					    use_5_taps, phase0_identity,
+					    designed);
+	else
+		dcss_scaler_gaussian_filter(div_q(dst, src * PSC_NUM_PHASES),
+					    use_5_taps, phase0_identity,
+					    designed);
+
+	return !memcmp(cached, designed, sizeof(cached));
+}
+
+static void test_hit_miss(void)
+{
+	struct dcss_scaler *scl = test_scaler_alloc();
+	struct dcss_scaler_coef_cache *cache = &scl->coef_cache;
+
+	/* first design misses, the same ratio then hits */
+	CHECK(design_matches(scl, 1920, 1280, false, false));
+	CHECK(0 == cache->hits && 1 == cache->misses);
+
+	CHECK(design_matches(scl, 1920, 1280, false, false));
+	CHECK(1 == cache->hits && 1 == cache->misses);
+
+	/* the key is the cutoff frequency, not the lengths */
+	CHECK(design_matches(scl, 960, 640, false, false));
+	CHECK(2 == cache->hits && 1 == cache->misses);
+
+	/* each flag is part of the key */
+	CHECK(design_matches(scl, 1920, 1280, true, false));
+	CHECK(2 == cache->hits && 2 == cache->misses);
+
+	CHECK(design_matches(scl, 1920, 1280, false, true));
+	CHECK(2 == cache->hits && 3 == cache->misses);
+
+	CHECK(design_matches(scl, 1920, 1280, true, true));
+	CHECK(2 == cache->hits && 4 == cache->misses);
+
+	CHECK(design_matches(scl, 1920, 1280, true, false));
+	CHECK(design_matches(scl, 1920, 1280, false, true));
+	CHECK(4 == cache->hits && 4 == cache->misses);
+
+	/* all upscales and 1:1 share the same cutoff */
+	CHECK(design_matches(scl, 640, 1920, false, false));
+	CHECK(design_matches(scl, 1280, 1280, false, false));
+	CHECK(design_matches(scl, 720, 1080, false, false));
+	CHECK(6 == cache->hits && 5 == cache->misses);
+
+	kfree(scl);
+}
+
+static void test_eviction(void)
+{
+	struct dcss_scaler *scl = test_scaler_alloc();
+	struct dcss_scaler_coef_cache *cache = &scl->coef_cache;
+	coef_set coef, expected;
+	int i;
+
+	for (i = 0; i < PSC_COEF_CACHE_ENTRIES; i++) {
+		CHECK(!dcss_scaler_coef_lookup(cache, 100 + i, 0, coef));
+		fill_coef(coef, i);
+		dcss_scaler_coef_insert(cache, 100 + i, 0, coef);
+	}
+
+	/* a full cache keeps everything */
+	for (i = 0; i < PSC_COEF_CACHE_ENTRIES; i++) {
+		fill_coef(expected, i);
+		CHECK(dcss_scaler_coef_lookup(cache, 100 + i, 0, coef));
+		CHECK(!memcmp(coef, expected, sizeof(coef)));
+	}
+
+	/* after the lookups above, the first entry is the oldest again */
+	CHECK(dcss_scaler_coef_lookup(cache, 100, 0, coef));
+
+	fill_coef(coef, 99);
+	dcss_scaler_coef_insert(cache, 200, 0, coef);
+
+	CHECK(!dcss_scaler_coef_lookup(cache, 101, 0, coef));
+	CHECK(dcss_scaler_coef_lookup(cache, 100, 0, coef));
+	CHECK(dcss_scaler_coef_lookup(cache, 200, 0, coef));
+	fill_coef(expected, 99);
+	CHECK(!memcmp(coef, expected, sizeof(coef)));
+
+	for (i = 2; i < PSC_COEF_CACHE_ENTRIES; i++)
+		CHECK(dcss_scaler_coef_lookup(cache, 100 + i, 0, coef));
+
+	/* the same cutoff with other flags is another entry */
+	CHECK(!dcss_scaler_coef_lookup(cache, 100, PSC_COEF_5_TAPS, coef));
+	CHECK(!dcss_scaler_coef_lookup(cache, 100, PSC_COEF_PHASE0_IDENTITY,
+				       coef));
+
+	kfree(scl);
+}
+
+static void test_tick_wrap(void)
+{
+	struct dcss_scaler *scl = test_scaler_alloc();
+	struct dcss_scaler_coef_cache *cache = &scl->coef_cache;
+	coef_set coef;
+	int i;
+
+	cache->tick = U32_MAX - 4;
+
+	for (i = 0; i < 8; i++) {
+		fill_coef(coef, i);
+		dcss_scaler_coef_insert(cache, 300 + i, 0, coef);
+	}
+
+	/* nothing was dropped as empty when the tick restarted */
+	for (i = 0; i < PSC_COEF_CACHE_ENTRIES; i++)
+		CHECK(!cache->entry[i].last_used ||
+		      cache->entry[i].last_used <= cache->tick);
+
+	for (i = 0; i < 8; i++)
+		CHECK(dcss_scaler_coef_lookup(cache, 300 + i, 0, coef));
+
+	/* the remaining empty entries are used before any live one */
+	for (i = 8; i < PSC_COEF_CACHE_ENTRIES; i++)
+		dcss_scaler_coef_insert(cache, 300 + i, 0, coef);
+
+	for (i = 0; i < PSC_COEF_CACHE_ENTRIES; i++)
+		CHECK(dcss_scaler_coef_lookup(cache, 300 + i, 0, coef));
+
+	kfree(scl);
+}
+
+/* Random resizes, with the cache thrashing through its entries */
+static void test_random_designs(void)
+{
+	struct dcss_scaler *scl = test_scaler_alloc();
+	u32 seed = 1;
+	int i;
+
+	for (i = 0; i < 4000; i++) {
+		int src, dst;
+
+		seed = seed * 1103515245 + 12345;
+		src = 64 + (seed >> 8) % 3776;
+		/* down to 1/5, the downscale limit of the overlay channels */
+		seed = seed * 1103515245 + 12345;
+		dst = src * (20 + (seed >> 8) % 181) / 100;
+
+		CHECK(design_matches(scl, src, dst, seed & 1, seed & 2));
+	}
+
+	CHECK(scl->coef_cache.hits && scl->coef_cache.misses);
+
+	kfree(scl);
+}
+
+int main(void)
+{
+	test_hit_miss();
+	test_eviction();
+	test_tick_wrap();
+	test_random_designs();
+
+	CHECK(0 == g_num_warnings);
+
+	return HostTestResult("dcss-scaler-test");
+}
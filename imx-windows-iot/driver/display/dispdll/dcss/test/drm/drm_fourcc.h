@@ -0,0 +1,34 @@
+/* Host test stand-in, see kshim.h */
+#include "kshim.h"
+
+#ifndef __DCSS_TEST_DRM_FOURCC_H__
+#define __DCSS_TEST_DRM_FOURCC_H__
+
+/* Only the formats and fields the scaler looks at */
+#define fourcc_code(a, b, c, d)	((u32)(a) | ((u32)(b) << 8) | \
+				 ((u32)(c) << 16) | ((u32)(d) << 24))
+
+#define DRM_FORMAT_XRGB2101010	fourcc_code('X', 'R', '3', '0')
+#define DRM_FORMAT_XBGR2101010	fourcc_code('X', 'B', '3', '0')
+#define DRM_FORMAT_RGBX1010102	fourcc_code('R', 'X', '3', '0')
+#define DRM_FORMAT_BGRX1010102	fourcc_code('B', 'X', '3', '0')
+#define DRM_FORMAT_ARGB2101010	fourcc_code('A', 'R', '3', '0')
+#define DRM_FORMAT_ABGR2101010	fourcc_code('A', 'B', '3', '0')
+#define DRM_FORMAT_RGBA1010102	fourcc_code('R', 'A', '3', '0')
+#define DRM_FORMAT_BGRA1010102	fourcc_code('B', 'A', '3', '0')
+#define DRM_FORMAT_YUYV		fourcc_code('Y', 'U', 'Y', 'V')
+#define DRM_FORMAT_YVYU		fourcc_code('Y', 'V', 'Y', 'U')
+#define DRM_FORMAT_UYVY		fourcc_code('U', 'Y', 'V', 'Y')
+#define DRM_FORMAT_VYUY		fourcc_code('V', 'Y', 'U', 'Y')
+#define DRM_FORMAT_NV12		fourcc_code('N', 'V', '1', '2')
+#define DRM_FORMAT_NV21		fourcc_code('N', 'V', '2', '1')
+#define DRM_FORMAT_NV12_10LE40	fourcc_code('R', 'K', '2', '0')
+
+struct drm_format_info {
+	u32 format;
+	u8 depth;
+	u8 num_planes;
+	bool is_yuv;
+};
+
+#endif /* __DCSS_TEST_DRM_FOURCC_H__ */
@@ -0,0 +1,107 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright 2023 NXP.
+ */
+
+/*
+ * Minimal stand-ins for the kernel interfaces used by the DCSS context
+ * loader and scaler, so they can be built and replayed on the host. MMIO goes to plain
+ * memory and DMA addresses are small tokens the test maps back.
+ */
+
+#ifndef __DCSS_TEST_KSHIM_H__
+#define __DCSS_TEST_KSHIM_H__
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef unsigned long long u64;
+typedef long long s64;
+typedef u32 dma_addr_t;
+typedef int irqreturn_t;
+
+#define __iomem
+
+#define BIT(nr)			(1U << (nr))
+#define GENMASK(h, l)		((~0U << (l)) & (~0U >> (31 - (h))))
+#define SZ_4K			0x1000
+#define U32_MAX			((u32)~0U)
+
+#define ENOMEM			12
+#define ETIMEDOUT		110
+
+#define GFP_KERNEL		0
+#define IRQ_HANDLED		1
+
+struct device {
+	int unused;
+};
+
+struct platform_device {
+	struct device dev;
+};
+
+struct completion {
+	int done;
+};
+
+struct drm_format_info;
+struct drm_plane_state;
+struct videomode;
+
+#define to_platform_device(d)	((struct platform_device *)(d))
+
+/* The lock count catches unbalanced or missing locking */
+typedef struct {
+	int locked;
+} spinlock_t;
+
+#define spin_lock_init(l)		((l)->locked = 0)
+#define spin_lock_irq(l)		(assert(!(l)->locked), (l)->locked = 1)
+#define spin_unlock_irq(l)		(assert((l)->locked), (l)->locked = 0)
+#define spin_lock_irqsave(l, f)		((f) = 0, spin_lock_irq(l))
+#define spin_unlock_irqrestore(l, f)	((void)(f), spin_unlock_irq(l))
+#define lockdep_assert_held(l)		assert((l)->locked)
+
+#define kzalloc(s, g)		calloc(1, (s))
+#define kcalloc(n, s, g)	calloc((n), (s))
+#define kfree(p)		free(p)
+
+#define ioremap(a, s)		((void)(a), calloc(1, (s)))
+#define iounmap(p, s)		((void)(s), free(p))
+#define readl(c)		(*(volatile u32 *)(c))
+#define writel(v, c)		(*(volatile u32 *)(c) = (v))
+
+void *dma_alloc_coherent(struct device *dev, size_t size, dma_addr_t *handle,
+			 int gfp);
+void dma_free_coherent(struct device *dev, size_t size, void *vaddr,
+		       dma_addr_t handle);
+
+#define platform_get_irq_byname(p, n)	((void)(p), 1)
+#define request_irq(i, h, f, n, d)	((void)(h), 0)
+#define free_irq(i, d)			((void)(i))
+#define enable_irq(i)			((void)(i))
+#define disable_irq_nosync(i)		((void)(i))
+
+#define dev_err(d, ...)		fprintf(stderr, __VA_ARGS__)
+#define dev_info(d, ...)	fprintf(stderr, __VA_ARGS__)
+#define dev_dbg(d, ...)		do { if (0) printf(__VA_ARGS__); } while (0)
+
+extern int g_num_warnings;
+
+#define WARN_ON(c)		({ int __c = !!(c); if (__c) g_num_warnings++; __c; })
+
+extern unsigned long long jiffies;
+
+#define msecs_to_jiffies(m)	((unsigned long long)(m))
+#define time_after(a, b)	((long long)((b) - (a)) < 0)
+#define msleep(m)		(jiffies += (m))
+
+#endif /* __DCSS_TEST_KSHIM_H__ */
@@ -0,0 +1,2 @@
+/* Host test stand-in, see kshim.h */
+#include "kshim.h"
@@ -0,0 +1,115 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host benchmark of the display-only present blitter (GcKmdBlt.cpp)
+//
+// Presents a 1920x1080 32bpp source in the typical desktop update patterns
+// and prints the time per present. The frame buffer is plain system memory
+// here, so the numbers only compare the blitter paths against each other.
+//
+
+#include "GcKmdBlt.cpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#define BENCH_WIDTH         1920
+#define BENCH_HEIGHT        1080
+#define BENCH_ITERATIONS    200
+
+struct BenchCase
+{
+    const char         *m_pName;
+    GcKmBltRotation     m_Rotation;
+    bool                m_bTileCache;
+    bool                m_bChangeContent;
+    uint32_t            m_NumRects;
+    GcKmBltRect         m_Rects[4];
+};
+
+static const BenchCase  g_Cases[] =
+{
+    { "full frame",                 GcKmBltRotationIdentity, false, true,  1, { { 0, 0, BENCH_WIDTH, BENCH_HEIGHT } } },
+    { "full frame, tile cache",     GcKmBltRotationIdentity, true,  true,  1, { { 0, 0, BENCH_WIDTH, BENCH_HEIGHT } } },
+    { "full frame, unchanged",      GcKmBltRotationIdentity, true,  false, 1, { { 0, 0, BENCH_WIDTH, BENCH_HEIGHT } } },
+    { "cursor and caret",           GcKmBltRotationIdentity, true,  true,  2, { { 400, 300, 432, 332 }, { 900, 500, 902, 520 } } },
+    { "overlapping windows",        GcKmBltRotationIdentity, true,  true,  3, { { 100, 100, 900, 700 }, { 600, 400, 1400, 900 }, { 890, 100, 1400, 420 } } },
+    { "full frame, rotated 90",     GcKmBltRotation90,       false, true,  1, { { 0, 0, BENCH_WIDTH, BENCH_HEIGHT } } },
+    { "full frame, rotated 180",    GcKmBltRotation180,      false, true,  1, { { 0, 0, BENCH_WIDTH, BENCH_HEIGHT } } },
+};
+
+int
+main()
+{
+    std::vector<uint8_t>    Src((size_t)BENCH_WIDTH*BENCH_HEIGHT*4);
+    std::vector<uint8_t>    Dst((size_t)BENCH_WIDTH*BENCH_HEIGHT*4);
+
+    for (size_t i = 0; i < Src.size(); i++)
+    {
+        Src[i] = (uint8_t)(i*7);
+    }
+
+    for (const BenchCase& Case : g_Cases)
+    {
+        bool            bTransposed = (GcKmBltRotation90 == Case.m_Rotation) || (GcKmBltRotation270 == Case.m_Rotation);
+        GcKmBltSurface  SrcSurface = { Src.data(), BENCH_WIDTH, BENCH_HEIGHT, BENCH_WIDTH*4 };
+        GcKmBltSurface  DstSurface;
+
+        DstSurface.m_pBits = Dst.data();
+        DstSurface.m_Width = bTransposed ? BENCH_HEIGHT : BENCH_WIDTH;
+        DstSurface.m_Height = bTransposed ? BENCH_WIDTH : BENCH_HEIGHT;
+        DstSurface.m_Pitch = DstSurface.m_Width*4;
+
+        GcKmBltTileCache            TileCache;
+        std::vector<GcKmBltTile>    Tiles(GcKmBltGetTileCount(BENCH_WIDTH, BENCH_HEIGHT, &TileCache.m_TilesX, &TileCache.m_TilesY));
+        std::vector<uint8_t>        Shadow(GcKmBltGetShadowSize(BENCH_WIDTH, BENCH_HEIGHT, 4, &TileCache.m_ShadowPitch));
+
+        TileCache.m_pTiles = Tiles.data();
+        TileCache.m_pShadow = Shadow.data();
+        GcKmBltInvalidateTileCache(&TileCache);
+
+        GcKmBltStats    Stats = {};
+        uint64_t        BytesCopied = 0;
+        auto            Start = std::chrono::steady_clock::now();
+
+        for (uint32_t Iteration = 0; Iteration < BENCH_ITERATIONS; Iteration++)
+        {
+            if (Case.m_bChangeContent)
+            {
+                for (uint32_t i = 0; i < Case.m_NumRects; i++)
+                {
+                    const GcKmBltRect&  Rect = Case.m_Rects[i];
+
+                    for (int32_t y = Rect.top; y < Rect.bottom; y += 16)
+                    {
+                        Src[((size_t)y*BENCH_WIDTH + Rect.left)*4] = (uint8_t)Iteration;
+                    }
+                }
+            }
+
+            GcKmBltPresent(
+                &SrcSurface,
+                &DstSurface,
+                4,
+                Case.m_Rotation,
+                Case.m_Rects,
+                Case.m_NumRects,
+                Case.m_bTileCache ? &TileCache : NULL,
+                &Stats);
+
+            BytesCopied += Stats.m_BytesCopied;
+        }
+
+        double  ElapsedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Start).count();
+
+        printf("%-28s %9.1f us/present %9.1f KB copied/present\n",
+               Case.m_pName,
+               ElapsedUs/BENCH_ITERATIONS,
+               BytesCopied/1024.0/BENCH_ITERATIONS);
+    }
+
+    return EXIT_SUCCESS;
+}
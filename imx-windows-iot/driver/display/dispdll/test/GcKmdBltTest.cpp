@@ -0,0 +1,422 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host unit test of the display-only present blitter (GcKmdBlt.cpp)
+//
+// The source is a persistent frame that is modified between presents, every
+// change is reported through the dirty rectangles. After each present the
+// frame buffer must match a per pixel rotation of the whole source.
+//
+
+#include "GcKmdBlt.cpp"
+#include "HostTest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+static uint32_t g_Seed = 1;
+
+static uint32_t
+Random(
+    uint32_t    Range)
+{
+    g_Seed = g_Seed*1103515245 + 12345;
+
+    return ((g_Seed >> 8) & 0xFFFFFF) % Range;
+}
+
+static GcKmBltRect
+MakeRect(
+    int32_t left,
+    int32_t top,
+    int32_t right,
+    int32_t bottom)
+{
+    GcKmBltRect Rect = { left, top, right, bottom };
+
+    return Rect;
+}
+
+class TestFrame
+{
+public:
+
+    TestFrame(
+        uint32_t    Width,
+        uint32_t    Height,
+        uint32_t    BytesPerPixel,
+        uint32_t    PitchPad)
+    {
+        m_Pixels.resize((size_t)(Width*BytesPerPixel + PitchPad)*Height + 64);
+
+        //
+        // Deliberately misaligned against the 64 byte bursts
+        //
+
+        m_Surface.m_pBits = m_Pixels.data() + 4;
+        m_Surface.m_Width = Width;
+        m_Surface.m_Height = Height;
+        m_Surface.m_Pitch = Width*BytesPerPixel + PitchPad;
+        m_BytesPerPixel = BytesPerPixel;
+    }
+
+    uint8_t*
+    Pixel(
+        uint32_t    x,
+        uint32_t    y)
+    {
+        return m_Surface.m_pBits + (size_t)y*m_Surface.m_Pitch + (size_t)x*m_BytesPerPixel;
+    }
+
+    void
+    Fill(
+        const GcKmBltRect&  Rect,
+        uint32_t            Value)
+    {
+        for (int32_t y = Rect.top; y < Rect.bottom; y++)
+        {
+            for (int32_t x = Rect.left; x < Rect.right; x++)
+            {
+                uint32_t    PixelValue = Value + x*131 + y*7;
+
+                memcpy(Pixel(x, y), &PixelValue, m_BytesPerPixel);
+            }
+        }
+    }
+
+    GcKmBltSurface      m_Surface;
+    uint32_t            m_BytesPerPixel;
+    std::vector<uint8_t> m_Pixels;
+};
+
+//
+// Frame buffer pixel (x, y) shows source pixel (SrcX, SrcY)
+//
+
+static void
+MapToSource(
+    GcKmBltRotation Rotation,
+    uint32_t        SrcWidth,
+    uint32_t        SrcHeight,
+    uint32_t        x,
+    uint32_t        y,
+    uint32_t       *pSrcX,
+    uint32_t       *pSrcY)
+{
+    switch (Rotation)
+    {
+    case GcKmBltRotation90:
+        *pSrcX = y;
+        *pSrcY = SrcHeight - 1 - x;
+        break;
+
+    case GcKmBltRotation180:
+        *pSrcX = SrcWidth - 1 - x;
+        *pSrcY = SrcHeight - 1 - y;
+        break;
+
+    case GcKmBltRotation270:
+        *pSrcX = SrcWidth - 1 - y;
+        *pSrcY = x;
+        break;
+
+    default:
+        *pSrcX = x;
+        *pSrcY = y;
+        break;
+    }
+}
+
+static bool
+MatchesSource(
+    TestFrame      *pSrc,
+    TestFrame      *pDst,
+    GcKmBltRotation Rotation)
+{
+    for (uint32_t y = 0; y < pDst->m_Surface.m_Height; y++)
+    {
+        for (uint32_t x = 0; x < pDst->m_Surface.m_Width; x++)
+        {
+            uint32_t    SrcX, SrcY;
+
+            MapToSource(Rotation, pSrc->m_Surface.m_Width, pSrc->m_Surface.m_Height, x, y, &SrcX, &SrcY);
+
+            if (memcmp(pDst->Pixel(x, y), pSrc->Pixel(SrcX, SrcY), pSrc->m_BytesPerPixel))
+            {
+                printf("Mismatch at frame buffer %u,%u, rotation %d\n", x, y, Rotation);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+class TestTileCache
+{
+public:
+
+    TestTileCache(
+        uint32_t    Width,
+        uint32_t    Height,
+        uint32_t    BytesPerPixel)
+    {
+        uint32_t    NumTiles = GcKmBltGetTileCount(Width, Height, &m_Cache.m_TilesX, &m_Cache.m_TilesY);
+        uint32_t    ShadowSize = GcKmBltGetShadowSize(Width, Height, BytesPerPixel, &m_Cache.m_ShadowPitch);
+
+        m_Tiles.resize(NumTiles);
+        m_Shadow.resize(ShadowSize);
+
+        m_Cache.m_pTiles = m_Tiles.data();
+        m_Cache.m_pShadow = m_Shadow.data();
+
+        GcKmBltInvalidateTileCache(&m_Cache);
+    }
+
+    GcKmBltTileCache            m_Cache;
+    std::vector<GcKmBltTile>    m_Tiles;
+    std::vector<uint8_t>        m_Shadow;
+};
+
+static void
+TestMergeRects()
+{
+    GcKmBltRect Merged[GC_KM_BLT_MAX_RECTS];
+
+    //
+    // Overlapping and adjacent rectangles are merged, distant ones are not
+    //
+
+    GcKmBltRect Overlapping[] = { MakeRect(0, 0, 100, 100), MakeRect(50, 0, 150, 100) };
+
+    CHECK(1 == GcKmBltMergeRects(Overlapping, 2, 1000, 1000, Merged));
+    CHECK((0 == Merged[0].left) && (150 == Merged[0].right) && (100 == Merged[0].bottom));
+
+    GcKmBltRect Adjacent[] = { MakeRect(0, 0, 100, 100), MakeRect(0, 100, 100, 200) };
+
+    CHECK(1 == GcKmBltMergeRects(Adjacent, 2, 1000, 1000, Merged));
+    CHECK(200 == Merged[0].bottom);
+
+    GcKmBltRect Distant[] = { MakeRect(0, 0, 10, 10), MakeRect(500, 500, 510, 510) };
+
+    CHECK(2 == GcKmBltMergeRects(Distant, 2, 1000, 1000, Merged));
+
+    //
+    // Touching corners would waste most of the union
+    //
+
+    GcKmBltRect Corner[] = { MakeRect(0, 0, 100, 100), MakeRect(100, 100, 200, 200) };
+
+    CHECK(2 == GcKmBltMergeRects(Corner, 2, 1000, 1000, Merged));
+
+    //
+    // Clipping and empty rectangles
+    //
+
+    GcKmBltRect Clipped[] = { MakeRect(-10, -10, 20, 20), MakeRect(30, 30, 30, 40), MakeRect(90, 90, 200, 200) };
+
+    CHECK(2 == GcKmBltMergeRects(Clipped, 3, 100, 100, Merged));
+    CHECK((0 == Merged[0].left) && (0 == Merged[0].top) && (20 == Merged[0].right));
+    CHECK((100 == Merged[1].right) && (100 == Merged[1].bottom));
+
+    //
+    // More rectangles than fit still cover all of them
+    //
+
+    std::vector<GcKmBltRect>    Many;
+
+    for (int32_t i = 0; i < 200; i++)
+    {
+        Many.push_back(MakeRect((i % 20)*50, (i/20)*50, (i % 20)*50 + 10, (i/20)*50 + 10));
+    }
+
+    uint32_t    NumMerged = GcKmBltMergeRects(Many.data(), (uint32_t)Many.size(), 1000, 1000, Merged);
+
+    CHECK(NumMerged <= GC_KM_BLT_MAX_RECTS);
+
+    for (const GcKmBltRect& Rect : Many)
+    {
+        bool    bCovered = false;
+
+        for (uint32_t j = 0; j < NumMerged; j++)
+        {
+            if ((Merged[j].left <= Rect.left) && (Merged[j].top <= Rect.top) &&
+                (Merged[j].right >= Rect.right) && (Merged[j].bottom >= Rect.bottom))
+            {
+                bCovered = true;
+            }
+        }
+
+        CHECK(bCovered);
+    }
+}
+
+static void
+TestPresent(
+    uint32_t        Width,
+    uint32_t        Height,
+    uint32_t        BytesPerPixel,
+    GcKmBltRotation Rotation,
+    bool            bTileCache)
+{
+    bool            bTransposed = (GcKmBltRotation90 == Rotation) || (GcKmBltRotation270 == Rotation);
+    TestFrame       Src(Width, Height, BytesPerPixel, 12);
+    TestFrame       Dst(bTransposed ? Height : Width, bTransposed ? Width : Height, BytesPerPixel, 0);
+    TestTileCache   TileCache(Width, Height, BytesPerPixel);
+    GcKmBltRect     Full = MakeRect(0, 0, (int32_t)Width, (int32_t)Height);
+    GcKmBltStats    Stats;
+
+    Src.Fill(Full, 0x10203040);
+
+    CHECK(GcKmBltPresent(&Src.m_Surface, &Dst.m_Surface, BytesPerPixel, Rotation, &Full, 1,
+                         bTileCache ? &TileCache.m_Cache : NULL, &Stats));
+    CHECK(MatchesSource(&Src, &Dst, Rotation));
+    CHECK(0 == Stats.m_NumTilesSkipped);
+
+    for (uint32_t Iteration = 0; Iteration < 40; Iteration++)
+    {
+        GcKmBltRect Dirty[8];
+        uint32_t    NumDirty = 1 + Random(8);
+
+        for (uint32_t i = 0; i < NumDirty; i++)
+        {
+            int32_t left = (int32_t)Random(Width);
+            int32_t top = (int32_t)Random(Height);
+
+            Dirty[i] = MakeRect(left, top, left + 1 + (int32_t)Random(Width/2), top + 1 + (int32_t)Random(Height/2));
+
+            //
+            // Only part of the reported area actually changes,
+            // partly back to what the frame buffer already shows
+            //
+
+            GcKmBltRect Change = Dirty[i];
+
+            Change.right = Change.right > (int32_t)Width ? (int32_t)Width : Change.right;
+            Change.bottom = Change.bottom > (int32_t)Height ? (int32_t)Height : Change.bottom;
+
+            if (Random(2))
+            {
+                Change.right = Change.left + (Change.right - Change.left + 1)/2;
+            }
+
+            Src.Fill(Change, Random(3) ? Random(0x7FFFFFFF) : 0x10203040);
+        }
+
+        CHECK(GcKmBltPresent(&Src.m_Surface, &Dst.m_Surface, BytesPerPixel, Rotation, Dirty, NumDirty,
+                             bTileCache ? &TileCache.m_Cache : NULL, &Stats));
+        CHECK(MatchesSource(&Src, &Dst, Rotation));
+    }
+
+    //
+    // Unchanged content is skipped with the tile cache, once the tiles
+    // invalidated by small rectangles have been refreshed
+    //
+
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        CHECK(GcKmBltPresent(&Src.m_Surface, &Dst.m_Surface, BytesPerPixel, Rotation, &Full, 1,
+                             bTileCache ? &TileCache.m_Cache : NULL, &Stats));
+        CHECK(MatchesSource(&Src, &Dst, Rotation));
+    }
+
+    if (bTileCache)
+    {
+        CHECK(0 == Stats.m_NumTilesCopied);
+        CHECK(0 == Stats.m_BytesCopied);
+    }
+    else
+    {
+        CHECK((uint64_t)Width*Height*BytesPerPixel == Stats.m_BytesCopied);
+    }
+}
+
+//
+// A single changed pixel must never be skipped, whatever
+// else in its tile stays the same
+//
+
+static void
+TestSinglePixelChange()
+{
+    const uint32_t  Width = 256;
+    const uint32_t  Height = 128;
+    TestFrame       Src(Width, Height, 4, 0);
+    TestFrame       Dst(Width, Height, 4, 0);
+    TestTileCache   TileCache(Width, Height, 4);
+    GcKmBltRect     Full = MakeRect(0, 0, Width, Height);
+    GcKmBltStats    Stats;
+
+    Src.Fill(Full, 0);
+
+    CHECK(GcKmBltPresent(&Src.m_Surface, &Dst.m_Surface, 4, GcKmBltRotationIdentity, &Full, 1, &TileCache.m_Cache, &Stats));
+
+    for (uint32_t i = 0; i < 64; i++)
+    {
+        uint32_t    x = Random(Width);
+        uint32_t    y = Random(Height);
+
+        //
+        // Flip bits the way a hash collision would need them
+        //
+
+        Src.Pixel(x, y)[Random(4)] ^= (uint8_t)(1 << Random(8));
+
+        CHECK(GcKmBltPresent(&Src.m_Surface, &Dst.m_Surface, 4, GcKmBltRotationIdentity, &Full, 1, &TileCache.m_Cache, &Stats));
+        CHECK(1 == Stats.m_NumTilesCopied);
+        CHECK(((Width/GC_KM_BLT_TILE_SIZE)*(Height/GC_KM_BLT_TILE_SIZE) - 1) == Stats.m_NumTilesSkipped);
+        CHECK(0 == memcmp(Src.Pixel(x, y), Dst.Pixel(x, y), 4));
+    }
+
+    CHECK(MatchesSource(&Src, &Dst, GcKmBltRotationIdentity));
+}
+
+static void
+TestInvalidParameters()
+{
+    TestFrame   Src(64, 32, 4, 0);
+    TestFrame   Dst(64, 32, 4, 0);
+    GcKmBltRect Full = MakeRect(0, 0, 64, 32);
+
+    CHECK(!GcKmBltPresent(&Src.m_Surface, &Dst.m_Surface, 3, GcKmBltRotationIdentity, &Full, 1, NULL, NULL));
+    CHECK(!GcKmBltPresent(&Src.m_Surface, &Dst.m_Surface, 4, GcKmBltRotation90, &Full, 1, NULL, NULL));
+    CHECK(GcKmBltPresent(&Src.m_Surface, &Dst.m_Surface, 4, GcKmBltRotation180, &Full, 1, NULL, NULL));
+
+    //
+    // A tile cache of the wrong size is ignored
+    //
+
+    TestTileCache   TileCache(32, 32, 4);
+
+    CHECK(GcKmBltPresent(&Src.m_Surface, &Dst.m_Surface, 4, GcKmBltRotationIdentity, &Full, 1, &TileCache.m_Cache, NULL));
+    CHECK(MatchesSource(&Src, &Dst, GcKmBltRotationIdentity));
+}
+
+int
+main()
+{
+    static const GcKmBltRotation Rotations[] =
+    {
+        GcKmBltRotationIdentity,
+        GcKmBltRotation90,
+        GcKmBltRotation180,
+        GcKmBltRotation270
+    };
+
+    TestMergeRects();
+
+    for (GcKmBltRotation Rotation : Rotations)
+    {
+        TestPresent(200, 150, 4, Rotation, false);
+        TestPresent(200, 150, 4, Rotation, true);
+        TestPresent(333, 97, 2, Rotation, true);
+        TestPresent(640, 64, 4, Rotation, true);
+    }
+
+    TestSinglePixelChange();
+    TestInvalidParameters();
+
+    return HostTestResult("GcKmdBltTest");
+}
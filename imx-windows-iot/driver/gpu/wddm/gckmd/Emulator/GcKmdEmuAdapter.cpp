@@ -164,6 +164,16 @@ NTSTATUS
 GcKmEmuAdapter::Escape(
     IN_CONST_PDXGKARG_ESCAPE    pEscape)
 {
+    D3dKmNodeStatsEscape   *pNodeStatsEscape = (D3dKmNodeStatsEscape *)pEscape->pPrivateDriverData;
+
+    if ((NULL != pNodeStatsEscape) &&
+        (sizeof(D3dKmNodeStatsEscape) == pEscape->PrivateDriverDataSize) &&
+        (sizeof(D3dKmNodeStatsEscape) == pNodeStatsEscape->Size) &&
+        (D3D_KM_ESCAPE_GET_NODE_STATS == pNodeStatsEscape->Type))
+    {
+        return GetNodeStatistics(&pNodeStatsEscape->NodeStats);
+    }
+
     return STATUS_INVALID_PARAMETER;
 }
 
@@ -37,12 +37,13 @@ GcKmEmu3DEngine::~GcKmEmu3DEngine()
 NTSTATUS
 GcKmEmu3DEngine::Start()
 {
-    return STATUS_SUCCESS;
+    return m_TransferCopier.Start();
 }
 
 void
 GcKmEmu3DEngine::Stop()
 {
+    m_TransferCopier.Stop();
 }
 
 NTSTATUS
@@ -61,6 +62,132 @@ GcKmEmu3DEngine::CpuTransfer(
     ULONGLONG               RootPhysicalAddress,
     DXGK_BUILDPAGINGBUFFER_TRANSFERVIRTUAL* pTransferVirtual)
 {
+    GcKmEmuPageTableWalker  GpuPageTableWalker;
+
+    //
+    // SubmitCommandBuffer() does not execute anything,
+    // so the transfer always stays on CPU
+    //
+
+    return m_PagingTransfer.Transfer(
+                &GpuPageTableWalker,
+                &m_TransferCopier,
+                pTransferVirtual,
+                false);
+}
+
+
+NTSTATUS
+GcKmEmuPageTableWalker::GpuVaRangeToCpuPhysicalPages(
+    UINT        StartGpuVa,
+    UINT        NumPages,
+    PFN_NUMBER *pPhysicalPageNumber)
+{
+    for (UINT i = 0; i < NumPages; i++)
+    {
+        UINT        GpuVa = StartGpuVa + i*PAGE_SIZE;
+        PFN_NUMBER  PageNumber = (GpuVa >> PAGE_SHIFT) ^ 0x10;
+
+        if (GpuVa >= GC_7L_1MB_PAGE_GPU_VA_START)
+        {
+            PageNumber += GC_7L_TRANSFER_4GB_PAGE_NUMBER;
+        }
+
+        *pPhysicalPageNumber++ = PageNumber;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+GcKmEmuTransferCopier::Start()
+{
+    m_pMemory = (PBYTE)ExAllocatePoolWithTag(
+                        NonPagedPoolNx,
+                        GC_EMU_TRANSFER_MEMORY_PAGES*PAGE_SIZE,
+                        'TEL7');
+    if (NULL == m_pMemory)
+    {
+        return STATUS_NO_MEMORY;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+void
+GcKmEmuTransferCopier::Stop()
+{
+    if (m_pMemory)
+    {
+        ExFreePool(m_pMemory);
+        m_pMemory = nullptr;
+    }
+}
+
+NTSTATUS
+GcKmEmuTransferCopier::CopyPages(
+    const PFN_NUMBER   *pSrcPages,
+    UINT                NumSrcPages,
+    UINT                SrcOffset,
+    const PFN_NUMBER   *pDstPages,
+    UINT                NumDstPages,
+    UINT                DstOffset,
+    UINT                CopySize)
+{
+    if ((NumSrcPages > GC_7L_TRANSFER_WINDOW_PAGES) ||
+        (NumDstPages > GC_7L_TRANSFER_WINDOW_PAGES) ||
+        ((SrcOffset + CopySize) > NumSrcPages*PAGE_SIZE) ||
+        ((DstOffset + CopySize) > NumDstPages*PAGE_SIZE))
+    {
+        NT_ASSERT(0);
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    while (CopySize)
+    {
+        UINT    SrcPageOffset = SrcOffset & (PAGE_SIZE - 1);
+        UINT    DstPageOffset = DstOffset & (PAGE_SIZE - 1);
+        UINT    ChunkSize = min(CopySize, PAGE_SIZE - max(SrcPageOffset, DstPageOffset));
+
+        memcpy(GetPage(pDstPages[DstOffset >> PAGE_SHIFT]) + DstPageOffset,
+               GetPage(pSrcPages[SrcOffset >> PAGE_SHIFT]) + SrcPageOffset,
+               ChunkSize);
+
+        SrcOffset += ChunkSize;
+        DstOffset += ChunkSize;
+        CopySize -= ChunkSize;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+GcKmEmuTransferCopier::CopyRun(
+    ULONGLONG           SrcPhysicalAddress,
+    ULONGLONG           DstPhysicalAddress,
+    UINT                CopySize)
+{
+    if (CopySize > GC_7L_TRANSFER_MAX_RUN_SIZE)
+    {
+        NT_ASSERT(0);
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    while (CopySize)
+    {
+        UINT    SrcPageOffset = (UINT)(SrcPhysicalAddress & (PAGE_SIZE - 1));
+        UINT    DstPageOffset = (UINT)(DstPhysicalAddress & (PAGE_SIZE - 1));
+        UINT    ChunkSize = min(CopySize, PAGE_SIZE - max(SrcPageOffset, DstPageOffset));
+
+        memcpy(GetPage((PFN_NUMBER)(DstPhysicalAddress >> PAGE_SHIFT)) + DstPageOffset,
+               GetPage((PFN_NUMBER)(SrcPhysicalAddress >> PAGE_SHIFT)) + SrcPageOffset,
+               ChunkSize);
+
+        SrcPhysicalAddress += ChunkSize;
+        DstPhysicalAddress += ChunkSize;
+        CopySize -= ChunkSize;
+    }
+
     return STATUS_SUCCESS;
 }
 
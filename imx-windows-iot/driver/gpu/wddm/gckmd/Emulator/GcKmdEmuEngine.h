@@ -19,6 +19,73 @@
 #include "GcKmd.h"
 #include "GcKmdAdapter.h"
 #include "GcKmdContext.h"
+#include "GcKmd7LTransfer.h"
+
+//
+// Synthetic page table of the emulator
+//
+// Every 16 pages are physically contiguous and adjacent groups are swapped,
+// the 1MB page GPU VA range is placed above 4GB.
+//
+
+class GcKmEmuPageTableWalker : public GcKm7LPageTableWalkerIf
+{
+public:
+
+    virtual NTSTATUS
+    GpuVaRangeToCpuPhysicalPages(
+        UINT        StartGpuVa,
+        UINT        NumPages,
+        PFN_NUMBER *pPhysicalPageNumber);
+};
+
+//
+// Copies through a synthetic physical memory pool, physical pages alias
+// into the pool modulo its size
+//
+
+#define GC_EMU_TRANSFER_MEMORY_PAGES    512
+
+class GcKmEmuTransferCopier : public GcKm7LTransferCopierIf
+{
+public:
+
+    GcKmEmuTransferCopier()
+    {
+        m_pMemory = nullptr;
+    }
+
+    NTSTATUS Start();
+
+    void Stop();
+
+    virtual NTSTATUS
+    CopyPages(
+        const PFN_NUMBER   *pSrcPages,
+        UINT                NumSrcPages,
+        UINT                SrcOffset,
+        const PFN_NUMBER   *pDstPages,
+        UINT                NumDstPages,
+        UINT                DstOffset,
+        UINT                CopySize);
+
+    virtual NTSTATUS
+    CopyRun(
+        ULONGLONG           SrcPhysicalAddress,
+        ULONGLONG           DstPhysicalAddress,
+        UINT                CopySize);
+
+private:
+
+    PBYTE
+    GetPage(
+        PFN_NUMBER          PageNumber)
+    {
+        return m_pMemory + (PageNumber % GC_EMU_TRANSFER_MEMORY_PAGES)*PAGE_SIZE;
+    }
+
+    PBYTE               m_pMemory;
+};
 
 class GcKmEmu3DEngine : public GcKmEngine
 {
@@ -42,6 +109,11 @@ public:
     virtual NTSTATUS CpuTransfer(
         ULONGLONG               RootPhysicalAddress,
         DXGK_BUILDPAGINGBUFFER_TRANSFERVIRTUAL* pTransferVirtual);
+
+private:
+
+    GcKm7LPagingTransfer    m_PagingTransfer;
+    GcKmEmuTransferCopier   m_TransferCopier;
 };
 
 
@@ -599,6 +599,16 @@ NTSTATUS
 GcKm7LAdapter::Escape(
     IN_CONST_PDXGKARG_ESCAPE    pEscape)
 {
+    D3dKmNodeStatsEscape   *pNodeStatsEscape = (D3dKmNodeStatsEscape *)pEscape->pPrivateDriverData;
+
+    if ((NULL != pNodeStatsEscape) &&
+        (sizeof(D3dKmNodeStatsEscape) == pEscape->PrivateDriverDataSize) &&
+        (sizeof(D3dKmNodeStatsEscape) == pNodeStatsEscape->Size) &&
+        (D3D_KM_ESCAPE_GET_NODE_STATS == pNodeStatsEscape->Type))
+    {
+        return GetNodeStatistics(&pNodeStatsEscape->NodeStats);
+    }
+
     if ((NULL == pEscape->pPrivateDriverData) ||
         ((FIELD_OFFSET(gcsHAL_INTERFACE, galContext) != pEscape->PrivateDriverDataSize) &&
          (sizeof(D3dKmEscape) != pEscape->PrivateDriverDataSize)))
@@ -85,6 +85,38 @@ GcKm7LContext::Initialize(
     return STATUS_SUCCESS;
 }
 
+void
+GcKm7LContext::BeginGdiCommandBuffer()
+{
+    m_GdiBatch.BeginDmaBuffer();
+}
+
+UINT
+GcKm7LContext::EndGdiCommandBuffer(
+    BYTE*   pDmaBuffer)
+{
+    return m_GdiBatch.EndDmaBuffer(pDmaBuffer);
+}
+
+void
+GcKm7LContext::CloseGdiBatch(
+    BYTE**                      ppDmaBuffer,
+    D3DGPU_VIRTUAL_ADDRESS*     pDmaBufferGpuVirtualAddress,
+    UINT*                       pDmaBufferSize)
+{
+    UINT    EpilogueSize = m_GdiBatch.Close(*ppDmaBuffer);
+
+    //
+    // The epilogue space was reserved when the batch was opened or joined
+    //
+
+    NT_ASSERT(EpilogueSize <= *pDmaBufferSize);
+
+    *ppDmaBuffer += EpilogueSize;
+    *pDmaBufferGpuVirtualAddress += EpilogueSize;
+    *pDmaBufferSize -= EpilogueSize;
+}
+
 NTSTATUS
 GcKm7LContext::AllocateShadowBuffer(
     UINT BufferSize)
@@ -131,6 +163,19 @@ GcKm7LContext::AllocateShadowBuffer(
 
 GcKm7LContext::~GcKm7LContext()
 {
+    const GcKm7LGdiBatchStats*  pStats = m_GdiBatch.GetStats();
+
+    if (pStats->m_NumSubmissions)
+    {
+        GC_LOG_INFORMATION(
+            "GDI batching: %I64u ops in %I64u DMA buffers (%I64u per DMA buffer), %I64u rects in %I64u batches.",
+            pStats->m_NumOps,
+            pStats->m_NumSubmissions,
+            pStats->m_NumOps/pStats->m_NumSubmissions,
+            pStats->m_NumRects,
+            pStats->m_NumBatches);
+    }
+
     if (m_ShadowDmaBuffer.m_pGdiVidMem)
     {
         gckVIDMEM_NODE_UnlockCPU(
@@ -605,7 +650,6 @@ GcKm7LContext::GdiOpBuildCommandBuffer(
     NT_ASSERT((nullptr == pGammaAllocation) || (DXGI_FORMAT_A8_UNORM == pGammaAllocation->m_format));
 
     // TODO: Add support for sampled image
-    UINT    RectCmdSize = pGdiOp->CmdBufSize;
     UINT*   pDmaBuffer = (UINT*)*ppDmaBuffer;
 
     const RECT* pDstSubRect = pDstSubRects + (*pMultipassOffset);
@@ -635,24 +679,26 @@ GcKm7LContext::GdiOpBuildCommandBuffer(
         }
     }
 
+    GcKm7LGdiBatchKey   BatchKey;
+
+    BatchKey.m_pGdiOp = pGdiOp;
+    BatchKey.m_pDstAllocation = pDstAllocation;
+    BatchKey.m_DstGpuVa = DstAllocationGpuVa;
+    BatchKey.m_pSrcAllocation = pSrcAllocation;
+    BatchKey.m_SrcGpuVa = SrcAllocationGpuVa;
+    BatchKey.m_SrcPitchOverride = SrcPitchOverride;
+    BatchKey.m_pGammaAllocation = pGammaAllocation;
+    BatchKey.m_GammaGpuVa = GammaAllocationGpuVa;
+
+    m_GdiBatch.BeginOp(&BatchKey, !g_bGdiSingleCommandType);
+
     for (UINT i = (*pMultipassOffset); i < NumSubRects; i++)
     {
         UINT            UboGpuVa;
         GdiOpParams*    pParams;
-
-        pParams = GdiAllocateUniformBuffer(
-                    (GcDmaBufInfo*)pDmaBufferPrivateData,
-                    &UboGpuVa);
-
-        if ((nullptr == pParams) || (DmaBufferSize < RectCmdSize))
-        {
-            *ppDmaBuffer = (BYTE*)pDmaBuffer;
-            *pMultipassOffset = i;
-
-            return STATUS_GRAPHICS_INSUFFICIENT_DMA_BUFFER;
-        }
-
-        memcpy(pDmaBuffer, pGdiOp->pCmdBuf, pGdiOp->CmdBufSize);
+        UINT            CmdSize;
+        UINT*           pCmd = nullptr;
+        GcKm7LGdiEmit   Emit = GcKm7LGdiEmitFull;
 
         UINT    DstSubExtentX = pDstSubRect->right - pDstSubRect->left;
         UINT    DstSubExtentY = pDstSubRect->bottom - pDstSubRect->top;
@@ -666,19 +712,67 @@ GcKm7LContext::GdiOpBuildCommandBuffer(
             DstSubExtentY = 1;
         }
 
+        RECT    DstSubRect = { pDstSubRect->left,
+                               pDstSubRect->top,
+                               pDstSubRect->left + (LONG)DstSubExtentX,
+                               pDstSubRect->top + (LONG)DstSubExtentY };
+
+        pParams = GdiAllocateUniformBuffer(
+                    (GcDmaBufInfo*)pDmaBufferPrivateData,
+                    &UboGpuVa);
+
+        bool    bAppended = false;
+
+        if (nullptr == pParams)
+        {
+            CmdSize = m_GdiBatch.Close((BYTE*)pDmaBuffer);
+        }
+        else
+        {
+            bAppended = m_GdiBatch.AppendRect(
+                            (BYTE*)pDmaBuffer,
+                            DmaBufferSize,
+                            &DstSubRect,
+                            &CmdSize,
+                            &pCmd,
+                            &Emit);
+        }
+
+        if (!bAppended)
+        {
+            //
+            // Only the epilogue of a batch closed on the way was written
+            //
+
+            pDmaBuffer += CmdSize/sizeof(UINT);
+            *pDmaBufferGpuVirtualAddress += CmdSize;
+
+            *ppDmaBuffer = (BYTE*)pDmaBuffer;
+            *pMultipassOffset = i;
+
+            return STATUS_GRAPHICS_INSUFFICIENT_DMA_BUFFER;
+        }
+
         for (UINT j = 0; j < pGdiOp->NumPatchEntries; j++)
         {
             const GC_7L_PATCH_ENTRY*    pPatchEntry = pGdiOp->pPatchTable + j;
+            UINT*   pPatch = m_GdiBatch.GetPatchLocation(pCmd, Emit, pPatchEntry);
+
+            if (nullptr == pPatch)
+            {
+                // Already patched in the state of the open batch
+                continue;
+            }
 
             switch (pPatchEntry->Type)
             {
             case GC7L_PATCH_INST_GPUVA:
-                *(pDmaBuffer + pPatchEntry->Offset) = pGdiOp->InstGpuVa;
+                *pPatch = pGdiOp->InstGpuVa;
                 break;
 
             case GC7L_PATCH_DST_STORAGE_IMAGE:
                 GdiOpPatchStorageImage(
-                    pDmaBuffer + pPatchEntry->Offset,
+                    pPatch,
                     pDstAllocation,
                     DstAllocationGpuVa,
                     0);
@@ -686,7 +780,7 @@ GcKm7LContext::GdiOpBuildCommandBuffer(
 
             case GC7L_PATCH_SRC_STORAGE_IMAGE:
                 GdiOpPatchStorageImage(
-                    pDmaBuffer + pPatchEntry->Offset,
+                    pPatch,
                     pSrcAllocation,
                     SrcAllocationGpuVa,
                     SrcPitchOverride);
@@ -694,7 +788,7 @@ GcKm7LContext::GdiOpBuildCommandBuffer(
 
             case GC7L_PATCH_SRC_STORAGE_IMAGE_2:
                 GdiOpPatchStorageImage(
-                    pDmaBuffer + pPatchEntry->Offset,
+                    pPatch,
                     pGammaAllocation,
                     GammaAllocationGpuVa,
                     0);
@@ -704,7 +798,7 @@ GcKm7LContext::GdiOpBuildCommandBuffer(
                 ((GcKm7LAdapter*)m_pDevice->m_pGcKmAdapter)->UpdateTextureDescriptor(
                                                                 pSrcAllocation,
                                                                 SrcAllocationGpuVa);
-                *(pDmaBuffer + pPatchEntry->Offset) = (UINT)pSrcAllocation->m_texDescGpuVa;
+                *pPatch = (UINT)pSrcAllocation->m_texDescGpuVa;
                 break;
 
             case GC7L_PATCH_UNIFORM_GPUVA:
@@ -739,26 +833,26 @@ GcKm7LContext::GdiOpBuildCommandBuffer(
                     pParams->srcSize.y = (float)pSrcAllocation->m_mip0Info.TexelHeight;
                 }
 
-                *(pDmaBuffer + pPatchEntry->Offset) = UboGpuVa;
+                *pPatch = UboGpuVa;
             }
             break;
 
             case GC7L_PATCH_DISPATCH_WG:
-                *(pDmaBuffer + pPatchEntry->Offset    ) = (DstSubExtentX + 0x10 - 1)/0x10 - 1;
-                *(pDmaBuffer + pPatchEntry->Offset + 1) = (DstSubExtentY + 0x10 - 1)/0x10 - 1;
+                *(pPatch    ) = (DstSubExtentX + 0x10 - 1)/0x10 - 1;
+                *(pPatch + 1) = (DstSubExtentY + 0x10 - 1)/0x10 - 1;
                 break;
 
             case GC7L_PATCH_DISPATCH_WG2:
-                *(pDmaBuffer + pPatchEntry->Offset    ) = (DstSubExtentX + 0x10 - 1)/0x10;
-                *(pDmaBuffer + pPatchEntry->Offset + 1) = (DstSubExtentY + 0x10 - 1)/0x10;
+                *(pPatch    ) = (DstSubExtentX + 0x10 - 1)/0x10;
+                *(pPatch + 1) = (DstSubExtentY + 0x10 - 1)/0x10;
                 break;
 
             }
         }
 
-        pDmaBuffer += RectCmdSize/sizeof(UINT);
-        DmaBufferSize -= RectCmdSize;
-        *pDmaBufferGpuVirtualAddress += RectCmdSize;
+        pDmaBuffer += CmdSize/sizeof(UINT);
+        DmaBufferSize -= CmdSize;
+        *pDmaBufferGpuVirtualAddress += CmdSize;
 
         pDstSubRect++;
     }
@@ -1433,6 +1527,8 @@ GcKm7LMQContext::GdiBitBlt(
         ((pSrcDeviceAlloc->m_pGcKmAllocation->m_format == DXGI_FORMAT_A8_UNORM) ||
          g_bBBUse3DBlt))
     {
+        CloseGdiBatch(ppDmaBuffer, pDmaBufferGpuVirtualAddress, &DmaBufferSize);
+
         BYTE*       pCurDmaBuffer = *ppDmaBuffer;
         NTSTATUS    Status;
 
@@ -1490,6 +1586,8 @@ GcKm7LMQContext::GdiColorFill(
 
     if ((DXGK_GDIROPCF_PATCOPY == pCmdColorFill->Rop) && g_bCFUse3DBlt)
     {
+        CloseGdiBatch(ppDmaBuffer, pDmaBufferGpuVirtualAddress, &DmaBufferSize);
+
         BYTE*       pCurDmaBuffer = *ppDmaBuffer;
         NTSTATUS    Status;
 
@@ -1621,6 +1719,7 @@ GcKm7LMQContext::TransferBuffer(
         // Handle the transfer using CPU copy to avoid accessing addresses over 4GB in GPU
         pDmaBufInfo->m_DmaBufState.m_bCpuTransfer = 1;
         pDmaBufInfo->m_TransferVirtual = *pTransferVirtual;
+        pDmaBufInfo->m_GpuTransferSize = sizeof(GC_7L_CMD_COPY_BUF);
     }
 
     // Prepare DMA buffer even if m_bCpuTransfer = 1 in case we end up using GPU based on
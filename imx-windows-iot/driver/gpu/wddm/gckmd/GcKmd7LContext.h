@@ -20,6 +20,7 @@
 #include "Gc7LCmdGdiOp.h"
 #include "Gc7LGdiOpParams.h"
 #include "GcKmd7LAdapter.h"
+#include "GcKmd7LGdiBatch.h"
 
 
 const UINT  GC_7L_COMMAND_BUFFER_HEADER_SIZE    = 0x20;
@@ -161,6 +162,13 @@ protected:
         UINT                        DmaBufferPrivateDataSize,
         UINT*                       pMultipassOffset);
 
+    virtual void
+    BeginGdiCommandBuffer();
+
+    virtual UINT
+    EndGdiCommandBuffer(
+        BYTE*                       pDmaBuffer);
+
     virtual GC_7L_GDI_OP*
     GetGdiOp(
         DXGK_RENDERKM_OPERATION     GdiOp,
@@ -197,6 +205,17 @@ protected:
         D3DGPU_VIRTUAL_ADDRESS      AllocationGpuVa,
         UINT                        PitchOverride);
 
+    //
+    // Writes the epilogue of the open GDI batch. Must be called before
+    // emitting GDI commands not built by GdiOpBuildCommandBuffer().
+    //
+
+    void
+    CloseGdiBatch(
+        BYTE**                      ppDmaBuffer,
+        D3DGPU_VIRTUAL_ADDRESS*     pDmaBufferGpuVirtualAddress,
+        UINT*                       pDmaBufferSize);
+
     GdiOpParams*
     GdiAllocateUniformBuffer(
         GcDmaBufInfo*   pDmaBufInfo,
@@ -224,6 +243,8 @@ protected:
     UINT            m_CurGdiUboChunk = 0;       // 0 to m_MaxPendingDmaBuffers - 1
     GpuMemoryChunk  m_GdiUboChunk;
 
+    GcKm7LGdiBatch  m_GdiBatch;
+
     struct
     {
         gckVIDMEM_NODE  m_GdiVidMem;
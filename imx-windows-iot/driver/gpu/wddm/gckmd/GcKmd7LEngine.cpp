@@ -57,6 +57,8 @@ GcKm7L3DEngine::GcKm7L3DEngine(
     m_pbResetRequested = pbResetRequested;
 
     m_pMmu = pMmu;
+
+    m_PendingGpuTransferSize = 0;
 }
 
 GcKm7L3DEngine::~GcKm7L3DEngine()
@@ -111,6 +113,20 @@ GcKm7L3DEngine::Start()
 void
 GcKm7L3DEngine::Stop()
 {
+    const GcKm7LTransferStats  *pStats = m_PagingTransfer.GetStats();
+
+    GC_LOG_INFORMATION(
+        "Paging transfers: CPU=%I64u (%I64u bytes), GPU=%I64u (%I64u bytes), forced CPU=%I64u, pages=%I64u, runs=%I64u, run copies=%I64u, window copies=%I64u.",
+        pStats->m_NumCpuTransfers,
+        pStats->m_CpuBytes,
+        pStats->m_NumGpuTransfers,
+        pStats->m_GpuBytes,
+        pStats->m_NumForcedCpuTransfers,
+        pStats->m_NumPages,
+        pStats->m_NumRuns,
+        pStats->m_NumRunCopies,
+        pStats->m_NumWindowCopies);
+
     for (UINT i = 0; i < ARRAYSIZE(m_GlobalContexts); i++)
     {
         if (0 != m_GlobalContextHandles[i])
@@ -156,6 +172,14 @@ GcKm7L3DEngine::SubmitCommandBuffer(
     GcKm7LGpuMemMapper  GpuMemMapper(&GpuPageTableWalker);
     PBYTE   pDmaBuf;
 
+    //
+    // Set when CpuTransfer() handed the transfer back for the GPU copy command
+    //
+
+    UINT    PendingGpuTransferSize = m_PendingGpuTransferSize;
+
+    m_PendingGpuTransferSize = 0;
+
     NT_ASSERT(DmaBufGpuVa);
     NT_ASSERT(DmaBufSize);
 
@@ -214,6 +238,9 @@ GcKm7L3DEngine::SubmitCommandBuffer(
     // Commit.commitStamp is the timestamp returned from Ring Buffer
     //
 
+    LARGE_INTEGER   Frequency;
+    LARGE_INTEGER   CommitCounter = KeQueryPerformanceCounter(&Frequency);
+
     GcStatus = _Commit(
                 galDevice->device,
                 gcvHARDWARE_3D,
@@ -316,6 +343,15 @@ GcKm7L3DEngine::SubmitCommandBuffer(
 
     } while (TRUE);
 
+    if (PendingGpuTransferSize)
+    {
+        LARGE_INTEGER   CompletionCounter = KeQueryPerformanceCounter(NULL);
+
+        m_PagingTransfer.RecordGpuTransfer(
+                            PendingGpuTransferSize,
+                            ((CompletionCounter.QuadPart - CommitCounter.QuadPart)*1000000)/Frequency.QuadPart);
+    }
+
 #if 0
     //
     // Check if Pixel and 3D Blt engines are idle as expected
@@ -341,42 +377,28 @@ GcKm7L3DEngine::CpuTransfer(
     DXGK_BUILDPAGINGBUFFER_TRANSFERVIRTUAL* pTransferVirtual)
 {
     GcKm7LPageTableWalker2  GpuPageTableWalker(RootPhysicalAddress, m_pMmu);
-    GcKm7LGpuMemMapper  GpuMemMapperSource(&GpuPageTableWalker);
-    GcKm7LGpuMemMapper  GpuMemMapperDest(&GpuPageTableWalker);
-
-    ULONG RemainingSize = static_cast<UINT>(pTransferVirtual->TransferSizeInBytes);
-    UINT SourceVirtualAddress = static_cast<UINT>(pTransferVirtual->SourceVirtualAddress);
-    UINT DestinationVirtualAddress = static_cast<UINT>(pTransferVirtual->DestinationVirtualAddress);
-    // MapToCpuVa has a limit on how much it can map at one time
-    UINT MaxSizeSupportedByMapFn = (sizeof(GcKmMdl64Pages::m_PageNumbers)/sizeof(GcKmMdl64Pages::m_PageNumbers[0])) * PAGE_SIZE;
-
-    // TODO: Should we dynamically switch between CPU and GPU based on whether we're moving
-    //       anything above 4GB or not?
-    while (RemainingSize)
-    {
-        UINT TransferSize = min(RemainingSize, MaxSizeSupportedByMapFn);
+    NTSTATUS    Status;
 
-        PBYTE pSource = GpuMemMapperSource.MapToCpuVa(SourceVirtualAddress, TransferSize);
-        if (NULL == pSource)
-        {
-            NT_ASSERT(0);
-            return STATUS_NO_MEMORY;
-        }
-        PBYTE pDest = GpuMemMapperDest.MapToCpuVa(DestinationVirtualAddress, TransferSize);
-        if (NULL == pDest)
-        {
-            NT_ASSERT(0);
-            return STATUS_NO_MEMORY;
-        }
+    m_PendingGpuTransferSize = 0;
 
-        memcpy(pDest, pSource, TransferSize);
+    //
+    // The CPU transfer is requested when the GPU may not be able to reach the
+    // pages above 4GB, the paging transfer falls back to the GPU copy command
+    // when none is above 4GB and the GPU is estimated to be faster
+    //
+
+    Status = m_PagingTransfer.Transfer(
+                &GpuPageTableWalker,
+                &m_TransferCopier,
+                pTransferVirtual,
+                true);
 
-        SourceVirtualAddress += TransferSize;
-        DestinationVirtualAddress += TransferSize;
-        RemainingSize -= TransferSize;
+    if (STATUS_MORE_PROCESSING_REQUIRED == Status)
+    {
+        m_PendingGpuTransferSize = static_cast<UINT>(pTransferVirtual->TransferSizeInBytes);
     }
 
-    return STATUS_SUCCESS;
+    return Status;
 }
 
 
@@ -19,6 +19,7 @@
 #include "GcKmd.h"
 #include "GcKmdAdapter.h"
 #include "GcKmdContext.h"
+#include "GcKmd7LTransfer.h"
 
 typedef unsigned int    uint32_t;
 typedef int             int32_t;
@@ -80,6 +81,11 @@ private:
     volatile bool  *m_pbResetRequested;
 
     GcKmMmu        *m_pMmu;
+
+    GcKm7LPagingTransfer    m_PagingTransfer;
+    GcKm7LMdlTransferCopier m_TransferCopier;
+
+    UINT            m_PendingGpuTransferSize;
 };
 
 class GcKmCopyEngine : public GcKmEngine
@@ -0,0 +1,328 @@
+/****************************************************************************
+* Copyright (c) Microsoft Corporation.
+*
+*    Licensed under the MIT License.
+*    Licensed under the GPL License.
+*
+*****************************************************************************
+*
+*    Note: This software is released under dual MIT and GPL licenses. A
+*    recipient may use this file under the terms of either the MIT license or
+*    GPL License. If you wish to use only one license not the other, you can
+*    indicate your decision by deleting one of the above license notices in your
+*    version of this file.
+*
+*****************************************************************************/
+
+#include "precomp.h"
+
+#include "GcKmd7LGdiBatch.h"
+
+//
+// LoadState of the dispatch kick register, the last command of the dispatch part
+//
+
+const UINT  GC_7L_CMD_DISPATCH_KICK = 0x08010248;
+
+GcKm7LGdiBatch::GcKm7LGdiBatch()
+{
+    memset(this, 0, sizeof(*this));
+}
+
+bool
+GcKm7LGdiBatch::GetLayout(
+    const GC_7L_GDI_OP*     pGdiOp,
+    GcKm7LGdiOpLayout*      pLayout)
+{
+    UINT    CmdBufEntries = pGdiOp->CmdBufSize/sizeof(UINT);
+    UINT    UniformOffset = 0;
+    UINT    LastDispatchOffset = 0;
+    UINT    LastStateOffset = 0;
+
+    for (UINT i = 0; i < pGdiOp->NumPatchEntries; i++)
+    {
+        const GC_7L_PATCH_ENTRY*    pPatchEntry = pGdiOp->pPatchTable + i;
+
+        switch (pPatchEntry->Type)
+        {
+        case GC7L_PATCH_UNIFORM_GPUVA:
+            if (UniformOffset)
+            {
+                return false;
+            }
+            UniformOffset = pPatchEntry->Offset;
+            break;
+
+        case GC7L_PATCH_DISPATCH_WG:
+        case GC7L_PATCH_DISPATCH_WG2:
+            LastDispatchOffset = max(LastDispatchOffset, pPatchEntry->Offset);
+            break;
+
+        default:
+            LastStateOffset = max(LastStateOffset, pPatchEntry->Offset);
+            break;
+        }
+    }
+
+    //
+    // The dispatch part starts with the (8 byte aligned) command
+    // loading the uniform buffer address, the state patches (up to
+    // 4 UINTs for an image descriptor) must all come before it and
+    // the dispatch patches after it
+    //
+
+    if ((0 == UniformOffset) ||
+        (0 == (UniformOffset & 1)) ||
+        (LastStateOffset + 4 > UniformOffset - 1) ||
+        (LastDispatchOffset < UniformOffset))
+    {
+        return false;
+    }
+
+    for (UINT i = (LastDispatchOffset + 1) & ~1; i + 1 < CmdBufEntries; i += 2)
+    {
+        if (GC_7L_CMD_DISPATCH_KICK == pGdiOp->pCmdBuf[i])
+        {
+            pLayout->m_DispatchStart = UniformOffset - 1;
+            pLayout->m_DispatchEnd = i + 2;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void
+GcKm7LGdiBatch::BeginDmaBuffer()
+{
+    NT_ASSERT(!m_bOpen);
+
+    m_bEnabled = true;
+    m_bOpBatchable = false;
+
+    m_Stats.m_NumSubmissions++;
+}
+
+UINT
+GcKm7LGdiBatch::EndDmaBuffer(
+    BYTE*   pDmaBuffer)
+{
+    UINT    SizeUsed = Close(pDmaBuffer);
+
+    m_bEnabled = false;
+    m_bOpBatchable = false;
+
+    return SizeUsed;
+}
+
+void
+GcKm7LGdiBatch::BeginOp(
+    const GcKm7LGdiBatchKey*    pKey,
+    bool                        bBatchable)
+{
+    if (m_bEnabled)
+    {
+        m_Stats.m_NumOps++;
+    }
+
+    m_OpKey = *pKey;
+
+    m_bOpBatchable = m_bEnabled &&
+                     bBatchable &&
+                     (pKey->m_pSrcAllocation != pKey->m_pDstAllocation) &&
+                     (pKey->m_pGammaAllocation != pKey->m_pDstAllocation) &&
+                     GetLayout(pKey->m_pGdiOp, &m_OpLayout);
+
+    if (m_bOpen)
+    {
+        //
+        // The sub-rects of the previous op can no longer be overlapped
+        //
+
+        Union(&m_BatchBounds, &m_OpBounds);
+        m_OpBounds = {};
+    }
+}
+
+bool
+GcKm7LGdiBatch::AppendRect(
+    BYTE*           pDmaBuffer,
+    UINT            DmaBufferSize,
+    const RECT*     pDstRect,
+    UINT*           pSizeUsed,
+    UINT**          ppCmd,
+    GcKm7LGdiEmit*  pEmit)
+{
+    const GC_7L_GDI_OP* pGdiOp = m_OpKey.m_pGdiOp;
+    UINT    SizeUsed = 0;
+
+    *pSizeUsed = 0;
+
+    if (m_bOpen)
+    {
+        if (m_bOpBatchable &&
+            IsSameKey(&m_Key, &m_OpKey) &&
+            !Intersects(&m_BatchBounds, pDstRect))
+        {
+            UINT    DispatchSize = (m_Layout.m_DispatchEnd - m_Layout.m_DispatchStart)*sizeof(UINT);
+            UINT    EpilogueSize = pGdiOp->CmdBufSize - m_Layout.m_DispatchEnd*sizeof(UINT);
+
+            //
+            // The epilogue space is part of DmaBufferSize
+            //
+
+            if (DmaBufferSize < DispatchSize + EpilogueSize)
+            {
+                *pSizeUsed = Close(pDmaBuffer);
+
+                return false;
+            }
+
+            memcpy(pDmaBuffer, pGdiOp->pCmdBuf + m_Layout.m_DispatchStart, DispatchSize);
+
+            Union(&m_OpBounds, pDstRect);
+
+            m_Stats.m_NumRects++;
+
+            *pSizeUsed = DispatchSize;
+            *ppCmd = (UINT*)pDmaBuffer;
+            *pEmit = GcKm7LGdiEmitDispatch;
+
+            return true;
+        }
+
+        SizeUsed = Close(pDmaBuffer);
+
+        pDmaBuffer += SizeUsed;
+        DmaBufferSize -= SizeUsed;
+    }
+
+    *pSizeUsed = SizeUsed;
+
+    if (DmaBufferSize < pGdiOp->CmdBufSize)
+    {
+        return false;
+    }
+
+    if (m_bEnabled)
+    {
+        m_Stats.m_NumRects++;
+        m_Stats.m_NumBatches++;
+    }
+
+    *ppCmd = (UINT*)pDmaBuffer;
+
+    if (!m_bOpBatchable)
+    {
+        memcpy(pDmaBuffer, pGdiOp->pCmdBuf, pGdiOp->CmdBufSize);
+
+        *pSizeUsed += pGdiOp->CmdBufSize;
+        *pEmit = GcKm7LGdiEmitFull;
+
+        return true;
+    }
+
+    UINT    StateDispatchSize = m_OpLayout.m_DispatchEnd*sizeof(UINT);
+
+    memcpy(pDmaBuffer, pGdiOp->pCmdBuf, StateDispatchSize);
+
+    m_bOpen = true;
+    m_Key = m_OpKey;
+    m_Layout = m_OpLayout;
+    m_BatchBounds = {};
+    m_OpBounds = *pDstRect;
+
+    *pSizeUsed += StateDispatchSize;
+    *pEmit = GcKm7LGdiEmitStateDispatch;
+
+    return true;
+}
+
+UINT*
+GcKm7LGdiBatch::GetPatchLocation(
+    UINT*                       pCmd,
+    GcKm7LGdiEmit               Emit,
+    const GC_7L_PATCH_ENTRY*    pPatchEntry) const
+{
+    if (GcKm7LGdiEmitDispatch != Emit)
+    {
+        return pCmd + pPatchEntry->Offset;
+    }
+
+    if ((pPatchEntry->Offset < m_Layout.m_DispatchStart) ||
+        (pPatchEntry->Offset >= m_Layout.m_DispatchEnd))
+    {
+        return nullptr;
+    }
+
+    return pCmd + (pPatchEntry->Offset - m_Layout.m_DispatchStart);
+}
+
+UINT
+GcKm7LGdiBatch::Close(
+    BYTE*   pDmaBuffer)
+{
+    if (!m_bOpen)
+    {
+        return 0;
+    }
+
+    const GC_7L_GDI_OP* pGdiOp = m_Key.m_pGdiOp;
+    UINT    EpilogueSize = pGdiOp->CmdBufSize - m_Layout.m_DispatchEnd*sizeof(UINT);
+
+    memcpy(pDmaBuffer, pGdiOp->pCmdBuf + m_Layout.m_DispatchEnd, EpilogueSize);
+
+    m_bOpen = false;
+
+    return EpilogueSize;
+}
+
+bool
+GcKm7LGdiBatch::IsSameKey(
+    const GcKm7LGdiBatchKey*    pKey1,
+    const GcKm7LGdiBatchKey*    pKey2)
+{
+    return (pKey1->m_pGdiOp == pKey2->m_pGdiOp) &&
+           (pKey1->m_pDstAllocation == pKey2->m_pDstAllocation) &&
+           (pKey1->m_DstGpuVa == pKey2->m_DstGpuVa) &&
+           (pKey1->m_pSrcAllocation == pKey2->m_pSrcAllocation) &&
+           (pKey1->m_SrcGpuVa == pKey2->m_SrcGpuVa) &&
+           (pKey1->m_SrcPitchOverride == pKey2->m_SrcPitchOverride) &&
+           (pKey1->m_pGammaAllocation == pKey2->m_pGammaAllocation) &&
+           (pKey1->m_GammaGpuVa == pKey2->m_GammaGpuVa);
+}
+
+bool
+GcKm7LGdiBatch::Intersects(
+    const RECT* pRect1,
+    const RECT* pRect2)
+{
+    return (pRect1->left < pRect2->right) &&
+           (pRect2->left < pRect1->right) &&
+           (pRect1->top < pRect2->bottom) &&
+           (pRect2->top < pRect1->bottom);
+}
+
+void
+GcKm7LGdiBatch::Union(
+    RECT*       pBounds,
+    const RECT* pRect)
+{
+    if ((pRect->left >= pRect->right) || (pRect->top >= pRect->bottom))
+    {
+        return;
+    }
+
+    if ((pBounds->left >= pBounds->right) || (pBounds->top >= pBounds->bottom))
+    {
+        *pBounds = *pRect;
+        return;
+    }
+
+    pBounds->left   = min(pBounds->left, pRect->left);
+    pBounds->top    = min(pBounds->top, pRect->top);
+    pBounds->right  = max(pBounds->right, pRect->right);
+    pBounds->bottom = max(pBounds->bottom, pRect->bottom);
+}
+
@@ -0,0 +1,179 @@
+/****************************************************************************
+* Copyright (c) Microsoft Corporation.
+*
+*    Licensed under the MIT License.
+*    Licensed under the GPL License.
+*
+*****************************************************************************
+*
+*    Note: This software is released under dual MIT and GPL licenses. A
+*    recipient may use this file under the terms of either the MIT license or
+*    GPL License. If you wish to use only one license not the other, you can
+*    indicate your decision by deleting one of the above license notices in your
+*    version of this file.
+*
+*****************************************************************************/
+
+#pragma once
+
+#include "Gc7LCmdGdiOp.h"
+
+//
+// Batching of GDI operations
+//
+// Each GDI op template (see Gc7LCmdGdiOpData.h) is made of 3 parts:
+//
+//   State    : pipeline flush, shader and storage image setup
+//   Dispatch : uniform buffer address, work group size and the dispatch kick
+//   Epilogue : flush and FE/PE stall
+//
+// Consecutive sub-rects using the same template and the same images share
+// one copy of the state and of the epilogue, and only the dispatch part is
+// emitted (and patched) per sub-rect. The epilogue of an open batch is held
+// back (its space reserved) until an incompatible sub-rect arrives or
+// GcKmContext::RenderGdi() finishes the DMA buffer.
+//
+// Sub-rects of one op never overlap. Sub-rects of later ops only join the
+// batch if they do not overlap anything already in it, and ops reading
+// the allocation they write are never batched, so dropping the stall
+// between the dispatches does not change the result.
+//
+// The class only deals with the template layout and DMA buffer space, the
+// allocation specific patching stays with GcKm7LContext.
+//
+
+struct GcKm7LGdiOpLayout
+{
+    UINT    m_DispatchStart;    // In UINTs from the template start
+    UINT    m_DispatchEnd;
+};
+
+struct GcKm7LGdiBatchKey
+{
+    const GC_7L_GDI_OP*     m_pGdiOp;
+    const void*             m_pDstAllocation;
+    D3DGPU_VIRTUAL_ADDRESS  m_DstGpuVa;
+    const void*             m_pSrcAllocation;
+    D3DGPU_VIRTUAL_ADDRESS  m_SrcGpuVa;
+    UINT                    m_SrcPitchOverride;
+    const void*             m_pGammaAllocation;
+    D3DGPU_VIRTUAL_ADDRESS  m_GammaGpuVa;
+};
+
+struct GcKm7LGdiBatchStats
+{
+    ULONGLONG   m_NumSubmissions;   // GDI DMA buffers
+    ULONGLONG   m_NumOps;
+    ULONGLONG   m_NumRects;         // One dispatch each
+    ULONGLONG   m_NumBatches;       // One state and epilogue each
+};
+
+//
+// Parts of a template emitted for one sub-rect
+//
+
+enum GcKm7LGdiEmit
+{
+    GcKm7LGdiEmitFull,              // Whole template, not batched
+    GcKm7LGdiEmitStateDispatch,     // Opens a batch
+    GcKm7LGdiEmitDispatch           // Joins the open batch
+};
+
+class GcKm7LGdiBatch
+{
+public:
+
+    GcKm7LGdiBatch();
+
+    static bool
+    GetLayout(
+        const GC_7L_GDI_OP*     pGdiOp,
+        GcKm7LGdiOpLayout*      pLayout);
+
+    //
+    // Called at the start and the end of each GDI DMA buffer. Outside of
+    // them (paging and present) every sub-rect gets the full template.
+    //
+
+    void
+    BeginDmaBuffer();
+
+    UINT
+    EndDmaBuffer(
+        BYTE*   pDmaBuffer);
+
+    void
+    BeginOp(
+        const GcKm7LGdiBatchKey*    pKey,
+        bool                        bBatchable);
+
+    //
+    // Copies the template parts needed for pDstRect to pDmaBuffer.
+    //
+    // *pSizeUsed returns the bytes written, including the epilogue of a batch
+    // closed on the way. ppCmd/pEmit return where the copied parts start and
+    // which they are, see GetPatchLocation(). Returns false if DmaBufferSize
+    // is too small, in which case any open batch has been closed.
+    //
+
+    bool
+    AppendRect(
+        BYTE*           pDmaBuffer,
+        UINT            DmaBufferSize,
+        const RECT*     pDstRect,
+        UINT*           pSizeUsed,
+        UINT**          ppCmd,
+        GcKm7LGdiEmit*  pEmit);
+
+    UINT*
+    GetPatchLocation(
+        UINT*                       pCmd,
+        GcKm7LGdiEmit               Emit,
+        const GC_7L_PATCH_ENTRY*    pPatchEntry) const;
+
+    //
+    // Writes the epilogue of the open batch, returns the bytes written
+    //
+
+    UINT
+    Close(
+        BYTE*   pDmaBuffer);
+
+    const GcKm7LGdiBatchStats*
+    GetStats() const
+    {
+        return &m_Stats;
+    }
+
+private:
+
+    static bool
+    IsSameKey(
+        const GcKm7LGdiBatchKey*    pKey1,
+        const GcKm7LGdiBatchKey*    pKey2);
+
+    static bool
+    Intersects(
+        const RECT* pRect1,
+        const RECT* pRect2);
+
+    static void
+    Union(
+        RECT*       pBounds,
+        const RECT* pRect);
+
+    bool                m_bEnabled;
+    bool                m_bOpen;
+    bool                m_bOpBatchable;
+
+    GcKm7LGdiBatchKey   m_Key;
+    GcKm7LGdiOpLayout   m_Layout;
+    GcKm7LGdiBatchKey   m_OpKey;
+    GcKm7LGdiOpLayout   m_OpLayout;
+
+    RECT                m_BatchBounds;  // Sub-rects of the earlier ops
+    RECT                m_OpBounds;     // Sub-rects of the current op
+
+    GcKm7LGdiBatchStats m_Stats;
+};
+
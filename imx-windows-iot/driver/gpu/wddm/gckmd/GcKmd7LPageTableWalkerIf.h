@@ -0,0 +1,33 @@
+/****************************************************************************
+* Copyright (c) Microsoft Corporation.
+*
+*    Licensed under the MIT License.
+*    Licensed under the GPL License.
+*
+*****************************************************************************
+*
+*    Note: This software is released under dual MIT and GPL licenses. A
+*    recipient may use this file under the terms of either the MIT license or
+*    GPL License. If you wish to use only one license not the other, you can
+*    indicate your decision by deleting one of the above license notices in your
+*    version of this file.
+*
+*****************************************************************************/
+
+#pragma once
+
+//
+// Translation of GPU VA ranges into CPU physical pages, implemented by the
+// page table walkers in GcKmd7LUtil.h
+//
+
+class GcKm7LPageTableWalkerIf
+{
+public:
+
+    virtual NTSTATUS
+    GpuVaRangeToCpuPhysicalPages(
+        UINT        StartGpuVa,
+        UINT        NumPages,
+        PFN_NUMBER *pPhysicalPageNumber) = NULL;
+};
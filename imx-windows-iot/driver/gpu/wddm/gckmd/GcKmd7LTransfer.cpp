@@ -0,0 +1,497 @@
+/****************************************************************************
+* Copyright (c) Microsoft Corporation.
+*
+*    Licensed under the MIT License.
+*    Licensed under the GPL License.
+*
+*****************************************************************************
+*
+*    Note: This software is released under dual MIT and GPL licenses. A
+*    recipient may use this file under the terms of either the MIT license or
+*    GPL License. If you wish to use only one license not the other, you can
+*    indicate your decision by deleting one of the above license notices in your
+*    version of this file.
+*
+*****************************************************************************/
+
+#include "precomp.h"
+
+#include "GcKmd.h"
+
+#include "GcKmd7LTransfer.h"
+
+//
+// Both mappings of a transfer are write combined, so the copy does not go
+// through the CPU caches. Moving whole 64 byte bursts with non-temporal
+// stores keeps the write combining buffers full instead of flushing partial
+// lines, and does not pull the destination into the caches on cached mappings.
+//
+
+void
+GcKm7LStreamCopy(
+    PBYTE       pDst,
+    const BYTE *pSrc,
+    SIZE_T      Size)
+{
+    if (Size < GC_7L_STREAM_COPY_MIN_SIZE)
+    {
+        memcpy(pDst, pSrc, Size);
+        return;
+    }
+
+    SIZE_T  HeadSize = (0 - (ULONG_PTR)pDst) & 63;
+
+    memcpy(pDst, pSrc, HeadSize);
+
+    pDst += HeadSize;
+    pSrc += HeadSize;
+    Size -= HeadSize;
+
+#if defined(_M_ARM64)
+    SIZE_T  BulkSize = Size & ~((SIZE_T)63);
+
+    GcKm7LStreamCopy64(pDst, pSrc, BulkSize);
+
+    pDst += BulkSize;
+    pSrc += BulkSize;
+    Size -= BulkSize;
+#endif
+
+    memcpy(pDst, pSrc, Size);
+}
+
+
+GcKm7LTransferCostModel::GcKm7LTransferCostModel()
+{
+    //
+    // Starting points for the i.MX8 class SoCs, refined by measurement
+    //
+
+    m_CpuBytesPerUs = 400;
+    m_GpuBytesPerUs = 1600;
+    m_GpuSubmitUs = 100;
+}
+
+bool
+GcKm7LTransferCostModel::IsGpuCheaper(
+    UINT    TransferSize) const
+{
+    UINT    CpuUs = TransferSize/m_CpuBytesPerUs;
+    UINT    GpuUs = m_GpuSubmitUs + TransferSize/m_GpuBytesPerUs;
+
+    return GpuUs < CpuUs;
+}
+
+void
+GcKm7LTransferCostModel::RecordCpuTransfer(
+    UINT        TransferSize,
+    ULONGLONG   ElapsedUs)
+{
+    //
+    // Small transfers are dominated by the mapping overhead
+    //
+
+    if ((TransferSize < GC_7L_TRANSFER_CPU_ONLY_SIZE) || (0 == ElapsedUs))
+    {
+        return;
+    }
+
+    UINT    BytesPerUs = (UINT)max(TransferSize/ElapsedUs, 1ULL);
+
+    m_CpuBytesPerUs = max((m_CpuBytesPerUs*7 + BytesPerUs)/8, 1U);
+}
+
+void
+GcKm7LTransferCostModel::RecordGpuTransfer(
+    UINT        TransferSize,
+    ULONGLONG   ElapsedUs)
+{
+    if (ElapsedUs <= m_GpuSubmitUs)
+    {
+        //
+        // Submission overhead is over-estimated
+        //
+
+        m_GpuSubmitUs = (UINT)((m_GpuSubmitUs*7 + ElapsedUs)/8);
+        return;
+    }
+
+    UINT    BytesPerUs = (UINT)max(TransferSize/(ElapsedUs - m_GpuSubmitUs), 1ULL);
+
+    m_GpuBytesPerUs = max((m_GpuBytesPerUs*7 + BytesPerUs)/8, 1U);
+}
+
+
+PBYTE
+GcKm7LMdlTransferCopier::MapPages(
+    GcKmMdl256Pages    *pMdlPages,
+    const PFN_NUMBER   *pPages,
+    UINT                NumPages)
+{
+    NT_ASSERT(NumPages <= GC_7L_TRANSFER_WINDOW_PAGES);
+
+    MmInitializeMdl(&pMdlPages->m_Mdl, NULL, PAGE_SIZE*NumPages);
+    //
+    // GPU memory pages are locked down by GPU kernel runtime
+    //
+    pMdlPages->m_Mdl.MdlFlags = MDL_PARTIAL | MDL_PAGES_LOCKED | MDL_IO_SPACE;
+
+    memcpy(pMdlPages->m_PageNumbers, pPages, NumPages*sizeof(PFN_NUMBER));
+
+    return (PBYTE)MmMapLockedPagesSpecifyCache(
+                    &pMdlPages->m_Mdl,
+                    KernelMode,
+                    MmWriteCombined,
+                    NULL,
+                    FALSE,
+                    NormalPagePriority | MdlMappingNoExecute);
+}
+
+NTSTATUS
+GcKm7LMdlTransferCopier::CopyPages(
+    const PFN_NUMBER   *pSrcPages,
+    UINT                NumSrcPages,
+    UINT                SrcOffset,
+    const PFN_NUMBER   *pDstPages,
+    UINT                NumDstPages,
+    UINT                DstOffset,
+    UINT                CopySize)
+{
+    PBYTE   pSrc = MapPages(&m_MdlSrc, pSrcPages, NumSrcPages);
+    if (NULL == pSrc)
+    {
+        return STATUS_NO_MEMORY;
+    }
+
+    PBYTE   pDst = MapPages(&m_MdlDst, pDstPages, NumDstPages);
+    if (NULL == pDst)
+    {
+        MmUnmapLockedPages(pSrc, &m_MdlSrc.m_Mdl);
+
+        return STATUS_NO_MEMORY;
+    }
+
+    GcKm7LStreamCopy(pDst + DstOffset, pSrc + SrcOffset, CopySize);
+
+    MmUnmapLockedPages(pDst, &m_MdlDst.m_Mdl);
+    MmUnmapLockedPages(pSrc, &m_MdlSrc.m_Mdl);
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+GcKm7LMdlTransferCopier::CopyRun(
+    ULONGLONG           SrcPhysicalAddress,
+    ULONGLONG           DstPhysicalAddress,
+    UINT                CopySize)
+{
+    PHYSICAL_ADDRESS    PhysicalAddress;
+
+    NT_ASSERT(CopySize <= GC_7L_TRANSFER_MAX_RUN_SIZE);
+
+    PhysicalAddress.QuadPart = SrcPhysicalAddress;
+
+    PBYTE   pSrc = (PBYTE)MmMapIoSpace(PhysicalAddress, CopySize, MmWriteCombined);
+    if (NULL == pSrc)
+    {
+        return STATUS_NO_MEMORY;
+    }
+
+    PhysicalAddress.QuadPart = DstPhysicalAddress;
+
+    PBYTE   pDst = (PBYTE)MmMapIoSpace(PhysicalAddress, CopySize, MmWriteCombined);
+    if (NULL == pDst)
+    {
+        MmUnmapIoSpace(pSrc, CopySize);
+
+        return STATUS_NO_MEMORY;
+    }
+
+    GcKm7LStreamCopy(pDst, pSrc, CopySize);
+
+    MmUnmapIoSpace(pDst, CopySize);
+    MmUnmapIoSpace(pSrc, CopySize);
+
+    return STATUS_SUCCESS;
+}
+
+
+GcKm7LPagingTransfer::GcKm7LPagingTransfer()
+{
+    memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+UINT
+GcKm7LPagingTransfer::GetWindowSize(
+    UINT    SrcGpuVa,
+    UINT    DstGpuVa,
+    UINT    RemainingSize) const
+{
+    UINT    SrcOffset = SrcGpuVa & (PAGE_SIZE - 1);
+    UINT    DstOffset = DstGpuVa & (PAGE_SIZE - 1);
+    UINT    WindowSize = GC_7L_TRANSFER_WINDOW_PAGES*PAGE_SIZE - max(SrcOffset, DstOffset);
+
+    return min(WindowSize, RemainingSize);
+}
+
+NTSTATUS
+GcKm7LPagingTransfer::TranslateWindow(
+    GcKm7LPageTableWalkerIf    *pPageTableWalker,
+    UINT                        GpuVa,
+    UINT                        Size,
+    PFN_NUMBER                 *pPages,
+    UINT                       *pNumPages,
+    UINT                       *pNumRuns,
+    bool                       *pbAbove4Gb)
+{
+    UINT    AlignedStart = GpuVa & (~(PAGE_SIZE - 1));
+    UINT    AlignedEnd = (GpuVa + Size + (PAGE_SIZE - 1)) & (~(PAGE_SIZE - 1));
+    UINT    NumPages = (AlignedEnd - AlignedStart)/PAGE_SIZE;
+
+    NT_ASSERT(NumPages <= GC_7L_TRANSFER_WINDOW_PAGES);
+
+    NTSTATUS    Status = pPageTableWalker->GpuVaRangeToCpuPhysicalPages(
+                                            AlignedStart,
+                                            NumPages,
+                                            pPages);
+    if (!NT_SUCCESS(Status))
+    {
+        return Status;
+    }
+
+    //
+    // Coalesce physically contiguous pages into runs
+    //
+
+    UINT    NumRuns = 0;
+
+    *pbAbove4Gb = false;
+
+    for (UINT i = 0; i < NumPages; i++)
+    {
+        if ((0 == i) || (pPages[i] != (pPages[i - 1] + 1)))
+        {
+            NumRuns++;
+        }
+
+        if (pPages[i] >= GC_7L_TRANSFER_4GB_PAGE_NUMBER)
+        {
+            *pbAbove4Gb = true;
+        }
+    }
+
+    m_Stats.m_NumPages += NumPages;
+    m_Stats.m_NumRuns += NumRuns;
+
+    *pNumPages = NumPages;
+    *pNumRuns = NumRuns;
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+GcKm7LPagingTransfer::IsGpuReachable(
+    GcKm7LPageTableWalkerIf    *pPageTableWalker,
+    UINT                        SrcGpuVa,
+    UINT                        DstGpuVa,
+    UINT                        TransferSize,
+    bool                       *pbGpuReachable)
+{
+    UINT    RemainingSize = TransferSize;
+
+    *pbGpuReachable = false;
+
+    while (RemainingSize)
+    {
+        UINT        WindowSize = GetWindowSize(SrcGpuVa, DstGpuVa, RemainingSize);
+        UINT        NumPages;
+        UINT        NumRuns;
+        bool        bAbove4Gb;
+        NTSTATUS    Status;
+
+        Status = TranslateWindow(pPageTableWalker, SrcGpuVa, WindowSize, m_SrcPages, &NumPages, &NumRuns, &bAbove4Gb);
+        if (!NT_SUCCESS(Status) || bAbove4Gb)
+        {
+            return Status;
+        }
+
+        Status = TranslateWindow(pPageTableWalker, DstGpuVa, WindowSize, m_DstPages, &NumPages, &NumRuns, &bAbove4Gb);
+        if (!NT_SUCCESS(Status) || bAbove4Gb)
+        {
+            return Status;
+        }
+
+        SrcGpuVa += WindowSize;
+        DstGpuVa += WindowSize;
+        RemainingSize -= WindowSize;
+    }
+
+    *pbGpuReachable = true;
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+GcKm7LPagingTransfer::CopyRun(
+    GcKm7LTransferCopierIf     *pCopier,
+    GcKm7LPageRun              *pRun)
+{
+    if (0 == pRun->m_Size)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    NTSTATUS    Status = pCopier->CopyRun(pRun->m_SrcAddress, pRun->m_DstAddress, pRun->m_Size);
+    if (!NT_SUCCESS(Status))
+    {
+        NT_ASSERT(0);
+        return Status;
+    }
+
+    m_Stats.m_NumRunCopies++;
+
+    pRun->m_Size = 0;
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+GcKm7LPagingTransfer::Transfer(
+    GcKm7LPageTableWalkerIf    *pPageTableWalker,
+    GcKm7LTransferCopierIf     *pCopier,
+    const DXGK_BUILDPAGINGBUFFER_TRANSFERVIRTUAL   *pTransferVirtual,
+    bool                        bGpuTransferAllowed)
+{
+    NTSTATUS    Status;
+    UINT        TransferSize = static_cast<UINT>(pTransferVirtual->TransferSizeInBytes);
+    UINT        SrcGpuVa = static_cast<UINT>(pTransferVirtual->SourceVirtualAddress);
+    UINT        DstGpuVa = static_cast<UINT>(pTransferVirtual->DestinationVirtualAddress);
+
+    if (bGpuTransferAllowed &&
+        (TransferSize > GC_7L_TRANSFER_CPU_ONLY_SIZE) &&
+        m_CostModel.IsGpuCheaper(TransferSize))
+    {
+        bool    bGpuReachable;
+
+        Status = IsGpuReachable(pPageTableWalker, SrcGpuVa, DstGpuVa, TransferSize, &bGpuReachable);
+        if (!NT_SUCCESS(Status))
+        {
+            return Status;
+        }
+
+        if (bGpuReachable)
+        {
+            m_Stats.m_NumGpuTransfers++;
+            m_Stats.m_GpuBytes += TransferSize;
+
+            return STATUS_MORE_PROCESSING_REQUIRED;
+        }
+
+        m_Stats.m_NumForcedCpuTransfers++;
+    }
+
+    LARGE_INTEGER   Frequency;
+    LARGE_INTEGER   StartTime = KeQueryPerformanceCounter(&Frequency);
+    UINT            RemainingSize = TransferSize;
+
+    GcKm7LPageRun   Run = {};
+
+    while (RemainingSize)
+    {
+        UINT    WindowSize = GetWindowSize(SrcGpuVa, DstGpuVa, RemainingSize);
+        UINT    SrcOffset = SrcGpuVa & (PAGE_SIZE - 1);
+        UINT    DstOffset = DstGpuVa & (PAGE_SIZE - 1);
+        UINT    NumSrcPages, NumDstPages;
+        UINT    NumSrcRuns, NumDstRuns;
+        bool    bAbove4Gb;
+
+        Status = TranslateWindow(pPageTableWalker, SrcGpuVa, WindowSize, m_SrcPages, &NumSrcPages, &NumSrcRuns, &bAbove4Gb);
+        if (!NT_SUCCESS(Status))
+        {
+            NT_ASSERT(0);
+            return Status;
+        }
+
+        Status = TranslateWindow(pPageTableWalker, DstGpuVa, WindowSize, m_DstPages, &NumDstPages, &NumDstRuns, &bAbove4Gb);
+        if (!NT_SUCCESS(Status))
+        {
+            NT_ASSERT(0);
+            return Status;
+        }
+
+        if ((1 == NumSrcRuns) && (1 == NumDstRuns))
+        {
+            ULONGLONG   WindowSrcAddress = ((ULONGLONG)m_SrcPages[0] << PAGE_SHIFT) + SrcOffset;
+            ULONGLONG   WindowDstAddress = ((ULONGLONG)m_DstPages[0] << PAGE_SHIFT) + DstOffset;
+
+            //
+            // Extend the pending run while both sides stay contiguous
+            //
+
+            if (((Run.m_SrcAddress + Run.m_Size) != WindowSrcAddress) ||
+                ((Run.m_DstAddress + Run.m_Size) != WindowDstAddress) ||
+                ((Run.m_Size + WindowSize) > GC_7L_TRANSFER_MAX_RUN_SIZE))
+            {
+                Status = CopyRun(pCopier, &Run);
+                if (!NT_SUCCESS(Status))
+                {
+                    return Status;
+                }
+            }
+
+            if (0 == Run.m_Size)
+            {
+                Run.m_SrcAddress = WindowSrcAddress;
+                Run.m_DstAddress = WindowDstAddress;
+            }
+
+            Run.m_Size += WindowSize;
+        }
+        else
+        {
+            Status = CopyRun(pCopier, &Run);
+            if (!NT_SUCCESS(Status))
+            {
+                return Status;
+            }
+
+            Status = pCopier->CopyPages(
+                                m_SrcPages,
+                                NumSrcPages,
+                                SrcOffset,
+                                m_DstPages,
+                                NumDstPages,
+                                DstOffset,
+                                WindowSize);
+            if (!NT_SUCCESS(Status))
+            {
+                NT_ASSERT(0);
+                return Status;
+            }
+
+            m_Stats.m_NumWindowCopies++;
+        }
+
+        SrcGpuVa += WindowSize;
+        DstGpuVa += WindowSize;
+        RemainingSize -= WindowSize;
+    }
+
+    Status = CopyRun(pCopier, &Run);
+    if (!NT_SUCCESS(Status))
+    {
+        return Status;
+    }
+
+    LARGE_INTEGER   EndTime = KeQueryPerformanceCounter(NULL);
+
+    m_CostModel.RecordCpuTransfer(
+                    TransferSize,
+                    ((EndTime.QuadPart - StartTime.QuadPart)*1000000)/Frequency.QuadPart);
+
+    m_Stats.m_NumCpuTransfers++;
+    m_Stats.m_CpuBytes += TransferSize;
+
+    return STATUS_SUCCESS;
+}
+
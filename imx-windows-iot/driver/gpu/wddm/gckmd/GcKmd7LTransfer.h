@@ -0,0 +1,274 @@
+/****************************************************************************
+* Copyright (c) Microsoft Corporation.
+*
+*    Licensed under the MIT License.
+*    Licensed under the GPL License.
+*
+*****************************************************************************
+*
+*    Note: This software is released under dual MIT and GPL licenses. A
+*    recipient may use this file under the terms of either the MIT license or
+*    GPL License. If you wish to use only one license not the other, you can
+*    indicate your decision by deleting one of the above license notices in your
+*    version of this file.
+*
+*****************************************************************************/
+
+#pragma once
+
+#include "GcKmd7LPageTableWalkerIf.h"
+
+//
+// CPU execution of DXGK_OPERATION_VIRTUAL_TRANSFER
+//
+// Source and destination GPU VA ranges are translated in windows of up to
+// GC_7L_TRANSFER_WINDOW_PAGES pages and the physical pages are coalesced into
+// contiguous runs. While both sides stay physically contiguous, consecutive
+// windows are merged and the whole run is mapped and copied at once, up to
+// GC_7L_TRANSFER_MAX_RUN_SIZE. Other windows are mapped through their page
+// list. Large copies use non-temporal stores.
+//
+// Before copying, the cost model decides whether the GPU copy command
+// prepared alongside the CPU transfer (see GcKm7LMQContext::TransferBuffer)
+// would be cheaper, in which case Transfer() returns
+// STATUS_MORE_PROCESSING_REQUIRED and the node submits the GPU copy instead.
+//
+
+#define GC_7L_TRANSFER_WINDOW_PAGES     256
+
+//
+// Largest physically contiguous run mapped and copied at once
+//
+
+#define GC_7L_TRANSFER_MAX_RUN_SIZE     (4*1024*1024)
+
+//
+// Transfers up to this size always stay on CPU, the GPU submission round
+// trip costs more than the copy itself
+//
+
+#define GC_7L_TRANSFER_CPU_ONLY_SIZE    (64*1024)
+
+//
+// Copies below this size use plain memcpy()
+//
+
+#define GC_7L_STREAM_COPY_MIN_SIZE      (4*1024)
+
+//
+// Pages at or above this PFN are out of reach of the GPU
+// when GcKmdGlobal::s_bLimitAllocBelow4gbPa is set
+//
+
+#define GC_7L_TRANSFER_4GB_PAGE_NUMBER  (0x100000000ULL >> PAGE_SHIFT)
+
+struct GcKmMdl256Pages
+{
+    MDL         m_Mdl;
+    PFN_NUMBER  m_PageNumbers[GC_7L_TRANSFER_WINDOW_PAGES];
+};
+
+struct GcKm7LTransferStats
+{
+    ULONGLONG   m_NumCpuTransfers;
+    ULONGLONG   m_NumGpuTransfers;
+    ULONGLONG   m_NumForcedCpuTransfers;    // GPU was cheaper but pages are above 4GB
+    ULONGLONG   m_CpuBytes;
+    ULONGLONG   m_GpuBytes;
+    ULONGLONG   m_NumPages;
+    ULONGLONG   m_NumRuns;
+    ULONGLONG   m_NumRunCopies;             // Contiguous runs copied with one mapping
+    ULONGLONG   m_NumWindowCopies;          // Fragmented windows copied with a page list mapping
+};
+
+#if defined(_M_ARM64)
+
+//
+// GcKmd7LStreamCopy.asm, Size must be a multiple of 64
+//
+
+extern "C"
+void
+GcKm7LStreamCopy64(
+    PBYTE       pDst,
+    const BYTE *pSrc,
+    SIZE_T      Size);
+
+#endif
+
+void
+GcKm7LStreamCopy(
+    PBYTE       pDst,
+    const BYTE *pSrc,
+    SIZE_T      Size);
+
+class GcKm7LTransferCostModel
+{
+public:
+
+    GcKm7LTransferCostModel();
+
+    bool
+    IsGpuCheaper(
+        UINT    TransferSize) const;
+
+    void
+    RecordCpuTransfer(
+        UINT        TransferSize,
+        ULONGLONG   ElapsedUs);
+
+    void
+    RecordGpuTransfer(
+        UINT        TransferSize,
+        ULONGLONG   ElapsedUs);
+
+private:
+
+    //
+    // Exponential moving averages of the measured cost
+    //
+
+    UINT    m_CpuBytesPerUs;
+    UINT    m_GpuBytesPerUs;
+    UINT    m_GpuSubmitUs;
+};
+
+class GcKm7LTransferCopierIf
+{
+public:
+
+    //
+    // Copies one window of pages, the source and destination
+    // page lists each cover at most GC_7L_TRANSFER_WINDOW_PAGES
+    //
+
+    virtual NTSTATUS
+    CopyPages(
+        const PFN_NUMBER   *pSrcPages,
+        UINT                NumSrcPages,
+        UINT                SrcOffset,
+        const PFN_NUMBER   *pDstPages,
+        UINT                NumDstPages,
+        UINT                DstOffset,
+        UINT                CopySize) = NULL;
+
+    //
+    // Copies between two physically contiguous ranges
+    // of at most GC_7L_TRANSFER_MAX_RUN_SIZE
+    //
+
+    virtual NTSTATUS
+    CopyRun(
+        ULONGLONG           SrcPhysicalAddress,
+        ULONGLONG           DstPhysicalAddress,
+        UINT                CopySize) = NULL;
+};
+
+class GcKm7LMdlTransferCopier : public GcKm7LTransferCopierIf
+{
+public:
+
+    virtual NTSTATUS
+    CopyPages(
+        const PFN_NUMBER   *pSrcPages,
+        UINT                NumSrcPages,
+        UINT                SrcOffset,
+        const PFN_NUMBER   *pDstPages,
+        UINT                NumDstPages,
+        UINT                DstOffset,
+        UINT                CopySize);
+
+    virtual NTSTATUS
+    CopyRun(
+        ULONGLONG           SrcPhysicalAddress,
+        ULONGLONG           DstPhysicalAddress,
+        UINT                CopySize);
+
+private:
+
+    PBYTE
+    MapPages(
+        GcKmMdl256Pages    *pMdlPages,
+        const PFN_NUMBER   *pPages,
+        UINT                NumPages);
+
+    GcKmMdl256Pages     m_MdlSrc;
+    GcKmMdl256Pages     m_MdlDst;
+};
+
+//
+// Physically contiguous source and destination range pending to be copied
+//
+
+struct GcKm7LPageRun
+{
+    ULONGLONG   m_SrcAddress;
+    ULONGLONG   m_DstAddress;
+    UINT        m_Size;
+};
+
+class GcKm7LPagingTransfer
+{
+public:
+
+    GcKm7LPagingTransfer();
+
+    NTSTATUS
+    Transfer(
+        GcKm7LPageTableWalkerIf    *pPageTableWalker,
+        GcKm7LTransferCopierIf     *pCopier,
+        const DXGK_BUILDPAGINGBUFFER_TRANSFERVIRTUAL   *pTransferVirtual,
+        bool                        bGpuTransferAllowed);
+
+    void
+    RecordGpuTransfer(
+        UINT        TransferSize,
+        ULONGLONG   ElapsedUs)
+    {
+        m_CostModel.RecordGpuTransfer(TransferSize, ElapsedUs);
+    }
+
+    const GcKm7LTransferStats*
+    GetStats() const
+    {
+        return &m_Stats;
+    }
+
+private:
+
+    NTSTATUS
+    TranslateWindow(
+        GcKm7LPageTableWalkerIf    *pPageTableWalker,
+        UINT                        GpuVa,
+        UINT                        Size,
+        PFN_NUMBER                 *pPages,
+        UINT                       *pNumPages,
+        UINT                       *pNumRuns,
+        bool                       *pbAbove4Gb);
+
+    NTSTATUS
+    IsGpuReachable(
+        GcKm7LPageTableWalkerIf    *pPageTableWalker,
+        UINT                        SrcGpuVa,
+        UINT                        DstGpuVa,
+        UINT                        TransferSize,
+        bool                       *pbGpuReachable);
+
+    NTSTATUS
+    CopyRun(
+        GcKm7LTransferCopierIf     *pCopier,
+        GcKm7LPageRun              *pRun);
+
+    UINT
+    GetWindowSize(
+        UINT    SrcGpuVa,
+        UINT    DstGpuVa,
+        UINT    RemainingSize) const;
+
+    GcKm7LTransferCostModel m_CostModel;
+    GcKm7LTransferStats     m_Stats;
+
+    PFN_NUMBER  m_SrcPages[GC_7L_TRANSFER_WINDOW_PAGES];
+    PFN_NUMBER  m_DstPages[GC_7L_TRANSFER_WINDOW_PAGES];
+};
+
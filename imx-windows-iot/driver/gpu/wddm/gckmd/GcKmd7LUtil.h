@@ -17,6 +17,7 @@
 #pragma once
 
 #include "GcKmd7LMmu.h"
+#include "GcKmd7LPageTableWalkerIf.h"
 #include <math.h>
 
 struct GcKmMdl1Page
@@ -37,17 +38,6 @@ struct GcKmMdl64Pages
     PFN_NUMBER  m_PageNumbers[64];
 };
 
-class GcKm7LPageTableWalkerIf
-{
-public:
-
-    virtual NTSTATUS
-    GpuVaRangeToCpuPhysicalPages(
-        UINT        StartGpuVa,
-        UINT        NumPages,
-        PFN_NUMBER *pPhysicalPageNumber) = NULL;
-};
-
 class GcKm7LPageTableWalker : public GcKm7LPageTableWalkerIf
 {
 public:
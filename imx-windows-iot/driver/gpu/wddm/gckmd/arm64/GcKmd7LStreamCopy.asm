@@ -0,0 +1,33 @@
+//
+//  Copyright 2023 NXP
+//
+//  Licensed under the MIT License.
+//
+//
+//  void GcKm7LStreamCopy64(PBYTE pDst, const BYTE *pSrc, SIZE_T Size)
+//
+//  Copies Size bytes, a multiple of 64, with non-temporal stores.
+//  Used by GcKm7LStreamCopy() for the bulk of large paging transfers.
+//
+
+	EXPORT GcKm7LStreamCopy64
+	AREA   s_GcKm7LStreamCopy64, CODE, READONLY
+
+GcKm7LStreamCopy64
+	cbz   x2, GcKm7LStreamCopy64_Done
+
+GcKm7LStreamCopy64_Loop
+	ldp   q0, q1, [x1]
+	ldp   q2, q3, [x1, #32]
+	add   x1, x1, #64
+	subs  x2, x2, #64
+
+	stnp  q0, q1, [x0]
+	stnp  q2, q3, [x0, #32]
+	add   x0, x0, #64
+	b.ne  GcKm7LStreamCopy64_Loop
+
+GcKm7LStreamCopy64_Done
+	ret
+
+	END
@@ -0,0 +1,4 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+#pragma once
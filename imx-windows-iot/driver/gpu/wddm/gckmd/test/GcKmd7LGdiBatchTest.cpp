@@ -0,0 +1,436 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host unit test of GcKm7LGdiBatch
+//
+// Sub-rects are appended the way GcKm7LContext::GdiOpBuildCommandBuffer()
+// does and the resulting DMA buffer is checked against the parts of the
+// real color fill template, including the guard bytes past the end of the
+// DMA buffer.
+//
+
+#include "GcKmd7LGdiBatch.cpp"
+
+#include "MQ/Gc7LCmdCompCF.h"
+#include "HostTest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define GUARD_SIZE      64
+#define GUARD_BYTE      0xA5
+
+static const GC_7L_GDI_OP   g_ColorFillOp =
+{
+    nullptr,
+    0,
+    0,
+    GC_7L_CMD_COMPUTE_COLORFILL_2_5_6,
+    sizeof(GC_7L_CMD_COMPUTE_COLORFILL_2_5_6),
+    GC_7L_CMD_COLORFILL_PATCH_TABLE,
+    sizeof(GC_7L_CMD_COLORFILL_PATCH_TABLE)/sizeof(GC_7L_PATCH_ENTRY)
+};
+
+static const UINT   STATE_DISPATCH_SIZE = 92*sizeof(UINT);
+static const UINT   DISPATCH_SIZE = (92 - 60)*sizeof(UINT);
+static const UINT   EPILOGUE_SIZE = sizeof(GC_7L_CMD_COMPUTE_COLORFILL_2_5_6) - STATE_DISPATCH_SIZE;
+
+//
+// DMA buffer of a given size followed by guard bytes
+//
+
+class TestDmaBuffer
+{
+public:
+
+    TestDmaBuffer(
+        UINT    Size)
+        : m_Buffer(Size + GUARD_SIZE, GUARD_BYTE),
+          m_Size(Size),
+          m_Used(0)
+    {
+    }
+
+    BYTE*
+    GetCurrent()
+    {
+        return m_Buffer.data() + m_Used;
+    }
+
+    UINT
+    GetRemaining() const
+    {
+        return m_Size - m_Used;
+    }
+
+    void
+    Advance(
+        UINT    SizeUsed)
+    {
+        CHECK(SizeUsed <= GetRemaining());
+
+        m_Used += SizeUsed;
+    }
+
+    //
+    // Checks the next Size bytes against the template from Offset
+    //
+
+    void
+    Expect(
+        UINT    *pCheckOffset,
+        UINT    TemplateOffset,
+        UINT    Size) const
+    {
+        CHECK(*pCheckOffset + Size <= m_Used);
+        CHECK(0 == memcmp(m_Buffer.data() + *pCheckOffset,
+                          (const BYTE*)g_ColorFillOp.pCmdBuf + TemplateOffset,
+                          Size));
+
+        *pCheckOffset += Size;
+    }
+
+    bool
+    IsGuardIntact() const
+    {
+        for (UINT i = 0; i < GUARD_SIZE; i++)
+        {
+            if (GUARD_BYTE != m_Buffer[m_Size + i])
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    UINT
+    GetUsed() const
+    {
+        return m_Used;
+    }
+
+private:
+
+    std::vector<BYTE>   m_Buffer;
+    UINT                m_Size;
+    UINT                m_Used;
+};
+
+static GcKm7LGdiBatchKey
+MakeKey(
+    const void* pDstAllocation,
+    const void* pSrcAllocation)
+{
+    GcKm7LGdiBatchKey   Key = {};
+
+    Key.m_pGdiOp = &g_ColorFillOp;
+    Key.m_pDstAllocation = pDstAllocation;
+    Key.m_DstGpuVa = 0x100000;
+    Key.m_pSrcAllocation = pSrcAllocation;
+
+    return Key;
+}
+
+static bool
+Append(
+    GcKm7LGdiBatch *pBatch,
+    TestDmaBuffer  *pDmaBuffer,
+    LONG            Left,
+    LONG            Top,
+    LONG            Right,
+    LONG            Bottom,
+    UINT           *pSizeUsed,
+    GcKm7LGdiEmit  *pEmit)
+{
+    RECT    Rect = { Left, Top, Right, Bottom };
+    UINT*   pCmd = nullptr;
+    bool    bAppended;
+
+    bAppended = pBatch->AppendRect(
+                    pDmaBuffer->GetCurrent(),
+                    pDmaBuffer->GetRemaining(),
+                    &Rect,
+                    pSizeUsed,
+                    &pCmd,
+                    pEmit);
+
+    if (bAppended)
+    {
+        BYTE*   pEnd = pDmaBuffer->GetCurrent() + *pSizeUsed;
+        UINT    EmitSize = (GcKm7LGdiEmitDispatch == *pEmit) ? DISPATCH_SIZE :
+                           (GcKm7LGdiEmitStateDispatch == *pEmit) ? STATE_DISPATCH_SIZE :
+                           sizeof(GC_7L_CMD_COMPUTE_COLORFILL_2_5_6);
+
+        CHECK((BYTE*)pCmd + EmitSize == pEnd);
+    }
+
+    pDmaBuffer->Advance(*pSizeUsed);
+
+    return bAppended;
+}
+
+static void
+TestLayout()
+{
+    GcKm7LGdiOpLayout   Layout;
+
+    CHECK(GcKm7LGdiBatch::GetLayout(&g_ColorFillOp, &Layout));
+    CHECK(60 == Layout.m_DispatchStart);
+    CHECK(92 == Layout.m_DispatchEnd);
+    CHECK(GC_7L_CMD_DISPATCH_KICK == g_ColorFillOp.pCmdBuf[Layout.m_DispatchEnd - 2]);
+
+    //
+    // A template without a uniform buffer can not be batched
+    //
+
+    GC_7L_PATCH_ENTRY   PatchTable[] = { { 55, GC7L_PATCH_DST_STORAGE_IMAGE } };
+    GC_7L_GDI_OP        GdiOp = g_ColorFillOp;
+
+    GdiOp.pPatchTable = PatchTable;
+    GdiOp.NumPatchEntries = 1;
+
+    CHECK(!GcKm7LGdiBatch::GetLayout(&GdiOp, &Layout));
+}
+
+static void
+TestBatch()
+{
+    GcKm7LGdiBatch      Batch;
+    TestDmaBuffer       DmaBuffer(4096);
+    GcKm7LGdiBatchKey   Key = MakeKey(&DmaBuffer, nullptr);
+    UINT                SizeUsed;
+    GcKm7LGdiEmit       Emit;
+    UINT                CheckOffset = 0;
+
+    Batch.BeginDmaBuffer();
+
+    Batch.BeginOp(&Key, true);
+    CHECK(Append(&Batch, &DmaBuffer, 0, 0, 10, 10, &SizeUsed, &Emit));
+    CHECK(GcKm7LGdiEmitStateDispatch == Emit);
+    CHECK(STATE_DISPATCH_SIZE == SizeUsed);
+    CHECK(Append(&Batch, &DmaBuffer, 10, 0, 20, 10, &SizeUsed, &Emit));
+    CHECK(GcKm7LGdiEmitDispatch == Emit);
+    CHECK(DISPATCH_SIZE == SizeUsed);
+
+    //
+    // Dispatch part patches are relocated, state patches are not needed
+    //
+
+    UINT*   pCmd = (UINT*)(DmaBuffer.GetCurrent() - DISPATCH_SIZE);
+
+    CHECK(pCmd + 1 == Batch.GetPatchLocation(pCmd, Emit, &GC_7L_CMD_COLORFILL_PATCH_TABLE[2]));
+    CHECK(pCmd + 27 == Batch.GetPatchLocation(pCmd, Emit, &GC_7L_CMD_COLORFILL_PATCH_TABLE[4]));
+    CHECK(nullptr == Batch.GetPatchLocation(pCmd, Emit, &GC_7L_CMD_COLORFILL_PATCH_TABLE[1]));
+
+    //
+    // A later op next to the batch joins it
+    //
+
+    Batch.BeginOp(&Key, true);
+    CHECK(Append(&Batch, &DmaBuffer, 0, 10, 20, 20, &SizeUsed, &Emit));
+    CHECK(GcKm7LGdiEmitDispatch == Emit);
+
+    DmaBuffer.Advance(Batch.EndDmaBuffer(DmaBuffer.GetCurrent()));
+
+    DmaBuffer.Expect(&CheckOffset, 0, STATE_DISPATCH_SIZE);
+    DmaBuffer.Expect(&CheckOffset, 60*sizeof(UINT), DISPATCH_SIZE);
+    DmaBuffer.Expect(&CheckOffset, 60*sizeof(UINT), DISPATCH_SIZE);
+    DmaBuffer.Expect(&CheckOffset, STATE_DISPATCH_SIZE, EPILOGUE_SIZE);
+    CHECK(CheckOffset == DmaBuffer.GetUsed());
+
+    const GcKm7LGdiBatchStats*  pStats = Batch.GetStats();
+
+    CHECK(1 == pStats->m_NumSubmissions);
+    CHECK(2 == pStats->m_NumOps);
+    CHECK(3 == pStats->m_NumRects);
+    CHECK(1 == pStats->m_NumBatches);
+}
+
+static void
+TestOverlap()
+{
+    GcKm7LGdiBatch      Batch;
+    TestDmaBuffer       DmaBuffer(4096);
+    GcKm7LGdiBatchKey   Key = MakeKey(&DmaBuffer, nullptr);
+    UINT                SizeUsed;
+    GcKm7LGdiEmit       Emit;
+    UINT                CheckOffset = 0;
+
+    Batch.BeginDmaBuffer();
+
+    Batch.BeginOp(&Key, true);
+    CHECK(Append(&Batch, &DmaBuffer, 0, 0, 10, 10, &SizeUsed, &Emit));
+
+    //
+    // Overlapping an earlier op needs the stall, a new batch is started
+    //
+
+    Batch.BeginOp(&Key, true);
+    CHECK(Append(&Batch, &DmaBuffer, 5, 5, 15, 15, &SizeUsed, &Emit));
+    CHECK(GcKm7LGdiEmitStateDispatch == Emit);
+    CHECK(EPILOGUE_SIZE + STATE_DISPATCH_SIZE == SizeUsed);
+
+    //
+    // So is a different destination
+    //
+
+    GcKm7LGdiBatchKey   OtherKey = MakeKey(&Batch, nullptr);
+
+    Batch.BeginOp(&OtherKey, true);
+    CHECK(Append(&Batch, &DmaBuffer, 100, 100, 110, 110, &SizeUsed, &Emit));
+    CHECK(GcKm7LGdiEmitStateDispatch == Emit);
+
+    DmaBuffer.Advance(Batch.EndDmaBuffer(DmaBuffer.GetCurrent()));
+
+    for (UINT i = 0; i < 3; i++)
+    {
+        DmaBuffer.Expect(&CheckOffset, 0, sizeof(GC_7L_CMD_COMPUTE_COLORFILL_2_5_6));
+    }
+    CHECK(CheckOffset == DmaBuffer.GetUsed());
+}
+
+static void
+TestNotBatchable()
+{
+    GcKm7LGdiBatch      Batch;
+    TestDmaBuffer       DmaBuffer(4096);
+    GcKm7LGdiBatchKey   Key = MakeKey(&DmaBuffer, nullptr);
+    GcKm7LGdiBatchKey   SelfCopyKey = MakeKey(&DmaBuffer, &DmaBuffer);
+    UINT                SizeUsed;
+    GcKm7LGdiEmit       Emit;
+    UINT                CheckOffset = 0;
+
+    //
+    // Outside of a GDI DMA buffer everything gets the full template
+    //
+
+    Batch.BeginOp(&Key, true);
+    CHECK(Append(&Batch, &DmaBuffer, 0, 0, 10, 10, &SizeUsed, &Emit));
+    CHECK(GcKm7LGdiEmitFull == Emit);
+    CHECK(sizeof(GC_7L_CMD_COMPUTE_COLORFILL_2_5_6) == SizeUsed);
+
+    Batch.BeginDmaBuffer();
+
+    Batch.BeginOp(&Key, true);
+    CHECK(Append(&Batch, &DmaBuffer, 0, 0, 10, 10, &SizeUsed, &Emit));
+    CHECK(GcKm7LGdiEmitStateDispatch == Emit);
+
+    //
+    // Reading the destination closes the batch and is not batched
+    //
+
+    Batch.BeginOp(&SelfCopyKey, true);
+    CHECK(Append(&Batch, &DmaBuffer, 20, 20, 30, 30, &SizeUsed, &Emit));
+    CHECK(GcKm7LGdiEmitFull == Emit);
+    CHECK(EPILOGUE_SIZE + sizeof(GC_7L_CMD_COMPUTE_COLORFILL_2_5_6) == SizeUsed);
+
+    CHECK(Append(&Batch, &DmaBuffer, 40, 40, 50, 50, &SizeUsed, &Emit));
+    CHECK(GcKm7LGdiEmitFull == Emit);
+
+    CHECK(0 == Batch.EndDmaBuffer(DmaBuffer.GetCurrent()));
+
+    for (UINT i = 0; i < 4; i++)
+    {
+        DmaBuffer.Expect(&CheckOffset, 0, sizeof(GC_7L_CMD_COMPUTE_COLORFILL_2_5_6));
+    }
+    CHECK(CheckOffset == DmaBuffer.GetUsed());
+}
+
+//
+// Ops emitting their own commands (GcKm7LMQContext::CopyImage() and
+// FillImage()) close the batch first, the next template op must not
+// join the batch of the ops before them
+//
+
+static void
+TestForeignCommands()
+{
+    GcKm7LGdiBatch      Batch;
+    TestDmaBuffer       DmaBuffer(4096);
+    GcKm7LGdiBatchKey   Key = MakeKey(&DmaBuffer, nullptr);
+    UINT                SizeUsed;
+    GcKm7LGdiEmit       Emit;
+    UINT                CheckOffset = 0;
+    const UINT          ForeignCmd[] = { 0x08010e02, 0x00000701, 0x48000000, 0x00000701 };
+
+    Batch.BeginDmaBuffer();
+
+    Batch.BeginOp(&Key, true);
+    CHECK(Append(&Batch, &DmaBuffer, 0, 0, 10, 10, &SizeUsed, &Emit));
+
+    DmaBuffer.Advance(Batch.Close(DmaBuffer.GetCurrent()));
+    CHECK(0 == Batch.Close(DmaBuffer.GetCurrent()));
+
+    memcpy(DmaBuffer.GetCurrent(), ForeignCmd, sizeof(ForeignCmd));
+    DmaBuffer.Advance(sizeof(ForeignCmd));
+
+    Batch.BeginOp(&Key, true);
+    CHECK(Append(&Batch, &DmaBuffer, 20, 20, 30, 30, &SizeUsed, &Emit));
+    CHECK(GcKm7LGdiEmitStateDispatch == Emit);
+    CHECK(STATE_DISPATCH_SIZE == SizeUsed);
+
+    DmaBuffer.Advance(Batch.EndDmaBuffer(DmaBuffer.GetCurrent()));
+
+    DmaBuffer.Expect(&CheckOffset, 0, sizeof(GC_7L_CMD_COMPUTE_COLORFILL_2_5_6));
+    CHECK(0 == memcmp(DmaBuffer.GetCurrent() - DmaBuffer.GetUsed() + CheckOffset, ForeignCmd, sizeof(ForeignCmd)));
+    CheckOffset += sizeof(ForeignCmd);
+    DmaBuffer.Expect(&CheckOffset, 0, sizeof(GC_7L_CMD_COMPUTE_COLORFILL_2_5_6));
+    CHECK(CheckOffset == DmaBuffer.GetUsed());
+}
+
+//
+// The epilogue of the open batch must always fit in the DMA buffer
+//
+
+static void
+TestEpilogueReserve()
+{
+    for (UINT Slack = 0; Slack < DISPATCH_SIZE; Slack += sizeof(UINT))
+    {
+        GcKm7LGdiBatch      Batch;
+        TestDmaBuffer       DmaBuffer(STATE_DISPATCH_SIZE + DISPATCH_SIZE + EPILOGUE_SIZE + Slack);
+        GcKm7LGdiBatchKey   Key = MakeKey(&DmaBuffer, nullptr);
+        UINT                SizeUsed;
+        GcKm7LGdiEmit       Emit;
+        UINT                NumRects = 0;
+        UINT                CheckOffset = 0;
+
+        Batch.BeginDmaBuffer();
+        Batch.BeginOp(&Key, true);
+
+        while (Append(&Batch, &DmaBuffer, NumRects*10, 0, NumRects*10 + 10, 10, &SizeUsed, &Emit))
+        {
+            NumRects++;
+        }
+
+        //
+        // The failed append closed the batch within the buffer
+        //
+
+        CHECK(2 == NumRects);
+        CHECK(EPILOGUE_SIZE == SizeUsed);
+        CHECK(0 == Batch.EndDmaBuffer(DmaBuffer.GetCurrent()));
+        CHECK(DmaBuffer.IsGuardIntact());
+
+        DmaBuffer.Expect(&CheckOffset, 0, STATE_DISPATCH_SIZE);
+        DmaBuffer.Expect(&CheckOffset, 60*sizeof(UINT), DISPATCH_SIZE);
+        DmaBuffer.Expect(&CheckOffset, STATE_DISPATCH_SIZE, EPILOGUE_SIZE);
+        CHECK(CheckOffset == DmaBuffer.GetUsed());
+    }
+}
+
+int
+main()
+{
+    TestLayout();
+    TestBatch();
+    TestOverlap();
+    TestNotBatchable();
+    TestForeignCommands();
+    TestEpilogueReserve();
+
+    return HostTestResult("GcKmd7LGdiBatchTest");
+}
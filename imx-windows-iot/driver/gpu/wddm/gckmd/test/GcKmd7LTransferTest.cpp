@@ -0,0 +1,436 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host unit test of GcKm7LPagingTransfer
+//
+// GPU VAs are translated through a synthetic page table into synthetic
+// physical pages. The copier moves the data between those pages, the test
+// then checks every destination byte and the guard bytes around it.
+//
+
+#include "GcKmd7LTransfer.cpp"
+#include "HostTest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <map>
+#include <vector>
+
+//
+// Synthetic physical memory, allocated on first touch
+//
+
+class SysMem
+{
+public:
+
+    PBYTE
+    GetPage(
+        PFN_NUMBER  PageNumber)
+    {
+        std::vector<BYTE>  &Page = m_Pages[PageNumber];
+
+        if (Page.empty())
+        {
+            Page.resize(PAGE_SIZE);
+            for (UINT i = 0; i < PAGE_SIZE; i++)
+            {
+                Page[i] = (BYTE)(PageNumber*31 + i*7 + 1);
+            }
+        }
+
+        return Page.data();
+    }
+
+private:
+
+    std::map<PFN_NUMBER, std::vector<BYTE>> m_Pages;
+};
+
+class TestPageTable : public GcKm7LPageTableWalkerIf
+{
+public:
+
+    //
+    // Maps NumPages GPU pages from StartGpuVa to PFNs from pPages
+    //
+
+    void
+    Map(
+        UINT                StartGpuVa,
+        const PFN_NUMBER   *pPages,
+        UINT                NumPages)
+    {
+        for (UINT i = 0; i < NumPages; i++)
+        {
+            m_Entries[(StartGpuVa >> PAGE_SHIFT) + i] = pPages[i];
+        }
+    }
+
+    void
+    MapContiguous(
+        UINT        StartGpuVa,
+        PFN_NUMBER  FirstPage,
+        UINT        NumPages)
+    {
+        for (UINT i = 0; i < NumPages; i++)
+        {
+            m_Entries[(StartGpuVa >> PAGE_SHIFT) + i] = FirstPage + i;
+        }
+    }
+
+    virtual NTSTATUS
+    GpuVaRangeToCpuPhysicalPages(
+        UINT        StartGpuVa,
+        UINT        NumPages,
+        PFN_NUMBER *pPhysicalPageNumber)
+    {
+        for (UINT i = 0; i < NumPages; i++)
+        {
+            auto    Entry = m_Entries.find((StartGpuVa >> PAGE_SHIFT) + i);
+
+            if (Entry == m_Entries.end())
+            {
+                return STATUS_INVALID_PARAMETER;
+            }
+
+            pPhysicalPageNumber[i] = Entry->second;
+        }
+
+        return STATUS_SUCCESS;
+    }
+
+    PBYTE
+    GpuVaToCpuVa(
+        SysMem *pSysMem,
+        UINT    GpuVa)
+    {
+        return pSysMem->GetPage(m_Entries[GpuVa >> PAGE_SHIFT]) + (GpuVa & (PAGE_SIZE - 1));
+    }
+
+private:
+
+    std::map<UINT, PFN_NUMBER>  m_Entries;
+};
+
+class TestCopier : public GcKm7LTransferCopierIf
+{
+public:
+
+    TestCopier(
+        SysMem *pSysMem)
+    {
+        m_pSysMem = pSysMem;
+        m_NumCopyPages = 0;
+        m_NumCopyRuns = 0;
+    }
+
+    virtual NTSTATUS
+    CopyPages(
+        const PFN_NUMBER   *pSrcPages,
+        UINT                NumSrcPages,
+        UINT                SrcOffset,
+        const PFN_NUMBER   *pDstPages,
+        UINT                NumDstPages,
+        UINT                DstOffset,
+        UINT                CopySize)
+    {
+        CHECK(NumSrcPages <= GC_7L_TRANSFER_WINDOW_PAGES);
+        CHECK(NumDstPages <= GC_7L_TRANSFER_WINDOW_PAGES);
+        CHECK((SrcOffset + CopySize) <= NumSrcPages*PAGE_SIZE);
+        CHECK((DstOffset + CopySize) <= NumDstPages*PAGE_SIZE);
+
+        m_NumCopyPages++;
+
+        for (UINT i = 0; i < CopySize; i++)
+        {
+            UINT    Src = SrcOffset + i;
+            UINT    Dst = DstOffset + i;
+
+            m_pSysMem->GetPage(pDstPages[Dst >> PAGE_SHIFT])[Dst & (PAGE_SIZE - 1)] =
+                m_pSysMem->GetPage(pSrcPages[Src >> PAGE_SHIFT])[Src & (PAGE_SIZE - 1)];
+        }
+
+        return STATUS_SUCCESS;
+    }
+
+    virtual NTSTATUS
+    CopyRun(
+        ULONGLONG           SrcPhysicalAddress,
+        ULONGLONG           DstPhysicalAddress,
+        UINT                CopySize)
+    {
+        CHECK(CopySize <= GC_7L_TRANSFER_MAX_RUN_SIZE);
+
+        m_NumCopyRuns++;
+
+        for (UINT i = 0; i < CopySize; i++)
+        {
+            ULONGLONG   Src = SrcPhysicalAddress + i;
+            ULONGLONG   Dst = DstPhysicalAddress + i;
+
+            m_pSysMem->GetPage(Dst >> PAGE_SHIFT)[Dst & (PAGE_SIZE - 1)] =
+                m_pSysMem->GetPage(Src >> PAGE_SHIFT)[Src & (PAGE_SIZE - 1)];
+        }
+
+        return STATUS_SUCCESS;
+    }
+
+    UINT    m_NumCopyPages;
+    UINT    m_NumCopyRuns;
+
+private:
+
+    SysMem *m_pSysMem;
+};
+
+//
+// Runs one transfer and checks the destination and the guard bytes around it
+//
+
+static NTSTATUS
+RunTransfer(
+    GcKm7LPagingTransfer   *pTransfer,
+    TestPageTable          *pPageTable,
+    SysMem                 *pSysMem,
+    TestCopier             *pCopier,
+    UINT                    SrcGpuVa,
+    UINT                    DstGpuVa,
+    UINT                    Size,
+    bool                    bGpuTransferAllowed)
+{
+    std::vector<BYTE>   Expected(Size);
+    BYTE                GuardBefore = *pPageTable->GpuVaToCpuVa(pSysMem, DstGpuVa - 1);
+    BYTE                GuardAfter = *pPageTable->GpuVaToCpuVa(pSysMem, DstGpuVa + Size);
+
+    for (UINT i = 0; i < Size; i++)
+    {
+        Expected[i] = *pPageTable->GpuVaToCpuVa(pSysMem, SrcGpuVa + i);
+    }
+
+    DXGK_BUILDPAGINGBUFFER_TRANSFERVIRTUAL  TransferVirtual;
+
+    TransferVirtual.SourceVirtualAddress = SrcGpuVa;
+    TransferVirtual.DestinationVirtualAddress = DstGpuVa;
+    TransferVirtual.TransferSizeInBytes = Size;
+
+    NTSTATUS    Status = pTransfer->Transfer(pPageTable, pCopier, &TransferVirtual, bGpuTransferAllowed);
+
+    if (STATUS_SUCCESS == Status)
+    {
+        UINT    NumMismatches = 0;
+
+        for (UINT i = 0; i < Size; i++)
+        {
+            if (*pPageTable->GpuVaToCpuVa(pSysMem, DstGpuVa + i) != Expected[i])
+            {
+                NumMismatches++;
+            }
+        }
+
+        CHECK(0 == NumMismatches);
+        CHECK(GuardBefore == *pPageTable->GpuVaToCpuVa(pSysMem, DstGpuVa - 1));
+        CHECK(GuardAfter == *pPageTable->GpuVaToCpuVa(pSysMem, DstGpuVa + Size));
+    }
+
+    return Status;
+}
+
+static void
+TestContiguous()
+{
+    SysMem                  Mem;
+    TestPageTable           PageTable;
+    TestCopier              Copier(&Mem);
+    GcKm7LPagingTransfer    Transfer;
+
+    PageTable.MapContiguous(0x00000000, 0x10000, 1024);
+    PageTable.MapContiguous(0x10000000, 0x20000, 1024);
+
+    //
+    // 3MB over several windows, one mapping
+    //
+
+    CHECK(STATUS_SUCCESS == RunTransfer(&Transfer, &PageTable, &Mem, &Copier, 0x1234, 0x10000567, 3*1024*1024, false));
+    CHECK(1 == Copier.m_NumCopyRuns);
+    CHECK(0 == Copier.m_NumCopyPages);
+
+    //
+    // Split at GC_7L_TRANSFER_MAX_RUN_SIZE
+    //
+
+    Copier.m_NumCopyRuns = 0;
+
+    CHECK(STATUS_SUCCESS == RunTransfer(&Transfer, &PageTable, &Mem, &Copier, 0x1000, 0x10000000, 4*1024*1024 - 0x2000, false));
+    CHECK(1 == Copier.m_NumCopyRuns);
+
+    PageTable.MapContiguous(0x00400000, 0x10400, 2048);
+    PageTable.MapContiguous(0x10400000, 0x20400, 2048);
+
+    Copier.m_NumCopyRuns = 0;
+
+    CHECK(STATUS_SUCCESS == RunTransfer(&Transfer, &PageTable, &Mem, &Copier, 0x10, 0x10000020, 9*1024*1024, false));
+    CHECK(3 == Copier.m_NumCopyRuns);
+    CHECK(0 == Copier.m_NumCopyPages);
+}
+
+static void
+TestFragmented()
+{
+    SysMem                  Mem;
+    TestPageTable           PageTable;
+    TestCopier              Copier(&Mem);
+    GcKm7LPagingTransfer    Transfer;
+    std::vector<PFN_NUMBER> Pages(600);
+
+    //
+    // Source pages in reverse order, destination pages 2 apart
+    //
+
+    for (UINT i = 0; i < Pages.size(); i++)
+    {
+        Pages[i] = 0x30000 + Pages.size() - i;
+    }
+
+    PageTable.Map(0x00000000, Pages.data(), (UINT)Pages.size());
+
+    for (UINT i = 0; i < Pages.size(); i++)
+    {
+        Pages[i] = 0x40000 + i*2;
+    }
+
+    PageTable.Map(0x10000000, Pages.data(), (UINT)Pages.size());
+
+    CHECK(STATUS_SUCCESS == RunTransfer(&Transfer, &PageTable, &Mem, &Copier, 0x0FFF, 0x10000001, 2*1024*1024 + 3, false));
+    CHECK(0 == Copier.m_NumCopyRuns);
+    CHECK(3 == Copier.m_NumCopyPages);
+
+    const GcKm7LTransferStats  *pStats = Transfer.GetStats();
+
+    CHECK(1 == pStats->m_NumCpuTransfers);
+    CHECK(3 == pStats->m_NumWindowCopies);
+    CHECK(0 == pStats->m_NumRunCopies);
+}
+
+static void
+TestMixed()
+{
+    SysMem                  Mem;
+    TestPageTable           PageTable;
+    TestCopier              Copier(&Mem);
+    GcKm7LPagingTransfer    Transfer;
+
+    //
+    // Source contiguous. Destination contiguous for the first window,
+    // a hole in the second one, then contiguous again but not adjacent.
+    //
+
+    PageTable.MapContiguous(0x00000000, 0x10000, 1024);
+    PageTable.MapContiguous(0x10000000, 0x50000, 256);
+    PageTable.MapContiguous(0x10100000, 0x60000, 128);
+    PageTable.MapContiguous(0x10180000, 0x70000, 128);
+    PageTable.MapContiguous(0x10200000, 0x80000, 512);
+
+    CHECK(STATUS_SUCCESS == RunTransfer(&Transfer, &PageTable, &Mem, &Copier, 0, 0x10000000, 3*1024*1024, false));
+    CHECK(2 == Copier.m_NumCopyRuns);
+    CHECK(1 == Copier.m_NumCopyPages);
+
+    //
+    // Adjacent GPU VA ranges whose physical pages are contiguous
+    // but do not follow each other
+    //
+
+    Copier.m_NumCopyRuns = 0;
+    Copier.m_NumCopyPages = 0;
+
+    PageTable.MapContiguous(0x20000000, 0x90000, 256);
+    PageTable.MapContiguous(0x20100000, 0xA0000, 256);
+
+    CHECK(STATUS_SUCCESS == RunTransfer(&Transfer, &PageTable, &Mem, &Copier, 0x20000000, 0x00000000, 2*1024*1024, false));
+    CHECK(2 == Copier.m_NumCopyRuns);
+    CHECK(0 == Copier.m_NumCopyPages);
+}
+
+static void
+TestCpuOrGpu()
+{
+    SysMem                  Mem;
+    TestPageTable           PageTable;
+    TestCopier              Copier(&Mem);
+    GcKm7LPagingTransfer    Transfer;
+
+    PageTable.MapContiguous(0x00000000, 0x10000, 2048);
+    PageTable.MapContiguous(0x10000000, 0x20000, 2048);
+    PageTable.MapContiguous(0x20000000, GC_7L_TRANSFER_4GB_PAGE_NUMBER + 0x100, 2048);
+
+    //
+    // Large transfer below 4GB goes to the GPU, nothing is copied
+    //
+
+    CHECK(STATUS_MORE_PROCESSING_REQUIRED == RunTransfer(&Transfer, &PageTable, &Mem, &Copier, 0, 0x10000000, 8*1024*1024, true));
+    CHECK(0 == Copier.m_NumCopyRuns);
+    CHECK(0 == Copier.m_NumCopyPages);
+
+    //
+    // Destination above 4GB forces the CPU
+    //
+
+    CHECK(STATUS_SUCCESS == RunTransfer(&Transfer, &PageTable, &Mem, &Copier, 0, 0x20000000, 8*1024*1024, true));
+    CHECK(2 == Copier.m_NumCopyRuns);
+
+    //
+    // Small transfers always stay on CPU
+    //
+
+    CHECK(STATUS_SUCCESS == RunTransfer(&Transfer, &PageTable, &Mem, &Copier, 0x100, 0x10000100, GC_7L_TRANSFER_CPU_ONLY_SIZE, true));
+
+    const GcKm7LTransferStats  *pStats = Transfer.GetStats();
+
+    CHECK(1 == pStats->m_NumGpuTransfers);
+    CHECK(1 == pStats->m_NumForcedCpuTransfers);
+    CHECK(2 == pStats->m_NumCpuTransfers);
+}
+
+static void
+TestStreamCopy()
+{
+    std::vector<BYTE>   Src(64*1024 + 256);
+    std::vector<BYTE>   Dst(64*1024 + 256);
+
+    for (UINT i = 0; i < Src.size(); i++)
+    {
+        Src[i] = (BYTE)(i*13 + 5);
+    }
+
+    static const UINT   Sizes[] = { 0, 1, 63, 64, 65, GC_7L_STREAM_COPY_MIN_SIZE - 1, GC_7L_STREAM_COPY_MIN_SIZE, 4096 + 77, 64*1024 };
+
+    for (UINT DstAlign = 0; DstAlign < 64; DstAlign += 7)
+    {
+        for (UINT SrcAlign = 0; SrcAlign < 64; SrcAlign += 5)
+        {
+            for (UINT Size : Sizes)
+            {
+                memset(Dst.data(), 0xA5, Dst.size());
+
+                GcKm7LStreamCopy(Dst.data() + DstAlign, Src.data() + SrcAlign, Size);
+
+                CHECK(0 == memcmp(Dst.data() + DstAlign, Src.data() + SrcAlign, Size));
+                CHECK((0 == DstAlign) || (0xA5 == Dst[DstAlign - 1]));
+                CHECK(0xA5 == Dst[DstAlign + Size]);
+            }
+        }
+    }
+}
+
+int
+main()
+{
+    TestContiguous();
+    TestFragmented();
+    TestMixed();
+    TestCpuOrGpu();
+    TestStreamCopy();
+
+    return HostTestResult("GcKmd7LTransferTest");
+}
@@ -0,0 +1,20 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host build stand-in, only the types used by the GDI op templates
+// and GcKmd7LGdiBatch.cpp are needed
+//
+
+#pragma once
+
+typedef int32_t             LONG;
+typedef ULONGLONG           D3DGPU_VIRTUAL_ADDRESS;
+
+typedef struct _RECT
+{
+    LONG    left;
+    LONG    top;
+    LONG    right;
+    LONG    bottom;
+} RECT;
@@ -0,0 +1,103 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host build stand-in for the kernel headers used by GcKmd7LTransfer.cpp
+// and GcKmd7LGdiBatch.cpp, pulled in through the driver's precomp.h. The
+// other headers precomp.h includes are empty.
+//
+
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+//
+// Pure virtual methods are declared "= NULL" as with MSVC
+//
+
+#undef NULL
+#define NULL                0
+
+typedef int32_t             NTSTATUS;
+typedef uint8_t             BYTE;
+typedef BYTE               *PBYTE;
+typedef unsigned int        UINT;
+typedef unsigned long       ULONG;
+typedef int64_t             LONGLONG;
+typedef uint64_t            ULONGLONG;
+typedef size_t              SIZE_T;
+typedef uintptr_t           ULONG_PTR;
+typedef ULONG_PTR           PFN_NUMBER;
+typedef void               *PVOID;
+
+#define STATUS_SUCCESS                      ((NTSTATUS)0x00000000L)
+#define STATUS_MORE_PROCESSING_REQUIRED     ((NTSTATUS)0xC0000016L)
+#define STATUS_NO_MEMORY                    ((NTSTATUS)0xC0000017L)
+#define STATUS_INVALID_PARAMETER            ((NTSTATUS)0xC000000DL)
+
+#define NT_SUCCESS(Status)  (((NTSTATUS)(Status)) >= 0)
+#define NT_ASSERT(e)        assert(e)
+
+#define PAGE_SIZE           0x1000
+#define PAGE_SHIFT          12
+
+#ifndef min
+#define min(a, b)           (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef max
+#define max(a, b)           (((a) > (b)) ? (a) : (b))
+#endif
+
+typedef union _LARGE_INTEGER
+{
+    LONGLONG    QuadPart;
+} LARGE_INTEGER, PHYSICAL_ADDRESS;
+
+inline LARGE_INTEGER
+KeQueryPerformanceCounter(
+    LARGE_INTEGER  *pFrequency)
+{
+    static LONGLONG Counter;
+    LARGE_INTEGER   Value;
+
+    if (pFrequency)
+    {
+        pFrequency->QuadPart = 1000000;
+    }
+
+    Value.QuadPart = ++Counter;
+
+    return Value;
+}
+
+//
+// The MDL copier is compiled but never called on host
+//
+
+typedef struct _MDL
+{
+    ULONG       MdlFlags;
+} MDL;
+
+#define MDL_PARTIAL             0x0001
+#define MDL_PAGES_LOCKED        0x0002
+#define MDL_IO_SPACE            0x0004
+
+enum { KernelMode };
+enum { MmWriteCombined };
+enum { NormalPagePriority = 0x10, MdlMappingNoExecute = 0x40000000 };
+
+#define MmInitializeMdl(pMdl, Va, Length)                           ((pMdl)->MdlFlags = 0)
+#define MmMapLockedPagesSpecifyCache(pMdl, Mode, Cache, Va, Bug, Pri)   (NULL)
+#define MmUnmapLockedPages(Va, pMdl)
+#define MmMapIoSpace(PhysicalAddress, Size, Cache)                  ((void)(PhysicalAddress), (PVOID)NULL)
+#define MmUnmapIoSpace(Va, Size)
+
+typedef struct _DXGK_BUILDPAGINGBUFFER_TRANSFERVIRTUAL
+{
+    ULONGLONG   SourceVirtualAddress;
+    ULONGLONG   DestinationVirtualAddress;
+    SIZE_T      TransferSizeInBytes;
+} DXGK_BUILDPAGINGBUFFER_TRANSFERVIRTUAL;
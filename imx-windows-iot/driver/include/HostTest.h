@@ -0,0 +1,42 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Checks shared by the host unit tests in the driver test directories
+//
+// A failed CHECK prints its location and the test carries on, main() runs
+// the cases and returns HostTestResult(), which reports the failed checks.
+// Builds as C and C++.
+//
+
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int  g_NumFailures;
+
+#define CHECK(Cond)                                                         \
+    do                                                                      \
+    {                                                                       \
+        if (!(Cond))                                                        \
+        {                                                                   \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #Cond); \
+            g_NumFailures++;                                                \
+        }                                                                   \
+    } while (0)
+
+static inline int
+HostTestResult(
+    const char *pName)
+{
+    if (g_NumFailures)
+    {
+        printf("%s: %d check(s) failed\n", pName, g_NumFailures);
+        return EXIT_FAILURE;
+    }
+
+    printf("%s: passed\n", pName);
+
+    return EXIT_SUCCESS;
+}
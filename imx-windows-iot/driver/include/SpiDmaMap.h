@@ -0,0 +1,517 @@
+// Copyright 2023 NXP
+// Licensed under the MIT License.
+//
+// Module Name:
+//
+//    SpiDmaMap.h
+//
+// Abstract:
+//
+//    This module contains the PIO/DMA crossover policy, the mapping of
+//    the transfer MDL chain to DMA chunks, and the transfer statistics
+//    shared by the IMX ECSPI and LPSPI controller drivers.
+//
+//    The names carry the prefix of the driver: the includer defines
+//    SPI_DMA_MAP_PREFIX (ECSPI or LPSPI) and includes this module from its
+//    own dmamap header, SPI_DMA_POLICY and SpiDmaSelectThreshold below then
+//    declare ECSPI_DMA_POLICY and ECSPIDmaSelectThreshold. The module can
+//    be included once per prefix.
+//
+//    The module does not depend on WDF or on the hardware, the includer
+//    provides ULONG, ULONG64, LONG64, BOOLEAN, size_t and __forceinline,
+//    and the MDL type is a template parameter, so the policy can be built and
+//    driven with a simulated MDL chain on any host.
+//
+// Environment:
+//
+//    kernel-mode only
+//
+
+#ifndef SPI_DMA_MAP_PREFIX
+#error SPI_DMA_MAP_PREFIX must be defined before including SpiDmaMap.h
+#endif
+
+#define SPI_DMA_MAP_PASTE2(Prefix, Name) Prefix##Name
+#define SPI_DMA_MAP_PASTE(Prefix, Name) SPI_DMA_MAP_PASTE2(Prefix, Name)
+#define SPI_DMA_MAP_NAME(Name) SPI_DMA_MAP_PASTE(SPI_DMA_MAP_PREFIX, Name)
+
+//
+// Names of this instance, undefined at the end of the module
+//
+#define SPI_DMA_THRESHOLD_DEFAULT      SPI_DMA_MAP_NAME(_DMA_THRESHOLD_DEFAULT)
+#define SPI_DMA_THRESHOLD_DISABLED     SPI_DMA_MAP_NAME(_DMA_THRESHOLD_DISABLED)
+#define SPI_DMA_POLICY                 SPI_DMA_MAP_NAME(_DMA_POLICY)
+#define SPI_TRANSFER_STATISTICS        SPI_DMA_MAP_NAME(_TRANSFER_STATISTICS)
+#define SPI_DMA_STATISTICS             SPI_DMA_MAP_NAME(_DMA_STATISTICS)
+#define SpiDmaSelectThreshold          SPI_DMA_MAP_NAME(DmaSelectThreshold)
+#define SpiDmaIsTransferEligible       SPI_DMA_MAP_NAME(DmaIsTransferEligible)
+#define SpiDmaIsBufferAligned          SPI_DMA_MAP_NAME(DmaIsBufferAligned)
+#define SpiDmaGetChunkLength           SPI_DMA_MAP_NAME(DmaGetChunkLength)
+#define SpiDmaGetChunkWatermark        SPI_DMA_MAP_NAME(DmaGetChunkWatermark)
+#define SpiDmaAdvanceMdl               SPI_DMA_MAP_NAME(DmaAdvanceMdl)
+#define SpiRecordTransfer              SPI_DMA_MAP_NAME(RecordTransfer)
+#define SpiGetAverageUsec              SPI_DMA_MAP_NAME(GetAverageUsec)
+#define SpiGetThroughputKBps           SPI_DMA_MAP_NAME(GetThroughputKBps)
+
+//
+// DmaThresholdBytes special values
+//
+enum : ULONG {
+    SPI_DMA_THRESHOLD_DEFAULT = 0,              // One TX FIFO fill
+    SPI_DMA_THRESHOLD_DISABLED = 0xFFFFFFFF,    // PIO only
+};
+
+
+//
+// SPI_DMA_POLICY.
+//  The PIO/DMA crossover policy, and the limits of a single DMA chunk.
+//
+struct SPI_DMA_POLICY {
+
+    //
+    // Transfers shorter than the threshold use PIO
+    //
+    ULONG ThresholdBytes;
+
+    //
+    // DMA element size in bytes, from the FixedDMA transfer width.
+    // Each element is a single FIFO entry.
+    //
+    ULONG ElementSize;
+
+    //
+    // Max FIFO entries the DMA moves per request (the watermark level)
+    //
+    ULONG WatermarkElements;
+
+    //
+    // Max chunk length, and max number of scatter/gather
+    // entries (pages) a chunk may span.
+    //
+    ULONG MaxChunkBytes;
+    ULONG MaxDescriptors;
+    ULONG PageSize;
+};
+
+
+//
+// SPI_TRANSFER_STATISTICS.
+//  Per transfer latency, from transfer start to completion,
+//  and throughput.
+//
+struct SPI_TRANSFER_STATISTICS {
+    ULONG64 Transfers;
+    ULONG64 Bytes;
+    ULONG64 TotalUsec;
+    ULONG MaxUsec;
+};
+
+
+//
+// SPI_DMA_STATISTICS.
+//
+struct SPI_DMA_STATISTICS {
+
+    //
+    // Number of DMA chunks
+    //
+    ULONG64 Chunks;
+
+    //
+    // Transfers above the threshold that used PIO, since the buffer
+    // layout, the target, or the IRQL did not allow DMA.
+    // Counted outside the device lock, with InterlockedIncrement64.
+    //
+    volatile LONG64 Fallbacks;
+
+    //
+    // Transfers that failed on a DMA error
+    //
+    ULONG64 Errors;
+};
+
+
+//
+// Routine Description:
+//
+//  SpiDmaSelectThreshold returns the DMA threshold for the
+//  configured DmaThresholdBytes value.
+//  By default a transfer that fits in the TX FIFO uses PIO, since it
+//  completes with a single FIFO fill, in less time than it takes
+//  to program the DMA.
+//
+// Arguments:
+//
+//  ConfiguredBytes - The DmaThresholdBytes parameter.
+//
+//  FifoDepthWords - The FIFO depth (32 bit words).
+//
+//  ElementSize - The DMA element size in bytes.
+//
+// Return Value:
+//
+//  The threshold in bytes, rounded up to the element size, or
+//  SPI_DMA_THRESHOLD_DISABLED.
+//
+__forceinline
+ULONG
+SpiDmaSelectThreshold (
+    ULONG ConfiguredBytes,
+    ULONG FifoDepthWords,
+    ULONG ElementSize
+    )
+{
+    if ((ConfiguredBytes == SPI_DMA_THRESHOLD_DISABLED) ||
+        (ElementSize == 0)) {
+
+        return SPI_DMA_THRESHOLD_DISABLED;
+    }
+
+    if (ConfiguredBytes == SPI_DMA_THRESHOLD_DEFAULT) {
+
+        ConfiguredBytes = FifoDepthWords * sizeof(ULONG);
+    }
+
+    ULONG remainder = ConfiguredBytes % ElementSize;
+    if (remainder != 0) {
+
+        if (ConfiguredBytes > (SPI_DMA_THRESHOLD_DISABLED - ElementSize)) {
+
+            return SPI_DMA_THRESHOLD_DISABLED;
+        }
+        ConfiguredBytes += ElementSize - remainder;
+    }
+    return ConfiguredBytes;
+}
+
+//
+// Routine Description:
+//
+//  SpiDmaIsTransferEligible returns TRUE if a transfer of the given
+//  length and buffer stride should use DMA.
+//
+// Arguments:
+//
+//  PolicyPtr - The DMA policy.
+//
+//  Length - The transfer length in bytes.
+//
+//  BufferStride - The transfer buffer stride in bytes.
+//
+// Return Value:
+//
+//  TRUE if transfer should use DMA, otherwise FALSE.
+//
+__forceinline
+BOOLEAN
+SpiDmaIsTransferEligible (
+    const SPI_DMA_POLICY* PolicyPtr,
+    size_t Length,
+    ULONG BufferStride
+    )
+{
+    if ((PolicyPtr->ThresholdBytes == SPI_DMA_THRESHOLD_DISABLED) ||
+        (Length < PolicyPtr->ThresholdBytes)) {
+
+        return FALSE;
+    }
+
+    return (BufferStride == PolicyPtr->ElementSize) &&
+           ((Length % PolicyPtr->ElementSize) == 0);
+}
+
+//
+// Routine Description:
+//
+//  SpiDmaIsBufferAligned returns TRUE if every MDL fragment of
+//  the transfer buffer starts on an element boundary, and holds
+//  whole elements, so no element is split between two
+//  scatter/gather entries.
+//
+// Arguments:
+//
+//  PolicyPtr - The DMA policy.
+//
+//  MdlPtr - The first MDL of the transfer buffer.
+//
+//  Length - The transfer length in bytes.
+//
+// Return Value:
+//
+//  TRUE if the buffer can be used for DMA, otherwise FALSE.
+//
+template<typename MDL_TYPE>
+__forceinline
+BOOLEAN
+SpiDmaIsBufferAligned (
+    const SPI_DMA_POLICY* PolicyPtr,
+    const MDL_TYPE* MdlPtr,
+    size_t Length
+    )
+{
+    const ULONG elementSize = PolicyPtr->ElementSize;
+
+    for (; (MdlPtr != nullptr) && (Length != 0); MdlPtr = MdlPtr->Next) {
+
+        size_t fragmentBytes = MdlPtr->ByteCount;
+        if (fragmentBytes > Length) {
+
+            fragmentBytes = Length;
+        }
+
+        if (((MdlPtr->ByteOffset % elementSize) != 0) ||
+            ((fragmentBytes % elementSize) != 0)) {
+
+            return FALSE;
+        }
+        Length -= fragmentBytes;
+    }
+    return Length == 0;
+}
+
+//
+// Routine Description:
+//
+//  SpiDmaGetChunkLength returns the length of the next DMA chunk
+//  starting at the given MDL position.
+//  A chunk does not cross an MDL, spans at most MaxDescriptors pages so
+//  it maps to a single scatter/gather list, and is a multiple of the
+//  watermark level, so the DMA requests line up with the chunk end.
+//  Only the last chunk of an MDL may be shorter than the watermark
+//  level, it is then programmed with its own length as watermark.
+//
+// Arguments:
+//
+//  PolicyPtr - The DMA policy.
+//
+//  MdlPtr - The current MDL.
+//
+//  MdlOffset - The current offset within MdlPtr.
+//
+//  BytesLeft - Number of bytes left to transfer.
+//
+//  DescriptorsPtr - Caller variable to receive the number of
+//      scatter/gather entries (pages) the chunk spans.
+//
+// Return Value:
+//
+//  The chunk length in bytes, 0 if there is nothing left in MdlPtr.
+//
+template<typename MDL_TYPE>
+__forceinline
+ULONG
+SpiDmaGetChunkLength (
+    const SPI_DMA_POLICY* PolicyPtr,
+    const MDL_TYPE* MdlPtr,
+    size_t MdlOffset,
+    size_t BytesLeft,
+    ULONG* DescriptorsPtr
+    )
+{
+    const ULONG pageSize = PolicyPtr->PageSize;
+    const ULONG elementSize = PolicyPtr->ElementSize;
+
+    *DescriptorsPtr = 0;
+    if ((MdlPtr == nullptr) || (MdlOffset >= MdlPtr->ByteCount)) {
+
+        return 0;
+    }
+
+    size_t length = MdlPtr->ByteCount - MdlOffset;
+    if (length > BytesLeft) {
+
+        length = BytesLeft;
+    }
+    if (length > PolicyPtr->MaxChunkBytes) {
+
+        length = PolicyPtr->MaxChunkBytes;
+    }
+
+    size_t pageOffset = (MdlPtr->ByteOffset + MdlOffset) % pageSize;
+    size_t maxSpan = (size_t(PolicyPtr->MaxDescriptors) * pageSize) - pageOffset;
+    if (length > maxSpan) {
+
+        length = maxSpan;
+    }
+
+    size_t elements = length / elementSize;
+    if (elements > PolicyPtr->WatermarkElements) {
+
+        elements -= elements % PolicyPtr->WatermarkElements;
+    }
+    length = elements * elementSize;
+
+    *DescriptorsPtr = ULONG((pageOffset + length + pageSize - 1) / pageSize);
+    return ULONG(length);
+}
+
+//
+// Routine Description:
+//
+//  SpiDmaGetChunkWatermark returns the watermark level (elements)
+//  to program for a chunk.
+//
+// Arguments:
+//
+//  PolicyPtr - The DMA policy.
+//
+//  ChunkLength - The chunk length in bytes.
+//
+// Return Value:
+//
+//  The watermark level in elements.
+//
+__forceinline
+ULONG
+SpiDmaGetChunkWatermark (
+    const SPI_DMA_POLICY* PolicyPtr,
+    ULONG ChunkLength
+    )
+{
+    ULONG elements = ChunkLength / PolicyPtr->ElementSize;
+
+    return (elements < PolicyPtr->WatermarkElements) ?
+        elements : PolicyPtr->WatermarkElements;
+}
+
+//
+// Routine Description:
+//
+//  SpiDmaAdvanceMdl advances an MDL position by the given number of
+//  bytes, and skips the MDLs that have been fully consumed.
+//
+// Arguments:
+//
+//  MdlPPtr - Address of the current MDL.
+//
+//  MdlOffsetPtr - Address of the current offset within the current MDL.
+//
+//  ByteCount - Number of bytes to advance.
+//
+// Return Value:
+//
+template<typename MDL_TYPE>
+__forceinline
+void
+SpiDmaAdvanceMdl (
+    MDL_TYPE** MdlPPtr,
+    size_t* MdlOffsetPtr,
+    size_t ByteCount
+    )
+{
+    size_t mdlOffset = *MdlOffsetPtr + ByteCount;
+    MDL_TYPE* mdlPtr = *MdlPPtr;
+
+    while ((mdlPtr != nullptr) && (mdlOffset >= mdlPtr->ByteCount)) {
+
+        mdlOffset -= mdlPtr->ByteCount;
+        mdlPtr = mdlPtr->Next;
+    }
+
+    *MdlPPtr = mdlPtr;
+    *MdlOffsetPtr = mdlOffset;
+}
+
+//
+// Routine Description:
+//
+//  SpiRecordTransfer adds a completed transfer to the statistics.
+//
+// Arguments:
+//
+//  StatisticsPtr - The statistics to update.
+//
+//  Bytes - Transfer length in bytes.
+//
+//  LatencyUsec - Transfer start to completion time in uSec.
+//
+// Return Value:
+//
+__forceinline
+void
+SpiRecordTransfer (
+    SPI_TRANSFER_STATISTICS* StatisticsPtr,
+    size_t Bytes,
+    ULONG LatencyUsec
+    )
+{
+    StatisticsPtr->Transfers += 1;
+    StatisticsPtr->Bytes += Bytes;
+    StatisticsPtr->TotalUsec += LatencyUsec;
+    if (LatencyUsec > StatisticsPtr->MaxUsec) {
+
+        StatisticsPtr->MaxUsec = LatencyUsec;
+    }
+}
+
+//
+// Routine Description:
+//
+//  SpiGetAverageUsec returns the average transfer latency.
+//
+// Arguments:
+//
+//  StatisticsPtr - The transfer statistics.
+//
+// Return Value:
+//
+//  Average transfer latency in uSec.
+//
+__forceinline
+ULONG64
+SpiGetAverageUsec (
+    const SPI_TRANSFER_STATISTICS* StatisticsPtr
+    )
+{
+    if (StatisticsPtr->Transfers == 0) {
+
+        return 0;
+    }
+    return StatisticsPtr->TotalUsec / StatisticsPtr->Transfers;
+}
+
+//
+// Routine Description:
+//
+//  SpiGetThroughputKBps returns the average throughput while
+//  transfers were active.
+//
+// Arguments:
+//
+//  StatisticsPtr - The transfer statistics.
+//
+// Return Value:
+//
+//  Throughput in KB (1000 bytes) per second.
+//
+__forceinline
+ULONG64
+SpiGetThroughputKBps (
+    const SPI_TRANSFER_STATISTICS* StatisticsPtr
+    )
+{
+    if (StatisticsPtr->TotalUsec == 0) {
+
+        return 0;
+    }
+    return (StatisticsPtr->Bytes * 1000) / StatisticsPtr->TotalUsec;
+}
+
+#undef SPI_DMA_MAP_NAME
+#undef SPI_DMA_MAP_PASTE
+#undef SPI_DMA_MAP_PASTE2
+#undef SPI_DMA_THRESHOLD_DEFAULT
+#undef SPI_DMA_THRESHOLD_DISABLED
+#undef SPI_DMA_POLICY
+#undef SPI_TRANSFER_STATISTICS
+#undef SPI_DMA_STATISTICS
+#undef SpiDmaSelectThreshold
+#undef SpiDmaIsTransferEligible
+#undef SpiDmaIsBufferAligned
+#undef SpiDmaGetChunkLength
+#undef SpiDmaGetChunkWatermark
+#undef SpiDmaAdvanceMdl
+#undef SpiRecordTransfer
+#undef SpiGetAverageUsec
+#undef SpiGetThroughputKBps
+#undef SPI_DMA_MAP_PREFIX
@@ -83,6 +83,16 @@ typedef enum {
     RxFrameDiscardEnabled  = 1,
 } ENET_RX_FRAME_DISCARD_MODE;
 
+typedef enum {
+    LsoDisabled = 0,
+    LsoEnabled  = 1,
+} ENET_LSO_MODE;
+
+typedef enum {
+    IntModerationDisabled = 0,
+    IntModerationEnabled  = 1,
+} ENET_INT_MODERATION_MODE;
+
 /*
  * ENET_EIR - ENET Interrupt Event Register
  */
@@ -366,6 +376,28 @@ typedef union {
 #define ENET_OPD_PAUSE_DUR_MASK                0x0000FFFF
 #define ENET_OPD_OPCODE_MASK                   0xFFFF0000
 
+/*
+ * ENET_TXIC/ENET_RXIC - ENET Transmit/Receive Interrupt Coalescing Register
+ */
+typedef union {
+    UINT32  U;
+    struct {
+        unsigned ICTT        : 16;
+        unsigned RSRVD_16_19 :  4;
+        unsigned ICFT        :  8;
+        unsigned RSRVD_28_29 :  2;
+        unsigned ICCS        :  1;
+        unsigned ICEN        :  1;
+    } B;
+} ICR_t;
+
+#define ENET_ICR_ICTT_MASK                     0x0000FFFF
+#define ENET_ICR_ICTT_SHIFT                    0
+#define ENET_ICR_ICFT_MASK                     0x0FF00000
+#define ENET_ICR_ICFT_SHIFT                    20
+#define ENET_ICR_ICCS_MASK                     0x40000000
+#define ENET_ICR_ICEN_MASK                     0x80000000
+
 //------------------------------------------------------------------------------
 // REGISTER LAYOUT
 //------------------------------------------------------------------------------
@@ -391,7 +423,10 @@ typedef struct {
     UINT32  PALR;               // 0E4
     UINT32  PAUR;               // 0E8
     OPD_t   OPD;                // 0EC
-    UINT32  ___RES_0F0[10];
+    ICR_t   TXIC[3];            // 0F0
+    UINT32  ___RES_0FC;
+    ICR_t   RXIC[3];            // 100
+    UINT32  ___RES_10C[3];
     UINT32  IAUR;               // 118
     UINT32  IALR;               // 11C
     UINT32  GAUR;               // 120
@@ -187,6 +187,14 @@ typedef struct _MP_TX_BD {
     PNET_BUFFER           pNB;             // NB address
     PNET_BUFFER_LIST      pNBL;            // MBL address
     LONG                  NBId;            // For debug only
+    BOOLEAN               IsLso;           // LSOv2 send, segmented by the driver
+    MP_TX_LSO_HEADER      Lso;             // LSOv2 segmentation parameters
+    ULONG                 HeaderBytes;     // Bytes copied to the bounce buffer ahead of the payload of each segment
+    ULONG                 SegmentSize;     // Payload bytes of each segment but the last one
+    ULONG                 SegmentCount;    // Number of Ethernet frames the NET_BUFFER is sent as, more than one for LSOv2 only
+    ULONG                 SegmentIdx;      // Next segment to put to the ENET BDs
+    ULONG                 BDCount;         // Number of ENET BDs the next segment takes
+    ULONG                 CopyBytes;       // Payload bytes of the next segment copied to the bounce buffer of its first BD, the rest is mapped straight from pSGList
     PSCATTER_GATHER_LIST  pSGList;         // The scatter gather list address
     SCATTER_GATHER_LIST   SGList;          // SG list passed to MpProcessSGList
 } MP_TX_BD, *PMP_TX_BD;
@@ -195,7 +203,9 @@ typedef struct _MP_TX_BD {
 // The TX payload data buffer descriptor.
 // ------------------------------------------------------------------------------------------------
 typedef struct _MP_TX_PAYLOAD_BD {
-    PMP_TX_BD               pMpBD;
+    PMP_TX_BD               pMpBD;          // Set on the first BD of each segment
+    ULONG                   BDCount;        // Number of BDs of the segment
+    BOOLEAN                 LastSegment;    // The NET_BUFFER is done with this segment
     PMDL                    pMdl;
     PUCHAR                  pBuffer;
     NDIS_PHYSICAL_ADDRESS   BufferPa;
@@ -211,6 +221,8 @@ typedef struct _MP_RX_FRAME_BD {
     PMDL                    pMdl;           // Address of the MDL describing buffer
     PUCHAR                  pBuffer;        // Address of the buffer (in the context of miniport driver)
     NDIS_PHYSICAL_ADDRESS   BufferPa;       // Physical address of the buffer
+    ULONG                   BufferSize;     // Size of the buffer
+    BOOLEAN                 CopyBuffer;     // Copy-break buffer, not used by the ENET DMA
 } MP_RX_FRAME_BD, *PMP_RX_FRAME_BD;
 
 
@@ -297,6 +309,8 @@ typedef struct _MP_ADAPTER {
     USHORT                  TheMostPowefullSpeedAndDuplexMode;     // The most powerful speed and duplex mode for both partners are capable
     NDIS_HANDLE             Tx_DmaHandle;                          // Scatter/Gather DMA handle
     ULONG                   Tx_SGListSize;
+    ULONG                   Tx_CopyBreak;                          // Frames up to this size are copied to the bounce buffer, longer frames are mapped from the NET_BUFFER
+    PMP_TX_BD               Tx_pLsoMpBD;                           // LSOv2 send with segments not put to the ENET BDs yet, already in Tx_qDmaOwnedBDs
     NPAGED_LOOKASIDE_LIST   Tx_MpTxBDLookasideList;                // Tx buffer descriptor lookaside list
     ULONG                   Tx_CheckForHangCounter;
     LONG                    Tx_PendingNBs;                         // Number of TX frames (NET_BUFFERs) that are owned by the miniport. Total number of queued TX frames and frames that are already setup for DMA transfers.
@@ -335,6 +349,16 @@ typedef struct _MP_ADAPTER {
     ULONG                   Rx_DmaBDT_Size;                        // Size of Rx_DmaBDT in bytes
     NDIS_PHYSICAL_ADDRESS   Rx_DmaBDT_Pa;                          // Physical address of Rx_DmaBDT
     LONG                    Rx_NBLCounter;                         // For debug only
+    LONG                    Rx_BufferCount;                        // Number of DMA receive buffers, not less than Rx_DmaBDT_ItemCount
+    ULONG                   Rx_CopyBreak;                          // Frames up to this size are copied to a copy-break buffer, 0 - copy-break disabled
+    LONG                    Rx_CopyBufferCount;                    // Number of copy-break buffers
+    PUCHAR                  Rx_CopyBuffer_Va;                      // Block of all copy-break buffers
+    ULONG                   Rx_CopyBuffer_Size;                    // Size of one copy-break buffer
+    ULONG                   Rx_RefillBatch;                        // Empty BDs refilled at once
+    PVOID                  *Rx_PoolEntries;                        // Storage of Rx_Pool and Rx_CopyPool
+    MP_RX_POOL              Rx_Pool;                               // Free DMA receive buffers
+    MP_RX_POOL              Rx_CopyPool;                           // Free copy-break buffers
+    MP_RX_POOL_STATISTICS   Rx_PoolStats;                          // Refill and copy-break counters, protected by Rx_SpinLock
     NDIS_SPIN_LOCK          Dev_SpinLock;                          // spin locks
     // Packet Filter and look ahead size.
     ULONG                   PacketFilter;
@@ -348,6 +372,12 @@ typedef struct _MP_ADAPTER {
 
     NDIS_HANDLE             NdisInterruptHandle;
     BOOLEAN                 InterruptRegistered;
+    ULONG                   RxPollBudget;                          // Max. Rx frames indicated in one DPC call
+    MP_INT_MOD              IntMod;                                // Adaptive interrupt coalescing state and statistics, protected by Dev_SpinLock
+    ULONG                   IntMod_Clock_kHz;                      // Coalescing timer clock (MII/GMII TX clock), 0 without link
+    LARGE_INTEGER           IntMod_QpcFrequency;                   // Performance counter frequency
+    LONGLONG                IntMod_IsrTimestamp;                   // Performance counter at the ISR that started the current poll
+    ULONG                   IntMod_PollPackets;                    // Rx and Tx frames handled since that ISR
 
     ULONG                   CacheFillSize;
 
@@ -413,6 +443,9 @@ typedef struct _MP_ADAPTER {
     ENET_CHECKSUM_OFFLOAD_MODE TCPChecksumOffloadIPv6;
     ENET_CHECKSUM_OFFLOAD_MODE UDPChecksumOffloadIPv4;
     ENET_CHECKSUM_OFFLOAD_MODE UDPChecksumOffloadIPv6;
+    ENET_LSO_MODE              LsoV2IPv4;
+    ENET_LSO_MODE              LsoV2IPv6;
+    ENET_INT_MODERATION_MODE   InterruptModeration;
     ENET_RX_FRAME_DISCARD_MODE DiscardRxFrameWithWrongProtocolChecksum;
     ENET_RX_FRAME_DISCARD_MODE DiscardRxFrameWithWrongIPv4HeaderChecksum;
 } MP_ADAPTER, *PMP_ADAPTER;
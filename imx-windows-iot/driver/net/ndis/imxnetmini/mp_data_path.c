@@ -262,6 +262,13 @@ VOID MpTxUnwindNetBuffer(PMP_ADAPTER pAdapter, PNET_BUFFER_LIST pNBL, PNET_BUFFE
         NdisFreeToNPagedLookasideList(&pAdapter->Tx_MpTxBDLookasideList, pMpTxBD);
     }
     if (NdisInterlockedDecrement(&MP_NBL_NB_Counter(pNBL)) == 0) {
+        NDIS_TCP_LARGE_SEND_OFFLOAD_NET_BUFFER_LIST_INFO lsoInfo;
+        lsoInfo.Value = NET_BUFFER_LIST_INFO(pNBL, TcpLargeSendNetBufferListInfo);
+        if ((lsoInfo.Value != NULL) && (lsoInfo.Transmit.Type == NDIS_TCP_LARGE_SEND_OFFLOAD_V2_TYPE)) {
+            lsoInfo.Value = NULL;                                                   // LSOv2 completion: Reserved must be zero
+            lsoInfo.LsoV2TransmitComplete.Type = NDIS_TCP_LARGE_SEND_OFFLOAD_V2_TYPE;
+            NET_BUFFER_LIST_INFO(pNBL, TcpLargeSendNetBufferListInfo) = lsoInfo.Value;
+        }
         #ifdef DBG
         LARGE_INTEGER  CurrentSystemTime;
         LARGE_INTEGER  NBLStartTime;
@@ -298,6 +305,7 @@ BOOLEAN MpTxCancelAll(PMP_ADAPTER pAdapter)
         InsertHeadList(&CanceledNetBufferList, pListEntry);
     while ((pListEntry = MpQueueGetNext(&pAdapter->Tx_qMpOwnedBDs)) != NULL)
         InsertHeadList(&CanceledNetBufferList, pListEntry);
+    pAdapter->Tx_pLsoMpBD = NULL;                                            // The LSOv2 send was in Tx_qDmaOwnedBDs
     CompletionStatus = pAdapter->NdisStatus;                                 // Get the completion status to use
     BOOLEAN isAnyTxFrameCanceled = !IsListEmpty(&CanceledNetBufferList);     // The status to return...
     NdisReleaseSpinLock(&pAdapter->Tx_SpinLock);
@@ -357,28 +365,29 @@ void MpCancelSendNetBufferLists(NDIS_HANDLE MiniportAdapterContext, PVOID Cancel
 Routine Description:
    Copy data in a packet to the specified location
 Arguments:
-    pMpTxBD         A pointer to the source buffer
-    pEnetSwExtBD    A pointer to the destination buffer
+    pNB             A pointer to the source NET_BUFFER
+    pDest           A pointer to the destination buffer
+    SkipBytes       Offset of the first byte to copy from the beginning of the NET_BUFFER
+    BytesToCopy     Max number of bytes to copy
 Return Value:
     The number of bytes actually copied
 --*/
-ULONG MpCopyNetBuffer(_In_ PMP_TX_BD pMpTxBD, _Inout_ PMP_TX_PAYLOAD_BD pEnetSwExtBD)
+ULONG MpCopyNetBuffer(_In_ PNET_BUFFER pNB, _Out_writes_bytes_(BytesToCopy) PUCHAR pDest, _In_ ULONG SkipBytes, _In_ ULONG BytesToCopy)
 {
     ULONG          CurrLength=0;
     PUCHAR         pSrc=NULL;
-    PUCHAR         pDest;
     ULONG          BytesCopied = 0;
     ULONG          Offset;
     PMDL           CurrentMdl;
     ULONG          DataLength;
-    PNET_BUFFER    NetBuffer = pMpTxBD->pNB;
-    PSCATTER_GATHER_LIST sgListPtr = pMpTxBD->pSGList;
 
 //TODO    DBG_ENET_DEV_TX_METHOD_BEG();
-    pDest = pEnetSwExtBD->pBuffer;
-    CurrentMdl = NET_BUFFER_FIRST_MDL(NetBuffer);
-    Offset = NET_BUFFER_DATA_OFFSET(NetBuffer);
-    DataLength = NET_BUFFER_DATA_LENGTH(NetBuffer);
+    CurrentMdl = NET_BUFFER_FIRST_MDL(pNB);
+    Offset = NET_BUFFER_DATA_OFFSET(pNB) + SkipBytes;
+    DataLength = (NET_BUFFER_DATA_LENGTH(pNB) > SkipBytes) ? (NET_BUFFER_DATA_LENGTH(pNB) - SkipBytes) : 0;
+    if (DataLength > BytesToCopy) {
+        DataLength = BytesToCopy;
+    }
 
     while (CurrentMdl && DataLength > 0) {
         NdisQueryMdl(CurrentMdl, &pSrc, &CurrLength, NormalPagePriority);
@@ -406,34 +415,154 @@ ULONG MpCopyNetBuffer(_In_ PMP_TX_BD pMpTxBD, _Inout_ PMP_TX_PAYLOAD_BD pEnetSwE
         NdisGetNextMdl(CurrentMdl, &CurrentMdl);
 
     }
-    if ((BytesCopied != 0) && (BytesCopied < ETHER_FRAME_NIN_LENGTH))  {
-        NdisZeroMemory(pDest, ETHER_FRAME_NIN_LENGTH - BytesCopied);
-    }
-    NdisAdjustMdlLength(pEnetSwExtBD->pMdl, BytesCopied);
-    ASSERT(BytesCopied <= pEnetSwExtBD->BufferSize);
-
-    sgListPtr->Elements[0].Address = pEnetSwExtBD->BufferPa;
-    sgListPtr->Elements[0].Length = BytesCopied;
 //TODO    DBG_ENET_DEV_TX_METHOD_END();
     return BytesCopied;
 }
 
 /*++
 Routine Description:
-    It is called to map all NET_BUFFER scatter gather elements into TX DMA descriptors.
+    Reads the LSOv2 parameters of the NET_BUFFER, if any, and parses its headers. The segment size is limited
+    so that the headers and the payload of a segment fit in a bounce buffer.
 Arguments:
     pAdapter    Address of the adapter context
-    pMpTxBD     Address of the TCB to be freed
+    pMpTxBD     Address of the Mp Tx BD
+Return Value:
+    NDIS_STATUS_SUCCESS, or NDIS_STATUS_INVALID_PACKET if the LSOv2 send can not be segmented.
+--*/
+NDIS_STATUS MpTxLsoParseNetBuffer(_In_ PMP_ADAPTER pAdapter, _Inout_ PMP_TX_BD pMpTxBD)
+{
+    NDIS_TCP_LARGE_SEND_OFFLOAD_NET_BUFFER_LIST_INFO lsoInfo;
+    UCHAR   HeaderStorage[MP_TX_LSO_MAX_HEADER_SIZE];
+    PUCHAR  pHeader = NULL;
+    ULONG   DataLength = NET_BUFFER_DATA_LENGTH(pMpTxBD->pNB);
+    ULONG   BytesNeeded;
+
+    UNREFERENCED_PARAMETER(pAdapter);
+    pMpTxBD->IsLso = FALSE;
+    lsoInfo.Value = NET_BUFFER_LIST_INFO(pMpTxBD->pNBL, TcpLargeSendNetBufferListInfo);
+    if ((lsoInfo.Value == NULL) || (lsoInfo.Transmit.Type != NDIS_TCP_LARGE_SEND_OFFLOAD_V2_TYPE)) {
+        return NDIS_STATUS_SUCCESS;
+    }
+    BytesNeeded = lsoInfo.LsoV2Transmit.TcpHeaderOffset + TCP_HEADER_MIN_LENGTH;                 // Up to the TCP header length field
+    if ((lsoInfo.LsoV2Transmit.MSS != 0) && (BytesNeeded <= sizeof(HeaderStorage)) && (BytesNeeded <= DataLength)) {
+        pHeader = (PUCHAR)NdisGetDataBuffer(pMpTxBD->pNB, BytesNeeded, HeaderStorage, 1, 0);
+    }
+    if ((pHeader == NULL) ||
+        !MpTxLsoParseHeader(&pMpTxBD->Lso, pHeader, BytesNeeded, lsoInfo.LsoV2Transmit.TcpHeaderOffset, (BOOLEAN)(lsoInfo.LsoV2Transmit.IPVersion == NDIS_TCP_LARGE_SEND_OFFLOAD_IPv6)) ||
+        (pMpTxBD->Lso.HeaderLength > DataLength)) {
+        DBG_ENET_DEV_TX_PRINT_ERROR("NB(%d) LSOv2 headers can not be segmented, MSS: %d, TcpHeaderOffset: %d", pMpTxBD->NBId, lsoInfo.LsoV2Transmit.MSS, lsoInfo.LsoV2Transmit.TcpHeaderOffset);
+        return NDIS_STATUS_INVALID_PACKET;
+    }
+    pMpTxBD->IsLso       = TRUE;
+    pMpTxBD->SegmentSize = lsoInfo.LsoV2Transmit.MSS;
+    if (pMpTxBD->SegmentSize > ENET_TX_FRAME_SIZE - pMpTxBD->Lso.HeaderLength) {
+        pMpTxBD->SegmentSize = ENET_TX_FRAME_SIZE - pMpTxBD->Lso.HeaderLength;                  // A segment must fit in the bounce buffer
+    }
+    return NDIS_STATUS_SUCCESS;
+}
+
+/*++
+Routine Description:
+    Returns the payload of the next segment of the NET_BUFFER.
+Arguments:
+    pMpTxBD         Address of the Mp Tx BD
+    pPayloadOffset  Offset of the payload from the beginning of the NET_BUFFER
+Return Value:
+    Payload bytes of the segment
+--*/
+ULONG MpTxSegmentPayload(_In_ PMP_TX_BD pMpTxBD, _Out_ PULONG pPayloadOffset)
+{
+    ULONG DataLength = NET_BUFFER_DATA_LENGTH(pMpTxBD->pNB);
+    ULONG PayloadOffset = pMpTxBD->HeaderBytes + pMpTxBD->SegmentIdx * pMpTxBD->SegmentSize;
+
+    *pPayloadOffset = PayloadOffset;
+    if (PayloadOffset >= DataLength) {
+        return 0;
+    }
+    return ((DataLength - PayloadOffset) > pMpTxBD->SegmentSize) ? pMpTxBD->SegmentSize : (DataLength - PayloadOffset);
+}
+
+/*++
+Routine Description:
+    Decides how the next segment of the NET_BUFFER is put to the ENET Tx BDs. Segments up to Tx_CopyBreak bytes and
+    segments the ENET can not take straight from the scatter gather list are copied to the bounce buffer of a single BD.
+    The payload of the other segments is mapped fragment by fragment, the headers, if any, are copied.
+Arguments:
+    pAdapter    Address of the adapter context
+    pMpTxBD     Address of the Mp Tx BD with the scatter gather list
 Return Value:
     None
 --*/
-void MpTxFillEnetTxBD(_In_ PMP_ADAPTER pAdapter, _In_ PMP_TX_BD pMpTxBD)
+void MpTxPlanSegment(_In_ PMP_ADAPTER pAdapter, _Inout_ PMP_TX_BD pMpTxBD)
 {
-    PSCATTER_GATHER_LIST sgListPtr = pMpTxBD->pSGList;
-    LONG                 EnetFreeBDIdx = pAdapter->Tx_EnetFreeBDIdx;            // First free Ethernet packet hw buffer descriptor index
-    volatile ENET_BD    *pFreeEnetBD = &pAdapter->Tx_DmaBDT[EnetFreeBDIdx];    // First free Ethernet packet hw buffer descriptor address
-    USHORT               ControlStatus;
-    ULONG                bytesToSent;
+    ULONG PayloadOffset;
+    ULONG PayloadLength = MpTxSegmentPayload(pMpTxBD, &PayloadOffset);
+    ULONG BDCount = MpTxMapPlan(pMpTxBD->pSGList, pMpTxBD->HeaderBytes, PayloadOffset, PayloadLength, pAdapter->Tx_CopyBreak,
+                                (ULONG)pAdapter->Tx_DmaBDT_ItemCount, ENET_TX_BD_MAX_LENGTH, ENET_TX_BD_ALIGN_MASK);
+
+    pMpTxBD->CopyBytes = (BDCount == 0) ? PayloadLength : 0;                                   // Copy the whole segment if it is not mapped
+    pMpTxBD->BDCount   = (BDCount == 0) ? 1 : BDCount;
+}
+
+/*++
+Routine Description:
+    Splits the NET_BUFFER into segments. A LSOv2 send is split into MSS sized segments, each with a copy of the headers.
+    Any other NET_BUFFER is a single segment, its headers are copied only if the protocol checksum field has to be cleared.
+Arguments:
+    pAdapter    Address of the adapter context
+    pMpTxBD     Address of the Mp Tx BD with the scatter gather list
+Return Value:
+    None
+--*/
+void MpTxMapNetBuffer(_In_ PMP_ADAPTER pAdapter, _Inout_ PMP_TX_BD pMpTxBD)
+{
+    ULONG DataLength = NET_BUFFER_DATA_LENGTH(pMpTxBD->pNB);
+#ifdef ENET_ENHANCED_BD
+    NDIS_TCP_IP_CHECKSUM_NET_BUFFER_LIST_INFO checksumInfo;
+#endif
+
+    pMpTxBD->HeaderBytes  = 0;
+    pMpTxBD->SegmentCount = 1;
+    pMpTxBD->SegmentIdx   = 0;
+    if (pMpTxBD->IsLso) {
+        pMpTxBD->HeaderBytes = pMpTxBD->Lso.HeaderLength;                                      // SegmentSize is set by MpTxLsoParseNetBuffer()
+        if (DataLength > pMpTxBD->HeaderBytes) {
+            pMpTxBD->SegmentCount = (DataLength - pMpTxBD->HeaderBytes + pMpTxBD->SegmentSize - 1) / pMpTxBD->SegmentSize;
+        }
+    } else {
+        pMpTxBD->SegmentSize = DataLength;
+#ifdef ENET_ENHANCED_BD
+        checksumInfo.Value = NET_BUFFER_LIST_INFO(pMpTxBD->pNBL, TcpIpChecksumNetBufferListInfo);
+        if ((checksumInfo.Transmit.IsIPv4 || checksumInfo.Transmit.IsIPv6) && (checksumInfo.Transmit.TcpChecksum || checksumInfo.Transmit.UdpChecksum)) {
+            pMpTxBD->HeaderBytes = ENET_TX_HEADER_COPY_SIZE;                                   // The checksum field is cleared in the bounce buffer
+            if (checksumInfo.Transmit.TcpChecksum && (checksumInfo.Transmit.TcpHeaderOffset + ETH_TCP_CHECKSUM_OFFSET + 2U > pMpTxBD->HeaderBytes)) {
+                pMpTxBD->HeaderBytes = checksumInfo.Transmit.TcpHeaderOffset + ETH_TCP_CHECKSUM_OFFSET + 2U;
+            }
+            if (pMpTxBD->HeaderBytes > DataLength) {
+                pMpTxBD->HeaderBytes = DataLength;
+            }
+            pMpTxBD->SegmentSize = DataLength - pMpTxBD->HeaderBytes;
+        }
+#endif
+    }
+    MpTxPlanSegment(pAdapter, pMpTxBD);
+}
+
+#ifdef ENET_ENHANCED_BD
+/*++
+Routine Description:
+    Returns the enhanced status of the Tx BDs of the frame. If the protocol checksum is to be inserted by ENET,
+    the checksum field is cleared in the bounce buffer.
+Arguments:
+    pMpTxBD         Address of the Mp Tx BD
+    buffer          The bounce buffer
+    BytesCopied     Number of bytes in the bounce buffer
+Return Value:
+    The ENET_BD EnhancedStatus
+--*/
+ULONG MpTxChecksumOffload(_In_ PMP_TX_BD pMpTxBD, _Inout_updates_bytes_(BytesCopied) UCHAR *buffer, _In_ ULONG BytesCopied)
+{
+    ULONG                EnhancedStatus = ENET_TX_BD_ESTATUS_INT;                             // Generate TX interrupt
     USHORT               EtherType;
     USHORT               IpHeaderStart;
     USHORT               IpHeaderLength;
@@ -441,27 +570,6 @@ void MpTxFillEnetTxBD(_In_ PMP_ADAPTER pAdapter, _In_ PMP_TX_BD pMpTxBD)
     USHORT               Checksum;
     NDIS_TCP_IP_CHECKSUM_NET_BUFFER_LIST_INFO checksumInfo = { 0 };
 
-    ASSERT(sgListPtr != NULL);
-    ASSERT(sgListPtr->NumberOfElements > 0);
-
-    DBG_ENET_DEV_TX_METHOD_BEG();
-    bytesToSent = MpCopyNetBuffer(pMpTxBD, &pAdapter->Tx_EnetSwExtBDT[EnetFreeBDIdx]);          // Copy data to driver provided buffer
-    UCHAR *buffer = pAdapter->Tx_EnetSwExtBDT[EnetFreeBDIdx].pBuffer;
-    ASSERT(bytesToSent);
-    ASSERT(!(pFreeEnetBD->ControlStatus & ENET_TX_BD_R_MASK));
-    pAdapter->Tx_EnetSwExtBDT[EnetFreeBDIdx].pMpBD = pMpTxBD;                                   // Associate sw MP_TxBD with current hw ENET_TxBD
-    ControlStatus = ENET_TX_BD_L_MASK | ENET_TX_BD_TC_MASK | ENET_TX_BD_R_MASK;                 // Prepare transfer flags
-    if (++EnetFreeBDIdx == pAdapter->Tx_DmaBDT_ItemCount) {                                     // Update Free BD index
-        ControlStatus |= ENET_TX_BD_W_MASK;                                                     // Last BD in BDT must have WRAP bit set
-        EnetFreeBDIdx = 0;                                                                      // Free BD is the first item of Tx_DmaBDT
-    }
-    pAdapter->Tx_EnetFreeBDIdx = EnetFreeBDIdx;
-    pAdapter->Tx_EnetFreeBDCount--;
-
-    pFreeEnetBD->DataLen        = (USHORT)sgListPtr->Elements[0].Length;                       // Set ENET_TxBD data length
-#ifdef ENET_ENHANCED_BD
-    pFreeEnetBD->EnhancedStatus = ENET_TX_BD_ESTATUS_INT;                                      // Generate TX interrupt
-
     // Get checksum offload OOB data
     checksumInfo.Value = NET_BUFFER_LIST_INFO(pMpTxBD->pNBL, TcpIpChecksumNetBufferListInfo);
     if (checksumInfo.Value) {
@@ -471,7 +579,7 @@ void MpTxFillEnetTxBD(_In_ PMP_ADAPTER pAdapter, _In_ PMP_TX_BD pMpTxBD)
         // Ip Header checksum
         if (checksumInfo.Transmit.IpHeaderChecksum) {
             DBG_ENET_DEV_CHKSUM_OFFLOAD_PRINT_TRACE("[TX] Enabling HW IP protocol checksum");
-            pFreeEnetBD->EnhancedStatus = pFreeEnetBD->EnhancedStatus | ENET_TX_BD_ESTATUS_IINS;
+            EnhancedStatus |= ENET_TX_BD_ESTATUS_IINS;
         }
         //UDP checksum
         ASSERT(buffer != NULL);
@@ -495,6 +603,7 @@ void MpTxFillEnetTxBD(_In_ PMP_ADAPTER pAdapter, _In_ PMP_TX_BD pMpTxBD)
             }
             //Calculate UDP checksum possition within buffer and get checksum calculated by NDIS
             ChksumPos = (IpHeaderStart + IpHeaderLength + ETH_UDP_CHECKSUM_OFFSET) - 1U;
+            ASSERT(ChksumPos + 1U < BytesCopied);
             Checksum = (USHORT)buffer[ChksumPos] << 8U | buffer[ChksumPos + 1U];
             // WORKARROUND - clear the checksum field becauses HW expects this field cleared but NDIS TCP/IP transport 
             //               calculates the one's complement sum for the TCP pseudoheader and insert this in the Checksum field
@@ -504,13 +613,14 @@ void MpTxFillEnetTxBD(_In_ PMP_ADAPTER pAdapter, _In_ PMP_TX_BD pMpTxBD)
                 buffer[ChksumPos + 1U] = 0x00U;
             }
             // Enable HW protocol checksum calculation
-            pFreeEnetBD->EnhancedStatus = pFreeEnetBD->EnhancedStatus | ENET_TX_BD_ESTATUS_PINS;
+            EnhancedStatus |= ENET_TX_BD_ESTATUS_PINS;
         }
         //TCP checksum
         if (checksumInfo.Transmit.TcpChecksum) {
             DBG_ENET_DEV_CHKSUM_OFFLOAD_PRINT_TRACE("[TX] Enabling HW TCP protocol checksum");
             // Calculate TCP checksum possition within buffer and get checksum calculated by NDIS
             ChksumPos = checksumInfo.Transmit.TcpHeaderOffset + ETH_TCP_CHECKSUM_OFFSET;
+            ASSERT(ChksumPos + 1U < BytesCopied);
             Checksum = (USHORT)buffer[ChksumPos] << 8U | buffer[ChksumPos + 1U];
             // WORKARROUND - clear the checksum field becauses HW expects this field cleared but NDIS TCP/IP transport 
             //               calculates the one's complement sum for the TCP pseudoheader and insert this in the Checksum field
@@ -520,20 +630,147 @@ void MpTxFillEnetTxBD(_In_ PMP_ADAPTER pAdapter, _In_ PMP_TX_BD pMpTxBD)
                 buffer[ChksumPos + 1] = 0x00U;
             }
             // Enable HW protocol checksum calculation
-            pFreeEnetBD->EnhancedStatus = pFreeEnetBD->EnhancedStatus | ENET_TX_BD_ESTATUS_PINS;
+            EnhancedStatus |= ENET_TX_BD_ESTATUS_PINS;
         }
     }
+    return EnhancedStatus;
+}
 #endif
-    pFreeEnetBD->BufferAddress = NdisGetPhysicalAddressLow(sgListPtr->Elements[0].Address);   // Set ENET_TxBD data address
-    pFreeEnetBD->ControlStatus = ControlStatus;                                               // Write ControlStatus word of BD as last step
+
+/*++
+Routine Description:
+    It is called to map the next segment of the NET_BUFFER into TX DMA descriptors.
+    The bounce buffer of the first BD takes the copied part of the segment, if any, the other BDs point straight to the
+    NET_BUFFER data. The headers of a LSOv2 segment are fixed up in the bounce buffer. The first BD is given to ENET DMA
+    as the last step.
+Arguments:
+    pAdapter    Address of the adapter context
+    pMpTxBD     Address of the TCB to be freed
+Return Value:
+    None
+--*/
+void MpTxFillEnetTxBD(_In_ PMP_ADAPTER pAdapter, _In_ PMP_TX_BD pMpTxBD)
+{
+    LONG                 EnetFreeBDIdx = pAdapter->Tx_EnetFreeBDIdx;            // First free Ethernet packet hw buffer descriptor index
+    volatile ENET_BD    *pFirstEnetBD = &pAdapter->Tx_DmaBDT[EnetFreeBDIdx];   // First Ethernet packet hw buffer descriptor address of the frame
+    volatile ENET_BD    *pFreeEnetBD;
+    PMP_TX_PAYLOAD_BD    pEnetSwExtBD = &pAdapter->Tx_EnetSwExtBDT[EnetFreeBDIdx];
+    MP_TX_MAP_CURSOR     Cursor;
+    USHORT               ControlStatus;
+    USHORT               FirstControlStatus = 0;
+    ULONG                BufferAddress;
+    ULONG                BufferLength;
+    ULONG                PayloadOffset;
+    ULONG                PayloadLength = MpTxSegmentPayload(pMpTxBD, &PayloadOffset);
+    ULONG                BDCount = pMpTxBD->BDCount;
+    BOOLEAN              IsLastSegment = (BOOLEAN)(pMpTxBD->SegmentIdx + 1 >= pMpTxBD->SegmentCount);
+    LARGE_INTEGER        LsoStartTicks = { 0 };
+    ULONG                bytesCopied = 0;
+    ULONG                bytesToSent = 0;
+#ifdef ENET_ENHANCED_BD
+    ULONG                EnhancedStatus;
+#endif
+
+    ASSERT(pMpTxBD->pSGList != NULL);
+    ASSERT(pMpTxBD->pSGList->NumberOfElements > 0);
+    ASSERT((LONG)BDCount <= pAdapter->Tx_EnetFreeBDCount);
+
+    DBG_ENET_DEV_TX_METHOD_BEG();
+    if (pMpTxBD->IsLso) {
+        LsoStartTicks = KeQueryPerformanceCounter(NULL);
+    }
+    if (pMpTxBD->HeaderBytes != 0) {
+        bytesCopied = MpCopyNetBuffer(pMpTxBD->pNB, pEnetSwExtBD->pBuffer, 0, pMpTxBD->HeaderBytes);   // Copy headers to driver provided buffer
+    }
+    if (pMpTxBD->CopyBytes != 0) {
+        bytesCopied += MpCopyNetBuffer(pMpTxBD->pNB, pEnetSwExtBD->pBuffer + bytesCopied, PayloadOffset, pMpTxBD->CopyBytes);   // Copy payload too
+    }
+    ASSERT(bytesCopied == pMpTxBD->HeaderBytes + pMpTxBD->CopyBytes);
+    ASSERT(bytesCopied <= pEnetSwExtBD->BufferSize);
+    if ((bytesCopied != 0) && (bytesCopied < ETHER_FRAME_NIN_LENGTH) && (pMpTxBD->CopyBytes == PayloadLength)) {
+        NdisZeroMemory(pEnetSwExtBD->pBuffer + bytesCopied, ETHER_FRAME_NIN_LENGTH - bytesCopied);
+    }
+    NdisAdjustMdlLength(pEnetSwExtBD->pMdl, bytesCopied);
+    if (pMpTxBD->IsLso) {
+        MpTxLsoBuildHeader(&pMpTxBD->Lso, pEnetSwExtBD->pBuffer, pMpTxBD->SegmentIdx, pMpTxBD->SegmentSize, PayloadLength, IsLastSegment);
+    }
+#ifdef ENET_ENHANCED_BD
+    if (pMpTxBD->IsLso) {
+        EnhancedStatus = ENET_TX_BD_ESTATUS_INT | ENET_TX_BD_ESTATUS_PINS;                     // ENET inserts the TCP checksum of the segment
+        if (!pMpTxBD->Lso.IsIPv6) {
+            EnhancedStatus |= ENET_TX_BD_ESTATUS_IINS;                                         // and the IPv4 header checksum
+        }
+    } else {
+        EnhancedStatus = MpTxChecksumOffload(pMpTxBD, pEnetSwExtBD->pBuffer, bytesCopied);
+    }
+#endif
+    if (BDCount == 1) {                                                                        // Update Tx path counters
+        pAdapter->TxdStatus.FramesXmitCopied++;
+    } else if (bytesCopied != 0) {
+        pAdapter->TxdStatus.FramesXmitHeaderCopied++;
+    } else {
+        pAdapter->TxdStatus.FramesXmitZeroCopy++;
+    }
+    MpTxMapInit(&Cursor, pMpTxBD->pSGList, PayloadOffset + pMpTxBD->CopyBytes, PayloadLength - pMpTxBD->CopyBytes, ENET_TX_BD_MAX_LENGTH);
+    pEnetSwExtBD->pMpBD       = pMpTxBD;                                                       // Associate sw MP_TxBD with the first hw ENET_TxBD of the segment
+    pEnetSwExtBD->BDCount     = BDCount;
+    pEnetSwExtBD->LastSegment = IsLastSegment;
+    for (ULONG BDIdx = 0; BDIdx < BDCount; ++BDIdx) {
+        if ((BDIdx == 0) && (bytesCopied != 0)) {
+            BufferAddress = pEnetSwExtBD->BufferPa.LowPart;                                    // Bounce buffer
+            BufferLength  = bytesCopied;
+        } else {
+            (void)MpTxMapNextFragment(&Cursor, &BufferAddress, &BufferLength);                 // NET_BUFFER fragment
+        }
+        pFreeEnetBD = &pAdapter->Tx_DmaBDT[EnetFreeBDIdx];
+        ASSERT(!(pFreeEnetBD->ControlStatus & ENET_TX_BD_R_MASK));
+        ControlStatus = ENET_TX_BD_R_MASK;                                                     // Prepare transfer flags
+        if (BDIdx == BDCount - 1) {
+            ControlStatus |= ENET_TX_BD_L_MASK | ENET_TX_BD_TC_MASK;                           // Last BD of the frame
+        }
+        if (++EnetFreeBDIdx == pAdapter->Tx_DmaBDT_ItemCount) {                                 // Update Free BD index
+            ControlStatus |= ENET_TX_BD_W_MASK;                                                 // Last BD in BDT must have WRAP bit set
+            EnetFreeBDIdx = 0;                                                                  // Free BD is the first item of Tx_DmaBDT
+        }
+        pFreeEnetBD->DataLen        = (USHORT)BufferLength;                                    // Set ENET_TxBD data length
+#ifdef ENET_ENHANCED_BD
+        pFreeEnetBD->EnhancedStatus = EnhancedStatus;
+#endif
+        pFreeEnetBD->BufferAddress  = BufferAddress;                                           // Set ENET_TxBD data address
+        if (BDIdx == 0) {
+            FirstControlStatus = ControlStatus;                                                // The first BD is given to DMA as the last step
+        } else {
+            pFreeEnetBD->ControlStatus = ControlStatus;
+        }
+        bytesToSent += BufferLength;
+    }
+    pAdapter->Tx_EnetFreeBDIdx = EnetFreeBDIdx;
+    pAdapter->Tx_EnetFreeBDCount -= (LONG)BDCount;
+    ASSERT(bytesToSent >= pMpTxBD->HeaderBytes + PayloadLength);
+    if (pMpTxBD->IsLso) {
+        if (pMpTxBD->SegmentIdx == 0) {
+            pAdapter->TxdStatus.FramesXmitLso++;
+            pAdapter->TxdStatus.BytesXmitLso += NET_BUFFER_DATA_LENGTH(pMpTxBD->pNB);
+        }
+        pAdapter->TxdStatus.FramesXmitLsoSegments++;
+    }
+    if (++pMpTxBD->SegmentIdx < pMpTxBD->SegmentCount) {
+        MpTxPlanSegment(pAdapter, pMpTxBD);                                                    // BDs the next segment takes
+    }
+    if (pMpTxBD->IsLso) {
+        pAdapter->TxdStatus.TicksXmitLso += (ULONGLONG)(KeQueryPerformanceCounter(NULL).QuadPart - LsoStartTicks.QuadPart);
+    }
+
+    _DataSynchronizationBarrier();                                                             // The rest of the frame must be ready before the first BD is
+    pFirstEnetBD->ControlStatus = FirstControlStatus;                                          // Write ControlStatus word of the first BD as last step
 
     _DataSynchronizationBarrier();                                                             // Wait for read is finished
-    ControlStatus = pFreeEnetBD->ControlStatus;                                                // Read ControlStatus back
+    ControlStatus = pFirstEnetBD->ControlStatus;                                               // Read ControlStatus back
     _DataSynchronizationBarrier();                                                             // Wait for read is finished
-    DBG_ENET_DEV_TX_PRINT_TRACE("NB(%d): Added to ENET_BD, Size: %5d.",pMpTxBD->NBId,(USHORT)sgListPtr->Elements[0].Length);
+    DBG_ENET_DEV_TX_PRINT_TRACE("NB(%d): Added to ENET_BD, Segment: %d/%d, Size: %5d, BDs: %d.", pMpTxBD->NBId, pMpTxBD->SegmentIdx, pMpTxBD->SegmentCount, bytesToSent, BDCount);
     if (pAdapter->ENETRegBase->TDAR == 0) {
         _DataSynchronizationBarrier();                                                         // Wait for read is finished
-        if (pFreeEnetBD->ControlStatus & ENET_TX_BD_R_MASK) {                                  // Transfer not started yet?
+        if (pFirstEnetBD->ControlStatus & ENET_TX_BD_R_MASK) {                                 // Transfer not started yet?
             DBG_ENET_DEV_TX_PRINT_TRACE("NB(%d): Starting transfer. TDAR: 0x%08X, EIR: 0x%08X", pMpTxBD->NBId, pAdapter->ENETRegBase->TDAR, pAdapter->ENETRegBase->EIR.U);
             pAdapter->ENETRegBase->TDAR = 0x00000000;                                          // No, start transfer
         }
@@ -546,7 +783,8 @@ Routine Description:
     Tries to send the next pending Ethernet frame (Net buffer). If an outgoing frame is pending, it makes sure we have enough
     free BDs to accommodate for the frame fragments. If we do, the frame is taken out from
     the queue, the required TFD list is setup to map the frame fragments and the transmission is
-    initiated.
+    initiated. A LSOv2 send is put to the BDs segment by segment, the segments left wait in Tx_pLsoMpBD
+    for BDs to be freed and go ahead of the queued frames.
     The above process continues until there are no more TX frames to send or we exhausted all
     our free TFDs, and we need to wait for a TX frame to complete before we can send the next
     pending frames.
@@ -565,18 +803,25 @@ void MpSendNextNB(_In_ PMP_ADAPTER pAdapter)
             break;
         }
         for (;;) {
-            if ((pAdapter->Tx_EnetFreeBDCount == 0)) {                            // No Dma BD empty?
-//TODO                DBG_ENET_DEV_TX_PRINT_TRACE("NB(%d) - OUT of ENET_TxBD", pAdapter->Tx_pCurrentMpBD->NBId);
+            PMP_TX_BD Tx_pCurrentMpBD = pAdapter->Tx_pLsoMpBD;                    // Segments of a LSOv2 send left?
+            if (Tx_pCurrentMpBD == NULL) {
+                PLIST_ENTRY pListEntry = MpQueuePeekFirst(&pAdapter->Tx_qMpOwnedBDs); // Get NB from Miniport queue
+                if (pListEntry == NULL) {                                         // Queue empty?
+                    DBG_ENET_DEV_TX_PRINT_TRACE("Tx_qMpOwnedBDs EMPTY");
+                    break;                                                        // Yes, no more NBs to send.
+                }
+                Tx_pCurrentMpBD = CONTAINING_RECORD(pListEntry, MP_TX_BD, Link);  // Get NB address
+            }
+            if ((LONG)Tx_pCurrentMpBD->BDCount > pAdapter->Tx_EnetFreeBDCount) {  // Not enough Dma BDs empty?
+                DBG_ENET_DEV_TX_PRINT_TRACE("NB(%d) - OUT of ENET_TxBD", Tx_pCurrentMpBD->NBId);
                 break;                                                            // Do nothing, Tx DPC will dequeue NB from Tx_qMpOwnedBDs
             }
-            PLIST_ENTRY pListEntry = MpQueueGetNext(&pAdapter->Tx_qMpOwnedBDs);   // Get NB from remove from Miniport queue
-            if (pListEntry == NULL) {                                             // Queue empty?
-                DBG_ENET_DEV_TX_PRINT_TRACE("Tx_qMpOwnedBDs EMPTY");
-                break;                                                            // Yes, no more NBs to send.
+            if (Tx_pCurrentMpBD->SegmentIdx == 0) {
+                (void)MpQueueGetNext(&pAdapter->Tx_qMpOwnedBDs);                  // Remove NB from Miniport queue
+                MpQueueAdd(&pAdapter->Tx_qDmaOwnedBDs, &Tx_pCurrentMpBD->Link);                               // Add NB to the DMA queue
             }
-            PMP_TX_BD Tx_pCurrentMpBD = Tx_pCurrentMpBD = CONTAINING_RECORD(pListEntry, MP_TX_BD, Link);  // Get NB address
-            MpQueueAdd(&pAdapter->Tx_qDmaOwnedBDs, &Tx_pCurrentMpBD->Link);                               // Add NB to the DMA queue
             MpTxFillEnetTxBD(pAdapter, Tx_pCurrentMpBD);                                                  // Put data to HW add start transfer
+            pAdapter->Tx_pLsoMpBD = (Tx_pCurrentMpBD->SegmentIdx < Tx_pCurrentMpBD->SegmentCount) ? Tx_pCurrentMpBD : NULL;
         } // Keep processing queued TX frames
     } while (0);
     NdisReleaseSpinLock(&pAdapter->Tx_SpinLock);
@@ -606,6 +851,7 @@ void MpProcessSGList(PDEVICE_OBJECT DeviceObjectPtr, PVOID Reserved, PSCATTER_GA
 
 //TODO    DBG_ENET_DEV_TX_PRINT_TRACE("NB(%d) Adding to Tx_qMpOwnedBDs queue", pMpTxBD->NBId);
     pMpTxBD->pSGList = SGListPtr;
+    MpTxMapNetBuffer(pMpTxBD->pAdapter, pMpTxBD);                               // Decide between the copy and the zero-copy path
     MpQueueAdd(&pMpTxBD->pAdapter->Tx_qMpOwnedBDs, &pMpTxBD->Link);
 }
 
@@ -670,6 +916,9 @@ void MpSendNetBufferLists(NDIS_HANDLE MiniportAdapterContext, PNET_BUFFER_LIST N
                 pMpTxBD->pNBL      = pCurrentNBL;                          // Associate NBL with MpTxBD
                 pMpTxBD->pNB       = pCurrentNB;                           // Associate NB with MpTxBD
                 pMpTxBD->pSGList   = NULL;
+                if ((status = MpTxLsoParseNetBuffer(pAdapter, pMpTxBD)) != NDIS_STATUS_SUCCESS) {
+                    break;
+                }
                 // Map the buffer to its physically contiguous fragments. NdisMAllocateNetBufferSGList needs to be called at DISPATCH_LEVEL
                 DBG_ENET_DEV_TX_PRINT_TRACE("NB(%d) Calling AllocSGList()", pMpTxBD->NBId);
                 NdisAcquireSpinLock(&pAdapter->Tx_SpinLock);
@@ -734,15 +983,18 @@ Arguments:
     pAdapter        The miniport adapter context
     InterruptEvent  The Interrupt Event Register image.
 Return Value:
-    None
+    Number of TX frames completed
 --*/
 _Use_decl_annotations_
-void MpHandleTxInterrupt(PMP_ADAPTER pAdapter, UINT32 InterruptEvent)
+ULONG MpHandleTxInterrupt(PMP_ADAPTER pAdapter, UINT32 InterruptEvent)
 {
     LIST_ENTRY         completedNetBufferList;
     LONG               EnetPendingBDIdx;
+    LONG               EnetLastBDIdx;
     volatile ENET_BD  *pDmaTxBD;
     PMP_TX_BD          pMpTxBD = NULL;
+    PMP_TX_PAYLOAD_BD  pEnetSwExtBD;
+    ULONG              CompletedFrames = 0;
 
     UNREFERENCED_PARAMETER(InterruptEvent);
     InitializeListHead(&completedNetBufferList);
@@ -752,26 +1004,34 @@ void MpHandleTxInterrupt(PMP_ADAPTER pAdapter, UINT32 InterruptEvent)
     EnetPendingBDIdx = pAdapter->Tx_EnetPendingBDIdx;
     DBG_ENET_DEV_TX_PRINT_TRACE("**** ISR,  Tx_EnetPendingBDIdx: %d, Tx_EnetFreeBDIdx: %d, flags: 0x%08X, TDAR: 0x%08X ****", pAdapter->Tx_EnetPendingBDIdx, pAdapter->Tx_EnetFreeBDIdx, InterruptEvent, pAdapter->ENETRegBase->TDAR);
     do {
-        pMpTxBD = pAdapter->Tx_EnetSwExtBDT[EnetPendingBDIdx].pMpBD;                     // Get Mp NB Tx BD
+        pEnetSwExtBD = &pAdapter->Tx_EnetSwExtBDT[EnetPendingBDIdx];
+        pMpTxBD = pEnetSwExtBD->pMpBD;                                                   // Get Mp NB Tx BD
         if (pMpTxBD == NULL) {                                                           // Mp NB Tx BD already processed as the first item in this loop?
             break;                                                                       // Break the loop
         }
-        pDmaTxBD = &pAdapter->Tx_DmaBDT[EnetPendingBDIdx];                               // Get Dma Tx BD
+        EnetLastBDIdx = EnetPendingBDIdx + (LONG)pEnetSwExtBD->BDCount - 1;              // Get the last Dma Tx BD of the segment
+        if (EnetLastBDIdx >= pAdapter->Tx_DmaBDT_ItemCount)
+            EnetLastBDIdx -= pAdapter->Tx_DmaBDT_ItemCount;
+        pDmaTxBD = &pAdapter->Tx_DmaBDT[EnetLastBDIdx];                                  // Get Dma Tx BD
         if (pDmaTxBD->ControlStatus & ENET_TX_BD_R_MASK) {                               // Dma Tx BD owned by DMA engine?
             if (pAdapter->ENETRegBase->TDAR == 0) {                                      // DMA stopped? (ERR006358 bug fix)
                 pAdapter->ENETRegBase->TDAR = 0x0000000;                                 // Restart DMA
             }
             break;                                                                       // Break the loop
         }
-        pAdapter->Tx_EnetSwExtBDT[EnetPendingBDIdx].pMpBD = NULL;                        // Mark Mp NB Tx BD as "already processed"
+        pEnetSwExtBD->pMpBD = NULL;                                                      // Mark Mp NB Tx BD as "already processed"
+        CompletedFrames++;
+        EnetPendingBDIdx = EnetLastBDIdx;
         if (++EnetPendingBDIdx >= pAdapter->Tx_DmaBDT_ItemCount)                         // Updated ENET_BDT index
             EnetPendingBDIdx = 0;
-        pAdapter->Tx_EnetFreeBDCount ++;                                                 // Update Free ENET_TxBD counter
+        pAdapter->Tx_EnetFreeBDCount += (LONG)pEnetSwExtBD->BDCount;                     // Update Free ENET_TxBD counter
         pAdapter->Tx_EnetPendingBDIdx = EnetPendingBDIdx;                                // Update pending BD index
-        DBG_ENET_DEV_TX_PRINT_TRACE("NB(%d) 0x%08X done, adding it to the complete queue.", pMpTxBD->NBId, pMpTxBD->pNB);
-        (void)MpQueueGetNext(&pAdapter->Tx_qDmaOwnedBDs);           // Remove the TX BD from the 'in progress' queue
-        InsertHeadList(&completedNetBufferList, &pMpTxBD->Link);                         // Put BD to the completed BD queue
         pAdapter->Tx_CheckForHangCounter = 0;                                            // Restart "check for hang" counter
+        if (pEnetSwExtBD->LastSegment) {                                                 // All segments of the NB sent?
+            DBG_ENET_DEV_TX_PRINT_TRACE("NB(%d) 0x%08X done, adding it to the complete queue.", pMpTxBD->NBId, pMpTxBD->pNB);
+            (void)MpQueueGetNext(&pAdapter->Tx_qDmaOwnedBDs);       // Remove the TX BD from the 'in progress' queue
+            InsertHeadList(&completedNetBufferList, &pMpTxBD->Link);                     // Put BD to the completed BD queue
+        }
     } while (EnetPendingBDIdx != pAdapter->Tx_EnetFreeBDIdx);
     DBG_ENET_DEV_TX_PRINT_TRACE("**** ISR, Before release spin lock, Tx_EnetPendingBDIdx: %d, Tx_EnetFreeBDIdx: %d", pAdapter->Tx_EnetPendingBDIdx, pAdapter->Tx_EnetFreeBDIdx);
     NdisDprReleaseSpinLock(&pAdapter->Tx_SpinLock);
@@ -786,7 +1046,7 @@ void MpHandleTxInterrupt(PMP_ADAPTER pAdapter, UINT32 InterruptEvent)
     } // More completed TX frames
     MpSendNextNB(pAdapter);            // Send next waiting TX frames, if any...
     DBG_ENET_DEV_DPC_TX_METHOD_END();
-    return;
+    return CompletedFrames;
 }
 
 /*++
@@ -804,6 +1064,7 @@ VOID MpTxInit(PMP_ADAPTER pAdapter)
     pAdapter->Tx_EnetFreeBDCount     = pAdapter->Tx_DmaBDT_ItemCount;    // Initialize number of unused Ethernet Buffer Descriptors
     pAdapter->Tx_EnetFreeBDIdx       = 0;
     pAdapter->Tx_EnetPendingBDIdx    = 0;
+    pAdapter->Tx_pLsoMpBD            = NULL;
 
     pAdapter->TxdStatus.FramesXmitGood            = 0;
     pAdapter->TxdStatus.FramesXmitBad             = 0;
@@ -812,7 +1073,40 @@ VOID MpTxInit(PMP_ADAPTER pAdapter)
     pAdapter->TxdStatus.FramesXmitCollisionErrors = 0;
     pAdapter->TxdStatus.FramesXmitAbortedErrors   = 0;
     pAdapter->TxdStatus.FramsXmitCarrierErrors    = 0;
+    pAdapter->TxdStatus.FramesXmitCopied          = 0;
+    pAdapter->TxdStatus.FramesXmitZeroCopy        = 0;
+    pAdapter->TxdStatus.FramesXmitHeaderCopied    = 0;
+    pAdapter->TxdStatus.FramesXmitLso             = 0;
+    pAdapter->TxdStatus.FramesXmitLsoSegments     = 0;
+    pAdapter->TxdStatus.BytesXmitLso              = 0;
+    pAdapter->TxdStatus.TicksXmitLso              = 0;
     NdisZeroMemory((VOID*)pAdapter->Tx_DmaBDT, pAdapter->Tx_DmaBDT_Size);      // Zero TxBDT
+    for (LONG Idx = 0; Idx < pAdapter->Tx_DmaBDT_ItemCount; ++Idx) {           // No frame in TxBDT
+        pAdapter->Tx_EnetSwExtBDT[Idx].pMpBD = NULL;
+    }
+}
+
+/*++
+Routine Description:
+    Prints the LSOv2 statistics, segments per send and CPU time spent segmenting per MB sent.
+Arguments:
+    pAdapter     Pointer to adapter data
+Return Value:
+    None
+--*/
+_Use_decl_annotations_
+VOID MpTxPrintLsoStatistics(PMP_ADAPTER pAdapter)
+{
+    PFRAME_TXD_STATUS  pTxdStatus = &pAdapter->TxdStatus;
+    LARGE_INTEGER      Frequency;
+
+    if ((pTxdStatus->FramesXmitLso == 0) || (pTxdStatus->BytesXmitLso == 0)) {
+        return;
+    }
+    (void)KeQueryPerformanceCounter(&Frequency);
+    DBG_ENET_DEV_PRINT_INFO("LSOv2: %d sends, %d.%02d segments/send, %I64d us CPU/MB", pTxdStatus->FramesXmitLso,
+        pTxdStatus->FramesXmitLsoSegments / pTxdStatus->FramesXmitLso, (pTxdStatus->FramesXmitLsoSegments * 100 / pTxdStatus->FramesXmitLso) % 100,
+        (pTxdStatus->TicksXmitLso * 1000000 / Frequency.QuadPart) * 1048576 / pTxdStatus->BytesXmitLso);
 }
 
 /*++
@@ -829,21 +1123,29 @@ void MpRxInit(PMP_ADAPTER pAdapter)
     PENET_BD             pDmaBD = NULL;
 
     ASSERT(pAdapter->Rx_DmaBDT_ItemCount);                                                // There must be at least one Rx buffer
+    ASSERT(pAdapter->Rx_BufferCount >= pAdapter->Rx_DmaBDT_ItemCount);
     pAdapter->Rx_EnetFreeBDIdx           = 0;                                             // Initialize HW Dma buffer descriptor ring index
     pAdapter->Rx_EnetPendingBDIdx        = 0;                                             
     pAdapter->Rx_NBLCounter              = 0;
     pAdapter->Rx_NdisOwnedBDsCount       = 0;                                             // No buffer is owned by NDIS
     pAdapter->Rx_DmaBDT_DmaOwnedBDsCount = pAdapter->Rx_DmaBDT_ItemCount;                 // All Rx BDs are owned by ENET DMA
     NdisZeroMemory(&pAdapter->RcvStatus, sizeof(pAdapter->RcvStatus));
-    for (LONG Idx = 0; Idx < pAdapter->Rx_DmaBDT_ItemCount; ++Idx) {                      // For each DmaBD do:
+    NdisZeroMemory(&pAdapter->Rx_PoolStats, sizeof(pAdapter->Rx_PoolStats));
+    MpRxPoolInit(&pAdapter->Rx_Pool, pAdapter->Rx_PoolEntries, (ULONG)pAdapter->Rx_BufferCount);
+    MpRxPoolInit(&pAdapter->Rx_CopyPool, pAdapter->Rx_PoolEntries + pAdapter->Rx_BufferCount, (ULONG)pAdapter->Rx_CopyBufferCount);
+    for (LONG Idx = pAdapter->Rx_BufferCount + pAdapter->Rx_CopyBufferCount - 1; Idx >= 0; --Idx) {  // Put all buffers to the pools, the first ones on the top
         MP_RX_FRAME_BD *pRxFrameBD = &pAdapter->Rx_FrameBDT[Idx];
+        NET_BUFFER_LIST_NEXT_NBL(pRxFrameBD->pNBL) = NULL;                                // Not necessary consider removing
+        /* MS-temp */ NdisAdjustMdlLength(pRxFrameBD->pMdl, pRxFrameBD->BufferSize);
+        (void)MpRxPoolPut(pRxFrameBD->CopyBuffer ? &pAdapter->Rx_CopyPool : &pAdapter->Rx_Pool, pRxFrameBD);
+    }
+    for (LONG Idx = 0; Idx < pAdapter->Rx_DmaBDT_ItemCount; ++Idx) {                      // For each DmaBD do:
+        MP_RX_FRAME_BD *pRxFrameBD = (PMP_RX_FRAME_BD)MpRxPoolGet(&pAdapter->Rx_Pool);
         pDmaBD = &pAdapter->Rx_DmaBDT[Idx];                                               // Get DmaBD address
         pAdapter->Rx_DmaBDT_SwExt[Idx].pRxFrameBD = pRxFrameBD;                           // Create link between Rx frame descriptor and DmaBD
-        NET_BUFFER_LIST_NEXT_NBL(pRxFrameBD->pNBL) = NULL;                                // Not necessary consider removing
         NT_ASSERT(pRxFrameBD->BufferPa.HighPart == 0);
         pDmaBD->BufferAddress = pRxFrameBD->BufferPa.LowPart;                             // Fill DmaBD data buffer address
         pDmaBD->ControlStatus = ENET_RX_BD_E_MASK | ENET_RX_BD_L_MASK;                    // Fill DMaBD Status (Mark DmaBD as ready to receive data)
-        /* MS-temp */ NdisAdjustMdlLength(pRxFrameBD->pMdl, ENET_RX_FRAME_SIZE);
 #ifdef ENET_ENHANCED_BD
 		pDmaBD->EnhancedStatus |= ENET_RX_BD_ESTATUS_INT;
 #endif
@@ -853,6 +1155,116 @@ void MpRxInit(PMP_ADAPTER pAdapter)
     }
 }
 
+/*++
+Routine Description:
+    Refills the empty RX BDs with buffers from the pool. The BDs are refilled in batches, see MpRxPoolGetRefillCount(),
+    and the ENET DMA gets the first refilled BD only after all the others are ready.
+    Called with Rx_SpinLock held.
+Arguments:
+    pAdapter    Pointer to adapter data
+Return Value:
+    None
+--*/
+_Use_decl_annotations_
+void MpRxRefill(PMP_ADAPTER pAdapter)
+{
+    PENET_BD          pCurrentDmaBD;
+    PENET_BD          pFirstDmaBD = NULL;
+    USHORT            CurrentControlStatus, FirstControlStatus = 0;
+    LONG              Rx_EnetFreeBDIdx = pAdapter->Rx_EnetFreeBDIdx;
+    ULONG             RefillCount;
+
+    if (!pAdapter->EnetStarted) {                                               // The ring is rebuilt by MpRxInit()
+        return;
+    }
+    RefillCount = MpRxPoolGetRefillCount(&pAdapter->Rx_Pool, (ULONG)(pAdapter->Rx_DmaBDT_ItemCount - pAdapter->Rx_DmaBDT_DmaOwnedBDsCount),
+        (ULONG)pAdapter->Rx_DmaBDT_DmaOwnedBDsCount, (ULONG)pAdapter->Rx_DmaBDT_DmaOwnedBDsLowWatterMark, pAdapter->Rx_RefillBatch);
+    if (RefillCount == 0) {
+        return;
+    }
+    for (ULONG Idx = 0; Idx < RefillCount; ++Idx) {
+        PMP_RX_FRAME_BD pRxFrameBD = (PMP_RX_FRAME_BD)MpRxPoolGet(&pAdapter->Rx_Pool);
+        ASSERT(pRxFrameBD != NULL);
+        ASSERT(!pAdapter->Rx_DmaBDT_SwExt[Rx_EnetFreeBDIdx].pRxFrameBD);
+        pAdapter->Rx_DmaBDT_SwExt[Rx_EnetFreeBDIdx].pRxFrameBD = pRxFrameBD;    // Association current Frame BD and the first free Dma BD
+        pCurrentDmaBD                = &pAdapter->Rx_DmaBDT[Rx_EnetFreeBDIdx];  // Get address of the first free Dma BD
+        NT_ASSERT(pRxFrameBD->BufferPa.HighPart == 0);
+        pCurrentDmaBD->BufferAddress = pRxFrameBD->BufferPa.LowPart;            // Fill Dma BD data buffer address
+        CurrentControlStatus = ENET_RX_BD_E_MASK;                               // Set EMPTY bit
+        CurrentControlStatus |= ENET_RX_BD_L_MASK;                              // Set LAST bit
+        if (++Rx_EnetFreeBDIdx == pAdapter->Rx_DmaBDT_ItemCount) {              // Compute next Rx_EnetFreeBDIdx
+            Rx_EnetFreeBDIdx = 0;
+            CurrentControlStatus |= ENET_RX_BD_W_MASK;                          // Set WRAP bit in the last Dma BD
+        }
+        if (pFirstDmaBD == NULL) {                                              // For the first refilled BD do not set Dma BD control and status word now, do it as the last step
+            pFirstDmaBD = pCurrentDmaBD;                                        // Remember the first free Dma BD address
+            FirstControlStatus = CurrentControlStatus;                          // Remember Dma BD control and status word for the first free Dma BD
+        } else {
+            pCurrentDmaBD->ControlStatus = CurrentControlStatus;                // Fill Dma BD control and status word
+        }
+    }
+    pAdapter->Rx_EnetFreeBDIdx = Rx_EnetFreeBDIdx;                              // Update Rx_EnetFreeBDIdx
+    pAdapter->Rx_DmaBDT_DmaOwnedBDsCount += (LONG)RefillCount;                  // Increment counter of Rx BDs owned by ENET DMA.
+    pAdapter->Rx_PoolStats.Refills++;
+    pAdapter->Rx_PoolStats.RefilledBDs += RefillCount;
+    DBG_ENET_DEV_RX_PRINT_TRACE("%d BDs refilled, DmaBD ready: %4d, free buffers: %d", RefillCount, pAdapter->Rx_DmaBDT_DmaOwnedBDsCount, pAdapter->Rx_Pool.Count);
+    pFirstDmaBD->ControlStatus = FirstControlStatus;                            // Mark first Dma BD as empty = ready to receive data
+    _DataSynchronizationBarrier();                                              // Wait until write is finished
+    FirstControlStatus = pFirstDmaBD->ControlStatus;                            // Read ControlStatus back
+    if (pAdapter->ENETRegBase->RDAR == 0) {                                     // Receive in progress?
+        if (pFirstDmaBD->ControlStatus & ENET_RX_BD_E_MASK) {                   // No, Transfer not started yet?
+            DBG_ENET_DEV_RX_PRINT_TRACE("Starting transfer. RDAR: 0x%08X, EIR: 0x%08X", pAdapter->ENETRegBase->RDAR, pAdapter->ENETRegBase->EIR.U);
+            pAdapter->ENETRegBase->RDAR = 0x00000000;                           // No, start transfer
+        }
+    }
+}
+
+/*++
+Routine Description:
+    Fills the RX buffer pool statistics.
+Arguments:
+    pAdapter    Pointer to adapter data
+    pStats      The statistics
+Return Value:
+    None
+--*/
+_Use_decl_annotations_
+void MpRxGetPoolStatistics(PMP_ADAPTER pAdapter, PMP_RX_POOL_STATISTICS pStats)
+{
+    NdisAcquireSpinLock(&pAdapter->Rx_SpinLock);
+    *pStats = pAdapter->Rx_PoolStats;
+    pStats->Buffers         = (ULONG)pAdapter->Rx_BufferCount;
+    pStats->FreeBuffers     = pAdapter->Rx_Pool.Count;
+    pStats->MinFreeBuffers  = pAdapter->Rx_Pool.MinCount;
+    pStats->CopyBuffers     = (ULONG)pAdapter->Rx_CopyBufferCount;
+    pStats->FreeCopyBuffers = pAdapter->Rx_CopyPool.Count;
+    pStats->CopyBreak       = pAdapter->Rx_CopyBreak;
+    pStats->RefillShortages = pAdapter->Rx_Pool.Shortages;
+    pStats->DroppedFrames   = pAdapter->ENETRegBase->IEEE_R_MACERR;
+    NdisReleaseSpinLock(&pAdapter->Rx_SpinLock);
+}
+
+/*++
+Routine Description:
+    Prints the RX buffer pool statistics, copied frames, refills and the frames dropped for lack of a BD.
+Arguments:
+    pAdapter     Pointer to adapter data
+Return Value:
+    None
+--*/
+_Use_decl_annotations_
+VOID MpRxPrintPoolStatistics(PMP_ADAPTER pAdapter)
+{
+    PMP_RX_POOL_STATISTICS pStats = &pAdapter->Rx_PoolStats;
+
+    if (pStats->Refills == 0) {
+        return;
+    }
+    DBG_ENET_DEV_PRINT_INFO("RX pool: %d buffers, min. %d free, %I64d copied, %I64d copy pool empty, %I64d refills (%I64d BDs, %I64d short), %I64d ring empty",
+        pAdapter->Rx_BufferCount, pAdapter->Rx_Pool.MinCount, pStats->FramesCopied, pStats->CopyPoolEmpty, pStats->Refills, pStats->RefilledBDs,
+        pAdapter->Rx_Pool.Shortages, pStats->RingEmpty);
+}
+
 /*++
 Routine Description:
     Returns TRUE if ndis owns at lease one RX buffer.
@@ -891,59 +1303,22 @@ void MpReturnNetBufferLists(NDIS_HANDLE MiniportAdapterContext, PNET_BUFFER_LIST
     PMP_ADAPTER       pAdapter = (PMP_ADAPTER)MiniportAdapterContext;
     PNET_BUFFER_LIST  pNextNBL;
     PMP_RX_FRAME_BD   pRxFrameBD;
-    PENET_BD          pCurrentDmaBD;
-    PENET_BD          pFirstDmaBD = NULL;
-    USHORT            CurrentControlStatus, FirtsControlStatus = 0;
-    LONG              Rx_EnetFreeBDIdx;
 
     UNREFERENCED_PARAMETER(ReturnFlags);
     DBG_ENET_DEV_RX_METHOD_BEG();
     NdisAcquireSpinLock(&pAdapter->Rx_SpinLock);
-    Rx_EnetFreeBDIdx = pAdapter->Rx_EnetFreeBDIdx;
-    // Mark all returned frames as active, so adapter DMA can use them for future RX frames.
+    // Put all returned buffers back to the pools, the empty BDs are refilled from there.
     ASSERT(pNBL);
     for (PNET_BUFFER_LIST pCurrentNBL = pNBL; pCurrentNBL != NULL; pCurrentNBL = pNextNBL) {
         pNextNBL = NET_BUFFER_LIST_NEXT_NBL(pCurrentNBL);
+        NET_BUFFER_LIST_NEXT_NBL(pCurrentNBL) = NULL;
         pRxFrameBD = MP_NBL_RX_FRAME_BD(pCurrentNBL);                               // Get Frame BD address from the current NBL.
-        /* MS-temp */ NdisAdjustMdlLength(pRxFrameBD->pMdl, ENET_RX_FRAME_SIZE);
-        pAdapter->Rx_DmaBDT_DmaOwnedBDsCount++;                                     // Increment counter of Rx BDs owned by ENET DMA.
+        /* MS-temp */ NdisAdjustMdlLength(pRxFrameBD->pMdl, pRxFrameBD->BufferSize);
         pAdapter->Rx_NdisOwnedBDsCount--;
-        if (!pAdapter->EnetStarted) {
-            continue;
-        }
-        ASSERT(!pAdapter->Rx_DmaBDT_SwExt[Rx_EnetFreeBDIdx].pRxFrameBD);
-        /* Reuse frame descriptor */
-        pAdapter->Rx_DmaBDT_SwExt[Rx_EnetFreeBDIdx].pRxFrameBD = pRxFrameBD;    // Association current Frame BD and the first free Dma BD
-        DBG_ENET_DEV_RX_PRINT_TRACE("NBL(%4d, 0x%08X) returned,       DmaIdx: %4d, NewDmaIdx: %4d DmaBD ready: %4d, PhyAddr: 0x%08X", MP_NBL_ID(pCurrentNBL), pCurrentNBL, MP_NB_DmaIdx(pCurrentNBL->FirstNetBuffer), Rx_EnetFreeBDIdx, pAdapter->Rx_DmaBDT_DmaOwnedBDsCount, pRxFrameBD->BufferPa.LowPart);
-        pCurrentDmaBD                = &pAdapter->Rx_DmaBDT[Rx_EnetFreeBDIdx];  // Get address of the first free Dma BD
-        NT_ASSERT(pRxFrameBD->BufferPa.HighPart == 0);
-        pCurrentDmaBD->BufferAddress = pRxFrameBD->BufferPa.LowPart;            // Fill Dma BD data buffer address
-        CurrentControlStatus = ENET_RX_BD_E_MASK;                               // Set EMPTY bit
-        CurrentControlStatus |= ENET_RX_BD_L_MASK;                              // Set LAST bit
-        if (++Rx_EnetFreeBDIdx == pAdapter->Rx_DmaBDT_ItemCount) {              // Compute next Rx_EnetFreeBDIdx
-            Rx_EnetFreeBDIdx = 0;
-            CurrentControlStatus |= ENET_RX_BD_W_MASK;                          // Set WRAP bit in the last Dma BD
-        }
-        if (pFirstDmaBD == NULL) {                                              // For the first returned BD do not set Dma BD control and status word now, do it as the last step
-            pFirstDmaBD = pCurrentDmaBD;                                        // Remember the first free Dma BD address
-            FirtsControlStatus = CurrentControlStatus;                          // Remember Dma BD control and status word for the first free Dma BD
-        } else {
-            pCurrentDmaBD->ControlStatus = CurrentControlStatus;                // Fill Dma BD control and status word
-        }
-    } // More free buffers
-    pAdapter->Rx_EnetFreeBDIdx = Rx_EnetFreeBDIdx;                              // Update Rx_EnetFreeBDIdx
-    if (pFirstDmaBD != NULL) {
-        pFirstDmaBD->ControlStatus = FirtsControlStatus;                        // Mark first Dma BD as empty = ready to receive data
-        _DataSynchronizationBarrier();                                          // Wait until write is finished
-        FirtsControlStatus = pFirstDmaBD->ControlStatus;                        // Read ControlStatus back
-        DBG_ENET_DEV_RX_PRINT_TRACE("NBL(%4d): Added to ENET_BD.",MP_NBL_ID(pNBL));
-        if (pAdapter->ENETRegBase->RDAR == 0) {                                 // Receive in progress?
-            if (pFirstDmaBD->ControlStatus & ENET_RX_BD_E_MASK) {               // No, Transfer not started yet?
-                DBG_ENET_DEV_RX_PRINT_TRACE("NBL(%4d): Starting transfer. TDAR: 0x%08X, EIR: 0x%08X", MP_NBL_ID(pNBL), pAdapter->ENETRegBase->RDAR, pAdapter->ENETRegBase->EIR.U);
-                pAdapter->ENETRegBase->RDAR = 0x00000000;                       // No, start transfer
-            }
-        }
+        DBG_ENET_DEV_RX_PRINT_TRACE("NBL(%4d, 0x%08X) returned,       DmaIdx: %4d, copy-break: %d", MP_NBL_ID(pCurrentNBL), pCurrentNBL, MP_NB_DmaIdx(pCurrentNBL->FirstNetBuffer), pRxFrameBD->CopyBuffer);
+        (void)MpRxPoolPut(pRxFrameBD->CopyBuffer ? &pAdapter->Rx_CopyPool : &pAdapter->Rx_Pool, pRxFrameBD);
     }
+    MpRxRefill(pAdapter);
     NdisReleaseSpinLock(&pAdapter->Rx_SpinLock);
     DBG_ENET_DEV_RX_METHOD_END();
 }
@@ -957,18 +1332,17 @@ Arguments:
     pAdapter
         Pointer to the adapter structure.
     pMaxNBLsToIndicate
-        A pointer to the maximal number of RX frames we indicate to NDIS
+        A pointer to the maximal number of RX frames we indicate to NDIS, the NDIS throttle limited to the poll budget
     pRecvThrottleParameters
         A pointer to an NDIS_RECEIVE_THROTTLE_PARAMETERS structure. This structure specifies
         the maximum number of NET_BUFFER_LIST structures that a miniport driver should indicate in a DPC.
 Return Value:
-    None
+    Number of RX frames handled, including the frames received with error
 --*/
 _Use_decl_annotations_
-void MpHandleRecvInterrupt(PMP_ADAPTER pAdapter, PULONG pMaxNBLsToIndicate, PNDIS_RECEIVE_THROTTLE_PARAMETERS pRecvThrottleParameters)
+ULONG MpHandleRecvInterrupt(PMP_ADAPTER pAdapter, PULONG pMaxNBLsToIndicate, PNDIS_RECEIVE_THROTTLE_PARAMETERS pRecvThrottleParameters)
 {
     PNET_BUFFER_LIST *ppNBLTail;
-    PNET_BUFFER_LIST pErrorNBLHead     = NULL;
     ULONG            ErrorNBLItemCount = 0;
     PNET_BUFFER_LIST pAsyncNBLHead     = NULL;
     PNET_BUFFER_LIST pAsyncNBLTail     = NULL;
@@ -984,7 +1358,7 @@ void MpHandleRecvInterrupt(PMP_ADAPTER pAdapter, PULONG pMaxNBLsToIndicate, PNDI
     if (pAdapter->NdisStatus != NDIS_STATUS_SUCCESS) {                        // Mp ready to indicate Rx packets?
        NdisDprReleaseSpinLock(&pAdapter->Rx_SpinLock);                        // No, do nothing
        DBG_ENET_DEV_DPC_RX_METHOD_END();
-       return;
+       return 0;
     }
     Rx_EnetPendingBDIdx = pAdapter->Rx_EnetPendingBDIdx;
     for (LONG Idx = 0; Idx < pAdapter->Rx_DmaBDT_ItemCount; ++Idx) {          // One call of MpHandleRecvInterrupt() will indicate up to pAdapter->Rx_DmaBDT_ItemCount NBLs
@@ -996,8 +1370,8 @@ void MpHandleRecvInterrupt(PMP_ADAPTER pAdapter, PULONG pMaxNBLsToIndicate, PNDI
             break;
         }
         if ((*pMaxNBLsToIndicate) == 0) {                                     // Did we reach the max number of RX frames we are allowed to indicate to NDIS?
-            DBG_ENET_DEV_PRINT_WARNING("NDIS RX frame throttle applied %d RX frames will be indicated", AsyncNBLItemCount + SyncNBLItemCount);
-            pRecvThrottleParameters->MoreNblsPending = TRUE;                  // No, inform NDIS about it
+            DBG_ENET_DEV_RX_PRINT_TRACE("NDIS RX frame throttle or poll budget applied %d RX frames will be indicated", AsyncNBLItemCount + SyncNBLItemCount);
+            pRecvThrottleParameters->MoreNblsPending = TRUE;                  // Yes, NDIS calls the DPC again with the interrupts still masked
             break;
         }
         pAdapter->Rx_DmaBDT_DmaOwnedBDsCount--;                                                    // Decrement counter of Rx BDs owned by ENET DMA
@@ -1051,9 +1425,7 @@ void MpHandleRecvInterrupt(PMP_ADAPTER pAdapter, PULONG pMaxNBLsToIndicate, PNDI
 
         // Is this packet completed and has error bits set?
         if (pDmaBD->ControlStatus & (ENET_RX_BD_TR_MASK | ENET_RX_BD_OV_MASK | ENET_RX_BD_NO_MASK | ENET_RX_BD_CR_MASK)) {
-            /* MS-temp */ NdisAdjustMdlLength(pRxFrameBD->pMdl, ENET_RX_FRAME_SIZE);
-            NET_BUFFER_LIST_NEXT_NBL(pCurrentNBL) = pErrorNBLHead;        // Append this NBL to the had of the error NBL list
-            pErrorNBLHead = pCurrentNBL;
+            (void)MpRxPoolPut(&pAdapter->Rx_Pool, pRxFrameBD);           // Put the buffer back to the pool
             pAdapter->RcvStatus.FrameRcvErrors++;
             ErrorNBLItemCount++;
             if (pDmaBD->ControlStatus & ENET_RX_BD_TR_MASK) {             // Truncated frame?
@@ -1075,10 +1447,28 @@ void MpHandleRecvInterrupt(PMP_ADAPTER pAdapter, PULONG pMaxNBLsToIndicate, PNDI
         } else {
             (*pMaxNBLsToIndicate)--;                                                   // Decrement MaxNBLsToIndicate counter
             NdisFlushBuffer(pRxFrameBD->pMdl, FALSE);                                  // Flush Rx buffer
-            /* MS-temp */NdisAdjustMdlLength(pRxFrameBD->pMdl, realFrameLength + 2);   // Update real length in MDL
             DBG_ENET_DEV_RX_PRINT_TRACE(" NBL(%4d) data received, DmaIdx: %4d, DmaOwnedBDs: %4d:, Size: %d, PhyAddr: 0x%08X", MP_NBL_ID(pCurrentNBL), Rx_EnetPendingBDIdx, pAdapter->Rx_DmaBDT_DmaOwnedBDsCount, realFrameLength, pRxFrameBD->BufferPa.LowPart);
+            if (realFrameLength <= pAdapter->Rx_CopyBreak) {                           // Short frame, copy it and put the DMA buffer back to the pool
+                PMP_RX_FRAME_BD pCopyFrameBD = (PMP_RX_FRAME_BD)MpRxPoolGet(&pAdapter->Rx_CopyPool);
+                if (pCopyFrameBD != NULL) {
+                    NdisMoveMemory(pCopyFrameBD->pBuffer, pRxFrameBD->pBuffer, realFrameLength + 2);
+                    (void)MpRxPoolPut(&pAdapter->Rx_Pool, pRxFrameBD);
+                    #if DBG
+                    MP_NBL_SET_ID(pCopyFrameBD->pNBL, MP_NBL_ID(pCurrentNBL));
+                    MP_NB_SET_DmaIdx(pCopyFrameBD->pNBL->FirstNetBuffer, Rx_EnetPendingBDIdx);
+                    #endif
+                    pRxFrameBD  = pCopyFrameBD;
+                    pCurrentNBL = pCopyFrameBD->pNBL;
+                    NET_BUFFER_DATA_LENGTH(pCurrentNBL->FirstNetBuffer) = realFrameLength;
+                    pAdapter->Rx_PoolStats.FramesCopied++;
+                } else {
+                    pAdapter->Rx_PoolStats.CopyPoolEmpty++;                            // All copy-break buffers are owned by NDIS, indicate the DMA buffer
+                }
+            }
+            /* MS-temp */NdisAdjustMdlLength(pRxFrameBD->pMdl, realFrameLength + 2);   // Update real length in MDL
             // Decide how we are going to indicate the RX buffer to NDIS. If we are running low on RX buffers, we will do in synchronously, otherwise we do it asynchronously.
-            if (pAdapter->Rx_DmaBDT_DmaOwnedBDsCount <= pAdapter->Rx_DmaBDT_DmaOwnedBDsLowWatterMark) {
+            // Copy-break buffers do not hold a DMA buffer, they are always indicated asynchronously.
+            if (!pRxFrameBD->CopyBuffer && ((ULONG)pAdapter->Rx_DmaBDT_DmaOwnedBDsCount + pAdapter->Rx_Pool.Count <= (ULONG)pAdapter->Rx_DmaBDT_DmaOwnedBDsLowWatterMark)) {
                 ppNBLTail = &pSyncNBLTail;                            // Low RX buffers level, use synchronous RX buffer indication
                 if (pSyncNBLTail == NULL) {                           // Synchronous NBL list empty?
                     pSyncNBLHead = pCurrentNBL;                       // Current NBL is the first item of the Synchronous NBL list
@@ -1105,12 +1495,12 @@ void MpHandleRecvInterrupt(PMP_ADAPTER pAdapter, PULONG pMaxNBLsToIndicate, PNDI
         }
     } // More RFDs
     pAdapter->Rx_EnetPendingBDIdx = Rx_EnetPendingBDIdx;              // Update Ethernet Dma Rx empty buffer index
-    pAdapter->Rx_NdisOwnedBDsCount += AsyncNBLItemCount + SyncNBLItemCount + ErrorNBLItemCount;
-    NdisDprReleaseSpinLock(&pAdapter->Rx_SpinLock);
-    if (pErrorNBLHead) {
-        DBG_ENET_DEV_RX_PRINT_ERROR(" NBL(%4d) received with error, returning back", MP_NBL_ID(pErrorNBLHead));
-        MpReturnNetBufferLists(pAdapter, pErrorNBLHead, 0);
+    pAdapter->Rx_NdisOwnedBDsCount += AsyncNBLItemCount + SyncNBLItemCount;
+    if (pAdapter->Rx_DmaBDT_DmaOwnedBDsCount == 0) {                  // No BD left to the ENET DMA, the next frames are dropped until the ring is refilled
+        pAdapter->Rx_PoolStats.RingEmpty++;
     }
+    MpRxRefill(pAdapter);                                             // Refill the BDs of the frames indicated, copied or received with error
+    NdisDprReleaseSpinLock(&pAdapter->Rx_SpinLock);
     // Indicate received RX frames to NDIS, if any...
     if (pAsyncNBLHead) {    // Asynchronous list not empty?
         NdisMIndicateReceiveNetBufferLists(pAdapter->AdapterHandle, pAsyncNBLHead, NDIS_DEFAULT_PORT_NUMBER, AsyncNBLItemCount, NDIS_RECEIVE_FLAGS_DISPATCH_LEVEL);
@@ -1122,5 +1512,5 @@ void MpHandleRecvInterrupt(PMP_ADAPTER pAdapter, PULONG pMaxNBLsToIndicate, PNDI
         MpReturnNetBufferLists(pAdapter, pSyncNBLHead, 0);
     } // Sync list
     DBG_ENET_DEV_DPC_RX_METHOD_END();
-    return;
+    return AsyncNBLItemCount + SyncNBLItemCount + ErrorNBLItemCount;
 }
@@ -79,11 +79,17 @@ void MpQueueAdd(_In_ PMP_QUEUE QueuePtr, PLIST_ENTRY ListEntryPtr);
 _IRQL_requires_max_(DISPATCH_LEVEL)
 LONG MpQueueGetDepth(PMP_QUEUE pQueue);
 _IRQL_requires_max_(DISPATCH_LEVEL)
-void MpHandleTxInterrupt(_In_ PMP_ADAPTER pAdapter, _In_ UINT32 InterruptEvent);
+ULONG MpHandleTxInterrupt(_In_ PMP_ADAPTER pAdapter, _In_ UINT32 InterruptEvent);
 _IRQL_requires_max_(DISPATCH_LEVEL)
-void MpHandleRecvInterrupt(_In_ PMP_ADAPTER pAdapter, _Inout_ PULONG pMaxNBLsToIndicate, _Inout_ PNDIS_RECEIVE_THROTTLE_PARAMETERS pRecvThrottleParameters);
+ULONG MpHandleRecvInterrupt(_In_ PMP_ADAPTER pAdapter, _Inout_ PULONG pMaxNBLsToIndicate, _Inout_ PNDIS_RECEIVE_THROTTLE_PARAMETERS pRecvThrottleParameters);
 void MpTxInit(_In_ PMP_ADAPTER pAdapter);
+VOID MpTxPrintLsoStatistics(_In_ PMP_ADAPTER pAdapter);
 void MpRxInit(_In_ PMP_ADAPTER pAdapter);
+_IRQL_requires_(DISPATCH_LEVEL)
+void MpRxRefill(_In_ PMP_ADAPTER pAdapter);
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void MpRxGetPoolStatistics(_In_ PMP_ADAPTER pAdapter, _Out_ PMP_RX_POOL_STATISTICS pStats);
+VOID MpRxPrintPoolStatistics(_In_ PMP_ADAPTER pAdapter);
 BOOLEAN IsRxFramePandingInNdis(_In_ PMP_ADAPTER pAdapter);
 
 #endif // _MP_DATA_PATH_H
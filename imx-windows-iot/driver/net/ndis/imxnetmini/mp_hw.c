@@ -123,9 +123,28 @@ void ClearAllMultiCast(PMP_ADAPTER pAdapter)
     pAdapter->ENETRegBase->GALR = 0;
 }
 
+/*++
+Routine Description:
+    Converts performance counter ticks to microseconds.
+Arguments:
+    pAdapter    Pointer to adapter data
+    Ticks       Performance counter ticks
+Return Value:
+    Microseconds
+--*/
+static ULONG64 EnetTicksToUs(_In_ PMP_ADAPTER pAdapter, _In_ LONGLONG Ticks)
+{
+    ULONG64 Frequency = (ULONG64)pAdapter->IntMod_QpcFrequency.QuadPart;
+
+    return ((ULONG64)Ticks / Frequency) * 1000000U + ((ULONG64)Ticks % Frequency) * 1000000U / Frequency;
+}
+
 /*++
 Routine Description:
     MiniportHandleInterrupt handler
+    Polls the Rx and Tx BD rings with the ENET interrupts masked. At most pAdapter->RxPollBudget Rx frames are indicated
+    in one call, if more are waiting NDIS calls the DPC again and the interrupts stay masked. The interrupts are enabled
+    once the rings are empty, the interrupt moderation controller then gets the frames handled since the ISR.
 Arguments:
     MiniportInterruptContext
         Pointer to the interrupt context. In this is a pointer to the adapter structure.
@@ -146,17 +165,20 @@ VOID EnetDpc(NDIS_HANDLE  MiniportInterruptContext, PVOID MiniportDpcContext, PV
     UINT32                             InterruptEvent, InterruptFlags;
     PNDIS_RECEIVE_THROTTLE_PARAMETERS  pRecvThrottleParameters = (PNDIS_RECEIVE_THROTTLE_PARAMETERS)ReceiveThrottleParameters;
     ULONG                              MaxNBLsToIndicate;
+    ULONG                              HandledFrames = 0;
+    ULONG64                            Latency_us;
+    LONGLONG                           Now;
 
     UNREFERENCED_PARAMETER(MiniportDpcContext);
     UNREFERENCED_PARAMETER(NdisReserved2);
 
     DBG_ENET_DEV_DPC_METHOD_BEG();
     MaxNBLsToIndicate = pRecvThrottleParameters->MaxNblsToIndicate;
-    if (MaxNBLsToIndicate == NDIS_INDICATE_ALL_NBLS) {
-        MaxNBLsToIndicate = MAXULONG;
+    if (MaxNBLsToIndicate > pAdapter->RxPollBudget) {                   // NDIS_INDICATE_ALL_NBLS or more than the poll budget?
+        MaxNBLsToIndicate = pAdapter->RxPollBudget;                     // Yes, the rest is indicated in the next DPC call
     }
     pRecvThrottleParameters->MoreNblsPending = FALSE;
-    do {
+    for (ULONG PollRound = 0; PollRound < ENET_DPC_MAX_POLL_ROUNDS; ++PollRound) {   // Read the interrupt flags again while new events keep coming
         NdisDprAcquireSpinLock(&pAdapter->Dev_SpinLock);
         pAdapter->DpcQueued          = FALSE;
         pAdapter->DpcRunning         = TRUE;
@@ -173,10 +195,10 @@ VOID EnetDpc(NDIS_HANDLE  MiniportInterruptContext, PVOID MiniportDpcContext, PV
             return;
         }
         if (InterruptEvent & ENET_TX_INT_MASK) {                        // Handle frame(s) sent or sent error interrupt
-            MpHandleTxInterrupt(pAdapter, InterruptEvent);
+            HandledFrames += MpHandleTxInterrupt(pAdapter, InterruptEvent);
         }
         if (InterruptEvent & ENET_RX_INT_MASK) {                        // Handle frame(s) received or receive error interrupt
-            MpHandleRecvInterrupt(pAdapter, &MaxNBLsToIndicate, pRecvThrottleParameters);
+            HandledFrames += MpHandleRecvInterrupt(pAdapter, &MaxNBLsToIndicate, pRecvThrottleParameters);
             if (pRecvThrottleParameters->MoreNblsPending) {
                 NdisDprAcquireSpinLock(&pAdapter->Dev_SpinLock);
                 pAdapter->InterruptFlags |= (InterruptEvent & ENET_RX_INT_MASK); // We have to prepare interrupt flags for NDIS called EnetDPC
@@ -187,7 +209,20 @@ VOID EnetDpc(NDIS_HANDLE  MiniportInterruptContext, PVOID MiniportDpcContext, PV
         if (InterruptEvent & ENET_EIR_GRA_MASK) {                       // Restart Tx path after pause frame transmit
             pAdapter->ENETRegBase->TDAR = 0x0000000;
         }
-    } while (0);
+    }
+    NdisDprAcquireSpinLock(&pAdapter->Dev_SpinLock);
+    pAdapter->IntMod_PollPackets += HandledFrames;
+    if (pRecvThrottleParameters->MoreNblsPending) {                     // Poll budget used up, interrupts stay masked
+        pAdapter->IntMod.Stats.Polls++;
+    } else {                                                            // Poll done, account it before the interrupts are enabled
+        Now = KeQueryPerformanceCounter(NULL).QuadPart;
+        Latency_us = EnetTicksToUs(pAdapter, Now - pAdapter->IntMod_IsrTimestamp);
+        if (MpIntModUpdate(&pAdapter->IntMod, pAdapter->IntMod_PollPackets, (Latency_us > MAXULONG) ? MAXULONG : (ULONG)Latency_us, EnetTicksToUs(pAdapter, Now))) {
+            EnetSetInterruptCoalescing(pAdapter);                       // New packet rate level
+        }
+        pAdapter->IntMod_PollPackets = 0;
+    }
+    NdisDprReleaseSpinLock(&pAdapter->Dev_SpinLock);
     if (!pRecvThrottleParameters->MoreNblsPending) {
       NdisMSynchronizeWithInterruptEx(pAdapter->NdisInterruptHandle, 0, EnetEnableRxAndTxInterrupts, pAdapter);
     }
@@ -218,6 +253,7 @@ BOOLEAN EnetIsr(NDIS_HANDLE MiniportInterruptContext, PBOOLEAN QueueDefaultInter
     if (pAdapter->ENETRegBase->EIMR.U != 0U) {
         pAdapter->ENETRegBase->EIMR.U = 0x00;     // Disable all ENET interrupts. (EnetIsr will not be called again until interrupts are enabled in EnetDpc)
         pAdapter->DpcQueued = TRUE;               // Remember that EnetDpc is queued
+        pAdapter->IntMod_IsrTimestamp = KeQueryPerformanceCounter(NULL).QuadPart;  // Start of the poll, for the latency histogram
         *QueueDefaultInterruptDpc = TRUE;         // Schedule EnetDpc on the current CPU to complete the operation
         __analysis_assume(*TargetProcessors = 0); // If QueueDefaultInterruptDpc value is set to TRUE, NDIS ignores the value of the TargetProcessors parameter. Suppress analyser warning "Returning uninitialized memory". 
     } else {
@@ -290,6 +326,8 @@ void EnetStop(PMP_ADAPTER pAdapter, NDIS_STATUS NdisStatus)
     while (ENETRegBase->ECR.U & ENET_ECR_ETHER_EN_MASK);  // Wait until Enet MAC is disabled
     pAdapter->NdisStatus = NdisStatus;                    // Remember new NDIS status
     pAdapter->EnetStarted = FALSE;                        // Remember new Enet state
+    MpTxPrintLsoStatistics(pAdapter);                     // LSOv2 statistics since EnetStart()
+    MpRxPrintPoolStatistics(pAdapter);                    // RX buffer pool statistics since EnetStart()
     DBG_SM_PRINT_TRACE("ENET stopped, status: %s, releasing all spinlocks", Dbg_GetNdisStatusName(NdisStatus));
     NdisReleaseSpinLock(&pAdapter->Tx_SpinLock);
     NdisReleaseSpinLock(&pAdapter->Rx_SpinLock);
@@ -317,6 +355,10 @@ void EnetStart(PMP_ADAPTER pAdapter)
     MpTxInit(pAdapter);                                                        // Initialize Tx data structures
     MpRxInit(pAdapter);                                                        // Initialize Rx data structures
     NdisZeroMemory(&pAdapter->StatisticsAcc, sizeof(pAdapter->StatisticsAcc)); // Reset accumulated values of HW statistic counters
+    (void)KeQueryPerformanceCounter(&pAdapter->IntMod_QpcFrequency);
+    MpIntModInit(&pAdapter->IntMod, pAdapter->InterruptModeration == IntModerationEnabled, EnetTicksToUs(pAdapter, KeQueryPerformanceCounter(NULL).QuadPart));
+    pAdapter->IntMod_PollPackets = 0;
+    EnetSetInterruptCoalescing(pAdapter);                                      // Interrupt per frame until the packet rate is known
     pAdapter->EnetStarted = TRUE;                                              // Remember new Enet state
     pAdapter->NdisStatus = NDIS_STATUS_SUCCESS;                                // Remember new NDIS status
     pAdapter->InterruptFlags = 0;                                              // No interrupt flags pending from previous call of DPC
@@ -441,6 +483,7 @@ _Use_decl_annotations_
 void EnetOnLinkStateChanged(MP_PHY_DEVICE *pPHYDev) {
     MP_ADAPTER*              pEnetAdapter = pPHYDev->PHYDev_pEnetAdapter;
     IMX_MII_LINK_STATE_t     LinkState = pPHYDev->PHYDev_LinkState;
+    ULONG                    Clock_kHz;
 
     DBG_PHY_DEV_METHOD_BEG();
     if (IMX_MII_LINK_STATE_SPEED_MHZ_GET(LinkState.R) == 1000) {
@@ -460,5 +503,41 @@ void EnetOnLinkStateChanged(MP_PHY_DEVICE *pPHYDev) {
         pEnetAdapter->ENETRegBase->RCR.U &= ~ENET_RCR_DRT_MASK;
         pEnetAdapter->ENETRegBase->TCR.U |= ENET_TCR_FEDN_MASK;
     }
+    switch (IMX_MII_LINK_STATE_SPEED_MHZ_GET(LinkState.R)) {          // The coalescing timer runs on the MII/GMII TX clock
+        case SPEED_1000MBPS: Clock_kHz = 125000; break;
+        case SPEED_100MBPS:  Clock_kHz = 25000;  break;
+        case SPEED_10MBPS:   Clock_kHz = 2500;   break;
+        default:             Clock_kHz = 0;      break;
+    }
+    NdisAcquireSpinLock(&pEnetAdapter->Dev_SpinLock);
+    pEnetAdapter->IntMod_Clock_kHz = Clock_kHz;
+    EnetSetInterruptCoalescing(pEnetAdapter);
+    NdisReleaseSpinLock(&pEnetAdapter->Dev_SpinLock);
     DBG_PHY_DEV_METHOD_END();
 }
+
+/*++
+Routine Description:
+    Programs the Rx and Tx interrupt coalescing from the current interrupt moderation level.
+    Called with Dev_SpinLock held.
+Arguments:
+    pAdapter    Pointer to adapter data
+Return Value:
+    None
+--*/
+_Use_decl_annotations_
+void EnetSetInterruptCoalescing(PMP_ADAPTER pAdapter)
+{
+    volatile CSP_ENET_REGS  *ENETRegBase = pAdapter->ENETRegBase;
+    ULONG                    FrameThreshold, TimerThreshold;
+    UINT32                   ICR_RegMask = 0;
+
+    if (MpIntModGetThresholds(&pAdapter->IntMod, pAdapter->IntMod_Clock_kHz, &FrameThreshold, &TimerThreshold)) {
+        ICR_RegMask = ENET_ICR_ICEN_MASK | BIT_FIELD_VAL(ENET_ICR_ICFT, FrameThreshold) | BIT_FIELD_VAL(ENET_ICR_ICTT, TimerThreshold);  // ICCS = 0, MII/GMII TX clock
+    }
+    ENETRegBase->RXIC[0].U = 0;                   // Disable the coalescing before the thresholds are changed
+    ENETRegBase->TXIC[0].U = 0;
+    ENETRegBase->RXIC[0].U = ICR_RegMask;
+    ENETRegBase->TXIC[0].U = ICR_RegMask;
+    DBG_ENET_DEV_PRINT_INFO("Interrupt moderation level %d, %d frames/%d us, RXIC/TXIC: 0x%08X", pAdapter->IntMod.Stats.Level, pAdapter->IntMod.Stats.FrameThreshold, pAdapter->IntMod.Stats.TimeThreshold_us, ICR_RegMask);
+}
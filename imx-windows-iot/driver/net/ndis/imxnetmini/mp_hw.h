@@ -85,12 +85,29 @@ extern "C" {
 #define TX_DESC_COUNT_DEFAULT                    64  // Number of Tx buffer descriptors
 #define TX_DESC_COUNT_MIN                         2
 #define TX_DESC_COUNT_MAX                      1024
+#define TX_COPY_BREAK_DEFAULT                   256  // Tx frames up to this size are copied to the bounce buffer
+#define TX_COPY_BREAK_MIN                        64  // Short frames are padded in the bounce buffer, >= ETHER_FRAME_NIN_LENGTH
+#define TX_COPY_BREAK_MAX                      2048  // All frames copied, zero-copy disabled, == ENET_TX_FRAME_SIZE
+#define RX_POLL_BUDGET_DEFAULT                   64  // Max. Rx frames indicated in one DPC call, the interrupts stay masked while more are waiting
+#define RX_POLL_BUDGET_MIN                        8
+#define RX_POLL_BUDGET_MAX        RX_DESC_COUNT_MAX
+#define RX_BUFFER_POOL_DEFAULT  (2 * RX_DESC_COUNT_DEFAULT)  // Number of Rx DMA buffers, the ring is refilled from the spare ones while NDIS holds frames
+#define RX_BUFFER_POOL_MIN        RX_DESC_COUNT_MIN  // Raised to the number of Rx buffer descriptors
+#define RX_BUFFER_POOL_MAX  (2 * RX_DESC_COUNT_MAX)
+#define RX_COPY_BREAK_DEFAULT                   256  // Rx frames up to this size are copied, their DMA buffer goes back to the ring at once
+#define RX_COPY_BREAK_MIN                         0  // Copy-break disabled
+#define RX_COPY_BREAK_MAX  (ETHER_FRAME_MAX_LENGTH - ETHER_FRAME_CRC_LENGTH)
 #define SPEED_SELECT_DEFAULT             SPEED_AUTO  // Speed select
 #define SPEED_SELECT_MIN                 SPEED_AUTO
 #define SPEED_SELECT_MAX     SPEED_FULL_DUPLEX_100M
 
 #define ENET_RX_FRAME_SIZE                     2048
 #define ENET_TX_FRAME_SIZE                     2048
+#define ENET_TX_BD_MAX_LENGTH                0xFFFF  // ENET_BD DataLen
+#define ENET_TX_BD_ALIGN_MASK                     0  // ENET with AVB takes Tx buffers at any byte address
+#define ENET_TX_HEADER_COPY_SIZE                128  // Bytes copied ahead of a mapped payload if the protocol checksum field has to be cleared
+#define ENET_LSO_MAX_OFFLOAD_SIZE             64000  // Max TCP payload of one LSOv2 send
+#define ENET_DPC_MAX_POLL_ROUNDS                  4  // Times the interrupt flags are read again in one DPC call while new events keep coming
 
 #define MMI_DATA_MASK                         0xFFFF
 
@@ -122,6 +139,13 @@ typedef struct  _FRAME_TXD_STATUS
     ULONG    FramesXmitAbortedErrors;
     ULONG    FramesXmitUnderrunErrors;
     ULONG    FramsXmitCarrierErrors;
+    ULONG    FramesXmitCopied;          // Frames copied to the bounce buffer
+    ULONG    FramesXmitZeroCopy;        // Frames mapped straight from the NET_BUFFER
+    ULONG    FramesXmitHeaderCopied;    // Frames with the headers copied and the payload mapped from the NET_BUFFER
+    ULONG    FramesXmitLso;             // LSOv2 sends
+    ULONG    FramesXmitLsoSegments;     // Frames the LSOv2 sends were segmented to
+    ULONGLONG BytesXmitLso;             // Bytes of the LSOv2 sends
+    ULONGLONG TicksXmitLso;             // Performance counter ticks spent segmenting the LSOv2 sends
 } FRAME_TXD_STATUS,  *PFRAME_TXD_STATUS;
 
 MINIPORT_ISR EnetIsr;
@@ -136,6 +160,7 @@ void EnetDeinit(_In_ PMP_ADAPTER pAdapter);
 void EnetStop  (_In_ PMP_ADAPTER pAdapter, _In_ NDIS_STATUS NdisStatus);
 void EnetStart (_In_ PMP_ADAPTER pAdapter);
 void EnetOnLinkStateChanged(_In_ MP_PHY_DEVICE *pPHYDev);
+void EnetSetInterruptCoalescing(_In_ PMP_ADAPTER pAdapter);
 
 // Multicast hash tables related functions
 void ClearAllMultiCast(_In_ PMP_ADAPTER Adapter);
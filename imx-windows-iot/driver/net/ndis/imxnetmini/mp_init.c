@@ -133,7 +133,10 @@ NDIS_STATUS NICAllocAdapterMemory(PMP_ADAPTER pAdapter)
         DmaDescription.Header.Revision                  = NDIS_SG_DMA_DESCRIPTION_REVISION_1;
         DmaDescription.Header.Size                      = sizeof(NDIS_SG_DMA_DESCRIPTION);
         DmaDescription.Flags                            = 0;                    // we don't do 64 bit DMA
-        DmaDescription.MaximumPhysicalMapping           = ENET_TX_FRAME_SIZE;   // Even if offload is enabled, the packet size for mapping shouldn't change
+        DmaDescription.MaximumPhysicalMapping           = ENET_TX_FRAME_SIZE;   // Checksum offload does not change the packet size for mapping
+        if ((pAdapter->LsoV2IPv4 == LsoEnabled) || (pAdapter->LsoV2IPv6 == LsoEnabled)) {
+            DmaDescription.MaximumPhysicalMapping       = ENET_LSO_MAX_OFFLOAD_SIZE + MP_TX_LSO_MAX_HEADER_SIZE;   // LSOv2 sends are mapped as a whole
+        }
         DmaDescription.ProcessSGListHandler             = MpProcessSGList;      //
         DmaDescription.SharedMemAllocateCompleteHandler = NULL;                 // ENET does not call NdisMAllocateSharedMemoryAsyncEx, hence no need for complete handler
         if ((Status = NdisMRegisterScatterGatherDma(pAdapter->AdapterHandle, &DmaDescription, &pAdapter->Tx_DmaHandle)) == NDIS_STATUS_SUCCESS) {
@@ -160,6 +163,11 @@ NDIS_STATUS NICAllocAdapterMemory(PMP_ADAPTER pAdapter)
         // Initialize Tx Lookaside lists
         NdisInitializeNPagedLookasideList(&pAdapter->Tx_MpTxBDLookasideList, NULL, NULL, 0, sizeof(MP_TX_BD) - sizeof(SCATTER_GATHER_LIST) + pAdapter->Tx_SGListSize, MP_TAG_TX_BD, 0);
         pAdapter->Rx_DmaBDT_DmaOwnedBDsLowWatterMark = (pAdapter->Rx_DmaBDT_ItemCount * MAC_RX_BUFFER_LOW_WATER_PERCENT) / 100;
+        pAdapter->Rx_RefillBatch = MpRxPoolGetRefillBatch((ULONG)pAdapter->Rx_DmaBDT_ItemCount);
+        if (pAdapter->Rx_BufferCount < pAdapter->Rx_DmaBDT_ItemCount) {
+            pAdapter->Rx_BufferCount = pAdapter->Rx_DmaBDT_ItemCount;                  // At least one buffer for each BD
+        }
+        pAdapter->Rx_CopyBufferCount = (pAdapter->Rx_CopyBreak != 0) ? pAdapter->Rx_DmaBDT_ItemCount : 0;
         /* ************************************************************************************************************************************ */
         /* Allocated memory for ENET DMA Receive Descriptors Table(Rx_DmaBDT). Note: This memory must be 8 bytes aligned!                       */
         /* ************************************************************************************************************************************ */
@@ -200,16 +208,23 @@ NDIS_STATUS NICAllocAdapterMemory(PMP_ADAPTER pAdapter)
             break;
         }
         NdisZeroMemory(pAdapter->Tx_EnetSwExtBDT, Tx_EnetSwExtBDT_Size);
-        // Allocate RX frame buffer descriptors array.
-        ULONG Rx_FrameBDTSize =  sizeof(MP_RX_FRAME_BD) * pAdapter->Rx_DmaBDT_ItemCount;
+        // Allocate RX frame buffer descriptors array, the DMA buffers are followed by the copy-break buffers.
+        ULONG Rx_FrameBDTSize =  sizeof(MP_RX_FRAME_BD) * (pAdapter->Rx_BufferCount + pAdapter->Rx_CopyBufferCount);
         if ((pAdapter->Rx_FrameBDT = NdisAllocateMemoryWithTagPriority(pAdapter->AdapterHandle, Rx_FrameBDTSize, MP_TAG_RX_PAYLOAD_DESC, NormalPoolPriority)) == NULL) {
             Status = NDIS_STATUS_RESOURCES;
             DBG_ENET_DEV_PRINT_ERROR_WITH_STATUS("NdisAllocateMemoryWithTagPriority() failed to allocated RX frame descriptors table.");
             break;
         }
         NdisZeroMemory(pAdapter->Rx_FrameBDT, Rx_FrameBDTSize);
+        // Allocate storage of the free RX buffer pools.
+        ULONG Rx_PoolEntriesSize = sizeof(PVOID) * (pAdapter->Rx_BufferCount + pAdapter->Rx_CopyBufferCount);
+        if ((pAdapter->Rx_PoolEntries = NdisAllocateMemoryWithTagPriority(pAdapter->AdapterHandle, Rx_PoolEntriesSize, MP_TAG_RX_PAYLOAD_DESC, NormalPoolPriority)) == NULL) {
+            Status = NDIS_STATUS_RESOURCES;
+            DBG_ENET_DEV_PRINT_ERROR_WITH_STATUS("NdisAllocateMemoryWithTagPriority() failed to allocated RX buffer pool.");
+            break;
+        }
         // Allocate RX frame date buffers. Allocate buffer memory, MDL, NBL, NB
-        for (LONG RxBuffIdx = 0; RxBuffIdx < pAdapter->Rx_DmaBDT_ItemCount; ++RxBuffIdx) {
+        for (LONG RxBuffIdx = 0; RxBuffIdx < pAdapter->Rx_BufferCount; ++RxBuffIdx) {
             MP_RX_FRAME_BD *pRxFrameBD = &pAdapter->Rx_FrameBDT[RxBuffIdx];
             #if 0 //MVa
             NdisMAllocateSharedMemory(pAdapter->AdapterHandle, pAdapter->ENET_RX_FRAME_SIZE, TRUE, &pRxFrameBD->pBuffer, &pRxFrameBD->BufferPa);
@@ -233,6 +248,7 @@ NDIS_STATUS NICAllocAdapterMemory(PMP_ADAPTER pAdapter)
                 pRxFrameBD->BufferPa = MmGetPhysicalAddress(pRxFrameBD->pBuffer);
                 NT_ASSERT(pRxFrameBD->BufferPa.HighPart == 0);
             } // MS-temp fix end
+            pRxFrameBD->BufferSize = ENET_RX_FRAME_SIZE;
             // Allocate MDL
             if ((pRxFrameBD->pMdl = NdisAllocateMdl(pAdapter->AdapterHandle, pRxFrameBD->pBuffer, ENET_RX_FRAME_SIZE)) == NULL) {
                 Status = NDIS_STATUS_RESOURCES;
@@ -250,6 +266,35 @@ NDIS_STATUS NICAllocAdapterMemory(PMP_ADAPTER pAdapter)
         if (Status != NDIS_STATUS_SUCCESS) {
             break;
         }
+        // Allocate RX copy-break buffers. The frame is copied by the CPU, so any non-paged memory will do.
+        if (pAdapter->Rx_CopyBufferCount != 0) {
+            pAdapter->Rx_CopyBuffer_Size = ALIGN_UP_BY(pAdapter->Rx_CopyBreak + 2, MEMORY_ALLOCATION_ALIGNMENT);
+            if ((pAdapter->Rx_CopyBuffer_Va = NdisAllocateMemoryWithTagPriority(pAdapter->AdapterHandle, pAdapter->Rx_CopyBuffer_Size * pAdapter->Rx_CopyBufferCount, MP_TAG_RX_PAYLOAD_DESC, NormalPoolPriority)) == NULL) {
+                Status = NDIS_STATUS_RESOURCES;
+                DBG_ENET_DEV_PRINT_ERROR_WITH_STATUS("NdisAllocateMemoryWithTagPriority() failed to allocate RX copy-break buffers.");
+                break;
+            }
+        }
+        for (LONG RxBuffIdx = 0; RxBuffIdx < pAdapter->Rx_CopyBufferCount; ++RxBuffIdx) {
+            MP_RX_FRAME_BD *pRxFrameBD = &pAdapter->Rx_FrameBDT[pAdapter->Rx_BufferCount + RxBuffIdx];
+            pRxFrameBD->pBuffer    = pAdapter->Rx_CopyBuffer_Va + (ULONG)RxBuffIdx * pAdapter->Rx_CopyBuffer_Size;
+            pRxFrameBD->BufferSize = pAdapter->Rx_CopyBreak + 2;
+            pRxFrameBD->CopyBuffer = TRUE;
+            if ((pRxFrameBD->pMdl = NdisAllocateMdl(pAdapter->AdapterHandle, pRxFrameBD->pBuffer, pRxFrameBD->BufferSize)) == NULL) {
+                Status = NDIS_STATUS_RESOURCES;
+                DBG_ENET_DEV_PRINT_ERROR_WITH_STATUS("NdisAllocateMdl() failed to allocate Mdl for copy-break buffer.");
+                break;
+            }
+            if ((pRxFrameBD->pNBL = NdisAllocateNetBufferAndNetBufferList(pAdapter->Rx_NBAndNBLPool, 0, 0, pRxFrameBD->pMdl, 2, 0)) == NULL) {
+                Status = NDIS_STATUS_RESOURCES;
+                DBG_ENET_DEV_PRINT_ERROR_WITH_STATUS("NdisAllocateNetBufferAndNetBufferList() failed to allocate NBL and NB for copy-break buffer.");
+                break;
+            }
+            MP_NBL_SET_RX_FRAME_BD(pRxFrameBD->pNBL, pRxFrameBD);       // Associate NBL and payload buffer descriptor
+        }
+        if (Status != NDIS_STATUS_SUCCESS) {
+            break;
+        }
         /* ************************************************************************************************************************************ */
         // Allocate memory for tx Ethernet frames
         /* ************************************************************************************************************************************ */
@@ -342,7 +387,7 @@ void MpFreeAdapter(PMP_ADAPTER  pAdapter)
         }
         // Free RX payload buffer descriptors
         if (pAdapter->Rx_FrameBDT != NULL) {
-            for (LONG RxBuffIdx = 0; RxBuffIdx < pAdapter->Rx_DmaBDT_ItemCount; ++RxBuffIdx) {
+            for (LONG RxBuffIdx = 0; RxBuffIdx < pAdapter->Rx_BufferCount + pAdapter->Rx_CopyBufferCount; ++RxBuffIdx) {
                 MP_RX_FRAME_BD *pRxFrameBD = &pAdapter->Rx_FrameBDT[RxBuffIdx];
                 if (pRxFrameBD != NULL) {
                     if (pRxFrameBD->pMdl != NULL) {
@@ -351,7 +396,7 @@ void MpFreeAdapter(PMP_ADAPTER  pAdapter)
                     if (pRxFrameBD->pNBL != NULL) {
                         NdisFreeNetBufferList(pRxFrameBD->pNBL);
                     }
-                    if (pRxFrameBD->pBuffer != NULL) {
+                    if ((pRxFrameBD->pBuffer != NULL) && !pRxFrameBD->CopyBuffer) {
                         // MVa NdisMFreeSharedMemory(pAdapter->AdapterHandle, ENET_RX_FRAME_SIZE, TRUE, pRxFrameBD->pBuffer, pRxFrameBD->BufferPa);
                         /* MS temp fix*/ MmFreeContiguousMemory(pRxFrameBD->pBuffer);
                     }
@@ -361,6 +406,16 @@ void MpFreeAdapter(PMP_ADAPTER  pAdapter)
             pAdapter->Rx_FrameBDT = NULL;
 
         }
+        // Free RX copy-break buffers
+        if (pAdapter->Rx_CopyBuffer_Va != NULL) {
+            NdisFreeMemory(pAdapter->Rx_CopyBuffer_Va, 0, 0);
+            pAdapter->Rx_CopyBuffer_Va = NULL;
+        }
+        // Free RX buffer pool storage
+        if (pAdapter->Rx_PoolEntries != NULL) {
+            NdisFreeMemory(pAdapter->Rx_PoolEntries, 0, 0);
+            pAdapter->Rx_PoolEntries = NULL;
+        }
         // Free NB and NBL pool
         if (pAdapter->Rx_NBAndNBLPool) {
             NdisFreeNetBufferListPool(pAdapter->Rx_NBAndNBLPool);
@@ -404,6 +459,10 @@ NDIS_STATUS NICReadRegParameters(PMP_ADAPTER pAdapter)
     UINT                            Length;
     NDIS_CONFIGURATION_OBJECT       ConfigObject;
 
+    // TxCopyBreak range of the INF, short frames must always be copied to get padded
+    C_ASSERT(TX_COPY_BREAK_MIN >= ETHER_FRAME_NIN_LENGTH);
+    C_ASSERT(TX_COPY_BREAK_MAX == ENET_TX_FRAME_SIZE);
+
     MP_REG_VALUE_DESC static regValues[] = {
         {
             NDIS_STRING_CONST("*ReceiveBuffers"),
@@ -413,6 +472,22 @@ NDIS_STATUS NICReadRegParameters(PMP_ADAPTER pAdapter)
             RX_DESC_COUNT_MIN,
             RX_DESC_COUNT_MAX
         },
+        {
+            NDIS_STRING_CONST("RxBufferPool"),
+            MP_OFFSET(Rx_BufferCount),
+            MP_SIZE(Rx_BufferCount),
+            RX_BUFFER_POOL_DEFAULT,
+            RX_BUFFER_POOL_MIN,
+            RX_BUFFER_POOL_MAX
+        },
+        {
+            NDIS_STRING_CONST("RxCopyBreak"),
+            MP_OFFSET(Rx_CopyBreak),
+            MP_SIZE(Rx_CopyBreak),
+            RX_COPY_BREAK_DEFAULT,
+            RX_COPY_BREAK_MIN,
+            RX_COPY_BREAK_MAX
+        },
         {
             NDIS_STRING_CONST("*TransmitBuffers"),
             MP_OFFSET(Tx_DmaBDT_ItemCount),
@@ -421,6 +496,14 @@ NDIS_STATUS NICReadRegParameters(PMP_ADAPTER pAdapter)
             TX_DESC_COUNT_MIN,
             TX_DESC_COUNT_MAX
         },
+        {
+            NDIS_STRING_CONST("TxCopyBreak"),
+            MP_OFFSET(Tx_CopyBreak),
+            MP_SIZE(Tx_CopyBreak),
+            TX_COPY_BREAK_DEFAULT,
+            TX_COPY_BREAK_MIN,
+            TX_COPY_BREAK_MAX
+        },
         {
             NDIS_STRING_CONST("*SpeedDuplex"),
             MP_OFFSET(SpeedSelect),
@@ -469,6 +552,38 @@ NDIS_STATUS NICReadRegParameters(PMP_ADAPTER pAdapter)
             ChksumOffloadDisabled,
             TxRxChksumOffloadEnabled
         },
+        {
+            NDIS_STRING_CONST("*LsoV2IPv4"),
+            MP_OFFSET(LsoV2IPv4),
+            MP_SIZE(LsoV2IPv4),
+            LsoEnabled,
+            LsoDisabled,
+            LsoEnabled
+        },
+        {
+            NDIS_STRING_CONST("*LsoV2IPv6"),
+            MP_OFFSET(LsoV2IPv6),
+            MP_SIZE(LsoV2IPv6),
+            LsoDisabled,
+            LsoDisabled,
+            LsoEnabled
+        },
+        {
+            NDIS_STRING_CONST("*InterruptModeration"),
+            MP_OFFSET(InterruptModeration),
+            MP_SIZE(InterruptModeration),
+            IntModerationEnabled,
+            IntModerationDisabled,
+            IntModerationEnabled
+        },
+        {
+            NDIS_STRING_CONST("RxPollBudget"),
+            MP_OFFSET(RxPollBudget),
+            MP_SIZE(RxPollBudget),
+            RX_POLL_BUDGET_DEFAULT,
+            RX_POLL_BUDGET_MIN,
+            RX_POLL_BUDGET_MAX
+        },
         {
             NDIS_STRING_CONST("*DiscardRxFrameWithWrongProtocolChecksum"),
             MP_OFFSET(DiscardRxFrameWithWrongProtocolChecksum),
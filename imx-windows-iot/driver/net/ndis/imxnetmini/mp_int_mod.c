@@ -0,0 +1,192 @@
+/*
+* Copyright 2023 NXP
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted (subject to the limitations in the disclaimer
+* below) provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of NXP nor the names of its contributors may be used to
+* endorse or promote products derived from this software without specific prior
+* written permission.
+*
+* NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS
+* LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+* THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+* GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include <wdm.h>
+#include "mp_int_mod.h"
+
+// Levels by packet rate. The time threshold bounds the latency the coalescing adds, the frame threshold keeps the RX
+// ring from filling up before the interrupt at the highest rates.
+static const MP_INT_MOD_LEVEL MpIntModLevels[MP_INT_MOD_LEVEL_COUNT] = {
+    //  MinPacketRate  FrameThreshold  TimeThreshold_us
+    {           0U,           1U,             0U },   // Interrupt per frame
+    {       20000U,           8U,            50U },
+    {       50000U,          16U,           100U },
+    {      100000U,          32U,           150U },
+    {      200000U,          64U,           250U },
+};
+
+static ULONG MpIntModGetHistogramBucket(_In_ ULONG Value)
+{
+    ULONG Bucket = 0U;
+
+    while ((Value != 0U) && (Bucket < (MP_INT_MOD_HISTOGRAM_SIZE - 1U))) {
+        Value >>= 1;
+        Bucket++;
+    }
+    return Bucket;
+}
+
+static void MpIntModSetLevel(_Inout_ PMP_INT_MOD pIntMod, _In_ ULONG Level)
+{
+    pIntMod->Stats.Level            = Level;
+    pIntMod->Stats.FrameThreshold   = MpIntModLevels[Level].FrameThreshold;
+    pIntMod->Stats.TimeThreshold_us = MpIntModLevels[Level].TimeThreshold_us;
+    pIntMod->DownWindows            = 0U;
+}
+
+/*++
+Routine Description:
+    Initializes the interrupt moderation state and clears the statistics. The coalescing starts disabled.
+Arguments:
+    pIntMod     The interrupt moderation state
+    Adaptive    FALSE if the coalescing stays disabled
+    Now_us      Current time [us]
+Return Value:
+    None
+--*/
+_Use_decl_annotations_
+void MpIntModInit(PMP_INT_MOD pIntMod, BOOLEAN Adaptive, ULONG64 Now_us)
+{
+    RtlZeroMemory(pIntMod, sizeof(*pIntMod));
+    pIntMod->Stats.Adaptive = Adaptive ? 1U : 0U;
+    pIntMod->WindowStart_us = Now_us;
+    MpIntModSetLevel(pIntMod, 0U);
+}
+
+/*++
+Routine Description:
+    Enables or disables the adaptive coalescing, disabling it returns to the interrupt per frame.
+Arguments:
+    pIntMod     The interrupt moderation state
+    Adaptive    FALSE to disable the coalescing
+Return Value:
+    TRUE if the coalescing thresholds changed.
+--*/
+_Use_decl_annotations_
+BOOLEAN MpIntModSetAdaptive(PMP_INT_MOD pIntMod, BOOLEAN Adaptive)
+{
+    pIntMod->Stats.Adaptive = Adaptive ? 1U : 0U;
+    if (Adaptive || (pIntMod->Stats.Level == 0U)) {
+        return FALSE;
+    }
+    MpIntModSetLevel(pIntMod, 0U);
+    pIntMod->Stats.LevelChanges++;
+    return TRUE;
+}
+
+/*++
+Routine Description:
+    Accounts one served interrupt and, at the end of each measurement window, selects the coalescing level from the
+    packet rate of the window.
+Arguments:
+    pIntMod     The interrupt moderation state
+    Packets     RX and TX frames handled since the interrupt, including the polls with the interrupts masked
+    Latency_us  Time from the ISR to the end of the poll
+    Now_us      Current time [us]
+Return Value:
+    TRUE if the coalescing thresholds changed.
+--*/
+_Use_decl_annotations_
+BOOLEAN MpIntModUpdate(PMP_INT_MOD pIntMod, ULONG Packets, ULONG Latency_us, ULONG64 Now_us)
+{
+    ULONG64  Elapsed_us;
+    ULONG64  Rate;
+    ULONG    Level;
+    ULONG    Target;
+
+    pIntMod->Stats.Interrupts++;
+    pIntMod->Stats.Packets += Packets;
+    pIntMod->Stats.LatencyHistogram[MpIntModGetHistogramBucket(Latency_us)]++;
+    pIntMod->Stats.PacketsPerInterruptHistogram[MpIntModGetHistogramBucket(Packets)]++;
+    pIntMod->WindowPackets += Packets;
+    pIntMod->WindowInterrupts++;
+    Elapsed_us = Now_us - pIntMod->WindowStart_us;
+    if (Elapsed_us < MP_INT_MOD_WINDOW_US) {
+        return FALSE;
+    }
+    Rate = (ULONG64)pIntMod->WindowPackets * 1000000U / Elapsed_us;
+    pIntMod->Stats.PacketRate          = (Rate > MAXULONG) ? MAXULONG : (ULONG)Rate;
+    pIntMod->Stats.InterruptRate       = (ULONG)((ULONG64)pIntMod->WindowInterrupts * 1000000U / Elapsed_us);
+    pIntMod->Stats.PacketsPerInterrupt = pIntMod->WindowPackets / pIntMod->WindowInterrupts;
+    pIntMod->WindowStart_us   = Now_us;
+    pIntMod->WindowPackets    = 0U;
+    pIntMod->WindowInterrupts = 0U;
+    if (!pIntMod->Stats.Adaptive) {
+        return FALSE;
+    }
+    Level  = pIntMod->Stats.Level;
+    Target = MP_INT_MOD_LEVEL_COUNT - 1U;
+    while (MpIntModLevels[Target].MinPacketRate > pIntMod->Stats.PacketRate) {   // Level 0 starts at 0 packets/s
+        Target--;
+    }
+    if (Target > Level) {                                                          // Raise at once, the RX ring must not fill up
+        MpIntModSetLevel(pIntMod, Target);
+    } else if ((Target < Level) && (pIntMod->Stats.PacketRate < (MpIntModLevels[Level].MinPacketRate / 4U * 3U))) {
+        if (++pIntMod->DownWindows < MP_INT_MOD_DOWN_WINDOWS) {
+            return FALSE;
+        }
+        MpIntModSetLevel(pIntMod, Target);
+    } else {
+        pIntMod->DownWindows = 0U;
+        return FALSE;
+    }
+    pIntMod->Stats.LevelChanges++;
+    return TRUE;
+}
+
+/*++
+Routine Description:
+    Converts the thresholds of the current level to the ENET_RXIC/ENET_TXIC register fields.
+Arguments:
+    pIntMod          The interrupt moderation state
+    Clock_kHz        The coalescing timer clock, 0 if not known yet
+    pFrameThreshold  ICFT value
+    pTimerThreshold  ICTT value
+Return Value:
+    FALSE if the coalescing must be disabled, otherwise TRUE.
+--*/
+_Use_decl_annotations_
+BOOLEAN MpIntModGetThresholds(const MP_INT_MOD *pIntMod, ULONG Clock_kHz, PULONG pFrameThreshold, PULONG pTimerThreshold)
+{
+    ULONG64  Timer;
+
+    *pFrameThreshold = 0U;
+    *pTimerThreshold = 0U;
+    if ((pIntMod->Stats.TimeThreshold_us == 0U) || (Clock_kHz == 0U)) {
+        return FALSE;
+    }
+    Timer = ((ULONG64)pIntMod->Stats.TimeThreshold_us * Clock_kHz + (MP_INT_MOD_TIMER_CLOCK_DIVIDER * 1000U) - 1U) / (MP_INT_MOD_TIMER_CLOCK_DIVIDER * 1000U);
+    *pTimerThreshold = (Timer > MP_INT_MOD_MAX_TIMER_THRESHOLD) ? MP_INT_MOD_MAX_TIMER_THRESHOLD : (ULONG)Timer;
+    *pFrameThreshold = (pIntMod->Stats.FrameThreshold > MP_INT_MOD_MAX_FRAME_THRESHOLD) ? MP_INT_MOD_MAX_FRAME_THRESHOLD : pIntMod->Stats.FrameThreshold;
+    return TRUE;
+}
@@ -0,0 +1,92 @@
+/*
+* Copyright 2023 NXP
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted (subject to the limitations in the disclaimer
+* below) provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of NXP nor the names of its contributors may be used to
+* endorse or promote products derived from this software without specific prior
+* written permission.
+*
+* NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS
+* LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+* THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+* GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#ifndef _MP_INT_MOD_H
+#define _MP_INT_MOD_H
+
+// Adaptive interrupt moderation. The packet rate measured over MP_INT_MOD_WINDOW_US selects one of the coalescing
+// levels, the ENET then raises the RX/TX interrupt when the frame threshold is reached or when the time threshold
+// passes after the first frame. A level is raised as soon as its packet rate is reached and lowered only after the rate
+// stayed under 3/4 of it for MP_INT_MOD_DOWN_WINDOWS windows, so a rate close to a level boundary does not keep
+// rewriting the coalescing registers. Interrupt rate, packets per interrupt and latency histograms are collected too.
+// Only needs the types of wdm.h, so it can be run on the host.
+
+#define MP_INT_MOD_LEVEL_COUNT         5U
+#define MP_INT_MOD_WINDOW_US           10000U   // Packet rate measurement window
+#define MP_INT_MOD_DOWN_WINDOWS        2U       // Windows under the level rate before the level is lowered
+#define MP_INT_MOD_HISTOGRAM_SIZE      12U      // Bucket 0: 0, bucket i: 2^(i-1) .. 2^i - 1, the last bucket takes the rest
+
+#define MP_INT_MOD_TIMER_CLOCK_DIVIDER 64U      // The ENET counts the time threshold in 64 coalescing clock periods
+#define MP_INT_MOD_MAX_FRAME_THRESHOLD 255U
+#define MP_INT_MOD_MAX_TIMER_THRESHOLD 0xFFFFU
+
+// Private OID returning MP_INT_MOD_STATISTICS
+#define OID_IMX_ENET_INTERRUPT_MODERATION_STATISTICS   0xFF010001U
+
+typedef struct _MP_INT_MOD_LEVEL {
+    ULONG    MinPacketRate;         // Packets/s the level is selected from
+    ULONG    FrameThreshold;        // Interrupt after this many frames ...
+    ULONG    TimeThreshold_us;      // ... or this time after the first frame, 0 - coalescing disabled
+} MP_INT_MOD_LEVEL, *PMP_INT_MOD_LEVEL;
+
+typedef struct _MP_INT_MOD_STATISTICS {
+    ULONG    Adaptive;                                                  // 0 - coalescing disabled by *InterruptModeration
+    ULONG    Level;                                                     // Current coalescing level
+    ULONG    FrameThreshold;                                            // Current coalescing frame threshold
+    ULONG    TimeThreshold_us;                                          // Current coalescing time threshold
+    ULONG    PacketRate;                                                // Packets/s in the last window
+    ULONG    InterruptRate;                                             // Interrupts/s in the last window
+    ULONG    PacketsPerInterrupt;                                       // Packets/interrupt in the last window
+    ULONG    Reserved;
+    ULONG64  Interrupts;                                                // Interrupts served
+    ULONG64  Polls;                                                     // DPC calls that left the interrupts masked, the poll budget was used up
+    ULONG64  Packets;                                                   // RX and TX frames handled
+    ULONG64  LevelChanges;
+    ULONG    LatencyHistogram[MP_INT_MOD_HISTOGRAM_SIZE];               // ISR to the end of the poll [us]
+    ULONG    PacketsPerInterruptHistogram[MP_INT_MOD_HISTOGRAM_SIZE];
+} MP_INT_MOD_STATISTICS, *PMP_INT_MOD_STATISTICS;
+
+typedef struct _MP_INT_MOD {
+    ULONG64                WindowStart_us;
+    ULONG                  WindowPackets;
+    ULONG                  WindowInterrupts;
+    ULONG                  DownWindows;      // Consecutive windows under the rate of the current level
+    MP_INT_MOD_STATISTICS  Stats;
+} MP_INT_MOD, *PMP_INT_MOD;
+
+void    MpIntModInit(_Out_ PMP_INT_MOD pIntMod, _In_ BOOLEAN Adaptive, _In_ ULONG64 Now_us);
+BOOLEAN MpIntModSetAdaptive(_Inout_ PMP_INT_MOD pIntMod, _In_ BOOLEAN Adaptive);
+BOOLEAN MpIntModUpdate(_Inout_ PMP_INT_MOD pIntMod, _In_ ULONG Packets, _In_ ULONG Latency_us, _In_ ULONG64 Now_us);
+BOOLEAN MpIntModGetThresholds(_In_ const MP_INT_MOD *pIntMod, _In_ ULONG Clock_kHz, _Out_ PULONG pFrameThreshold, _Out_ PULONG pTimerThreshold);
+
+#endif // _MP_INT_MOD_H
@@ -279,6 +279,21 @@ NDIS_STATUS MpInitializeEx(NDIS_HANDLE MiniportAdapterHandle, NDIS_HANDLE Minipo
         NdisOffload.Checksum.IPv4Receive.TcpChecksum = NDIS_OFFLOAD_SET_ON;
         NdisOffload.Checksum.IPv4Receive.UdpChecksum = NDIS_OFFLOAD_SET_ON;
         NdisOffload.Checksum.IPv4Receive.IpChecksum = NDIS_OFFLOAD_SET_ON;
+#ifdef ENET_ENHANCED_BD
+        // LSOv2 sends are segmented by the driver, ENET inserts the checksums of the segments
+        if (pAdapter->LsoV2IPv4 == LsoEnabled) {
+            NdisOffload.LsoV2.IPv4.Encapsulation = NDIS_ENCAPSULATION_IEEE_802_3;
+            NdisOffload.LsoV2.IPv4.MaxOffLoadSize = ENET_LSO_MAX_OFFLOAD_SIZE;
+            NdisOffload.LsoV2.IPv4.MinSegmentCount = MP_TX_LSO_MIN_SEGMENT_COUNT;
+        }
+        if (pAdapter->LsoV2IPv6 == LsoEnabled) {
+            NdisOffload.LsoV2.IPv6.Encapsulation = NDIS_ENCAPSULATION_IEEE_802_3;
+            NdisOffload.LsoV2.IPv6.MaxOffLoadSize = ENET_LSO_MAX_OFFLOAD_SIZE;
+            NdisOffload.LsoV2.IPv6.MinSegmentCount = MP_TX_LSO_MIN_SEGMENT_COUNT;
+            NdisOffload.LsoV2.IPv6.IpExtensionHeadersSupported = NDIS_OFFLOAD_NOT_SUPPORTED;
+            NdisOffload.LsoV2.IPv6.TcpOptionsSupported = NDIS_OFFLOAD_SUPPORTED;
+        }
+#endif
 
         NdisZeroMemory( &OffloadAttributes, sizeof(NDIS_MINIPORT_ADAPTER_OFFLOAD_ATTRIBUTES));
         OffloadAttributes.Header.Type = NDIS_OBJECT_TYPE_MINIPORT_ADAPTER_OFFLOAD_ATTRIBUTES;
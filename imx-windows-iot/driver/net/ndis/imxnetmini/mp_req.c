@@ -40,6 +40,9 @@ NDIS_OID ENETSupportedOids[] = {
     OID_802_3_RCV_OVERRUN,
     OID_802_3_XMIT_UNDERRUN,
     OID_PNP_SET_POWER,                             // Q: ""   S: "O"  RH
+    // Private OIDs
+    OID_IMX_ENET_INTERRUPT_MODERATION_STATISTICS,
+    OID_IMX_ENET_RX_POOL_STATISTICS,
 };
 
 ULONG ENETSupportedOidsSize = sizeof(ENETSupportedOids);
@@ -354,6 +357,8 @@ NDIS_STATUS MpQueryInformation(NDIS_HANDLE MiniportAdapterContext, PNDIS_OID_REQ
     ULONG                                 BytesNeeded             = 0;
     UCHAR                                 VendorDesc[]            = NIC_VENDOR_DESC;
     NDIS_INTERRUPT_MODERATION_PARAMETERS  ndisIntModParams;
+    MP_INT_MOD_STATISTICS                 IntModStatistics;
+    MP_RX_POOL_STATISTICS                 RxPoolStatistics;
     ULONG                                 ulInfo                  = 0;
     ULONG64                               ul64Info                = 0;
     PVOID                                 pInfo                   = (PVOID) &ulInfo;
@@ -382,7 +387,7 @@ NDIS_STATUS MpQueryInformation(NDIS_HANDLE MiniportAdapterContext, PNDIS_OID_REQ
 
         case OID_GEN_RECEIVE_BUFFER_SPACE:
             // Specifies the amount of memory on the NIC that is available for buffering receive data.
-            ulInfo = ETHER_FRAME_MAX_LENGTH * pAdapter->Rx_DmaBDT_ItemCount;
+            ulInfo = ETHER_FRAME_MAX_LENGTH * pAdapter->Rx_BufferCount;
             break;
 
         case OID_GEN_VENDOR_ID:
@@ -449,16 +454,31 @@ NDIS_STATUS MpQueryInformation(NDIS_HANDLE MiniportAdapterContext, PNDIS_OID_REQ
             break;
 
         case OID_GEN_INTERRUPT_MODERATION:
-            // Miniport driver does not support interrupt moderation, the driver must specify NdisInterruptModerationNotSupported
-            // in the InterruptModeration member of the NDIS_INTERRUPT_MODERATION_PARAMETERS structure.
+            // Adaptive Rx/Tx interrupt coalescing, it can be enabled or disabled without a reset.
             NdisZeroMemory(&ndisIntModParams, sizeof(ndisIntModParams));
             ndisIntModParams.Header.Type         = NDIS_OBJECT_TYPE_DEFAULT;
             ndisIntModParams.Header.Revision     = NDIS_INTERRUPT_MODERATION_PARAMETERS_REVISION_1;
             ndisIntModParams.Header.Size         = NDIS_SIZEOF_INTERRUPT_MODERATION_PARAMETERS_REVISION_1;
             ndisIntModParams.Flags               = 0;
-            ndisIntModParams.InterruptModeration = NdisInterruptModerationNotSupported;
+            ndisIntModParams.InterruptModeration = (pAdapter->InterruptModeration == IntModerationEnabled) ? NdisInterruptModerationEnabled : NdisInterruptModerationDisabled;
             pInfo = &ndisIntModParams;
-            ulBytesAvailable = sizeof(ndisIntModParams);
+            ulBytesAvailable = ulInfoLen = NDIS_SIZEOF_INTERRUPT_MODERATION_PARAMETERS_REVISION_1;
+            break;
+
+        case OID_IMX_ENET_INTERRUPT_MODERATION_STATISTICS:
+            // Interrupt rate, packets per interrupt and latency histograms of the interrupt moderation.
+            NdisAcquireSpinLock(&pAdapter->Dev_SpinLock);
+            IntModStatistics = pAdapter->IntMod.Stats;
+            NdisReleaseSpinLock(&pAdapter->Dev_SpinLock);
+            pInfo = &IntModStatistics;
+            ulBytesAvailable = ulInfoLen = sizeof(IntModStatistics);
+            break;
+
+        case OID_IMX_ENET_RX_POOL_STATISTICS:
+            // Copy-break, refill and drop counters of the RX buffer pool.
+            MpRxGetPoolStatistics(pAdapter, &RxPoolStatistics);
+            pInfo = &RxPoolStatistics;
+            ulBytesAvailable = ulInfoLen = sizeof(RxPoolStatistics);
             break;
 
         case OID_TCP_OFFLOAD_CURRENT_CONFIG:
@@ -517,6 +537,7 @@ NDIS_STATUS MpSetInformation(NDIS_HANDLE MiniportAdapterContext, PNDIS_OID_REQUE
     ULONG                       BytesNeeded             = 0;
     ULONG                       PacketFilter;
     ULONG                       MCAddressCount;
+    PNDIS_INTERRUPT_MODERATION_PARAMETERS pIntModParams;
 
     DBG_ENET_DEV_OIDS_METHOD_BEG_WITH_PARAMS("%s",Dbg_GetNdisOidName(Oid));
     switch(Oid) {
@@ -578,6 +599,35 @@ NDIS_STATUS MpSetInformation(NDIS_HANDLE MiniportAdapterContext, PNDIS_OID_REQUE
             Status = NDIS_STATUS_SUCCESS;
             break;
 
+        case OID_GEN_INTERRUPT_MODERATION:
+            if (InformationBufferLength < NDIS_SIZEOF_INTERRUPT_MODERATION_PARAMETERS_REVISION_1) {  // Verify the Length
+                BytesNeeded = NDIS_SIZEOF_INTERRUPT_MODERATION_PARAMETERS_REVISION_1;
+                Status = NDIS_STATUS_INVALID_LENGTH;
+                break;
+            }
+            pIntModParams = (PNDIS_INTERRUPT_MODERATION_PARAMETERS)InformationBuffer;
+            if ((pIntModParams->Header.Type != NDIS_OBJECT_TYPE_DEFAULT) ||
+                (pIntModParams->Header.Revision < NDIS_INTERRUPT_MODERATION_PARAMETERS_REVISION_1) ||
+                (pIntModParams->Header.Size < NDIS_SIZEOF_INTERRUPT_MODERATION_PARAMETERS_REVISION_1)) {
+                Status = NDIS_STATUS_INVALID_PARAMETER;
+                break;
+            }
+            if (pIntModParams->InterruptModeration == NdisInterruptModerationEnabled) {
+                pAdapter->InterruptModeration = IntModerationEnabled;
+            } else if (pIntModParams->InterruptModeration == NdisInterruptModerationDisabled) {
+                pAdapter->InterruptModeration = IntModerationDisabled;
+            } else {
+                Status = NDIS_STATUS_INVALID_DATA;
+                break;
+            }
+            BytesRead = NDIS_SIZEOF_INTERRUPT_MODERATION_PARAMETERS_REVISION_1;
+            NdisAcquireSpinLock(&pAdapter->Dev_SpinLock);
+            if (MpIntModSetAdaptive(&pAdapter->IntMod, pAdapter->InterruptModeration == IntModerationEnabled) && pAdapter->EnetStarted) {
+                EnetSetInterruptCoalescing(pAdapter);     // Back to the interrupt per frame
+            }
+            NdisReleaseSpinLock(&pAdapter->Dev_SpinLock);
+            break;
+
       case OID_PNP_SET_POWER:
           if (InformationBufferLength != sizeof(NDIS_DEVICE_POWER_STATE)) {
               Status = NDIS_STATUS_INVALID_LENGTH;
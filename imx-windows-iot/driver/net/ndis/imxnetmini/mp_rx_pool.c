@@ -0,0 +1,138 @@
+/*
+* Copyright 2023 NXP
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted (subject to the limitations in the disclaimer
+* below) provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of NXP nor the names of its contributors may be used to
+* endorse or promote products derived from this software without specific prior
+* written permission.
+*
+* NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS
+* LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+* THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+* GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include <wdm.h>
+#include "mp_rx_pool.h"
+
+/*++
+Routine Description:
+    Initializes an empty pool.
+Arguments:
+    pPool       The pool
+    ppEntries   Storage for Capacity buffer pointers
+    Capacity    Max. number of buffers in the pool
+Return Value:
+    None
+--*/
+_Use_decl_annotations_
+void MpRxPoolInit(PMP_RX_POOL pPool, PVOID *ppEntries, ULONG Capacity)
+{
+    RtlZeroMemory(pPool, sizeof(*pPool));
+    pPool->ppEntries = ppEntries;
+    pPool->Capacity  = Capacity;
+    pPool->MinCount  = Capacity;
+}
+
+/*++
+Routine Description:
+    Puts a free buffer to the pool.
+Arguments:
+    pPool       The pool
+    pEntry      The buffer
+Return Value:
+    FALSE if the pool is full, the buffer was not put to the pool then.
+--*/
+_Use_decl_annotations_
+BOOLEAN MpRxPoolPut(PMP_RX_POOL pPool, PVOID pEntry)
+{
+    if (pPool->Count == pPool->Capacity) {
+        return FALSE;
+    }
+    pPool->ppEntries[pPool->Count++] = pEntry;
+    return TRUE;
+}
+
+/*++
+Routine Description:
+    Takes the last buffer put to the pool.
+Arguments:
+    pPool       The pool
+Return Value:
+    The buffer, NULL if the pool is empty.
+--*/
+_Use_decl_annotations_
+PVOID MpRxPoolGet(PMP_RX_POOL pPool)
+{
+    if (pPool->Count == 0U) {
+        return NULL;
+    }
+    if (--pPool->Count < pPool->MinCount) {
+        pPool->MinCount = pPool->Count;
+    }
+    return pPool->ppEntries[pPool->Count];
+}
+
+/*++
+Routine Description:
+    Returns the refill batch size for a BD ring, a quarter of the ring at most, so a short ring is not left mostly empty.
+Arguments:
+    RingSize    Number of RX BDs
+Return Value:
+    Number of empty BDs refilled at once.
+--*/
+_Use_decl_annotations_
+ULONG MpRxPoolGetRefillBatch(ULONG RingSize)
+{
+    ULONG Batch = RingSize / 4U;
+
+    if (Batch > MP_RX_POOL_REFILL_BATCH) {
+        Batch = MP_RX_POOL_REFILL_BATCH;
+    }
+    return (Batch == 0U) ? 1U : Batch;
+}
+
+/*++
+Routine Description:
+    Decides how many empty BDs are refilled now. The BDs are refilled once Batch of them are empty, or at once when the
+    number of BDs owned by the ENET DMA drops to the low water mark.
+Arguments:
+    pPool           The pool of free DMA receive buffers
+    EmptyBDs        Number of BDs with no buffer
+    DmaOwnedBDs     Number of BDs owned by the ENET DMA
+    LowWaterMark    The ring runs low at this number of BDs owned by the ENET DMA
+    Batch           Number of empty BDs refilled at once
+Return Value:
+    Number of BDs to refill, not more than the free buffers in the pool.
+--*/
+_Use_decl_annotations_
+ULONG MpRxPoolGetRefillCount(PMP_RX_POOL pPool, ULONG EmptyBDs, ULONG DmaOwnedBDs, ULONG LowWaterMark, ULONG Batch)
+{
+    if ((EmptyBDs == 0U) || ((EmptyBDs < Batch) && (DmaOwnedBDs > LowWaterMark))) {
+        return 0U;
+    }
+    if (pPool->Count < EmptyBDs) {
+        pPool->Shortages++;
+        return pPool->Count;
+    }
+    return EmptyBDs;
+}
@@ -0,0 +1,78 @@
+/*
+* Copyright 2023 NXP
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted (subject to the limitations in the disclaimer
+* below) provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of NXP nor the names of its contributors may be used to
+* endorse or promote products derived from this software without specific prior
+* written permission.
+*
+* NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS
+* LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+* THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+* GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#ifndef _MP_RX_POOL_H
+#define _MP_RX_POOL_H
+
+// RX buffer pool. The receive buffers are not tied to the RX BDs: the pool holds more buffers than the BD ring, so the
+// BDs of the frames NDIS still holds are refilled from the pool and the ENET does not run out of BDs under a burst.
+// Empty BDs are refilled in batches, one at a time only when the ring runs low. The buffers are handed out LIFO, the
+// last returned buffer is likely still in the cache.
+// Only needs the types of wdm.h, so it can be run on the host.
+
+#define MP_RX_POOL_REFILL_BATCH        16U      // Empty BDs refilled at once, unless the ring runs low
+
+// Private OID returning MP_RX_POOL_STATISTICS
+#define OID_IMX_ENET_RX_POOL_STATISTICS   0xFF010002U
+
+typedef struct _MP_RX_POOL {
+    PVOID   *ppEntries;         // Free buffers, the last one is handed out first
+    ULONG    Capacity;
+    ULONG    Count;             // Number of free buffers
+    ULONG    MinCount;          // Lowest Count since MpRxPoolInit
+    ULONG64  Shortages;         // Refills that left BDs empty, the pool had not enough buffers
+} MP_RX_POOL, *PMP_RX_POOL;
+
+typedef struct _MP_RX_POOL_STATISTICS {
+    ULONG    Buffers;           // DMA receive buffers
+    ULONG    FreeBuffers;       // DMA receive buffers neither in the BD ring nor owned by NDIS
+    ULONG    MinFreeBuffers;    // Lowest FreeBuffers since the ENET start
+    ULONG    CopyBuffers;       // Copy-break buffers
+    ULONG    FreeCopyBuffers;   // Copy-break buffers not owned by NDIS
+    ULONG    CopyBreak;         // Frames up to this size are copied to a copy-break buffer
+    ULONG64  FramesCopied;      // Frames indicated in a copy-break buffer, their DMA buffer went back to the pool at once
+    ULONG64  CopyPoolEmpty;     // Short frames indicated in their DMA buffer, all copy-break buffers were owned by NDIS
+    ULONG64  Refills;           // Refill batches
+    ULONG64  RefilledBDs;       // BDs refilled
+    ULONG64  RefillShortages;   // Refills that left BDs empty
+    ULONG64  RingEmpty;         // Receive DPC calls that left no BD to the ENET
+    ULONG64  DroppedFrames;     // Frames dropped by the ENET, receive FIFO overflow (IEEE_R_MACERR)
+} MP_RX_POOL_STATISTICS, *PMP_RX_POOL_STATISTICS;
+
+void    MpRxPoolInit(_Out_ PMP_RX_POOL pPool, _In_ PVOID *ppEntries, _In_ ULONG Capacity);
+BOOLEAN MpRxPoolPut(_Inout_ PMP_RX_POOL pPool, _In_ PVOID pEntry);
+PVOID   MpRxPoolGet(_Inout_ PMP_RX_POOL pPool);
+ULONG   MpRxPoolGetRefillBatch(_In_ ULONG RingSize);
+ULONG   MpRxPoolGetRefillCount(_Inout_ PMP_RX_POOL pPool, _In_ ULONG EmptyBDs, _In_ ULONG DmaOwnedBDs, _In_ ULONG LowWaterMark, _In_ ULONG Batch);
+
+#endif // _MP_RX_POOL_H
@@ -0,0 +1,158 @@
+/*
+* Copyright 2023 NXP
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted (subject to the limitations in the disclaimer
+* below) provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of NXP nor the names of its contributors may be used to
+* endorse or promote products derived from this software without specific prior
+* written permission.
+*
+* NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS
+* LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+* THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+* GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include <wdm.h>
+#include "mp_tx_lso.h"
+
+#define ETH_HEADER_LENGTH         14U
+#define ETH_TYPE_OFFSET           12U
+#define ETH_TYPE_VLAN             0x8100U
+#define ETH_VLAN_TAG_SIZE         4U
+#define IPV4_MIN_HEADER_LENGTH    20U
+#define IPV6_FIXED_HEADER_LENGTH  40U
+
+static USHORT MpTxLsoGetUshort(_In_reads_bytes_(2) const UCHAR *p)
+{
+    return (USHORT)(((USHORT)p[0] << 8) | p[1]);
+}
+
+static ULONG MpTxLsoGetUlong(_In_reads_bytes_(4) const UCHAR *p)
+{
+    return ((ULONG)p[0] << 24) | ((ULONG)p[1] << 16) | ((ULONG)p[2] << 8) | p[3];
+}
+
+static void MpTxLsoPutUshort(_Out_writes_bytes_(2) UCHAR *p, _In_ ULONG Value)
+{
+    p[0] = (UCHAR)(Value >> 8);
+    p[1] = (UCHAR)Value;
+}
+
+static void MpTxLsoPutUlong(_Out_writes_bytes_(4) UCHAR *p, _In_ ULONG Value)
+{
+    p[0] = (UCHAR)(Value >> 24);
+    p[1] = (UCHAR)(Value >> 16);
+    p[2] = (UCHAR)(Value >> 8);
+    p[3] = (UCHAR)Value;
+}
+
+/*++
+Routine Description:
+    Parses the headers of a LSOv2 NET_BUFFER. IPv4 with options and IPv6 without extension headers are supported,
+    TCP options are copied to each segment as they are.
+Arguments:
+    pLso                The segmentation parameters
+    pFrame              The beginning of the NET_BUFFER data
+    Length              Number of bytes at pFrame, at least up to the end of the fixed part of the TCP header
+    TcpHeaderOffset     TCP header offset given by NDIS (NDIS_TCP_LARGE_SEND_OFFLOAD_NET_BUFFER_LIST_INFO)
+    IsIPv6              IP version given by NDIS
+Return Value:
+    FALSE if the headers can not be segmented, otherwise TRUE.
+--*/
+_Use_decl_annotations_
+BOOLEAN MpTxLsoParseHeader(PMP_TX_LSO_HEADER pLso, const UCHAR *pFrame, ULONG Length, ULONG TcpHeaderOffset, BOOLEAN IsIPv6)
+{
+    ULONG IpHeaderOffset = ETH_HEADER_LENGTH;
+    ULONG TcpHeaderLength;
+
+    RtlZeroMemory(pLso, sizeof(MP_TX_LSO_HEADER));
+    if ((Length < ETH_HEADER_LENGTH) || (TcpHeaderOffset + TCP_HEADER_MIN_LENGTH > Length)) {
+        return FALSE;
+    }
+    if (MpTxLsoGetUshort(&pFrame[ETH_TYPE_OFFSET]) == ETH_TYPE_VLAN) {
+        IpHeaderOffset += ETH_VLAN_TAG_SIZE;
+    }
+    if (IsIPv6) {
+        if (((pFrame[IpHeaderOffset] >> 4) != 6U) || (TcpHeaderOffset != IpHeaderOffset + IPV6_FIXED_HEADER_LENGTH) ||
+            (pFrame[IpHeaderOffset + IPV6_HEADER_NEXT_HEADER_OFFSET] != IP_PROTOCOL_TCP)) {
+            return FALSE;                                                          // Extension headers are not supported
+        }
+    } else {
+        ULONG IpHeaderLength = (pFrame[IpHeaderOffset] & 0x0FU) * 4U;
+        if (((pFrame[IpHeaderOffset] >> 4) != 4U) || (IpHeaderLength < IPV4_MIN_HEADER_LENGTH) ||
+            (TcpHeaderOffset != IpHeaderOffset + IpHeaderLength) || (pFrame[IpHeaderOffset + IPV4_HEADER_PROTOCOL_OFFSET] != IP_PROTOCOL_TCP)) {
+            return FALSE;
+        }
+        pLso->IpId = MpTxLsoGetUshort(&pFrame[IpHeaderOffset + IPV4_HEADER_ID_OFFSET]);
+    }
+    TcpHeaderLength = (pFrame[TcpHeaderOffset + TCP_HEADER_DATA_OFFSET] >> 4) * 4U;
+    if ((TcpHeaderLength < TCP_HEADER_MIN_LENGTH) || (TcpHeaderOffset + TcpHeaderLength > MP_TX_LSO_MAX_HEADER_SIZE)) {
+        return FALSE;
+    }
+    pLso->IpHeaderOffset  = IpHeaderOffset;
+    pLso->TcpHeaderOffset = TcpHeaderOffset;
+    pLso->HeaderLength    = TcpHeaderOffset + TcpHeaderLength;
+    pLso->IsIPv6          = IsIPv6;
+    pLso->TcpFlags        = pFrame[TcpHeaderOffset + TCP_HEADER_FLAGS_OFFSET];
+    pLso->TcpSequence     = MpTxLsoGetUlong(&pFrame[TcpHeaderOffset + TCP_HEADER_SEQUENCE_OFFSET]);
+    return TRUE;
+}
+
+/*++
+Routine Description:
+    Fixes up the copy of the NET_BUFFER headers for one segment. FIN and PSH are kept on the last segment only,
+    CWR on the first one only. The IPv4 header checksum and the TCP checksum are cleared, ENET inserts them.
+Arguments:
+    pLso            The segmentation parameters
+    pHeader         The copy of the first pLso->HeaderLength bytes of the NET_BUFFER
+    SegmentIdx      Index of the segment
+    SegmentSize     Payload bytes of each segment but the last one (MSS)
+    PayloadLength   Payload bytes of this segment
+    IsLastSegment   TRUE for the last segment
+Return Value:
+    None
+--*/
+_Use_decl_annotations_
+void MpTxLsoBuildHeader(const MP_TX_LSO_HEADER *pLso, UCHAR *pHeader, ULONG SegmentIdx, ULONG SegmentSize, ULONG PayloadLength, BOOLEAN IsLastSegment)
+{
+    UCHAR *pIp = &pHeader[pLso->IpHeaderOffset];
+    UCHAR *pTcp = &pHeader[pLso->TcpHeaderOffset];
+    ULONG  IpLength = pLso->HeaderLength - pLso->IpHeaderOffset + PayloadLength;
+    UCHAR  TcpFlags = pLso->TcpFlags;
+
+    if (pLso->IsIPv6) {
+        MpTxLsoPutUshort(&pIp[IPV6_HEADER_PAYLOAD_LENGTH_OFFSET], IpLength - IPV6_FIXED_HEADER_LENGTH);
+    } else {
+        MpTxLsoPutUshort(&pIp[IPV4_HEADER_TOTAL_LENGTH_OFFSET], IpLength);
+        MpTxLsoPutUshort(&pIp[IPV4_HEADER_ID_OFFSET], (USHORT)(pLso->IpId + SegmentIdx));
+        MpTxLsoPutUshort(&pIp[IPV4_HEADER_CHECKSUM_OFFSET], 0);
+    }
+    MpTxLsoPutUlong(&pTcp[TCP_HEADER_SEQUENCE_OFFSET], pLso->TcpSequence + SegmentIdx * SegmentSize);
+    if (!IsLastSegment) {
+        TcpFlags &= (UCHAR)~(TCP_FLAG_FIN | TCP_FLAG_PSH);
+    }
+    if (SegmentIdx != 0) {
+        TcpFlags &= (UCHAR)~TCP_FLAG_CWR;
+    }
+    pTcp[TCP_HEADER_FLAGS_OFFSET] = TcpFlags;
+    MpTxLsoPutUshort(&pTcp[TCP_HEADER_CHECKSUM_OFFSET], 0);
+}
@@ -0,0 +1,75 @@
+/*
+* Copyright 2023 NXP
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted (subject to the limitations in the disclaimer
+* below) provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of NXP nor the names of its contributors may be used to
+* endorse or promote products derived from this software without specific prior
+* written permission.
+*
+* NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS
+* LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+* THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+* GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#ifndef _MP_TX_LSO_H
+#define _MP_TX_LSO_H
+
+// Builds the headers of the segments of a large send offload (LSOv2) NET_BUFFER. The headers of the NET_BUFFER are
+// copied in front of each segment payload, the IP length, IPv4 identification, TCP sequence number and TCP flags are
+// fixed up per segment and the checksums are left cleared for the ENET to insert.
+// Only needs the types of wdm.h, so it can be run on the host.
+
+#define MP_TX_LSO_MAX_HEADER_SIZE     256U  // Ethernet (VLAN) + IP + TCP headers
+#define MP_TX_LSO_MIN_SEGMENT_COUNT   2U
+
+#define TCP_HEADER_SEQUENCE_OFFSET    4U
+#define TCP_HEADER_DATA_OFFSET        12U   // Header length in 32-bit words, upper nibble
+#define TCP_HEADER_FLAGS_OFFSET       13U
+#define TCP_HEADER_CHECKSUM_OFFSET    16U
+#define TCP_HEADER_MIN_LENGTH         20U
+#define TCP_FLAG_FIN                  0x01U
+#define TCP_FLAG_PSH                  0x08U
+#define TCP_FLAG_CWR                  0x80U
+
+#define IPV4_HEADER_TOTAL_LENGTH_OFFSET   2U
+#define IPV4_HEADER_ID_OFFSET             4U
+#define IPV4_HEADER_PROTOCOL_OFFSET       9U
+#define IPV4_HEADER_CHECKSUM_OFFSET       10U
+#define IPV6_HEADER_PAYLOAD_LENGTH_OFFSET 4U
+#define IPV6_HEADER_NEXT_HEADER_OFFSET    6U
+#define IP_PROTOCOL_TCP                   6U
+
+typedef struct _MP_TX_LSO_HEADER {
+    ULONG    IpHeaderOffset;      // Offset of the IP header in the frame
+    ULONG    TcpHeaderOffset;     // Offset of the TCP header in the frame
+    ULONG    HeaderLength;        // Bytes copied in front of each segment payload
+    BOOLEAN  IsIPv6;
+    UCHAR    TcpFlags;            // TCP flags of the NET_BUFFER
+    USHORT   IpId;                // IPv4 identification of the first segment
+    ULONG    TcpSequence;         // TCP sequence number of the first segment
+} MP_TX_LSO_HEADER, *PMP_TX_LSO_HEADER;
+
+BOOLEAN MpTxLsoParseHeader(_Out_ PMP_TX_LSO_HEADER pLso, _In_reads_bytes_(Length) const UCHAR *pFrame, _In_ ULONG Length, _In_ ULONG TcpHeaderOffset, _In_ BOOLEAN IsIPv6);
+void    MpTxLsoBuildHeader(_In_ const MP_TX_LSO_HEADER *pLso, _Inout_updates_bytes_(pLso->HeaderLength) UCHAR *pHeader, _In_ ULONG SegmentIdx, _In_ ULONG SegmentSize, _In_ ULONG PayloadLength, _In_ BOOLEAN IsLastSegment);
+
+#endif // _MP_TX_LSO_H
@@ -45,7 +45,11 @@
 #include "mp_mdio.h"
 #include "mp_enet_phy.h"
 #include "mp_hw.h"
+#include "mp_tx_lso.h"
+#include "mp_int_mod.h"
+#include "mp_rx_pool.h"
 #include "mp.h"
 #include "mp_data_path.h"
+#include "mp_tx_map.h"
 #include "mp_dbg.h"
 #include "mp_acpi.h"
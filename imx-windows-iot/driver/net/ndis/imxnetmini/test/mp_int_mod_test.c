@@ -0,0 +1,300 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host unit test of the adaptive interrupt moderation
+//
+// Synthetic packet traces are played against a model of the ENET
+// coalescing: the interrupt is raised when the frame threshold is reached
+// or when the time threshold passed after the first frame, each interrupt
+// is accounted with MpIntModUpdate() and new thresholds are taken as the
+// driver takes them. Checks the level each rate settles at, the latency the
+// coalescing adds, the hysteresis at a level boundary, the way down after
+// a burst, and the register values of the thresholds.
+//
+
+#include "../mp_int_mod.c"
+#include "HostTest.h"
+
+typedef struct {
+    MP_INT_MOD  IntMod;
+    ULONG64     Now_us;
+    ULONG64     NextArrival_ns;
+    ULONG       Pending;
+    ULONG64     FirstPending_us;
+    ULONG       FrameThreshold;
+    ULONG       TimeThreshold_us;
+    ULONG       MaxAddedLatency_us;
+    ULONG       LevelChanges;
+} SIM;
+
+static void
+SimInit(
+    SIM    *pSim,
+    BOOLEAN Adaptive)
+{
+    memset(pSim, 0, sizeof(*pSim));
+    pSim->Now_us = 1000000;
+    pSim->NextArrival_ns = pSim->Now_us * 1000;
+    MpIntModInit(&pSim->IntMod, Adaptive, pSim->Now_us);
+    pSim->FrameThreshold = pSim->IntMod.Stats.FrameThreshold;
+    pSim->TimeThreshold_us = pSim->IntMod.Stats.TimeThreshold_us;
+}
+
+static void
+SimInterrupt(
+    SIM    *pSim)
+{
+    ULONG Latency_us = (ULONG)(pSim->Now_us - pSim->FirstPending_us);
+
+    if (Latency_us > pSim->MaxAddedLatency_us) {
+        pSim->MaxAddedLatency_us = Latency_us;
+    }
+    if (MpIntModUpdate(&pSim->IntMod, pSim->Pending, 2, pSim->Now_us)) {
+        pSim->FrameThreshold = pSim->IntMod.Stats.FrameThreshold;                 // Written to ENET_RXIC/ENET_TXIC
+        pSim->TimeThreshold_us = pSim->IntMod.Stats.TimeThreshold_us;
+        pSim->LevelChanges++;
+    }
+    pSim->Pending = 0;
+}
+
+// Plays Duration_ms of traffic at Rate packets/s, 0 for no traffic
+static void
+SimRun(
+    SIM    *pSim,
+    ULONG   Rate,
+    ULONG   Duration_ms)
+{
+    ULONG64 End_us = pSim->Now_us + (ULONG64)Duration_ms * 1000;
+
+    if (Rate == 0) {
+        pSim->NextArrival_ns = MAXULONG * 1000000000ULL;
+    } else if (pSim->NextArrival_ns > (pSim->Now_us + 1000000) * 1000) {
+        pSim->NextArrival_ns = pSim->Now_us * 1000;                                // Traffic comes back after an idle time
+    }
+    for (; pSim->Now_us < End_us; pSim->Now_us++) {
+        while (pSim->NextArrival_ns <= pSim->Now_us * 1000) {
+            if (pSim->Pending++ == 0) {
+                pSim->FirstPending_us = pSim->Now_us;
+            }
+            pSim->NextArrival_ns += 1000000000ULL / Rate;
+            if ((pSim->TimeThreshold_us == 0) || (pSim->Pending >= pSim->FrameThreshold)) {
+                SimInterrupt(pSim);                                                // Interrupt per frame or frame threshold reached
+            }
+        }
+        if ((pSim->Pending != 0) && (pSim->Now_us - pSim->FirstPending_us >= pSim->TimeThreshold_us)) {
+            SimInterrupt(pSim);                                                    // Time threshold passed
+        }
+    }
+}
+
+static void
+TestSteadyRates(void)
+{
+    static const ULONG  Rates[][2] = {
+        // packets/s, level
+        {    1000, 0 },
+        {   19000, 0 },
+        {   25000, 1 },
+        {   60000, 2 },
+        {  150000, 3 },
+        {  400000, 4 },
+        { 1488000, 4 },
+    };
+
+    for (ULONG Idx = 0; Idx < sizeof(Rates) / sizeof(Rates[0]); Idx++) {
+        SIM Sim;
+
+        SimInit(&Sim, TRUE);
+        SimRun(&Sim, Rates[Idx][0], 200);
+        CHECK(Sim.IntMod.Stats.Level == Rates[Idx][1]);
+
+        // The rate is measured well, and the coalescing adds no more than its time threshold
+        CHECK(Sim.IntMod.Stats.PacketRate >= Rates[Idx][0] - Rates[Idx][0] / 50);
+        CHECK(Sim.IntMod.Stats.PacketRate <= Rates[Idx][0] + Rates[Idx][0] / 50);
+        CHECK(Sim.MaxAddedLatency_us <= MpIntModLevels[Rates[Idx][1]].TimeThreshold_us);
+
+        // One level change on the way up, straight to the level of the rate
+        CHECK(Sim.LevelChanges == ((Rates[Idx][1] != 0) ? 1U : 0U));
+
+        // Coalescing cuts the interrupt rate
+        if (Rates[Idx][1] != 0) {
+            CHECK(Sim.IntMod.Stats.PacketsPerInterrupt > 1);
+            CHECK(Sim.IntMod.Stats.InterruptRate <= Rates[Idx][0] / 2);
+        } else {
+            CHECK(Sim.IntMod.Stats.PacketsPerInterrupt == 1);
+        }
+    }
+}
+
+static void
+TestRaiseWithinWindow(void)
+{
+    SIM Sim;
+
+    SimInit(&Sim, TRUE);
+    SimRun(&Sim, 5000, 50);
+    CHECK(0 == Sim.IntMod.Stats.Level);
+
+    // A burst is picked up at the end of the first window that sees it
+    SimRun(&Sim, 300000, 2 * MP_INT_MOD_WINDOW_US / 1000 + 1);
+    CHECK(4 == Sim.IntMod.Stats.Level);
+    CHECK(1 == Sim.LevelChanges);
+}
+
+static void
+TestHysteresis(void)
+{
+    SIM     Sim;
+    ULONG   Changes;
+
+    SimInit(&Sim, TRUE);
+    SimRun(&Sim, 55000, 100);
+    CHECK(2 == Sim.IntMod.Stats.Level);
+    Changes = Sim.LevelChanges;
+
+    // Rate going back and forth over the 50000 packets/s boundary, never under 3/4 of it
+    for (ULONG Idx = 0; Idx < 50; Idx++) {
+        SimRun(&Sim, (Idx & 1) ? 52000 : 45000, MP_INT_MOD_WINDOW_US / 1000);
+    }
+    CHECK(2 == Sim.IntMod.Stats.Level);
+    CHECK(Changes == Sim.LevelChanges);
+
+    // Under 3/4 of the rate for one window only, and back
+    SimRun(&Sim, 30000, MP_INT_MOD_WINDOW_US / 1000);
+    SimRun(&Sim, 55000, 3 * MP_INT_MOD_WINDOW_US / 1000);
+    CHECK(2 == Sim.IntMod.Stats.Level);
+    CHECK(Changes == Sim.LevelChanges);
+}
+
+static void
+TestWayDown(void)
+{
+    SIM     Sim;
+    ULONG64 Start_us;
+    ULONG   Windows;
+
+    SimInit(&Sim, TRUE);
+    SimRun(&Sim, 500000, 100);
+    CHECK(4 == Sim.IntMod.Stats.Level);
+
+    // Idle link, no interrupt, the level is kept until traffic comes back
+    SimRun(&Sim, 0, 1000);
+    CHECK(4 == Sim.IntMod.Stats.Level);
+
+    // Slow traffic after the burst: the first window still sees the idle time, the level is lowered at the end of
+    // MP_INT_MOD_DOWN_WINDOWS windows, straight to level 0, and no frame waits longer than the time threshold
+    Start_us = Sim.Now_us;
+    SimRun(&Sim, 2000, 100);
+    CHECK(0 == Sim.IntMod.Stats.Level);
+    CHECK(2 == Sim.LevelChanges);
+    CHECK(Sim.MaxAddedLatency_us <= MpIntModLevels[4].TimeThreshold_us);
+    CHECK(Sim.IntMod.WindowStart_us - Start_us < 100000);
+
+    // A single window under the rate is not enough
+    SimInit(&Sim, TRUE);
+    SimRun(&Sim, 120000, 100);
+    CHECK(3 == Sim.IntMod.Stats.Level);
+    Start_us = Sim.IntMod.WindowStart_us;
+    while (Start_us == Sim.IntMod.WindowStart_us) {
+        SimRun(&Sim, 120000, 1);                                                   // Slow down as a window starts
+    }
+    Windows = 0;
+    for (ULONG Ms = 0; (Ms < 100) && (3 == Sim.IntMod.Stats.Level); Ms++) {
+        ULONG64 WindowStart_us = Sim.IntMod.WindowStart_us;
+
+        SimRun(&Sim, 20000, 1);
+        if (Sim.IntMod.WindowStart_us != WindowStart_us) {
+            Windows++;
+        }
+    }
+    CHECK(1 == Sim.IntMod.Stats.Level);
+    CHECK(MP_INT_MOD_DOWN_WINDOWS == Windows);
+}
+
+static void
+TestNotAdaptive(void)
+{
+    SIM Sim;
+
+    SimInit(&Sim, FALSE);
+    SimRun(&Sim, 500000, 100);
+    CHECK(0 == Sim.IntMod.Stats.Level);
+    CHECK(0 == Sim.LevelChanges);
+    CHECK(Sim.IntMod.Stats.Interrupts == Sim.IntMod.Stats.Packets);
+    CHECK(Sim.IntMod.Stats.PacketRate > 490000);
+
+    // Disabling the coalescing on the fly returns to the interrupt per frame
+    SimInit(&Sim, TRUE);
+    SimRun(&Sim, 500000, 100);
+    CHECK(4 == Sim.IntMod.Stats.Level);
+    CHECK(!MpIntModSetAdaptive(&Sim.IntMod, TRUE));
+    CHECK(MpIntModSetAdaptive(&Sim.IntMod, FALSE));
+    CHECK(0 == Sim.IntMod.Stats.Level);
+    CHECK((1 == Sim.IntMod.Stats.FrameThreshold) && (0 == Sim.IntMod.Stats.TimeThreshold_us));
+    CHECK(!MpIntModSetAdaptive(&Sim.IntMod, FALSE));
+}
+
+static void
+TestHistograms(void)
+{
+    SIM     Sim;
+    ULONG64 Latencies = 0;
+    ULONG64 PacketsPerInterrupt = 0;
+
+    SimInit(&Sim, TRUE);
+    SimRun(&Sim, 1000, 50);
+    SimRun(&Sim, 250000, 50);
+    for (ULONG Idx = 0; Idx < MP_INT_MOD_HISTOGRAM_SIZE; Idx++) {
+        Latencies += Sim.IntMod.Stats.LatencyHistogram[Idx];
+        PacketsPerInterrupt += Sim.IntMod.Stats.PacketsPerInterruptHistogram[Idx];
+    }
+    CHECK(Latencies == Sim.IntMod.Stats.Interrupts);
+    CHECK(PacketsPerInterrupt == Sim.IntMod.Stats.Interrupts);
+    CHECK(Sim.IntMod.Stats.LatencyHistogram[2] == Sim.IntMod.Stats.Interrupts);   // 2 us
+    CHECK(Sim.IntMod.Stats.PacketsPerInterruptHistogram[1] != 0);                 // 1 packet
+    CHECK(Sim.IntMod.Stats.PacketsPerInterruptHistogram[6] != 0);                 // 32 - 63 packets, the time threshold is reached first
+
+    CHECK(0 == MpIntModGetHistogramBucket(0));
+    CHECK(1 == MpIntModGetHistogramBucket(1));
+    CHECK(2 == MpIntModGetHistogramBucket(3));
+    CHECK(3 == MpIntModGetHistogramBucket(4));
+    CHECK(MP_INT_MOD_HISTOGRAM_SIZE - 1 == MpIntModGetHistogramBucket(MAXULONG));
+}
+
+static void
+TestThresholds(void)
+{
+    MP_INT_MOD  IntMod;
+    ULONG       FrameThreshold;
+    ULONG       TimerThreshold;
+
+    MpIntModInit(&IntMod, TRUE, 0);
+    CHECK(!MpIntModGetThresholds(&IntMod, 125000, &FrameThreshold, &TimerThreshold));
+    CHECK((0 == FrameThreshold) && (0 == TimerThreshold));
+
+    MpIntModSetLevel(&IntMod, 1);
+    CHECK(!MpIntModGetThresholds(&IntMod, 0, &FrameThreshold, &TimerThreshold));
+    CHECK(MpIntModGetThresholds(&IntMod, 125000, &FrameThreshold, &TimerThreshold));
+    CHECK((8 == FrameThreshold) && (98 == TimerThreshold));                        // 50 us of 64 clocks at 125 MHz, rounded up
+
+    MpIntModSetLevel(&IntMod, 4);
+    CHECK(MpIntModGetThresholds(&IntMod, 266000, &FrameThreshold, &TimerThreshold));
+    CHECK((64 == FrameThreshold) && (1040 == TimerThreshold));
+    CHECK(MpIntModGetThresholds(&IntMod, 100000000, &FrameThreshold, &TimerThreshold));
+    CHECK(MP_INT_MOD_MAX_TIMER_THRESHOLD == TimerThreshold);
+}
+
+int
+main(void)
+{
+    TestSteadyRates();
+    TestRaiseWithinWindow();
+    TestHysteresis();
+    TestWayDown();
+    TestNotAdaptive();
+    TestHistograms();
+    TestThresholds();
+
+    return HostTestResult("mp_int_mod_test");
+}
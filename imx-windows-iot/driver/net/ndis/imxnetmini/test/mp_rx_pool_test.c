@@ -0,0 +1,333 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host unit test of the RX buffer pool
+//
+// MpRxPoolPut(), MpRxPoolGet() and the refill decisions of
+// MpRxPoolGetRefillCount() are checked one by one, then a simulated RX BD
+// ring is run under bursts: the DMA fills the BDs it owns, the receive DPC
+// indicates the frames to a simulated NDIS that returns them late, and the
+// BDs are refilled from the pool the way MpRxRefill() does it. Every buffer
+// must be in exactly one place at any time, and with spare buffers in the
+// pool the ring must never run dry.
+//
+
+#include "../mp_rx_pool.c"
+#include "HostTest.h"
+
+#define MAX_BUFFERS     512
+#define MAX_RING        256
+
+typedef enum {
+    BUFFER_IN_POOL,
+    BUFFER_IN_RING,
+    BUFFER_IN_NDIS,
+} BUFFER_PLACE;
+
+typedef struct {
+    ULONG           Id;
+    BUFFER_PLACE    Place;
+} BUFFER;
+
+static uint32_t g_Seed = 1;
+
+static ULONG
+Random(
+    ULONG   Range)
+{
+    g_Seed = g_Seed * 1103515245 + 12345;
+    return (g_Seed >> 8) % Range;
+}
+
+static void
+TestPutGet(void)
+{
+    PVOID       Entries[4];
+    BUFFER      Buffers[5];
+    MP_RX_POOL  Pool;
+
+    MpRxPoolInit(&Pool, Entries, 4);
+    CHECK((0 == Pool.Count) && (4 == Pool.MinCount) && (0 == Pool.Shortages));
+    CHECK(NULL == MpRxPoolGet(&Pool));
+
+    for (ULONG Idx = 0; Idx < 4; Idx++) {
+        CHECK(MpRxPoolPut(&Pool, &Buffers[Idx]));
+    }
+    CHECK(!MpRxPoolPut(&Pool, &Buffers[4]));                                       // Full
+    CHECK(4 == Pool.Count);
+
+    // LIFO, the buffer returned last is handed out first
+    CHECK(&Buffers[3] == MpRxPoolGet(&Pool));
+    CHECK(&Buffers[2] == MpRxPoolGet(&Pool));
+    CHECK(2 == Pool.MinCount);
+    CHECK(MpRxPoolPut(&Pool, &Buffers[4]));
+    CHECK(&Buffers[4] == MpRxPoolGet(&Pool));
+    CHECK(&Buffers[1] == MpRxPoolGet(&Pool));
+    CHECK(&Buffers[0] == MpRxPoolGet(&Pool));
+    CHECK(NULL == MpRxPoolGet(&Pool));
+    CHECK(0 == Pool.MinCount);
+    CHECK(MpRxPoolPut(&Pool, &Buffers[0]));
+    CHECK(0 == Pool.MinCount);
+}
+
+static void
+TestRefillBatch(void)
+{
+    CHECK(1 == MpRxPoolGetRefillBatch(0));
+    CHECK(1 == MpRxPoolGetRefillBatch(3));
+    CHECK(1 == MpRxPoolGetRefillBatch(4));
+    CHECK(4 == MpRxPoolGetRefillBatch(16));
+    CHECK(16 == MpRxPoolGetRefillBatch(64));
+    CHECK(MP_RX_POOL_REFILL_BATCH == MpRxPoolGetRefillBatch(512));
+}
+
+static void
+TestRefillCount(void)
+{
+    PVOID       Entries[64];
+    BUFFER      Buffers[64];
+    MP_RX_POOL  Pool;
+
+    MpRxPoolInit(&Pool, Entries, 64);
+    for (ULONG Idx = 0; Idx < 40; Idx++) {
+        MpRxPoolPut(&Pool, &Buffers[Idx]);
+    }
+
+    // 128 BDs ring, batch of 16, low water mark at 32 BDs owned by the DMA
+    CHECK(0 == MpRxPoolGetRefillCount(&Pool, 0, 128, 32, 16));
+    CHECK(0 == MpRxPoolGetRefillCount(&Pool, 15, 113, 32, 16));                   // Wait for a batch
+    CHECK(16 == MpRxPoolGetRefillCount(&Pool, 16, 112, 32, 16));
+    CHECK(30 == MpRxPoolGetRefillCount(&Pool, 30, 98, 32, 16));
+    CHECK(0 == MpRxPoolGetRefillCount(&Pool, 5, 33, 32, 16));
+    CHECK(5 == MpRxPoolGetRefillCount(&Pool, 5, 32, 32, 16));                     // Ring low, refill at once
+    CHECK(1 == MpRxPoolGetRefillCount(&Pool, 1, 0, 32, 16));
+    CHECK(0 == Pool.Shortages);
+
+    // Not more than the pool has
+    CHECK(40 == MpRxPoolGetRefillCount(&Pool, 100, 28, 32, 16));
+    CHECK(1 == Pool.Shortages);
+    Pool.Count = 0;
+    CHECK(0 == MpRxPoolGetRefillCount(&Pool, 16, 112, 32, 16));
+    CHECK(2 == Pool.Shortages);
+    CHECK(0 == MpRxPoolGetRefillCount(&Pool, 10, 112, 32, 16));                   // No refill due, no shortage
+    CHECK(2 == Pool.Shortages);
+}
+
+//
+// Simulated RX BD ring
+//
+
+typedef struct {
+    ULONG       RingSize;
+    ULONG       BufferCount;
+    ULONG       LowWaterMark;
+    ULONG       Batch;
+    BUFFER      Buffers[MAX_BUFFERS];
+    PVOID       PoolEntries[MAX_BUFFERS];
+    MP_RX_POOL  Pool;
+    BUFFER     *pRing[MAX_RING];        // Buffer of each BD, NULL if the BD is empty
+    BOOLEAN     Filled[MAX_RING];       // The DMA wrote a frame to the BD
+    ULONG       DmaIdx;                 // Next BD the DMA fills
+    ULONG       ReceiveIdx;             // Next BD the DPC takes a frame from
+    ULONG       FreeIdx;                // Next BD to refill
+    ULONG       DmaOwned;
+    BUFFER     *pNdis[MAX_BUFFERS];
+    ULONG       NdisCount;
+    ULONG64     Frames;
+    ULONG64     Dropped;
+} SIM;
+
+static void
+SimInit(
+    SIM    *pSim,
+    ULONG   RingSize,
+    ULONG   BufferCount)
+{
+    memset(pSim, 0, sizeof(*pSim));
+    pSim->RingSize = RingSize;
+    pSim->BufferCount = BufferCount;
+    pSim->LowWaterMark = RingSize / 4;
+    pSim->Batch = MpRxPoolGetRefillBatch(RingSize);
+    MpRxPoolInit(&pSim->Pool, pSim->PoolEntries, BufferCount);
+    for (ULONG Idx = 0; Idx < BufferCount; Idx++) {
+        pSim->Buffers[Idx].Id = Idx;
+        pSim->Buffers[Idx].Place = BUFFER_IN_POOL;
+        CHECK(MpRxPoolPut(&pSim->Pool, &pSim->Buffers[Idx]));
+    }
+}
+
+// MpRxRefill()
+static void
+SimRefill(
+    SIM    *pSim)
+{
+    ULONG   RefillCount = MpRxPoolGetRefillCount(&pSim->Pool, pSim->RingSize - pSim->DmaOwned, pSim->DmaOwned, pSim->LowWaterMark, pSim->Batch);
+
+    for (ULONG Idx = 0; Idx < RefillCount; Idx++) {
+        BUFFER *pBuffer = (BUFFER *)MpRxPoolGet(&pSim->Pool);
+
+        CHECK(pBuffer != NULL);
+        if (pBuffer == NULL) {
+            return;
+        }
+        CHECK(pBuffer->Place == BUFFER_IN_POOL);
+        CHECK(pSim->pRing[pSim->FreeIdx] == NULL);
+        pBuffer->Place = BUFFER_IN_RING;
+        pSim->pRing[pSim->FreeIdx] = pBuffer;
+        pSim->Filled[pSim->FreeIdx] = FALSE;
+        pSim->FreeIdx = (pSim->FreeIdx + 1) % pSim->RingSize;
+    }
+    pSim->DmaOwned += RefillCount;
+}
+
+// The DMA receives Count frames, frames with no BD are dropped
+static void
+SimDmaReceive(
+    SIM    *pSim,
+    ULONG   Count)
+{
+    for (ULONG Idx = 0; Idx < Count; Idx++) {
+        pSim->Frames++;
+        if ((pSim->pRing[pSim->DmaIdx] == NULL) || pSim->Filled[pSim->DmaIdx]) {
+            pSim->Dropped++;
+            continue;
+        }
+        pSim->Filled[pSim->DmaIdx] = TRUE;
+        pSim->DmaIdx = (pSim->DmaIdx + 1) % pSim->RingSize;
+        pSim->DmaOwned--;
+    }
+}
+
+// Receive DPC, takes up to Budget frames, short frames are copied and their buffer goes back to the pool at once
+static void
+SimReceiveDpc(
+    SIM    *pSim,
+    ULONG   Budget)
+{
+    for (ULONG Idx = 0; Idx < Budget; Idx++) {
+        BUFFER *pBuffer = pSim->pRing[pSim->ReceiveIdx];
+
+        if ((pBuffer == NULL) || !pSim->Filled[pSim->ReceiveIdx]) {
+            break;
+        }
+        CHECK(pBuffer->Place == BUFFER_IN_RING);
+        pSim->pRing[pSim->ReceiveIdx] = NULL;
+        pSim->Filled[pSim->ReceiveIdx] = FALSE;
+        pSim->ReceiveIdx = (pSim->ReceiveIdx + 1) % pSim->RingSize;
+        if (Random(4) == 0) {
+            pBuffer->Place = BUFFER_IN_POOL;
+            CHECK(MpRxPoolPut(&pSim->Pool, pBuffer));
+        } else {
+            pBuffer->Place = BUFFER_IN_NDIS;
+            pSim->pNdis[pSim->NdisCount++] = pBuffer;
+        }
+    }
+    SimRefill(pSim);
+}
+
+// NDIS returns Count of the frames it holds, in any order
+static void
+SimNdisReturn(
+    SIM    *pSim,
+    ULONG   Count)
+{
+    for (ULONG Idx = 0; (Idx < Count) && (pSim->NdisCount != 0); Idx++) {
+        ULONG   Pick = Random(pSim->NdisCount);
+        BUFFER *pBuffer = pSim->pNdis[Pick];
+
+        pSim->pNdis[Pick] = pSim->pNdis[--pSim->NdisCount];
+        CHECK(pBuffer->Place == BUFFER_IN_NDIS);
+        pBuffer->Place = BUFFER_IN_POOL;
+        CHECK(MpRxPoolPut(&pSim->Pool, pBuffer));
+    }
+}
+
+static void
+SimCheckInvariants(
+    SIM    *pSim)
+{
+    ULONG   InRing = 0;
+    ULONG   InPool = 0;
+    ULONG   InNdis = 0;
+
+    for (ULONG Idx = 0; Idx < pSim->BufferCount; Idx++) {
+        InRing += (pSim->Buffers[Idx].Place == BUFFER_IN_RING);
+        InPool += (pSim->Buffers[Idx].Place == BUFFER_IN_POOL);
+        InNdis += (pSim->Buffers[Idx].Place == BUFFER_IN_NDIS);
+    }
+    CHECK(InPool == pSim->Pool.Count);
+    CHECK(InNdis == pSim->NdisCount);
+    CHECK(InRing + InPool + InNdis == pSim->BufferCount);
+    CHECK(pSim->DmaOwned <= InRing);
+    CHECK(pSim->Pool.MinCount <= pSim->Pool.Count);
+
+    // Each buffer in the pool once
+    for (ULONG Idx = 0; Idx < pSim->Pool.Count; Idx++) {
+        CHECK(((BUFFER *)pSim->Pool.ppEntries[Idx])->Place == BUFFER_IN_POOL);
+        for (ULONG Other = Idx + 1; Other < pSim->Pool.Count; Other++) {
+            CHECK(pSim->Pool.ppEntries[Idx] != pSim->Pool.ppEntries[Other]);
+        }
+    }
+}
+
+static void
+TestRing(
+    ULONG   RingSize,
+    ULONG   BufferCount,
+    ULONG   MaxNdisHeld,
+    BOOLEAN ExpectNoDrop)
+{
+    static SIM  Sim;
+
+    SimInit(&Sim, RingSize, BufferCount);
+    SimRefill(&Sim);
+    CHECK(Sim.DmaOwned == RingSize);
+
+    for (ULONG Step = 0; Step < 20000; Step++) {
+        ULONG   Burst = (Random(16) == 0) ? Random(RingSize - Sim.LowWaterMark + 1) : Random(Sim.LowWaterMark + 1);
+
+        if (ExpectNoDrop) {
+            CHECK(Sim.DmaOwned >= Burst);
+        }
+        SimDmaReceive(&Sim, Burst);
+        SimReceiveDpc(&Sim, RingSize);
+        if (Sim.NdisCount > MaxNdisHeld) {
+            SimNdisReturn(&Sim, Sim.NdisCount - MaxNdisHeld);
+        }
+        SimNdisReturn(&Sim, Random(Sim.NdisCount + 1));
+        SimRefill(&Sim);
+        if (Step % 64 == 0) {
+            SimCheckInvariants(&Sim);
+        }
+    }
+    SimCheckInvariants(&Sim);
+    SimNdisReturn(&Sim, Sim.NdisCount);
+    SimRefill(&Sim);
+    SimCheckInvariants(&Sim);
+    CHECK(Sim.Frames != 0);
+    if (ExpectNoDrop) {
+        CHECK(0 == Sim.Dropped);
+        CHECK(0 == Sim.Pool.Shortages);
+    } else {
+        CHECK(0 != Sim.Pool.Shortages);
+    }
+}
+
+int
+main(void)
+{
+    TestPutGet();
+    TestRefillBatch();
+    TestRefillCount();
+
+    // Spare buffers for everything NDIS holds plus a burst, the DMA never runs out of BDs
+    TestRing(64, 256, 256 - 64 - 48, TRUE);
+    TestRing(128, 384, 384 - 128 - 96, TRUE);
+    TestRing(8, 64, 64 - 8 - 6, TRUE);
+
+    // One buffer for each BD, the BDs of the frames NDIS holds stay empty
+    TestRing(64, 64, 48, FALSE);
+
+    return HostTestResult("mp_rx_pool_test");
+}
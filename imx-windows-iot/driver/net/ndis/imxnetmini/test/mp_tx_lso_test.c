@@ -0,0 +1,350 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host unit test of the LSOv2 header segmentation
+//
+// LSO NET_BUFFERs are parsed with MpTxLsoParseHeader() and split into
+// segments the way MpTxFillEnetTxBD() does it: the headers are copied in
+// front of each MSS sized payload and fixed up by MpTxLsoBuildHeader().
+// The segments are compared with golden frames written out by hand, then
+// random frames over IPv4 and IPv6, with and without VLAN tag, IP and TCP
+// options, are compared with a reference segmenter.
+//
+
+#include "../mp_tx_lso.c"
+#include "HostTest.h"
+
+#include <stdlib.h>
+
+#define FRAME_SIZE      (64 * 1024)
+
+typedef struct {
+    ULONG   Length;
+    UCHAR   Data[MP_TX_LSO_MAX_HEADER_SIZE + 2048];
+} SEGMENT;
+
+static uint32_t g_Seed = 1;
+
+static ULONG
+Random(
+    ULONG   Range)
+{
+    g_Seed = g_Seed * 1103515245 + 12345;
+    return (g_Seed >> 8) % Range;
+}
+
+// Splits the frame like the driver, returns the number of segments
+static ULONG
+Segment(
+    const UCHAR    *pFrame,
+    ULONG           Length,
+    ULONG           TcpHeaderOffset,
+    BOOLEAN         IsIPv6,
+    ULONG           Mss,
+    SEGMENT        *pSegments,
+    ULONG           MaxSegments)
+{
+    MP_TX_LSO_HEADER    Lso;
+    ULONG               SegmentCount;
+
+    if (!MpTxLsoParseHeader(&Lso, pFrame, Length, TcpHeaderOffset, IsIPv6)) {
+        return 0;
+    }
+    SegmentCount = (Length - Lso.HeaderLength + Mss - 1) / Mss;
+    CHECK(SegmentCount <= MaxSegments);
+    for (ULONG SegmentIdx = 0; SegmentIdx < SegmentCount; SegmentIdx++) {
+        ULONG PayloadOffset = Lso.HeaderLength + SegmentIdx * Mss;
+        ULONG PayloadLength = (Length - PayloadOffset > Mss) ? Mss : Length - PayloadOffset;
+
+        memcpy(pSegments[SegmentIdx].Data, pFrame, Lso.HeaderLength);
+        memcpy(pSegments[SegmentIdx].Data + Lso.HeaderLength, pFrame + PayloadOffset, PayloadLength);
+        pSegments[SegmentIdx].Length = Lso.HeaderLength + PayloadLength;
+        MpTxLsoBuildHeader(&Lso, pSegments[SegmentIdx].Data, SegmentIdx, Mss, PayloadLength, (BOOLEAN)(SegmentIdx + 1 == SegmentCount));
+    }
+    return SegmentCount;
+}
+
+//
+// IPv4, no options, 100 payload bytes sent with MSS 60.
+// CWR, PSH, FIN and ACK set on the NET_BUFFER.
+//
+
+static const UCHAR  g_Ipv4Header[] = {
+    0x02, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x00, 0x00, 0x00, 0x00, 0x02, 0x08, 0x00,
+    0x45, 0x00, 0x00, 0x8C, 0x12, 0x34, 0x40, 0x00, 0x40, 0x06, 0xAB, 0xCD,
+    0xC0, 0xA8, 0x00, 0x01, 0xC0, 0xA8, 0x00, 0x02,
+    0x1F, 0x90, 0xC3, 0x50, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x01,
+    0x50, 0x99, 0x01, 0x00, 0x55, 0xAA, 0x00, 0x00,
+};
+
+static const UCHAR  g_Ipv4Segment0[] = {
+    0x02, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x00, 0x00, 0x00, 0x00, 0x02, 0x08, 0x00,
+    0x45, 0x00, 0x00, 0x64, 0x12, 0x34, 0x40, 0x00, 0x40, 0x06, 0x00, 0x00,
+    0xC0, 0xA8, 0x00, 0x01, 0xC0, 0xA8, 0x00, 0x02,
+    0x1F, 0x90, 0xC3, 0x50, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x01,
+    0x50, 0x90, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+static const UCHAR  g_Ipv4Segment1[] = {
+    0x02, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x00, 0x00, 0x00, 0x00, 0x02, 0x08, 0x00,
+    0x45, 0x00, 0x00, 0x50, 0x12, 0x35, 0x40, 0x00, 0x40, 0x06, 0x00, 0x00,
+    0xC0, 0xA8, 0x00, 0x01, 0xC0, 0xA8, 0x00, 0x02,
+    0x1F, 0x90, 0xC3, 0x50, 0x00, 0x00, 0x10, 0x3C, 0x00, 0x00, 0x00, 0x01,
+    0x50, 0x19, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+//
+// VLAN tagged IPv6, 12 bytes of TCP options (NOP, NOP, timestamp), 250
+// payload bytes sent with MSS 100, the sequence number wraps.
+// PSH and ACK set on the NET_BUFFER.
+//
+
+static const UCHAR  g_Ipv6Header[] = {
+    0x02, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x00, 0x00, 0x00, 0x00, 0x02, 0x81, 0x00, 0x00, 0x05, 0x86, 0xDD,
+    0x60, 0x00, 0x00, 0x00, 0x01, 0x16, 0x06, 0x40,
+    0xFE, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+    0xFE, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02,
+    0x1F, 0x90, 0xC3, 0x50, 0xFF, 0xFF, 0xFF, 0xF0, 0x00, 0x00, 0x00, 0x01,
+    0x80, 0x18, 0x01, 0x00, 0x55, 0xAA, 0x00, 0x00,
+    0x01, 0x01, 0x08, 0x0A, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02,
+};
+
+static const UCHAR  g_Ipv6Segment2[] = {
+    0x02, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x00, 0x00, 0x00, 0x00, 0x02, 0x81, 0x00, 0x00, 0x05, 0x86, 0xDD,
+    0x60, 0x00, 0x00, 0x00, 0x00, 0x52, 0x06, 0x40,
+    0xFE, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+    0xFE, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02,
+    0x1F, 0x90, 0xC3, 0x50, 0x00, 0x00, 0x00, 0xB8, 0x00, 0x00, 0x00, 0x01,
+    0x80, 0x18, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x01, 0x01, 0x08, 0x0A, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02,
+};
+
+static void
+FillPayload(
+    UCHAR  *pFrame,
+    ULONG   HeaderLength,
+    ULONG   Length)
+{
+    for (ULONG Idx = HeaderLength; Idx < Length; Idx++) {
+        pFrame[Idx] = (UCHAR)(Idx * 7 + 3);
+    }
+}
+
+static void
+TestGoldenIpv4(void)
+{
+    static UCHAR    Frame[sizeof(g_Ipv4Header) + 100];
+    static SEGMENT  Segments[4];
+
+    memcpy(Frame, g_Ipv4Header, sizeof(g_Ipv4Header));
+    FillPayload(Frame, sizeof(g_Ipv4Header), sizeof(Frame));
+
+    CHECK(2 == Segment(Frame, sizeof(Frame), 34, FALSE, 60, Segments, 4));
+    CHECK(Segments[0].Length == sizeof(g_Ipv4Segment0) + 60);
+    CHECK(0 == memcmp(Segments[0].Data, g_Ipv4Segment0, sizeof(g_Ipv4Segment0)));
+    CHECK(0 == memcmp(Segments[0].Data + sizeof(g_Ipv4Segment0), Frame + sizeof(g_Ipv4Header), 60));
+    CHECK(Segments[1].Length == sizeof(g_Ipv4Segment1) + 40);
+    CHECK(0 == memcmp(Segments[1].Data, g_Ipv4Segment1, sizeof(g_Ipv4Segment1)));
+    CHECK(0 == memcmp(Segments[1].Data + sizeof(g_Ipv4Segment1), Frame + sizeof(g_Ipv4Header) + 60, 40));
+}
+
+static void
+TestGoldenIpv6(void)
+{
+    static UCHAR    Frame[sizeof(g_Ipv6Header) + 250];
+    static SEGMENT  Segments[4];
+
+    memcpy(Frame, g_Ipv6Header, sizeof(g_Ipv6Header));
+    FillPayload(Frame, sizeof(g_Ipv6Header), sizeof(Frame));
+
+    CHECK(3 == Segment(Frame, sizeof(Frame), 58, TRUE, 100, Segments, 4));
+    for (ULONG SegmentIdx = 0; SegmentIdx < 2; SegmentIdx++) {
+        const UCHAR *pHeader = Segments[SegmentIdx].Data;
+
+        CHECK(Segments[SegmentIdx].Length == sizeof(g_Ipv6Header) + 100);
+        CHECK((pHeader[22] == 0x00) && (pHeader[23] == 0x84));                     // Payload length, 32 TCP header bytes + 100
+        CHECK(pHeader[71] == 0x10);                                                // PSH cleared
+        CHECK((pHeader[74] == 0x00) && (pHeader[75] == 0x00));                     // TCP checksum cleared
+    }
+    CHECK(0 == memcmp(&Segments[0].Data[62], "\xFF\xFF\xFF\xF0", 4));
+    CHECK(0 == memcmp(&Segments[1].Data[62], "\x00\x00\x00\x54", 4));
+    CHECK(Segments[2].Length == sizeof(g_Ipv6Segment2) + 50);
+    CHECK(0 == memcmp(Segments[2].Data, g_Ipv6Segment2, sizeof(g_Ipv6Segment2)));
+    CHECK(0 == memcmp(Segments[2].Data + sizeof(g_Ipv6Segment2), Frame + sizeof(g_Ipv6Header) + 200, 50));
+}
+
+static void
+TestParseHeader(void)
+{
+    static UCHAR        Frame[512];
+    MP_TX_LSO_HEADER    Lso;
+
+    memcpy(Frame, g_Ipv4Header, sizeof(g_Ipv4Header));
+    CHECK(MpTxLsoParseHeader(&Lso, Frame, sizeof(g_Ipv4Header), 34, FALSE));
+    CHECK((14 == Lso.IpHeaderOffset) && (34 == Lso.TcpHeaderOffset) && (54 == Lso.HeaderLength));
+    CHECK(!Lso.IsIPv6 && (0x99 == Lso.TcpFlags) && (0x1234 == Lso.IpId) && (0x1000 == Lso.TcpSequence));
+
+    // The fixed TCP header must be in the buffer, and NDIS must agree with the headers
+    CHECK(!MpTxLsoParseHeader(&Lso, Frame, 53, 34, FALSE));
+    CHECK(!MpTxLsoParseHeader(&Lso, Frame, 10, 34, FALSE));
+    CHECK(!MpTxLsoParseHeader(&Lso, Frame, sizeof(g_Ipv4Header), 38, FALSE));
+    CHECK(!MpTxLsoParseHeader(&Lso, Frame, sizeof(g_Ipv4Header), 34, TRUE));
+
+    // Not TCP
+    Frame[23] = 17;
+    CHECK(!MpTxLsoParseHeader(&Lso, Frame, sizeof(g_Ipv4Header), 34, FALSE));
+    Frame[23] = 6;
+
+    // Bad IPv4 header length
+    Frame[14] = 0x44;
+    CHECK(!MpTxLsoParseHeader(&Lso, Frame, sizeof(g_Ipv4Header), 30, FALSE));
+    Frame[14] = 0x45;
+
+    // Bad TCP header length
+    Frame[46] = 0x40;
+    CHECK(!MpTxLsoParseHeader(&Lso, Frame, sizeof(g_Ipv4Header), 34, FALSE));
+    Frame[46] = 0x50;
+
+    // Longest IP and TCP options, with and without VLAN tag
+    memset(Frame, 0, sizeof(Frame));
+    memcpy(Frame, g_Ipv4Header, 14);
+    Frame[14] = 0x4F;                                                              // 40 bytes of IP options
+    Frame[23] = 6;
+    Frame[74 + 12] = 0xF0;                                                         // 40 bytes of TCP options
+    CHECK(MpTxLsoParseHeader(&Lso, Frame, sizeof(Frame), 74, FALSE));
+    CHECK(134 == Lso.HeaderLength);
+    memmove(Frame + 14 + 4, Frame + 14, sizeof(Frame) - 18);
+    memcpy(Frame + 12, "\x81\x00\x00\x05\x08\x00", 6);
+    CHECK(MpTxLsoParseHeader(&Lso, Frame, sizeof(Frame), 78, FALSE));
+    CHECK((18 == Lso.IpHeaderOffset) && (138 == Lso.HeaderLength));
+
+    // IPv6 extension headers are not supported
+    memcpy(Frame, g_Ipv6Header, sizeof(g_Ipv6Header));
+    CHECK(MpTxLsoParseHeader(&Lso, Frame, sizeof(g_Ipv6Header), 58, TRUE));
+    CHECK(Lso.IsIPv6 && (18 == Lso.IpHeaderOffset) && (90 == Lso.HeaderLength) && (0 == Lso.IpId));
+    Frame[24] = 0;                                                                 // Hop-by-hop options
+    CHECK(!MpTxLsoParseHeader(&Lso, Frame, sizeof(g_Ipv6Header), 58, TRUE));
+    CHECK(!MpTxLsoParseHeader(&Lso, Frame, sizeof(Frame), 66, TRUE));
+    Frame[24] = 6;
+    CHECK(!MpTxLsoParseHeader(&Lso, Frame, sizeof(g_Ipv6Header), 58, FALSE));
+}
+
+static void
+TestIpIdWrap(void)
+{
+    static UCHAR    Frame[sizeof(g_Ipv4Header) + 300];
+    static SEGMENT  Segments[4];
+
+    memcpy(Frame, g_Ipv4Header, sizeof(g_Ipv4Header));
+    Frame[18] = 0xFF;
+    Frame[19] = 0xFE;
+    FillPayload(Frame, sizeof(g_Ipv4Header), sizeof(Frame));
+
+    CHECK(3 == Segment(Frame, sizeof(Frame), 34, FALSE, 100, Segments, 4));
+    CHECK((Segments[0].Data[18] == 0xFF) && (Segments[0].Data[19] == 0xFE));
+    CHECK((Segments[1].Data[18] == 0xFF) && (Segments[1].Data[19] == 0xFF));
+    CHECK((Segments[2].Data[18] == 0x00) && (Segments[2].Data[19] == 0x00));
+}
+
+//
+// Random frames against a reference segmenter written from the RFCs
+//
+
+static void
+TestRandom(void)
+{
+    static UCHAR    Frame[FRAME_SIZE];
+    static SEGMENT  Segments[FRAME_SIZE / 64 + 1];
+
+    for (ULONG Iteration = 0; Iteration < 2000; Iteration++) {
+        BOOLEAN IsIPv6 = (BOOLEAN)Random(2);
+        BOOLEAN IsVlan = (BOOLEAN)Random(2);
+        ULONG   IpOffset = IsVlan ? 18 : 14;
+        ULONG   IpLength = IsIPv6 ? 40 : 20 + 4 * Random(11);
+        ULONG   TcpOffset = IpOffset + IpLength;
+        ULONG   TcpLength = 20 + 4 * Random(11);
+        ULONG   HeaderLength = TcpOffset + TcpLength;
+        ULONG   Mss = 64 + Random(1460 - 64 + 1);
+        ULONG   Length = HeaderLength + 1 + Random(Random(4) ? 4 * Mss : FRAME_SIZE - HeaderLength - 1);
+        UCHAR   Flags = (UCHAR)Random(256);
+        ULONG   Sequence = (ULONG)Random(0x10000) << 16 | Random(0x10000);
+        USHORT  IpId = (USHORT)Random(0x10000);
+        ULONG   SegmentCount;
+
+        for (ULONG Idx = 0; Idx < Length; Idx++) {
+            Frame[Idx] = (UCHAR)Random(256);
+        }
+        Frame[12] = IsVlan ? 0x81 : (IsIPv6 ? 0x86 : 0x08);
+        Frame[13] = IsVlan ? 0x00 : (IsIPv6 ? 0xDD : 0x00);
+        if (IsIPv6) {
+            Frame[IpOffset] = 0x60 | (Frame[IpOffset] & 0x0F);
+            Frame[IpOffset + 6] = 6;
+        } else {
+            Frame[IpOffset] = (UCHAR)(0x40 | (IpLength / 4));
+            Frame[IpOffset + 4] = (UCHAR)(IpId >> 8);
+            Frame[IpOffset + 5] = (UCHAR)IpId;
+            Frame[IpOffset + 9] = 6;
+        }
+        Frame[TcpOffset + 4] = (UCHAR)(Sequence >> 24);
+        Frame[TcpOffset + 5] = (UCHAR)(Sequence >> 16);
+        Frame[TcpOffset + 6] = (UCHAR)(Sequence >> 8);
+        Frame[TcpOffset + 7] = (UCHAR)Sequence;
+        Frame[TcpOffset + 12] = (UCHAR)((TcpLength / 4) << 4);
+        Frame[TcpOffset + 13] = Flags;
+
+        SegmentCount = Segment(Frame, Length, TcpOffset, IsIPv6, Mss, Segments, sizeof(Segments) / sizeof(Segments[0]));
+        CHECK(SegmentCount == (Length - HeaderLength + Mss - 1) / Mss);
+
+        for (ULONG SegmentIdx = 0; SegmentIdx < SegmentCount; SegmentIdx++) {
+            static UCHAR    Expected[MP_TX_LSO_MAX_HEADER_SIZE];
+            const SEGMENT  *pSegment = &Segments[SegmentIdx];
+            BOOLEAN         IsLast = (BOOLEAN)(SegmentIdx + 1 == SegmentCount);
+            ULONG           PayloadLength = IsLast ? Length - HeaderLength - SegmentIdx * Mss : Mss;
+            ULONG           SegmentSequence = Sequence + SegmentIdx * Mss;
+            UCHAR           SegmentFlags = Flags;
+
+            if (!IsLast) {
+                SegmentFlags &= 0xF6;                                              // FIN and PSH on the last segment only
+            }
+            if (SegmentIdx != 0) {
+                SegmentFlags &= 0x7F;                                              // CWR on the first segment only
+            }
+            memcpy(Expected, Frame, HeaderLength);
+            if (IsIPv6) {
+                Expected[IpOffset + 4] = (UCHAR)((TcpLength + PayloadLength) >> 8);
+                Expected[IpOffset + 5] = (UCHAR)(TcpLength + PayloadLength);
+            } else {
+                Expected[IpOffset + 2] = (UCHAR)((IpLength + TcpLength + PayloadLength) >> 8);
+                Expected[IpOffset + 3] = (UCHAR)(IpLength + TcpLength + PayloadLength);
+                Expected[IpOffset + 4] = (UCHAR)((IpId + SegmentIdx) >> 8);
+                Expected[IpOffset + 5] = (UCHAR)(IpId + SegmentIdx);
+                Expected[IpOffset + 10] = 0;
+                Expected[IpOffset + 11] = 0;
+            }
+            Expected[TcpOffset + 4] = (UCHAR)(SegmentSequence >> 24);
+            Expected[TcpOffset + 5] = (UCHAR)(SegmentSequence >> 16);
+            Expected[TcpOffset + 6] = (UCHAR)(SegmentSequence >> 8);
+            Expected[TcpOffset + 7] = (UCHAR)SegmentSequence;
+            Expected[TcpOffset + 13] = SegmentFlags;
+            Expected[TcpOffset + 16] = 0;
+            Expected[TcpOffset + 17] = 0;
+
+            CHECK(pSegment->Length == HeaderLength + PayloadLength);
+            CHECK(0 == memcmp(pSegment->Data, Expected, HeaderLength));
+            CHECK(0 == memcmp(pSegment->Data + HeaderLength, Frame + HeaderLength + SegmentIdx * Mss, PayloadLength));
+        }
+    }
+}
+
+int
+main(void)
+{
+    TestGoldenIpv4();
+    TestGoldenIpv6();
+    TestParseHeader();
+    TestIpIdWrap();
+    TestRandom();
+
+    return HostTestResult("mp_tx_lso_test");
+}
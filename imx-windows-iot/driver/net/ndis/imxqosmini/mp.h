@@ -186,9 +186,12 @@ typedef struct _MP_QUEUE {
 typedef struct _MP_TX_BD {
     LIST_ENTRY            Link;            // Queable
     PMP_ADAPTER           pAdapter;        // Adapter private data address
+    PMP_CHANNEL           pChannel;        // DMA channel the frame is sent on
     PNET_BUFFER           pNB;             // NB address
     PNET_BUFFER_LIST      pNBL;            // MBL address
     LONG                  NBId;            // For debug only
+    ULONG                 BDCount;         // Number of ENET QOS descriptors the frame takes
+    ULONG                 CopyBytes;       // Bytes copied to the bounce buffer of the first BD, the rest is mapped straight from pSGList
     PSCATTER_GATHER_LIST  pSGList;         // The scatter gather list address
     SCATTER_GATHER_LIST   SGList;          // SG list passed to MpProcessSGList
 } MP_TX_BD, *PMP_TX_BD;
@@ -209,6 +212,7 @@ typedef struct _MP_TX_PAYLOAD_BD {
 // ------------------------------------------------------------------------------------------------
 typedef struct _MP_RX_FRAME_BD {
     LIST_ENTRY              Link;
+    PMP_CHANNEL             pChannel;       // DMA channel the buffer belongs to
     PNET_BUFFER_LIST        pNBL;           //
     PMDL                    pMdl;           // Address of the MDL describing buffer
     PUCHAR                  pBuffer;        // Address of the buffer (in the context of miniport driver)
@@ -273,6 +277,57 @@ typedef enum _MP_MII_PHY_INTERFACE_TYPE {
 
 typedef VOID (MP_SM_STATE_HANDLER)(PMP_ADAPTER pAdapter);
 
+//--------------------------------------
+// ENET QOS DMA channel. Each channel has its own Tx and Rx BD ring, served by the MTL queue with the same index.
+//--------------------------------------
+typedef struct _MP_CHANNEL {
+    PMP_ADAPTER             pAdapter;
+    ULONG                   Idx;                                   // DMA channel and MTL queue index
+    ULONG                   DpcProcessor;                          // Index of the processor the DPC of the channel runs on
+    volatile BOOLEAN        DpcQueued;                             // Set to TRUE by ISR if DPC is queued for the channel
+    UINT32                  InterruptFlags;                        // Interrupt flags saved for the next DPC
+    FRAME_RCV_STATUS        RcvStatus;
+    FRAME_TXD_STATUS        TxdStatus;
+    // XMIT
+    ULONG                   Tx_CheckForHangCounter;
+    MP_QUEUE                Tx_qMpOwnedBDs;                        // Pending (owned by driver) TX ethernet frames (NET_BUFFERs) queue
+    MP_QUEUE                Tx_qDmaOwnedBDs;                       // In progress (owned by Enet DMA) TX ethernet frames (NET_BUFFERs) queue
+    NDIS_SPIN_LOCK          Tx_SpinLock;                           // Tx path spin lock
+    LONG                    Tx_EnetFreeBDCount;                    // Number of unused Enet Buffer Descriptors
+    LONG                    Tx_EnetFreeBDIdx;                      // Index of the first free BD
+    LONG                    Tx_EnetPendingBDIdx;                   // Index of first BD submitted to ENET DMA
+    PMP_TX_PAYLOAD_BD       Tx_EnetSwExtBDT;                       // Address of table containing Sw related data for each Enet BD
+    PUCHAR                  Tx_DataBuffer_Va;                      // TxBufAlloc points to the block of numTCB*NIC_PACKET_SIZE
+    ULONG                   Tx_DataBuffer_Size;                    // numTCB*NIC_PACKET_SIZE
+    NDIS_PHYSICAL_ADDRESS   Tx_DataBuffer_Pa;
+    volatile ENET_BD       *Tx_DmaBDT;                             // ENET peripheral Tx Dma buffer descriptor table (BDT) address
+    ULONG                   Tx_DmaBDT_Size;                        // Size of the Tx_DmaBDT [Bytes]
+    NDIS_PHYSICAL_ADDRESS   Tx_DmaBDT_Pa;                          // Tx_DmaBDT physical address
+    // RECV
+    PMP_RX_FRAME_BD         Rx_FrameBDT;                           // Rx payload data buffer descriptor table address
+    NDIS_SPIN_LOCK          Rx_SpinLock;                           // Rx path spin lock
+    LONG                    Rx_EnetFreeBDIdx;                      // Index of the first free BD
+    LONG                    Rx_EnetPendingBDIdx;                   // Index of first BD submitted to ENET DMA
+    LONG                    Rx_NdisOwnedBDsCount;                  // Number of buffers owned by NDIS
+    LONG                    Rx_DmaBDT_DmaOwnedBDsCount;            // Number of BDs owned by ENET DMA (ready to receive data)
+    PENET_BD                Rx_DmaBDT;                             // ENET peripheral Dma buffer descriptor table (BDT) address
+    PMP_ENET_BD_SW_EXT      Rx_DmaBDT_SwExt;                       // SW extension of Rx_DmaBDT
+    ULONG                   Rx_DmaBDT_Size;                        // Size of Rx_DmaBDT in bytes
+    NDIS_PHYSICAL_ADDRESS   Rx_DmaBDT_Pa;                          // Physical address of Rx_DmaBDT
+} MP_CHANNEL, *PMP_CHANNEL;
+
+#define MP_RSS_PROCESSOR_COUNT_MAX    32    // The DPC target processors are a ULONG bitmask
+
+//--------------------------------------
+// Received frames the RSS indirection table assigned to a processor, indicated by the DPC on that processor
+//--------------------------------------
+typedef struct _MP_RSS_PROCESSOR {
+    NDIS_SPIN_LOCK          Lock;
+    PNET_BUFFER_LIST        pNBLHead;
+    PNET_BUFFER_LIST        pNBLTail;
+    ULONG                   NBLCount;
+} MP_RSS_PROCESSOR, *PMP_RSS_PROCESSOR;
+
 //--------------------------------------
 // The miniport adapter structure
 //--------------------------------------
@@ -287,14 +342,11 @@ typedef struct _MP_ADAPTER {
         MP_STATE            SM_NextState;
         MP_STATE            SM_OnResetPreviousState;  // State machine state at the moment when OnReset state handler is called.
     } StateMachine;
-    volatile BOOLEAN        DpcQueued;                // Set to TRUE by ISR id DPC is queued
-    BOOLEAN                 DpcRunning;               // Set to TRUE at the begin of DPC and to FALSE ad the and of DPC
     MP_NDIS_PEND_OPS        PendingNdisOperations;
     NDIS_STATUS             NdisStatus;
     BOOLEAN                 EnetStarted;              // Set to TRUE(data path is running) by EnetStart() and to FALSE in EnetQos_Stop() method.
     BOOLEAN                 RestartEnetAfterResume;
     volatile CSP_ENET_REGS *ENETRegBase;              // ENET peripheral registers virtual base address
-    UINT32                  InterruptFlags;
     UCHAR                   PermanentAddress[ETH_LENGTH_OF_ADDRESS];
     UCHAR                   CurrentAddress[ETH_LENGTH_OF_ADDRESS];
     UCHAR                   FecMacAddress[ETH_LENGTH_OF_ADDRESS];
@@ -312,24 +364,10 @@ typedef struct _MP_ADAPTER {
     USHORT                  TheMostPowefullSpeedAndDuplexMode;     // The most powerful speed and duplex mode for both partners are capable
     NDIS_HANDLE             Tx_DmaHandle;                          // Scatter/Gather DMA handle
     ULONG                   Tx_SGListSize;
+    ULONG                   Tx_CopyBreak;                          // Frames up to this size are copied to the bounce buffer, longer frames are mapped from the NET_BUFFER
     NPAGED_LOOKASIDE_LIST   Tx_MpTxBDLookasideList;                // Tx buffer descriptor lookaside list
-    ULONG                   Tx_CheckForHangCounter;
     LONG                    Tx_PendingNBs;                         // Number of TX frames (NET_BUFFERs) that are owned by the miniport. Total number of queued TX frames and frames that are already setup for DMA transfers.
-    MP_QUEUE                Tx_qMpOwnedBDs;                        // Pending (owned by driver) TX ethernet frames (NET_BUFFERs) queue
-    MP_QUEUE                Tx_qDmaOwnedBDs;                       // In progress (owned by Enet DMA) TX ethernet frames (NET_BUFFERs) queue
-    NDIS_SPIN_LOCK          Tx_SpinLock;                           // Tx path spin lock
-    LONG                    Tx_EnetFreeBDCount;                    // Number of unused Enet Buffer Descriptors
-    LONG                    Tx_EnetFreeBDIdx;                      // Index of the first free BD
-    LONG                    Tx_EnetPendingBDIdx;                   // Index of first BD submitted to ENET DMA
-    PMP_TX_PAYLOAD_BD       Tx_EnetSwExtBDT;                       // Address of table containing Sw related data for each Enet BD
-    PUCHAR                  Tx_DataBuffer_Va;                      // TxBufAlloc points to the block of numTCB*NIC_PACKET_SIZE
-    ULONG                   Tx_DataBuffer_Size;                    // numTCB*NIC_PACKET_SIZE
-    NDIS_PHYSICAL_ADDRESS   Tx_DataBuffer_Pa;
-
-    volatile ENET_BD       *Tx_DmaBDT;                             // ENET peripheral Tx Dma buffer descriptor table (BDT) address
-    LONG                    Tx_DmaBDT_ItemCount;                   // ENET peripheral Tx Dma buffer descriptor table (BDT) item count
-    ULONG                   Tx_DmaBDT_Size;                        // Size of the Tx_DmaBDT [Bytes]
-    NDIS_PHYSICAL_ADDRESS   Tx_DmaBDT_Pa;                          // Tx_DmaBDT physical address
+    LONG                    Tx_DmaBDT_ItemCount;                   // ENET peripheral Tx Dma buffer descriptor table (BDT) item count of each channel
     #if DBG
     LONG                    Tx_NBCounter;                          // For debug only
     LONG                    Tx_NBLCounter;                         // For debug only
@@ -337,20 +375,22 @@ typedef struct _MP_ADAPTER {
 
     // RECV
     NDIS_HANDLE             Rx_NBAndNBLPool;                       // NB and NBL pool handle
-    PMP_RX_FRAME_BD         Rx_FrameBDT;                           // Rx payload data buffer descriptor table address
-    NDIS_SPIN_LOCK          Rx_SpinLock;                           // Rx path spin lock
-    LONG                    Rx_EnetFreeBDIdx;                      // Index of the first free BD
-    LONG                    Rx_EnetPendingBDIdx;                   // Index of first BD submitted to ENET DMA
-    LONG                    Rx_NdisOwnedBDsCount;                  // Number of buffers owned by NDIS
-    LONG                    Rx_DmaBDT_DmaOwnedBDsCount;            // Number of BDs owned by ENET DMA (ready to receive data)
     LONG                    Rx_DmaBDT_DmaOwnedBDsLowWatterMark;    // Number of BDs that must be ready for data reception
-    PENET_BD                Rx_DmaBDT;                             // ENET peripheral Dma buffer descriptor table (BDT) address
-    PMP_ENET_BD_SW_EXT      Rx_DmaBDT_SwExt;                       // SW extension of Rx_DmaBDT
-    LONG                    Rx_DmaBDT_ItemCount;                   // ENET peripheral Dma buffer descriptor table (BDT) item count
-    ULONG                   Rx_DmaBDT_Size;                        // Size of Rx_DmaBDT in bytes
-    NDIS_PHYSICAL_ADDRESS   Rx_DmaBDT_Pa;                          // Physical address of Rx_DmaBDT
+    LONG                    Rx_DmaBDT_ItemCount;                   // ENET peripheral Dma buffer descriptor table (BDT) item count of each channel
     LONG                    Rx_NBLCounter;                         // For debug only
     NDIS_SPIN_LOCK          Dev_SpinLock;                          // spin locks
+
+    // DMA channels
+    ULONG                   ChannelCount;                          // Number of DMA channels (and MTL queues) in use
+    MP_CHANNEL              Channel[ENET_QOS_CHANNEL_COUNT_MAX];
+    UCHAR                   PriorityMap[MP_RSS_PRIORITY_COUNT];    // DMA channel of each 802.1p priority
+
+    // Receive side scaling
+    ULONG                   RssEnabled;                            // RSS capabilities are reported to NDIS
+    ULONG                   ProcessorCount;                        // Number of processors RSS and the channel DPCs can use
+    PNDIS_RW_LOCK_EX        Rss_Lock;                              // Protects Rss, taken for read by the DPCs
+    MP_RSS                  Rss;
+    MP_RSS_PROCESSOR        Rss_Processor[MP_RSS_PROCESSOR_COUNT_MAX];
     // Packet Filter and look ahead size.
     ULONG                   PacketFilter;
     ULONG                   OldPacketFilter;
@@ -364,8 +404,6 @@ typedef struct _MP_ADAPTER {
 
     ULONG                   CacheFillSize;
 
-    FRAME_RCV_STATUS        RcvStatus;
-    FRAME_TXD_STATUS        TxdStatus;
     IMX_MII_LINK_STATE_t    LinkState;
 
     NDIS_DEVICE_POWER_STATE CurrentPowerState;
@@ -426,6 +464,11 @@ NDIS_STATUS NICReadRegParameters(_In_ PMP_ADAPTER Adapter);
 _Must_inspect_result_
 _IRQL_requires_max_(PASSIVE_LEVEL)
 NDIS_STATUS NICAllocAdapterMemory(_In_ PMP_ADAPTER Adapter);
+_Must_inspect_result_
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NDIS_STATUS NICAllocChannelMemory(_In_ PMP_CHANNEL pChannel);
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void MpFreeChannel(_In_ PMP_CHANNEL pChannel);
 
 // MP_REQ.C
 _IRQL_requires_max_(DISPATCH_LEVEL)
@@ -436,6 +479,8 @@ NDIS_STATUS NICSetPacketFilter(_In_ PMP_ADAPTER Adapter, _In_ ULONG PacketFilter
 _Requires_lock_held_(&Adapter->Dev_SpinLock)
 _IRQL_requires_(DISPATCH_LEVEL)
 NDIS_STATUS NICSetMulticastList(_In_ PMP_ADAPTER Adapter);
+_IRQL_requires_(PASSIVE_LEVEL)
+NDIS_STATUS NICSetRssParameters(_In_ PMP_ADAPTER Adapter, _In_reads_bytes_(InformationBufferLength) PNDIS_RECEIVE_SCALE_PARAMETERS pParams, _In_ ULONG InformationBufferLength);
 
 // NDIS Miniport interfaces
 _IRQL_requires_max_(DISPATCH_LEVEL)
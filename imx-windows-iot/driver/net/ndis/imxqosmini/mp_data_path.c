@@ -216,20 +216,19 @@ _Use_decl_annotations_
 BOOLEAN MpCheckForHangEx(NDIS_HANDLE MiniportAdapterContext)
 {
     PMP_ADAPTER pAdapter = (PMP_ADAPTER)MiniportAdapterContext;
-    BOOLEAN     isTxHang = TRUE;
+    BOOLEAN     isTxHang = FALSE;
 
-    NdisAcquireSpinLock(&pAdapter->Tx_SpinLock);
-    for(;;) {
-        if (MpQueueGetDepth(&pAdapter->Tx_qDmaOwnedBDs) > 0) {  // Any Tx frame pending in HW?
-            if (++pAdapter->Tx_CheckForHangCounter > 2) {       // Second call of this function without successful Tx transfer?
-                DBG_ENET_DEV_PRINT_ERROR("TX is hang!");
-                break;
+    for (ULONG Idx = 0; Idx < pAdapter->ChannelCount; ++Idx) {
+        PMP_CHANNEL pChannel = &pAdapter->Channel[Idx];
+        NdisAcquireSpinLock(&pChannel->Tx_SpinLock);
+        if (MpQueueGetDepth(&pChannel->Tx_qDmaOwnedBDs) > 0) {  // Any Tx frame pending in HW?
+            if (++pChannel->Tx_CheckForHangCounter > 2) {       // Second call of this function without successful Tx transfer?
+                DBG_ENET_DEV_PRINT_ERROR("TX is hang on channel %d!", Idx);
+                isTxHang = TRUE;
             }
         }
-        isTxHang = FALSE;
-        break;
+        NdisReleaseSpinLock(&pChannel->Tx_SpinLock);
     }
-    NdisReleaseSpinLock(&pAdapter->Tx_SpinLock);
     if (TRUE == isTxHang)
         DBG_ENET_DEV_PRINT_ERROR("Requesting Reset by NDIS");
     return isTxHang;
@@ -293,14 +292,17 @@ BOOLEAN MpTxCancelAll(PMP_ADAPTER pAdapter)
     PLIST_ENTRY pListEntry;
 
     InitializeListHead(&CanceledNetBufferList);
-    NdisAcquireSpinLock(&pAdapter->Tx_SpinLock);
-    while ((pListEntry = MpQueueGetNext(&pAdapter->Tx_qDmaOwnedBDs)) != NULL)
-        InsertHeadList(&CanceledNetBufferList, pListEntry);
-    while ((pListEntry = MpQueueGetNext(&pAdapter->Tx_qMpOwnedBDs)) != NULL)
-        InsertHeadList(&CanceledNetBufferList, pListEntry);
+    for (ULONG Idx = 0; Idx < pAdapter->ChannelCount; ++Idx) {
+        PMP_CHANNEL pChannel = &pAdapter->Channel[Idx];
+        NdisAcquireSpinLock(&pChannel->Tx_SpinLock);
+        while ((pListEntry = MpQueueGetNext(&pChannel->Tx_qDmaOwnedBDs)) != NULL)
+            InsertHeadList(&CanceledNetBufferList, pListEntry);
+        while ((pListEntry = MpQueueGetNext(&pChannel->Tx_qMpOwnedBDs)) != NULL)
+            InsertHeadList(&CanceledNetBufferList, pListEntry);
+        NdisReleaseSpinLock(&pChannel->Tx_SpinLock);
+    }
     CompletionStatus = pAdapter->NdisStatus;                                 // Get the completion status to use
     BOOLEAN isAnyTxFrameCanceled = !IsListEmpty(&CanceledNetBufferList);     // The status to return...
-    NdisReleaseSpinLock(&pAdapter->Tx_SpinLock);
     // Unwind all canceled NET_BUFFERs
     while (!IsListEmpty(&CanceledNetBufferList)) {
         pListEntry = RemoveTailList(&CanceledNetBufferList);
@@ -330,21 +332,26 @@ void MpCancelSendNetBufferLists(NDIS_HANDLE MiniportAdapterContext, PVOID Cancel
     PMP_ADAPTER       pAdapter = (PMP_ADAPTER)MiniportAdapterContext;
     LIST_ENTRY        CanceledNBList;       // The list of NET_BUFFERs associated with NET_BUFFER_LISTs that should be cancelled.
 
+    PLIST_ENTRY       pListEntry;
+
     InitializeListHead(&CanceledNBList);
-    NdisAcquireSpinLock(&pAdapter->Tx_SpinLock);
-    PLIST_ENTRY pListEntry = MpQueuePeekFirst(&pAdapter->Tx_qMpOwnedBDs);
-    while (pListEntry != NULL) {
-        PMP_TX_BD pMpTxBD = CONTAINING_RECORD(pListEntry, MP_TX_BD, Link);         // Get pMpTxBD address
-        if (NDIS_GET_NET_BUFFER_LIST_CANCEL_ID(pMpTxBD->pNBL) == CancelId) {       // Compare CancelIds
-            PLIST_ENTRY curpListEntry = pListEntry;                                // Remember current pMpTxBD
-            pListEntry = MpQueuePeekNext(&pAdapter->Tx_qMpOwnedBDs, pListEntry);   // Move to next pMpTxBD, before removing...
-            MpQueueRemoveEntry(&pAdapter->Tx_qMpOwnedBDs, curpListEntry);          // Remove pMpTxBD from Tx_qMpOwnedBDs queue
-            InsertHeadList(&CanceledNBList, &pMpTxBD->Link);                       // Add pMpTxBD to the cancel ready queue
-        } else {
-            pListEntry = MpQueuePeekNext(&pAdapter->Tx_qMpOwnedBDs, pListEntry);   // CancelIds are different, move to the next pMpTxBD
+    for (ULONG Idx = 0; Idx < pAdapter->ChannelCount; ++Idx) {
+        PMP_CHANNEL pChannel = &pAdapter->Channel[Idx];
+        NdisAcquireSpinLock(&pChannel->Tx_SpinLock);
+        pListEntry = MpQueuePeekFirst(&pChannel->Tx_qMpOwnedBDs);
+        while (pListEntry != NULL) {
+            PMP_TX_BD pMpTxBD = CONTAINING_RECORD(pListEntry, MP_TX_BD, Link);         // Get pMpTxBD address
+            if (NDIS_GET_NET_BUFFER_LIST_CANCEL_ID(pMpTxBD->pNBL) == CancelId) {       // Compare CancelIds
+                PLIST_ENTRY curpListEntry = pListEntry;                                // Remember current pMpTxBD
+                pListEntry = MpQueuePeekNext(&pChannel->Tx_qMpOwnedBDs, pListEntry);   // Move to next pMpTxBD, before removing...
+                MpQueueRemoveEntry(&pChannel->Tx_qMpOwnedBDs, curpListEntry);          // Remove pMpTxBD from Tx_qMpOwnedBDs queue
+                InsertHeadList(&CanceledNBList, &pMpTxBD->Link);                       // Add pMpTxBD to the cancel ready queue
+            } else {
+                pListEntry = MpQueuePeekNext(&pChannel->Tx_qMpOwnedBDs, pListEntry);   // CancelIds are different, move to the next pMpTxBD
+            }
         }
+        NdisReleaseSpinLock(&pChannel->Tx_SpinLock);
     }
-    NdisReleaseSpinLock(&pAdapter->Tx_SpinLock);
     while (!IsListEmpty(&CanceledNBList)) {                                        // Unwind all cancelled NET_BUFFERs
         pListEntry = RemoveTailList(&CanceledNBList);
         ASSERT(pListEntry != NULL);
@@ -357,12 +364,12 @@ void MpCancelSendNetBufferLists(NDIS_HANDLE MiniportAdapterContext, PVOID Cancel
 Routine Description:
    Copy data in a packet to the specified location
 Arguments:
-    pMpTxBD         A pointer to the source buffer
+    pNB             A pointer to the source NET_BUFFER
     pEnetSwExtBD    A pointer to the destination buffer
 Return Value:
     The number of bytes actually copied
 --*/
-ULONG MpCopyNetBuffer(_In_ PMP_TX_BD pMpTxBD, _Inout_ PMP_TX_PAYLOAD_BD pEnetSwExtBD)
+ULONG MpCopyNetBuffer(_In_ PNET_BUFFER pNB, _Inout_ PMP_TX_PAYLOAD_BD pEnetSwExtBD)
 {
     ULONG          CurrLength=0;
     PUCHAR         pSrc=NULL;
@@ -371,13 +378,11 @@ ULONG MpCopyNetBuffer(_In_ PMP_TX_BD pMpTxBD, _Inout_ PMP_TX_PAYLOAD_BD pEnetSwE
     ULONG          Offset;
     PMDL           CurrentMdl;
     ULONG          DataLength;
-    PNET_BUFFER    NetBuffer = pMpTxBD->pNB;
-    PSCATTER_GATHER_LIST sgListPtr = pMpTxBD->pSGList;
 
     pDest = pEnetSwExtBD->pBuffer;
-    CurrentMdl = NET_BUFFER_FIRST_MDL(NetBuffer);
-    Offset = NET_BUFFER_DATA_OFFSET(NetBuffer);
-    DataLength = NET_BUFFER_DATA_LENGTH(NetBuffer);
+    CurrentMdl = NET_BUFFER_FIRST_MDL(pNB);
+    Offset = NET_BUFFER_DATA_OFFSET(pNB);
+    DataLength = NET_BUFFER_DATA_LENGTH(pNB);
 
     while (CurrentMdl && DataLength > 0) {
         NdisQueryMdl(CurrentMdl, &pSrc, &CurrLength, NormalPagePriority);
@@ -411,60 +416,112 @@ ULONG MpCopyNetBuffer(_In_ PMP_TX_BD pMpTxBD, _Inout_ PMP_TX_PAYLOAD_BD pEnetSwE
     NdisAdjustMdlLength(pEnetSwExtBD->pMdl, BytesCopied);
     ASSERT(BytesCopied <= pEnetSwExtBD->BufferSize);
 
-    sgListPtr->Elements[0].Address = pEnetSwExtBD->BufferPa;
-    sgListPtr->Elements[0].Length = BytesCopied;
-
     return BytesCopied;
 }
 
 /*++
 Routine Description:
-    It is called to map all NET_BUFFER scatter gather elements into TX DMA descriptors.
+    Decides how the NET_BUFFER is put to the ENET QOS Tx descriptors. Frames up to Tx_CopyBreak bytes and frames
+    the DMA can not take straight from the scatter gather list are copied to the bounce buffer of a single descriptor.
+    The other frames are mapped fragment by fragment.
 Arguments:
     pAdapter    Address of the adapter context
+    pMpTxBD     Address of the Mp Tx BD with the scatter gather list
+Return Value:
+    None
+--*/
+void MpTxMapNetBuffer(_In_ PMP_ADAPTER pAdapter, _Inout_ PMP_TX_BD pMpTxBD)
+{
+    ULONG DataLength = NET_BUFFER_DATA_LENGTH(pMpTxBD->pNB);
+    ULONG BDCount = MpTxMapPlan(pMpTxBD->pSGList, 0, 0, DataLength, pAdapter->Tx_CopyBreak,
+                                (ULONG)pAdapter->Tx_DmaBDT_ItemCount, ENET_TX_BD_MAX_LENGTH, ENET_TX_BD_ALIGN_MASK);
+
+    pMpTxBD->CopyBytes = (BDCount == 0) ? DataLength : 0;                                      // Copy the whole frame if it is not mapped
+    pMpTxBD->BDCount   = (BDCount == 0) ? 1 : BDCount;
+}
+
+/*++
+Routine Description:
+    It is called to map all NET_BUFFER scatter gather elements into TX DMA descriptors.
+    A copied frame takes the bounce buffer of the first descriptor, a mapped frame takes one descriptor per
+    fragment. The first descriptor is given to the DMA as the last step.
+Arguments:
+    pChannel    Address of the DMA channel context
     pMpTxBD     Address of the TCB to be freed
 Return Value:
     None
 --*/
-void MpTxFillEnetTxBD(_In_ PMP_ADAPTER pAdapter, _In_ PMP_TX_BD pMpTxBD)
+void MpTxFillEnetTxBD(_In_ PMP_CHANNEL pChannel, _In_ PMP_TX_BD pMpTxBD)
 {
-    PSCATTER_GATHER_LIST sgListPtr = pMpTxBD->pSGList;
-    LONG                 EnetFreeBDIdx = pAdapter->Tx_EnetFreeBDIdx;         // First free Ethernet packet hw buffer descriptor index
-    volatile ENET_BD    *pFreeEnetBD = &pAdapter->Tx_DmaBDT[EnetFreeBDIdx];  // First free Ethernet packet hw buffer descriptor address
-    ULONG                bytesToSent;
+    PMP_ADAPTER          pAdapter = pChannel->pAdapter;
+    LONG                 EnetFreeBDIdx = pChannel->Tx_EnetFreeBDIdx;         // First free Ethernet packet hw buffer descriptor index
+    volatile ENET_BD    *pFirstEnetBD = &pChannel->Tx_DmaBDT[EnetFreeBDIdx]; // First Ethernet packet hw buffer descriptor address of the frame
+    volatile ENET_BD    *pFreeEnetBD;
+    PMP_TX_PAYLOAD_BD    pEnetSwExtBD = &pChannel->Tx_EnetSwExtBDT[EnetFreeBDIdx];
+    MP_TX_MAP_CURSOR     Cursor;
+    ULONG                BufferAddress;
+    ULONG                BufferLength;
+    ULONG                FrameLength;
+    UINT32               des3;
 
-    ASSERT(sgListPtr != NULL);
-    ASSERT(sgListPtr->NumberOfElements > 0);
+    ASSERT(pMpTxBD->pSGList != NULL);
+    ASSERT(pMpTxBD->pSGList->NumberOfElements > 0);
+    ASSERT((LONG)pMpTxBD->BDCount <= pChannel->Tx_EnetFreeBDCount);
 
     DBG_ENET_DEV_TX_METHOD_BEG();
-    bytesToSent = MpCopyNetBuffer(pMpTxBD, &pAdapter->Tx_EnetSwExtBDT[EnetFreeBDIdx]);          // Copy data to driver provided buffer
+    if (pMpTxBD->CopyBytes != 0) {
+        FrameLength = MpCopyNetBuffer(pMpTxBD->pNB, pEnetSwExtBD);                            // Copy data to driver provided buffer
+        ASSERT(FrameLength);
+        pChannel->TxdStatus.FramesXmitCopied++;
+    } else {
+        FrameLength = NET_BUFFER_DATA_LENGTH(pMpTxBD->pNB);
+        pChannel->TxdStatus.FramesXmitZeroCopy++;
+    }
 #if 0
-    UCHAR *buffer = pAdapter->Tx_EnetSwExtBDT[EnetFreeBDIdx].pBuffer;
+    UCHAR *buffer = pEnetSwExtBD->pBuffer;
 #endif
-    ASSERT(bytesToSent);
-    pAdapter->Tx_EnetSwExtBDT[EnetFreeBDIdx].pMpBD = pMpTxBD;                                   // Associate sw MP_TxBD with current hw ENET_TxBD
-    if (++EnetFreeBDIdx == pAdapter->Tx_DmaBDT_ItemCount) {                                     // Update Free BD index
-        EnetFreeBDIdx = 0;                                                                      // Free BD is the first item of Tx_DmaBDT
+    MpTxMapInit(&Cursor, pMpTxBD->pSGList, 0, NET_BUFFER_DATA_LENGTH(pMpTxBD->pNB), ENET_TX_BD_MAX_LENGTH);
+    pEnetSwExtBD->pMpBD = pMpTxBD;                                                              // Associate sw MP_TxBD with the first hw ENET_TxBD of the frame
+    for (ULONG BDIdx = 0; BDIdx < pMpTxBD->BDCount; ++BDIdx) {
+        if (pMpTxBD->CopyBytes != 0) {
+            BufferAddress = pEnetSwExtBD->BufferPa.LowPart;                                     // Bounce buffer
+            BufferLength  = FrameLength;
+        } else {
+            (void)MpTxMapNextFragment(&Cursor, &BufferAddress, &BufferLength);                  // NET_BUFFER fragment
+        }
+        pFreeEnetBD = &pChannel->Tx_DmaBDT[EnetFreeBDIdx];
+        des3 = (UINT32)FrameLength;
+        if (BDIdx == 0) {
+            des3 |= TDES3_FD_MASK;                                                              // First descriptor of the frame
+        } else {
+            des3 |= TDES3_OWN_MASK;
+        }
+        if (BDIdx == pMpTxBD->BDCount - 1) {
+            des3 |= TDES3_LD_MASK;                                                              // Last descriptor of the frame
+        }
+        pFreeEnetBD->des0 = BufferAddress;                                                      // Set ENET_TxBD data address
+        pFreeEnetBD->des1 = 0;
+        pFreeEnetBD->des2 = BufferLength;                                                       // Set ENET_TxBD data length
+        if (BDIdx == pMpTxBD->BDCount - 1) {
+            pFreeEnetBD->des2 |= TDES2_IOC_MASK;                                                // Enable interrupt on completetion
+        }
+        pFreeEnetBD->des3 = des3;                                                               // Write ControlStatus word of BD as last step
+        if (++EnetFreeBDIdx == pAdapter->Tx_DmaBDT_ItemCount) {                                 // Update Free BD index
+            EnetFreeBDIdx = 0;                                                                  // Free BD is the first item of Tx_DmaBDT
+        }
     }
-    pAdapter->Tx_EnetFreeBDIdx = EnetFreeBDIdx;
-    pAdapter->Tx_EnetFreeBDCount--;
-
-    pFreeEnetBD->des0 = NdisGetPhysicalAddressLow(sgListPtr->Elements[0].Address);   // Set ENET_TxBD data address
-    pFreeEnetBD->des1 = 0;
-    pFreeEnetBD->des2 = (UINT32)sgListPtr->Elements[0].Length | TDES2_IOC_MASK;      // Set ENET_TxBD data length, Enable interrupt on completetion
-    pFreeEnetBD->des3 = (UINT32)sgListPtr->Elements[0].Length;                       // Write ControlStatus word of BD as last step
-    
+    pChannel->Tx_EnetFreeBDIdx = EnetFreeBDIdx;
+    pChannel->Tx_EnetFreeBDCount -= (LONG)pMpTxBD->BDCount;
+
     _DataSynchronizationBarrier();                                                   // Wait for read is finished
-    pFreeEnetBD->des3 |= TDES3_OWN_MASK
-        | TDES3_LD_MASK
-        | TDES3_FD_MASK;
+    pFirstEnetBD->des3 |= TDES3_OWN_MASK;                                            // Give the first descriptor to the DMA as the last step
     _DataSynchronizationBarrier();                                                   // Wait for read is finished
-    DBG_ENET_DEV_TX_PRINT_TRACE("NB(%d): Added to ENET_BD, Size: %5d.",pMpTxBD->NBId,(USHORT)sgListPtr->Elements[0].Length);
+    DBG_ENET_DEV_TX_PRINT_TRACE("NB(%d): Added to ENET_BD, Size: %5d, BDs: %d.", pMpTxBD->NBId, FrameLength, pMpTxBD->BDCount);
     DBG_ENET_DEV_TX_PRINT_TRACE("NB(%d): Starting transfer", pMpTxBD->NBId);
-    pAdapter->ENETRegBase->DMA_CH[0].DMA_CHX_TXDESC_TAIL_PTR.R = pAdapter->Tx_DmaBDT_Pa.LowPart + (pAdapter->Tx_DmaBDT_ItemCount * (UINT32)sizeof(ENET_BD));
+    pAdapter->ENETRegBase->DMA_CH[pChannel->Idx].DMA_CHX_TXDESC_TAIL_PTR.R = pChannel->Tx_DmaBDT_Pa.LowPart + (pAdapter->Tx_DmaBDT_ItemCount * (UINT32)sizeof(ENET_BD));
 #if 0
 #define LINE_BYTES 16
-        UINT32 len = sgListPtr->Elements[0].Length;
+        UINT32 len = FrameLength;
         DbgPrintEx(DPFLTR_IHVDRIVER_ID, DPFLTR_TRACE_LEVEL, "TX dump (len :%d):\n", len);
         for (int i = 0; i < len; i++) {
             DbgPrintEx(DPFLTR_IHVDRIVER_ID, DPFLTR_TRACE_LEVEL, "%02X ", buffer[i]);
@@ -486,34 +543,37 @@ Routine Description:
     our free TFDs, and we need to wait for a TX frame to complete before we can send the next
     pending frames.
 Arguments:
-    pAdapter    Address of the adapter context
+    pChannel    Address of the DMA channel context
 Return Value:
     None
 --*/
-void MpSendNextNB(_In_ PMP_ADAPTER pAdapter)
+void MpSendNextNB(_In_ PMP_CHANNEL pChannel)
 {
+    PMP_ADAPTER pAdapter = pChannel->pAdapter;
+
     DBG_ENET_DEV_TX_METHOD_BEG();
-    NdisAcquireSpinLock(&pAdapter->Tx_SpinLock);
+    NdisAcquireSpinLock(&pChannel->Tx_SpinLock);
     do {
         if (pAdapter->NdisStatus != NDIS_STATUS_SUCCESS)  {                       // Make sure the adapter is ready
             DBG_SM_PRINT_TRACE("NIC is not ready ");
             break;
         }
         for (;;) {
-            if ((pAdapter->Tx_EnetFreeBDCount == 0)) {                            // No Dma BD empty?
-                break;                                                            // Do nothing, Tx DPC will dequeue NB from Tx_qMpOwnedBDs
-            }
-            PLIST_ENTRY pListEntry = MpQueueGetNext(&pAdapter->Tx_qMpOwnedBDs);   // Get NB from remove from Miniport queue
+            PLIST_ENTRY pListEntry = MpQueuePeekFirst(&pChannel->Tx_qMpOwnedBDs); // Get NB from Miniport queue
             if (pListEntry == NULL) {                                             // Queue empty?
                 DBG_ENET_DEV_TX_PRINT_TRACE("Tx_qMpOwnedBDs EMPTY");
                 break;                                                            // Yes, no more NBs to send.
             }
-            PMP_TX_BD Tx_pCurrentMpBD = Tx_pCurrentMpBD = CONTAINING_RECORD(pListEntry, MP_TX_BD, Link);  // Get NB address
-            MpQueueAdd(&pAdapter->Tx_qDmaOwnedBDs, &Tx_pCurrentMpBD->Link);                               // Add NB to the DMA queue
-            MpTxFillEnetTxBD(pAdapter, Tx_pCurrentMpBD);                                                  // Put data to HW add start transfer
+            PMP_TX_BD Tx_pCurrentMpBD = CONTAINING_RECORD(pListEntry, MP_TX_BD, Link);   // Get NB address
+            if ((LONG)Tx_pCurrentMpBD->BDCount > pChannel->Tx_EnetFreeBDCount) {  // Not enough Dma BDs empty?
+                break;                                                            // Do nothing, Tx DPC will dequeue NB from Tx_qMpOwnedBDs
+            }
+            (void)MpQueueGetNext(&pChannel->Tx_qMpOwnedBDs);                      // Remove NB from Miniport queue
+            MpQueueAdd(&pChannel->Tx_qDmaOwnedBDs, &Tx_pCurrentMpBD->Link);                               // Add NB to the DMA queue
+            MpTxFillEnetTxBD(pChannel, Tx_pCurrentMpBD);                                                  // Put data to HW add start transfer
         } // Keep processing queued TX frames
     } while (0);
-    NdisReleaseSpinLock(&pAdapter->Tx_SpinLock);
+    NdisReleaseSpinLock(&pChannel->Tx_SpinLock);
     DBG_ENET_DEV_TX_METHOD_END();
 }
 
@@ -539,7 +599,41 @@ void MpProcessSGList(PDEVICE_OBJECT DeviceObjectPtr, PVOID Reserved, PSCATTER_GA
     UNREFERENCED_PARAMETER(Reserved);
 
     pMpTxBD->pSGList = SGListPtr;
-    MpQueueAdd(&pMpTxBD->pAdapter->Tx_qMpOwnedBDs, &pMpTxBD->Link);
+    MpTxMapNetBuffer(pMpTxBD->pAdapter, pMpTxBD);                               // Decide between the copy and the zero-copy path
+    MpQueueAdd(&pMpTxBD->pChannel->Tx_qMpOwnedBDs, &pMpTxBD->Link);
+}
+
+/*++
+Routine Description:
+    Selects the Tx DMA channel of the NET_BUFFER. The 802.1p user priority is taken from the NBL 802.1Q
+    information or, if it is not set, from the VLAN tag of the frame. The priority map translates it to the
+    traffic class, traffic class x is served by DMA channel x.
+Arguments:
+    pAdapter    Address of the adapter context
+    pNBL        Address of the NET_BUFFER_LIST
+    pNB         Address of the NET_BUFFER
+Return Value:
+    Address of the DMA channel context
+--*/
+PMP_CHANNEL MpTxSelectChannel(_In_ PMP_ADAPTER pAdapter, _In_ PNET_BUFFER_LIST pNBL, _In_ PNET_BUFFER pNB)
+{
+    NDIS_NET_BUFFER_LIST_8021Q_INFO Ieee8021QInfo;
+    UCHAR                           Header[16];
+    PUCHAR                          pHeader;
+    ULONG                           Priority;
+
+    if (pAdapter->ChannelCount == 1) {
+        return &pAdapter->Channel[0];
+    }
+    Ieee8021QInfo.Value = NET_BUFFER_LIST_INFO(pNBL, Ieee8021QNetBufferListInfo);
+    Priority = (ULONG)Ieee8021QInfo.TagHeader.UserPriority;
+    if ((Priority == 0) && (NET_BUFFER_DATA_LENGTH(pNB) >= sizeof(Header))) {
+        pHeader = (PUCHAR)NdisGetDataBuffer(pNB, sizeof(Header), Header, 1, 0);     // VLAN tagged by the protocol stack?
+        if (pHeader != NULL) {
+            Priority = MpRssGetFramePriority(pHeader, sizeof(Header));
+        }
+    }
+    return &pAdapter->Channel[pAdapter->PriorityMap[Priority & (MP_RSS_PRIORITY_COUNT - 1)]];
 }
 
 /*++
@@ -564,14 +658,16 @@ void MpSendNetBufferLists(NDIS_HANDLE MiniportAdapterContext, PNET_BUFFER_LIST N
     PNET_BUFFER_LIST  pCurrentNBL = pNextNBL;
     PNET_BUFFER       pCurrentNB;
     PMP_TX_BD         pMpTxBD;
+    PMP_CHANNEL       pChannel;
+    ULONG             ChannelMask          = 0;
 
     UNREFERENCED_PARAMETER(PortNumber);
     DBG_ENET_DEV_TX_METHOD_BEG();
 
     for(;;) {
-        NdisAcquireSpinLock(&pAdapter->Tx_SpinLock);
+        NdisAcquireSpinLock(&pAdapter->Channel[0].Tx_SpinLock);
         status = pAdapter->NdisStatus;
-        NdisReleaseSpinLock(&pAdapter->Tx_SpinLock);
+        NdisReleaseSpinLock(&pAdapter->Channel[0].Tx_SpinLock);
         if (status != NDIS_STATUS_SUCCESS)  {                                                 // Make sure the adapter is ready
             DBG_SM_PRINT_TRACE("NIC is not ready ");
             break;
@@ -599,19 +695,22 @@ void MpSendNetBufferLists(NDIS_HANDLE MiniportAdapterContext, PNET_BUFFER_LIST N
                 DBG_ENET_DEV_TX_PRINT_TRACE("### Sending NBL(%d), NB(%d)", MP_NBL_ID(pCurrentNBL),pMpTxBD->NBId);
                 #endif
                 DBG_ENET_DEV_TX_PRINT_TRACE("NB(%d) MpTxBD allocated ", pMpTxBD->NBId);
+                pChannel           = MpTxSelectChannel(pAdapter, pCurrentNBL, pCurrentNB);
                 pMpTxBD->pAdapter  = pAdapter;
+                pMpTxBD->pChannel  = pChannel;                             // Tx DMA channel of the frame priority
                 pMpTxBD->pNBL      = pCurrentNBL;                          // Associate NBL with MpTxBD
                 pMpTxBD->pNB       = pCurrentNB;                           // Associate NB with MpTxBD
                 pMpTxBD->pSGList   = NULL;
                 // Map the buffer to its physically contiguous fragments. NdisMAllocateNetBufferSGList needs to be called at DISPATCH_LEVEL
                 DBG_ENET_DEV_TX_PRINT_TRACE("NB(%d) Calling AllocSGList()", pMpTxBD->NBId);
-                NdisAcquireSpinLock(&pAdapter->Tx_SpinLock);
+                NdisAcquireSpinLock(&pChannel->Tx_SpinLock);
                 status = NdisMAllocateNetBufferSGList(pAdapter->Tx_DmaHandle, pCurrentNB, pMpTxBD, NDIS_SG_LIST_WRITE_TO_DEVICE, &pMpTxBD->SGList, pAdapter->Tx_SGListSize);
-                NdisReleaseSpinLock(&pAdapter->Tx_SpinLock);
+                NdisReleaseSpinLock(&pChannel->Tx_SpinLock);
                 if (status != NDIS_STATUS_SUCCESS) {                       // Fail to allocate memory from non-paged pool for SGList
                     DBG_ENET_DEV_PRINT_ERROR("NB(%d) NdisMAllocateNetBufferSGList() failed. Status: 0x%08X", pMpTxBD->NBId, status);
                     break;
                 }
+                ChannelMask |= 1UL << pChannel->Idx;                       // Remember the channel to kick off
                 NdisInterlockedIncrement(&pAdapter->Tx_PendingNBs);
             }
             if (status == NDIS_STATUS_SUCCESS) {
@@ -655,8 +754,13 @@ void MpSendNetBufferLists(NDIS_HANDLE MiniportAdapterContext, PNET_BUFFER_LIST N
         }
     }
 
-    if (uQueuedPacketCounter != 0) // If at lease one NBL (packet) was queued, kick off the transmission, if it had not been already started.
-        MpSendNextNB(pAdapter);    // Send queued NBs (Ethernet frames)
+    if (uQueuedPacketCounter != 0) { // If at lease one NBL (packet) was queued, kick off the transmission, if it had not been already started.
+        for (ULONG Idx = 0; Idx < pAdapter->ChannelCount; ++Idx) {
+            if (ChannelMask & (1UL << Idx)) {
+                MpSendNextNB(&pAdapter->Channel[Idx]);      // Send queued NBs (Ethernet frames)
+            }
+        }
+    }
     DBG_ENET_DEV_TX_METHOD_END();
 }
 
@@ -666,16 +770,18 @@ Routine Description:
     MpHandleTxInterrupt() scans the TFD list for transmitted frames, notifies NDIS,
     and tries to send the next queued outgoing frame.
 Arguments:
-    pAdapter        The miniport adapter context
+    pChannel        The DMA channel context
     InterruptEvent  The Interrupt Event Register image.
 Return Value:
     None
 --*/
 _Use_decl_annotations_
-void MpHandleTxInterrupt(PMP_ADAPTER pAdapter, UINT32 InterruptEvent)
+void MpHandleTxInterrupt(PMP_CHANNEL pChannel, UINT32 InterruptEvent)
 {
+    PMP_ADAPTER        pAdapter = pChannel->pAdapter;
     LIST_ENTRY         completedNetBufferList;
     LONG               EnetPendingBDIdx;
+    LONG               EnetLastBDIdx;
     volatile ENET_BD  *pDmaTxBD;
     PMP_TX_BD          pMpTxBD = NULL;
 
@@ -683,30 +789,34 @@ void MpHandleTxInterrupt(PMP_ADAPTER pAdapter, UINT32 InterruptEvent)
     InitializeListHead(&completedNetBufferList);
     DBG_ENET_DEV_DPC_TX_METHOD_BEG();
 
-    NdisDprAcquireSpinLock(&pAdapter->Tx_SpinLock);
-    EnetPendingBDIdx = pAdapter->Tx_EnetPendingBDIdx;
-    DBG_ENET_DEV_TX_PRINT_TRACE("**** ISR,  Tx_EnetPendingBDIdx: %d, Tx_EnetFreeBDIdx: %d, flags: 0x%08X ****", pAdapter->Tx_EnetPendingBDIdx, pAdapter->Tx_EnetFreeBDIdx, InterruptEvent);
+    NdisDprAcquireSpinLock(&pChannel->Tx_SpinLock);
+    EnetPendingBDIdx = pChannel->Tx_EnetPendingBDIdx;
+    DBG_ENET_DEV_TX_PRINT_TRACE("**** ISR,  Tx_EnetPendingBDIdx: %d, Tx_EnetFreeBDIdx: %d, flags: 0x%08X ****", pChannel->Tx_EnetPendingBDIdx, pChannel->Tx_EnetFreeBDIdx, InterruptEvent);
     do {
-        pMpTxBD = pAdapter->Tx_EnetSwExtBDT[EnetPendingBDIdx].pMpBD;                     // Get Mp NB Tx BD
+        pMpTxBD = pChannel->Tx_EnetSwExtBDT[EnetPendingBDIdx].pMpBD;                     // Get Mp NB Tx BD
         if (pMpTxBD == NULL) {                                                           // Mp NB Tx BD already processed as the first item in this loop?
             break;                                                                       // Break the loop
         }
-        pDmaTxBD = &pAdapter->Tx_DmaBDT[EnetPendingBDIdx];                               // Get Dma Tx BD
+        EnetLastBDIdx = EnetPendingBDIdx + (LONG)pMpTxBD->BDCount - 1;                   // Get the last Dma Tx BD of the frame
+        if (EnetLastBDIdx >= pAdapter->Tx_DmaBDT_ItemCount)
+            EnetLastBDIdx -= pAdapter->Tx_DmaBDT_ItemCount;
+        pDmaTxBD = &pChannel->Tx_DmaBDT[EnetLastBDIdx];                                  // Get Dma Tx BD
         if (pDmaTxBD->des3 & TDES3_OWN_MASK) {                                           // Dma Tx BD owned by DMA engine?
             break;                                                                       // Break the loop
         }
-        pAdapter->Tx_EnetSwExtBDT[EnetPendingBDIdx].pMpBD = NULL;                        // Mark Mp NB Tx BD as "already processed"
+        pChannel->Tx_EnetSwExtBDT[EnetPendingBDIdx].pMpBD = NULL;                        // Mark Mp NB Tx BD as "already processed"
+        EnetPendingBDIdx = EnetLastBDIdx;
         if (++EnetPendingBDIdx >= pAdapter->Tx_DmaBDT_ItemCount)                         // Updated ENET_BDT index
             EnetPendingBDIdx = 0;
-        pAdapter->Tx_EnetFreeBDCount ++;                                                 // Update Free ENET_TxBD counter
-        pAdapter->Tx_EnetPendingBDIdx = EnetPendingBDIdx;                                // Update pending BD index
+        pChannel->Tx_EnetFreeBDCount += (LONG)pMpTxBD->BDCount;                          // Update Free ENET_TxBD counter
+        pChannel->Tx_EnetPendingBDIdx = EnetPendingBDIdx;                                // Update pending BD index
         DBG_ENET_DEV_TX_PRINT_TRACE("NB(%d) 0x%08X done, adding it to the complete queue.", pMpTxBD->NBId, pMpTxBD->pNB);
-        (void)MpQueueGetNext(&pAdapter->Tx_qDmaOwnedBDs);                                // Remove the TX BD from the 'in progress' queue
+        (void)MpQueueGetNext(&pChannel->Tx_qDmaOwnedBDs);                                // Remove the TX BD from the 'in progress' queue
         InsertHeadList(&completedNetBufferList, &pMpTxBD->Link);                         // Put BD to the completed BD queue
-        pAdapter->Tx_CheckForHangCounter = 0;                                            // Restart "check for hang" counter
-    } while (EnetPendingBDIdx != pAdapter->Tx_EnetFreeBDIdx);
-    DBG_ENET_DEV_TX_PRINT_TRACE("**** ISR, Before release spin lock, Tx_EnetPendingBDIdx: %d, Tx_EnetFreeBDIdx: %d", pAdapter->Tx_EnetPendingBDIdx, pAdapter->Tx_EnetFreeBDIdx);
-    NdisDprReleaseSpinLock(&pAdapter->Tx_SpinLock);
+        pChannel->Tx_CheckForHangCounter = 0;                                            // Restart "check for hang" counter
+    } while (EnetPendingBDIdx != pChannel->Tx_EnetFreeBDIdx);
+    DBG_ENET_DEV_TX_PRINT_TRACE("**** ISR, Before release spin lock, Tx_EnetPendingBDIdx: %d, Tx_EnetFreeBDIdx: %d", pChannel->Tx_EnetPendingBDIdx, pChannel->Tx_EnetFreeBDIdx);
+    NdisDprReleaseSpinLock(&pChannel->Tx_SpinLock);
 
     while (!IsListEmpty(&completedNetBufferList)) {                                      // Unwind all completed NET_BUFFERs
         PLIST_ENTRY pListEntry = RemoveTailList(&completedNetBufferList);
@@ -716,61 +826,70 @@ void MpHandleTxInterrupt(PMP_ADAPTER pAdapter, UINT32 InterruptEvent)
         NDIS_STATUS completionStatus = NDIS_STATUS_SUCCESS;//(InterruptEvent & ENET_TX_ERR_INT_MASK)? NDIS_STATUS_FAILURE : NDIS_STATUS_SUCCESS;   // Get the completion status
         MpTxUnwindNetBuffer(pAdapter, pMpTxBD->pNBL, pMpTxBD->pNB, completionStatus, NDIS_SEND_COMPLETE_FLAGS_DISPATCH_LEVEL);
     } // More completed TX frames
-    MpSendNextNB(pAdapter);            // Send next waiting TX frames, if any...
+    MpSendNextNB(pChannel);            // Send next waiting TX frames, if any...
     DBG_ENET_DEV_DPC_TX_METHOD_END();
     return;
 }
 
 /*++
 Routine Description:
-    Initialize send data structures
+    Initialize send data structures of the DMA channel
 Arguments:
-    pAdapter     Pointer to adapter data
+    pChannel     Pointer to DMA channel data
 Return Value:
     None
 --*/
 _Use_decl_annotations_
-VOID MpTxInit(PMP_ADAPTER pAdapter)
+VOID MpTxInit(PMP_CHANNEL pChannel)
 {
-    pAdapter->Tx_CheckForHangCounter = 0;
-    pAdapter->Tx_EnetFreeBDCount     = pAdapter->Tx_DmaBDT_ItemCount;    // Initialize number of unused Ethernet Buffer Descriptors
-    pAdapter->Tx_EnetFreeBDIdx       = 0;
-    pAdapter->Tx_EnetPendingBDIdx    = 0;
-
-    pAdapter->TxdStatus.FramesXmitGood            = 0;
-    pAdapter->TxdStatus.FramesXmitBad             = 0;
-    pAdapter->TxdStatus.FramesXmitHBErrors        = 0;
-    pAdapter->TxdStatus.FramesXmitUnderrunErrors  = 0;
-    pAdapter->TxdStatus.FramesXmitCollisionErrors = 0;
-    pAdapter->TxdStatus.FramesXmitAbortedErrors   = 0;
-    pAdapter->TxdStatus.FramsXmitCarrierErrors    = 0;
-    NdisZeroMemory((VOID*)pAdapter->Tx_DmaBDT, pAdapter->Tx_DmaBDT_Size);      // Zero TxBDT
+    PMP_ADAPTER pAdapter = pChannel->pAdapter;
+
+    pChannel->Tx_CheckForHangCounter = 0;
+    pChannel->Tx_EnetFreeBDCount     = pAdapter->Tx_DmaBDT_ItemCount;    // Initialize number of unused Ethernet Buffer Descriptors
+    pChannel->Tx_EnetFreeBDIdx       = 0;
+    pChannel->Tx_EnetPendingBDIdx    = 0;
+
+    pChannel->TxdStatus.FramesXmitGood            = 0;
+    pChannel->TxdStatus.FramesXmitBad             = 0;
+    pChannel->TxdStatus.FramesXmitHBErrors        = 0;
+    pChannel->TxdStatus.FramesXmitUnderrunErrors  = 0;
+    pChannel->TxdStatus.FramesXmitCollisionErrors = 0;
+    pChannel->TxdStatus.FramesXmitAbortedErrors   = 0;
+    pChannel->TxdStatus.FramsXmitCarrierErrors    = 0;
+    pChannel->TxdStatus.FramesXmitCopied          = 0;
+    pChannel->TxdStatus.FramesXmitZeroCopy        = 0;
+    NdisZeroMemory((VOID*)pChannel->Tx_DmaBDT, pChannel->Tx_DmaBDT_Size);      // Zero TxBDT
+    for (LONG Idx = 0; Idx < pAdapter->Tx_DmaBDT_ItemCount; ++Idx) {           // No frame in TxBDT
+        pChannel->Tx_EnetSwExtBDT[Idx].pMpBD = NULL;
+    }
 }
 
 /*++
 Routine Description:
-    Initialize receive data structures.
+    Initialize receive data structures of the DMA channel.
 Arguments:
-    pAdapter    Pointer to adapter data
+    pChannel    Pointer to DMA channel data
 Return Value:
     None
 --*/
 _Use_decl_annotations_
-void MpRxInit(PMP_ADAPTER pAdapter)
+void MpRxInit(PMP_CHANNEL pChannel)
 {
+    PMP_ADAPTER          pAdapter = pChannel->pAdapter;
     PENET_BD             pDmaBD = NULL;
 
     ASSERT(pAdapter->Rx_DmaBDT_ItemCount);                                                // There must be at least one Rx buffer
-    pAdapter->Rx_EnetFreeBDIdx           = 0;                                             // Initialize HW Dma buffer descriptor ring index
-    pAdapter->Rx_EnetPendingBDIdx        = 0;                                             
+    pChannel->Rx_EnetFreeBDIdx           = 0;                                             // Initialize HW Dma buffer descriptor ring index
+    pChannel->Rx_EnetPendingBDIdx        = 0;                                             
     pAdapter->Rx_NBLCounter              = 0;
-    pAdapter->Rx_NdisOwnedBDsCount       = 0;                                             // No buffer is owned by NDIS
-    pAdapter->Rx_DmaBDT_DmaOwnedBDsCount = pAdapter->Rx_DmaBDT_ItemCount;                 // All Rx BDs are owned by ENET DMA
-    NdisZeroMemory(&pAdapter->RcvStatus, sizeof(pAdapter->RcvStatus));
+    pChannel->Rx_NdisOwnedBDsCount       = 0;                                             // No buffer is owned by NDIS
+    pChannel->Rx_DmaBDT_DmaOwnedBDsCount = pAdapter->Rx_DmaBDT_ItemCount;                 // All Rx BDs are owned by ENET DMA
+    NdisZeroMemory(&pChannel->RcvStatus, sizeof(pChannel->RcvStatus));
     for (LONG Idx = 0; Idx < pAdapter->Rx_DmaBDT_ItemCount; ++Idx) {                      // For each DmaBD do:
-        MP_RX_FRAME_BD *pRxFrameBD = &pAdapter->Rx_FrameBDT[Idx];
-        pDmaBD = &pAdapter->Rx_DmaBDT[Idx];                                               // Get DmaBD address
-        pAdapter->Rx_DmaBDT_SwExt[Idx].pRxFrameBD = pRxFrameBD;                           // Create link between Rx frame descriptor and DmaBD
+        MP_RX_FRAME_BD *pRxFrameBD = &pChannel->Rx_FrameBDT[Idx];
+        pDmaBD = &pChannel->Rx_DmaBDT[Idx];                                               // Get DmaBD address
+        pChannel->Rx_DmaBDT_SwExt[Idx].pRxFrameBD = pRxFrameBD;                           // Create link between Rx frame descriptor and DmaBD
+        pRxFrameBD->pChannel = pChannel;                                                  // Rx frame descriptor is owned by this channel
         NET_BUFFER_LIST_NEXT_NBL(pRxFrameBD->pNBL) = NULL;                                // Not necessary consider removing
         NT_ASSERT(pRxFrameBD->BufferPa.HighPart == 0);
         pDmaBD->des0 = pRxFrameBD->BufferPa.LowPart + 2;                                  // Fill DmaBD data buffer address
@@ -783,7 +902,7 @@ void MpRxInit(PMP_ADAPTER pAdapter)
 
 /*++
 Routine Description:
-    Returns TRUE if ndis owns at lease one RX buffer.
+    Returns TRUE if ndis owns at lease one RX buffer of any DMA channel.
 Arguments:
     pAdapter    Pointer to adapter data
 Return Value:
@@ -792,10 +911,13 @@ Return Value:
 --*/
 _Use_decl_annotations_
 BOOLEAN IsRxFramePandingInNdis(PMP_ADAPTER pAdapter) {
-    BOOLEAN RxFramePanding;
-    NdisAcquireSpinLock(&pAdapter->Rx_SpinLock);
-    RxFramePanding = pAdapter->Rx_NdisOwnedBDsCount != 0;
-    NdisReleaseSpinLock(&pAdapter->Rx_SpinLock);
+    BOOLEAN RxFramePanding = FALSE;
+    for (ULONG Idx = 0; Idx < pAdapter->ChannelCount; ++Idx) {
+        PMP_CHANNEL pChannel = &pAdapter->Channel[Idx];
+        NdisAcquireSpinLock(&pChannel->Rx_SpinLock);
+        RxFramePanding |= pChannel->Rx_NdisOwnedBDsCount != 0;
+        NdisReleaseSpinLock(&pChannel->Rx_SpinLock);
+    }
     return RxFramePanding;
 }
 
@@ -803,6 +925,7 @@ BOOLEAN IsRxFramePandingInNdis(PMP_ADAPTER pAdapter) {
 Routine Description:
     MiniportReturnNetBufferLists handler. NDIS will call this function once it is done with the RX frames
     indicated using NdisMIndicateReceiveNetBufferLists(),  so the miniport can re-use them for new RX frames.
+    The NBLs may belong to different DMA channels, each frame is returned to the ring of its own channel.
 Argument:
     MiniportAdapterContext
         Our adapter context
@@ -817,32 +940,41 @@ _Use_decl_annotations_
 void MpReturnNetBufferLists(NDIS_HANDLE MiniportAdapterContext, PNET_BUFFER_LIST pNBL, ULONG ReturnFlags)
 {
     PMP_ADAPTER       pAdapter = (PMP_ADAPTER)MiniportAdapterContext;
+    PMP_CHANNEL       pChannel = NULL;
     PNET_BUFFER_LIST  pNextNBL;
     PMP_RX_FRAME_BD   pRxFrameBD;
     PENET_BD          pCurrentDmaBD;
-    LONG              Rx_EnetFreeBDIdx;
+    LONG              Rx_EnetFreeBDIdx = 0;
 
     UNREFERENCED_PARAMETER(ReturnFlags);
     DBG_ENET_DEV_RX_METHOD_BEG();
 
-    NdisAcquireSpinLock(&pAdapter->Rx_SpinLock);
-    Rx_EnetFreeBDIdx = pAdapter->Rx_EnetFreeBDIdx;
     // Mark all returned frames as active, so adapter DMA can use them for future RX frames.
     ASSERT(pNBL);
     for (PNET_BUFFER_LIST pCurrentNBL = pNBL; pCurrentNBL != NULL; pCurrentNBL = pNextNBL) {
         pNextNBL = NET_BUFFER_LIST_NEXT_NBL(pCurrentNBL);
         pRxFrameBD = MP_NBL_RX_FRAME_BD(pCurrentNBL);                               // Get Frame BD address from the current NBL.
+        if (pRxFrameBD->pChannel != pChannel) {                                     // Frame of other DMA channel?
+            if (pChannel != NULL) {                                                 // Yes, finish the previous channel
+                pChannel->Rx_EnetFreeBDIdx = Rx_EnetFreeBDIdx;                      // Update Rx_EnetFreeBDIdx
+                pAdapter->ENETRegBase->DMA_CH[pChannel->Idx].DMA_CHX_RXDESC_TAIL_PTR.R = pChannel->Rx_DmaBDT_Pa.LowPart + (pAdapter->Rx_DmaBDT_ItemCount * (UINT32)sizeof(ENET_BD)); //Trigger DMA
+                NdisReleaseSpinLock(&pChannel->Rx_SpinLock);
+            }
+            pChannel = pRxFrameBD->pChannel;
+            NdisAcquireSpinLock(&pChannel->Rx_SpinLock);
+            Rx_EnetFreeBDIdx = pChannel->Rx_EnetFreeBDIdx;
+        }
         /* MS-temp */ NdisAdjustMdlLength(pRxFrameBD->pMdl, ENET_RX_FRAME_SIZE);
-        pAdapter->Rx_DmaBDT_DmaOwnedBDsCount++;                                     // Increment counter of Rx BDs owned by ENET DMA.
-        pAdapter->Rx_NdisOwnedBDsCount--;
+        pChannel->Rx_DmaBDT_DmaOwnedBDsCount++;                                     // Increment counter of Rx BDs owned by ENET DMA.
+        pChannel->Rx_NdisOwnedBDsCount--;
         if (!pAdapter->EnetStarted) {
             continue;
         }
-        ASSERT(!pAdapter->Rx_DmaBDT_SwExt[Rx_EnetFreeBDIdx].pRxFrameBD);
+        ASSERT(!pChannel->Rx_DmaBDT_SwExt[Rx_EnetFreeBDIdx].pRxFrameBD);
         /* Reuse frame descriptor */
-        pAdapter->Rx_DmaBDT_SwExt[Rx_EnetFreeBDIdx].pRxFrameBD = pRxFrameBD;    // Association current Frame BD and the first free Dma BD
-        DBG_ENET_DEV_RX_PRINT_TRACE("NBL(%4d, 0x%08X) returned,       DmaIdx: %4d, NewDmaIdx: %4d DmaBD ready: %4d, PhyAddr: 0x%08X", MP_NBL_ID(pCurrentNBL), pCurrentNBL, MP_NB_DmaIdx(pCurrentNBL->FirstNetBuffer), Rx_EnetFreeBDIdx, pAdapter->Rx_DmaBDT_DmaOwnedBDsCount, pRxFrameBD->BufferPa.LowPart);
-        pCurrentDmaBD                = &pAdapter->Rx_DmaBDT[Rx_EnetFreeBDIdx];  // Get address of the first free Dma BD
+        pChannel->Rx_DmaBDT_SwExt[Rx_EnetFreeBDIdx].pRxFrameBD = pRxFrameBD;    // Association current Frame BD and the first free Dma BD
+        DBG_ENET_DEV_RX_PRINT_TRACE("NBL(%4d, 0x%08X) returned,       DmaIdx: %4d, NewDmaIdx: %4d DmaBD ready: %4d, PhyAddr: 0x%08X", MP_NBL_ID(pCurrentNBL), pCurrentNBL, MP_NB_DmaIdx(pCurrentNBL->FirstNetBuffer), Rx_EnetFreeBDIdx, pChannel->Rx_DmaBDT_DmaOwnedBDsCount, pRxFrameBD->BufferPa.LowPart);
+        pCurrentDmaBD                = &pChannel->Rx_DmaBDT[Rx_EnetFreeBDIdx];  // Get address of the first free Dma BD
         NT_ASSERT(pRxFrameBD->BufferPa.HighPart == 0);
         pCurrentDmaBD->des0 = pRxFrameBD->BufferPa.LowPart + 2;                 // Fill Dma BD data buffer address
         pCurrentDmaBD->des1 = 0;
@@ -856,21 +988,127 @@ void MpReturnNetBufferLists(NDIS_HANDLE MiniportAdapterContext, PNET_BUFFER_LIST
             Rx_EnetFreeBDIdx = 0;
         }
     } // More free buffers
-    pAdapter->Rx_EnetFreeBDIdx = Rx_EnetFreeBDIdx;                              // Update Rx_EnetFreeBDIdx
-    pAdapter->ENETRegBase->DMA_CH[0].DMA_CHX_RXDESC_TAIL_PTR.R = pAdapter->Rx_DmaBDT_Pa.LowPart + (pAdapter->Rx_DmaBDT_ItemCount * (UINT32)sizeof(ENET_BD)); //Trigger DMA
-
-    NdisReleaseSpinLock(&pAdapter->Rx_SpinLock);
+    if (pChannel != NULL) {
+        pChannel->Rx_EnetFreeBDIdx = Rx_EnetFreeBDIdx;                          // Update Rx_EnetFreeBDIdx
+        pAdapter->ENETRegBase->DMA_CH[pChannel->Idx].DMA_CHX_RXDESC_TAIL_PTR.R = pChannel->Rx_DmaBDT_Pa.LowPart + (pAdapter->Rx_DmaBDT_ItemCount * (UINT32)sizeof(ENET_BD)); //Trigger DMA
+        NdisReleaseSpinLock(&pChannel->Rx_SpinLock);
+    }
     DBG_ENET_DEV_RX_METHOD_END();
 }
 
+/*++
+Routine Description:
+    Computes the RSS hash of the received frames and moves the frames, that have to be indicated on other processor,
+    to the RSS pending list of the target processor. The target processor DPC indicates them to NDIS.
+    The ENET QOS has no RSS hash engine, the Toeplitz hash is computed here, at DPC level.
+Arguments:
+    pAdapter        Pointer to the adapter structure.
+    ppNBLHead       Address of the NBL list head, only the frames of the current processor remain in the list
+    pNBLCount       Address of the NBL list item count
+    Distribute      FALSE - the hash is computed only, all the frames remain in the list
+Return Value:
+    Mask of processors whose RSS pending list has been updated
+--*/
+_IRQL_requires_(DISPATCH_LEVEL)
+ULONG MpRssDistributeNBLs(_In_ PMP_ADAPTER pAdapter, _Inout_ PNET_BUFFER_LIST *ppNBLHead, _Inout_ PULONG pNBLCount, _In_ BOOLEAN Distribute)
+{
+    LOCK_STATE_EX      LockState;
+    PNET_BUFFER_LIST   pNextNBL;
+    PNET_BUFFER_LIST   pLocalNBLHead     = NULL;
+    PNET_BUFFER_LIST  *ppLocalNBLTail    = &pLocalNBLHead;
+    ULONG              LocalNBLItemCount = 0;
+    ULONG              ProcessorMask     = 0;
+    ULONG              CurrentProcessor  = KeGetCurrentProcessorIndex();
+
+    NdisAcquireRWLockRead(pAdapter->Rss_Lock, &LockState, NDIS_RWL_AT_DISPATCH_LEVEL);
+    for (PNET_BUFFER_LIST pCurrentNBL = *ppNBLHead; pCurrentNBL != NULL; pCurrentNBL = pNextNBL) {
+        PMP_RX_FRAME_BD pRxFrameBD = MP_NBL_RX_FRAME_BD(pCurrentNBL);
+        ULONG           HashValue;
+        ULONG           Processor;
+        ULONG           HashType;
+
+        pNextNBL = NET_BUFFER_LIST_NEXT_NBL(pCurrentNBL);
+        NET_BUFFER_LIST_NEXT_NBL(pCurrentNBL) = NULL;
+        HashType = MpRssClassify(&pAdapter->Rss, pRxFrameBD->pBuffer + 2, NET_BUFFER_DATA_LENGTH(NET_BUFFER_LIST_FIRST_NB(pCurrentNBL)), &HashValue, &Processor);
+        if (HashType != 0) {
+            NET_BUFFER_LIST_SET_HASH_VALUE(pCurrentNBL, HashValue);
+            NET_BUFFER_LIST_SET_HASH_TYPE(pCurrentNBL, HashType);
+            NET_BUFFER_LIST_SET_HASH_FUNCTION(pCurrentNBL, NdisHashFunctionToeplitz);
+        } else {
+            NET_BUFFER_LIST_INFO(pCurrentNBL, NetBufferListHashInfo)  = NULL;     // RSS disabled or the frame can not be hashed
+            NET_BUFFER_LIST_INFO(pCurrentNBL, NetBufferListHashValue) = NULL;
+            Processor = CurrentProcessor;
+        }
+        if (Distribute && (Processor != CurrentProcessor) && (Processor < pAdapter->ProcessorCount)) {
+            PMP_RSS_PROCESSOR pRssProcessor = &pAdapter->Rss_Processor[Processor];
+            NdisDprAcquireSpinLock(&pRssProcessor->Lock);
+            if (pRssProcessor->pNBLTail != NULL) {
+                NET_BUFFER_LIST_NEXT_NBL(pRssProcessor->pNBLTail) = pCurrentNBL;
+            } else {
+                pRssProcessor->pNBLHead = pCurrentNBL;
+            }
+            pRssProcessor->pNBLTail = pCurrentNBL;
+            pRssProcessor->NBLCount++;
+            NdisDprReleaseSpinLock(&pRssProcessor->Lock);
+            ProcessorMask |= 1UL << Processor;
+        } else {
+            *ppLocalNBLTail = pCurrentNBL;                                         // Indicate the frame on the current processor
+            ppLocalNBLTail  = &NET_BUFFER_LIST_NEXT_NBL(pCurrentNBL);
+            LocalNBLItemCount++;
+        }
+    }
+    NdisReleaseRWLock(pAdapter->Rss_Lock, &LockState);
+    *ppNBLHead = pLocalNBLHead;
+    *pNBLCount = LocalNBLItemCount;
+    return ProcessorMask;
+}
+
+/*++
+Routine Description:
+    Indicates the frames of the current processor RSS pending list to NDIS. It is called from EnetDpc().
+    If the miniport is not ready, the frames are returned to the DMA rings.
+Arguments:
+    pAdapter        Pointer to the adapter structure.
+Return Value:
+    None
+--*/
+_Use_decl_annotations_
+void MpRssIndicatePendingNBLs(PMP_ADAPTER pAdapter)
+{
+    ULONG              Processor = KeGetCurrentProcessorIndex();
+    PMP_RSS_PROCESSOR  pRssProcessor;
+    PNET_BUFFER_LIST   pNBLHead;
+    ULONG              NBLItemCount;
+
+    if (Processor >= pAdapter->ProcessorCount) {
+        return;
+    }
+    pRssProcessor = &pAdapter->Rss_Processor[Processor];
+    NdisDprAcquireSpinLock(&pRssProcessor->Lock);
+    pNBLHead     = pRssProcessor->pNBLHead;
+    NBLItemCount = pRssProcessor->NBLCount;
+    pRssProcessor->pNBLHead = NULL;
+    pRssProcessor->pNBLTail = NULL;
+    pRssProcessor->NBLCount = 0;
+    NdisDprReleaseSpinLock(&pRssProcessor->Lock);
+    if (pNBLHead == NULL) {
+        return;
+    }
+    if (pAdapter->NdisStatus != NDIS_STATUS_SUCCESS) {                        // Mp ready to indicate Rx packets?
+        MpReturnNetBufferLists(pAdapter, pNBLHead, NDIS_RETURN_FLAGS_DISPATCH_LEVEL);
+        return;
+    }
+    NdisMIndicateReceiveNetBufferLists(pAdapter->AdapterHandle, pNBLHead, NDIS_DEFAULT_PORT_NUMBER, NBLItemCount, NDIS_RECEIVE_FLAGS_DISPATCH_LEVEL);
+}
+
 /*++
 Routine Description:
     Interrupt handler for receive processing. Put the received packets into an array and call
     NdisMIndicateReceivePacket. If we run low on RFDs, allocate another one
-    Assumption: Receive spin lock has been acquired
+    If RSS is enabled, the frames are hashed and the frames of other processors are handed over to their DPCs.
 Arguments:
-    pAdapter
-        Pointer to the adapter structure.
+    pChannel
+        Pointer to the DMA channel structure.
     pMaxNBLsToIndicate
         A pointer to the maximal number of RX frames we indicate to NDIS
     pRecvThrottleParameters
@@ -880,8 +1118,9 @@ Return Value:
     None
 --*/
 _Use_decl_annotations_
-void MpHandleRecvInterrupt(PMP_ADAPTER pAdapter, PULONG pMaxNBLsToIndicate, PNDIS_RECEIVE_THROTTLE_PARAMETERS pRecvThrottleParameters)
+void MpHandleRecvInterrupt(PMP_CHANNEL pChannel, PULONG pMaxNBLsToIndicate, PNDIS_RECEIVE_THROTTLE_PARAMETERS pRecvThrottleParameters)
 {
+    PMP_ADAPTER      pAdapter          = pChannel->pAdapter;
     PNET_BUFFER_LIST *ppNBLTail;
     PNET_BUFFER_LIST pErrorNBLHead     = NULL;
     ULONG            ErrorNBLItemCount = 0;
@@ -892,21 +1131,22 @@ void MpHandleRecvInterrupt(PMP_ADAPTER pAdapter, PULONG pMaxNBLsToIndicate, PNDI
     PNET_BUFFER_LIST pSyncNBLTail      = NULL;
     ULONG            SyncNBLItemCount = 0;
     LONG             Rx_EnetPendingBDIdx;
+    ULONG            ProcessorMask     = 0;
 
     DBG_ENET_DEV_DPC_RX_METHOD_BEG();
-    NdisDprAcquireSpinLock(&pAdapter->Rx_SpinLock);
+    NdisDprAcquireSpinLock(&pChannel->Rx_SpinLock);
     if (pAdapter->NdisStatus != NDIS_STATUS_SUCCESS) {                        // Mp ready to indicate Rx packets?
-       NdisDprReleaseSpinLock(&pAdapter->Rx_SpinLock);                        // No, do nothing
+       NdisDprReleaseSpinLock(&pChannel->Rx_SpinLock);                        // No, do nothing
        DBG_ENET_DEV_DPC_RX_METHOD_END();
        return;
     }
-    Rx_EnetPendingBDIdx = pAdapter->Rx_EnetPendingBDIdx;
+    Rx_EnetPendingBDIdx = pChannel->Rx_EnetPendingBDIdx;
     for (LONG Idx = 0; Idx < pAdapter->Rx_DmaBDT_ItemCount; ++Idx) {          // One call of MpHandleRecvInterrupt() will indicate up to pAdapter->Rx_DmaBDT_ItemCount NBLs
-        PENET_BD pDmaBD = &pAdapter->Rx_DmaBDT[Rx_EnetPendingBDIdx];          // Get address of the first not checked BD
+        PENET_BD pDmaBD = &pChannel->Rx_DmaBDT[Rx_EnetPendingBDIdx];          // Get address of the first not checked BD
         if (pDmaBD->des3 & RDES3_OWN_MASK) {                                  // No data received or reception in progress?
             break;                                                            // Stop BD checking
         }
-        if (pAdapter->Rx_DmaBDT_DmaOwnedBDsCount == 0) {                      // All NBL has been already indicated to NDIS, next packet will be lost
+        if (pChannel->Rx_DmaBDT_DmaOwnedBDsCount == 0) {                      // All NBL has been already indicated to NDIS, next packet will be lost
             break;
         }
         if ((*pMaxNBLsToIndicate) == 0) {                                     // Did we reach the max number of RX frames we are allowed to indicate to NDIS?
@@ -914,10 +1154,10 @@ void MpHandleRecvInterrupt(PMP_ADAPTER pAdapter, PULONG pMaxNBLsToIndicate, PNDI
             pRecvThrottleParameters->MoreNblsPending = TRUE;                  // No, inform NDIS about it
             break;
         }
-        pAdapter->Rx_DmaBDT_DmaOwnedBDsCount--;                                                    // Decrement counter of Rx BDs owned by ENET DMA
-        PMP_RX_FRAME_BD pRxFrameBD = pAdapter->Rx_DmaBDT_SwExt[Rx_EnetPendingBDIdx].pRxFrameBD;    // Get frame descriptor
+        pChannel->Rx_DmaBDT_DmaOwnedBDsCount--;                                                    // Decrement counter of Rx BDs owned by ENET DMA
+        PMP_RX_FRAME_BD pRxFrameBD = pChannel->Rx_DmaBDT_SwExt[Rx_EnetPendingBDIdx].pRxFrameBD;    // Get frame descriptor
         ASSERT(pRxFrameBD != NULL);
-        pAdapter->Rx_DmaBDT_SwExt[Rx_EnetPendingBDIdx].pRxFrameBD = NULL;                          // Disconnect Rx Frame BD from ENET DMA BD
+        pChannel->Rx_DmaBDT_SwExt[Rx_EnetPendingBDIdx].pRxFrameBD = NULL;                          // Disconnect Rx Frame BD from ENET DMA BD
         PNET_BUFFER_LIST  pCurrentNBL     = pRxFrameBD->pNBL;                                      // Get NBL
         ULONG             realFrameLength = ((ULONG)pDmaBD->des3 & RDES3_PL_MASK);                 // Compute real data length
         #if DBG
@@ -931,11 +1171,11 @@ void MpHandleRecvInterrupt(PMP_ADAPTER pAdapter, PULONG pMaxNBLsToIndicate, PNDI
             /* MS-temp */ NdisAdjustMdlLength(pRxFrameBD->pMdl, ENET_RX_FRAME_SIZE);
             NET_BUFFER_LIST_NEXT_NBL(pCurrentNBL) = pErrorNBLHead;        // Append this NBL to the had of the error NBL list
             pErrorNBLHead = pCurrentNBL;
-            pAdapter->RcvStatus.FrameRcvErrors++;
+            pChannel->RcvStatus.FrameRcvErrors++;
             ErrorNBLItemCount++;
             DBG_ENET_DEV_PRINT_ERROR("RX packet error, RDES3 = 0x%08X", pDmaBD->des3);
         } else {
-            pAdapter->RcvStatus.FrameRcvGood++;                                        // Increment internal stats counter of the RX OK frames
+            pChannel->RcvStatus.FrameRcvGood++;                                        // Increment internal stats counter of the RX OK frames
             (*pMaxNBLsToIndicate)--;                                                   // Decrement MaxNBLsToIndicate counter
             NdisFlushBuffer(pRxFrameBD->pMdl, FALSE);                                  // Flush Rx buffer
 #if 0
@@ -952,9 +1192,9 @@ void MpHandleRecvInterrupt(PMP_ADAPTER pAdapter, PULONG pMaxNBLsToIndicate, PNDI
                 }
 #endif
             /* MS-temp */NdisAdjustMdlLength(pRxFrameBD->pMdl, realFrameLength + 2);// +2);   // Update real length in MDL
-            DBG_ENET_DEV_RX_PRINT_TRACE(" NBL(%4d) data received, DmaIdx: %4d, DmaOwnedBDs: %4d:, Size: %d, PhyAddr: 0x%08X", MP_NBL_ID(pCurrentNBL), Rx_EnetPendingBDIdx, pAdapter->Rx_DmaBDT_DmaOwnedBDsCount, realFrameLength, pRxFrameBD->BufferPa.LowPart);
+            DBG_ENET_DEV_RX_PRINT_TRACE(" NBL(%4d) data received, DmaIdx: %4d, DmaOwnedBDs: %4d:, Size: %d, PhyAddr: 0x%08X", MP_NBL_ID(pCurrentNBL), Rx_EnetPendingBDIdx, pChannel->Rx_DmaBDT_DmaOwnedBDsCount, realFrameLength, pRxFrameBD->BufferPa.LowPart);
             // Decide how we are going to indicate the RX buffer to NDIS. If we are running low on RX buffers, we will do in synchronously, otherwise we do it asynchronously.
-            if (pAdapter->Rx_DmaBDT_DmaOwnedBDsCount <= pAdapter->Rx_DmaBDT_DmaOwnedBDsLowWatterMark) {
+            if (pChannel->Rx_DmaBDT_DmaOwnedBDsCount <= pAdapter->Rx_DmaBDT_DmaOwnedBDsLowWatterMark) {
                 ppNBLTail = &pSyncNBLTail;                            // Low RX buffers level, use synchronous RX buffer indication
                 if (pSyncNBLTail == NULL) {                           // Synchronous NBL list empty?
                     pSyncNBLHead = pCurrentNBL;                       // Current NBL is the first item of the Synchronous NBL list
@@ -980,13 +1220,30 @@ void MpHandleRecvInterrupt(PMP_ADAPTER pAdapter, PULONG pMaxNBLsToIndicate, PNDI
             Rx_EnetPendingBDIdx = 0;
         }
     } // More RFDs
-    pAdapter->Rx_EnetPendingBDIdx = Rx_EnetPendingBDIdx;              // Update Ethernet Dma Rx empty buffer index
-    pAdapter->Rx_NdisOwnedBDsCount += AsyncNBLItemCount + SyncNBLItemCount + ErrorNBLItemCount;
-    NdisDprReleaseSpinLock(&pAdapter->Rx_SpinLock);
+    pChannel->Rx_EnetPendingBDIdx = Rx_EnetPendingBDIdx;              // Update Ethernet Dma Rx empty buffer index
+    pChannel->Rx_NdisOwnedBDsCount += AsyncNBLItemCount + SyncNBLItemCount + ErrorNBLItemCount;
+    NdisDprReleaseSpinLock(&pChannel->Rx_SpinLock);
     if (pErrorNBLHead) {
         DBG_ENET_DEV_RX_PRINT_ERROR(" NBL(%4d) received with error, returning back", MP_NBL_ID(pErrorNBLHead));
         MpReturnNetBufferLists(pAdapter, pErrorNBLHead, 0);
     }
+    if (pAdapter->RssEnabled) {
+        if (pAsyncNBLHead) {    // Hash the frames and hand over the frames of other processors to their DPCs
+            ProcessorMask = MpRssDistributeNBLs(pAdapter, &pAsyncNBLHead, &AsyncNBLItemCount, TRUE);
+        }
+        if (pSyncNBLHead) {     // The frames are returned to the DMA ring immediately, hash only
+            (void)MpRssDistributeNBLs(pAdapter, &pSyncNBLHead, &SyncNBLItemCount, FALSE);
+        }
+        for (ULONG Processor = 0; ProcessorMask != 0; ++Processor, ProcessorMask >>= 1) {
+            if (ProcessorMask & 1UL) {
+                GROUP_AFFINITY Affinity;
+                NdisZeroMemory(&Affinity, sizeof(Affinity));
+                Affinity.Group = 0;
+                Affinity.Mask  = (KAFFINITY)1 << Processor;
+                (void)NdisMQueueDpcEx(pAdapter->NdisInterruptHandle, 0, &Affinity, NULL);    // Run EnetDpc on the target processor
+            }
+        }
+    }
     // Indicate received RX frames to NDIS, if any...
     if (pAsyncNBLHead) {    // Asynchronous list not empty?
         NdisMIndicateReceiveNetBufferLists(pAdapter->AdapterHandle, pAsyncNBLHead, NDIS_DEFAULT_PORT_NUMBER, AsyncNBLItemCount, NDIS_RECEIVE_FLAGS_DISPATCH_LEVEL);
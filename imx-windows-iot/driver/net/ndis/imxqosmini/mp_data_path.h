@@ -68,11 +68,13 @@ void MpQueueAdd(_In_ PMP_QUEUE QueuePtr, PLIST_ENTRY ListEntryPtr);
 _IRQL_requires_max_(DISPATCH_LEVEL)
 LONG MpQueueGetDepth(PMP_QUEUE pQueue);
 _IRQL_requires_max_(DISPATCH_LEVEL)
-void MpHandleTxInterrupt(_In_ PMP_ADAPTER pAdapter, _In_ UINT32 InterruptEvent);
+void MpHandleTxInterrupt(_In_ PMP_CHANNEL pChannel, _In_ UINT32 InterruptEvent);
 _IRQL_requires_max_(DISPATCH_LEVEL)
-void MpHandleRecvInterrupt(_In_ PMP_ADAPTER pAdapter, _Inout_ PULONG pMaxNBLsToIndicate, _Inout_ PNDIS_RECEIVE_THROTTLE_PARAMETERS pRecvThrottleParameters);
-void MpTxInit(_In_ PMP_ADAPTER pAdapter);
-void MpRxInit(_In_ PMP_ADAPTER pAdapter);
+void MpHandleRecvInterrupt(_In_ PMP_CHANNEL pChannel, _Inout_ PULONG pMaxNBLsToIndicate, _Inout_ PNDIS_RECEIVE_THROTTLE_PARAMETERS pRecvThrottleParameters);
+_IRQL_requires_(DISPATCH_LEVEL)
+void MpRssIndicatePendingNBLs(_In_ PMP_ADAPTER pAdapter);
+void MpTxInit(_In_ PMP_CHANNEL pChannel);
+void MpRxInit(_In_ PMP_CHANNEL pChannel);
 BOOLEAN IsRxFramePandingInNdis(_In_ PMP_ADAPTER pAdapter);
 
 #endif // _MP_DATA_PATH_H
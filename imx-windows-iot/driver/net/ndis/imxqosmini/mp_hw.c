@@ -110,6 +110,7 @@ void ClearAllMultiCast(PMP_ADAPTER pAdapter)
 /*++
 Routine Description:
     MiniportHandleInterrupt handler
+    Indicates the frames handed over to this processor by RSS and serves the DMA channels whose DPC runs on this processor.
 Arguments:
     MiniportInterruptContext
         Pointer to the interrupt context. In this is a pointer to the adapter structure.
@@ -130,6 +131,7 @@ VOID EnetDpc(NDIS_HANDLE  MiniportInterruptContext, PVOID MiniportDpcContext, PV
     UINT32                             InterruptEvent, InterruptFlags;
     PNDIS_RECEIVE_THROTTLE_PARAMETERS  pRecvThrottleParameters = (PNDIS_RECEIVE_THROTTLE_PARAMETERS)ReceiveThrottleParameters;
     ULONG                              MaxNBLsToIndicate;
+    ULONG                              CurrentProcessor = KeGetCurrentProcessorIndex();
 
     UNREFERENCED_PARAMETER(MiniportDpcContext);
     UNREFERENCED_PARAMETER(NdisReserved2);
@@ -141,47 +143,48 @@ VOID EnetDpc(NDIS_HANDLE  MiniportInterruptContext, PVOID MiniportDpcContext, PV
     }
 
     pRecvThrottleParameters->MoreNblsPending = FALSE;
-    do {
+    if (pAdapter->RssEnabled) {
+        MpRssIndicatePendingNBLs(pAdapter);                                    // Frames received by other processors for this one
+    }
+    for (ULONG Idx = 0; Idx < pAdapter->ChannelCount; ++Idx) {
+        PMP_CHANNEL pChannel = &pAdapter->Channel[Idx];
+        if (pChannel->DpcProcessor != CurrentProcessor) {                      // Channel served by other processor?
+            continue;
+        }
         NdisDprAcquireSpinLock(&pAdapter->Dev_SpinLock);
-        pAdapter->DpcQueued  = FALSE;
-        pAdapter->DpcRunning = TRUE;
-        InterruptFlags = pAdapter->ENETRegBase->DMA_CH[0].DMA_CHX_STAT.R;  // Get current interrupt flags from HW register
-        pAdapter->ENETRegBase->DMA_CH[0].DMA_CHX_STAT.R = InterruptFlags;  // Clear current interrupt flags in HW register
-        InterruptFlags |= pAdapter->InterruptFlags;                        // Add saved interrupt flags
-        pAdapter->InterruptFlags = 0;                                      // Clear saved interrupt flags
+        if (!pChannel->DpcQueued && !pChannel->InterruptFlags) {               // Channel interrupt neither queued nor saved?
+            NdisDprReleaseSpinLock(&pAdapter->Dev_SpinLock);
+            continue;
+        }
+        pChannel->DpcQueued = FALSE;
+        InterruptFlags = pAdapter->ENETRegBase->DMA_CH[Idx].DMA_CHX_STAT.R;    // Get current interrupt flags from HW register
+        pAdapter->ENETRegBase->DMA_CH[Idx].DMA_CHX_STAT.R = InterruptFlags;    // Clear current interrupt flags in HW register
+        InterruptFlags |= pChannel->InterruptFlags;                            // Add saved interrupt flags
+        pChannel->InterruptFlags = 0;                                          // Clear saved interrupt flags
         NdisDprReleaseSpinLock(&pAdapter->Dev_SpinLock);
-        InterruptEvent = InterruptFlags;                                   // Compute new interrupt flags
-
-        if (!InterruptEvent)                                               // An interrupt ready to be served?
-            break;                                                         // No, finish DPC
+        InterruptEvent = InterruptFlags;                                       // Compute new interrupt flags
 
         if (InterruptEvent & IMX_ENET_QOS_DMA_CHX_STAT_TI_MASK) {                        // Handle frame(s) sent or sent error interrupt
-            MpHandleTxInterrupt(pAdapter, InterruptEvent);
+            MpHandleTxInterrupt(pChannel, InterruptEvent);
         }
         if (InterruptEvent & IMX_ENET_QOS_DMA_CHX_STAT_RI_MASK) {                        // Handle frame(s) received or receive error interrupt
-            MpHandleRecvInterrupt(pAdapter, &MaxNBLsToIndicate, pRecvThrottleParameters);
-            if (pRecvThrottleParameters->MoreNblsPending) {
-                NdisDprAcquireSpinLock(&pAdapter->Dev_SpinLock);
-                pAdapter->InterruptFlags |= (InterruptEvent & IMX_ENET_QOS_DMA_CHX_STAT_RI_MASK); // We have to prepare interrupt flags for NDIS called EnetDPC
-                NdisDprReleaseSpinLock(&pAdapter->Dev_SpinLock);
-                break;
-            }
+            MpHandleRecvInterrupt(pChannel, &MaxNBLsToIndicate, pRecvThrottleParameters);
+        }
+        if (pRecvThrottleParameters->MoreNblsPending) {
+            NdisDprAcquireSpinLock(&pAdapter->Dev_SpinLock);
+            pChannel->InterruptFlags |= IMX_ENET_QOS_DMA_CHX_STAT_RI_MASK;   // We have to prepare interrupt flags for NDIS called EnetDPC
+            NdisDprReleaseSpinLock(&pAdapter->Dev_SpinLock);
+        } else {
+            NdisMSynchronizeWithInterruptEx(pAdapter->NdisInterruptHandle, 0, EnetEnableChannelInterrupts, pChannel);
         }
-
-    } while (0);
-    if (!pRecvThrottleParameters->MoreNblsPending) {
-      NdisMSynchronizeWithInterruptEx(pAdapter->NdisInterruptHandle, 0, EnetEnableRxAndTxInterrupts, pAdapter);
     }
-    NdisDprAcquireSpinLock(&pAdapter->Dev_SpinLock);
-    pAdapter->DpcRunning = FALSE;
-    NdisDprReleaseSpinLock(&pAdapter->Dev_SpinLock);
     DBG_ENET_DEV_DPC_METHOD_END();
 }
 
 /*++
 Routine Description:
     Miniport ISR callback function.
-    Disables all ENET peripheral interrupts and queues DPC.
+    Disables the interrupts of the DMA channels that request service and queues DPC on the processors of these channels.
 Arguments:
     MiniportInterruptContext  Pointer to the miniport adapter data structure.
     QueueDefaultInterruptDpc  Set to TRUE value to queue DPC on default(this) CPU.
@@ -194,25 +197,36 @@ _Use_decl_annotations_
 BOOLEAN EnetIsr(NDIS_HANDLE MiniportInterruptContext, PBOOLEAN QueueDefaultInterruptDpc, PULONG TargetProcessors)
 {
     PMP_ADAPTER pAdapter = (PMP_ADAPTER)MiniportInterruptContext;
-    UNREFERENCED_PARAMETER(TargetProcessors);
+    ULONG       ProcessorMask = 0;
+
     DBG_ENET_DEV_ISR_METHOD_BEG();
-    if (pAdapter->ENETRegBase->DMA_CH[0].DMA_CHX_INT_EN.R != 0U) {
-        pAdapter->ENETRegBase->DMA_CH[0].DMA_CHX_INT_EN.R = 0x00;     // Disable all ENET interrupts. (EnetIsr will not be called again until interrupts are enabled in EnetDpc)
-        pAdapter->DpcQueued = TRUE;                                   // Remember that EnetDpc is queued
+    for (ULONG Idx = 0; Idx < pAdapter->ChannelCount; ++Idx) {
+        PMP_CHANNEL pChannel = &pAdapter->Channel[Idx];
+        if ((pAdapter->ENETRegBase->DMA_CH[Idx].DMA_CHX_INT_EN.R != 0U) &&
+            (pAdapter->ENETRegBase->DMA_CH[Idx].DMA_CHX_STAT.R & (IMX_ENET_QOS_DMA_CHX_STAT_TI_MASK | IMX_ENET_QOS_DMA_CHX_STAT_RI_MASK))) {
+            pAdapter->ENETRegBase->DMA_CH[Idx].DMA_CHX_INT_EN.R = 0x00;   // Disable channel interrupts. (EnetIsr will not be called again for this channel until interrupts are enabled in EnetDpc)
+            pChannel->DpcQueued = TRUE;                                   // Remember that EnetDpc is queued
+            ProcessorMask |= 1UL << pChannel->DpcProcessor;
+        }
+    }
+    if (ProcessorMask == (1UL << KeGetCurrentProcessorIndex())) {
         *QueueDefaultInterruptDpc = TRUE;                             // Schedule EnetDpc on the current CPU to complete the operation
         __analysis_assume(*TargetProcessors = 0);                     // If QueueDefaultInterruptDpc value is set to TRUE, NDIS ignores the value of the TargetProcessors parameter. Suppress analyser warning "Returning uninitialized memory". 
+    } else if (ProcessorMask != 0) {
+        *QueueDefaultInterruptDpc = FALSE;                            // Schedule EnetDpc on the processors of the channels
+        *TargetProcessors = ProcessorMask;
     } else {
         *QueueDefaultInterruptDpc = FALSE;                            // Do not schedule Dpc
         *TargetProcessors = 0;
         DBG_ENET_DEV_ISR_PRINT_WARNING("Spurious Interrupt.");
     }
     DBG_ENET_DEV_ISR_METHOD_END();
-    return *QueueDefaultInterruptDpc;
+    return ProcessorMask != 0;
 }
 
 /*++
 Routine Description:
-    Enables TxF, RxF and MII interrupts
+    Enables TxF, RxF and MII interrupts of all DMA channels
 Arguments:
     SynchronizeContext  The handle to the driver allocated context area.
     Return Value:
@@ -221,7 +235,24 @@ Arguments:
 _Use_decl_annotations_
 BOOLEAN EnetEnableRxAndTxInterrupts(NDIS_HANDLE SynchronizeContext) {
     PMP_ADAPTER  pAdapter = (PMP_ADAPTER)SynchronizeContext;
-    pAdapter->ENETRegBase->DMA_CH[0].DMA_CHX_INT_EN.R |= IMX_ENET_QOS_DMA_CHX_INT_EN_NIE_MASK | IMX_ENET_QOS_DMA_CHX_INT_EN_TIE_MASK | IMX_ENET_QOS_DMA_CHX_INT_EN_RIE_MASK; // Enable Rx and Tx interrupts
+    for (ULONG Idx = 0; Idx < pAdapter->ChannelCount; ++Idx) {
+        (void)EnetEnableChannelInterrupts(&pAdapter->Channel[Idx]);
+    }
+    return TRUE;
+}
+
+/*++
+Routine Description:
+    Enables TxF and RxF interrupts of one DMA channel
+Arguments:
+    SynchronizeContext  The DMA channel context.
+    Return Value:
+        Always returns TRUE
+--*/
+_Use_decl_annotations_
+BOOLEAN EnetEnableChannelInterrupts(NDIS_HANDLE SynchronizeContext) {
+    PMP_CHANNEL  pChannel = (PMP_CHANNEL)SynchronizeContext;
+    pChannel->pAdapter->ENETRegBase->DMA_CH[pChannel->Idx].DMA_CHX_INT_EN.R |= IMX_ENET_QOS_DMA_CHX_INT_EN_NIE_MASK | IMX_ENET_QOS_DMA_CHX_INT_EN_TIE_MASK | IMX_ENET_QOS_DMA_CHX_INT_EN_RIE_MASK; // Enable Rx and Tx interrupts
     return TRUE;
 }
 
@@ -239,10 +270,14 @@ _Use_decl_annotations_
 BOOLEAN EnetDisableRxAndTxInterrupts(NDIS_HANDLE SynchronizeContext) {
     PMP_ADAPTER  pAdapter = (PMP_ADAPTER)SynchronizeContext;
     volatile CSP_ENET_REGS  *ENETRegBase = pAdapter->ENETRegBase;
+    BOOLEAN      DpcQueued = FALSE;
 
-    pAdapter->ENETRegBase->DMA_CH[0].DMA_CHX_INT_EN.R &= ~(IMX_ENET_QOS_DMA_CHX_INT_EN_NIE_MASK | IMX_ENET_QOS_DMA_CHX_INT_EN_TIE_MASK | IMX_ENET_QOS_DMA_CHX_INT_EN_RIE_MASK); // Disable Rx and Tx interrupts
-    ENETRegBase->DMA_CH[0].DMA_CHX_STAT.R = 0xFFFF;                                                                                      // Clear Rx and Tx interrupts flags
-    return pAdapter->DpcQueued;
+    for (ULONG Idx = 0; Idx < pAdapter->ChannelCount; ++Idx) {
+        ENETRegBase->DMA_CH[Idx].DMA_CHX_INT_EN.R &= ~(IMX_ENET_QOS_DMA_CHX_INT_EN_NIE_MASK | IMX_ENET_QOS_DMA_CHX_INT_EN_TIE_MASK | IMX_ENET_QOS_DMA_CHX_INT_EN_RIE_MASK); // Disable Rx and Tx interrupts
+        ENETRegBase->DMA_CH[Idx].DMA_CHX_STAT.R = 0xFFFF;                                                                                      // Clear Rx and Tx interrupts flags
+        DpcQueued |= pAdapter->Channel[Idx].DpcQueued;
+    }
+    return DpcQueued;
 }
 
 /*++
@@ -261,8 +296,10 @@ void EnetQos_Stop(PMP_ADAPTER pAdapter, NDIS_STATUS NdisStatus)
     volatile CSP_ENET_REGS  *ENETRegBase = pAdapter->ENETRegBase;
 
     NdisAcquireSpinLock(&pAdapter->Dev_SpinLock);
-    NdisAcquireSpinLock(&pAdapter->Rx_SpinLock);
-    NdisAcquireSpinLock(&pAdapter->Tx_SpinLock);
+    for (ULONG Idx = 0; Idx < pAdapter->ChannelCount; ++Idx) {
+        NdisDprAcquireSpinLock(&pAdapter->Channel[Idx].Rx_SpinLock);
+        NdisDprAcquireSpinLock(&pAdapter->Channel[Idx].Tx_SpinLock);
+    }
     DBG_SM_PRINT_TRACE("Stopping ENET, all spinlocks acquired");
     NdisMSynchronizeWithInterruptEx(pAdapter->NdisInterruptHandle, 0, EnetDisableRxAndTxInterrupts, pAdapter);
     _DataSynchronizationBarrier();                                             // Wait until mem-io accesses are finished
@@ -271,8 +308,10 @@ void EnetQos_Stop(PMP_ADAPTER pAdapter, NDIS_STATUS NdisStatus)
     pAdapter->NdisStatus = NdisStatus;                    // Remember new NDIS status
     pAdapter->EnetStarted = FALSE;                        // Remember new Enet state
     DBG_SM_PRINT_TRACE("ENET stopped, status: %s, releasing all spinlocks", Dbg_GetNdisStatusName(NdisStatus));
-    NdisReleaseSpinLock(&pAdapter->Tx_SpinLock);
-    NdisReleaseSpinLock(&pAdapter->Rx_SpinLock);
+    for (ULONG Idx = pAdapter->ChannelCount; Idx-- > 0;) {
+        NdisDprReleaseSpinLock(&pAdapter->Channel[Idx].Tx_SpinLock);
+        NdisDprReleaseSpinLock(&pAdapter->Channel[Idx].Rx_SpinLock);
+    }
     NdisReleaseSpinLock(&pAdapter->Dev_SpinLock);
 }
 
@@ -291,8 +330,10 @@ void EnetQos_Start(PMP_ADAPTER pAdapter)
     volatile CSP_ENET_REGS  *ENETRegBase = pAdapter->ENETRegBase;
 
     NdisAcquireSpinLock(&pAdapter->Dev_SpinLock);
-    NdisAcquireSpinLock(&pAdapter->Rx_SpinLock);
-    NdisAcquireSpinLock(&pAdapter->Tx_SpinLock);
+    for (ULONG Idx = 0; Idx < pAdapter->ChannelCount; ++Idx) {
+        NdisDprAcquireSpinLock(&pAdapter->Channel[Idx].Rx_SpinLock);
+        NdisDprAcquireSpinLock(&pAdapter->Channel[Idx].Tx_SpinLock);
+    }
     DBG_SM_PRINT_TRACE("Starting ENET, all spinlocks acquired");
     pAdapter->EnetStarted = TRUE;                                              // Remember new Enet state
     pAdapter->NdisStatus = NDIS_STATUS_SUCCESS;                                // Remember new NDIS status
@@ -300,8 +341,10 @@ void EnetQos_Start(PMP_ADAPTER pAdapter)
     _DataSynchronizationBarrier();                                             // Wait until mem-io accesses are finished
     ENETRegBase->MAC_CONFIGURATION.R |= (IMX_ENET_QOS_MAC_CONFIGURATION_TE_MASK | IMX_ENET_QOS_MAC_CONFIGURATION_RE_MASK);
     DBG_SM_PRINT_TRACE("ENET started, releasing all spinlocks");
-    NdisReleaseSpinLock(&pAdapter->Tx_SpinLock);
-    NdisReleaseSpinLock(&pAdapter->Rx_SpinLock);
+    for (ULONG Idx = pAdapter->ChannelCount; Idx-- > 0;) {
+        NdisDprReleaseSpinLock(&pAdapter->Channel[Idx].Tx_SpinLock);
+        NdisDprReleaseSpinLock(&pAdapter->Channel[Idx].Rx_SpinLock);
+    }
     NdisReleaseSpinLock(&pAdapter->Dev_SpinLock);
 }
 
@@ -365,6 +408,7 @@ NTSTATUS EnetQos_Init(PMP_ADAPTER pAdapter)
     UINT32 TxFifoSize, RxFifoSize;
     UINT32 Tqs, Rqs;
     UINT32 Val, Bw;
+    UINT32 RxqEnable, RxqDmaMap0, RxqDmaMap1, PriorityMap0, PriorityMap1;
 
     // Reset peripheral
     Status = EnetQos_Reset(pAdapter);
@@ -379,7 +423,9 @@ NTSTATUS EnetQos_Init(PMP_ADAPTER pAdapter)
     pAdapter->ENETRegBase->MAC_CONFIGURATION.R = IMX_ENET_QOS_MAC_CONFIGURATION_ACS_MASK | IMX_ENET_QOS_MAC_CONFIGURATION_CST_MASK;
 
     // Disable all interrupts
-    pAdapter->ENETRegBase->DMA_CH[0].DMA_CHX_INT_EN.R = 0U;
+    for (ULONG Idx = 0; Idx < ENET_QOS_CHANNEL_COUNT_MAX; ++Idx) {
+        pAdapter->ENETRegBase->DMA_CH[Idx].DMA_CHX_INT_EN.R = 0U;
+    }
     pAdapter->ENETRegBase->MAC_INTERRUPT_ENABLE.R = 0U;
 
     // Read Tx/Rx fifo sizes in
@@ -388,49 +434,73 @@ NTSTATUS EnetQos_Init(PMP_ADAPTER pAdapter)
     RxFifoSize = (HwFeature1 & IMX_ENET_QOS_MAC_HW_FEAT_RXFIFOSIZE_MASK) >> IMX_ENET_QOS_MAC_HW_FEAT_RXFIFOSIZE_SHIFT;
     TxFifoSize = (128 << TxFifoSize);
     RxFifoSize = (128 << RxFifoSize);
-    Tqs = (TxFifoSize / 256U) - 1U;
-    Rqs = (RxFifoSize / 256U) - 1U;
-
-    // Queue enable for DCB/Generic
-    pAdapter->ENETRegBase->MAC_RXQ_CTRL[0].B.RXQ0EN = 2U;
-
-    // Set Tx/Rx Queue size in number of 256B blocks and enable store and forward mode
-    pAdapter->ENETRegBase->MTL_QUEUE[0].MTL_TXQX_OP_MODE.B.TQS = Tqs;
-    pAdapter->ENETRegBase->MTL_QUEUE[0].MTL_TXQX_OP_MODE.B.TXQEN = 2U;
-    pAdapter->ENETRegBase->MTL_QUEUE[0].MTL_TXQX_OP_MODE.B.TSF = 1U;
-
-    pAdapter->ENETRegBase->MTL_QUEUE[0].MTL_RXQX_OP_MODE.B.RQS = Rqs;
-    pAdapter->ENETRegBase->MTL_QUEUE[0].MTL_RXQX_OP_MODE.B.RSF = 1U;
-
-    // Enable selected interrupts
-    pAdapter->ENETRegBase->DMA_CH[0].DMA_CHX_INT_EN.R = IMX_ENET_QOS_DMA_CHX_INT_EN_NIE_MASK |  // Normal summary Interrupt
-                                                        IMX_ENET_QOS_DMA_CHX_INT_EN_RIE_MASK |  // Receive Interrupt
-                                                        IMX_ENET_QOS_DMA_CHX_INT_EN_TIE_MASK;   // Transmit Interrupt
+    Tqs = (TxFifoSize / pAdapter->ChannelCount / 256U) - 1U;                   // FIFOs are shared equally by the queues
+    Rqs = (RxFifoSize / pAdapter->ChannelCount / 256U) - 1U;
+
+    // Queue enable for DCB/Generic, Rx queue x is served by DMA channel x.
+    // VLAN tagged frames are steered to the queues by 802.1p priority, untagged frames go to queue 0.
+    RxqEnable = RxqDmaMap0 = RxqDmaMap1 = PriorityMap0 = PriorityMap1 = 0U;
+    for (ULONG Idx = 0; Idx < pAdapter->ChannelCount; ++Idx) {
+        RxqEnable |= 2U << (Idx * 2U);
+        if (Idx < 4U) {
+            RxqDmaMap0   |= (UINT32)Idx << (Idx * 8U);
+            PriorityMap0 |= MpRssGetPriorityMask(pAdapter->PriorityMap, Idx) << (Idx * 8U);
+        } else {
+            RxqDmaMap1   |= (UINT32)Idx << ((Idx - 4U) * 8U);
+            PriorityMap1 |= MpRssGetPriorityMask(pAdapter->PriorityMap, Idx) << ((Idx - 4U) * 8U);
+        }
+    }
+    pAdapter->ENETRegBase->MAC_RXQ_CTRL[0].R = RxqEnable;
+    pAdapter->ENETRegBase->MAC_RXQ_CTRL[2].R = PriorityMap0;                   // PSRQ0 - PSRQ3
+    pAdapter->ENETRegBase->MAC_RXQ_CTRL[3].R = PriorityMap1;                   // PSRQ4
+    pAdapter->ENETRegBase->MTL_RXQ_DMA_MAP0.R = RxqDmaMap0;
+    pAdapter->ENETRegBase->MTL_RXQ_DMA_MAP1.R = RxqDmaMap1;
+    pAdapter->ENETRegBase->MAC_TXQ_PRTY_MAP0.R = PriorityMap0;                 // Priorities of the PFC frames, the same as Rx
+    pAdapter->ENETRegBase->MAC_TXQ_PRTY_MAP1.R = PriorityMap1;
 
-    // Init DMA
-    MpTxInit(pAdapter);                                                        // Initialize Tx data structures
-    MpRxInit(pAdapter);                                                        //  Initialize Rx data structures
     NdisZeroMemory(&pAdapter->StatisticsAcc, sizeof(pAdapter->StatisticsAcc)); //  Reset accumulated values of HW statistic counters
-    pAdapter->InterruptFlags = 0;                                              //  No interrupt flags pending from previous call of DPC
-    NT_ASSERT(pAdapter->Rx_DmaBDT_Pa.HighPart == 0);
-    NT_ASSERT(pAdapter->Tx_DmaBDT_Pa.HighPart == 0);
 
     pAdapter->ENETRegBase->DMA_CH[0].DMA_CHX_TXDESC_TAIL_PTR.R = 0xF;
     Val = pAdapter->ENETRegBase->DMA_CH[0].DMA_CHX_TXDESC_TAIL_PTR.R;
     Bw = (Val ^ 0xF) + 1;
 
-    pAdapter->ENETRegBase->DMA_CH[0].DMA_CHX_TXDESC_RING_LENGTH.R = pAdapter->Tx_DmaBDT_ItemCount - 1U;
-    pAdapter->ENETRegBase->DMA_CH[0].DMA_CHX_RXDESC_RING_LENGTH.R = pAdapter->Rx_DmaBDT_ItemCount - 1U;
+    for (ULONG Idx = 0; Idx < pAdapter->ChannelCount; ++Idx) {
+        PMP_CHANNEL pChannel = &pAdapter->Channel[Idx];
+
+        // Set Tx/Rx Queue size in number of 256B blocks and enable store and forward mode
+        pAdapter->ENETRegBase->MTL_QUEUE[Idx].MTL_TXQX_OP_MODE.B.TQS = Tqs;
+        pAdapter->ENETRegBase->MTL_QUEUE[Idx].MTL_TXQX_OP_MODE.B.TXQEN = 2U;
+        pAdapter->ENETRegBase->MTL_QUEUE[Idx].MTL_TXQX_OP_MODE.B.TSF = 1U;
+
+        pAdapter->ENETRegBase->MTL_QUEUE[Idx].MTL_RXQX_OP_MODE.B.RQS = Rqs;
+        pAdapter->ENETRegBase->MTL_QUEUE[Idx].MTL_RXQX_OP_MODE.B.RSF = 1U;
+
+        // Enable selected interrupts
+        pAdapter->ENETRegBase->DMA_CH[Idx].DMA_CHX_INT_EN.R = IMX_ENET_QOS_DMA_CHX_INT_EN_NIE_MASK |  // Normal summary Interrupt
+                                                              IMX_ENET_QOS_DMA_CHX_INT_EN_RIE_MASK |  // Receive Interrupt
+                                                              IMX_ENET_QOS_DMA_CHX_INT_EN_TIE_MASK;   // Transmit Interrupt
 
-    pAdapter->ENETRegBase->DMA_CH[0].DMA_CHX_TXDESC_LIST_ADDR.R = pAdapter->Tx_DmaBDT_Pa.LowPart;
-    pAdapter->ENETRegBase->DMA_CH[0].DMA_CHX_RXDESC_LIST_ADDR.R = pAdapter->Rx_DmaBDT_Pa.LowPart;
+        // Init DMA
+        MpTxInit(pChannel);                                                    // Initialize Tx data structures
+        MpRxInit(pChannel);                                                    //  Initialize Rx data structures
+        pChannel->InterruptFlags = 0;                                          //  No interrupt flags pending from previous call of DPC
+        pChannel->DpcQueued      = FALSE;
+        NT_ASSERT(pChannel->Rx_DmaBDT_Pa.HighPart == 0);
+        NT_ASSERT(pChannel->Tx_DmaBDT_Pa.HighPart == 0);
 
-    pAdapter->ENETRegBase->DMA_CH[0].DMA_CHX_TXDESC_TAIL_PTR.R = pAdapter->Tx_DmaBDT_Pa.LowPart + (pAdapter->Tx_DmaBDT_ItemCount * (UINT32)sizeof(ENET_BD));
-    pAdapter->ENETRegBase->DMA_CH[0].DMA_CHX_RXDESC_TAIL_PTR.R = pAdapter->Rx_DmaBDT_Pa.LowPart + (pAdapter->Rx_DmaBDT_ItemCount * (UINT32)sizeof(ENET_BD));
+        pAdapter->ENETRegBase->DMA_CH[Idx].DMA_CHX_TXDESC_RING_LENGTH.R = pAdapter->Tx_DmaBDT_ItemCount - 1U;
+        pAdapter->ENETRegBase->DMA_CH[Idx].DMA_CHX_RXDESC_RING_LENGTH.R = pAdapter->Rx_DmaBDT_ItemCount - 1U;
 
-    pAdapter->ENETRegBase->DMA_CH[0].DMA_CHX_CTRL.B.PBLX8 = 1U;
-    pAdapter->ENETRegBase->DMA_CH[0].DMA_CHX_RX_CTRL.R = ((32U << IMX_ENET_QOS_DMA_CHX_RX_CTRL_RXPBL_SHIFT) | (2048U << IMX_ENET_QOS_DMA_CHX_RX_CTRL_RBSZ_X_0_SHIFT));
-    pAdapter->ENETRegBase->DMA_CH[0].DMA_CHX_TX_CTRL.R = (32U << IMX_ENET_QOS_DMA_CHX_TX_CTRL_TXPBL_SHIFT);
+        pAdapter->ENETRegBase->DMA_CH[Idx].DMA_CHX_TXDESC_LIST_ADDR.R = pChannel->Tx_DmaBDT_Pa.LowPart;
+        pAdapter->ENETRegBase->DMA_CH[Idx].DMA_CHX_RXDESC_LIST_ADDR.R = pChannel->Rx_DmaBDT_Pa.LowPart;
+
+        pAdapter->ENETRegBase->DMA_CH[Idx].DMA_CHX_TXDESC_TAIL_PTR.R = pChannel->Tx_DmaBDT_Pa.LowPart + (pAdapter->Tx_DmaBDT_ItemCount * (UINT32)sizeof(ENET_BD));
+        pAdapter->ENETRegBase->DMA_CH[Idx].DMA_CHX_RXDESC_TAIL_PTR.R = pChannel->Rx_DmaBDT_Pa.LowPart + (pAdapter->Rx_DmaBDT_ItemCount * (UINT32)sizeof(ENET_BD));
+
+        pAdapter->ENETRegBase->DMA_CH[Idx].DMA_CHX_CTRL.B.PBLX8 = 1U;
+        pAdapter->ENETRegBase->DMA_CH[Idx].DMA_CHX_RX_CTRL.R = ((32U << IMX_ENET_QOS_DMA_CHX_RX_CTRL_RXPBL_SHIFT) | (2048U << IMX_ENET_QOS_DMA_CHX_RX_CTRL_RBSZ_X_0_SHIFT));
+        pAdapter->ENETRegBase->DMA_CH[Idx].DMA_CHX_TX_CTRL.R = (32U << IMX_ENET_QOS_DMA_CHX_TX_CTRL_TXPBL_SHIFT);
+    }
 
     pAdapter->ENETRegBase->MAC_CSR_SW_CTRL.R = IMX_ENET_QOS_MAC_CSR_SW_CTRL_RCWE_MASK;
 
@@ -440,12 +510,14 @@ NTSTATUS EnetQos_Init(PMP_ADAPTER pAdapter)
 
     Val = pAdapter->ENETRegBase->DMA_SYSBUS_MODE.R;
 
-    // Enable RX DMA
-    pAdapter->ENETRegBase->DMA_CH[0].DMA_CHX_RX_CTRL.B.SR = 1U;
-    // Enable TX DMA
-    pAdapter->ENETRegBase->DMA_CH[0].DMA_CHX_TX_CTRL.B.ST = 1U;
-    // Clear DMA intr status
-    pAdapter->ENETRegBase->DMA_CH[0].DMA_CHX_STAT.R = 0xFFFF;
+    for (ULONG Idx = 0; Idx < pAdapter->ChannelCount; ++Idx) {
+        // Enable RX DMA
+        pAdapter->ENETRegBase->DMA_CH[Idx].DMA_CHX_RX_CTRL.B.SR = 1U;
+        // Enable TX DMA
+        pAdapter->ENETRegBase->DMA_CH[Idx].DMA_CHX_TX_CTRL.B.ST = 1U;
+        // Clear DMA intr status
+        pAdapter->ENETRegBase->DMA_CH[Idx].DMA_CHX_STAT.R = 0xFFFF;
+    }
 
     return Status;
 }
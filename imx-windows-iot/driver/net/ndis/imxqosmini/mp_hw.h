@@ -85,12 +85,24 @@ extern "C" {
 #define TX_DESC_COUNT_DEFAULT                    64  // Number of Tx buffer descriptors
 #define TX_DESC_COUNT_MIN                         2
 #define TX_DESC_COUNT_MAX                      1024
+#define TX_COPY_BREAK_DEFAULT                   256  // Tx frames up to this size are copied to the bounce buffer
+#define TX_COPY_BREAK_MIN                        64  // Short frames are padded in the bounce buffer, >= ETHER_FRAME_NIN_LENGTH
+#define TX_COPY_BREAK_MAX                      2048  // All frames copied, zero-copy disabled, == ENET_TX_FRAME_SIZE
+#define TX_RX_QUEUES_DEFAULT                      4  // Number of DMA channels (MTL queues), frames are steered to them by 802.1p priority
+#define TX_RX_QUEUES_MIN                          1
+#define TX_RX_QUEUES_MAX     ENET_QOS_CHANNEL_COUNT_MAX
+#define RSS_DEFAULT                               1  // Receive side scaling enabled
+#define RSS_MIN                                   0
+#define RSS_MAX                                   1
 #define SPEED_SELECT_DEFAULT             SPEED_AUTO  // Speed select
 #define SPEED_SELECT_MIN                 SPEED_AUTO
 #define SPEED_SELECT_MAX     SPEED_FULL_DUPLEX_100M
 
+#define ENET_QOS_CHANNEL_COUNT_MAX                5  // DMA channels and MTL queues of the ENET QOS
 #define ENET_RX_FRAME_SIZE                     2048
 #define ENET_TX_FRAME_SIZE                     2048
+#define ENET_TX_BD_MAX_LENGTH     TDES2_HL_B1L_MASK  // Buffer 1 length of a Tx descriptor
+#define ENET_TX_BD_ALIGN_MASK                     0  // Tx buffers can start at any byte address
 
 /* CCM regs used for ENET_QOS clock configuration */
 #define ENET_QOS_CLK_ROOT                        0xA880
@@ -129,13 +141,17 @@ typedef struct  _FRAME_TXD_STATUS
     ULONG    FramesXmitAbortedErrors;
     ULONG    FramesXmitUnderrunErrors;
     ULONG    FramsXmitCarrierErrors;
+    ULONG    FramesXmitCopied;          // Frames copied to the bounce buffer
+    ULONG    FramesXmitZeroCopy;        // Frames mapped straight from the NET_BUFFER
 } FRAME_TXD_STATUS,  *PFRAME_TXD_STATUS;
 
 MINIPORT_ISR EnetIsr;
 MINIPORT_SYNCHRONIZE_INTERRUPT EnetEnableRxAndTxInterrupts;
 MINIPORT_SYNCHRONIZE_INTERRUPT EnetDisableRxAndTxInterrupts;
+MINIPORT_SYNCHRONIZE_INTERRUPT EnetEnableChannelInterrupts;
 
 typedef struct _MP_ADAPTER MP_ADAPTER,*PMP_ADAPTER;
+typedef struct _MP_CHANNEL MP_CHANNEL,*PMP_CHANNEL;
 
 typedef enum _MP_MII_PHY_INTERFACE_TYPE MP_MII_PHY_INTERFACE_TYPE, * PMP_MII_PHY_INTERFACE_TYPE;
 
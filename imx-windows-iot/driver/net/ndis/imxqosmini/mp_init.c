@@ -70,10 +70,22 @@ NDIS_STATUS MpAllocAdapterBlock(PMP_ADAPTER *ppAdapter, NDIS_HANDLE MiniportAdap
         InitializeListHead(&pAdapter->PoMgmt.PatternList);
         NdisAllocateSpinLock(&pAdapter->Dev_SpinLock);
 
-        MpQueueInit(&pAdapter->Tx_qMpOwnedBDs);                // Initialize pending Tx Ethernet frames (NET_BUFFERs) queue
-        MpQueueInit(&pAdapter->Tx_qDmaOwnedBDs);               // Initialize in-progress Tx Ethernet frames (NET_BUFFERs) queue
-        NdisAllocateSpinLock(&pAdapter->Tx_SpinLock);          // Initialize Tx path spin lock
-        NdisAllocateSpinLock(&pAdapter->Rx_SpinLock);          // Initialize Rx path spin lock
+        for (ULONG Idx = 0; Idx < ENET_QOS_CHANNEL_COUNT_MAX; ++Idx) {
+            PMP_CHANNEL pChannel = &pAdapter->Channel[Idx];
+            MpQueueInit(&pChannel->Tx_qMpOwnedBDs);            // Initialize pending Tx Ethernet frames (NET_BUFFERs) queue
+            MpQueueInit(&pChannel->Tx_qDmaOwnedBDs);           // Initialize in-progress Tx Ethernet frames (NET_BUFFERs) queue
+            NdisAllocateSpinLock(&pChannel->Tx_SpinLock);      // Initialize Tx path spin lock
+            NdisAllocateSpinLock(&pChannel->Rx_SpinLock);      // Initialize Rx path spin lock
+        }
+        for (ULONG Idx = 0; Idx < MP_RSS_PROCESSOR_COUNT_MAX; ++Idx) {
+            NdisAllocateSpinLock(&pAdapter->Rss_Processor[Idx].Lock);  // Initialize RSS pending list spin lock
+        }
+        pAdapter->ProcessorCount = min(NdisGroupActiveProcessorCount(0), MP_RSS_PROCESSOR_COUNT_MAX);
+        if ((pAdapter->Rss_Lock = NdisAllocateRWLock(MiniportAdapterHandle)) == NULL) {
+            Status = NDIS_STATUS_RESOURCES;
+            DBG_ENET_DEV_PRINT_ERROR_WITH_STATUS("NdisAllocateRWLock() failed to allocate RSS lock.");
+            break;
+        }
 
         // State machine initialization
         PMP_STATE_MACHINE pSM = &pAdapter->StateMachine;
@@ -106,111 +118,75 @@ NDIS_STATUS MpAllocAdapterBlock(PMP_ADAPTER *ppAdapter, NDIS_HANDLE MiniportAdap
 
 /*++
 Routine Description:
-    Allocate all the memory blocks for send, receive and others
+    Allocate the memory blocks for send and receive of one DMA channel
 Arguments:
-    pAdapter    Pointer to our adapter
+    pChannel    Pointer to the DMA channel
 Return Value:
     NDIS_STATUS_SUCCESS
-    NDIS_STATUS_FAILURE
     NDIS_STATUS_RESOURCES
 --*/
 _Use_decl_annotations_
-NDIS_STATUS NICAllocAdapterMemory(PMP_ADAPTER pAdapter)
+NDIS_STATUS NICAllocChannelMemory(PMP_CHANNEL pChannel)
 {
+    PMP_ADAPTER                     pAdapter = pChannel->pAdapter;
     NDIS_STATUS                     Status = NDIS_STATUS_SUCCESS;
     PMP_TX_PAYLOAD_BD               pEnetSwExtBD;
     LONG                            index;
-    NDIS_SG_DMA_DESCRIPTION         DmaDescription;
     PUCHAR                          AllocVa;
     NDIS_PHYSICAL_ADDRESS           AllocPa;
-    NET_BUFFER_LIST_POOL_PARAMETERS PoolParameters;
 
-    DBG_ENET_DEV_METHOD_BEG();
     for(;;) {
-        // Initialize DMA system
-        NdisZeroMemory(&DmaDescription, sizeof(DmaDescription));
-        DmaDescription.Header.Type                      = NDIS_OBJECT_TYPE_SG_DMA_DESCRIPTION;
-        DmaDescription.Header.Revision                  = NDIS_SG_DMA_DESCRIPTION_REVISION_1;
-        DmaDescription.Header.Size                      = sizeof(NDIS_SG_DMA_DESCRIPTION);
-        DmaDescription.Flags                            = 0;                    // we don't do 64 bit DMA
-        DmaDescription.MaximumPhysicalMapping           = ENET_TX_FRAME_SIZE;   // Even if offload is enabled, the packet size for mapping shouldn't change
-        DmaDescription.ProcessSGListHandler             = MpProcessSGList;      //
-        DmaDescription.SharedMemAllocateCompleteHandler = NULL;                 // ENET does not call NdisMAllocateSharedMemoryAsyncEx, hence no need for complete handler
-        if ((Status = NdisMRegisterScatterGatherDma(pAdapter->AdapterHandle, &DmaDescription, &pAdapter->Tx_DmaHandle)) == NDIS_STATUS_SUCCESS) {
-            pAdapter->Tx_SGListSize = DmaDescription.ScatterGatherListSize;
-        } else {
-            DBG_ENET_DEV_PRINT_ERROR_WITH_STATUS("NdisMRegisterScatterGatherDma() failed.");
-            break;
-        }
-        pAdapter->CacheFillSize = NdisMGetDmaAlignment(pAdapter->AdapterHandle);
-        //  Allocates a pool of NBL(and NB) structures for Rx path. Each allocated NBL structure is initialized with one NB structure.
-        NdisZeroMemory(&PoolParameters, sizeof(NET_BUFFER_LIST_POOL_PARAMETERS));
-        PoolParameters.Header.Type        = NDIS_OBJECT_TYPE_DEFAULT;
-        PoolParameters.Header.Revision    = NET_BUFFER_LIST_POOL_PARAMETERS_REVISION_1;
-        PoolParameters.Header.Size        = sizeof(PoolParameters);
-        PoolParameters.fAllocateNetBuffer = TRUE;                     // Allocate one NB for each NBL
-        // PoolParameters.DataSize        = 0;                        // Do not allocate data buffer
-        // PoolParameters.ProtocolId      = NDIS_PROTOCOL_ID_DEFAULT; // NDIS_PROTOCOL_ID_DEFAULT = 0;
-        PoolParameters.PoolTag            = MP_TAG_TX_NBL_AND_NB;
-        pAdapter->Rx_NBAndNBLPool         = NdisAllocateNetBufferListPool(pAdapter->AdapterHandle,&PoolParameters);
-        if (pAdapter->Rx_NBAndNBLPool == NULL)  {
-            Status = NDIS_STATUS_RESOURCES;
-            break;
-        }
-        // Initialize Tx Lookaside lists
-        NdisInitializeNPagedLookasideList(&pAdapter->Tx_MpTxBDLookasideList, NULL, NULL, 0, sizeof(MP_TX_BD) - sizeof(SCATTER_GATHER_LIST) + pAdapter->Tx_SGListSize, MP_TAG_TX_BD, 0);
-        pAdapter->Rx_DmaBDT_DmaOwnedBDsLowWatterMark = (pAdapter->Rx_DmaBDT_ItemCount * MAC_RX_BUFFER_LOW_WATER_PERCENT) / 100;
         /* ************************************************************************************************************************************ */
         /* Allocated memory for ENET DMA Receive Descriptors Table(Rx_DmaBDT). Note: This memory must be 8 bytes aligned!                       */
         /* ************************************************************************************************************************************ */
-        pAdapter->Rx_DmaBDT_Size = pAdapter->Rx_DmaBDT_ItemCount * sizeof(ENET_BD);
-        NdisMAllocateSharedMemory(pAdapter->AdapterHandle, pAdapter->Rx_DmaBDT_Size, FALSE, (PVOID) &pAdapter->Rx_DmaBDT, &pAdapter->Rx_DmaBDT_Pa);
-        ASSERT(!((uintptr_t)pAdapter->Rx_DmaBDT & 0x7));   // This memory must be 8 bytes aligned!
-        if (!pAdapter->Rx_DmaBDT) {
+        pChannel->Rx_DmaBDT_Size = pAdapter->Rx_DmaBDT_ItemCount * sizeof(ENET_BD);
+        NdisMAllocateSharedMemory(pAdapter->AdapterHandle, pChannel->Rx_DmaBDT_Size, FALSE, (PVOID) &pChannel->Rx_DmaBDT, &pChannel->Rx_DmaBDT_Pa);
+        ASSERT(!((uintptr_t)pChannel->Rx_DmaBDT & 0x7));   // This memory must be 8 bytes aligned!
+        if (!pChannel->Rx_DmaBDT) {
             Status = NDIS_STATUS_RESOURCES;
             DBG_ENET_DEV_PRINT_ERROR_WITH_STATUS("NdisMAllocateSharedMemory() failed to allocate memory for Rx_DmaBDT.");
             break;
         }
-        NdisZeroMemory((PVOID)pAdapter->Rx_DmaBDT, pAdapter->Rx_DmaBDT_Size);
+        NdisZeroMemory((PVOID)pChannel->Rx_DmaBDT, pChannel->Rx_DmaBDT_Size);
         /* ************************************************************************************************************************************ */
         /* Allocated memory for ENET DMA Transmit Descriptors Table(Tx_DmaBDT). Note: This memory must be 8 bytes aligned!                      */
         /* ************************************************************************************************************************************ */
-        pAdapter->Tx_DmaBDT_Size = pAdapter->Tx_DmaBDT_ItemCount * sizeof(ENET_BD);
-        NdisMAllocateSharedMemory(pAdapter->AdapterHandle, pAdapter->Tx_DmaBDT_Size, FALSE, (PVOID) &pAdapter->Tx_DmaBDT, &pAdapter->Tx_DmaBDT_Pa);
-        ASSERT(!((uintptr_t)pAdapter->Tx_DmaBDT & 0x7));   // This memory must be 8 bytes aligned!
-        if (!pAdapter->Tx_DmaBDT) {
+        pChannel->Tx_DmaBDT_Size = pAdapter->Tx_DmaBDT_ItemCount * sizeof(ENET_BD);
+        NdisMAllocateSharedMemory(pAdapter->AdapterHandle, pChannel->Tx_DmaBDT_Size, FALSE, (PVOID) &pChannel->Tx_DmaBDT, &pChannel->Tx_DmaBDT_Pa);
+        ASSERT(!((uintptr_t)pChannel->Tx_DmaBDT & 0x7));   // This memory must be 8 bytes aligned!
+        if (!pChannel->Tx_DmaBDT) {
             Status = NDIS_STATUS_RESOURCES;
             DBG_ENET_DEV_PRINT_ERROR_WITH_STATUS("NdisMAllocateSharedMemory() failed to allocate memory for Tx_DmaBDT.");
             break;
         }
-        NdisZeroMemory((PVOID)pAdapter->Tx_DmaBDT, pAdapter->Tx_DmaBDT_Size);
+        NdisZeroMemory((PVOID)pChannel->Tx_DmaBDT, pChannel->Tx_DmaBDT_Size);
         // Allocate RX DMA SW extension buffer descriptors array.
         ULONG Rx_DmaBDT_SwExtSize =  sizeof(MP_ENET_BD_SW_EXT) * pAdapter->Rx_DmaBDT_ItemCount;
-        if ((pAdapter->Rx_DmaBDT_SwExt = NdisAllocateMemoryWithTagPriority(pAdapter->AdapterHandle, Rx_DmaBDT_SwExtSize, MP_TAG_RX_PAYLOAD_DESC, NormalPoolPriority)) == NULL) {
+        if ((pChannel->Rx_DmaBDT_SwExt = NdisAllocateMemoryWithTagPriority(pAdapter->AdapterHandle, Rx_DmaBDT_SwExtSize, MP_TAG_RX_PAYLOAD_DESC, NormalPoolPriority)) == NULL) {
             Status = NDIS_STATUS_RESOURCES;
             DBG_ENET_DEV_PRINT_ERROR_WITH_STATUS("NdisMAllocateSharedMemory() failed to allocated RX Dma SW extension descriptors table.");
             break;
         }
-        NdisZeroMemory(pAdapter->Rx_DmaBDT_SwExt, Rx_DmaBDT_SwExtSize);
+        NdisZeroMemory(pChannel->Rx_DmaBDT_SwExt, Rx_DmaBDT_SwExtSize);
         // Allocate TX DMA SW extension buffer descriptors array.
         ULONG Tx_EnetSwExtBDT_Size =  sizeof(MP_TX_PAYLOAD_BD) * pAdapter->Tx_DmaBDT_ItemCount;
-        if ((pAdapter->Tx_EnetSwExtBDT = NdisAllocateMemoryWithTagPriority(pAdapter->AdapterHandle, Tx_EnetSwExtBDT_Size, MP_TAG_TX_BD, NormalPoolPriority)) == NULL) {
+        if ((pChannel->Tx_EnetSwExtBDT = NdisAllocateMemoryWithTagPriority(pAdapter->AdapterHandle, Tx_EnetSwExtBDT_Size, MP_TAG_TX_BD, NormalPoolPriority)) == NULL) {
             Status = NDIS_STATUS_RESOURCES;
             DBG_ENET_DEV_PRINT_ERROR_WITH_STATUS("NdisMAllocateSharedMemory() failed to allocated TX Dma SW extension descriptors table.");
             break;
         }
-        NdisZeroMemory(pAdapter->Tx_EnetSwExtBDT, Tx_EnetSwExtBDT_Size);
+        NdisZeroMemory(pChannel->Tx_EnetSwExtBDT, Tx_EnetSwExtBDT_Size);
         // Allocate RX frame buffer descriptors array.
         ULONG Rx_FrameBDTSize =  sizeof(MP_RX_FRAME_BD) * pAdapter->Rx_DmaBDT_ItemCount;
-        if ((pAdapter->Rx_FrameBDT = NdisAllocateMemoryWithTagPriority(pAdapter->AdapterHandle, Rx_FrameBDTSize, MP_TAG_RX_PAYLOAD_DESC, NormalPoolPriority)) == NULL) {
+        if ((pChannel->Rx_FrameBDT = NdisAllocateMemoryWithTagPriority(pAdapter->AdapterHandle, Rx_FrameBDTSize, MP_TAG_RX_PAYLOAD_DESC, NormalPoolPriority)) == NULL) {
             Status = NDIS_STATUS_RESOURCES;
             DBG_ENET_DEV_PRINT_ERROR_WITH_STATUS("NdisAllocateMemoryWithTagPriority() failed to allocated RX frame descriptors table.");
             break;
         }
-        NdisZeroMemory(pAdapter->Rx_FrameBDT, Rx_FrameBDTSize);
+        NdisZeroMemory(pChannel->Rx_FrameBDT, Rx_FrameBDTSize);
         // Allocate RX frame date buffers. Allocate buffer memory, MDL, NBL, NB
         for (LONG RxBuffIdx = 0; RxBuffIdx < pAdapter->Rx_DmaBDT_ItemCount; ++RxBuffIdx) {
-            MP_RX_FRAME_BD *pRxFrameBD = &pAdapter->Rx_FrameBDT[RxBuffIdx];
+            MP_RX_FRAME_BD *pRxFrameBD = &pChannel->Rx_FrameBDT[RxBuffIdx];
             #if 0 //MVa
             NdisMAllocateSharedMemory(pAdapter->AdapterHandle, pAdapter->ENET_RX_FRAME_SIZE, TRUE, &pRxFrameBD->pBuffer, &pRxFrameBD->BufferPa);
             if (pRxFrameBD->pBuffer == NULL) {
@@ -253,18 +229,18 @@ NDIS_STATUS NICAllocAdapterMemory(PMP_ADAPTER pAdapter)
         /* ************************************************************************************************************************************ */
         // Allocate memory for tx Ethernet frames
         /* ************************************************************************************************************************************ */
-        pAdapter->Tx_DataBuffer_Size = pAdapter->Tx_DmaBDT_ItemCount * (ENET_TX_FRAME_SIZE/*+ pAdapter->CacheFillSize*/ );
-        NdisMAllocateSharedMemory(pAdapter->AdapterHandle, pAdapter->Tx_DataBuffer_Size, TRUE, &pAdapter->Tx_DataBuffer_Va, &pAdapter->Tx_DataBuffer_Pa);
-        if (pAdapter->Tx_DataBuffer_Va == NULL) {
+        pChannel->Tx_DataBuffer_Size = pAdapter->Tx_DmaBDT_ItemCount * (ENET_TX_FRAME_SIZE/*+ pAdapter->CacheFillSize*/ );
+        NdisMAllocateSharedMemory(pAdapter->AdapterHandle, pChannel->Tx_DataBuffer_Size, TRUE, &pChannel->Tx_DataBuffer_Va, &pChannel->Tx_DataBuffer_Pa);
+        if (pChannel->Tx_DataBuffer_Va == NULL) {
             Status = NDIS_STATUS_RESOURCES;
             DBG_ENET_DEV_PRINT_ERROR_WITH_STATUS("NdisMAllocateSharedMemory() failed to allocate a big Tx data buffer");
             break;
         }
         // For each Tx buffer initialize buffer description
-        AllocVa = pAdapter->Tx_DataBuffer_Va;
-        AllocPa = pAdapter->Tx_DataBuffer_Pa;
+        AllocVa = pChannel->Tx_DataBuffer_Va;
+        AllocPa = pChannel->Tx_DataBuffer_Pa;
         for (index = 0; index < pAdapter->Tx_DmaBDT_ItemCount; index++) {
-            pEnetSwExtBD = &pAdapter->Tx_EnetSwExtBDT[index];
+            pEnetSwExtBD = &pChannel->Tx_EnetSwExtBDT[index];
             pEnetSwExtBD->BufferSize        = ENET_TX_FRAME_SIZE;
             pEnetSwExtBD->pBuffer           = MP_ALIGNMEM(AllocVa, pAdapter->CacheFillSize); // Align the buffer on the cache line boundary
             pEnetSwExtBD->BufferPa.QuadPart = MP_ALIGNMEM_PA(AllocPa, pAdapter->CacheFillSize);
@@ -281,6 +257,142 @@ NDIS_STATUS NICAllocAdapterMemory(PMP_ADAPTER pAdapter)
         }
         break;
     }
+    return Status;
+}
+
+/*++
+Routine Description:
+    Free the memory blocks for send and receive of one DMA channel
+Arguments:
+    pChannel    Pointer to the DMA channel
+Return Value:
+    None
+--*/
+_Use_decl_annotations_
+void MpFreeChannel(PMP_CHANNEL pChannel)
+{
+    PMP_ADAPTER pAdapter = pChannel->pAdapter;
+
+    if (pAdapter == NULL) {     // Channel not initialized
+        return;
+    }
+    if (pChannel->Tx_DataBuffer_Va != NULL)  { // Free Tx packets memory
+        NdisMFreeSharedMemory(pAdapter->AdapterHandle, pChannel->Tx_DataBuffer_Size, TRUE, pChannel->Tx_DataBuffer_Va, pChannel->Tx_DataBuffer_Pa);
+        pChannel->Tx_DataBuffer_Va = NULL;
+    }
+    if (pChannel->Tx_DmaBDT) { // Free Tx_DmaBDT
+        NdisMFreeSharedMemory(pAdapter->AdapterHandle, pChannel->Tx_DmaBDT_Size, FALSE, (PVOID)pChannel->Tx_DmaBDT, pChannel->Tx_DmaBDT_Pa);
+        pChannel->Tx_DmaBDT = NULL;
+    }
+    if (pChannel->Rx_DmaBDT) { // Free ENET Rx_DmaBDT
+        NdisMFreeSharedMemory(pAdapter->AdapterHandle, pChannel->Rx_DmaBDT_Size, FALSE, (PVOID)pChannel->Rx_DmaBDT, pChannel->Rx_DmaBDT_Pa);
+        pChannel->Rx_DmaBDT = NULL;
+    }
+    // Free Rx_DmaBDT_SwExt
+    if (pChannel->Rx_DmaBDT_SwExt != NULL) {
+        NdisFreeMemory(pChannel->Rx_DmaBDT_SwExt, 0, 0);
+        pChannel->Rx_DmaBDT_SwExt = NULL;
+    }
+    // Free Tx_EnetSwExtBDT
+    if (pChannel->Tx_EnetSwExtBDT != NULL) {
+        for (int i = 0; i < pAdapter->Tx_DmaBDT_ItemCount; i++) { // Free all Tx packets buffer MDL
+            if (pChannel->Tx_EnetSwExtBDT[i].pMdl != NULL) {
+                NdisFreeMdl(pChannel->Tx_EnetSwExtBDT[i].pMdl);
+                pChannel->Tx_EnetSwExtBDT[i].pMdl = NULL;
+            }
+        }
+        NdisFreeMemory(pChannel->Tx_EnetSwExtBDT, 0, 0);
+        pChannel->Tx_EnetSwExtBDT = NULL;
+    }
+    // Free RX payload buffer descriptors
+    if (pChannel->Rx_FrameBDT != NULL) {
+        for (LONG RxBuffIdx = 0; RxBuffIdx < pAdapter->Rx_DmaBDT_ItemCount; ++RxBuffIdx) {
+            MP_RX_FRAME_BD *pRxFrameBD = &pChannel->Rx_FrameBDT[RxBuffIdx];
+            if (pRxFrameBD != NULL) {
+                if (pRxFrameBD->pMdl != NULL) {
+                    NdisFreeMdl(pRxFrameBD->pMdl);
+                }
+                if (pRxFrameBD->pNBL != NULL) {
+                    NdisFreeNetBufferList(pRxFrameBD->pNBL);
+                }
+                if (pRxFrameBD->pBuffer != NULL) {
+                    // MVa NdisMFreeSharedMemory(pAdapter->AdapterHandle, ENET_RX_FRAME_SIZE, TRUE, pRxFrameBD->pBuffer, pRxFrameBD->BufferPa);
+                    /* MS temp fix*/ MmFreeContiguousMemory(pRxFrameBD->pBuffer);
+                }
+            }
+        }
+        NdisFreeMemory(pChannel->Rx_FrameBDT, 0, 0);
+        pChannel->Rx_FrameBDT = NULL;
+
+    }
+}
+
+/*++
+Routine Description:
+    Allocate all the memory blocks for send, receive and others
+Arguments:
+    pAdapter    Pointer to our adapter
+Return Value:
+    NDIS_STATUS_SUCCESS
+    NDIS_STATUS_FAILURE
+    NDIS_STATUS_RESOURCES
+--*/
+_Use_decl_annotations_
+NDIS_STATUS NICAllocAdapterMemory(PMP_ADAPTER pAdapter)
+{
+    NDIS_STATUS                     Status = NDIS_STATUS_SUCCESS;
+    NDIS_SG_DMA_DESCRIPTION         DmaDescription;
+    NET_BUFFER_LIST_POOL_PARAMETERS PoolParameters;
+
+    DBG_ENET_DEV_METHOD_BEG();
+    for(;;) {
+        // Initialize DMA system
+        NdisZeroMemory(&DmaDescription, sizeof(DmaDescription));
+        DmaDescription.Header.Type                      = NDIS_OBJECT_TYPE_SG_DMA_DESCRIPTION;
+        DmaDescription.Header.Revision                  = NDIS_SG_DMA_DESCRIPTION_REVISION_1;
+        DmaDescription.Header.Size                      = sizeof(NDIS_SG_DMA_DESCRIPTION);
+        DmaDescription.Flags                            = 0;                    // we don't do 64 bit DMA
+        DmaDescription.MaximumPhysicalMapping           = ENET_TX_FRAME_SIZE;   // Even if offload is enabled, the packet size for mapping shouldn't change
+        DmaDescription.ProcessSGListHandler             = MpProcessSGList;      //
+        DmaDescription.SharedMemAllocateCompleteHandler = NULL;                 // ENET does not call NdisMAllocateSharedMemoryAsyncEx, hence no need for complete handler
+        if ((Status = NdisMRegisterScatterGatherDma(pAdapter->AdapterHandle, &DmaDescription, &pAdapter->Tx_DmaHandle)) == NDIS_STATUS_SUCCESS) {
+            pAdapter->Tx_SGListSize = DmaDescription.ScatterGatherListSize;
+        } else {
+            DBG_ENET_DEV_PRINT_ERROR_WITH_STATUS("NdisMRegisterScatterGatherDma() failed.");
+            break;
+        }
+        pAdapter->CacheFillSize = NdisMGetDmaAlignment(pAdapter->AdapterHandle);
+        //  Allocates a pool of NBL(and NB) structures for Rx path. Each allocated NBL structure is initialized with one NB structure.
+        NdisZeroMemory(&PoolParameters, sizeof(NET_BUFFER_LIST_POOL_PARAMETERS));
+        PoolParameters.Header.Type        = NDIS_OBJECT_TYPE_DEFAULT;
+        PoolParameters.Header.Revision    = NET_BUFFER_LIST_POOL_PARAMETERS_REVISION_1;
+        PoolParameters.Header.Size        = sizeof(PoolParameters);
+        PoolParameters.fAllocateNetBuffer = TRUE;                     // Allocate one NB for each NBL
+        // PoolParameters.DataSize        = 0;                        // Do not allocate data buffer
+        // PoolParameters.ProtocolId      = NDIS_PROTOCOL_ID_DEFAULT; // NDIS_PROTOCOL_ID_DEFAULT = 0;
+        PoolParameters.PoolTag            = MP_TAG_TX_NBL_AND_NB;
+        pAdapter->Rx_NBAndNBLPool         = NdisAllocateNetBufferListPool(pAdapter->AdapterHandle,&PoolParameters);
+        if (pAdapter->Rx_NBAndNBLPool == NULL)  {
+            Status = NDIS_STATUS_RESOURCES;
+            break;
+        }
+        // Initialize Tx Lookaside lists
+        NdisInitializeNPagedLookasideList(&pAdapter->Tx_MpTxBDLookasideList, NULL, NULL, 0, sizeof(MP_TX_BD) - sizeof(SCATTER_GATHER_LIST) + pAdapter->Tx_SGListSize, MP_TAG_TX_BD, 0);
+        pAdapter->Rx_DmaBDT_DmaOwnedBDsLowWatterMark = (pAdapter->Rx_DmaBDT_ItemCount * MAC_RX_BUFFER_LOW_WATER_PERCENT) / 100;
+        for (ULONG Idx = 0; Idx < ENET_QOS_CHANNEL_COUNT_MAX; ++Idx) {
+            PMP_CHANNEL pChannel = &pAdapter->Channel[Idx];
+            pChannel->pAdapter     = pAdapter;
+            pChannel->Idx          = Idx;
+            pChannel->DpcProcessor = Idx % pAdapter->ProcessorCount;  // Spread the channel DPCs over the processors
+        }
+        MpRssBuildPriorityMap(pAdapter->ChannelCount, pAdapter->PriorityMap);
+        for (ULONG Idx = 0; Idx < pAdapter->ChannelCount; ++Idx) {
+            if ((Status = NICAllocChannelMemory(&pAdapter->Channel[Idx])) != NDIS_STATUS_SUCCESS) {
+                break;
+            }
+        }
+        break;
+    }
     DBG_ENET_DEV_METHOD_END_WITH_STATUS(Status);
     return Status;
 }
@@ -310,54 +422,8 @@ void MpFreeAdapter(PMP_ADAPTER  pAdapter)
             NdisMUnmapIoSpace(pAdapter->AdapterHandle, (PVOID)pAdapter->ENETRegBase, sizeof(CSP_ENET_REGS));
         }
 
-        if (pAdapter->Tx_DataBuffer_Va != NULL)  { // Free Tx packets memory
-            NdisMFreeSharedMemory(pAdapter->AdapterHandle, pAdapter->Tx_DataBuffer_Size, TRUE, pAdapter->Tx_DataBuffer_Va, pAdapter->Tx_DataBuffer_Pa);
-            pAdapter->Tx_DataBuffer_Va = NULL;
-        }
-        if (pAdapter->Tx_DmaBDT) { // Free Tx_DmaBDT
-            NdisMFreeSharedMemory(pAdapter->AdapterHandle, pAdapter->Tx_DmaBDT_Size, FALSE, (PVOID)pAdapter->Tx_DmaBDT, pAdapter->Tx_DmaBDT_Pa);
-            pAdapter->Tx_DmaBDT = NULL;
-        }
-        if (pAdapter->Rx_DmaBDT) { // Free ENET Rx_DmaBDT
-            NdisMFreeSharedMemory(pAdapter->AdapterHandle, pAdapter->Rx_DmaBDT_Size, FALSE, (PVOID)pAdapter->Rx_DmaBDT, pAdapter->Rx_DmaBDT_Pa);
-            pAdapter->Rx_DmaBDT = NULL;
-        }
-        // Free Rx_DmaBDT_SwExt
-        if (pAdapter->Rx_DmaBDT_SwExt != NULL) {
-            NdisFreeMemory(pAdapter->Rx_DmaBDT_SwExt, 0, 0);
-            pAdapter->Rx_DmaBDT_SwExt = NULL;
-        }
-        // Free Tx_EnetSwExtBDT
-        if (pAdapter->Tx_EnetSwExtBDT != NULL) {
-            for (int i = 0; i < pAdapter->Tx_DmaBDT_ItemCount; i++) { // Free all Tx packets buffer MDL
-                if (pAdapter->Tx_EnetSwExtBDT[i].pMdl != NULL) {
-                    NdisFreeMdl(pAdapter->Tx_EnetSwExtBDT[i].pMdl);
-                    pAdapter->Tx_EnetSwExtBDT[i].pMdl = NULL;
-                }
-            }
-            NdisFreeMemory(pAdapter->Tx_EnetSwExtBDT, 0, 0);
-            pAdapter->Tx_EnetSwExtBDT = NULL;
-        }
-        // Free RX payload buffer descriptors
-        if (pAdapter->Rx_FrameBDT != NULL) {
-            for (LONG RxBuffIdx = 0; RxBuffIdx < pAdapter->Rx_DmaBDT_ItemCount; ++RxBuffIdx) {
-                MP_RX_FRAME_BD *pRxFrameBD = &pAdapter->Rx_FrameBDT[RxBuffIdx];
-                if (pRxFrameBD != NULL) {
-                    if (pRxFrameBD->pMdl != NULL) {
-                        NdisFreeMdl(pRxFrameBD->pMdl);
-                    }
-                    if (pRxFrameBD->pNBL != NULL) {
-                        NdisFreeNetBufferList(pRxFrameBD->pNBL);
-                    }
-                    if (pRxFrameBD->pBuffer != NULL) {
-                        // MVa NdisMFreeSharedMemory(pAdapter->AdapterHandle, ENET_RX_FRAME_SIZE, TRUE, pRxFrameBD->pBuffer, pRxFrameBD->BufferPa);
-                        /* MS temp fix*/ MmFreeContiguousMemory(pRxFrameBD->pBuffer);
-                    }
-                }
-            }
-            NdisFreeMemory(pAdapter->Rx_FrameBDT, 0, 0);
-            pAdapter->Rx_FrameBDT = NULL;
-
+        for (ULONG Idx = 0; Idx < ENET_QOS_CHANNEL_COUNT_MAX; ++Idx) {
+            MpFreeChannel(&pAdapter->Channel[Idx]);
         }
         // Free NB and NBL pool
         if (pAdapter->Rx_NBAndNBLPool) {
@@ -368,6 +434,10 @@ void MpFreeAdapter(PMP_ADAPTER  pAdapter)
         if (pAdapter->Tx_DmaHandle != NULL)  {
             NdisMDeregisterScatterGatherDma(pAdapter->Tx_DmaHandle);
         }
+        if (pAdapter->Rss_Lock != NULL) {
+            NdisFreeRWLock(pAdapter->Rss_Lock);
+            pAdapter->Rss_Lock = NULL;
+        }
         // Free timer object
         if (pAdapter->StateMachine.SM_hTimer) {
             NdisFreeTimerObject(pAdapter->StateMachine.SM_hTimer);
@@ -400,6 +470,10 @@ NDIS_STATUS NICReadRegParameters(PMP_ADAPTER pAdapter)
     UINT                            Length;
     NDIS_CONFIGURATION_OBJECT       ConfigObject;
 
+    // TxCopyBreak range of the INF, short frames must always be copied to get padded
+    C_ASSERT(TX_COPY_BREAK_MIN >= ETHER_FRAME_NIN_LENGTH);
+    C_ASSERT(TX_COPY_BREAK_MAX == ENET_TX_FRAME_SIZE);
+
     MP_REG_VALUE_DESC static regValues[] = {
         {
             NDIS_STRING_CONST("*ReceiveBuffers"),
@@ -417,6 +491,30 @@ NDIS_STATUS NICReadRegParameters(PMP_ADAPTER pAdapter)
             TX_DESC_COUNT_MIN,
             TX_DESC_COUNT_MAX
         },
+        {
+            NDIS_STRING_CONST("TxCopyBreak"),
+            MP_OFFSET(Tx_CopyBreak),
+            MP_SIZE(Tx_CopyBreak),
+            TX_COPY_BREAK_DEFAULT,
+            TX_COPY_BREAK_MIN,
+            TX_COPY_BREAK_MAX
+        },
+        {
+            NDIS_STRING_CONST("TxRxQueues"),
+            MP_OFFSET(ChannelCount),
+            MP_SIZE(ChannelCount),
+            TX_RX_QUEUES_DEFAULT,
+            TX_RX_QUEUES_MIN,
+            TX_RX_QUEUES_MAX
+        },
+        {
+            NDIS_STRING_CONST("*RSS"),
+            MP_OFFSET(RssEnabled),
+            MP_SIZE(RssEnabled),
+            RSS_DEFAULT,
+            RSS_MIN,
+            RSS_MAX
+        },
         {
             NDIS_STRING_CONST("*SpeedDuplex"),
             MP_OFFSET(SpeedSelect),
@@ -157,6 +157,7 @@ NDIS_STATUS MpInitializeEx(NDIS_HANDLE MiniportAdapterHandle, NDIS_HANDLE Minipo
     NDIS_MINIPORT_ADAPTER_REGISTRATION_ATTRIBUTES   RegistrationAttributes;
     NDIS_MINIPORT_ADAPTER_GENERAL_ATTRIBUTES        GeneralAttributes;
     NDIS_PM_CAPABILITIES                            PowerManagementCapabilities;
+    NDIS_RECEIVE_SCALE_CAPABILITIES                 RssCapabilities;
     PMP_ADAPTER                                     pAdapter = NULL;
     PCM_PARTIAL_RESOURCE_DESCRIPTOR                 pResDesc;
     ULONG                                           index;
@@ -247,6 +248,19 @@ NDIS_STATUS MpInitializeEx(NDIS_HANDLE MiniportAdapterHandle, NDIS_HANDLE Minipo
 
         GeneralAttributes.PhysicalMediumType     = NdisPhysicalMedium802_3;
         GeneralAttributes.RecvScaleCapabilities  = NULL;
+        if (pAdapter->RssEnabled) {
+            // The ENET_QOS has no hash engine, RSS classification is done in software at DPC time.
+            NdisZeroMemory(&RssCapabilities, sizeof(RssCapabilities));
+            RssCapabilities.Header.Type                     = NDIS_OBJECT_TYPE_RSS_CAPABILITIES;
+            RssCapabilities.Header.Revision                 = NDIS_RECEIVE_SCALE_CAPABILITIES_REVISION_2;
+            RssCapabilities.Header.Size                     = NDIS_SIZEOF_RECEIVE_SCALE_CAPABILITIES_REVISION_2;
+            RssCapabilities.CapabilitiesFlags               = NDIS_RSS_CAPS_CLASSIFICATION_AT_DPC | NdisHashFunctionToeplitz |
+                                                              NDIS_RSS_CAPS_HASH_TYPE_TCP_IPV4 | NDIS_RSS_CAPS_HASH_TYPE_TCP_IPV6;
+            RssCapabilities.NumberOfInterruptMessages       = 1;
+            RssCapabilities.NumberOfReceiveQueues           = pAdapter->ProcessorCount;
+            RssCapabilities.NumberOfIndirectionTableEntries = MP_RSS_INDIRECTION_TABLE_SIZE_MAX;
+            GeneralAttributes.RecvScaleCapabilities = &RssCapabilities;
+        }
         GeneralAttributes.AccessType             = NET_IF_ACCESS_BROADCAST;      // NET_IF_ACCESS_BROADCAST for a typical ethernet adapter
         GeneralAttributes.DirectionType          = NET_IF_DIRECTION_SENDRECEIVE; // NET_IF_DIRECTION_SENDRECEIVE for a typical ethernet adapter
         GeneralAttributes.ConnectionType         = NET_IF_CONNECTION_DEDICATED;  // NET_IF_CONNECTION_DEDICATED for a typical ethernet adapter
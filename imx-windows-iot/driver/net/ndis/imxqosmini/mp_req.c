@@ -24,6 +24,7 @@ NDIS_OID ENETSupportedOids[] = {
     OID_GEN_RCV_OK,
     OID_GEN_RECEIVE_BLOCK_SIZE,
     OID_GEN_RECEIVE_BUFFER_SPACE,
+    OID_GEN_RECEIVE_SCALE_PARAMETERS,
     OID_GEN_STATISTICS,
     OID_GEN_TRANSMIT_BLOCK_SIZE,
     OID_GEN_TRANSMIT_BUFFER_SPACE,
@@ -61,6 +62,7 @@ NDIS_STATUS NICGetStatsCounters(PMP_ADAPTER pAdapter, NDIS_OID Oid, PULONG64 pCo
     NDIS_STATUS             Status = NDIS_STATUS_SUCCESS;
     PNDIS_STATISTICS_INFO   pStatisticsInfo;
     volatile CSP_ENET_REGS *ENETRegBase = pAdapter->ENETRegBase;
+    ULONG                   ChannelIdx;
 
     DBG_ENET_DEV_OIDS_METHOD_BEG();
     *pCounter = 0;
@@ -70,19 +72,27 @@ NDIS_STATUS NICGetStatsCounters(PMP_ADAPTER pAdapter, NDIS_OID Oid, PULONG64 pCo
             break;
 
         case OID_GEN_RCV_OK:
-            *pCounter = pAdapter->RcvStatus.FrameRcvGood;
+            for (ChannelIdx = 0; ChannelIdx < pAdapter->ChannelCount; ChannelIdx++) {
+                *pCounter += pAdapter->Channel[ChannelIdx].RcvStatus.FrameRcvGood;
+            }
             break;
 
         case OID_802_3_XMIT_MAX_COLLISIONS:
-            *pCounter = pAdapter->TxdStatus.FramesXmitCollisionErrors;
+            for (ChannelIdx = 0; ChannelIdx < pAdapter->ChannelCount; ChannelIdx++) {
+                *pCounter += pAdapter->Channel[ChannelIdx].TxdStatus.FramesXmitCollisionErrors;
+            }
             break;
 
         case OID_802_3_RCV_OVERRUN:
-            *pCounter = pAdapter->RcvStatus.FrameRcvOverrunErrors;
+            for (ChannelIdx = 0; ChannelIdx < pAdapter->ChannelCount; ChannelIdx++) {
+                *pCounter += pAdapter->Channel[ChannelIdx].RcvStatus.FrameRcvOverrunErrors;
+            }
             break;
 
         case OID_802_3_XMIT_UNDERRUN:
-            *pCounter = pAdapter->TxdStatus.FramesXmitUnderrunErrors;
+            for (ChannelIdx = 0; ChannelIdx < pAdapter->ChannelCount; ChannelIdx++) {
+                *pCounter += pAdapter->Channel[ChannelIdx].TxdStatus.FramesXmitUnderrunErrors;
+            }
             break;
 
         case OID_GEN_STATISTICS:
@@ -237,6 +247,108 @@ NDIS_STATUS NICSetMulticastList(PMP_ADAPTER pAdapter)
     return(NDIS_STATUS_SUCCESS);
 }
 
+/*++
+Routine Description:
+    Applies the RSS parameters set by the protocol. The hash key, hash types and indirection table are replaced under
+    the Rss_Lock, so the receive DPCs never see a partially updated configuration.
+Arguments:
+    pAdapter                Pointer to our adapter
+    pParams                 The NDIS_RECEIVE_SCALE_PARAMETERS structure
+    InformationBufferLength Size of the information buffer
+Return Value:
+    NDIS_STATUS_SUCCESS
+    NDIS_STATUS_INVALID_LENGTH
+    NDIS_STATUS_INVALID_PARAMETER
+    NDIS_STATUS_NOT_SUPPORTED
+--*/
+_Use_decl_annotations_
+NDIS_STATUS NICSetRssParameters(PMP_ADAPTER pAdapter, PNDIS_RECEIVE_SCALE_PARAMETERS pParams, ULONG InformationBufferLength)
+{
+    NDIS_STATUS             Status = NDIS_STATUS_SUCCESS;
+    LOCK_STATE_EX           LockState;
+    PPROCESSOR_NUMBER       pProcessorNumber;
+    UCHAR                   IndirectionTable[MP_RSS_INDIRECTION_TABLE_SIZE_MAX];
+    ULONG                   TableSize = 0;
+    ULONG                   HashTypes = 0;
+    ULONG                   ProcessorIdx;
+    ULONG                   Idx;
+
+    DBG_ENET_DEV_OIDS_METHOD_BEG();
+    do {
+        if (!pAdapter->RssEnabled) {
+            Status = NDIS_STATUS_NOT_SUPPORTED;
+            break;
+        }
+        if ((InformationBufferLength < NDIS_SIZEOF_RECEIVE_SCALE_PARAMETERS_REVISION_1) ||
+            (pParams->Header.Type != NDIS_OBJECT_TYPE_RSS_PARAMETERS) ||
+            (pParams->Header.Revision < NDIS_RECEIVE_SCALE_PARAMETERS_REVISION_1) ||
+            (pParams->Header.Size < NDIS_SIZEOF_RECEIVE_SCALE_PARAMETERS_REVISION_1)) {
+            Status = NDIS_STATUS_INVALID_LENGTH;
+            break;
+        }
+        if (!(pParams->Flags & NDIS_RSS_PARAM_FLAG_DISABLE_RSS) && !(pParams->Flags & NDIS_RSS_PARAM_FLAG_HASH_INFO_UNCHANGED)) {
+            HashTypes = NDIS_RSS_HASH_TYPE_FROM_HASH_INFO(pParams->HashInformation);
+            if ((HashTypes != 0) && (NDIS_RSS_HASH_FUNC_FROM_HASH_INFO(pParams->HashInformation) != NdisHashFunctionToeplitz)) {
+                Status = NDIS_STATUS_NOT_SUPPORTED;
+                break;
+            }
+            if (HashTypes & ~MP_RSS_HASH_TYPES_SUPPORTED) {
+                Status = NDIS_STATUS_NOT_SUPPORTED;
+                break;
+            }
+        }
+        if (!(pParams->Flags & NDIS_RSS_PARAM_FLAG_ITABLE_UNCHANGED)) {                        // Indirection table entries are PROCESSOR_NUMBERs
+            if ((pParams->IndirectionTableOffset > InformationBufferLength) ||
+                (pParams->IndirectionTableSize > InformationBufferLength - pParams->IndirectionTableOffset)) {
+                Status = NDIS_STATUS_INVALID_LENGTH;
+                break;
+            }
+            TableSize = pParams->IndirectionTableSize / sizeof(PROCESSOR_NUMBER);
+            if ((TableSize == 0) || (TableSize > MP_RSS_INDIRECTION_TABLE_SIZE_MAX) || (TableSize & (TableSize - 1))) {
+                Status = NDIS_STATUS_INVALID_PARAMETER;
+                break;
+            }
+            pProcessorNumber = (PPROCESSOR_NUMBER)((PUCHAR)pParams + pParams->IndirectionTableOffset);
+            for (Idx = 0; Idx < TableSize; Idx++) {
+                ProcessorIdx = KeGetProcessorIndexFromNumber(&pProcessorNumber[Idx]);
+                if (ProcessorIdx >= pAdapter->ProcessorCount) {
+                    DBG_ENET_DEV_OIDS_PRINT_ERROR("Indirection table entry %d: processor %d/%d is not supported", Idx, pProcessorNumber[Idx].Group, pProcessorNumber[Idx].Number);
+                    Status = NDIS_STATUS_INVALID_PARAMETER;
+                    break;
+                }
+                IndirectionTable[Idx] = (UCHAR)ProcessorIdx;
+            }
+            if (Status != NDIS_STATUS_SUCCESS) {
+                break;
+            }
+        }
+        if (!(pParams->Flags & NDIS_RSS_PARAM_FLAG_HASH_KEY_UNCHANGED)) {
+            if ((pParams->HashSecretKeySize > MP_RSS_HASH_KEY_SIZE) ||
+                (pParams->HashSecretKeyOffset > InformationBufferLength) ||
+                (pParams->HashSecretKeySize > InformationBufferLength - pParams->HashSecretKeyOffset)) {
+                Status = NDIS_STATUS_INVALID_LENGTH;
+                break;
+            }
+        }
+        NdisAcquireRWLockWrite(pAdapter->Rss_Lock, &LockState, 0);
+        if (!(pParams->Flags & NDIS_RSS_PARAM_FLAG_HASH_KEY_UNCHANGED)) {
+            MpRssSetHashKey(&pAdapter->Rss, (PUCHAR)pParams + pParams->HashSecretKeyOffset, pParams->HashSecretKeySize);
+        }
+        if (!(pParams->Flags & NDIS_RSS_PARAM_FLAG_ITABLE_UNCHANGED)) {
+            (void)MpRssSetIndirectionTable(&pAdapter->Rss, IndirectionTable, TableSize);
+        }
+        if (pParams->Flags & NDIS_RSS_PARAM_FLAG_DISABLE_RSS) {
+            pAdapter->Rss.HashTypes = 0;
+        } else if (!(pParams->Flags & NDIS_RSS_PARAM_FLAG_HASH_INFO_UNCHANGED)) {
+            pAdapter->Rss.HashTypes = HashTypes;
+        }
+        NdisReleaseRWLock(pAdapter->Rss_Lock, &LockState);
+        DBG_ENET_DEV_OIDS_PRINT_INFO("RSS hash types 0x%08X, indirection table entries %d", pAdapter->Rss.HashTypes, pAdapter->Rss.IndirectionTableMask + 1);
+    } while (0);
+    DBG_ENET_DEV_OIDS_METHOD_END_WITH_STATUS(Status);
+    return(Status);
+}
+
 void MpIndicateLinkStatus(_In_ PMP_ADAPTER pAdapter);
 /*++
 Routine Description:
@@ -364,12 +476,12 @@ NDIS_STATUS MpQueryInformation(NDIS_HANDLE MiniportAdapterContext, PNDIS_OID_REQ
 
         case OID_GEN_TRANSMIT_BUFFER_SPACE:
             // Specifies the amount of memory, in bytes, on the NIC that is available for buffering transmit data.
-            ulInfo = ETHER_FRAME_MAX_LENGTH * pAdapter->Tx_DmaBDT_ItemCount;
+            ulInfo = ETHER_FRAME_MAX_LENGTH * pAdapter->Tx_DmaBDT_ItemCount * pAdapter->ChannelCount;
             break;
 
         case OID_GEN_RECEIVE_BUFFER_SPACE:
             // Specifies the amount of memory on the NIC that is available for buffering receive data.
-            ulInfo = ETHER_FRAME_MAX_LENGTH * pAdapter->Rx_DmaBDT_ItemCount;
+            ulInfo = ETHER_FRAME_MAX_LENGTH * pAdapter->Rx_DmaBDT_ItemCount * pAdapter->ChannelCount;
             break;
 
         case OID_GEN_VENDOR_ID:
@@ -565,6 +677,13 @@ NDIS_STATUS MpSetInformation(NDIS_HANDLE MiniportAdapterContext, PNDIS_OID_REQUE
             Status = NDIS_STATUS_SUCCESS;
             break;
 
+        case OID_GEN_RECEIVE_SCALE_PARAMETERS:
+            Status = NICSetRssParameters(pAdapter, (PNDIS_RECEIVE_SCALE_PARAMETERS)InformationBuffer, InformationBufferLength);
+            if (Status == NDIS_STATUS_SUCCESS) {
+                BytesRead = InformationBufferLength;
+            }
+            break;
+
       case OID_PNP_SET_POWER:
           if (InformationBufferLength != sizeof(NDIS_DEVICE_POWER_STATE)) {
               Status = NDIS_STATUS_INVALID_LENGTH;
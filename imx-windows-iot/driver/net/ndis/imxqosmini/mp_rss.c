@@ -0,0 +1,331 @@
+/*
+* Copyright 2023 NXP
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted (subject to the limitations in the disclaimer
+* below) provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of NXP nor the names of its contributors may be used to
+* endorse or promote products derived from this software without specific prior
+* written permission.
+*
+* NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS
+* LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+* THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+* GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include <wdm.h>
+#include "mp_rss.h"
+
+#define MP_RSS_ETHERTYPE_IPV4         0x0800
+#define MP_RSS_ETHERTYPE_IPV6         0x86DD
+#define MP_RSS_ETHERTYPE_VLAN         0x8100
+#define MP_RSS_ETHERTYPE_QINQ         0x88A8
+#define MP_RSS_IP_PROTOCOL_TCP        6
+#define MP_RSS_IPV6_HOP_BY_HOP        0
+#define MP_RSS_IPV6_ROUTING           43
+#define MP_RSS_IPV6_DEST_OPTIONS      60
+#define MP_RSS_IPV6_EXT_HEADERS_MAX   8
+
+// IEEE 802.1Q recommended priority to traffic class mapping, one row for each number of traffic classes
+static const UCHAR MpRssPriorityMapTable[MP_RSS_TRAFFIC_CLASS_COUNT_MAX][MP_RSS_PRIORITY_COUNT] = {
+    {0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 1, 1, 1, 1},
+    {0, 0, 0, 0, 1, 1, 2, 2},
+    {0, 0, 1, 1, 2, 2, 3, 3},
+    {0, 0, 1, 1, 2, 2, 3, 4},
+    {1, 0, 2, 2, 3, 3, 4, 5},
+    {1, 0, 2, 3, 4, 4, 5, 6},
+    {1, 0, 2, 3, 4, 5, 6, 7}
+};
+
+static USHORT MpRssGetUshort(const UCHAR *pData)
+{
+    return (USHORT)((pData[0] << 8) | pData[1]);
+}
+
+/*++
+Routine Description:
+    Sets the Toeplitz key. The hash of each byte value at each position of the hash input is computed here,
+    so hashing a frame takes one table lookup per input byte. A key shorter than MP_RSS_HASH_KEY_SIZE is padded with zeros.
+Arguments:
+    pRss        The RSS context
+    pKey        The secret key
+    KeySize     Size of the key in bytes
+Return Value:
+    None
+--*/
+_Use_decl_annotations_
+void MpRssSetHashKey(PMP_RSS pRss, const UCHAR *pKey, ULONG KeySize)
+{
+    UCHAR Key[MP_RSS_HASH_KEY_SIZE + 8];
+    ULONG Window[8];
+
+    RtlZeroMemory(Key, sizeof(Key));
+    for (ULONG Idx = 0; (Idx < KeySize) && (Idx < MP_RSS_HASH_KEY_SIZE); ++Idx) {
+        Key[Idx] = pKey[Idx];
+    }
+    for (ULONG Pos = 0; Pos < MP_RSS_HASH_INPUT_SIZE_MAX; ++Pos) {
+        ULONGLONG KeyBits = 0;
+        for (ULONG Idx = 0; Idx < 8; ++Idx) {
+            KeyBits = (KeyBits << 8) | Key[Pos + Idx];
+        }
+        for (ULONG Bit = 0; Bit < 8; ++Bit) {                                      // 32 key bits the input bit is multiplied with
+            Window[Bit] = (ULONG)(KeyBits >> (32 - Bit));
+        }
+        for (ULONG Value = 0; Value < 256; ++Value) {
+            ULONG Hash = 0;
+            for (ULONG Bit = 0; Bit < 8; ++Bit) {
+                if (Value & (0x80 >> Bit)) {
+                    Hash ^= Window[Bit];
+                }
+            }
+            pRss->HashTable[Pos][Value] = Hash;
+        }
+    }
+}
+
+/*++
+Routine Description:
+    Sets the indirection table.
+Arguments:
+    pRss        The RSS context
+    pTable      Processor index of each entry
+    TableSize   Number of entries, a power of 2 up to MP_RSS_INDIRECTION_TABLE_SIZE_MAX
+Return Value:
+    FALSE if the table size is not valid, the table is not changed then.
+--*/
+_Use_decl_annotations_
+BOOLEAN MpRssSetIndirectionTable(PMP_RSS pRss, const UCHAR *pTable, ULONG TableSize)
+{
+    if ((TableSize == 0) || (TableSize > MP_RSS_INDIRECTION_TABLE_SIZE_MAX) || (TableSize & (TableSize - 1))) {
+        return FALSE;
+    }
+    for (ULONG Idx = 0; Idx < TableSize; ++Idx) {
+        pRss->IndirectionTable[Idx] = pTable[Idx];
+    }
+    pRss->IndirectionTableMask = TableSize - 1;
+    return TRUE;
+}
+
+/*++
+Routine Description:
+    Computes the Toeplitz hash of the hash input.
+Arguments:
+    pRss        The RSS context with the key set
+    pInput      The hash input
+    InputSize   Size of the input, up to MP_RSS_HASH_INPUT_SIZE_MAX bytes
+Return Value:
+    The hash value.
+--*/
+_Use_decl_annotations_
+ULONG MpRssHash(const MP_RSS *pRss, const UCHAR *pInput, ULONG InputSize)
+{
+    ULONG Hash = 0;
+
+    for (ULONG Pos = 0; Pos < InputSize; ++Pos) {
+        Hash ^= pRss->HashTable[Pos][pInput[Pos]];
+    }
+    return Hash;
+}
+
+/*++
+Routine Description:
+    Parses the Ethernet frame and builds the hash input. The TCP 4-tuple is used if it is enabled and the frame
+    carries a TCP segment, the IP addresses are used otherwise. IPv4 fragments are hashed on the addresses only.
+Arguments:
+    pFrame          The frame, starting with the destination MAC address
+    FrameLength     Length of the frame
+    HashTypes       Enabled MP_RSS_HASH_xxx types
+    pInput          Buffer for the hash input
+    pInputSize      Size of the hash input
+Return Value:
+    The MP_RSS_HASH_xxx type of the input, or 0 if the frame can not be hashed.
+--*/
+_Use_decl_annotations_
+ULONG MpRssGetHashInput(const UCHAR *pFrame, ULONG FrameLength, ULONG HashTypes, UCHAR *pInput, PULONG pInputSize)
+{
+    ULONG  Offset = 12;
+    USHORT EtherType;
+    ULONG  L4Offset;
+
+    *pInputSize = 0;
+    if (FrameLength < Offset + 2) {
+        return 0;
+    }
+    EtherType = MpRssGetUshort(&pFrame[Offset]);
+    for (ULONG Tag = 0; (Tag < 2) && ((EtherType == MP_RSS_ETHERTYPE_VLAN) || (EtherType == MP_RSS_ETHERTYPE_QINQ)); ++Tag) {
+        Offset += 4;                                                                // Skip 802.1Q tag
+        if (FrameLength < Offset + 2) {
+            return 0;
+        }
+        EtherType = MpRssGetUshort(&pFrame[Offset]);
+    }
+    Offset += 2;
+    if (EtherType == MP_RSS_ETHERTYPE_IPV4) {
+        const UCHAR *pIp = &pFrame[Offset];
+        if ((FrameLength < Offset + 20) || ((pIp[0] >> 4) != 4) || ((pIp[0] & 0x0F) < 5)) {
+            return 0;
+        }
+        L4Offset = Offset + (pIp[0] & 0x0F) * 4;
+        BOOLEAN Fragment = ((MpRssGetUshort(&pIp[6]) & 0x3FFF) != 0);              // More fragments or fragment offset set
+        if ((HashTypes & MP_RSS_HASH_TCP_IPV4) && (pIp[9] == MP_RSS_IP_PROTOCOL_TCP) && !Fragment && (FrameLength >= L4Offset + 4)) {
+            RtlCopyMemory(pInput, &pIp[12], 8);                                            // Source and destination address
+            RtlCopyMemory(&pInput[8], &pFrame[L4Offset], 4);                               // Source and destination port
+            *pInputSize = 12;
+            return MP_RSS_HASH_TCP_IPV4;
+        }
+        if (HashTypes & MP_RSS_HASH_IPV4) {
+            RtlCopyMemory(pInput, &pIp[12], 8);
+            *pInputSize = 8;
+            return MP_RSS_HASH_IPV4;
+        }
+        return 0;
+    }
+    if (EtherType == MP_RSS_ETHERTYPE_IPV6) {
+        const UCHAR *pIp = &pFrame[Offset];
+        if ((FrameLength < Offset + 40) || ((pIp[0] >> 4) != 6)) {
+            return 0;
+        }
+        UCHAR NextHeader = pIp[6];
+        L4Offset = Offset + 40;
+        for (ULONG Idx = 0; Idx < MP_RSS_IPV6_EXT_HEADERS_MAX; ++Idx) {             // Skip the extension headers in front of TCP
+            if ((NextHeader != MP_RSS_IPV6_HOP_BY_HOP) && (NextHeader != MP_RSS_IPV6_ROUTING) && (NextHeader != MP_RSS_IPV6_DEST_OPTIONS)) {
+                break;
+            }
+            if (FrameLength < L4Offset + 8) {
+                break;
+            }
+            NextHeader = pFrame[L4Offset];
+            L4Offset += ((ULONG)pFrame[L4Offset + 1] + 1) * 8;
+        }
+        if ((HashTypes & MP_RSS_HASH_TCP_IPV6) && (NextHeader == MP_RSS_IP_PROTOCOL_TCP) && (FrameLength >= L4Offset + 4)) {
+            RtlCopyMemory(pInput, &pIp[8], 32);
+            RtlCopyMemory(&pInput[32], &pFrame[L4Offset], 4);
+            *pInputSize = 36;
+            return MP_RSS_HASH_TCP_IPV6;
+        }
+        if (HashTypes & MP_RSS_HASH_IPV6) {
+            RtlCopyMemory(pInput, &pIp[8], 32);
+            *pInputSize = 32;
+            return MP_RSS_HASH_IPV6;
+        }
+    }
+    return 0;
+}
+
+/*++
+Routine Description:
+    Computes the RSS hash of the frame and looks up the processor it should be indicated on.
+Arguments:
+    pRss            The RSS context
+    pFrame          The frame, starting with the destination MAC address
+    FrameLength     Length of the frame
+    pHashValue      The hash value, 0 if the frame is not hashed
+    pProcessor      Processor index from the indirection table, 0 if the frame is not hashed
+Return Value:
+    The MP_RSS_HASH_xxx type of the hash, or 0 if RSS is disabled or the frame can not be hashed.
+--*/
+_Use_decl_annotations_
+ULONG MpRssClassify(const MP_RSS *pRss, const UCHAR *pFrame, ULONG FrameLength, PULONG pHashValue, PULONG pProcessor)
+{
+    UCHAR Input[MP_RSS_HASH_INPUT_SIZE_MAX];
+    ULONG InputSize;
+    ULONG HashType;
+
+    *pHashValue = 0;
+    *pProcessor = 0;
+    if (pRss->HashTypes == 0) {
+        return 0;
+    }
+    HashType = MpRssGetHashInput(pFrame, FrameLength, pRss->HashTypes, Input, &InputSize);
+    if (HashType != 0) {
+        *pHashValue = MpRssHash(pRss, Input, InputSize);
+        *pProcessor = pRss->IndirectionTable[*pHashValue & pRss->IndirectionTableMask];
+    }
+    return HashType;
+}
+
+/*++
+Routine Description:
+    Returns the 802.1p priority of the frame.
+Arguments:
+    pFrame          The frame, starting with the destination MAC address
+    FrameLength     Length of the frame
+Return Value:
+    The PCP field of the outer VLAN tag, or 0 if the frame is not tagged.
+--*/
+_Use_decl_annotations_
+ULONG MpRssGetFramePriority(const UCHAR *pFrame, ULONG FrameLength)
+{
+    if (FrameLength < 16) {
+        return 0;
+    }
+    USHORT EtherType = MpRssGetUshort(&pFrame[12]);
+    if ((EtherType != MP_RSS_ETHERTYPE_VLAN) && (EtherType != MP_RSS_ETHERTYPE_QINQ)) {
+        return 0;
+    }
+    return pFrame[14] >> 5;
+}
+
+/*++
+Routine Description:
+    Builds the 802.1p priority to traffic class (queue) map.
+Arguments:
+    TrafficClassCount   Number of traffic classes, 1 to MP_RSS_TRAFFIC_CLASS_COUNT_MAX
+    pPriorityMap        Traffic class of each priority
+Return Value:
+    None
+--*/
+_Use_decl_annotations_
+void MpRssBuildPriorityMap(ULONG TrafficClassCount, UCHAR *pPriorityMap)
+{
+    if (TrafficClassCount == 0) {
+        TrafficClassCount = 1;
+    }
+    if (TrafficClassCount > MP_RSS_TRAFFIC_CLASS_COUNT_MAX) {
+        TrafficClassCount = MP_RSS_TRAFFIC_CLASS_COUNT_MAX;
+    }
+    for (ULONG Priority = 0; Priority < MP_RSS_PRIORITY_COUNT; ++Priority) {
+        pPriorityMap[Priority] = MpRssPriorityMapTable[TrafficClassCount - 1][Priority];
+    }
+}
+
+/*++
+Routine Description:
+    Returns the priorities mapped to the traffic class, in the format of the PSRQx and PSTQx fields.
+Arguments:
+    pPriorityMap    Traffic class of each priority
+    TrafficClass    The traffic class
+Return Value:
+    Bit n is set if priority n is mapped to the traffic class.
+--*/
+_Use_decl_annotations_
+ULONG MpRssGetPriorityMask(const UCHAR *pPriorityMap, ULONG TrafficClass)
+{
+    ULONG Mask = 0;
+
+    for (ULONG Priority = 0; Priority < MP_RSS_PRIORITY_COUNT; ++Priority) {
+        if (pPriorityMap[Priority] == TrafficClass) {
+            Mask |= 1U << Priority;
+        }
+    }
+    return Mask;
+}
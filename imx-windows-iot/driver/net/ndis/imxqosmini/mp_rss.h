@@ -0,0 +1,71 @@
+/*
+* Copyright 2023 NXP
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted (subject to the limitations in the disclaimer
+* below) provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of NXP nor the names of its contributors may be used to
+* endorse or promote products derived from this software without specific prior
+* written permission.
+*
+* NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS
+* LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+* THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+* GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#ifndef _MP_RSS_H
+#define _MP_RSS_H
+
+// Receive side scaling and 802.1p traffic class mapping of the ENET QOS queues. The MAC has no hash engine, so the
+// Toeplitz hash is computed by the driver when a frame is taken from the RX ring, and the indirection table selects
+// the processor that indicates it. Tagged frames are steered to the DMA channels by the MAC according to their priority.
+// Only needs the types of wdm.h, so it can be run on the host.
+
+#define MP_RSS_HASH_KEY_SIZE                40      // Toeplitz key size, enough for the IPv6 4-tuple
+#define MP_RSS_HASH_INPUT_SIZE_MAX          36      // IPv6 source and destination address, TCP source and destination port
+#define MP_RSS_INDIRECTION_TABLE_SIZE_MAX  128
+#define MP_RSS_PRIORITY_COUNT                8      // 802.1p priorities
+#define MP_RSS_TRAFFIC_CLASS_COUNT_MAX       8
+
+// Hash types, the values are the NDIS_HASH_xxx ones
+#define MP_RSS_HASH_IPV4                    0x00000100
+#define MP_RSS_HASH_TCP_IPV4                0x00000200
+#define MP_RSS_HASH_IPV6                    0x00000400
+#define MP_RSS_HASH_TCP_IPV6                0x00001000
+#define MP_RSS_HASH_TYPES_SUPPORTED         (MP_RSS_HASH_IPV4 | MP_RSS_HASH_TCP_IPV4 | MP_RSS_HASH_IPV6 | MP_RSS_HASH_TCP_IPV6)
+
+typedef struct _MP_RSS {
+    ULONG   HashTypes;                                                  // Enabled MP_RSS_HASH_xxx types, 0 if RSS is disabled
+    ULONG   IndirectionTableMask;                                       // Number of indirection table entries minus one
+    UCHAR   IndirectionTable[MP_RSS_INDIRECTION_TABLE_SIZE_MAX];        // Processor index of each entry
+    ULONG   HashTable[MP_RSS_HASH_INPUT_SIZE_MAX][256];                 // Hash of each byte value at each input position, built from the key
+} MP_RSS, *PMP_RSS;
+
+void    MpRssSetHashKey(_Inout_ PMP_RSS pRss, _In_reads_bytes_(KeySize) const UCHAR *pKey, _In_ ULONG KeySize);
+BOOLEAN MpRssSetIndirectionTable(_Inout_ PMP_RSS pRss, _In_reads_bytes_(TableSize) const UCHAR *pTable, _In_ ULONG TableSize);
+ULONG   MpRssHash(_In_ const MP_RSS *pRss, _In_reads_bytes_(InputSize) const UCHAR *pInput, _In_ ULONG InputSize);
+ULONG   MpRssGetHashInput(_In_reads_bytes_(FrameLength) const UCHAR *pFrame, _In_ ULONG FrameLength, _In_ ULONG HashTypes, _Out_writes_bytes_(MP_RSS_HASH_INPUT_SIZE_MAX) UCHAR *pInput, _Out_ PULONG pInputSize);
+ULONG   MpRssClassify(_In_ const MP_RSS *pRss, _In_reads_bytes_(FrameLength) const UCHAR *pFrame, _In_ ULONG FrameLength, _Out_ PULONG pHashValue, _Out_ PULONG pProcessor);
+ULONG   MpRssGetFramePriority(_In_reads_bytes_(FrameLength) const UCHAR *pFrame, _In_ ULONG FrameLength);
+void    MpRssBuildPriorityMap(_In_ ULONG TrafficClassCount, _Out_writes_bytes_(MP_RSS_PRIORITY_COUNT) UCHAR *pPriorityMap);
+ULONG   MpRssGetPriorityMask(_In_reads_bytes_(MP_RSS_PRIORITY_COUNT) const UCHAR *pPriorityMap, _In_ ULONG TrafficClass);
+
+#endif // _MP_RSS_H
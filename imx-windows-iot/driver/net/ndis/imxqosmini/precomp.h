@@ -41,7 +41,9 @@
 #include "mii_iomap.h"
 #include "mp_enet_phy.h"
 #include "mp_hw.h"
+#include "mp_rss.h"
 #include "mp.h"
 #include "mp_data_path.h"
+#include "mp_tx_map.h"
 #include "mp_dbg.h"
 #include "mp_acpi.h"
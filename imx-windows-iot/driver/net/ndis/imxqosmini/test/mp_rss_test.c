@@ -0,0 +1,427 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host unit test of the RSS hash and the 802.1p traffic class mapping
+//
+// The Toeplitz hash is checked against the verification vectors NDIS
+// documents for the default key, hashed from the input and from frames
+// built around it, then against a bit by bit reference implementation for
+// random keys and inputs. The frame parser is checked on VLAN and QinQ
+// tags, IPv4 fragments and IPv6 extension headers.
+//
+
+#include "../mp_rss.c"
+#include "HostTest.h"
+
+static const UCHAR  g_Key[MP_RSS_HASH_KEY_SIZE] = {
+    0x6D, 0x5A, 0x56, 0xDA, 0x25, 0x5B, 0x0E, 0xC2, 0x41, 0x67, 0x25, 0x3D, 0x43, 0xA3, 0x8F, 0xB0,
+    0xD0, 0xCA, 0x2B, 0xCB, 0xAE, 0x7B, 0x30, 0xB4, 0x77, 0xCB, 0x2D, 0xA3, 0x80, 0x30, 0xF2, 0x0C,
+    0x6A, 0x42, 0xB7, 0x3B, 0xBE, 0xAC, 0x01, 0xFA,
+};
+
+typedef struct {
+    UCHAR   Source[4];
+    UCHAR   Destination[4];
+    USHORT  SourcePort;
+    USHORT  DestinationPort;
+    ULONG   HashIp;
+    ULONG   HashTcp;
+} IPV4_VECTOR;
+
+static const IPV4_VECTOR    g_Ipv4Vectors[] = {
+    { {  66,   9, 149, 187 }, { 161, 142, 100,  80 },  2794,  1766, 0x323E8FC2, 0x51CCC178 },
+    { { 199,  92, 111,   2 }, {  65,  69, 140,  83 }, 14230,  4739, 0xD718262A, 0xC626B0EA },
+    { {  24,  19, 198,  95 }, {  12,  22, 207, 184 }, 12898, 38024, 0xD2D0A5DE, 0x5C2B394A },
+    { {  38,  27, 205,  30 }, { 209, 142, 163,   6 }, 48228,  2217, 0x82989176, 0xAFC7327F },
+    { { 153,  39, 163, 191 }, { 202, 188, 127,   2 }, 44251,  1303, 0x5D1809C5, 0x10E828A2 },
+};
+
+typedef struct {
+    UCHAR   Source[16];
+    UCHAR   Destination[16];
+    USHORT  SourcePort;
+    USHORT  DestinationPort;
+    ULONG   HashIp;
+    ULONG   HashTcp;
+} IPV6_VECTOR;
+
+static const IPV6_VECTOR    g_Ipv6Vectors[] = {
+    {
+        { 0x3F, 0xFE, 0x25, 0x01, 0x02, 0x00, 0x1F, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07 },    // 3ffe:2501:200:1fff::7
+        { 0x3F, 0xFE, 0x25, 0x01, 0x02, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01 },    // 3ffe:2501:200:3::1
+        2794, 1766, 0x2CC18CD5, 0x40207D3D
+    },
+    {
+        { 0x3F, 0xFE, 0x05, 0x01, 0x00, 0x08, 0x00, 0x00, 0x02, 0x60, 0x97, 0xFF, 0xFE, 0x40, 0xEF, 0xAB },    // 3ffe:501:8::260:97ff:fe40:efab
+        { 0xFF, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01 },    // ff02::1
+        14230, 4739, 0x0F0C461C, 0xDDE51BBF
+    },
+    {
+        { 0x3F, 0xFE, 0x19, 0x00, 0x45, 0x45, 0x00, 0x03, 0x02, 0x00, 0xF8, 0xFF, 0xFE, 0x21, 0x67, 0xCF },    // 3ffe:1900:4545:3:200:f8ff:fe21:67cf
+        { 0xFE, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0xF8, 0xFF, 0xFE, 0x21, 0x67, 0xCF },    // fe80::200:f8ff:fe21:67cf
+        44251, 38024, 0x4B61E985, 0x02D1FEEF
+    },
+};
+
+static MP_RSS   g_Rss;
+static uint32_t g_Seed = 1;
+
+static ULONG
+Random(
+    ULONG   Range)
+{
+    g_Seed = g_Seed * 1103515245 + 12345;
+    return (g_Seed >> 8) % Range;
+}
+
+// Toeplitz hash as the NDIS documentation describes it
+static ULONG
+ReferenceHash(
+    const UCHAR    *pKey,
+    ULONG           KeySize,
+    const UCHAR    *pInput,
+    ULONG           InputSize)
+{
+    ULONG   Result = 0;
+    ULONG   Window = 0;
+
+    for (ULONG Idx = 0; Idx < 4; Idx++) {
+        Window = (Window << 8) | ((Idx < KeySize) ? pKey[Idx] : 0);
+    }
+    for (ULONG Bit = 0; Bit < InputSize * 8; Bit++) {
+        ULONG   NextKeyBit = Bit + 32;
+        UCHAR   KeyByte = (NextKeyBit / 8 < KeySize) ? pKey[NextKeyBit / 8] : 0;
+
+        if (pInput[Bit / 8] & (0x80 >> (Bit % 8))) {
+            Result ^= Window;
+        }
+        Window = (Window << 1) | ((KeyByte >> (7 - NextKeyBit % 8)) & 1);
+    }
+    return Result;
+}
+
+static void
+PutUshort(
+    UCHAR  *p,
+    ULONG   Value)
+{
+    p[0] = (UCHAR)(Value >> 8);
+    p[1] = (UCHAR)Value;
+}
+
+// Ethernet header with Tags VLAN tags, returns the offset of the IP header
+static ULONG
+BuildEthernet(
+    UCHAR  *pFrame,
+    ULONG   Tags,
+    ULONG   EtherType)
+{
+    ULONG   Offset = 12;
+
+    memset(pFrame, 0xEE, 12);
+    for (ULONG Tag = 0; Tag < Tags; Tag++) {
+        PutUshort(&pFrame[Offset], (Tag == 0) ? MP_RSS_ETHERTYPE_QINQ : MP_RSS_ETHERTYPE_VLAN);
+        PutUshort(&pFrame[Offset + 2], (5U << 13) | 42);
+        Offset += 4;
+    }
+    PutUshort(&pFrame[Offset], EtherType);
+    return Offset + 2;
+}
+
+static ULONG
+BuildIpv4(
+    UCHAR              *pFrame,
+    ULONG               Tags,
+    const IPV4_VECTOR  *pVector,
+    UCHAR               Protocol,
+    USHORT              Fragment)
+{
+    ULONG   Offset = BuildEthernet(pFrame, Tags, MP_RSS_ETHERTYPE_IPV4);
+    UCHAR  *pIp = &pFrame[Offset];
+
+    memset(pIp, 0, 24);
+    pIp[0] = 0x46;                                                                 // 4 bytes of options
+    PutUshort(&pIp[6], Fragment);
+    pIp[8] = 64;
+    pIp[9] = Protocol;
+    memcpy(&pIp[12], pVector->Source, 4);
+    memcpy(&pIp[16], pVector->Destination, 4);
+    PutUshort(&pIp[24], pVector->SourcePort);
+    PutUshort(&pIp[26], pVector->DestinationPort);
+    memset(&pIp[28], 0x55, 16);
+    return Offset + 44;
+}
+
+static ULONG
+BuildIpv6(
+    UCHAR              *pFrame,
+    ULONG               Tags,
+    const IPV6_VECTOR  *pVector,
+    ULONG               ExtensionHeaders)
+{
+    ULONG   Offset = BuildEthernet(pFrame, Tags, MP_RSS_ETHERTYPE_IPV6);
+    UCHAR  *pIp = &pFrame[Offset];
+    ULONG   L4Offset = Offset + 40;
+    UCHAR  *pNextHeader = &pIp[6];
+    static const UCHAR ExtensionTypes[] = { MP_RSS_IPV6_HOP_BY_HOP, MP_RSS_IPV6_DEST_OPTIONS, MP_RSS_IPV6_ROUTING };
+
+    memset(pIp, 0, 40);
+    pIp[0] = 0x60;
+    pIp[7] = 64;
+    memcpy(&pIp[8], pVector->Source, 16);
+    memcpy(&pIp[24], pVector->Destination, 16);
+    for (ULONG Idx = 0; Idx < ExtensionHeaders; Idx++) {
+        *pNextHeader = ExtensionTypes[Idx % 3];
+        memset(&pFrame[L4Offset], 0x77, 16);
+        pFrame[L4Offset + 1] = 1;                                                  // 16 bytes
+        pNextHeader = &pFrame[L4Offset];
+        L4Offset += 16;
+    }
+    *pNextHeader = MP_RSS_IP_PROTOCOL_TCP;
+    PutUshort(&pFrame[L4Offset], pVector->SourcePort);
+    PutUshort(&pFrame[L4Offset + 2], pVector->DestinationPort);
+    memset(&pFrame[L4Offset + 4], 0x55, 16);
+    return L4Offset + 20;
+}
+
+static void
+TestKnownVectorsIpv4(void)
+{
+    static UCHAR    Frame[256];
+    UCHAR           Input[MP_RSS_HASH_INPUT_SIZE_MAX];
+    ULONG           Hash;
+    ULONG           Processor;
+
+    for (ULONG Idx = 0; Idx < sizeof(g_Ipv4Vectors) / sizeof(g_Ipv4Vectors[0]); Idx++) {
+        const IPV4_VECTOR  *pVector = &g_Ipv4Vectors[Idx];
+
+        memcpy(Input, pVector->Source, 4);
+        memcpy(&Input[4], pVector->Destination, 4);
+        PutUshort(&Input[8], pVector->SourcePort);
+        PutUshort(&Input[10], pVector->DestinationPort);
+        CHECK(pVector->HashIp == MpRssHash(&g_Rss, Input, 8));
+        CHECK(pVector->HashTcp == MpRssHash(&g_Rss, Input, 12));
+        CHECK(pVector->HashTcp == ReferenceHash(g_Key, sizeof(g_Key), Input, 12));
+
+        for (ULONG Tags = 0; Tags <= 2; Tags++) {
+            ULONG Length = BuildIpv4(Frame, Tags, pVector, MP_RSS_IP_PROTOCOL_TCP, 0x4000);
+
+            g_Rss.HashTypes = MP_RSS_HASH_TYPES_SUPPORTED;
+            CHECK(MP_RSS_HASH_TCP_IPV4 == MpRssClassify(&g_Rss, Frame, Length, &Hash, &Processor));
+            CHECK((pVector->HashTcp == Hash) && (g_Rss.IndirectionTable[Hash & g_Rss.IndirectionTableMask] == Processor));
+
+            g_Rss.HashTypes = MP_RSS_HASH_IPV4;
+            CHECK(MP_RSS_HASH_IPV4 == MpRssClassify(&g_Rss, Frame, Length, &Hash, &Processor));
+            CHECK(pVector->HashIp == Hash);
+
+            // Not TCP, or a fragment, is hashed on the addresses
+            g_Rss.HashTypes = MP_RSS_HASH_TYPES_SUPPORTED;
+            Length = BuildIpv4(Frame, Tags, pVector, 17, 0);
+            CHECK(MP_RSS_HASH_IPV4 == MpRssClassify(&g_Rss, Frame, Length, &Hash, &Processor));
+            CHECK(pVector->HashIp == Hash);
+            Length = BuildIpv4(Frame, Tags, pVector, MP_RSS_IP_PROTOCOL_TCP, 0x2000);
+            CHECK(MP_RSS_HASH_IPV4 == MpRssClassify(&g_Rss, Frame, Length, &Hash, &Processor));
+            CHECK(pVector->HashIp == Hash);
+            Length = BuildIpv4(Frame, Tags, pVector, MP_RSS_IP_PROTOCOL_TCP, 0x00B9);
+            CHECK(MP_RSS_HASH_IPV4 == MpRssClassify(&g_Rss, Frame, Length, &Hash, &Processor));
+
+            // IPv4 hashing disabled
+            g_Rss.HashTypes = MP_RSS_HASH_TCP_IPV6 | MP_RSS_HASH_IPV6;
+            CHECK(0 == MpRssClassify(&g_Rss, Frame, Length, &Hash, &Processor));
+            CHECK((0 == Hash) && (0 == Processor));
+        }
+    }
+}
+
+static void
+TestKnownVectorsIpv6(void)
+{
+    static UCHAR    Frame[512];
+    UCHAR           Input[MP_RSS_HASH_INPUT_SIZE_MAX];
+    ULONG           InputSize;
+    ULONG           Hash;
+    ULONG           Processor;
+
+    for (ULONG Idx = 0; Idx < sizeof(g_Ipv6Vectors) / sizeof(g_Ipv6Vectors[0]); Idx++) {
+        const IPV6_VECTOR  *pVector = &g_Ipv6Vectors[Idx];
+
+        memcpy(Input, pVector->Source, 16);
+        memcpy(&Input[16], pVector->Destination, 16);
+        PutUshort(&Input[32], pVector->SourcePort);
+        PutUshort(&Input[34], pVector->DestinationPort);
+        CHECK(pVector->HashIp == MpRssHash(&g_Rss, Input, 32));
+        CHECK(pVector->HashTcp == MpRssHash(&g_Rss, Input, 36));
+        CHECK(pVector->HashTcp == ReferenceHash(g_Key, sizeof(g_Key), Input, 36));
+
+        for (ULONG ExtensionHeaders = 0; ExtensionHeaders <= MP_RSS_IPV6_EXT_HEADERS_MAX; ExtensionHeaders++) {
+            ULONG Length = BuildIpv6(Frame, ExtensionHeaders % 3, pVector, ExtensionHeaders);
+
+            g_Rss.HashTypes = MP_RSS_HASH_TYPES_SUPPORTED;
+            CHECK(MP_RSS_HASH_TCP_IPV6 == MpRssClassify(&g_Rss, Frame, Length, &Hash, &Processor));
+            CHECK(pVector->HashTcp == Hash);
+
+            g_Rss.HashTypes = MP_RSS_HASH_IPV6 | MP_RSS_HASH_TCP_IPV4;
+            CHECK(MP_RSS_HASH_IPV6 == MpRssGetHashInput(Frame, Length, g_Rss.HashTypes, Input, &InputSize));
+            CHECK((32 == InputSize) && (pVector->HashIp == MpRssHash(&g_Rss, Input, InputSize)));
+        }
+
+        // More extension headers than are skipped, and the TCP header cut off, hash the addresses
+        g_Rss.HashTypes = MP_RSS_HASH_TYPES_SUPPORTED;
+        ULONG Length = BuildIpv6(Frame, 0, pVector, MP_RSS_IPV6_EXT_HEADERS_MAX + 1);
+        CHECK(MP_RSS_HASH_IPV6 == MpRssClassify(&g_Rss, Frame, Length, &Hash, &Processor));
+        CHECK(pVector->HashIp == Hash);
+        Length = BuildIpv6(Frame, 0, pVector, 1);
+        CHECK(MP_RSS_HASH_IPV6 == MpRssClassify(&g_Rss, Frame, Length - 17, &Hash, &Processor));
+        CHECK(pVector->HashIp == Hash);
+    }
+}
+
+static void
+TestShortFrames(void)
+{
+    static UCHAR    Frame[256];
+    ULONG           Hash;
+    ULONG           Processor;
+    ULONG           Length = BuildIpv4(Frame, 2, &g_Ipv4Vectors[0], MP_RSS_IP_PROTOCOL_TCP, 0);
+
+    g_Rss.HashTypes = MP_RSS_HASH_TYPES_SUPPORTED;
+    for (ULONG Cut = 0; Cut < Length; Cut++) {
+        ULONG Type = MpRssClassify(&g_Rss, Frame, Cut, &Hash, &Processor);
+
+        if (Cut < 22 + 20) {
+            CHECK(0 == Type);                                                      // No complete IPv4 header
+        } else if (Cut < 22 + 24 + 4) {
+            CHECK((MP_RSS_HASH_IPV4 == Type) && (g_Ipv4Vectors[0].HashIp == Hash));
+        } else {
+            CHECK((MP_RSS_HASH_TCP_IPV4 == Type) && (g_Ipv4Vectors[0].HashTcp == Hash));
+        }
+    }
+
+    // Not IP, bad IP version, RSS disabled
+    Frame[20] = 0x08;
+    Frame[21] = 0x06;
+    CHECK(0 == MpRssClassify(&g_Rss, Frame, Length, &Hash, &Processor));
+    Length = BuildIpv4(Frame, 0, &g_Ipv4Vectors[0], MP_RSS_IP_PROTOCOL_TCP, 0);
+    Frame[14] = 0x44;
+    CHECK(0 == MpRssClassify(&g_Rss, Frame, Length, &Hash, &Processor));
+    Frame[14] = 0x66;
+    CHECK(0 == MpRssClassify(&g_Rss, Frame, Length, &Hash, &Processor));
+    Frame[14] = 0x45;
+    g_Rss.HashTypes = 0;
+    CHECK(0 == MpRssClassify(&g_Rss, Frame, Length, &Hash, &Processor));
+}
+
+static void
+TestRandomKeys(void)
+{
+    static MP_RSS   Rss;
+
+    for (ULONG Iteration = 0; Iteration < 200; Iteration++) {
+        UCHAR   Key[MP_RSS_HASH_KEY_SIZE];
+        ULONG   KeySize = (Iteration % 4) ? MP_RSS_HASH_KEY_SIZE : Random(MP_RSS_HASH_KEY_SIZE + 1);
+
+        for (ULONG Idx = 0; Idx < sizeof(Key); Idx++) {
+            Key[Idx] = (UCHAR)Random(256);
+        }
+        MpRssSetHashKey(&Rss, Key, KeySize);
+        for (ULONG Input = 0; Input < 20; Input++) {
+            UCHAR   Data[MP_RSS_HASH_INPUT_SIZE_MAX];
+            ULONG   Size = Random(MP_RSS_HASH_INPUT_SIZE_MAX + 1);
+
+            for (ULONG Idx = 0; Idx < Size; Idx++) {
+                Data[Idx] = (UCHAR)Random(256);
+            }
+            CHECK(ReferenceHash(Key, KeySize, Data, Size) == MpRssHash(&Rss, Data, Size));
+        }
+    }
+}
+
+static void
+TestIndirectionTable(void)
+{
+    UCHAR   Table[MP_RSS_INDIRECTION_TABLE_SIZE_MAX * 2];
+    ULONG   Hash;
+    ULONG   Processor;
+    ULONG   Counts[4] = { 0 };
+    UCHAR   Frame[256];
+
+    for (ULONG Idx = 0; Idx < sizeof(Table); Idx++) {
+        Table[Idx] = (UCHAR)(Idx % 4);
+    }
+    CHECK(!MpRssSetIndirectionTable(&g_Rss, Table, 0));
+    CHECK(!MpRssSetIndirectionTable(&g_Rss, Table, 96));
+    CHECK(!MpRssSetIndirectionTable(&g_Rss, Table, MP_RSS_INDIRECTION_TABLE_SIZE_MAX * 2));
+    CHECK(MpRssSetIndirectionTable(&g_Rss, Table, MP_RSS_INDIRECTION_TABLE_SIZE_MAX));
+    CHECK(MP_RSS_INDIRECTION_TABLE_SIZE_MAX - 1 == g_Rss.IndirectionTableMask);
+
+    // Flows spread over the processors
+    g_Rss.HashTypes = MP_RSS_HASH_TYPES_SUPPORTED;
+    for (ULONG Flow = 0; Flow < 4000; Flow++) {
+        IPV4_VECTOR Vector = g_Ipv4Vectors[0];
+        ULONG       Length;
+
+        Vector.SourcePort = (USHORT)(1024 + Flow);
+        Length = BuildIpv4(Frame, 0, &Vector, MP_RSS_IP_PROTOCOL_TCP, 0);
+        CHECK(MP_RSS_HASH_TCP_IPV4 == MpRssClassify(&g_Rss, Frame, Length, &Hash, &Processor));
+        CHECK(Processor < 4);
+        Counts[Processor % 4]++;
+    }
+    for (ULONG Idx = 0; Idx < 4; Idx++) {
+        CHECK((Counts[Idx] > 800) && (Counts[Idx] < 1200));
+    }
+    CHECK(MpRssSetIndirectionTable(&g_Rss, Table, 1));
+    CHECK(0 == g_Rss.IndirectionTableMask);
+}
+
+static void
+TestPriorities(void)
+{
+    UCHAR   Frame[64] = { 0 };
+    UCHAR   Map[MP_RSS_PRIORITY_COUNT];
+
+    BuildEthernet(Frame, 0, MP_RSS_ETHERTYPE_IPV4);
+    CHECK(0 == MpRssGetFramePriority(Frame, sizeof(Frame)));
+    BuildEthernet(Frame, 1, MP_RSS_ETHERTYPE_IPV4);
+    CHECK(5 == MpRssGetFramePriority(Frame, sizeof(Frame)));
+    CHECK(0 == MpRssGetFramePriority(Frame, 15));
+
+    // Every priority in exactly one class, and the classes used are 0 .. Count - 1
+    for (ULONG Count = 0; Count <= MP_RSS_TRAFFIC_CLASS_COUNT_MAX + 1; Count++) {
+        ULONG Classes = (Count == 0) ? 1 : (Count > MP_RSS_TRAFFIC_CLASS_COUNT_MAX) ? MP_RSS_TRAFFIC_CLASS_COUNT_MAX : Count;
+        ULONG AllMask = 0;
+
+        MpRssBuildPriorityMap(Count, Map);
+        for (ULONG Class = 0; Class < MP_RSS_TRAFFIC_CLASS_COUNT_MAX; Class++) {
+            ULONG Mask = MpRssGetPriorityMask(Map, Class);
+
+            CHECK((Mask != 0) == (Class < Classes));
+            CHECK(0 == (AllMask & Mask));
+            AllMask |= Mask;
+        }
+        CHECK(0xFF == AllMask);
+    }
+    MpRssBuildPriorityMap(8, Map);
+    CHECK((1 == Map[0]) && (0 == Map[1]) && (7 == Map[7]));                       // Priority 1 is background, below best effort
+}
+
+int
+main(void)
+{
+    UCHAR   Table[MP_RSS_INDIRECTION_TABLE_SIZE_MAX];
+
+    for (ULONG Idx = 0; Idx < sizeof(Table); Idx++) {
+        Table[Idx] = (UCHAR)(Idx * 7 % 8);
+    }
+    MpRssSetHashKey(&g_Rss, g_Key, sizeof(g_Key));
+    MpRssSetIndirectionTable(&g_Rss, Table, 64);
+
+    TestKnownVectorsIpv4();
+    TestKnownVectorsIpv6();
+    TestShortFrames();
+    TestRandomKeys();
+    TestIndirectionTable();
+    TestPriorities();
+
+    return HostTestResult("mp_rss_test");
+}
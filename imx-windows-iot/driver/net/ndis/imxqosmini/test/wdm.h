@@ -0,0 +1,34 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Stand-in for the parts of wdm.h used by the miniport sources in the host
+// tests
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+typedef unsigned char           UCHAR;
+typedef unsigned short          USHORT;
+typedef uint32_t                ULONG, *PULONG;
+typedef int32_t                 LONG;
+typedef uint64_t                ULONGLONG, ULONG64;
+typedef int64_t                 LONGLONG;
+typedef UCHAR                   BOOLEAN;
+
+#define TRUE                    1
+#define FALSE                   0
+#define MAXULONG                0xFFFFFFFFUL
+
+#define RtlZeroMemory(Destination, Length)          memset((Destination), 0, (Length))
+#define RtlCopyMemory(Destination, Source, Length)  memcpy((Destination), (Source), (Length))
+
+#define _In_
+#define _Out_
+#define _Inout_
+#define _In_reads_bytes_(Size)
+#define _Out_writes_bytes_(Size)
+#define _Use_decl_annotations_
@@ -60,6 +60,12 @@ typedef struct {
     UINT32 TuningStartTap;
     UINT32 TuningStep;
 
+    //
+    // eMMC command queue depth, 0 leaves the command queuing
+    // engine disabled
+    //
+    UINT32 CommandQueueDepth;
+
     //
     // Can power on/off SD/MMC slot supply voltage via
     // firmware
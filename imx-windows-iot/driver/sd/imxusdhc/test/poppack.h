@@ -0,0 +1,8 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host build stand-in, restores the packing saved by pshpack1.h
+//
+
+#pragma pack(pop)
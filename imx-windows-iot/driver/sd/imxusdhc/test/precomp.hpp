@@ -0,0 +1,30 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host build stand-in for the kernel headers used by usdhchw.h and
+// usdhccqe.hpp
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+typedef void                VOID;
+typedef uint8_t             BOOLEAN;
+typedef uint32_t            UINT32;
+typedef uint64_t            UINT64;
+typedef uint32_t            ULONG;
+typedef uint64_t            ULONG64;
+typedef int32_t             LONG;
+
+#define TRUE                1
+#define FALSE               0
+
+#define __forceinline       inline
+
+#define _In_
+#define _Out_
+#define _Inout_
+#define _Inout_updates_(Size)
@@ -0,0 +1,8 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host build stand-in, packs the structures that follow on 1 byte
+//
+
+#pragma pack(push, 1)
@@ -0,0 +1,235 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host unit test of the CQE task descriptor and ADMA2 transfer table
+// builder (usdhccqe.hpp)
+//
+// The descriptors are checked word by word against the layouts of the
+// uSDHC reference manual, so a change of the bit fields in usdhchw.h shows
+// up here. The scatter-gather lists are synthetic.
+//
+
+#include "precomp.hpp"
+#include "usdhchw.h"
+#include "usdhccqe.hpp"
+#include "HostTest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+//
+// The scatter-gather list shape the builder expects
+//
+struct SgElement {
+    struct {
+        int64_t QuadPart;
+    } Address;
+    ULONG Length;
+};
+
+struct SgList {
+    ULONG NumberOfElements;
+    SgElement Elements[8];
+};
+
+static SgList
+MakeSgList(
+    std::initializer_list<std::pair<UINT64, ULONG>> Elements)
+{
+    SgList sgList = {};
+
+    for (const auto& element : Elements) {
+        sgList.Elements[sgList.NumberOfElements].Address.QuadPart = int64_t(element.first);
+        sgList.Elements[sgList.NumberOfElements].Length = element.second;
+        sgList.NumberOfElements += 1;
+    }
+
+    return sgList;
+}
+
+//
+// ADMA2 descriptor: Valid 0, End 1, Int 2, Act 4:5, Length 16:31,
+// Address 32:63
+//
+static UINT64
+Adma2Descriptor(
+    UINT32  Address,
+    ULONG   Length,
+    UINT32  Action,
+    bool    IsEnd)
+{
+    return (UINT64(Address) << 32) |
+        (UINT64(Length) << 16) |
+        (UINT64(Action) << 4) |
+        (IsEnd ? 0x2 : 0) |
+        0x1;
+}
+
+static void
+TestLayout()
+{
+    CHECK(8 == sizeof(USDHC_ADMA2_DESCRIPTOR_TABLE_ENTRY));
+    CHECK(8 == sizeof(USDHC_CQE_TASK_DESCRIPTOR));
+    CHECK(16 == sizeof(USDHC_CQE_TASK_SLOT));
+}
+
+static void
+TestTaskSlot()
+{
+    USDHC_CQE_TASK_SLOT slot;
+    USDHC_CQE_TASK_EXTENT extent = {};
+
+    //
+    // Task descriptor: Valid 0, End 1, Int 2, Act 3:5, Direction 12,
+    // Block Count 16:31, Block Address 32:63
+    //
+    memset(&slot, 0xA5, sizeof(slot));
+    extent.BlockAddress = 0x12345678;
+    extent.BlockCount = 8;
+    extent.IsRead = TRUE;
+    UsdhcCqeBuildTaskSlot(&slot, &extent, 0x80001000);
+
+    CHECK(0x123456780008102FULL == slot.Task.AsUint64);
+    CHECK(Adma2Descriptor(0x80001000, 0, USDHC_ADMA2_ACTION_LINK, false) == slot.Link.AsUint64);
+
+    memset(&slot, 0xA5, sizeof(slot));
+    extent.BlockAddress = 0xFFFFFFFF;
+    extent.BlockCount = 0xFFFF;
+    extent.IsRead = FALSE;
+    UsdhcCqeBuildTaskSlot(&slot, &extent, 0x4);
+
+    CHECK(0xFFFFFFFFFFFF002FULL == slot.Task.AsUint64);
+    CHECK(Adma2Descriptor(0x4, 0, USDHC_ADMA2_ACTION_LINK, false) == slot.Link.AsUint64);
+}
+
+static void
+TestAppendAdmaTable()
+{
+    const ULONG capacity = 8;
+    std::vector<USDHC_ADMA2_DESCRIPTOR_TABLE_ENTRY> table(capacity);
+
+    for (auto& entry : table) {
+        entry.AsUint64 = 0xDEADBEEFDEADBEEFULL;
+    }
+
+    //
+    // An element longer than SDHC_ADMA2_MAX_LENGTH_PER_ENTRY is split
+    //
+    SgList first = MakeSgList({ { 0x1000, 0x200 }, { 0x40000, 0x10000 } });
+    CHECK(3 == UsdhcCqeAdmaEntryCount(&first));
+    CHECK(3 == UsdhcCqeAppendAdmaTable(&first, table.data(), 0, capacity));
+    CHECK(Adma2Descriptor(0x1000, 0x200, USDHC_ADMA2_ACTION_TRAN, false) == table[0].AsUint64);
+    CHECK(Adma2Descriptor(0x40000, 0xF000, USDHC_ADMA2_ACTION_TRAN, false) == table[1].AsUint64);
+    CHECK(Adma2Descriptor(0x4F000, 0x1000, USDHC_ADMA2_ACTION_TRAN, true) == table[2].AsUint64);
+    CHECK(0xDEADBEEFDEADBEEFULL == table[3].AsUint64);
+
+    //
+    // Appending moves the End mark to the new last descriptor
+    //
+    SgList second = MakeSgList({ { 0x2000, 0x400 } });
+    CHECK(4 == UsdhcCqeAppendAdmaTable(&second, table.data(), 3, capacity));
+    CHECK(Adma2Descriptor(0x4F000, 0x1000, USDHC_ADMA2_ACTION_TRAN, false) == table[2].AsUint64);
+    CHECK(Adma2Descriptor(0x2000, 0x400, USDHC_ADMA2_ACTION_TRAN, true) == table[3].AsUint64);
+
+    std::vector<USDHC_ADMA2_DESCRIPTOR_TABLE_ENTRY> saved = table;
+
+    //
+    // Lists that do not fit, or that the 32-bit ADMA2 can't reach, leave
+    // the table untouched
+    //
+    SgList tooLong = MakeSgList({ { 0x100000, 5 * 0xF000 } });
+    CHECK(5 == UsdhcCqeAdmaEntryCount(&tooLong));
+    CHECK(0 == UsdhcCqeAppendAdmaTable(&tooLong, table.data(), 4, capacity));
+
+    SgList above4G = MakeSgList({ { 0x3000, 0x200 }, { 0xFFFFF000, 0x2000 } });
+    CHECK(0 == UsdhcCqeAppendAdmaTable(&above4G, table.data(), 4, capacity));
+
+    SgList unaligned = MakeSgList({ { 0x3002, 0x200 } });
+    CHECK(0 == UsdhcCqeAppendAdmaTable(&unaligned, table.data(), 4, capacity));
+
+    SgList empty = MakeSgList({});
+    CHECK(0 == UsdhcCqeAppendAdmaTable(&empty, table.data(), 4, capacity));
+
+    CHECK(0 == memcmp(saved.data(), table.data(), capacity * sizeof(table[0])));
+
+    //
+    // A list ending right below 4GB still fits, up to the capacity
+    //
+    SgList top = MakeSgList({ { 0xFFFFF000, 0x1000 } });
+    CHECK(5 == UsdhcCqeAppendAdmaTable(&top, table.data(), 4, 5));
+    CHECK(Adma2Descriptor(0xFFFFF000, 0x1000, USDHC_ADMA2_ACTION_TRAN, true) == table[4].AsUint64);
+    CHECK(Adma2Descriptor(0x2000, 0x400, USDHC_ADMA2_ACTION_TRAN, false) == table[3].AsUint64);
+}
+
+static void
+TestTags()
+{
+    CHECK(0x1 == UsdhcCqeTagMask(1));
+    CHECK(0xFFFF == UsdhcCqeTagMask(16));
+    CHECK(0xFFFFFFFF == UsdhcCqeTagMask(USDHC_CQE_MAX_TASKS));
+    CHECK(32 == UsdhcCqeTagCount(0xFFFFFFFF));
+    CHECK(3 == UsdhcCqeTagCount(0x80000101));
+
+    UINT32 freeTagMask = 0x80000006;
+    CHECK(1 == UsdhcCqeAllocateTag(&freeTagMask));
+    CHECK(2 == UsdhcCqeAllocateTag(&freeTagMask));
+    CHECK(31 == UsdhcCqeAllocateTag(&freeTagMask));
+    CHECK(-1 == UsdhcCqeAllocateTag(&freeTagMask));
+    CHECK(0 == freeTagMask);
+}
+
+static void
+TestMergeWrite()
+{
+    USDHC_CQE_TASK_EXTENT extent = {};
+    extent.BlockAddress = 1000;
+    extent.BlockCount = 16;
+    extent.RequestCount = 1;
+    extent.AdmaEntryCount = 2;
+    extent.IsRead = FALSE;
+
+    CHECK(UsdhcCqeCanMergeWrite(&extent, 1016, 8, 1));
+
+    // Not adjacent
+    CHECK(!UsdhcCqeCanMergeWrite(&extent, 1017, 8, 1));
+    CHECK(!UsdhcCqeCanMergeWrite(&extent, 992, 8, 1));
+
+    // Too large a request, or a task growing past its limits
+    CHECK(!UsdhcCqeCanMergeWrite(&extent, 1016, USDHC_CQE_MERGE_MAX_REQUEST_BLOCKS + 1, 1));
+    CHECK(!UsdhcCqeCanMergeWrite(&extent, 1016, 8, USDHC_CQE_ADMA_ENTRIES_PER_SLOT - 1));
+
+    extent.BlockCount = USDHC_CQE_MERGE_MAX_TASK_BLOCKS - 8;
+    CHECK(UsdhcCqeCanMergeWrite(&extent, 1000 + extent.BlockCount, 8, 1));
+    CHECK(!UsdhcCqeCanMergeWrite(&extent, 1000 + extent.BlockCount, 9, 1));
+    extent.BlockCount = 16;
+
+    extent.RequestCount = USDHC_CQE_MERGE_MAX_REQUESTS;
+    CHECK(!UsdhcCqeCanMergeWrite(&extent, 1016, 8, 1));
+    extent.RequestCount = 1;
+
+    // Reads, and tasks on the request's own descriptor table, never grow
+    extent.AdmaEntryCount = 0;
+    CHECK(!UsdhcCqeCanMergeWrite(&extent, 1016, 8, 1));
+    extent.AdmaEntryCount = 2;
+    extent.IsRead = TRUE;
+    CHECK(!UsdhcCqeCanMergeWrite(&extent, 1016, 8, 1));
+
+    // The block address does not wrap
+    extent.IsRead = FALSE;
+    extent.BlockAddress = 0xFFFFFFF0;
+    CHECK(!UsdhcCqeCanMergeWrite(&extent, 0, 8, 1));
+}
+
+int
+main()
+{
+    TestLayout();
+    TestTaskSlot();
+    TestAppendAdmaTable();
+    TestTags();
+    TestMergeWrite();
+
+    return HostTestResult("usdhccqetest");
+}
@@ -24,6 +24,7 @@
 #include "acpiutil.hpp"
 #include "devpropslist.hpp"
 #include "usdhchw.h"
+#include "usdhccqe.hpp"
 #include "usdhc.hpp"
 
 INIT_SEGMENT_BEGIN; //======================================================
@@ -220,6 +221,15 @@ SdhcSlotInterrupt(
     *SdioInterruptPtr = 0;
     *TuningPtr = 0;
 
+    //
+    // Let the command queuing engine take its own events first
+    //
+    BOOLEAN isCqeHandled = SdhcCqeInterrupt(sdhcExtPtr, &intStatus);
+    if (isCqeHandled && (intStatus.AsUint32 == 0)) {
+        USDHC_DDI_EXIT(sdhcExtPtr->IfrLogHandle, sdhcExtPtr, "%!bool!", TRUE);
+        return TRUE;
+    }
+
     //
     // If there aren't any events to handle, then we don't need to
     // process anything.
@@ -361,6 +371,18 @@ SdhcSlotIssueRequest(
     switch (RequestPtr->Type) {
     case SdRequestTypeCommandNoTransfer:
     case SdRequestTypeCommandWithTransfer:
+        if (sdhcExtPtr->Cqe.IsSupported) {
+            status = SdhcCqeIssueRequest(sdhcExtPtr, RequestPtr);
+            if (!NT_SUCCESS(status)) {
+                USDHC_LOG_ERROR_STATUS(
+                    sdhcExtPtr->IfrLogHandle,
+                    sdhcExtPtr,
+                    status,
+                    "SdhcCqeIssueRequest() failed");
+            }
+            break;
+        }
+
         status = SdhcSendCommand(sdhcExtPtr, RequestPtr);
         if (!NT_SUCCESS(status)) {
             USDHC_LOG_ERROR_STATUS(
@@ -464,6 +486,14 @@ SdhcSlotRequestDpc(
 {
     USDHC_EXTENSION* sdhcExtPtr = static_cast<USDHC_EXTENSION*>(PrivateExtensionPtr);
 
+    //
+    // Command queuing tasks complete from the CQE DPC, there may be
+    // no legacy request for late events
+    //
+    if (RequestPtr == nullptr) {
+        return;
+    }
+
     USDHC_DDI_ENTER(
         sdhcExtPtr->IfrLogHandle,
         sdhcExtPtr,
@@ -536,6 +566,9 @@ SdhcSlotSaveContext(
     USDHC_EXTENSION* sdhcExtPtr = static_cast<USDHC_EXTENSION*>(PrivateExtensionPtr);
 
     USDHC_DDI_ENTER(sdhcExtPtr->IfrLogHandle, sdhcExtPtr, "()");
+
+    SdhcCqeLogStatistics(sdhcExtPtr);
+
     USDHC_DDI_EXIT(sdhcExtPtr->IfrLogHandle, sdhcExtPtr, "()");
 }
 
@@ -571,10 +604,12 @@ SdhcSlotToggleEvents(
     UINT32 InterruptMask = SdhcConvertStandardEventsToIntStatusMask(
         EventMask, 
         SDHC_ALL_STANDARD_ERRORS_MASK);
-    if (Enable) {
-        SdhcEnableInterrupt(sdhcExtPtr, InterruptMask);
-    } else {
-        SdhcDisableInterrupt(sdhcExtPtr, InterruptMask);
+    if (!SdhcCqeToggleEvents(sdhcExtPtr, InterruptMask, Enable)) {
+        if (Enable) {
+            SdhcEnableInterrupt(sdhcExtPtr, InterruptMask);
+        } else {
+            SdhcDisableInterrupt(sdhcExtPtr, InterruptMask);
+        }
     }
 
     USDHC_DDI_EXIT(sdhcExtPtr->IfrLogHandle, sdhcExtPtr, "()");
@@ -626,6 +661,7 @@ SdhcCleanup(
         (VOID)DevicePropertiesListSafeRemoveByKey(devPropsPtr->Key);
     }
 
+    SdhcCqeCleanup(MiniportPtr);
     SdhcLogCleanup(MiniportPtr);
     WPP_CLEANUP(NULL);
 }
@@ -1336,7 +1372,19 @@ SdhcCompleteRequest(
         NT_ASSERTMSG("Unsupported request type", FALSE);
     }
 
+    BOOLEAN isLegacyDone = FALSE;
+    if (SdhcExtPtr->Cqe.IsSupported) {
+        isLegacyDone = SdhcCqeLegacyRequestDone(SdhcExtPtr, RequestPtr, Status);
+    }
+
     SdPortCompleteRequest(RequestPtr, Status);
+
+    //
+    // The bus is free, issue the requests held back by the legacy one
+    //
+    if (isLegacyDone) {
+        SdhcCqeProcessQueue(SdhcExtPtr);
+    }
 }
 
 _Use_decl_annotations_
@@ -1504,6 +1552,7 @@ SdhcSlotInitialize(
             sdhcExtPtr->DeviceProperties.BaseClockFrequencyHz      = USDHC_DEFAULT_BASE_CLOCK_FREQ_HZ;
             sdhcExtPtr->DeviceProperties.TuningStartTap            = SDHC_TUNING_CTRL_START_TAP_DFLT;
             sdhcExtPtr->DeviceProperties.TuningStep                = SDHC_TUNING_CTRL_TUNING_STEP_DFLT;
+            sdhcExtPtr->DeviceProperties.CommandQueueDepth         = 0;
         } else {
             RtlCopyMemory(
                 &sdhcExtPtr->DeviceProperties,
@@ -1520,6 +1569,7 @@ SdhcSlotInitialize(
         sdhcExtPtr->DeviceProperties.BaseClockFrequencyHz = 400000000;
         sdhcExtPtr->DeviceProperties.TuningStartTap = 20;
         sdhcExtPtr->DeviceProperties.TuningStep = 2;
+        sdhcExtPtr->DeviceProperties.CommandQueueDepth = 0;
     }
 
     // Reset tuning circuit
@@ -1645,6 +1695,11 @@ SdhcSlotInitialize(
         capabilitiesPtr->Supported.ScatterGatherDma = 0;
     }
 
+    SdhcCqeInitialize(sdhcExtPtr, Length);
+    if (sdhcExtPtr->Cqe.IsSupported) {
+        capabilitiesPtr->MaximumOutstandingRequests = sdhcExtPtr->Cqe.HostDepth;
+    }
+
     status = STATUS_SUCCESS;
 
 Cleanup:
@@ -1668,6 +1723,15 @@ SdhcSlotIssueBusOperation(
         "Type:%!BUSOPERATIONTYPE!",
         BusOperationPtr->Type);
 
+    //
+    // Bus operations go to the legacy interface once the tasks in
+    // flight completed, and tuning has to run with command queuing
+    // off on the card
+    //
+    SdhcCqeQuiesce(
+        sdhcExtPtr,
+        (BusOperationPtr->Type == SdExecuteTuning) ? TRUE : FALSE);
+
     NTSTATUS status;
 
     switch (BusOperationPtr->Type) {
@@ -1782,6 +1846,8 @@ SdhcSlotIssueBusOperation(
             BusOperationPtr->Type);
     }
 
+    SdhcCqeResume(sdhcExtPtr);
+
     USDHC_DDI_EXIT(sdhcExtPtr->IfrLogHandle, sdhcExtPtr, "%!STATUS!", status);
     return status;
 }
@@ -2689,6 +2755,20 @@ SdhcReadDeviceProperties(
         devPropsPtr->TuningStep = SDHC_TUNING_CTRL_TUNING_STEP_DFLT;
     }
 
+    status =
+        AcpiDevicePropertiesQueryIntegerValue(
+            devicePropertiesPkgPtr,
+            "CommandQueueDepth",
+            &devPropsPtr->CommandQueueDepth);
+    if (!NT_SUCCESS(status)) {
+        USDHC_LOG_INFORMATION(
+            DriverLogHandle,
+            NullPrivateExtensionPtr,
+            "CommandQueueDepth not specified, eMMC command queuing disabled");
+        status = STATUS_SUCCESS;
+        devPropsPtr->CommandQueueDepth = 0;
+    }
+
 // SlotPowerControlSupported is not supported but might be usefull in
 // future so we will keep the code here.
 #if 0
@@ -38,7 +38,8 @@
 #define USDHC_POLL_WAIT_TIME_US             10
 
 //
-// Not supporting more than 1 request at a time
+// Not supporting more than 1 request at a time without the command
+// queuing engine, with it up to the queue depth
 //
 #define USDHC_MAX_OUTSTANDING_REQUESTS      1
 
@@ -134,6 +135,120 @@ typedef union {
 
 #include <poppack.h> // pshpack1.h
 
+//
+// Command queuing engine state
+//
+typedef enum {
+    //
+    // The legacy command interface is in use
+    //
+    UsdhcCqeStateOff,
+    //
+    // The CQE is enabled, data transfers are issued as tasks
+    //
+    UsdhcCqeStateRunning,
+} USDHC_CQE_STATE;
+
+//
+// A CQE task, one request, or adjacent writes merged into one task
+//
+typedef struct {
+    USDHC_CQE_TASK_EXTENT Extent;
+    SDPORT_REQUEST* RequestPtrs[USDHC_CQE_MERGE_MAX_REQUESTS];
+} USDHC_CQE_TASK;
+
+//
+// Command queuing engine context
+//
+typedef struct {
+    //
+    // Set when the controller has a CQE and a queue depth is configured
+    //
+    BOOLEAN IsSupported;
+    volatile USDHC_CQE_STATE State;
+
+    //
+    // What is known about the card, snooped from the Sdport requests
+    //
+    BOOLEAN IsCardMmc;
+    BOOLEAN IsCardUnsupported;
+    BOOLEAN IsCardCqEnabled;
+    UINT16 CardRca;
+
+    //
+    // Queue depth from ACPI, and the depth in use once the card
+    // reported its own
+    //
+    ULONG HostDepth;
+    ULONG Depth;
+
+    //
+    // Protects the queue state, the ISR only uses the interlocked fields
+    //
+    KSPIN_LOCK Lock;
+    KDPC CompletionDpc;
+    volatile LONG CompletedTagMask;
+    volatile LONG ErrorStatus;
+
+    //
+    // Task descriptor list and the per slot ADMA2 transfer tables,
+    // in one non-cached buffer below 4GB
+    //
+    VOID* DescriptorMemoryPtr;
+    SIZE_T DescriptorMemorySize;
+    USDHC_CQE_TASK_SLOT* TaskListPtr;
+    UINT32 TaskListAddress;
+    USDHC_ADMA2_DESCRIPTOR_TABLE_ENTRY* TransferTablesPtr;
+    UINT32 TransferTablesAddress;
+
+    //
+    // Tag bookkeeping. A plugged task is built but not rung yet, so
+    // adjacent writes can be merged into it.
+    //
+    UINT32 FreeTagMask;
+    UINT32 InFlightTagMask;
+    UINT32 DoneTagMask;
+    UINT32 FailedTagMask;
+    NTSTATUS FailedStatus;
+    LONG PluggedTag;
+    USDHC_CQE_TASK Tasks[USDHC_CQE_MAX_TASKS];
+
+    //
+    // Requests waiting for the queue to drain, or for the legacy
+    // command in progress to complete
+    //
+    SDPORT_REQUEST* DeferredRequestPtrs[USDHC_CQE_MAX_TASKS];
+    ULONG DeferredHead;
+    ULONG DeferredCount;
+
+    //
+    // The legacy command in progress, and if its PIO data phase is
+    // still to come
+    //
+    SDPORT_REQUEST* LegacyRequestPtr;
+    BOOLEAN IsLegacyDataPending;
+
+    //
+    // Set while a bus operation waits for the tasks in flight to
+    // complete, IdleEvent is signaled when the last one does
+    //
+    BOOLEAN IsBusOperationPending;
+    KEVENT IdleEvent;
+
+    //
+    // Interrupt enables owned by Sdport, parked while the CQE runs
+    //
+    UINT32 SavedIntStatusEnable;
+    UINT32 SavedIntSignalEnable;
+
+    //
+    // EXT_CSD read when command queuing gets enabled on the card
+    //
+    UINT32 ExtCsd[USDHC_MMC_EXT_CSD_SIZE / sizeof(UINT32)];
+
+    USDHC_CQE_STATISTICS Statistics;
+} USDHC_CQE_CONTEXT;
+
 //
 // SDHC Private Extension
 //
@@ -156,6 +271,11 @@ typedef struct {
     // Information populated from ACPI
     //
     USDHC_DEVICE_PROPERTIES DeviceProperties;
+
+    //
+    // eMMC command queuing
+    //
+    USDHC_CQE_CONTEXT Cqe;
 } USDHC_EXTENSION;
 
 //
@@ -334,6 +454,65 @@ SdhcSdClockEnableInIdle(
     _In_ USDHC_EXTENSION* SdhcExtPtr,
     _In_ BOOLEAN Enable);
 
+//
+// Command queuing engine routines
+//
+
+_IRQL_requires_(PASSIVE_LEVEL)
+VOID
+SdhcCqeInitialize(
+    _In_ USDHC_EXTENSION* SdhcExtPtr,
+    _In_ ULONG RegistersLength);
+
+_IRQL_requires_(PASSIVE_LEVEL)
+VOID
+SdhcCqeCleanup(
+    _In_ SD_MINIPORT* MiniportPtr);
+
+NTSTATUS
+SdhcCqeIssueRequest(
+    _In_ USDHC_EXTENSION* SdhcExtPtr,
+    _In_ SDPORT_REQUEST* RequestPtr);
+
+BOOLEAN
+SdhcCqeInterrupt(
+    _In_ USDHC_EXTENSION* SdhcExtPtr,
+    _Inout_ USDHC_INT_STATUS_REG* IntStatusPtr);
+
+BOOLEAN
+SdhcCqeLegacyRequestDone(
+    _In_ USDHC_EXTENSION* SdhcExtPtr,
+    _In_ SDPORT_REQUEST* RequestPtr,
+    _In_ NTSTATUS Status);
+
+VOID
+SdhcCqeProcessQueue(
+    _In_ USDHC_EXTENSION* SdhcExtPtr);
+
+_IRQL_requires_max_(APC_LEVEL)
+VOID
+SdhcCqeQuiesce(
+    _In_ USDHC_EXTENSION* SdhcExtPtr,
+    _In_ BOOLEAN DisableCardQueuing);
+
+_IRQL_requires_max_(APC_LEVEL)
+VOID
+SdhcCqeResume(
+    _In_ USDHC_EXTENSION* SdhcExtPtr);
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+SdhcCqeToggleEvents(
+    _In_ USDHC_EXTENSION* SdhcExtPtr,
+    _In_ UINT32 InterruptMask,
+    _In_ BOOLEAN Enable);
+
+VOID
+SdhcCqeLogStatistics(
+    _In_ USDHC_EXTENSION* SdhcExtPtr);
+
+KDEFERRED_ROUTINE SdhcCqeCompletionDpc;
+
 _IRQL_requires_same_
 _IRQL_requires_(PASSIVE_LEVEL)
 VOID
@@ -0,0 +1,1608 @@
+// Copyright 2023 NXP
+// Licensed under the MIT License.
+//
+// Module Name:
+//
+//   usdhccqe.cpp
+//
+// Abstract:
+//
+//  This module contains the eMMC command queuing support of the uSDHC
+//  miniport. Multi-block reads and writes of an eMMC device that supports
+//  command queuing are issued as CQE tasks, up to the queue depth, and small
+//  adjacent writes are merged into one task while earlier tasks are in
+//  flight. All the other commands go through the legacy interface, after
+//  the queue drained and the CQE was turned off.
+//
+//  Command queuing is enabled on the card the first time a queueable request
+//  is issued, and disabled again before any legacy command other than CMD13
+//  and CMD0. Task completions are handled in a DPC owned by the miniport, so
+//  the Sdport request DPC only sees legacy commands.
+//
+// Environment:
+//
+//  Kernel mode only
+//
+
+#include "precomp.hpp"
+#pragma hdrstop
+
+#include "trace.hpp"
+#include "usdhccqe.tmh"
+
+#include "devpropslist.hpp"
+#include "usdhchw.h"
+#include "usdhccqe.hpp"
+#include "usdhc.hpp"
+
+//
+// Layout of the CQE descriptor memory, the task descriptor list
+// followed by the ADMA2 transfer tables of the task slots
+//
+#define USDHC_CQE_TRANSFER_TABLES_OFFSET    0x400
+#define USDHC_CQE_TRANSFER_TABLE_SIZE \
+    ULONG(USDHC_CQE_ADMA_ENTRIES_PER_SLOT * sizeof(USDHC_ADMA2_DESCRIPTOR_TABLE_ENTRY))
+#define USDHC_CQE_DESCRIPTOR_MEMORY_SIZE \
+    (USDHC_CQE_TRANSFER_TABLES_OFFSET + (USDHC_CQE_MAX_TASKS * USDHC_CQE_TRANSFER_TABLE_SIZE))
+
+C_ASSERT((sizeof(USDHC_CQE_TASK_SLOT) * USDHC_CQE_MAX_TASKS) <= USDHC_CQE_TRANSFER_TABLES_OFFSET);
+
+//
+// How long a bus operation waits for the tasks in flight to complete
+//
+#define USDHC_CQE_IDLE_TIMEOUT_MS           1000
+
+//
+// Internal helpers
+//
+
+static
+BOOLEAN
+SdhcCqepIsQueueable(
+    _In_ const SDPORT_REQUEST* RequestPtr);
+
+static
+NTSTATUS
+SdhcCqepSendPolledCommand(
+    _In_ USDHC_EXTENSION* SdhcExtPtr,
+    _In_ UINT32 Index,
+    _In_ UINT32 Argument,
+    _In_ BOOLEAN IsBusy,
+    _Out_writes_bytes_opt_(Length) UINT32* BufferPtr,
+    _In_ ULONG Length);
+
+static
+NTSTATUS
+SdhcCqepStart(
+    _In_ USDHC_EXTENSION* SdhcExtPtr);
+
+static
+VOID
+SdhcCqepStop(
+    _In_ USDHC_EXTENSION* SdhcExtPtr);
+
+static
+NTSTATUS
+SdhcCqepHalt(
+    _In_ USDHC_EXTENSION* SdhcExtPtr);
+
+static
+NTSTATUS
+SdhcCqepDisableCard(
+    _In_ USDHC_EXTENSION* SdhcExtPtr);
+
+static
+VOID
+SdhcCqepRecover(
+    _In_ USDHC_EXTENSION* SdhcExtPtr,
+    _In_ NTSTATUS Status);
+
+static
+VOID
+SdhcCqepRingTag(
+    _In_ USDHC_EXTENSION* SdhcExtPtr,
+    _In_ LONG Tag);
+
+static
+VOID
+SdhcCqepRingPlugged(
+    _In_ USDHC_EXTENSION* SdhcExtPtr);
+
+static
+BOOLEAN
+SdhcCqepCanMergeRequest(
+    _In_ USDHC_EXTENSION* SdhcExtPtr,
+    _In_ const SDPORT_REQUEST* RequestPtr);
+
+static
+NTSTATUS
+SdhcCqepQueueRequest(
+    _In_ USDHC_EXTENSION* SdhcExtPtr,
+    _In_ SDPORT_REQUEST* RequestPtr);
+
+static
+NTSTATUS
+SdhcCqepIssueLegacy(
+    _In_ USDHC_EXTENSION* SdhcExtPtr,
+    _In_ SDPORT_REQUEST* RequestPtr);
+
+static
+BOOLEAN
+SdhcCqepTryIssue(
+    _In_ USDHC_EXTENSION* SdhcExtPtr,
+    _In_ SDPORT_REQUEST* RequestPtr,
+    _Out_ NTSTATUS* StatusPtr);
+
+static
+BOOLEAN
+SdhcCqepTakeCompletion(
+    _In_ USDHC_EXTENSION* SdhcExtPtr,
+    _Out_writes_(USDHC_CQE_MERGE_MAX_REQUESTS) SDPORT_REQUEST** RequestPtrs,
+    _Out_ ULONG* RequestCountPtr,
+    _Out_ NTSTATUS* StatusPtr);
+
+static
+VOID
+SdhcCqepCompleteTasks(
+    _In_ USDHC_EXTENSION* SdhcExtPtr);
+
+NONPAGED_SEGMENT_BEGIN; //======================================================
+
+_Use_decl_annotations_
+VOID
+SdhcCqeInitialize(
+    USDHC_EXTENSION* SdhcExtPtr,
+    ULONG RegistersLength
+    )
+{
+    USDHC_CQE_CONTEXT* cqePtr = &SdhcExtPtr->Cqe;
+
+    RtlZeroMemory(cqePtr, sizeof(*cqePtr));
+    cqePtr->State = UsdhcCqeStateOff;
+    cqePtr->PluggedTag = -1;
+
+    if (SdhcExtPtr->CrashdumpMode ||
+        (SdhcExtPtr->DeviceProperties.CommandQueueDepth == 0)) {
+        return;
+    }
+
+    if (!SdhcExtPtr->Capabilities.Supported.ScatterGatherDma) {
+        USDHC_LOG_INFORMATION(
+            SdhcExtPtr->IfrLogHandle,
+            SdhcExtPtr,
+            "Command queuing needs ADMA2, CQE disabled");
+        return;
+    }
+
+    if (RegistersLength < sizeof(USDHC_REGISTERS)) {
+        USDHC_LOG_ERROR(
+            SdhcExtPtr->IfrLogHandle,
+            SdhcExtPtr,
+            "Register space 0x%lX does not cover the CQE registers, CQE disabled",
+            RegistersLength);
+        return;
+    }
+
+    USDHC_CQVER_REG cqVer = { SdhcReadRegister(&SdhcExtPtr->RegistersPtr->CQVER) };
+    if (cqVer.MAJOR_VERSION < 5) {
+        USDHC_LOG_INFORMATION(
+            SdhcExtPtr->IfrLogHandle,
+            SdhcExtPtr,
+            "No command queuing engine (CQVER:0x%08X)",
+            cqVer.AsUint32);
+        return;
+    }
+
+    PHYSICAL_ADDRESS lowestAddress;
+    PHYSICAL_ADDRESS highestAddress;
+    PHYSICAL_ADDRESS boundaryAddress;
+    lowestAddress.QuadPart = 0;
+    highestAddress.QuadPart = MAXULONG;
+    boundaryAddress.QuadPart = 0;
+
+    SIZE_T memorySize = ROUND_TO_PAGES(USDHC_CQE_DESCRIPTOR_MEMORY_SIZE);
+    VOID* memoryPtr = MmAllocateContiguousMemorySpecifyCache(
+        memorySize,
+        lowestAddress,
+        highestAddress,
+        boundaryAddress,
+        MmNonCached);
+    if (memoryPtr == nullptr) {
+        USDHC_LOG_ERROR(
+            SdhcExtPtr->IfrLogHandle,
+            SdhcExtPtr,
+            "Failed to allocate %Iu bytes of CQE descriptor memory, CQE disabled",
+            memorySize);
+        return;
+    }
+
+    RtlZeroMemory(memoryPtr, memorySize);
+
+    PHYSICAL_ADDRESS memoryAddress = MmGetPhysicalAddress(memoryPtr);
+    NT_ASSERT(memoryAddress.HighPart == 0);
+
+    cqePtr->DescriptorMemoryPtr = memoryPtr;
+    cqePtr->DescriptorMemorySize = memorySize;
+    cqePtr->TaskListPtr = static_cast<USDHC_CQE_TASK_SLOT*>(memoryPtr);
+    cqePtr->TaskListAddress = memoryAddress.LowPart;
+    cqePtr->TransferTablesPtr = reinterpret_cast<USDHC_ADMA2_DESCRIPTOR_TABLE_ENTRY*>(
+        static_cast<UCHAR*>(memoryPtr) + USDHC_CQE_TRANSFER_TABLES_OFFSET);
+    cqePtr->TransferTablesAddress = memoryAddress.LowPart + USDHC_CQE_TRANSFER_TABLES_OFFSET;
+
+    KeInitializeSpinLock(&cqePtr->Lock);
+    KeInitializeDpc(&cqePtr->CompletionDpc, SdhcCqeCompletionDpc, SdhcExtPtr);
+    KeInitializeEvent(&cqePtr->IdleEvent, NotificationEvent, FALSE);
+
+    cqePtr->HostDepth = Min(
+        ULONG(SdhcExtPtr->DeviceProperties.CommandQueueDepth),
+        ULONG(USDHC_CQE_MAX_TASKS));
+    cqePtr->Depth = cqePtr->HostDepth;
+    cqePtr->FreeTagMask = UsdhcCqeTagMask(cqePtr->Depth);
+    cqePtr->IsSupported = TRUE;
+
+    USDHC_LOG_INFORMATION(
+        SdhcExtPtr->IfrLogHandle,
+        SdhcExtPtr,
+        "CQE version %lu.%lu%lu, queue depth %lu",
+        cqVer.MAJOR_VERSION,
+        cqVer.MINOR_VERSION,
+        cqVer.VERSION_SUFFIX,
+        cqePtr->HostDepth);
+}
+
+_Use_decl_annotations_
+VOID
+SdhcCqeCleanup(
+    SD_MINIPORT* MiniportPtr
+    )
+{
+    for (LONG i = 0; i < MiniportPtr->SlotCount; ++i) {
+        USDHC_EXTENSION* sdhcExtPtr = reinterpret_cast<USDHC_EXTENSION*>(
+            MiniportPtr->SlotExtensionList[i]->PrivateExtension);
+        USDHC_CQE_CONTEXT* cqePtr = &sdhcExtPtr->Cqe;
+
+        if (cqePtr->DescriptorMemoryPtr == nullptr) {
+            continue;
+        }
+
+        SdhcCqeLogStatistics(sdhcExtPtr);
+
+        cqePtr->IsSupported = FALSE;
+        MmFreeContiguousMemorySpecifyCache(
+            cqePtr->DescriptorMemoryPtr,
+            cqePtr->DescriptorMemorySize,
+            MmNonCached);
+        cqePtr->DescriptorMemoryPtr = nullptr;
+    }
+}
+
+_Use_decl_annotations_
+NTSTATUS
+SdhcCqeIssueRequest(
+    USDHC_EXTENSION* SdhcExtPtr,
+    SDPORT_REQUEST* RequestPtr
+    )
+{
+    USDHC_CQE_CONTEXT* cqePtr = &SdhcExtPtr->Cqe;
+    NTSTATUS status;
+    KIRQL oldIrql;
+
+    KeAcquireSpinLock(&cqePtr->Lock, &oldIrql);
+
+    //
+    // Keep the Sdport order, nothing gets ahead of a deferred request
+    //
+    if ((cqePtr->DeferredCount != 0) ||
+        !SdhcCqepTryIssue(SdhcExtPtr, RequestPtr, &status)) {
+
+        if (cqePtr->DeferredCount == ARRAYSIZE(cqePtr->DeferredRequestPtrs)) {
+            status = STATUS_INSUFFICIENT_RESOURCES;
+        } else {
+            ULONG tail = (cqePtr->DeferredHead + cqePtr->DeferredCount) %
+                ARRAYSIZE(cqePtr->DeferredRequestPtrs);
+            cqePtr->DeferredRequestPtrs[tail] = RequestPtr;
+            cqePtr->DeferredCount += 1;
+            cqePtr->Statistics.RequestsDeferred += 1;
+            status = STATUS_PENDING;
+        }
+    }
+
+    KeReleaseSpinLock(&cqePtr->Lock, oldIrql);
+    return status;
+}
+
+_Use_decl_annotations_
+BOOLEAN
+SdhcCqeInterrupt(
+    USDHC_EXTENSION* SdhcExtPtr,
+    USDHC_INT_STATUS_REG* IntStatusPtr
+    )
+{
+    USDHC_CQE_CONTEXT* cqePtr = &SdhcExtPtr->Cqe;
+
+    if (cqePtr->State != UsdhcCqeStateRunning) {
+        return FALSE;
+    }
+
+    volatile USDHC_REGISTERS* registersPtr = SdhcExtPtr->RegistersPtr;
+    USDHC_CQIS_REG cqIs = { SdhcReadRegister(&registersPtr->CQIS) };
+    const UINT32 errors =
+        IntStatusPtr->AsUint32 & (USDHC_INT_STATUS_CMD_ERROR | USDHC_INT_STATUS_DATA_ERROR);
+
+    if ((cqIs.AsUint32 == 0) &&
+        (errors == 0) &&
+        ((IntStatusPtr->AsUint32 & USDHC_INT_STATUS_CQI) == 0)) {
+        return FALSE;
+    }
+
+    SdhcWriteRegister(&registersPtr->CQIS, cqIs.AsUint32);
+
+    if (cqIs.TCC) {
+        UINT32 completedTagMask = SdhcReadRegister(&registersPtr->CQTCN);
+        SdhcWriteRegister(&registersPtr->CQTCN, completedTagMask);
+        InterlockedOr(&cqePtr->CompletedTagMask, LONG(completedTagMask));
+    }
+
+    //
+    // While the CQE runs, the command and data errors belong to its tasks
+    //
+    if (cqIs.RED || (errors != 0)) {
+        NTSTATUS status = STATUS_IO_DEVICE_ERROR;
+        if (errors != 0) {
+            USDHC_INT_STATUS_REG errorStatus = { errors };
+            ULONG events;
+            ULONG stdErrors = 0;
+            SdhcConvertIntStatusToStandardEvents(errorStatus, &events, &stdErrors);
+            status = SdhcConvertStandardErrorToStatus(stdErrors);
+        }
+
+        InterlockedCompareExchange(&cqePtr->ErrorStatus, status, STATUS_SUCCESS);
+    }
+
+    const UINT32 handledMask = USDHC_INT_STATUS_CQI | errors;
+    SdhcAcknowledgeInterrupts(SdhcExtPtr, handledMask);
+    IntStatusPtr->AsUint32 &= ~handledMask;
+
+    KeInsertQueueDpc(&cqePtr->CompletionDpc, nullptr, nullptr);
+    return TRUE;
+}
+
+_Use_decl_annotations_
+VOID
+SdhcCqeCompletionDpc(
+    KDPC* /* DpcPtr */,
+    PVOID DeferredContextPtr,
+    PVOID /* SystemArgument1Ptr */,
+    PVOID /* SystemArgument2Ptr */
+    )
+{
+    USDHC_EXTENSION* sdhcExtPtr = static_cast<USDHC_EXTENSION*>(DeferredContextPtr);
+    USDHC_CQE_CONTEXT* cqePtr = &sdhcExtPtr->Cqe;
+
+    UINT32 completedTagMask = UINT32(InterlockedExchange(&cqePtr->CompletedTagMask, 0));
+    NTSTATUS errorStatus = InterlockedExchange(&cqePtr->ErrorStatus, STATUS_SUCCESS);
+
+    KeAcquireSpinLockAtDpcLevel(&cqePtr->Lock);
+
+    completedTagMask &= cqePtr->InFlightTagMask;
+    cqePtr->InFlightTagMask &= ~completedTagMask;
+    cqePtr->DoneTagMask |= completedTagMask;
+    UsdhcCqeStatisticsTasksRetired(&cqePtr->Statistics, UsdhcCqeTagCount(completedTagMask));
+
+    if (!NT_SUCCESS(errorStatus) && (cqePtr->State == UsdhcCqeStateRunning)) {
+        USDHC_LOG_ERROR_STATUS(
+            sdhcExtPtr->IfrLogHandle,
+            sdhcExtPtr,
+            errorStatus,
+            "CQE error, failing tasks 0x%08X (CQTERRI:0x%08X)",
+            cqePtr->InFlightTagMask,
+            SdhcReadRegister(&sdhcExtPtr->RegistersPtr->CQTERRI));
+
+        SdhcCqepRecover(sdhcExtPtr, errorStatus);
+    }
+
+    if (cqePtr->IsBusOperationPending && (cqePtr->InFlightTagMask == 0)) {
+        KeSetEvent(&cqePtr->IdleEvent, IO_NO_INCREMENT, FALSE);
+    }
+
+    KeReleaseSpinLockFromDpcLevel(&cqePtr->Lock);
+
+    SdhcCqeProcessQueue(sdhcExtPtr);
+}
+
+_Use_decl_annotations_
+BOOLEAN
+SdhcCqeLegacyRequestDone(
+    USDHC_EXTENSION* SdhcExtPtr,
+    SDPORT_REQUEST* RequestPtr,
+    NTSTATUS Status
+    )
+{
+    USDHC_CQE_CONTEXT* cqePtr = &SdhcExtPtr->Cqe;
+    BOOLEAN isDone = FALSE;
+    KIRQL oldIrql;
+
+    KeAcquireSpinLock(&cqePtr->Lock, &oldIrql);
+
+    switch (RequestPtr->Type) {
+    case SdRequestTypeCommandNoTransfer:
+    case SdRequestTypeCommandWithTransfer:
+        if (RequestPtr != cqePtr->LegacyRequestPtr) {
+            break;
+        }
+
+        //
+        // A successful PIO command is followed by its data phase
+        //
+        if ((RequestPtr->Type == SdRequestTypeCommandWithTransfer) &&
+            (RequestPtr->Command.TransferMethod == SdTransferMethodPio) &&
+            NT_SUCCESS(Status)) {
+            cqePtr->IsLegacyDataPending = TRUE;
+        } else {
+            cqePtr->LegacyRequestPtr = nullptr;
+            isDone = TRUE;
+        }
+        break;
+
+    case SdRequestTypeStartTransfer:
+        if (cqePtr->IsLegacyDataPending &&
+            (RequestPtr->Command.TransferMethod == SdTransferMethodPio) &&
+            (Status != STATUS_MORE_PROCESSING_REQUIRED)) {
+            cqePtr->IsLegacyDataPending = FALSE;
+            cqePtr->LegacyRequestPtr = nullptr;
+            isDone = TRUE;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    KeReleaseSpinLock(&cqePtr->Lock, oldIrql);
+    return isDone;
+}
+
+_Use_decl_annotations_
+VOID
+SdhcCqeProcessQueue(
+    USDHC_EXTENSION* SdhcExtPtr
+    )
+{
+    USDHC_CQE_CONTEXT* cqePtr = &SdhcExtPtr->Cqe;
+
+    for (;;) {
+        SdhcCqepCompleteTasks(SdhcExtPtr);
+
+        SDPORT_REQUEST* failedRequestPtr = nullptr;
+        NTSTATUS status = STATUS_SUCCESS;
+        KIRQL oldIrql;
+
+        KeAcquireSpinLock(&cqePtr->Lock, &oldIrql);
+
+        //
+        // Writes are held back only until a task completes
+        //
+        SdhcCqepRingPlugged(SdhcExtPtr);
+
+        while (cqePtr->DeferredCount != 0) {
+            SDPORT_REQUEST* requestPtr = cqePtr->DeferredRequestPtrs[cqePtr->DeferredHead];
+
+            if (!SdhcCqepTryIssue(SdhcExtPtr, requestPtr, &status)) {
+                break;
+            }
+
+            cqePtr->DeferredHead =
+                (cqePtr->DeferredHead + 1) % ARRAYSIZE(cqePtr->DeferredRequestPtrs);
+            cqePtr->DeferredCount -= 1;
+
+            if (status != STATUS_PENDING) {
+                failedRequestPtr = requestPtr;
+                break;
+            }
+        }
+
+        KeReleaseSpinLock(&cqePtr->Lock, oldIrql);
+
+        if (failedRequestPtr == nullptr) {
+            break;
+        }
+
+        USDHC_LOG_ERROR_STATUS(
+            SdhcExtPtr->IfrLogHandle,
+            SdhcExtPtr,
+            status,
+            "Deferred CMD%d failed to issue",
+            failedRequestPtr->Command.Index);
+
+        NT_ASSERT(!NT_SUCCESS(status));
+        SdhcCompleteRequest(SdhcExtPtr, failedRequestPtr, status);
+    }
+}
+
+_Use_decl_annotations_
+VOID
+SdhcCqeQuiesce(
+    USDHC_EXTENSION* SdhcExtPtr,
+    BOOLEAN DisableCardQueuing
+    )
+{
+    USDHC_CQE_CONTEXT* cqePtr = &SdhcExtPtr->Cqe;
+    KIRQL oldIrql;
+
+    if (!cqePtr->IsSupported) {
+        return;
+    }
+
+    ASSERT_MAX_IRQL(APC_LEVEL);
+
+    KeAcquireSpinLock(&cqePtr->Lock, &oldIrql);
+
+    //
+    // The requests that come meanwhile are deferred as for a legacy
+    // command in progress, and the plugged task is released so the
+    // queue can drain
+    //
+    cqePtr->IsBusOperationPending = TRUE;
+    SdhcCqepRingPlugged(SdhcExtPtr);
+    KeClearEvent(&cqePtr->IdleEvent);
+    const BOOLEAN isIdle = (cqePtr->InFlightTagMask == 0) ? TRUE : FALSE;
+
+    KeReleaseSpinLock(&cqePtr->Lock, oldIrql);
+
+    if (!isIdle) {
+        LARGE_INTEGER timeout;
+        timeout.QuadPart = -10000LL * USDHC_CQE_IDLE_TIMEOUT_MS;
+        (VOID)KeWaitForSingleObject(
+            &cqePtr->IdleEvent,
+            Executive,
+            KernelMode,
+            FALSE,
+            &timeout);
+    }
+
+    KeAcquireSpinLock(&cqePtr->Lock, &oldIrql);
+
+    if (cqePtr->State == UsdhcCqeStateRunning) {
+        if (cqePtr->InFlightTagMask != 0) {
+            USDHC_LOG_ERROR(
+                SdhcExtPtr->IfrLogHandle,
+                SdhcExtPtr,
+                "Time-out waiting on tasks 0x%08X before a bus operation",
+                cqePtr->InFlightTagMask);
+            SdhcCqepRecover(SdhcExtPtr, STATUS_IO_TIMEOUT);
+        } else {
+            SdhcCqepStop(SdhcExtPtr);
+        }
+    }
+
+    if (DisableCardQueuing && cqePtr->IsCardCqEnabled) {
+        (VOID)SdhcCqepDisableCard(SdhcExtPtr);
+    }
+
+    KeReleaseSpinLock(&cqePtr->Lock, oldIrql);
+
+    //
+    // Only hand back the completed tasks, the deferred requests wait
+    // for SdhcCqeResume()
+    //
+    SdhcCqepCompleteTasks(SdhcExtPtr);
+}
+
+_Use_decl_annotations_
+VOID
+SdhcCqeResume(
+    USDHC_EXTENSION* SdhcExtPtr
+    )
+{
+    USDHC_CQE_CONTEXT* cqePtr = &SdhcExtPtr->Cqe;
+    KIRQL oldIrql;
+
+    if (!cqePtr->IsSupported) {
+        return;
+    }
+
+    KeAcquireSpinLock(&cqePtr->Lock, &oldIrql);
+    cqePtr->IsBusOperationPending = FALSE;
+    KeReleaseSpinLock(&cqePtr->Lock, oldIrql);
+
+    //
+    // Issue the requests deferred during the bus operation
+    //
+    SdhcCqeProcessQueue(SdhcExtPtr);
+}
+
+_Use_decl_annotations_
+BOOLEAN
+SdhcCqeToggleEvents(
+    USDHC_EXTENSION* SdhcExtPtr,
+    UINT32 InterruptMask,
+    BOOLEAN Enable
+    )
+{
+    USDHC_CQE_CONTEXT* cqePtr = &SdhcExtPtr->Cqe;
+    KIRQL oldIrql;
+
+    if (!cqePtr->IsSupported) {
+        return FALSE;
+    }
+
+    KeAcquireSpinLock(&cqePtr->Lock, &oldIrql);
+
+    //
+    // While the CQE runs, the Sdport interrupt enables are parked and
+    // only the card events stay live
+    //
+    BOOLEAN isParked = (cqePtr->State == UsdhcCqeStateRunning) ? TRUE : FALSE;
+    if (isParked) {
+        USDHC_INT_STATUS_REG cardEvents = { 0 };
+        cardEvents.CINS = 1;
+        cardEvents.CRM = 1;
+        cardEvents.CINT = 1;
+
+        if (Enable) {
+            cqePtr->SavedIntStatusEnable |= InterruptMask;
+            cqePtr->SavedIntSignalEnable |= InterruptMask;
+            SdhcEnableInterrupt(SdhcExtPtr, InterruptMask & cardEvents.AsUint32);
+        } else {
+            cqePtr->SavedIntStatusEnable &= ~InterruptMask;
+            cqePtr->SavedIntSignalEnable &= ~InterruptMask;
+            SdhcDisableInterrupt(SdhcExtPtr, InterruptMask & cardEvents.AsUint32);
+        }
+    }
+
+    KeReleaseSpinLock(&cqePtr->Lock, oldIrql);
+    return isParked;
+}
+
+_Use_decl_annotations_
+VOID
+SdhcCqeLogStatistics(
+    USDHC_EXTENSION* SdhcExtPtr
+    )
+{
+    const USDHC_CQE_STATISTICS* statisticsPtr = &SdhcExtPtr->Cqe.Statistics;
+
+    if (!SdhcExtPtr->Cqe.IsSupported) {
+        return;
+    }
+
+    USDHC_LOG_INFORMATION(
+        SdhcExtPtr->IfrLogHandle,
+        SdhcExtPtr,
+        "CQE Queued:%I64u Tasks:%I64u Completed:%I64u Merged:%I64u Deferred:%I64u "
+        "Errors:%I64u Depth:%lu MaxDepth:%lu AvgDepth:%I64u IOPS:%lu PeakIOPS:%lu",
+        statisticsPtr->RequestsQueued,
+        statisticsPtr->TasksIssued,
+        statisticsPtr->RequestsCompleted,
+        statisticsPtr->RequestsMerged,
+        statisticsPtr->RequestsDeferred,
+        statisticsPtr->TaskErrors,
+        statisticsPtr->QueueDepth,
+        statisticsPtr->MaxQueueDepth,
+        (statisticsPtr->TasksIssued != 0) ?
+            (statisticsPtr->QueueDepthTotal / statisticsPtr->TasksIssued) : 0,
+        statisticsPtr->Iops,
+        statisticsPtr->PeakIops);
+}
+
+//
+// Internal helpers, called with the CQE lock held unless noted
+//
+
+_Use_decl_annotations_
+static
+BOOLEAN
+SdhcCqepIsQueueable(
+    const SDPORT_REQUEST* RequestPtr
+    )
+{
+    const SDPORT_COMMAND* cmdPtr = &RequestPtr->Command;
+
+    if ((RequestPtr->Type != SdRequestTypeCommandWithTransfer) ||
+        (cmdPtr->Class != SdCommandClassStandard) ||
+        (cmdPtr->TransferMethod != SdTransferMethodSgDma) ||
+        (cmdPtr->BlockSize != USDHC_CQE_BLOCK_SIZE) ||
+        (cmdPtr->BlockCount == 0) ||
+        (cmdPtr->ScatterGatherList == nullptr)) {
+        return FALSE;
+    }
+
+    switch (cmdPtr->Index) {
+    case USDHC_MMC_CMD_READ_SINGLE_BLOCK:
+    case USDHC_MMC_CMD_READ_MULTIPLE_BLOCK:
+    case USDHC_MMC_CMD_WRITE_BLOCK:
+    case USDHC_MMC_CMD_WRITE_MULTIPLE_BLOCK:
+        return TRUE;
+
+    default:
+        return FALSE;
+    }
+}
+
+//
+// Sends a command on the legacy interface and polls it to completion,
+// reading Length bytes to BufferPtr for a single block read.
+// The controller interrupt is masked meanwhile, the CQE must be off or
+// halted.
+//
+_Use_decl_annotations_
+static
+NTSTATUS
+SdhcCqepSendPolledCommand(
+    USDHC_EXTENSION* SdhcExtPtr,
+    UINT32 Index,
+    UINT32 Argument,
+    BOOLEAN IsBusy,
+    UINT32* BufferPtr,
+    ULONG Length
+    )
+{
+    volatile USDHC_REGISTERS* registersPtr = SdhcExtPtr->RegistersPtr;
+    const UINT32 intStatusEnable = SdhcReadRegister(&registersPtr->INT_STATUS_EN);
+    const UINT32 intSignalEnable = SdhcReadRegister(&registersPtr->INT_SIGNAL_EN);
+    NTSTATUS status = STATUS_SUCCESS;
+    UINT32 retries;
+
+    USDHC_INT_STATUS_REG pollMask = { 0 };
+    pollMask.CC = 1;
+    pollMask.TC = 1;
+    pollMask.BRR = 1;
+
+    SdhcWriteRegister(&registersPtr->INT_SIGNAL_EN, 0);
+    SdhcWriteRegister(
+        &registersPtr->INT_STATUS_EN,
+        pollMask.AsUint32 | USDHC_INT_STATUS_CMD_ERROR | USDHC_INT_STATUS_DATA_ERROR);
+    SdhcWriteRegister(&registersPtr->INT_STATUS, pollMask.AsUint32 | USDHC_INT_STATUS_ERROR);
+
+    USDHC_PRES_STATE_REG presState = { SdhcReadRegister(&registersPtr->PRES_STATE) };
+    retries = USDHC_POLL_RETRY_COUNT;
+    while ((presState.CIHB || presState.CDIHB) && retries) {
+        SdPortWait(USDHC_POLL_WAIT_TIME_US);
+        presState.AsUint32 = SdhcReadRegister(&registersPtr->PRES_STATE);
+        --retries;
+    }
+
+    if (presState.CIHB || presState.CDIHB) {
+        status = STATUS_DEVICE_BUSY;
+    }
+
+    if (NT_SUCCESS(status)) {
+        USDHC_MIX_CTRL_REG mixCtrl = { SdhcReadRegister(&registersPtr->MIX_CTRL) };
+        mixCtrl.DMAEN = 0;
+        mixCtrl.BCEN = 0;
+        mixCtrl.MSBSEL = 0;
+        mixCtrl.AC12EN = 0;
+        mixCtrl.AC23EN = 0;
+        mixCtrl.DTDSEL = (Length != 0) ? 1 : 0;
+        SdhcWriteRegister(&registersPtr->MIX_CTRL, mixCtrl.AsUint32);
+
+        USDHC_CMD_XFR_TYP_REG cmdXfrTyp = { 0 };
+        cmdXfrTyp.CMDINX = Index;
+        cmdXfrTyp.RSPTYP = IsBusy ?
+            USDHC_CMD_XFR_TYP_RSPTYP_RSP_48_CHK_BSY : USDHC_CMD_XFR_TYP_RSPTYP_RSP_48;
+        cmdXfrTyp.CCCEN = 1;
+        cmdXfrTyp.CICEN = 1;
+        cmdXfrTyp.CMDTYP = USDHC_CMD_XFR_TYP_CMDTYP_NORMAL;
+
+        USDHC_WTMK_LVL_REG wtmkLvl = { SdhcReadRegister(&registersPtr->WTMK_LVL) };
+        if (Length != 0) {
+            NT_ASSERT((BufferPtr != nullptr) && ((Length % sizeof(UINT32)) == 0));
+
+            USDHC_BLK_ATT_REG blkAtt = { 0 };
+            blkAtt.BLKSIZE = Length;
+            blkAtt.BLKCNT = 1;
+            SdhcWriteRegister(&registersPtr->BLK_ATT, blkAtt.AsUint32);
+
+            wtmkLvl.RD_WML = USDHC_FIFO_MAX_WORD_COUNT / 2;
+            wtmkLvl.RD_BRST_LEN = 8;
+            SdhcWriteRegister(&registersPtr->WTMK_LVL, wtmkLvl.AsUint32);
+
+            cmdXfrTyp.DPSEL = 1;
+        }
+
+        SdhcWriteRegister(&registersPtr->CMD_ARG, Argument);
+        SdhcWriteRegister(&registersPtr->CMD_XFR_TYP, cmdXfrTyp.AsUint32);
+
+        UINT32* wordPtr = BufferPtr;
+        ULONG remainingWords = Length / sizeof(UINT32);
+        BOOLEAN isCommandDone = FALSE;
+        retries = USDHC_POLL_RETRY_COUNT;
+
+        for (;;) {
+            USDHC_INT_STATUS_REG intStatus = { SdhcReadRegister(&registersPtr->INT_STATUS) };
+
+            if (intStatus.AsUint32 & (USDHC_INT_STATUS_CMD_ERROR | USDHC_INT_STATUS_DATA_ERROR)) {
+                ULONG events;
+                ULONG errors = 0;
+                SdhcConvertIntStatusToStandardEvents(intStatus, &events, &errors);
+                status = SdhcConvertStandardErrorToStatus(errors);
+                break;
+            }
+
+            if (intStatus.CC) {
+                isCommandDone = TRUE;
+            }
+
+            if (intStatus.BRR && (remainingWords != 0)) {
+                ULONG wordCount = Min(remainingWords, ULONG(wtmkLvl.RD_WML));
+                SdhcReadDataPort(SdhcExtPtr, wordPtr, wordCount);
+                wordPtr += wordCount;
+                remainingWords -= wordCount;
+            }
+
+            SdhcAcknowledgeInterrupts(SdhcExtPtr, intStatus.AsUint32 & pollMask.AsUint32);
+
+            if (isCommandDone &&
+                ((Length == 0) || ((remainingWords == 0) && intStatus.TC))) {
+                break;
+            }
+
+            if (retries == 0) {
+                status = STATUS_IO_TIMEOUT;
+                break;
+            }
+
+            SdPortWait(USDHC_POLL_WAIT_TIME_US);
+            --retries;
+        }
+    }
+
+    //
+    // uSDHC does not fire TC on busy deassertion, wait for DAT0 release
+    // as the request DPC does
+    //
+    if (NT_SUCCESS(status) && IsBusy) {
+        presState.AsUint32 = SdhcReadRegister(&registersPtr->PRES_STATE);
+        retries = USDHC_POLL_RETRY_COUNT;
+        while (presState.DLA && retries) {
+            SdPortWait(USDHC_POLL_WAIT_TIME_US);
+            presState.AsUint32 = SdhcReadRegister(&registersPtr->PRES_STATE);
+            --retries;
+        }
+
+        if (presState.DLA) {
+            status = STATUS_IO_TIMEOUT;
+        }
+    }
+
+    if (NT_SUCCESS(status)) {
+        UINT32 cardStatus = SdhcReadRegister(&registersPtr->CMD_RSP0);
+        if (cardStatus & USDHC_MMC_R1_ERROR_MASK) {
+            USDHC_LOG_ERROR(
+                SdhcExtPtr->IfrLogHandle,
+                SdhcExtPtr,
+                "CMD%lu(0x%08X) card status error 0x%08X",
+                Index,
+                Argument,
+                cardStatus);
+            status = STATUS_IO_DEVICE_ERROR;
+        }
+    } else {
+        USDHC_LOG_ERROR_STATUS(
+            SdhcExtPtr->IfrLogHandle,
+            SdhcExtPtr,
+            status,
+            "CMD%lu(0x%08X) failed",
+            Index,
+            Argument);
+
+        //
+        // Reset the CMD and DAT lines
+        //
+        USDHC_SYS_CTRL_REG sysCtrlMask = { 0 };
+        sysCtrlMask.RSTC = 1;
+        sysCtrlMask.RSTD = 1;
+
+        USDHC_SYS_CTRL_REG sysCtrl = { SdhcReadRegister(&registersPtr->SYS_CTRL) };
+        SdhcWriteRegister(&registersPtr->SYS_CTRL, sysCtrl.AsUint32 | sysCtrlMask.AsUint32);
+
+        retries = USDHC_POLL_RETRY_COUNT;
+        do {
+            SdPortWait(USDHC_POLL_WAIT_TIME_US);
+            sysCtrl.AsUint32 = SdhcReadRegister(&registersPtr->SYS_CTRL);
+            --retries;
+        } while ((sysCtrl.AsUint32 & sysCtrlMask.AsUint32) && retries);
+    }
+
+    SdhcWriteRegister(&registersPtr->INT_STATUS, pollMask.AsUint32 | USDHC_INT_STATUS_ERROR);
+    SdhcWriteRegister(&registersPtr->INT_STATUS_EN, intStatusEnable);
+    SdhcWriteRegister(&registersPtr->INT_SIGNAL_EN, intSignalEnable);
+
+    return status;
+}
+
+//
+// Enables command queuing on the card if needed, then starts the CQE.
+// The queue must be empty.
+//
+_Use_decl_annotations_
+static
+NTSTATUS
+SdhcCqepStart(
+    USDHC_EXTENSION* SdhcExtPtr
+    )
+{
+    USDHC_CQE_CONTEXT* cqePtr = &SdhcExtPtr->Cqe;
+    volatile USDHC_REGISTERS* registersPtr = SdhcExtPtr->RegistersPtr;
+    NTSTATUS status;
+
+    NT_ASSERT(cqePtr->State == UsdhcCqeStateOff);
+    NT_ASSERT((cqePtr->InFlightTagMask == 0) && (cqePtr->PluggedTag == -1));
+
+    if (!cqePtr->IsCardCqEnabled) {
+        status = SdhcCqepSendPolledCommand(
+            SdhcExtPtr,
+            USDHC_MMC_CMD_SEND_EXT_CSD,
+            0,
+            FALSE,
+            cqePtr->ExtCsd,
+            sizeof(cqePtr->ExtCsd));
+        if (!NT_SUCCESS(status)) {
+            return status;
+        }
+
+        const UCHAR* extCsdPtr = reinterpret_cast<const UCHAR*>(cqePtr->ExtCsd);
+        if ((extCsdPtr[USDHC_MMC_EXT_CSD_CMDQ_SUPPORT] & 0x1) == 0) {
+            return STATUS_NOT_SUPPORTED;
+        }
+
+        //
+        // Devices supporting command queuing are all high capacity, so
+        // the block address argument of the Sdport requests is used as is
+        //
+        ULONG cardDepth =
+            (extCsdPtr[USDHC_MMC_EXT_CSD_CMDQ_DEPTH] & USDHC_MMC_EXT_CSD_CMDQ_DEPTH_MASK) + 1;
+        cqePtr->Depth = Min(cqePtr->HostDepth, cardDepth);
+        cqePtr->FreeTagMask = UsdhcCqeTagMask(cqePtr->Depth);
+
+        status = SdhcCqepSendPolledCommand(
+            SdhcExtPtr,
+            USDHC_MMC_CMD_SWITCH,
+            USDHC_MMC_SWITCH_WRITE_BYTE(USDHC_MMC_EXT_CSD_CMDQ_MODE_EN, 1),
+            TRUE,
+            nullptr,
+            0);
+        if (!NT_SUCCESS(status)) {
+            return status;
+        }
+
+        cqePtr->IsCardCqEnabled = TRUE;
+
+        USDHC_LOG_INFORMATION(
+            SdhcExtPtr->IfrLogHandle,
+            SdhcExtPtr,
+            "Card command queuing enabled, card depth %lu, queue depth %lu",
+            cardDepth,
+            cqePtr->Depth);
+    }
+
+    //
+    // The CQE gets stuck if it sees the buffer read enable set,
+    // which can be the case after tuning
+    //
+    USDHC_PRES_STATE_REG presState = { SdhcReadRegister(&registersPtr->PRES_STATE) };
+    UINT32 retries = USDHC_FIFO_MAX_WORD_COUNT;
+    while (presState.BREN && retries) {
+        (VOID)SdhcReadRegister(&registersPtr->DATA_BUFF_ACC_PORT);
+        presState.AsUint32 = SdhcReadRegister(&registersPtr->PRES_STATE);
+        --retries;
+    }
+
+    USDHC_MIX_CTRL_REG mixCtrl = { SdhcReadRegister(&registersPtr->MIX_CTRL) };
+    mixCtrl.DMAEN = 1;
+    mixCtrl.BCEN = 1;
+    mixCtrl.MSBSEL = 1;
+    mixCtrl.AC12EN = 0;
+    mixCtrl.AC23EN = 0;
+    SdhcWriteRegister(&registersPtr->MIX_CTRL, mixCtrl.AsUint32);
+
+    USDHC_BLK_ATT_REG blkAtt = { 0 };
+    blkAtt.BLKSIZE = USDHC_CQE_BLOCK_SIZE;
+    SdhcWriteRegister(&registersPtr->BLK_ATT, blkAtt.AsUint32);
+
+    SdhcWriteRegister(&registersPtr->CQCFG, 0);
+    SdhcWriteRegister(&registersPtr->CQTDLBA, cqePtr->TaskListAddress);
+    SdhcWriteRegister(&registersPtr->CQTDLBAU, 0);
+    SdhcWriteRegister(&registersPtr->CQSSC1, USDHC_CQSSC1_RESET_VALUE);
+    SdhcWriteRegister(&registersPtr->CQSSC2, cqePtr->CardRca);
+    SdhcWriteRegister(&registersPtr->CQIC, 0);
+    SdhcWriteRegister(&registersPtr->CQIS, USDHC_CQIS_ALL);
+    SdhcWriteRegister(&registersPtr->CQISTE, USDHC_CQIS_ALL);
+    SdhcWriteRegister(&registersPtr->CQISGE, USDHC_CQIS_ALL);
+    SdhcWriteRegister(&registersPtr->CQCTL, 0);
+
+    //
+    // Park the Sdport interrupt enables, only the CQE interrupt, the
+    // errors of its tasks and the card events are enabled while it runs
+    //
+    USDHC_INT_STATUS_REG cardEvents = { 0 };
+    cardEvents.CINS = 1;
+    cardEvents.CRM = 1;
+    cardEvents.CINT = 1;
+
+    cqePtr->SavedIntStatusEnable = SdhcReadRegister(&registersPtr->INT_STATUS_EN);
+    cqePtr->SavedIntSignalEnable = SdhcReadRegister(&registersPtr->INT_SIGNAL_EN);
+
+    const UINT32 cqeInterrupts = USDHC_INT_STATUS_CQI |
+        USDHC_INT_STATUS_CMD_ERROR |
+        USDHC_INT_STATUS_DATA_ERROR;
+    SdhcWriteRegister(
+        &registersPtr->INT_STATUS_EN,
+        (cqePtr->SavedIntStatusEnable & cardEvents.AsUint32) | cqeInterrupts);
+    SdhcWriteRegister(
+        &registersPtr->INT_SIGNAL_EN,
+        (cqePtr->SavedIntSignalEnable & cardEvents.AsUint32) | cqeInterrupts);
+    SdhcAcknowledgeInterrupts(SdhcExtPtr, cqeInterrupts);
+
+    USDHC_CQCFG_REG cqCfg = { 0 };
+    cqCfg.CQ_EN = 1;
+    SdhcWriteRegister(&registersPtr->CQCFG, cqCfg.AsUint32);
+
+    cqePtr->State = UsdhcCqeStateRunning;
+    if (cqePtr->Statistics.IopsWindowStart == 0) {
+        cqePtr->Statistics.IopsWindowStart = KeQueryInterruptTime();
+    }
+
+    return STATUS_SUCCESS;
+}
+
+_Use_decl_annotations_
+static
+NTSTATUS
+SdhcCqepHalt(
+    USDHC_EXTENSION* SdhcExtPtr
+    )
+{
+    volatile USDHC_REGISTERS* registersPtr = SdhcExtPtr->RegistersPtr;
+
+    USDHC_CQCTL_REG cqCtl = { SdhcReadRegister(&registersPtr->CQCTL) };
+    cqCtl.HALT = 1;
+    SdhcWriteRegister(&registersPtr->CQCTL, cqCtl.AsUint32);
+
+    UINT32 retries = USDHC_POLL_RETRY_COUNT;
+    cqCtl.AsUint32 = SdhcReadRegister(&registersPtr->CQCTL);
+    while (!cqCtl.HALT && retries) {
+        SdPortWait(USDHC_POLL_WAIT_TIME_US);
+        cqCtl.AsUint32 = SdhcReadRegister(&registersPtr->CQCTL);
+        --retries;
+    }
+
+    if (!cqCtl.HALT) {
+        USDHC_LOG_ERROR(
+            SdhcExtPtr->IfrLogHandle,
+            SdhcExtPtr,
+            "Time-out waiting on the CQE to halt");
+        return STATUS_IO_TIMEOUT;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+//
+// Turns the CQE off and hands the interrupt enables back to Sdport.
+// Command queuing stays enabled on the card.
+//
+_Use_decl_annotations_
+static
+VOID
+SdhcCqepStop(
+    USDHC_EXTENSION* SdhcExtPtr
+    )
+{
+    USDHC_CQE_CONTEXT* cqePtr = &SdhcExtPtr->Cqe;
+    volatile USDHC_REGISTERS* registersPtr = SdhcExtPtr->RegistersPtr;
+
+    NT_ASSERT(cqePtr->State == UsdhcCqeStateRunning);
+
+    (VOID)SdhcCqepHalt(SdhcExtPtr);
+    SdhcWriteRegister(&registersPtr->CQCFG, 0);
+    SdhcWriteRegister(&registersPtr->CQIS, USDHC_CQIS_ALL);
+
+    cqePtr->State = UsdhcCqeStateOff;
+
+    SdhcWriteRegister(&registersPtr->INT_STATUS_EN, cqePtr->SavedIntStatusEnable);
+    SdhcWriteRegister(&registersPtr->INT_SIGNAL_EN, cqePtr->SavedIntSignalEnable);
+    SdhcAcknowledgeInterrupts(SdhcExtPtr, USDHC_INT_STATUS_CQI);
+}
+
+_Use_decl_annotations_
+static
+NTSTATUS
+SdhcCqepDisableCard(
+    USDHC_EXTENSION* SdhcExtPtr
+    )
+{
+    USDHC_CQE_CONTEXT* cqePtr = &SdhcExtPtr->Cqe;
+
+    NT_ASSERT(cqePtr->State == UsdhcCqeStateOff);
+
+    NTSTATUS status = SdhcCqepSendPolledCommand(
+        SdhcExtPtr,
+        USDHC_MMC_CMD_SWITCH,
+        USDHC_MMC_SWITCH_WRITE_BYTE(USDHC_MMC_EXT_CSD_CMDQ_MODE_EN, 0),
+        TRUE,
+        nullptr,
+        0);
+    if (NT_SUCCESS(status)) {
+        cqePtr->IsCardCqEnabled = FALSE;
+    }
+
+    return status;
+}
+
+//
+// Clears all the tasks from the CQE and the card, fails the tasks that
+// did not complete with Status, and turns the CQE off.
+//
+_Use_decl_annotations_
+static
+VOID
+SdhcCqepRecover(
+    USDHC_EXTENSION* SdhcExtPtr,
+    NTSTATUS Status
+    )
+{
+    USDHC_CQE_CONTEXT* cqePtr = &SdhcExtPtr->Cqe;
+    volatile USDHC_REGISTERS* registersPtr = SdhcExtPtr->RegistersPtr;
+
+    (VOID)SdhcCqepHalt(SdhcExtPtr);
+
+    USDHC_CQCTL_REG cqCtl = { SdhcReadRegister(&registersPtr->CQCTL) };
+    cqCtl.CLEAR_ALL_TASKS = 1;
+    SdhcWriteRegister(&registersPtr->CQCTL, cqCtl.AsUint32);
+
+    UINT32 retries = USDHC_POLL_RETRY_COUNT;
+    while ((SdhcReadRegister(&registersPtr->CQTDBR) != 0) && retries) {
+        SdPortWait(USDHC_POLL_WAIT_TIME_US);
+        --retries;
+    }
+
+    //
+    // Tasks the CQE reported done before it halted still succeed
+    //
+    UINT32 completedTagMask = SdhcReadRegister(&registersPtr->CQTCN);
+    SdhcWriteRegister(&registersPtr->CQTCN, completedTagMask);
+    completedTagMask |= UINT32(InterlockedExchange(&cqePtr->CompletedTagMask, 0));
+    completedTagMask &= cqePtr->InFlightTagMask;
+
+    cqePtr->DoneTagMask |= completedTagMask;
+    cqePtr->FailedTagMask |= cqePtr->InFlightTagMask & ~completedTagMask;
+    cqePtr->FailedStatus = Status;
+    UsdhcCqeStatisticsTasksRetired(
+        &cqePtr->Statistics,
+        UsdhcCqeTagCount(cqePtr->InFlightTagMask));
+    cqePtr->InFlightTagMask = 0;
+
+    if (cqePtr->PluggedTag != -1) {
+        cqePtr->FailedTagMask |= 1UL << cqePtr->PluggedTag;
+        cqePtr->PluggedTag = -1;
+    }
+
+    //
+    // Discard whatever the card still has queued
+    //
+    (VOID)SdhcCqepSendPolledCommand(
+        SdhcExtPtr,
+        USDHC_MMC_CMD_CMDQ_TASK_MGMT,
+        USDHC_MMC_CMDQ_DISCARD_QUEUE,
+        TRUE,
+        nullptr,
+        0);
+
+    SdhcCqepStop(SdhcExtPtr);
+}
+
+_Use_decl_annotations_
+static
+VOID
+SdhcCqepRingTag(
+    USDHC_EXTENSION* SdhcExtPtr,
+    LONG Tag
+    )
+{
+    USDHC_CQE_CONTEXT* cqePtr = &SdhcExtPtr->Cqe;
+    const UINT32 tagBit = 1UL << Tag;
+
+    NT_ASSERT((cqePtr->InFlightTagMask & tagBit) == 0);
+
+    cqePtr->InFlightTagMask |= tagBit;
+    UsdhcCqeStatisticsTaskIssued(&cqePtr->Statistics);
+
+    //
+    // The descriptors are in non-cached memory, make sure they
+    // are written before the doorbell
+    //
+    KeMemoryBarrier();
+    SdhcWriteRegister(&SdhcExtPtr->RegistersPtr->CQTDBR, tagBit);
+}
+
+_Use_decl_annotations_
+static
+VOID
+SdhcCqepRingPlugged(
+    USDHC_EXTENSION* SdhcExtPtr
+    )
+{
+    USDHC_CQE_CONTEXT* cqePtr = &SdhcExtPtr->Cqe;
+
+    if (cqePtr->PluggedTag != -1) {
+        LONG tag = cqePtr->PluggedTag;
+        cqePtr->PluggedTag = -1;
+        SdhcCqepRingTag(SdhcExtPtr, tag);
+    }
+}
+
+_Use_decl_annotations_
+static
+BOOLEAN
+SdhcCqepCanMergeRequest(
+    USDHC_EXTENSION* SdhcExtPtr,
+    const SDPORT_REQUEST* RequestPtr
+    )
+{
+    const USDHC_CQE_CONTEXT* cqePtr = &SdhcExtPtr->Cqe;
+    const SDPORT_COMMAND* cmdPtr = &RequestPtr->Command;
+
+    if ((cqePtr->PluggedTag == -1) ||
+        (cmdPtr->Index == USDHC_MMC_CMD_READ_SINGLE_BLOCK) ||
+        (cmdPtr->Index == USDHC_MMC_CMD_READ_MULTIPLE_BLOCK)) {
+        return FALSE;
+    }
+
+    return UsdhcCqeCanMergeWrite(
+        &cqePtr->Tasks[cqePtr->PluggedTag].Extent,
+        cmdPtr->Argument,
+        cmdPtr->BlockCount,
+        UsdhcCqeAdmaEntryCount(cmdPtr->ScatterGatherList));
+}
+
+//
+// Builds the task of a queueable request, or merges it into the plugged
+// task, and rings it unless it is kept plugged for merging.
+// The CQE must be running, with a free tag or a plugged task the request
+// can be merged into.
+//
+_Use_decl_annotations_
+static
+NTSTATUS
+SdhcCqepQueueRequest(
+    USDHC_EXTENSION* SdhcExtPtr,
+    SDPORT_REQUEST* RequestPtr
+    )
+{
+    USDHC_CQE_CONTEXT* cqePtr = &SdhcExtPtr->Cqe;
+    SDPORT_COMMAND* cmdPtr = &RequestPtr->Command;
+    const SCATTER_GATHER_LIST* sgListPtr = cmdPtr->ScatterGatherList;
+    USDHC_CQE_TASK* taskPtr;
+    ULONG entryCount;
+
+    NT_ASSERT(cqePtr->State == UsdhcCqeStateRunning);
+
+    if (SdhcCqepCanMergeRequest(SdhcExtPtr, RequestPtr)) {
+        LONG tag = cqePtr->PluggedTag;
+        taskPtr = &cqePtr->Tasks[tag];
+
+        entryCount = UsdhcCqeAppendAdmaTable(
+            sgListPtr,
+            cqePtr->TransferTablesPtr + (tag * USDHC_CQE_ADMA_ENTRIES_PER_SLOT),
+            taskPtr->Extent.AdmaEntryCount,
+            USDHC_CQE_ADMA_ENTRIES_PER_SLOT);
+        if (entryCount != 0) {
+            taskPtr->Extent.AdmaEntryCount = entryCount;
+            taskPtr->Extent.BlockCount += cmdPtr->BlockCount;
+            taskPtr->RequestPtrs[taskPtr->Extent.RequestCount] = RequestPtr;
+            taskPtr->Extent.RequestCount += 1;
+
+            UsdhcCqeBuildTaskSlot(
+                &cqePtr->TaskListPtr[tag],
+                &taskPtr->Extent,
+                cqePtr->TransferTablesAddress + (tag * USDHC_CQE_TRANSFER_TABLE_SIZE));
+
+            cqePtr->Statistics.RequestsQueued += 1;
+            cqePtr->Statistics.RequestsMerged += 1;
+
+            if ((taskPtr->Extent.RequestCount == USDHC_CQE_MERGE_MAX_REQUESTS) ||
+                (taskPtr->Extent.BlockCount >= USDHC_CQE_MERGE_MAX_TASK_BLOCKS)) {
+                SdhcCqepRingPlugged(SdhcExtPtr);
+            }
+
+            return STATUS_PENDING;
+        }
+    }
+
+    //
+    // Tasks are not reordered, a new task releases the plugged one
+    //
+    SdhcCqepRingPlugged(SdhcExtPtr);
+
+    LONG tag = UsdhcCqeAllocateTag(&cqePtr->FreeTagMask);
+    NT_ASSERT(tag >= 0);
+    if (tag < 0) {
+        return STATUS_DEVICE_BUSY;
+    }
+
+    taskPtr = &cqePtr->Tasks[tag];
+    taskPtr->Extent.BlockAddress = cmdPtr->Argument;
+    taskPtr->Extent.BlockCount = cmdPtr->BlockCount;
+    taskPtr->Extent.RequestCount = 1;
+    taskPtr->Extent.IsRead =
+        ((cmdPtr->Index == USDHC_MMC_CMD_READ_SINGLE_BLOCK) ||
+         (cmdPtr->Index == USDHC_MMC_CMD_READ_MULTIPLE_BLOCK)) ? TRUE : FALSE;
+    taskPtr->RequestPtrs[0] = RequestPtr;
+
+    UINT32 transferTableAddress;
+    entryCount = UsdhcCqeAppendAdmaTable(
+        sgListPtr,
+        cqePtr->TransferTablesPtr + (tag * USDHC_CQE_ADMA_ENTRIES_PER_SLOT),
+        0,
+        USDHC_CQE_ADMA_ENTRIES_PER_SLOT);
+    if (entryCount != 0) {
+        transferTableAddress =
+            cqePtr->TransferTablesAddress + (tag * USDHC_CQE_TRANSFER_TABLE_SIZE);
+    } else {
+        //
+        // Too large for the slot, use the request's own descriptor
+        // table the way the legacy ADMA2 path does
+        //
+        entryCount = UsdhcCqeAppendAdmaTable(
+            sgListPtr,
+            static_cast<USDHC_ADMA2_DESCRIPTOR_TABLE_ENTRY*>(cmdPtr->DmaVirtualAddress),
+            0,
+            MAXULONG);
+        if (entryCount == 0) {
+            cqePtr->FreeTagMask |= 1UL << tag;
+            return STATUS_INVALID_PARAMETER;
+        }
+
+        NT_ASSERT(cmdPtr->DmaPhysicalAddress.HighPart == 0);
+        transferTableAddress = cmdPtr->DmaPhysicalAddress.LowPart;
+        entryCount = 0;
+    }
+
+    taskPtr->Extent.AdmaEntryCount = entryCount;
+    UsdhcCqeBuildTaskSlot(&cqePtr->TaskListPtr[tag], &taskPtr->Extent, transferTableAddress);
+    cqePtr->Statistics.RequestsQueued += 1;
+
+    //
+    // Hold a small write back while other tasks are in flight, so the
+    // writes adjacent to it can be merged until one of them completes
+    //
+    if (!taskPtr->Extent.IsRead &&
+        (taskPtr->Extent.AdmaEntryCount != 0) &&
+        (taskPtr->Extent.BlockCount <= USDHC_CQE_MERGE_MAX_REQUEST_BLOCKS) &&
+        (cqePtr->InFlightTagMask != 0)) {
+        cqePtr->PluggedTag = tag;
+    } else {
+        SdhcCqepRingTag(SdhcExtPtr, tag);
+    }
+
+    return STATUS_PENDING;
+}
+
+//
+// Sends a command on the legacy interface, turning the CQE off and
+// command queuing on the card off first when needed.
+// The queue must be empty.
+//
+_Use_decl_annotations_
+static
+NTSTATUS
+SdhcCqepIssueLegacy(
+    USDHC_EXTENSION* SdhcExtPtr,
+    SDPORT_REQUEST* RequestPtr
+    )
+{
+    USDHC_CQE_CONTEXT* cqePtr = &SdhcExtPtr->Cqe;
+    const SDPORT_COMMAND* cmdPtr = &RequestPtr->Command;
+    const BOOLEAN isStandard = (cmdPtr->Class == SdCommandClassStandard) ? TRUE : FALSE;
+    NTSTATUS status;
+
+    NT_ASSERT((cqePtr->InFlightTagMask == 0) && (cqePtr->PluggedTag == -1));
+
+    if (cqePtr->State == UsdhcCqeStateRunning) {
+        SdhcCqepStop(SdhcExtPtr);
+    }
+
+    //
+    // CMD13 is allowed with command queuing enabled, and CMD0
+    // resets it
+    //
+    if (cqePtr->IsCardCqEnabled &&
+        !(isStandard &&
+          ((cmdPtr->Index == USDHC_MMC_CMD_GO_IDLE_STATE) ||
+           (cmdPtr->Index == USDHC_MMC_CMD_SEND_STATUS)))) {
+        status = SdhcCqepDisableCard(SdhcExtPtr);
+        if (!NT_SUCCESS(status)) {
+            return status;
+        }
+    }
+
+    //
+    // Track the card from the Sdport requests
+    //
+    if (isStandard) {
+        switch (cmdPtr->Index) {
+        case USDHC_MMC_CMD_GO_IDLE_STATE:
+            cqePtr->IsCardMmc = FALSE;
+            cqePtr->IsCardUnsupported = FALSE;
+            cqePtr->IsCardCqEnabled = FALSE;
+            cqePtr->CardRca = 0;
+            break;
+
+        case USDHC_MMC_CMD_SELECT_CARD:
+            if ((cmdPtr->Argument >> 16) != 0) {
+                cqePtr->CardRca = UINT16(cmdPtr->Argument >> 16);
+            }
+            break;
+
+        case USDHC_MMC_CMD_SEND_EXT_CSD:
+            //
+            // SD CMD8 (SEND_IF_COND) has no data phase
+            //
+            if (cmdPtr->TransferType != SdTransferTypeNone) {
+                cqePtr->IsCardMmc = TRUE;
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    cqePtr->LegacyRequestPtr = RequestPtr;
+    cqePtr->IsLegacyDataPending = FALSE;
+
+    status = SdhcSendCommand(SdhcExtPtr, RequestPtr);
+    if (!NT_SUCCESS(status)) {
+        cqePtr->LegacyRequestPtr = nullptr;
+    }
+
+    return status;
+}
+
+//
+// Issues the request if the queue state allows it, returns FALSE if
+// the request has to wait.
+//
+_Use_decl_annotations_
+static
+BOOLEAN
+SdhcCqepTryIssue(
+    USDHC_EXTENSION* SdhcExtPtr,
+    SDPORT_REQUEST* RequestPtr,
+    NTSTATUS* StatusPtr
+    )
+{
+    USDHC_CQE_CONTEXT* cqePtr = &SdhcExtPtr->Cqe;
+
+    //
+    // Nothing is issued while a bus operation waits for the queue
+    // to drain
+    //
+    if (cqePtr->IsBusOperationPending) {
+        return FALSE;
+    }
+
+    if (SdhcCqepIsQueueable(RequestPtr) &&
+        cqePtr->IsCardMmc &&
+        (cqePtr->CardRca != 0) &&
+        !cqePtr->IsCardUnsupported) {
+
+        if (cqePtr->LegacyRequestPtr != nullptr) {
+            return FALSE;
+        }
+
+        if (cqePtr->State != UsdhcCqeStateRunning) {
+            NTSTATUS status = SdhcCqepStart(SdhcExtPtr);
+            if (!NT_SUCCESS(status)) {
+                USDHC_LOG_INFORMATION(
+                    SdhcExtPtr->IfrLogHandle,
+                    SdhcExtPtr,
+                    "Command queuing not available (%!STATUS!), using the legacy interface",
+                    status);
+                cqePtr->IsCardUnsupported = TRUE;
+            }
+        }
+
+        if (cqePtr->State == UsdhcCqeStateRunning) {
+            if ((cqePtr->FreeTagMask == 0) &&
+                !SdhcCqepCanMergeRequest(SdhcExtPtr, RequestPtr)) {
+                return FALSE;
+            }
+
+            *StatusPtr = SdhcCqepQueueRequest(SdhcExtPtr, RequestPtr);
+            return TRUE;
+        }
+    }
+
+    if ((cqePtr->LegacyRequestPtr != nullptr) || (cqePtr->InFlightTagMask != 0)) {
+        return FALSE;
+    }
+
+    if (cqePtr->PluggedTag != -1) {
+        SdhcCqepRingPlugged(SdhcExtPtr);
+        return FALSE;
+    }
+
+    *StatusPtr = SdhcCqepIssueLegacy(SdhcExtPtr, RequestPtr);
+    return TRUE;
+}
+
+_Use_decl_annotations_
+static
+BOOLEAN
+SdhcCqepTakeCompletion(
+    USDHC_EXTENSION* SdhcExtPtr,
+    SDPORT_REQUEST** RequestPtrs,
+    ULONG* RequestCountPtr,
+    NTSTATUS* StatusPtr
+    )
+{
+    USDHC_CQE_CONTEXT* cqePtr = &SdhcExtPtr->Cqe;
+    UINT32 tagMask = cqePtr->DoneTagMask | cqePtr->FailedTagMask;
+
+    LONG tag = UsdhcCqeAllocateTag(&tagMask);
+    if (tag < 0) {
+        return FALSE;
+    }
+
+    const UINT32 tagBit = 1UL << tag;
+    if (cqePtr->DoneTagMask & tagBit) {
+        *StatusPtr = STATUS_SUCCESS;
+    } else {
+        *StatusPtr = cqePtr->FailedStatus;
+        cqePtr->Statistics.TaskErrors += 1;
+    }
+
+    cqePtr->DoneTagMask &= ~tagBit;
+    cqePtr->FailedTagMask &= ~tagBit;
+
+    const USDHC_CQE_TASK* taskPtr = &cqePtr->Tasks[tag];
+    for (ULONG i = 0; i < taskPtr->Extent.RequestCount; ++i) {
+        RequestPtrs[i] = taskPtr->RequestPtrs[i];
+    }
+    *RequestCountPtr = taskPtr->Extent.RequestCount;
+
+    cqePtr->FreeTagMask |= tagBit;
+    UsdhcCqeStatisticsRequestsCompleted(
+        &cqePtr->Statistics,
+        taskPtr->Extent.RequestCount,
+        KeQueryInterruptTime());
+
+    return TRUE;
+}
+
+//
+// Completes the done and failed tasks, called without the CQE lock
+//
+_Use_decl_annotations_
+static
+VOID
+SdhcCqepCompleteTasks(
+    USDHC_EXTENSION* SdhcExtPtr
+    )
+{
+    USDHC_CQE_CONTEXT* cqePtr = &SdhcExtPtr->Cqe;
+    SDPORT_REQUEST* requestPtrs[USDHC_CQE_MERGE_MAX_REQUESTS];
+    ULONG requestCount;
+    NTSTATUS status;
+    KIRQL oldIrql;
+
+    for (;;) {
+        KeAcquireSpinLock(&cqePtr->Lock, &oldIrql);
+        BOOLEAN isCompleted =
+            SdhcCqepTakeCompletion(SdhcExtPtr, requestPtrs, &requestCount, &status);
+        KeReleaseSpinLock(&cqePtr->Lock, oldIrql);
+
+        if (!isCompleted) {
+            break;
+        }
+
+        for (ULONG i = 0; i < requestCount; ++i) {
+            requestPtrs[i]->RequiredEvents = 0;
+            SdhcCompleteRequest(SdhcExtPtr, requestPtrs[i], status);
+        }
+    }
+}
+
+NONPAGED_SEGMENT_END; //======================================================
@@ -0,0 +1,415 @@
+// Copyright 2023 NXP
+// Licensed under the MIT License.
+//
+// Module Name:
+//
+//   usdhccqe.hpp
+//
+// Abstract:
+//
+//  This module contains the eMMC command queuing (CQE) task descriptor and
+//  ADMA2 transfer table builder, the adjacent write merging policy and the
+//  queue statistics used by the uSDHC miniport.
+//
+//  The builder only depends on the types in usdhchw.h and on a scatter-gather
+//  list type providing NumberOfElements and Elements[].Address.QuadPart and
+//  Elements[].Length, so it can be driven with synthetic scatter-gather lists
+//  on any host. The includer provides UINT32, UINT64, ULONG, ULONG64, LONG
+//  and __forceinline.
+//
+// Environment:
+//
+//  Kernel mode only
+//
+
+#ifndef __USDHCCQE_HPP__
+#define __USDHCCQE_HPP__
+
+//
+// eMMC commands the miniport sends or snoops to manage command queuing
+//
+#define USDHC_MMC_CMD_GO_IDLE_STATE         0
+#define USDHC_MMC_CMD_SWITCH                6
+#define USDHC_MMC_CMD_SELECT_CARD           7
+#define USDHC_MMC_CMD_SEND_EXT_CSD          8
+#define USDHC_MMC_CMD_SEND_STATUS           13
+#define USDHC_MMC_CMD_READ_SINGLE_BLOCK     17
+#define USDHC_MMC_CMD_READ_MULTIPLE_BLOCK   18
+#define USDHC_MMC_CMD_WRITE_BLOCK           24
+#define USDHC_MMC_CMD_WRITE_MULTIPLE_BLOCK  25
+#define USDHC_MMC_CMD_CMDQ_TASK_MGMT        48
+
+//
+// CMD48 argument discarding all the tasks queued in the card
+//
+#define USDHC_MMC_CMDQ_DISCARD_QUEUE        0x1
+
+//
+// R1 card status error bits, including SWITCH_ERROR
+//
+#define USDHC_MMC_R1_ERROR_MASK             0xFDF98080
+
+//
+// EXT_CSD fields used for command queuing
+//
+#define USDHC_MMC_EXT_CSD_SIZE              512
+#define USDHC_MMC_EXT_CSD_CMDQ_MODE_EN      15
+#define USDHC_MMC_EXT_CSD_CMDQ_DEPTH        307
+#define USDHC_MMC_EXT_CSD_CMDQ_SUPPORT      308
+
+#define USDHC_MMC_EXT_CSD_CMDQ_DEPTH_MASK   0x1F
+
+//
+// CMD6 argument writing Value to the EXT_CSD byte at Index
+//
+#define USDHC_MMC_SWITCH_WRITE_BYTE(Index, Value) \
+    ((3UL << 24) | ((UINT32)(Index) << 16) | ((UINT32)(Value) << 8))
+
+//
+// The only block size the CQE transfers
+//
+#define USDHC_CQE_BLOCK_SIZE                512
+
+//
+// ADMA2 transfer descriptors reserved for each task slot. Tasks whose
+// scatter-gather list does not fit use the request's own descriptor table.
+//
+#define USDHC_CQE_ADMA_ENTRIES_PER_SLOT     64
+
+//
+// Adjacent write merging limits. Only writes up to
+// USDHC_CQE_MERGE_MAX_REQUEST_BLOCKS are merged, into tasks of at most
+// USDHC_CQE_MERGE_MAX_TASK_BLOCKS and USDHC_CQE_MERGE_MAX_REQUESTS requests.
+//
+#define USDHC_CQE_MERGE_MAX_REQUEST_BLOCKS  32
+#define USDHC_CQE_MERGE_MAX_TASK_BLOCKS     256
+#define USDHC_CQE_MERGE_MAX_REQUESTS        8
+
+//
+// The IOPS sampling window in 100ns units
+//
+#define USDHC_CQE_IOPS_WINDOW_100NS         10000000ULL
+
+//
+// The blocks and transfer descriptors of a task
+//
+typedef struct {
+    UINT32 BlockAddress;
+    ULONG BlockCount;
+    ULONG RequestCount;
+    ULONG AdmaEntryCount;
+    BOOLEAN IsRead;
+} USDHC_CQE_TASK_EXTENT;
+
+//
+// Command queue statistics
+//
+typedef struct {
+    //
+    // Requests taken by the CQE, tasks rung on the doorbell, and
+    // requests completed
+    //
+    ULONG64 RequestsQueued;
+    ULONG64 TasksIssued;
+    ULONG64 RequestsCompleted;
+
+    //
+    // Writes merged into the task of an earlier adjacent write
+    //
+    ULONG64 RequestsMerged;
+
+    //
+    // Requests that waited for the queue to drain or for a
+    // legacy command to complete
+    //
+    ULONG64 RequestsDeferred;
+
+    //
+    // Tasks failed by a CQE or bus error
+    //
+    ULONG64 TaskErrors;
+
+    //
+    // Tasks in flight, the most seen, and the sum of the depth
+    // sampled each time a task is issued
+    //
+    ULONG QueueDepth;
+    ULONG MaxQueueDepth;
+    ULONG64 QueueDepthTotal;
+
+    //
+    // Completions per second over the last window, and the highest
+    //
+    ULONG64 IopsWindowStart;
+    ULONG64 IopsWindowCompletions;
+    ULONG Iops;
+    ULONG PeakIops;
+} USDHC_CQE_STATISTICS;
+
+//
+// Returns the number of ADMA2 transfer descriptors needed to describe
+// the scatter-gather list.
+//
+template<class SG_LIST>
+__forceinline
+ULONG
+UsdhcCqeAdmaEntryCount(
+    _In_ const SG_LIST* SgListPtr
+    )
+{
+    ULONG entryCount = 0;
+
+    for (ULONG i = 0; i < SgListPtr->NumberOfElements; ++i) {
+        ULONG length = SgListPtr->Elements[i].Length;
+        entryCount += (length + SDHC_ADMA2_MAX_LENGTH_PER_ENTRY - 1) /
+            SDHC_ADMA2_MAX_LENGTH_PER_ENTRY;
+    }
+
+    return entryCount;
+}
+
+//
+// Appends the scatter-gather list to the ADMA2 transfer table that
+// already holds EntryCount descriptors, moving the End mark to the new
+// last descriptor.
+// Returns the new descriptor count, or 0 if the list does not fit in
+// Capacity descriptors, or has an address the 32-bit ADMA2 can't reach.
+// The table is left untouched on failure.
+//
+template<class SG_LIST>
+__forceinline
+ULONG
+UsdhcCqeAppendAdmaTable(
+    _In_ const SG_LIST* SgListPtr,
+    _Inout_updates_(Capacity) USDHC_ADMA2_DESCRIPTOR_TABLE_ENTRY* TablePtr,
+    _In_ ULONG EntryCount,
+    _In_ ULONG Capacity
+    )
+{
+    ULONG newEntryCount = UsdhcCqeAdmaEntryCount(SgListPtr);
+    if ((newEntryCount == 0) || (newEntryCount > (Capacity - EntryCount))) {
+        return 0;
+    }
+
+    for (ULONG i = 0; i < SgListPtr->NumberOfElements; ++i) {
+        UINT64 address = UINT64(SgListPtr->Elements[i].Address.QuadPart);
+        UINT64 length = SgListPtr->Elements[i].Length;
+
+        if (((address + length) > 0x100000000ULL) || ((address & 0x3) != 0)) {
+            return 0;
+        }
+    }
+
+    USDHC_ADMA2_DESCRIPTOR_TABLE_ENTRY* descriptorPtr = TablePtr + EntryCount;
+
+    for (ULONG i = 0; i < SgListPtr->NumberOfElements; ++i) {
+        UINT32 address = UINT32(SgListPtr->Elements[i].Address.QuadPart);
+        ULONG remainingLength = SgListPtr->Elements[i].Length;
+
+        while (remainingLength > 0) {
+            ULONG length = remainingLength;
+            if (length > SDHC_ADMA2_MAX_LENGTH_PER_ENTRY) {
+                length = SDHC_ADMA2_MAX_LENGTH_PER_ENTRY;
+            }
+
+            descriptorPtr->AsUint64 = 0;
+            descriptorPtr->Valid = 1;
+            descriptorPtr->Action = USDHC_ADMA2_ACTION_TRAN;
+            descriptorPtr->Length = length;
+            descriptorPtr->Address = address;
+
+            address += length;
+            remainingLength -= length;
+            ++descriptorPtr;
+        }
+    }
+
+    if (EntryCount != 0) {
+        TablePtr[EntryCount - 1].End = 0;
+    }
+    TablePtr[EntryCount + newEntryCount - 1].End = 1;
+
+    return EntryCount + newEntryCount;
+}
+
+//
+// Builds the task descriptor and the link to the task transfer
+// descriptors in a task descriptor list slot.
+//
+__forceinline
+VOID
+UsdhcCqeBuildTaskSlot(
+    _Out_ USDHC_CQE_TASK_SLOT* SlotPtr,
+    _In_ const USDHC_CQE_TASK_EXTENT* ExtentPtr,
+    _In_ UINT32 TransferTableAddress
+    )
+{
+    USDHC_CQE_TASK_DESCRIPTOR task;
+    task.AsUint64 = 0;
+    task.Valid = 1;
+    task.End = 1;
+    task.Int = 1;
+    task.Act = USDHC_CQE_TASK_DESCRIPTOR_ACT_TASK;
+    task.DataDirection = ExtentPtr->IsRead ?
+        USDHC_CQE_DATA_DIRECTION_READ : USDHC_CQE_DATA_DIRECTION_WRITE;
+    task.BlockCount = ExtentPtr->BlockCount;
+    task.BlockAddress = ExtentPtr->BlockAddress;
+
+    USDHC_ADMA2_DESCRIPTOR_TABLE_ENTRY link;
+    link.AsUint64 = 0;
+    link.Valid = 1;
+    link.Action = USDHC_ADMA2_ACTION_LINK;
+    link.Address = TransferTableAddress;
+
+    SlotPtr->Task = task;
+    SlotPtr->Link = link;
+}
+
+//
+// Returns the tag mask of a queue of Depth tasks
+//
+__forceinline
+UINT32
+UsdhcCqeTagMask(
+    _In_ ULONG Depth
+    )
+{
+    return (Depth >= USDHC_CQE_MAX_TASKS) ? 0xFFFFFFFFUL : ((1UL << Depth) - 1);
+}
+
+__forceinline
+ULONG
+UsdhcCqeTagCount(
+    _In_ UINT32 TagMask
+    )
+{
+    ULONG tagCount = 0;
+    while (TagMask != 0) {
+        TagMask &= TagMask - 1;
+        ++tagCount;
+    }
+
+    return tagCount;
+}
+
+//
+// Takes the lowest free task tag from the free tag mask.
+// Returns -1 if all tags are in use.
+//
+__forceinline
+LONG
+UsdhcCqeAllocateTag(
+    _Inout_ UINT32* FreeTagMaskPtr
+    )
+{
+    UINT32 freeTagMask = *FreeTagMaskPtr;
+    if (freeTagMask == 0) {
+        return -1;
+    }
+
+    LONG tag = 0;
+    while ((freeTagMask & (1UL << tag)) == 0) {
+        ++tag;
+    }
+
+    *FreeTagMaskPtr = freeTagMask & ~(1UL << tag);
+    return tag;
+}
+
+//
+// Returns TRUE if a write of BlockCount blocks at BlockAddress, needing
+// AdmaEntryCount transfer descriptors, can be appended to the task.
+//
+__forceinline
+BOOLEAN
+UsdhcCqeCanMergeWrite(
+    _In_ const USDHC_CQE_TASK_EXTENT* ExtentPtr,
+    _In_ UINT32 BlockAddress,
+    _In_ ULONG BlockCount,
+    _In_ ULONG AdmaEntryCount
+    )
+{
+    if (ExtentPtr->IsRead ||
+        (BlockCount > USDHC_CQE_MERGE_MAX_REQUEST_BLOCKS) ||
+        (ExtentPtr->RequestCount >= USDHC_CQE_MERGE_MAX_REQUESTS)) {
+        return FALSE;
+    }
+
+    //
+    // A task that uses the request's own descriptor table can't grow
+    //
+    if (ExtentPtr->AdmaEntryCount == 0) {
+        return FALSE;
+    }
+
+    if ((UINT64(ExtentPtr->BlockAddress) + ExtentPtr->BlockCount) != BlockAddress) {
+        return FALSE;
+    }
+
+    if ((ExtentPtr->BlockCount + BlockCount) > USDHC_CQE_MERGE_MAX_TASK_BLOCKS) {
+        return FALSE;
+    }
+
+    return (AdmaEntryCount <= (USDHC_CQE_ADMA_ENTRIES_PER_SLOT - ExtentPtr->AdmaEntryCount)) ?
+        TRUE : FALSE;
+}
+
+//
+// Statistics helpers
+//
+
+__forceinline
+VOID
+UsdhcCqeStatisticsTaskIssued(
+    _Inout_ USDHC_CQE_STATISTICS* StatisticsPtr
+    )
+{
+    StatisticsPtr->TasksIssued += 1;
+    StatisticsPtr->QueueDepth += 1;
+    StatisticsPtr->QueueDepthTotal += StatisticsPtr->QueueDepth;
+    if (StatisticsPtr->QueueDepth > StatisticsPtr->MaxQueueDepth) {
+        StatisticsPtr->MaxQueueDepth = StatisticsPtr->QueueDepth;
+    }
+}
+
+//
+// Accounts for TaskCount tasks leaving the CQE, completed or cleared
+//
+__forceinline
+VOID
+UsdhcCqeStatisticsTasksRetired(
+    _Inout_ USDHC_CQE_STATISTICS* StatisticsPtr,
+    _In_ ULONG TaskCount
+    )
+{
+    StatisticsPtr->QueueDepth -= TaskCount;
+}
+
+//
+// Accounts for RequestCount completed requests, Now is the current
+// time in 100ns units.
+//
+__forceinline
+VOID
+UsdhcCqeStatisticsRequestsCompleted(
+    _Inout_ USDHC_CQE_STATISTICS* StatisticsPtr,
+    _In_ ULONG RequestCount,
+    _In_ ULONG64 Now
+    )
+{
+    StatisticsPtr->RequestsCompleted += RequestCount;
+    StatisticsPtr->IopsWindowCompletions += RequestCount;
+
+    ULONG64 elapsed = Now - StatisticsPtr->IopsWindowStart;
+    if (elapsed >= USDHC_CQE_IOPS_WINDOW_100NS) {
+        StatisticsPtr->Iops = ULONG(
+            (StatisticsPtr->IopsWindowCompletions * USDHC_CQE_IOPS_WINDOW_100NS) / elapsed);
+        if (StatisticsPtr->Iops > StatisticsPtr->PeakIops) {
+            StatisticsPtr->PeakIops = StatisticsPtr->Iops;
+        }
+        StatisticsPtr->IopsWindowStart = Now;
+        StatisticsPtr->IopsWindowCompletions = 0;
+    }
+}
+
+#endif // __USDHCCQE_HPP__
@@ -59,6 +59,36 @@ typedef struct {
     UINT32 MMC_BOOT;
     UINT32 VEND_SPEC2;
     UINT32 TUNING_CTRL;
+    UINT32 _reserved3[12];
+
+    //
+    // Command Queuing Engine (CQHCI) registers, only implemented
+    // on uSDHC instances that have a CQE (CQVER reads 0 otherwise)
+    //
+    UINT32 CQVER;
+    UINT32 CQCAP;
+    UINT32 CQCFG;
+    UINT32 CQCTL;
+    UINT32 CQIS;
+    UINT32 CQISTE;
+    UINT32 CQISGE;
+    UINT32 CQIC;
+    UINT32 CQTDLBA;
+    UINT32 CQTDLBAU;
+    UINT32 CQTDBR;
+    UINT32 CQTCN;
+    UINT32 CQDQS;
+    UINT32 CQDPT;
+    UINT32 CQTCLR;
+    UINT32 _reserved4;
+    UINT32 CQSSC1;
+    UINT32 CQSSC2;
+    UINT32 CQCRDCT;
+    UINT32 _reserved5;
+    UINT32 CQRMEM;
+    UINT32 CQTERRI;
+    UINT32 CQCRI;
+    UINT32 CQCRA;
 } USDHC_REGISTERS;
 
 //
@@ -328,6 +358,11 @@ typedef union {
 typedef USDHC_INT_STATUS_REG USDHC_INT_STATUS_EN_REG;
 typedef USDHC_INT_STATUS_REG USDHC_INT_SIGNAL_EN_REG;
 
+//
+// On uSDHC instances with a CQE, bit 14 is the command queuing
+// interrupt (CQI) and signals a pending CQIS event
+//
+#define USDHC_INT_STATUS_CQI     0x00004000
 #define USDHC_INT_STATUS_CTOE    0x00010000
 #define USDHC_INT_STATUS_CCE     0x00020000
 #define USDHC_INT_STATUS_CEBE    0x00040000
@@ -419,6 +454,122 @@ typedef union {
 
 #define USDHC_VEND_SPEC2_RESET_VALUE     0x00000006
 
+//
+// Command Queuing Engine version uSDHCx_CQVER fields
+//
+typedef union {
+    UINT32 AsUint32;
+    struct {
+        UINT32 VERSION_SUFFIX   : 4; // 0:3
+        UINT32 MINOR_VERSION    : 4; // 4:7
+        UINT32 MAJOR_VERSION    : 4; // 8:11
+        UINT32 _reserved0       : 20; // 12:31
+    };
+} USDHC_CQVER_REG;
+
+//
+// Command Queuing Engine configuration uSDHCx_CQCFG fields
+//
+typedef union {
+    UINT32 AsUint32;
+    struct {
+        UINT32 CQ_EN            : 1; // 0
+        UINT32 _reserved0       : 7; // 1:7
+        UINT32 TASK_DESC_SIZE   : 1; // 8
+        UINT32 _reserved1       : 3; // 9:11
+        UINT32 DCMD_EN          : 1; // 12
+        UINT32 _reserved2       : 19; // 13:31
+    };
+} USDHC_CQCFG_REG;
+
+//
+// Command Queuing Engine control uSDHCx_CQCTL fields
+//
+typedef union {
+    UINT32 AsUint32;
+    struct {
+        UINT32 HALT             : 1; // 0
+        UINT32 _reserved0       : 7; // 1:7
+        UINT32 CLEAR_ALL_TASKS  : 1; // 8
+        UINT32 _reserved1       : 23; // 9:31
+    };
+} USDHC_CQCTL_REG;
+
+//
+// Command Queuing Engine interrupt status uSDHCx_CQIS fields, the same
+// layout is used by the CQISTE and CQISGE enable registers
+//
+typedef union {
+    UINT32 AsUint32;
+    struct {
+        UINT32 HAC              : 1; // 0
+        UINT32 TCC              : 1; // 1
+        UINT32 RED              : 1; // 2
+        UINT32 TCL              : 1; // 3
+        UINT32 _reserved0       : 28; // 4:31
+    };
+} USDHC_CQIS_REG;
+
+#define USDHC_CQIS_HAC    0x00000001
+#define USDHC_CQIS_TCC    0x00000002
+#define USDHC_CQIS_RED    0x00000004
+#define USDHC_CQIS_TCL    0x00000008
+#define USDHC_CQIS_ALL    (USDHC_CQIS_HAC | USDHC_CQIS_TCC | USDHC_CQIS_RED | USDHC_CQIS_TCL)
+
+//
+// Command Queuing Engine send status configuration uSDHCx_CQSSC1 fields
+//
+typedef union {
+    UINT32 AsUint32;
+    struct {
+        UINT32 CIT              : 16; // 0:15
+        UINT32 CBC              : 4; // 16:19
+        UINT32 _reserved0       : 12; // 20:31
+    };
+} USDHC_CQSSC1_REG;
+
+#define USDHC_CQSSC1_RESET_VALUE    0x00011000
+
+//
+// The CQE supports up to 32 tasks, one doorbell bit per task slot
+//
+#define USDHC_CQE_MAX_TASKS    32
+
+//
+// Layout of the CQE task descriptor, 64-bit mode (CQCFG.TASK_DESC_SIZE = 0)
+//
+typedef union {
+    UINT64 AsUint64;
+    struct {
+        UINT32 Valid            : 1; // 0
+        UINT32 End              : 1; // 1
+        UINT32 Int              : 1; // 2
+        UINT32 Act              : 3; // 3:5
+        UINT32 ForcedProg       : 1; // 6
+        UINT32 ContextId        : 4; // 7:10
+        UINT32 TagRequest       : 1; // 11
+        UINT32 DataDirection    : 1; // 12
+        UINT32 Priority         : 1; // 13
+        UINT32 Qbr              : 1; // 14
+        UINT32 ReliableWrite    : 1; // 15
+        UINT32 BlockCount       : 16; // 16:31
+        UINT32 BlockAddress;
+    };
+} USDHC_CQE_TASK_DESCRIPTOR;
+
+#define USDHC_CQE_TASK_DESCRIPTOR_ACT_TASK    0x5
+#define USDHC_CQE_DATA_DIRECTION_WRITE        0x0
+#define USDHC_CQE_DATA_DIRECTION_READ         0x1
+
+//
+// A task descriptor list slot, the task descriptor followed by
+// the ADMA2 link to the task transfer descriptors
+//
+typedef struct {
+    USDHC_CQE_TASK_DESCRIPTOR Task;
+    USDHC_ADMA2_DESCRIPTOR_TABLE_ENTRY Link;
+} USDHC_CQE_TASK_SLOT;
+
 //
 // Tuning Control
 //
@@ -466,6 +617,31 @@ typedef struct {
     UINT32 MMC_BOOT;
     UINT32 VEND_SPEC2;
     UINT32 TUNING_CTRL;
+    UINT32 _reserved3[12];
+    USDHC_CQVER_REG CQVER;
+    UINT32 CQCAP;
+    USDHC_CQCFG_REG CQCFG;
+    USDHC_CQCTL_REG CQCTL;
+    USDHC_CQIS_REG CQIS;
+    USDHC_CQIS_REG CQISTE;
+    USDHC_CQIS_REG CQISGE;
+    UINT32 CQIC;
+    UINT32 CQTDLBA;
+    UINT32 CQTDLBAU;
+    UINT32 CQTDBR;
+    UINT32 CQTCN;
+    UINT32 CQDQS;
+    UINT32 CQDPT;
+    UINT32 CQTCLR;
+    UINT32 _reserved4;
+    USDHC_CQSSC1_REG CQSSC1;
+    UINT32 CQSSC2;
+    UINT32 CQCRDCT;
+    UINT32 _reserved5;
+    UINT32 CQRMEM;
+    UINT32 CQTERRI;
+    UINT32 CQCRI;
+    UINT32 CQCRA;
 } USDHC_REGISTERS_DEBUG;
 
 #include <poppack.h> // pshpack1.h
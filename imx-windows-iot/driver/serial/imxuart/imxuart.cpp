@@ -412,6 +412,32 @@ IMXUartEvtInterruptIsr (
         }
     }
 
+    //
+    // The receive line went idle while a custom receive transaction is
+    // waiting for RX DMA bytes. Queue the DPC to hand the bytes out now,
+    // instead of waiting for the DMA notification or the progress timer.
+    //
+    if ((usr2Masked & IMX_UART_USR2_IDLE) != 0) {
+        WRITE_REGISTER_NOFENCE_ULONG(
+            &registersPtr->Usr2,
+            IMX_UART_USR2_IDLE);
+
+        if ((interruptContextPtr->RxDmaState ==
+             IMX_UART_STATE::WAITING_FOR_DPC) &&
+            (interruptContextPtr->RxDmaIdleState !=
+             IMX_UART_STATE::WAITING_FOR_DPC)) {
+
+            IMX_UART_LOG_TRACE("RX DMA: Idle line detected, queuing DPC.");
+
+            interruptContextPtr->RxDmaIdleTimestamp =
+                KeQueryPerformanceCounter(nullptr);
+
+            interruptContextPtr->RxDmaIdleState = IMX_UART_STATE::WAITING_FOR_DPC;
+
+            queueDpc = true;
+        }
+    }
+
     //
     // If FIFO empty request is pending and enabled, queue DPC
     //
@@ -541,6 +567,22 @@ IMXUartEvtInterruptDpc (
         SerCx2PioReceiveReady(interruptContextPtr->SerCx2PioReceive);
     }
 
+    if (interruptContextPtr->RxDmaIdleState ==
+        IMX_UART_STATE::WAITING_FOR_DPC) {
+
+        WdfInterruptAcquireLock(interruptContextPtr->WdfInterrupt);
+        const LARGE_INTEGER idleTimestamp =
+            interruptContextPtr->RxDmaIdleTimestamp;
+
+        interruptContextPtr->RxDmaIdleState = IMX_UART_STATE::COMPLETE;
+        WdfInterruptReleaseLock(interruptContextPtr->WdfInterrupt);
+
+        IMX_UART_LOG_TRACE("RX DMA: Flushing DMA buffer on idle line");
+        IMXUartRxDmaFlush(
+            interruptContextPtr->RxDmaTransactionContextPtr,
+            &idleTimestamp);
+    }
+
     //
     // If the TX buffer is below the threshold and TX notifications are
     // enabled, call SerCx2PioTransmitReady() to request more bytes
@@ -701,6 +743,11 @@ VOID IMXUartEvtSerCx2FileClose (WDFDEVICE WdfDevice)
     }
     IMXUartReleaseDmaRequestLineOwnership(interruptContextPtr);
 
+    if (interruptContextPtr->RxDmaTransactionContextPtr != nullptr) {
+        IMXUartRxDmaLogStatistics(
+            interruptContextPtr->RxDmaTransactionContextPtr);
+    }
+
     // In case Xon/Xoff is used at receiver side and XOFF was send,
     // unblock the device by sending XON prior to close.
     if (interruptContextPtr->CurrentFlowReplace & SERIAL_AUTO_RECEIVE) {
@@ -740,6 +787,7 @@ VOID IMXUartEvtSerCx2FileClose (WDFDEVICE WdfDevice)
 
     interruptContextPtr->RxState = IMX_UART_STATE::STOPPED;
     interruptContextPtr->RxDmaState = IMX_UART_STATE::STOPPED;
+    interruptContextPtr->RxDmaIdleState = IMX_UART_STATE::STOPPED;
     interruptContextPtr->RxHoldState = IMX_UART_STATE::STOPPED;
     interruptContextPtr->TxState = IMX_UART_STATE::STOPPED;
     interruptContextPtr->TxDrainState = IMX_UART_STATE::STOPPED;
@@ -1498,22 +1546,15 @@ IMXUartEvtSerCx2CustomReceiveTransactionStart (
 
     if (NT_SUCCESS(status)) {
         //
-        // Enable RX DMA and Aging DMA timer
+        // Enable RX DMA, Aging DMA timer and the idle line interrupt.
         //
-        // Even though we do not handle DMA receive transactions through
-        // ISR/DPC, but rather through the DMA completion routine, and
-        // DMA progress timer, we set the RxDma state to WAITING_FOR_DPC,
-        // to mark it as active.
+        // Received bytes are handed out from the DMA completion routine,
+        // the idle line DPC, and the DMA progress timer. We set the RxDma
+        // state to WAITING_FOR_DPC, to mark it as active, which also
+        // arms the idle line flush.
         //
-        IMX_UART_REGISTERS* registersPtr = interruptContextPtr->RegistersPtr;
-
         WdfInterruptAcquireLock(interruptContextPtr->WdfInterrupt);
-        interruptContextPtr->Ucr1Copy |=
-            (IMX_UART_UCR1_RXDMAEN | IMX_UART_UCR1_ATDMAEN);
-
-        WRITE_REGISTER_NOFENCE_ULONG(
-            &registersPtr->Ucr1,
-            interruptContextPtr->Ucr1Copy);
+        IMXUartEnableRxDmaRequests(interruptContextPtr, true);
 
         interruptContextPtr->RxDmaState = IMX_UART_STATE::WAITING_FOR_DPC;
         WdfInterruptReleaseLock(interruptContextPtr->WdfInterrupt);
@@ -1752,34 +1793,24 @@ IMXUartEvtWdfProgramRxDma (
     IMX_UART_INTERRUPT_CONTEXT* interruptContextPtr =
         rxDmaTransactionContextPtr->InterruptContextPtr;
 
-    IMX_UART_REGISTERS* registersPtr = interruptContextPtr->RegistersPtr;
-
     //
     // Keep the DMA transfer paused until enabled
     // through the custom receive transaction.
     //
-    // Disable RX DMA and Aging DMA timer
+    // Disable RX DMA, Aging DMA timer and the idle line interrupt
     //
 
     WdfInterruptAcquireLock(interruptContextPtr->WdfInterrupt);
     interruptContextPtr->RxDmaState = IMX_UART_STATE::IDLE;
-    interruptContextPtr->Ucr1Copy &=
-        ~(IMX_UART_UCR1_RXDMAEN | IMX_UART_UCR1_ATDMAEN);
-
-    WRITE_REGISTER_NOFENCE_ULONG(
-        &registersPtr->Ucr1,
-        interruptContextPtr->Ucr1Copy);
-
+    IMXUartEnableRxDmaRequests(interruptContextPtr, false);
     WdfInterruptReleaseLock(interruptContextPtr->WdfInterrupt);
 
     NT_ASSERT(rxDmaTransactionContextPtr->DmaBufferPtr != nullptr);
     NT_ASSERT(rxDmaTransactionContextPtr->DmaBufferSize != 0);
     NT_ASSERT(rxDmaTransactionContextPtr->DmaBufferMdlPtr != nullptr);
 
-    rxDmaTransactionContextPtr->DmaBufferReadPos = 0;
-    rxDmaTransactionContextPtr->DmaBufferPendingBytes = 0;
+    rxDmaTransactionContextPtr->DmaRing.Restart();
     rxDmaTransactionContextPtr->BytesTransferred = 0;
-    rxDmaTransactionContextPtr->LastDmaCounter = 0;
     return TRUE;
 }
 
@@ -1792,33 +1823,12 @@ IMXUartEvtTimerRxDmaProgress (
     IMX_UART_RX_DMA_TIMER_CONTEXT* rxDmaTimerContextPtr =
         IMXUartGetRxDmaTimerContext(WdfTimer);
 
-    IMX_UART_RX_DMA_TRANSACTION_CONTEXT* rxDmaTransactionContextPtr =
-        rxDmaTimerContextPtr->RxDmaTransactionPtr;
-
-    size_t bytesTransferred =
-        IMXUartRxDmaGetBytesTransferred(rxDmaTransactionContextPtr);
-
-    bool isRequestCompleted = IMXUartRxDmaCopyToUserBuffer(
-        rxDmaTransactionContextPtr,
-        bytesTransferred);
-
-    if (bytesTransferred != 0) {
-        IMX_UART_LOG_TRACE(
-            "RX DMA timer: Got %Iu bytes. %Iu out of %Iu transferred",
-            bytesTransferred,
-            rxDmaTransactionContextPtr->BytesTransferred,
-            rxDmaTransactionContextPtr->TransferLength);
-    }
-
-    if (isRequestCompleted) {
-        IMXUartCompleteCustomRxTransactionRequest(
-            rxDmaTransactionContextPtr,
-            STATUS_SUCCESS);
-
-        return;
-    }
-
-    IMXUartRxDmaStartProgressTimer(rxDmaTransactionContextPtr);
+    //
+    // Bursts are handed out by the idle line interrupt, the timer
+    // covers a stream that does not go idle before the request is
+    // satisfied.
+    //
+    IMXUartRxDmaFlush(rxDmaTimerContextPtr->RxDmaTransactionPtr, nullptr);
 }
 
 _Use_decl_annotations_
@@ -1849,6 +1859,10 @@ IMXUartEvtWdfRxDmaTransactionTransferComplete (
         size_t bytesTransferred =
             IMXUartRxDmaGetBytesTransferred(rxDmaTransactionContextPtr);
 
+        WdfSpinLockAcquire(rxDmaTransactionContextPtr->Lock);
+        rxDmaTransactionContextPtr->DmaRing.Statistics.DmaNotifications += 1;
+        WdfSpinLockRelease(rxDmaTransactionContextPtr->Lock);
+
         if (bytesTransferred != 0) {
             waitEvents |= SERIAL_EV_RXCHAR;
         }
@@ -1932,6 +1946,71 @@ IMXUartRxDmaStartProgressTimer (
         WDF_REL_TIMEOUT_IN_US(progressTimerUsec));
 }
 
+_Use_decl_annotations_
+VOID
+IMXUartRxDmaFlush (
+    IMX_UART_RX_DMA_TRANSACTION_CONTEXT* RxDmaTransactionContextPtr,
+    const LARGE_INTEGER* IdleTimestampPtr
+    )
+{
+    //
+    // Hand the bytes the DMA received so far to the caller buffer.
+    // IdleTimestampPtr is the time the idle line was detected when called
+    // from the DPC, nullptr when called from the progress timer.
+    //
+    size_t bytesTransferred =
+        IMXUartRxDmaGetBytesTransferred(RxDmaTransactionContextPtr);
+
+    bool isRequestCompleted = IMXUartRxDmaCopyToUserBuffer(
+        RxDmaTransactionContextPtr,
+        bytesTransferred);
+
+    if (bytesTransferred != 0) {
+        IMX_UART_LOG_TRACE(
+            "RX DMA flush: Got %Iu bytes. %Iu out of %Iu transferred",
+            bytesTransferred,
+            RxDmaTransactionContextPtr->BytesTransferred,
+            RxDmaTransactionContextPtr->TransferLength);
+    }
+
+    if (isRequestCompleted) {
+        IMXUartCompleteCustomRxTransactionRequest(
+            RxDmaTransactionContextPtr,
+            STATUS_SUCCESS);
+    }
+
+    ULONG64 latencyUsec = 0;
+    if (IdleTimestampPtr != nullptr) {
+        LARGE_INTEGER frequency;
+        LARGE_INTEGER now = KeQueryPerformanceCounter(&frequency);
+
+        latencyUsec = ULONG64(now.QuadPart - IdleTimestampPtr->QuadPart) *
+            1000000ULL / ULONG64(frequency.QuadPart);
+    }
+
+    WdfSpinLockAcquire(RxDmaTransactionContextPtr->Lock);
+    IMX_UART_DMA_RING* dmaRingPtr = &RxDmaTransactionContextPtr->DmaRing;
+    if (IdleTimestampPtr != nullptr) {
+        dmaRingPtr->Statistics.IdleFlushes += 1;
+        dmaRingPtr->RecordLatency(ULONG(min(latencyUsec, ULONG64(MAXULONG))));
+    } else {
+        dmaRingPtr->Statistics.TimerFlushes += 1;
+    }
+
+    //
+    // Do not re-arm the timer once the transaction has been cleaned up
+    // or canceled.
+    //
+    bool isRequestPending =
+        RxDmaTransactionContextPtr->WdfRequest != WDF_NO_HANDLE;
+
+    WdfSpinLockRelease(RxDmaTransactionContextPtr->Lock);
+
+    if (!isRequestCompleted && isRequestPending) {
+        IMXUartRxDmaStartProgressTimer(RxDmaTransactionContextPtr);
+    }
+}
+
 _Use_decl_annotations_
 ULONG
 IMXUartRxDmaGetBytesTransferred (
@@ -1940,25 +2019,18 @@ IMXUartRxDmaGetBytesTransferred (
 {
     WdfSpinLockAcquire(RxDmaTransactionContextPtr->Lock);
 
-    size_t dmaCounter = RxDmaTransactionContextPtr->DmaBufferSize -
-        IMXUartDmaReadCounter(RxDmaTransactionContextPtr->DmaAdapterPtr);
+    ULONG dmaPosition = static_cast<ULONG>(
+        RxDmaTransactionContextPtr->DmaBufferSize -
+        IMXUartDmaReadCounter(RxDmaTransactionContextPtr->DmaAdapterPtr));
 
-    size_t newBytes;
-    if (dmaCounter >= RxDmaTransactionContextPtr->LastDmaCounter) {
-        newBytes = dmaCounter - RxDmaTransactionContextPtr->LastDmaCounter;
-    } else {
-        newBytes = RxDmaTransactionContextPtr->DmaBufferSize -
-            RxDmaTransactionContextPtr->LastDmaCounter +
-            dmaCounter;
-    }
+    ULONG newBytes = RxDmaTransactionContextPtr->DmaRing.Update(dmaPosition);
 
-    RxDmaTransactionContextPtr->LastDmaCounter = dmaCounter;
     WdfSpinLockRelease(RxDmaTransactionContextPtr->Lock);
     InterlockedAdd(
         &RxDmaTransactionContextPtr->UnreportedBytes,
         LONG(newBytes));
 
-    return (ULONG)newBytes;
+    return newBytes;
 }
 
 _Use_decl_annotations_
@@ -1988,7 +2060,7 @@ IMXUartRxDmaCopyToUserBuffer (
         return true;
     }
 
-    RxDmaTransactionContextPtr->DmaBufferPendingBytes += NewBytesTransferred;
+    IMX_UART_DMA_RING* dmaRingPtr = &RxDmaTransactionContextPtr->DmaRing;
 
     //
     // Update comm events, if any...
@@ -2002,8 +2074,8 @@ IMXUartRxDmaCopyToUserBuffer (
     //
     // Check for DMA buffer (SW) overrun
     //
-    if (RxDmaTransactionContextPtr->DmaBufferPendingBytes >
-        RxDmaTransactionContextPtr->DmaBufferSize) {
+    if (dmaRingPtr->TakeOverrun()) {
+        IMX_UART_LOG_WARNING("RX DMA: DMA buffer overrun, received bytes were lost");
 
         waitEvents |= SERIAL_EV_ERR;
         commStatusInfo = SERIAL_ERROR_QUEUEOVERRUN;
@@ -2017,19 +2089,15 @@ IMXUartRxDmaCopyToUserBuffer (
     }
 
     if ((RxDmaTransactionContextPtr->BufferMdlPtr == nullptr) ||
-        (RxDmaTransactionContextPtr->DmaBufferPendingBytes == 0)) {
+        (dmaRingPtr->Count() == 0)) {
 
         WdfSpinLockRelease(RxDmaTransactionContextPtr->Lock);
         return false;
     }
 
     //
-    // DMA buffer runtime parameters
-    //
-    size_t dmaBufferPendingBytes = RxDmaTransactionContextPtr->DmaBufferPendingBytes;
-    size_t dmaBufferReadPos = RxDmaTransactionContextPtr->DmaBufferReadPos;
-    size_t dmaBufferSize = RxDmaTransactionContextPtr->DmaBufferSize;
-    const UCHAR* dmaBufferPtr = RxDmaTransactionContextPtr->DmaBufferPtr;
+    // Bytes are copied once, in place from the DMA buffer
+    // to the caller buffer.
     //
     // User buffer runtime parameters
     //
@@ -2041,7 +2109,7 @@ IMXUartRxDmaCopyToUserBuffer (
     size_t maxBytesToCopy = RxDmaTransactionContextPtr->TransferLength -
         RxDmaTransactionContextPtr->BytesTransferred;
 
-    size_t bytesToCopy = min(dmaBufferPendingBytes, maxBytesToCopy);
+    size_t bytesToCopy = min(size_t(dmaRingPtr->Count()), maxBytesToCopy);
     size_t bytesCopied = 0;
 
     while (bytesToCopy != 0) {
@@ -2053,29 +2121,29 @@ IMXUartRxDmaCopyToUserBuffer (
             }
             mdlAddr = reinterpret_cast<UCHAR*>(mdlPtr->MappedSystemVa);
             mdlOffset = 0;
+            continue;
         }
 
-        size_t dmaBufferBytes = dmaBufferSize - dmaBufferReadPos;
+        size_t dmaBufferBytes = dmaRingPtr->ContiguousCount();
         dmaBufferBytes = min(dmaBufferBytes, bytesToCopy);
 
         size_t iterBytes = min(mdlBytes, dmaBufferBytes);
 
         RtlCopyMemory(
             mdlAddr,
-            dmaBufferPtr + dmaBufferReadPos,
+            dmaRingPtr->ReadPointer(),
             iterBytes);
 
-        dmaBufferReadPos = (dmaBufferReadPos + iterBytes) % dmaBufferSize;
+        dmaRingPtr->Consume(static_cast<ULONG>(iterBytes));
+        mdlAddr += iterBytes;
         mdlOffset += iterBytes;
         bytesToCopy -= iterBytes;
         bytesCopied += iterBytes;
     }
 
-    RxDmaTransactionContextPtr->DmaBufferReadPos = dmaBufferReadPos;
     RxDmaTransactionContextPtr->BufferMdlPtr = mdlPtr;
     RxDmaTransactionContextPtr->BufferMdlOffset = mdlOffset;
     RxDmaTransactionContextPtr->BytesTransferred += bytesCopied;
-    RxDmaTransactionContextPtr->DmaBufferPendingBytes -= bytesCopied;
 
     bool isReqCompleted = RxDmaTransactionContextPtr->BytesTransferred ==
         RxDmaTransactionContextPtr->TransferLength;
@@ -2116,29 +2184,29 @@ IMXUartPioDequeueDmaBytes (
         return 0;
     }
 
-    size_t newBytesTransferred =
-        IMXUartRxDmaGetBytesTransferred(rxDmaTransactionContextPtr);
+    IMXUartRxDmaGetBytesTransferred(rxDmaTransactionContextPtr);
 
     WdfSpinLockAcquire(rxDmaTransactionContextPtr->Lock);
-    rxDmaTransactionContextPtr->DmaBufferPendingBytes += newBytesTransferred;
+    IMX_UART_DMA_RING* dmaRingPtr = &rxDmaTransactionContextPtr->DmaRing;
 
     IMX_UART_LOG_TRACE(
-        "RX DMA: retrieving residual %Iu DMA bytes",
-        rxDmaTransactionContextPtr->DmaBufferPendingBytes);
+        "RX DMA: retrieving residual %lu DMA bytes",
+        dmaRingPtr->Count());
+
+    if (dmaRingPtr->TakeOverrun()) {
+        IMX_UART_LOG_WARNING("RX DMA: DMA buffer overrun, received bytes were lost");
+        IMXUartNotifyEventsDuringDma(
+            rxDmaTransactionContextPtr,
+            SERIAL_EV_ERR,
+            SERIAL_ERROR_QUEUEOVERRUN);
+    }
 
-    if (rxDmaTransactionContextPtr->DmaBufferPendingBytes == 0) {
+    if (dmaRingPtr->Count() == 0) {
         //
         // Stop RX DMA
         //
-        IMX_UART_REGISTERS* registersPtr = interruptContextPtr->RegistersPtr;
-
         WdfInterruptAcquireLock(interruptContextPtr->WdfInterrupt);
-        interruptContextPtr->Ucr1Copy &=
-            ~(IMX_UART_UCR1_RXDMAEN | IMX_UART_UCR1_ATDMAEN);
-
-        WRITE_REGISTER_NOFENCE_ULONG(
-            &registersPtr->Ucr1,
-            interruptContextPtr->Ucr1Copy);
+        IMXUartEnableRxDmaRequests(interruptContextPtr, false);
 
         InterruptContextPtr->RxDmaState = IMX_UART_STATE::STOPPED;
         WdfInterruptReleaseLock(interruptContextPtr->WdfInterrupt);
@@ -2148,33 +2216,26 @@ IMXUartPioDequeueDmaBytes (
 
     NT_ASSERT(InterruptContextPtr->RxDmaState == IMX_UART_STATE::STOPPING);
 
-    size_t dmaBufferPendingBytes = rxDmaTransactionContextPtr->DmaBufferPendingBytes;
-    size_t dmaBufferReadPos = rxDmaTransactionContextPtr->DmaBufferReadPos;
-    size_t dmaBufferSize = rxDmaTransactionContextPtr->DmaBufferSize;
-    const UCHAR* dmaBufferPtr = rxDmaTransactionContextPtr->DmaBufferPtr;
-    size_t bytesToCopy = min(dmaBufferPendingBytes, Length);
-    size_t bytesCopied = 0;
+    ULONG bytesToCopy = min(dmaRingPtr->Count(), Length);
+    ULONG bytesCopied = 0;
 
     while (bytesToCopy != 0) {
-        size_t iterBytes = dmaBufferSize - dmaBufferReadPos;
-        iterBytes = min(iterBytes, bytesToCopy);
+        ULONG iterBytes = min(dmaRingPtr->ContiguousCount(), bytesToCopy);
 
         RtlCopyMemory(
             Buffer,
-            dmaBufferPtr + dmaBufferReadPos,
+            dmaRingPtr->ReadPointer(),
             iterBytes);
 
-        dmaBufferReadPos = (dmaBufferReadPos + iterBytes) % dmaBufferSize;
+        dmaRingPtr->Consume(iterBytes);
         bytesToCopy -= iterBytes;
         bytesCopied += iterBytes;
         Buffer += iterBytes;
     }
 
-    rxDmaTransactionContextPtr->DmaBufferReadPos = dmaBufferReadPos;
     rxDmaTransactionContextPtr->BytesTransferred += bytesCopied;
-    rxDmaTransactionContextPtr->DmaBufferPendingBytes -= bytesCopied;
     WdfSpinLockRelease(rxDmaTransactionContextPtr->Lock);
-    return (ULONG)bytesCopied;
+    return bytesCopied;
 }
 
 
@@ -4938,15 +4999,8 @@ IMXUartStopRxDma (
     // Stop RX DMA
     //
 
-    IMX_UART_REGISTERS* registersPtr = InterruptContextPtr->RegistersPtr;
-
     WdfInterruptAcquireLock(InterruptContextPtr->WdfInterrupt);
-    InterruptContextPtr->Ucr1Copy &=
-        ~(IMX_UART_UCR1_RXDMAEN | IMX_UART_UCR1_ATDMAEN);
-
-    WRITE_REGISTER_NOFENCE_ULONG(
-        &registersPtr->Ucr1,
-        InterruptContextPtr->Ucr1Copy);
+    IMXUartEnableRxDmaRequests(InterruptContextPtr, false);
 
     InterruptContextPtr->RxDmaState = IMX_UART_STATE::STOPPED;
     WdfInterruptReleaseLock(InterruptContextPtr->WdfInterrupt);
@@ -4984,11 +5038,91 @@ IMXUartStopRxDma (
             status);
     }
 
-    rxDmaTransactionContextPtr->DmaBufferPendingBytes = 0;
+    rxDmaTransactionContextPtr->DmaRing.Restart();
     WdfSpinLockRelease(rxDmaTransactionContextPtr->Lock);
     return status;
 }
 
+void
+IMXUartEnableRxDmaRequests (
+    IMX_UART_INTERRUPT_CONTEXT* InterruptContextPtr,
+    bool Enable
+    )
+{
+    IMX_UART_REGISTERS* registersPtr = InterruptContextPtr->RegistersPtr;
+
+    if (Enable) {
+        //
+        // The aging DMA request moves the bytes left below the RX FIFO
+        // watermark to the DMA buffer after 8 idle frames. The idle line
+        // interrupt is set to 16 idle frames, so the whole burst is in the
+        // DMA buffer by the time it fires.
+        //
+        WRITE_REGISTER_NOFENCE_ULONG(
+            &registersPtr->Usr2,
+            IMX_UART_USR2_IDLE);
+
+        InterruptContextPtr->Ucr1Copy &= ~IMX_UART_UCR1_ICD_MASK;
+        InterruptContextPtr->Ucr1Copy |=
+            (IMX_UART_UCR1_RXDMAEN |
+             IMX_UART_UCR1_ATDMAEN |
+             IMX_UART_UCR1_ICD_16 |
+             IMX_UART_UCR1_IDEN);
+
+        InterruptContextPtr->Usr2EnabledInterruptsMask |= IMX_UART_USR2_IDLE;
+    } else {
+        InterruptContextPtr->Ucr1Copy &=
+            ~(IMX_UART_UCR1_RXDMAEN |
+              IMX_UART_UCR1_ATDMAEN |
+              IMX_UART_UCR1_IDEN);
+
+        InterruptContextPtr->Usr2EnabledInterruptsMask &= ~IMX_UART_USR2_IDLE;
+        InterruptContextPtr->RxDmaIdleState = IMX_UART_STATE::STOPPED;
+    }
+
+    WRITE_REGISTER_NOFENCE_ULONG(
+        &registersPtr->Ucr1,
+        InterruptContextPtr->Ucr1Copy);
+}
+
+_Use_decl_annotations_
+VOID
+IMXUartRxDmaLogStatistics (
+    IMX_UART_RX_DMA_TRANSACTION_CONTEXT* RxDmaTransactionContextPtr
+    )
+{
+    //
+    // Statistics are kept per open handle, log and reset them.
+    //
+    WdfSpinLockAcquire(RxDmaTransactionContextPtr->Lock);
+    const IMX_UART_DMA_RING_STATISTICS statistics =
+        RxDmaTransactionContextPtr->DmaRing.Statistics;
+
+    RxDmaTransactionContextPtr->DmaRing.ResetStatistics();
+    WdfSpinLockRelease(RxDmaTransactionContextPtr->Lock);
+
+    ULONG64 averageLatencyUsec = 0;
+    if (statistics.LatencySamples != 0) {
+        averageLatencyUsec =
+            statistics.LatencyTotalUsec / statistics.LatencySamples;
+    }
+
+    IMX_UART_LOG_INFORMATION(
+        "RX DMA statistics: received %I64u, delivered %I64u, "
+        "overruns %I64u (%I64u bytes dropped), idle flushes %I64u, "
+        "DMA notifications %I64u, timer flushes %I64u, "
+        "idle flush latency average %I64u us, max %lu us",
+        statistics.BytesReceived,
+        statistics.BytesDelivered,
+        statistics.Overruns,
+        statistics.BytesDropped,
+        statistics.IdleFlushes,
+        statistics.DmaNotifications,
+        statistics.TimerFlushes,
+        averageLatencyUsec,
+        statistics.LatencyMaxUsec);
+}
+
 _Use_decl_annotations_
 NTSTATUS
 IMXUartAcquireDmaRequestLineOwnership (
@@ -6616,6 +6750,10 @@ IMXUartInitializeDma (
         }
         MmBuildMdlForNonPagedPool(dmaTransactionContextPtr->DmaBufferMdlPtr);
 
+        dmaTransactionContextPtr->DmaRing.SetBuffer(
+            dmaTransactionContextPtr->DmaBufferPtr,
+            static_cast<ULONG>(dmaTransactionContextPtr->DmaBufferSize));
+
         WdfDmaTransactionSetChannelConfigurationCallback(
             wdfDmaTransaction,
             IMXUartEvtWdfRxDmaTransactionConfigureDmaChannel,
@@ -6627,8 +6765,9 @@ IMXUartInitializeDma (
             dmaTransactionContextPtr);
 
         //
-        // Since we are using a cyclic buffer we will need to
-        // poll the transfer to figure out the transfer progress
+        // Bursts are flushed from the cyclic buffer by the idle line
+        // interrupt, the progress timer picks up the bytes of a stream
+        // that does not go idle.
         //
 
         WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(
@@ -15,6 +15,7 @@
 #define _IMX_UART_H_
 
 #include "imx_acpi_utils.h"
+#include "imxuartdmaring.h"
 
 //
 // Macros to be used for proper PAGED/NON-PAGED code placement
@@ -293,6 +294,12 @@ struct IMX_UART_INTERRUPT_CONTEXT {
     IMX_UART_TX_DMA_TRANSACTION_CONTEXT* TxDmaTransactionContextPtr;
     bool IsRxDmaStarted;
 
+    //
+    // RX DMA idle line flush, and the time the idle line was detected
+    //
+    IMX_UART_STATE RxDmaIdleState;
+    LARGE_INTEGER RxDmaIdleTimestamp;
+
     //
     // Handflow 1:1 copy
     //
@@ -363,14 +370,13 @@ struct IMX_UART_RX_DMA_TRANSACTION_CONTEXT
     SERCX2CUSTOMRECEIVETRANSACTION SerCx2CustomRxTransaction;
 
     //
-    // DMA RX buffer information
+    // DMA RX buffer information. The DMA runs over the buffer in a loop,
+    // DmaRing tracks the received bytes that were not handed out yet.
     //
     UCHAR* DmaBufferPtr;
     size_t DmaBufferSize;
     PMDL DmaBufferMdlPtr;
-    size_t DmaBufferReadPos;
-    size_t DmaBufferPendingBytes;
-    size_t LastDmaCounter;
+    IMX_UART_DMA_RING DmaRing;
 
     //
     // Caller request buffer parameters
@@ -629,6 +635,28 @@ IMXUartRxDmaCopyToUserBuffer (
     size_t NewBytesTransferred
     );
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+IMXUartRxDmaFlush (
+    IMX_UART_RX_DMA_TRANSACTION_CONTEXT* RxDmaTransactionContextPtr,
+    const LARGE_INTEGER* IdleTimestampPtr
+    );
+
+//
+// Must be called with the interrupt lock held
+//
+void
+IMXUartEnableRxDmaRequests (
+    IMX_UART_INTERRUPT_CONTEXT* InterruptContextPtr,
+    bool Enable
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+IMXUartRxDmaLogStatistics (
+    IMX_UART_RX_DMA_TRANSACTION_CONTEXT* RxDmaTransactionContextPtr
+    );
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 ULONG
 IMXUartPioDequeueDmaBytes (
@@ -0,0 +1,182 @@
+// Copyright 2023 NXP
+// Licensed under the MIT License.
+//
+//
+// Module Name:
+//
+//   imxuartdmaring.h
+//
+// Abstract:
+//
+//   Receive side of the circular RX DMA buffer.
+//
+//   SDMA writes the received bytes into the buffer in an endless loop, the
+//   driver only samples the DMA position (DMA counter) from the idle line
+//   interrupt, the DMA notification and the progress timer. The ring turns
+//   these samples into a count of pending bytes and hands them out in
+//   place, straight from the DMA buffer to the caller buffer.
+//
+//   The ring does not depend on WDF or on the hardware, the includer provides
+//   ULONG, ULONG64, UCHAR and FORCEINLINE, so the state machine can be built
+//   and driven with a simulated DMA cursor on any host.
+//
+#ifndef _IMX_UART_DMA_RING_H_
+#define _IMX_UART_DMA_RING_H_
+
+struct IMX_UART_DMA_RING_STATISTICS {
+    //
+    // Bytes written by the DMA, and handed out to the caller
+    //
+    ULONG64 BytesReceived;
+    ULONG64 BytesDelivered;
+
+    //
+    // Number of times the DMA caught up with the reader, and the
+    // bytes overwritten before they were handed out.
+    //
+    ULONG64 Overruns;
+    ULONG64 BytesDropped;
+
+    //
+    // What made the driver sample the DMA position
+    //
+    ULONG64 IdleFlushes;
+    ULONG64 DmaNotifications;
+    ULONG64 TimerFlushes;
+
+    //
+    // Idle line detection to request update latency
+    //
+    ULONG64 LatencySamples;
+    ULONG64 LatencyTotalUsec;
+    ULONG LatencyMaxUsec;
+};
+
+struct IMX_UART_DMA_RING {
+    _Field_size_(Size) UCHAR* BufferPtr;
+    ULONG Size;                         // size of the DMA buffer
+    ULONG ReadPos;                      // next byte to hand out
+    ULONG DmaPos;                       // DMA position at the last update
+    ULONG PendingBytes;                 // bytes received, not handed out yet
+    bool IsOverrun;                     // overrun not reported yet
+
+    IMX_UART_DMA_RING_STATISTICS Statistics;
+
+    FORCEINLINE void SetBuffer (_In_reads_(InBufferSize) UCHAR* InBufferPtr, ULONG InBufferSize)
+    {
+        this->BufferPtr = InBufferPtr;
+        this->Size = InBufferSize;
+        this->Restart();
+        this->ResetStatistics();
+    }
+
+    //
+    // Called when the DMA (re)starts at the beginning of the buffer.
+    //
+    FORCEINLINE void Restart ()
+    {
+        this->ReadPos = 0;
+        this->DmaPos = 0;
+        this->PendingBytes = 0;
+        this->IsOverrun = false;
+    }
+
+    FORCEINLINE void ResetStatistics ()
+    {
+        this->Statistics = IMX_UART_DMA_RING_STATISTICS();
+    }
+
+    //
+    // Accounts for the bytes the DMA wrote since the last update.
+    // DmaPosition is the offset of the next byte the DMA writes.
+    // The DMA must be sampled at least once per buffer lap, which the
+    // DMA notification threshold guarantees, a full lap between two
+    // samples cannot be told from no progress.
+    // If the DMA overwrote bytes that were not handed out, the oldest
+    // bytes are dropped and the ring is left full, with the read position
+    // at the DMA position.
+    //
+    FORCEINLINE ULONG Update (ULONG DmaPosition)
+    {
+        if (DmaPosition >= this->Size) {
+            DmaPosition -= this->Size;
+        }
+
+        ULONG newBytes;
+        if (DmaPosition >= this->DmaPos) {
+            newBytes = DmaPosition - this->DmaPos;
+        } else {
+            newBytes = this->Size - this->DmaPos + DmaPosition;
+        }
+
+        this->DmaPos = DmaPosition;
+        this->Statistics.BytesReceived += newBytes;
+
+        if (newBytes > (this->Size - this->PendingBytes)) {
+            ULONG bytesDropped = newBytes - (this->Size - this->PendingBytes);
+
+            this->ReadPos = DmaPosition;
+            this->PendingBytes = this->Size;
+            this->IsOverrun = true;
+            this->Statistics.Overruns += 1;
+            this->Statistics.BytesDropped += bytesDropped;
+        } else {
+            this->PendingBytes += newBytes;
+        }
+
+        return newBytes;
+    }
+
+    //
+    // Returns true once for each overrun the caller has not seen yet.
+    //
+    FORCEINLINE bool TakeOverrun ()
+    {
+        bool isOverrun = this->IsOverrun;
+        this->IsOverrun = false;
+        return isOverrun;
+    }
+
+    FORCEINLINE ULONG Count () const
+    {
+        return this->PendingBytes;
+    }
+
+    //
+    // Pending bytes that can be read in place from ReadPointer(),
+    // up to the end of the buffer.
+    //
+    FORCEINLINE ULONG ContiguousCount () const
+    {
+        ULONG toEnd = this->Size - this->ReadPos;
+        return (this->PendingBytes < toEnd) ? this->PendingBytes : toEnd;
+    }
+
+    FORCEINLINE const UCHAR* ReadPointer () const
+    {
+        return this->BufferPtr + this->ReadPos;
+    }
+
+    FORCEINLINE void Consume (ULONG ByteCount)
+    {
+        ULONG readPos = this->ReadPos + ByteCount;
+        if (readPos >= this->Size) {
+            readPos -= this->Size;
+        }
+
+        this->ReadPos = readPos;
+        this->PendingBytes -= ByteCount;
+        this->Statistics.BytesDelivered += ByteCount;
+    }
+
+    FORCEINLINE void RecordLatency (ULONG LatencyUsec)
+    {
+        this->Statistics.LatencySamples += 1;
+        this->Statistics.LatencyTotalUsec += LatencyUsec;
+        if (LatencyUsec > this->Statistics.LatencyMaxUsec) {
+            this->Statistics.LatencyMaxUsec = LatencyUsec;
+        }
+    }
+};
+
+#endif // !_IMX_UART_DMA_RING_H_
@@ -0,0 +1,382 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host unit test of the RX DMA ring (imxuartdmaring.h)
+//
+// A simulated SDMA channel writes a numbered byte stream into the buffer in
+// an endless loop and the ring is updated with its position, as from the
+// idle line interrupt, the DMA notification and the progress timer. The
+// bytes handed out are compared with a model that keeps the last bytes
+// written, the ring must hand out exactly the newest ones, in order, and
+// report each overrun once. Covers the buffer wrap, the DMA position at the
+// end of the buffer, a full ring, overruns of a few bytes and of almost a
+// lap, the restart of the DMA and random DMA progress and reads.
+//
+
+#include <stdint.h>
+
+typedef unsigned char UCHAR;
+typedef uint32_t ULONG;
+typedef uint64_t ULONG64;
+
+#define FORCEINLINE inline
+#define _Field_size_(Size)
+#define _In_reads_(Size)
+
+#include "imxuartdmaring.h"
+#include "HostTest.h"
+
+#include <vector>
+
+#define RANDOM_STEPS 200000
+
+//
+// DMA channel writing byte N of the stream at offset N % Size
+//
+struct DmaModel
+{
+    std::vector<UCHAR> Buffer;
+    ULONG64 Written;                    // bytes of the stream written
+    ULONG Position;                     // next offset written
+
+    static UCHAR Pattern (ULONG64 Index)
+    {
+        // Not periodic in 256, so a dropped lap of any size shows up.
+        return UCHAR((Index * 2654435761ULL) >> 13);
+    }
+
+    void Init (ULONG Size)
+    {
+        Buffer.assign(Size, 0xCD);
+        Written = 0;
+        Position = 0;
+    }
+
+    void Write (ULONG ByteCount)
+    {
+        for (ULONG i = 0; i < ByteCount; i++) {
+            Buffer[Position] = Pattern(Written);
+            Written += 1;
+            Position = (Position + 1) % ULONG(Buffer.size());
+        }
+    }
+
+    void Restart ()
+    {
+        Position = 0;
+    }
+};
+
+//
+// What the ring should hold: the last Pending bytes of the stream
+//
+struct RingModel
+{
+    ULONG Size;
+    ULONG Pending;
+    bool IsOverrun;
+    ULONG64 Received;
+    ULONG64 Delivered;
+    ULONG64 Overruns;
+    ULONG64 Dropped;
+
+    void Init (ULONG InSize)
+    {
+        *this = RingModel();
+        Size = InSize;
+    }
+
+    void Update (ULONG NewBytes)
+    {
+        Received += NewBytes;
+        Pending += NewBytes;
+        if (Pending > Size) {
+            Dropped += Pending - Size;
+            Overruns += 1;
+            Pending = Size;
+            IsOverrun = true;
+        }
+    }
+};
+
+static DmaModel g_Dma;
+static RingModel g_Model;
+static IMX_UART_DMA_RING g_Ring;
+
+static unsigned g_Seed = 1;
+
+static unsigned
+Random (
+    unsigned Range
+    )
+{
+    g_Seed = g_Seed * 1103515245 + 12345;
+    return (g_Seed >> 8) % Range;
+}
+
+static void
+Init (
+    ULONG Size
+    )
+{
+    g_Dma.Init(Size);
+    g_Model.Init(Size);
+    g_Ring.SetBuffer(g_Dma.Buffer.data(), Size);
+}
+
+static bool
+StatisticsMatch ()
+{
+    const IMX_UART_DMA_RING_STATISTICS& statistics = g_Ring.Statistics;
+
+    return (statistics.BytesReceived == g_Model.Received) &&
+           (statistics.BytesDelivered == g_Model.Delivered) &&
+           (statistics.Overruns == g_Model.Overruns) &&
+           (statistics.BytesDropped == g_Model.Dropped);
+}
+
+//
+// DMA progress of ByteCount bytes (less than a lap), then an update with
+// the DMA position, optionally reported as Size instead of 0.
+//
+static void
+Receive (
+    ULONG ByteCount,
+    bool EndAsSize = false
+    )
+{
+    g_Dma.Write(ByteCount);
+    ULONG position = g_Dma.Position;
+    if (EndAsSize && (position == 0)) {
+        position = g_Model.Size;
+    }
+
+    CHECK(g_Ring.Update(position) == ByteCount);
+    g_Model.Update(ByteCount);
+    CHECK(g_Ring.Count() == g_Model.Pending);
+    CHECK(g_Ring.DmaPos == g_Dma.Position);
+}
+
+//
+// Reads up to ByteCount bytes in place, the way the read path copies them
+// to the caller buffer, and checks them against the stream.
+//
+static ULONG
+Deliver (
+    ULONG ByteCount
+    )
+{
+    ULONG64 first = g_Dma.Written - g_Model.Pending;
+    ULONG total = 0;
+    bool isMatch = true;
+
+    while ((total < ByteCount) && (g_Ring.Count() != 0)) {
+        ULONG chunk = g_Ring.ContiguousCount();
+        const UCHAR* dataPtr = g_Ring.ReadPointer();
+
+        CHECK(chunk != 0);
+        CHECK(chunk <= g_Ring.Count());
+        CHECK(dataPtr + chunk <= g_Dma.Buffer.data() + g_Model.Size);
+        if (chunk > ByteCount - total) {
+            chunk = ByteCount - total;
+        }
+        for (ULONG i = 0; i < chunk; i++) {
+            isMatch = isMatch && (dataPtr[i] == DmaModel::Pattern(first + total + i));
+        }
+        g_Ring.Consume(chunk);
+        total += chunk;
+    }
+    CHECK(isMatch);
+
+    g_Model.Pending -= total;
+    g_Model.Delivered += total;
+    CHECK(g_Ring.Count() == g_Model.Pending);
+
+    return total;
+}
+
+static void
+TestReceive ()
+{
+    Init(64);
+
+    // Nothing written
+    CHECK(g_Ring.Update(0) == 0);
+    CHECK((g_Ring.Count() == 0) && (g_Ring.ContiguousCount() == 0));
+    CHECK(!g_Ring.TakeOverrun());
+
+    Receive(10);
+    CHECK(g_Ring.ContiguousCount() == 10);
+    CHECK(Deliver(4) == 4);
+    CHECK(Deliver(100) == 6);
+
+    // Across the end of the buffer: two chunks
+    Receive(40);
+    CHECK(Deliver(40) == 40);
+    Receive(30);
+    CHECK(g_Ring.ReadPos == 50);
+    CHECK(g_Ring.ContiguousCount() == 14);
+    CHECK(Deliver(30) == 30);
+    CHECK(g_Ring.ReadPos == 16);
+
+    // DMA counter at the end of the buffer
+    Receive(48, true);
+    CHECK(g_Ring.DmaPos == 0);
+    CHECK(Deliver(48) == 48);
+
+    CHECK(!g_Ring.TakeOverrun());
+    CHECK(StatisticsMatch());
+}
+
+static void
+TestFull ()
+{
+    Init(64);
+
+    // A full ring is not an overrun.
+    Receive(40);
+    Receive(24);
+    CHECK(g_Ring.Count() == 64);
+    CHECK(g_Ring.ReadPos == g_Ring.DmaPos);
+    CHECK(g_Ring.ContiguousCount() == 64);
+    CHECK(!g_Ring.TakeOverrun());
+
+    // One more byte drops the oldest one.
+    Receive(1);
+    CHECK(g_Ring.Count() == 64);
+    CHECK(g_Ring.ReadPos == 1);
+    CHECK(g_Ring.TakeOverrun());
+    CHECK(!g_Ring.TakeOverrun());
+    CHECK(g_Ring.Statistics.BytesDropped == 1);
+    CHECK(Deliver(64) == 64);
+    CHECK(StatisticsMatch());
+}
+
+static void
+TestOverrun ()
+{
+    Init(97);
+
+    // Almost a lap with 90 bytes pending: 89 bytes are lost.
+    Receive(90);
+    CHECK(Deliver(3) == 3);
+    Receive(96);
+    CHECK(g_Ring.Statistics.Overruns == 1);
+    CHECK(g_Ring.Statistics.BytesDropped == 87 + 96 - 97);
+    CHECK(g_Ring.ReadPos == g_Ring.DmaPos);
+
+    // Two overruns before the caller looks are reported once.
+    Receive(5);
+    CHECK(g_Ring.Statistics.Overruns == 2);
+    CHECK(g_Ring.TakeOverrun());
+    CHECK(!g_Ring.TakeOverrun());
+
+    CHECK(Deliver(97) == 97);
+    Receive(20);
+    CHECK(!g_Ring.TakeOverrun());
+    CHECK(Deliver(20) == 20);
+    CHECK(StatisticsMatch());
+}
+
+static void
+TestRestart ()
+{
+    Init(64);
+
+    Receive(50);
+    CHECK(Deliver(20) == 20);
+
+    // The DMA restarts at the beginning of the buffer, the pending bytes
+    // are gone and the statistics are kept.
+    g_Ring.Restart();
+    g_Dma.Restart();
+    g_Model.Pending = 0;
+    CHECK((g_Ring.Count() == 0) && (g_Ring.ReadPos == 0) && (g_Ring.DmaPos == 0));
+    Receive(10);
+    CHECK(Deliver(10) == 10);
+    CHECK(StatisticsMatch());
+
+    g_Ring.RecordLatency(30);
+    g_Ring.RecordLatency(10);
+    CHECK(g_Ring.Statistics.LatencySamples == 2);
+    CHECK(g_Ring.Statistics.LatencyTotalUsec == 40);
+    CHECK(g_Ring.Statistics.LatencyMaxUsec == 30);
+
+    // A new buffer clears them.
+    g_Ring.SetBuffer(g_Dma.Buffer.data(), 64);
+    CHECK(g_Ring.Statistics.BytesReceived == 0);
+    CHECK(g_Ring.Statistics.LatencyMaxUsec == 0);
+}
+
+//
+// Random DMA progress (less than a lap per sample), reads and restarts
+//
+static void
+TestRandom (
+    ULONG Size
+    )
+{
+    ULONG64 overrunsSeen = 0;
+
+    Init(Size);
+    for (ULONG step = 0; step < RANDOM_STEPS; step++) {
+        switch (Random(8)) {
+        case 0:
+            Receive(Random(Size), Random(2) != 0);
+            break;
+        case 1:
+        case 2:
+        case 3:
+            Receive(Random(Size / 4 + 1));
+            break;
+        case 4:
+            Deliver(Random(Size + 1));
+            break;
+        case 5:
+        case 6:
+            Deliver(Random(Size / 4 + 1));
+            break;
+        default:
+            if (Random(64) == 0) {
+                g_Ring.Restart();
+                g_Dma.Restart();
+                g_Model.Pending = 0;
+                g_Model.IsOverrun = false;
+            }
+            break;
+        }
+        if (g_Ring.TakeOverrun()) {
+            overrunsSeen += 1;
+            CHECK(g_Model.IsOverrun);
+            g_Model.IsOverrun = false;
+        }
+        CHECK(!g_Model.IsOverrun);
+        if (!StatisticsMatch() || (g_NumFailures != 0)) {
+            printf("random: size %u, step %u\n", unsigned(Size), unsigned(step));
+            CHECK(StatisticsMatch());
+            return;
+        }
+    }
+
+    printf("random: size %u, %llu bytes received, %llu dropped, %llu overruns, %llu reported\n",
+           unsigned(Size),
+           (unsigned long long)g_Ring.Statistics.BytesReceived,
+           (unsigned long long)g_Ring.Statistics.BytesDropped,
+           (unsigned long long)g_Ring.Statistics.Overruns,
+           (unsigned long long)overrunsSeen);
+}
+
+int
+main ()
+{
+    TestReceive();
+    TestFull();
+    TestOverrun();
+    TestRestart();
+    TestRandom(64);
+    TestRandom(97);
+    TestRandom(4096);
+
+    return HostTestResult("uartdmaringtest");
+}
@@ -0,0 +1,187 @@
+/*
+* Copyright 2023 NXP
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted (subject to the limitations in the disclaimer
+* below) provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of NXP nor the names of its contributors may be used to
+* endorse or promote products derived from this software without specific prior
+* written permission.
+*
+* NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS
+* LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+* THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+* GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include <wdm.h>
+#include "mp_tx_map.h"
+
+/*++
+Routine Description:
+    Returns the number of BDs needed to map Length bytes of the scatter gather list, starting SkipBytes bytes in.
+Arguments:
+    pSGList             The NET_BUFFER scatter gather list
+    SkipBytes           Number of bytes at the beginning of the list that are not mapped
+    Length              Number of bytes to map
+    MaxFragmentLength   Max data length of one BD, longer elements are split
+    AlignMask           Required alignment of the BD data address minus one, 0 if any address will do
+Return Value:
+    Number of BDs, or 0 if the range can not be mapped (address above 4GB or not aligned, too many fragments,
+    empty or not covered by the list).
+--*/
+_Use_decl_annotations_
+ULONG MpTxMapCountFragments(PSCATTER_GATHER_LIST pSGList, ULONG SkipBytes, ULONG Length, ULONG MaxFragmentLength, ULONG AlignMask)
+{
+    ULONG Fragments = 0;
+    ULONG Offset = SkipBytes;
+    ULONG BytesLeft = Length;
+
+    for (ULONG Idx = 0; (Idx < pSGList->NumberOfElements) && (BytesLeft != 0); ++Idx) {
+        PSCATTER_GATHER_ELEMENT pElement = &pSGList->Elements[Idx];
+        if (Offset >= pElement->Length) {                                          // Element skipped as a whole
+            Offset -= pElement->Length;
+            continue;
+        }
+        ULONGLONG Address = (ULONGLONG)pElement->Address.QuadPart + Offset;
+        ULONG     ElementLength = pElement->Length - Offset;
+        Offset = 0;
+        if (ElementLength > BytesLeft) {
+            ElementLength = BytesLeft;
+        }
+        BytesLeft -= ElementLength;
+        if ((Address + ElementLength - 1) > MAXULONG) {                            // The BD address is 32 bit only
+            return 0;
+        }
+        if ((Address & AlignMask) || ((ElementLength > MaxFragmentLength) && (MaxFragmentLength & AlignMask))) {
+            return 0;
+        }
+        Fragments += (ElementLength + MaxFragmentLength - 1) / MaxFragmentLength;
+        if (Fragments > MP_TX_MAP_MAX_FRAGMENTS) {
+            return 0;
+        }
+    }
+    return (BytesLeft == 0) ? Fragments : 0;
+}
+
+/*++
+Routine Description:
+    Initializes the cursor used to walk the fragments of the scatter gather list.
+Arguments:
+    pCursor             The cursor
+    pSGList             The NET_BUFFER scatter gather list
+    SkipBytes           Number of bytes at the beginning of the list that are not mapped
+    Length              Number of bytes to map
+    MaxFragmentLength   Max data length of one BD
+Return Value:
+    None
+--*/
+_Use_decl_annotations_
+void MpTxMapInit(PMP_TX_MAP_CURSOR pCursor, PSCATTER_GATHER_LIST pSGList, ULONG SkipBytes, ULONG Length, ULONG MaxFragmentLength)
+{
+    pCursor->pSGList = pSGList;
+    pCursor->ElementIdx = 0;
+    pCursor->BytesLeft = Length;
+    pCursor->MaxFragmentLength = MaxFragmentLength;
+    while ((pCursor->ElementIdx < pSGList->NumberOfElements) && (SkipBytes >= pSGList->Elements[pCursor->ElementIdx].Length)) {
+        SkipBytes -= pSGList->Elements[pCursor->ElementIdx].Length;
+        pCursor->ElementIdx++;
+    }
+    pCursor->ElementOffset = SkipBytes;
+}
+
+/*++
+Routine Description:
+    Returns the next fragment of the scatter gather list, MpTxMapCountFragments() fragments are returned in total.
+Arguments:
+    pCursor     The cursor
+    pAddress    The BD data address
+    pLength     The BD data length
+Return Value:
+    FALSE if there is no fragment left, otherwise TRUE.
+--*/
+_Use_decl_annotations_
+BOOLEAN MpTxMapNextFragment(PMP_TX_MAP_CURSOR pCursor, PULONG pAddress, PULONG pLength)
+{
+    PSCATTER_GATHER_ELEMENT pElement;
+    ULONG                   Length;
+
+    *pAddress = 0;
+    *pLength = 0;
+    while ((pCursor->ElementIdx < pCursor->pSGList->NumberOfElements) && (pCursor->pSGList->Elements[pCursor->ElementIdx].Length == 0)) {
+        pCursor->ElementIdx++;                                                     // Skip empty elements
+    }
+    if ((pCursor->ElementIdx >= pCursor->pSGList->NumberOfElements) || (pCursor->BytesLeft == 0)) {
+        return FALSE;
+    }
+    pElement = &pCursor->pSGList->Elements[pCursor->ElementIdx];
+    Length = pElement->Length - pCursor->ElementOffset;
+    if (Length > pCursor->MaxFragmentLength) {
+        Length = pCursor->MaxFragmentLength;
+    }
+    if (Length > pCursor->BytesLeft) {
+        Length = pCursor->BytesLeft;
+    }
+    *pAddress = (ULONG)(pElement->Address.QuadPart + pCursor->ElementOffset);
+    *pLength = Length;
+    pCursor->BytesLeft -= Length;
+    pCursor->ElementOffset += Length;
+    if (pCursor->ElementOffset == pElement->Length) {                              // Element done, move to the next one
+        pCursor->ElementIdx++;
+        pCursor->ElementOffset = 0;
+    }
+    return TRUE;
+}
+
+/*++
+Routine Description:
+    Decides how a frame or LSO segment is put to the Tx BDs. The headers, if any, are always copied to the bounce buffer.
+    The payload is copied too if the whole frame is not longer than CopyBreak, or if the DMA can not take it straight
+    from the scatter gather list. Otherwise the payload is mapped fragment by fragment.
+Arguments:
+    pSGList             The NET_BUFFER scatter gather list
+    HeaderBytes         Number of header bytes copied to the bounce buffer
+    PayloadOffset       Offset of the payload from the beginning of the NET_BUFFER
+    PayloadLength       Number of payload bytes
+    CopyBreak           Frames up to this length are copied
+    MaxBDCount          Number of BDs of the BDT, a frame must never need more
+    MaxFragmentLength   Max data length of one BD
+    AlignMask           Required alignment of the BD data address minus one, 0 if any address will do
+Return Value:
+    Number of BDs the frame takes if the payload is mapped, including the BD of the bounce buffer if there are headers.
+    0 if the whole frame is copied to the bounce buffer of a single BD.
+--*/
+_Use_decl_annotations_
+ULONG MpTxMapPlan(PSCATTER_GATHER_LIST pSGList, ULONG HeaderBytes, ULONG PayloadOffset, ULONG PayloadLength, ULONG CopyBreak, ULONG MaxBDCount, ULONG MaxFragmentLength, ULONG AlignMask)
+{
+    ULONG Fragments;
+
+    if ((PayloadLength == 0) || (HeaderBytes + PayloadLength <= CopyBreak)) {
+        return 0;
+    }
+    Fragments = MpTxMapCountFragments(pSGList, PayloadOffset, PayloadLength, MaxFragmentLength, AlignMask);
+    if (Fragments == 0) {                                                          // Can not be mapped, copy it
+        return 0;
+    }
+    if (HeaderBytes != 0) {
+        Fragments++;                                                               // The BD of the bounce buffer
+    }
+    return (Fragments <= MaxBDCount) ? Fragments : 0;                              // Would never fit in the BDT, copy it
+}
@@ -0,0 +1,56 @@
+/*
+* Copyright 2023 NXP
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted (subject to the limitations in the disclaimer
+* below) provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of NXP nor the names of its contributors may be used to
+* endorse or promote products derived from this software without specific prior
+* written permission.
+*
+* NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS
+* LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+* THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+* GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#ifndef _MP_TX_MAP_H
+#define _MP_TX_MAP_H
+
+// Maps the scatter gather list of a TX NET_BUFFER onto DMA buffer descriptors. A range of the NET_BUFFER is mapped,
+// the leading bytes already copied to a bounce buffer are skipped and elements longer than a BD can describe are split.
+// Shared by the ENET and ENET QOS miniports. Only needs the types of wdm.h, so it can be run on the host.
+
+#define MP_TX_MAP_MAX_FRAGMENTS   16    // Frames with more fragments are copied to the bounce buffer
+
+typedef struct _MP_TX_MAP_CURSOR {
+    PSCATTER_GATHER_LIST  pSGList;
+    ULONG                 ElementIdx;          // Current SG element
+    ULONG                 ElementOffset;       // Bytes of the current SG element already mapped
+    ULONG                 BytesLeft;           // Bytes of the range not mapped yet
+    ULONG                 MaxFragmentLength;   // Max data length of one BD
+} MP_TX_MAP_CURSOR, *PMP_TX_MAP_CURSOR;
+
+ULONG   MpTxMapCountFragments(_In_ PSCATTER_GATHER_LIST pSGList, _In_ ULONG SkipBytes, _In_ ULONG Length, _In_ ULONG MaxFragmentLength, _In_ ULONG AlignMask);
+void    MpTxMapInit(_Out_ PMP_TX_MAP_CURSOR pCursor, _In_ PSCATTER_GATHER_LIST pSGList, _In_ ULONG SkipBytes, _In_ ULONG Length, _In_ ULONG MaxFragmentLength);
+BOOLEAN MpTxMapNextFragment(_Inout_ PMP_TX_MAP_CURSOR pCursor, _Out_ PULONG pAddress, _Out_ PULONG pLength);
+ULONG   MpTxMapPlan(_In_ PSCATTER_GATHER_LIST pSGList, _In_ ULONG HeaderBytes, _In_ ULONG PayloadOffset, _In_ ULONG PayloadLength, _In_ ULONG CopyBreak, _In_ ULONG MaxBDCount, _In_ ULONG MaxFragmentLength, _In_ ULONG AlignMask);
+
+#endif // _MP_TX_MAP_H
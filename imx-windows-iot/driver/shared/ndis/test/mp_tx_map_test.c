@@ -0,0 +1,421 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host unit test of the TX scatter gather mapping
+//
+// MpTxMapCountFragments(), MpTxMapNextFragment() and MpTxMapPlan() are
+// checked on hand made lists, then random NET_BUFFERs are sent through a
+// simulated Tx BDT the way the miniports fill it: the frame is split into
+// segments, each segment is planned, the headers and copied payload go to
+// the bounce buffer of the first BD and the mapped payload to one BD per
+// fragment. The simulated DMA gathers the bytes of each segment from the
+// BDs and they are compared with the NET_BUFFER.
+//
+
+#include "../mp_tx_map.c"
+#include "HostTest.h"
+
+#include <stdlib.h>
+
+#define MAX_ELEMENTS        32
+#define PHYS_MEMORY_SIZE    (1024 * 1024)
+#define BOUNCE_BASE         0x80000000U     // Bounce buffers are outside the simulated NET_BUFFER memory
+#define BOUNCE_SIZE         0x4000
+
+typedef struct {
+    SCATTER_GATHER_LIST     List;
+    SCATTER_GATHER_ELEMENT  Elements[MAX_ELEMENTS];
+} SG_LIST;
+
+static UCHAR    g_PhysMemory[PHYS_MEMORY_SIZE];
+static uint32_t g_Seed = 1;
+
+static ULONG
+Random(
+    ULONG   Range)
+{
+    g_Seed = g_Seed * 1103515245 + 12345;
+    return (g_Seed >> 8) % Range;
+}
+
+static void
+AddElement(
+    SG_LIST    *pList,
+    ULONGLONG   Address,
+    ULONG       Length)
+{
+    PSCATTER_GATHER_ELEMENT pElement = &pList->List.Elements[pList->List.NumberOfElements++];
+
+    pElement->Address.QuadPart = (LONGLONG)Address;
+    pElement->Length = Length;
+}
+
+static void
+TestCountFragments(void)
+{
+    SG_LIST List = { 0 };
+
+    AddElement(&List, 0x1000, 100);
+    AddElement(&List, 0x3000, 0);
+    AddElement(&List, 0x2000, 300);
+
+    CHECK(2 == MpTxMapCountFragments(&List.List, 0, 400, 0xFFFF, 0));
+    CHECK(1 == MpTxMapCountFragments(&List.List, 100, 300, 0xFFFF, 0));
+    CHECK(1 == MpTxMapCountFragments(&List.List, 150, 10, 0xFFFF, 0));
+    CHECK(2 == MpTxMapCountFragments(&List.List, 99, 2, 0xFFFF, 0));
+
+    // Long elements are split
+    CHECK(4 == MpTxMapCountFragments(&List.List, 0, 400, 128, 0));
+    CHECK(3 == MpTxMapCountFragments(&List.List, 0, 356, 128, 0));
+
+    // The range must be covered by the list
+    CHECK(0 == MpTxMapCountFragments(&List.List, 0, 401, 0xFFFF, 0));
+    CHECK(0 == MpTxMapCountFragments(&List.List, 400, 1, 0xFFFF, 0));
+
+    // The BD address is 32 bit only
+    List.List.NumberOfElements = 0;
+    AddElement(&List, 0xFFFFFF00ULL, 0x100);
+    AddElement(&List, 0x100000000ULL, 0x100);
+    CHECK(1 == MpTxMapCountFragments(&List.List, 0, 0x100, 0xFFFF, 0));
+    CHECK(0 == MpTxMapCountFragments(&List.List, 0, 0x101, 0xFFFF, 0));
+    CHECK(0 == MpTxMapCountFragments(&List.List, 0xFF, 2, 0xFFFF, 0));
+
+    List.List.NumberOfElements = 0;
+    AddElement(&List, 0xFFFFFF00ULL, 0x101);
+    CHECK(0 == MpTxMapCountFragments(&List.List, 0, 0x101, 0xFFFF, 0));
+
+    // Alignment of the element and of the split
+    List.List.NumberOfElements = 0;
+    AddElement(&List, 0x1000, 64);
+    AddElement(&List, 0x2004, 64);
+    CHECK(2 == MpTxMapCountFragments(&List.List, 0, 128, 0xFFFF, 3));
+    CHECK(0 == MpTxMapCountFragments(&List.List, 0, 128, 0xFFFF, 7));
+    CHECK(0 == MpTxMapCountFragments(&List.List, 2, 126, 0xFFFF, 3));
+    CHECK(0 == MpTxMapCountFragments(&List.List, 0, 128, 30, 3));
+    CHECK(4 == MpTxMapCountFragments(&List.List, 0, 128, 32, 3));
+
+    // Too many fragments
+    List.List.NumberOfElements = 0;
+    for (ULONG Idx = 0; Idx < MP_TX_MAP_MAX_FRAGMENTS + 1; Idx++) {
+        AddElement(&List, 0x1000 + Idx * 0x100, 16);
+    }
+    CHECK(MP_TX_MAP_MAX_FRAGMENTS == MpTxMapCountFragments(&List.List, 0, MP_TX_MAP_MAX_FRAGMENTS * 16, 0xFFFF, 0));
+    CHECK(0 == MpTxMapCountFragments(&List.List, 0, (MP_TX_MAP_MAX_FRAGMENTS + 1) * 16, 0xFFFF, 0));
+    CHECK(MP_TX_MAP_MAX_FRAGMENTS == MpTxMapCountFragments(&List.List, 16, MP_TX_MAP_MAX_FRAGMENTS * 16, 0xFFFF, 0));
+    CHECK(0 == MpTxMapCountFragments(&List.List, 0, 17 * 8, 8, 0));
+}
+
+static void
+TestNextFragment(void)
+{
+    SG_LIST             List = { 0 };
+    MP_TX_MAP_CURSOR    Cursor;
+    ULONG               Address;
+    ULONG               Length;
+
+    AddElement(&List, 0x1000, 0);
+    AddElement(&List, 0x2000, 100);
+    AddElement(&List, 0x3000, 0);
+    AddElement(&List, 0x4000, 300);
+    AddElement(&List, 0x5000, 50);
+
+    MpTxMapInit(&Cursor, &List.List, 40, 310, 128);
+    CHECK(MpTxMapNextFragment(&Cursor, &Address, &Length));
+    CHECK((0x2000 + 40 == Address) && (60 == Length));
+    CHECK(MpTxMapNextFragment(&Cursor, &Address, &Length));
+    CHECK((0x4000 == Address) && (128 == Length));
+    CHECK(MpTxMapNextFragment(&Cursor, &Address, &Length));
+    CHECK((0x4000 + 128 == Address) && (122 == Length));
+    CHECK(!MpTxMapNextFragment(&Cursor, &Address, &Length));
+    CHECK((0 == Address) && (0 == Length));
+    CHECK(3 == MpTxMapCountFragments(&List.List, 40, 310, 128, 0));
+
+    // Skip a whole element
+    MpTxMapInit(&Cursor, &List.List, 100, 310, 0xFFFF);
+    CHECK(MpTxMapNextFragment(&Cursor, &Address, &Length));
+    CHECK((0x4000 == Address) && (300 == Length));
+    CHECK(MpTxMapNextFragment(&Cursor, &Address, &Length));
+    CHECK((0x5000 == Address) && (10 == Length));
+    CHECK(!MpTxMapNextFragment(&Cursor, &Address, &Length));
+
+    // Nothing left in the list
+    MpTxMapInit(&Cursor, &List.List, 450, 10, 0xFFFF);
+    CHECK(!MpTxMapNextFragment(&Cursor, &Address, &Length));
+}
+
+static void
+TestPlan(void)
+{
+    SG_LIST List = { 0 };
+
+    AddElement(&List, 0x1000, 54);
+    AddElement(&List, 0x2000, 1000);
+    AddElement(&List, 0x3000, 1000);
+
+    // Short frames are copied, headers and payload together
+    CHECK(0 == MpTxMapPlan(&List.List, 0, 0, 256, 256, 64, 0xFFFF, 0));
+    CHECK(0 == MpTxMapPlan(&List.List, 54, 54, 200, 256, 64, 0xFFFF, 0));
+    CHECK(2 == MpTxMapPlan(&List.List, 0, 0, 257, 256, 64, 0xFFFF, 0));
+    CHECK(0 == MpTxMapPlan(&List.List, 54, 2054, 0, 0, 64, 0xFFFF, 0));
+
+    // The headers take the bounce buffer BD
+    CHECK(2 == MpTxMapPlan(&List.List, 54, 54, 1000, 256, 64, 0xFFFF, 0));
+    CHECK(3 == MpTxMapPlan(&List.List, 54, 554, 1000, 256, 64, 0xFFFF, 0));
+    CHECK(3 == MpTxMapPlan(&List.List, 0, 0, 2054, 256, 64, 0xFFFF, 0));
+
+    // Frames that need more BDs than the BDT has are copied
+    CHECK(3 == MpTxMapPlan(&List.List, 54, 554, 1000, 256, 3, 0xFFFF, 0));
+    CHECK(0 == MpTxMapPlan(&List.List, 54, 554, 1000, 256, 2, 0xFFFF, 0));
+    CHECK(0 == MpTxMapPlan(&List.List, 54, 54, 2000, 256, 64, 100, 0));
+
+    // Frames that can not be mapped are copied
+    CHECK(0 == MpTxMapPlan(&List.List, 0, 0, 2055, 256, 64, 0xFFFF, 0));
+    CHECK(0 == MpTxMapPlan(&List.List, 0, 1, 2053, 256, 64, 0xFFFF, 7));
+}
+
+//
+// Simulated Tx BDT. The producer fills the BDs of a segment the way the
+// miniports do, the consumer plays the DMA: it takes ready BDs in order,
+// gathers their data and checks each segment when its last BD is reached.
+//
+
+typedef struct {
+    ULONG   Address;
+    ULONG   Length;
+    BOOLEAN Ready;
+    BOOLEAN Last;
+} SIM_BD;
+
+typedef struct {
+    ULONG   ItemCount;
+    ULONG   FreeIdx;
+    ULONG   DoneIdx;
+    ULONG   FreeCount;
+    SIM_BD  Bd[64];
+    UCHAR   Bounce[64][BOUNCE_SIZE];
+    UCHAR   Expected[64][BOUNCE_SIZE];       // Bytes of the segment, kept at its first BD
+    ULONG   ExpectedLength[64];
+    ULONG   Segments;
+    ULONG   MappedSegments;
+} SIM_RING;
+
+static const UCHAR *
+SimPhysToVirt(
+    SIM_RING   *pRing,
+    ULONG       Address,
+    ULONG       Length)
+{
+    if (Address >= BOUNCE_BASE) {
+        ULONG Idx = (Address - BOUNCE_BASE) / BOUNCE_SIZE;
+        ULONG Offset = (Address - BOUNCE_BASE) % BOUNCE_SIZE;
+
+        CHECK((Idx < pRing->ItemCount) && (Offset + Length <= BOUNCE_SIZE));
+        return &pRing->Bounce[Idx][Offset];
+    }
+    CHECK((ULONGLONG)Address + Length <= PHYS_MEMORY_SIZE);
+    return &g_PhysMemory[Address];
+}
+
+static void
+SimDmaComplete(
+    SIM_RING   *pRing)
+{
+    static UCHAR    Gathered[BOUNCE_SIZE * 2];
+    ULONG           First = pRing->DoneIdx;
+    ULONG           Length = 0;
+
+    for (;;) {
+        SIM_BD *pBd = &pRing->Bd[pRing->DoneIdx];
+
+        CHECK(pBd->Ready);
+        CHECK(Length + pBd->Length <= sizeof(Gathered));
+        memcpy(&Gathered[Length], SimPhysToVirt(pRing, pBd->Address, pBd->Length), pBd->Length);
+        Length += pBd->Length;
+        pBd->Ready = FALSE;
+        pRing->FreeCount++;
+        pRing->DoneIdx = (pRing->DoneIdx + 1) % pRing->ItemCount;
+        if (pBd->Last) {
+            break;
+        }
+    }
+    CHECK(Length == pRing->ExpectedLength[First]);
+    CHECK(0 == memcmp(Gathered, pRing->Expected[First], Length));
+}
+
+static void
+SimFillSegment(
+    SIM_RING           *pRing,
+    PSCATTER_GATHER_LIST pSGList,
+    const UCHAR        *pFrame,
+    ULONG               HeaderBytes,
+    ULONG               PayloadOffset,
+    ULONG               PayloadLength,
+    ULONG               CopyBreak,
+    ULONG               MaxFragmentLength,
+    ULONG               AlignMask)
+{
+    ULONG               BDCount = MpTxMapPlan(pSGList, HeaderBytes, PayloadOffset, PayloadLength, CopyBreak, pRing->ItemCount, MaxFragmentLength, AlignMask);
+    ULONG               CopyBytes = (BDCount == 0) ? PayloadLength : 0;
+    ULONG               First = pRing->FreeIdx;
+    ULONG               BounceBytes = HeaderBytes + CopyBytes;
+    ULONG               MappedBytes = 0;
+    ULONG               Address;
+    ULONG               Length;
+    MP_TX_MAP_CURSOR    Cursor;
+
+    if (BDCount == 0) {
+        BDCount = 1;
+        CHECK(BounceBytes <= BOUNCE_SIZE);
+    } else {
+        CHECK(BDCount <= MP_TX_MAP_MAX_FRAGMENTS + 1);
+        pRing->MappedSegments++;
+    }
+    CHECK(BDCount <= pRing->ItemCount);
+    while (pRing->FreeCount < BDCount) {
+        SimDmaComplete(pRing);
+    }
+
+    memcpy(pRing->Expected[First], pFrame, HeaderBytes);
+    memcpy(pRing->Expected[First] + HeaderBytes, pFrame + PayloadOffset, PayloadLength);
+    pRing->ExpectedLength[First] = HeaderBytes + PayloadLength;
+    memcpy(pRing->Bounce[First], pFrame, HeaderBytes);
+    memcpy(pRing->Bounce[First] + HeaderBytes, pFrame + PayloadOffset, CopyBytes);
+
+    MpTxMapInit(&Cursor, pSGList, PayloadOffset + CopyBytes, PayloadLength - CopyBytes, MaxFragmentLength);
+    for (ULONG BDIdx = 0; BDIdx < BDCount; ++BDIdx) {
+        SIM_BD *pBd = &pRing->Bd[pRing->FreeIdx];
+
+        CHECK(!pBd->Ready);
+        if ((BDIdx == 0) && (BounceBytes != 0)) {
+            pBd->Address = BOUNCE_BASE + First * BOUNCE_SIZE;
+            pBd->Length = BounceBytes;
+        } else {
+            CHECK(MpTxMapNextFragment(&Cursor, &pBd->Address, &pBd->Length));
+            CHECK((pBd->Length != 0) && (pBd->Length <= MaxFragmentLength));
+            CHECK(0 == (pBd->Address & AlignMask));
+            MappedBytes += pBd->Length;
+        }
+        pBd->Last = (BOOLEAN)(BDIdx == BDCount - 1);
+        pBd->Ready = TRUE;
+        pRing->FreeIdx = (pRing->FreeIdx + 1) % pRing->ItemCount;
+    }
+    pRing->FreeCount -= BDCount;
+    pRing->Segments++;
+
+    // All fragments the plan counted were returned, and no more
+    CHECK(MappedBytes == PayloadLength - CopyBytes);
+    CHECK(!MpTxMapNextFragment(&Cursor, &Address, &Length));
+}
+
+// Scatters the frame over random elements of the simulated memory. The
+// memory is taken in order, once it runs out the BDT is drained so that
+// the frames still in flight are not overwritten.
+static void
+BuildNetBuffer(
+    SIM_RING   *pRing,
+    SG_LIST    *pList,
+    UCHAR      *pFrame,
+    ULONG       Length,
+    ULONG       AlignMask)
+{
+    static ULONG    PhysNext;
+    ULONG           Offset = 0;
+
+    pList->List.NumberOfElements = 0;
+    for (ULONG Idx = 0; Idx < Length; Idx++) {
+        pFrame[Idx] = (UCHAR)Random(256);
+    }
+    while (Offset < Length) {
+        ULONG       ElementLength;
+        ULONG       Address;
+
+        if (pList->List.NumberOfElements == MAX_ELEMENTS - 1) {
+            ElementLength = Length - Offset;
+        } else if (Random(8) == 0) {
+            ElementLength = 0;
+        } else {
+            ElementLength = 1 + Random((Random(4) == 0) ? Length - Offset : 512);
+            if (ElementLength > Length - Offset) {
+                ElementLength = Length - Offset;
+            }
+        }
+        Address = PhysNext + Random(64);
+        if (Random(4) != 0) {
+            Address = (Address + AlignMask) & ~AlignMask;
+        }
+        if (Address + ElementLength > PHYS_MEMORY_SIZE) {
+            while (pRing->FreeCount < pRing->ItemCount) {
+                SimDmaComplete(pRing);
+            }
+            Address = 0;
+        }
+        memcpy(&g_PhysMemory[Address], pFrame + Offset, ElementLength);
+        AddElement(pList, Address, ElementLength);
+        PhysNext = Address + ElementLength;
+        Offset += ElementLength;
+    }
+}
+
+static void
+TestRing(
+    ULONG   ItemCount,
+    ULONG   MaxFragmentLength,
+    ULONG   AlignMask)
+{
+    static SIM_RING Ring;
+    static UCHAR    Frame[64 * 1024];
+    SG_LIST         List;
+
+    memset(&Ring, 0, sizeof(Ring));
+    Ring.ItemCount = ItemCount;
+    Ring.FreeCount = ItemCount;
+
+    for (ULONG Iteration = 0; Iteration < 4000; Iteration++) {
+        ULONG   Length = 14 + Random((Random(4) == 0) ? sizeof(Frame) - 14 : 1500);
+        ULONG   HeaderBytes = 0;
+        ULONG   SegmentSize = Length;
+        ULONG   CopyBreak = Random(4) ? 128 : 0;
+
+        BuildNetBuffer(&Ring, &List, Frame, Length, AlignMask);
+        if (Length > 1514) {
+            HeaderBytes = 54 + 4 * Random(11);                                     // LSO, Ethernet, IP and TCP headers
+            SegmentSize = 536 + Random(1460 - 536 + 1);
+        } else if (Random(2)) {
+            HeaderBytes = (Length < 64) ? Length : 64;                             // Checksum field cleared in the bounce buffer
+            SegmentSize = Length - HeaderBytes;
+        }
+        if (SegmentSize == 0) {
+            SimFillSegment(&Ring, &List.List, Frame, HeaderBytes, HeaderBytes, 0, CopyBreak, MaxFragmentLength, AlignMask);
+            continue;
+        }
+        for (ULONG PayloadOffset = HeaderBytes; PayloadOffset < Length; PayloadOffset += SegmentSize) {
+            ULONG PayloadLength = (Length - PayloadOffset > SegmentSize) ? SegmentSize : Length - PayloadOffset;
+
+            SimFillSegment(&Ring, &List.List, Frame, HeaderBytes, PayloadOffset, PayloadLength, CopyBreak, MaxFragmentLength, AlignMask);
+        }
+    }
+    while (Ring.FreeCount < Ring.ItemCount) {
+        SimDmaComplete(&Ring);
+    }
+    CHECK(Ring.FreeIdx == Ring.DoneIdx);
+
+    // Both paths are taken
+    CHECK(Ring.MappedSegments != 0);
+    CHECK(Ring.MappedSegments != Ring.Segments);
+}
+
+int
+main(void)
+{
+    TestCountFragments();
+    TestNextFragment();
+    TestPlan();
+
+    TestRing(64, 0xFFFF, 0);                                                       // ENET
+    TestRing(16, 0x3FFF, 0);                                                       // ENET QOS
+    TestRing(8, 1000, 0);
+    TestRing(32, 0xFFFF, 7);
+
+    return HostTestResult("mp_tx_map_test");
+}
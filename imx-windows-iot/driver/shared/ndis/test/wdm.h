@@ -0,0 +1,49 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Stand-in for the parts of wdm.h used by the shared NDIS sources in the
+// host tests
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+typedef unsigned char           UCHAR;
+typedef unsigned short          USHORT;
+typedef uint32_t                ULONG, *PULONG;
+typedef int32_t                 LONG;
+typedef uint64_t                ULONGLONG;
+typedef int64_t                 LONGLONG;
+typedef UCHAR                   BOOLEAN;
+
+#define TRUE                    1
+#define FALSE                   0
+#define MAXULONG                0xFFFFFFFFUL
+
+typedef union _LARGE_INTEGER {
+    struct {
+        ULONG   LowPart;
+        LONG    HighPart;
+    };
+    LONGLONG    QuadPart;
+} LARGE_INTEGER, PHYSICAL_ADDRESS;
+
+typedef struct _SCATTER_GATHER_ELEMENT {
+    PHYSICAL_ADDRESS    Address;
+    ULONG               Length;
+    uintptr_t           Reserved;
+} SCATTER_GATHER_ELEMENT, *PSCATTER_GATHER_ELEMENT;
+
+typedef struct _SCATTER_GATHER_LIST {
+    ULONG                   NumberOfElements;
+    uintptr_t               Reserved;
+    SCATTER_GATHER_ELEMENT  Elements[];
+} SCATTER_GATHER_LIST, *PSCATTER_GATHER_LIST;
+
+#define _In_
+#define _Out_
+#define _Inout_
+#define _Use_decl_annotations_
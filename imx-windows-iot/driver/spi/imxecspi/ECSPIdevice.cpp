@@ -29,6 +29,8 @@
 // Module specific header files
 #include "ECSPIhw.h"
 #include "ECSPIspb.h"
+#include "ECSPIdmamap.h"
+#include "ECSPIdma.h"
 #include "ECSPIdriver.h"
 #include "ECSPIdevice.h"
 
@@ -73,7 +75,9 @@ ECSPIEvtDevicePrepareHardware (
     ULONG numIntResourcesFound = 0;
     ULONG numMemResourcesFound = 0;
     ULONG numConnectionResourcesFound = 0;
+    ULONG numDmaResourcesFound = 0;
     const CM_PARTIAL_RESOURCE_DESCRIPTOR* memResourceDescPtr = nullptr;
+    const CM_PARTIAL_RESOURCE_DESCRIPTOR* dmaResourceDescPtrs[2] = { nullptr };
     ULONG traceLogId = 0;
 
     for (ULONG resInx = 0; resInx < numResourses; ++resInx) {
@@ -191,6 +195,25 @@ ECSPIEvtDevicePrepareHardware (
             } // New CS GPIO pin entry
             break;
 
+        case CmResourceTypeDma:
+            //
+            // Optional RX and TX DMA channels, in this order.
+            //
+            if (numDmaResourcesFound < ARRAYSIZE(dmaResourceDescPtrs)) {
+
+                dmaResourceDescPtrs[numDmaResourcesFound] = resDescPtr;
+
+            } else {
+
+                ECSPI_LOG_WARNING(
+                    DRIVER_LOG_HANDLE,
+                    "Unexpected additional DMA resource %lu, ignored!",
+                    numDmaResourcesFound
+                    );
+            }
+            ++numDmaResourcesFound;
+            break;
+
         default:
             ECSPI_ASSERT(DRIVER_LOG_HANDLE, FALSE);
             break;
@@ -260,6 +283,34 @@ ECSPIEvtDevicePrepareHardware (
         PVOID(devExtPtr->ECSPIRegsPtr)
         );
 
+    //
+    // DMA is optional, on failure all transfers use PIO.
+    //
+    if (numDmaResourcesFound >= ARRAYSIZE(dmaResourceDescPtrs)) {
+
+        status = ECSPIDmaInitialize(
+            devExtPtr,
+            memResourceDescPtr,
+            dmaResourceDescPtrs[0],
+            dmaResourceDescPtrs[1]
+            );
+        if (!NT_SUCCESS(status)) {
+
+            ECSPI_LOG_WARNING(
+                devExtPtr->IfrLogHandle,
+                "ECSPIDmaInitialize failed, using PIO. status = %!STATUS!",
+                status
+                );
+        }
+
+    } else if (numDmaResourcesFound != 0) {
+
+        ECSPI_LOG_WARNING(
+            devExtPtr->IfrLogHandle,
+            "Both RX and TX DMA resources are required, using PIO"
+            );
+    }
+
     return STATUS_SUCCESS;
 }
 
@@ -295,6 +346,9 @@ ECSPIEvtDeviceReleaseHardware (
 
     UNREFERENCED_PARAMETER(ResourcesTranslated);
 
+    ECSPIDmaLogStatistics(devExtPtr);
+    ECSPIDmaDeinitialize(devExtPtr);
+
     if (devExtPtr->ECSPIRegsPtr != nullptr) {
 
         MmUnmapIoSpace(
@@ -835,12 +889,14 @@ ECSPIEvtInterruptDpc (
             devExtPtr->IfrLogHandle,
             ECSPISpbIsAllDataTransferred(transfer1Ptr)
             );
+        ECSPISpbRecordTransfer(transfer1Ptr);
         if (transfer2Ptr != nullptr) {
 
             ECSPI_ASSERT(
                 devExtPtr->IfrLogHandle,
                 ECSPISpbIsAllDataTransferred(transfer2Ptr)
                 );
+            ECSPISpbRecordTransfer(transfer2Ptr);
         }
 
         break;
@@ -124,6 +124,17 @@ typedef struct _ECSPI_DEVICE_EXTENSION
     //
     ECSPI_CS_GPIO_PIN CsGpioPins[ECSPI_CHANNEL::COUNT];
 
+    //
+    // The DMA resources and state
+    //
+    ECSPI_DMA_CONTEXT Dma;
+
+    //
+    // PIO/DMA transfer statistics
+    //
+    ECSPI_TRANSFER_STATISTICS PioStatistics;
+    ECSPI_TRANSFER_STATISTICS DmaStatistics;
+
 } ECSPI_DEVICE_EXTENSION;
 
 WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(ECSPI_DEVICE_EXTENSION, ECSPIDeviceGetExtension);
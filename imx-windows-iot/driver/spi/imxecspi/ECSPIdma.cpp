@@ -0,0 +1,1364 @@
+// Copyright 2023 NXP
+// Licensed under the MIT License.
+//
+// Module Name:
+//
+//    ECSPIdma.cpp
+//
+// Abstract:
+//
+//    This module contains the implementation of the IMX ECSPI controller
+//    system DMA (SDMA) transfers.
+//    Transfers at or above the DMA threshold are moved by two SDMA
+//    channels, one per direction, so the CPU only runs once per chunk
+//    instead of once per FIFO watermark.
+//    Both channels run for every transfer: read transfers clock in data by
+//    sending 0s from a scratch buffer, and write transfers receive the
+//    data clocked in into the same scratch buffer. The RX channel
+//    completion thus also tells that the last word has been shifted out,
+//    so no transfer complete interrupt is needed.
+//    This controller driver uses the SPB WDF class extension (SpbCx).
+//
+// Environment:
+//
+//    kernel-mode only
+//
+#include "precomp.h"
+#pragma hdrstop
+
+#define _ECSPI_DMA_CPP_
+
+// Logging header files
+#include "ECSPItrace.h"
+#include "ECSPIdma.tmh"
+
+// Common driver header files
+#include "ECSPIcommon.h"
+
+// SDMA HAL extension configuration
+#include "HalExtiMXDmaCfg.h"
+
+// Module specific header files
+#include "ECSPIhw.h"
+#include "ECSPIspb.h"
+#include "ECSPIdmamap.h"
+#include "ECSPIdma.h"
+#include "ECSPIdriver.h"
+#include "ECSPIdevice.h"
+
+
+#ifdef ALLOC_PRAGMA
+    #pragma alloc_text(PAGE, ECSPIDmaInitialize)
+    #pragma alloc_text(PAGE, ECSPIDmaDeinitialize)
+    #pragma alloc_text(PAGE, ECSPIpDmaCreateChannel)
+    #pragma alloc_text(PAGE, ECSPIpDmaDeleteChannel)
+#endif
+
+
+//
+// Routine Description:
+//
+//  ECSPIDmaInitialize is called by ECSPIEvtDevicePrepareHardware to
+//  create the RX/TX system DMA channels and the scratch buffer.
+//  DMA is only used if the firmware describes the RX and TX
+//  FixedDMA resources, and the DMA threshold is not disabled.
+//
+// Arguments:
+//
+//  DevExtPtr - The device extension.
+//
+//  MemResourcePtr - The ECSPI registers resource.
+//
+//  RxDmaResourcePtr - The RX DMA resource.
+//
+//  TxDmaResourcePtr - The TX DMA resource.
+//
+// Return Value:
+//
+//  NTSTATUS, on failure the DMA resources have been released and
+//  all transfers use PIO.
+//
+_Use_decl_annotations_
+NTSTATUS
+ECSPIDmaInitialize (
+    ECSPI_DEVICE_EXTENSION* DevExtPtr,
+    const CM_PARTIAL_RESOURCE_DESCRIPTOR* MemResourcePtr,
+    const CM_PARTIAL_RESOURCE_DESCRIPTOR* RxDmaResourcePtr,
+    const CM_PARTIAL_RESOURCE_DESCRIPTOR* TxDmaResourcePtr
+    )
+{
+    PAGED_CODE();
+
+    ECSPI_DMA_CONTEXT* dmaPtr = &DevExtPtr->Dma;
+    NTSTATUS status;
+
+    RtlZeroMemory(dmaPtr, sizeof(*dmaPtr));
+
+    //
+    // Each DMA element is a single FIFO entry, the element size
+    // comes from the FixedDMA transfer width.
+    //
+    ULONG transferWidth = RxDmaResourcePtr->u.DmaV3.TransferWidth;
+    if ((transferWidth != TxDmaResourcePtr->u.DmaV3.TransferWidth) ||
+        (transferWidth > ULONG(Width32Bits))) {
+
+        ECSPI_LOG_ERROR(
+            DevExtPtr->IfrLogHandle,
+            "Unsupported DMA transfer width (RX %lu, TX %lu)!",
+            transferWidth,
+            ULONG(TxDmaResourcePtr->u.DmaV3.TransferWidth)
+            );
+        return STATUS_DEVICE_CONFIGURATION_ERROR;
+    }
+
+    ECSPI_DMA_POLICY* policyPtr = &dmaPtr->Policy;
+    policyPtr->ElementSize = 1UL << transferWidth;
+    policyPtr->ThresholdBytes = ECSPIDmaSelectThreshold(
+        ECSPIDriverGetDmaThreshold(),
+        ECSPI_FIFO_DEPTH,
+        policyPtr->ElementSize
+        );
+    policyPtr->WatermarkElements = ECSPI_DMA_WATERMARK;
+    policyPtr->MaxChunkBytes = ECSPI_DMA_SCRATCH_BUFFER_SIZE;
+    policyPtr->MaxDescriptors = SDMA_SG_LIST_MAX_SIZE;
+    policyPtr->PageSize = PAGE_SIZE;
+
+    if (policyPtr->ThresholdBytes == ECSPI_DMA_THRESHOLD_DISABLED) {
+
+        ECSPI_LOG_INFORMATION(
+            DevExtPtr->IfrLogHandle,
+            "DMA is disabled, all transfers use PIO"
+            );
+        return STATUS_SUCCESS;
+    }
+
+    //
+    // Create the RX/TX channels
+    //
+    {
+        PHYSICAL_ADDRESS rxDataAddress;
+        rxDataAddress.QuadPart = MemResourcePtr->u.Memory.Start.QuadPart +
+            FIELD_OFFSET(ECSPI_REGISTERS, RXDATA);
+
+        status = ECSPIpDmaCreateChannel(
+            DevExtPtr,
+            &dmaPtr->Rx,
+            WdfDmaDirectionReadFromDevice,
+            rxDataAddress,
+            RxDmaResourcePtr
+            );
+        if (!NT_SUCCESS(status)) {
+
+            goto done;
+        }
+
+        PHYSICAL_ADDRESS txDataAddress;
+        txDataAddress.QuadPart = MemResourcePtr->u.Memory.Start.QuadPart +
+            FIELD_OFFSET(ECSPI_REGISTERS, TXDATA);
+
+        status = ECSPIpDmaCreateChannel(
+            DevExtPtr,
+            &dmaPtr->Tx,
+            WdfDmaDirectionWriteToDevice,
+            txDataAddress,
+            TxDmaResourcePtr
+            );
+        if (!NT_SUCCESS(status)) {
+
+            goto done;
+        }
+
+    } // Create the RX/TX channels
+
+    //
+    // The scratch buffer, non paged/non-cached.
+    //
+    {
+        PHYSICAL_ADDRESS highestAcceptableAddress;
+        PHYSICAL_ADDRESS lowestAcceptableAddress = { 0 };
+        PHYSICAL_ADDRESS boundaryAddress = { 0 };
+
+        // Limit to 32 bit address space
+        highestAcceptableAddress.QuadPart = LONGLONG(MAXULONG);
+
+        dmaPtr->ScratchBufferPtr = static_cast<UCHAR*>(
+            MmAllocateContiguousMemorySpecifyCache(
+                2 * ECSPI_DMA_SCRATCH_BUFFER_SIZE,
+                lowestAcceptableAddress,
+                highestAcceptableAddress,
+                boundaryAddress,
+                MmNonCached
+                ));
+        if (dmaPtr->ScratchBufferPtr == nullptr) {
+
+            ECSPI_LOG_ERROR(
+                DevExtPtr->IfrLogHandle,
+                "Failed to allocate DMA scratch buffer, %lu bytes!",
+                2 * ECSPI_DMA_SCRATCH_BUFFER_SIZE
+                );
+            status = STATUS_INSUFFICIENT_RESOURCES;
+            goto done;
+        }
+        RtlZeroMemory(dmaPtr->ScratchBufferPtr, 2 * ECSPI_DMA_SCRATCH_BUFFER_SIZE);
+
+        dmaPtr->ZerosMdlPtr = IoAllocateMdl(
+            dmaPtr->ScratchBufferPtr,
+            ECSPI_DMA_SCRATCH_BUFFER_SIZE,
+            FALSE,
+            FALSE,
+            nullptr
+            );
+        dmaPtr->DiscardMdlPtr = IoAllocateMdl(
+            dmaPtr->ScratchBufferPtr + ECSPI_DMA_SCRATCH_BUFFER_SIZE,
+            ECSPI_DMA_SCRATCH_BUFFER_SIZE,
+            FALSE,
+            FALSE,
+            nullptr
+            );
+        if ((dmaPtr->ZerosMdlPtr == nullptr) ||
+            (dmaPtr->DiscardMdlPtr == nullptr)) {
+
+            ECSPI_LOG_ERROR(
+                DevExtPtr->IfrLogHandle,
+                "IoAllocateMdl failed for DMA scratch buffer!"
+                );
+            status = STATUS_INSUFFICIENT_RESOURCES;
+            goto done;
+        }
+        MmBuildMdlForNonPagedPool(dmaPtr->ZerosMdlPtr);
+        MmBuildMdlForNonPagedPool(dmaPtr->DiscardMdlPtr);
+
+    } // The scratch buffer
+
+    //
+    // Stopping the system DMA may call the completion routine
+    // synchronously, so it is done from a DPC, where we do not
+    // hold the device lock.
+    //
+    {
+        WDF_DPC_CONFIG dpcConfig;
+        WDF_DPC_CONFIG_INIT(&dpcConfig, ECSPIpEvtDmaStopDpc);
+        dpcConfig.AutomaticSerialization = FALSE;
+
+        WDF_OBJECT_ATTRIBUTES attributes;
+        WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+        attributes.ParentObject = DevExtPtr->WdfDevice;
+
+        status = WdfDpcCreate(&dpcConfig, &attributes, &dmaPtr->WdfStopDpc);
+        if (!NT_SUCCESS(status)) {
+
+            ECSPI_LOG_ERROR(
+                DevExtPtr->IfrLogHandle,
+                "WdfDpcCreate failed. status = %!STATUS!",
+                status
+                );
+            goto done;
+        }
+
+    } // Stop DPC
+
+    //
+    // Acquire the SDMA request lines
+    //
+    {
+        ECSPI_DMA_CHANNEL* channels[] = { &dmaPtr->Rx, &dmaPtr->Tx };
+        for (ECSPI_DMA_CHANNEL* channelPtr : channels) {
+
+            DMA_ADAPTER* dmaAdapterPtr = channelPtr->DmaAdapterPtr;
+            status = dmaAdapterPtr->DmaOperations->ConfigureAdapterChannel(
+                dmaAdapterPtr,
+                SDMA_CFG_FUN_ACQUIRE_REQUEST_LINE,
+                &channelPtr->DmaRequestLine
+                );
+            if (!NT_SUCCESS(status)) {
+
+                ECSPI_LOG_ERROR(
+                    DevExtPtr->IfrLogHandle,
+                    "SDMA_CFG_FUN_ACQUIRE_REQUEST_LINE failed for line %lu. "
+                    "status = %!STATUS!",
+                    channelPtr->DmaRequestLine,
+                    status
+                    );
+                goto done;
+            }
+            channelPtr->IsRequestLineAcquired = TRUE;
+        }
+
+    } // Acquire the SDMA request lines
+
+    dmaPtr->IsEnabled = TRUE;
+
+    ECSPI_LOG_INFORMATION(
+        DevExtPtr->IfrLogHandle,
+        "DMA enabled: RX line %lu, TX line %lu, element %lu bytes, "
+        "threshold %lu bytes",
+        dmaPtr->Rx.DmaRequestLine,
+        dmaPtr->Tx.DmaRequestLine,
+        policyPtr->ElementSize,
+        policyPtr->ThresholdBytes
+        );
+
+    status = STATUS_SUCCESS;
+
+done:
+
+    if (!NT_SUCCESS(status)) {
+
+        ECSPIDmaDeinitialize(DevExtPtr);
+    }
+    return status;
+}
+
+
+//
+// Routine Description:
+//
+//  ECSPIDmaDeinitialize is called by ECSPIEvtDeviceReleaseHardware,
+//  or when ECSPIDmaInitialize fails, to release the DMA resources.
+//
+// Arguments:
+//
+//  DevExtPtr - The device extension.
+//
+// Return Value:
+//
+_Use_decl_annotations_
+VOID
+ECSPIDmaDeinitialize (
+    ECSPI_DEVICE_EXTENSION* DevExtPtr
+    )
+{
+    PAGED_CODE();
+
+    ECSPI_DMA_CONTEXT* dmaPtr = &DevExtPtr->Dma;
+
+    dmaPtr->IsEnabled = FALSE;
+
+    if (dmaPtr->WdfStopDpc != NULL) {
+
+        (void)WdfDpcCancel(dmaPtr->WdfStopDpc, TRUE);
+        WdfObjectDelete(dmaPtr->WdfStopDpc);
+    }
+
+    ECSPIpDmaDeleteChannel(&dmaPtr->Rx);
+    ECSPIpDmaDeleteChannel(&dmaPtr->Tx);
+
+    if (dmaPtr->ZerosMdlPtr != nullptr) {
+
+        IoFreeMdl(dmaPtr->ZerosMdlPtr);
+    }
+    if (dmaPtr->DiscardMdlPtr != nullptr) {
+
+        IoFreeMdl(dmaPtr->DiscardMdlPtr);
+    }
+    if (dmaPtr->ScratchBufferPtr != nullptr) {
+
+        MmFreeContiguousMemorySpecifyCache(
+            dmaPtr->ScratchBufferPtr,
+            2 * ECSPI_DMA_SCRATCH_BUFFER_SIZE,
+            MmNonCached
+            );
+    }
+
+    RtlZeroMemory(dmaPtr, sizeof(*dmaPtr));
+}
+
+
+//
+// Routine Description:
+//
+//  ECSPIDmaShouldUseDma is called by ECSPISpbStartNextTransfer, with the
+//  device lock held, to decide whether the transfer(s) use DMA or PIO.
+//  Transfers below the DMA threshold use PIO. Transfers at or above the
+//  threshold use DMA, unless one of the following is true, in which case
+//  PIO is used and the fallback is counted:
+//  - The target does not use a GPIO for CS. In DMA mode each word is a
+//    separate burst, and the native CS would be negated between words.
+//  - A FULL_DUPLEX request with different write and read lengths.
+//  - The buffer layout would split an element between two pages.
+//  - The previous DMA transfer is still being stopped.
+//
+// Arguments:
+//
+//  DevExtPtr - The device extension.
+//
+//  Transfer1Ptr - The 1st active transfer.
+//
+//  Transfer2Ptr - The 2nd active transfer (FULL_DUPLEX only).
+//
+// Return Value:
+//
+//  TRUE if the transfer(s) use DMA, otherwise FALSE.
+//
+_Use_decl_annotations_
+BOOLEAN
+ECSPIDmaShouldUseDma (
+    ECSPI_DEVICE_EXTENSION* DevExtPtr,
+    ECSPI_SPB_TRANSFER* Transfer1Ptr,
+    ECSPI_SPB_TRANSFER* Transfer2Ptr
+    )
+{
+    ECSPI_DMA_CONTEXT* dmaPtr = &DevExtPtr->Dma;
+    const ECSPI_DMA_POLICY* policyPtr = &dmaPtr->Policy;
+    size_t length = Transfer1Ptr->SpbTransferDescriptor.TransferLength;
+
+    if (!dmaPtr->IsEnabled ||
+        !ECSPIDmaIsTransferEligible(
+            policyPtr,
+            length,
+            Transfer1Ptr->BufferStride)) {
+
+        return FALSE;
+    }
+
+    ECSPI_TARGET_CONTEXT* trgCtxPtr =
+        Transfer1Ptr->AssociatedRequestPtr->SpbTargetPtr;
+    BOOLEAN isDma =
+        (ECSPIDeviceGetCsGpio(trgCtxPtr)->WdfIoTargetGpio != NULL) &&
+        !dmaPtr->IsStopPending &&
+        (ReadNoFence(&dmaPtr->Rx.IsActive) == 0) &&
+        (ReadNoFence(&dmaPtr->Tx.IsActive) == 0) &&
+        ECSPIDmaIsBufferAligned(policyPtr, Transfer1Ptr->CurrentMdlPtr, length);
+
+    if (isDma && (Transfer2Ptr != nullptr)) {
+
+        isDma =
+            (Transfer2Ptr->SpbTransferDescriptor.TransferLength == length) &&
+            ECSPIDmaIsBufferAligned(
+                policyPtr,
+                Transfer2Ptr->CurrentMdlPtr,
+                length
+                );
+    }
+
+    if (!isDma) {
+
+        InterlockedIncrement64(&dmaPtr->Statistics.Fallbacks);
+    }
+    return isDma;
+}
+
+
+//
+// Routine Description:
+//
+//  ECSPIDmaStartTransfer is called by ECSPISpbStartNextTransfer, with the
+//  device lock held, to start a DMA transfer.
+//  The routine sets the controller to DMA mode and starts the first chunk,
+//  the DMA completion routine drives the rest of the transfer.
+//
+// Arguments:
+//
+//  DevExtPtr - The device extension.
+//
+//  Transfer1Ptr - The 1st active transfer.
+//
+//  Transfer2Ptr - The 2nd active transfer (FULL_DUPLEX only).
+//
+// Return Value:
+//
+//  NTSTATUS. On failure no DMA has been started, the controller
+//  is back in PIO mode, and the caller can use PIO.
+//
+_Use_decl_annotations_
+NTSTATUS
+ECSPIDmaStartTransfer (
+    ECSPI_DEVICE_EXTENSION* DevExtPtr,
+    ECSPI_SPB_TRANSFER* Transfer1Ptr,
+    ECSPI_SPB_TRANSFER* Transfer2Ptr
+    )
+{
+    ECSPI_DMA_CONTEXT* dmaPtr = &DevExtPtr->Dma;
+
+    if (ECSPISpbIsWriteTransfer(Transfer1Ptr)) {
+
+        dmaPtr->TxTransferPtr = Transfer1Ptr;
+        dmaPtr->RxTransferPtr = Transfer2Ptr;
+
+    } else {
+
+        ECSPI_ASSERT(DevExtPtr->IfrLogHandle, Transfer2Ptr == nullptr);
+
+        dmaPtr->TxTransferPtr = nullptr;
+        dmaPtr->RxTransferPtr = Transfer1Ptr;
+    }
+    dmaPtr->IsAborted = FALSE;
+
+    //
+    // Skip empty MDLs
+    //
+    ECSPI_SPB_TRANSFER* transfers[] = {
+        dmaPtr->TxTransferPtr,
+        dmaPtr->RxTransferPtr
+        };
+    for (ECSPI_SPB_TRANSFER* transferPtr : transfers) {
+
+        if (transferPtr != nullptr) {
+
+            ECSPIDmaAdvanceMdl(
+                &transferPtr->CurrentMdlPtr,
+                &transferPtr->CurrentMdlOffset,
+                0
+                );
+            transferPtr->IsDmaTransfer = TRUE;
+        }
+    }
+
+    ECSPIHwConfigureDmaTransfer(DevExtPtr, Transfer1Ptr);
+
+    NTSTATUS status = ECSPIpDmaStartChunk(DevExtPtr);
+    if (!NT_SUCCESS(status)) {
+
+        ECSPIHwStopDmaTransfer(DevExtPtr);
+
+        for (ECSPI_SPB_TRANSFER* transferPtr : transfers) {
+
+            if (transferPtr != nullptr) {
+
+                transferPtr->IsDmaTransfer = FALSE;
+            }
+        }
+        dmaPtr->TxTransferPtr = nullptr;
+        dmaPtr->RxTransferPtr = nullptr;
+        InterlockedIncrement64(&dmaPtr->Statistics.Fallbacks);
+    }
+    return status;
+}
+
+
+//
+// Routine Description:
+//
+//  ECSPIDmaAbortTransfer is called by ECSPISpbAbortAllTransfers, with the
+//  device lock held, to abort the DMA transfer in progress.
+//  The DMA requests are disabled right away, the system DMA transfers
+//  are stopped from the stop DPC.
+//
+// Arguments:
+//
+//  DevExtPtr - The device extension.
+//
+// Return Value:
+//
+_Use_decl_annotations_
+VOID
+ECSPIDmaAbortTransfer (
+    ECSPI_DEVICE_EXTENSION* DevExtPtr
+    )
+{
+    ECSPI_DMA_CONTEXT* dmaPtr = &DevExtPtr->Dma;
+
+    if (!dmaPtr->IsEnabled) {
+
+        return;
+    }
+
+    dmaPtr->IsAborted = TRUE;
+
+    if ((ReadNoFence(&dmaPtr->Rx.IsActive) != 0) ||
+        (ReadNoFence(&dmaPtr->Tx.IsActive) != 0)) {
+
+        ECSPI_LOG_WARNING(
+            DevExtPtr->IfrLogHandle,
+            "Aborting DMA transfer, chunk length %lu",
+            dmaPtr->ChunkLength
+            );
+
+        ECSPIHwStopDmaTransfer(DevExtPtr);
+
+        dmaPtr->IsStopPending = TRUE;
+        WdfDpcEnqueue(dmaPtr->WdfStopDpc);
+    }
+}
+
+
+//
+// Routine Description:
+//
+//  ECSPIDmaLogStatistics logs the PIO and DMA transfer statistics.
+//
+// Arguments:
+//
+//  DevExtPtr - The device extension.
+//
+// Return Value:
+//
+_Use_decl_annotations_
+VOID
+ECSPIDmaLogStatistics (
+    ECSPI_DEVICE_EXTENSION* DevExtPtr
+    )
+{
+    const ECSPI_TRANSFER_STATISTICS* pioStatsPtr = &DevExtPtr->PioStatistics;
+    const ECSPI_TRANSFER_STATISTICS* dmaStatsPtr = &DevExtPtr->DmaStatistics;
+    const ECSPI_DMA_STATISTICS* dmaPtr = &DevExtPtr->Dma.Statistics;
+
+    ECSPI_LOG_INFORMATION(
+        DevExtPtr->IfrLogHandle,
+        "PIO: %llu transfers, %llu bytes, latency avg %llu uSec "
+        "max %lu uSec, %llu KB/s",
+        pioStatsPtr->Transfers,
+        pioStatsPtr->Bytes,
+        ECSPIGetAverageUsec(pioStatsPtr),
+        pioStatsPtr->MaxUsec,
+        ECSPIGetThroughputKBps(pioStatsPtr)
+        );
+
+    ECSPI_LOG_INFORMATION(
+        DevExtPtr->IfrLogHandle,
+        "DMA: %llu transfers, %llu bytes, latency avg %llu uSec "
+        "max %lu uSec, %llu KB/s, %llu chunks, %llu fallbacks, %llu errors",
+        dmaStatsPtr->Transfers,
+        dmaStatsPtr->Bytes,
+        ECSPIGetAverageUsec(dmaStatsPtr),
+        dmaStatsPtr->MaxUsec,
+        ECSPIGetThroughputKBps(dmaStatsPtr),
+        dmaPtr->Chunks,
+        dmaPtr->Fallbacks,
+        dmaPtr->Errors
+        );
+}
+
+
+//
+// ECSPIdma private methods.
+//
+
+
+//
+// Routine Description:
+//
+//  ECSPIpDmaCreateChannel creates the WDF system DMA enabler and
+//  transaction of a single direction.
+//
+// Arguments:
+//
+//  DevExtPtr - The device extension.
+//
+//  ChannelPtr - The channel to create.
+//
+//  Direction - The channel direction.
+//
+//  DeviceAddress - The physical address of the data register.
+//
+//  DmaResourcePtr - The channel DMA resource.
+//
+// Return Value:
+//
+//  NTSTATUS
+//
+_Use_decl_annotations_
+NTSTATUS
+ECSPIpDmaCreateChannel (
+    ECSPI_DEVICE_EXTENSION* DevExtPtr,
+    ECSPI_DMA_CHANNEL* ChannelPtr,
+    WDF_DMA_DIRECTION Direction,
+    PHYSICAL_ADDRESS DeviceAddress,
+    const CM_PARTIAL_RESOURCE_DESCRIPTOR* DmaResourcePtr
+    )
+{
+    PAGED_CODE();
+
+    ChannelPtr->DevExtPtr = DevExtPtr;
+    ChannelPtr->Direction = Direction;
+    ChannelPtr->DmaRequestLine = DmaResourcePtr->u.DmaV3.RequestLine;
+
+    WDF_DMA_ENABLER_CONFIG wdfDmaEnablerConfig;
+    WDF_DMA_ENABLER_CONFIG_INIT(
+        &wdfDmaEnablerConfig,
+        WdfDmaProfileSystem,
+        SDMA_MAX_TRANSFER_LENGTH
+        );
+    wdfDmaEnablerConfig.WdmDmaVersionOverride = DEVICE_DESCRIPTION_VERSION3;
+
+    NTSTATUS status = WdfDmaEnablerCreate(
+        DevExtPtr->WdfDevice,
+        &wdfDmaEnablerConfig,
+        WDF_NO_OBJECT_ATTRIBUTES,
+        &ChannelPtr->WdfDmaEnabler
+        );
+    if (!NT_SUCCESS(status)) {
+
+        ECSPI_LOG_ERROR(
+            DevExtPtr->IfrLogHandle,
+            "WdfDmaEnablerCreate failed. status = %!STATUS!",
+            status
+            );
+        return status;
+    }
+
+    WDF_DMA_SYSTEM_PROFILE_CONFIG wdfDmaSystemProfileConfig;
+    WDF_DMA_SYSTEM_PROFILE_CONFIG_INIT(
+        &wdfDmaSystemProfileConfig,
+        DeviceAddress,
+        static_cast<DMA_WIDTH>(DmaResourcePtr->u.DmaV3.TransferWidth),
+        const_cast<PCM_PARTIAL_RESOURCE_DESCRIPTOR>(DmaResourcePtr)
+        );
+    wdfDmaSystemProfileConfig.DemandMode = TRUE;
+
+    status = WdfDmaEnablerConfigureSystemProfile(
+        ChannelPtr->WdfDmaEnabler,
+        &wdfDmaSystemProfileConfig,
+        Direction
+        );
+    if (!NT_SUCCESS(status)) {
+
+        ECSPI_LOG_ERROR(
+            DevExtPtr->IfrLogHandle,
+            "WdfDmaEnablerConfigureSystemProfile failed. status = %!STATUS!",
+            status
+            );
+        return status;
+    }
+
+    status = WdfDmaTransactionCreate(
+        ChannelPtr->WdfDmaEnabler,
+        WDF_NO_OBJECT_ATTRIBUTES,
+        &ChannelPtr->WdfDmaTransaction
+        );
+    if (!NT_SUCCESS(status)) {
+
+        ECSPI_LOG_ERROR(
+            DevExtPtr->IfrLogHandle,
+            "WdfDmaTransactionCreate failed. status = %!STATUS!",
+            status
+            );
+        return status;
+    }
+
+    ChannelPtr->DmaAdapterPtr = WdfDmaEnablerWdmGetDmaAdapter(
+        ChannelPtr->WdfDmaEnabler,
+        Direction
+        );
+
+    WdfDmaTransactionSetChannelConfigurationCallback(
+        ChannelPtr->WdfDmaTransaction,
+        ECSPIpEvtDmaConfigureChannel,
+        ChannelPtr
+        );
+
+    WdfDmaTransactionSetTransferCompleteCallback(
+        ChannelPtr->WdfDmaTransaction,
+        ECSPIpEvtDmaTransferComplete,
+        ChannelPtr
+        );
+
+    return STATUS_SUCCESS;
+}
+
+
+//
+// Routine Description:
+//
+//  ECSPIpDmaDeleteChannel releases the channel request line, and
+//  deletes the channel WDF objects.
+//
+// Arguments:
+//
+//  ChannelPtr - The channel to delete.
+//
+// Return Value:
+//
+_Use_decl_annotations_
+VOID
+ECSPIpDmaDeleteChannel (
+    ECSPI_DMA_CHANNEL* ChannelPtr
+    )
+{
+    PAGED_CODE();
+
+    if (ChannelPtr->DevExtPtr == nullptr) {
+        //
+        // Channel was never created
+        //
+        return;
+    }
+
+    ECSPI_ASSERT(
+        ChannelPtr->DevExtPtr->IfrLogHandle,
+        ChannelPtr->IsActive == 0
+        );
+
+    if (ChannelPtr->IsRequestLineAcquired) {
+
+        DMA_ADAPTER* dmaAdapterPtr = ChannelPtr->DmaAdapterPtr;
+        NTSTATUS status = dmaAdapterPtr->DmaOperations->ConfigureAdapterChannel(
+            dmaAdapterPtr,
+            SDMA_CFG_FUN_RELEASE_REQUEST_LINE,
+            &ChannelPtr->DmaRequestLine
+            );
+        if (!NT_SUCCESS(status)) {
+
+            ECSPI_LOG_WARNING(
+                ChannelPtr->DevExtPtr->IfrLogHandle,
+                "SDMA_CFG_FUN_RELEASE_REQUEST_LINE failed for line %lu. "
+                "status = %!STATUS!",
+                ChannelPtr->DmaRequestLine,
+                status
+                );
+        }
+        ChannelPtr->IsRequestLineAcquired = FALSE;
+    }
+
+    if (ChannelPtr->WdfDmaTransaction != NULL) {
+
+        WdfObjectDelete(ChannelPtr->WdfDmaTransaction);
+        ChannelPtr->WdfDmaTransaction = NULL;
+    }
+    if (ChannelPtr->WdfDmaEnabler != NULL) {
+
+        WdfObjectDelete(ChannelPtr->WdfDmaEnabler);
+        ChannelPtr->WdfDmaEnabler = NULL;
+    }
+    ChannelPtr->DmaAdapterPtr = nullptr;
+}
+
+
+//
+// Routine Description:
+//
+//  ECSPIpDmaStartChunk is called with the device lock held to start the
+//  next chunk of the DMA transfer.
+//  The RX channel is started first, so it is ready before the TX channel
+//  starts clocking data.
+//
+// Arguments:
+//
+//  DevExtPtr - The device extension.
+//
+// Return Value:
+//
+//  NTSTATUS. On failure no DMA is in progress.
+//  If the TX channel fails to start after the RX channel has started, the
+//  RX channel is stopped, and the routine returns STATUS_SUCCESS. The
+//  error is reported to the RX channel completion through ChunkStatus.
+//
+_Use_decl_annotations_
+NTSTATUS
+ECSPIpDmaStartChunk (
+    ECSPI_DEVICE_EXTENSION* DevExtPtr
+    )
+{
+    ECSPI_DMA_CONTEXT* dmaPtr = &DevExtPtr->Dma;
+    const ECSPI_DMA_POLICY* policyPtr = &dmaPtr->Policy;
+    ECSPI_SPB_TRANSFER* txTransferPtr = dmaPtr->TxTransferPtr;
+    ECSPI_SPB_TRANSFER* rxTransferPtr = dmaPtr->RxTransferPtr;
+
+    //
+    // Chunk length is limited by the data side(s), the scratch
+    // buffer side is never shorter than MaxChunkBytes.
+    //
+    ULONG chunkLength = MAXULONG;
+    ECSPI_SPB_TRANSFER* transfers[] = { txTransferPtr, rxTransferPtr };
+    for (ECSPI_SPB_TRANSFER* transferPtr : transfers) {
+
+        if (transferPtr != nullptr) {
+
+            ULONG descriptors;
+            ULONG length = ECSPIDmaGetChunkLength(
+                policyPtr,
+                transferPtr->CurrentMdlPtr,
+                transferPtr->CurrentMdlOffset,
+                ECSPISpbBytesLeftToTransfer(transferPtr),
+                &descriptors
+                );
+            chunkLength = min(chunkLength, length);
+        }
+    }
+
+    if ((chunkLength == 0) || (chunkLength == MAXULONG)) {
+
+        ECSPI_LOG_ERROR(
+            DevExtPtr->IfrLogHandle,
+            "Invalid DMA chunk length %lu!",
+            chunkLength
+            );
+        return STATUS_INVALID_BUFFER_SIZE;
+    }
+
+    dmaPtr->ChunkLength = chunkLength;
+    dmaPtr->ChunkWatermark = ECSPIDmaGetChunkWatermark(policyPtr, chunkLength);
+    dmaPtr->ChunkStatus = STATUS_SUCCESS;
+    dmaPtr->PendingChannels = 2;
+
+    ECSPIHwSetDmaWatermark(DevExtPtr, dmaPtr->ChunkWatermark);
+
+    NTSTATUS status = ECSPIpDmaStartChannel(
+        &dmaPtr->Rx,
+        rxTransferPtr != nullptr ?
+            rxTransferPtr->CurrentMdlPtr : dmaPtr->DiscardMdlPtr,
+        rxTransferPtr != nullptr ? rxTransferPtr->CurrentMdlOffset : 0,
+        chunkLength
+        );
+    if (!NT_SUCCESS(status)) {
+
+        dmaPtr->PendingChannels = 0;
+        return status;
+    }
+
+    status = ECSPIpDmaStartChannel(
+        &dmaPtr->Tx,
+        txTransferPtr != nullptr ?
+            txTransferPtr->CurrentMdlPtr : dmaPtr->ZerosMdlPtr,
+        txTransferPtr != nullptr ? txTransferPtr->CurrentMdlOffset : 0,
+        chunkLength
+        );
+    if (!NT_SUCCESS(status)) {
+        //
+        // RX would never complete, stop it.
+        //
+        dmaPtr->ChunkStatus = status;
+        dmaPtr->PendingChannels = 1;
+        dmaPtr->IsStopPending = TRUE;
+        WdfDpcEnqueue(dmaPtr->WdfStopDpc);
+    }
+
+    dmaPtr->Statistics.Chunks += 1;
+
+    ECSPI_LOG_TRACE(
+        DevExtPtr->IfrLogHandle,
+        "DMA chunk started: length %lu, watermark %lu",
+        chunkLength,
+        dmaPtr->ChunkWatermark
+        );
+
+    return STATUS_SUCCESS;
+}
+
+
+//
+// Routine Description:
+//
+//  ECSPIpDmaStartChannel starts a system DMA transaction on
+//  a single channel.
+//
+// Arguments:
+//
+//  ChannelPtr - The channel.
+//
+//  MdlPtr - The buffer MDL.
+//
+//  Offset - The buffer offset within MdlPtr.
+//
+//  Length - Number of bytes to transfer.
+//
+// Return Value:
+//
+//  NTSTATUS
+//
+_Use_decl_annotations_
+NTSTATUS
+ECSPIpDmaStartChannel (
+    ECSPI_DMA_CHANNEL* ChannelPtr,
+    PMDL MdlPtr,
+    size_t Offset,
+    ULONG Length
+    )
+{
+    WDFDMATRANSACTION wdfDmaTransaction = ChannelPtr->WdfDmaTransaction;
+
+    NTSTATUS status = WdfDmaTransactionInitializeUsingOffset(
+        wdfDmaTransaction,
+        ECSPIpEvtDmaProgramDma,
+        ChannelPtr->Direction,
+        MdlPtr,
+        Offset,
+        Length
+        );
+    if (!NT_SUCCESS(status)) {
+
+        ECSPI_LOG_ERROR(
+            ChannelPtr->DevExtPtr->IfrLogHandle,
+            "WdfDmaTransactionInitializeUsingOffset failed. "
+            "status = %!STATUS!",
+            status
+            );
+        return status;
+    }
+
+    InterlockedExchange(&ChannelPtr->IsActive, 1);
+
+    WdfDmaTransactionSetImmediateExecution(wdfDmaTransaction, TRUE);
+    status = WdfDmaTransactionExecute(wdfDmaTransaction, ChannelPtr);
+    if (!NT_SUCCESS(status)) {
+
+        InterlockedExchange(&ChannelPtr->IsActive, 0);
+        WdfDmaTransactionRelease(wdfDmaTransaction);
+
+        ECSPI_LOG_ERROR(
+            ChannelPtr->DevExtPtr->IfrLogHandle,
+            "WdfDmaTransactionExecute failed. status = %!STATUS!",
+            status
+            );
+        return status;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+//
+// Routine Description:
+//
+//  ECSPIpDmaCompleteChunk is called with the device lock held, after both
+//  channels of a chunk have completed.
+//  The routine updates the transfer(s) progress, and either starts the
+//  next chunk, or completes the transfer the way the ISR does for a PIO
+//  transfer.
+//
+// Arguments:
+//
+//  DevExtPtr - The device extension.
+//
+// Return Value:
+//
+//  STATUS_PENDING if the transfer continues, or has been aborted.
+//  STATUS_SUCCESS if the transfer is done, and the DPC needs to run.
+//  Otherwise the DMA error the request needs to be completed with.
+//
+_Use_decl_annotations_
+NTSTATUS
+ECSPIpDmaCompleteChunk (
+    ECSPI_DEVICE_EXTENSION* DevExtPtr
+    )
+{
+    ECSPI_DMA_CONTEXT* dmaPtr = &DevExtPtr->Dma;
+    ECSPI_SPB_TRANSFER* dataTransferPtr = dmaPtr->TxTransferPtr != nullptr ?
+        dmaPtr->TxTransferPtr : dmaPtr->RxTransferPtr;
+
+    if (dmaPtr->IsAborted || (dataTransferPtr == nullptr)) {
+        //
+        // The abort path owns the request
+        //
+        return STATUS_PENDING;
+    }
+
+    NTSTATUS status = dmaPtr->ChunkStatus;
+    if (NT_SUCCESS(status)) {
+
+        ECSPI_SPB_REQUEST* requestPtr = dataTransferPtr->AssociatedRequestPtr;
+        ULONG chunkLength = dmaPtr->ChunkLength;
+
+        ECSPI_SPB_TRANSFER* transfers[] = {
+            dmaPtr->TxTransferPtr,
+            dmaPtr->RxTransferPtr
+            };
+        for (ECSPI_SPB_TRANSFER* transferPtr : transfers) {
+
+            if (transferPtr != nullptr) {
+
+                transferPtr->BytesTransferred += chunkLength;
+                ECSPIDmaAdvanceMdl(
+                    &transferPtr->CurrentMdlPtr,
+                    &transferPtr->CurrentMdlOffset,
+                    chunkLength
+                    );
+                requestPtr->TotalBytesTransferred += chunkLength;
+            }
+        }
+
+        if (!ECSPISpbIsAllDataTransferred(dataTransferPtr)) {
+
+            status = ECSPIpDmaStartChunk(DevExtPtr);
+            if (NT_SUCCESS(status)) {
+
+                return STATUS_PENDING;
+            }
+        }
+    }
+
+    ECSPIHwStopDmaTransfer(DevExtPtr);
+
+    dmaPtr->TxTransferPtr = nullptr;
+    dmaPtr->RxTransferPtr = nullptr;
+
+    if (!NT_SUCCESS(status)) {
+
+        dmaPtr->Statistics.Errors += 1;
+
+        ECSPI_LOG_ERROR(
+            DevExtPtr->IfrLogHandle,
+            "DMA transfer %p failed. status = %!STATUS!",
+            dataTransferPtr,
+            status
+            );
+        return status;
+    }
+
+    ECSPI_LOG_TRACE(
+        DevExtPtr->IfrLogHandle,
+        "DMA transfer %p done, length %Iu",
+        dataTransferPtr,
+        dataTransferPtr->SpbTransferDescriptor.TransferLength
+        );
+
+    if (dataTransferPtr->AssociatedRequestPtr->Type ==
+        ECSPI_REQUEST_TYPE::SEQUENCE) {
+        //
+        // Start the next transfer if ready, or let the DPC
+        // prepare more transfers, or complete the request.
+        //
+        ECSPISpbCompleteSequenceTransfer(dataTransferPtr);
+    }
+    return STATUS_SUCCESS;
+}
+
+
+//
+// Routine Description:
+//
+//  ECSPIpEvtDmaProgramDma is called by the framework to program the DMA.
+//  Since we are using system DMA, WDF programs the SG list into the
+//  system DMA controller for us.
+//
+// Arguments:
+//
+//  See EVT_WDF_PROGRAM_DMA.
+//
+// Return Value:
+//
+//  TRUE
+//
+_Use_decl_annotations_
+BOOLEAN
+ECSPIpEvtDmaProgramDma (
+    WDFDMATRANSACTION /*WdfDmaTransaction*/,
+    WDFDEVICE /*WdfDevice*/,
+    WDFCONTEXT /*ContextPtr*/,
+    WDF_DMA_DIRECTION /*Direction*/,
+    PSCATTER_GATHER_LIST /*SgListPtr*/
+    )
+{
+    return TRUE;
+}
+
+
+//
+// Routine Description:
+//
+//  ECSPIpEvtDmaConfigureChannel is called by the framework before the DMA
+//  transfer is programmed, to set the channel watermark level.
+//
+// Arguments:
+//
+//  See EVT_WDF_DMA_TRANSACTION_CONFIGURE_DMA_CHANNEL.
+//
+// Return Value:
+//
+//  TRUE if the channel has been configured, otherwise FALSE.
+//
+_Use_decl_annotations_
+BOOLEAN
+ECSPIpEvtDmaConfigureChannel (
+    WDFDMATRANSACTION /*WdfDmaTransaction*/,
+    WDFDEVICE /*WdfDevice*/,
+    WDFCONTEXT ContextPtr,
+    PMDL /*MdlPtr*/,
+    size_t /*Offset*/,
+    size_t /*Length*/
+    )
+{
+    ECSPI_DMA_CHANNEL* channelPtr = static_cast<ECSPI_DMA_CHANNEL*>(ContextPtr);
+    ECSPI_DEVICE_EXTENSION* devExtPtr = channelPtr->DevExtPtr;
+
+    //
+    // The SDMA watermark level is in bytes
+    //
+    ULONG watermarkLevel = devExtPtr->Dma.ChunkWatermark *
+        devExtPtr->Dma.Policy.ElementSize;
+
+    DMA_ADAPTER* dmaAdapterPtr = channelPtr->DmaAdapterPtr;
+    NTSTATUS status = dmaAdapterPtr->DmaOperations->ConfigureAdapterChannel(
+        dmaAdapterPtr,
+        SDMA_CFG_FUN_SET_CHANNEL_WATERMARK_LEVEL,
+        &watermarkLevel
+        );
+    if (!NT_SUCCESS(status)) {
+
+        ECSPI_LOG_ERROR(
+            devExtPtr->IfrLogHandle,
+            "SDMA_CFG_FUN_SET_CHANNEL_WATERMARK_LEVEL failed for line %lu. "
+            "status = %!STATUS!",
+            channelPtr->DmaRequestLine,
+            status
+            );
+        return FALSE;
+    }
+    return TRUE;
+}
+
+
+//
+// Routine Description:
+//
+//  ECSPIpEvtDmaTransferComplete is called by the framework when a channel
+//  DMA transfer is done.
+//  The last channel to complete a chunk continues the transfer.
+//
+// Arguments:
+//
+//  See EVT_WDF_DMA_TRANSACTION_DMA_TRANSFER_COMPLETE.
+//
+// Return Value:
+//
+_Use_decl_annotations_
+VOID
+ECSPIpEvtDmaTransferComplete (
+    WDFDMATRANSACTION WdfDmaTransaction,
+    WDFDEVICE /*WdfDevice*/,
+    WDFCONTEXT ContextPtr,
+    WDF_DMA_DIRECTION /*Direction*/,
+    DMA_COMPLETION_STATUS DmaStatus
+    )
+{
+    ECSPI_DMA_CHANNEL* channelPtr = static_cast<ECSPI_DMA_CHANNEL*>(ContextPtr);
+    ECSPI_DEVICE_EXTENSION* devExtPtr = channelPtr->DevExtPtr;
+    ECSPI_DMA_CONTEXT* dmaPtr = &devExtPtr->Dma;
+
+    ECSPI_LOG_TRACE(
+        devExtPtr->IfrLogHandle,
+        "DMA line %lu completed. status = %!DMACOMPLETIONSTATUS!",
+        channelPtr->DmaRequestLine,
+        DmaStatus
+        );
+
+    NTSTATUS status;
+    switch (DmaStatus) {
+    case DmaComplete:
+        status = STATUS_SUCCESS;
+        break;
+
+    case DmaAborted:
+        status = STATUS_REQUEST_ABORTED;
+        break;
+
+    case DmaError:
+        status = STATUS_IO_DEVICE_ERROR;
+        break;
+
+    case DmaCancelled:
+        __fallthrough;
+
+    default:
+        status = STATUS_CANCELLED;
+        break;
+    }
+
+    NTSTATUS dmaStatus;
+    if (NT_SUCCESS(status)) {
+
+        if (!WdfDmaTransactionDmaCompleted(WdfDmaTransaction, &dmaStatus)) {
+            //
+            // More DMA transfers are pending for this transaction
+            //
+            return;
+        }
+
+    } else {
+
+        (void)WdfDmaTransactionDmaCompletedFinal(
+            WdfDmaTransaction,
+            0,
+            &dmaStatus
+            );
+    }
+    WdfDmaTransactionRelease(WdfDmaTransaction);
+
+    //
+    // Continue the transfer when both channels are done
+    //
+    {
+        KLOCK_QUEUE_HANDLE lockHandle;
+        KeAcquireInStackQueuedSpinLock(&devExtPtr->DeviceLock, &lockHandle);
+
+        InterlockedExchange(&channelPtr->IsActive, 0);
+
+        if (!NT_SUCCESS(status) && NT_SUCCESS(dmaPtr->ChunkStatus)) {
+
+            dmaPtr->ChunkStatus = status;
+        }
+
+        ECSPI_ASSERT(devExtPtr->IfrLogHandle, dmaPtr->PendingChannels > 0);
+        dmaPtr->PendingChannels -= 1;
+        if (dmaPtr->PendingChannels != 0) {
+
+            KeReleaseInStackQueuedSpinLock(&lockHandle);
+            return;
+        }
+
+        status = ECSPIpDmaCompleteChunk(devExtPtr);
+
+        KeReleaseInStackQueuedSpinLock(&lockHandle);
+
+    } // Continue the transfer when both channels are done
+
+    if (status == STATUS_PENDING) {
+
+        return;
+    }
+
+    ECSPI_SPB_REQUEST* requestPtr = &devExtPtr->CurrentRequest;
+    if (NT_SUCCESS(status)) {
+        //
+        // Continue in DPC, as the ISR does...
+        //
+        WdfInterruptQueueDpcForIsr(devExtPtr->WdfSpiInterrupt);
+        return;
+    }
+
+    //
+    // Complete the request with the DMA error
+    //
+    NTSTATUS cancelStatus = ECSPIDeviceDisableRequestCancellation(requestPtr);
+    if (NT_SUCCESS(cancelStatus)) {
+
+        ECSPISpbCompleteTransferRequest(
+            requestPtr,
+            status,
+            requestPtr->TotalBytesTransferred
+            );
+    }
+}
+
+
+//
+// Routine Description:
+//
+//  ECSPIpEvtDmaStopDpc stops the active system DMA transfers after
+//  an abort, or after a chunk failed to start.
+//  The completion routine of each stopped channel is called with
+//  DmaCancelled.
+//
+// Arguments:
+//
+//  WdfDpc - The stop DPC.
+//
+// Return Value:
+//
+_Use_decl_annotations_
+VOID
+ECSPIpEvtDmaStopDpc (
+    WDFDPC WdfDpc
+    )
+{
+    ECSPI_DEVICE_EXTENSION* devExtPtr = ECSPIDeviceGetExtension(
+        static_cast<WDFDEVICE>(WdfDpcGetParentObject(WdfDpc))
+        );
+    ECSPI_DMA_CONTEXT* dmaPtr = &devExtPtr->Dma;
+
+    ECSPI_DMA_CHANNEL* channels[] = { &dmaPtr->Rx, &dmaPtr->Tx };
+    for (ECSPI_DMA_CHANNEL* channelPtr : channels) {
+
+        if (ReadNoFence(&channelPtr->IsActive) != 0) {
+
+            WdfDmaTransactionStopSystemTransfer(channelPtr->WdfDmaTransaction);
+        }
+    }
+
+    KLOCK_QUEUE_HANDLE lockHandle;
+    KeAcquireInStackQueuedSpinLock(&devExtPtr->DeviceLock, &lockHandle);
+
+    dmaPtr->IsStopPending = FALSE;
+
+    KeReleaseInStackQueuedSpinLock(&lockHandle);
+}
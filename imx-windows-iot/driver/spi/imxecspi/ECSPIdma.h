@@ -0,0 +1,240 @@
+// Copyright 2023 NXP
+// Licensed under the MIT License.
+//
+// Module Name:
+//
+//    ECSPIdma.h
+//
+// Abstract:
+//
+//    This module contains all the enums, types, and functions related to
+//    the IMX ECSPI controller system DMA (SDMA) transfers.
+//    This controller driver uses the SPB WDF class extension (SpbCx).
+//
+// Environment:
+//
+//    kernel-mode only
+//
+
+#ifndef _ECSPI_DMA_H_
+#define _ECSPI_DMA_H_
+
+WDF_EXTERN_C_START
+
+
+//
+// ECSPI DMA parameters
+//
+enum : ULONG {
+    //
+    // Size of the buffer that provides the 0s to clock in read transfers,
+    // and receives the data clocked in by write transfers.
+    // It is also the max DMA chunk length.
+    //
+    ECSPI_DMA_SCRATCH_BUFFER_SIZE = 32 * 1024,
+
+    //
+    // FIFO entries the DMA moves per request
+    //
+    ECSPI_DMA_WATERMARK = ECSPI_FIFO_DEPTH / 2,
+};
+
+
+//
+// ECSPI_DMA_CHANNEL.
+//  A single direction system DMA channel.
+//
+typedef struct _ECSPI_DMA_CHANNEL
+{
+    //
+    // The owning device extension
+    //
+    ECSPI_DEVICE_EXTENSION* DevExtPtr;
+
+    //
+    // The channel direction
+    //
+    WDF_DMA_DIRECTION Direction;
+
+    //
+    // WDF system DMA objects
+    //
+    WDFDMAENABLER WdfDmaEnabler;
+    WDFDMATRANSACTION WdfDmaTransaction;
+    DMA_ADAPTER* DmaAdapterPtr;
+
+    //
+    // SDMA request line, and if we own it
+    //
+    ULONG DmaRequestLine;
+    BOOLEAN IsRequestLineAcquired;
+
+    //
+    // If a DMA transaction is in progress
+    //
+    LONG IsActive;
+
+} ECSPI_DMA_CHANNEL;
+
+
+//
+// ECSPI_DMA_CONTEXT.
+//  The DMA resources and the state of the DMA transfer in progress.
+//
+typedef struct _ECSPI_DMA_CONTEXT
+{
+    //
+    // If DMA can be used
+    //
+    BOOLEAN IsEnabled;
+
+    //
+    // The PIO/DMA crossover policy
+    //
+    ECSPI_DMA_POLICY Policy;
+
+    //
+    // RX/TX channels
+    //
+    ECSPI_DMA_CHANNEL Rx;
+    ECSPI_DMA_CHANNEL Tx;
+
+    //
+    // The scratch buffer, the first half is the 0s TX source,
+    // the second half is the RX sink.
+    //
+    UCHAR* ScratchBufferPtr;
+    PMDL ZerosMdlPtr;
+    PMDL DiscardMdlPtr;
+
+    //
+    // The transfer in progress.
+    // TxTransferPtr is NULL for read transfers, and
+    // RxTransferPtr is NULL for write transfers.
+    //
+    ECSPI_SPB_TRANSFER* TxTransferPtr;
+    ECSPI_SPB_TRANSFER* RxTransferPtr;
+
+    //
+    // The chunk in progress
+    //
+    ULONG ChunkLength;
+    ULONG ChunkWatermark;
+    LONG PendingChannels;
+    NTSTATUS ChunkStatus;
+
+    //
+    // Set when the transfer is aborted
+    //
+    BOOLEAN IsAborted;
+
+    //
+    // Stops the system DMA transfers outside the device lock,
+    // IsStopPending is set until it is done.
+    //
+    WDFDPC WdfStopDpc;
+    BOOLEAN IsStopPending;
+
+    //
+    // Statistics
+    //
+    ECSPI_DMA_STATISTICS Statistics;
+
+} ECSPI_DMA_CONTEXT;
+
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+ECSPIDmaInitialize (
+    _In_ ECSPI_DEVICE_EXTENSION* DevExtPtr,
+    _In_ const CM_PARTIAL_RESOURCE_DESCRIPTOR* MemResourcePtr,
+    _In_ const CM_PARTIAL_RESOURCE_DESCRIPTOR* RxDmaResourcePtr,
+    _In_ const CM_PARTIAL_RESOURCE_DESCRIPTOR* TxDmaResourcePtr
+    );
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+VOID
+ECSPIDmaDeinitialize (
+    _In_ ECSPI_DEVICE_EXTENSION* DevExtPtr
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+ECSPIDmaShouldUseDma (
+    _In_ ECSPI_DEVICE_EXTENSION* DevExtPtr,
+    _In_ ECSPI_SPB_TRANSFER* Transfer1Ptr,
+    _In_opt_ ECSPI_SPB_TRANSFER* Transfer2Ptr
+    );
+
+_IRQL_requires_(DISPATCH_LEVEL)
+NTSTATUS
+ECSPIDmaStartTransfer (
+    _In_ ECSPI_DEVICE_EXTENSION* DevExtPtr,
+    _In_ ECSPI_SPB_TRANSFER* Transfer1Ptr,
+    _In_opt_ ECSPI_SPB_TRANSFER* Transfer2Ptr
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+ECSPIDmaAbortTransfer (
+    _In_ ECSPI_DEVICE_EXTENSION* DevExtPtr
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+ECSPIDmaLogStatistics (
+    _In_ ECSPI_DEVICE_EXTENSION* DevExtPtr
+    );
+
+//
+// ECSPIdma private methods
+//
+#ifdef _ECSPI_DMA_CPP_
+
+    _IRQL_requires_max_(PASSIVE_LEVEL)
+    static NTSTATUS
+    ECSPIpDmaCreateChannel (
+        _In_ ECSPI_DEVICE_EXTENSION* DevExtPtr,
+        _In_ ECSPI_DMA_CHANNEL* ChannelPtr,
+        _In_ WDF_DMA_DIRECTION Direction,
+        _In_ PHYSICAL_ADDRESS DeviceAddress,
+        _In_ const CM_PARTIAL_RESOURCE_DESCRIPTOR* DmaResourcePtr
+        );
+
+    _IRQL_requires_max_(PASSIVE_LEVEL)
+    static VOID
+    ECSPIpDmaDeleteChannel (
+        _In_ ECSPI_DMA_CHANNEL* ChannelPtr
+        );
+
+    _IRQL_requires_(DISPATCH_LEVEL)
+    static NTSTATUS
+    ECSPIpDmaStartChunk (
+        _In_ ECSPI_DEVICE_EXTENSION* DevExtPtr
+        );
+
+    _IRQL_requires_(DISPATCH_LEVEL)
+    static NTSTATUS
+    ECSPIpDmaStartChannel (
+        _In_ ECSPI_DMA_CHANNEL* ChannelPtr,
+        _In_ PMDL MdlPtr,
+        _In_ size_t Offset,
+        _In_ ULONG Length
+        );
+
+    _IRQL_requires_(DISPATCH_LEVEL)
+    static NTSTATUS
+    ECSPIpDmaCompleteChunk (
+        _In_ ECSPI_DEVICE_EXTENSION* DevExtPtr
+        );
+
+    static EVT_WDF_PROGRAM_DMA ECSPIpEvtDmaProgramDma;
+    static EVT_WDF_DMA_TRANSACTION_CONFIGURE_DMA_CHANNEL ECSPIpEvtDmaConfigureChannel;
+    static EVT_WDF_DMA_TRANSACTION_DMA_TRANSFER_COMPLETE ECSPIpEvtDmaTransferComplete;
+    static EVT_WDF_DPC ECSPIpEvtDmaStopDpc;
+
+#endif // _ECSPI_DMA_CPP_
+
+WDF_EXTERN_C_END
+
+#endif // !_ECSPI_DMA_H_
@@ -0,0 +1,26 @@
+// Copyright 2023 NXP
+// Licensed under the MIT License.
+//
+// Module Name:
+//
+//    ECSPIdmamap.h
+//
+// Abstract:
+//
+//    This module declares the PIO/DMA crossover policy, the mapping of
+//    the transfer MDL chain to DMA chunks, and the transfer statistics
+//    of the IMX ECSPI controller driver, from the module shared with the
+//    other SPI driver (SpiDmaMap.h), with the ECSPI prefix.
+//
+// Environment:
+//
+//    kernel-mode only
+//
+
+#ifndef _ECSPI_DMA_MAP_H_
+#define _ECSPI_DMA_MAP_H_
+
+#define SPI_DMA_MAP_PREFIX ECSPI
+#include "SpiDmaMap.h"
+
+#endif // !_ECSPI_DMA_MAP_H_
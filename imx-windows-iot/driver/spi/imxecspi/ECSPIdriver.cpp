@@ -29,6 +29,8 @@
 // Module specific header files
 #include "ECSPIhw.h"
 #include "ECSPIspb.h"
+#include "ECSPIdmamap.h"
+#include "ECSPIdma.h"
 #include "ECSPIdriver.h"
 #include "ECSPIdevice.h"
 
@@ -475,6 +477,12 @@ ECSPIpDriverReadConfig ()
             FIELD_SIZE(ECSPI_DRIVER_EXTENSION, Flags),
             0,
         },
+        {
+            REGSTR_VAL_DMA_THRESHOLD,
+            &drvExtPtr->DmaThresholdBytes,
+            FIELD_SIZE(ECSPI_DRIVER_EXTENSION, DmaThresholdBytes),
+            ECSPI_DMA_THRESHOLD_DEFAULT,
+        },
 
     }; // regValues
 
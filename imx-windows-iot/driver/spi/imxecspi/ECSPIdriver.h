@@ -26,6 +26,7 @@ WDF_EXTERN_C_START
 #define REGSTR_VAL_REFERENCE_CLOCK_HZ L"ReferenceClockHz"
 #define REGSTR_VAL_REFERENCE_MAX_SPEED_HZ L"MaxSpeedHz"
 #define REGSTR_VAL_FLAGS L"Flags"
+#define REGSTR_VAL_DMA_THRESHOLD L"DmaThresholdBytes"
 
 
 //
@@ -75,6 +76,13 @@ typedef struct _ECSPI_DRIVER_EXTENSION
     //
     ULONG Flags;
 
+    //
+    // Transfers of at least DmaThresholdBytes use DMA.
+    // Optional, 0 (default) is one TX FIFO fill,
+    // 0xFFFFFFFF disables DMA.
+    //
+    ULONG DmaThresholdBytes;
+
 } ECSPI_DRIVER_EXTENSION;
 
 WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(ECSPI_DRIVER_EXTENSION, ECSPIDriverGetExtension);
@@ -155,6 +163,24 @@ ECSPIDriverGetFlags ()
     return ECSPIDriverGetDriverExtension()->Flags;
 }
 
+//
+// Routine Description:
+//
+//  ECSPIDriverGetDmaThreshold returns the configured DMA threshold.
+//
+// Arguments:
+//
+// Return Value:
+//
+// The DmaThresholdBytes parameter
+//
+__forceinline
+ULONG
+ECSPIDriverGetDmaThreshold ()
+{
+    return ECSPIDriverGetDriverExtension()->DmaThresholdBytes;
+}
+
 //
 // Routine Description:
 //
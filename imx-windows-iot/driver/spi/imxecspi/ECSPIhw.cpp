@@ -30,6 +30,8 @@
 // Module specific header files
 #include "ECSPIhw.h"
 #include "ECSPIspb.h"
+#include "ECSPIdmamap.h"
+#include "ECSPIdma.h"
 #include "ECSPIdriver.h"
 #include "ECSPIdevice.h"
 
@@ -798,6 +800,124 @@ ECSPIHwDisableTransferInterrupts (
 }
 
 
+//
+// Routine Description:
+//
+//  ECSPIHwConfigureDmaTransfer is called to set the controller to
+//  DMA mode.
+//  In DMA mode each FIFO entry is a single data word (burst), and bursts
+//  start as soon as TX FIFO is not empty, so the SDMA keeps the
+//  controller busy without CPU intervention.
+//  ECSPI interrupts are not used, the transfer progress is driven
+//  by the DMA completion.
+//
+// Arguments:
+//
+//  DevExtPtr - The device extension.
+//
+//  TransferPtr - The transfer descriptor
+//
+// Return Value:
+//
+_Use_decl_annotations_
+VOID
+ECSPIHwConfigureDmaTransfer (
+    ECSPI_DEVICE_EXTENSION* DevExtPtr,
+    ECSPI_SPB_TRANSFER* TransferPtr
+    )
+{
+    volatile ECSPI_REGISTERS* ecspiRegsPtr = DevExtPtr->ECSPIRegsPtr;
+
+    WRITE_REGISTER_NOFENCE_ULONG(&ecspiRegsPtr->INTREG, 0);
+    WRITE_REGISTER_NOFENCE_ULONG(&ecspiRegsPtr->DMAREG, 0);
+
+    ECSPI_CONREG ctrlReg = {
+        READ_REGISTER_NOFENCE_ULONG(&ecspiRegsPtr->CONREG)
+        };
+    ctrlReg.BURST_LENGTH = (TransferPtr->BufferStride * 8) - 1;
+    ctrlReg.SMC = ECSPI_START_MODE::IMMEDIATE;
+    WRITE_REGISTER_NOFENCE_ULONG(&ecspiRegsPtr->CONREG, ctrlReg.AsUlong);
+    TransferPtr->IsStartBurst = FALSE;
+
+    #ifdef DBG
+        ECSPIpHwEnableLoopbackIf(DevExtPtr);
+    #endif // DBG
+}
+
+
+//
+// Routine Description:
+//
+//  ECSPIHwSetDmaWatermark is called to set the RX/TX DMA request
+//  thresholds, and enable the DMA requests.
+//  TX DMA request is asserted while TX FIFO has room for a watermark of
+//  entries, RX DMA request is asserted when RX FIFO holds a watermark
+//  of entries.
+//
+// Arguments:
+//
+//  DevExtPtr - The device extension.
+//
+//  WatermarkLevel - The number of FIFO entries per DMA request.
+//
+// Return Value:
+//
+_Use_decl_annotations_
+VOID
+ECSPIHwSetDmaWatermark (
+    ECSPI_DEVICE_EXTENSION* DevExtPtr,
+    ULONG WatermarkLevel
+    )
+{
+    volatile ECSPI_REGISTERS* ecspiRegsPtr = DevExtPtr->ECSPIRegsPtr;
+
+    ECSPI_ASSERT(
+        DevExtPtr->IfrLogHandle,
+        (WatermarkLevel > 0) && (WatermarkLevel <= (ECSPI_FIFO_DEPTH / 2))
+        );
+
+    ECSPI_DMAREG dmaReg = { 0 };
+    dmaReg.TX_THRESHOLD = WatermarkLevel;
+    dmaReg.TEDEN = 1;
+    dmaReg.RX_THRESHOLD = WatermarkLevel - 1;
+    dmaReg.RXDEN = 1;
+    WRITE_REGISTER_NOFENCE_ULONG(&ecspiRegsPtr->DMAREG, dmaReg.AsUlong);
+}
+
+
+//
+// Routine Description:
+//
+//  ECSPIHwStopDmaTransfer is called to disable the DMA requests, and
+//  set the controller back to PIO mode.
+//
+// Arguments:
+//
+//  DevExtPtr - The device extension.
+//
+// Return Value:
+//
+_Use_decl_annotations_
+VOID
+ECSPIHwStopDmaTransfer (
+    ECSPI_DEVICE_EXTENSION* DevExtPtr
+    )
+{
+    volatile ECSPI_REGISTERS* ecspiRegsPtr = DevExtPtr->ECSPIRegsPtr;
+
+    WRITE_REGISTER_NOFENCE_ULONG(&ecspiRegsPtr->DMAREG, 0);
+
+    ECSPI_CONREG ctrlReg = {
+        READ_REGISTER_NOFENCE_ULONG(&ecspiRegsPtr->CONREG)
+        };
+    if (ctrlReg.EN != 0) {
+
+        ctrlReg.SMC = ECSPI_START_MODE::XCH;
+        WRITE_REGISTER_NOFENCE_ULONG(&ecspiRegsPtr->CONREG, ctrlReg.AsUlong);
+    }
+}
+
+
 //
 // Routine Description:
 //
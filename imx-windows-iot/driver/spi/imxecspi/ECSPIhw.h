@@ -539,6 +539,23 @@ ECSPIHwDisableTransferInterrupts (
     _In_ const ECSPI_SPB_TRANSFER* TransferPtr
     );
 
+VOID
+ECSPIHwConfigureDmaTransfer (
+    _In_ ECSPI_DEVICE_EXTENSION* DevExtPtr,
+    _In_ ECSPI_SPB_TRANSFER* TransferPtr
+    );
+
+VOID
+ECSPIHwSetDmaWatermark (
+    _In_ ECSPI_DEVICE_EXTENSION* DevExtPtr,
+    _In_ ULONG WatermarkLevel
+    );
+
+VOID
+ECSPIHwStopDmaTransfer (
+    _In_ ECSPI_DEVICE_EXTENSION* DevExtPtr
+    );
+
 BOOLEAN
 ECSPIpHwStartBurstIf (
     _In_ ECSPI_DEVICE_EXTENSION* DevExtPtr,
@@ -30,6 +30,8 @@
 // Module specific header files
 #include "ECSPIhw.h"
 #include "ECSPIspb.h"
+#include "ECSPIdmamap.h"
+#include "ECSPIdma.h"
 #include "ECSPIdevice.h"
 
 
@@ -787,6 +789,9 @@ ECSPISpbPrepareNextTransfer (
 //
 //  ECSPISpbStartNextTransfer is called to start the next IO transfer.
 //  The routine prepares the HW and starts the transfer.
+//  Transfers at or above the DMA threshold are started as DMA transfers,
+//  which can only be done at IRQL <= DISPATCH_LEVEL. When called from the
+//  ISR, the routine leaves a DMA transfer to the DPC.
 //
 // Arguments:
 //
@@ -798,7 +803,8 @@ ECSPISpbPrepareNextTransfer (
 // Return Value:
 //
 //  NTSTATUS: STATUS_SUCCESS, or STATUS_NO_MORE_FILES if there are no
-//      more prepared transfers.
+//      more prepared transfers, or the next transfer needs to be
+//      started from the DPC.
 //
 _Use_decl_annotations_
 NTSTATUS
@@ -859,6 +865,46 @@ ECSPISpbStartNextTransfer (
             );
     }
 
+    //
+    // Latency is measured from the first start attempt
+    //
+    ECSPI_SPB_TRANSFER* activeXfers[] = { activeXfer1Ptr, activeXfer2Ptr };
+    for (ECSPI_SPB_TRANSFER* transferPtr : activeXfers) {
+
+        if ((transferPtr != nullptr) && (transferPtr->StartTicks == 0)) {
+
+            transferPtr->StartTicks = KeQueryPerformanceCounter(nullptr).QuadPart;
+        }
+    }
+
+    if (ECSPIDmaShouldUseDma(devExtPtr, activeXfer1Ptr, activeXfer2Ptr)) {
+
+        if (KeGetCurrentIrql() > DISPATCH_LEVEL) {
+            //
+            // Let the DPC start the DMA transfer
+            //
+            return STATUS_NO_MORE_FILES;
+        }
+
+        ECSPIHwClearFIFOs(devExtPtr);  // only clears Rx fifo
+
+        NTSTATUS status = ECSPIDmaStartTransfer(
+            devExtPtr,
+            activeXfer1Ptr,
+            activeXfer2Ptr
+            );
+        if (NT_SUCCESS(status)) {
+
+            return STATUS_SUCCESS;
+        }
+
+        ECSPI_LOG_WARNING(
+            devExtPtr->IfrLogHandle,
+            "ECSPIDmaStartTransfer failed, using PIO. status = %!STATUS!",
+            status
+            );
+    }
+
     ECSPIHwClearFIFOs(devExtPtr);  // only clears Rx fifo
 
     //
@@ -1044,6 +1090,8 @@ ECSPISpbCompleteSequenceTransfer (
 
     ECSPIHwDisableTransferInterrupts(devExtPtr, TransferPtr);
 
+    ECSPISpbRecordTransfer(TransferPtr);
+
     InterlockedDecrement(
         reinterpret_cast<volatile LONG*>(&requestPtr->ReadyTransferCount)
         );
@@ -1069,6 +1117,41 @@ ECSPISpbCompleteSequenceTransfer (
     }
 }
 
+//
+// Routine Description:
+//
+//  ECSPISpbRecordTransfer is called when a transfer is complete, to add
+//  the transfer latency and length to the PIO or DMA statistics.
+//
+// Arguments:
+//
+//  TransferPtr - The completed transfer context.
+//
+// Return Value:
+//
+_Use_decl_annotations_
+VOID
+ECSPISpbRecordTransfer (
+    ECSPI_SPB_TRANSFER* TransferPtr
+    )
+{
+    ECSPI_DEVICE_EXTENSION* devExtPtr =
+        TransferPtr->AssociatedRequestPtr->SpbTargetPtr->DevExtPtr;
+
+    LARGE_INTEGER frequency;
+    LONGLONG elapsedTicks =
+        KeQueryPerformanceCounter(&frequency).QuadPart - TransferPtr->StartTicks;
+    ULONG64 latencyUsec =
+        (ULONG64(elapsedTicks) * 1000000) / ULONG64(frequency.QuadPart);
+
+    ECSPIRecordTransfer(
+        TransferPtr->IsDmaTransfer ?
+            &devExtPtr->DmaStatistics : &devExtPtr->PioStatistics,
+        TransferPtr->SpbTransferDescriptor.TransferLength,
+        latencyUsec > MAXULONG ? MAXULONG : ULONG(latencyUsec)
+        );
+}
+
 //
 // Routine Description:
 //
@@ -1131,6 +1214,8 @@ ECSPISpbAbortAllTransfers (
     ECSPI_TARGET_CONTEXT* trgCtxPtr = RequestPtr->SpbTargetPtr;
     ECSPI_DEVICE_EXTENSION* devExtPtr = trgCtxPtr->DevExtPtr;
 
+    ECSPIDmaAbortTransfer(devExtPtr);
+
     WdfInterruptAcquireLock(devExtPtr->WdfSpiInterrupt);
 
     ECSPIHwUnselectTarget(trgCtxPtr);
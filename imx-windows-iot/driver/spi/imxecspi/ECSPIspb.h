@@ -186,6 +186,17 @@ typedef struct _ECSPI_SPB_TRANSFER {
     //
     ULONG BufferStride;
 
+    //
+    // Performance counter at transfer start, for the
+    // transfer statistics.
+    //
+    LONGLONG StartTicks;
+
+    //
+    // If the transfer is moved by the DMA
+    //
+    BOOLEAN IsDmaTransfer;
+
 } ECSPI_SPB_TRANSFER;
 
 
@@ -656,6 +667,11 @@ ECSPISpbCompleteSequenceTransfer (
     _In_ ECSPI_SPB_TRANSFER* TransferPtr
     );
 
+VOID
+ECSPISpbRecordTransfer (
+    _In_ ECSPI_SPB_TRANSFER* TransferPtr
+    );
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 VOID
 ECSPISpbAbortAllTransfers(
@@ -103,6 +103,7 @@ extern BOOLEAN ECSPIBreakPoint ();
 
 // begin_wpp config
 // CUSTOM_TYPE(REQUESTTYPE, ItemEnum(ECSPI_REQUEST_TYPE));
+// CUSTOM_TYPE(DMACOMPLETIONSTATUS, ItemEnum(DMA_COMPLETION_STATUS));
 // end_wpp
 
 
@@ -30,6 +30,8 @@
 // Module specific header files
 #include "LPSPIhw.h"
 #include "LPSPIspb.h"
+#include "LPSPIdmamap.h"
+#include "LPSPIdma.h"
 #include "LPSPIdriver.h"
 #include "LPSPIdevice.h"
 #include <acpiioct.h>
@@ -77,7 +79,9 @@ LPSPIEvtDevicePrepareHardware (
     ULONG numIntResourcesFound = 0;
     ULONG numMemResourcesFound = 0;
     ULONG numConnectionResourcesFound = 0;
+    ULONG numDmaResourcesFound = 0;
     const CM_PARTIAL_RESOURCE_DESCRIPTOR* memResourceDescPtr = nullptr;
+    const CM_PARTIAL_RESOURCE_DESCRIPTOR* dmaResourceDescPtrs[2] = { nullptr };
     ULONG traceLogId = 0;
 
     for (ULONG resInx = 0; resInx < numResourses; ++resInx) {
@@ -195,6 +199,25 @@ LPSPIEvtDevicePrepareHardware (
             } // New CS GPIO pin entry
             break;
 
+        case CmResourceTypeDma:
+            //
+            // Optional RX and TX DMA channels, in this order.
+            //
+            if (numDmaResourcesFound < ARRAYSIZE(dmaResourceDescPtrs)) {
+
+                dmaResourceDescPtrs[numDmaResourcesFound] = resDescPtr;
+
+            } else {
+
+                LPSPI_LOG_WARNING(
+                    DRIVER_LOG_HANDLE,
+                    "Unexpected additional DMA resource %lu, ignored!",
+                    numDmaResourcesFound
+                    );
+            }
+            ++numDmaResourcesFound;
+            break;
+
         default:
             LPSPI_ASSERT(DRIVER_LOG_HANDLE, FALSE);
             break;
@@ -264,6 +287,34 @@ LPSPIEvtDevicePrepareHardware (
         PVOID(devExtPtr->LPSPIRegsPtr)
         );
 
+    //
+    // DMA is optional, on failure all transfers use PIO.
+    //
+    if (numDmaResourcesFound >= ARRAYSIZE(dmaResourceDescPtrs)) {
+
+        status = LPSPIDmaInitialize(
+            devExtPtr,
+            memResourceDescPtr,
+            dmaResourceDescPtrs[0],
+            dmaResourceDescPtrs[1]
+            );
+        if (!NT_SUCCESS(status)) {
+
+            LPSPI_LOG_WARNING(
+                devExtPtr->IfrLogHandle,
+                "LPSPIDmaInitialize failed, using PIO. status = %!STATUS!",
+                status
+                );
+        }
+
+    } else if (numDmaResourcesFound != 0) {
+
+        LPSPI_LOG_WARNING(
+            devExtPtr->IfrLogHandle,
+            "Both RX and TX DMA resources are required, using PIO"
+            );
+    }
+
     return STATUS_SUCCESS;
 }
 
@@ -299,6 +350,9 @@ LPSPIEvtDeviceReleaseHardware (
 
     UNREFERENCED_PARAMETER(ResourcesTranslated);
 
+    LPSPIDmaLogStatistics(devExtPtr);
+    LPSPIDmaDeinitialize(devExtPtr);
+
     if (devExtPtr->LPSPIRegsPtr != nullptr) {
 
         MmUnmapIoSpace(
@@ -789,12 +843,14 @@ LPSPIEvtInterruptDpc (
             devExtPtr->IfrLogHandle,
             LPSPISpbIsAllDataTransferred(transfer1Ptr)
             );
+        LPSPISpbRecordTransfer(transfer1Ptr);
         if (transfer2Ptr != nullptr) {
 
             LPSPI_ASSERT(
                 devExtPtr->IfrLogHandle,
                 LPSPISpbIsAllDataTransferred(transfer2Ptr)
                 );
+            LPSPISpbRecordTransfer(transfer2Ptr);
         }
 
         break;
@@ -1863,6 +1919,7 @@ NTSTATUS LPSPIGetConfigValues(
     DriverSpiConfigPtr->ReferenceClockHz = 0;
     DriverSpiConfigPtr->MaxConnectionSpeedHz = 0;
     DriverSpiConfigPtr->SampleOnDelayedSckEdge = FALSE;
+    DriverSpiConfigPtr->DmaThresholdBytes = LPSPI_DMA_THRESHOLD_DEFAULT;
 
     status = AcpiQueryDsd(pdoPtr, &dsdBufferPtr);
 
@@ -1917,6 +1974,19 @@ NTSTATUS LPSPIGetConfigValues(
         );
     }
 
+    //
+    // Optional, a missing value leaves the default threshold.
+    //
+    if (!NT_SUCCESS(AcpiDevicePropertiesQueryIntegerValue(devicePropertiesPkgPtr,
+            "DmaThresholdBytes", &DriverSpiConfigPtr->DmaThresholdBytes))) {
+        LPSPI_LOG_INFORMATION(
+            DRIVER_LOG_HANDLE,
+            "LPSPIGetConfigValues() - No DmaThresholdBytes in ACPI, using default, "
+            "wdfDevice = %p",
+            Device
+        );
+    }
+
     status = AcpiDevicePropertiesQueryIntegerValue(devicePropertiesPkgPtr,
         "SampleOnDelayedSckEdge", &DriverSpiConfigPtr->SampleOnDelayedSckEdge);
 
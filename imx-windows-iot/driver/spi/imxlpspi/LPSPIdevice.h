@@ -68,6 +68,7 @@ typedef struct _LPSPI_CONFIG_DATA {
     ULONG ReferenceClockHz;
     ULONG MaxConnectionSpeedHz;
     ULONG SampleOnDelayedSckEdge;
+    ULONG DmaThresholdBytes;
 } LPSPI_CONFIG_DATA;
 
 typedef struct _LPSPI_HW_VERSION {
@@ -156,6 +157,13 @@ typedef struct _LPSPI_DEVICE_EXTENSION
     //
     BOOLEAN SampleOnDelayedSckEdge;
 
+    //
+    // Transfers of at least DmaThresholdBytes use DMA.
+    // Optional, 0 (default) is one TX FIFO fill,
+    // 0xFFFFFFFF disables DMA.
+    //
+    ULONG DmaThresholdBytes;
+
     //
     // LPSPI configuration
     // 
@@ -182,6 +190,17 @@ typedef struct _LPSPI_DEVICE_EXTENSION
     //
     ULONG PrescaleMax;
 
+    //
+    // The DMA resources and state
+    //
+    LPSPI_DMA_CONTEXT Dma;
+
+    //
+    // PIO/DMA transfer statistics
+    //
+    LPSPI_TRANSFER_STATISTICS PioStatistics;
+    LPSPI_TRANSFER_STATISTICS DmaStatistics;
+
 } LPSPI_DEVICE_EXTENSION;
 
 WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(LPSPI_DEVICE_EXTENSION, LPSPIDeviceGetExtension);
@@ -0,0 +1,238 @@
+// Copyright 2023 NXP
+// Licensed under the MIT License.
+//
+// Module Name:
+//
+//    LPSPIdma.h
+//
+// Abstract:
+//
+//    This module contains all the enums, types, and functions related to
+//    the IMX LPSPI controller system DMA transfers.
+//    This controller driver uses the SPB WDF class extension (SpbCx).
+//
+// Environment:
+//
+//    kernel-mode only
+//
+
+#ifndef _LPSPI_DMA_H_
+#define _LPSPI_DMA_H_
+
+WDF_EXTERN_C_START
+
+
+//
+// LPSPI DMA parameters
+//
+enum : ULONG {
+    //
+    // Size of the buffer that provides the 0s to clock in read transfers,
+    // and receives the data clocked in by write transfers.
+    // It is also the max DMA chunk length.
+    //
+    LPSPI_DMA_SCRATCH_BUFFER_SIZE = 32 * 1024,
+
+    //
+    // Max number of scatter/gather entries (pages) a DMA chunk may span
+    //
+    LPSPI_DMA_MAX_SG_ENTRIES = 16,
+};
+
+
+//
+// LPSPI_DMA_CHANNEL.
+//  A single direction system DMA channel.
+//
+typedef struct _LPSPI_DMA_CHANNEL
+{
+    //
+    // The owning device extension
+    //
+    LPSPI_DEVICE_EXTENSION* DevExtPtr;
+
+    //
+    // The channel direction
+    //
+    WDF_DMA_DIRECTION Direction;
+
+    //
+    // WDF system DMA objects
+    //
+    WDFDMAENABLER WdfDmaEnabler;
+    WDFDMATRANSACTION WdfDmaTransaction;
+    DMA_ADAPTER* DmaAdapterPtr;
+
+    //
+    // The DMA request line, for logging
+    //
+    ULONG DmaRequestLine;
+
+    //
+    // If a DMA transaction is in progress
+    //
+    LONG IsActive;
+
+} LPSPI_DMA_CHANNEL;
+
+
+//
+// LPSPI_DMA_CONTEXT.
+//  The DMA resources and the state of the DMA transfer in progress.
+//
+typedef struct _LPSPI_DMA_CONTEXT
+{
+    //
+    // If DMA can be used
+    //
+    BOOLEAN IsEnabled;
+
+    //
+    // The PIO/DMA crossover policy
+    //
+    LPSPI_DMA_POLICY Policy;
+
+    //
+    // RX/TX channels
+    //
+    LPSPI_DMA_CHANNEL Rx;
+    LPSPI_DMA_CHANNEL Tx;
+
+    //
+    // The scratch buffer, the first half is the 0s TX source,
+    // the second half is the RX sink.
+    //
+    UCHAR* ScratchBufferPtr;
+    PMDL ZerosMdlPtr;
+    PMDL DiscardMdlPtr;
+
+    //
+    // The transfer in progress.
+    // TxTransferPtr is NULL for read transfers, and
+    // RxTransferPtr is NULL for write transfers.
+    //
+    LPSPI_SPB_TRANSFER* TxTransferPtr;
+    LPSPI_SPB_TRANSFER* RxTransferPtr;
+
+    //
+    // The chunk in progress
+    //
+    ULONG ChunkLength;
+    ULONG ChunkWatermark;
+    LONG PendingChannels;
+    NTSTATUS ChunkStatus;
+
+    //
+    // Set when the transfer is aborted
+    //
+    BOOLEAN IsAborted;
+
+    //
+    // Stops the system DMA transfers outside the device lock,
+    // IsStopPending is set until it is done.
+    //
+    WDFDPC WdfStopDpc;
+    BOOLEAN IsStopPending;
+
+    //
+    // Statistics
+    //
+    LPSPI_DMA_STATISTICS Statistics;
+
+} LPSPI_DMA_CONTEXT;
+
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+LPSPIDmaInitialize (
+    _In_ LPSPI_DEVICE_EXTENSION* DevExtPtr,
+    _In_ const CM_PARTIAL_RESOURCE_DESCRIPTOR* MemResourcePtr,
+    _In_ const CM_PARTIAL_RESOURCE_DESCRIPTOR* RxDmaResourcePtr,
+    _In_ const CM_PARTIAL_RESOURCE_DESCRIPTOR* TxDmaResourcePtr
+    );
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+VOID
+LPSPIDmaDeinitialize (
+    _In_ LPSPI_DEVICE_EXTENSION* DevExtPtr
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+LPSPIDmaShouldUseDma (
+    _In_ LPSPI_DEVICE_EXTENSION* DevExtPtr,
+    _In_ LPSPI_SPB_TRANSFER* Transfer1Ptr,
+    _In_opt_ LPSPI_SPB_TRANSFER* Transfer2Ptr
+    );
+
+_IRQL_requires_(DISPATCH_LEVEL)
+NTSTATUS
+LPSPIDmaStartTransfer (
+    _In_ LPSPI_DEVICE_EXTENSION* DevExtPtr,
+    _In_ LPSPI_SPB_TRANSFER* Transfer1Ptr,
+    _In_opt_ LPSPI_SPB_TRANSFER* Transfer2Ptr
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+LPSPIDmaAbortTransfer (
+    _In_ LPSPI_DEVICE_EXTENSION* DevExtPtr
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+LPSPIDmaLogStatistics (
+    _In_ LPSPI_DEVICE_EXTENSION* DevExtPtr
+    );
+
+//
+// LPSPIdma private methods
+//
+#ifdef _LPSPI_DMA_CPP_
+
+    _IRQL_requires_max_(PASSIVE_LEVEL)
+    static NTSTATUS
+    LPSPIpDmaCreateChannel (
+        _In_ LPSPI_DEVICE_EXTENSION* DevExtPtr,
+        _In_ LPSPI_DMA_CHANNEL* ChannelPtr,
+        _In_ WDF_DMA_DIRECTION Direction,
+        _In_ PHYSICAL_ADDRESS DeviceAddress,
+        _In_ const CM_PARTIAL_RESOURCE_DESCRIPTOR* DmaResourcePtr
+        );
+
+    _IRQL_requires_max_(PASSIVE_LEVEL)
+    static VOID
+    LPSPIpDmaDeleteChannel (
+        _In_ LPSPI_DMA_CHANNEL* ChannelPtr
+        );
+
+    _IRQL_requires_(DISPATCH_LEVEL)
+    static NTSTATUS
+    LPSPIpDmaStartChunk (
+        _In_ LPSPI_DEVICE_EXTENSION* DevExtPtr
+        );
+
+    _IRQL_requires_(DISPATCH_LEVEL)
+    static NTSTATUS
+    LPSPIpDmaStartChannel (
+        _In_ LPSPI_DMA_CHANNEL* ChannelPtr,
+        _In_ PMDL MdlPtr,
+        _In_ size_t Offset,
+        _In_ ULONG Length
+        );
+
+    _IRQL_requires_(DISPATCH_LEVEL)
+    static NTSTATUS
+    LPSPIpDmaCompleteChunk (
+        _In_ LPSPI_DEVICE_EXTENSION* DevExtPtr
+        );
+
+    static EVT_WDF_PROGRAM_DMA LPSPIpEvtDmaProgramDma;
+    static EVT_WDF_DMA_TRANSACTION_DMA_TRANSFER_COMPLETE LPSPIpEvtDmaTransferComplete;
+    static EVT_WDF_DPC LPSPIpEvtDmaStopDpc;
+
+#endif // _LPSPI_DMA_CPP_
+
+WDF_EXTERN_C_END
+
+#endif // !_LPSPI_DMA_H_
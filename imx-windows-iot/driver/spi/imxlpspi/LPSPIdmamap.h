@@ -0,0 +1,26 @@
+// Copyright 2023 NXP
+// Licensed under the MIT License.
+//
+// Module Name:
+//
+//    LPSPIdmamap.h
+//
+// Abstract:
+//
+//    This module declares the PIO/DMA crossover policy, the mapping of
+//    the transfer MDL chain to DMA chunks, and the transfer statistics
+//    of the IMX LPSPI controller driver, from the module shared with the
+//    other SPI driver (SpiDmaMap.h), with the LPSPI prefix.
+//
+// Environment:
+//
+//    kernel-mode only
+//
+
+#ifndef _LPSPI_DMA_MAP_H_
+#define _LPSPI_DMA_MAP_H_
+
+#define SPI_DMA_MAP_PREFIX LPSPI
+#include "SpiDmaMap.h"
+
+#endif // !_LPSPI_DMA_MAP_H_
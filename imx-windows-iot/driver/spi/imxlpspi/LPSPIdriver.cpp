@@ -30,6 +30,8 @@
 // Module specific header files
 #include "LPSPIhw.h"
 #include "LPSPIspb.h"
+#include "LPSPIdmamap.h"
+#include "LPSPIdma.h"
 #include "LPSPIdriver.h"
 #include "LPSPIdevice.h"
 
@@ -368,6 +370,7 @@ LPSPIEvtDeviceAdd (
         devExtPtr->ReferenceClockHz = SpiConfigDataSt.ReferenceClockHz;
         devExtPtr->MaxConnectionSpeedHz = SpiConfigDataSt.MaxConnectionSpeedHz;
         devExtPtr->SampleOnDelayedSckEdge = SpiConfigDataSt.SampleOnDelayedSckEdge != 0;
+        devExtPtr->DmaThresholdBytes = SpiConfigDataSt.DmaThresholdBytes;
         devExtPtr->WdfDevice = wdfDevice;
         devExtPtr->WdfSpiInterrupt = wdfInterrupt;
         KeInitializeSpinLock(&devExtPtr->DeviceLock);
@@ -57,6 +57,8 @@
 // Module specific header files
 #include "LPSPIhw.h"
 #include "LPSPIspb.h"
+#include "LPSPIdmamap.h"
+#include "LPSPIdma.h"
 #include "LPSPIdriver.h"
 #include "LPSPIdevice.h"
 
@@ -1098,6 +1100,134 @@ LPSPIHwDisableTransferInterrupts (
 }
 
 
+//
+// Routine Description:
+//
+//  LPSPIHwConfigureDmaTransfer is called to set the controller to
+//  DMA mode.
+//  The transfer is issued as a single continuous command, with a frame
+//  per FIFO entry, so PCS stays asserted between the DMA elements.
+//  Neither TX nor RX is masked, the DMA feeds the TX FIFO and drains the
+//  RX FIFO for both directions.
+//  LPSPI interrupts are not used, the transfer progress is driven
+//  by the DMA completion.
+//
+// Arguments:
+//
+//  DevExtPtr - The device extension.
+//
+//  TransferPtr - The transfer descriptor
+//
+// Return Value:
+//
+_Use_decl_annotations_
+VOID
+LPSPIHwConfigureDmaTransfer (
+    LPSPI_DEVICE_EXTENSION* DevExtPtr,
+    LPSPI_SPB_TRANSFER* TransferPtr
+    )
+{
+    LPSPI_SPB_REQUEST* requestPtr = TransferPtr->AssociatedRequestPtr;
+    LPSPI_TARGET_SETTINGS* trgSettingsPtr = &requestPtr->SpbTargetPtr->Settings;
+    volatile LPSPI_REGISTERS* lpspiRegsPtr = DevExtPtr->LPSPIRegsPtr;
+
+    WRITE_REGISTER_NOFENCE_ULONG(&lpspiRegsPtr->IER, 0);
+    WRITE_REGISTER_NOFENCE_ULONG(&lpspiRegsPtr->DER, 0);
+
+    LPSPI_TCR transmitCmdReg = { trgSettingsPtr->TransmitCmdReg.AsUlong };
+    transmitCmdReg.FRAMESZ = (TransferPtr->BufferStride * 8) - 1;
+    transmitCmdReg.TXMSK = 0;
+    transmitCmdReg.RXMSK = 0;
+    transmitCmdReg.CONTC = 0;
+    transmitCmdReg.CONT = 1;
+    WRITE_REGISTER_NOFENCE_ULONG(&lpspiRegsPtr->TCR, transmitCmdReg.AsUlong);
+    TransferPtr->IsStartBurst = FALSE;
+}
+
+
+//
+// Routine Description:
+//
+//  LPSPIHwSetDmaWatermark is called to set the RX/TX DMA request
+//  thresholds, and enable the DMA requests.
+//  TX DMA request is asserted while TX FIFO has room for a watermark of
+//  entries, RX DMA request is asserted when RX FIFO holds a watermark
+//  of entries.
+//
+// Arguments:
+//
+//  DevExtPtr - The device extension.
+//
+//  WatermarkLevel - The number of FIFO entries per DMA request.
+//
+// Return Value:
+//
+_Use_decl_annotations_
+VOID
+LPSPIHwSetDmaWatermark (
+    LPSPI_DEVICE_EXTENSION* DevExtPtr,
+    ULONG WatermarkLevel
+    )
+{
+    volatile LPSPI_REGISTERS* lpspiRegsPtr = DevExtPtr->LPSPIRegsPtr;
+
+    LPSPI_ASSERT(
+        DevExtPtr->IfrLogHandle,
+        (WatermarkLevel > 0) &&
+        (WatermarkLevel <= (min(DevExtPtr->TxFifoSize, DevExtPtr->RxFifoSize) / 2))
+        );
+
+    //
+    // TDF is set while TX FIFO count <= TXWATER,
+    // RDF is set while RX FIFO count > RXWATER.
+    //
+    LPSPI_FCR fifoCtrlReg = { 0 };
+    fifoCtrlReg.TXWATER = ULONG(DevExtPtr->TxFifoSize) - WatermarkLevel;
+    fifoCtrlReg.RXWATER = WatermarkLevel - 1;
+    WRITE_REGISTER_NOFENCE_ULONG(&lpspiRegsPtr->FCR, fifoCtrlReg.AsUlong);
+
+    LPSPI_DER dmaEnableReg = { 0 };
+    dmaEnableReg.TDDE = 1;
+    dmaEnableReg.RDDE = 1;
+    WRITE_REGISTER_NOFENCE_ULONG(&lpspiRegsPtr->DER, dmaEnableReg.AsUlong);
+}
+
+
+//
+// Routine Description:
+//
+//  LPSPIHwStopDmaTransfer is called to disable the DMA requests, and
+//  end the continuous command, so PCS is negated.
+//
+// Arguments:
+//
+//  DevExtPtr - The device extension.
+//
+// Return Value:
+//
+_Use_decl_annotations_
+VOID
+LPSPIHwStopDmaTransfer (
+    LPSPI_DEVICE_EXTENSION* DevExtPtr
+    )
+{
+    volatile LPSPI_REGISTERS* lpspiRegsPtr = DevExtPtr->LPSPIRegsPtr;
+    const LPSPI_TARGET_CONTEXT* trgCtxPtr = DevExtPtr->CurrentRequest.SpbTargetPtr;
+
+    WRITE_REGISTER_NOFENCE_ULONG(&lpspiRegsPtr->DER, 0);
+
+    LPSPI_CR ctrlReg = {
+        READ_REGISTER_NOFENCE_ULONG(&lpspiRegsPtr->CR)
+        };
+    if ((ctrlReg.MEN != 0) && (trgCtxPtr != nullptr)) {
+
+        LPSPI_TCR transmitCmdReg = { trgCtxPtr->Settings.TransmitCmdReg.AsUlong };
+        transmitCmdReg.CONT = 0;
+        WRITE_REGISTER_NOFENCE_ULONG(&lpspiRegsPtr->TCR, transmitCmdReg.AsUlong);
+    }
+}
+
+
 //
 // Routine Description:
 //
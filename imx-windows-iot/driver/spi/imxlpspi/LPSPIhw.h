@@ -661,6 +661,23 @@ LPSPIHwDisableTransferInterrupts (
     _In_ const LPSPI_SPB_TRANSFER* TransferPtr
     );
 
+VOID
+LPSPIHwConfigureDmaTransfer (
+    _In_ LPSPI_DEVICE_EXTENSION* DevExtPtr,
+    _In_ LPSPI_SPB_TRANSFER* TransferPtr
+    );
+
+VOID
+LPSPIHwSetDmaWatermark (
+    _In_ LPSPI_DEVICE_EXTENSION* DevExtPtr,
+    _In_ ULONG WatermarkLevel
+    );
+
+VOID
+LPSPIHwStopDmaTransfer (
+    _In_ LPSPI_DEVICE_EXTENSION* DevExtPtr
+    );
+
 BOOLEAN
 LPSPIpHwStartBurstIf (
     _In_ LPSPI_DEVICE_EXTENSION* DevExtPtr,
@@ -31,6 +31,8 @@
 // Module specific header files
 #include "LPSPIhw.h"
 #include "LPSPIspb.h"
+#include "LPSPIdmamap.h"
+#include "LPSPIdma.h"
 #include "LPSPIdevice.h"
 
 
@@ -791,6 +793,9 @@ LPSPISpbPrepareNextTransfer (
 //
 //  LPSPISpbStartNextTransfer is called to start the next IO transfer.
 //  The routine prepares the HW and starts the transfer.
+//  Transfers at or above the DMA threshold are started as DMA transfers,
+//  which can only be done at IRQL <= DISPATCH_LEVEL. When called from the
+//  ISR, the routine leaves a DMA transfer to the DPC.
 //
 // Arguments:
 //
@@ -802,7 +807,8 @@ LPSPISpbPrepareNextTransfer (
 // Return Value:
 //
 //  NTSTATUS: STATUS_SUCCESS, or STATUS_NO_MORE_FILES if there are no
-//      more prepared transfers.
+//      more prepared transfers, or the next transfer needs to be
+//      started from the DPC.
 //
 _Use_decl_annotations_
 NTSTATUS
@@ -863,6 +869,46 @@ LPSPISpbStartNextTransfer (
             );
     }
 
+    //
+    // Latency is measured from the first start attempt
+    //
+    LPSPI_SPB_TRANSFER* activeXfers[] = { activeXfer1Ptr, activeXfer2Ptr };
+    for (LPSPI_SPB_TRANSFER* transferPtr : activeXfers) {
+
+        if ((transferPtr != nullptr) && (transferPtr->StartTicks == 0)) {
+
+            transferPtr->StartTicks = KeQueryPerformanceCounter(nullptr).QuadPart;
+        }
+    }
+
+    if (LPSPIDmaShouldUseDma(devExtPtr, activeXfer1Ptr, activeXfer2Ptr)) {
+
+        if (KeGetCurrentIrql() > DISPATCH_LEVEL) {
+            //
+            // Let the DPC start the DMA transfer
+            //
+            return STATUS_NO_MORE_FILES;
+        }
+
+        LPSPIHwClearFIFOs(devExtPtr);
+
+        NTSTATUS status = LPSPIDmaStartTransfer(
+            devExtPtr,
+            activeXfer1Ptr,
+            activeXfer2Ptr
+            );
+        if (NT_SUCCESS(status)) {
+
+            return STATUS_SUCCESS;
+        }
+
+        LPSPI_LOG_WARNING(
+            devExtPtr->IfrLogHandle,
+            "LPSPIDmaStartTransfer failed, using PIO. status = %!STATUS!",
+            status
+            );
+    }
+
     LPSPIHwClearFIFOs(devExtPtr);
 
     activeXfer1Ptr->IsStartBurst = TRUE;
@@ -1050,6 +1096,8 @@ LPSPISpbCompleteSequenceTransfer (
         TransferPtr->SpbTransferDescriptor.TransferLength
         );
 
+    LPSPISpbRecordTransfer(TransferPtr);
+
     InterlockedDecrement(
         reinterpret_cast<volatile LONG*>(&requestPtr->ReadyTransferCount)
         );
@@ -1075,6 +1123,41 @@ LPSPISpbCompleteSequenceTransfer (
     }
 }
 
+//
+// Routine Description:
+//
+//  LPSPISpbRecordTransfer is called when a transfer is complete, to add
+//  the transfer latency and length to the PIO or DMA statistics.
+//
+// Arguments:
+//
+//  TransferPtr - The completed transfer context.
+//
+// Return Value:
+//
+_Use_decl_annotations_
+VOID
+LPSPISpbRecordTransfer (
+    LPSPI_SPB_TRANSFER* TransferPtr
+    )
+{
+    LPSPI_DEVICE_EXTENSION* devExtPtr =
+        TransferPtr->AssociatedRequestPtr->SpbTargetPtr->DevExtPtr;
+
+    LARGE_INTEGER frequency;
+    LONGLONG elapsedTicks =
+        KeQueryPerformanceCounter(&frequency).QuadPart - TransferPtr->StartTicks;
+    ULONG64 latencyUsec =
+        (ULONG64(elapsedTicks) * 1000000) / ULONG64(frequency.QuadPart);
+
+    LPSPIRecordTransfer(
+        TransferPtr->IsDmaTransfer ?
+            &devExtPtr->DmaStatistics : &devExtPtr->PioStatistics,
+        TransferPtr->SpbTransferDescriptor.TransferLength,
+        latencyUsec > MAXULONG ? MAXULONG : ULONG(latencyUsec)
+        );
+}
+
 //
 // Routine Description:
 //
@@ -1137,6 +1220,8 @@ LPSPISpbAbortAllTransfers (
     LPSPI_TARGET_CONTEXT* trgCtxPtr = RequestPtr->SpbTargetPtr;
     LPSPI_DEVICE_EXTENSION* devExtPtr = trgCtxPtr->DevExtPtr;
 
+    LPSPIDmaAbortTransfer(devExtPtr);
+
     WdfInterruptAcquireLock(devExtPtr->WdfSpiInterrupt);
 
     LPSPIHwUnselectTarget(trgCtxPtr);
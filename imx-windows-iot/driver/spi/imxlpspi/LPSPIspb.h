@@ -199,6 +199,17 @@ typedef struct _LPSPI_SPB_TRANSFER {
     //
     ULONG BufferStride;
 
+    //
+    // Performance counter at transfer start, for the
+    // transfer statistics.
+    //
+    LONGLONG StartTicks;
+
+    //
+    // If the transfer is moved by the DMA
+    //
+    BOOLEAN IsDmaTransfer;
+
 } LPSPI_SPB_TRANSFER;
 
 
@@ -669,6 +680,11 @@ LPSPISpbCompleteSequenceTransfer (
     _In_ LPSPI_SPB_TRANSFER* TransferPtr
     );
 
+VOID
+LPSPISpbRecordTransfer (
+    _In_ LPSPI_SPB_TRANSFER* TransferPtr
+    );
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 VOID
 LPSPISpbAbortAllTransfers(
@@ -104,6 +104,7 @@ extern BOOLEAN LPSPIBreakPoint ();
 
 // begin_wpp config
 // CUSTOM_TYPE(REQUESTTYPE, ItemEnum(LPSPI_REQUEST_TYPE));
+// CUSTOM_TYPE(DMACOMPLETIONSTATUS, ItemEnum(DMA_COMPLETION_STATUS));
 // end_wpp
 
 
@@ -0,0 +1,557 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host unit test of the PIO/DMA crossover policy and of the mapping of the
+// transfer MDL chain to DMA chunks (SpiDmaMap.h)
+//
+// The module is instantiated twice, through ECSPIdmamap.h and LPSPIdmamap.h,
+// the way the two drivers include it. Random MDL chains are walked chunk by
+// chunk the way the DMA start and completion routines do, and every chunk
+// is checked against the policy limits. A buffer that cannot be mapped
+// must fall back to PIO, a buffer that can must be moved completely and in
+// order. Both instantiations must give the same results.
+//
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t ULONG;
+typedef uint64_t ULONG64;
+typedef int64_t LONG64;
+typedef unsigned char BOOLEAN;
+
+#define TRUE 1
+#define FALSE 0
+#define __forceinline inline
+
+#include "ECSPIdmamap.h"
+#include "LPSPIdmamap.h"
+#include "HostTest.h"
+
+#include <vector>
+
+#define RANDOM_CHAINS 20000
+#define MAX_CHUNKS_PER_TRANSFER 100000
+
+//
+// The MDL fields the module uses
+//
+struct HostMdl {
+    HostMdl* Next;
+    ULONG ByteCount;
+    ULONG ByteOffset;
+};
+
+typedef std::vector<HostMdl> HostMdlChain;
+
+static unsigned g_Seed = 1;
+
+static unsigned
+Random (
+    unsigned Range
+    )
+{
+    g_Seed = g_Seed * 1103515245 + 12345;
+    return (g_Seed >> 8) % Range;
+}
+
+static void
+LinkChain (
+    HostMdlChain* ChainPtr
+    )
+{
+    for (size_t i = 0; i < ChainPtr->size(); i++) {
+        (*ChainPtr)[i].Next = (i + 1 < ChainPtr->size()) ? &(*ChainPtr)[i + 1] : nullptr;
+    }
+}
+
+static ECSPI_DMA_POLICY
+MakePolicy (
+    ULONG ElementSize,
+    ULONG WatermarkElements,
+    ULONG MaxChunkBytes,
+    ULONG MaxDescriptors,
+    ULONG PageSize
+    )
+{
+    ECSPI_DMA_POLICY policy = {};
+
+    policy.ElementSize = ElementSize;
+    policy.ThresholdBytes = ECSPIDmaSelectThreshold(ECSPI_DMA_THRESHOLD_DEFAULT, 64, ElementSize);
+    policy.WatermarkElements = WatermarkElements;
+    policy.MaxChunkBytes = MaxChunkBytes;
+    policy.MaxDescriptors = MaxDescriptors;
+    policy.PageSize = PageSize;
+    return policy;
+}
+
+static LPSPI_DMA_POLICY
+ToLpspi (
+    const ECSPI_DMA_POLICY& Policy
+    )
+{
+    LPSPI_DMA_POLICY policy;
+
+    policy.ThresholdBytes = Policy.ThresholdBytes;
+    policy.ElementSize = Policy.ElementSize;
+    policy.WatermarkElements = Policy.WatermarkElements;
+    policy.MaxChunkBytes = Policy.MaxChunkBytes;
+    policy.MaxDescriptors = Policy.MaxDescriptors;
+    policy.PageSize = Policy.PageSize;
+    return policy;
+}
+
+//
+// Reference of the buffer check: every fragment of the transfer starts on
+// an element boundary and holds whole elements.
+//
+static bool
+IsChainAligned (
+    const HostMdlChain& Chain,
+    size_t Length,
+    ULONG ElementSize
+    )
+{
+    for (const HostMdl& mdl : Chain) {
+        if (Length == 0) {
+            break;
+        }
+        size_t fragment = (mdl.ByteCount < Length) ? mdl.ByteCount : Length;
+        if (((mdl.ByteOffset % ElementSize) != 0) || ((fragment % ElementSize) != 0)) {
+            return false;
+        }
+        Length -= fragment;
+    }
+    return Length == 0;
+}
+
+//
+// The decision of ECSPIDmaShouldUseDma/LPSPIDmaShouldUseDma for the buffer
+// layout: DMA, PIO below the threshold, or PIO fallback.
+//
+enum TRANSFER_PATH {
+    PathPio,
+    PathDma,
+    PathFallback,
+};
+
+static TRANSFER_PATH
+SelectPath (
+    const ECSPI_DMA_POLICY& Policy,
+    const HostMdlChain& TxChain,
+    const HostMdlChain* RxChainPtr,
+    size_t Length,
+    ULONG BufferStride
+    )
+{
+    if (!ECSPIDmaIsTransferEligible(&Policy, Length, BufferStride)) {
+        return PathPio;
+    }
+
+    const HostMdl* txPtr = TxChain.empty() ? nullptr : &TxChain[0];
+    bool isDma = ECSPIDmaIsBufferAligned(&Policy, txPtr, Length) != FALSE;
+    if (isDma && (RxChainPtr != nullptr)) {
+        const HostMdl* rxPtr = RxChainPtr->empty() ? nullptr : &(*RxChainPtr)[0];
+        isDma = ECSPIDmaIsBufferAligned(&Policy, rxPtr, Length) != FALSE;
+    }
+
+    return isDma ? PathDma : PathFallback;
+}
+
+static void
+TestThreshold ()
+{
+    // One TX FIFO fill by default
+    CHECK(ECSPIDmaSelectThreshold(ECSPI_DMA_THRESHOLD_DEFAULT, 64, 1) == 256);
+    CHECK(LPSPIDmaSelectThreshold(LPSPI_DMA_THRESHOLD_DEFAULT, 16, 4) == 64);
+
+    // Rounded up to the element size
+    CHECK(ECSPIDmaSelectThreshold(33, 64, 4) == 36);
+    CHECK(ECSPIDmaSelectThreshold(36, 64, 4) == 36);
+    CHECK(ECSPIDmaSelectThreshold(1, 64, 2) == 2);
+
+    // Disabled, no element size, or no room to round up
+    CHECK(ECSPIDmaSelectThreshold(ECSPI_DMA_THRESHOLD_DISABLED, 64, 4) == ECSPI_DMA_THRESHOLD_DISABLED);
+    CHECK(ECSPIDmaSelectThreshold(100, 64, 0) == ECSPI_DMA_THRESHOLD_DISABLED);
+    CHECK(ECSPIDmaSelectThreshold(0xFFFFFFFD, 64, 4) == ECSPI_DMA_THRESHOLD_DISABLED);
+    CHECK(ECSPIDmaSelectThreshold(0xFFFFFFF8, 64, 4) == 0xFFFFFFF8);
+}
+
+static void
+TestPath ()
+{
+    ECSPI_DMA_POLICY policy = MakePolicy(4, 32, 32 * 1024, 16, 4096);
+    HostMdlChain chain = { { nullptr, 4096, 0 } };
+
+    LinkChain(&chain);
+    CHECK(policy.ThresholdBytes == 256);
+
+    // Below the threshold, a stride that is not the element size, or a
+    // length that is not whole elements: PIO, not counted as a fallback
+    CHECK(SelectPath(policy, chain, nullptr, 252, 4) == PathPio);
+    CHECK(SelectPath(policy, chain, nullptr, 256, 4) == PathDma);
+    CHECK(SelectPath(policy, chain, nullptr, 512, 2) == PathPio);
+    CHECK(SelectPath(policy, chain, nullptr, 258, 4) == PathPio);
+
+    policy.ThresholdBytes = ECSPI_DMA_THRESHOLD_DISABLED;
+    CHECK(SelectPath(policy, chain, nullptr, 4096, 4) == PathPio);
+    policy.ThresholdBytes = 256;
+
+    // A fragment that is not element aligned falls back to PIO.
+    HostMdlChain split = { { nullptr, 1022, 2 }, { nullptr, 1026, 0 } };
+    LinkChain(&split);
+    CHECK(SelectPath(policy, split, nullptr, 2048, 4) == PathFallback);
+
+    HostMdlChain odd = { { nullptr, 1024, 2 } };
+    LinkChain(&odd);
+    CHECK(SelectPath(policy, odd, nullptr, 1024, 4) == PathFallback);
+
+    // Only the fragments within the transfer length are checked.
+    HostMdlChain tail = { { nullptr, 512, 0 }, { nullptr, 3, 1 } };
+    LinkChain(&tail);
+    CHECK(SelectPath(policy, tail, nullptr, 512, 4) == PathDma);
+    CHECK(SelectPath(policy, tail, nullptr, 516, 4) == PathFallback);
+
+    // A chain shorter than the transfer
+    CHECK(SelectPath(policy, chain, nullptr, 8192, 4) == PathFallback);
+
+    // FULL_DUPLEX: both buffers must be aligned.
+    CHECK(SelectPath(policy, chain, &chain, 1024, 4) == PathDma);
+    CHECK(SelectPath(policy, chain, &odd, 1024, 4) == PathFallback);
+}
+
+static void
+TestChunkLimits ()
+{
+    ECSPI_DMA_POLICY policy = MakePolicy(1, 32, 32 * 1024, 2, 4096);
+    HostMdlChain chain = { { nullptr, 64 * 1024, 4000 } };
+    ULONG descriptors;
+
+    LinkChain(&chain);
+
+    // Two pages from offset 4000: 96 + 4096 bytes, down to a watermark multiple
+    ULONG length = ECSPIDmaGetChunkLength(&policy, &chain[0], 0, 64 * 1024, &descriptors);
+    CHECK(length == 4192 - (4192 % 32));
+    CHECK(descriptors == 2);
+    CHECK(ECSPIDmaGetChunkWatermark(&policy, length) == 32);
+
+    // Short tail of the transfer: its own length is the watermark.
+    length = ECSPIDmaGetChunkLength(&policy, &chain[0], 0, 20, &descriptors);
+    CHECK((length == 20) && (descriptors == 1));
+    CHECK(ECSPIDmaGetChunkWatermark(&policy, length) == 20);
+    length = ECSPIDmaGetChunkLength(&policy, &chain[0], 64 * 1024 - 22, 20, &descriptors);
+    CHECK(length == 20);
+
+    // Scratch buffer size
+    policy.MaxDescriptors = 16;
+    length = ECSPIDmaGetChunkLength(&policy, &chain[0], 96, 64 * 1024, &descriptors);
+    CHECK((length == 32 * 1024) && (descriptors == 8));
+
+    // Nothing left in the MDL
+    CHECK(ECSPIDmaGetChunkLength(&policy, &chain[0], 64 * 1024, 100, &descriptors) == 0);
+    CHECK(descriptors == 0);
+    CHECK(ECSPIDmaGetChunkLength(&policy, (const HostMdl*)nullptr, 0, 100, &descriptors) == 0);
+
+    // Empty MDLs are skipped, the position ends past the last MDL.
+    HostMdlChain empty = { { nullptr, 0, 0 }, { nullptr, 0, 0 }, { nullptr, 8, 0 }, { nullptr, 0, 0 } };
+    LinkChain(&empty);
+    HostMdl* mdlPtr = &empty[0];
+    size_t mdlOffset = 0;
+    ECSPIDmaAdvanceMdl(&mdlPtr, &mdlOffset, 0);
+    CHECK((mdlPtr == &empty[2]) && (mdlOffset == 0));
+    ECSPIDmaAdvanceMdl(&mdlPtr, &mdlOffset, 5);
+    CHECK((mdlPtr == &empty[2]) && (mdlOffset == 5));
+    ECSPIDmaAdvanceMdl(&mdlPtr, &mdlOffset, 3);
+    CHECK((mdlPtr == nullptr) && (mdlOffset == 0));
+}
+
+//
+// Walks one side of the transfer the way the DMA routines do, the chunk is
+// the shortest of both sides.
+//
+struct TransferSide {
+    HostMdlChain* ChainPtr;
+    HostMdl* MdlPtr;
+    size_t MdlOffset;
+    size_t Position;                    // offset in the transfer
+
+    void Start (HostMdlChain* InChainPtr)
+    {
+        ChainPtr = InChainPtr;
+        MdlPtr = ChainPtr->empty() ? nullptr : &(*ChainPtr)[0];
+        MdlOffset = 0;
+        Position = 0;
+        ECSPIDmaAdvanceMdl(&MdlPtr, &MdlOffset, 0);
+    }
+
+    //
+    // Offset of the current position in the transfer, from the MDL pointer
+    //
+    size_t MdlPosition () const
+    {
+        size_t position = 0;
+        for (const HostMdl& mdl : *ChainPtr) {
+            if (&mdl == MdlPtr) {
+                return position + MdlOffset;
+            }
+            position += mdl.ByteCount;
+        }
+        return position + MdlOffset;
+    }
+};
+
+static bool
+CheckChunk (
+    const ECSPI_DMA_POLICY& Policy,
+    const TransferSide& Side,
+    ULONG ChunkLength
+    )
+{
+    const HostMdl* mdlPtr = Side.MdlPtr;
+    size_t start = mdlPtr->ByteOffset + Side.MdlOffset;
+    size_t pages = ((start + ChunkLength + Policy.PageSize - 1) / Policy.PageSize) -
+                   (start / Policy.PageSize);
+
+    return (Side.MdlOffset + ChunkLength <= mdlPtr->ByteCount) &&
+           (pages <= Policy.MaxDescriptors) &&
+           ((start % Policy.ElementSize) == 0);
+}
+
+static bool
+MoveTransfer (
+    const ECSPI_DMA_POLICY& Policy,
+    HostMdlChain* TxChainPtr,
+    HostMdlChain* RxChainPtr,
+    size_t Length,
+    ULONG* ChunksPtr
+    )
+{
+    LPSPI_DMA_POLICY lpspiPolicy = ToLpspi(Policy);
+    TransferSide sides[2];
+    size_t sideCount = (RxChainPtr != nullptr) ? 2 : 1;
+    size_t done = 0;
+    bool isValid = true;
+
+    sides[0].Start(TxChainPtr);
+    if (RxChainPtr != nullptr) {
+        sides[1].Start(RxChainPtr);
+    }
+
+    *ChunksPtr = 0;
+    while ((done < Length) && isValid) {
+        ULONG chunkLength = 0xFFFFFFFF;
+
+        for (size_t i = 0; i < sideCount; i++) {
+            ULONG descriptors;
+            ULONG lpspiDescriptors;
+            ULONG length = ECSPIDmaGetChunkLength(
+                &Policy,
+                sides[i].MdlPtr,
+                sides[i].MdlOffset,
+                Length - done,
+                &descriptors
+                );
+
+            isValid = isValid &&
+                      (length == LPSPIDmaGetChunkLength(
+                                     &lpspiPolicy,
+                                     sides[i].MdlPtr,
+                                     sides[i].MdlOffset,
+                                     Length - done,
+                                     &lpspiDescriptors)) &&
+                      (descriptors == lpspiDescriptors) &&
+                      (descriptors <= Policy.MaxDescriptors) &&
+                      (length <= Policy.MaxChunkBytes) &&
+                      ((length % Policy.ElementSize) == 0);
+            if (length < chunkLength) {
+                chunkLength = length;
+            }
+        }
+
+        ULONG watermark = ECSPIDmaGetChunkWatermark(&Policy, chunkLength);
+        isValid = isValid &&
+                  (chunkLength != 0) &&
+                  (chunkLength <= Length - done) &&
+                  (watermark != 0) &&
+                  (watermark <= Policy.WatermarkElements) &&
+                  (((chunkLength / Policy.ElementSize) % watermark) == 0) &&
+                  (watermark == LPSPIDmaGetChunkWatermark(&lpspiPolicy, chunkLength));
+        if (!isValid) {
+            break;
+        }
+
+        for (size_t i = 0; i < sideCount; i++) {
+            isValid = isValid && CheckChunk(Policy, sides[i], chunkLength);
+            ECSPIDmaAdvanceMdl(&sides[i].MdlPtr, &sides[i].MdlOffset, chunkLength);
+            sides[i].Position += chunkLength;
+            isValid = isValid && (sides[i].MdlPosition() == sides[i].Position);
+        }
+        done += chunkLength;
+        *ChunksPtr += 1;
+        if (*ChunksPtr > MAX_CHUNKS_PER_TRANSFER) {
+            isValid = false;
+        }
+    }
+
+    return isValid && (done == Length);
+}
+
+static HostMdlChain
+RandomChain (
+    size_t Length,
+    ULONG ElementSize,
+    ULONG PageSize,
+    bool IsAligned
+    )
+{
+    HostMdlChain chain;
+    size_t left = Length;
+
+    while (left != 0) {
+        HostMdl mdl = {};
+        mdl.ByteOffset = Random(PageSize / ElementSize) * ElementSize;
+        if (Random(8) == 0) {
+            mdl.ByteCount = 0;
+        } else {
+            mdl.ByteCount = ULONG(1 + Random(unsigned(left < 3 * PageSize ? left : 3 * PageSize)));
+            mdl.ByteCount -= mdl.ByteCount % ElementSize;
+            if (mdl.ByteCount == 0) {
+                mdl.ByteCount = ElementSize;
+            }
+        }
+        if (mdl.ByteCount > left) {
+            mdl.ByteCount = ULONG(left);
+        }
+        left -= mdl.ByteCount;
+        chain.push_back(mdl);
+    }
+
+    // Longer than the transfer, the extra bytes are not checked.
+    if (Random(4) == 0) {
+        HostMdl mdl = { nullptr, 1 + Random(100), Random(PageSize) };
+        chain.push_back(mdl);
+    } else if ((Random(4) == 0) && !chain.empty()) {
+        chain.back().ByteCount += 1 + Random(100);
+    }
+
+    if (!IsAligned && (ElementSize > 1) && !chain.empty()) {
+        HostMdl* mdlPtr = &chain[Random(unsigned(chain.size()))];
+        if (Random(2) == 0) {
+            mdlPtr->ByteOffset += 1 + Random(ElementSize - 1);
+        } else if (mdlPtr->ByteCount >= ElementSize) {
+            ULONG shift = 1 + Random(ElementSize - 1);
+            mdlPtr->ByteCount -= shift;
+            if (mdlPtr != &chain.back()) {
+                (mdlPtr + 1)->ByteCount += shift;
+            }
+        }
+    }
+
+    LinkChain(&chain);
+    return chain;
+}
+
+static void
+TestRandomChains ()
+{
+    static const ULONG elementSizes[] = { 1, 2, 4 };
+    static const ULONG watermarks[] = { 1, 3, 8, 32 };
+    static const ULONG pageSizes[] = { 64, 4096 };
+    static const ULONG maxChunks[] = { 256, 32 * 1024 };
+    ULONG paths[3] = {};
+    ULONG64 chunks = 0;
+    ULONG64 bytes = 0;
+
+    for (ULONG n = 0; n < RANDOM_CHAINS; n++) {
+        ULONG elementSize = elementSizes[Random(3)];
+        ULONG pageSize = pageSizes[Random(2)];
+        ECSPI_DMA_POLICY policy = MakePolicy(
+            elementSize,
+            watermarks[Random(4)],
+            maxChunks[Random(2)],
+            1 + Random(16),
+            pageSize
+            );
+        policy.ThresholdBytes = ECSPIDmaSelectThreshold(Random(512), 64, elementSize);
+
+        size_t length = (1 + Random(16 * pageSize / elementSize)) * elementSize;
+        bool isDuplex = Random(3) == 0;
+        HostMdlChain txChain = RandomChain(length, elementSize, pageSize, Random(4) != 0);
+        HostMdlChain rxChain = RandomChain(length, elementSize, pageSize, Random(4) != 0);
+        HostMdlChain* rxChainPtr = isDuplex ? &rxChain : nullptr;
+
+        bool isAligned = IsChainAligned(txChain, length, elementSize) &&
+                         (!isDuplex || IsChainAligned(rxChain, length, elementSize));
+        LPSPI_DMA_POLICY lpspiPolicy = ToLpspi(policy);
+        CHECK((ECSPIDmaIsBufferAligned(&policy, &txChain[0], length) != FALSE) ==
+              IsChainAligned(txChain, length, elementSize));
+        CHECK(LPSPIDmaIsBufferAligned(&lpspiPolicy, &txChain[0], length) ==
+              ECSPIDmaIsBufferAligned(&policy, &txChain[0], length));
+
+        TRANSFER_PATH path = SelectPath(policy, txChain, rxChainPtr, length, elementSize);
+        paths[path] += 1;
+        if (length < policy.ThresholdBytes) {
+            CHECK(path == PathPio);
+        } else {
+            CHECK(path == (isAligned ? PathDma : PathFallback));
+        }
+
+        if (isAligned) {
+            ULONG transferChunks;
+            bool isMoved = MoveTransfer(policy, &txChain, rxChainPtr, length, &transferChunks);
+            CHECK(isMoved);
+            if (!isMoved) {
+                printf("chain %u: length %zu, element %u, watermark %u, descriptors %u, page %u\n",
+                       unsigned(n),
+                       length,
+                       unsigned(elementSize),
+                       unsigned(policy.WatermarkElements),
+                       unsigned(policy.MaxDescriptors),
+                       unsigned(pageSize));
+                return;
+            }
+            chunks += transferChunks;
+            bytes += length;
+        }
+    }
+
+    printf("random: %u PIO, %u DMA, %u fallback, %llu bytes in %llu chunks\n",
+           unsigned(paths[PathPio]),
+           unsigned(paths[PathDma]),
+           unsigned(paths[PathFallback]),
+           (unsigned long long)bytes,
+           (unsigned long long)chunks);
+}
+
+static void
+TestStatistics ()
+{
+    ECSPI_TRANSFER_STATISTICS statistics = {};
+    LPSPI_DMA_STATISTICS dmaStatistics = {};
+
+    CHECK(ECSPIGetAverageUsec(&statistics) == 0);
+    CHECK(ECSPIGetThroughputKBps(&statistics) == 0);
+
+    ECSPIRecordTransfer(&statistics, 1000, 100);
+    ECSPIRecordTransfer(&statistics, 3000, 300);
+    CHECK(statistics.Transfers == 2);
+    CHECK(statistics.Bytes == 4000);
+    CHECK(statistics.MaxUsec == 300);
+    CHECK(ECSPIGetAverageUsec(&statistics) == 200);
+    CHECK(ECSPIGetThroughputKBps(&statistics) == 10000);
+
+    CHECK(dmaStatistics.Fallbacks == 0);
+}
+
+int
+main ()
+{
+    TestThreshold();
+    TestPath();
+    TestChunkLimits();
+    TestRandomChains();
+    TestStatistics();
+
+    return HostTestResult("spidmamaptest");
+}
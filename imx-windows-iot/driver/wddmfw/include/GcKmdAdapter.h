@@ -7,6 +7,7 @@
 #include "GcKmdAllocation.h"
 
 #include "AdapterExchangeData.h"
+#include "d3d_km_interface.h"
 
 #include "gcdispif.h"
 
@@ -133,6 +134,14 @@ public:
 
     virtual void PrepareToReset() = NULL;
 
+    virtual NTSTATUS GetStatistics(
+        D3dKmNodeStats *pNodeStats)
+    {
+        UNREFERENCED_PARAMETER(pNodeStats);
+
+        return STATUS_NOT_SUPPORTED;
+    }
+
 protected:
 
     GcKmNodeErrorCondition  m_ErrorHit;
@@ -188,6 +197,9 @@ public:
     NTSTATUS PreemptCommand(
         IN_CONST_PDXGKARG_PREEMPTCOMMAND    pPreemptCommand);
 
+    NTSTATUS GetNodeStatistics(
+        D3dKmNodeStats *pNodeStats);
+
     virtual NTSTATUS CollectDbgInfo(
         IN_CONST_PDXGKARG_COLLECTDBGINFO    pCollectDbgInfo) = NULL;
 
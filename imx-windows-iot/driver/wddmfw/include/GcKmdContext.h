@@ -64,6 +64,23 @@ protected:
         return 0;
     }
 
+    //
+    // Called around the GDI operations of one DMA buffer, the end may
+    // append commands still held back, returns their size
+    //
+
+    virtual void
+    BeginGdiCommandBuffer()
+    {
+    }
+
+    virtual UINT
+    EndGdiCommandBuffer(
+        BYTE*   pDmaBuffer)
+    {
+        return 0;
+    }
+
     virtual NTSTATUS
     CopyImage(
         GcKmAllocation*         pSrcAllocation,
@@ -0,0 +1,195 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+#pragma once
+
+//
+// Lock-free multiple producer, single consumer queue of DMA buffer submissions.
+//
+// Producers push entries onto a shared LIFO list with a single compare-exchange.
+// The consumer (the node worker thread) detaches the whole list with a single
+// exchange, reverses it and pops the batch in submission order. Only the consumer
+// ever removes entries, so a producer can never observe a recycled head (no ABA).
+//
+// TEntry must have a "TEntry *m_pNext" member.
+//
+
+template<typename TEntry>
+class GcKmMpscQueue
+{
+public:
+
+    void Initialize()
+    {
+        m_pPushHead = nullptr;
+        m_pBatchHead = nullptr;
+        m_pBatchTail = nullptr;
+    }
+
+    //
+    // Can be called by any number of threads at IRQL <= DISPATCH_LEVEL.
+    // Returns true if nothing was pending for the consumer to pick up,
+    // i.e. the consumer may have to be woken up.
+    //
+
+    bool Push(
+        TEntry *pEntry)
+    {
+        TEntry *pHead;
+
+        do
+        {
+            pHead = m_pPushHead;
+            pEntry->m_pNext = pHead;
+        } while (InterlockedCompareExchangePointer(
+                    (PVOID volatile *)&m_pPushHead,
+                    pEntry,
+                    pHead) != pHead);
+
+        return (nullptr == pHead);
+    }
+
+    //
+    // Consumer only, moves everything pushed so far to the end of the batch
+    // and returns the number of entries moved
+    //
+
+    UINT DequeueBatch()
+    {
+        TEntry *pEntry = (TEntry *)InterlockedExchangePointer((PVOID volatile *)&m_pPushHead, nullptr);
+        TEntry *pFirst = nullptr;
+        TEntry *pLast = pEntry;
+        UINT    Count = 0;
+
+        while (pEntry)
+        {
+            TEntry *pNext = pEntry->m_pNext;
+
+            pEntry->m_pNext = pFirst;
+            pFirst = pEntry;
+            pEntry = pNext;
+
+            Count++;
+        }
+
+        if (pFirst)
+        {
+            if (m_pBatchTail)
+            {
+                m_pBatchTail->m_pNext = pFirst;
+            }
+            else
+            {
+                m_pBatchHead = pFirst;
+            }
+
+            m_pBatchTail = pLast;
+        }
+
+        return Count;
+    }
+
+    //
+    // Consumer only, pops the oldest entry of the batch
+    //
+
+    TEntry* Pop()
+    {
+        TEntry *pEntry = m_pBatchHead;
+
+        if (pEntry)
+        {
+            m_pBatchHead = pEntry->m_pNext;
+            if (!m_pBatchHead)
+            {
+                m_pBatchTail = nullptr;
+            }
+
+            pEntry->m_pNext = nullptr;
+        }
+
+        return pEntry;
+    }
+
+private:
+
+    TEntry * volatile   m_pPushHead;
+    TEntry             *m_pBatchHead;
+    TEntry             *m_pBatchTail;
+};
+
+//
+// Per node submission statistics, times are in 100ns units.
+//
+// Submission counters are updated by the (serialized) submit path, the rest
+// by the worker thread only, so no interlocked operations are needed.
+// Readers get a snapshot that may be off by the buffer in flight.
+//
+
+struct GcKmSubmissionStats
+{
+    ULONGLONG   m_SubmittedCount;
+    ULONGLONG   m_CompletedCount;
+    ULONGLONG   m_DiscardedCount;
+    ULONGLONG   m_BatchCount;
+    UINT        m_MaxBatchSize;
+    UINT        m_MaxQueueDepth;
+
+    ULONGLONG   m_TotalWaitTime;
+    ULONGLONG   m_MaxWaitTime;
+    ULONGLONG   m_TotalExecutionTime;
+    ULONGLONG   m_MaxExecutionTime;
+
+    void OnSubmit(
+        UINT        QueueDepth)
+    {
+        m_SubmittedCount++;
+
+        if (QueueDepth > m_MaxQueueDepth)
+        {
+            m_MaxQueueDepth = QueueDepth;
+        }
+    }
+
+    void OnBatch(
+        UINT        BatchSize)
+    {
+        if (BatchSize)
+        {
+            m_BatchCount++;
+
+            if (BatchSize > m_MaxBatchSize)
+            {
+                m_MaxBatchSize = BatchSize;
+            }
+        }
+    }
+
+    void OnExecuted(
+        ULONGLONG   SubmitTime,
+        ULONGLONG   StartTime,
+        ULONGLONG   EndTime)
+    {
+        ULONGLONG   WaitTime = StartTime - SubmitTime;
+        ULONGLONG   ExecutionTime = EndTime - StartTime;
+
+        m_CompletedCount++;
+
+        m_TotalWaitTime += WaitTime;
+        if (WaitTime > m_MaxWaitTime)
+        {
+            m_MaxWaitTime = WaitTime;
+        }
+
+        m_TotalExecutionTime += ExecutionTime;
+        if (ExecutionTime > m_MaxExecutionTime)
+        {
+            m_MaxExecutionTime = ExecutionTime;
+        }
+    }
+
+    void OnDiscarded()
+    {
+        m_DiscardedCount++;
+    }
+};
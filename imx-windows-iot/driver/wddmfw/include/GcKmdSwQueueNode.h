@@ -5,6 +5,7 @@
 
 #include "GcKmdAdapter.h"
 #include "GcCommandBuffer.h"
+#include "GcKmdSubmissionQueue.h"
 
 class GcKmContext;
 
@@ -48,16 +49,23 @@ struct GcDmaBufInfo
     CommandBufferChunk         *m_pCommandBufferChunks;
 
     DXGK_BUILDPAGINGBUFFER_TRANSFERVIRTUAL m_TransferVirtual;
+
+    //
+    // Size of the GPU copy command prepared along with a CPU transfer
+    //
+
+    UINT                        m_GpuTransferSize;
 };
 
 struct GcDmaBufSubmission
 {
-    LIST_ENTRY      m_QueueEntry;
+    GcDmaBufSubmission *m_pNext;
     GcDmaBufInfo   *m_pDmaBufInfo;
     GcKmContext    *m_pContext;
     UINT            m_EngineOrdinal;
     UINT            m_NodeOrdinal;
     UINT            m_SubmissionFenceId;
+    ULONGLONG       m_SubmitTime;
 };
 
 class GcKmSwQueueNode : public GcKmNode
@@ -79,6 +87,10 @@ public:
         m_pWorkerThread = nullptr;
 
         memset(&m_DefaultDmaBufInfo, 0, sizeof(m_DefaultDmaBufInfo));
+
+        m_DmaBufQueueDepth = 0;
+
+        memset(&m_Stats, 0, sizeof(m_Stats));
     }
 
     virtual NTSTATUS Start(
@@ -94,18 +106,21 @@ public:
 
     virtual void PrepareToReset();
 
+    virtual NTSTATUS GetStatistics(
+        D3dKmNodeStats *pNodeStats);
+
     static void HwDmaBufCompletionDpcRoutine(KDPC *, PVOID, PVOID, PVOID);
 
 private:
 
     static void WorkerThread(void* StartContext);
     void DoWork(void);
-    void QueueDmaBuffer(IN_CONST_PDXGKARG_SUBMITCOMMANDVIRTUAL pSubmitCommand);
+    NTSTATUS QueueDmaBuffer(IN_CONST_PDXGKARG_SUBMITCOMMANDVIRTUAL pSubmitCommand, bool *pbWakeWorker);
     void NotifyDmaBufCompletion(GcDmaBufSubmission* pDmaBufSubmission);
     void NotifyPreemptionCompletion();
     static BOOLEAN SynchronizeNotifyInterrupt(PVOID SynchronizeContext);
     BOOLEAN SynchronizeNotifyInterrupt();
-    GcDmaBufSubmission *DequeueDmaBuffer(KSPIN_LOCK* pDmaBufQueueLock);
+    bool DequeueDmaBuffer(GcDmaBufSubmission* pDmaBufSubmission);
     void EmptyDmaBufferQueue(bool bForPreemption);
 
 protected:
@@ -126,9 +141,18 @@ protected:
     const static UINT           m_MaxDmaBufQueueLength = 32;
     GcDmaBufSubmission          m_DmaBufSubmissions[m_MaxDmaBufQueueLength];
 
-    LIST_ENTRY                  m_DmaBufSubmissionFree;
-    LIST_ENTRY                  m_DmaBufQueue;
-    KSPIN_LOCK                  m_DmaBufQueueLock;
+    //
+    // Submissions are handed to the worker thread through a lock-free queue.
+    // Slots are taken round robin by the submit path and retired in order by
+    // the worker thread as soon as they are dequeued, m_DmaBufQueueDepth
+    // counts the slots in use and a submission that finds none free fails.
+    //
+
+    GcKmMpscQueue<GcDmaBufSubmission> m_DmaBufQueue;
+    UINT                        m_NextDmaBufSubmission;
+    volatile LONG               m_DmaBufQueueDepth;
+
+    GcKmSubmissionStats         m_Stats;
 
     GcDmaBufInfo                m_DefaultDmaBufInfo;
 
@@ -56,7 +56,8 @@ typedef enum _D3dKmEscapeType
     D3D_KM_ESCAPE_UPDATE_IMAGE_INFO = 'UImI',
     D3D_KM_ESCAPE_GET_TILE_MODE_CAP = 'QTMO',
     D3D_KM_ESCAPE_GET_ADAPTER_CAPS  = 'GADC',
-    D3D_KM_ESCAPE_CHECK_DIRECT_FLIP = 'CDFL'
+    D3D_KM_ESCAPE_CHECK_DIRECT_FLIP = 'CDFL',
+    D3D_KM_ESCAPE_GET_NODE_STATS    = 'GNST'
 } D3dKmEscapeType;
 
 typedef struct _D3dKmEscape
@@ -73,6 +74,39 @@ typedef struct _D3dKmEscape
     };
 } D3dKmEscape;
 
+//
+// Per node DMA buffer queue statistics, times are in 100ns units.
+// Wait time is from submission to the start of execution.
+//
+
+typedef struct _D3dKmNodeStats
+{
+    UINT                NodeOrdinal;
+    UINT                QueueDepth;
+    UINT                MaxQueueDepth;
+    UINT                MaxBatchSize;
+    UINT64              SubmittedCount;
+    UINT64              CompletedCount;
+    UINT64              DiscardedCount;
+    UINT64              BatchCount;
+    UINT64              TotalWaitTime;
+    UINT64              MaxWaitTime;
+    UINT64              TotalExecutionTime;
+    UINT64              MaxExecutionTime;
+} D3dKmNodeStats;
+
+//
+// D3D_KM_ESCAPE_GET_NODE_STATS does not fit in D3dKmEscape,
+// so it has its own escape data
+//
+
+typedef struct _D3dKmNodeStatsEscape
+{
+    UINT                Size;
+    D3dKmEscapeType     Type;
+    D3dKmNodeStats      NodeStats;
+} D3dKmNodeStatsEscape;
+
 typedef struct _D3dKmPresentSyncInfo
 {
     union 
@@ -828,6 +828,19 @@ GcKmAdapter::PreemptCommand(
     return m_Nodes[pPreemptCommand->NodeOrdinal]->Preempt(pPreemptCommand);
 }
 
+NTSTATUS
+GcKmAdapter::GetNodeStatistics(
+    D3dKmNodeStats *pNodeStats)
+{
+    if ((pNodeStats->NodeOrdinal >= m_NumNodes) ||
+        (NULL == m_Nodes[pNodeStats->NodeOrdinal]))
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    return m_Nodes[pNodeStats->NodeOrdinal]->GetStatistics(pNodeStats);
+}
+
 void GcKmAdapter::DpcRoutine(void)
 {
     // dp nothing other than calling back into dxgk
@@ -407,6 +407,8 @@ GcKmContext::RenderGdi(
 
     BYTE*   pInitialDmaBuffer = pDmaBuffer;
 
+    BeginGdiCommandBuffer();
+
     for (; pCurGdiCmd < pEndGdiCmd; pCurGdiCmd += pRenderKmCmd->CommandSize)
     {
         pRenderKmCmd = (DXGK_RENDERKM_COMMAND*)pCurGdiCmd;
@@ -614,6 +616,12 @@ GcKmContext::RenderGdi(
         }
     }
 
+    //
+    // Space for the held back commands is part of the DMA buffer used so far
+    //
+
+    pDmaBuffer += EndGdiCommandBuffer(pDmaBuffer);
+
     if (STATUS_GRAPHICS_INSUFFICIENT_DMA_BUFFER == Status)
     {
         pRenderGdi->MultipassOffset = (UINT)(pMultipassRestart - (BYTE*)pRenderGdi->pCommand);
@@ -36,17 +36,12 @@ GcKmSwQueueNode::Start(
     m_bPreemptionRequested = false;
 
     //
-    // Intialize DMA buffer queue and lock
+    // Intialize DMA buffer queue
     //
 
-    InitializeListHead(&m_DmaBufSubmissionFree);
-    for (UINT i = 0; i < m_MaxDmaBufQueueLength; i++)
-    {
-        InsertHeadList(&m_DmaBufSubmissionFree, &m_DmaBufSubmissions[i].m_QueueEntry);
-    }
-
-    InitializeListHead(&m_DmaBufQueue);
-    KeInitializeSpinLock(&m_DmaBufQueueLock);
+    m_DmaBufQueue.Initialize();
+    m_NextDmaBufSubmission = 0;
+    m_DmaBufQueueDepth = 0;
 
     //
     // Initialize HW DMA buffer compeletion DPC and event
@@ -149,6 +144,15 @@ GcKmSwQueueNode::Stop()
 
     ObDereferenceObject(m_pWorkerThread);
 
+    GC_LOG_TRACE(
+        "Node DMA buffers: submitted=%I64u completed=%I64u discarded=%I64u batches=%I64u max batch=%u max depth=%u",
+        m_Stats.m_SubmittedCount,
+        m_Stats.m_CompletedCount,
+        m_Stats.m_DiscardedCount,
+        m_Stats.m_BatchCount,
+        m_Stats.m_MaxBatchSize,
+        m_Stats.m_MaxQueueDepth);
+
     GC_LOG_TRACE("Node was successfully stopped.");
 
     m_pHwEngine->Stop();
@@ -160,15 +164,20 @@ NTSTATUS
 GcKmSwQueueNode::SubmitCommandVirtual(
     IN_CONST_PDXGKARG_SUBMITCOMMANDVIRTUAL pSubmitCommandVirtual)
 {
-    QueueDmaBuffer(pSubmitCommandVirtual);
+    bool        bWakeWorker = false;
+    NTSTATUS    Status = QueueDmaBuffer(pSubmitCommandVirtual, &bWakeWorker);
 
     //
-    // Wake up the worker thread for the GPU node
+    // Wake up the worker thread for the GPU node, unless it still
+    // has earlier submissions to pick up
     //
 
-    KeSetEvent(&m_WorkerThreadEvent, 0, FALSE);
+    if (bWakeWorker)
+    {
+        KeSetEvent(&m_WorkerThreadEvent, 0, FALSE);
+    }
 
-    return STATUS_SUCCESS;
+    return Status;
 }
 
 NTSTATUS
@@ -213,6 +222,25 @@ GcKmSwQueueNode::PrepareToReset()
     m_bWaitingForReset = false;
 }
 
+NTSTATUS
+GcKmSwQueueNode::GetStatistics(
+    D3dKmNodeStats *pNodeStats)
+{
+    pNodeStats->QueueDepth = (UINT)m_DmaBufQueueDepth;
+    pNodeStats->MaxQueueDepth = m_Stats.m_MaxQueueDepth;
+    pNodeStats->MaxBatchSize = m_Stats.m_MaxBatchSize;
+    pNodeStats->SubmittedCount = m_Stats.m_SubmittedCount;
+    pNodeStats->CompletedCount = m_Stats.m_CompletedCount;
+    pNodeStats->DiscardedCount = m_Stats.m_DiscardedCount;
+    pNodeStats->BatchCount = m_Stats.m_BatchCount;
+    pNodeStats->TotalWaitTime = m_Stats.m_TotalWaitTime;
+    pNodeStats->MaxWaitTime = m_Stats.m_MaxWaitTime;
+    pNodeStats->TotalExecutionTime = m_Stats.m_TotalExecutionTime;
+    pNodeStats->MaxExecutionTime = m_Stats.m_MaxExecutionTime;
+
+    return STATUS_SUCCESS;
+}
+
 void
 GcKmSwQueueNode::WorkerThread(
     void   *pThis)
@@ -288,12 +316,16 @@ GcKmSwQueueNode::DoWork(void)
                 break;
             }
 
-            GcDmaBufSubmission *pDmaBufSubmission = DequeueDmaBuffer(&m_DmaBufQueueLock);
-            if (pDmaBufSubmission == NULL)
+            GcDmaBufSubmission  DmaBufSubmission;
+
+            if (!DequeueDmaBuffer(&DmaBufSubmission))
             {
                 break;
             }
 
+            GcDmaBufSubmission *pDmaBufSubmission = &DmaBufSubmission;
+            ULONGLONG           StartTime = KeQueryInterruptTime();
+
             GcDmaBufInfo* pDmaBufInfo = pDmaBufSubmission->m_pDmaBufInfo;
 
             pDmaBufInfo->m_DmaBufState.m_bRun = 1;
@@ -331,6 +363,21 @@ GcKmSwQueueNode::DoWork(void)
                     // Need to handle paging using CPU
                     Status = m_pHwEngine->CpuTransfer(m_pMmu->GetPhysicalAddress(&RootPageTable), 
                                                       &pDmaBufInfo->m_TransferVirtual);
+                    if (STATUS_MORE_PROCESSING_REQUIRED != Status)
+                    {
+                        break;
+                    }
+
+                    //
+                    // Engine prefers the GPU for this transfer
+                    //
+
+                    Status = m_pHwEngine->SubmitCommandBuffer(
+                                            pDmaBufInfo->m_DmaBufferGpuVa,
+                                            pDmaBufInfo->m_GpuTransferSize,
+                                            pDmaBufSubmission->m_pContext,
+                                            m_pMmu->GetPhysicalAddress(&RootPageTable),
+                                            false);
                     break;
                 }
 
@@ -372,16 +419,12 @@ GcKmSwQueueNode::DoWork(void)
 
             if (STATUS_SUCCESS == Status)
             {
+                m_Stats.OnExecuted(pDmaBufSubmission->m_SubmitTime, StartTime, KeQueryInterruptTime());
+
                 // Report back to VidSch that DMA buffer has successfully completed
                 NotifyDmaBufCompletion(pDmaBufSubmission);
             }
 
-            KIRQL OldIrql;
-
-            KeAcquireSpinLock(&m_DmaBufQueueLock, &OldIrql);
-            InsertTailList(&m_DmaBufSubmissionFree, &pDmaBufSubmission->m_QueueEntry);
-            KeReleaseSpinLock(&m_DmaBufQueueLock, OldIrql);
-
             if (!((STATUS_SUCCESS == Status) || (STATUS_TIMEOUT == Status)))
             {
                 m_bWaitingForReset = true;
@@ -392,65 +435,65 @@ GcKmSwQueueNode::DoWork(void)
     }
 }
 
-GcDmaBufSubmission*
+bool
 GcKmSwQueueNode::DequeueDmaBuffer(
-    KSPIN_LOCK *pDmaBufQueueLock)
+    GcDmaBufSubmission *pDmaBufSubmission)
 {
-    LIST_ENTRY *pQueueEntry;
-    KIRQL OldIrql = {};
+    GcDmaBufSubmission *pQueuedSubmission = m_DmaBufQueue.Pop();
 
-    if (pDmaBufQueueLock)
+    if (NULL == pQueuedSubmission)
     {
-        KeAcquireSpinLock(pDmaBufQueueLock, &OldIrql);
-    }
+        //
+        // Current batch is done, grab everything submitted since in one go
+        //
 
-    pQueueEntry = IsListEmpty(&m_DmaBufQueue) ? NULL : RemoveHeadList(&m_DmaBufQueue);
+        m_Stats.OnBatch(m_DmaBufQueue.DequeueBatch());
 
-    if (pDmaBufQueueLock)
-    {
-        KeReleaseSpinLock(pDmaBufQueueLock, OldIrql);
+        pQueuedSubmission = m_DmaBufQueue.Pop();
+        if (NULL == pQueuedSubmission)
+        {
+            return false;
+        }
     }
 
-    return pQueueEntry ? CONTAINING_RECORD(pQueueEntry, GcDmaBufSubmission, m_QueueEntry) : NULL;
+    //
+    // Copy the submission out and retire its slot right away,
+    // slots are retired in the same order they were taken
+    //
+
+    *pDmaBufSubmission = *pQueuedSubmission;
+
+    InterlockedDecrement(&m_DmaBufQueueDepth);
+
+    return true;
 }
 
 void
 GcKmSwQueueNode::EmptyDmaBufferQueue(
     bool bForPreemption)
 {
-    KIRQL   OldIrql;
-
-    KeAcquireSpinLock(&m_DmaBufQueueLock, &OldIrql);
-
-    LIST_ENTRY* pQueueEntry;
-    GcDmaBufSubmission* pDmaBufSubmission;
+    GcDmaBufSubmission  DmaBufSubmission;
     BOOLEAN bHasEntry = false;
 
-    while (!IsListEmpty(&m_DmaBufQueue))
+    while (DequeueDmaBuffer(&DmaBufSubmission))
     {
-        pQueueEntry = RemoveHeadList(&m_DmaBufQueue);
-
-        pDmaBufSubmission = CONTAINING_RECORD(pQueueEntry, GcDmaBufSubmission, m_QueueEntry);
-
         if (!bHasEntry)
         {
             bHasEntry = true;
-            m_LastProcessedFenceId = pDmaBufSubmission->m_SubmissionFenceId;
+            m_LastProcessedFenceId = DmaBufSubmission.m_SubmissionFenceId;
         }
 
         if (bForPreemption)
         {
-            pDmaBufSubmission->m_pDmaBufInfo->m_DmaBufState.m_bPreempted = 1;
+            DmaBufSubmission.m_pDmaBufInfo->m_DmaBufState.m_bPreempted = 1;
         }
         else
         {
-            pDmaBufSubmission->m_pDmaBufInfo->m_DmaBufState.m_bReset = 1;
+            DmaBufSubmission.m_pDmaBufInfo->m_DmaBufState.m_bReset = 1;
         }
 
-        InsertTailList(&m_DmaBufSubmissionFree, pQueueEntry);
+        m_Stats.OnDiscarded();
     }
-
-    KeReleaseSpinLock(&m_DmaBufQueueLock, OldIrql);
 }
 
 void
@@ -546,14 +589,38 @@ GcKmSwQueueNode::SynchronizeNotifyInterrupt(void)
     return m_DxgkInterface.DxgkCbQueueDpc(m_DxgkInterface.DeviceHandle);
 }
 
-void
+NTSTATUS
 GcKmSwQueueNode::QueueDmaBuffer(
-    IN_CONST_PDXGKARG_SUBMITCOMMANDVIRTUAL pSubmitCommandVirtual)
+    IN_CONST_PDXGKARG_SUBMITCOMMANDVIRTUAL pSubmitCommandVirtual,
+    bool *pbWakeWorker)
 {
     UINT                DmaBufferUmdPrivateDataSize = pSubmitCommandVirtual->DmaBufferUmdPrivateDataSize;
     GcDmaBufInfo       *pDmaBufInfo;
-    KIRQL               OldIrql;
     GcDmaBufSubmission *pDmaBufSubmission;
+    LONG                QueueDepth;
+
+    *pbWakeWorker = false;
+
+    //
+    // Reserve a slot before touching the submission. VidSch serializes
+    // submissions to a node and never has more than RequiredDmaQueueEntry
+    // of them outstanding, one beyond that would overwrite the oldest
+    // slot before the worker thread has retired it. Slots are taken and
+    // retired in the same order, so the next slot is free as long as the
+    // depth stays within the queue length.
+    //
+
+    QueueDepth = InterlockedIncrement(&m_DmaBufQueueDepth);
+    if (QueueDepth > (LONG)m_MaxDmaBufQueueLength)
+    {
+        InterlockedDecrement(&m_DmaBufQueueDepth);
+
+        GC_LOG_ERROR(
+            "DMA buffer queue is full, submission rejected. (SubmissionFenceId=%d, m_MaxDmaBufQueueLength=%d)",
+            pSubmitCommandVirtual->SubmissionFenceId,
+            m_MaxDmaBufQueueLength);
+        return STATUS_DEVICE_BUSY;
+    }
 
     if (DmaBufferUmdPrivateDataSize &&
         ((pSubmitCommandVirtual->DmaBufferPrivateDataSize - DmaBufferUmdPrivateDataSize) < sizeof(GcDmaBufInfo)))
@@ -571,11 +638,8 @@ GcKmSwQueueNode::QueueDmaBuffer(
         pDmaBufInfo = &m_DefaultDmaBufInfo;
     }
 
-    KeAcquireSpinLock(&m_DmaBufQueueLock, &OldIrql);
-
-    NT_ASSERT(!IsListEmpty(&m_DmaBufSubmissionFree));
-
-    pDmaBufSubmission = CONTAINING_RECORD(RemoveHeadList(&m_DmaBufSubmissionFree), GcDmaBufSubmission, m_QueueEntry);
+    pDmaBufSubmission = &m_DmaBufSubmissions[m_NextDmaBufSubmission];
+    m_NextDmaBufSubmission = (m_NextDmaBufSubmission + 1) % m_MaxDmaBufQueueLength;
 
     if (!(pSubmitCommandVirtual->Flags.Resubmission || pSubmitCommandVirtual->Flags.ContextSwitch))
     {
@@ -623,12 +687,15 @@ GcKmSwQueueNode::QueueDmaBuffer(
     pDmaBufSubmission->m_NodeOrdinal = pSubmitCommandVirtual->NodeOrdinal;
 
     pDmaBufSubmission->m_SubmissionFenceId = pSubmitCommandVirtual->SubmissionFenceId;
-
-    InsertTailList(&m_DmaBufQueue, &pDmaBufSubmission->m_QueueEntry);
+    pDmaBufSubmission->m_SubmitTime = KeQueryInterruptTime();
 
     m_LastSubmittedFenceId = pSubmitCommandVirtual->SubmissionFenceId;
 
-    KeReleaseSpinLock(&m_DmaBufQueueLock, OldIrql);
+    m_Stats.OnSubmit((UINT)QueueDepth);
+
+    *pbWakeWorker = m_DmaBufQueue.Push(pDmaBufSubmission);
+
+    return STATUS_SUCCESS;
 }
 
 void
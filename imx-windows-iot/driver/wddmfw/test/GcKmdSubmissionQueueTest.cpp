@@ -0,0 +1,275 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host unit test of GcKmMpscQueue and GcKmSubmissionStats
+//
+// The single threaded cases check the submission order across pushes
+// interleaved with batches, and the wake-up hint returned by Push. The
+// stress case runs several producer threads against one consumer, which
+// must see every entry exactly once and each producer's entries in order.
+//
+
+#include "precomp.h"
+#include "GcKmdSubmissionQueue.h"
+#include "HostTest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+struct TestEntry
+{
+    TestEntry  *m_pNext;
+    UINT        m_Producer;
+    UINT        m_Sequence;
+};
+
+static void
+TestEmpty()
+{
+    GcKmMpscQueue<TestEntry>    Queue;
+
+    Queue.Initialize();
+
+    CHECK(0 == Queue.DequeueBatch());
+    CHECK(nullptr == Queue.Pop());
+}
+
+static void
+TestOrder()
+{
+    GcKmMpscQueue<TestEntry>    Queue;
+    TestEntry                   Entries[8] = {};
+
+    Queue.Initialize();
+
+    for (UINT i = 0; i < 8; i++)
+    {
+        Entries[i].m_Sequence = i;
+    }
+
+    //
+    // Only a push onto an empty list asks for a wake-up
+    //
+    CHECK(Queue.Push(&Entries[0]));
+    CHECK(!Queue.Push(&Entries[1]));
+    CHECK(!Queue.Push(&Entries[2]));
+
+    CHECK(3 == Queue.DequeueBatch());
+
+    //
+    // Pushes after the batch was taken go behind it, even before the
+    // batch is drained
+    //
+    CHECK(Queue.Push(&Entries[3]));
+    CHECK(!Queue.Push(&Entries[4]));
+
+    CHECK(&Entries[0] == Queue.Pop());
+    CHECK(nullptr == Entries[0].m_pNext);
+    CHECK(&Entries[1] == Queue.Pop());
+
+    CHECK(2 == Queue.DequeueBatch());
+    CHECK(0 == Queue.DequeueBatch());
+
+    CHECK(&Entries[2] == Queue.Pop());
+    CHECK(&Entries[3] == Queue.Pop());
+    CHECK(&Entries[4] == Queue.Pop());
+    CHECK(nullptr == Queue.Pop());
+
+    //
+    // A drained batch starts over
+    //
+    CHECK(Queue.Push(&Entries[5]));
+    CHECK(!Queue.Push(&Entries[6]));
+    CHECK(2 == Queue.DequeueBatch());
+    CHECK(Queue.Push(&Entries[7]));
+    CHECK(1 == Queue.DequeueBatch());
+
+    for (UINT i = 5; i < 8; i++)
+    {
+        TestEntry  *pEntry = Queue.Pop();
+
+        CHECK(pEntry && (i == pEntry->m_Sequence));
+    }
+
+    CHECK(nullptr == Queue.Pop());
+    CHECK(0 == Queue.DequeueBatch());
+}
+
+//
+// Pushes with nothing dequeued in between still come out in order after
+// a reinitialization, as after a reset of the node
+//
+
+static void
+TestDrainAndReinitialize()
+{
+    GcKmMpscQueue<TestEntry>    Queue;
+    TestEntry                   Entries[4] = {};
+    UINT                        Drained = 0;
+
+    Queue.Initialize();
+
+    for (UINT i = 0; i < 4; i++)
+    {
+        Entries[i].m_Sequence = i;
+        Queue.Push(&Entries[i]);
+    }
+
+    while (Queue.DequeueBatch())
+    {
+        while (TestEntry *pEntry = Queue.Pop())
+        {
+            CHECK(Drained == pEntry->m_Sequence);
+            Drained++;
+        }
+    }
+
+    CHECK(4 == Drained);
+
+    Queue.Initialize();
+    CHECK(Queue.Push(&Entries[0]));
+    CHECK(1 == Queue.DequeueBatch());
+    CHECK(&Entries[0] == Queue.Pop());
+    CHECK(nullptr == Queue.Pop());
+}
+
+static void
+TestConcurrentProducers()
+{
+    const UINT                  NumProducers = 4;
+    const UINT                  NumPerProducer = 100000;
+    GcKmMpscQueue<TestEntry>    Queue;
+    std::vector<TestEntry>      Entries(NumProducers * NumPerProducer);
+    std::vector<UINT>           NextSequence(NumProducers, 0);
+    std::vector<std::thread>    Producers;
+    std::atomic<UINT>           NumWakeups(0);
+    std::atomic<UINT>           NumFinished(0);
+    UINT                        Received = 0;
+    UINT                        OutOfOrder = 0;
+    UINT                        NumBatches = 0;
+
+    Queue.Initialize();
+
+    for (UINT p = 0; p < NumProducers; p++)
+    {
+        Producers.emplace_back([&, p]()
+            {
+                for (UINT i = 0; i < NumPerProducer; i++)
+                {
+                    TestEntry  *pEntry = &Entries[p * NumPerProducer + i];
+
+                    pEntry->m_Producer = p;
+                    pEntry->m_Sequence = i;
+
+                    if (Queue.Push(pEntry))
+                    {
+                        NumWakeups++;
+                    }
+                }
+
+                NumFinished++;
+            });
+    }
+
+    while (Received < Entries.size())
+    {
+        bool    IsPushDone = (NumProducers == NumFinished);
+        UINT    Count = Queue.DequeueBatch();
+        UINT    Popped = 0;
+
+        if (Count)
+        {
+            NumBatches++;
+        }
+
+        while (TestEntry *pEntry = Queue.Pop())
+        {
+            if (pEntry->m_Sequence != NextSequence[pEntry->m_Producer])
+            {
+                OutOfOrder++;
+            }
+
+            NextSequence[pEntry->m_Producer] = pEntry->m_Sequence + 1;
+            Popped++;
+        }
+
+        CHECK(Count == Popped);
+        Received += Popped;
+
+        //
+        // Everything was pushed before this batch was taken, a broken queue
+        // lost entries
+        //
+        if (IsPushDone && (0 == Popped))
+        {
+            break;
+        }
+    }
+
+    for (auto& Producer : Producers)
+    {
+        Producer.join();
+    }
+
+    CHECK(0 == OutOfOrder);
+    CHECK(Entries.size() == Received);
+    CHECK(0 == Queue.DequeueBatch());
+    CHECK(nullptr == Queue.Pop());
+
+    for (UINT p = 0; p < NumProducers; p++)
+    {
+        CHECK(NumPerProducer == NextSequence[p]);
+    }
+
+    //
+    // Each batch was announced by the one push that found the list empty
+    //
+    CHECK(NumWakeups == NumBatches);
+}
+
+static void
+TestStats()
+{
+    GcKmSubmissionStats Stats = {};
+
+    Stats.OnSubmit(1);
+    Stats.OnSubmit(3);
+    Stats.OnSubmit(2);
+
+    CHECK(3 == Stats.m_SubmittedCount);
+    CHECK(3 == Stats.m_MaxQueueDepth);
+
+    Stats.OnBatch(0);
+    Stats.OnBatch(2);
+    Stats.OnBatch(1);
+
+    CHECK(2 == Stats.m_BatchCount);
+    CHECK(2 == Stats.m_MaxBatchSize);
+
+    Stats.OnExecuted(100, 150, 400);
+    Stats.OnExecuted(200, 400, 450);
+    Stats.OnDiscarded();
+
+    CHECK(2 == Stats.m_CompletedCount);
+    CHECK(1 == Stats.m_DiscardedCount);
+    CHECK(250 == Stats.m_TotalWaitTime);
+    CHECK(200 == Stats.m_MaxWaitTime);
+    CHECK(300 == Stats.m_TotalExecutionTime);
+    CHECK(250 == Stats.m_MaxExecutionTime);
+}
+
+int
+main()
+{
+    TestEmpty();
+    TestOrder();
+    TestDrainAndReinitialize();
+    TestConcurrentProducers();
+    TestStats();
+
+    return HostTestResult("GcKmdSubmissionQueueTest");
+}
@@ -0,0 +1,37 @@
+/* Copyright 2023 NXP
+   Licensed under the MIT License. */
+
+//
+// Host build stand-in for the kernel headers used by GcKmdSubmissionQueue.h
+//
+
+#pragma once
+
+#include <stdint.h>
+
+typedef unsigned int        UINT;
+typedef uint64_t            ULONGLONG;
+typedef void               *PVOID;
+
+//
+// Full barriers, as the kernel routines
+//
+
+inline PVOID
+InterlockedCompareExchangePointer(
+    PVOID volatile *Destination,
+    PVOID           Exchange,
+    PVOID           Comperand)
+{
+    __atomic_compare_exchange_n(Destination, &Comperand, Exchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+
+    return Comperand;
+}
+
+inline PVOID
+InterlockedExchangePointer(
+    PVOID volatile *Target,
+    PVOID           Value)
+{
+    return __atomic_exchange_n(Target, Value, __ATOMIC_SEQ_CST);
+}